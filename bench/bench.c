@@ -0,0 +1,96 @@
+#include "bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+unsigned bench_scale(void)
+{
+    const char *env = getenv("BENCH_SCALE");
+    if (env == NULL) {
+        return 1U;
+    }
+    unsigned long v = strtoul(env, NULL, 10);
+    return ((v == 0UL) || (v > 1000UL)) ? 1U : (unsigned)v;
+}
+
+int bench_begin(bench_t *b, const char *name, size_t max_samples)
+{
+    memset(b, 0, sizeof(*b));
+    b->name = name;
+    if (max_samples > 0U) {
+        b->lat_ns = malloc(max_samples * sizeof(uint64_t));
+        if (b->lat_ns == NULL) {
+            return -1;
+        }
+        b->lat_cap = max_samples;
+    }
+    b->t0_ns = bench_now_ns();
+    return 0;
+}
+
+void bench_start(bench_t *b)
+{
+    b->lat_n = 0U;
+    b->t0_ns = bench_now_ns();
+}
+
+void bench_sample(bench_t *b, uint64_t ns)
+{
+    if (b->lat_n < b->lat_cap) {
+        b->lat_ns[b->lat_n++] = ns;
+    }
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of the sorted samples */
+static uint64_t percentile(const uint64_t *v, size_t n, unsigned pct)
+{
+    if (n == 0U) {
+        return 0U;
+    }
+    size_t rank = ((n * pct) + 99U) / 100U;
+    return v[(rank == 0U) ? 0U : rank - 1U];
+}
+
+void bench_end(bench_t *b, uint64_t ops, uint64_t bytes)
+{
+    b->elapsed_ns = bench_now_ns() - b->t0_ns;
+    b->ops = ops;
+    b->bytes = bytes;
+
+    qsort(b->lat_ns, b->lat_n, sizeof(uint64_t), cmp_u64);
+    double secs = (double)b->elapsed_ns / 1e9;
+    if (secs <= 0.0) {
+        secs = 1e-9;
+    }
+    printf("{\"bench\":\"%s\",\"ops\":%llu,\"bytes\":%llu,\"secs\":%.6f,"
+           "\"ops_s\":%.1f,\"mb_s\":%.1f,\"p50_ns\":%llu,\"p99_ns\":%llu}\n",
+           b->name, (unsigned long long)ops, (unsigned long long)bytes, secs,
+           (double)ops / secs, ((double)bytes / (1024.0 * 1024.0)) / secs,
+           (unsigned long long)percentile(b->lat_ns, b->lat_n, 50U),
+           (unsigned long long)percentile(b->lat_ns, b->lat_n, 99U));
+    fflush(stdout);
+    free(b->lat_ns);
+    b->lat_ns = NULL;
+    b->lat_cap = 0U;
+}
+
+void bench_skip(const char *name, const char *why)
+{
+    printf("{\"bench\":\"%s\",\"skipped\":\"%s\"}\n", name, why);
+    fflush(stdout);
+}
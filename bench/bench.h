@@ -0,0 +1,61 @@
+/*
+ * Microbenchmark harness shared by bench/bench_*.c.
+ *
+ * Every case prints one JSON object per line on stdout:
+ *
+ *   {"bench":"sendfile_loopback","ops":256,"bytes":268435456,
+ *    "secs":0.142,"ops_s":1802.8,"mb_s":1802.8,"p50_ns":512000,
+ *    "p99_ns":901000}
+ *
+ * ops/bytes are totals over the timed region, ops_s and mb_s derive
+ * from the wall time, and p50/p99 come from the per-sample latencies
+ * the case recorded (one sample per op, or per batch of ops divided
+ * down for nanosecond-scale operations).  "mb_s" is MiB/s and is 0
+ * for cases that move no payload.
+ *
+ * BENCH_SCALE (environment, default 1) multiplies every iteration
+ * count, for longer and steadier runs on release machines.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    const char *name;
+    uint64_t ops;
+    uint64_t bytes;
+    uint64_t t0_ns;
+    uint64_t elapsed_ns;
+    uint64_t *lat_ns; /**< Samples, dropped once lat_cap is reached */
+    size_t lat_n;
+    size_t lat_cap;
+} bench_t;
+
+/** CLOCK_MONOTONIC in nanoseconds */
+uint64_t bench_now_ns(void);
+
+/** BENCH_SCALE from the environment (>= 1) */
+unsigned bench_scale(void);
+
+/**
+ * @brief Prepare a case with room for @p max_samples latencies
+ *
+ * @return 0, or -1 if the sample buffer cannot be allocated
+ */
+int bench_begin(bench_t *b, const char *name, size_t max_samples);
+
+/** Start the timed region (bench_begin() starts it too) */
+void bench_start(bench_t *b);
+
+/** Record one latency sample */
+void bench_sample(bench_t *b, uint64_t ns);
+
+/** Close the timed region, print the JSON line, free the samples */
+void bench_end(bench_t *b, uint64_t ops, uint64_t bytes);
+
+/** Print {"bench":name,"skipped":why} for a case that cannot run here */
+void bench_skip(const char *name, const char *why);
+
+#endif
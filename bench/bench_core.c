@@ -0,0 +1,281 @@
+/*
+ * CPU-bound hot paths: ChaCha20 XOR, the arena allocator under
+ * contention, the stream buffer pool, path normalize/resolve and
+ * listing line formatting.
+ */
+#include "bench.h"
+#include "ftp_buffer_pool.h"
+#include "ftp_crypto.h"
+#include "ftp_list.h"
+#include "ftp_path.h"
+#include "pal_alloc.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* Nanosecond-scale ops are timed in batches; samples are per op */
+#define BATCH 64U
+#define THREADS 4U
+#define SLOTS 256U
+#define ALLOC_ARENA_SIZE (64U * 1024U * 1024U)
+#define CRYPTO_BUF (1U * 1024U * 1024U)
+
+static unsigned g_scale = 1U;
+
+static uint32_t xs32(uint32_t *s)
+{
+    uint32_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *s = x;
+    return x;
+}
+
+static void bench_crypto(void)
+{
+#if FTP_ENABLE_CRYPTO
+    static char name[32];
+    uint8_t key[32];
+    uint8_t nonce[12];
+    ftp_crypto_ctx_t ctx;
+    bench_t b;
+
+    uint8_t *buf = malloc(CRYPTO_BUF);
+    if (buf == NULL) {
+        return;
+    }
+    memset(buf, 0x5A, CRYPTO_BUF);
+    memset(key, 0x11, sizeof(key));
+    memset(nonce, 0x22, sizeof(nonce));
+    (void)snprintf(name, sizeof(name), "crypto_xor_%s",
+                   ftp_crypto_backend_name());
+
+    unsigned rounds = 64U * g_scale;
+    if (bench_begin(&b, name, rounds) == 0) {
+        ftp_crypto_init(&ctx, key, nonce);
+        for (unsigned i = 0U; i < rounds; i++) {
+            uint64_t t = bench_now_ns();
+            ftp_crypto_xor(&ctx, buf, CRYPTO_BUF);
+            bench_sample(&b, bench_now_ns() - t);
+        }
+        bench_end(&b, rounds, (uint64_t)rounds * CRYPTO_BUF);
+    }
+    free(buf);
+#else
+    bench_skip("crypto_xor", "FTP_ENABLE_CRYPTO=0");
+#endif
+}
+
+/*---------------------------------------------------------------------------*
+ * Threaded cases: each worker keeps its own samples, merged afterwards
+ *---------------------------------------------------------------------------*/
+
+typedef struct {
+    pal_allocator_t *arena;
+    uint32_t seed;
+    unsigned iters;
+    uint64_t *lat;
+    size_t lat_n;
+    uint64_t ops;
+} worker_t;
+
+static void *alloc_worker(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+    void *slots[SLOTS] = {0};
+
+    for (unsigned i = 0U; i < w->iters; i += BATCH) {
+        uint64_t t = bench_now_ns();
+        for (unsigned k = 0U; k < BATCH; k++) {
+            uint32_t r = xs32(&w->seed);
+            uint32_t idx = r % SLOTS;
+            if (slots[idx] != NULL) {
+                pal_allocator_free(w->arena, slots[idx]);
+                slots[idx] = NULL;
+            } else {
+                slots[idx] = pal_allocator_malloc(w->arena,
+                                                  (size_t)(r % 4096U) + 16U);
+            }
+        }
+        w->lat[w->lat_n++] = (bench_now_ns() - t) / BATCH;
+        w->ops += BATCH;
+    }
+    for (unsigned i = 0U; i < SLOTS; i++) {
+        pal_allocator_free(w->arena, slots[i]);
+    }
+    return NULL;
+}
+
+static void *pool_worker(void *arg)
+{
+    worker_t *w = (worker_t *)arg;
+
+    for (unsigned i = 0U; i < w->iters; i += BATCH) {
+        uint64_t t = bench_now_ns();
+        for (unsigned k = 0U; k < BATCH; k++) {
+            void *buf = ftp_buffer_acquire();
+            ftp_buffer_release(buf);
+        }
+        w->lat[w->lat_n++] = (bench_now_ns() - t) / BATCH;
+        w->ops += BATCH;
+    }
+    return NULL;
+}
+
+static void run_threads(const char *name, void *(*fn)(void *),
+                        pal_allocator_t *arena, unsigned threads,
+                        unsigned iters)
+{
+    worker_t w[THREADS];
+    pthread_t tid[THREADS];
+    size_t per = (iters / BATCH) + 1U;
+    bench_t b;
+
+    if (bench_begin(&b, name, per * threads) != 0) {
+        return;
+    }
+    for (unsigned i = 0U; i < threads; i++) {
+        memset(&w[i], 0, sizeof(w[i]));
+        w[i].arena = arena;
+        w[i].seed = 0x9E3779B9U ^ (i * 7919U);
+        w[i].iters = iters;
+        w[i].lat = b.lat_ns + (i * per);
+    }
+    bench_start(&b);
+    unsigned started = 0U;
+    for (; started < threads; started++) {
+        if (pthread_create(&tid[started], NULL, fn, &w[started]) != 0) {
+            break;
+        }
+    }
+    uint64_t ops = 0U;
+    for (unsigned i = 0U; i < started; i++) {
+        (void)pthread_join(tid[i], NULL);
+        ops += w[i].ops;
+    }
+    /* Compact the per-thread slices into one sample set */
+    for (unsigned i = 0U; i < started; i++) {
+        memmove(b.lat_ns + b.lat_n, w[i].lat, w[i].lat_n * sizeof(uint64_t));
+        b.lat_n += w[i].lat_n;
+    }
+    bench_end(&b, ops, 0U);
+}
+
+static void bench_alloc(void)
+{
+    static pal_allocator_t arena;
+    void *mem = aligned_alloc(4096U, ALLOC_ARENA_SIZE);
+    if ((mem == NULL) ||
+        (pal_allocator_init(&arena, mem, ALLOC_ARENA_SIZE) != 0)) {
+        free(mem);
+        bench_skip("alloc_malloc_free", "arena init failed");
+        return;
+    }
+    unsigned iters = 200000U * g_scale;
+    run_threads("alloc_malloc_free_1t", alloc_worker, &arena, 1U, iters);
+    run_threads("alloc_malloc_free_4t", alloc_worker, &arena, THREADS, iters);
+    free(mem);
+}
+
+static void bench_buffer_pool(void)
+{
+    unsigned iters = 500000U * g_scale;
+    run_threads("buffer_acquire_release_1t", pool_worker, NULL, 1U, iters);
+    run_threads("buffer_acquire_release_4t", pool_worker, NULL, THREADS,
+                iters);
+}
+
+static void bench_path(void)
+{
+    static const char *const inputs[] = {
+        "/home/user/../admin/./docs//report.txt",
+        "/a/b/c/d/e/f/g/h/../../../../x",
+        "/mnt/usb0/games/CUSA00001/sce_sys/param.sfo",
+    };
+    char out[FTP_PATH_MAX];
+    unsigned iters = 1000000U * g_scale;
+    bench_t b;
+
+    if (bench_begin(&b, "path_normalize", iters / BATCH) == 0) {
+        for (unsigned i = 0U; i < iters; i += BATCH) {
+            uint64_t t = bench_now_ns();
+            for (unsigned k = 0U; k < BATCH; k++) {
+                (void)ftp_path_normalize(inputs[k % 3U], out, sizeof(out));
+            }
+            bench_sample(&b, (bench_now_ns() - t) / BATCH);
+        }
+        bench_end(&b, iters, 0U);
+    }
+
+    /* Relative names under a root that exists, as RETR/STOR resolve them */
+    ftp_session_t s;
+    static ftp_session_paths_t paths;
+    memset(&s, 0, sizeof(s));
+    s.root_path = paths.root_path;
+    s.cwd = paths.cwd;
+    (void)snprintf(paths.root_path, sizeof(paths.root_path), "/tmp");
+    (void)snprintf(paths.cwd, sizeof(paths.cwd), "/tmp");
+
+    iters = 200000U * g_scale;
+    if (bench_begin(&b, "path_resolve", iters / BATCH) == 0) {
+        for (unsigned i = 0U; i < iters; i += BATCH) {
+            uint64_t t = bench_now_ns();
+            for (unsigned k = 0U; k < BATCH; k++) {
+                (void)ftp_path_resolve(&s, "incoming/../upload.bin", out,
+                                       sizeof(out));
+            }
+            bench_sample(&b, (bench_now_ns() - t) / BATCH);
+        }
+        bench_end(&b, iters, 0U);
+    }
+}
+
+static void bench_list(void)
+{
+    static const struct {
+        const char *name;
+        ftp_list_format_t fmt;
+    } cases[] = {
+        {"list_format_unix", FTP_LIST_UNIX},
+        {"list_format_mlsd", FTP_LIST_MLSD},
+    };
+    char line[FTP_LIST_LINE_SIZE];
+    vfs_stat_t st;
+    memset(&st, 0, sizeof(st));
+    st.mode = (uint32_t)S_IFREG | 0644U;
+    st.size = 4294967296ULL + 12345ULL;
+
+    for (size_t c = 0U; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        unsigned iters = 1000000U * g_scale;
+        uint64_t bytes = 0U;
+        bench_t b;
+        if (bench_begin(&b, cases[c].name, iters / BATCH) != 0) {
+            continue;
+        }
+        for (unsigned i = 0U; i < iters; i += BATCH) {
+            uint64_t t = bench_now_ns();
+            for (unsigned k = 0U; k < BATCH; k++) {
+                st.mtime = 1700000000LL + (int64_t)(i + k);
+                bytes += ftp_list_format(cases[c].fmt, &st,
+                                         "some_reasonably_long_file_name.pkg",
+                                         line, sizeof(line));
+            }
+            bench_sample(&b, (bench_now_ns() - t) / BATCH);
+        }
+        bench_end(&b, iters, bytes);
+    }
+}
+
+int main(void)
+{
+    g_scale = bench_scale();
+    bench_crypto();
+    bench_alloc();
+    bench_buffer_pool();
+    bench_path();
+    bench_list();
+    return 0;
+}
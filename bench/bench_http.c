@@ -0,0 +1,48 @@
+/*
+ * http_parse_request() on a browser-sized GET.  The parser tokenises
+ * in place, so each op includes copying the request into a scratch
+ * buffer, as http_server.c hands it fresh recv() data.
+ */
+#include "bench.h"
+#include "http_parser.h"
+#include <string.h>
+
+#define BATCH 64U
+
+static const char g_request[] =
+    "GET /api/list?path=%2Fmnt%2Fusb0%2Fgames HTTP/1.1\r\n"
+    "Host: 192.168.1.50:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 "
+    "Firefox/128.0\r\n"
+    "Accept: application/json, text/plain, */*\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Referer: http://192.168.1.50:8080/\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: zftpd_csrf=0123456789abcdef0123456789abcdef\r\n"
+    "\r\n";
+
+int main(void)
+{
+    char work[sizeof(g_request)];
+    static http_request_t req;
+    unsigned iters = 500000U * bench_scale();
+    uint64_t parsed = 0U;
+    bench_t b;
+
+    if (bench_begin(&b, "http_parse_request", iters / BATCH) != 0) {
+        return 1;
+    }
+    for (unsigned i = 0U; i < iters; i += BATCH) {
+        uint64_t t = bench_now_ns();
+        for (unsigned k = 0U; k < BATCH; k++) {
+            memcpy(work, g_request, sizeof(g_request));
+            if (http_parse_request(work, sizeof(g_request) - 1U, &req) == 0) {
+                parsed++;
+            }
+        }
+        bench_sample(&b, (bench_now_ns() - t) / BATCH);
+    }
+    bench_end(&b, parsed, parsed * (sizeof(g_request) - 1U));
+    return 0;
+}
@@ -0,0 +1,330 @@
+/*
+ * Data-path throughput over loopback TCP: pal_sendfile() as RETR
+ * drives it, and the STOR receive pipeline (recv into pool buffers,
+ * pal_ring hand-off, writer thread to disk) as stor_ring_receive()
+ * runs it.  Samples are per pal_sendfile() call and per received
+ * buffer respectively.
+ */
+#include "bench.h"
+#include "ftp_buffer_pool.h"
+#include "ftp_config.h"
+#include "pal_fileio.h"
+#include "pal_ring.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define FILE_SIZE (64U * 1024U * 1024U)
+#define SEND_CHUNK (1U * 1024U * 1024U)
+
+static unsigned g_scale = 1U;
+
+/* Connected loopback pair: *tx dialled, *rx accepted */
+static int tcp_pair(int *tx, int *rx)
+{
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (lfd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+        (listen(lfd, 1) != 0) ||
+        (getsockname(lfd, (struct sockaddr *)&addr, &len) != 0)) {
+        close(lfd);
+        return -1;
+    }
+    *tx = socket(AF_INET, SOCK_STREAM, 0);
+    if ((*tx < 0) ||
+        (connect(*tx, (struct sockaddr *)&addr, sizeof(addr)) != 0)) {
+        if (*tx >= 0) {
+            close(*tx);
+        }
+        close(lfd);
+        return -1;
+    }
+    *rx = accept(lfd, NULL, NULL);
+    close(lfd);
+    if (*rx < 0) {
+        close(*tx);
+        return -1;
+    }
+    return 0;
+}
+
+static int temp_file(size_t size)
+{
+    char path[] = "/var/tmp/zftpd_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return -1;
+    }
+    (void)unlink(path);
+    if (size == 0U) {
+        return fd;
+    }
+    uint8_t *chunk = malloc(SEND_CHUNK);
+    if (chunk == NULL) {
+        close(fd);
+        return -1;
+    }
+    for (size_t i = 0U; i < SEND_CHUNK; i++) {
+        chunk[i] = (uint8_t)((i * 31U) ^ (i >> 11));
+    }
+    for (size_t done = 0U; done < size; done += SEND_CHUNK) {
+        if (write(fd, chunk, SEND_CHUNK) != (ssize_t)SEND_CHUNK) {
+            free(chunk);
+            close(fd);
+            return -1;
+        }
+    }
+    free(chunk);
+    return fd;
+}
+
+typedef struct {
+    int fd;
+    uint64_t bytes;
+} peer_t;
+
+static void *drain_thread(void *arg)
+{
+    peer_t *p = (peer_t *)arg;
+    static uint8_t sink[256U * 1024U];
+    for (;;) {
+        ssize_t n = recv(p->fd, sink, sizeof(sink), 0);
+        if (n > 0) {
+            p->bytes += (uint64_t)n;
+        } else if ((n < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void *feed_thread(void *arg)
+{
+    peer_t *p = (peer_t *)arg;
+    static uint8_t src[256U * 1024U];
+    memset(src, 0xA5, sizeof(src));
+    while (p->bytes > 0U) {
+        size_t want = (p->bytes < sizeof(src)) ? (size_t)p->bytes : sizeof(src);
+        ssize_t n = send(p->fd, src, want, 0);
+        if (n > 0) {
+            p->bytes -= (uint64_t)n;
+        } else if ((n < 0) && (errno == EINTR)) {
+            continue;
+        } else {
+            break;
+        }
+    }
+    shutdown(p->fd, SHUT_WR);
+    return NULL;
+}
+
+static void bench_sendfile(void)
+{
+    unsigned rounds = 4U * g_scale;
+    int file = temp_file(FILE_SIZE);
+    int tx = -1;
+    int rx = -1;
+    if ((file < 0) || (tcp_pair(&tx, &rx) != 0)) {
+        if (file >= 0) {
+            close(file);
+        }
+        bench_skip("sendfile_loopback", "loopback setup failed");
+        return;
+    }
+
+    peer_t peer = {rx, 0U};
+    pthread_t tid;
+    bench_t b;
+    if ((pthread_create(&tid, NULL, drain_thread, &peer) != 0)) {
+        close(tx);
+        close(rx);
+        close(file);
+        return;
+    }
+    if (bench_begin(&b, "sendfile_loopback",
+                    ((size_t)rounds * FILE_SIZE / SEND_CHUNK) * 2U) == 0) {
+        uint64_t sent = 0U;
+        uint64_t calls = 0U;
+        for (unsigned r = 0U; r < rounds; r++) {
+            off_t off = 0;
+            while (off < (off_t)FILE_SIZE) {
+                size_t left = FILE_SIZE - (size_t)off;
+                uint64_t t = bench_now_ns();
+                ssize_t n = pal_sendfile(tx, file, &off,
+                                         (left < SEND_CHUNK) ? left
+                                                             : SEND_CHUNK);
+                if (n <= 0) {
+                    if ((n < 0) && (errno == EINTR)) {
+                        continue;
+                    }
+                    r = rounds;
+                    break;
+                }
+                bench_sample(&b, bench_now_ns() - t);
+                sent += (uint64_t)n;
+                calls++;
+            }
+        }
+        shutdown(tx, SHUT_WR);
+        (void)pthread_join(tid, NULL);
+        bench_end(&b, calls, sent);
+    } else {
+        shutdown(tx, SHUT_WR);
+        (void)pthread_join(tid, NULL);
+    }
+    close(tx);
+    close(rx);
+    close(file);
+}
+
+static void *ring_alloc(void *ctx)
+{
+    (void)ctx;
+    return ftp_buffer_acquire();
+}
+
+static void ring_release(void *buf, void *ctx)
+{
+    (void)ctx;
+    ftp_buffer_release(buf);
+}
+
+typedef struct {
+    pal_ring_t ring;
+    int fd;
+    int error;
+} writer_t;
+
+static void *writer_thread(void *arg)
+{
+    writer_t *w = (writer_t *)arg;
+    for (;;) {
+        size_t n = 0U;
+        void *buf = pal_ring_peek(&w->ring, &n);
+        if (buf == NULL) {
+            break;
+        }
+        if (write(w->fd, buf, n) != (ssize_t)n) {
+            w->error = (errno != 0) ? errno : EIO;
+            pal_ring_abort(&w->ring, w->error);
+            break;
+        }
+        pal_ring_consume(&w->ring, buf);
+    }
+    return NULL;
+}
+
+static void bench_stor(void)
+{
+    size_t depth = (FTP_STOR_RING_DEPTH >= 2U) ? FTP_STOR_RING_DEPTH : 2U;
+    uint64_t total = (uint64_t)FILE_SIZE * 2U * g_scale;
+    writer_t w;
+    int tx = -1;
+    int rx = -1;
+
+    w.fd = temp_file(0U);
+    w.error = 0;
+    if ((w.fd < 0) || (tcp_pair(&tx, &rx) != 0)) {
+        if (w.fd >= 0) {
+            close(w.fd);
+        }
+        bench_skip("stor_pipeline", "loopback setup failed");
+        return;
+    }
+
+    pal_ring_config_t cfg;
+    cfg.initial_depth = (unsigned)depth;
+    cfg.max_depth = (FTP_STOR_RING_MAX_DEPTH >= depth) ? FTP_STOR_RING_MAX_DEPTH
+                                                        : (unsigned)depth;
+    cfg.grow_after = FTP_STOR_RING_GROW_AFTER;
+    cfg.slot_size = ftp_buffer_size();
+    cfg.alloc = ring_alloc;
+    cfg.release = ring_release;
+    cfg.ctx = NULL;
+
+    peer_t feed = {tx, total};
+    pthread_t feeder;
+    pthread_t writer;
+    bench_t b;
+    if (pal_ring_init(&w.ring, &cfg) != 0) {
+        bench_skip("stor_pipeline", "ring init failed");
+        close(tx);
+        close(rx);
+        close(w.fd);
+        return;
+    }
+    if (bench_begin(&b, "stor_pipeline",
+                    (size_t)(total / 4096U) + 1U) != 0) {
+        pal_ring_destroy(&w.ring);
+        close(tx);
+        close(rx);
+        close(w.fd);
+        return;
+    }
+    if (pthread_create(&writer, NULL, writer_thread, &w) != 0) {
+        pal_ring_destroy(&w.ring);
+        close(tx);
+        close(rx);
+        close(w.fd);
+        return;
+    }
+    if (pthread_create(&feeder, NULL, feed_thread, &feed) != 0) {
+        shutdown(tx, SHUT_WR);
+        feeder = pthread_self();
+    }
+
+    uint64_t received = 0U;
+    uint64_t buffers = 0U;
+    for (;;) {
+        uint64_t t = bench_now_ns();
+        void *buf = pal_ring_acquire(&w.ring);
+        if (buf == NULL) {
+            break;
+        }
+        ssize_t n = recv(rx, buf, cfg.slot_size, 0);
+        if (n <= 0) {
+            pal_ring_unacquire(&w.ring, buf);
+            if ((n < 0) && (errno == EINTR)) {
+                continue;
+            }
+            break;
+        }
+        received += (uint64_t)n;
+        buffers++;
+        pal_ring_commit(&w.ring, buf, (size_t)n);
+        bench_sample(&b, bench_now_ns() - t);
+    }
+    pal_ring_close(&w.ring);
+    (void)pthread_join(writer, NULL);
+    bench_end(&b, buffers, received);
+
+    if (!pthread_equal(feeder, pthread_self())) {
+        (void)pthread_join(feeder, NULL);
+    }
+    pal_ring_destroy(&w.ring);
+    close(tx);
+    close(rx);
+    close(w.fd);
+}
+
+int main(void)
+{
+    g_scale = bench_scale();
+    bench_sendfile();
+    bench_stor();
+    return 0;
+}
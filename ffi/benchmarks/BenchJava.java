@@ -1,43 +1,243 @@
 package org.zftpd.ffi;
 
+import java.io.File;
+import java.io.RandomAccessFile;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.util.Arrays;
+
+/**
+ * FFI benchmark, Java binding: the cases of SPEC.md, JSON lines on stdout.
+ * Every case runs once untimed first to warm up the JIT.
+ *
+ * ffi_read goes through OpQueue with a file descriptor; the JDK hides
+ * descriptors, so the benchmark asks the kernel for one via
+ * /proc/self/fd and skips where that is unavailable.
+ */
 public class BenchJava {
 
-    public static void benchmarkAllocator(int iterations) {
-        PalAlloc.initDefault();
+    static final int ROUND = 1000;
+    static final int BATCH = 64;
+    static final int READ_CHUNK = 64 * 1024;
+    static final int READ_BATCH = 16;
+
+    static long sink = 0;
+
+    static int scale() {
+        try {
+            int v = Integer.parseInt(System.getenv().getOrDefault("BENCH_SCALE", "1"));
+            return (v >= 1 && v <= 1000) ? v : 1;
+        } catch (NumberFormatException e) {
+            return 1;
+        }
+    }
+
+    static long percentile(long[] v, int n, int pct) {
+        if (n == 0) {
+            return 0;
+        }
+        int rank = (n * pct + 99) / 100;
+        return v[Math.max(rank, 1) - 1];
+    }
+
+    static void report(String name, long ops, long bytes, long start, long[] samples, int n, boolean print) {
+        if (!print) {
+            return;
+        }
+        double secs = Math.max((System.nanoTime() - start) / 1e9, 1e-9);
+        Arrays.sort(samples, 0, n);
+        System.out.printf("{\"bench\":\"%s\",\"ops\":%d,\"bytes\":%d,\"secs\":%.6f,\"ops_s\":%.1f,"
+                + "\"mb_s\":%.1f,\"p50_ns\":%d,\"p99_ns\":%d}%n",
+                name, ops, bytes, secs, ops / secs, bytes / (1024.0 * 1024.0) / secs,
+                percentile(samples, n, 50), percentile(samples, n, 99));
+    }
+
+    static void skip(String name, String why) {
+        System.out.printf("{\"bench\":\"%s\",\"skipped\":\"%s\"}%n", name, why);
+    }
+
+    static void benchCall(FtpServer server, int scale, boolean print) {
+        int ops = 200000 * scale;
+        long[] samples = new long[ops / ROUND];
+        long sum = 0;
         long start = System.nanoTime();
-        
-        for (int i = 0; i < iterations; i++) {
-            long ptr = PalAlloc.malloc(64);
-            PalAlloc.free(ptr);
+        for (int r = 0; r < ops / ROUND; r++) {
+            long t = System.nanoTime();
+            for (int j = 0; j < ROUND; j++) {
+                sum += server.getActiveSessions();
+            }
+            samples[r] = (System.nanoTime() - t) / ROUND;
+        }
+        sink += sum;
+        report("ffi_call", ops, 0, start, samples, samples.length, print);
+    }
+
+    static void benchBatchNop(int scale, boolean print) {
+        long total = 200000L * scale;
+        try (OpQueue q = new OpQueue(BATCH)) {
+            ByteBuffer ops = OpQueue.allocateOps(BATCH);
+            for (int i = 0; i < BATCH; i++) {
+                OpQueue.putOp(ops, i, OpQueue.OP_NOP, -1, 0, 0, 0, 0, 0, i);
+            }
+            long[] samples = new long[(int) (total / BATCH) + 1];
+            int n = 0;
+            long done = 0;
+            long start = System.nanoTime();
+            while (done < total) {
+                long t = System.nanoTime();
+                int ran = q.submit(ops, BATCH);
+                ByteBuffer c = q.peek();
+                q.advance((c == null) ? 0 : c.capacity() / OpQueue.CQE_SIZE);
+                samples[n++] = (System.nanoTime() - t) / BATCH;
+                if (ran <= 0) {
+                    break;
+                }
+                done += ran;
+            }
+            report("ffi_batch_nop", done, 0, start, samples, n, print);
         }
-        
-        long end = System.nanoTime();
-        double ms = (end - start) / 1_000_000.0;
-        System.out.printf("[Java] Allocator (%d iters): %.2f ms\n", iterations, ms);
     }
 
-    public static void benchmarkFtpStartup(int iterations) {
+    static void benchStats(FtpServer server, int scale, boolean print) {
+        int ops = 100000 * scale;
+        ByteBuffer st = ByteBuffer.allocateDirect(FtpServer.STATS_SIZE).order(ByteOrder.nativeOrder());
+        long[] samples = new long[ops / ROUND];
+        long sum = 0;
         long start = System.nanoTime();
-        
-        for (int i = 0; i < iterations; i++) {
-            int port = 20000 + (i % 10000);
-            try (FtpServer server = new FtpServer("127.0.0.1", port, "/tmp")) {
-                if (server.start() == 0) {
-                    server.stop();
+        for (int r = 0; r < ops / ROUND; r++) {
+            long t = System.nanoTime();
+            for (int j = 0; j < ROUND; j++) {
+                server.getStats(st);
+                sum += st.getLong(0);
+            }
+            samples[r] = (System.nanoTime() - t) / ROUND;
+        }
+        sink += sum;
+        report("ffi_stats", ops, 0, start, samples, samples.length, print);
+    }
+
+    static void benchListing(String root, int scale, boolean print) {
+        String path = root + "/list";
+        new DirListing(path).close();
+        int reps = 50 * scale;
+        long[] samples = new long[reps];
+        long ops = 0;
+        long sum = 0;
+        long start = System.nanoTime();
+        for (int r = 0; r < reps; r++) {
+            long t = System.nanoTime();
+            int count;
+            try (DirListing d = new DirListing(path)) {
+                count = d.count();
+                for (int i = 0; i < count; i++) {
+                    sum += d.size(i) + d.name(i).length();
+                }
+            }
+            samples[r] = (System.nanoTime() - t) / Math.max(count, 1);
+            ops += count;
+        }
+        sink += sum;
+        report("ffi_listing", ops, 0, start, samples, reps, print);
+    }
+
+    static void benchRead(int fd, long size, int scale, boolean print) {
+        long perPass = size / (READ_CHUNK * READ_BATCH);
+        try (OpQueue q = new OpQueue(READ_BATCH)) {
+            ByteBuffer buf = ByteBuffer.allocateDirect(READ_CHUNK * READ_BATCH);
+            long addr = OpQueue.address(buf);
+            ByteBuffer ops = OpQueue.allocateOps(READ_BATCH);
+            long[] samples = new long[(int) (perPass * 2 * scale)];
+            int n = 0;
+            long count = 0;
+            long bytes = 0;
+            long start = System.nanoTime();
+            for (int pass = 0; pass < 2 * scale; pass++) {
+                for (long k = 0; k < perPass; k++) {
+                    long t = System.nanoTime();
+                    long base = k * READ_CHUNK * READ_BATCH;
+                    for (int i = 0; i < READ_BATCH; i++) {
+                        OpQueue.putOp(ops, i, OpQueue.OP_READ, fd, 0, addr + (long) i * READ_CHUNK,
+                                      READ_CHUNK, base + (long) i * READ_CHUNK, 0, i);
+                    }
+                    q.submit(ops, READ_BATCH);
+                    ByteBuffer c = q.peek();
+                    int got = (c == null) ? 0 : c.capacity() / OpQueue.CQE_SIZE;
+                    for (int i = 0; i < got; i++) {
+                        long res = c.getLong(i * OpQueue.CQE_SIZE + OpQueue.CQE_RESULT);
+                        if (res > 0) {
+                            bytes += res;
+                        }
+                    }
+                    q.advance(got);
+                    count += got;
+                    samples[n++] = (System.nanoTime() - t) / READ_BATCH;
+                }
+            }
+            report("ffi_read", count, bytes, start, samples, n, print);
+        }
+    }
+
+    /** Descriptor of a file this process has open, found through /proc */
+    static int findFd(String path) {
+        File[] fds = new File("/proc/self/fd").listFiles();
+        if (fds == null) {
+            return -1;
+        }
+        for (File f : fds) {
+            try {
+                if (f.getCanonicalPath().equals(new File(path).getCanonicalPath())) {
+                    return Integer.parseInt(f.getName());
                 }
             } catch (Exception e) {
-                // Ignore, as ports may be closing
+                // Descriptor closed meanwhile, or not a number
             }
         }
-        
-        long end = System.nanoTime();
-        double ms = (end - start) / 1_000_000.0;
-        System.out.printf("[Java] FtpServer start/stop (%d iters): %.2f ms\n", iterations, ms);
+        return -1;
     }
 
-    public static void main(String[] args) {
-        System.out.println("--- Java FFI Benchmarks ---");
-        benchmarkAllocator(100_000);
-        benchmarkFtpStartup(1000);
+    public static void main(String[] args) throws Exception {
+        PalAlloc.initDefault();
+        int scale = scale();
+        String root = System.getenv("ZFTPD_BENCH_DIR");
+        if (root != null && root.isEmpty()) {
+            root = null;
+        }
+
+        for (int pass = 0; pass < 2; pass++) {
+            boolean print = (pass == 1);
+            try (FtpServer server = new FtpServer("127.0.0.1", 2199, "/tmp")) {
+                benchCall(server, scale, print);
+                benchBatchNop(scale, print);
+                benchStats(server, scale, print);
+            } catch (RuntimeException e) {
+                if (print) {
+                    skip("ffi_call", "server create failed");
+                    benchBatchNop(scale, true);
+                    skip("ffi_stats", "server create failed");
+                }
+            }
+            if (root == null) {
+                if (print) {
+                    skip("ffi_listing", "ZFTPD_BENCH_DIR not set");
+                    skip("ffi_read", "ZFTPD_BENCH_DIR not set");
+                }
+                continue;
+            }
+            benchListing(root, scale, print);
+            String data = root + "/data.bin";
+            try (RandomAccessFile f = new RandomAccessFile(data, "r")) {
+                int fd = findFd(data);
+                if (fd < 0) {
+                    if (print) {
+                        skip("ffi_read", "no file descriptor");
+                    }
+                } else {
+                    benchRead(fd, f.length(), scale, print);
+                }
+            }
+        }
+        if (sink == 42) {
+            System.out.println();
+        }
     }
 }
@@ -0,0 +1,214 @@
+/*
+ * FFI benchmark, C reference: the cases of ffi/benchmarks/SPEC.md
+ * through libzftpd_ffi exactly as a binding sees it, so the other
+ * languages have a floor to compare against.
+ */
+#include "../../bench/bench.h"
+#include "../c_core/pal_ffi.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define ROUND 1000U
+#define BATCH 64U
+#define READ_CHUNK (64U * 1024U)
+#define READ_BATCH 16U
+
+static unsigned g_scale = 1U;
+static const char *g_dir = NULL;
+static volatile uint64_t g_sink = 0U;
+
+static void bench_call(void *server)
+{
+    bench_t b;
+    uint64_t ops = 200000ULL * g_scale;
+    if (bench_begin(&b, "ffi_call", (size_t)(ops / ROUND)) != 0) {
+        return;
+    }
+    uint64_t sum = 0U;
+    for (uint64_t i = 0U; i < ops; i += ROUND) {
+        uint64_t t = bench_now_ns();
+        for (unsigned j = 0U; j < ROUND; j++) {
+            sum += pal_ffi_ftp_server_get_active_sessions(server);
+        }
+        bench_sample(&b, (bench_now_ns() - t) / ROUND);
+    }
+    g_sink = sum;
+    bench_end(&b, ops, 0U);
+}
+
+static void bench_batch_nop(void)
+{
+    bench_t b;
+    void *q = pal_ffi_queue_create(BATCH);
+    pal_ffi_op_t ops[BATCH];
+    memset(ops, 0, sizeof(ops));
+    for (unsigned i = 0U; i < BATCH; i++) {
+        ops[i].opcode = PAL_FFI_OP_NOP;
+        ops[i].user_data = i;
+    }
+    uint64_t total = 200000ULL * g_scale;
+    if ((q == NULL) || (bench_begin(&b, "ffi_batch_nop", (size_t)(total / BATCH) + 1U) != 0)) {
+        pal_ffi_queue_destroy(q);
+        return;
+    }
+    uint64_t done = 0U;
+    while (done < total) {
+        uint64_t t = bench_now_ns();
+        int n = pal_ffi_queue_submit(q, ops, BATCH);
+        uint32_t got = 0U;
+        (void)pal_ffi_queue_peek(q, &got);
+        pal_ffi_queue_advance(q, got);
+        bench_sample(&b, (bench_now_ns() - t) / BATCH);
+        done += (n > 0) ? (uint64_t)n : 0U;
+        if (n <= 0) {
+            break;
+        }
+    }
+    bench_end(&b, done, 0U);
+    pal_ffi_queue_destroy(q);
+}
+
+static void bench_stats(void *server)
+{
+    bench_t b;
+    uint64_t ops = 100000ULL * g_scale;
+    if (bench_begin(&b, "ffi_stats", (size_t)(ops / ROUND)) != 0) {
+        return;
+    }
+    pal_ffi_ftp_stats_t st;
+    uint64_t sum = 0U;
+    for (uint64_t i = 0U; i < ops; i += ROUND) {
+        uint64_t t = bench_now_ns();
+        for (unsigned j = 0U; j < ROUND; j++) {
+            (void)pal_ffi_ftp_server_get_stats(server, &st);
+            sum += st.total_connections;
+        }
+        bench_sample(&b, (bench_now_ns() - t) / ROUND);
+    }
+    g_sink = sum;
+    bench_end(&b, ops, 0U);
+}
+
+static void bench_listing(void)
+{
+    if (g_dir == NULL) {
+        bench_skip("ffi_listing", "ZFTPD_BENCH_DIR not set");
+        return;
+    }
+    char path[1024];
+    (void)snprintf(path, sizeof(path), "%s/list", g_dir);
+    pal_ffi_dir_close(pal_ffi_dir_open(path));
+
+    bench_t b;
+    unsigned reps = 50U * g_scale;
+    if (bench_begin(&b, "ffi_listing", reps) != 0) {
+        return;
+    }
+    uint64_t ops = 0U;
+    uint64_t sum = 0U;
+    for (unsigned r = 0U; r < reps; r++) {
+        uint64_t t = bench_now_ns();
+        void *dir = pal_ffi_dir_open(path);
+        uint32_t count = 0U;
+        const pal_ffi_dirent_t *e = pal_ffi_dir_entries(dir, &count, NULL);
+        for (uint32_t i = 0U; i < count; i++) {
+            const char *name = (const char *)e + e[i].name_off;
+            sum += e[i].size + (uint64_t)(unsigned char)name[0];
+        }
+        pal_ffi_dir_close(dir);
+        bench_sample(&b, (bench_now_ns() - t) / ((count != 0U) ? count : 1U));
+        ops += count;
+    }
+    g_sink = sum;
+    bench_end(&b, ops, 0U);
+}
+
+static void bench_read(void)
+{
+    if (g_dir == NULL) {
+        bench_skip("ffi_read", "ZFTPD_BENCH_DIR not set");
+        return;
+    }
+    char path[1024];
+    (void)snprintf(path, sizeof(path), "%s/data.bin", g_dir);
+    int fd = open(path, O_RDONLY);
+    off_t size = (fd >= 0) ? lseek(fd, 0, SEEK_END) : -1;
+    uint8_t *buf = malloc(READ_CHUNK * READ_BATCH);
+    void *q = pal_ffi_queue_create(READ_BATCH);
+    bench_t b;
+    uint64_t per_pass = (size > 0) ? (uint64_t)size / (READ_CHUNK * READ_BATCH) : 0U;
+    if ((fd < 0) || (per_pass == 0U) || (buf == NULL) || (q == NULL) ||
+        (bench_begin(&b, "ffi_read", (size_t)(per_pass * 2U * g_scale)) != 0)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(buf);
+        pal_ffi_queue_destroy(q);
+        bench_skip("ffi_read", "fixture unavailable");
+        return;
+    }
+
+    pal_ffi_op_t ops[READ_BATCH];
+    memset(ops, 0, sizeof(ops));
+    for (unsigned i = 0U; i < READ_BATCH; i++) {
+        ops[i].opcode = PAL_FFI_OP_READ;
+        ops[i].fd = fd;
+        ops[i].addr = (uint64_t)(uintptr_t)(buf + ((size_t)i * READ_CHUNK));
+        ops[i].len = READ_CHUNK;
+    }
+    uint64_t ops_done = 0U;
+    uint64_t bytes = 0U;
+    for (unsigned pass = 0U; pass < 2U * g_scale; pass++) {
+        for (uint64_t k = 0U; k < per_pass; k++) {
+            uint64_t t = bench_now_ns();
+            uint64_t base = k * READ_CHUNK * READ_BATCH;
+            for (unsigned i = 0U; i < READ_BATCH; i++) {
+                ops[i].offset = base + ((uint64_t)i * READ_CHUNK);
+            }
+            (void)pal_ffi_queue_submit(q, ops, READ_BATCH);
+            uint32_t got = 0U;
+            const pal_ffi_cqe_t *c = pal_ffi_queue_peek(q, &got);
+            for (uint32_t i = 0U; i < got; i++) {
+                if (c[i].result > 0) {
+                    bytes += (uint64_t)c[i].result;
+                }
+            }
+            pal_ffi_queue_advance(q, got);
+            ops_done += got;
+            bench_sample(&b, (bench_now_ns() - t) / READ_BATCH);
+        }
+    }
+    bench_end(&b, ops_done, bytes);
+    pal_ffi_queue_destroy(q);
+    free(buf);
+    close(fd);
+}
+
+int main(void)
+{
+    g_scale = bench_scale();
+    g_dir = getenv("ZFTPD_BENCH_DIR");
+    if ((g_dir != NULL) && (g_dir[0] == '\0')) {
+        g_dir = NULL;
+    }
+    (void)pal_ffi_alloc_init_default();
+
+    void *server = pal_ffi_ftp_server_create("127.0.0.1", 2199U, "/tmp");
+    if (server == NULL) {
+        bench_skip("ffi_call", "server create failed");
+        bench_skip("ffi_stats", "server create failed");
+    } else {
+        bench_call(server);
+    }
+    bench_batch_nop();
+    if (server != NULL) {
+        bench_stats(server);
+        pal_ffi_ftp_server_destroy(server);
+    }
+    bench_listing();
+    bench_read();
+    return 0;
+}
@@ -1,32 +1,153 @@
+"""FFI benchmark, Python binding: the cases of SPEC.md, JSON lines on stdout."""
+import json
+import os
 import time
-from zftpd.core import PalAlloc, FtpServer
 
-def benchmark_allocator(iterations=100_000):
-    PalAlloc.init_default()
-    start = time.perf_counter()
-    
-    for _ in range(iterations):
-        ptr = PalAlloc.malloc(64)
-        PalAlloc.free(ptr)
-        
-    end = time.perf_counter()
-    print(f"[Python] Allocator ({iterations} iters): {(end - start) * 1000:.2f} ms")
-
-
-def benchmark_ftp_startup(iterations=1000):
-    start = time.perf_counter()
-    
-    for i in range(iterations):
-        server = FtpServer("127.0.0.1", 20000 + (i % 10000), "/tmp")
-        server.start()
-        server.stop()
-        server.close()
-        
-    end = time.perf_counter()
-    print(f"[Python] FtpServer start/stop ({iterations} iters): {(end - start) * 1000:.2f} ms")
+from zftpd.core import FtpServer, DirListing, PalAlloc, Queue
+
+ROUND = 1000
+BATCH = 64
+READ_CHUNK = 64 * 1024
+READ_BATCH = 16
+
+
+def scale():
+    try:
+        v = int(os.environ.get("BENCH_SCALE", "1"))
+    except ValueError:
+        return 1
+    return v if 1 <= v <= 1000 else 1
+
+
+def percentile(v, pct):
+    if not v:
+        return 0
+    rank = (len(v) * pct + 99) // 100
+    return v[max(rank, 1) - 1]
+
+
+def report(name, ops, nbytes, secs, samples):
+    samples.sort()
+    secs = max(secs, 1e-9)
+    print(json.dumps({
+        "bench": name, "ops": ops, "bytes": nbytes, "secs": round(secs, 6),
+        "ops_s": round(ops / secs, 1),
+        "mb_s": round(nbytes / (1024.0 * 1024.0) / secs, 1),
+        "p50_ns": percentile(samples, 50), "p99_ns": percentile(samples, 99),
+    }, separators=(",", ":")), flush=True)
+
+
+def skip(name, why):
+    print(json.dumps({"bench": name, "skipped": why}, separators=(",", ":")), flush=True)
+
+
+def bench_call(server, n):
+    ops = 200000 * n
+    samples = []
+    total = 0
+    t0 = time.perf_counter_ns()
+    for _ in range(ops // ROUND):
+        t = time.perf_counter_ns()
+        for _ in range(ROUND):
+            total += server.active_sessions()
+        samples.append((time.perf_counter_ns() - t) // ROUND)
+    report("ffi_call", ops, 0, (time.perf_counter_ns() - t0) / 1e9, samples)
+
+
+def bench_batch_nop(n):
+    total = 200000 * n
+    samples = []
+    done = 0
+    with Queue(BATCH) as q:
+        t0 = time.perf_counter_ns()
+        while done < total:
+            t = time.perf_counter_ns()
+            for i in range(BATCH):
+                q.nop(i)
+            got = q.submit()
+            q.advance(len(q.completions()))
+            samples.append((time.perf_counter_ns() - t) // BATCH)
+            done += got
+        report("ffi_batch_nop", done, 0, (time.perf_counter_ns() - t0) / 1e9, samples)
+
+
+def bench_stats(server, n):
+    ops = 100000 * n
+    samples = []
+    total = 0
+    t0 = time.perf_counter_ns()
+    for _ in range(ops // ROUND):
+        t = time.perf_counter_ns()
+        for _ in range(ROUND):
+            total += server.stats().total_connections
+        samples.append((time.perf_counter_ns() - t) // ROUND)
+    report("ffi_stats", ops, 0, (time.perf_counter_ns() - t0) / 1e9, samples)
+
+
+def bench_listing(root, n):
+    if root is None:
+        skip("ffi_listing", "ZFTPD_BENCH_DIR not set")
+        return
+    path = os.path.join(root, "list")
+    DirListing(path).close()
+    samples = []
+    ops = 0
+    total = 0
+    t0 = time.perf_counter_ns()
+    for _ in range(50 * n):
+        t = time.perf_counter_ns()
+        with DirListing(path) as d:
+            count = len(d)
+            for i in range(count):
+                total += d.entry(i).size + len(d.name(i))
+        samples.append((time.perf_counter_ns() - t) // max(count, 1))
+        ops += count
+    report("ffi_listing", ops, 0, (time.perf_counter_ns() - t0) / 1e9, samples)
+
+
+def bench_read(root, n):
+    if root is None:
+        skip("ffi_read", "ZFTPD_BENCH_DIR not set")
+        return
+    path = os.path.join(root, "data.bin")
+    fd = os.open(path, os.O_RDONLY)
+    try:
+        per_pass = os.fstat(fd).st_size // (READ_CHUNK * READ_BATCH)
+        buf = bytearray(READ_CHUNK * READ_BATCH)
+        view = memoryview(buf)
+        chunks = [view[i * READ_CHUNK:(i + 1) * READ_CHUNK] for i in range(READ_BATCH)]
+        samples = []
+        ops = 0
+        nbytes = 0
+        with Queue(READ_BATCH) as q:
+            t0 = time.perf_counter_ns()
+            for _ in range(2 * n):
+                for k in range(per_pass):
+                    t = time.perf_counter_ns()
+                    base = k * READ_CHUNK * READ_BATCH
+                    for i in range(READ_BATCH):
+                        q.read(fd, chunks[i], base + i * READ_CHUNK, i)
+                    q.submit()
+                    done = q.completions()
+                    for c in done:
+                        if c.result > 0:
+                            nbytes += c.result
+                    q.advance(len(done))
+                    ops += len(done)
+                    samples.append((time.perf_counter_ns() - t) // READ_BATCH)
+            report("ffi_read", ops, nbytes, (time.perf_counter_ns() - t0) / 1e9, samples)
+    finally:
+        os.close(fd)
 
 
 if __name__ == "__main__":
-    print("--- Python FFI Benchmarks ---")
-    benchmark_allocator()
-    benchmark_ftp_startup()
+    n = scale()
+    root = os.environ.get("ZFTPD_BENCH_DIR") or None
+    PalAlloc.init_default()
+    server = FtpServer("127.0.0.1", 2199, "/tmp")
+    bench_call(server, n)
+    bench_batch_nop(n)
+    bench_stats(server, n)
+    server.close()
+    bench_listing(root, n)
+    bench_read(root, n)
@@ -0,0 +1,199 @@
+#!/usr/bin/env python3
+"""Run the FFI benchmark (SPEC.md) for every binding and merge the results.
+
+Each language prints bench.h-style JSON lines; this runner tags them with
+"lang", writes them all to --out (JSON lines) and prints a side-by-side
+table.  A language whose toolchain is missing is recorded as skipped.
+"""
+import argparse
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FFI = os.path.dirname(HERE)
+CASES = ["ffi_call", "ffi_batch_nop", "ffi_stats", "ffi_listing", "ffi_read"]
+LIST_FILES = 1000
+DATA_BYTES = 64 * 1024 * 1024
+
+
+def make_fixture(root):
+    os.makedirs(os.path.join(root, "list"), exist_ok=True)
+    for i in range(LIST_FILES):
+        open(os.path.join(root, "list", "f%04d" % i), "wb").close()
+    block = os.urandom(1024 * 1024)
+    with open(os.path.join(root, "data.bin"), "wb") as f:
+        for _ in range(DATA_BYTES // len(block)):
+            f.write(block)
+
+
+def sanitizer_preload(lib_dir):
+    """A sanitized (debug) library needs its runtime loaded first in hosts
+    that were not linked against it."""
+    lib = os.path.join(lib_dir, "libzftpd_ffi.so")
+    try:
+        out = subprocess.run(["ldd", lib], capture_output=True, text=True).stdout
+    except OSError:
+        return None
+    if "libasan" not in out:
+        return None
+    asan = subprocess.run(["gcc", "-print-file-name=libasan.so"],
+                          capture_output=True, text=True).stdout.strip()
+    return asan or None
+
+
+def commands(lang, args, lib_dir):
+    """(argv, cwd, extra env, build argv or None) for one language."""
+    env = {}
+    if lang == "c":
+        return [os.path.abspath(args.c_bench)], None, env, None
+    if lang == "rust":
+        env["RUSTFLAGS"] = "-L native=" + lib_dir
+        crate = os.path.join(FFI, "rust")
+        return ([os.path.join(crate, "target", "release", "bench")], crate, env,
+                ["cargo", "build", "--release", "--quiet", "--bin", "bench"])
+    if lang == "java":
+        # Bindings and JNI library come from `make ffi-java`
+        out = os.path.join(lib_dir, "ffi", "java")
+        build = ["javac", "-cp", out, "-d", out, os.path.join(HERE, "BenchJava.java")]
+        return (["java", "-Djava.library.path=" + lib_dir, "-cp", out,
+                 "org.zftpd.ffi.BenchJava"], None, env, build)
+    if lang == "python":
+        env["PYTHONPATH"] = os.path.join(FFI, "python")
+        env["ZFTPD_FFI_LIB"] = os.path.join(lib_dir, "libzftpd_ffi.so")
+        return [sys.executable, os.path.join(HERE, "bench_python.py")], None, env, None
+    if lang == "go":
+        env["CGO_LDFLAGS"] = "-L" + lib_dir
+        env["GO111MODULE"] = "off"
+        env["ZFTPD_FFI_BENCH"] = "1"
+        exe = os.path.join(args.work, "ffibench.test")
+        return ([exe, "-test.count=1", "-test.run", "^TestFfiBench$"],
+                os.path.join(FFI, "go", "zftpd"), env, ["go", "test", "-c", "-o", exe])
+    raise ValueError(lang)
+
+
+TOOLS = {"c": None, "rust": "cargo", "java": "java", "python": None, "go": "go"}
+
+
+def run_lang(lang, args, lib_dir, base_env):
+    tool = TOOLS[lang]
+    if tool is not None and shutil.which(tool) is None:
+        return [{"bench": c, "skipped": tool + " not found"} for c in CASES]
+    if lang == "java":
+        if shutil.which("javac") is None:
+            return [{"bench": c, "skipped": "javac not found"} for c in CASES]
+        jni = [f for f in os.listdir(lib_dir) if f.startswith("libzftpd_ffi_java")]
+        if not jni:
+            return [{"bench": c, "skipped": "run make ffi-java first"} for c in CASES]
+    if lang == "python":
+        try:
+            import cffi  # noqa: F401
+        except ImportError:
+            return [{"bench": c, "skipped": "cffi not installed"} for c in CASES]
+    if lang == "c" and not (args.c_bench and os.path.exists(args.c_bench)):
+        return [{"bench": c, "skipped": "bench_ffi not built"} for c in CASES]
+
+    argv, cwd, extra, build = commands(lang, args, lib_dir)
+    env = dict(base_env)
+    env.update(extra)
+    if build is not None:
+        # Toolchains run without the sanitizer preload
+        benv = dict(env)
+        benv.pop("LD_PRELOAD", None)
+        b = subprocess.run(build, cwd=cwd, env=benv, capture_output=True, text=True)
+        if b.returncode != 0:
+            sys.stderr.write(b.stderr[-2000:])
+            return [{"bench": c, "skipped": "build failed"} for c in CASES]
+    p = subprocess.run(argv, cwd=cwd, env=env, capture_output=True, text=True)
+    rows = []
+    for line in p.stdout.splitlines():
+        line = line.strip()
+        if not line.startswith("{"):
+            continue
+        try:
+            row = json.loads(line)
+        except ValueError:
+            continue
+        if row.get("bench") in CASES:
+            rows.append(row)
+    seen = {r["bench"] for r in rows}
+    why = "exit %d" % p.returncode if p.returncode != 0 else "no output"
+    rows += [{"bench": c, "skipped": why} for c in CASES if c not in seen]
+    if p.returncode != 0:
+        sys.stderr.write(p.stderr[-2000:])
+    return rows
+
+
+def table(results, langs):
+    def cell(row):
+        if row is None or "skipped" in row:
+            return "-"
+        if row.get("bytes"):
+            return "%.0f MiB/s" % row["mb_s"]
+        return "%d ns" % row["p50_ns"]
+
+    by = {(r["lang"], r["bench"]): r for r in results}
+    width = max(len(c) for c in CASES) + 2
+    print("p50 per op (MiB/s for ffi_read)".ljust(width) + "".join(l.rjust(14) for l in langs))
+    for c in CASES:
+        print(c.ljust(width) + "".join(cell(by.get((l, c))).rjust(14) for l in langs))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__)
+    ap.add_argument("--lib-dir", required=True, help="directory holding libzftpd_ffi")
+    ap.add_argument("--c-bench", help="bench_ffi binary (C reference)")
+    ap.add_argument("--langs", default="c,rust,java,python,go")
+    ap.add_argument("--out", help="merged JSON lines")
+    ap.add_argument("--fixture", help="reuse this fixture directory")
+    args = ap.parse_args()
+
+    lib_dir = os.path.abspath(args.lib_dir)
+    langs = [l for l in args.langs.split(",") if l]
+    for l in langs:
+        if l not in TOOLS:
+            ap.error("unknown language " + l)
+
+    tmp = tempfile.mkdtemp(prefix="zftpd-ffi-bench-")
+    args.work = tmp
+    fixture = args.fixture
+    if fixture is None:
+        fixture = os.path.join(tmp, "fixture")
+    if not os.path.exists(os.path.join(fixture, "data.bin")):
+        make_fixture(fixture)
+
+    env = dict(os.environ)
+    env["ZFTPD_BENCH_DIR"] = os.path.abspath(fixture)
+    env["LD_LIBRARY_PATH"] = lib_dir + os.pathsep + env.get("LD_LIBRARY_PATH", "")
+    env["DYLD_LIBRARY_PATH"] = lib_dir + os.pathsep + env.get("DYLD_LIBRARY_PATH", "")
+    preload = sanitizer_preload(lib_dir)
+    if preload is not None:
+        sys.stderr.write("note: sanitized library, numbers are not representative\n")
+
+    results = []
+    try:
+        for lang in langs:
+            lenv = dict(env)
+            if preload is not None and lang != "c":
+                lenv["LD_PRELOAD"] = preload
+                lenv["ASAN_OPTIONS"] = "detect_leaks=0"
+            for row in run_lang(lang, args, lib_dir, lenv):
+                row["lang"] = lang
+                results.append(row)
+    finally:
+        shutil.rmtree(tmp, ignore_errors=True)
+
+    if args.out:
+        os.makedirs(os.path.dirname(os.path.abspath(args.out)), exist_ok=True)
+        with open(args.out, "w") as f:
+            for r in results:
+                f.write(json.dumps(r, separators=(",", ":")) + "\n")
+    table(results, langs)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -25,12 +25,26 @@ SOFTWARE.
 #include "pal_ffi.h"
 
 #include "../../include/event_loop.h"
+#include "../../include/ftp_list.h"
 #include "../../include/ftp_server.h"
 #include "../../include/http_server.h"
 #include "../../include/pal_alloc.h"
 
+#include <errno.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* The layouts are part of the ABI: bindings hard-code these sizes */
+_Static_assert(sizeof(pal_ffi_ftp_stats_t) == 72U, "pal_ffi_ftp_stats_t");
+_Static_assert(sizeof(pal_ffi_stat_t) == 24U, "pal_ffi_stat_t");
+_Static_assert(sizeof(pal_ffi_dirent_t) == 32U, "pal_ffi_dirent_t");
+_Static_assert(sizeof(pal_ffi_op_t) == 56U, "pal_ffi_op_t");
+_Static_assert(sizeof(pal_ffi_cqe_t) == 24U, "pal_ffi_cqe_t");
 
 /*===========================================================================*
  * MEMORY ALLOCATOR
@@ -89,8 +103,9 @@ void *pal_ffi_ftp_server_create(const char *bind_ip, uint16_t port,
   if (bind_ip == NULL || root_path == NULL)
     return NULL;
 
-  ftp_server_context_t *ctx =
-      (ftp_server_context_t *)pal_malloc(sizeof(ftp_server_context_t));
+  /* The context is cache-line aligned (64 bytes) */
+  ftp_server_context_t *ctx = (ftp_server_context_t *)pal_aligned_alloc(
+      _Alignof(ftp_server_context_t), sizeof(ftp_server_context_t));
   if (ctx == NULL)
     return NULL;
 
@@ -142,7 +157,9 @@ void pal_ffi_ftp_server_destroy(void *server) {
 void *pal_ffi_http_server_create(void *loop, uint16_t port) {
   if (loop == NULL)
     return NULL;
-  return (void *)http_server_create((event_loop_t *)loop, port);
+  char bind_addr[32];
+  (void)snprintf(bind_addr, sizeof(bind_addr), "0.0.0.0:%u", (unsigned)port);
+  return (void *)http_server_create((event_loop_t *)loop, bind_addr, "/");
 }
 
 void pal_ffi_http_server_destroy(void *server) {
@@ -159,3 +176,264 @@ void *pal_ffi_http_server_create(void *loop, uint16_t port) {
 
 void pal_ffi_http_server_destroy(void *server) { (void)server; }
 #endif
+
+/*===========================================================================*
+ * FLAT VIEWS
+ *===========================================================================*/
+
+int pal_ffi_ftp_server_get_stats(const void *server,
+                                 pal_ffi_ftp_stats_t *out) {
+  if (server == NULL || out == NULL)
+    return PAL_FFI_ERR_INVALID_PARAM;
+
+  const ftp_server_context_t *ctx = (const ftp_server_context_t *)server;
+  ftp_server_stats_t st;
+  ftp_server_get_stats_ex(ctx, &st);
+
+  memset(out, 0, sizeof(*out));
+  out->total_connections = st.total_connections;
+  out->bytes_sent = st.bytes_sent;
+  out->bytes_received = st.bytes_received;
+  out->accept_latency_avg_ns = st.accept_latency_avg_ns;
+  out->accept_latency_max_ns = st.accept_latency_max_ns;
+  out->total_errors = st.total_errors;
+  out->acceptors = st.acceptors;
+  out->listen_backlog = st.listen_backlog;
+  out->connections_per_sec = st.connections_per_sec;
+  out->start_queue_depth = st.start_queue_depth;
+  out->start_queue_peak = st.start_queue_peak;
+  out->active_sessions = ftp_server_get_active_sessions(ctx);
+  return PAL_FFI_OK;
+}
+
+typedef struct {
+  uint32_t count;
+  size_t bytes; /* From entries[0] to the end of the last name */
+  pal_ffi_dirent_t entries[];
+} ffi_dir_t;
+
+void *pal_ffi_dir_open(const char *path) {
+  if (path == NULL)
+    return NULL;
+
+  ftp_list_snapshot_t snap;
+  if (ftp_list_snapshot(path, &snap) != FTP_OK)
+    return NULL;
+  if (snap.count > UINT32_MAX / sizeof(pal_ffi_dirent_t)) {
+    ftp_list_snapshot_release(&snap);
+    return NULL;
+  }
+
+  /* Names are packed right after the entry array */
+  size_t names = 0U;
+  for (size_t i = 0U; i < snap.count; i++) {
+    names += strlen(ftp_list_snapshot_name(&snap, i)) + 1U;
+  }
+  size_t head = snap.count * sizeof(pal_ffi_dirent_t);
+  if (names > (size_t)UINT32_MAX - head) {
+    ftp_list_snapshot_release(&snap);
+    return NULL;
+  }
+
+  ffi_dir_t *dir = (ffi_dir_t *)pal_malloc(sizeof(ffi_dir_t) + head + names);
+  if (dir == NULL) {
+    ftp_list_snapshot_release(&snap);
+    return NULL;
+  }
+  dir->count = (uint32_t)snap.count;
+  dir->bytes = head + names;
+
+  char *base = (char *)dir->entries;
+  size_t off = head;
+  for (size_t i = 0U; i < snap.count; i++) {
+    const vfs_stat_t *st = ftp_list_snapshot_stat(&snap, i);
+    const char *name = ftp_list_snapshot_name(&snap, i);
+    size_t len = strlen(name);
+    pal_ffi_dirent_t *e = &dir->entries[i];
+    e->size = st->size;
+    e->mtime = st->mtime;
+    e->mode = st->mode;
+    e->name_off = (uint32_t)off;
+    e->name_len = (uint32_t)len;
+    e->reserved = 0U;
+    memcpy(base + off, name, len + 1U);
+    off += len + 1U;
+  }
+  ftp_list_snapshot_release(&snap);
+  return (void *)dir;
+}
+
+const pal_ffi_dirent_t *pal_ffi_dir_entries(const void *dir, uint32_t *count,
+                                            size_t *bytes) {
+  const ffi_dir_t *d = (const ffi_dir_t *)dir;
+  uint32_t n = (d != NULL) ? d->count : 0U;
+  if (count != NULL)
+    *count = n;
+  if (bytes != NULL)
+    *bytes = (n != 0U) ? d->bytes : 0U;
+  return (n != 0U) ? d->entries : NULL;
+}
+
+void pal_ffi_dir_close(void *dir) {
+  if (dir != NULL) {
+    pal_free(dir);
+  }
+}
+
+/*===========================================================================*
+ * BATCHED OPERATIONS
+ *===========================================================================*/
+
+#define FFI_QUEUE_MAX_DEPTH 65536U
+
+typedef struct {
+  uint32_t mask;
+  uint32_t head; /* Next completion to reap (free-running) */
+  uint32_t tail; /* Next completion to post (free-running) */
+  pal_ffi_cqe_t cqes[];
+} ffi_queue_t;
+
+void *pal_ffi_queue_create(uint32_t depth) {
+  if (depth == 0U || depth > FFI_QUEUE_MAX_DEPTH)
+    return NULL;
+  uint32_t size = 1U;
+  while (size < depth) {
+    size <<= 1U;
+  }
+
+  ffi_queue_t *q = (ffi_queue_t *)pal_malloc(
+      sizeof(ffi_queue_t) + ((size_t)size * sizeof(pal_ffi_cqe_t)));
+  if (q == NULL)
+    return NULL;
+  q->mask = size - 1U;
+  q->head = 0U;
+  q->tail = 0U;
+  return (void *)q;
+}
+
+static int64_t op_errno(int32_t *sys_errno) {
+  *sys_errno = (int32_t)errno;
+  return PAL_FFI_ERR_IO;
+}
+
+/* Run one operation; the result as it goes into the completion */
+static int64_t op_run(const pal_ffi_op_t *op, int32_t *sys_errno) {
+  void *buf = (void *)(uintptr_t)op->addr;
+  *sys_errno = 0;
+
+  switch (op->opcode) {
+  case PAL_FFI_OP_NOP:
+    return 0;
+
+  case PAL_FFI_OP_READ:
+  case PAL_FFI_OP_WRITE: {
+    if (buf == NULL || op->fd < 0 || op->len > (uint64_t)SSIZE_MAX ||
+        op->offset > (uint64_t)INT64_MAX)
+      return PAL_FFI_ERR_INVALID_PARAM;
+    ssize_t n;
+    do {
+      n = (op->opcode == PAL_FFI_OP_READ)
+              ? pread(op->fd, buf, (size_t)op->len, (off_t)op->offset)
+              : pwrite(op->fd, buf, (size_t)op->len, (off_t)op->offset);
+    } while (n < 0 && errno == EINTR);
+    return (n < 0) ? op_errno(sys_errno) : (int64_t)n;
+  }
+
+  case PAL_FFI_OP_FSYNC:
+    if (op->fd < 0)
+      return PAL_FFI_ERR_INVALID_PARAM;
+    return (fsync(op->fd) != 0) ? op_errno(sys_errno) : 0;
+
+  case PAL_FFI_OP_STAT: {
+    const char *path = (const char *)(uintptr_t)op->path;
+    if (buf == NULL || path == NULL || op->len < sizeof(pal_ffi_stat_t))
+      return PAL_FFI_ERR_INVALID_PARAM;
+    struct stat st;
+    if (stat(path, &st) != 0)
+      return op_errno(sys_errno);
+    pal_ffi_stat_t *out = (pal_ffi_stat_t *)buf;
+    out->size = (uint64_t)st.st_size;
+    out->mtime = (int64_t)st.st_mtime;
+    out->mode = (uint32_t)st.st_mode;
+    out->reserved = 0U;
+    return 0;
+  }
+
+  case PAL_FFI_OP_FTP_STATS:
+    if (op->len < sizeof(pal_ffi_ftp_stats_t))
+      return PAL_FFI_ERR_INVALID_PARAM;
+    return pal_ffi_ftp_server_get_stats((const void *)(uintptr_t)op->handle,
+                                        (pal_ffi_ftp_stats_t *)buf);
+
+  default:
+    return PAL_FFI_ERR_INVALID_PARAM;
+  }
+}
+
+int pal_ffi_queue_submit(void *queue, const pal_ffi_op_t *ops,
+                         uint32_t count) {
+  ffi_queue_t *q = (ffi_queue_t *)queue;
+  if (q == NULL || (ops == NULL && count != 0U) || count > (uint32_t)INT32_MAX)
+    return PAL_FFI_ERR_INVALID_PARAM;
+
+  uint32_t done = 0U;
+  while (done < count && (q->tail - q->head) <= q->mask) {
+    const pal_ffi_op_t *op = &ops[done];
+    pal_ffi_cqe_t *cqe = &q->cqes[q->tail & q->mask];
+    cqe->result = op_run(op, &cqe->sys_errno);
+    cqe->user_data = op->user_data;
+    cqe->opcode = op->opcode;
+    q->tail++;
+    done++;
+  }
+  return (int)done;
+}
+
+const pal_ffi_cqe_t *pal_ffi_queue_peek(const void *queue, uint32_t *count) {
+  const ffi_queue_t *q = (const ffi_queue_t *)queue;
+  uint32_t n = 0U;
+  const pal_ffi_cqe_t *first = NULL;
+  if (q != NULL && q->tail != q->head) {
+    uint32_t at = q->head & q->mask;
+    uint32_t to_end = q->mask + 1U - at;
+    n = q->tail - q->head;
+    if (n > to_end)
+      n = to_end;
+    first = &q->cqes[at];
+  }
+  if (count != NULL)
+    *count = n;
+  return first;
+}
+
+void pal_ffi_queue_advance(void *queue, uint32_t n) {
+  ffi_queue_t *q = (ffi_queue_t *)queue;
+  if (q == NULL)
+    return;
+  uint32_t pending = q->tail - q->head;
+  q->head += (n < pending) ? n : pending;
+}
+
+uint32_t pal_ffi_queue_reap(void *queue, pal_ffi_cqe_t *out, uint32_t max) {
+  if (queue == NULL || out == NULL)
+    return 0U;
+  uint32_t got = 0U;
+  while (got < max) {
+    uint32_t n = 0U;
+    const pal_ffi_cqe_t *run = pal_ffi_queue_peek(queue, &n);
+    if (run == NULL)
+      break;
+    if (n > max - got)
+      n = max - got;
+    memcpy(&out[got], run, (size_t)n * sizeof(*run));
+    pal_ffi_queue_advance(queue, n);
+    got += n;
+  }
+  return got;
+}
+
+void pal_ffi_queue_destroy(void *queue) {
+  if (queue != NULL) {
+    pal_free(queue);
+  }
+}
@@ -30,6 +30,12 @@ SOFTWARE.
  * high-level languages (Java, Rust, Python, Go, Zig).
  * It uses opaque contexts (`void*`) and integer error codes to remain strictly
  * decoupled from the internal data structures of zftpd.
+ *
+ * Hot paths do not go call-by-call: operations are submitted in arrays
+ * (pal_ffi_queue_submit) against caller-owned buffers, completions are
+ * read in place (pal_ffi_queue_peek), and stats and listings are flat
+ * fixed-layout structs the caller maps directly (repr(C) in Rust, a
+ * direct ByteBuffer in Java) instead of marshalling field by field.
  */
 
 #ifndef PAL_FFI_H
@@ -56,6 +62,7 @@ extern "C" {
 #define PAL_FFI_OK 0
 #define PAL_FFI_ERR_INVALID_PARAM -1
 #define PAL_FFI_ERR_OUT_OF_MEMORY -2
+#define PAL_FFI_ERR_IO -3 /* errno in pal_ffi_cqe_t.sys_errno */
 #define PAL_FFI_ERR_UNKNOWN -99
 
 /*===========================================================================*
@@ -207,6 +214,183 @@ PAL_FFI_EXPORT void *pal_ffi_http_server_create(void *loop, uint16_t port);
  */
 PAL_FFI_EXPORT void pal_ffi_http_server_destroy(void *server);
 
+/*===========================================================================*
+ * FLAT VIEWS
+ * Fixed layout on every platform (explicit widths, no implicit padding):
+ * bindings may read them straight out of memory.
+ *===========================================================================*/
+
+/** FTP server counters (pal_ffi_ftp_server_get_stats), 72 bytes */
+typedef struct {
+  uint64_t total_connections;
+  uint64_t bytes_sent;
+  uint64_t bytes_received;
+  uint64_t accept_latency_avg_ns;
+  uint64_t accept_latency_max_ns;
+  uint32_t total_errors;
+  uint32_t acceptors;
+  uint32_t listen_backlog;
+  uint32_t connections_per_sec;
+  uint32_t start_queue_depth;
+  uint32_t start_queue_peak;
+  uint32_t active_sessions;
+  uint32_t reserved;
+} pal_ffi_ftp_stats_t;
+
+/** File metadata (PAL_FFI_OP_STAT), 24 bytes */
+typedef struct {
+  uint64_t size;
+  int64_t mtime; /**< Seconds since the epoch */
+  uint32_t mode; /**< st_mode: type and permission bits */
+  uint32_t reserved;
+} pal_ffi_stat_t;
+
+/** One directory entry (pal_ffi_dir_entries), 32 bytes */
+typedef struct {
+  uint64_t size;
+  int64_t mtime;
+  uint32_t mode;
+  uint32_t name_off; /**< Bytes from the first entry to the name */
+  uint32_t name_len; /**< Without the terminating NUL */
+  uint32_t reserved;
+} pal_ffi_dirent_t;
+
+/**
+ * @brief Read the FTP server counters into @p out
+ * @param server Opaque pointer to the FTP server context
+ * @param out Caller-owned, filled in
+ * @return PAL_FFI_OK, or PAL_FFI_ERR_INVALID_PARAM
+ */
+PAL_FFI_EXPORT int pal_ffi_ftp_server_get_stats(const void *server,
+                                                pal_ffi_ftp_stats_t *out);
+
+/**
+ * @brief List a directory into one read-only block
+ *
+ * Served from the listing cache when it is warm.  The entries and their
+ * names live in a single allocation, so a binding can wrap the whole
+ * listing (pal_ffi_dir_entries) without converting entry by entry.
+ *
+ * @param path Directory path
+ * @return Opaque listing, or NULL if the directory cannot be read
+ */
+PAL_FFI_EXPORT void *pal_ffi_dir_open(const char *path);
+
+/**
+ * @brief Borrow the entries of a listing
+ *
+ * Valid until pal_ffi_dir_close().  The name of entry i is the
+ * NUL-terminated string at (const char *)entries + entries[i].name_off.
+ *
+ * @param dir Opaque listing
+ * @param count Output: number of entries ("." and ".." excluded)
+ * @param bytes Output (may be NULL): size of the block from entries[0]
+ * @return First entry, or NULL for an empty listing
+ */
+PAL_FFI_EXPORT const pal_ffi_dirent_t *
+pal_ffi_dir_entries(const void *dir, uint32_t *count, size_t *bytes);
+
+/**
+ * @brief Free a listing
+ * @param dir Opaque listing (NULL is ignored)
+ */
+PAL_FFI_EXPORT void pal_ffi_dir_close(void *dir);
+
+/*===========================================================================*
+ * BATCHED OPERATIONS
+ * One crossing per batch.  An operation names caller-owned memory by
+ * address; zftpd reads and writes it in place.  Every operation in a
+ * batch has completed when pal_ffi_queue_submit() returns, so buffers
+ * only need to stay pinned for the duration of that call.  The
+ * completions wait in the queue until reaped.
+ *
+ * A queue is not thread-safe: use one per thread.
+ *===========================================================================*/
+
+#define PAL_FFI_OP_NOP 0U
+#define PAL_FFI_OP_READ 1U      /* pread(fd, addr, len, offset) -> bytes */
+#define PAL_FFI_OP_WRITE 2U     /* pwrite(fd, addr, len, offset) -> bytes */
+#define PAL_FFI_OP_FSYNC 3U     /* fsync(fd) -> 0 */
+#define PAL_FFI_OP_STAT 4U      /* path -> pal_ffi_stat_t at addr */
+#define PAL_FFI_OP_FTP_STATS 5U /* handle -> pal_ffi_ftp_stats_t at addr */
+
+/** Submission entry, 56 bytes.  Addresses are carried as uint64_t */
+typedef struct {
+  uint32_t opcode;    /**< PAL_FFI_OP_*                              */
+  int32_t fd;         /**< READ, WRITE, FSYNC                         */
+  uint64_t handle;    /**< FTP_STATS: FTP server context              */
+  uint64_t addr;      /**< Caller buffer                              */
+  uint64_t len;       /**< Caller buffer length                       */
+  uint64_t offset;    /**< READ, WRITE: file offset                   */
+  uint64_t path;      /**< STAT: NUL-terminated path                  */
+  uint64_t user_data; /**< Returned untouched in the completion       */
+} pal_ffi_op_t;
+
+/** Completion entry, 24 bytes */
+typedef struct {
+  uint64_t user_data; /**< From the operation                         */
+  int64_t result;     /**< >= 0 on success, else PAL_FFI_ERR_*        */
+  int32_t sys_errno;  /**< errno when result is PAL_FFI_ERR_IO        */
+  uint32_t opcode;    /**< From the operation                         */
+} pal_ffi_cqe_t;
+
+/**
+ * @brief Create a completion queue
+ * @param depth Completions it can hold (rounded up to a power of two)
+ * @return Opaque queue, or NULL on failure
+ */
+PAL_FFI_EXPORT void *pal_ffi_queue_create(uint32_t depth);
+
+/**
+ * @brief Run a batch of operations, in order
+ *
+ * Stops early when the queue is full: reap, then submit the rest.
+ *
+ * @param queue Opaque queue
+ * @param ops Operations
+ * @param count Number of operations
+ * @return Operations run (each posted one completion), or
+ *         PAL_FFI_ERR_INVALID_PARAM
+ */
+PAL_FFI_EXPORT int pal_ffi_queue_submit(void *queue, const pal_ffi_op_t *ops,
+                                        uint32_t count);
+
+/**
+ * @brief Borrow the oldest pending completions without copying them
+ *
+ * Returns the longest contiguous run; after a wrap-around the rest is
+ * returned by the next call.  Consume with pal_ffi_queue_advance().
+ *
+ * @param queue Opaque queue
+ * @param count Output: completions in the run
+ * @return First completion, or NULL if none is pending
+ */
+PAL_FFI_EXPORT const pal_ffi_cqe_t *pal_ffi_queue_peek(const void *queue,
+                                                       uint32_t *count);
+
+/**
+ * @brief Drop the @p n oldest completions
+ * @param queue Opaque queue
+ * @param n At most the number pending
+ */
+PAL_FFI_EXPORT void pal_ffi_queue_advance(void *queue, uint32_t n);
+
+/**
+ * @brief Copy out and drop up to @p max completions
+ * @param queue Opaque queue
+ * @param out Caller array
+ * @param max Capacity of @p out
+ * @return Completions copied
+ */
+PAL_FFI_EXPORT uint32_t pal_ffi_queue_reap(void *queue, pal_ffi_cqe_t *out,
+                                           uint32_t max);
+
+/**
+ * @brief Destroy a queue, dropping pending completions
+ * @param queue Opaque queue (NULL is ignored)
+ */
+PAL_FFI_EXPORT void pal_ffi_queue_destroy(void *queue);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,223 @@
+package zftpd
+
+// FFI benchmark, Go binding: the cases of ffi/benchmarks/SPEC.md, JSON
+// lines on stdout.  Runs only with ZFTPD_FFI_BENCH=1 (see run.py).
+
+import (
+	"encoding/json"
+	"fmt"
+	"os"
+	"path/filepath"
+	"sort"
+	"strconv"
+	"testing"
+	"time"
+)
+
+const (
+	benchRound     = 1000
+	benchBatch     = 64
+	benchReadChunk = 64 * 1024
+	benchReadBatch = 16
+)
+
+func benchScale() int {
+	v, err := strconv.Atoi(os.Getenv("BENCH_SCALE"))
+	if err != nil || v < 1 || v > 1000 {
+		return 1
+	}
+	return v
+}
+
+func benchPercentile(v []uint64, pct int) uint64 {
+	if len(v) == 0 {
+		return 0
+	}
+	rank := (len(v)*pct + 99) / 100
+	if rank < 1 {
+		rank = 1
+	}
+	return v[rank-1]
+}
+
+func benchReport(name string, ops, bytes uint64, start time.Time, samples []uint64) {
+	secs := time.Since(start).Seconds()
+	if secs <= 0 {
+		secs = 1e-9
+	}
+	sort.Slice(samples, func(i, j int) bool { return samples[i] < samples[j] })
+	fmt.Printf("{\"bench\":\"%s\",\"ops\":%d,\"bytes\":%d,\"secs\":%.6f,\"ops_s\":%.1f,\"mb_s\":%.1f,\"p50_ns\":%d,\"p99_ns\":%d}\n",
+		name, ops, bytes, secs, float64(ops)/secs, float64(bytes)/(1024.0*1024.0)/secs,
+		benchPercentile(samples, 50), benchPercentile(samples, 99))
+}
+
+func benchSkip(name, why string) {
+	out, _ := json.Marshal(map[string]string{"bench": name, "skipped": why})
+	fmt.Println(string(out))
+}
+
+func benchCall(s *FtpServer, n int) {
+	ops := 200000 * n
+	samples := make([]uint64, 0, ops/benchRound)
+	var sum uint64
+	start := time.Now()
+	for r := 0; r < ops/benchRound; r++ {
+		t := time.Now()
+		for j := 0; j < benchRound; j++ {
+			sum += uint64(s.ActiveSessions())
+		}
+		samples = append(samples, uint64(time.Since(t).Nanoseconds())/benchRound)
+	}
+	_ = sum
+	benchReport("ffi_call", uint64(ops), 0, start, samples)
+}
+
+func benchBatchNop(n int) {
+	total := uint64(200000 * n)
+	q, err := NewQueue(benchBatch)
+	if err != nil {
+		benchSkip("ffi_batch_nop", "queue create failed")
+		return
+	}
+	defer q.Close()
+	ops := make([]Op, benchBatch)
+	for i := range ops {
+		ops[i] = NopOp(uint64(i))
+	}
+	var samples []uint64
+	var done uint64
+	start := time.Now()
+	for done < total {
+		t := time.Now()
+		ran, _ := q.Submit(ops)
+		q.Advance(len(q.Completions()))
+		samples = append(samples, uint64(time.Since(t).Nanoseconds())/benchBatch)
+		if ran == 0 {
+			break
+		}
+		done += uint64(ran)
+	}
+	benchReport("ffi_batch_nop", done, 0, start, samples)
+}
+
+func benchStats(s *FtpServer, n int) {
+	ops := 100000 * n
+	samples := make([]uint64, 0, ops/benchRound)
+	var sum uint64
+	start := time.Now()
+	for r := 0; r < ops/benchRound; r++ {
+		t := time.Now()
+		for j := 0; j < benchRound; j++ {
+			if st, err := s.Stats(); err == nil {
+				sum += st.TotalConnections
+			}
+		}
+		samples = append(samples, uint64(time.Since(t).Nanoseconds())/benchRound)
+	}
+	_ = sum
+	benchReport("ffi_stats", uint64(ops), 0, start, samples)
+}
+
+func benchListing(root string, n int) {
+	if root == "" {
+		benchSkip("ffi_listing", "ZFTPD_BENCH_DIR not set")
+		return
+	}
+	path := filepath.Join(root, "list")
+	if d, err := OpenDir(path); err == nil {
+		d.Close()
+	}
+	var samples []uint64
+	var ops, sum uint64
+	start := time.Now()
+	for r := 0; r < 50*n; r++ {
+		t := time.Now()
+		d, err := OpenDir(path)
+		if err != nil {
+			break
+		}
+		entries := d.Entries()
+		for i := range entries {
+			sum += entries[i].Size + uint64(len(d.Name(i)))
+		}
+		count := len(entries)
+		d.Close()
+		if count == 0 {
+			count = 1
+		}
+		samples = append(samples, uint64(time.Since(t).Nanoseconds())/uint64(count))
+		ops += uint64(len(entries))
+	}
+	_ = sum
+	benchReport("ffi_listing", ops, 0, start, samples)
+}
+
+func benchRead(root string, n int) {
+	if root == "" {
+		benchSkip("ffi_read", "ZFTPD_BENCH_DIR not set")
+		return
+	}
+	f, err := os.Open(filepath.Join(root, "data.bin"))
+	if err != nil {
+		benchSkip("ffi_read", "fixture unavailable")
+		return
+	}
+	defer f.Close()
+	info, _ := f.Stat()
+	perPass := int(info.Size()) / (benchReadChunk * benchReadBatch)
+	fd := int(f.Fd())
+	q, err := NewQueue(benchReadBatch)
+	if err != nil {
+		benchSkip("ffi_read", "queue create failed")
+		return
+	}
+	defer q.Close()
+	buf := make([]byte, benchReadChunk*benchReadBatch)
+	ops := make([]Op, benchReadBatch)
+	var samples []uint64
+	var count, bytes uint64
+	start := time.Now()
+	for pass := 0; pass < 2*n; pass++ {
+		for k := 0; k < perPass; k++ {
+			t := time.Now()
+			base := uint64(k * benchReadChunk * benchReadBatch)
+			for i := range ops {
+				chunk := buf[i*benchReadChunk : (i+1)*benchReadChunk]
+				ops[i] = ReadOp(fd, chunk, base+uint64(i*benchReadChunk), uint64(i))
+			}
+			_, _ = q.Submit(ops)
+			done := q.Completions()
+			for i := range done {
+				if done[i].Result > 0 {
+					bytes += uint64(done[i].Result)
+				}
+			}
+			q.Advance(len(done))
+			count += uint64(len(done))
+			samples = append(samples, uint64(time.Since(t).Nanoseconds())/benchReadBatch)
+		}
+	}
+	benchReport("ffi_read", count, bytes, start, samples)
+}
+
+func TestFfiBench(t *testing.T) {
+	if os.Getenv("ZFTPD_FFI_BENCH") != "1" {
+		t.Skip("set ZFTPD_FFI_BENCH=1 (ffi/benchmarks/run.py)")
+	}
+	n := benchScale()
+	root := os.Getenv("ZFTPD_BENCH_DIR")
+	_ = PalAllocInitDefault()
+	server, err := NewFtpServer("127.0.0.1", 2199, "/tmp")
+	if err != nil {
+		benchSkip("ffi_call", "server create failed")
+		benchBatchNop(n)
+		benchSkip("ffi_stats", "server create failed")
+	} else {
+		benchCall(server, n)
+		benchBatchNop(n)
+		benchStats(server, n)
+		server.Close()
+	}
+	benchListing(root, n)
+	benchRead(root, n)
+}
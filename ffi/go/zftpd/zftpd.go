@@ -10,6 +10,7 @@ package zftpd
 import "C"
 import (
 	"errors"
+	"runtime"
 	"unsafe"
 )
 
@@ -112,6 +113,33 @@ func (s *FtpServer) ActiveSessions() uint32 {
 	return uint32(C.pal_ffi_ftp_server_get_active_sessions(s.handle))
 }
 
+// FtpStats mirrors pal_ffi_ftp_stats_t field for field.
+type FtpStats struct {
+	TotalConnections   uint64
+	BytesSent          uint64
+	BytesReceived      uint64
+	AcceptLatencyAvgNs uint64
+	AcceptLatencyMaxNs uint64
+	TotalErrors        uint32
+	Acceptors          uint32
+	ListenBacklog      uint32
+	ConnectionsPerSec  uint32
+	StartQueueDepth    uint32
+	StartQueuePeak     uint32
+	ActiveSessions     uint32
+	reserved           uint32
+}
+
+// Stats reads every counter in one call, straight into the Go struct.
+func (s *FtpServer) Stats() (FtpStats, error) {
+	var out FtpStats
+	res := C.pal_ffi_ftp_server_get_stats(s.handle, (*C.pal_ffi_ftp_stats_t)(unsafe.Pointer(&out)))
+	if res != C.PAL_FFI_OK {
+		return out, errors.New("failed to read ftp stats")
+	}
+	return out, nil
+}
+
 func (s *FtpServer) Stop() {
 	if s.handle != nil {
 		C.pal_ffi_ftp_server_stop(s.handle)
@@ -145,3 +173,212 @@ func (s *HttpServer) Close() {
 		s.handle = nil
 	}
 }
+
+// --- Directory listings ---
+
+// DirEntry mirrors pal_ffi_dirent_t.
+type DirEntry struct {
+	Size     uint64
+	Mtime    int64
+	Mode     uint32
+	nameOff  uint32
+	nameLen  uint32
+	reserved uint32
+}
+
+// DirListing is one directory read into a single C block; Entries and
+// Name borrow from it until Close.
+type DirListing struct {
+	handle  unsafe.Pointer
+	entries []DirEntry
+}
+
+func OpenDir(path string) (*DirListing, error) {
+	cPath := C.CString(path)
+	defer C.free(unsafe.Pointer(cPath))
+
+	handle := C.pal_ffi_dir_open(cPath)
+	if handle == nil {
+		return nil, errors.New("failed to list directory")
+	}
+	var count C.uint32_t
+	first := C.pal_ffi_dir_entries(handle, &count, nil)
+	d := &DirListing{handle: handle}
+	if first != nil {
+		d.entries = unsafe.Slice((*DirEntry)(unsafe.Pointer(first)), int(count))
+	}
+	return d, nil
+}
+
+func (d *DirListing) Entries() []DirEntry {
+	return d.entries
+}
+
+// Name of entry i (copied into a Go string).
+func (d *DirListing) Name(i int) string {
+	e := &d.entries[i]
+	base := unsafe.Pointer(&d.entries[0])
+	return C.GoStringN((*C.char)(unsafe.Add(base, e.nameOff)), C.int(e.nameLen))
+}
+
+func (d *DirListing) Close() {
+	if d.handle != nil {
+		C.pal_ffi_dir_close(d.handle)
+		d.handle = nil
+		d.entries = nil
+	}
+}
+
+// --- Batched operations ---
+
+const (
+	OpNop      = uint32(C.PAL_FFI_OP_NOP)
+	OpRead     = uint32(C.PAL_FFI_OP_READ)
+	OpWrite    = uint32(C.PAL_FFI_OP_WRITE)
+	OpFsync    = uint32(C.PAL_FFI_OP_FSYNC)
+	OpStat     = uint32(C.PAL_FFI_OP_STAT)
+	OpFtpStats = uint32(C.PAL_FFI_OP_FTP_STATS)
+)
+
+// FileStat mirrors pal_ffi_stat_t.
+type FileStat struct {
+	Size     uint64
+	Mtime    int64
+	Mode     uint32
+	reserved uint32
+}
+
+// Completion mirrors pal_ffi_cqe_t.
+type Completion struct {
+	UserData uint64
+	Result   int64
+	Errno    int32
+	Opcode   uint32
+}
+
+// Op is one operation for Queue.Submit. The memory it names is pinned
+// for the duration of the Submit and used in place.
+type Op struct {
+	raw   C.pal_ffi_op_t
+	pin   unsafe.Pointer
+	cPath *C.char
+}
+
+func opBuf(opcode uint32, fd int, buf unsafe.Pointer, n int, offset uint64, userData uint64) Op {
+	var op Op
+	op.raw.opcode = C.uint32_t(opcode)
+	op.raw.fd = C.int32_t(fd)
+	op.raw.addr = C.uint64_t(uintptr(buf))
+	op.raw.len = C.uint64_t(n)
+	op.raw.offset = C.uint64_t(offset)
+	op.raw.user_data = C.uint64_t(userData)
+	op.pin = buf
+	return op
+}
+
+func NopOp(userData uint64) Op {
+	return opBuf(OpNop, -1, nil, 0, 0, userData)
+}
+
+func ReadOp(fd int, buf []byte, offset uint64, userData uint64) Op {
+	if len(buf) == 0 {
+		return opBuf(OpRead, fd, nil, 0, offset, userData)
+	}
+	return opBuf(OpRead, fd, unsafe.Pointer(&buf[0]), len(buf), offset, userData)
+}
+
+func WriteOp(fd int, buf []byte, offset uint64, userData uint64) Op {
+	if len(buf) == 0 {
+		return opBuf(OpWrite, fd, nil, 0, offset, userData)
+	}
+	return opBuf(OpWrite, fd, unsafe.Pointer(&buf[0]), len(buf), offset, userData)
+}
+
+func FsyncOp(fd int, userData uint64) Op {
+	return opBuf(OpFsync, fd, nil, 0, 0, userData)
+}
+
+// StatOp stats path into out. The path is copied to C memory owned by
+// the op and released by Queue.Submit.
+func StatOp(path string, out *FileStat, userData uint64) Op {
+	op := opBuf(OpStat, -1, unsafe.Pointer(out), int(unsafe.Sizeof(*out)), 0, userData)
+	op.cPath = C.CString(path)
+	op.raw.path = C.uint64_t(uintptr(unsafe.Pointer(op.cPath)))
+	return op
+}
+
+func FtpStatsOp(server *FtpServer, out *FtpStats, userData uint64) Op {
+	op := opBuf(OpFtpStats, -1, unsafe.Pointer(out), int(unsafe.Sizeof(*out)), 0, userData)
+	op.raw.handle = C.uint64_t(uintptr(server.handle))
+	return op
+}
+
+// Queue is a batched command/completion queue; use one per goroutine.
+type Queue struct {
+	handle unsafe.Pointer
+	raw    []C.pal_ffi_op_t
+}
+
+func NewQueue(depth uint32) (*Queue, error) {
+	handle := C.pal_ffi_queue_create(C.uint32_t(depth))
+	if handle == nil {
+		return nil, errors.New("failed to create queue")
+	}
+	return &Queue{handle: handle}, nil
+}
+
+// Submit runs ops in order with one cgo call and returns how many ran
+// before the queue filled up.
+func (q *Queue) Submit(ops []Op) (int, error) {
+	var pinner runtime.Pinner
+	defer pinner.Unpin()
+
+	q.raw = q.raw[:0]
+	for i := range ops {
+		if ops[i].pin != nil {
+			pinner.Pin(ops[i].pin)
+		}
+		q.raw = append(q.raw, ops[i].raw)
+	}
+	defer func() {
+		for i := range ops {
+			if ops[i].cPath != nil {
+				C.free(unsafe.Pointer(ops[i].cPath))
+				ops[i].cPath = nil
+				ops[i].raw.path = 0
+			}
+		}
+	}()
+	if len(q.raw) == 0 {
+		return 0, nil
+	}
+	res := C.pal_ffi_queue_submit(q.handle, &q.raw[0], C.uint32_t(len(q.raw)))
+	if res < 0 {
+		return 0, errors.New("invalid submission")
+	}
+	return int(res), nil
+}
+
+// Completions returns the oldest pending completions without copying;
+// valid until the next Advance or Submit.
+func (q *Queue) Completions() []Completion {
+	var count C.uint32_t
+	first := C.pal_ffi_queue_peek(q.handle, &count)
+	if first == nil {
+		return nil
+	}
+	return unsafe.Slice((*Completion)(unsafe.Pointer(first)), int(count))
+}
+
+func (q *Queue) Advance(n int) {
+	if n > 0 {
+		C.pal_ffi_queue_advance(q.handle, C.uint32_t(n))
+	}
+}
+
+func (q *Queue) Close() {
+	if q.handle != nil {
+		C.pal_ffi_queue_destroy(q.handle)
+		q.handle = nil
+	}
+}
@@ -1,6 +1,8 @@
 package zftpd
 
 import (
+	"os"
+	"path/filepath"
 	"testing"
 )
 
@@ -64,3 +66,53 @@ func TestHttpServer(t *testing.T) {
 	}
 	defer httpServer.Close()
 }
+
+func TestQueueBatch(t *testing.T) {
+	dir := t.TempDir()
+	path := filepath.Join(dir, "data.bin")
+	if err := os.WriteFile(path, []byte("batched"), 0644); err != nil {
+		t.Fatal(err)
+	}
+	f, err := os.Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer f.Close()
+
+	q, err := NewQueue(8)
+	if err != nil {
+		t.Fatalf("Failed to create queue: %v", err)
+	}
+	defer q.Close()
+
+	buf := make([]byte, 16)
+	var st FileStat
+	n, err := q.Submit([]Op{
+		ReadOp(int(f.Fd()), buf, 2, 1),
+		StatOp(path, &st, 2),
+		NopOp(3),
+	})
+	if err != nil || n != 3 {
+		t.Fatalf("Submit ran %d: %v", n, err)
+	}
+	if string(buf[:5]) != "tched" || st.Size != 7 {
+		t.Fatalf("Unexpected read %q / size %d", buf[:5], st.Size)
+	}
+	done := q.Completions()
+	if len(done) != 3 || done[0].Result != 5 || done[2].UserData != 3 {
+		t.Fatalf("Unexpected completions %+v", done)
+	}
+	q.Advance(len(done))
+	if q.Completions() != nil {
+		t.Fatal("Queue not drained")
+	}
+
+	d, err := OpenDir(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer d.Close()
+	if len(d.Entries()) != 1 || d.Name(0) != "data.bin" || d.Entries()[0].Size != 7 {
+		t.Fatalf("Unexpected listing")
+	}
+}
@@ -238,6 +238,24 @@ JNIEXPORT void JNICALL Java_org_zftpd_ffi_FtpServer_destroyServer(
   }
 }
 
+/*
+ * Class:     org_zftpd_ffi_FtpServer
+ * Method:    readStats
+ * Signature: (JLjava/nio/ByteBuffer;)I
+ */
+JNIEXPORT jint JNICALL Java_org_zftpd_ffi_FtpServer_readStats(
+    JNIEnv *env, jclass clazz, jlong serverHandle, jobject out) {
+  (void)clazz;
+  void *addr = (*env)->GetDirectBufferAddress(env, out);
+  if (addr == NULL ||
+      (*env)->GetDirectBufferCapacity(env, out) <
+          (jlong)sizeof(pal_ffi_ftp_stats_t)) {
+    return PAL_FFI_ERR_INVALID_PARAM;
+  }
+  return (jint)pal_ffi_ftp_server_get_stats(
+      (const void *)(intptr_t)serverHandle, (pal_ffi_ftp_stats_t *)addr);
+}
+
 /*
  * Class:     org_zftpd_ffi_HttpServer
  * Method:    create
@@ -267,6 +285,160 @@ JNIEXPORT void JNICALL Java_org_zftpd_ffi_HttpServer_destroyServer(
   }
 }
 
+/*
+ * Class:     org_zftpd_ffi_OpQueue
+ * Method:    address
+ * Signature: (Ljava/nio/ByteBuffer;)J
+ */
+JNIEXPORT jlong JNICALL Java_org_zftpd_ffi_OpQueue_address(JNIEnv *env,
+                                                           jclass clazz,
+                                                           jobject direct) {
+  (void)clazz;
+  return (jlong)(intptr_t)(*env)->GetDirectBufferAddress(env, direct);
+}
+
+/*
+ * Class:     org_zftpd_ffi_OpQueue
+ * Method:    create
+ * Signature: (I)J
+ */
+JNIEXPORT jlong JNICALL Java_org_zftpd_ffi_OpQueue_create(JNIEnv *env,
+                                                          jclass clazz,
+                                                          jint depth) {
+  (void)env;
+  (void)clazz;
+  if (depth <= 0) {
+    return 0;
+  }
+  return (jlong)(intptr_t)pal_ffi_queue_create((uint32_t)depth);
+}
+
+/*
+ * Class:     org_zftpd_ffi_OpQueue
+ * Method:    submitOps
+ * Signature: (JLjava/nio/ByteBuffer;I)I
+ */
+JNIEXPORT jint JNICALL Java_org_zftpd_ffi_OpQueue_submitOps(
+    JNIEnv *env, jclass clazz, jlong queueHandle, jobject ops, jint count) {
+  (void)clazz;
+  const pal_ffi_op_t *raw =
+      (const pal_ffi_op_t *)(*env)->GetDirectBufferAddress(env, ops);
+  if (raw == NULL || count < 0 ||
+      (*env)->GetDirectBufferCapacity(env, ops) <
+          (jlong)count * (jlong)sizeof(pal_ffi_op_t)) {
+    return PAL_FFI_ERR_INVALID_PARAM;
+  }
+  return (jint)pal_ffi_queue_submit((void *)(intptr_t)queueHandle, raw,
+                                    (uint32_t)count);
+}
+
+/*
+ * Class:     org_zftpd_ffi_OpQueue
+ * Method:    peekCompletions
+ * Signature: (J)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_org_zftpd_ffi_OpQueue_peekCompletions(
+    JNIEnv *env, jclass clazz, jlong queueHandle) {
+  (void)clazz;
+  uint32_t count = 0U;
+  const pal_ffi_cqe_t *first =
+      pal_ffi_queue_peek((const void *)(intptr_t)queueHandle, &count);
+  if (first == NULL) {
+    return NULL;
+  }
+  /* Read-only by contract; JNI has no const direct buffers */
+  return (*env)->NewDirectByteBuffer(env, (void *)(uintptr_t)first,
+                                     (jlong)count *
+                                         (jlong)sizeof(pal_ffi_cqe_t));
+}
+
+/*
+ * Class:     org_zftpd_ffi_OpQueue
+ * Method:    advanceCompletions
+ * Signature: (JI)V
+ */
+JNIEXPORT void JNICALL Java_org_zftpd_ffi_OpQueue_advanceCompletions(
+    JNIEnv *env, jclass clazz, jlong queueHandle, jint n) {
+  (void)env;
+  (void)clazz;
+  if (n > 0) {
+    pal_ffi_queue_advance((void *)(intptr_t)queueHandle, (uint32_t)n);
+  }
+}
+
+/*
+ * Class:     org_zftpd_ffi_OpQueue
+ * Method:    destroy
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_org_zftpd_ffi_OpQueue_destroy(JNIEnv *env,
+                                                          jclass clazz,
+                                                          jlong queueHandle) {
+  (void)env;
+  (void)clazz;
+  pal_ffi_queue_destroy((void *)(intptr_t)queueHandle);
+}
+
+/*
+ * Class:     org_zftpd_ffi_DirListing
+ * Method:    open
+ * Signature: (Ljava/lang/String;)J
+ */
+JNIEXPORT jlong JNICALL Java_org_zftpd_ffi_DirListing_open(JNIEnv *env,
+                                                           jclass clazz,
+                                                           jstring path) {
+  (void)clazz;
+  const char *c_path = (*env)->GetStringUTFChars(env, path, 0);
+  void *dir = pal_ffi_dir_open(c_path);
+  (*env)->ReleaseStringUTFChars(env, path, c_path);
+  return (jlong)(intptr_t)dir;
+}
+
+/*
+ * Class:     org_zftpd_ffi_DirListing
+ * Method:    entryCount
+ * Signature: (J)I
+ */
+JNIEXPORT jint JNICALL Java_org_zftpd_ffi_DirListing_entryCount(
+    JNIEnv *env, jclass clazz, jlong dirHandle) {
+  (void)env;
+  (void)clazz;
+  uint32_t count = 0U;
+  (void)pal_ffi_dir_entries((const void *)(intptr_t)dirHandle, &count, NULL);
+  return (jint)count;
+}
+
+/*
+ * Class:     org_zftpd_ffi_DirListing
+ * Method:    entries
+ * Signature: (J)Ljava/nio/ByteBuffer;
+ */
+JNIEXPORT jobject JNICALL Java_org_zftpd_ffi_DirListing_entries(
+    JNIEnv *env, jclass clazz, jlong dirHandle) {
+  (void)clazz;
+  uint32_t count = 0U;
+  size_t bytes = 0U;
+  const pal_ffi_dirent_t *first =
+      pal_ffi_dir_entries((const void *)(intptr_t)dirHandle, &count, &bytes);
+  if (first == NULL) {
+    return NULL;
+  }
+  return (*env)->NewDirectByteBuffer(env, (void *)(uintptr_t)first,
+                                     (jlong)bytes);
+}
+
+/*
+ * Class:     org_zftpd_ffi_DirListing
+ * Method:    closeListing
+ * Signature: (J)V
+ */
+JNIEXPORT void JNICALL Java_org_zftpd_ffi_DirListing_closeListing(
+    JNIEnv *env, jclass clazz, jlong dirHandle) {
+  (void)env;
+  (void)clazz;
+  pal_ffi_dir_close((void *)(intptr_t)dirHandle);
+}
+
 #ifdef __cplusplus
 }
 #endif
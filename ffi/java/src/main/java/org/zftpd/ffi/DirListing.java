@@ -0,0 +1,82 @@
+package org.zftpd.ffi;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Directory listing (pal_ffi_dir_*), viewed in place.
+ *
+ * The entries (32 bytes each: size, mtime, mode, name offset, name
+ * length) and their names sit in one native block that entries() wraps
+ * without copying.  Valid until close().
+ */
+public class DirListing implements AutoCloseable {
+
+    static {
+        System.loadLibrary("zftpd_ffi_java");
+    }
+
+    public static final int ENTRY_SIZE = 32;
+
+    private long handle = 0;
+    private ByteBuffer block;
+    private int count;
+
+    public DirListing(String path) {
+        this.handle = open(path);
+        if (this.handle == 0) {
+            throw new RuntimeException("Failed to list " + path);
+        }
+        this.count = entryCount(this.handle);
+        ByteBuffer view = entries(this.handle);
+        this.block = (view == null) ? null : view.order(ByteOrder.nativeOrder());
+    }
+
+    public int count() {
+        return this.count;
+    }
+
+    public long size(int i) {
+        return this.block.getLong(i * ENTRY_SIZE);
+    }
+
+    public long mtime(int i) {
+        return this.block.getLong(i * ENTRY_SIZE + 8);
+    }
+
+    public int mode(int i) {
+        return this.block.getInt(i * ENTRY_SIZE + 16);
+    }
+
+    public String name(int i) {
+        int off = this.block.getInt(i * ENTRY_SIZE + 20);
+        int len = this.block.getInt(i * ENTRY_SIZE + 24);
+        byte[] raw = new byte[len];
+        ByteBuffer dup = this.block.duplicate();
+        dup.position(off);
+        dup.get(raw);
+        return new String(raw, StandardCharsets.UTF_8);
+    }
+
+    /** The whole block, for callers that decode entries themselves */
+    public ByteBuffer block() {
+        return this.block;
+    }
+
+    @Override
+    public void close() {
+        if (this.handle != 0) {
+            closeListing(this.handle);
+            this.handle = 0;
+            this.block = null;
+            this.count = 0;
+        }
+    }
+
+    // Native calls
+    private static native long open(String path);
+    private static native int entryCount(long dirHandle);
+    private static native ByteBuffer entries(long dirHandle);
+    private static native void closeListing(long dirHandle);
+}
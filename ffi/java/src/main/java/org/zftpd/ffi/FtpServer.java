@@ -1,5 +1,7 @@
 package org.zftpd.ffi;
 
+import java.nio.ByteBuffer;
+
 /**
  * Zftpd FTP Server Java Bindings
  */
@@ -35,6 +37,21 @@ public class FtpServer implements AutoCloseable {
         return 0;
     }
     
+    /** Size of the counters block filled by getStats (pal_ffi_ftp_stats_t) */
+    public static final int STATS_SIZE = 72;
+
+    /**
+     * Fill @p out (a direct buffer of at least STATS_SIZE bytes, native
+     * order) with every server counter in one call.
+     * @return 0 on success, negative error code on failure
+     */
+    public int getStats(ByteBuffer out) {
+        if (this.handle == 0 || !out.isDirect() || out.capacity() < STATS_SIZE) {
+            return -1;
+        }
+        return readStats(this.handle, out);
+    }
+
     public void stop() {
         if (this.handle != 0) {
             stopServer(this.handle);
@@ -54,6 +71,7 @@ public class FtpServer implements AutoCloseable {
     private static native int startServer(long serverHandle);
     private static native int isServerRunning(long serverHandle);
     private static native long getSessions(long serverHandle);
+    private static native int readStats(long serverHandle, ByteBuffer out);
     private static native void stopServer(long serverHandle);
     private static native void destroyServer(long serverHandle);
 }
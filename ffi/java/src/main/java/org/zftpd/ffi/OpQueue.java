@@ -0,0 +1,118 @@
+package org.zftpd.ffi;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Batched command/completion queue (pal_ffi_queue_*).
+ *
+ * Operations are written into a direct ByteBuffer with putOp() and run
+ * with a single native call per batch.  They reference direct buffers by
+ * address (see address()), so zftpd reads and writes them in place.
+ * Completions are viewed in place through peek().  Not thread-safe: use
+ * one queue per thread.
+ */
+public class OpQueue implements AutoCloseable {
+
+    static {
+        System.loadLibrary("zftpd_ffi_java");
+    }
+
+    /** Size of one operation in the ops buffer (pal_ffi_op_t) */
+    public static final int OP_SIZE = 56;
+    /** Size of one completion in the peek() view (pal_ffi_cqe_t) */
+    public static final int CQE_SIZE = 24;
+
+    public static final int OP_NOP = 0;
+    public static final int OP_READ = 1;
+    public static final int OP_WRITE = 2;
+    public static final int OP_FSYNC = 3;
+    public static final int OP_STAT = 4;
+    public static final int OP_FTP_STATS = 5;
+
+    /** Completion field offsets */
+    public static final int CQE_USER_DATA = 0;
+    public static final int CQE_RESULT = 8;
+    public static final int CQE_ERRNO = 16;
+    public static final int CQE_OPCODE = 20;
+
+    private long handle = 0;
+
+    public OpQueue(int depth) {
+        this.handle = create(depth);
+        if (this.handle == 0) {
+            throw new RuntimeException("Failed to create OpQueue");
+        }
+    }
+
+    /** A direct buffer for @p count operations, in native byte order */
+    public static ByteBuffer allocateOps(int count) {
+        return ByteBuffer.allocateDirect(count * OP_SIZE).order(ByteOrder.nativeOrder());
+    }
+
+    /**
+     * Write operation @p index into @p ops.  Addresses come from address();
+     * the buffers they point at must stay reachable until submit() returns.
+     */
+    public static void putOp(ByteBuffer ops, int index, int opcode, int fd, long handle,
+                             long addr, long len, long offset, long path, long userData) {
+        int at = index * OP_SIZE;
+        ops.putInt(at, opcode);
+        ops.putInt(at + 4, fd);
+        ops.putLong(at + 8, handle);
+        ops.putLong(at + 16, addr);
+        ops.putLong(at + 24, len);
+        ops.putLong(at + 32, offset);
+        ops.putLong(at + 40, path);
+        ops.putLong(at + 48, userData);
+    }
+
+    /** Native address of a direct buffer, to reference it from an operation */
+    public static native long address(ByteBuffer direct);
+
+    /**
+     * Run @p count operations from @p ops (a direct buffer).
+     * @return operations run (stops early when the queue is full), or a negative error code
+     */
+    public int submit(ByteBuffer ops, int count) {
+        if (this.handle == 0 || !ops.isDirect() || count < 0 || ops.capacity() < count * OP_SIZE) {
+            return -1;
+        }
+        return submitOps(this.handle, ops, count);
+    }
+
+    /**
+     * Oldest pending completions, viewed in place (CQE_SIZE bytes each).
+     * Valid until the next advance() or submit().
+     * @return the view, or null when nothing is pending
+     */
+    public ByteBuffer peek() {
+        if (this.handle == 0) {
+            return null;
+        }
+        ByteBuffer view = peekCompletions(this.handle);
+        return (view == null) ? null : view.order(ByteOrder.nativeOrder());
+    }
+
+    /** Drop the @p n oldest completions */
+    public void advance(int n) {
+        if (this.handle != 0 && n > 0) {
+            advanceCompletions(this.handle, n);
+        }
+    }
+
+    @Override
+    public void close() {
+        if (this.handle != 0) {
+            destroy(this.handle);
+            this.handle = 0;
+        }
+    }
+
+    // Native calls
+    private static native long create(int depth);
+    private static native int submitOps(long queueHandle, ByteBuffer ops, int count);
+    private static native ByteBuffer peekCompletions(long queueHandle);
+    private static native void advanceCompletions(long queueHandle, int n);
+    private static native void destroy(long queueHandle);
+}
@@ -1,5 +1,9 @@
 package org.zftpd.ffi;
 
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.StandardCharsets;
+
 public class FfiTests {
 
     public static void main(String[] args) {
@@ -24,6 +28,9 @@ public class FfiTests {
             int started = ftp.start();
             System.out.println("FtpServer started: " + started);
             System.out.println("FtpServer isRunning: " + ftp.isRunning());
+            ByteBuffer stats = ByteBuffer.allocateDirect(FtpServer.STATS_SIZE).order(ByteOrder.nativeOrder());
+            System.out.println("FtpServer getStats: " + ftp.getStats(stats)
+                    + " connections=" + stats.getLong(0));
             ftp.stop();
             System.out.println("FtpServer stopped.");
         } catch (Exception e) {
@@ -42,6 +49,38 @@ public class FfiTests {
             System.err.println("EventLoop error: " + e.getMessage());
         }
         
+        // 4. Batched operations and listings
+        try (OpQueue queue = new OpQueue(8)) {
+            ByteBuffer stat = ByteBuffer.allocateDirect(24).order(ByteOrder.nativeOrder());
+            byte[] raw = "/tmp".getBytes(StandardCharsets.UTF_8);
+            ByteBuffer path = ByteBuffer.allocateDirect(raw.length + 1);
+            path.put(raw).put((byte) 0);
+            ByteBuffer ops = OpQueue.allocateOps(2);
+            OpQueue.putOp(ops, 0, OpQueue.OP_STAT, -1, 0, OpQueue.address(stat), 24, 0,
+                          OpQueue.address(path), 1);
+            OpQueue.putOp(ops, 1, OpQueue.OP_NOP, -1, 0, 0, 0, 0, 0, 2);
+            System.out.println("OpQueue submit: " + queue.submit(ops, 2));
+            ByteBuffer done = queue.peek();
+            int n = (done == null) ? 0 : done.capacity() / OpQueue.CQE_SIZE;
+            for (int i = 0; i < n; i++) {
+                System.out.println("  completion " + done.getLong(i * OpQueue.CQE_SIZE + OpQueue.CQE_USER_DATA)
+                        + " -> " + done.getLong(i * OpQueue.CQE_SIZE + OpQueue.CQE_RESULT));
+            }
+            queue.advance(n);
+            System.out.println("  /tmp mode: " + Integer.toOctalString(stat.getInt(16)));
+        } catch (Exception e) {
+            System.err.println("OpQueue error: " + e.getMessage());
+        }
+
+        try (DirListing listing = new DirListing("/tmp")) {
+            System.out.println("DirListing /tmp: " + listing.count() + " entries");
+            if (listing.count() > 0) {
+                System.out.println("  first: " + listing.name(0) + " (" + listing.size(0) + " bytes)");
+            }
+        } catch (Exception e) {
+            System.err.println("DirListing error: " + e.getMessage());
+        }
+
         System.out.println("All FFI Tests Completed.");
     }
 }
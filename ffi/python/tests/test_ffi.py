@@ -1,5 +1,6 @@
 import pytest
-from zftpd.core import PalAlloc, EventLoop, FtpServer, HttpServer
+import os
+from zftpd.core import PalAlloc, EventLoop, FtpServer, HttpServer, DirListing, Queue
 
 def test_pal_alloc():
     # Initialize allocator
@@ -22,6 +23,7 @@ def test_ftp_server():
     
     assert server.is_running() is True
     assert server.active_sessions() == 0
+    assert server.stats().active_sessions == 0
 
     server.stop()
     assert server.is_running() is False
@@ -32,3 +34,27 @@ def test_http_server():
     with EventLoop() as loop:
         with HttpServer(loop, 8888) as http:
             pass # Creating it implies it works; will auto-close on __exit__
+
+def test_queue_batch(tmp_path):
+    path = tmp_path / "data.bin"
+    path.write_bytes(b"batched")
+    buf = bytearray(16)
+    fd = os.open(str(path), os.O_RDONLY)
+    try:
+        with Queue(8) as q:
+            q.read(fd, buf, 2, user_data=1)
+            st = q.stat(str(path), user_data=2)
+            assert q.submit() == 2
+            assert bytes(buf[:5]) == b"tched"
+            assert st.size == 7
+            done = q.completions()
+            assert [c.user_data for c in done] == [1, 2]
+            assert done[0].result == 5
+            q.advance(len(done))
+            assert q.completions() == []
+    finally:
+        os.close(fd)
+
+    with DirListing(str(tmp_path)) as listing:
+        assert len(listing) == 1
+        assert listing.name(0) == b"data.bin"
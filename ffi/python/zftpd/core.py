@@ -32,8 +32,74 @@ ffi.cdef("""
     // HTTP Server
     void *pal_ffi_http_server_create(void *loop, uint16_t port);
     void pal_ffi_http_server_destroy(void *server);
+
+    // Flat views
+    typedef struct {
+        uint64_t total_connections;
+        uint64_t bytes_sent;
+        uint64_t bytes_received;
+        uint64_t accept_latency_avg_ns;
+        uint64_t accept_latency_max_ns;
+        uint32_t total_errors;
+        uint32_t acceptors;
+        uint32_t listen_backlog;
+        uint32_t connections_per_sec;
+        uint32_t start_queue_depth;
+        uint32_t start_queue_peak;
+        uint32_t active_sessions;
+        uint32_t reserved;
+    } pal_ffi_ftp_stats_t;
+    typedef struct {
+        uint64_t size;
+        int64_t mtime;
+        uint32_t mode;
+        uint32_t reserved;
+    } pal_ffi_stat_t;
+    typedef struct {
+        uint64_t size;
+        int64_t mtime;
+        uint32_t mode;
+        uint32_t name_off;
+        uint32_t name_len;
+        uint32_t reserved;
+    } pal_ffi_dirent_t;
+    int pal_ffi_ftp_server_get_stats(const void *server, pal_ffi_ftp_stats_t *out);
+    void *pal_ffi_dir_open(const char *path);
+    const pal_ffi_dirent_t *pal_ffi_dir_entries(const void *dir, uint32_t *count, size_t *bytes);
+    void pal_ffi_dir_close(void *dir);
+
+    // Batched operations
+    typedef struct {
+        uint32_t opcode;
+        int32_t fd;
+        uint64_t handle;
+        uint64_t addr;
+        uint64_t len;
+        uint64_t offset;
+        uint64_t path;
+        uint64_t user_data;
+    } pal_ffi_op_t;
+    typedef struct {
+        uint64_t user_data;
+        int64_t result;
+        int32_t sys_errno;
+        uint32_t opcode;
+    } pal_ffi_cqe_t;
+    void *pal_ffi_queue_create(uint32_t depth);
+    int pal_ffi_queue_submit(void *queue, const pal_ffi_op_t *ops, uint32_t count);
+    const pal_ffi_cqe_t *pal_ffi_queue_peek(const void *queue, uint32_t *count);
+    void pal_ffi_queue_advance(void *queue, uint32_t n);
+    uint32_t pal_ffi_queue_reap(void *queue, pal_ffi_cqe_t *out, uint32_t max);
+    void pal_ffi_queue_destroy(void *queue);
 """)
 
+OP_NOP = 0
+OP_READ = 1
+OP_WRITE = 2
+OP_FSYNC = 3
+OP_STAT = 4
+OP_FTP_STATS = 5
+
 # Automatically load the library from the build directory based on current OS
 _library_path = None
 _possible_paths = [
@@ -44,6 +110,8 @@ _possible_paths = [
 ]
 
 _current_dir = os.path.dirname(os.path.abspath(__file__))
+if os.environ.get("ZFTPD_FFI_LIB"):
+    _possible_paths.insert(0, os.environ["ZFTPD_FFI_LIB"])
 for path in _possible_paths:
     full_path = os.path.normpath(os.path.join(_current_dir, path))
     if os.path.exists(full_path):
@@ -130,6 +198,14 @@ class FtpServer:
     def active_sessions(self) -> int:
         return lib.pal_ffi_ftp_server_get_active_sessions(self._handle)
 
+    def stats(self):
+        """All counters in one call, as a pal_ffi_ftp_stats_t cdata struct."""
+        out = ffi.new("pal_ffi_ftp_stats_t *")
+        res = lib.pal_ffi_ftp_server_get_stats(self._handle, out)
+        if res != 0:
+            raise ZftpdException(f"FtpServer stats failed with: {res}")
+        return out
+
     def stop(self):
         if self._handle != ffi.NULL:
             lib.pal_ffi_ftp_server_stop(self._handle)
@@ -162,3 +238,129 @@ class HttpServer:
 
     def __exit__(self, exc_type, exc_val, exc_tb):
         self.close()
+
+
+class DirListing:
+    """One directory read into a single C block; entries are borrowed until close()."""
+
+    def __init__(self, path: str):
+        self._handle = lib.pal_ffi_dir_open(path.encode('utf-8'))
+        if self._handle == ffi.NULL:
+            raise ZftpdException(f"Failed to list {path}")
+        count = ffi.new("uint32_t *")
+        self._entries = lib.pal_ffi_dir_entries(self._handle, count, ffi.NULL)
+        self._count = count[0]
+
+    def __len__(self):
+        return self._count
+
+    def entry(self, i: int):
+        if not 0 <= i < self._count:
+            raise IndexError(i)
+        return self._entries[i]
+
+    def name(self, i: int) -> bytes:
+        e = self.entry(i)
+        base = ffi.cast("const char *", self._entries)
+        return ffi.string(base + e.name_off, e.name_len)
+
+    def close(self):
+        if self._handle != ffi.NULL:
+            lib.pal_ffi_dir_close(self._handle)
+            self._handle = ffi.NULL
+            self._count = 0
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+
+class Queue:
+    """Batched command/completion queue; one per thread.
+
+    Operations reference writable Python buffers (bytearray, memoryview,
+    numpy arrays...) through ffi.from_buffer, so data is read and written
+    in place.  They only need to stay alive until submit() returns.
+    """
+
+    def __init__(self, depth: int):
+        self._handle = lib.pal_ffi_queue_create(depth)
+        if self._handle == ffi.NULL:
+            raise ZftpdException("Failed to create Queue")
+        self._ops = []
+        self._keep = []
+
+    def _add(self, opcode, user_data, fd=-1, buf=None, offset=0, path=None, handle=ffi.NULL, out=None):
+        op = {"opcode": opcode, "fd": fd, "offset": offset, "user_data": user_data}
+        if buf is not None:
+            cbuf = ffi.from_buffer(buf, require_writable=(opcode == OP_READ))
+            self._keep.append(cbuf)
+            op["addr"] = int(ffi.cast("uintptr_t", cbuf))
+            op["len"] = len(cbuf)
+        if out is not None:
+            self._keep.append(out)
+            op["addr"] = int(ffi.cast("uintptr_t", out))
+            op["len"] = ffi.sizeof(out[0])
+        if path is not None:
+            cpath = ffi.new("char[]", path.encode('utf-8'))
+            self._keep.append(cpath)
+            op["path"] = int(ffi.cast("uintptr_t", cpath))
+        op["handle"] = int(ffi.cast("uintptr_t", handle))
+        self._ops.append(op)
+
+    def nop(self, user_data: int = 0):
+        self._add(OP_NOP, user_data)
+
+    def read(self, fd: int, buf, offset: int, user_data: int = 0):
+        self._add(OP_READ, user_data, fd=fd, buf=buf, offset=offset)
+
+    def write(self, fd: int, buf, offset: int, user_data: int = 0):
+        self._add(OP_WRITE, user_data, fd=fd, buf=buf, offset=offset)
+
+    def fsync(self, fd: int, user_data: int = 0):
+        self._add(OP_FSYNC, user_data, fd=fd)
+
+    def stat(self, path: str, user_data: int = 0):
+        """Returns the pal_ffi_stat_t filled in by the next submit()."""
+        out = ffi.new("pal_ffi_stat_t *")
+        self._add(OP_STAT, user_data, path=path, out=out)
+        return out
+
+    def ftp_stats(self, server: "FtpServer", user_data: int = 0):
+        """Returns the pal_ffi_ftp_stats_t filled in by the next submit()."""
+        out = ffi.new("pal_ffi_ftp_stats_t *")
+        self._add(OP_FTP_STATS, user_data, handle=server._handle, out=out)
+        return out
+
+    def submit(self) -> int:
+        """Run every queued operation in one call; returns how many ran."""
+        ops = ffi.new("pal_ffi_op_t[]", self._ops) if self._ops else ffi.NULL
+        res = lib.pal_ffi_queue_submit(self._handle, ops, len(self._ops))
+        self._ops = [] if res < 0 else self._ops[res:]
+        if not self._ops:
+            self._keep = []
+        if res < 0:
+            raise ZftpdException(f"Queue submit failed with: {res}")
+        return res
+
+    def completions(self):
+        """Oldest pending completions, borrowed in place until advance()/submit()."""
+        count = ffi.new("uint32_t *")
+        first = lib.pal_ffi_queue_peek(self._handle, count)
+        return [first[i] for i in range(count[0])] if first != ffi.NULL else []
+
+    def advance(self, n: int):
+        lib.pal_ffi_queue_advance(self._handle, n)
+
+    def close(self):
+        if self._handle != ffi.NULL:
+            lib.pal_ffi_queue_destroy(self._handle)
+            self._handle = ffi.NULL
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
@@ -1,45 +1,195 @@
+//! FFI benchmark, Rust binding: the cases of ffi/benchmarks/SPEC.md,
+//! JSON lines on stdout.
+
+use std::fs::File;
+use std::os::unix::io::AsRawFd;
 use std::time::Instant;
-use zftpd::{FtpServer, PalAlloc};
+use zftpd::{DirListing, FtpServer, Op, PalAlloc, Queue};
 
-fn benchmark_allocator(iterations: usize) {
-    PalAlloc::init_default().unwrap();
-    let start = Instant::now();
+const ROUND: u64 = 1000;
+const BATCH: usize = 64;
+const READ_CHUNK: usize = 64 * 1024;
+const READ_BATCH: usize = 16;
 
-    for _ in 0..iterations {
-        let ptr = PalAlloc::malloc(64);
-        PalAlloc::free(ptr);
+fn scale() -> u64 {
+    match std::env::var("BENCH_SCALE").ok().and_then(|v| v.parse::<u64>().ok()) {
+        Some(v) if (1..=1000).contains(&v) => v,
+        _ => 1,
     }
+}
 
-    let duration = start.elapsed();
+fn percentile(v: &[u64], pct: usize) -> u64 {
+    if v.is_empty() {
+        return 0;
+    }
+    let rank = (v.len() * pct + 99) / 100;
+    v[rank.max(1) - 1]
+}
+
+fn report(name: &str, ops: u64, bytes: u64, start: Instant, mut samples: Vec<u64>) {
+    let secs = start.elapsed().as_secs_f64().max(1e-9);
+    samples.sort_unstable();
     println!(
-        "[Rust] Allocator ({} iters): {:.2} ms",
-        iterations,
-        duration.as_secs_f64() * 1000.0
+        "{{\"bench\":\"{}\",\"ops\":{},\"bytes\":{},\"secs\":{:.6},\"ops_s\":{:.1},\"mb_s\":{:.1},\"p50_ns\":{},\"p99_ns\":{}}}",
+        name,
+        ops,
+        bytes,
+        secs,
+        ops as f64 / secs,
+        bytes as f64 / (1024.0 * 1024.0) / secs,
+        percentile(&samples, 50),
+        percentile(&samples, 99)
     );
 }
 
-fn benchmark_ftp_startup(iterations: usize) {
+fn skip(name: &str, why: &str) {
+    println!("{{\"bench\":\"{}\",\"skipped\":\"{}\"}}", name, why);
+}
+
+fn bench_call(server: &FtpServer, n: u64) {
+    let ops = 200_000 * n;
+    let mut samples = Vec::with_capacity((ops / ROUND) as usize);
+    let mut sum = 0u64;
     let start = Instant::now();
+    for _ in 0..ops / ROUND {
+        let t = Instant::now();
+        for _ in 0..ROUND {
+            sum += server.active_sessions() as u64;
+        }
+        samples.push(t.elapsed().as_nanos() as u64 / ROUND);
+    }
+    std::hint::black_box(sum);
+    report("ffi_call", ops, 0, start, samples);
+}
+
+fn bench_batch_nop(n: u64) {
+    let total = 200_000 * n;
+    let mut queue = Queue::new(BATCH as u32).expect("queue");
+    let ops: Vec<Op> = (0..BATCH as u64).map(Op::nop).collect();
+    let mut samples = Vec::new();
+    let mut done = 0u64;
+    let start = Instant::now();
+    while done < total {
+        let t = Instant::now();
+        let ran = queue.submit(&ops).unwrap_or(0);
+        let got = queue.completions().len();
+        queue.advance(got);
+        samples.push(t.elapsed().as_nanos() as u64 / BATCH as u64);
+        if ran == 0 {
+            break;
+        }
+        done += ran as u64;
+    }
+    report("ffi_batch_nop", done, 0, start, samples);
+}
 
-    for i in 0..iterations {
-        let port = 20000 + (i as u16 % 10000);
-        if let Ok(server) = FtpServer::new("127.0.0.1", port, "/tmp") {
-            if server.start().is_ok() {
-                server.stop();
+fn bench_stats(server: &FtpServer, n: u64) {
+    let ops = 100_000 * n;
+    let mut samples = Vec::with_capacity((ops / ROUND) as usize);
+    let mut sum = 0u64;
+    let start = Instant::now();
+    for _ in 0..ops / ROUND {
+        let t = Instant::now();
+        for _ in 0..ROUND {
+            if let Ok(st) = server.stats() {
+                sum += st.total_connections;
             }
         }
+        samples.push(t.elapsed().as_nanos() as u64 / ROUND);
     }
+    std::hint::black_box(sum);
+    report("ffi_stats", ops, 0, start, samples);
+}
 
-    let duration = start.elapsed();
-    println!(
-        "[Rust] FtpServer start/stop ({} iters): {:.2} ms",
-        iterations,
-        duration.as_secs_f64() * 1000.0
-    );
+fn bench_listing(root: Option<&str>, n: u64) {
+    let Some(root) = root else {
+        skip("ffi_listing", "ZFTPD_BENCH_DIR not set");
+        return;
+    };
+    let path = format!("{}/list", root);
+    drop(DirListing::open(&path));
+    let mut samples = Vec::new();
+    let mut ops = 0u64;
+    let mut sum = 0u64;
+    let start = Instant::now();
+    for _ in 0..50 * n {
+        let t = Instant::now();
+        let Ok(listing) = DirListing::open(&path) else {
+            break;
+        };
+        let count = listing.entries().len();
+        for i in 0..count {
+            sum += listing.entries()[i].size + listing.name(i).to_bytes().len() as u64;
+        }
+        drop(listing);
+        samples.push(t.elapsed().as_nanos() as u64 / count.max(1) as u64);
+        ops += count as u64;
+    }
+    std::hint::black_box(sum);
+    report("ffi_listing", ops, 0, start, samples);
+}
+
+fn bench_read(root: Option<&str>, n: u64) {
+    let Some(root) = root else {
+        skip("ffi_read", "ZFTPD_BENCH_DIR not set");
+        return;
+    };
+    let Ok(file) = File::open(format!("{}/data.bin", root)) else {
+        skip("ffi_read", "fixture unavailable");
+        return;
+    };
+    let size = file.metadata().map(|m| m.len()).unwrap_or(0);
+    let per_pass = size / (READ_CHUNK * READ_BATCH) as u64;
+    let fd = file.as_raw_fd();
+    let mut queue = Queue::new(READ_BATCH as u32).expect("queue");
+    let mut buf = vec![0u8; READ_CHUNK * READ_BATCH];
+    let mut samples = Vec::new();
+    let mut ops = 0u64;
+    let mut bytes = 0u64;
+    let start = Instant::now();
+    for _ in 0..2 * n {
+        for k in 0..per_pass {
+            let t = Instant::now();
+            let base = k * (READ_CHUNK * READ_BATCH) as u64;
+            {
+                let batch: Vec<Op> = buf
+                    .chunks_mut(READ_CHUNK)
+                    .enumerate()
+                    .map(|(i, chunk)| Op::read(fd, chunk, base + (i * READ_CHUNK) as u64, i as u64))
+                    .collect();
+                let _ = queue.submit(&batch);
+            }
+            let done = queue.completions();
+            let got = done.len();
+            for c in done {
+                if c.result > 0 {
+                    bytes += c.result as u64;
+                }
+            }
+            queue.advance(got);
+            ops += got as u64;
+            samples.push(t.elapsed().as_nanos() as u64 / READ_BATCH as u64);
+        }
+    }
+    report("ffi_read", ops, bytes, start, samples);
 }
 
 fn main() {
-    println!("--- Rust FFI Benchmarks ---");
-    benchmark_allocator(100_000);
-    benchmark_ftp_startup(1000);
+    let n = scale();
+    let root = std::env::var("ZFTPD_BENCH_DIR").ok().filter(|v| !v.is_empty());
+    let _ = PalAlloc::init_default();
+    match FtpServer::new("127.0.0.1", 2199, "/tmp") {
+        Ok(server) => {
+            bench_call(&server, n);
+            bench_batch_nop(n);
+            bench_stats(&server, n);
+        }
+        Err(_) => {
+            skip("ffi_call", "server create failed");
+            bench_batch_nop(n);
+            skip("ffi_stats", "server create failed");
+        }
+    }
+    bench_listing(root.as_deref(), n);
+    bench_read(root.as_deref(), n);
 }
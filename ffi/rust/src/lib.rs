@@ -2,8 +2,10 @@
 #![allow(non_camel_case_types)]
 #![allow(non_snake_case)]
 
-use std::ffi::CString;
+use std::ffi::{CStr, CString};
+use std::marker::PhantomData;
 use std::os::raw::c_char;
+use std::os::unix::io::RawFd;
 use std::ptr;
 
 // Generate unsafe FFI bindings
@@ -20,6 +22,7 @@ pub enum Error {
     InvalidParam,
     OutOfMemory,
     Unknown,
+    Io(i32),
     FfiError(i32)
 }
 
@@ -29,6 +32,7 @@ impl From<i32> for Error {
             sys::PAL_FFI_ERR_INVALID_PARAM => Error::InvalidParam,
             sys::PAL_FFI_ERR_OUT_OF_MEMORY => Error::OutOfMemory,
             sys::PAL_FFI_ERR_UNKNOWN => Error::Unknown,
+            sys::PAL_FFI_ERR_IO => Error::Io(0),
             _ => Error::FfiError(err),
         }
     }
@@ -143,6 +147,17 @@ impl FtpServer {
     pub fn stop(&self) {
         unsafe { sys::pal_ffi_ftp_server_stop(self.handle) }
     }
+
+    /// All counters in one call, read straight into a `repr(C)` struct
+    pub fn stats(&self) -> Result<FtpStats> {
+        let mut out: FtpStats = unsafe { std::mem::zeroed() };
+        let res = unsafe { sys::pal_ffi_ftp_server_get_stats(self.handle, &mut out) };
+        if res == sys::PAL_FFI_OK as i32 {
+            Ok(out)
+        } else {
+            Err(Error::from(res))
+        }
+    }
 }
 
 impl Drop for FtpServer {
@@ -175,3 +190,179 @@ impl Drop for HttpServer {
         }
     }
 }
+
+/*===========================================================================*
+ * Flat views and batched operations
+ *===========================================================================*/
+
+pub type FtpStats = sys::pal_ffi_ftp_stats_t;
+pub type FileStat = sys::pal_ffi_stat_t;
+pub type DirEntry = sys::pal_ffi_dirent_t;
+pub type Completion = sys::pal_ffi_cqe_t;
+
+/// Directory listing held in one C block; entries and names are borrowed
+pub struct DirListing {
+    handle: *mut libc::c_void,
+    entries: *const DirEntry,
+    count: usize,
+}
+
+impl DirListing {
+    pub fn open(path: &str) -> Result<Self> {
+        let c_path = CString::new(path).map_err(|_| Error::InvalidParam)?;
+        let handle = unsafe { sys::pal_ffi_dir_open(c_path.as_ptr()) };
+        if handle.is_null() {
+            return Err(Error::Unknown);
+        }
+        let mut count: u32 = 0;
+        let entries = unsafe { sys::pal_ffi_dir_entries(handle, &mut count, ptr::null_mut()) };
+        Ok(Self { handle, entries, count: count as usize })
+    }
+
+    pub fn entries(&self) -> &[DirEntry] {
+        if self.count == 0 {
+            return &[];
+        }
+        unsafe { std::slice::from_raw_parts(self.entries, self.count) }
+    }
+
+    /// Name of entry `i`, without copying
+    pub fn name(&self, i: usize) -> &CStr {
+        let e = &self.entries()[i];
+        unsafe { CStr::from_ptr((self.entries as *const c_char).add(e.name_off as usize)) }
+    }
+}
+
+impl Drop for DirListing {
+    fn drop(&mut self) {
+        unsafe { sys::pal_ffi_dir_close(self.handle) }
+    }
+}
+
+/// One operation for `Queue::submit`.  It borrows the memory it names, so
+/// the buffers cannot move or be freed before the batch has run.
+#[repr(transparent)]
+pub struct Op<'a> {
+    raw: sys::pal_ffi_op_t,
+    _buf: PhantomData<&'a mut [u8]>,
+}
+
+impl<'a> Op<'a> {
+    fn new(opcode: u32, user_data: u64) -> Self {
+        let mut raw: sys::pal_ffi_op_t = unsafe { std::mem::zeroed() };
+        raw.opcode = opcode;
+        raw.fd = -1;
+        raw.user_data = user_data;
+        Self { raw, _buf: PhantomData }
+    }
+
+    pub fn nop(user_data: u64) -> Self {
+        Self::new(sys::PAL_FFI_OP_NOP, user_data)
+    }
+
+    pub fn read(fd: RawFd, buf: &'a mut [u8], offset: u64, user_data: u64) -> Self {
+        let mut op = Self::new(sys::PAL_FFI_OP_READ, user_data);
+        op.raw.fd = fd;
+        op.raw.addr = buf.as_mut_ptr() as u64;
+        op.raw.len = buf.len() as u64;
+        op.raw.offset = offset;
+        op
+    }
+
+    pub fn write(fd: RawFd, buf: &'a [u8], offset: u64, user_data: u64) -> Self {
+        let mut op = Self::new(sys::PAL_FFI_OP_WRITE, user_data);
+        op.raw.fd = fd;
+        op.raw.addr = buf.as_ptr() as u64;
+        op.raw.len = buf.len() as u64;
+        op.raw.offset = offset;
+        op
+    }
+
+    pub fn fsync(fd: RawFd, user_data: u64) -> Self {
+        let mut op = Self::new(sys::PAL_FFI_OP_FSYNC, user_data);
+        op.raw.fd = fd;
+        op
+    }
+
+    pub fn stat(path: &'a CStr, out: &'a mut FileStat, user_data: u64) -> Self {
+        let mut op = Self::new(sys::PAL_FFI_OP_STAT, user_data);
+        op.raw.path = path.as_ptr() as u64;
+        op.raw.addr = out as *mut FileStat as u64;
+        op.raw.len = std::mem::size_of::<FileStat>() as u64;
+        op
+    }
+
+    pub fn ftp_stats(server: &'a FtpServer, out: &'a mut FtpStats, user_data: u64) -> Self {
+        let mut op = Self::new(sys::PAL_FFI_OP_FTP_STATS, user_data);
+        op.raw.handle = server.handle as u64;
+        op.raw.addr = out as *mut FtpStats as u64;
+        op.raw.len = std::mem::size_of::<FtpStats>() as u64;
+        op
+    }
+}
+
+/// Completion value: bytes for READ/WRITE, 0 otherwise
+pub fn completion_result(c: &Completion) -> Result<u64> {
+    if c.result >= 0 {
+        Ok(c.result as u64)
+    } else if c.result == sys::PAL_FFI_ERR_IO as i64 {
+        Err(Error::Io(c.sys_errno))
+    } else {
+        Err(Error::from(c.result as i32))
+    }
+}
+
+/// Batched command/completion queue; one per thread
+pub struct Queue {
+    handle: *mut libc::c_void,
+}
+
+impl Queue {
+    pub fn new(depth: u32) -> Result<Self> {
+        let handle = unsafe { sys::pal_ffi_queue_create(depth) };
+        if handle.is_null() {
+            return Err(Error::InvalidParam);
+        }
+        Ok(Self { handle })
+    }
+
+    /// Run `ops` in order; returns how many ran before the queue filled up
+    pub fn submit(&mut self, ops: &[Op<'_>]) -> Result<usize> {
+        let count = u32::try_from(ops.len()).map_err(|_| Error::InvalidParam)?;
+        let res = unsafe {
+            sys::pal_ffi_queue_submit(self.handle, ops.as_ptr() as *const sys::pal_ffi_op_t, count)
+        };
+        if res >= 0 {
+            Ok(res as usize)
+        } else {
+            Err(Error::from(res))
+        }
+    }
+
+    /// Oldest pending completions, borrowed from the queue
+    pub fn completions(&self) -> &[Completion] {
+        let mut count: u32 = 0;
+        let first = unsafe { sys::pal_ffi_queue_peek(self.handle, &mut count) };
+        if first.is_null() {
+            return &[];
+        }
+        unsafe { std::slice::from_raw_parts(first, count as usize) }
+    }
+
+    pub fn advance(&mut self, n: usize) {
+        let n = u32::try_from(n).unwrap_or(u32::MAX);
+        unsafe { sys::pal_ffi_queue_advance(self.handle, n) }
+    }
+
+    /// Copy out and drop completions
+    pub fn reap(&mut self, out: &mut [Completion]) -> usize {
+        let max = u32::try_from(out.len()).unwrap_or(u32::MAX);
+        unsafe { sys::pal_ffi_queue_reap(self.handle, out.as_mut_ptr(), max) as usize }
+    }
+}
+
+impl Drop for Queue {
+    fn drop(&mut self) {
+        unsafe { sys::pal_ffi_queue_destroy(self.handle) }
+    }
+}
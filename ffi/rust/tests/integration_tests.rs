@@ -1,4 +1,7 @@
-use zftpd::{EventLoop, FtpServer, HttpServer, PalAlloc};
+use std::ffi::CString;
+use std::io::Write;
+use std::os::unix::io::AsRawFd;
+use zftpd::{completion_result, Completion, DirListing, FileStat, FtpServer, HttpServer, EventLoop, Op, PalAlloc, Queue};
 
 #[test]
 fn test_allocator() {
@@ -21,6 +24,7 @@ fn test_ftp_server() {
 
     let sessions = server.active_sessions();
     assert_eq!(sessions, 0);
+    assert_eq!(server.stats().unwrap().active_sessions, 0);
 
     server.stop();
     assert!(!server.is_running());
@@ -33,3 +37,42 @@ fn test_http_server() {
     let _http = HttpServer::new(&loop_ctx, 8888).expect("Failed to create HttpServer");
     // Handle dropped automatically.
 }
+
+#[test]
+fn test_queue_batch() {
+    let dir = std::env::temp_dir().join("zftpd-rust-ffi");
+    let _ = std::fs::create_dir_all(&dir);
+    let path = dir.join("data.bin");
+    let mut file = std::fs::File::create(&path).unwrap();
+    file.write_all(b"batched").unwrap();
+    let file = std::fs::File::open(&path).unwrap();
+
+    let mut queue = Queue::new(8).expect("Failed to create Queue");
+    let mut buf = [0u8; 16];
+    let mut st: FileStat = unsafe { std::mem::zeroed() };
+    let c_path = CString::new(path.to_str().unwrap()).unwrap();
+    {
+        let ops = [
+            Op::read(file.as_raw_fd(), &mut buf, 2, 1),
+            Op::stat(&c_path, &mut st, 2),
+            Op::nop(3),
+        ];
+        assert_eq!(queue.submit(&ops).unwrap(), 3);
+    }
+    assert_eq!(&buf[..5], b"tched");
+    assert_eq!(st.size, 7);
+
+    let done = queue.completions();
+    assert_eq!(done.len(), 3);
+    assert_eq!(completion_result(&done[0]).unwrap(), 5);
+    queue.advance(1);
+    let mut rest: [Completion; 4] = unsafe { std::mem::zeroed() };
+    assert_eq!(queue.reap(&mut rest), 2);
+    assert_eq!(rest[1].user_data, 3);
+
+    let listing = DirListing::open(dir.to_str().unwrap()).expect("Failed to list");
+    let names: Vec<_> = (0..listing.entries().len()).map(|i| listing.name(i).to_owned()).collect();
+    assert!(names.iter().any(|n| n.to_bytes() == b"data.bin"));
+
+    let _ = std::fs::remove_file(&path);
+}
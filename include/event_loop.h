@@ -31,6 +31,10 @@ SOFTWARE.
  * PLATFORMS: FreeBSD (PS4/PS5 kqueue), Linux (epoll)
  * DESIGN: Single-threaded, non-blocking I/O
  * 
+ * Both backends keep handlers in a table indexed by fd that grows on
+ * demand, so dispatch and registration are O(1) and the number of
+ * monitored fds is bounded only by the process fd limit.
+ * 
  */
 
 #ifndef EVENT_LOOP_H
@@ -49,6 +53,12 @@ typedef enum {
     EVENT_WRITE = 0x02,  /**< Socket ready for writing */
     EVENT_ERROR = 0x04,  /**< Socket error occurred */
     EVENT_CLOSE = 0x08,  /**< Connection closed */
+
+    /* Registration options, event_loop_add() / event_loop_modify() only */
+    EVENT_EDGE      = 0x10, /**< Edge-triggered (EPOLLET / EV_CLEAR)     */
+    EVENT_EXCLUSIVE = 0x20, /**< Wake one loop per event when several
+                                 loops watch the fd (EPOLLEXCLUSIVE);
+                                 kqueue ignores it                      */
 } event_type_t;
 
 /**
@@ -64,6 +74,16 @@ typedef enum {
  */
 typedef int (*event_callback_t)(int fd, uint32_t events, void *data);
 
+/**
+ * @brief Periodic callback run by event_loop_run()
+ *
+ * Invoked after every wait round, i.e. at least once a second even when
+ * no fd is ready.  Used for housekeeping such as idle-connection reaping.
+ *
+ * @note Thread-safety: Called from event loop thread only
+ */
+typedef void (*event_tick_t)(void *data);
+
 /**
  * @brief Create event loop
  * 
@@ -82,7 +102,8 @@ event_loop_t* event_loop_create(void);
  * 
  * @param loop     Event loop instance
  * @param fd       File descriptor to monitor
- * @param events   Events to monitor (EVENT_READ | EVENT_WRITE)
+ * @param events   Events to monitor (EVENT_READ | EVENT_WRITE), plus
+ *                 optional EVENT_EDGE / EVENT_EXCLUSIVE
  * @param callback Function to call when event occurs
  * @param data     User context passed to callback
  * 
@@ -101,9 +122,11 @@ int event_loop_add(event_loop_t *loop, int fd, uint32_t events,
  * 
  * @param loop   Event loop instance
  * @param fd     File descriptor
- * @param events New event mask
+ * @param events New event mask; events left out stop being reported
  * 
  * @return 0 on success, negative on error
+ *
+ * @note EVENT_EXCLUSIVE only takes effect when the fd is first added
  */
 int event_loop_modify(event_loop_t *loop, int fd, uint32_t events);
 
@@ -117,6 +140,15 @@ int event_loop_modify(event_loop_t *loop, int fd, uint32_t events);
  */
 int event_loop_remove(event_loop_t *loop, int fd);
 
+/**
+ * @brief Install (or clear, with NULL) the periodic tick callback
+ *
+ * @param loop Event loop instance
+ * @param tick Callback, or NULL
+ * @param data User context passed to tick
+ */
+void event_loop_set_tick(event_loop_t *loop, event_tick_t tick, void *data);
+
 /**
  * @brief Run event loop (blocking)
  * 
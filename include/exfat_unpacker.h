@@ -107,6 +107,16 @@ extern "C" {
 /* I/O chunk size for file extraction (avoids per-cluster malloc) */
 #define EXFAT_IO_CHUNK_SIZE         (256U * 1024U)  /* 256 KiB */
 
+/*
+ * FAT cache.  The FAT is read on demand in EXFAT_FAT_PAGE_SIZE pages and at
+ * most EXFAT_FAT_CACHE_PAGES are resident, least recently used evicted
+ * first.  A 2 TB image with 4 KiB clusters has a 2 GiB FAT; the cache
+ * stays at 1 MiB, and a sequential chain misses once per 16384 clusters.
+ */
+#define EXFAT_FAT_PAGE_SIZE         (64U * 1024U)   /* 64 KiB */
+#define EXFAT_FAT_PAGE_ENTRIES      (EXFAT_FAT_PAGE_SIZE / 4U)
+#define EXFAT_FAT_CACHE_PAGES       16U
+
 /* ── Boot Sector (512 bytes, Microsoft exFAT spec §3.1) ─────────────────── */
 /*
  * Accurate field layout with correct offsets.  Previously volume_flags was
@@ -264,6 +274,14 @@ typedef char exfat_filename_entry_size_check[
 
 /* ── Main context ───────────────────────────────────────────────────────── */
 
+/* One resident FAT page */
+typedef struct {
+    uint32_t *entries;   /* EXFAT_FAT_PAGE_ENTRIES; NULL until first used */
+    uint32_t  page;      /* page number held, valid when entries != NULL */
+    uint32_t  count;     /* valid entries (the last page may be short)   */
+    uint32_t  last_use;  /* fat_clock at the most recent lookup         */
+} exfat_fat_page_t;
+
 typedef struct {
     FILE    *image_file;              /* open for reading; owned by context */
     exfat_boot_sector_t boot_sector;
@@ -271,8 +289,11 @@ typedef struct {
     uint32_t sectors_per_cluster;
     uint32_t bytes_per_cluster;
     uint64_t cluster_heap_offset_bytes; /* absolute byte offset in image */
-    uint32_t *fat_table;
+    uint64_t fat_offset_bytes;          /* absolute byte offset of the FAT */
     size_t    fat_entries;
+    exfat_fat_page_t fat_cache[EXFAT_FAT_CACHE_PAGES];
+    uint32_t  fat_clock;                /* lookup counter for the LRU */
+    uint32_t  fat_hot;                  /* slot of the last hit */
 } exfat_context_t;
 
 /* ── Parsed file/directory descriptor ──────────────────────────────────── */
@@ -300,9 +321,9 @@ int  exfat_read_boot_sector(exfat_context_t *ctx);
 int  exfat_validate_boot_sector(const exfat_boot_sector_t *boot);
 void exfat_print_boot_sector(const exfat_boot_sector_t *boot);
 
-/* FAT */
+/* FAT: exfat_read_fat() validates the geometry; pages load on lookup */
 int      exfat_read_fat(exfat_context_t *ctx);
-uint32_t exfat_get_next_cluster(const exfat_context_t *ctx, uint32_t cluster);
+uint32_t exfat_get_next_cluster(exfat_context_t *ctx, uint32_t cluster);
 void     exfat_free_fat(exfat_context_t *ctx);
 
 /* Cluster I/O */
@@ -318,6 +339,14 @@ int exfat_parse_file_entry(const uint8_t *data, size_t offset, size_t data_len,
 int exfat_utf16_to_utf8(const uint16_t *utf16, int nchars,
                          char *utf8, size_t utf8_size);
 
+/*
+ * Extents: clusters in [*cluster, *cluster + return) hold the next bytes
+ * of the file, at most `want` of them; *cluster moves past the extent.
+ * Returns 0 at the end of the chain or the heap.
+ */
+uint64_t exfat_next_extent(exfat_context_t *ctx, const exfat_file_info_t *info,
+                           uint32_t *cluster, uint64_t want);
+
 /* File extraction */
 int     exfat_extract_file(exfat_context_t *ctx, const exfat_file_info_t *info,
                             const char *output_path);
@@ -22,13 +22,67 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+/**
+ * @file ftp_buffer_pool.h
+ * @brief Tiered stream buffer pool
+ *
+ * Three size classes, each one lazily created anonymous mapping with a
+ * lock-free free list, fronted by a per-thread magazine:
+ *
+ *   acquire ──► thread magazine ──► class free list ──► (next class up)
+ *   release ──► thread magazine ──► class free list
+ *
+ * ftp_buffer_acquire() keeps its old contract: one FTP_STREAM_BUFFER_SIZE
+ * buffer or NULL when the stream class is exhausted.
+ */
+
 #ifndef FTP_BUFFER_POOL_H
 #define FTP_BUFFER_POOL_H
 
 #include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  FTP_BUFFER_SMALL = 0,  /**< FTP_BUFFER_SMALL_SIZE  (listings)   */
+  FTP_BUFFER_STREAM = 1, /**< FTP_STREAM_BUFFER_SIZE (transfers)  */
+  FTP_BUFFER_LARGE = 2,  /**< FTP_BUFFER_LARGE_SIZE  (bulk copies) */
+  FTP_BUFFER_CLASSES = 3,
+} ftp_buffer_class_t;
 
+/** Per-class occupancy (ftp_buffer_get_stats) */
+typedef struct {
+  size_t size;         /**< Buffer size in bytes                     */
+  uint32_t count;      /**< Buffers in the class                     */
+  uint32_t in_use;     /**< Held by callers (not cached in magazines) */
+  uint32_t high_water; /**< Peak in_use                              */
+  uint32_t mapped;     /**< Backing mapping exists                   */
+  uint32_t huge;       /**< Mapping uses huge pages / superpages     */
+  uint64_t acquires;   /**< Successful acquisitions                  */
+  uint64_t waits;      /**< Requests that found the class exhausted  */
+} ftp_buffer_class_stats_t;
+
+/** One FTP_STREAM_BUFFER_SIZE buffer, NULL when all are taken */
 void *ftp_buffer_acquire(void);
+
+/**
+ * @brief Smallest buffer of at least @p want bytes
+ *
+ * Falls back to the next larger class when the best fit is exhausted.
+ *
+ * @param want     Minimum size
+ * @param size_out Actual buffer size (may be NULL)
+ *
+ * @return Buffer, or NULL if no class can serve the request
+ */
+void *ftp_buffer_acquire_size(size_t want, size_t *size_out);
+
+/** Return a buffer from either acquire function (NULL is ignored) */
 void ftp_buffer_release(void *buffer);
+
+/** Size of ftp_buffer_acquire() buffers (FTP_STREAM_BUFFER_SIZE) */
 size_t ftp_buffer_size(void);
 
+/** Snapshot all classes, indexed by ftp_buffer_class_t */
+void ftp_buffer_get_stats(ftp_buffer_class_stats_t out[FTP_BUFFER_CLASSES]);
+
 #endif
@@ -0,0 +1,154 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_bwsched.h
+ * @brief Server-wide bandwidth scheduler (global / per-IP / per-session)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Three levels of token buckets; a transfer may move a byte only when
+ * every level with a non-zero rate has a token for it:
+ *
+ *   ┌──────────────────────── global ────────────────────────┐
+ *   │  ┌──── IP 10.0.0.5 ────┐      ┌──── IP 10.0.0.9 ────┐  │
+ *   │  │ session 3  session 4 │      │ session 7           │  │
+ *   │  └──────────────────────┘      └─────────────────────┘  │
+ *   └─────────────────────────────────────────────────────────┘
+ *
+ * Rates change at runtime (SITE BWLIMIT, /api/bwlimit); 0 = unlimited.
+ *
+ * Throttling sizes transfers instead of pausing them: ftp_bw_grant()
+ * returns how many bytes the caller may move now, so the RETR loop
+ * hands that much to one sendfile() and keeps the zero-copy path.  A
+ * grant never exceeds the level's burst divided among the sessions
+ * sharing it, so a bulk download drains the buckets in small slices
+ * and an interactive session waiting on the same bucket gets the next
+ * slice instead of queueing behind a whole buffer.
+ *
+ * THREAD SAFETY: all functions may be called from any thread; a client
+ * belongs to one session thread.
+ */
+
+#ifndef FTP_BWSCHED_H
+#define FTP_BWSCHED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Bucket level */
+typedef enum {
+  FTP_BW_GLOBAL = 0, /**< Whole server                        */
+  FTP_BW_PER_IP,     /**< Each client address                 */
+  FTP_BW_SESSION,    /**< Each control connection             */
+  FTP_BW_SCOPES
+} ftp_bw_scope_t;
+
+/** Token bucket */
+typedef struct {
+  uint64_t tokens;  /**< Bytes that may be moved now             */
+  uint64_t last_ns; /**< Last refill (monotonic ns, 0 = never)   */
+} ftp_bw_bucket_t;
+
+/** One session's view of the scheduler (embedded in ftp_session_t) */
+typedef struct {
+  ftp_bw_bucket_t own; /**< Session bucket                      */
+  uint32_t ip;         /**< Client IPv4 (network order)         */
+  int ip_slot;         /**< Per-IP bucket index, -1 = none       */
+  int attached;        /**< Counted in the global client set     */
+} ftp_bw_client_t;
+
+/** Scheduler counters (ftp_bw_get_stats) */
+typedef struct {
+  uint64_t rate[FTP_BW_SCOPES]; /**< Configured bytes/sec, 0 = off      */
+  uint32_t clients;             /**< Attached sessions                  */
+  uint32_t ips;                 /**< Client addresses with a bucket     */
+  uint64_t granted_bytes;       /**< Bytes handed out while limited     */
+  uint64_t waits;               /**< Grants that had to sleep           */
+  uint64_t wait_ns;             /**< Total time spent sleeping          */
+} ftp_bw_stats_t;
+
+/**
+ * @brief Register a session with the scheduler
+ *
+ * @param ip Client IPv4 address (network order); sessions from the same
+ *           address share a per-IP bucket.  When the per-IP table is full
+ *           the session runs without one.
+ */
+void ftp_bw_attach(ftp_bw_client_t *c, uint32_t ip);
+
+/** @brief Unregister (no-op if never attached) */
+void ftp_bw_detach(ftp_bw_client_t *c);
+
+/** @brief Set the rate of one level (bytes/sec, 0 = unlimited) */
+void ftp_bw_set_rate(ftp_bw_scope_t scope, uint64_t bps);
+
+/** @brief Current rate of one level */
+uint64_t ftp_bw_get_rate(ftp_bw_scope_t scope);
+
+/**
+ * @brief Nonzero if any level is limited
+ *
+ * Kernel-side engines (splice, io_uring) cannot be metered per call,
+ * so transfers use sendfile or the userspace loops while this holds.
+ */
+int ftp_bw_limited(void);
+
+/**
+ * @brief Bytes the caller may move now
+ *
+ * Sleeps (in slices of at most 100 ms) until at least
+ * min(@p want, fair slice) tokens are free on every limited level, then
+ * takes them.  Returns @p want unchanged when nothing is limited.
+ *
+ * @return 1..want bytes granted (0 only if @p want is 0)
+ */
+size_t ftp_bw_grant(ftp_bw_client_t *c, size_t want);
+
+/** @brief Give back the part of a grant that was not sent */
+void ftp_bw_refund(ftp_bw_client_t *c, size_t granted, size_t used);
+
+/**
+ * @brief Take tokens for @p bytes, grant by grant (blocking)
+ *
+ * For buffers that must go out whole (send) or have already arrived
+ * (recv): the wait is split into fair slices like ftp_bw_grant().
+ */
+void ftp_bw_consume(ftp_bw_client_t *c, size_t bytes);
+
+/** @brief Snapshot of rates and counters */
+void ftp_bw_get_stats(ftp_bw_stats_t *out);
+
+/**
+ * @brief Parse a rate: "0", "off", "500000", "512K", "20M", "1G"
+ *
+ * @return 0 on success, -1 on syntax error or overflow
+ */
+int ftp_bw_parse_rate(const char *text, uint64_t *out);
+
+/** @brief Scope name ("global", "ip", "session") */
+const char *ftp_bw_scope_name(ftp_bw_scope_t scope);
+
+#endif /* FTP_BWSCHED_H */
@@ -211,6 +211,16 @@ ftp_error_t cmd_APPE(ftp_session_t *session, const char *args);
  */
 ftp_error_t cmd_REST(ftp_session_t *session, const char *args);
 
+/**
+ * @brief ALLO command - Announce the size of the next STOR
+ *
+ * @param session Client session
+ * @param args    Byte count, optionally followed by "R <record size>"
+ *
+ * @return FTP_OK on success, negative error code on failure
+ */
+ftp_error_t cmd_ALLO(ftp_session_t *session, const char *args);
+
 /*===========================================================================*
  * FILE MANAGEMENT
  *===========================================================================*/
@@ -387,6 +397,35 @@ ftp_error_t cmd_SIZE(ftp_session_t *session, const char *args);
  */
 ftp_error_t cmd_MDTM(ftp_session_t *session, const char *args);
 
+#if FTP_ENABLE_HASH
+/**
+ * @brief HASH command - File digest (draft-bryan-ftpext-hash)
+ *
+ * Reply: 213 <algo> 0-<size> <hex> <path>, algorithm from OPTS HASH.
+ *
+ * @param session Client session
+ * @param args    File path
+ *
+ * @return FTP_OK on success, negative error code on failure
+ */
+ftp_error_t cmd_HASH(ftp_session_t *session, const char *args);
+
+/**
+ * @brief XCRC / XMD5 / XSHA1 / XSHA256 - Legacy digest commands
+ *
+ * Reply: 250 <hex>
+ *
+ * @param session Client session
+ * @param args    File path
+ *
+ * @return FTP_OK on success, negative error code on failure
+ */
+ftp_error_t cmd_XCRC(ftp_session_t *session, const char *args);
+ftp_error_t cmd_XMD5(ftp_session_t *session, const char *args);
+ftp_error_t cmd_XSHA1(ftp_session_t *session, const char *args);
+ftp_error_t cmd_XSHA256(ftp_session_t *session, const char *args);
+#endif /* FTP_ENABLE_HASH */
+
 /**
  * @brief STAT command - Return status
  *
@@ -470,21 +509,48 @@ ftp_error_t cmd_MODE(ftp_session_t *session, const char *args);
 ftp_error_t cmd_STRU(ftp_session_t *session, const char *args);
 
 /*===========================================================================*
- * ENCRYPTION (ChaCha20)
+ * ENCRYPTION (ChaCha20, FTPS)
  *===========================================================================*/
 
-#if FTP_ENABLE_CRYPTO
+#if FTP_ENABLE_CRYPTO || FTP_ENABLE_TLS
 /**
  * @brief AUTH command - Negotiate encryption
  *
- * Supports: AUTH XCRYPT (ChaCha20 stream cipher)
+ * Supports: AUTH XCRYPT (ChaCha20 stream cipher, FTP_ENABLE_CRYPTO)
+ *           AUTH TLS / TLS-C / SSL (RFC 4217, FTP_ENABLE_TLS)
  *
  * @param session Client session
- * @param args    Auth mechanism ("XCRYPT")
+ * @param args    Auth mechanism
  *
  * @return FTP_OK on success, negative error code on failure
  */
 ftp_error_t cmd_AUTH(ftp_session_t *session, const char *args);
-#endif /* FTP_ENABLE_CRYPTO */
+#endif /* FTP_ENABLE_CRYPTO || FTP_ENABLE_TLS */
+
+#if FTP_ENABLE_TLS
+/**
+ * @brief PBSZ command - Protection buffer size (RFC 4217 §9)
+ *
+ * Only "0" is meaningful for TLS; any value is answered with PBSZ=0.
+ *
+ * @param session Client session
+ * @param args    Buffer size
+ *
+ * @return FTP_OK on success, negative error code on failure
+ */
+ftp_error_t cmd_PBSZ(ftp_session_t *session, const char *args);
+
+/**
+ * @brief PROT command - Data channel protection level
+ *
+ * Supports: C (clear), P (private). S and E are refused with 536.
+ *
+ * @param session Client session
+ * @param args    Protection level
+ *
+ * @return FTP_OK on success, negative error code on failure
+ */
+ftp_error_t cmd_PROT(ftp_session_t *session, const char *args);
+#endif /* FTP_ENABLE_TLS */
 
 #endif /* FTP_COMMANDS_H */
@@ -78,6 +78,47 @@ SOFTWARE.
 #define FTP_STREAM_BUFFER_COUNT FTP_MAX_SESSIONS
 #endif
 
+/**
+ * Buffer pool size classes (ftp_buffer_pool.h)
+ *
+ *   small   FTP_BUFFER_SMALL_SIZE  x FTP_BUFFER_SMALL_COUNT   listings
+ *   stream  FTP_STREAM_BUFFER_SIZE x FTP_STREAM_BUFFER_COUNT  transfers
+ *   large   FTP_BUFFER_LARGE_SIZE  x FTP_BUFFER_LARGE_COUNT   bulk copies
+ *
+ * Each class is one anonymous mapping created on first use, so a class
+ * nobody asks for costs no memory.  FTP_BUFFER_MAGAZINE buffers per class
+ * are cached per thread; FTP_BUFFER_HUGEPAGES asks for MAP_HUGETLB
+ * (Linux) or superpage-aligned (FreeBSD) mappings and silently falls
+ * back to normal pages.
+ */
+#ifndef FTP_BUFFER_SMALL_SIZE
+#define FTP_BUFFER_SMALL_SIZE 65536U
+#endif
+
+#ifndef FTP_BUFFER_SMALL_COUNT
+#define FTP_BUFFER_SMALL_COUNT FTP_MAX_SESSIONS
+#endif
+
+#ifndef FTP_BUFFER_LARGE_SIZE
+#define FTP_BUFFER_LARGE_SIZE 4194304U
+#endif
+
+#ifndef FTP_BUFFER_LARGE_COUNT
+#if defined(PS4) || defined(PLATFORM_PS4)
+#define FTP_BUFFER_LARGE_COUNT 2U
+#else
+#define FTP_BUFFER_LARGE_COUNT 4U
+#endif
+#endif
+
+#ifndef FTP_BUFFER_MAGAZINE
+#define FTP_BUFFER_MAGAZINE 1U
+#endif
+
+#ifndef FTP_BUFFER_HUGEPAGES
+#define FTP_BUFFER_HUGEPAGES 0
+#endif
+
 /**
  * Maximum number of concurrent client connections
  * @note This is a hard limit to prevent resource exhaustion
@@ -129,6 +170,59 @@ SOFTWARE.
 #define FTP_DATA_CONNECT_TIMEOUT_MS 15000U
 #endif
 
+/**
+ * Passive listener pool (ftp_pasv_pool.h)
+ *
+ *   FTP_PASV_POOL_SIZE  listeners kept open between transfers; PASV/EPSV
+ *                       lease one instead of socket/bind/listen per
+ *                       data connection.  0 = open a listener per PASV.
+ *   FTP_PASV_PORT_MIN   passive port range for pooled listeners (for
+ *   FTP_PASV_PORT_MAX   firewalls / port forwarding); 0 = any port.
+ *   FTP_PASV_PEER_CHECK only accept data connections from the control
+ *                       connection's peer address (anti data theft).
+ */
+#ifndef FTP_PASV_POOL_SIZE
+#define FTP_PASV_POOL_SIZE FTP_MAX_SESSIONS
+#endif
+
+#ifndef FTP_PASV_PORT_MIN
+#define FTP_PASV_PORT_MIN 0U
+#endif
+
+#ifndef FTP_PASV_PORT_MAX
+#define FTP_PASV_PORT_MAX 0U
+#endif
+
+#ifndef FTP_PASV_PEER_CHECK
+#define FTP_PASV_PEER_CHECK 1
+#endif
+
+/**
+ * FXP server-to-server transfers (ftp_fxp.h)
+ *
+ *   FTP_FXP_ALLOW      hosts that may be a PORT target other than the
+ *                      client, and may connect to a passive listener in
+ *                      its place ("192.168.1.20,10.0.0.0/24"); "" = no
+ *                      FXP.  SITE FXP shows it; clients cannot change it.
+ *   FTP_FXP_ALLOW_MAX  entries the list holds.
+ *   FTP_FXP_PREFIX_MIN shortest CIDR prefix accepted: wider blocks (and
+ *                      /0) would hand bounce access to whole networks.
+ */
+#ifndef FTP_FXP_ALLOW
+#define FTP_FXP_ALLOW ""
+#endif
+
+#ifndef FTP_FXP_ALLOW_MAX
+#define FTP_FXP_ALLOW_MAX 16U
+#endif
+
+#ifndef FTP_FXP_PREFIX_MIN
+#define FTP_FXP_PREFIX_MIN 16U
+#endif
+
+_Static_assert((FTP_FXP_PREFIX_MIN >= 1U) && (FTP_FXP_PREFIX_MIN <= 32U),
+               "FTP_FXP_PREFIX_MIN must be in [1, 32]");
+
 /**
  * Listen backlog for accept queue
  * @note Number of pending connections before refusing new ones
@@ -137,6 +231,69 @@ SOFTWARE.
 #define FTP_LISTEN_BACKLOG 8U
 #endif
 
+/**
+ * Control-port acceptors
+ *
+ *   FTP_ACCEPT_THREADS   1 = one accept thread that starts sessions
+ *                        inline (classic).  K > 1 = K acceptor threads,
+ *                        each on its own SO_REUSEPORT listener, feeding a
+ *                        session-start queue served by one starter thread;
+ *                        the kernel spreads incoming SYNs across the K
+ *                        accept queues.  Runtime: ftp_server_set_acceptors().
+ *   FTP_ACCEPT_QUEUE     start-queue depth; a full queue makes the acceptor
+ *                        start the session itself (backpressure).
+ *
+ *   The backlog is runtime-configurable too: ftp_server_set_listen_backlog().
+ */
+#ifndef FTP_ACCEPT_THREADS
+#define FTP_ACCEPT_THREADS 1U
+#endif
+
+#ifndef FTP_ACCEPT_THREADS_MAX
+#define FTP_ACCEPT_THREADS_MAX 8U
+#endif
+
+#ifndef FTP_ACCEPT_QUEUE
+#define FTP_ACCEPT_QUEUE 64U
+#endif
+
+_Static_assert((FTP_ACCEPT_THREADS >= 1) &&
+                   (FTP_ACCEPT_THREADS <= FTP_ACCEPT_THREADS_MAX),
+               "FTP_ACCEPT_THREADS must be in [1, FTP_ACCEPT_THREADS_MAX]");
+
+/**
+ * Restart hand-off (see ftp_handoff.h)
+ *
+ *   FTP_HANDOFF_PATH     UNIX socket a running instance offers its
+ *                        listeners on ("" = no hand-off); its directory
+ *                        must be private to the server's user (0700)
+ *   FTP_HANDOFF_FDS_MAX  listeners passed in one message (control port,
+ *                        idle passive listeners, web server)
+ *   FTP_HANDOFF_WAIT_MS  how long the old process waits for the new one
+ *                        to confirm it is accepting
+ *   FTP_HANDOFF_DRAIN_S  how long the old process keeps serving its open
+ *                        sessions before the normal shutdown ends them
+ */
+#ifndef FTP_HANDOFF_PATH
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_HANDOFF_PATH "/data/zftpd/run/handoff.sock"
+#else
+#define FTP_HANDOFF_PATH "/tmp/zftpd-run/handoff.sock"
+#endif
+#endif
+
+#ifndef FTP_HANDOFF_FDS_MAX
+#define FTP_HANDOFF_FDS_MAX 64U
+#endif
+
+#ifndef FTP_HANDOFF_WAIT_MS
+#define FTP_HANDOFF_WAIT_MS 10000U
+#endif
+
+#ifndef FTP_HANDOFF_DRAIN_S
+#define FTP_HANDOFF_DRAIN_S 300U
+#endif
+
 /*===========================================================================*
  * BUFFER SIZES
  *===========================================================================*/
@@ -227,6 +384,63 @@ SOFTWARE.
 #define FTP_MAX_SYMLINK_DEPTH 8U
 #endif
 
+/**
+ * Per-session path resolution cache
+ *
+ * The last FTP_PATH_CACHE_ENTRIES ftp_path_resolve() results of a
+ * session, keyed by the argument as sent (up to FTP_PATH_CACHE_KEY_MAX
+ * bytes), so SIZE/MDTM/RETR on the same name resolve once.  CWD clears
+ * the cache, any namespace change made through the server (the same
+ * calls that drop listing cache entries) invalidates every session's
+ * entries, and FTP_PATH_CACHE_TTL_MS bounds staleness for changes made
+ * by other processes.  0 entries disables it.
+ */
+#ifndef FTP_PATH_CACHE_ENTRIES
+#define FTP_PATH_CACHE_ENTRIES 4U
+#endif
+
+#ifndef FTP_PATH_CACHE_KEY_MAX
+#define FTP_PATH_CACHE_KEY_MAX 256U
+#endif
+
+#ifndef FTP_PATH_CACHE_TTL_MS
+#define FTP_PATH_CACHE_TTL_MS 2000U
+#endif
+
+/**
+ * Shared file metadata cache (ftp_stat_cache.h)
+ *
+ * path -> vfs_stat_t for SIZE, MDTM, MLST and RETR, across sessions,
+ * also filled by the stat that path resolution already does, so the
+ * usual SIZE + MDTM + RETR of one file costs one stat.  Changes made
+ * through the server drop the path, its parent and everything below it
+ * (together with the listing cache); FTP_STAT_CACHE_TTL_MS bounds
+ * staleness for changes made by other processes.  0 entries disables it.
+ */
+#ifndef FTP_STAT_CACHE_ENTRIES
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_STAT_CACHE_ENTRIES 256U
+#else
+#define FTP_STAT_CACHE_ENTRIES 1024U
+#endif
+#endif
+
+#ifndef FTP_STAT_CACHE_SHARDS
+#define FTP_STAT_CACHE_SHARDS 16U
+#endif
+
+#ifndef FTP_STAT_CACHE_KEY_MAX
+#define FTP_STAT_CACHE_KEY_MAX 512U
+#endif
+
+#ifndef FTP_STAT_CACHE_TTL_MS
+#define FTP_STAT_CACHE_TTL_MS 2000U
+#endif
+
+_Static_assert((FTP_STAT_CACHE_SHARDS > 0U) &&
+                   ((FTP_STAT_CACHE_ENTRIES % FTP_STAT_CACHE_SHARDS) == 0U),
+               "stat cache entries must split evenly across shards");
+
 /*===========================================================================*
  * FEATURE FLAGS
  *===========================================================================*/
@@ -275,6 +489,96 @@ SOFTWARE.
 #define FTP_ENABLE_REST 1
 #endif
 
+/**
+ * Enable HASH / XCRC / XMD5 / XSHA1 / XSHA256
+ * @note Server-side digests (draft-bryan-ftpext-hash); OPTS HASH selects
+ *       the HASH algorithm (default SHA-256)
+ */
+#ifndef FTP_ENABLE_HASH
+#define FTP_ENABLE_HASH 1
+#endif
+
+/**
+ * Hardware digest kernels
+ *
+ *   1 = SHA-256 via SHA-NI (CPUID-detected; always on PS5, never on PS4),
+ *       CRC-32 via ARMv8 CRC32 instructions when compiled for them.
+ *   0 = portable kernels only (CRC-32 slicing-by-8).
+ */
+#ifndef FTP_HASH_SIMD
+#define FTP_HASH_SIMD 1
+#endif
+
+/** Read size of the hashing pipeline (bytes per pal_ring buffer) */
+#ifndef FTP_HASH_READ_CHUNK
+#define FTP_HASH_READ_CHUNK (256U * 1024U)
+#endif
+
+/** Growth limit of the hashing read-ahead ring */
+#ifndef FTP_HASH_RING_MAX_DEPTH
+#define FTP_HASH_RING_MAX_DEPTH 4U
+#endif
+
+/** Digests remembered by (path, size, mtime) */
+#ifndef FTP_HASH_CACHE_SLOTS
+#define FTP_HASH_CACHE_SLOTS 64U
+#endif
+
+/**
+ * On-disk digest index ("" = keep it in memory only)
+ * @note Rewritten through a .tmp file + rename on every new digest
+ */
+#ifndef FTP_HASH_CACHE_PATH
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_HASH_CACHE_PATH "/data/zftpd/hash.idx"
+#else
+#define FTP_HASH_CACHE_PATH "/tmp/zftpd-hash.idx"
+#endif
+#endif
+
+/**
+ * Digest uploads while they are received
+ *
+ *   1 = once a client has chosen an algorithm with OPTS HASH, a fresh
+ *       STOR hashes the incoming bytes inline and stores the digest, so
+ *       HASH right after the upload needs no extra read pass.  Such
+ *       uploads skip the splice/io_uring engines.
+ *   0 = digests are only computed on request.
+ */
+#ifndef FTP_HASH_INLINE_STOR
+#define FTP_HASH_INLINE_STOR 1
+#endif
+
+/**
+ * SITE DELTA (ftp_delta.h)
+ *
+ *   FTP_DELTA_BLOCK_MIN/MAX  block size range; the size grows with the
+ *                            file (~sqrt).  MAX must not exceed
+ *                            FTP_STREAM_BUFFER_SIZE.
+ *   FTP_DELTA_SIG_DIR        cached signatures, next to the digest index
+ *                            ("" = never cache)
+ *   FTP_DELTA_SIG_CACHE_MIN  smaller files are signed on every request
+ */
+#ifndef FTP_DELTA_BLOCK_MIN
+#define FTP_DELTA_BLOCK_MIN 2048U
+#endif
+
+#ifndef FTP_DELTA_BLOCK_MAX
+#define FTP_DELTA_BLOCK_MAX (256U * 1024U)
+#endif
+
+#ifndef FTP_DELTA_SIG_DIR
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_DELTA_SIG_DIR "/data/zftpd/sig"
+#else
+#define FTP_DELTA_SIG_DIR "/tmp/zftpd-sig"
+#endif
+#endif
+
+#ifndef FTP_DELTA_SIG_CACHE_MIN
+#define FTP_DELTA_SIG_CACHE_MIN (64ULL * 1024ULL * 1024ULL)
+#endif
+
 /**
  * Enable ChaCha20 stream encryption (AUTH XCRYPT)
  *
@@ -293,6 +597,94 @@ SOFTWARE.
 #endif
 #endif
 
+/**
+ * FTPS: AUTH TLS / PBSZ / PROT (RFC 4217)
+ *
+ *   1 = control and data channels can be upgraded to TLS (pal_tls).
+ *       Set by the Makefile when OpenSSL is available (ENABLE_TLS=1);
+ *       a certificate must be supplied at startup (-c / -k).
+ *   0 = AUTH TLS answered with 504.
+ */
+#ifndef FTP_ENABLE_TLS
+#define FTP_ENABLE_TLS 0
+#endif
+
+/**
+ * Kernel TLS offload for FTPS data connections
+ *
+ *   1 = after the handshake the record layer moves into the kernel when
+ *       it supports the cipher (Linux tls ULP, FreeBSD KERN_TLS).  RETR
+ *       then keeps using sendfile() under PROT P.
+ *   0 = userspace TLS only; PROT P transfers use the buffered loops.
+ */
+#ifndef FTP_TLS_KTLS
+#define FTP_TLS_KTLS 1
+#endif
+
+/**
+ * MODE Z: deflate-compressed data connections
+ *
+ *   1 = MODE Z accepted; LIST/NLST/MLSD/RETR output is deflated and
+ *       STOR/APPE input inflated (ftp_zstream).  Set by the Makefile when
+ *       zlib is available (ENABLE_MODEZ=1).
+ *   0 = MODE Z answered with 504.
+ *
+ * @note MODE Z transfers never use sendfile/splice/io_uring.
+ */
+#ifndef FTP_ENABLE_MODEZ
+#define FTP_ENABLE_MODEZ 0
+#endif
+
+/** Initial deflate level of a MODE Z stream (the controller moves it) */
+#ifndef FTP_MODEZ_LEVEL
+#define FTP_MODEZ_LEVEL 6
+#endif
+
+/** Level range used while link/CPU adaptation is active (0 = stored) */
+#ifndef FTP_MODEZ_LEVEL_MIN
+#define FTP_MODEZ_LEVEL_MIN 1
+#endif
+#ifndef FTP_MODEZ_LEVEL_MAX
+#define FTP_MODEZ_LEVEL_MAX 9
+#endif
+
+/** Uncompressed bytes per adaptation window */
+#ifndef FTP_MODEZ_WINDOW_BYTES
+#define FTP_MODEZ_WINDOW_BYTES (1024U * 1024U)
+#endif
+
+/**
+ * Output/input ratio (percent) at which a window counts as
+ * incompressible; the stream then switches to stored blocks (level 0)
+ */
+#ifndef FTP_MODEZ_STORED_PCT
+#define FTP_MODEZ_STORED_PCT 95U
+#endif
+
+/** Stored windows before level 1 is probed again */
+#ifndef FTP_MODEZ_PROBE_WINDOWS
+#define FTP_MODEZ_PROBE_WINDOWS 16U
+#endif
+
+/** Per-stream staging buffer (compressed side) */
+#ifndef FTP_MODEZ_BUF_SIZE
+#define FTP_MODEZ_BUF_SIZE (64U * 1024U)
+#endif
+
+/**
+ * SIMD ChaCha20 keystream kernels
+ *
+ *   1 = ftp_crypto_xor() computes 4 (SSE2/NEON) or 8 (AVX2) blocks per
+ *       step for whole 256/512-byte runs; AVX2 is picked via CPUID on
+ *       generic x86-64, at compile time on PS5 (Zen2) / PS4 (SSE2 only).
+ *   0 = scalar block function only.
+ *
+ *   Output is bit-identical either way.
+ */
+#ifndef FTP_CRYPTO_SIMD
+#define FTP_CRYPTO_SIMD 1
+#endif
+
 /**
  * Pre-shared key for ChaCha20 encryption (256-bit / 32 bytes)
  *
@@ -320,6 +712,165 @@ SOFTWARE.
 #endif
 #endif
 
+/**
+ * Directory listing cache
+ *
+ * Stat results (and formatted LIST/NLST/MLSD blobs) of recently listed
+ * directories, shared by all sessions.  An entry is reused while the
+ * directory's mtime/inode are unchanged and it is younger than
+ * FTP_LIST_CACHE_TTL_S; STOR/APPE/DELE/MKD/RMD/RNTO/SITE CHMOD drop the
+ * affected entries immediately.  The TTL bounds staleness for changes
+ * made by other processes that do not touch the directory mtime (e.g.
+ * a file growing in place).
+ */
+#ifndef FTP_LIST_CACHE_ENABLE
+#define FTP_LIST_CACHE_ENABLE 1
+#endif
+
+/** Total cache budget in bytes (entries, names, formatted blobs) */
+#ifndef FTP_LIST_CACHE_BYTES
+#if defined(PLATFORM_PS4)
+#define FTP_LIST_CACHE_BYTES (4U * 1024U * 1024U)
+#else
+#define FTP_LIST_CACHE_BYTES (8U * 1024U * 1024U)
+#endif
+#endif
+
+/** Seconds a cached listing may be served without a rescan */
+#ifndef FTP_LIST_CACHE_TTL_S
+#define FTP_LIST_CACHE_TTL_S 30
+#endif
+
+/**
+ * Listing-cache snapshot handed to the next process on a restart
+ * ("" = start cold).  Only entries still valid and within the TTL are
+ * loaded back.
+ */
+#ifndef FTP_LIST_CACHE_SNAPSHOT
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_LIST_CACHE_SNAPSHOT "/data/zftpd/list.snap"
+#else
+#define FTP_LIST_CACHE_SNAPSHOT "/tmp/zftpd-list.snap"
+#endif
+#endif
+
+/**
+ * Parallel stat for LIST / MLSD
+ *
+ * Directory entries are read in batches of FTP_LIST_STAT_BATCH names and
+ * stat'ed with fstatat() relative to the open directory by the listing
+ * thread plus up to FTP_LIST_STAT_WORKERS helpers; output stays in
+ * readdir order.  Helpers are only started once a directory fills its
+ * first batch, and FTP_LIST_STAT_WORKERS_MAX caps them server-wide.
+ * On USB exFAT and PFS a stat costs milliseconds, so overlapping them
+ * is what makes large game folders list quickly.
+ */
+#ifndef FTP_LIST_STAT_WORKERS
+#if defined(PLATFORM_PS4)
+#define FTP_LIST_STAT_WORKERS 2U
+#else
+#define FTP_LIST_STAT_WORKERS 4U
+#endif
+#endif
+
+#ifndef FTP_LIST_STAT_WORKERS_MAX
+#define FTP_LIST_STAT_WORKERS_MAX 16U
+#endif
+
+#ifndef FTP_LIST_STAT_BATCH
+#define FTP_LIST_STAT_BATCH 256U
+#endif
+
+/**
+ * Directory-size index (ftp_dirsize.h)
+ *
+ * Per-directory sizes are walked in the background by
+ * FTP_DIRSIZE_THREADS walkers and kept up to date incrementally: a
+ * directory is only re-read when its mtime changed, a watch fired or one
+ * of our own writes touched it.  Subtrees without a watch on every
+ * directory are revalidated once a query finds them older than
+ * FTP_DIRSIZE_FRESH_S.
+ */
+#ifndef FTP_DIRSIZE_THREADS
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_DIRSIZE_THREADS 2U
+#else
+#define FTP_DIRSIZE_THREADS 4U
+#endif
+#endif
+
+/** Indexed directories; deeper trees are reported as partial */
+#ifndef FTP_DIRSIZE_MAX_DIRS
+#if defined(PLATFORM_PS4)
+#define FTP_DIRSIZE_MAX_DIRS 65536U
+#else
+#define FTP_DIRSIZE_MAX_DIRS 262144U
+#endif
+#endif
+
+/**
+ * Directories watched for changes (inotify on Linux, one kqueue
+ * EVFILT_VNODE descriptor each elsewhere — hence the small BSD budget).
+ * 0 disables the watcher.
+ */
+#ifndef FTP_DIRSIZE_WATCH_MAX
+#if defined(__linux__)
+#define FTP_DIRSIZE_WATCH_MAX 4096U
+#else
+#define FTP_DIRSIZE_WATCH_MAX 128U
+#endif
+#endif
+
+#ifndef FTP_DIRSIZE_FRESH_S
+#define FTP_DIRSIZE_FRESH_S 30
+#endif
+
+/**
+ * On-disk index ("" = keep it in memory only)
+ * @note Rewritten through a .tmp file + rename, at most once per
+ *       FTP_DIRSIZE_SAVE_S and at shutdown
+ */
+#ifndef FTP_DIRSIZE_INDEX_PATH
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_DIRSIZE_INDEX_PATH "/data/zftpd/dirsize.idx"
+#else
+#define FTP_DIRSIZE_INDEX_PATH "/tmp/zftpd-dirsize.idx"
+#endif
+#endif
+
+#ifndef FTP_DIRSIZE_SAVE_S
+#define FTP_DIRSIZE_SAVE_S 60
+#endif
+
+/**
+ * Background copy jobs (ftp_copyjob.h)
+ *
+ * FTP_COPYJOB_WORKERS threads are shared by every job.  Each device
+ * (st_dev) has FTP_COPYJOB_DEVICE_SLOTS: a file up to
+ * FTP_COPYJOB_SMALL_FILE takes one, a larger file takes them all, so a
+ * device streams one large file or a few small ones at a time.
+ */
+#ifndef FTP_COPYJOB_WORKERS
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_COPYJOB_WORKERS 3U
+#else
+#define FTP_COPYJOB_WORKERS 4U
+#endif
+#endif
+
+#ifndef FTP_COPYJOB_DEVICE_SLOTS
+#define FTP_COPYJOB_DEVICE_SLOTS 3U
+#endif
+
+#ifndef FTP_COPYJOB_SMALL_FILE
+#define FTP_COPYJOB_SMALL_FILE (1U * 1024U * 1024U)
+#endif
+
+/** Jobs remembered; the oldest finished job makes room for a new one */
+#ifndef FTP_COPYJOB_MAX
+#define FTP_COPYJOB_MAX 16U
+#endif
+
 /**
  * Enable TCP_NODELAY (disable Nagle's algorithm)
  * @note Reduces latency for small packets (control commands)
@@ -402,6 +953,392 @@ SOFTWARE.
 #define FTP_RETR_SENDFILE_CHUNK (2U * 1024U * 1024U) /* 2 MB — PS5 NVMe: meno syscall boundary, meno TCP flush prematuri */
 #endif
 
+/**
+ * Adaptive RETR sendfile controller
+ *
+ *   1 = cmd_RETR measures bytes/sec and the sendfile zero-return rate per
+ *       FTP_RETR_TUNE_WINDOW_BYTES window and adjusts chunk size, read()
+ *       cooldown length and EAGAIN backoff sleep on the fly.  The best
+ *       settings are remembered per filesystem type for the next RETR.
+ *   0 = fixed FTP_RETR_SENDFILE_CHUNK / FTP_RETR_TUNE_COOLDOWN /
+ *       FTP_SENDFILE_EAGAIN_SLEEP_US (previous behaviour).
+ *
+ *   FTP_RETR_SENDFILE_CHUNK and FTP_SENDFILE_EAGAIN_SLEEP_US are the
+ *   starting point for a filesystem that has not been seen yet.  The
+ *   stall-detection budget (retries × sleep) stays constant: a shorter
+ *   sleep buys more retries.
+ *
+ * @see ftp_xfer_tune.c
+ */
+#ifndef FTP_RETR_ADAPTIVE
+#define FTP_RETR_ADAPTIVE 1
+#endif
+
+/** Smallest/largest sendfile chunk the controller may pick (bytes) */
+#ifndef FTP_RETR_TUNE_CHUNK_MIN
+#define FTP_RETR_TUNE_CHUNK_MIN (256U * 1024U)
+#endif
+#ifndef FTP_RETR_TUNE_CHUNK_MAX
+#define FTP_RETR_TUNE_CHUNK_MAX (8U * 1024U * 1024U)
+#endif
+
+/** read() cooldown after a sendfile stall: initial, min, max (bytes) */
+#ifndef FTP_RETR_TUNE_COOLDOWN
+#define FTP_RETR_TUNE_COOLDOWN (4U * 1024U * 1024U) /* 4 MB — allineato a PAL_FILE_COPY_BUFFER_SIZE PS5 */
+#endif
+#ifndef FTP_RETR_TUNE_COOLDOWN_MIN
+#define FTP_RETR_TUNE_COOLDOWN_MIN (1U * 1024U * 1024U)
+#endif
+#ifndef FTP_RETR_TUNE_COOLDOWN_MAX
+#define FTP_RETR_TUNE_COOLDOWN_MAX (32U * 1024U * 1024U)
+#endif
+
+/** EAGAIN backoff sleep bounds (microseconds) */
+#ifndef FTP_RETR_TUNE_SLEEP_MIN_US
+#define FTP_RETR_TUNE_SLEEP_MIN_US 50U
+#endif
+#ifndef FTP_RETR_TUNE_SLEEP_MAX_US
+#define FTP_RETR_TUNE_SLEEP_MAX_US 4000U
+#endif
+
+/** Bytes per measurement window */
+#ifndef FTP_RETR_TUNE_WINDOW_BYTES
+#define FTP_RETR_TUNE_WINDOW_BYTES (32U * 1024U * 1024U)
+#endif
+
+/** Zero-return percentage per window above which the chunk is halved */
+#ifndef FTP_RETR_TUNE_EAGAIN_PCT
+#define FTP_RETR_TUNE_EAGAIN_PCT 25U
+#endif
+
+/** Filesystem types remembered by the controller */
+#ifndef FTP_RETR_TUNE_FS_SLOTS
+#define FTP_RETR_TUNE_FS_SLOTS 8U
+#endif
+
+/**
+ * STOR preallocation and durability
+ *
+ *   FTP_STOR_PREALLOCATE       1 = a size announced with ALLO is reserved
+ *                              (pal_file_preallocate) before 150, so the
+ *                              file is laid out once instead of growing
+ *                              per write; 0 = ALLO replies 202.
+ *   FTP_STOR_SYNC_POLICY       0 = no explicit flush (close() only)
+ *                              1 = fdatasync()/fsync() once at the end
+ *                              2 = writeback every FTP_STOR_SYNC_INTERVAL_MB
+ *                                  while data arrives (writer thread in the
+ *                                  ring path), then a final flush that finds
+ *                                  little left to write.  No end stall on
+ *                                  multi-GB files.
+ *
+ *   PS4/PS5 default to 0: close() already flushes, and an explicit fsync
+ *   forces a controller barrier through PFS crypto.
+ */
+#ifndef FTP_STOR_PREALLOCATE
+#define FTP_STOR_PREALLOCATE 1
+#endif
+
+#ifndef FTP_STOR_SYNC_POLICY
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_STOR_SYNC_POLICY 0
+#else
+#define FTP_STOR_SYNC_POLICY 1
+#endif
+#endif
+
+#ifndef FTP_STOR_SYNC_INTERVAL_MB
+#define FTP_STOR_SYNC_INTERVAL_MB 64U
+#endif
+
+/**
+ * Atomic uploads and per-filesystem profiles (ftp_fsprofile)
+ *
+ *   FTP_STOR_ATOMIC          1 = a fresh STOR is written to
+ *                            .zftpd.tmp.NAME and renamed into place, so
+ *                            watchers never see a partial file.  Off on
+ *                            PS4/PS5: PFS-encrypted writes through a temp
+ *                            file cost ~40 ms per 256 KB chunk.
+ *   FTP_FS_PROFILE_PATH      per-filesystem overrides of these defaults
+ *                            (format in ftp_fsprofile.h; "" = built-in
+ *                            profiles only, a missing file is the same).
+ *   FTP_FS_PROFILE_RECHECK_S a lookup stats the file at most this often
+ *                            and reloads it when its mtime changed.
+ *   FTP_FS_PROFILE_LINES     lines kept from the file.
+ */
+#ifndef FTP_STOR_ATOMIC
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_STOR_ATOMIC 0
+#else
+#define FTP_STOR_ATOMIC 1
+#endif
+#endif
+
+#ifndef FTP_FS_PROFILE_PATH
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_FS_PROFILE_PATH "/data/zftpd/fsprofile.conf"
+#else
+#define FTP_FS_PROFILE_PATH "/etc/zftpd/fsprofile.conf"
+#endif
+#endif
+
+#ifndef FTP_FS_PROFILE_RECHECK_S
+#define FTP_FS_PROFILE_RECHECK_S 5U
+#endif
+
+#ifndef FTP_FS_PROFILE_LINES
+#define FTP_FS_PROFILE_LINES 32U
+#endif
+
+/**
+ * Transfer cache policy (pal_io_*)
+ *
+ *   FTP_IO_STREAM_MIN_MB    RETRs of at least this size stream through the
+ *                           page cache: a read-ahead window in front, sent
+ *                           pages dropped behind, so one multi-GB image
+ *                           does not evict the small files that are hot.
+ *                           Smaller files keep their pages.  0 = never.
+ *   FTP_IO_READAHEAD_MB     WILLNEED window kept ahead of a streaming RETR.
+ *   FTP_STOR_DIRECT_MIN_MB  uploads are written O_DIRECT from this size on
+ *                           (from the first byte when ALLO announced at
+ *                           least this much).  0 = never; PS4/PS5 PFS does
+ *                           not take uncached unaligned writes.
+ */
+#ifndef FTP_IO_STREAM_MIN_MB
+#define FTP_IO_STREAM_MIN_MB 64U
+#endif
+
+#ifndef FTP_IO_READAHEAD_MB
+#define FTP_IO_READAHEAD_MB 8U
+#endif
+
+#ifndef FTP_STOR_DIRECT_MIN_MB
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_STOR_DIRECT_MIN_MB 0U
+#else
+#define FTP_STOR_DIRECT_MIN_MB 256U
+#endif
+#endif
+
+/**
+ * Mirror prefetch (ftp_prefetch.h)
+ *
+ *   FTP_PREFETCH_ENABLE     predict the next RETRs of a session from the
+ *                           listing it just received
+ *   FTP_PREFETCH_TRIGGER    RETRs in a row, in listing or name order,
+ *                           before prefetching starts
+ *   FTP_PREFETCH_FILES      files warmed ahead of the current one
+ *   FTP_PREFETCH_FILE_MB    head of each file warmed; the RETR read-ahead
+ *                           window takes over from there
+ *   FTP_PREFETCH_BUDGET_MB  prefetched, not yet requested bytes, all
+ *                           sessions together
+ *   FTP_PREFETCH_LIST_MAX   larger listings are not tracked
+ */
+#ifndef FTP_PREFETCH_ENABLE
+#define FTP_PREFETCH_ENABLE 1
+#endif
+
+#ifndef FTP_PREFETCH_TRIGGER
+#define FTP_PREFETCH_TRIGGER 2U
+#endif
+
+#ifndef FTP_PREFETCH_FILES
+#define FTP_PREFETCH_FILES 4U
+#endif
+
+#ifndef FTP_PREFETCH_FILE_MB
+#define FTP_PREFETCH_FILE_MB 8U
+#endif
+
+#ifndef FTP_PREFETCH_BUDGET_MB
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_PREFETCH_BUDGET_MB 32U
+#else
+#define FTP_PREFETCH_BUDGET_MB 64U
+#endif
+#endif
+
+#ifndef FTP_PREFETCH_LIST_MAX
+#define FTP_PREFETCH_LIST_MAX 8192U
+#endif
+
+_Static_assert((FTP_PREFETCH_TRIGGER >= 2U) && (FTP_PREFETCH_FILES >= 1U),
+               "prefetch needs an order to follow and a file to warm");
+
+/**
+ * Multi-stream segmented transfers (ftp_segment.h)
+ *
+ *   FTP_SEGMENT_FILES    files with a RETR or STOR in progress tracked at
+ *                        once; one per session is enough, so a full
+ *                        table only happens when this is set lower
+ *   FTP_SEGMENT_STREAMS  data connections per file counted in its
+ *                        progress; more still share the file
+ */
+#ifndef FTP_SEGMENT_FILES
+#define FTP_SEGMENT_FILES FTP_MAX_SESSIONS
+#endif
+
+#ifndef FTP_SEGMENT_STREAMS
+#define FTP_SEGMENT_STREAMS 16U
+#endif
+
+_Static_assert((FTP_SEGMENT_FILES >= 1U) && (FTP_SEGMENT_STREAMS >= 1U),
+               "the segment table needs a file and a stream");
+
+/**
+ * Decrypted SELF segment cache (pal_filesystem_psx, PS4/PS5)
+ *
+ *   psx_vfs_read() keeps MAP_SELF segment mappings, keyed by file (dev,
+ *   inode, mtime) and segment index, instead of mapping and unmapping
+ *   one per read.  Shared by all sessions; least recently used mappings
+ *   are unmapped once their total passes FTP_SELF_CACHE_MB, and at most
+ *   FTP_SELF_CACHE_SLOTS are held.  0 MB = map per read.
+ */
+#ifndef FTP_SELF_CACHE_MB
+#define FTP_SELF_CACHE_MB 64U
+#endif
+
+#ifndef FTP_SELF_CACHE_SLOTS
+#define FTP_SELF_CACHE_SLOTS 16U
+#endif
+
+/**
+ * Mounted exFAT images (pal_filesystem_image, SITE MOUNT)
+ *
+ *   At most FTP_VFS_IMAGE_MOUNTS images are mounted at once.  Each one's
+ *   directory index holds up to FTP_VFS_IMAGE_MAX_ENTRIES files and
+ *   directories (about 40 bytes each plus the path); a larger tree, or a
+ *   corrupt one that loops, fails to mount.
+ */
+#ifndef FTP_VFS_IMAGE_MOUNTS
+#define FTP_VFS_IMAGE_MOUNTS 4U
+#endif
+
+#ifndef FTP_VFS_IMAGE_MAX_ENTRIES
+#define FTP_VFS_IMAGE_MAX_ENTRIES (1U << 20)
+#endif
+
+/**
+ * SITE MRETR directory depth limit
+ *
+ *   Subdirectories deeper than this below a MRETR argument are skipped
+ *   (and counted in the 226 reply).  Bounds the recursion of the walk.
+ */
+#ifndef FTP_MRETR_MAX_DEPTH
+#define FTP_MRETR_MAX_DEPTH 32U
+#endif
+
+/**
+ * SITE MSTOR (tar upload unpacked as it arrives)
+ *
+ *   FTP_MSTOR_ATOMIC        1 = each member is written to .zftpd.tmp.NAME
+ *                           and renamed into place when complete, as
+ *                           STOR does; off on PS4/PS5 for the same PFS
+ *                           latency reason.
+ *   FTP_MSTOR_PREALLOC_MIN  members at least this large get their blocks
+ *                           reserved from the header size before the body
+ *                           arrives (pal_file_preallocate); 0 = never.
+ */
+#ifndef FTP_MSTOR_ATOMIC
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#define FTP_MSTOR_ATOMIC 0
+#else
+#define FTP_MSTOR_ATOMIC 1
+#endif
+#endif
+
+#ifndef FTP_MSTOR_PREALLOC_MIN
+#define FTP_MSTOR_PREALLOC_MIN (1024U * 1024U)
+#endif
+
+/**
+ * io_uring data-path engine (Linux only)
+ *
+ *   1 = RETR read() fallback and STOR/APPE receive loops go through
+ *       pal_uring_*() when the running kernel supports it (probed once at
+ *       first use; 5.11+ with IORING_FEAT_EXT_ARG).  Socket and disk ops
+ *       overlap in one thread and each step costs one io_uring_enter().
+ *   0 = classic blocking syscalls only.
+ *
+ *   Ignored on non-Linux targets.  Disabled automatically when crypto or
+ *   rate limiting needs to touch each chunk in userspace.
+ *
+ * @see pal_fileio_uring.c
+ */
+#ifndef FTP_ENABLE_IO_URING
+#define FTP_ENABLE_IO_URING 1
+#endif
+
+/**
+ * splice() zero-copy upload path (Linux only)
+ *
+ *   1 = STOR/APPE move data socket → pipe → file with splice(2) and never
+ *       copy payload through userspace.  Filesystems without splice_write
+ *       fall back to io_uring / the double buffer mid-transfer.
+ *   0 = always use the buffered receive loops.
+ *
+ * @see pal_splice_socket_to_file in pal_fileio.c
+ */
+#ifndef FTP_ENABLE_SPLICE
+#define FTP_ENABLE_SPLICE 1
+#endif
+
+/**
+ * Pipe capacity requested for the splice path (F_SETPIPE_SZ)
+ *
+ *   1 MB is the default fs.pipe-max-size for unprivileged processes;
+ *   larger requests fail and the kernel default (64 KB) is used instead.
+ */
+#ifndef FTP_SPLICE_PIPE_SIZE
+#define FTP_SPLICE_PIPE_SIZE 1048576U
+#endif
+
+/**
+ * STOR writer ring (pal_ring) — recv() thread → disk writer thread
+ *
+ *   FTP_STOR_RING_DEPTH      buffers allocated when the upload starts.
+ *                            0 disables the writer thread entirely
+ *                            (single-buffer recv/write, see cmd_STOR).
+ *   FTP_STOR_RING_MAX_DEPTH  growth limit while the writer lags.  Each
+ *                            extra slot is one FTP_STREAM_BUFFER_SIZE pool
+ *                            buffer, so keep depth × busy uploads below
+ *                            FTP_STREAM_BUFFER_COUNT.
+ *   FTP_STOR_RING_GROW_AFTER consecutive recv-side stalls that count as
+ *                            "sustained" and add one slot.
+ *
+ *   PS4/PS5 default to 0: OrbisOS caps SO_RCVBUF on accepted sockets and
+ *   the single-buffer loop is the empirically stable choice there.  The
+ *   depth is only the default of a filesystem profile's ring= (the ring
+ *   is built whenever FTP_STOR_RING_MAX_DEPTH >= 2).
+ */
+#ifndef FTP_STOR_RING_DEPTH
+#if defined(PS5) || defined(PS4) || defined(PLATFORM_PS5) || defined(PLATFORM_PS4)
+#define FTP_STOR_RING_DEPTH 0U
+#else
+#define FTP_STOR_RING_DEPTH 2U
+#endif
+#endif
+
+#ifndef FTP_STOR_RING_MAX_DEPTH
+#define FTP_STOR_RING_MAX_DEPTH 4U
+#endif
+
+#ifndef FTP_STOR_RING_GROW_AFTER
+#define FTP_STOR_RING_GROW_AFTER 4U
+#endif
+
+/**
+ * RETR read-ahead ring (pal_ring) — disk reader thread → send() thread
+ *
+ *   Where sendfile does not apply (crypto, TLS without kTLS, MODE Z, rate
+ *   limiting, PS4/PS5 SELF files, the exFAT cooldown windows) a reader
+ *   thread keeps up to this many pool buffers filled ahead of the sender,
+ *   so disk and network latency overlap instead of adding up.
+ *   0 = read and send in lockstep on the session thread.
+ */
+#ifndef FTP_RETR_PREFETCH_DEPTH
+#define FTP_RETR_PREFETCH_DEPTH 3U
+#endif
+
 /**
  * TCP receive buffer size in bytes
  *
@@ -457,6 +1394,62 @@ SOFTWARE.
 #define FTP_SOCKET_TELEMETRY 0
 #endif
 
+/**
+ * Data socket buffer auto-tuning (pal_sock_tune_*)
+ *
+ *   While a data connection moves bytes, its TCP_INFO (RTT, cwnd,
+ *   retransmits, send queue) is sampled every FTP_SOCK_TUNE_INTERVAL_MS
+ *   and SO_SNDBUF / SO_RCVBUF grown toward twice the measured
+ *   bandwidth-delay product, at most FTP_SOCK_TUNE_MAX_BUF.  Where the
+ *   kernel still autotunes a buffer (SO_SNDBUF off-console), it is left
+ *   alone until the target passes the kernel's own autotuning ceiling.
+ *   Buffers only grow; the samples feed GET /api/metrics.
+ */
+#ifndef FTP_SOCK_TUNE
+#define FTP_SOCK_TUNE 1
+#endif
+
+#ifndef FTP_SOCK_TUNE_INTERVAL_MS
+#define FTP_SOCK_TUNE_INTERVAL_MS 250U
+#endif
+
+#ifndef FTP_SOCK_TUNE_MAX_BUF
+#if defined(PS5) || defined(PLATFORM_PS5) || defined(PS4) || defined(PLATFORM_PS4)
+#define FTP_SOCK_TUNE_MAX_BUF (8U * 1024U * 1024U) /* payload memory is tight */
+#else
+#define FTP_SOCK_TUNE_MAX_BUF (16U * 1024U * 1024U)
+#endif
+#endif
+
+/**
+ * MSG_ZEROCOPY for data built in user space (Linux, pal_zc_*)
+ *
+ *   Listing batches, read()+send() RETR (cooldowns, SELF files) and
+ *   ChaCha20 output leave from pool buffers with MSG_ZEROCOPY when a
+ *   send is at least FTP_ZEROCOPY_MIN bytes; below that, pinning pages
+ *   costs more than the copy.  A buffer returns to the pool only after
+ *   the socket error queue says the kernel released it, with at most
+ *   FTP_ZEROCOPY_INFLIGHT waiting per connection.  A completion the
+ *   kernel served by copying (loopback, NICs without scatter-gather)
+ *   turns it off for the rest of that connection.  TLS and MODE Z
+ *   output keep the copying path.
+ */
+#ifndef FTP_ZEROCOPY
+#if defined(__linux__)
+#define FTP_ZEROCOPY 1
+#else
+#define FTP_ZEROCOPY 0
+#endif
+#endif
+
+#ifndef FTP_ZEROCOPY_MIN
+#define FTP_ZEROCOPY_MIN 32768U
+#endif
+
+#ifndef FTP_ZEROCOPY_INFLIGHT
+#define FTP_ZEROCOPY_INFLIGHT 8U
+#endif
+
 /*===========================================================================*
  * SECURITY LIMITS
  *===========================================================================*/
@@ -503,6 +1496,59 @@ SOFTWARE.
 #endif
 #endif
 
+/**
+ * Thread placement by role (pal_thread.h): CPU sets and nice values,
+ * e.g. "data=4-7 disk=4-7/5 background=/10".  Empty: the scheduler
+ * decides, as before.  Runtime: -T SPEC (POSIX build).
+ */
+#ifndef FTP_THREAD_PLACEMENT
+#define FTP_THREAD_PLACEMENT ""
+#endif
+
+/**
+ * Event-driven session engine (default engine, switchable at runtime)
+ *
+ *   0: one thread per connection for its whole lifetime (classic)
+ *   1: idle control channels are parked on FTP_ENGINE_LOOPS poll() loops
+ *      and commands run on an elastic I/O pool, so a session only holds
+ *      a thread while a command (or its transfer) is executing
+ *
+ * @note ftp_server_set_event_engine() overrides this before start
+ */
+#ifndef FTP_SESSION_ENGINE_EVENT
+#define FTP_SESSION_ENGINE_EVENT 0
+#endif
+
+/**
+ * Event engine loop threads (0 = one per online CPU, capped at _MAX)
+ */
+#ifndef FTP_ENGINE_LOOPS
+#define FTP_ENGINE_LOOPS 0U
+#endif
+
+#ifndef FTP_ENGINE_LOOPS_MAX
+#define FTP_ENGINE_LOOPS_MAX 8U
+#endif
+
+/**
+ * Event engine I/O pool
+ *
+ *   FTP_ENGINE_IO_THREADS      workers kept when idle
+ *   FTP_ENGINE_IO_THREADS_MAX  upper bound; one per active command
+ *   FTP_ENGINE_IO_IDLE_S       idle seconds before an extra worker exits
+ */
+#ifndef FTP_ENGINE_IO_THREADS
+#define FTP_ENGINE_IO_THREADS 2U
+#endif
+
+#ifndef FTP_ENGINE_IO_THREADS_MAX
+#define FTP_ENGINE_IO_THREADS_MAX FTP_MAX_SESSIONS
+#endif
+
+#ifndef FTP_ENGINE_IO_IDLE_S
+#define FTP_ENGINE_IO_IDLE_S 30U
+#endif
+
 /*===========================================================================*
  * DEBUG AND LOGGING
  *===========================================================================*/
@@ -523,6 +1569,32 @@ SOFTWARE.
 #define FTP_LOG_COMMANDS 1
 #endif
 
+/**
+ * Asynchronous session log (ftp_log_session_cmd / ftp_log_session_event)
+ *
+ *   Each logging thread owns a lock-free ring of FTP_LOG_RING_RECORDS
+ *   fixed-size binary records; one background thread formats and writes
+ *   them in batches every FTP_LOG_FLUSH_MS.  A full ring drops the record
+ *   (counted, reported as a WARN line) instead of blocking the session.
+ *   At most FTP_LOG_RINGS threads hold a ring at a time (rings of exited
+ *   threads are reused); others log synchronously.  0 = always synchronous.
+ */
+#ifndef FTP_LOG_ASYNC
+#define FTP_LOG_ASYNC 1
+#endif
+
+#ifndef FTP_LOG_RING_RECORDS
+#define FTP_LOG_RING_RECORDS 256U
+#endif
+
+#ifndef FTP_LOG_RINGS
+#define FTP_LOG_RINGS 64U
+#endif
+
+#ifndef FTP_LOG_FLUSH_MS
+#define FTP_LOG_FLUSH_MS 20U
+#endif
+
 /**
  * Enable performance statistics
  * @note Track throughput, latency, error rates
@@ -531,19 +1603,106 @@ SOFTWARE.
 #define FTP_ENABLE_STATS 1
 #endif
 
+/**
+ * Per-session transfer rate cap (bytes/sec, 0 = off)
+ * @note Startup default of the session level of the bandwidth scheduler
+ *       (FTP_BW_SESSION_BPS); SITE BWLIMIT changes it at runtime.
+ */
 #ifndef FTP_TRANSFER_RATE_LIMIT_BPS
 #define FTP_TRANSFER_RATE_LIMIT_BPS 0U
 #endif
 
-#ifndef FTP_TRANSFER_RATE_BURST_BYTES
-#define FTP_TRANSFER_RATE_BURST_BYTES (FTP_TRANSFER_RATE_LIMIT_BPS)
-#endif
-
 #if defined(PLATFORM_PS5)
 #undef FTP_TRANSFER_RATE_LIMIT_BPS
 #define FTP_TRANSFER_RATE_LIMIT_BPS 0U
-#undef FTP_TRANSFER_RATE_BURST_BYTES
-#define FTP_TRANSFER_RATE_BURST_BYTES 0U
+#endif
+
+/**
+ * Bandwidth scheduler (ftp_bwsched)
+ *
+ *   FTP_BW_GLOBAL_BPS   whole server
+ *   FTP_BW_PER_IP_BPS   each client address (all its sessions together)
+ *   FTP_BW_SESSION_BPS  each control connection
+ *
+ * Startup rates in bytes/sec, 0 = unlimited; SITE BWLIMIT and
+ * /api/bwlimit change them at runtime.  Every bucket holds at most
+ * FTP_BW_BURST_MS worth of its rate, which also bounds how much one
+ * sendfile() call may move while a limit is active.
+ * FTP_BW_IP_SLOTS client addresses get a per-IP bucket at a time.
+ */
+#ifndef FTP_BW_GLOBAL_BPS
+#define FTP_BW_GLOBAL_BPS 0U
+#endif
+
+#ifndef FTP_BW_PER_IP_BPS
+#define FTP_BW_PER_IP_BPS 0U
+#endif
+
+#ifndef FTP_BW_SESSION_BPS
+#define FTP_BW_SESSION_BPS FTP_TRANSFER_RATE_LIMIT_BPS
+#endif
+
+#ifndef FTP_BW_BURST_MS
+#define FTP_BW_BURST_MS 100U
+#endif
+
+#ifndef FTP_BW_IP_SLOTS
+#define FTP_BW_IP_SLOTS 64U
+#endif
+
+/**
+ * Metrics registry (ftp_metrics, GET /api/metrics)
+ *
+ *   Hot paths update one of FTP_METRICS_SHARDS cache-line aligned shards
+ *   (one per thread, round-robin); a scrape sums them.  Histograms have
+ *   FTP_METRICS_BUCKETS doubling buckets from ~1 us / 1 KiB/s, plus +Inf.
+ *   FTP_METRICS_VERBS bounds the per-command latency table (the command
+ *   table has ~45 entries).  Data connections that moved fewer than
+ *   FTP_METRICS_RATE_MIN_BYTES stay out of the throughput histograms.
+ */
+#ifndef FTP_METRICS_SHARDS
+#define FTP_METRICS_SHARDS 8U
+#endif
+
+#ifndef FTP_METRICS_BUCKETS
+#define FTP_METRICS_BUCKETS 24U
+#endif
+
+#ifndef FTP_METRICS_VERBS
+#define FTP_METRICS_VERBS 64U
+#endif
+
+#ifndef FTP_METRICS_RATE_MIN_BYTES
+#define FTP_METRICS_RATE_MIN_BYTES (64U * 1024U)
+#endif
+
+/**
+ * Transfer timelines (ftp_trace: SITE TRACE, /api/trace)
+ *
+ *   Each transfer keeps up to FTP_TRACE_EVENTS events; the server keeps
+ *   the FTP_TRACE_HISTORY most recent timelines.  Spans of one kind that
+ *   follow within FTP_TRACE_MERGE_MS are merged.  A STOR write or writer
+ *   ring wait of at least FTP_TRACE_LAG_MIN_US is recorded as writer lag.
+ *   FTP_TRACE_PATH_MAX bytes of the path tail are kept.
+ */
+#ifndef FTP_TRACE_EVENTS
+#define FTP_TRACE_EVENTS 32U
+#endif
+
+#ifndef FTP_TRACE_HISTORY
+#define FTP_TRACE_HISTORY 64U
+#endif
+
+#ifndef FTP_TRACE_MERGE_MS
+#define FTP_TRACE_MERGE_MS 100U
+#endif
+
+#ifndef FTP_TRACE_LAG_MIN_US
+#define FTP_TRACE_LAG_MIN_US 2000U
+#endif
+
+#ifndef FTP_TRACE_PATH_MAX
+#define FTP_TRACE_PATH_MAX 64U
 #endif
 
 /*===========================================================================*
@@ -554,6 +1713,24 @@ SOFTWARE.
 _Static_assert((FTP_BUFFER_SIZE & (FTP_BUFFER_SIZE - 1U)) == 0U,
                "FTP_BUFFER_SIZE must be power of 2");
 
+/* Ensure STOR writer ring depth fits pal_ring (PAL_RING_MAX_SLOTS) */
+_Static_assert((FTP_STOR_RING_DEPTH == 0U) ||
+               ((FTP_STOR_RING_DEPTH >= 2U) &&
+                (FTP_STOR_RING_MAX_DEPTH >= FTP_STOR_RING_DEPTH) &&
+                (FTP_STOR_RING_MAX_DEPTH <= 16U)),
+               "FTP_STOR_RING_DEPTH must be 0 or 2..FTP_STOR_RING_MAX_DEPTH (<= 16)");
+
+/* Ensure the RETR controller bounds are ordered */
+_Static_assert((FTP_RETR_TUNE_CHUNK_MIN <= FTP_RETR_SENDFILE_CHUNK) &&
+               (FTP_RETR_SENDFILE_CHUNK <= FTP_RETR_TUNE_CHUNK_MAX),
+               "FTP_RETR_SENDFILE_CHUNK must lie within FTP_RETR_TUNE_CHUNK_MIN..MAX");
+
+/* Ensure the MODE Z level range is valid for zlib */
+_Static_assert((FTP_MODEZ_LEVEL_MIN >= 1) &&
+               (FTP_MODEZ_LEVEL_MIN <= FTP_MODEZ_LEVEL_MAX) &&
+               (FTP_MODEZ_LEVEL_MAX <= 9),
+               "FTP_MODEZ_LEVEL_MIN..MAX must lie within 1..9");
+
 /* Ensure command buffer meets RFC 959 requirement */
 _Static_assert(FTP_CMD_BUFFER_SIZE >= 512U,
                "FTP_CMD_BUFFER_SIZE must be >= 512 bytes (RFC 959)");
@@ -568,6 +1745,65 @@ _Static_assert(FTP_MAX_SESSIONS <= 256U, "FTP_MAX_SESSIONS must be <= 256");
 _Static_assert(FTP_MAX_PATH_DEPTH > 0U && FTP_MAX_PATH_DEPTH <= 128U,
                "FTP_MAX_PATH_DEPTH must be 1-128");
 
+/* Ensure buffer size classes are strictly increasing */
+_Static_assert((FTP_BUFFER_SMALL_SIZE < FTP_STREAM_BUFFER_SIZE) &&
+               (FTP_STREAM_BUFFER_SIZE < FTP_BUFFER_LARGE_SIZE),
+               "buffer classes must satisfy SMALL < STREAM < LARGE");
+
+/* Ensure the event engine pool can make progress */
+_Static_assert((FTP_ENGINE_LOOPS <= FTP_ENGINE_LOOPS_MAX) &&
+               (FTP_ENGINE_IO_THREADS >= 1U) &&
+               (FTP_ENGINE_IO_THREADS <= FTP_ENGINE_IO_THREADS_MAX),
+               "FTP_ENGINE_* thread bounds are inconsistent");
+
+/* Ensure the RETR read-ahead ring fits pal_ring */
+_Static_assert((FTP_RETR_PREFETCH_DEPTH == 0U) ||
+               ((FTP_RETR_PREFETCH_DEPTH >= 2U) &&
+                (FTP_RETR_PREFETCH_DEPTH <= 16U)),
+               "FTP_RETR_PREFETCH_DEPTH must be 0 or 2..16");
+
+/* Ensure log rings index by mask */
+_Static_assert((FTP_LOG_RING_RECORDS >= 16U) &&
+                   ((FTP_LOG_RING_RECORDS & (FTP_LOG_RING_RECORDS - 1U)) == 0U) &&
+                   (FTP_LOG_RINGS >= 1U) && (FTP_LOG_FLUSH_MS >= 1U),
+               "FTP_LOG_RING_RECORDS must be a power of two >= 16");
+
+/* Ensure bandwidth buckets have a burst and the per-IP table exists */
+_Static_assert((FTP_BW_BURST_MS >= 1U) && (FTP_BW_BURST_MS <= 1000U) &&
+                   (FTP_BW_IP_SLOTS >= 1U),
+               "FTP_BW_BURST_MS must be 1..1000 and FTP_BW_IP_SLOTS >= 1");
+
+/* Ensure the buffer controller samples and has room to grow */
+_Static_assert((FTP_SOCK_TUNE_INTERVAL_MS >= 10U) &&
+                   (FTP_SOCK_TUNE_MAX_BUF >= 65536U) &&
+                   (FTP_SOCK_TUNE_MAX_BUF <= 0x40000000U),
+               "FTP_SOCK_TUNE_INTERVAL_MS must be >= 10, MAX_BUF 64 KiB..1 GiB");
+
+/* Owners in flight share the 64-send completion window */
+_Static_assert((FTP_ZEROCOPY_INFLIGHT >= 1U) &&
+                   (FTP_ZEROCOPY_INFLIGHT <= 32U) &&
+                   (FTP_ZEROCOPY_MIN >= 4096U),
+               "FTP_ZEROCOPY_INFLIGHT must be 1..32, FTP_ZEROCOPY_MIN >= 4096");
+
+/* Ensure metric bucket bounds fit 64 bits and shards exist */
+_Static_assert((FTP_METRICS_SHARDS >= 1U) && (FTP_METRICS_BUCKETS >= 1U) &&
+                   (FTP_METRICS_BUCKETS <= 50U) && (FTP_METRICS_VERBS >= 1U),
+               "FTP_METRICS_BUCKETS must be 1..50, SHARDS/VERBS >= 1");
+
+/* Ensure a timeline has room for open, close and something between */
+_Static_assert((FTP_TRACE_EVENTS >= 4U) && (FTP_TRACE_EVENTS <= 65535U) &&
+                   (FTP_TRACE_HISTORY >= 1U) && (FTP_TRACE_PATH_MAX >= 16U),
+               "FTP_TRACE_EVENTS must be 4..65535, HISTORY >= 1, PATH_MAX >= 16");
+
+/* Ensure the SELF segment cache has a slot table */
+_Static_assert(FTP_SELF_CACHE_SLOTS >= 1U,
+               "FTP_SELF_CACHE_SLOTS must be >= 1");
+
+/* Ensure the STOR sync policy is known and periodic syncs make progress */
+_Static_assert((FTP_STOR_SYNC_POLICY >= 0) && (FTP_STOR_SYNC_POLICY <= 2) &&
+               (FTP_STOR_SYNC_INTERVAL_MB > 0U),
+               "FTP_STOR_SYNC_POLICY must be 0-2, interval > 0");
+
 /* Ensure stack size is sufficient (minimum 32KB) */
 _Static_assert(FTP_THREAD_STACK_SIZE >= 32768U,
                "FTP_THREAD_STACK_SIZE must be >= 32KB");
@@ -0,0 +1,155 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_copyjob.h
+ * @brief Background copy/move/delete jobs on a shared, device-aware pool
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Server-side copies (HTTP /api/copy, FTP COPY/CPTO and the cross-device
+ * RNTO fallback) are queued as jobs:
+ *
+ *   submit ──► job (id) ──► scan ──► file tasks ──► workers ──► done
+ *                                        │
+ *                      device budget ────┘  (per st_dev, src and dst)
+ *
+ * Every job is split into one task per regular file.  FTP_COPYJOB_WORKERS
+ * threads take tasks from the oldest job first, as long as the devices
+ * the task reads and writes have budget left: a small file costs one of
+ * FTP_COPYJOB_DEVICE_SLOTS, a large one (pipelined reader/writer) costs
+ * all of them.  Many small files therefore copy in parallel, while a
+ * single USB disk never serves two large streams at once; jobs on
+ * different devices run side by side.
+ *
+ * Recursive deletes (ftp_copyjob_delete) use the same pool with one task
+ * per directory: the entries are removed with unlinkat() relative to the
+ * directory fd, using d_type so no entry is stat'ed, and subdirectories
+ * become new tasks.  Each costs one device slot, so a huge tree is
+ * emptied by up to FTP_COPYJOB_DEVICE_SLOTS workers at once.
+ *
+ * THREAD SAFETY: every function may be called from any thread.
+ */
+
+#ifndef FTP_COPYJOB_H
+#define FTP_COPYJOB_H
+
+#include "ftp_config.h"
+#include "ftp_types.h"
+
+#include <stdint.h>
+
+typedef enum {
+  FTP_COPYJOB_QUEUED = 0,    /**< Waiting for a worker          */
+  FTP_COPYJOB_RUNNING = 1,   /**< Scanning or copying           */
+  FTP_COPYJOB_PAUSED = 2,    /**< Paused; running files wait    */
+  FTP_COPYJOB_DONE = 3,      /**< Finished successfully         */
+  FTP_COPYJOB_FAILED = 4,    /**< Stopped at the first error    */
+  FTP_COPYJOB_CANCELLED = 5, /**< Stopped by ftp_copyjob_cancel */
+} ftp_copyjob_state_t;
+
+typedef struct {
+  uint32_t id;
+  ftp_copyjob_state_t state;
+  int is_move;
+  int is_delete;        /**< dst = trash name, or "" (in place)  */
+  int scanned;          /**< 1 = totals below are final          */
+  uint64_t bytes_done;  /**< Bytes written so far                */
+  uint64_t bytes_total; /**< Scanned size, or the submit hint    */
+  uint32_t files_done;
+  uint32_t files_total;
+  int error_code;  /**< ftp_error_t of the first failure       */
+  int error_errno; /**< errno captured with it                 */
+  char src[FTP_PATH_MAX];
+  char dst[FTP_PATH_MAX];
+} ftp_copyjob_info_t;
+
+/**
+ * @brief Queue a copy (or move) of @p src to @p dst
+ *
+ * @param src        Resolved source file or directory
+ * @param dst        Resolved destination (the new name, not its parent)
+ * @param is_move    1 = remove the source once everything is copied
+ * @param total_hint Size shown until the scan has finished (0 = none)
+ * @param out_id     Job id, increasing and never reused
+ *
+ * @return FTP_OK, FTP_ERR_MAX_SESSIONS when FTP_COPYJOB_MAX jobs are
+ *         still unfinished, FTP_ERR_THREAD_CREATE without workers
+ */
+ftp_error_t ftp_copyjob_submit(const char *src, const char *dst, int is_move,
+                               uint64_t total_hint, uint32_t *out_id);
+
+/**
+ * @brief Queue a recursive delete of @p path (file or directory)
+ *
+ * With @p use_trash the tree is first renamed to a hidden sibling
+ * (".zftpd-trash.<pid>.<n>"), so @p path is gone when this returns and
+ * the contents are removed in the background.  If the rename fails the
+ * tree is deleted in place.  A failed or cancelled job renames what is
+ * left back to @p path.
+ *
+ * Progress is reported in files_done (entries removed so far); the total
+ * is not known in advance.
+ *
+ * @return Same codes as ftp_copyjob_submit()
+ */
+ftp_error_t ftp_copyjob_delete(const char *path, int use_trash,
+                               uint32_t *out_id);
+
+/** @return 0 with @p out filled, -1 for an unknown (or dropped) id */
+int ftp_copyjob_get(uint32_t id, ftp_copyjob_info_t *out);
+
+/**
+ * @brief Known jobs, oldest first
+ * @return Number of entries written (at most @p max)
+ */
+size_t ftp_copyjob_list(ftp_copyjob_info_t *out, size_t max);
+
+/** @return Id of the most recent copy or move job, 0 if none */
+uint32_t ftp_copyjob_latest(void);
+
+/**
+ * @brief Pause (1) or resume (0) a job
+ * @return 0, or -1 if the job is unknown or already finished
+ */
+int ftp_copyjob_pause(uint32_t id, int paused);
+
+/** @return 0, or -1 if the job is unknown or already finished */
+int ftp_copyjob_cancel(uint32_t id);
+
+/**
+ * @brief Wait for a job to finish
+ * @return 0 once finished (or unknown), -1 on timeout
+ */
+int ftp_copyjob_wait(uint32_t id, unsigned timeout_ms);
+
+/**
+ * @brief Cancel every job, join the workers and forget all jobs
+ * @note Workers are started again by the next submit
+ */
+void ftp_copyjob_shutdown(void);
+
+#endif /* FTP_COPYJOB_H */
@@ -44,8 +44,9 @@ SOFTWARE.
  *  │  decrypt = same XOR with same keystream            │
  *  └────────────────────────────────────────────────────┘
  *
- * PERFORMANCE: ~3 GB/s on x86-64, ~1 GB/s on ARM (pure C)
- * DEPENDENCIES: None (self-contained ARX operations)
+ * PERFORMANCE: multi-block SIMD keystream (AVX2 8-way, SSE2/NEON 4-way),
+ *              scalar fallback; see ftp_crypto.c
+ * DEPENDENCIES: None (self-contained ARX operations, compiler intrinsics)
  */
 
 #ifndef FTP_CRYPTO_H
@@ -84,6 +85,20 @@ typedef struct {
   uint32_t counter;      /**< Block counter (increments per 64B)     */
 } ftp_crypto_ctx_t;
 
+/**
+ * Keystream kernels
+ *
+ *  All backends produce the same keystream; they differ only in how many
+ *  64-byte blocks one call computes.
+ */
+typedef enum {
+  FTP_CRYPTO_BACKEND_AUTO = 0, /**< Best available (default)           */
+  FTP_CRYPTO_BACKEND_SCALAR,   /**< One block at a time, portable C    */
+  FTP_CRYPTO_BACKEND_SSE2,     /**< 4 blocks per call (x86)            */
+  FTP_CRYPTO_BACKEND_AVX2,     /**< 8 blocks per call (x86, CPUID)     */
+  FTP_CRYPTO_BACKEND_NEON      /**< 4 blocks per call (ARM)            */
+} ftp_crypto_backend_t;
+
 /*===========================================================================*
  * API
  *===========================================================================*/
@@ -119,6 +134,23 @@ void ftp_crypto_init(ftp_crypto_ctx_t *ctx, const uint8_t key[32],
  */
 void ftp_crypto_xor(ftp_crypto_ctx_t *ctx, void *data, size_t len);
 
+/**
+ * @brief Force a keystream backend (process-wide)
+ *
+ * Meant for tests and benchmarks; servers leave it on AUTO.
+ *
+ * @param backend  Backend to use, FTP_CRYPTO_BACKEND_AUTO to re-detect
+ *
+ * @return 0 on success, -1 if the backend is not built in or the CPU
+ *         lacks it (selection unchanged)
+ */
+int ftp_crypto_set_backend(ftp_crypto_backend_t backend);
+
+/**
+ * @brief Name of the backend ftp_crypto_xor() uses ("avx2", "scalar", ...)
+ */
+const char *ftp_crypto_backend_name(void);
+
 /**
  * @brief Securely reset crypto context (zeroes all key material)
  *
@@ -0,0 +1,296 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_delta.h
+ * @brief rsync-style delta uploads for SITE DELTA
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Re-uploading a large file that changed in a few places sends only the
+ * changes.  The server describes the copy it has (the basis) as a list of
+ * per-block checksums; the client slides a window over its new version,
+ * finds blocks the server already has, and sends references to those
+ * plus the bytes in between.
+ *
+ *   client                                    server
+ *   SITE DELTA SIG f  ───────────────────────► signature of f (cached)
+ *                     ◄══ [hdr][weak,strong]* ═
+ *   rolling match against the signature
+ *   SITE DELTA PUT f  ═══ [hdr][C|L]*[E] ═════► temp file:
+ *                                               C = copy_file_range(f)
+ *                                               L = write(literal)
+ *                                              verify SHA-256, rename()
+ *
+ * All integers are big-endian.
+ *
+ * SIGNATURE (server → client):
+ *
+ *   0  "ZDSG"    magic
+ *   4  u32       block size
+ *   8  u64       basis size
+ *  16  i64       basis mtime (seconds)
+ *  24  u32       strong checksum bytes per block (FTP_DELTA_STRONG_LEN)
+ *  28  u32       0
+ *  32  per block: u32 weak, u8 strong[FTP_DELTA_STRONG_LEN]
+ *
+ *   The last block may be short; its checksums cover what is there.
+ *
+ * DELTA (client → server):
+ *
+ *   0  "ZDLT"    magic
+ *   4  u32       block size    ┐
+ *   8  u64       basis size    ├ echoed from the signature: the server
+ *  16  i64       basis mtime   ┘ refuses a delta made for another version
+ *  24  u64       result size
+ *  32  records:
+ *        'C' u64 first block, u32 count   copy basis blocks
+ *        'L' u32 length, bytes            literal data
+ *        'E' u8 sha256[32]                end: digest of the result
+ *
+ * CHECKSUMS:
+ *   weak    rsync's rolling sum: a = sum(x), b = sum((len - i) * x),
+ *           (a & 0xffff) | (b << 16); SSSE3 kernel on x86 for the
+ *           whole-block sums, ftp_delta_roll() slides it one byte
+ *   strong  SHA-256 (SHA-NI when present) truncated to 16 bytes
+ *
+ * SIGNATURE CACHE: signatures of large files are kept on disk next to the
+ * HASH digest index, keyed by (path, size, mtime) and served without
+ * reading the file again.  SITE DELTA PUT caches the new version's
+ * signature while it verifies the result, so the next round starts warm.
+ *
+ * THREAD SAFETY: the checksum and stream functions are stateless; the
+ * signature cache is mutex-protected.
+ */
+
+#ifndef FTP_DELTA_H
+#define FTP_DELTA_H
+
+#include "ftp_config.h"
+#include "ftp_hash.h"
+#include "ftp_types.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** Truncated SHA-256 per block */
+#define FTP_DELTA_STRONG_LEN 16U
+
+/** Signature header / entry sizes */
+#define FTP_DELTA_SIG_HEADER 32U
+#define FTP_DELTA_SIG_ENTRY (4U + FTP_DELTA_STRONG_LEN)
+
+/** Delta stream header size */
+#define FTP_DELTA_HEADER 32U
+
+/** Record tags */
+#define FTP_DELTA_COPY 'C'
+#define FTP_DELTA_LITERAL 'L'
+#define FTP_DELTA_END 'E'
+
+typedef struct {
+  uint32_t block_size;
+  uint64_t size;  /**< Basis bytes       */
+  int64_t mtime;  /**< Basis mtime (s)   */
+} ftp_delta_basis_t;
+
+/**
+ * @brief Block size for a file of @p size bytes
+ *
+ * Roughly sqrt(size) rounded up to a power of two, clamped to
+ * [FTP_DELTA_BLOCK_MIN, FTP_DELTA_BLOCK_MAX]: 40 GB gets 256 KB blocks
+ * and a ~3 MB signature.
+ */
+uint32_t ftp_delta_block_size(uint64_t size);
+
+/** @brief Blocks in a basis */
+uint64_t ftp_delta_block_count(const ftp_delta_basis_t *b);
+
+/*===========================================================================*
+ * CHECKSUMS
+ *===========================================================================*/
+
+/** @brief Weak (rolling) checksum of @p len bytes */
+uint32_t ftp_delta_weak(const void *data, size_t len);
+
+/**
+ * @brief Slide a weak checksum one byte: drop @p out, append @p in
+ *
+ * @param len Window length
+ */
+uint32_t ftp_delta_roll(uint32_t weak, uint8_t out, uint8_t in, uint32_t len);
+
+/** @brief Strong checksum of @p len bytes */
+void ftp_delta_strong(const void *data, size_t len,
+                      uint8_t out[FTP_DELTA_STRONG_LEN]);
+
+/** @brief Weak checksum kernel in use ("ssse3", "scalar") */
+const char *ftp_delta_kernel_name(void);
+
+/** @brief Force the portable weak checksum (tests/benchmarks) */
+void ftp_delta_force_scalar(int scalar);
+
+/*===========================================================================*
+ * SIGNATURES
+ *===========================================================================*/
+
+/** @brief Encode a signature header */
+void ftp_delta_sig_header(uint8_t out[FTP_DELTA_SIG_HEADER],
+                          const ftp_delta_basis_t *b);
+
+/**
+ * @brief Decode a signature header
+ *
+ * @return 0, or -1 for a bad magic, strong length or block size
+ */
+int ftp_delta_sig_parse(const uint8_t in[FTP_DELTA_SIG_HEADER],
+                        ftp_delta_basis_t *b);
+
+/** @brief Output callback: 0 to continue, nonzero to stop */
+typedef int (*ftp_delta_emit_t)(void *ctx, const void *data, size_t len);
+
+/**
+ * @brief Stream the signature of an open file
+ *
+ * Reads @p b->size bytes from offset 0 in @p buf sized chunks (a multiple
+ * of the block size is used) and emits the header and one entry per
+ * block, in batches.
+ *
+ * @param whole If not NULL, also digests every byte read into it
+ *
+ * @return 0, -1 on a read error or a file shorter than b->size (errno
+ *         set), or the emit callback's nonzero return
+ */
+int ftp_delta_sig_fd(int fd, const ftp_delta_basis_t *b, void *buf,
+                     size_t buf_size, ftp_delta_emit_t emit, void *ctx,
+                     ftp_hash_ctx_t *whole);
+
+/*===========================================================================*
+ * DELTA STREAM
+ *===========================================================================*/
+
+typedef struct {
+  ftp_delta_basis_t basis;
+  uint64_t result_size;
+} ftp_delta_header_t;
+
+/** @brief Encode a delta header (clients, tests) */
+void ftp_delta_header(uint8_t out[FTP_DELTA_HEADER],
+                      const ftp_delta_header_t *h);
+
+/**
+ * Record callbacks.  A negative return aborts the parse and is returned
+ * by ftp_delta_reader_feed().
+ */
+typedef struct {
+  int (*begin)(void *ctx, const ftp_delta_header_t *h);
+  /** Copy @p len basis bytes from @p offset (already range-checked) */
+  int (*copy)(void *ctx, uint64_t offset, uint64_t len);
+  /** Literal bytes, straight from the caller's buffer */
+  int (*data)(void *ctx, const void *buf, size_t len);
+  int (*end)(void *ctx, const uint8_t sha256[32]);
+  void *ctx;
+} ftp_delta_sink_t;
+
+typedef struct {
+  ftp_delta_sink_t sink;
+  ftp_delta_header_t hdr;
+  uint8_t rec[FTP_DELTA_HEADER]; /* header or record being assembled */
+  size_t have;
+  size_t need;
+  uint64_t literal_left;
+  uint64_t produced; /* result bytes described so far */
+  int state;
+} ftp_delta_reader_t;
+
+/** @brief Reset @p r to the start of a delta stream */
+void ftp_delta_reader_init(ftp_delta_reader_t *r, const ftp_delta_sink_t *sink);
+
+/**
+ * @brief Parse the next @p len bytes of the stream
+ *
+ * @return FTP_OK, FTP_ERR_PROTOCOL (bad magic, record, a copy outside
+ *         the basis, more output than the header announced, bytes after
+ *         'E'), or a sink's negative return
+ */
+ftp_error_t ftp_delta_reader_feed(ftp_delta_reader_t *r, const void *data,
+                                  size_t len);
+
+/**
+ * @brief Check the stream ended with its 'E' record
+ *
+ * @return FTP_OK, or FTP_ERR_PROTOCOL
+ */
+ftp_error_t ftp_delta_reader_finish(const ftp_delta_reader_t *r);
+
+/**
+ * @brief Copy @p len bytes at @p offset of @p src to the current position
+ *        of @p dst
+ *
+ * copy_file_range() where the kernel has it (reflinked or server-side
+ * on filesystems that can), else pread() + write() through @p buf.
+ *
+ * @return 0, or -1 (errno set)
+ */
+int ftp_delta_copy(int src, uint64_t offset, int dst, uint64_t len, void *buf,
+                   size_t buf_size);
+
+/*===========================================================================*
+ * SIGNATURE CACHE
+ *===========================================================================*/
+
+/**
+ * @brief Open the cached signature of @p path, if it matches @p b
+ *
+ * @return File positioned at the signature header (read it to the end),
+ *         or -1 on a miss
+ */
+int ftp_delta_sig_cache_open(const char *path, const ftp_delta_basis_t *b);
+
+/**
+ * @brief Start caching a signature for @p path
+ *
+ * Write the signature to the returned file, then call
+ * ftp_delta_sig_cache_commit().
+ *
+ * @param tmp Receives the temp name (FTP_PATH_MAX)
+ *
+ * @return fd, or -1 (caching off or the directory is not writable)
+ */
+int ftp_delta_sig_cache_create(const char *path, char *tmp, size_t tmp_size);
+
+/**
+ * @brief Publish (@p ok) or drop a signature started above; closes @p fd
+ */
+void ftp_delta_sig_cache_commit(const char *path, int fd, const char *tmp,
+                                int ok);
+
+/**
+ * @brief Use @p dir for cached signatures ("" = off, NULL = default
+ *        FTP_DELTA_SIG_DIR)
+ */
+void ftp_delta_sig_cache_reset(const char *dir);
+
+#endif /* FTP_DELTA_H */
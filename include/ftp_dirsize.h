@@ -0,0 +1,122 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_dirsize.h
+ * @brief Background, incrementally refreshed directory-size index
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Answers "how big is this tree" from memory instead of walking it per
+ * request:
+ *
+ *   query ──► index hit ──► answer now (+ stale flag)
+ *                 │
+ *                 └─ missing / dirty / aged ──► walkers ──► index
+ *                                                  ▲
+ *   inotify / kqueue, ftp_dirsize_invalidate() ────┘  (mark dirty)
+ *
+ * Sizes are st_blocks * 512 of the regular files below the directory;
+ * symlinks are not followed.
+ *
+ * THREAD SAFETY: every function may be called from any thread.
+ */
+
+#ifndef FTP_DIRSIZE_H
+#define FTP_DIRSIZE_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint64_t bytes; /**< Total under the directory, as far as indexed    */
+  uint32_t age_s; /**< Seconds since the oldest directory was verified */
+  int stale;      /**< 1 = a change is pending or the data has aged    */
+  int partial;    /**< 1 = not walked completely (yet, or size caps)   */
+} ftp_dirsize_info_t;
+
+typedef struct {
+  uint32_t dirs;          /**< Indexed directories                   */
+  uint32_t watches;       /**< Directories with a change watch       */
+  uint64_t reads;         /**< Directories read (readdir + stat)     */
+  uint64_t reuses;        /**< Revisits skipped thanks to the mtime  */
+  uint64_t invalidations; /**< Dirty marks from writes and watches   */
+} ftp_dirsize_stats_t;
+
+/**
+ * @brief Size of the tree at @p path
+ *
+ * Answers from the index.  A directory seen for the first time, or one
+ * whose data is dirty or older than FTP_DIRSIZE_FRESH_S, is queued for
+ * the walkers; the call then waits up to @p wait_ms for them.
+ *
+ * @param path     Resolved absolute directory path
+ * @return 0 with @p out filled, -1 if @p path is not a directory
+ */
+int ftp_dirsize_query(const char *path, unsigned wait_ms,
+                      ftp_dirsize_info_t *out);
+
+/**
+ * @brief Size of @p path as the index has it, without queueing work
+ *
+ * For callers that already queried an ancestor (the disk treemap):
+ * no stat, no walk, just a lookup.
+ *
+ * @return 0 with @p out filled, -1 if @p path is not indexed
+ */
+int ftp_dirsize_peek(const char *path, ftp_dirsize_info_t *out);
+
+/**
+ * @brief Report a change made to @p path (file or directory)
+ *
+ * Marks its parent directory, and @p path itself if indexed, for a
+ * re-read.  Called through ftp_list_cache_invalidate().
+ */
+void ftp_dirsize_invalidate(const char *path);
+
+/** @brief Counters and current size */
+void ftp_dirsize_get_stats(ftp_dirsize_stats_t *out);
+
+/**
+ * @brief Load the on-disk index and start the walkers now
+ *
+ * Normally done by the first query; a process taking over from another
+ * (ftp_handoff.h) calls it at start-up so the first answer is warm.
+ */
+void ftp_dirsize_preload(void);
+
+/** @brief Write the index now if it changed since the last save */
+void ftp_dirsize_save(void);
+
+/** @brief Stop the walkers and the watcher, save the index, free it */
+void ftp_dirsize_shutdown(void);
+
+/**
+ * @brief Shut down and switch to another on-disk index (tests)
+ * @param index_path NULL = FTP_DIRSIZE_INDEX_PATH, "" = memory only
+ */
+void ftp_dirsize_reset(const char *index_path);
+
+#endif /* FTP_DIRSIZE_H */
@@ -0,0 +1,103 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_engine.h
+ * @brief Event-driven session engine
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Replaces thread-per-session with a fixed set of poll() loops and an
+ * elastic I/O pool.  A session that is waiting for its next command is
+ * only a pollfd on one loop; it holds a worker thread only while a
+ * command, and the blocking file or data transfer it starts, runs:
+ *
+ *   accept ──► run queue ──► I/O worker: 220 / command(s) ──┐
+ *                  ▲                                         │ park
+ *                  └── loop i: poll(ctrl fds) ◄───────────────┘
+ *                      readable / EOF / idle timeout
+ *
+ * The workers execute the same ftp_session_begin / serve_command / end
+ * steps as ftp_session_thread(), so command handlers are unchanged.
+ * Workers are spawned on demand up to FTP_ENGINE_IO_THREADS_MAX and
+ * retire after FTP_ENGINE_IO_IDLE_S down to FTP_ENGINE_IO_THREADS.
+ *
+ * THREAD SAFETY: a session is owned by exactly one place at a time
+ * (run queue, a worker, or a loop); hand-offs happen under a mutex.
+ */
+
+#ifndef FTP_ENGINE_H
+#define FTP_ENGINE_H
+
+#include "ftp_types.h"
+
+typedef struct ftp_engine ftp_engine_t;
+
+/** Engine counters (ftp_engine_get_stats) */
+typedef struct {
+  uint32_t loops;        /**< poll() loop threads                 */
+  uint32_t workers;      /**< Live I/O workers                    */
+  uint32_t busy_workers; /**< Workers running a session right now */
+  uint32_t parked;       /**< Sessions waiting on a loop          */
+  uint64_t dispatches;   /**< Sessions handed to a worker         */
+} ftp_engine_stats_t;
+
+/**
+ * @brief Start the loop threads and the minimum I/O pool
+ *
+ * @param loops Loop threads (0 = one per online CPU)
+ *
+ * @return Engine, or NULL if no loop could be started
+ */
+ftp_engine_t *ftp_engine_create(unsigned loops);
+
+/**
+ * @brief Hand a freshly initialised session to the engine
+ *
+ * The first worker to pick it up sends the greeting.
+ *
+ * @param engine  Engine
+ * @param session Session after ftp_session_init (server_ctx set)
+ *
+ * @return FTP_OK, or FTP_ERR_THREAD_CREATE if no worker could run it
+ */
+ftp_error_t ftp_engine_submit(ftp_engine_t *engine, ftp_session_t *session);
+
+/**
+ * @brief Snapshot the engine counters
+ */
+void ftp_engine_get_stats(ftp_engine_t *engine, ftp_engine_stats_t *out);
+
+/**
+ * @brief Stop loops and workers and free the engine
+ *
+ * Sessions must already have been shut down (ftp_server_stop).  Waits a
+ * bounded time for busy workers; if one is stuck the engine is left
+ * allocated rather than freed under it.
+ */
+void ftp_engine_destroy(ftp_engine_t *engine);
+
+#endif /* FTP_ENGINE_H */
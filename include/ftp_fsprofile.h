@@ -0,0 +1,95 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_fsprofile.h
+ * @brief Per-filesystem I/O profiles (RETR, STOR, MSTOR, LIST)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Filesystem quirks are looked up once per transfer from the filesystem
+ * type (ftp_xfer_tune_fstype(), the "fs=" of the [RETR] diag line)
+ * instead of being fixed per platform:
+ *
+ *   compile-time defaults (FTP_STOR_*, FTP_RETR_SENDFILE_CHUNK, ...)
+ *     └─► file "*" line ─► built-in line for the type ─► file line for it
+ *
+ * PROFILE FILE (FTP_FS_PROFILE_PATH, re-read when its mtime changes):
+ *
+ *   # fstype  key=value ...
+ *   *         sync=0
+ *   exfat     chunk=1M ring=4
+ *   ext4      atomic=1 sync=2
+ *
+ *   sendfile=0|1   RETR may use sendfile()
+ *   chunk=N[K|M]   first sendfile() chunk (the RETR controller moves it)
+ *   ring=N         STOR writer ring depth; 0/1 = single-buffer loop
+ *   prealloc=0|1   ALLO / MSTOR members reserve their blocks
+ *   atomic=0|1     STOR / MSTOR write a temp file and rename() it
+ *   skip_stat=0|1  LIST takes entries from d_type only (pseudo fs)
+ *   sync=0|1|2     as FTP_STOR_SYNC_POLICY
+ *
+ * THREAD SAFETY: all functions may be called from any thread.
+ */
+
+#ifndef FTP_FSPROFILE_H
+#define FTP_FSPROFILE_H
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t sendfile_chunk; /**< First sendfile() chunk (bytes)          */
+  uint8_t sendfile;        /**< RETR may use sendfile()                 */
+  uint8_t stor_ring;       /**< STOR writer ring depth (< 2 = none)     */
+  uint8_t preallocate;     /**< Reserve announced sizes                 */
+  uint8_t atomic_rename;   /**< Temp file + rename() for fresh uploads  */
+  uint8_t skip_stat;       /**< LIST without stat() (FTP_LIST_SAFE_MODE) */
+  uint8_t sync_policy;     /**< 0 / 1 / 2, as FTP_STOR_SYNC_POLICY      */
+  uint8_t _pad[2];
+} ftp_fs_profile_t;
+
+/** @brief Profile for a filesystem type name (NULL = defaults only) */
+void ftp_fs_profile_lookup(const char *fstype, ftp_fs_profile_t *out);
+
+/** @brief Profile of the filesystem an open fd lives on */
+void ftp_fs_profile_for_fd(int fd, ftp_fs_profile_t *out);
+
+/**
+ * @brief Profile of the filesystem holding @p path
+ *
+ * Anything but a directory (a file, or one that does not exist yet for a
+ * fresh STOR) is looked up through its parent directory.
+ */
+void ftp_fs_profile_for_path(const char *path, ftp_fs_profile_t *out);
+
+/**
+ * @brief Use a different profile file ("" = built-ins only) and load it
+ *
+ * @return Lines in effect, or -1 if the file could not be read
+ */
+int ftp_fs_profile_reset(const char *conf_path);
+
+#endif /* FTP_FSPROFILE_H */
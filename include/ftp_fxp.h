@@ -0,0 +1,82 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_fxp.h
+ * @brief FXP (server-to-server) data connection allow-list
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * In an FXP transfer the client drives two servers and the data flows
+ * directly between them:
+ *
+ *   client ──PASV──► B (227 B:port)      B ◄═══ data ═══ A
+ *   client ──PORT B:port──► A                 (sendfile)  (splice / ring)
+ *   client ──STOR──► B, ──RETR──► A
+ *
+ * A's PORT names a host that is not the client, and B's listener is
+ * reached by a peer that is not the client.  Both are refused by
+ * default (RFC 2577 bounce protection, FTP_PASV_PEER_CHECK).  Addresses
+ * on this list are let through on both sides; PORT to a port below 1024
+ * is refused even for them.
+ *
+ * The list comes from FTP_FXP_ALLOW.  It lifts bounce protection for
+ * every session, so clients cannot change it: SITE FXP only shows it,
+ * and ftp_fxp_set_allow() is for the host process.  Format:
+ * comma-separated IPv4 addresses or CIDR blocks no wider than
+ * /FTP_FXP_PREFIX_MIN, e.g. "192.168.1.20,10.0.0.0/24"; "" or "off"
+ * clears it.
+ *
+ * The data path is the ordinary one: RETR keeps sendfile() on the
+ * source, STOR its splice / writer-ring pipeline on the destination.
+ *
+ * THREAD SAFETY: all functions may be called from any thread.
+ */
+
+#ifndef FTP_FXP_H
+#define FTP_FXP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Replace the allow-list (host process only, never a session)
+ *
+ * @return Entries now on the list, or -1 on a syntax error (list
+ *         unchanged)
+ */
+int ftp_fxp_set_allow(const char *list);
+
+/** @brief Write the list in ftp_fxp_set_allow() form ("off" when empty) */
+void ftp_fxp_format(char *buf, size_t size);
+
+/**
+ * @brief Is @p ip (network order) a permitted FXP peer?
+ *
+ * @return 1 if it matches an entry, 0 otherwise
+ */
+int ftp_fxp_allowed(uint32_t ip);
+
+#endif /* FTP_FXP_H */
@@ -0,0 +1,165 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_handoff.h
+ * @brief Zero-downtime restart: listening sockets passed to a new process
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * The running instance offers its listeners on a UNIX socket
+ * (FTP_HANDOFF_PATH).  A new instance started to replace it connects,
+ * receives them with SCM_RIGHTS and accepts on the very same sockets,
+ * so the ports never close and no SYN is refused:
+ *
+ *   old                                      new
+ *   ftp_handoff_serve() ◄──── "ZHOR" ──────  ftp_handoff_take()
+ *   collect: save caches,
+ *            gather listeners ─ fds ──────►  adopt them, load caches,
+ *                                            start accepting
+ *   done(adopted = 1)   ◄──── 'A' ─────────  ftp_handoff_confirm()
+ *   stop accepting, drain sessions, exit     ftp_handoff_serve()
+ *
+ * Until the confirmation both processes accept on the shared sockets;
+ * if the new process fails, it closes its copies and the old one simply
+ * carries on (done(adopted = 0)).  Shared listeners are switched to
+ * non-blocking before they are sent: both sides poll() them, and an
+ * accept() that loses the race must not block.
+ *
+ * THREAD SAFETY: ftp_handoff_serve() runs its own thread; the callbacks
+ * are called on it.  The other functions are for the start-up thread.
+ */
+
+#ifndef FTP_HANDOFF_H
+#define FTP_HANDOFF_H
+
+#include "ftp_config.h"
+#include "ftp_types.h"
+#include <stdint.h>
+
+/** What a handed-over socket is for */
+typedef enum {
+  FTP_HANDOFF_FTP = 1,  /**< Control-port listener         */
+  FTP_HANDOFF_PASV = 2, /**< Idle passive listener (pool)  */
+  FTP_HANDOFF_HTTP = 3, /**< Web server listener           */
+} ftp_handoff_kind_t;
+
+/** Listeners in one hand-off message */
+typedef struct {
+  uint32_t count;
+  int fds[FTP_HANDOFF_FDS_MAX];
+  uint8_t kinds[FTP_HANDOFF_FDS_MAX]; /**< ftp_handoff_kind_t */
+} ftp_handoff_set_t;
+
+/** Callbacks of the serving (old) process */
+typedef struct {
+  /**
+   * Persist caches and fill @p set with the listeners to hand over.
+   * @return 0 to hand over, -1 to refuse
+   */
+  int (*collect)(ftp_handoff_set_t *set, void *user);
+  /**
+   * The peer answered.  @p adopted = 1: stop accepting and drain;
+   * 0: take back anything collect() gave away.
+   */
+  void (*done)(const ftp_handoff_set_t *set, int adopted, void *user);
+  void *user;
+} ftp_handoff_ops_t;
+
+/**
+ * @brief Add a listener to @p set
+ *
+ * @return 0, or -1 when the set is full
+ */
+int ftp_handoff_add(ftp_handoff_set_t *set, int fd, ftp_handoff_kind_t kind);
+
+/**
+ * @brief Copy the fds of one kind out of @p set
+ *
+ * @return Number stored (at most @p max)
+ */
+uint32_t ftp_handoff_pick(const ftp_handoff_set_t *set,
+                          ftp_handoff_kind_t kind, int *fds, uint32_t max);
+
+/**
+ * @brief Send @p set over a connected UNIX socket (one message)
+ *
+ * @return 0, or -1 (errno set)
+ */
+int ftp_handoff_send(int sock, const ftp_handoff_set_t *set);
+
+/**
+ * @brief Receive a set sent by ftp_handoff_send()
+ *
+ * Anything that is not a listening stream socket fails the message.
+ *
+ * @return 0 with the received fds in @p set (owned by the caller), or -1
+ *         (nothing left open)
+ */
+int ftp_handoff_recv(int sock, ftp_handoff_set_t *set);
+
+/**
+ * @brief Offer this process's listeners on @p path
+ *
+ * Replaces a stale socket file.  The parent directory is created 0700
+ * when missing and must otherwise belong to this user and be closed to
+ * group and others.  Requests from another user are refused.  The
+ * serving thread stops after one successful hand-off (the path then
+ * belongs to the new process) or at ftp_handoff_serve_stop().
+ *
+ * @return FTP_OK, FTP_ERR_INVALID_PARAM ("" or over-long path),
+ *         FTP_ERR_PERMISSION (directory not private), FTP_ERR_SOCKET_*
+ *         or FTP_ERR_THREAD_CREATE
+ */
+ftp_error_t ftp_handoff_serve(const char *path, const ftp_handoff_ops_t *ops);
+
+/** @brief Stop serving and remove the socket file (if still ours) */
+void ftp_handoff_serve_stop(void);
+
+/** @brief 1 once a hand-off completed (done(adopted = 1) returned) */
+int ftp_handoff_released(void);
+
+/**
+ * @brief Take the listeners of the instance serving @p path
+ *
+ * @param set  Received listeners (owned by the caller)
+ * @param link Connection to confirm on (ftp_handoff_confirm())
+ *
+ * @return FTP_OK, FTP_ERR_NOT_FOUND (nobody serving, or the directory is
+ *         not private), FTP_ERR_PERMISSION (served by another user),
+ *         FTP_ERR_TIMEOUT or FTP_ERR_PROTOCOL
+ */
+ftp_error_t ftp_handoff_take(const char *path, ftp_handoff_set_t *set,
+                             int *link);
+
+/**
+ * @brief Tell the old process whether the listeners were adopted
+ *
+ * @p adopted = 1 once this process accepts on them; 0 gives them back
+ * (close this process's copies first).  Closes @p link.
+ */
+void ftp_handoff_confirm(int link, int adopted);
+
+#endif /* FTP_HANDOFF_H */
@@ -0,0 +1,163 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_hash.h
+ * @brief File digests for HASH / XCRC / XMD5 / XSHA1 / XSHA256
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Streaming digests (CRC-32, MD5, SHA-1, SHA-256), a read pipeline that
+ * overlaps disk reads with hashing, and a small digest index keyed by
+ * (path, size, mtime) so that verifying an unchanged file again does not
+ * re-read it.
+ *
+ *   reader thread ──pal_ring──► ftp_hash_update() ──► digest
+ *                                              │
+ *                         (path,size,mtime) ◄──┘ ftp_hash_cache_store()
+ *
+ * KERNELS:
+ *   CRC-32   slicing-by-8; ARMv8 CRC32 instructions when available
+ *   SHA-256  SHA-NI (x86 CPUID leaf 7) with scalar fallback
+ *   MD5/SHA-1 scalar
+ *
+ * THREAD SAFETY: contexts are per caller; the digest index is
+ * mutex-protected.
+ */
+
+#ifndef FTP_HASH_H
+#define FTP_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  FTP_HASH_CRC32 = 0,
+  FTP_HASH_MD5 = 1,
+  FTP_HASH_SHA1 = 2,
+  FTP_HASH_SHA256 = 3,
+  FTP_HASH_ALGO_COUNT
+} ftp_hash_algo_t;
+
+/** Largest digest (SHA-256) */
+#define FTP_HASH_MAX_DIGEST 32U
+
+/** Hex digest buffer size including NUL */
+#define FTP_HASH_HEX_MAX ((FTP_HASH_MAX_DIGEST * 2U) + 1U)
+
+typedef struct {
+  ftp_hash_algo_t algo;
+  uint32_t h[8];      /**< Chaining state (h[0] = CRC register) */
+  uint64_t total;     /**< Bytes hashed so far                  */
+  uint8_t block[64];  /**< Partial block                        */
+  uint32_t block_len; /**< Bytes in block[]                     */
+} ftp_hash_ctx_t;
+
+/** @brief Protocol name ("SHA-256", "CRC32", ...) */
+const char *ftp_hash_name(ftp_hash_algo_t algo);
+
+/**
+ * @brief Parse a protocol name (case-insensitive, "SHA256" accepted)
+ *
+ * @return 0 on success, -1 if unknown
+ */
+int ftp_hash_from_name(const char *name, ftp_hash_algo_t *algo);
+
+/** @brief Digest length in bytes */
+size_t ftp_hash_digest_len(ftp_hash_algo_t algo);
+
+void ftp_hash_init(ftp_hash_ctx_t *ctx, ftp_hash_algo_t algo);
+void ftp_hash_update(ftp_hash_ctx_t *ctx, const void *data, size_t len);
+
+/**
+ * @brief Finish and write ftp_hash_digest_len() bytes to @p out
+ *
+ * CRC-32 is written big-endian, i.e. its usual hex rendering.
+ */
+void ftp_hash_final(ftp_hash_ctx_t *ctx, uint8_t out[FTP_HASH_MAX_DIGEST]);
+
+/** @brief Lowercase hex of @p len digest bytes */
+void ftp_hash_hex(const uint8_t *digest, size_t len, char *out,
+                  size_t out_size);
+
+/** @brief Kernel in use for @p algo ("sha-ni", "slice8", ...) */
+const char *ftp_hash_kernel_name(ftp_hash_algo_t algo);
+
+/**
+ * @brief Force the portable kernels (tests/benchmarks)
+ *
+ * @param scalar Nonzero to disable SHA-NI / ARMv8 CRC
+ */
+void ftp_hash_force_scalar(int scalar);
+
+/**
+ * @brief Digest a whole open file through the read pipeline
+ *
+ * A reader thread fills pal_ring buffers while the caller hashes; falls
+ * back to a plain read loop if the thread cannot be started.
+ *
+ * @param fd    Open file, read from offset 0
+ * @param algo  Algorithm
+ * @param out   Digest (ftp_hash_digest_len() bytes)
+ * @param bytes Bytes hashed (may be NULL)
+ *
+ * @return 0 on success, -1 on read error (errno set)
+ */
+int ftp_hash_fd(int fd, ftp_hash_algo_t algo, uint8_t out[FTP_HASH_MAX_DIGEST],
+                uint64_t *bytes);
+
+/*===========================================================================*
+ * DIGEST INDEX
+ *===========================================================================*/
+
+/**
+ * @brief Look up a digest computed for this exact file version
+ *
+ * @return 1 on hit (digest copied to @p out), 0 on miss
+ */
+int ftp_hash_cache_lookup(const char *path, ftp_hash_algo_t algo,
+                          uint64_t size, int64_t mtime,
+                          uint8_t out[FTP_HASH_MAX_DIGEST]);
+
+/**
+ * @brief Remember a digest (LRU if full) and persist the index
+ */
+void ftp_hash_cache_store(const char *path, ftp_hash_algo_t algo,
+                          uint64_t size, int64_t mtime,
+                          const uint8_t digest[FTP_HASH_MAX_DIGEST]);
+
+/** @brief Read the on-disk index now instead of on the first lookup */
+void ftp_hash_cache_preload(void);
+
+/**
+ * @brief Drop every entry and re-read the index from @p index_path
+ *
+ * @param index_path On-disk index ("" = memory only, NULL = default
+ *                   FTP_HASH_CACHE_PATH)
+ */
+void ftp_hash_cache_reset(const char *index_path);
+
+#endif /* FTP_HASH_H */
@@ -0,0 +1,214 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_list.h
+ * @brief Directory listing engine (LIST / NLST / MLSD / MLST)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Entries are formatted straight into one pooled stream buffer and
+ * handed to ftp_session_send_data() a full buffer at a time, with the
+ * data socket corked for the duration of the listing:
+ *
+ *   readdir ──► stat ──► ftp_list_format ──► [64 KB batch] ──► send
+ *
+ * One send (and one rate-limit / crypto / TLS / deflate pass) per
+ * batch instead of one per entry.  The formatters avoid snprintf and
+ * gmtime: dates come from a days-to-civil conversion and fixed month
+ * and digit tables.
+ *
+ * THREAD SAFETY: a writer belongs to one session thread; the
+ * formatters are reentrant.
+ */
+
+#ifndef FTP_LIST_H
+#define FTP_LIST_H
+
+#include "ftp_types.h"
+#include "pal_filesystem.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** Used when every pooled stream buffer is taken */
+#define FTP_LIST_FALLBACK_SIZE (FTP_LIST_LINE_SIZE * 4U)
+
+typedef enum {
+  FTP_LIST_NAMES = 0, /**< NLST: "name\r\n"                          */
+  FTP_LIST_UNIX = 1,  /**< LIST: "-rw-r--r-- 1 ftp ftp size date name" */
+  FTP_LIST_MLSD = 2,  /**< MLSD: "type=..;size=..;modify=..; name"     */
+  FTP_LIST_MLST = 3,  /**< MLST: MLSD facts with a leading space       */
+} ftp_list_format_t;
+
+/** Batching writer over the session data connection */
+typedef struct {
+  ftp_session_t *session;
+  char *buf;
+  size_t cap;
+  size_t len;
+  int pooled;      /**< buf came from ftp_buffer_acquire() */
+  ftp_error_t err; /**< First send error, sticky           */
+  char fallback[FTP_LIST_FALLBACK_SIZE];
+} ftp_list_writer_t;
+
+/**
+ * @brief Format one entry
+ *
+ * @param fmt  Output format
+ * @param st   Entry metadata (ignored for FTP_LIST_NAMES)
+ * @param name Display name
+ * @param out  Destination
+ * @param size Destination size
+ *
+ * @return Line length (NUL-terminated, CRLF included), or 0 if it does
+ *         not fit in @p size
+ */
+size_t ftp_list_format(ftp_list_format_t fmt, const vfs_stat_t *st,
+                       const char *name, char *out, size_t size);
+
+/**
+ * @brief Start a batched listing on the open data connection
+ *
+ * Takes a stream buffer from the pool and corks the data socket.
+ */
+void ftp_list_writer_open(ftp_list_writer_t *w, ftp_session_t *session);
+
+/**
+ * @brief Append one formatted entry, flushing first if the batch is full
+ *
+ * @return FTP_OK, FTP_ERR_PATH_TOO_LONG (entry skipped) or the sticky
+ *         send error
+ */
+ftp_error_t ftp_list_writer_add(ftp_list_writer_t *w, ftp_list_format_t fmt,
+                                const vfs_stat_t *st, const char *name);
+
+/**
+ * @brief Flush, uncork and return the buffer
+ *
+ * @return FTP_OK or the first send error
+ */
+ftp_error_t ftp_list_writer_close(ftp_list_writer_t *w);
+
+/**
+ * @brief Stream a whole directory in @p fmt over the data connection
+ *
+ * "." and ".." are skipped.  Entries that cannot be stat'ed (or live
+ * on /dev, /proc, /sys with FTP_LIST_SAFE_MODE) are listed from their
+ * dirent type with zero size and time.
+ *
+ * @return FTP_OK, FTP_ERR_DIR_OPEN or FTP_ERR_SOCKET_SEND
+ */
+ftp_error_t ftp_list_send_directory(ftp_session_t *session, const char *path,
+                                    ftp_list_format_t fmt);
+
+/*===========================================================================*
+ * LISTING CACHE (FTP_LIST_CACHE_ENABLE)
+ *
+ *   key    : resolved directory path
+ *   valid  : dev/ino/mtime of the directory unchanged, age < TTL
+ *   value  : stat array + lazily formatted NLST / LIST / MLSD blobs
+ *
+ * A listing built while any invalidation ran (generation changed) is not
+ * stored, and neither is one whose directory mtime is too recent to be
+ * trusted at one-second granularity.
+ *===========================================================================*/
+
+typedef struct {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t invalidations;
+  uint32_t entries;
+  size_t bytes;
+} ftp_list_cache_stats_t;
+
+/**
+ * @brief Forget cached listings affected by a change to @p path
+ *
+ * Drops the parent directory of @p path, @p path itself and anything
+ * below it, and marks the same directories for a size-index re-read.
+ * Call after the filesystem operation completed.
+ */
+void ftp_list_cache_invalidate(const char *path);
+
+/** @brief Counters and current size */
+void ftp_list_cache_get_stats(ftp_list_cache_stats_t *out);
+
+/** @brief Drop every entry (tests, low-memory handling) */
+void ftp_list_cache_clear(void);
+
+/**
+ * @brief Write the cached listings to @p path (restart hand-off)
+ *
+ * Stat arrays and names only; formatted blobs are rebuilt on demand.
+ * Written through a .tmp file + rename.
+ *
+ * @return Entries written, or -1 on I/O error
+ */
+int ftp_list_cache_save(const char *path);
+
+/**
+ * @brief Load listings written by ftp_list_cache_save()
+ *
+ * An entry is kept only if its directory still has the saved
+ * dev/ino/mtime and it is younger than FTP_LIST_CACHE_TTL_S.
+ *
+ * @return Entries loaded, or -1 if @p path is missing or malformed
+ */
+int ftp_list_cache_load(const char *path);
+
+/*===========================================================================*
+ * SNAPSHOTS — the listing cache for callers other than FTP sessions
+ *===========================================================================*/
+
+/** Pinned, read-only view of one directory */
+typedef struct {
+  size_t count; /**< Entries, "." and ".." excluded, in readdir order */
+  void *entry;  /**< Cache entry (opaque)                             */
+} ftp_list_snapshot_t;
+
+/**
+ * @brief Get every entry of @p path with its stat data
+ *
+ * Served from the listing cache when valid; otherwise the directory is
+ * walked (with the parallel stat crew) and the result is stored under
+ * the same rules as a LIST.  The snapshot stays valid, whatever happens
+ * to the cache, until ftp_list_snapshot_release().
+ *
+ * @return FTP_OK, FTP_ERR_DIR_OPEN or FTP_ERR_OUT_OF_MEMORY
+ */
+ftp_error_t ftp_list_snapshot(const char *path, ftp_list_snapshot_t *snap);
+
+/** @brief Metadata of entry @p i (i < snap->count) */
+const vfs_stat_t *ftp_list_snapshot_stat(const ftp_list_snapshot_t *snap,
+                                         size_t i);
+
+/** @brief Name of entry @p i (i < snap->count) */
+const char *ftp_list_snapshot_name(const ftp_list_snapshot_t *snap, size_t i);
+
+/** @brief Unpin; safe on a zeroed or already released snapshot */
+void ftp_list_snapshot_release(ftp_list_snapshot_t *snap);
+
+#endif /* FTP_LIST_H */
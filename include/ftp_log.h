@@ -10,8 +10,22 @@ typedef enum {
     FTP_LOG_ERROR = 2
 } ftp_log_level_t;
 
+/** Asynchronous session log counters (ftp_log_get_stats) */
+typedef struct {
+    uint64_t queued;  /**< Records put in a ring                 */
+    uint64_t written; /**< Records formatted and written         */
+    uint64_t dropped; /**< Records lost to a full ring           */
+    uint64_t direct;  /**< Records logged synchronously (no ring) */
+    uint32_t rings;   /**< Rings allocated so far                */
+} ftp_log_stats_t;
+
 void ftp_log_line(ftp_log_level_t level, const char *line);
 
+/*
+ * Session records.  With FTP_LOG_ASYNC they are queued as binary records
+ * on the calling thread's ring and written by the log thread; the event
+ * and command names are kept up to 15 characters.
+ */
 void ftp_log_session_event(const ftp_session_t *session,
                            const char *event,
                            ftp_error_t result,
@@ -21,4 +35,9 @@ void ftp_log_session_cmd(const ftp_session_t *session,
                          const char *command,
                          ftp_error_t result);
 
+/** Write every queued session record now (also runs at exit) */
+void ftp_log_flush(void);
+
+void ftp_log_get_stats(ftp_log_stats_t *out);
+
 #endif
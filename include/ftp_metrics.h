@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_metrics.h
+ * @brief Metrics registry: sharded counters and log2 histograms
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Hot paths record into the calling thread's shard; a scrape sums the
+ * shards and renders the Prometheus text exposition format (version
+ * 0.0.4), served by zhttpd as GET /api/metrics.
+ *
+ *   thread ──► shard[t % FTP_METRICS_SHARDS] ──┐
+ *   thread ──► shard[..]                        ├─► ftp_metrics_render()
+ *   thread ──► shard[..]                        ┘
+ *
+ * HISTOGRAMS: FTP_METRICS_BUCKETS power-of-two buckets; bucket i counts
+ * values <= 2^(i+10) in the histogram's unit (ns or bytes/sec), so the
+ * first bound is ~1 us or 1 KiB/s and every bucket doubles.  Values past
+ * the last bound land in +Inf.  Relative error is at most 2x, which is
+ * what capacity planning and regression spotting need, at one atomic add
+ * per observation.
+ *
+ * THREAD SAFETY: all functions may be called from any thread.
+ */
+
+#ifndef FTP_METRICS_H
+#define FTP_METRICS_H
+
+#include "ftp_types.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Event counters */
+typedef enum {
+  FTP_METRIC_SENDFILE_EAGAIN = 0, /**< sendfile() hit EAGAIN            */
+  FTP_METRIC_SENDFILE_STALLS,     /**< Retries exhausted: cooldown began */
+  FTP_METRIC_COOLDOWN_BYTES,      /**< Bytes moved by read()+send()     */
+  FTP_METRIC_TCP_RETRANS,         /**< Retransmits seen on data sockets */
+  FTP_METRIC_SOCKBUF_RESIZES,     /**< Data socket buffers grown        */
+  FTP_METRIC_ZEROCOPY_BYTES,      /**< Bytes sent with MSG_ZEROCOPY     */
+  FTP_METRIC_ZEROCOPY_COPIED,     /**< Zerocopy sends the kernel copied */
+  FTP_METRIC_PREFETCH_FILES,      /**< Files warmed ahead of their RETR */
+  FTP_METRIC_PREFETCH_BYTES,      /**< Bytes those files brought in     */
+  FTP_METRIC_PREFETCH_HITS,       /**< RETRs of a predicted file        */
+  FTP_METRIC_PREFETCH_CANCELLED,  /**< Predictions dropped unrequested  */
+  FTP_METRIC_SEGMENT_FILES,       /**< Files moved by several streams   */
+  FTP_METRIC_SEGMENT_JOINS,       /**< Streams that joined such a file  */
+  FTP_METRIC_COUNTERS
+} ftp_metric_counter_t;
+
+/** Histograms */
+typedef enum {
+  FTP_METRIC_FIRST_BYTE = 0, /**< Transfer command -> first data byte (ns) */
+  FTP_METRIC_PASV_ACCEPT,    /**< Wait for the passive connect (ns)       */
+  FTP_METRIC_RATE_SEND,      /**< Data connection throughput out (B/s)    */
+  FTP_METRIC_RATE_RECV,      /**< Data connection throughput in (B/s)     */
+  FTP_METRIC_TCP_RTT,        /**< Data socket smoothed RTT sample (ns)    */
+  FTP_METRIC_TCP_CWND,       /**< Data socket congestion window (bytes)   */
+  FTP_METRIC_TCP_SENDQ,      /**< Data socket unsent + unacked (bytes)    */
+  FTP_METRIC_SOCKBUF,        /**< Data socket buffer in use (bytes)       */
+  FTP_METRIC_HISTOGRAMS
+} ftp_metric_hist_t;
+
+/** @brief Add @p n to a counter */
+void ftp_metrics_add(ftp_metric_counter_t c, uint64_t n);
+
+/** @brief Summed value of a counter */
+uint64_t ftp_metrics_counter(ftp_metric_counter_t c);
+
+/** @brief Record one value in a histogram */
+void ftp_metrics_observe(ftp_metric_hist_t h, uint64_t value);
+
+/**
+ * @brief Record one command's latency
+ *
+ * @param verb Index into ftp_get_command_table(); indexes at or beyond
+ *             FTP_METRICS_VERBS are ignored
+ * @param ns   Dispatch to handler return
+ */
+void ftp_metrics_command(size_t verb, uint64_t ns);
+
+/**
+ * @brief Record time-to-first-byte once
+ *
+ * @param armed_ns Start time, or 0 once recorded; the first caller that
+ *                 finds it nonzero clears it and records now - start.
+ *
+ * @return 1 if this call recorded it
+ */
+int ftp_metrics_first_byte(_Atomic uint64_t *armed_ns);
+
+/**
+ * @brief Record a finished data connection's throughput
+ *
+ * Connections that moved fewer than FTP_METRICS_RATE_MIN_BYTES are
+ * skipped: a short listing says nothing about the link.
+ */
+void ftp_metrics_transfer(int rx, uint64_t bytes, uint64_t ns);
+
+/** @brief Bucket index of @p value (FTP_METRICS_BUCKETS = +Inf) */
+unsigned ftp_metrics_bucket(uint64_t value);
+
+/**
+ * @brief Render every metric in text exposition format
+ *
+ * @param ctx Server whose counters are included (may be NULL)
+ *
+ * @return Length of the full output, like snprintf(): if it is >= @p cap
+ *         the text was truncated and a buffer of return + 1 is needed
+ */
+size_t ftp_metrics_render(const ftp_server_context_t *ctx, char *buf,
+                          size_t cap);
+
+#endif /* FTP_METRICS_H */
@@ -0,0 +1,137 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_pasv_pool.h
+ * @brief Pre-bound passive listener pool
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * PASV/EPSV used to pay socket + setsockopt + bind + listen per data
+ * connection.  The pool keeps configured listeners open between
+ * transfers and leases them to sessions, so a small-file RETR costs one
+ * accept:
+ *
+ *   PASV ──► lease (idle listener on the control IP) ──► 227/229
+ *   accept / close_data_connection ──► return (drain stale SYNs) ──► idle
+ *
+ * Listeners keep the cmd_PASV setup: SO_REUSEADDR, SO_RCVBUF before
+ * listen() (inherited by accepted sockets), bound to the control
+ * connection's local address rather than INADDR_ANY.
+ *
+ * THREAD SAFETY: all functions may be called from any thread.
+ */
+
+#ifndef FTP_PASV_POOL_H
+#define FTP_PASV_POOL_H
+
+#include <stdint.h>
+
+typedef struct ftp_pasv_pool ftp_pasv_pool_t;
+
+/** Pool counters (ftp_pasv_pool_get_stats) */
+typedef struct {
+  uint32_t slots;   /**< Pool capacity                          */
+  uint32_t idle;    /**< Open listeners waiting for a lease     */
+  uint32_t leased;  /**< Listeners held by sessions             */
+  uint64_t created; /**< Listeners opened for the pool          */
+  uint64_t reused;  /**< Leases served by an idle listener      */
+  uint64_t spilled; /**< Leases served outside the pool (full)  */
+} ftp_pasv_pool_stats_t;
+
+/**
+ * @brief Open one passive listener
+ *
+ * @param ip       Local IPv4 address (host order, 0 = INADDR_ANY)
+ * @param port_min First port to try (0 = kernel-chosen port)
+ * @param port_max Last port to try (ignored when port_min is 0)
+ * @param port_out Bound port (host order)
+ *
+ * @return Listening fd, or negative ftp_error_t
+ */
+int ftp_pasv_listen(uint32_t ip, uint16_t port_min, uint16_t port_max,
+                    uint16_t *port_out);
+
+/**
+ * @brief Create a pool of up to @p slots listeners
+ *
+ * Listeners are opened on first lease, not here.
+ *
+ * @param slots    Pool capacity (> 0)
+ * @param port_min First port of the passive range (0 = ephemeral)
+ * @param port_max Last port of the passive range
+ *
+ * @return Pool, or NULL on invalid arguments / allocation failure
+ */
+ftp_pasv_pool_t *ftp_pasv_pool_create(uint32_t slots, uint16_t port_min,
+                                      uint16_t port_max);
+
+/** Close every listener; no lease may be outstanding.  NULL is ignored. */
+void ftp_pasv_pool_destroy(ftp_pasv_pool_t *pool);
+
+/**
+ * @brief Lease a listener bound to @p ip
+ *
+ * Prefers an idle listener on the same address, then opens one in a
+ * free slot.  When every slot is leased the listener is opened outside
+ * the pool (and closed by ftp_pasv_pool_return).  A NULL pool always
+ * opens a fresh ephemeral listener.
+ *
+ * @return Listening fd, or negative ftp_error_t
+ */
+int ftp_pasv_pool_lease(ftp_pasv_pool_t *pool, uint32_t ip,
+                        uint16_t *port_out);
+
+/**
+ * @brief Give a leased listener back
+ *
+ * Pending connections are accepted and closed so the next lessee cannot
+ * pick up a stale one.  fds the pool does not own are closed.
+ */
+void ftp_pasv_pool_return(ftp_pasv_pool_t *pool, int fd);
+
+/**
+ * @brief Take the idle listeners out of the pool (restart hand-off)
+ *
+ * The slots become free; the caller owns the fds.
+ *
+ * @return Listeners stored in @p fds (at most @p max)
+ */
+uint32_t ftp_pasv_pool_detach_idle(ftp_pasv_pool_t *pool, int *fds,
+                                   uint32_t max);
+
+/**
+ * @brief Add a listener opened elsewhere as an idle slot
+ *
+ * @return 0 when the pool took ownership of @p fd, -1 if it is full, the
+ *         fd is not an IPv4 listener or its port is outside the range
+ */
+int ftp_pasv_pool_adopt(ftp_pasv_pool_t *pool, int fd);
+
+/** Snapshot the counters (zeroes for a NULL pool) */
+void ftp_pasv_pool_get_stats(ftp_pasv_pool_t *pool,
+                             ftp_pasv_pool_stats_t *out);
+
+#endif /* FTP_PASV_POOL_H */
@@ -108,12 +108,45 @@ ftp_error_t ftp_path_normalize(const char *path,
  * @pre size >= FTP_PATH_MAX
  * 
  * @post output contains absolute, normalized path
+ *
+ * @note A single name under the CWD is checked with one fstatat() on
+ *       the session's open cwd descriptor instead of realpath(); recent
+ *       results come from the FTP_PATH_CACHE_ENTRIES cache.  Sessions
+ *       without a paths block always take the full realpath() route.
  */
 ftp_error_t ftp_path_resolve(const ftp_session_t *session,
                               const char *path,
                               char *output,
                               size_t size);
 
+/**
+ * @brief Change the session CWD to an already resolved directory
+ *
+ * Copies @p resolved into session->cwd, closes the held cwd descriptor
+ * and clears the session's resolution cache.  Every CWD change goes
+ * through here.
+ *
+ * @param session Client session
+ * @param resolved Output of ftp_path_resolve() naming a directory
+ *
+ * @return FTP_OK, FTP_ERR_INVALID_PARAM or FTP_ERR_PATH_TOO_LONG
+ */
+ftp_error_t ftp_path_set_cwd(ftp_session_t *session, const char *resolved);
+
+/** @brief Empty resolution cache, no cwd descriptor (new paths block) */
+void ftp_path_cache_init(ftp_session_paths_t *paths);
+
+/** @brief Close the cwd descriptor and empty the cache */
+void ftp_path_cache_release(ftp_session_paths_t *paths);
+
+/**
+ * @brief Invalidate every session's cached resolutions
+ *
+ * Called by ftp_list_cache_invalidate(), which every namespace change
+ * made through the server (FTP or HTTP) already reports to.
+ */
+void ftp_path_cache_invalidate(void);
+
 /**
  * @brief Check if path is within server root
  * 
@@ -0,0 +1,89 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_prefetch.h
+ * @brief Predictive prefetch for mirror-style sequential downloads
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Mirror clients fetch a directory's files one after another in the
+ * order they were listed (or sorted by name).  Each session remembers
+ * its last listing; once FTP_PREFETCH_TRIGGER RETRs in a row follow one
+ * of the two orders, the next FTP_PREFETCH_FILES files are warmed in the
+ * background while the current one is sent:
+ *
+ *   LIST dir ──► ftp_prefetch_listing()    names + sizes, two orders
+ *   RETR a   ──► ftp_prefetch_retr()       a, b in order: pattern
+ *   RETR b   ──►   queue c, d, e, f ──► worker: open + WILLNEED head
+ *   RETR c   ──►   c was warm (hit); queue g
+ *   RETR x   ──►   out of order: queued work dropped, budget returned
+ *
+ * A warmed file costs min(size, FTP_PREFETCH_FILE_MB) of a process-wide
+ * FTP_PREFETCH_BUDGET_MB, returned when the file is requested or the
+ * pattern breaks.  Where fadvise hints are off (PS4) the worker reads
+ * the head instead, checking for cancellation between chunks.
+ *
+ * Counters: zftpd_prefetch_{files,bytes,hits,cancelled}_total.
+ *
+ * THREAD SAFETY: the per-session calls come from the thread serving the
+ * session's commands; the worker only reads a copied path.
+ */
+
+#ifndef FTP_PREFETCH_H
+#define FTP_PREFETCH_H
+
+#include "ftp_types.h"
+#include <stdint.h>
+
+/**
+ * @brief Remember the listing @p session just received
+ *
+ * Regular files of @p dir, taken from the listing cache.  Replaces the
+ * previous listing and drops its queued work.
+ */
+void ftp_prefetch_listing(ftp_session_t *session, const char *dir);
+
+/**
+ * @brief A RETR of @p path is starting
+ *
+ * Follows the pattern, returns this file's budget and queues the files
+ * after it, or drops queued work when the order broke.
+ */
+void ftp_prefetch_retr(ftp_session_t *session, const char *path);
+
+/** @brief Session ends: drop its listing and queued work */
+void ftp_prefetch_session_end(ftp_session_t *session);
+
+/** @brief Bytes reserved by queued or warmed, not yet requested files */
+uint64_t ftp_prefetch_budget_used(void);
+
+/** @brief Wait until no prefetch is queued or running (tests) */
+void ftp_prefetch_quiesce(void);
+
+/** @brief Stop the worker; pending prefetches are dropped */
+void ftp_prefetch_shutdown(void);
+
+#endif /* FTP_PREFETCH_H */
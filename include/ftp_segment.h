@@ -0,0 +1,168 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_segment.h
+ * @brief Server-wide table of files being transferred, for multi-stream
+ *        (segmented) RETR and STOR
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Clients such as lftp pget open several data connections to one file,
+ * each with its own REST offset.  Every RETR and STOR registers its file
+ * here, so those connections are seen as one transfer:
+ *
+ *   STOR #1 (REST 0)   ──► FIRST:  opens (temp name, O_TRUNC, ALLO) ─┐
+ *   STOR #2 (REST n)   ──► JOINED: same fd, pwrite() at n          ◄─┤
+ *   STOR #3 (REST 2n)  ──► JOINED: same fd, pwrite() at 2n         ◄─┘
+ *                          last one out: trim, flush, close, rename
+ *
+ * A STOR that finds its file being opened waits for the open, so the
+ * truncation happens once, before any segment writes.  The largest ALLO
+ * of any segment is reserved once.  The first stream keeps its usual
+ * write paths; joiners write positionally, so the fd position they
+ * share does not matter.  While the first stream writes O_DIRECT (the
+ * flag belongs to the shared open file) a joiner gets its own fd.
+ *
+ * Commit: only the last stream to finish renames the temp file.  When a
+ * stream of a multi-stream upload fails the file is kept (renamed into
+ * place) so the client can send that segment again with REST; a failed
+ * single-stream fresh upload is removed as before.
+ *
+ * RETR streams share nothing but the entry: reads are positional
+ * already.  Both directions report per-file progress (streams, bytes
+ * moved by all of them) through ftp_segment_snapshot().
+ *
+ * THREAD SAFETY: every function may be called from any thread.
+ */
+
+#ifndef FTP_SEGMENT_H
+#define FTP_SEGMENT_H
+
+#include "ftp_types.h"
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef enum {
+  FTP_SEGMENT_ALONE = 0, /**< Not tracked (table full): work as before  */
+  FTP_SEGMENT_FIRST,     /**< Open the file, then ftp_segment_stor_opened() */
+  FTP_SEGMENT_JOINED,    /**< Another STOR holds the file: write seg->fd */
+} ftp_segment_role_t;
+
+/** One stream's hold on a file */
+typedef struct {
+  int slot;     /**< Table entry, -1 = untracked                 */
+  int holder;   /**< Progress slot in the entry, -1 = uncounted   */
+  int fd;       /**< File to write                                */
+  int own_fd;   /**< 1 = fd is private to this stream             */
+  int atomic;   /**< Written under a temp name, renamed on commit */
+  int fresh;    /**< Created by this upload                       */
+  int reserved; /**< ALLO space reserved (untracked streams)      */
+  int direct;   /**< Holds the entry's O_DIRECT right             */
+  char write_path[FTP_PATH_MAX]; /**< Temp or final name          */
+} ftp_segment_t;
+
+/** What ftp_segment_stor_end() leaves to its caller */
+typedef struct {
+  int fd;        /**< Last stream: flush and close this; else -1    */
+  int failed;    /**< Some stream of the file failed                */
+  int segmented; /**< More than one stream wrote the file           */
+  int discard;   /**< Remove write_path                             */
+  int rename;    /**< Move write_path onto the final name           */
+} ftp_segment_end_t;
+
+/** One file in ftp_segment_snapshot() */
+typedef struct {
+  char path[FTP_PATH_MAX];
+  int upload;        /**< 1 = STOR, 0 = RETR                       */
+  uint32_t streams;  /**< Data connections on it now               */
+  uint32_t peak;     /**< Most at once                             */
+  uint64_t bytes;    /**< Moved by all of them since the first one */
+  uint64_t size;     /**< RETR: file size; STOR: reserved or written end */
+  uint64_t age_ms;   /**< Since the first stream started           */
+} ftp_segment_info_t;
+
+/**
+ * @brief Register a STOR of @p path (resolved)
+ *
+ * Waits while another STOR of the same file is still opening it.
+ * FIRST and ALONE callers open the file themselves and report it with
+ * ftp_segment_stor_opened(); JOINED callers find it in @p seg.
+ */
+ftp_segment_role_t ftp_segment_stor_begin(ftp_session_t *session,
+                                          const char *path,
+                                          ftp_segment_t *seg);
+
+/**
+ * @brief Hand the opened file to the table
+ *
+ * @param fd  -1 when the open failed: the hold is dropped and waiting
+ *            STORs open the file themselves
+ */
+void ftp_segment_stor_opened(ftp_segment_t *seg, int fd,
+                             const char *write_path, int atomic, int fresh);
+
+/**
+ * @brief Reserve @p size bytes (ALLO) once for all streams of the file
+ *
+ * @return FTP_OK, FTP_ERR_NOT_SUPPORTED (no fallocate; the file grows),
+ *         FTP_ERR_FILE_WRITE (out of space)
+ */
+ftp_error_t ftp_segment_reserve(ftp_segment_t *seg, uint64_t size);
+
+/**
+ * @brief May this stream switch the shared fd to O_DIRECT?
+ *
+ * @return 1 (held until ftp_segment_direct_end()) when it is the only
+ *         stream of its file, else 0
+ */
+int ftp_segment_direct_begin(ftp_segment_t *seg);
+
+void ftp_segment_direct_end(ftp_segment_t *seg);
+
+/**
+ * @brief Drop a STOR's hold
+ *
+ * @param ok   this stream's result
+ * @param end  file offset it wrote up to, -1 = nothing written
+ * @param res  trimming is done here; the rest is the caller's
+ */
+void ftp_segment_stor_end(ftp_segment_t *seg, int ok, off_t end,
+                          ftp_segment_end_t *res);
+
+/** @brief Count a RETR of @p path (@p size bytes) in its file's progress */
+void ftp_segment_retr_begin(ftp_session_t *session, const char *path,
+                            uint64_t size, ftp_segment_t *seg);
+
+void ftp_segment_retr_end(ftp_segment_t *seg);
+
+/**
+ * @brief Files being transferred now, most streams first
+ *
+ * @return entries written to @p out (at most @p max)
+ */
+size_t ftp_segment_snapshot(ftp_segment_info_t *out, size_t max);
+
+#endif /* FTP_SEGMENT_H */
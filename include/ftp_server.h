@@ -30,8 +30,10 @@ SOFTWARE.
  * @version 1.0.0
  * @date 2026-02-13
  * 
- * ARCHITECTURE: Single listener thread + thread-per-client sessions
- * CONCURRENCY: Fixed session pool (FTP_MAX_SESSIONS)
+ * ARCHITECTURE: Single listener thread + thread-per-client sessions,
+ *               or the event engine (ftp_server_set_event_engine)
+ * CONCURRENCY: Session pool grown on demand up to a runtime limit
+ *              (at most FTP_MAX_SESSIONS), lock-free slot free list
  * 
  */
 
@@ -73,6 +75,25 @@ ftp_error_t ftp_server_init(ftp_server_context_t *ctx,
                               uint16_t port,
                               const char *root_path);
 
+/**
+ * @brief Initialize FTP server on listeners that are already open
+ *
+ * For a process taking over from a running instance (ftp_handoff.h):
+ * nothing is bound, the port never closes.  With more than one fd each
+ * gets its own acceptor thread, as with ftp_server_set_acceptors();
+ * the acceptor count is then fixed.
+ *
+ * @param fds       Listening IPv4 sockets on the same address (1..
+ *                  FTP_ACCEPT_THREADS_MAX), owned by the server from
+ *                  here on (also on failure)
+ * @param count     Number of fds
+ * @param root_path Server root directory
+ *
+ * @return FTP_OK, FTP_ERR_INVALID_PARAM (bad fds) or as ftp_server_init()
+ */
+ftp_error_t ftp_server_init_fds(ftp_server_context_t *ctx, const int *fds,
+                                uint32_t count, const char *root_path);
+
 /**
  * @brief Start FTP server (begin accepting connections)
  * 
@@ -109,6 +130,24 @@ ftp_error_t ftp_server_start(ftp_server_context_t *ctx);
  */
 void ftp_server_stop(ftp_server_context_t *ctx);
 
+/**
+ * @brief Control-port listeners, for handing them to another process
+ *
+ * @return Number of fds stored (at most @p max), 0 once released
+ */
+uint32_t ftp_server_listeners(const ftp_server_context_t *ctx, int *fds,
+                              uint32_t max);
+
+/**
+ * @brief Stop accepting but keep serving the open sessions
+ *
+ * Joins the accept thread(s), starts whatever they already queued and
+ * closes this process's listener descriptors without shutdown(), so a
+ * process holding copies keeps accepting on the same sockets.  Follow
+ * with ftp_server_stop() once the sessions have drained.
+ */
+void ftp_server_release_listeners(ftp_server_context_t *ctx);
+
 /**
  * @brief Cleanup server resources
  * 
@@ -122,6 +161,81 @@ void ftp_server_stop(ftp_server_context_t *ctx);
  */
 void ftp_server_cleanup(ftp_server_context_t *ctx);
 
+/**
+ * @brief Set the runtime session limit
+ * 
+ * @param ctx          Server context (after ftp_server_init)
+ * @param max_sessions 1..FTP_MAX_SESSIONS concurrent sessions
+ * 
+ * @return FTP_OK, or FTP_ERR_INVALID_PARAM if out of range
+ * 
+ * @note Slots are allocated when first needed, never up front
+ */
+ftp_error_t ftp_server_set_max_sessions(ftp_server_context_t *ctx,
+                                        uint32_t max_sessions);
+
+/**
+ * @brief Choose the session engine
+ * 
+ * @param ctx    Server context (after ftp_server_init)
+ * @param enable 1 = event engine (ftp_engine.h), 0 = thread per session
+ * 
+ * @return FTP_OK, or FTP_ERR_INVALID_PARAM once the server is running
+ * 
+ * @note Defaults to FTP_SESSION_ENGINE_EVENT
+ */
+ftp_error_t ftp_server_set_event_engine(ftp_server_context_t *ctx,
+                                        int enable);
+
+/**
+ * @brief Choose the number of control-port acceptor threads
+ * 
+ * @param ctx       Server context (after ftp_server_init)
+ * @param acceptors 1..FTP_ACCEPT_THREADS_MAX; K > 1 opens K SO_REUSEPORT
+ *                  listeners at ftp_server_start()
+ * 
+ * @return FTP_OK, or FTP_ERR_INVALID_PARAM when out of range, when the
+ *         server is running, or when the platform lacks SO_REUSEPORT
+ * 
+ * @note Defaults to FTP_ACCEPT_THREADS
+ */
+ftp_error_t ftp_server_set_acceptors(ftp_server_context_t *ctx,
+                                     uint32_t acceptors);
+
+/**
+ * @brief Change the control-port listen() backlog
+ * 
+ * @param ctx     Server context (after ftp_server_init)
+ * @param backlog Pending connections per listener (> 0)
+ * 
+ * @return FTP_OK, or FTP_ERR_INVALID_PARAM / FTP_ERR_SOCKET_LISTEN
+ * 
+ * @note Takes effect immediately on open listeners (listen() again)
+ */
+ftp_error_t ftp_server_set_listen_backlog(ftp_server_context_t *ctx,
+                                          uint32_t backlog);
+
+#if FTP_ENABLE_TLS
+/**
+ * @brief Load a certificate and enable AUTH TLS (FTPS)
+ * 
+ * @param ctx       Server context (after ftp_server_init)
+ * @param cert_file PEM certificate chain
+ * @param key_file  PEM private key (NULL = key is in cert_file)
+ * 
+ * @return FTP_OK on success, FTP_ERR_FILE_OPEN if the pair cannot be loaded
+ * 
+ * @pre ctx != NULL
+ * @pre cert_file != NULL
+ * @pre Server not started yet
+ * 
+ * @note Kernel TLS offload is requested when FTP_TLS_KTLS is set.
+ */
+ftp_error_t ftp_server_enable_tls(ftp_server_context_t *ctx,
+                                  const char *cert_file,
+                                  const char *key_file);
+#endif
+
 /*===========================================================================*
  * SERVER CONTROL
  *===========================================================================*/
@@ -164,6 +278,35 @@ void ftp_server_get_stats(const ftp_server_context_t *ctx,
                             uint64_t *bytes_sent,
                             uint64_t *bytes_received);
 
+/**
+ * Server counters (ftp_server_get_stats_ex)
+ */
+typedef struct {
+  uint64_t total_connections;     /**< Sessions started                 */
+  uint64_t bytes_sent;            /**< Sum over session slots           */
+  uint64_t bytes_received;        /**< Sum over session slots           */
+  uint32_t total_errors;          /**< Rejected / failed starts         */
+  uint32_t acceptors;             /**< Acceptor threads                 */
+  uint32_t listen_backlog;        /**< Current listen() backlog         */
+  uint32_t connections_per_sec;   /**< Starts in the last full second   */
+  uint64_t accept_latency_avg_ns; /**< accept() -> session running      */
+  uint64_t accept_latency_max_ns; /**< Worst case since start           */
+  uint32_t start_queue_depth;     /**< Accepted, not yet started        */
+  uint32_t start_queue_peak;      /**< Deepest start queue seen         */
+} ftp_server_stats_t;
+
+/**
+ * @brief Get server statistics, including the acceptor counters
+ * 
+ * @param ctx Server context
+ * @param out Filled in
+ * 
+ * @pre ctx != NULL
+ * @pre out != NULL
+ */
+void ftp_server_get_stats_ex(const ftp_server_context_t *ctx,
+                             ftp_server_stats_t *out);
+
 /*===========================================================================*
  * SESSION POOL MANAGEMENT (called by session threads)
  *===========================================================================*/
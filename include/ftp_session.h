@@ -31,7 +31,8 @@ SOFTWARE.
  * @date 2026-02-13
  * 
  * DESIGN: Thread-per-client model with session pool
- * THREADING: Each session runs in dedicated thread
+ * THREADING: Each session runs in dedicated thread, or on the event
+ *            engine (ftp_engine.h) built from the same begin/serve/end steps
  * 
  */
 
@@ -103,6 +104,73 @@ void ftp_session_cleanup(ftp_session_t *session);
  */
 void* ftp_session_thread(void *arg);
 
+/**
+ * Result of serving one control command
+ */
+typedef enum {
+    FTP_SESSION_STEP_END  = 0, /**< QUIT, EOF or fatal error: end session  */
+    FTP_SESSION_STEP_MORE = 1, /**< Command processed                      */
+    FTP_SESSION_STEP_IDLE = 2, /**< No complete command within the timeout */
+} ftp_session_step_t;
+
+/**
+ * @brief Start a session: send the 220 greeting and log CONNECT
+ * 
+ * @param session Client session (after ftp_session_init)
+ */
+void ftp_session_begin(ftp_session_t *session);
+
+/**
+ * @brief Read and execute one command line
+ * 
+ * Blocks for at most FTP_CTRL_IO_TIMEOUT_MS when no full line is buffered.
+ * 
+ * @param session Client session
+ * 
+ * @return FTP_SESSION_STEP_* (see ftp_session_step_t)
+ */
+ftp_session_step_t ftp_session_serve_command(ftp_session_t *session);
+
+/**
+ * @brief Check the FTP_SESSION_TIMEOUT idle limit
+ * 
+ * @param session Client session
+ * @param now     Current time(NULL)
+ * 
+ * @return 1 if the session has been idle too long, 0 otherwise
+ * 
+ * @note Thread-safety: Only reads last_activity; safe from a watcher thread
+ */
+int ftp_session_idle_expired(const ftp_session_t *session, time_t now);
+
+/**
+ * @brief Tell the client it timed out (421) and log IDLE_TIMEOUT
+ * 
+ * @param session Client session
+ */
+void ftp_session_expire(ftp_session_t *session);
+
+/**
+ * @brief Check for control input that can be read without blocking
+ * 
+ * Covers bytes buffered in ctrl_rxbuf, decrypted TLS records and the
+ * socket itself (including EOF/errors).
+ * 
+ * @param session Client session
+ * 
+ * @return 1 if ftp_session_serve_command() has something to read
+ */
+int ftp_session_input_pending(ftp_session_t *session);
+
+/**
+ * @brief Finish a session: cleanup, log DISCONNECT, release the slot
+ * 
+ * @param session Client session
+ * 
+ * @post session must not be touched again (the slot may be reused)
+ */
+void ftp_session_end(ftp_session_t *session);
+
 /*===========================================================================*
  * REPLY SENDING
  *===========================================================================*/
@@ -150,6 +218,20 @@ ftp_error_t ftp_session_send_multiline_reply(ftp_session_t *session,
                                                const char **lines,
                                                size_t count);
 
+/**
+ * @brief Send raw bytes on the control connection
+ * 
+ * Goes through the control TLS session after AUTH TLS.
+ * 
+ * @param session Client session
+ * @param data    Bytes to send
+ * @param len     Number of bytes
+ * 
+ * @return FTP_OK if all bytes were sent, FTP_ERR_SOCKET_SEND otherwise
+ */
+ftp_error_t ftp_session_send_control(ftp_session_t *session,
+                                       const void *data, size_t len);
+
 /*===========================================================================*
  * DATA CONNECTION MANAGEMENT
  *===========================================================================*/
@@ -185,6 +267,44 @@ ftp_error_t ftp_session_open_data_connection(ftp_session_t *session);
  */
 void ftp_session_close_data_connection(ftp_session_t *session);
 
+/**
+ * @brief Give the passive listener back to the server's pool
+ *
+ * Closes it when it is not pooled (no server context, pool disabled or
+ * full).  No-op when there is no listener.
+ *
+ * @post session->pasv_fd == -1
+ */
+void ftp_session_release_pasv(ftp_session_t *session);
+
+/**
+ * @brief Note that data bytes moved (time-to-first-byte)
+ *
+ * Records the first byte since the data connection opened in the
+ * metrics and the transfer timeline; later calls cost one load.
+ */
+void ftp_session_note_first_byte(ftp_session_t *session);
+
+#if FTP_ENABLE_TLS
+/**
+ * @brief Run the TLS handshake on the data connection (PROT P)
+ * 
+ * Clients start the handshake only after the 150 reply, so it cannot be
+ * part of ftp_session_open_data_connection() (LIST opens before 150).
+ * Every data command calls it once the connection is open and 150 is
+ * out, so an empty listing or file is still secured; send_data() and
+ * recv_data() call it lazily as a fallback.
+ * 
+ * @param session Client session
+ * 
+ * @return FTP_OK (also when PROT C or already secured),
+ *         FTP_ERR_SOCKET_ACCEPT if the handshake failed
+ * 
+ * @pre session->data_fd >= 0
+ */
+ftp_error_t ftp_session_start_data_tls(ftp_session_t *session);
+#endif
+
 /**
  * @brief Send data via data connection
  * 
@@ -205,6 +325,23 @@ ssize_t ftp_session_send_data(ftp_session_t *session,
                                 const void *buffer,
                                 size_t length);
 
+/**
+ * @brief Send a pool buffer, letting the kernel keep it (MSG_ZEROCOPY)
+ * 
+ * Same as ftp_session_send_data() for @p length bytes at *buffer.  When
+ * the send can go out zerocopy (FTP_ZEROCOPY), the session keeps the
+ * buffer until the kernel releases it and *buffer is replaced by a
+ * fresh pool buffer of @p cap bytes; the caller goes on filling and
+ * finally releasing whatever *buffer points to.
+ * 
+ * @param buffer In/out: buffer from ftp_buffer_acquire[_size]()
+ * @param cap    Its size
+ * 
+ * @return Number of bytes sent, or negative error code
+ */
+ssize_t ftp_session_send_buffer(ftp_session_t *session, void **buffer,
+                                size_t cap, size_t length);
+
 /**
  * @brief Receive data via data connection
  * 
@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_stat_cache.h
+ * @brief Short-TTL file metadata cache shared by all sessions
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * A client typically sends SIZE, MDTM and RETR for every file, and each
+ * used to stat the same path again.  On PFS a stat is slow; one is
+ * enough:
+ *
+ *   ftp_path_resolve ──► fstatat ──► store ─┐
+ *   SIZE / MDTM / MLST / RETR ──► lookup ◄──┘  miss: vfs_stat + store
+ *
+ * The table is split into FTP_STAT_CACHE_SHARDS shards by path hash,
+ * each with its own lock and FTP_STAT_CACHE_ENTRIES / SHARDS slots; a
+ * full shard replaces its oldest entry.  Paths longer than
+ * FTP_STAT_CACHE_KEY_MAX and failed stats are not cached.
+ *
+ * Invalidation: ftp_stat_cache_invalidate() (called by
+ * ftp_list_cache_invalidate(), so by every command that changes the
+ * tree) drops the path, everything below it and its parent directory,
+ * and bumps a generation so a stat that raced with the change is not
+ * stored.  Entries expire after FTP_STAT_CACHE_TTL_MS regardless.
+ *
+ * THREAD SAFETY: every function may be called from any thread.
+ */
+
+#ifndef FTP_STAT_CACHE_H
+#define FTP_STAT_CACHE_H
+
+#include "pal_filesystem.h"
+#include <stdint.h>
+
+typedef struct {
+  uint64_t hits;          /**< Lookups answered from the cache     */
+  uint64_t misses;        /**< Lookups that had to stat            */
+  uint64_t invalidations; /**< Entries dropped by changes          */
+  uint32_t entries;       /**< Entries currently held              */
+} ftp_stat_cache_stats_t;
+
+/**
+ * @brief vfs_stat() through the cache
+ *
+ * @return vfs_stat()'s result; only FTP_OK results are cached
+ */
+ftp_error_t ftp_stat_cache_stat(const char *path, vfs_stat_t *out);
+
+/** @brief Current generation, read before a stat meant for _store() */
+uint32_t ftp_stat_cache_generation(void);
+
+/**
+ * @brief Remember @p st for @p path
+ *
+ * Ignored when the generation moved past @p gen since the stat was
+ * taken (a change may have raced with it).
+ */
+void ftp_stat_cache_store(const char *path, const vfs_stat_t *st,
+                          uint32_t gen);
+
+/** @brief Drop @p path, everything below it and its parent directory */
+void ftp_stat_cache_invalidate(const char *path);
+
+/** @brief Counters and current size */
+void ftp_stat_cache_get_stats(ftp_stat_cache_stats_t *out);
+
+/** @brief Drop every entry (tests) */
+void ftp_stat_cache_clear(void);
+
+#endif /* FTP_STAT_CACHE_H */
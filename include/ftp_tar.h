@@ -0,0 +1,169 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_tar.h
+ * @brief ustar archive framing for SITE MRETR / SITE MSTOR
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * WRITER: builds the 512-byte member headers of a POSIX ustar stream.
+ * File bodies are not copied through here: the caller sends a header,
+ * the body (sendfile), then ftp_tar_padding() zero bytes.
+ *
+ * READER: a push parser.  Feed it the stream in chunks of any size as
+ * they arrive; it calls the sink for each member header and hands out
+ * body bytes straight from the caller's buffer (no copy).
+ *
+ *   recv() ──► ftp_tar_reader_feed() ──► begin(entry) data()* end()
+ *
+ *   [hdr][body .. pad] [hdr][body .. pad] ... [zero block][zero block]
+ *
+ * NAMES:  <= 100 bytes in name[]; <= 255 split across prefix[]/name[] at
+ *         a '/'; longer names are preceded by a GNU 'L' long-name record
+ *         (GNU tar, bsdtar and Python's tarfile all read it).
+ * SIZES:  octal up to 8 GiB - 1, GNU base-256 above.
+ * READ:   ustar, GNU ('L' long names) and pax ('x' path/size records;
+ *         'g' global records are ignored).
+ *
+ * THREAD SAFETY: stateless.
+ */
+
+#ifndef FTP_TAR_H
+#define FTP_TAR_H
+
+#include "ftp_config.h"
+#include "ftp_types.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** Archive block size */
+#define FTP_TAR_BLOCK 512U
+
+/** End-of-archive marker: two zero blocks */
+#define FTP_TAR_TRAILER (FTP_TAR_BLOCK * 2U)
+
+typedef enum {
+  FTP_TAR_FILE = '0',
+  FTP_TAR_DIR = '5',
+} ftp_tar_type_t;
+
+typedef struct {
+  const char *name;    /**< Member name, relative, '/'-separated */
+  uint64_t size;       /**< Body length (0 for directories)      */
+  uint32_t mode;       /**< Permission bits                      */
+  int64_t mtime;       /**< Seconds since the epoch              */
+  ftp_tar_type_t type;
+} ftp_tar_member_t;
+
+/**
+ * @brief Header bytes needed for a member name (1 block, or 3+ with a
+ *        long-name record); 0 if the name is empty
+ */
+size_t ftp_tar_header_size(const char *name, ftp_tar_type_t type);
+
+/**
+ * @brief Encode the header(s) for one member
+ *
+ * Directory names get a trailing '/' if they lack one.
+ *
+ * @return Bytes written (a multiple of FTP_TAR_BLOCK), 0 if @p cap is
+ *         too small or the member is invalid
+ */
+size_t ftp_tar_header(void *out, size_t cap, const ftp_tar_member_t *m);
+
+/** @brief Zero bytes that follow a body of @p size bytes */
+size_t ftp_tar_padding(uint64_t size);
+
+/*===========================================================================*
+ * READER
+ *===========================================================================*/
+
+/** Longest member name the reader accepts (bytes, including NUL) */
+#define FTP_TAR_NAME_MAX FTP_PATH_MAX
+
+typedef struct {
+  char name[FTP_TAR_NAME_MAX]; /**< As stored: may be absolute or hold ".." */
+  uint64_t size;
+  uint32_t mode;
+  int64_t mtime;
+  char type; /**< Raw typeflag: '0' file, '5' dir, '1'/'2' links, ...  */
+} ftp_tar_entry_t;
+
+/**
+ * Member callbacks.  A negative return aborts the parse and is returned
+ * by ftp_tar_reader_feed().
+ */
+typedef struct {
+  /** Header parsed: 0 = deliver the body, 1 = skip it */
+  int (*begin)(void *ctx, const ftp_tar_entry_t *entry);
+  /** Body bytes (only after begin() returned 0) */
+  int (*data)(void *ctx, const void *buf, size_t len);
+  /** Body complete (only after begin() returned 0) */
+  int (*end)(void *ctx);
+  void *ctx;
+} ftp_tar_sink_t;
+
+typedef struct {
+  ftp_tar_sink_t sink;
+  ftp_tar_entry_t entry;
+  uint8_t block[FTP_TAR_BLOCK]; /* header being assembled */
+  size_t have;                  /* bytes in block[]       */
+  uint64_t left;                /* body bytes to come     */
+  size_t pad;                   /* padding after the body */
+  int state;
+  int skip;
+  char ext_kind;                /* 'L', 'x' or 'g' record being read */
+  size_t ext_len;
+  char ext[FTP_TAR_NAME_MAX + 256U];
+  int next_name;                /* ext[] holds a name for the next header */
+  uint64_t next_size;
+  int has_next_size;
+  uint32_t zero_blocks;
+} ftp_tar_reader_t;
+
+/** @brief Reset @p r to the start of an archive */
+void ftp_tar_reader_init(ftp_tar_reader_t *r, const ftp_tar_sink_t *sink);
+
+/**
+ * @brief Parse the next @p len bytes of the stream
+ *
+ * @return FTP_OK, FTP_ERR_PROTOCOL (bad checksum / record),
+ *         FTP_ERR_PATH_TOO_LONG, or a sink's negative return
+ */
+ftp_error_t ftp_tar_reader_feed(ftp_tar_reader_t *r, const void *data,
+                                size_t len);
+
+/**
+ * @brief Check the stream ended cleanly
+ *
+ * @return FTP_OK after the end-of-archive blocks, or at a member boundary
+ *         (archivers that omit the trailer); FTP_ERR_PROTOCOL when the
+ *         stream stopped inside a header or body
+ */
+ftp_error_t ftp_tar_reader_finish(const ftp_tar_reader_t *r);
+
+#endif /* FTP_TAR_H */
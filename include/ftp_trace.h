@@ -0,0 +1,163 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_trace.h
+ * @brief Per-transfer timelines (SITE TRACE, /api/trace)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Each RETR/STOR/APPE records a compact timeline in its session; when the
+ * transfer ends the timeline is copied into a server-wide ring of the
+ * FTP_TRACE_HISTORY most recent ones.
+ *
+ *   RETR /data/game.pkg ok 12884901888B 61200.0ms
+ *    +0.3ms open 0.3ms
+ *    +4.1ms connect 3.7ms
+ *    +4.2ms first-byte
+ *    +4.2ms sendfile 9013.0ms 29360128B x112
+ *    +9017.2ms stall 200.1ms
+ *    +9217.3ms cooldown 210.0ms 1048576B x4
+ *    ...
+ *    +61200.0ms close 12884901888B
+ *
+ * Disk trouble shows up as stalls, cooldowns and STOR writer lag;
+ * network trouble as a late connect or first byte and long sendfile
+ * bursts at a low rate.
+ *
+ * Spans (sendfile, cooldown, writer lag) extend the previous event of
+ * the same kind when they follow it within FTP_TRACE_MERGE_MS, so a burst
+ * of thousands of calls is one event.  A timeline holds at most
+ * FTP_TRACE_EVENTS events; the last slot is kept for close and further
+ * events are only counted.
+ *
+ * THREAD SAFETY: a timeline belongs to its session thread; the history
+ * ring is locked.
+ */
+
+#ifndef FTP_TRACE_H
+#define FTP_TRACE_H
+
+#include "ftp_config.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+/** Event kinds */
+typedef enum {
+  FTP_TRACE_OPEN = 0,   /**< File opened (dur: since the command)     */
+  FTP_TRACE_CONNECT,    /**< Data connection up (dur: connect/accept) */
+  FTP_TRACE_FIRST_BYTE, /**< First data byte moved                    */
+  FTP_TRACE_SENDFILE,   /**< sendfile burst (bytes, count: calls)     */
+  FTP_TRACE_STALL,      /**< sendfile gave up (dur: EAGAIN retries)   */
+  FTP_TRACE_COOLDOWN,   /**< read()+send() window (bytes, count)      */
+  FTP_TRACE_WRITER_LAG, /**< STOR blocked on disk (dur, count: waits) */
+  FTP_TRACE_CLOSE,      /**< Transfer ended (bytes: total)            */
+  FTP_TRACE_KINDS
+} ftp_trace_kind_t;
+
+/** One timeline event */
+typedef struct {
+  uint64_t at_us;  /**< Start, relative to the command            */
+  uint64_t dur_us; /**< Duration (0 for instants)                 */
+  uint64_t bytes;  /**< Bytes moved, kind-dependent               */
+  uint16_t kind;   /**< ftp_trace_kind_t                          */
+  uint16_t count;  /**< Kind-dependent, saturating                */
+  uint32_t _pad;
+} ftp_trace_event_t;
+
+/** One transfer's timeline */
+typedef struct {
+  uint64_t start_ns;   /**< Command start (monotonic), 0 = idle    */
+  time_t wall;         /**< Command start (wall clock)             */
+  uint32_t session_id; /**< Owning session                         */
+  uint16_t events;     /**< Used entries of ev[]                   */
+  uint16_t dropped;    /**< Events that found ev[] full            */
+  uint8_t ok;          /**< Ended with 226                         */
+  char cmd[5];         /**< "RETR", "STOR", "APPE"                 */
+  char path[FTP_TRACE_PATH_MAX]; /**< Path tail                    */
+  ftp_trace_event_t ev[FTP_TRACE_EVENTS];
+} ftp_trace_t;
+
+/** Session filter for ftp_trace_recent(): every session */
+#define FTP_TRACE_ALL_SESSIONS UINT32_MAX
+
+/**
+ * @brief Start a timeline and record the open event
+ *
+ * A timeline still open from an earlier command (one that returned
+ * before ftp_trace_end) is published first, marked failed.
+ *
+ * @param start_ns Command start (monotonic); open latency is measured
+ *                 from here
+ */
+void ftp_trace_begin(ftp_trace_t *t, const char *cmd, const char *path,
+                     uint32_t session_id, uint64_t start_ns);
+
+/** @brief Nonzero between begin and end */
+int ftp_trace_active(const ftp_trace_t *t);
+
+/**
+ * @brief Record an event that started at @p since_ns and ends now
+ *
+ * @param since_ns Monotonic start; 0 = an instant now
+ */
+void ftp_trace_mark(ftp_trace_t *t, ftp_trace_kind_t kind, uint64_t since_ns,
+                    uint64_t bytes, uint32_t count);
+
+/**
+ * @brief Extend (or open) a span that continues from the previous event
+ *
+ * The span runs from the end of the previous event to now.
+ */
+void ftp_trace_span(ftp_trace_t *t, ftp_trace_kind_t kind, uint64_t bytes);
+
+/** @brief Record close and publish the timeline to the history ring */
+void ftp_trace_end(ftp_trace_t *t, int ok, uint64_t bytes);
+
+/**
+ * @brief Copy recent timelines, newest first
+ *
+ * @param session_id Only this session's, or FTP_TRACE_ALL_SESSIONS
+ *
+ * @return Number copied (<= @p max)
+ */
+size_t ftp_trace_recent(uint32_t session_id, ftp_trace_t *out, size_t max);
+
+/** @brief Monotonic clock used for timelines (ns) */
+uint64_t ftp_trace_now_ns(void);
+
+/** @brief Kind name ("open", "sendfile", ...) */
+const char *ftp_trace_kind_name(ftp_trace_kind_t kind);
+
+/**
+ * @brief One event as text: "+4.2ms sendfile 9013.0ms 29360128B x112"
+ *
+ * @return Length written (snprintf semantics)
+ */
+int ftp_trace_format_event(const ftp_trace_event_t *e, char *buf,
+                           size_t cap);
+
+#endif /* FTP_TRACE_H */
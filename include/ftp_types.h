@@ -35,8 +35,18 @@ SOFTWARE.
 #ifndef FTP_TYPES_H
 #define FTP_TYPES_H
 
+#include "ftp_bwsched.h"
 #include "ftp_config.h"
 #include "ftp_crypto.h"
+#include "ftp_trace.h"
+#include "pal_sock_tune.h"
+#include "pal_zerocopy.h"
+#if FTP_ENABLE_TLS
+#include "pal_tls.h"
+#endif
+#if FTP_ENABLE_MODEZ
+#include "ftp_zstream.h"
+#endif
 #include <netinet/in.h>
 #include <pthread.h>
 #include <stdatomic.h>
@@ -78,6 +88,7 @@ typedef enum {
   FTP_ERR_PROTOCOL = -22,      /**< Protocol violation */
   FTP_ERR_DIR_EXISTS = -23,    /**< Directory already exists */
   FTP_ERR_CROSS_DEVICE = -24,  /**< Cross-device link (EXDEV) */
+  FTP_ERR_NOT_SUPPORTED = -25, /**< Facility unavailable on this host */
   FTP_ERR_UNKNOWN = -99,       /**< Unknown error */
 } ftp_error_t;
 
@@ -95,6 +106,7 @@ typedef enum {
 
   /* Positive Completion (2xx) */
   FTP_REPLY_200_OK = 200,                /**< Command okay */
+  FTP_REPLY_202_SUPERFLUOUS = 202,       /**< Not needed at this site */
   FTP_REPLY_211_SYSTEM_STATUS = 211,     /**< System status */
   FTP_REPLY_212_DIR_STATUS = 212,        /**< Directory status */
   FTP_REPLY_213_FILE_STATUS = 213,       /**< File status */
@@ -119,6 +131,7 @@ typedef enum {
   FTP_REPLY_421_SERVICE_UNAVAIL = 421,      /**< Service not available */
   FTP_REPLY_425_CANT_OPEN_DATA = 425,       /**< Can't open data connection */
   FTP_REPLY_426_TRANSFER_ABORTED = 426,     /**< Transfer aborted */
+  FTP_REPLY_431_NEED_SECURITY = 431,        /**< Security resource unavailable */
   FTP_REPLY_450_FILE_UNAVAILABLE = 450,     /**< File unavailable */
   FTP_REPLY_451_LOCAL_ERROR = 451,          /**< Local error */
   FTP_REPLY_452_INSUFFICIENT_STORAGE = 452, /**< Insufficient storage */
@@ -131,6 +144,7 @@ typedef enum {
   FTP_REPLY_504_NOT_IMPL_PARAM = 504,    /**< Not impl for parameter */
   FTP_REPLY_530_NOT_LOGGED_IN = 530,     /**< Not logged in */
   FTP_REPLY_532_NEED_ACCOUNT = 532,      /**< Need account */
+  FTP_REPLY_536_PROT_UNSUPPORTED = 536,  /**< PROT level not supported */
   FTP_REPLY_550_FILE_ERROR = 550,        /**< File unavailable */
   FTP_REPLY_551_PAGE_TYPE_UNKNOWN = 551, /**< Page type unknown */
   FTP_REPLY_552_STORAGE_EXCEEDED = 552,  /**< Storage exceeded */
@@ -177,6 +191,7 @@ typedef enum {
   FTP_MODE_STREAM = 'S',   /**< Stream mode (default) */
   FTP_MODE_BLOCK = 'B',    /**< Block mode (not implemented) */
   FTP_MODE_COMPRESS = 'C', /**< Compressed mode (not implemented) */
+  FTP_MODE_ZLIB = 'Z',     /**< Deflate stream (MODE Z) */
 } ftp_transfer_mode_t;
 
 /**
@@ -219,55 +234,91 @@ typedef struct {
  * circular dependency.
  */
 struct ftp_server_context;
+struct ftp_engine;
+struct ftp_pasv_pool;
+struct ftp_acceptors;
 
 /*===========================================================================*
  * SESSION STRUCTURE
  *===========================================================================*/
 
+/**
+ * Path strings of a live session
+ *
+ * Cold: touched by path resolution and a few commands, never by the
+ * transfer loops.  Taken from a small recycled slab by ftp_session_init()
+ * and returned by ftp_session_cleanup(), so an unused pool slot does not
+ * carry 4 x FTP_PATH_MAX bytes.
+ */
+#if FTP_PATH_CACHE_ENTRIES > 0
+/** One cached ftp_path_resolve() result (see FTP_PATH_CACHE_ENTRIES) */
+typedef struct {
+  uint64_t stamp_ms;                 /**< Monotonic time of the lookup    */
+  uint32_t ns_gen;                   /**< Namespace generation, 0 = empty */
+  uint32_t key_len;
+  char key[FTP_PATH_CACHE_KEY_MAX];  /**< Argument as sent by the client  */
+  char resolved[FTP_PATH_MAX];
+} ftp_path_cache_entry_t;
+#endif
+
+typedef struct ftp_session_paths {
+  struct ftp_session_paths *next_free; /**< Slab free-list link */
+  char root_path[FTP_PATH_MAX];        /**< Server root directory */
+  char cwd[FTP_PATH_MAX];              /**< Current working directory */
+  char rename_from[FTP_PATH_MAX];      /**< RNFR source path */
+  char copy_from[FTP_PATH_MAX];        /**< CPFR source path */
+  int cwd_fd;          /**< cwd opened O_DIRECTORY, -1 until first use */
+  uint32_t cwd_fd_gen; /**< Namespace generation cwd_fd was opened at  */
+#if FTP_PATH_CACHE_ENTRIES > 0
+  uint32_t cache_next; /**< Round-robin replacement index */
+  ftp_path_cache_entry_t cache[FTP_PATH_CACHE_ENTRIES];
+#endif
+} ftp_session_paths_t;
+
 /**
  * FTP client session
  *
- * MEMORY LAYOUT: Optimized for cache-line alignment
- * SIZE: Approximately 2KB per session
+ * MEMORY LAYOUT: hot fields (fds, state, counters) in the first two
+ *                cache lines; path strings live in ftp_session_paths_t
+ * SIZE: Approximately 2KB per session plus the paths block while live
  * THREAD SAFETY: Access from single thread (session thread)
  *
  * @note Structure members ordered to minimize padding
  */
 typedef struct ftp_session {
-  /* Control connection - accessed frequently (cache-hot) */
-  int ctrl_fd;                  /**< Control socket descriptor */
-  struct sockaddr_in ctrl_addr; /**< Client address */
+  /* Hot: touched on every command and transfer */
+  int ctrl_fd;               /**< Control socket descriptor */
+  int data_fd;               /**< Data socket descriptor */
+  int pasv_fd;               /**< Passive listener socket */
+  atomic_int state;          /**< Current session state (atomic queries) */
+  ftp_data_mode_t data_mode; /**< Active/Passive/None */
+  uint32_t pool_slot;        /**< Index in the server session pool */
 
-  /* Data connection */
-  int data_fd;                  /**< Data socket descriptor */
-  int pasv_fd;                  /**< Passive listener socket */
-  struct sockaddr_in data_addr; /**< Data connection address */
-  ftp_data_mode_t data_mode;    /**< Active/Passive/None */
+  /* Statistics */
+  ftp_session_stats_t stats;
 
-  /* Session state - atomic for thread-safe state queries */
-  atomic_int state; /**< Current session state */
+  /* Connection addresses */
+  struct sockaddr_in ctrl_addr; /**< Client address */
+  struct sockaddr_in data_addr; /**< Data connection address */
 
   /* Transfer parameters */
   ftp_transfer_type_t transfer_type;   /**< ASCII or Binary */
   ftp_transfer_mode_t transfer_mode;   /**< Stream/Block/Compress */
   ftp_file_structure_t file_structure; /**< File/Record/Page */
   off_t restart_offset;                /**< REST command offset */
+  uint64_t alloc_size;                 /**< ALLO hint for the next STOR */
 
-  /* File system state */
-  char root_path[FTP_PATH_MAX];   /**< Server root directory */
-  char cwd[FTP_PATH_MAX];         /**< Current working directory */
-  char rename_from[FTP_PATH_MAX]; /**< RNFR source path */
+  /* File system state (point into *paths, FTP_PATH_MAX bytes each) */
+  ftp_session_paths_t *paths; /**< Cold path block, NULL when not live */
+  char *root_path;            /**< Server root directory */
+  char *cwd;                  /**< Current working directory */
+  char *rename_from;          /**< RNFR source path */
 
   /* Async Copy State */
-  char copy_from[FTP_PATH_MAX]; /**< CPFR source path */
-  pthread_t copy_thread;        /**< Background copy thread */
-  pthread_mutex_t copy_mutex;   /**< Mutex for copy thread state */
-  atomic_int copy_in_progress;  /**< Flag indicating active background copy */
-  uint8_t
-      copy_thread_valid; /**< Flag indicating if thread handle is joinable */
+  char *copy_from;              /**< CPFR source path */
   uint8_t copy_is_move;  /**< Flag indicating if copy should delete source (RNTO
                             fallback) */
-  uint8_t _padding_copy[2]; /**< Alignment padding */
+  uint8_t _padding_copy[3]; /**< Alignment padding */
 
   /* Authentication */
   uint8_t auth_attempts; /**< Failed auth attempts */
@@ -284,24 +335,54 @@ typedef struct ftp_session {
   pthread_t thread;    /**< Session thread handle */
   uint32_t session_id; /**< Unique session ID */
 
+  /* Event engine (FTP_SESSION_ENGINE_EVENT) */
+  struct ftp_session *engine_next; /**< Run queue / loop inbox link   */
+  uint8_t engine_greeted;          /**< 220 sent by an I/O worker     */
+  uint8_t engine_expired;          /**< Loop saw the idle timeout     */
+  uint8_t _padding_engine[6];      /**< Alignment padding             */
+
   /* Timing */
   time_t connect_time;  /**< Connection timestamp */
   time_t last_activity; /**< Last command timestamp */
-
-  uint64_t rl_tokens;  /**< Rate limiter tokens (bytes) */
-  uint64_t rl_last_ns; /**< Last refill timestamp (ns) */
+  uint64_t cmd_start_ns;          /**< Current command dispatch (monotonic) */
+  _Atomic uint64_t first_byte_ns; /**< Armed TTFB start, 0 = recorded      */
+  uint64_t data_open_ns;          /**< Data connection opened, 0 = none    */
+  uint64_t data_base_sent;        /**< bytes_sent when it opened           */
+  uint64_t data_base_received;    /**< bytes_received when it opened       */
+  pal_sock_tune_t sock_tune;      /**< Data socket TCP_INFO / buffer tuner */
+  pal_zc_t zc;                    /**< MSG_ZEROCOPY buffers in flight     */
+
+  ftp_bw_client_t bw; /**< Bandwidth scheduler (session + per-IP buckets) */
+  ftp_trace_t trace;  /**< Timeline of the current transfer            */
+  struct ftp_prefetch *prefetch; /**< Mirror predictor, NULL until LIST */
 
   /* Encryption (ChaCha20 stream cipher) */
   ftp_crypto_ctx_t crypto; /**< Per-session crypto context  */
 
+#if FTP_ENABLE_TLS
+  /* FTPS (RFC 4217) */
+  pal_tls_session_t *ctrl_tls; /**< Control channel TLS (AUTH TLS)    */
+  pal_tls_session_t *data_tls; /**< Current data connection TLS       */
+  uint8_t pbsz_set;            /**< PBSZ received after AUTH TLS      */
+  uint8_t prot_private;        /**< PROT P: data connections use TLS  */
+  uint8_t _padding_tls[6];     /**< Alignment padding                 */
+#endif
+
+#if FTP_ENABLE_MODEZ
+  ftp_zstream_t *zstream; /**< MODE Z stream of the open data connection */
+#endif
+
+#if FTP_ENABLE_HASH
+  uint8_t hash_algo;     /**< ftp_hash_algo_t used by HASH (OPTS HASH) */
+  uint8_t hash_chosen;   /**< Client picked it: hash STOR inline       */
+  uint8_t _padding_hash[6]; /**< Alignment padding                     */
+#endif
+
   /* Client identification */
   char client_ip[INET_ADDRSTRLEN]; /**< Client IP (text) */
   uint16_t client_port;            /**< Client port */
   uint16_t _padding2;              /**< Alignment padding */
 
-  /* Statistics */
-  ftp_session_stats_t stats;
-
   /*
    * Back-pointer to the owning server context.
    *
@@ -376,9 +457,39 @@ typedef struct ftp_server_context {
   atomic_int running;                   /**< Server running flag */
   atomic_uint_fast32_t active_sessions; /**< Active session count */
 
+  /* Acceptors (FTP_ACCEPT_THREADS) */
+  uint32_t acceptors;                 /**< Acceptor threads (1 = inline)   */
+  atomic_uint listen_backlog;         /**< listen() backlog                */
+  struct ftp_acceptors *acceptor_set; /**< K > 1: threads and start queue  */
+  atomic_int accepting;               /**< 0 = listeners released          */
+  pthread_t accept_thread;            /**< Single acceptor (joinable)      */
+  int accept_started;                 /**< accept_thread is joinable       */
+  uint32_t inherited;                 /**< Listeners adopted at init       */
+  int inherited_fds[FTP_ACCEPT_THREADS_MAX]; /**< ftp_server_init_fds()    */
+
+#if FTP_ENABLE_TLS
+  pal_tls_server_t *tls; /**< FTPS certificate context (NULL = AUTH TLS off) */
+#endif
+
   /* Session management */
-  ftp_session_t sessions[FTP_MAX_SESSIONS]; /**< Session pool */
-  pthread_mutex_t session_lock;             /**< Session pool lock */
+  int event_engine;            /**< Serve sessions on the event engine */
+  struct ftp_engine *engine;   /**< Event engine (NULL = thread mode)  */
+
+  /*
+   * Session pool: slots are allocated on first use and recycled through
+   * a lock-free free list (Treiber stack of slot indices; the upper 32
+   * bits of session_free are an ABA tag).  Only growth takes
+   * session_lock.
+   */
+  ftp_session_t *sessions[FTP_MAX_SESSIONS]; /**< Slots [0, session_slots) */
+  atomic_uint session_slots;                 /**< Slots allocated so far   */
+  uint32_t max_sessions;                     /**< Runtime session limit    */
+  atomic_uint session_next[FTP_MAX_SESSIONS]; /**< Free-list links (idx+1) */
+  _Atomic uint64_t session_free;             /**< Free-list head           */
+  pthread_mutex_t session_lock;              /**< Pool growth / stop lock  */
+
+  /* Passive listeners leased to PASV/EPSV (NULL = one per PASV) */
+  struct ftp_pasv_pool *pasv_pool;
 
   /* Default paths */
   char root_path[FTP_PATH_MAX]; /**< Server root directory */
@@ -389,6 +500,14 @@ typedef struct ftp_server_context {
     atomic_uint_fast64_t total_bytes_sent;
     atomic_uint_fast64_t total_bytes_received;
     atomic_uint_fast32_t total_errors;
+    /* Session start: accept() return -> thread created / engine submit */
+    atomic_uint_fast64_t start_count;
+    atomic_uint_fast64_t start_ns_total;
+    atomic_uint_fast64_t start_ns_max;
+    /* Connection rate: per-second buckets */
+    atomic_uint_fast64_t rate_sec;  /**< Second of rate_count   */
+    atomic_uint_fast64_t rate_count;/**< Starts in rate_sec     */
+    atomic_uint_fast64_t rate_last; /**< Starts in rate_sec - 1 */
   } stats;
 
 } ftp_server_context_t;
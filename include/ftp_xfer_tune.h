@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_xfer_tune.h
+ * @brief Closed-loop sendfile tuning for cmd_RETR
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * One controller per RETR.  The transfer loop reports what happened
+ * (bytes moved, zero-byte sendfile returns, driver stalls) and reads back
+ * three knobs:
+ *
+ *   chunk           bytes per sendfile() call
+ *   cooldown        bytes of read() after a driver stall
+ *   eagain_sleep_us backoff between zero-byte retries
+ *
+ * Every FTP_RETR_TUNE_WINDOW_BYTES the controller computes bytes/sec and
+ * the zero-return rate for the window and hill-climbs the chunk size.
+ * The settings that worked best are stored per filesystem type (the
+ * "fs=" value of the [RETR] diag line) and seed the next transfer from
+ * the same filesystem.
+ *
+ *   ┌────────┐ on_sent / on_eagain / on_stall ┌────────────┐
+ *   │  RETR  │──────────────────────────────►│ controller │
+ *   │  loop  │◄──────────────────────────────│  (window)  │
+ *   └────────┘  chunk / cooldown / sleep     └─────┬──────┘
+ *                                          end()   ▼
+ *                                          ┌──────────────┐
+ *                                          │ per-fs table │
+ *                                          └──────────────┘
+ *
+ * THREAD SAFETY: a controller belongs to one session thread; only the
+ * per-fs table is shared (mutex-protected).
+ */
+
+#ifndef FTP_XFER_TUNE_H
+#define FTP_XFER_TUNE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Longest filesystem type name kept (including NUL) */
+#define FTP_XFER_TUNE_FSNAME_MAX 16U
+
+typedef struct {
+  char fstype[FTP_XFER_TUNE_FSNAME_MAX];
+
+  /* knobs (read by the RETR loop) */
+  uint32_t chunk;
+  uint32_t cooldown;
+  uint32_t eagain_sleep_us;
+  uint32_t eagain_retries;
+
+  /* current measurement window */
+  uint64_t win_start_ns;
+  uint64_t win_bytes;
+  uint32_t win_calls;
+  uint32_t win_eagain;
+  uint32_t win_recoveries;
+  uint32_t win_retry_sum;
+
+  /* hill-climb state */
+  uint64_t best_bps;
+  uint32_t best_chunk;
+  int dir;
+  uint32_t reversals;
+
+  uint64_t burst_bytes; /* sendfile bytes since the last stall    */
+  uint64_t total_bytes;
+  uint32_t stalls;
+  int seeded; /* 1 = knobs came from the per-fs table  */
+} ftp_xfer_tune_t;
+
+/**
+ * @brief Identify the filesystem behind an open fd
+ *
+ * Writes f_fstypename on BSD-derived systems, a well-known name or the
+ * hex magic on Linux, "unknown" on failure.
+ */
+void ftp_xfer_tune_fstype(int fd, char *out, size_t out_size);
+
+/**
+ * @brief Start a controller, seeded from the per-fs table when possible
+ *
+ * @param fstype Filesystem type from ftp_xfer_tune_fstype() (may be NULL)
+ */
+void ftp_xfer_tune_begin(ftp_xfer_tune_t *t, const char *fstype);
+
+/**
+ * @brief Start from @p chunk unless the per-fs table seeded the controller
+ *
+ * For the filesystem profile's first chunk (ftp_fsprofile.h); clamped to
+ * the controller's range.
+ */
+void ftp_xfer_tune_default_chunk(ftp_xfer_tune_t *t, uint32_t chunk);
+
+/** @brief sendfile() moved @p bytes */
+void ftp_xfer_tune_on_sent(ftp_xfer_tune_t *t, size_t bytes);
+
+/** @brief sendfile() returned 0 / EAGAIN (one retry) */
+void ftp_xfer_tune_on_eagain(ftp_xfer_tune_t *t);
+
+/** @brief Back-pressure cleared after @p retries sleeps */
+void ftp_xfer_tune_on_recovered(ftp_xfer_tune_t *t, uint32_t retries);
+
+/** @brief All retries failed: driver stall, a read() cooldown follows */
+void ftp_xfer_tune_on_stall(ftp_xfer_tune_t *t);
+
+/** @brief read() cooldown moved @p bytes (counted in the window) */
+void ftp_xfer_tune_on_cooldown(ftp_xfer_tune_t *t, size_t bytes);
+
+/**
+ * @brief Finish the transfer and publish its settings
+ *
+ * @param ok Nonzero if the transfer completed; failed transfers are not
+ *           remembered.
+ */
+void ftp_xfer_tune_end(ftp_xfer_tune_t *t, int ok);
+
+/** @brief Forget every remembered setting (tests) */
+void ftp_xfer_tune_reset_table(void);
+
+#endif /* FTP_XFER_TUNE_H */
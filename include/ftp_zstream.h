@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_zstream.h
+ * @brief MODE Z (deflate) streaming for data connections
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * One stream per data connection, created on the first send (deflate)
+ * or receive (inflate) in MODE Z and finished when the connection
+ * closes.  The stream sits between ftp_session_send_data()/recv_data()
+ * and the wire:
+ *
+ *   RETR/LIST ──► ftp_zstream_write ──► deflate ──► sink (TLS/XOR/TCP)
+ *   STOR      ◄── ftp_zstream_read  ◄── inflate ◄── source
+ *
+ * ADAPTIVE LEVEL (deflate only, evaluated per FTP_MODEZ_WINDOW_BYTES):
+ *
+ *   output/input >= FTP_MODEZ_STORED_PCT  -> level 0 (stored blocks);
+ *                                            re-probe level 1 after
+ *                                            FTP_MODEZ_PROBE_WINDOWS
+ *   deflate time  > 2 x sink time         -> CPU-bound: level - 1
+ *   sink time     > 2 x deflate time      -> link-bound: level + 1
+ *
+ * Already-compressed payloads (PKG, archives) thereby cost a memcpy
+ * instead of a full deflate search.
+ *
+ * THREAD SAFETY: a stream belongs to one session thread.
+ */
+
+#ifndef FTP_ZSTREAM_H
+#define FTP_ZSTREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef struct ftp_zstream ftp_zstream_t;
+
+typedef enum {
+  FTP_ZSTREAM_DEFLATE = 0, /**< Outgoing data (RETR, LIST, MLSD) */
+  FTP_ZSTREAM_INFLATE = 1, /**< Incoming data (STOR, APPE)       */
+} ftp_zstream_dir_t;
+
+/** Write @p len bytes to the wire; returns bytes written or <= 0 */
+typedef ssize_t (*ftp_zstream_sink_fn)(void *ctx, const void *buf,
+                                       size_t len);
+
+/** Read up to @p len bytes from the wire (recv() semantics) */
+typedef ssize_t (*ftp_zstream_source_fn)(void *ctx, void *buf, size_t len);
+
+/** Level controller state (one measurement window) */
+typedef struct {
+  int level;               /**< Current deflate level (0 = stored) */
+  uint64_t win_in;         /**< Uncompressed bytes in this window  */
+  uint64_t win_out;        /**< Compressed bytes in this window    */
+  uint64_t win_deflate_ns; /**< Time spent inside deflate()        */
+  uint64_t win_sink_ns;    /**< Time spent writing to the sink     */
+  uint32_t stored_windows; /**< Windows spent at level 0           */
+} ftp_zadapt_t;
+
+/** @brief Start a controller at @p level */
+void ftp_zadapt_init(ftp_zadapt_t *a, int level);
+
+/**
+ * @brief Close the current window and pick the next level
+ *
+ * @return Level for the next window
+ */
+int ftp_zadapt_window(ftp_zadapt_t *a);
+
+/**
+ * @brief Allocate a stream
+ *
+ * @param dir   Direction
+ * @param level Initial deflate level (ignored for inflate)
+ *
+ * @return Stream, or NULL if out of memory
+ */
+ftp_zstream_t *ftp_zstream_create(ftp_zstream_dir_t dir, int level);
+
+/** @brief Free a stream (NULL-safe); does not flush */
+void ftp_zstream_destroy(ftp_zstream_t *z);
+
+/** @brief Direction the stream was created for */
+ftp_zstream_dir_t ftp_zstream_dir(const ftp_zstream_t *z);
+
+/**
+ * @brief Compress @p len bytes and push the output to @p sink
+ *
+ * @return @p len on success, -1 if the sink failed or the stream is not
+ *         a deflate stream
+ */
+ssize_t ftp_zstream_write(ftp_zstream_t *z, const void *buf, size_t len,
+                          ftp_zstream_sink_fn sink, void *ctx);
+
+/**
+ * @brief Flush the final deflate block (Z_FINISH) to @p sink
+ *
+ * @return 0 on success, -1 on failure
+ */
+int ftp_zstream_finish(ftp_zstream_t *z, ftp_zstream_sink_fn sink, void *ctx);
+
+/**
+ * @brief Read up to @p len decompressed bytes
+ *
+ * @return Bytes produced, 0 at end of stream (or peer close), -1 with
+ *         errno set on wire error (EAGAIN preserved) or corrupt input (EIO)
+ */
+ssize_t ftp_zstream_read(ftp_zstream_t *z, void *buf, size_t len,
+                         ftp_zstream_source_fn source, void *ctx);
+
+/**
+ * @brief Byte counters and current level
+ *
+ * @param raw   Uncompressed bytes (may be NULL)
+ * @param wire  Compressed bytes (may be NULL)
+ * @param level Current level (may be NULL)
+ */
+void ftp_zstream_stats(const ftp_zstream_t *z, uint64_t *raw, uint64_t *wire,
+                       int *level);
+
+#endif /* FTP_ZSTREAM_H */
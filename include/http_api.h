@@ -31,11 +31,70 @@ SOFTWARE.
 #define HTTP_API_H
 
 #include "ftp_types.h"
+#include "http_games.h"
 #include "http_parser.h"
 #include "http_response.h"
 
 http_response_t *http_api_handle(const http_request_t *request);
 
+/** Route runs on the worker pool (see http_api_is_offloadable()) */
+#define HTTP_ROUTE_OFFLOAD 0x01U
+/** POST requests must carry a valid CSRF token */
+#define HTTP_ROUTE_CSRF 0x02U
+/** Successful replies carry a cacheable Cache-Control */
+#define HTTP_ROUTE_CACHE 0x04U
+
+/**
+ * @brief Flags of the API route a request resolves to.
+ *
+ * Routes match the whole path before '?'; the lookup is a hash probe,
+ * not a prefix scan.
+ *
+ * @return HTTP_ROUTE_* bits, 0 for unknown paths and static resources
+ */
+unsigned http_api_route_flags(const http_request_t *request);
+
+/**
+ * @brief Tell whether a request should run off the event-loop thread.
+ *
+ * True for the routes that scan directories, parse game metadata or
+ * mutate the filesystem.  http_api_handle() is safe to call from any
+ * thread for these routes.
+ *
+ * @return 1 if the route may block on storage, 0 otherwise
+ */
+int http_api_is_offloadable(const http_request_t *request);
+
+/** Number of /api/events topics (copy, extract, downloads, ftp) */
+#define HTTP_EVENT_TOPICS 4U
+
+/** Buffer size that always fits one http_api_event_render() frame */
+#define HTTP_EVENT_FRAME_MAX 4608U
+
+/**
+ * @brief Tell whether a request opens the /api/events SSE stream.
+ *
+ * The HTTP server answers these itself and keeps the connection open;
+ * they never reach http_api_handle().
+ *
+ * @return 1 for GET /api/events, 0 otherwise
+ */
+int http_api_is_event_stream(const http_request_t *request);
+
+/**
+ * @brief Render the current state of one event topic as an SSE frame.
+ *
+ * Produces "event: <topic>\ndata: <json>\n\n".  Safe to call from the
+ * event-loop thread while jobs run; the values are read without locks.
+ *
+ * @param topic  0 .. HTTP_EVENT_TOPICS - 1
+ * @param out    Destination, at least HTTP_EVENT_FRAME_MAX bytes
+ * @param cap    Size of out
+ *
+ * @return Frame length, or 0 if the topic is unavailable in this build
+ */
+size_t http_api_event_render(size_t topic, char *out, size_t cap);
+
 /**
  * @brief Attach the FTP server context to the HTTP API layer.
  *
@@ -73,4 +132,17 @@ const char *http_api_get_root(void);
  */
 uint64_t http_dir_size_recursive(const char *path, int depth);
 
+/**
+ * @brief Read the metadata of a title from disk (http_games.c loader)
+ *
+ * An app directory is read from its param.sfo (sce_sys/ or top level)
+ * or sce_sys/param.json, its icon resolved like the icon endpoints do;
+ * any other path is opened as a PKG, then as an exFAT image.
+ *
+ * @param icon  Receives the icon file of a directory ("" for images)
+ * @return 0 with @p out filled, -1 if nothing could be read
+ */
+int http_api_load_game(const char *path, http_game_meta_t *out, char *icon,
+                       size_t icon_size);
+
 #endif /* HTTP_API_H */
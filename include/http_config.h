@@ -65,7 +65,17 @@ SOFTWARE.
 
 /* Server configuration */
 #define HTTP_DEFAULT_PORT 8888
+/*
+ * Each connection slot is a static request buffer plus a pooled
+ * response (~16 KB together); the event loop itself has no fd cap.
+ */
+#ifndef HTTP_MAX_CONNECTIONS
+#if defined(PS5) || defined(PLATFORM_PS5) || defined(PS4) || defined(PLATFORM_PS4)
 #define HTTP_MAX_CONNECTIONS 100
+#else
+#define HTTP_MAX_CONNECTIONS 1024
+#endif
+#endif
 #define HTTP_REQUEST_TIMEOUT 30
 #define HTTP_KEEPALIVE_TIMEOUT 60
 
@@ -93,11 +103,110 @@ SOFTWARE.
  */
 #define HTTP_SENDFILE_CHUNK_SIZE (512 * 1024)
 
+/*
+ * Multi-range requests (Range: bytes=a-b,c-d) are answered with one 206
+ * covering the bounding span when the gaps between the ranges total at
+ * most this many bytes — roughly what a multipart/byteranges part header
+ * would cost.  Wider requests get the whole file with a 200.
+ */
+#ifndef HTTP_RANGE_COALESCE_GAP
+#define HTTP_RANGE_COALESCE_GAP 128U
+#endif
+
 /* Thread stack size (bytes) */
 #ifndef HTTP_THREAD_STACK_SIZE
 #define HTTP_THREAD_STACK_SIZE (512U * 1024U)
 #endif
 
+/*
+ * Worker pool for blocking API routes (see http_api_is_offloadable()).
+ *
+ * HTTP_WORKER_THREADS      threads started with the server; 0 keeps
+ *                          every route on the event-loop thread
+ * HTTP_WORKER_QUEUE_DEPTH  requests waiting for a worker; when the queue
+ *                          is full the request runs inline as before
+ */
+#ifndef HTTP_WORKER_THREADS
+#if defined(PS5) || defined(PLATFORM_PS5) || defined(PS4) || defined(PLATFORM_PS4)
+#define HTTP_WORKER_THREADS 2U
+#else
+#define HTTP_WORKER_THREADS 4U
+#endif
+#endif
+#ifndef HTTP_WORKER_QUEUE_DEPTH
+#define HTTP_WORKER_QUEUE_DEPTH 32U
+#endif
+
+/*
+ * GET /api/events (Server-Sent Events) replaces the UI's progress polls.
+ *
+ * HTTP_SSE_MAX_CLIENTS   open streams; further subscribers get a 503
+ * HTTP_SSE_PUSH_MS       minimum gap between change checks (the loop
+ *                        tick still guarantees one per second)
+ * HTTP_SSE_PING_SECONDS  comment line sent on a quiet stream so proxies
+ *                        and the browser keep it open
+ */
+#ifndef HTTP_SSE_MAX_CLIENTS
+#define HTTP_SSE_MAX_CLIENTS 8U
+#endif
+#ifndef HTTP_SSE_PUSH_MS
+#define HTTP_SSE_PUSH_MS 250U
+#endif
+#ifndef HTTP_SSE_PING_SECONDS
+#define HTTP_SSE_PING_SECONDS 15
+#endif
+
+/*
+ * Paged /api/list (see api_list_paged()).
+ *
+ * HTTP_LIST_PAGE_DEFAULT  entries per page when ?limit= is absent
+ * HTTP_LIST_PAGE_MAX      upper clamp for ?limit=
+ * HTTP_LIST_CURSOR_MAX    hex-encoded cursor, NUL included
+ */
+#ifndef HTTP_LIST_PAGE_DEFAULT
+#define HTTP_LIST_PAGE_DEFAULT 500U
+#endif
+#ifndef HTTP_LIST_PAGE_MAX
+#define HTTP_LIST_PAGE_MAX 5000U
+#endif
+#define HTTP_LIST_CURSOR_MAX 640U
+
+/*
+ * GET /api/disk/tree (see api_disk_tree()).
+ *
+ * HTTP_TREE_WAIT_MS       how long the request waits for the size index
+ *                         before answering with "partial":true
+ * HTTP_TREE_DEPTH_MAX     upper clamp for ?depth=
+ * HTTP_TREE_TOP_DEFAULT   children kept per directory when ?top= is
+ *                         absent; the rest are folded into one "other"
+ * HTTP_TREE_TOP_MAX       upper clamp for ?top=
+ * HTTP_TREE_MAX_NODES     nodes per response, whatever depth and top say
+ * HTTP_STREAM_CHUNK_SIZE  chunk formatted per send by body generators
+ */
+#ifndef HTTP_TREE_WAIT_MS
+#define HTTP_TREE_WAIT_MS 2000U
+#endif
+#define HTTP_TREE_DEPTH_MAX 6U
+#ifndef HTTP_TREE_TOP_DEFAULT
+#define HTTP_TREE_TOP_DEFAULT 100U
+#endif
+#define HTTP_TREE_TOP_MAX 512U
+#ifndef HTTP_TREE_MAX_NODES
+#if defined(PS5) || defined(PLATFORM_PS5) || defined(PS4) || defined(PLATFORM_PS4)
+#define HTTP_TREE_MAX_NODES 8192U
+#else
+#define HTTP_TREE_MAX_NODES 32768U
+#endif
+#endif
+#ifndef HTTP_STREAM_CHUNK_SIZE
+#define HTTP_STREAM_CHUNK_SIZE (16U * 1024U)
+#endif
+
+/* SSE2/NEON scan in the JSON string escaper (http_json.c) */
+#ifndef HTTP_JSON_SIMD
+#define HTTP_JSON_SIMD 1
+#endif
+
 /* CSRF token length in hex characters (32 hex = 16 random bytes) */
 #define HTTP_CSRF_TOKEN_LENGTH 32
 
@@ -112,8 +221,8 @@ SOFTWARE.
  * Upload streaming performance tuning
  *
  * HTTP_UPLOAD_CHUNK_SIZE
- *   Heap-allocated read buffer used exclusively while an upload is active.
- *   Each event-loop iteration drains up to this many bytes from the socket.
+ *   Size of one write-behind ring slot (see HTTP_UPLOAD_WRITERS below).
+ *   Each event-loop iteration fills at most one slot from the socket.
  *
  *   Rationale:
  *     The connection's header buffer (HTTP_REQUEST_BUFFER_SIZE = 8 KB) is
@@ -123,7 +232,7 @@ SOFTWARE.
  *
  *     256 KB reduces the required syscall rate to ~440/s at 113 MB/s,
  *     comfortably within budget while keeping per-upload heap overhead low.
- *     The buffer is allocated on upload start and freed on completion, so
+ *     Slots are allocated on upload start and freed on completion, so
  *     idle connections pay no memory cost.
  *
  * HTTP_UPLOAD_RCVBUF_SIZE
@@ -146,7 +255,44 @@ SOFTWARE.
 #endif
 
 /*---------------------------------------------------------------------------*
- * Download pread() chunk size (PATH B — pread + pal_send_all)
+ * Upload write-behind (see http_upload.h)
+ *
+ * The event loop only moves body bytes off the socket; a shared pool of
+ * writer threads puts them on disk, so a PFS stall slows that one upload
+ * instead of freezing the server.
+ *
+ * HTTP_UPLOAD_WRITERS          writer threads; 0 writes inline on the loop
+ * HTTP_UPLOAD_RING_DEPTH       HTTP_UPLOAD_CHUNK_SIZE slots per upload ...
+ * HTTP_UPLOAD_RING_MAX_DEPTH   ... growing to this many while the disk lags
+ * HTTP_UPLOAD_RING_GROW_AFTER  stalled refills before one more slot
+ * HTTP_UPLOAD_SPLICE           Linux: socket ─► pipe ─► file with splice(2),
+ *                              no ring and no userspace copy
+ * HTTP_UPLOAD_PIPE_SIZE        F_SETPIPE_SZ request for that pipe
+ *
+ * Read interest on the socket is dropped only while the upload's ring
+ * (or pipe) is full and comes back as soon as a writer frees space.
+ *---------------------------------------------------------------------------*/
+#ifndef HTTP_UPLOAD_WRITERS
+#define HTTP_UPLOAD_WRITERS 2U
+#endif
+#ifndef HTTP_UPLOAD_RING_DEPTH
+#define HTTP_UPLOAD_RING_DEPTH 2U
+#endif
+#ifndef HTTP_UPLOAD_RING_MAX_DEPTH
+#define HTTP_UPLOAD_RING_MAX_DEPTH 4U
+#endif
+#ifndef HTTP_UPLOAD_RING_GROW_AFTER
+#define HTTP_UPLOAD_RING_GROW_AFTER 4U
+#endif
+#ifndef HTTP_UPLOAD_SPLICE
+#define HTTP_UPLOAD_SPLICE 1
+#endif
+#ifndef HTTP_UPLOAD_PIPE_SIZE
+#define HTTP_UPLOAD_PIPE_SIZE (1024U * 1024U)
+#endif
+
+/*---------------------------------------------------------------------------*
+ * Download pread() chunk size (PATH B — pread + send)
  *
  * Used when sendfile() is unsafe (PS5/PS4 PFS/exFAT filesystems).
  * Larger chunks mean fewer pread()+send_all() round-trips per MB.
@@ -157,6 +303,124 @@ SOFTWARE.
 #define HTTP_DOWNLOAD_PREAD_CHUNK (2U * 1024U * 1024U) /* 2 MB */
 #endif
 
+/*---------------------------------------------------------------------------*
+ * Download fairness quantum
+ *
+ * File bodies are sent from the event loop without blocking: each
+ * wakeup a download moves at most this many bytes (or stops at EAGAIN)
+ * before the loop serves the next ready connection.  Equal to the pread
+ * chunk so PATH B does one read per turn.
+ *---------------------------------------------------------------------------*/
+#ifndef HTTP_DOWNLOAD_QUANTUM
+#define HTTP_DOWNLOAD_QUANTUM HTTP_DOWNLOAD_PREAD_CHUNK
+#endif
+
+/*---------------------------------------------------------------------------*
+ * Remote URL downloads (/api/download/start, http_fetch.c)
+ *
+ * HTTP_FETCH_SEGMENTS      parallel ranged connections per download
+ * HTTP_FETCH_SEGMENTED_MIN smaller files (or servers without ranges)
+ *                          use a single connection
+ * HTTP_FETCH_STEAL_MIN     a connection that runs out of work takes the
+ *                          upper half of the largest unfinished range,
+ *                          if at least twice this much is left of it
+ * HTTP_FETCH_STATE_MS      how often the segment table is synced to
+ *                          "<file>.zdl" for pause/resume and crash recovery
+ *---------------------------------------------------------------------------*/
+#ifndef HTTP_FETCH_SEGMENTS
+#define HTTP_FETCH_SEGMENTS 4U
+#endif
+#ifndef HTTP_FETCH_SEGMENTED_MIN
+#define HTTP_FETCH_SEGMENTED_MIN (8U * 1024U * 1024U)
+#endif
+#ifndef HTTP_FETCH_STEAL_MIN
+#define HTTP_FETCH_STEAL_MIN (1U * 1024U * 1024U)
+#endif
+#ifndef HTTP_FETCH_STATE_MS
+#define HTTP_FETCH_STATE_MS 1000U
+#endif
+
+/*---------------------------------------------------------------------------*
+ * Game metadata index (http_games.c)
+ *
+ * HTTP_GAMES_MAX        indexed titles and images; images looked up by
+ *                       path are evicted least recently used first
+ * HTTP_GAMES_FRESH_S    installed rows older than this are rescanned in
+ *                       the background on the next query
+ * HTTP_GAMES_WAIT_MS    how long a query waits for a scan it needs
+ * HTTP_GAMES_INDEX_PATH on-disk copy ("" = memory only), rewritten
+ *                       through a .tmp file + rename after a scan that
+ *                       changed something and at shutdown
+ *---------------------------------------------------------------------------*/
+#ifndef HTTP_GAMES_MAX
+#define HTTP_GAMES_MAX 4096U
+#endif
+#ifndef HTTP_GAMES_FRESH_S
+#define HTTP_GAMES_FRESH_S 30
+#endif
+#ifndef HTTP_GAMES_WAIT_MS
+#define HTTP_GAMES_WAIT_MS 5000U
+#endif
+#ifndef HTTP_GAMES_INDEX_PATH
+#if defined(PS5) || defined(PLATFORM_PS5) || defined(PS4) || defined(PLATFORM_PS4)
+#define HTTP_GAMES_INDEX_PATH "/data/zftpd/games.idx"
+#else
+#define HTTP_GAMES_INDEX_PATH "/tmp/zftpd-games.idx"
+#endif
+#endif
+
+/*---------------------------------------------------------------------------*
+ * Icon thumbnails (http_thumb.c, ?size= on the icon routes)
+ *
+ * HTTP_THUMB_MAX_EDGE   largest thumbnail; bigger requests get the
+ *                       full-size icon
+ * HTTP_THUMB_MAX_SRC    icons wider or taller than this are not decoded
+ * HTTP_THUMB_DIR        on-disk cache ("" = build every request)
+ * HTTP_THUMB_CACHE_MAX  bytes kept there before the least recently
+ *                       served files are removed
+ *---------------------------------------------------------------------------*/
+#ifndef HTTP_THUMB_MAX_EDGE
+#define HTTP_THUMB_MAX_EDGE 256U
+#endif
+#ifndef HTTP_THUMB_MAX_SRC
+#define HTTP_THUMB_MAX_SRC 4096U
+#endif
+#ifndef HTTP_THUMB_DIR
+#if defined(PS5) || defined(PLATFORM_PS5) || defined(PS4) || defined(PLATFORM_PS4)
+#define HTTP_THUMB_DIR "/data/zftpd/thumbs"
+#else
+#define HTTP_THUMB_DIR "/tmp/zftpd-thumbs"
+#endif
+#endif
+#ifndef HTTP_THUMB_CACHE_MAX
+#define HTTP_THUMB_CACHE_MAX (32U * 1024U * 1024U)
+#endif
+
+/*---------------------------------------------------------------------------*
+ * System stats sampler (http_sysmon.c)
+ *
+ * HTTP_SYSMON_INTERVAL_MS  period of the RAM / temperature / uptime
+ *                          sample (and of the process list while
+ *                          /api/processes is being polled)
+ * HTTP_SYSMON_HISTORY      samples kept for ?since= (a power of two)
+ * HTTP_SYSMON_IDLE_S       the sampler parks after this long without a
+ *                          reader; the next request wakes it
+ * HTTP_SYSMON_WAIT_MS      how long a request waits for a fresh sample
+ *                          when the sampler was parked
+ *---------------------------------------------------------------------------*/
+#ifndef HTTP_SYSMON_INTERVAL_MS
+#define HTTP_SYSMON_INTERVAL_MS 1000U
+#endif
+#ifndef HTTP_SYSMON_HISTORY
+#define HTTP_SYSMON_HISTORY 512U
+#endif
+#ifndef HTTP_SYSMON_IDLE_S
+#define HTTP_SYSMON_IDLE_S 30
+#endif
+#ifndef HTTP_SYSMON_WAIT_MS
+#define HTTP_SYSMON_WAIT_MS 2000U
+#endif
+
 /*---------------------------------------------------------------------------*
  * HTTP client send buffer (SO_SNDBUF) — download throughput on PS5/PS4
  *
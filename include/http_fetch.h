@@ -0,0 +1,90 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/**
+ * @file http_fetch.h
+ * @brief Remote URL downloads, split over parallel ranged connections
+ *
+ * Backs /api/download/start.  A HEAD request gives the size; if the
+ * server also answers a one-byte range with 206, the file is
+ * preallocated and fetched over HTTP_FETCH_SEGMENTS connections, each
+ * writing its range with pwrite():
+ *
+ *   [ seg 0 ····>      | seg 1 ··>          | seg 2 ······> | seg 3 ·> ]
+ *                                             seg 2 done: steals the
+ *   [ seg 0 ····>      | seg 1 ··>  | seg 4 ··>             ]  upper
+ *                                                              half of
+ *                                                              seg 1
+ *
+ * A connection that runs out of work takes the upper half of the largest
+ * range still being fetched, so one slow connection does not hold up
+ * the tail of the file.  The segment table is synced to "<file>.zdl"
+ * every HTTP_FETCH_STATE_MS (after an fdatasync of the data), so a pause,
+ * an error or a crash resumes from the saved positions instead of from
+ * zero; the table is removed once the file is complete.
+ *
+ * Servers without ranges, unknown sizes and small files use one plain
+ * connection, as before.
+ *
+ * Built with ENABLE_LIBCURL (libcurl on desktop, pal_curl on PS4/PS5).
+ */
+
+#ifndef HTTP_FETCH_H
+#define HTTP_FETCH_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* http_fetch() results */
+#define HTTP_FETCH_OK         0
+#define HTTP_FETCH_FAILED   (-1) /**< err filled; the state file is kept */
+#define HTTP_FETCH_CANCELLED  1  /**< partial file and state removed   */
+
+/** Shared between the fetching thread and the status/pause/cancel routes */
+typedef struct {
+  _Atomic uint64_t downloaded; /**< bytes on disk, including resumed ones */
+  _Atomic uint64_t total;      /**< 0 while unknown                      */
+  atomic_int paused;           /**< 1 = connections closed, waiting      */
+  atomic_int cancel;           /**< 1 = stop and remove the partial file */
+  atomic_int connections;      /**< ranged connections currently open    */
+  _Atomic uint64_t resumed;    /**< bytes found on disk at the start     */
+} http_fetch_ctl_t;
+
+/**
+ * @brief Download @p url into @p path (blocking; run on its own thread)
+ *
+ * @param url       http:// (or https:// where libcurl is used) URL
+ * @param path      destination file
+ * @param ctl       progress and control; zero-initialised by the caller
+ * @param err       message for HTTP_FETCH_FAILED
+ * @param err_size  size of @p err
+ *
+ * @return HTTP_FETCH_OK, HTTP_FETCH_FAILED or HTTP_FETCH_CANCELLED
+ */
+int http_fetch(const char *url, const char *path, http_fetch_ctl_t *ctl,
+               char *err, size_t err_size);
+
+#endif /* HTTP_FETCH_H */
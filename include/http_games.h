@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file http_games.h
+ * @brief Game metadata and icon index behind the games/library APIs
+ *
+ * Answers "what is this title" from memory instead of re-reading and
+ * re-parsing param.sfo / param.json / icon0.png on every request:
+ *
+ *   /api/admin/games/installed ──► installed rows ──► one snapshot
+ *                                       ▲
+ *                          scanner thread (readdir of the bases,
+ *                          re-parse only what changed)
+ *
+ *   /api/game/meta, icons ──► http_games_meta() ──► hit: copy
+ *                                                 └─ miss: load + keep
+ *
+ * Entries are keyed by path (an installed app directory or an image
+ * file) and validated by the size and mtime of the file the metadata
+ * came from: param.sfo / param.json for a directory, the image itself
+ * otherwise.  A changed stamp simply reloads the entry.
+ *
+ * The installed list is refreshed in the background: when a base
+ * directory's mtime changed (a title was added or removed),
+ * http_games_refresh() was called, or the last scan is older than
+ * HTTP_GAMES_FRESH_S.  The index is saved to HTTP_GAMES_INDEX_PATH, so
+ * the first library page after a restart is answered before any scan.
+ *
+ * Metadata itself is read by http_api_load_game() (http_api.h).
+ *
+ * THREAD SAFETY: every function may be called from any thread.
+ */
+
+#ifndef HTTP_GAMES_H
+#define HTTP_GAMES_H
+
+#include <stddef.h>
+
+typedef struct {
+  char id[64];         /**< TITLE_ID                                 */
+  char name[256];      /**< TITLE (or TITLE_01)                      */
+  char version[64];    /**< APP_VER / contentVersion                 */
+  char category[64];   /**< CATEGORY                                 */
+  char content_id[48]; /**< CONTENT_ID                               */
+  int has_icon;        /**< 1 = an icon0.png was found               */
+} http_game_meta_t;
+
+/** One installed title of an http_games_installed() snapshot */
+typedef struct {
+  http_game_meta_t meta;
+  const char *path;   /**< App directory                            */
+  const char *source; /**< Base directory it was found under        */
+} http_game_row_t;
+
+/**
+ * @brief Metadata of the app directory or image file at @p path
+ *
+ * @param icon      Receives the resolved icon file ("" when the icon
+ *                  lives inside an image or was not found); may be NULL
+ * @return 0 with @p out filled, -1 if @p path holds no readable title
+ */
+int http_games_meta(const char *path, http_game_meta_t *out, char *icon,
+                    size_t icon_size);
+
+/**
+ * @brief Snapshot of the installed titles, sorted by base then path
+ *
+ * Waits up to HTTP_GAMES_WAIT_MS for a scan when nothing is known yet or
+ * a base directory changed; otherwise answers at once and refreshes
+ * aged data in the background.
+ *
+ * @return malloc()'d rows (strings stored behind them; one free()), or
+ *         NULL with *count = 0 when none are known or memory ran out
+ */
+http_game_row_t *http_games_installed(size_t *count);
+
+/**
+ * @brief Installed app directory of @p title_id
+ * @return 0 with @p out filled, -1 if the index has no such title
+ */
+int http_games_find(const char *title_id, char *out, size_t out_size);
+
+/**
+ * @brief Report an install or uninstall
+ *
+ * Starts a rescan now; the next http_games_installed() waits for it.
+ */
+void http_games_refresh(void);
+
+/** @brief Stop the scanner, save the index, free it */
+void http_games_shutdown(void);
+
+/**
+ * @brief Shut down and switch index file and base directories (tests)
+ * @param index_path NULL = HTTP_GAMES_INDEX_PATH, "" = memory only
+ * @param bases      NULL-terminated, NULL = the console app directories;
+ *                   the strings must outlive the index
+ */
+void http_games_reset(const char *index_path, const char *const *bases);
+
+#endif /* HTTP_GAMES_H */
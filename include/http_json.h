@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file http_json.h
+ * @brief Streaming JSON writer for API responses
+ *
+ * Writes into a caller-supplied chunk and never allocates.  The writer
+ * keeps the nesting state across chunks, so a body generator
+ * (http_stream_fill_t) attaches each new chunk and carries on:
+ *
+ *   fill(ctx, buf, cap) ─► http_json_attach(w, buf, cap)
+ *                          for each record:
+ *                            mark = *w
+ *                            write record
+ *                            overflow? ─► *w = mark, return w->pos
+ *                          end of data ─► return w->pos (0 ends body)
+ *
+ * Commas between members and elements are inserted automatically.
+ * Strings go through http_json_escape(): a 256-entry class table, with
+ * SSE2/NEON scanning of 16-byte runs that need no escaping when
+ * HTTP_JSON_SIMD is set.
+ */
+
+#ifndef HTTP_JSON_H
+#define HTTP_JSON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HTTP_JSON_MAX_DEPTH 32U
+
+typedef struct {
+  char *buf;
+  size_t cap;
+  size_t pos;        /**< Bytes written to the current chunk          */
+  uint32_t depth;    /**< Open objects/arrays                         */
+  uint32_t fresh;    /**< Bit d set: nothing written yet at depth d   */
+  int after_key;     /**< Next value belongs to the key just written */
+  int overflow;      /**< A write did not fit; the chunk is suspect  */
+} http_json_t;
+
+/** @brief Empty document, no chunk attached */
+void http_json_init(http_json_t *w);
+
+/** @brief Continue into a new chunk; clears pos and overflow */
+void http_json_attach(http_json_t *w, char *buf, size_t cap);
+
+void http_json_object_begin(http_json_t *w);
+void http_json_object_end(http_json_t *w);
+void http_json_array_begin(http_json_t *w);
+void http_json_array_end(http_json_t *w);
+
+/** @brief Member name; the next value call writes its value */
+void http_json_key(http_json_t *w, const char *key);
+
+void http_json_string(http_json_t *w, const char *s);
+void http_json_u64(http_json_t *w, uint64_t v);
+void http_json_i64(http_json_t *w, int64_t v);
+void http_json_bool(http_json_t *w, int v);
+void http_json_null(http_json_t *w);
+
+/** @brief Pre-formatted value (a number, a literal) written verbatim */
+void http_json_raw(http_json_t *w, const char *text, size_t len);
+
+/**
+ * @brief Escape @p len bytes of @p s as JSON string contents
+ *
+ * No quotes are added.  Control characters, '"' and '\\' are escaped;
+ * everything else, UTF-8 included, is copied.
+ *
+ * @return bytes written, or (size_t)-1 if @p cap was too small
+ */
+size_t http_json_escape(char *dst, size_t cap, const char *s, size_t len);
+
+#endif /* HTTP_JSON_H */
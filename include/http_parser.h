@@ -32,6 +32,7 @@ SOFTWARE.
 
 #include "http_config.h"
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum {
     HTTP_METHOD_GET,
@@ -59,4 +60,19 @@ typedef struct {
 int http_parse_request(char *buffer, size_t length, http_request_t *request);
 const char* http_get_header(const http_request_t *request, const char *name);
 
+/**
+ * @brief Resolve a "Range: bytes=..." value against a resource size.
+ *
+ * @return 1 with [*start, *start + *len) to send as 206, 0 to ignore the
+ *         header and send 200, -1 to answer 416
+ */
+int http_parse_range(const char *value, uint64_t size, uint64_t *start,
+                     uint64_t *len);
+
+/** @return 1 if an Accept-Encoding value allows `coding` (q > 0) */
+int http_accepts_encoding(const char *value, const char *coding);
+
+/** @return 1 if an If-None-Match value matches `etag` (weak comparison) */
+int http_etag_match(const char *value, const char *etag);
+
 #endif /* HTTP_PARSER_H */
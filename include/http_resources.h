@@ -27,18 +27,29 @@ SOFTWARE.
 #include <stddef.h>
 
 /**
- * Pre-compressed HTTP resource descriptor.
- * @field is_gzip  1 => send Content-Encoding: gzip before Content-Type
+ * Embedded web UI asset, generated by tools/generate_resources.py.
+ *
+ * @field hash       First hex digits of the identity SHA-256; the ETag
+ *                   is "<hash>" for identity, "<hash>-gz" / "<hash>-br"
+ *                   for the encoded variants
+ * @field gzip_data  Precompressed gzip body, NULL when not worth it
+ * @field br_data    Precompressed brotli body, NULL when not generated
  */
 typedef struct {
     const char          *path;
+    const char          *hash;
     const unsigned char *data;
     size_t               size;
-    size_t               original_size;
-    const char          *content_type;
-    int                  is_gzip;
+    const unsigned char *gzip_data;
+    size_t               gzip_size;
+    const unsigned char *br_data;
+    size_t               br_size;
 } http_resource_t;
 
+/**
+ * @brief Look up an embedded asset by its path relative to web/
+ * @return 0 and *out set on success, -1 if not embedded
+ */
 int http_resource_get(const char *path, const http_resource_t **out);
 
 #endif /* HTTP_RESOURCES_H */
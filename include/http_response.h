@@ -29,7 +29,7 @@ SOFTWARE.
  *   2xx  Success       (200, 201, 204)
  *   3xx  Redirection   (301, 304)
  *   4xx  Client error  (400, 403, 404, 405)
- *   5xx  Server error  (500)
+ *   5xx  Server error  (500, 503)
  */
 
 #ifndef HTTP_RESPONSE_H
@@ -39,6 +39,8 @@ SOFTWARE.
 #include <stddef.h>
 #include <sys/types.h>
 
+struct vfs_node;
+
 /*===========================================================================*
  * HTTP STATUS CODES
  *===========================================================================*/
@@ -48,6 +50,7 @@ typedef enum {
   HTTP_STATUS_200_OK = 200,
   HTTP_STATUS_201_CREATED = 201,
   HTTP_STATUS_204_NO_CONTENT = 204,
+  HTTP_STATUS_206_PARTIAL_CONTENT = 206,
 
   /*  3xx ── Redirection  */
   HTTP_STATUS_301_MOVED = 301,
@@ -59,15 +62,25 @@ typedef enum {
   HTTP_STATUS_404_NOT_FOUND = 404,
   HTTP_STATUS_405_METHOD_NOT_ALLOWED = 405,
   HTTP_STATUS_409_CONFLICT = 409,
+  HTTP_STATUS_416_RANGE_NOT_SATISFIABLE = 416,
 
   /*  5xx ── Server Error  */
   HTTP_STATUS_500_INTERNAL_ERROR = 500,
+  HTTP_STATUS_503_SERVICE_UNAVAILABLE = 503,
 } http_status_t;
 
 /*===========================================================================*
  * RESPONSE BUFFER
  *===========================================================================*/
 
+/**
+ * Body generator for a chunked response: write at most @p cap bytes of
+ * body into @p buf and return how many were written; 0 ends the body.
+ * Runs on the thread that sends the response, so it must not block on
+ * I/O — do the work in the handler and only format here.
+ */
+typedef size_t (*http_stream_fill_t)(void *ctx, char *buf, size_t cap);
+
 typedef struct {
   char data[HTTP_RESPONSE_BUFFER_SIZE];
   size_t used;
@@ -101,10 +114,18 @@ typedef struct {
                           * is never set, the process never returns.
                           * The flag is checked in http_server.c BEFORE
                           * the first call to pal_sendfile(). */
+  struct vfs_node *sendfile_node; /**< File inside a mounted image (owned,
+                                   *   read with vfs_pread; sendfile_fd is
+                                   *   -1 and sendfile_safe 0)          */
 
   /* Chunked directory streaming (for /api/list) */
   void *stream_dir;       /**< DIR* — NULL = not streaming       */
   char stream_path[1024]; /**< Base path for stat() calls        */
+
+  /* Chunked body from a generator (for /api/disk/tree) */
+  http_stream_fill_t stream_fill; /**< NULL = not used                 */
+  void (*stream_free)(void *ctx); /**< Releases stream_ctx on destroy  */
+  void *stream_ctx;
 } http_response_t;
 
 /*===========================================================================*
@@ -114,6 +135,8 @@ typedef struct {
 http_response_t *http_response_create(http_status_t status);
 int http_response_add_header(http_response_t *resp, const char *name,
                              const char *value);
+int http_response_set_header(http_response_t *resp, const char *name,
+                             const char *value);
 int http_response_set_body(http_response_t *resp, const void *body,
                            size_t length);
 int http_response_set_body_owned(http_response_t *resp, void *body,
@@ -124,9 +147,19 @@ int http_response_set_body_splice(http_response_t *resp, const void *prefix,
                                   size_t prefix_len, const void *insert,
                                   size_t insert_len, const void *suffix,
                                   size_t suffix_len);
+/**
+ * Finish the headers with Transfer-Encoding: chunked and produce the body
+ * from @p fill at send time.  On success the response owns @p ctx and
+ * hands it to @p release (may be NULL) when destroyed; on failure the
+ * caller still owns it.
+ */
+int http_response_set_body_stream(http_response_t *resp,
+                                  http_stream_fill_t fill,
+                                  void (*release)(void *ctx), void *ctx);
 int http_response_append_raw(http_response_t *resp, const void *data,
                              size_t length);
 int http_response_finalize(http_response_t *resp);
+int http_response_is_framed(const http_response_t *resp);
 void http_response_destroy(http_response_t *resp);
 
 #endif /* HTTP_RESPONSE_H */
@@ -52,6 +52,33 @@ typedef struct http_server http_server_t;
 http_server_t *http_server_create(event_loop_t *loop, const char *bind_addr,
                                   const char *root_path);
 
+/**
+ * @brief Create HTTP server on an already listening socket
+ *
+ * For a listener inherited from a previous process (ftp_handoff.h).
+ *
+ * @param loop      Event loop handle
+ * @param listen_fd Listening TCP socket; owned by the server (closed on
+ *                  failure too)
+ * @param root_path Filesystem root for confinement
+ *
+ * @return Server handle, or NULL on failure
+ */
+http_server_t *http_server_create_fd(event_loop_t *loop, int listen_fd,
+                                     const char *root_path);
+
+/** @brief Listening socket, or -1 once released */
+int http_server_listen_fd(const http_server_t *server);
+
+/**
+ * @brief Stop accepting without disturbing the listening socket
+ *
+ * The loop thread unregisters and closes this process's descriptor on
+ * its next tick; a process that received a copy keeps accepting.  Open
+ * connections are served until http_server_destroy().
+ */
+void http_server_release_listener(http_server_t *server);
+
 /**
  * @brief Stop and destroy HTTP server
  */
@@ -0,0 +1,119 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file http_sysmon.h
+ * @brief Background sampler behind the system stats endpoints
+ *
+ * RAM counters, CPU temperature and the boot time cost sysctl / procfs
+ * round trips, and the process list a full /proc walk.  Every open
+ * dashboard polls them, so they are sampled once by a thread instead:
+ *
+ *   sampler thread ──► ring[HTTP_SYSMON_HISTORY] ──► /api/stats/ram
+ *   (every HTTP_SYSMON_INTERVAL_MS)      │        ──► /api/stats/system
+ *                                        │        ──► ?since=N history
+ *                  process list ──► latest list ──► /api/processes
+ *                  (only while polled)
+ *
+ * Readers never take a lock for samples: each ring slot carries a
+ * sequence stamp (odd while the sampler writes it) and a reader simply
+ * copies again if the stamp moved.  The process list is swapped as a
+ * reference-counted block.
+ *
+ * The sampler parks after HTTP_SYSMON_IDLE_S without a reader.  The
+ * first request after that waits up to HTTP_SYSMON_WAIT_MS for a fresh
+ * sample, so nothing is sampled for nobody.
+ *
+ * THREAD SAFETY: every function may be called from any thread.
+ */
+
+#ifndef HTTP_SYSMON_H
+#define HTTP_SYSMON_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint64_t seq;     /**< 1, 2, ...; history is asked for by seq      */
+  int64_t at_ms;    /**< Wall clock of the sample (epoch ms)         */
+  int ram_ok;       /**< 0 = the ram_* fields are valid              */
+  uint64_t ram_used;
+  uint64_t ram_cached;
+  uint64_t ram_buffers;
+  uint64_t ram_free;
+  uint64_t ram_total;
+  int temp_ok;      /**< 0 = cpu_temp is valid                       */
+  int32_t cpu_temp; /**< Celsius                                     */
+  int boot_ok;      /**< 0 = boot_epoch is valid                     */
+  uint64_t boot_epoch;
+} http_sysmon_sample_t;
+
+typedef struct {
+  int pid;
+  unsigned int uid;
+  uint64_t mem_mb;
+  double cpu; /**< Percent of one core since the previous list      */
+  const char *status; /**< "running", "sleep" or "zombie"           */
+  char name[256];
+} http_sysmon_proc_t;
+
+/** Process list (by pid); read-only while acquired */
+typedef struct {
+  int64_t at_ms; /**< Wall clock of the listing (epoch ms)          */
+  size_t count;
+  const http_sysmon_proc_t *rows;
+} http_sysmon_procs_t;
+
+/**
+ * @brief Most recent sample
+ * @return 0, or -1 if none could be taken in time
+ */
+int http_sysmon_latest(http_sysmon_sample_t *out);
+
+/**
+ * @brief Samples newer than @p since, oldest first
+ *
+ * Only the last HTTP_SYSMON_HISTORY samples are kept; an older @p since
+ * returns all of them.
+ *
+ * @return number written to @p out (at most @p max)
+ */
+size_t http_sysmon_history(uint64_t since, http_sysmon_sample_t *out,
+                           size_t max);
+
+/**
+ * @brief Latest process list (listing starts on the first call)
+ * @return the list, to be given back to http_sysmon_procs_release(), or
+ *         NULL if none could be taken in time
+ */
+const http_sysmon_procs_t *http_sysmon_procs_acquire(void);
+void http_sysmon_procs_release(const http_sysmon_procs_t *procs);
+
+/** @brief Stop the sampler and drop the history */
+void http_sysmon_shutdown(void);
+
+/** @brief Restart sampling every @p interval_ms (tests; 0 = default) */
+void http_sysmon_reset(unsigned interval_ms);
+
+#endif /* HTTP_SYSMON_H */
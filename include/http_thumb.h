@@ -0,0 +1,102 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file http_thumb.h
+ * @brief Downsampled game icons, cached on disk
+ *
+ * A full-size icon0.png is 512x512 and a few hundred KB; a library page
+ * shows dozens of them at card size.  Icons are decoded once, box
+ * filtered down to the requested edge and re-encoded:
+ *
+ *   icon route ──► ETag matches? ──► 304
+ *        │
+ *        └─► http_thumb_get(key, edge) ──► cache file ──► bytes
+ *                     │ miss
+ *                     └─► load(user) ─► decode ─► downsample ─► encode
+ *                                                         │
+ *                                HTTP_THUMB_DIR ◄──────────┘
+ *
+ * The key names the source and its stamp (path, size, mtime), so a
+ * changed icon simply misses.  The ETag is derived from the key alone:
+ * a revalidation is answered without touching the icon at all.
+ *
+ * The PNG codec handles what console icons use: 8-bit gray, RGB,
+ * palette, gray+alpha and RGBA, not interlaced.  Anything else is
+ * cached and served at full size.  Output is 8-bit RGB(A), compressed
+ * with fixed-Huffman deflate (no zlib needed on the consoles).
+ *
+ * The cache is bounded by HTTP_THUMB_CACHE_MAX bytes; the least
+ * recently served files go first.
+ *
+ * THREAD SAFETY: every function may be called from any thread.
+ */
+
+#ifndef HTTP_THUMB_H
+#define HTTP_THUMB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Source of a full-size icon
+ * @return 0 with *png malloc()'d (the caller frees it), -1 if none
+ */
+typedef int (*http_thumb_load_fn)(void *user, uint8_t **png, size_t *len);
+
+/**
+ * @brief Edge served for a ?size= request
+ * @return 64, 128 or HTTP_THUMB_MAX_EDGE (rounded up), 0 = full size
+ */
+unsigned http_thumb_edge(unsigned requested);
+
+/** @brief Quoted ETag of (@p key, @p edge) */
+void http_thumb_etag(const char *key, unsigned edge, char *out,
+                     size_t out_size);
+
+/**
+ * @brief Icon for @p key at @p edge (0 = full size)
+ *
+ * @param data  Receives malloc()'d PNG bytes (the caller frees them)
+ * @return 0, or -1 if @p load found no icon
+ */
+int http_thumb_get(const char *key, unsigned edge, http_thumb_load_fn load,
+                   void *user, uint8_t **data, size_t *len);
+
+/**
+ * @brief Downsample a PNG so that its longer side is @p edge
+ *
+ * @return 0 with *out malloc()'d, 1 if the image is already that small,
+ *         -1 if it cannot be decoded
+ */
+int http_thumb_scale(const uint8_t *png, size_t len, unsigned edge,
+                     uint8_t **out, size_t *out_len);
+
+/**
+ * @brief Switch to another cache directory (tests)
+ * @param dir NULL = HTTP_THUMB_DIR, "" = no disk cache
+ */
+void http_thumb_reset(const char *dir);
+
+#endif /* HTTP_THUMB_H */
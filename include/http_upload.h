@@ -0,0 +1,141 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file http_upload.h
+ * @brief Write-behind pipeline for zhttpd uploads
+ *
+ * The event loop only moves body bytes off the socket; disk writes
+ * happen on a small pool of writer threads shared by every upload:
+ *
+ *   loop thread                          writer pool
+ *   ───────────                          ───────────
+ *   http_upload_feed()
+ *     recv ─► ring slot ─► commit ──────► pwrite(slot), consume
+ *     (or splice socket ─► pipe) ───────► splice pipe ─► file
+ *   ring/pipe full: PAUSED,                 space freed:
+ *   drop read interest   ◄── RESUME note ── post RESUME
+ *   body complete: FLUSHING ◄─ DONE note ── file closed, result set
+ *
+ * The ring is the pal_ring SPSC pipeline used by FTP STOR, driven with
+ * its non-blocking calls.  With splice enabled (Linux) the pages go
+ * socket ─► pipe ─► page cache and never touch userspace; a socket or
+ * filesystem that rejects splice falls back to the ring / a bounce
+ * buffer without losing bytes.
+ *
+ * Notes reach the loop through a pipe (http_upload_notes_fd()).  Each
+ * note holds a reference, so an upload released by the loop stays valid
+ * until the note is read; http_upload_owner() is NULL by then.
+ *
+ * @note Feed, release and note handling are loop-thread only.
+ */
+
+#ifndef HTTP_UPLOAD_H
+#define HTTP_UPLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct http_upload http_upload_t;
+
+/* http_upload_feed() results */
+#define HTTP_UPLOAD_MORE      0  /**< Keep read interest              */
+#define HTTP_UPLOAD_PAUSED    1  /**< Ring full: wait for RESUME/DONE */
+#define HTTP_UPLOAD_FLUSHING  2  /**< Body received: wait for DONE    */
+#define HTTP_UPLOAD_FAILED  (-1) /**< Socket error or early EOF       */
+
+/* Note kinds */
+#define HTTP_UPLOAD_NOTE_RESUME 1
+#define HTTP_UPLOAD_NOTE_DONE   2
+
+/**
+ * @brief Start the writer pool and the note pipe
+ *
+ * @param writers  threads; 0 runs every write inline in the feeding call
+ * @param splice   use the splice path where the platform has it
+ *
+ * @return 0 on success, -1 if the note pipe could not be created
+ */
+int http_upload_pool_start(unsigned writers, int splice);
+
+/**
+ * @brief Finish queued passes, join the writers, drop unread notes
+ *
+ * Uploads still open are not touched; release them first.
+ */
+void http_upload_pool_stop(void);
+
+/** @return read end of the note pipe (non-blocking), -1 if not started */
+int http_upload_notes_fd(void);
+
+/**
+ * @brief Start writing a body of @p length bytes from @p sock_fd
+ *
+ * Takes ownership of @p file_fd (closed by the writer or on release)
+ * and makes @p sock_fd non-blocking.
+ *
+ * @return upload, or NULL (file_fd is then left to the caller)
+ */
+http_upload_t *http_upload_open(int file_fd, uint64_t length, int sock_fd,
+                                void *owner);
+
+/**
+ * @brief Body bytes that arrived with the headers; call before feeding
+ *
+ * @return 0, or -1 if @p len exceeds the body or memory is short
+ */
+int http_upload_prefill(http_upload_t *up, const void *data, size_t len);
+
+/**
+ * @brief Move what the socket has (at most one slot) toward the disk
+ *
+ * @return HTTP_UPLOAD_MORE, _PAUSED, _FLUSHING or _FAILED
+ */
+int http_upload_feed(http_upload_t *up);
+
+/**
+ * @brief Read one note
+ *
+ * @return upload (call http_upload_note_done() on it), NULL when drained
+ */
+http_upload_t *http_upload_next_note(int *kind);
+
+/** @brief Drop the reference a note carried */
+void http_upload_note_done(http_upload_t *up);
+
+/** @return owner given to http_upload_open(), NULL once released */
+void *http_upload_owner(const http_upload_t *up);
+
+/** @return 0 once the whole body is on disk, -1 on a write failure */
+int http_upload_result(const http_upload_t *up);
+
+/**
+ * @brief Abandon the upload (client gone, connection closed)
+ *
+ * The writer stops, closes the file and the last reference frees it.
+ * No DONE note is posted after this.
+ */
+void http_upload_release(http_upload_t *up);
+
+#endif
@@ -43,6 +43,83 @@ SOFTWARE.
 #define PAL_ALLOC_HARD_FAIL 0
 #endif
 
+/*
+ * Small-object slabs
+ *
+ *   Requests up to PAL_ALLOC_SLAB_MAX bytes are served from power-of-two
+ *   size classes (16 B .. 4 KB) carved out of PAL_ALLOC_SLAB_PAGE buddy
+ *   blocks, fronted by a per-thread magazine of up to
+ *   PAL_ALLOC_MAGAZINE objects per class (fewer for large classes, see
+ *   PAL_ALLOC_MAGAZINE_BYTES).  Slab pages are never handed back to the
+ *   buddy allocator, so they are capped at 1/PAL_ALLOC_SLAB_SHARE of the
+ *   arena; past that, small requests take the buddy path again.
+ *   PAL_ALLOC_MAGAZINE 0 keeps the slabs but drops the magazines.
+ */
+#define PAL_ALLOC_SLAB_CLASSES 9U
+#define PAL_ALLOC_SLAB_MAX 4096U
+
+#ifndef PAL_ALLOC_MAGAZINE
+#define PAL_ALLOC_MAGAZINE 16U
+#endif
+
+#ifndef PAL_ALLOC_MAGAZINE_BYTES
+#define PAL_ALLOC_MAGAZINE_BYTES 32768U
+#endif
+
+#ifndef PAL_ALLOC_SLAB_PAGE
+#define PAL_ALLOC_SLAB_PAGE 65536U
+#endif
+
+#ifndef PAL_ALLOC_SLAB_SHARE
+#define PAL_ALLOC_SLAB_SHARE 4U
+#endif
+
+/*
+ * Large-block region
+ *
+ *   Requests of PAL_ALLOC_LARGE_MIN bytes or more (header included) are
+ *   served from a region of their own, kept as an address-ordered list
+ *   of free extents in PAL_ALLOC_LARGE_GRAIN units (best fit, coalesced
+ *   on free), so long-lived small blocks can no longer split the buddy
+ *   orders a big buffer needs.  The region takes 1/PAL_ALLOC_LARGE_DIV
+ *   of the arena plus whatever the power-of-two buddy area leaves over;
+ *   it is skipped when that comes to less than two PAL_ALLOC_LARGE_MIN
+ *   blocks.  Large requests fall back to the buddy area when the region
+ *   is full; smaller ones never enter it.  PAL_ALLOC_LARGE_DIV 0 gives
+ *   the whole arena to the buddy allocator.
+ */
+#ifndef PAL_ALLOC_LARGE_MIN
+#define PAL_ALLOC_LARGE_MIN (256U * 1024U)
+#endif
+
+#ifndef PAL_ALLOC_LARGE_DIV
+#define PAL_ALLOC_LARGE_DIV 2U
+#endif
+
+#ifndef PAL_ALLOC_LARGE_GRAIN
+#define PAL_ALLOC_LARGE_GRAIN 4096U
+#endif
+
+/* Buddy orders 5 (32 B) .. 26 (64 MB) */
+#define PAL_ALLOC_ORDERS ((26U - 5U) + 1U)
+
+/* Statistics shards; each thread counts into one, summed on read */
+#ifndef PAL_ALLOC_STAT_SHARDS
+#define PAL_ALLOC_STAT_SHARDS 8U
+#endif
+
+_Static_assert((PAL_ALLOC_SLAB_PAGE & (PAL_ALLOC_SLAB_PAGE - 1U)) == 0U &&
+                   PAL_ALLOC_SLAB_PAGE >= 4U * (PAL_ALLOC_SLAB_MAX + 16U),
+               "PAL_ALLOC_SLAB_PAGE must be a power of two >= 4 max objects");
+_Static_assert(PAL_ALLOC_SLAB_SHARE >= 1U, "PAL_ALLOC_SLAB_SHARE must be >= 1");
+_Static_assert(PAL_ALLOC_STAT_SHARDS >= 1U, "PAL_ALLOC_STAT_SHARDS must be >= 1");
+_Static_assert((PAL_ALLOC_LARGE_GRAIN & (PAL_ALLOC_LARGE_GRAIN - 1U)) == 0U &&
+                   PAL_ALLOC_LARGE_GRAIN >= 64U,
+               "PAL_ALLOC_LARGE_GRAIN must be a power of two >= 64");
+_Static_assert(PAL_ALLOC_LARGE_MIN > PAL_ALLOC_SLAB_MAX &&
+                   PAL_ALLOC_LARGE_MIN >= PAL_ALLOC_LARGE_GRAIN,
+               "PAL_ALLOC_LARGE_MIN must exceed the slab and grain sizes");
+
 typedef struct {
     uint64_t alloc_calls;
     uint64_t free_calls;
@@ -51,29 +128,65 @@ typedef struct {
     uint64_t aligned_calls;
     uint64_t failures;
     uint64_t bytes_in_use;
-    uint64_t bytes_peak;
+    uint64_t bytes_peak;  /* arena high-water mark (slab pages included) */
+    uint64_t slab_bytes;  /* arena bytes carved into slab pages          */
 } pal_alloc_stats_t;
 
+/*
+ * Fragmentation snapshot, taken under the arena lock.  A large
+ * buddy_free with a small buddy_largest means the free space is there
+ * but split; the same goes for the large region and its extents.
+ */
+typedef struct {
+    uint64_t buddy_size;
+    uint64_t buddy_free;
+    uint64_t buddy_largest;                /* biggest free buddy block  */
+    uint32_t free_blocks[PAL_ALLOC_ORDERS]; /* per order, [0] = order 5  */
+    uint32_t large_extents;                /* free extents in the region */
+    uint64_t large_size;                   /* 0 = no large region        */
+    uint64_t large_free;
+    uint64_t large_largest;                /* biggest free extent        */
+} pal_alloc_frag_t;
+
+typedef struct {
+    _Alignas(64) atomic_uint_fast64_t alloc_calls;
+    atomic_uint_fast64_t free_calls;
+    atomic_uint_fast64_t calloc_calls;
+    atomic_uint_fast64_t realloc_calls;
+    atomic_uint_fast64_t aligned_calls;
+    atomic_uint_fast64_t failures;
+    atomic_uint_fast64_t bytes_alloc;
+    atomic_uint_fast64_t bytes_freed;
+} pal_alloc_shard_t;
+
+typedef struct {
+    _Alignas(64) atomic_flag lock;
+    void *head; /* free objects, linked through their first word */
+    uint32_t count;
+} pal_alloc_slab_t;
+
 typedef struct pal_allocator {
     uint8_t *base;
     size_t size;
     uint32_t max_order;
     atomic_flag lock;
     atomic_int initialized;
-    atomic_uint_fast64_t alloc_calls;
-    atomic_uint_fast64_t free_calls;
-    atomic_uint_fast64_t calloc_calls;
-    atomic_uint_fast64_t realloc_calls;
-    atomic_uint_fast64_t aligned_calls;
-    atomic_uint_fast64_t failures;
-    atomic_uint_fast64_t bytes_in_use;
-    atomic_uint_fast64_t bytes_peak;
-    void *free_lists[(26U - 5U) + 1U];
+    atomic_uint epoch;      /* bumped by init: drops stale magazines */
+    uint64_t arena_in_use;  /* buddy bytes handed out, under lock    */
+    uint64_t arena_peak;    /* under lock                            */
+    uint64_t slab_bytes;    /* under lock                            */
+    uint8_t *large_base;    /* large-block region, NULL if none      */
+    size_t large_size;
+    void *large_free;       /* free extents, address order           */
+    void *free_lists[PAL_ALLOC_ORDERS];
+    pal_alloc_slab_t slabs[PAL_ALLOC_SLAB_CLASSES];
+    pal_alloc_shard_t shards[PAL_ALLOC_STAT_SHARDS];
 } pal_allocator_t;
 
 int pal_allocator_init(pal_allocator_t *a, void *buffer, size_t size);
 void pal_allocator_get_stats(pal_allocator_t *a, pal_alloc_stats_t *out);
 void pal_allocator_reset_stats(pal_allocator_t *a);
+void pal_allocator_get_frag(pal_allocator_t *a, pal_alloc_frag_t *out);
 void *pal_allocator_malloc(pal_allocator_t *a, size_t size);
 void pal_allocator_free(pal_allocator_t *a, void *ptr);
 void *pal_allocator_calloc(pal_allocator_t *a, size_t nmemb, size_t size);
@@ -87,6 +200,7 @@ size_t pal_alloc_arena_size(void);
 size_t pal_alloc_arena_free_approx(void);
 void pal_alloc_get_stats(pal_alloc_stats_t *out);
 void pal_alloc_reset_stats(void);
+void pal_alloc_get_frag(pal_alloc_frag_t *out);
 
 void *pal_malloc(size_t size);
 void pal_free(void *ptr);
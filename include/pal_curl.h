@@ -11,7 +11,7 @@
  * for all local-network transfers).
  *
  * Supported API surface:
- *   curl_global_init / curl_global_cleanup   (no-ops; for source compat)
+ *   curl_global_init / curl_global_cleanup   (cleanup closes pooled sockets)
  *   curl_easy_init / curl_easy_cleanup
  *   curl_easy_reset
  *   curl_easy_setopt
@@ -27,10 +27,14 @@
  * Timeouts          : connect and transfer, via select(2)
  * Speed guard       : CURLOPT_LOW_SPEED_LIMIT / LOW_SPEED_TIME
  * Progress          : CURLOPT_XFERINFOFUNCTION
+ * Disk sink         : CURLOPT_PAL_SINK_FD (receive/write pipeline)
+ * Keep-alive        : idle connections pooled per host:port, reused by
+ *                     any handle; resolved addresses cached for 60 s
  *
  * ── Thread-safety ──────────────────────────────────────────────────────────
- * NO function in this unit is thread-safe.  Each CURL handle must be
- * used from a single thread at a time.
+ * Each CURL handle must be used from a single thread at a time.  The
+ * connection pool and resolver cache behind them are shared and locked,
+ * so different handles may run on different threads.
  *
  * ── Build guard ────────────────────────────────────────────────────────────
  * Compiled only when ENABLE_LIBCURL=1 && (PS4 || PS5).
@@ -161,6 +165,18 @@ typedef int (*curl_xferinfo_callback)(void       *clientp,
 #define CURLOPT_TIMEOUT_MS          155     /* long milliseconds */
 #define CURLOPT_CONNECTTIMEOUT_MS   156     /* long milliseconds */
 
+/*
+ * pal_curl extensions (not in libcurl; test with #ifdef before use)
+ *
+ * CURLOPT_PAL_SINK_FD: the 2xx response body is written to this open fd,
+ * from its current offset, instead of being passed to the write callback.
+ * The body is received into pool buffers and written by a second thread,
+ * so network receive and disk writes overlap; chunked bodies are decoded
+ * in place.  A known Content-Length is preallocated first.  Progress,
+ * pause and cancel go through CURLOPT_XFERINFOFUNCTION.  -1 = off.
+ */
+#define CURLOPT_PAL_SINK_FD         9001    /* long fd */
+
 /*
  * FUNCTIONPOINT options   (base 20000 in libcurl)
  */
@@ -184,6 +200,11 @@ typedef int (*curl_xferinfo_callback)(void       *clientp,
 #define CURLINFO_SPEED_DOWNLOAD             0x30000B  /* double (bytes/s) */
 #define CURLINFO_CONTENT_LENGTH_DOWNLOAD    0x30000F  /* double (-1 if unknown) */
 
+/*
+ * OFF_T info   (base 0x600000, -1 if unknown)
+ */
+#define CURLINFO_CONTENT_LENGTH_DOWNLOAD_T  0x60000F  /* curl_off_t */
+
 /* ═══════════════════════════════════════════════════════════════════════════
  * API
  * ═════════════════════════════════════════════════════════════════════════*/
@@ -202,7 +223,8 @@ typedef int (*curl_xferinfo_callback)(void       *clientp,
 CURLcode curl_global_init(long flags);
 
 /**
- * @brief No-op stub counterpart to curl_global_init().
+ * @brief Counterpart to curl_global_init(): closes the idle keep-alive
+ *        connections and clears the resolver cache.
  *
  * @note Thread-safety: safe to call from any thread.
  * @note WCET: O(1).
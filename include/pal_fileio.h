@@ -108,6 +108,125 @@ SOFTWARE.
  */
 ssize_t pal_sendfile(int sock_fd, int file_fd, off_t *offset, size_t count);
 
+/*===========================================================================*
+ * COPY PROGRESS CALLBACK
+ *
+ *   Invoked after each read/write chunk during file copy and io_uring
+ *   transfers.
+ *
+ *   bytes_copied : cumulative bytes written so far (across all files)
+ *   user_data    : opaque pointer passed by the caller
+ *
+ *   Return:  0  = continue
+ *           -1  = cancel (copy will abort and return FTP_ERR_CANCELLED)
+ *===========================================================================*/
+
+typedef int (*pal_copy_progress_cb_t)(uint64_t bytes_copied, void *user_data);
+
+/*===========================================================================*
+ * ZERO-COPY FILE RECEIVE (Linux splice)
+ *===========================================================================*/
+
+#if defined(__linux__) && FTP_ENABLE_SPLICE
+#define HAS_SPLICE 1
+#else
+#define HAS_SPLICE 0
+#endif
+
+/**
+ * @brief Receive socket bytes into a file with splice() until EOF
+ *
+ * socket → pipe → file, no userspace copy.  Writes are positional from
+ * *offset; the fd's file position is left untouched.
+ *
+ * @param sock_fd   Connected data socket (SO_RCVTIMEO is honoured)
+ * @param file_fd   Destination file, must NOT be O_APPEND
+ * @param offset    Starting file offset (advanced by bytes written)
+ * @param bounce    Buffer used only to drain the pipe on fallback
+ * @param bounce_sz Size of bounce
+ * @param cb        Optional progress callback (cumulative bytes written)
+ * @param user_data Passed to cb
+ * @param out_bytes Output: bytes committed to the file
+ *
+ * @return FTP_OK on clean EOF
+ * @retval FTP_ERR_NOT_SUPPORTED Socket or filesystem rejects splice.  Any
+ *         bytes already received are in the file (*out_bytes, *offset);
+ *         the caller continues with its buffered loop from *offset.
+ * @retval FTP_ERR_SOCKET_RECV   Receive failed or cb cancelled (errno set)
+ * @retval FTP_ERR_FILE_WRITE    Write failed (errno set)
+ */
+ftp_error_t pal_splice_socket_to_file(int sock_fd, int file_fd, off_t *offset,
+                                      void *bounce, size_t bounce_sz,
+                                      pal_copy_progress_cb_t cb,
+                                      void *user_data, uint64_t *out_bytes);
+
+/*===========================================================================*
+ * IO_URING DATA PATH (Linux)
+ *===========================================================================*/
+
+#if defined(__linux__) && FTP_ENABLE_IO_URING
+#define HAS_IO_URING 1
+#else
+#define HAS_IO_URING 0
+#endif
+
+/**
+ * @brief Check whether the io_uring engine can run on this host
+ *
+ * @return 1 if available, 0 otherwise (non-Linux, old kernel, seccomp)
+ *
+ * @note Probed once; later calls are a single atomic load
+ */
+int pal_uring_available(void);
+
+/**
+ * @brief Stream file bytes to a socket through io_uring
+ *
+ * Splits buf into two halves: the read of chunk N+1 is in flight while
+ * chunk N is being sent, one io_uring_enter() per step.
+ *
+ * @param sock_fd   Connected data socket
+ * @param file_fd   Source file
+ * @param offset    File offset to start from (advanced by bytes sent)
+ * @param count     Bytes to send
+ * @param buf       Transfer buffer (typically from ftp_buffer_pool)
+ * @param buf_sz    Size of buf (>= 8 KB)
+ * @param cb        Optional progress callback (cumulative bytes sent)
+ * @param user_data Passed to cb
+ * @param out_bytes Output: bytes actually sent
+ *
+ * @return FTP_OK when all count bytes were sent
+ * @retval FTP_ERR_NOT_SUPPORTED Engine unavailable, nothing was sent
+ * @retval FTP_ERR_SOCKET_SEND   Send failed or cb cancelled (errno set)
+ * @retval FTP_ERR_FILE_READ     Read failed or file shrank (errno set)
+ * @retval FTP_ERR_TIMEOUT       No progress for FTP_DATA_IO_TIMEOUT_MS;
+ *                               the socket has been shut down
+ */
+ftp_error_t pal_uring_file_to_socket(int sock_fd, int file_fd, off_t *offset,
+                                     uint64_t count, void *buf, size_t buf_sz,
+                                     pal_copy_progress_cb_t cb, void *user_data,
+                                     uint64_t *out_bytes);
+
+/**
+ * @brief Receive socket bytes into a file through io_uring until EOF
+ *
+ * Mirror of pal_uring_file_to_socket(): the write of chunk N overlaps
+ * the recv of chunk N+1.  Writes are positional (pwrite semantics).
+ *
+ * @param offset    File offset to start writing at (advanced on return)
+ * @param out_bytes Output: bytes durably handed to the file
+ *
+ * @return FTP_OK on clean EOF with every byte written
+ * @retval FTP_ERR_NOT_SUPPORTED Engine unavailable, nothing was received
+ * @retval FTP_ERR_SOCKET_RECV   Receive failed or cb cancelled (errno set)
+ * @retval FTP_ERR_FILE_WRITE    Write failed (errno set)
+ * @retval FTP_ERR_TIMEOUT       No progress for FTP_DATA_IO_TIMEOUT_MS
+ */
+ftp_error_t pal_uring_socket_to_file(int sock_fd, int file_fd, off_t *offset,
+                                     void *buf, size_t buf_sz,
+                                     pal_copy_progress_cb_t cb, void *user_data,
+                                     uint64_t *out_bytes);
+
 /*===========================================================================*
  * FILE OPERATIONS
  *===========================================================================*/
@@ -241,6 +360,172 @@ off_t pal_file_seek(int fd, off_t offset, int whence);
  */
 ftp_error_t pal_file_truncate(int fd, off_t len);
 
+/**
+ * @brief Reserve disk blocks for a file about to be written
+ *
+ * Linux fallocate(2) / FreeBSD posix_fallocate(2) / macOS F_PREALLOCATE.
+ * Never emulated by writing zeros: filesystems without native support
+ * report FTP_ERR_NOT_SUPPORTED and the caller just writes.
+ *
+ * @param fd  File descriptor (open for writing)
+ * @param len Bytes to reserve from offset 0.  Linux and macOS keep the
+ *            file size; FreeBSD grows it to len, so a caller that may
+ *            write less truncates to what it wrote.
+ *
+ * @return FTP_OK, FTP_ERR_NOT_SUPPORTED, or FTP_ERR_FILE_WRITE (ENOSPC...)
+ *
+ * @pre fd >= 0
+ */
+ftp_error_t pal_file_preallocate(int fd, off_t len);
+
+/**
+ * @brief Push a written range of a file towards the disk
+ *
+ * @param fd     File descriptor
+ * @param offset Start of the range
+ * @param len    Length of the range
+ * @param wait   0 = start writeback and return at once (Linux
+ *               sync_file_range(2); FTP_ERR_NOT_SUPPORTED elsewhere);
+ *               1 = return once the range is on disk (Linux: that range
+ *               only; elsewhere fsync() of the whole file)
+ *
+ * @return FTP_OK, FTP_ERR_NOT_SUPPORTED, or FTP_ERR_FILE_WRITE
+ *
+ * @pre fd >= 0
+ */
+ftp_error_t pal_file_writeback(int fd, off_t offset, off_t len, int wait);
+
+/*===========================================================================*
+ * PER-TRANSFER CACHE POLICY
+ *
+ *   One multi-GB image read through the page cache evicts the small
+ *   files that are actually hot.  Each transfer therefore picks how it
+ *   uses the cache:
+ *
+ *     PAL_IO_CACHED  small or already-resident file: no hints
+ *     PAL_IO_STREAM  large RETR: FADV_SEQUENTIAL, a WILLNEED window kept
+ *                    ahead of the send position, sent pages dropped
+ *                    behind it (FADV_DONTNEED)
+ *     PAL_IO_DIRECT  large STOR: O_DIRECT writes staged in an aligned
+ *                    pool buffer, the upload never enters the cache
+ *
+ *       [ dropped ][ sent ]▲[ window (WILLNEED) ][ not read yet ]
+ *                         pos
+ *===========================================================================*/
+
+typedef enum {
+  PAL_IO_CACHED = 0,
+  PAL_IO_STREAM = 1,
+  PAL_IO_DIRECT = 2,
+} pal_io_policy_t;
+
+/** Process-wide counters (pal_io_get_stats) */
+typedef struct {
+  uint64_t cached;          /**< Transfers left to the page cache      */
+  uint64_t streamed;        /**< RETRs with read-ahead + drop-behind   */
+  uint64_t direct;          /**< STORs switched to O_DIRECT            */
+  uint64_t readahead_bytes; /**< WILLNEED ranges issued                */
+  uint64_t dropped_bytes;   /**< DONTNEED ranges issued                */
+  uint64_t direct_bytes;    /**< Bytes written with O_DIRECT           */
+  uint64_t probed_bytes;    /**< Large-RETR bytes sampled for residency */
+  uint64_t resident_bytes;  /**< Estimated share already in the cache  */
+} pal_io_stats_t;
+
+/** Read side of one transfer (pal_io_read_begin) */
+typedef struct {
+  int fd;
+  pal_io_policy_t policy;
+  off_t end;     /* end of the transfer range            */
+  off_t window;  /* read-ahead window                    */
+  off_t ahead;   /* WILLNEED issued up to here           */
+  off_t dropped; /* pages below this have been dropped   */
+} pal_io_reader_t;
+
+/** Write side of one transfer (pal_io_write_begin) */
+typedef struct {
+  int fd;
+  int direct;       /* O_DIRECT currently set on fd            */
+  uint8_t *stage;   /* aligned staging buffer (caller-owned)   */
+  size_t cap;       /* stage size, multiple of PAL_IO_ALIGN    */
+  size_t staged;    /* bytes waiting in stage                  */
+  size_t lead;      /* buffered bytes up to the aligned offset */
+} pal_io_writer_t;
+
+/** O_DIRECT offset / length / address alignment */
+#define PAL_IO_ALIGN 4096U
+
+/**
+ * @brief Choose the read policy for sending [start, start + len)
+ *
+ * Ranges of at least @p stream_min bytes stream unless a sample of
+ * their pages (mincore) shows they are mostly cached already; then the
+ * cached copy is worth keeping.
+ *
+ * @param r          Reader state (initialised here)
+ * @param fd         Source file
+ * @param start      First byte to be sent
+ * @param len        Bytes to be sent
+ * @param stream_min Streaming threshold (0 = never stream)
+ * @param window     Read-ahead window in bytes (0 = kernel default)
+ *
+ * @return PAL_IO_CACHED or PAL_IO_STREAM
+ */
+pal_io_policy_t pal_io_read_begin(pal_io_reader_t *r, int fd, off_t start,
+                                  uint64_t len, uint64_t stream_min,
+                                  off_t window);
+
+/**
+ * @brief Report that everything below @p pos has been sent
+ *
+ * Drops the sent pages and tops up the read-ahead window.  No-op for
+ * PAL_IO_CACHED and for NULL.
+ */
+void pal_io_read_advance(pal_io_reader_t *r, off_t pos);
+
+/**
+ * @brief Ask the kernel to start reading [offset, offset + len) into the
+ *        page cache (FADV_WILLNEED), without waiting for it
+ *
+ * @return FTP_OK, or FTP_ERR_NOT_SUPPORTED where hints are off (PS4) or
+ *         refused; the caller may read the range itself instead
+ */
+ftp_error_t pal_io_prefetch(int fd, off_t offset, off_t len);
+
+/**
+ * @brief Start O_DIRECT writing at the current offset of @p fd
+ *
+ * Bytes up to the next PAL_IO_ALIGN boundary go through the cache; from
+ * there every write is a full, aligned @p stage.
+ *
+ * @param stage Staging buffer aligned to PAL_IO_ALIGN
+ * @param cap   Its size, a non-zero multiple of PAL_IO_ALIGN
+ *
+ * @return FTP_OK, or FTP_ERR_NOT_SUPPORTED (no O_DIRECT on this
+ *         platform or filesystem, misaligned stage); nothing was written
+ */
+ftp_error_t pal_io_write_begin(pal_io_writer_t *w, int fd, void *stage,
+                               size_t cap);
+
+/**
+ * @brief Write through the stage
+ *
+ * A filesystem that rejects an O_DIRECT write mid-way (EINVAL) is
+ * finished through the cache instead.
+ *
+ * @return @p len, or -1 with errno set
+ */
+ssize_t pal_io_write(pal_io_writer_t *w, const void *buf, size_t len);
+
+/**
+ * @brief Write the staged tail through the cache and clear O_DIRECT
+ *
+ * @return FTP_OK or FTP_ERR_FILE_WRITE (errno set)
+ */
+ftp_error_t pal_io_write_end(pal_io_writer_t *w);
+
+/** @brief Snapshot the cache-policy counters */
+void pal_io_get_stats(pal_io_stats_t *out);
+
 /**
  * @brief Delete file
  *
@@ -277,20 +562,6 @@ ftp_error_t pal_file_rename(const char *old_path, const char *new_path);
 ftp_error_t pal_file_copy_recursive(const char *src, const char *dst,
                                     int keep_src);
 
-/*===========================================================================*
- * COPY PROGRESS CALLBACK
- *
- *   Invoked after each read/write chunk during file copy.
- *
- *   bytes_copied : cumulative bytes written so far (across all files)
- *   user_data    : opaque pointer passed by the caller
- *
- *   Return:  0  = continue
- *           -1  = cancel (copy will abort and return FTP_ERR_CANCELLED)
- *===========================================================================*/
-
-typedef int (*pal_copy_progress_cb_t)(uint64_t bytes_copied, void *user_data);
-
 /**
  * @brief Recursively copy with progress reporting
  *
@@ -300,6 +571,18 @@ ftp_error_t pal_file_copy_recursive_ex(const char *src, const char *dst,
                                        int keep_src, pal_copy_progress_cb_t cb,
                                        void *user_data, int *out_errno);
 
+/**
+ * @brief Copy one regular file with progress reporting
+ *
+ * The per-file step of pal_file_copy_recursive_ex(): written to a temp
+ * file next to @p dst and renamed into place.  Files larger than one
+ * PAL_FILE_COPY_BUFFER_SIZE go through the reader/writer pipeline.
+ * @p cb receives the bytes copied of this file only.
+ */
+ftp_error_t pal_file_copy_file_ex(const char *src, const char *dst,
+                                  pal_copy_progress_cb_t cb, void *user_data,
+                                  int *out_errno);
+
 /*===========================================================================*
  * DIRECTORY OPERATIONS
  *===========================================================================*/
@@ -33,7 +33,8 @@ SOFTWARE.
 
 typedef enum {
     VFS_CAP_SENDFILE = 1U << 0,
-    VFS_CAP_STREAM_ONLY = 1U << 1
+    VFS_CAP_STREAM_ONLY = 1U << 1,
+    VFS_CAP_IMAGE = 1U << 2      /* file inside a mounted image, fd = -1 */
 } vfs_capability_t;
 
 typedef struct {
@@ -58,6 +59,12 @@ typedef struct vfs_node {
         uint64_t phoff;
         uint64_t file_size;
         uint32_t magic;
+        void *phdrs;       /* Elf64_Phdr[phnum], read once at open        */
+        void *entries;     /* self_entry_t[num_entries], read once at open */
+        uint16_t last_seg; /* phdr that covered the previous read         */
+        uint64_t dev;      /* segment cache key: dev, inode, mtime        */
+        uint64_t ino;
+        int64_t mtime;
     } psx;
 #endif
 } vfs_node_t;
@@ -68,6 +75,59 @@ void vfs_close(vfs_node_t *node);
 void vfs_set_offset(vfs_node_t *node, uint64_t offset);
 ssize_t vfs_read(vfs_node_t *node, void *buffer, size_t length);
 
+/**
+ * @brief Read at @p offset without moving the node's offset
+ * @return Bytes read, 0 at end of file, -1 with errno set
+ */
+ssize_t vfs_pread(vfs_node_t *node, void *buffer, size_t length,
+                  uint64_t offset);
+
+/*
+ * MOUNTED exFAT IMAGES (pal_filesystem_image.c)
+ *
+ *   vfs_mount_image("/data/games.exfat", "/data/games")
+ *
+ *   The image's directory tree is read once into an index hashed by
+ *   path; afterwards vfs_stat(), vfs_open() and vfs_image_readdir() on
+ *   "/data/games/..." are answered from the index, and reads go straight
+ *   to the file's extents in the image (no extraction, no temp space).
+ *   Mounts are read-only.  The mount point must not exist on disk, so
+ *   writes below it fail as they would for any missing directory.
+ *
+ *   Paths are matched as given: pass normalized, absolute paths (what
+ *   ftp_path_resolve() and the HTTP confinement produce).
+ */
+
+/**
+ * @brief Mount the exFAT image @p image read-only at @p at
+ *
+ * @return FTP_OK, FTP_ERR_FILE_OPEN / FTP_ERR_FILE_READ for an unreadable
+ *         or malformed image, FTP_ERR_DIR_EXISTS if @p at exists on disk
+ *         or overlaps a mount, FTP_ERR_MAX_SESSIONS when all
+ *         FTP_VFS_IMAGE_MOUNTS slots are taken
+ */
+ftp_error_t vfs_mount_image(const char *image, const char *at);
+
+/**
+ * @brief Unmount the image at @p at
+ * @note Files still open keep the image until they are closed
+ * @return FTP_OK, or FTP_ERR_NOT_FOUND
+ */
+ftp_error_t vfs_unmount_image(const char *at);
+
+/** @return 1 if @p path is a mount point or lies below one, else 0 */
+int vfs_is_image_path(const char *path);
+
+/** Called per entry; return non-zero to stop the walk */
+typedef int (*vfs_dir_fn)(void *user, const char *name, const vfs_stat_t *st);
+
+/**
+ * @brief List the image directory @p path in on-disk order
+ * @return FTP_OK, FTP_ERR_NOT_FOUND if @p path is not a directory of a
+ *         mounted image
+ */
+ftp_error_t vfs_image_readdir(const char *path, vfs_dir_fn fn, void *user);
+
 static inline vfs_capability_t vfs_get_caps(const vfs_node_t *node)
 {
     return (node != NULL) ? node->caps : 0;
@@ -39,10 +39,13 @@ SOFTWARE.
 #define PAL_NETWORK_H
 
 #include "ftp_types.h"
+#include "pal_sock_tune.h"
+#include "pal_zerocopy.h"
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 /*===========================================================================*
@@ -337,6 +340,16 @@ ftp_error_t pal_socket_set_timeouts(socket_t fd, uint32_t recv_timeout_ms,
 
 ssize_t pal_send_all(socket_t fd, const void *buffer, size_t length, int flags);
 
+/**
+ * @brief Gathered pal_send_all(): send every byte of iov[0..iovcnt)
+ *
+ * Lets a header block and its body leave in one sendmsg() instead of
+ * two send() calls.  The iovec array is advanced in place.
+ *
+ * @return Total bytes sent, or -1 with errno set
+ */
+ssize_t pal_sendv_all(socket_t fd, struct iovec *iov, int iovcnt, int flags);
+
 /*===========================================================================*
  * UTILITY FUNCTIONS
  *===========================================================================*/
@@ -432,13 +445,13 @@ ftp_error_t pal_make_sockaddr_ex(const char *addr_str,
  * sockets.  Addresses progressive throughput degradation after large transfers
  * to the internal SSD or M.2 on PS4/PS5.
  *
- * @param sessions  Pointer to the server session pool (ftp_server_context_t.sessions)
- * @param count     Pool size (FTP_MAX_SESSIONS)
+ * @param sessions  Server session slots (ftp_server_context_t.sessions)
+ * @param count     Allocated slots (ftp_server_context_t.session_slots)
  *
- * @return 0 on success, -1 if sessions/count invalid
+ * @return 0 on success, -1 if sessions is NULL
  *
  * @note Thread-safety: Do NOT call while a session is mid-accept.
  *       Safe to call from the HTTP API handler thread.
  * @note Does NOT interrupt active (TRANSFERRING) sessions.
  */
-int pal_network_reset_ftp_stack(ftp_session_t *sessions, size_t count);
+int pal_network_reset_ftp_stack(ftp_session_t *const *sessions, size_t count);
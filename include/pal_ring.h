@@ -0,0 +1,192 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file pal_ring.h
+ * @brief Platform Abstraction Layer - Adaptive SPSC buffer ring
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * One producer fills buffers, one consumer drains them.  Replaces the
+ * fixed two-buffer handoffs of cmd_STOR and the cross-device copy.
+ *
+ *   producer ──acquire/commit──► [full queue]  ──peek/consume──► consumer
+ *            ◄──────────────────  [free queue] ◄─────────────────
+ *
+ * Both queues are lock-free single-producer/single-consumer index rings.
+ * The mutex/condvar pair is touched only on the empty and full edges,
+ * i.e. when one side is actually going to sleep.
+ *
+ * ADAPTIVE DEPTH: the ring starts with initial_depth buffers.  When the
+ * producer has to wait for a free buffer on grow_after consecutive
+ * acquires (the consumer is lagging, e.g. PFS crypto stalls), one more
+ * buffer is allocated, up to max_depth.  Allocation failure simply stops
+ * the growth; it is never an error.
+ */
+#ifndef PAL_RING_H
+#define PAL_RING_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Hard cap on buffers per ring (power of two) */
+#define PAL_RING_MAX_SLOTS 16U
+
+typedef void *(*pal_ring_alloc_fn)(void *ctx);
+typedef void (*pal_ring_free_fn)(void *buf, void *ctx);
+
+typedef struct {
+    unsigned initial_depth; /**< Buffers allocated up front (>= 2)       */
+    unsigned max_depth;     /**< Growth limit (<= PAL_RING_MAX_SLOTS)    */
+    unsigned grow_after;    /**< Consecutive stalled acquires per growth */
+    size_t slot_size;       /**< Bytes per buffer                        */
+    pal_ring_alloc_fn alloc;
+    pal_ring_free_fn release;
+    void *ctx;
+} pal_ring_config_t;
+
+typedef struct {
+    void *buf;
+    size_t len;
+} pal_ring_entry_t;
+
+typedef struct pal_ring {
+    pal_ring_config_t cfg;
+
+    /* producer → consumer */
+    pal_ring_entry_t full[PAL_RING_MAX_SLOTS];
+    atomic_uint full_head;
+    atomic_uint full_tail;
+
+    /* consumer → producer */
+    void *free_q[PAL_RING_MAX_SLOTS];
+    atomic_uint free_head;
+    atomic_uint free_tail;
+
+    /* every buffer ever allocated (for destroy) */
+    void *owned[PAL_RING_MAX_SLOTS];
+    unsigned depth;        /* producer-private: buffers allocated */
+    unsigned stall_streak; /* producer-private                    */
+    void *spare;           /* producer-private: unacquired buffer */
+
+    atomic_int closed;  /* producer finished (EOF)             */
+    atomic_int aborted; /* either side gave up                  */
+    atomic_int error;   /* errno passed to pal_ring_abort()     */
+    atomic_int prod_sleeping;
+    atomic_int cons_sleeping;
+    atomic_uint peak_depth;
+
+    pthread_mutex_t mtx;
+    pthread_cond_t cv_prod;
+    pthread_cond_t cv_cons;
+} pal_ring_t;
+
+/**
+ * @brief Initialise a ring and allocate initial_depth buffers
+ *
+ * @return 0 on success, -1 if the config is invalid or fewer than two
+ *         buffers could be allocated (caller falls back to single-buffer)
+ */
+int pal_ring_init(pal_ring_t *ring, const pal_ring_config_t *cfg);
+
+/** @brief Release every buffer through cfg.release.  Both sides must be done. */
+void pal_ring_destroy(pal_ring_t *ring);
+
+/*---------------------------------------------------------------------------*
+ * Producer side
+ *---------------------------------------------------------------------------*/
+
+/**
+ * @brief Get an empty buffer (cfg.slot_size bytes), blocking if needed
+ *
+ * @return buffer, or NULL once the consumer has aborted
+ */
+void *pal_ring_acquire(pal_ring_t *ring);
+
+/**
+ * @brief pal_ring_acquire() that never sleeps
+ *
+ * For producers driven by an event loop.  An empty free queue counts as
+ * a stall, so a lagging consumer still makes the ring grow.
+ *
+ * @return buffer, or NULL if none is free right now or the ring aborted
+ */
+void *pal_ring_try_acquire(pal_ring_t *ring);
+
+/** @brief Hand a filled buffer to the consumer */
+void pal_ring_commit(pal_ring_t *ring, void *buf, size_t len);
+
+/** @brief Return an acquired but unfilled buffer */
+void pal_ring_unacquire(pal_ring_t *ring, void *buf);
+
+/** @brief Signal EOF: the consumer drains what is queued, then sees NULL */
+void pal_ring_close(pal_ring_t *ring);
+
+/*---------------------------------------------------------------------------*
+ * Consumer side
+ *---------------------------------------------------------------------------*/
+
+/**
+ * @brief Wait for the next filled buffer
+ *
+ * @return buffer with *len bytes, or NULL on EOF (closed and drained)
+ *         or abort
+ */
+void *pal_ring_peek(pal_ring_t *ring, size_t *len);
+
+/**
+ * @brief pal_ring_peek() that never sleeps
+ *
+ * @return 1 with *buf / *len set, 0 if nothing is queued yet, -1 on EOF
+ *         (closed and drained) or abort
+ */
+int pal_ring_try_peek(pal_ring_t *ring, void **buf, size_t *len);
+
+/**
+ * @return 1 if a consumer call would not find the ring idle: a buffer is
+ *         queued, or the ring is closed or aborted
+ */
+int pal_ring_pending(pal_ring_t *ring);
+
+/** @brief Return a drained buffer to the producer */
+void pal_ring_consume(pal_ring_t *ring, void *buf);
+
+/*---------------------------------------------------------------------------*
+ * Either side
+ *---------------------------------------------------------------------------*/
+
+/** @brief Stop the pipeline; the other side's blocking call returns NULL */
+void pal_ring_abort(pal_ring_t *ring, int err);
+
+/** @return errno given to pal_ring_abort(), 0 if none */
+int pal_ring_error(pal_ring_t *ring);
+
+/** @return largest depth reached (telemetry) */
+unsigned pal_ring_peak_depth(pal_ring_t *ring);
+
+#endif
@@ -30,6 +30,17 @@ SOFTWARE.
  * @version 1.0.0
  * @date 2026-02-13
  * 
+ * Two kinds of temporary memory that never touch the general heap in
+ * the common case:
+ *
+ *   slots  PAL_SCRATCH_SLOTS shared buffers of PAL_SCRATCH_SIZE bytes
+ *          for multi-MB needs; pal_scratch_acquire() takes any free one
+ *   arena  a per-thread bump arena of PAL_SCRATCH_ARENA_SIZE bytes,
+ *          scoped with pal_scratch_mark() / pal_scratch_reset()
+ *
+ * pal_scratch_get() and pal_scratch_alloc() fall back to malloc() when
+ * the slots are busy or the arena is full; those fallbacks are counted
+ * in pal_scratch_stats_t so the sizes can be tuned.
  */
 #ifndef PAL_SCRATCH_H
 #define PAL_SCRATCH_H
@@ -37,8 +48,50 @@ SOFTWARE.
 #include <stddef.h>
 #include <stdint.h>
 
+#ifndef PAL_SCRATCH_SIZE
+#define PAL_SCRATCH_SIZE (2U * 1024U * 1024U)
+#endif
+
+#ifndef PAL_SCRATCH_SLOTS
+#define PAL_SCRATCH_SLOTS 2U
+#endif
+
+#ifndef PAL_SCRATCH_ARENA_SIZE
+#define PAL_SCRATCH_ARENA_SIZE (128U * 1024U)
+#endif
+
+_Static_assert(PAL_SCRATCH_SLOTS >= 1U && PAL_SCRATCH_SLOTS <= 32U,
+               "PAL_SCRATCH_SLOTS must be 1..32");
+
+typedef struct {
+    uint64_t slot_acquires; /* slots handed out                          */
+    uint64_t slot_busy;     /* requests that found every slot taken      */
+    uint64_t arena_allocs;  /* served from a thread arena                */
+    uint64_t fallbacks;     /* served by malloc() instead                */
+    uint64_t fallback_bytes;
+    uint32_t slots_in_use;
+    uint32_t arenas;        /* thread arenas currently allocated         */
+} pal_scratch_stats_t;
+
+/* Arena position; everything allocated after it goes on reset */
+typedef struct {
+    size_t used;
+    void *spill;
+} pal_scratch_mark_t;
+
+/* Shared slot, zeroed for @p need bytes; -1 if none is free or too big */
 int pal_scratch_acquire(uint8_t **out, size_t need);
 void pal_scratch_release(uint8_t *ptr);
 size_t pal_scratch_capacity(void);
 
+/* Slot if one is free, else malloc(); release with pal_scratch_put() */
+void *pal_scratch_get(size_t need);
+void pal_scratch_put(void *ptr);
+
+pal_scratch_mark_t pal_scratch_mark(void);
+void *pal_scratch_alloc(size_t size);
+void pal_scratch_reset(pal_scratch_mark_t mark);
+
+void pal_scratch_get_stats(pal_scratch_stats_t *out);
+
 #endif
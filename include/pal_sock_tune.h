@@ -0,0 +1,140 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file pal_sock_tune.h
+ * @brief TCP_INFO sampling and data socket buffer auto-tuning
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Kept apart from pal_network.h so ftp_types.h can embed the controller
+ * in the session.  Implemented in pal_network.c.
+ *
+ * THREAD SAFETY: a controller belongs to one transfer thread; the kernel
+ * limits it reads are cached process-wide on first use.
+ */
+
+#ifndef PAL_SOCK_TUNE_H
+#define PAL_SOCK_TUNE_H
+
+#include <stdint.h>
+
+/*===========================================================================*
+ * TCP_INFO SAMPLING AND BUFFER AUTO-TUNING
+ *
+ *   transfer loop ──► pal_sock_tune_tick() ──(every interval)──┐
+ *                                                              ▼
+ *        TCP_INFO + send queue ──► pal_sock_tune_target() ──► setsockopt
+ *
+ *   The target is twice the bandwidth-delay product: delivered rate ×
+ *   smoothed RTT, or the bytes in flight when that is larger.  While the
+ *   buffer is what limits the window, in flight ≈ buffer, so the target
+ *   doubles each interval until the link (or a retransmit) stops it.
+ *===========================================================================*/
+
+/** One TCP_INFO sample, normalised across stacks (0 = not reported) */
+typedef struct {
+  uint32_t rtt_us;         /**< Smoothed RTT                          */
+  uint32_t rttvar_us;      /**< RTT variance                          */
+  uint32_t mss;            /**< Send MSS                              */
+  uint32_t cwnd_bytes;     /**< Congestion window                     */
+  uint32_t retrans;        /**< Retransmitted segments (total)        */
+  uint32_t inflight_bytes; /**< Sent, not yet acknowledged            */
+  uint32_t sendq_bytes;    /**< Send queue: unsent + unacknowledged   */
+  uint32_t sndbuf;         /**< SO_SNDBUF as getsockopt() reports it  */
+  uint32_t rcvbuf;         /**< SO_RCVBUF as getsockopt() reports it  */
+} pal_tcp_info_t;
+
+/**
+ * @brief Sample a connected TCP socket
+ *
+ * Linux: TCP_INFO + SIOCOUTQ.  FreeBSD / PS4 / PS5: TCP_INFO + FIONWRITE.
+ * macOS: TCP_CONNECTION_INFO.  Fields a stack does not report stay 0.
+ *
+ * @return 0 on success, -1 if the platform has no TCP_INFO or it failed
+ */
+int pal_socket_tcp_info(int fd, pal_tcp_info_t *out);
+
+/** Kernel limits for one buffer, in getsockopt() units */
+typedef struct {
+  uint32_t auto_max; /**< Kernel autotuning ceiling (0 = none)          */
+  uint32_t set_max;  /**< Largest explicit size accepted                */
+  int kernel_auto;   /**< 1 = nobody set the buffer: the kernel tunes it */
+} pal_sock_limits_t;
+
+/** Per-connection controller (embedded in the session, no allocation) */
+typedef struct {
+  int fd;
+  int rx;                 /**< Tune SO_RCVBUF (receiving side)          */
+  pal_sock_limits_t lim;  /**< Limits for this buffer                   */
+  uint32_t buf;           /**< Current size (getsockopt units)          */
+  uint32_t resizes;       /**< Times the buffer was grown               */
+  uint32_t retrans_delta; /**< Retransmits during the last interval     */
+  uint64_t next_ns;       /**< Next sample due                          */
+  uint64_t last_ns;       /**< Previous sample                          */
+  uint64_t last_bytes;    /**< Bytes moved at the previous sample       */
+  uint64_t rate_bps;      /**< Delivered rate over the last interval    */
+  pal_tcp_info_t info;    /**< Latest sample                            */
+} pal_sock_tune_t;
+
+/**
+ * @brief Size to grow a buffer to, or 0 to leave it
+ *
+ * Pure policy (no syscalls): holds while the last interval retransmitted,
+ * ignores gains under 25%, defers to kernel autotuning until the target
+ * passes lim->auto_max, and never exceeds lim->set_max or
+ * FTP_SOCK_TUNE_MAX_BUF.
+ *
+ * @param info     Latest sample
+ * @param rate_bps Bytes per second delivered over the last interval
+ * @param retrans  Retransmits during the last interval
+ * @param cur      Current buffer size (getsockopt units)
+ */
+uint32_t pal_sock_tune_target(const pal_tcp_info_t *info, uint64_t rate_bps,
+                              uint32_t retrans, uint32_t cur,
+                              const pal_sock_limits_t *lim);
+
+/**
+ * @brief Start tuning a data socket
+ *
+ * @param rx    Nonzero for a receiving transfer (STOR/APPE)
+ * @param bytes Bytes the connection has moved so far
+ */
+void pal_sock_tune_begin(pal_sock_tune_t *t, int fd, int rx,
+                         uint64_t bytes, uint64_t now_ns);
+
+/**
+ * @brief Account progress; sample and maybe resize once per interval
+ *
+ * Cheap when no sample is due (one comparison).
+ *
+ * @param bytes  Bytes the connection has moved so far (cumulative)
+ *
+ * @return 1 if a sample was taken (t->info, t->rate_bps and
+ *         t->retrans_delta are fresh), 0 otherwise
+ */
+int pal_sock_tune_tick(pal_sock_tune_t *t, uint64_t bytes, uint64_t now_ns);
+
+#endif /* PAL_SOCK_TUNE_H */
@@ -0,0 +1,131 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file pal_thread.h
+ * @brief Thread roles: CPU placement and priority for every server thread
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Every thread the server starts belongs to a role.  A role may carry a
+ * CPU set and a nice value; pal_thread_create() applies both from inside
+ * the new thread before its function runs:
+ *
+ *   pal_thread_create(role, fn) ──► pthread_create(trampoline)
+ *                                       │  affinity (role CPUs)
+ *                                       │  priority (role nice)
+ *                                       └► fn(arg)
+ *
+ * Roles without placement start exactly as a plain pthread_create().
+ * On Linux a pinned thread also keeps the memory it first touches
+ * (stream buffers, magazines) on its own NUMA node.
+ *
+ * SPEC ("role=CPUS/NICE", entries separated by spaces or ';'):
+ *
+ *   "data=4-7 disk=4-7/5 background=/10"
+ *
+ *   CPUS  comma list of CPUs and ranges; empty = anywhere
+ *   NICE  -20 (highest) .. 19 (lowest); omitted = inherited
+ *
+ * Affinity: Linux, FreeBSD, PS5.  Priority: setpriority() per thread on
+ * Linux, pthread_setschedparam() relative to the current priority
+ * elsewhere.  Raising priority (NICE < 0) usually needs privileges;
+ * refusals are counted and logged once, never fatal.
+ *
+ * THREAD SAFETY: all functions are thread-safe.
+ */
+
+#ifndef PAL_THREAD_H
+#define PAL_THREAD_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+  PAL_THREAD_ACCEPT = 0,     /**< Control-port accept / session starter */
+  PAL_THREAD_CONTROL = 1,    /**< Session threads, event engine         */
+  PAL_THREAD_DATA = 2,       /**< Read-ahead pumps, stat crews, hashing */
+  PAL_THREAD_DISK = 3,       /**< STOR / upload / download writers      */
+  PAL_THREAD_HTTP = 4,       /**< zhttpd event loop and workers         */
+  PAL_THREAD_BACKGROUND = 5, /**< Copy jobs, indexers, scanners, logs   */
+  PAL_THREAD_ROLES = 6,
+} pal_thread_role_t;
+
+/** Highest CPU number a spec may name, plus one */
+#define PAL_THREAD_CPUS_MAX 256U
+
+/** Placement of one role */
+typedef struct {
+  uint64_t cpus[PAL_THREAD_CPUS_MAX / 64U]; /**< Bit n = CPU n; none = any */
+  int nice;                                 /**< -20..19                    */
+  int has_nice;                             /**< nice is set               */
+} pal_thread_place_t;
+
+/** Counters since start (pal_thread_get_stats) */
+typedef struct {
+  uint64_t started[PAL_THREAD_ROLES]; /**< Threads created per role    */
+  uint64_t placed;                    /**< Placements fully applied     */
+  uint64_t refused;                   /**< Affinity / priority refused  */
+} pal_thread_stats_t;
+
+/**
+ * @brief Replace the placement table from a spec (see file comment)
+ *
+ * Threads already running keep their placement.  NULL or "" clears it.
+ *
+ * @return 0, or -1 if @p spec is malformed (table unchanged)
+ */
+int pal_thread_config(const char *spec);
+
+/** @brief Current placement of @p role (zeroed for an unknown role) */
+void pal_thread_get_place(pal_thread_role_t role, pal_thread_place_t *out);
+
+/**
+ * @brief Describe the table as a spec ("" when nothing is placed)
+ *
+ * @return Length written (truncated to @p size - 1)
+ */
+size_t pal_thread_describe(char *out, size_t size);
+
+/** @brief Role name as used in specs ("data", ...), NULL if unknown */
+const char *pal_thread_role_name(pal_thread_role_t role);
+
+/**
+ * @brief pthread_create() for a thread of @p role
+ *
+ * @p attr (may be NULL) is used as given: stack size and detach state
+ * stay the caller's business.
+ *
+ * @return 0, or the pthread_create() error
+ */
+int pal_thread_create(pthread_t *tid, const pthread_attr_t *attr,
+                      pal_thread_role_t role, void *(*fn)(void *),
+                      void *arg);
+
+/** @brief Snapshot the counters */
+void pal_thread_get_stats(pal_thread_stats_t *out);
+
+#endif /* PAL_THREAD_H */
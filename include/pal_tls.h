@@ -1,14 +1,19 @@
 /*
- * pal_tls.h — TLS session abstraction (mbedTLS backend)
+ * pal_tls.h — TLS session abstraction
  *
- * Thin opaque layer used by pal_curl for HTTPS.
- * Wraps mbedTLS state; exposes send/recv primitives that match pal_curl's I/O model.
+ * Thin opaque layer used by pal_curl for HTTPS (client) and by the FTP
+ * server for AUTH TLS / PROT P (server, RFC 4217).
+ * Exposes send/recv primitives that match pal_curl's I/O model.
  *
  * Certificate verification is DISABLED by default (no system CA store on PS4/PS5).
  * Enable it by supplying a PEM CA bundle in pal_tls_cfg_t.ca_chain_pem.
  *
- * ── mbedTLS version ──────────────────────────────────────────────────────
- * Targets mbedTLS 3.x.  For mbedTLS 2.x define PAL_MBEDTLS_2X before including.
+ * ── Backends ─────────────────────────────────────────────────────────────
+ * mbedTLS 3.x (consoles; for mbedTLS 2.x define PAL_MBEDTLS_2X).
+ * OpenSSL 3.x (src/pal_tls_openssl.c, Linux/FreeBSD hosts, ENABLE_TLS=1):
+ * after the handshake the record layer is handed to kernel TLS when the
+ * kernel and cipher allow it, so plain send()/sendfile() on the fd are
+ * encrypted by the kernel (see pal_tls_ktls_send()).
  *
  * ── Thread-safety ────────────────────────────────────────────────────────
  * NOT thread-safe.  Call pal_tls_global_init() once from the main thread
@@ -34,6 +39,7 @@ extern "C" {
 #define PAL_TLS_ERR_RECV      -5
 #define PAL_TLS_ERR_CERT      -6
 #define PAL_TLS_ERR_INIT      -7
+#define PAL_TLS_ERR_TIMEOUT   -8  /**< SO_RCVTIMEO/SO_SNDTIMEO expired */
 
 /* ── Configuration ───────────────────────────────────────────────────── */
 typedef struct {
@@ -42,9 +48,19 @@ typedef struct {
     int         verify_peer;  /**< Non-zero to require cert validation.       */
 } pal_tls_cfg_t;
 
+/** Server-side configuration (PEM files) */
+typedef struct {
+    const char *cert_file; /**< Certificate chain (PEM); must not be NULL.  */
+    const char *key_file;  /**< Private key (PEM); NULL = inside cert_file. */
+    int         ktls;      /**< Non-zero to offload records to kernel TLS. */
+} pal_tls_server_cfg_t;
+
 /* ── Opaque session ──────────────────────────────────────────────────── */
 typedef struct pal_tls_session pal_tls_session_t;
 
+/* ── Opaque server context (certificate + session cache) ─────────────── */
+typedef struct pal_tls_server pal_tls_server_t;
+
 /* ── Global lifecycle (one call per process) ─────────────────────────── */
 
 /**
@@ -81,6 +97,61 @@ void pal_tls_global_cleanup(void);
  */
 pal_tls_session_t *pal_tls_connect(int fd, const pal_tls_cfg_t *cfg);
 
+/* ── Server side ─────────────────────────────────────────────────────── */
+
+/**
+ * @brief Load certificate and key into a reusable server context.
+ *
+ * One context serves every connection; it also holds the session cache
+ * that lets FTPS data connections resume the control session.
+ *
+ * @return New context, or NULL (bad files, key mismatch, no backend).
+ *
+ * @note Thread-safety: create once at startup; pal_tls_accept() may then
+ *       be called from any number of threads.
+ */
+pal_tls_server_t *pal_tls_server_create(const pal_tls_server_cfg_t *cfg);
+
+/** Free a server context.  All sessions accepted from it must be closed. */
+void pal_tls_server_destroy(pal_tls_server_t *srv);
+
+/**
+ * @brief Perform a TLS server handshake on an accepted TCP socket.
+ *
+ * Caller retains ownership of fd; does NOT close it on failure.
+ *
+ * @param[in] srv  Context from pal_tls_server_create().
+ * @param[in] fd   Connected, blocking TCP socket (timeouts honoured).
+ *
+ * @return New session on success, NULL on any failure.
+ */
+pal_tls_session_t *pal_tls_accept(pal_tls_server_t *srv, int fd);
+
+/**
+ * @brief Is the transmit path offloaded to kernel TLS?
+ *
+ * When non-zero, send(), writev() and sendfile() on the session's fd
+ * produce TLS records in the kernel; pal_sendfile() stays usable.
+ */
+int pal_tls_ktls_send(const pal_tls_session_t *sess);
+
+/** @brief Is the receive path offloaded to kernel TLS? */
+int pal_tls_ktls_recv(const pal_tls_session_t *sess);
+
+/**
+ * @brief Decrypted bytes readable without touching the socket
+ *
+ * A whole record is read at once, so poll() on the fd can report nothing
+ * while pal_tls_recv() still has data to return.
+ */
+int pal_tls_pending(const pal_tls_session_t *sess);
+
+/** @brief Negotiated protocol and cipher, e.g. "TLSv1.3 TLS_AES_256_GCM_SHA384" */
+const char *pal_tls_describe(const pal_tls_session_t *sess, char *buf,
+                             size_t buf_size);
+
+/* ── I/O ─────────────────────────────────────────────────────────────── */
+
 /**
  * @brief Send exactly len bytes through a TLS session.
  *
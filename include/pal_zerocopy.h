@@ -0,0 +1,140 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file pal_zerocopy.h
+ * @brief MSG_ZEROCOPY sends with completion tracking (Linux)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Kept apart from pal_network.h so ftp_types.h can embed the tracker in
+ * the session.  Implemented in pal_network.c; elsewhere (and with
+ * FTP_ZEROCOPY 0) pal_zc_begin() leaves the tracker off and the session
+ * sends by copying as before.
+ *
+ * THREAD SAFETY: a tracker belongs to one transfer thread.
+ */
+
+#ifndef PAL_ZEROCOPY_H
+#define PAL_ZEROCOPY_H
+
+#include "ftp_config.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/*===========================================================================*
+ * MSG_ZEROCOPY
+ *
+ *   pal_zc_send(buf, owner) ──► send(MSG_ZEROCOPY) ──► seq n   (owner parked)
+ *                                                        │
+ *   socket error queue ◄── kernel done with pages ◄──────┘
+ *           │
+ *           └──► pal_zc_reap() ──► owner handed back once every send
+ *                                  that read its bytes completed
+ *
+ *   The kernel numbers zerocopy sends per socket and reports finished
+ *   ranges [lo, hi], possibly out of order; completions are folded into
+ *   done_seq plus a 64-send window.  A send that would leave the window
+ *   goes out copied instead, so nothing is ever tracked outside it.
+ *===========================================================================*/
+
+/** Completed-send window (bits of done_mask) */
+#define PAL_ZC_WINDOW 64U
+
+/** Per-connection tracker (embedded in the session, no allocation) */
+typedef struct {
+  int fd;             /**< Socket with SO_ZEROCOPY, -1 = off            */
+  uint32_t next_seq;  /**< Number the kernel gives the next send        */
+  uint32_t done_seq;  /**< Every send below this one has completed      */
+  uint32_t parked;    /**< Owners in owner[]                            */
+  uint64_t done_mask; /**< Bit i: send done_seq + i completed           */
+  uint64_t bytes;     /**< Bytes sent with MSG_ZEROCOPY                 */
+  uint32_t copied;    /**< Completions the kernel served by copying     */
+  uint32_t aborted;   /**< Set by pal_zc_end() when it had to reset     */
+  void *owner[FTP_ZEROCOPY_INFLIGHT];         /**< Buffers in flight     */
+  uint32_t owner_end[FTP_ZEROCOPY_INFLIGHT];  /**< Free at done_seq >= */
+} pal_zc_t;
+
+/**
+ * @brief Start tracking a connected TCP socket
+ *
+ * Sets SO_ZEROCOPY; the tracker stays off (fd = -1) where that fails
+ * or the platform has no MSG_ZEROCOPY.  Must not hold parked owners.
+ */
+void pal_zc_begin(pal_zc_t *zc, int fd);
+
+/**
+ * @brief Whether a new send should use MSG_ZEROCOPY
+ *
+ * False when off, when every owner slot is taken, and once the kernel
+ * reported a copied completion (loopback, no scatter-gather): pinning
+ * pages and reading notifications is then pure overhead.
+ */
+int pal_zc_usable(const pal_zc_t *zc);
+
+/**
+ * @brief Send every byte of @p buf, zerocopy where the window allows
+ *
+ * Same loop and errors as pal_send_all().  If any part left with
+ * MSG_ZEROCOPY, @p owner is parked and *parked set to 1: the caller
+ * must not write to @p buf (nor free it) until pal_zc_reap() or
+ * pal_zc_end() hands @p owner back.  Requires pal_zc_usable().
+ *
+ * @return Bytes sent, or -1 with errno set (the owner may be parked
+ *         even then)
+ */
+ssize_t pal_zc_send(pal_zc_t *zc, const void *buf, size_t len, void *owner,
+                    int *parked);
+
+/**
+ * @brief Read completions and hand back owners the kernel is done with
+ *
+ * @param wait_ms 0 = only what is queued; otherwise wait up to this long
+ *                for at least one owner to come free
+ * @param out     Receives the owners, oldest first
+ * @param max     Room in @p out
+ *
+ * @return Owners written to @p out
+ */
+uint32_t pal_zc_reap(pal_zc_t *zc, uint32_t wait_ms, void **out,
+                     uint32_t max);
+
+/**
+ * @brief Wait for every completion before the socket is closed
+ *
+ * Waits up to @p wait_ms.  Owners still parked after that are returned
+ * too, with SO_LINGER set to reset the connection: closing then drops
+ * the unacknowledged data instead of letting it read reused pages.
+ * Release the owners only after closing the socket.
+ *
+ * @param out Room for FTP_ZEROCOPY_INFLIGHT owners
+ *
+ * @return Owners written to @p out; the tracker is off afterwards
+ */
+uint32_t pal_zc_end(pal_zc_t *zc, uint32_t wait_ms,
+                    void *out[FTP_ZEROCOPY_INFLIGHT]);
+
+#endif /* PAL_ZEROCOPY_H */
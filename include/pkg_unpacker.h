@@ -14,15 +14,23 @@
  *
  * Modelled after the exfat_unpacker.h API for consistency.
  *
- * ── Thread-safety ──────────────────────────────────────────────────────────
- * NONE.  All functions require external synchronisation when a context is
- * shared across threads.
+ * ── I/O model ──────────────────────────────────────────────────────────────
+ * pkg_init() reads the header and the entry table once and builds an
+ * id → entry hash index.  The leading PKG_MAP_WINDOW bytes of the file
+ * (header, entry table and the metadata entries that follow it) are
+ * mmap()ed read-only, so small entries such as param.sfo and icon0.png can
+ * be used in place through pkg_entry_view().  Anything outside the mapping
+ * is read with pread(); when mmap() fails or is unavailable every read
+ * takes that path.
  *
- * ── Re-entrancy ────────────────────────────────────────────────────────────
- * Functions are NOT re-entrant.
+ * ── Thread-safety ──────────────────────────────────────────────────────────
+ * pkg_init() and pkg_cleanup() require exclusive access.  Between them,
+ * lookups, views and extractions never move a shared file position and may
+ * run concurrently on the same context.
  *
  * ── Platform ───────────────────────────────────────────────────────────────
- * POSIX (_FILE_OFFSET_BITS=64) and Windows (_fseeki64 / _ftelli64).
+ * POSIX (_FILE_OFFSET_BITS=64, mmap + pread) and Windows (_lseeki64 /
+ * _read, no mapping).
  *
  * ── Format reference ───────────────────────────────────────────────────────
  * PS4 PKG specification: https://www.psdevwiki.com/ps4/PKG_files
@@ -83,7 +91,31 @@ extern "C" {
 /** Size in bytes of one serialised entry record in the file. */
 #define PKG_ENTRY_RECORD_SIZE       32U
 
+/**
+ * Length of the file prefix mapped by pkg_init().  The header, the entry
+ * table and the plaintext metadata entries sit in the first few MiB of a
+ * PKG; the PFS image behind them is never mapped.  Only address space is
+ * reserved: pages are faulted in when a view is actually read.
+ */
+#define PKG_MAP_WINDOW              (32U * 1024U * 1024U)   /* 32 MiB */
+
+/** Workers used by pkg_extract_batch() when the caller passes 0. */
+#define PKG_BATCH_WORKERS           4U
+
+/** Upper bound on pkg_extract_batch() workers. */
+#define PKG_BATCH_MAX_WORKERS       8U
+
+/**
+ * Per-worker buffer for the pread/pwrite fallback of pkg_extract_batch().
+ * Large enough that a USB disk sees long sequential requests.
+ */
+#define PKG_BATCH_BUF_SIZE          (1024U * 1024U)         /* 1 MiB */
+
+/** Longest name pkg_entry_name() produces, including the NUL. */
+#define PKG_ENTRY_NAME_MAX          256U
+
 /* ── Common unencrypted entry IDs ────────────────────────────────────────── */
+#define PKG_ENTRY_ID_ENTRY_NAMES    0x0200U  /**< NUL-separated name table. */
 #define PKG_ENTRY_ID_PARAM_SFO      0x1000U
 #define PKG_ENTRY_ID_ICON0_PNG      0x1200U
 #define PKG_ENTRY_ID_ICON1_PNG      0x1210U
@@ -116,7 +148,9 @@ typedef enum {
     PKG_ERR_RANGE        = -4,  /**< Value would overflow or is out of range.   */
     PKG_ERR_NOMEM        = -5,  /**< malloc() returned NULL.                    */
     PKG_ERR_ENCRYPTED    = -6,  /**< Entry is encrypted; cannot yield plaintext.*/
-    PKG_ERR_BUFFER_SMALL = -7   /**< Caller buffer is smaller than entry->size. */
+    PKG_ERR_BUFFER_SMALL = -7,  /**< Caller buffer is smaller than entry->size. */
+    PKG_ERR_UNMAPPED     = -8,  /**< Entry lies outside the mapped window.      */
+    PKG_ERR_CANCELLED    = -9   /**< pkg_extract_batch() was cancelled.         */
 } pkg_error_t;
 
 /* ═══════════════════════════════════════════════════════════════════════════
@@ -166,13 +200,32 @@ typedef struct {
  * are established by pkg_init() and held until pkg_cleanup().
  */
 typedef struct {
-    FILE         *file;         /**< Open file handle (owned by this context).  */
-    uint64_t      file_size;    /**< Total PKG file size in bytes.              */
-    pkg_header_t  header;       /**< Decoded header fields.                     */
-    pkg_entry_t  *entries;      /**< Heap-allocated array [0, num_entries).     */
-    size_t        num_entries;  /**< Element count of entries[].                */
+    int             fd;           /**< Open descriptor (owned), -1 when closed.  */
+    uint64_t        file_size;    /**< Total PKG file size in bytes.             */
+    const uint8_t  *map;          /**< Read-only mapping of [0, map_len), or NULL*/
+    size_t          map_len;      /**< Mapped bytes (0 = pread only).            */
+    pkg_header_t    header;       /**< Decoded header fields.                    */
+    pkg_entry_t    *entries;      /**< Heap-allocated array [0, num_entries).    */
+    size_t          num_entries;  /**< Element count of entries[].               */
+    uint32_t       *index;        /**< Open-addressed id hash: entry index + 1.  */
+    uint32_t        index_mask;   /**< Slot count - 1 (power of two).            */
 } pkg_context_t;
 
+/**
+ * One output of pkg_extract_batch().
+ */
+typedef struct {
+    const pkg_entry_t *entry;   /**< Entry to extract (from ctx->entries).    */
+    const char        *path;    /**< Output file; created or truncated.       */
+    int                result;  /**< Out: PKG_OK or a pkg_error_t value.      */
+} pkg_batch_item_t;
+
+/**
+ * Progress callback of pkg_extract_batch(): @p bytes more bytes were
+ * written.  Called from the worker threads, concurrently.
+ */
+typedef void (*pkg_progress_fn)(void *user, uint64_t bytes);
+
 /* ═══════════════════════════════════════════════════════════════════════════
  * Inline helpers
  * ═════════════════════════════════════════════════════════════════════════*/
@@ -219,7 +272,7 @@ static inline int pkg_entry_is_encrypted(const pkg_entry_t *entry)
  *
  * @return PKG_OK on success.
  * @retval PKG_ERR_PARAM    ctx or pkg_path is NULL / pkg_path is empty.
- * @retval PKG_ERR_IO       fopen, fread, fseeko, or ftello failed.
+ * @retval PKG_ERR_IO       open, fstat or pread failed.
  * @retval PKG_ERR_FORMAT   File is too small, magic mismatch, entry_count
  *                           out of range, or an entry extends beyond EOF.
  * @retval PKG_ERR_RANGE    Internal arithmetic overflow (defensive).
@@ -227,12 +280,12 @@ static inline int pkg_entry_is_encrypted(const pkg_entry_t *entry)
  *
  * @pre  ctx != NULL
  * @pre  pkg_path != NULL && pkg_path[0] != '\0'
- * @post On PKG_OK: ctx->file != NULL, ctx->entries != NULL,
+ * @post On PKG_OK: ctx->fd >= 0, ctx->entries != NULL,
  *       ctx->num_entries == ctx->header.entry_count,
  *       ctx->header.content_id is NUL-terminated.
  *
  * @note Thread-safety: NOT thread-safe.
- * @note WCET: Unbounded (disk I/O; up to PKG_MAX_ENTRY_COUNT entry reads).
+ * @note WCET: Unbounded (disk I/O; one header and one table read).
  * @warning Do not call from interrupt or hard-real-time context.
  */
 int pkg_init(pkg_context_t *ctx, const char *pkg_path);
@@ -240,7 +293,8 @@ int pkg_init(pkg_context_t *ctx, const char *pkg_path);
 /**
  * @brief Release all resources owned by ctx.
  *
- * Closes the file handle and frees the entries array.  Safe to call on a
+ * Unmaps the window, closes the descriptor and frees the entry array and
+ * index.  Views obtained from ctx become invalid.  Safe to call on a
  * partially-initialised context (e.g., after a failed pkg_init).
  * Idempotent: safe to call more than once on the same ctx.
  *
@@ -254,9 +308,9 @@ void pkg_cleanup(pkg_context_t *ctx);
 /**
  * @brief Find an entry in the table by its numeric ID.
  *
- * Performs a linear scan over the parsed entry array.  For the typical
- * entry counts found in real PKG files (<200) this is faster than a hash
- * map due to cache locality.
+ * Probes the hash index built by pkg_init().  Metadata scans look up the
+ * same few ids in hundreds of PKGs, so the lookup stays O(1) regardless of
+ * the entry count.  With duplicate ids the first table entry wins.
  *
  * @param[in] ctx  Initialised context.
  * @param[in] id   Entry ID to search for (e.g., PKG_ENTRY_ID_PARAM_SFO).
@@ -267,18 +321,47 @@ void pkg_cleanup(pkg_context_t *ctx);
  * @warning The returned pointer is invalidated by pkg_cleanup().
  *          Do not free or retain it beyond the lifetime of ctx.
  *
- * @note Thread-safety: NOT thread-safe.
- * @note WCET: O(num_entries).
+ * @note Thread-safety: safe between pkg_init() and pkg_cleanup().
+ * @note WCET: O(1) expected; the table is at most half full.
  */
 const pkg_entry_t *pkg_find_entry_by_id(const pkg_context_t *ctx, uint32_t id);
 
+/**
+ * @brief Zero-copy access to a plaintext entry inside the mapped window.
+ *
+ * On success *data points at entry->size bytes of the mapping; nothing is
+ * read or copied until the caller touches them.  The pointer stays valid
+ * until pkg_cleanup().  Entries outside the window, or every entry when
+ * the file could not be mapped, return PKG_ERR_UNMAPPED: fall back to
+ * pkg_extract_to_buffer(), which copies from the same source either way.
+ *
+ * @param[in]  ctx    Initialised context.
+ * @param[in]  entry  Entry to view; must not be NULL.
+ * @param[out] data   Receives the entry bytes; set to NULL on error.
+ *
+ * @return entry->size (>= 0) on success, or a negative pkg_error_t value.
+ * @retval PKG_ERR_PARAM      A required argument is NULL.
+ * @retval PKG_ERR_ENCRYPTED  Entry is encrypted; call refused.
+ * @retval PKG_ERR_RANGE      entry->size > PKG_MAX_ENTRY_SIZE.
+ * @retval PKG_ERR_UNMAPPED   Entry is not inside the mapping.
+ *
+ * @warning The mapping is shared with the file: a concurrent truncation of
+ *          the PKG raises SIGBUS on access, as with any mmap() reader.
+ *
+ * @note Thread-safety: safe between pkg_init() and pkg_cleanup().
+ * @note WCET: O(1), no I/O.
+ */
+ssize_t pkg_entry_view(const pkg_context_t *ctx, const pkg_entry_t *entry,
+                       const uint8_t **data);
+
 /**
  * @brief Extract a plaintext entry's raw bytes into a caller-supplied buffer.
  *
- * Seeks to entry->offset and reads entry->size bytes into buf.
- * The call is rejected if the entry is encrypted (flags1 bit 31 set).
+ * Copies entry->size bytes from the mapping, or reads them with pread()
+ * when the entry lies outside it.  The call is rejected if the entry is
+ * encrypted (flags1 bit 31 set).
  *
- * @param[in,out] ctx       Initialised context (file position is modified).
+ * @param[in,out] ctx       Initialised context.
  * @param[in]     entry     Entry to extract; must not be NULL.
  * @param[out]    buf       Destination buffer; must not be NULL.
  * @param[in]     buf_size  Usable bytes in buf.
@@ -288,13 +371,13 @@ const pkg_entry_t *pkg_find_entry_by_id(const pkg_context_t *ctx, uint32_t id);
  * @retval PKG_ERR_ENCRYPTED    Entry is encrypted; call refused.
  * @retval PKG_ERR_RANGE        entry->size > PKG_MAX_ENTRY_SIZE or > SSIZE_MAX.
  * @retval PKG_ERR_BUFFER_SMALL buf_size < entry->size.
- * @retval PKG_ERR_IO           fseeko or fread failed, or short read occurred.
+ * @retval PKG_ERR_IO           pread failed, or a short read occurred.
  *
  * @pre  (entry->flags1 & PKG_ENTRY_FLAG_ENCRYPTED) == 0
  * @pre  buf_size >= entry->size
  * @post On success, buf[0..entry->size) contains the raw entry data.
  *
- * @note Thread-safety: NOT thread-safe.
+ * @note Thread-safety: safe between pkg_init() and pkg_cleanup().
  * @note WCET: Proportional to entry->size; dominated by disk I/O.
  */
 ssize_t pkg_extract_to_buffer(pkg_context_t *ctx, const pkg_entry_t *entry,
@@ -307,7 +390,7 @@ ssize_t pkg_extract_to_buffer(pkg_context_t *ctx, const pkg_entry_t *entry,
  * allocates from the heap.  EINTR-interrupted write(2) calls are retried
  * automatically.
  *
- * @param[in,out] ctx        Initialised context (file position is modified).
+ * @param[in,out] ctx        Initialised context.
  * @param[in]     entry      Entry to extract; must not be NULL.
  * @param[in]     output_fd  Open, writable, blocking file descriptor (>= 0).
  *
@@ -315,18 +398,77 @@ ssize_t pkg_extract_to_buffer(pkg_context_t *ctx, const pkg_entry_t *entry,
  * @retval PKG_ERR_PARAM     A required argument is NULL or output_fd < 0.
  * @retval PKG_ERR_ENCRYPTED Entry is encrypted; call refused.
  * @retval PKG_ERR_RANGE     entry->size > PKG_MAX_ENTRY_SIZE.
- * @retval PKG_ERR_IO        fseeko, fread, or write(2) failed, or the read
+ * @retval PKG_ERR_IO        pread or write(2) failed, or the read
  *                            returned fewer bytes than entry->size (truncated).
  *
  * @pre  (entry->flags1 & PKG_ENTRY_FLAG_ENCRYPTED) == 0
  * @pre  output_fd is open for writing in blocking mode.
  *
- * @note Thread-safety: NOT thread-safe.
+ * @note Thread-safety: safe between pkg_init() and pkg_cleanup().
  * @note WCET: Proportional to entry->size; dominated by disk I/O.
  */
 int pkg_extract_file_fd(pkg_context_t *ctx, const pkg_entry_t *entry,
                         int output_fd);
 
+/**
+ * @brief Extract many entries to their own files on a bounded worker pool.
+ *
+ * Items are taken in ascending entry->offset order, so the PKG is read
+ * front to back even with several workers.  Each output is written by one
+ * worker with the cheapest available path:
+ *
+ *   entry inside the mapping   pwrite() straight from the mapping
+ *   copy_file_range()          in-kernel copy (Linux, FreeBSD 13+)
+ *   otherwise                  PKG_BATCH_BUF_SIZE pread/pwrite pairs
+ *
+ * A failing item is unlinked and recorded in its result; the others
+ * still run.  Encrypted entries are refused with PKG_ERR_ENCRYPTED and
+ * no file is created.
+ *
+ * @param[in]     ctx       Initialised context.
+ * @param[in,out] items     Outputs; every items[i].result is set.
+ * @param[in]     count     Element count of items.
+ * @param[in]     workers   Thread count (0 = PKG_BATCH_WORKERS), capped at
+ *                          PKG_BATCH_MAX_WORKERS and count.
+ * @param[in]     progress  Optional; receives written byte deltas.
+ * @param[in]     user      Passed to progress.
+ * @param[in]     cancel    Optional; a non-zero value stops the batch
+ *                          between chunks.
+ *
+ * @return PKG_OK when every item succeeded, PKG_ERR_CANCELLED when
+ *         cancelled, otherwise the result of the first failed item.
+ * @retval PKG_ERR_PARAM  A required argument is NULL.
+ * @retval PKG_ERR_NOMEM  Could not allocate the work list.
+ *
+ * @note Thread-safety: safe between pkg_init() and pkg_cleanup(); the
+ *       call blocks until every worker has finished.
+ * @note WCET: Proportional to the total entry size; dominated by disk I/O.
+ */
+int pkg_extract_batch(pkg_context_t *ctx, pkg_batch_item_t *items,
+                      size_t count, unsigned workers,
+                      pkg_progress_fn progress, void *user,
+                      const volatile int *cancel);
+
+/**
+ * @brief File name for an entry, suitable as a single path component.
+ *
+ * Taken from the PKG's name table (PKG_ENTRY_ID_ENTRY_NAMES) when the entry
+ * has one, else from the well-known ids above, else "<id as 8 hex>.bin".
+ * '/' and '\\' become '_' and a name of "." or ".." is replaced by the hex
+ * form, so the result never leaves the destination directory.
+ *
+ * @param[in]  ctx   Initialised context.
+ * @param[in]  entry Entry to name.
+ * @param[out] buf   Receives the NUL-terminated name.
+ * @param[in]  size  Capacity of buf (PKG_ENTRY_NAME_MAX is always enough).
+ *
+ * @return PKG_OK, PKG_ERR_PARAM, or PKG_ERR_BUFFER_SMALL.
+ *
+ * @note Thread-safety: safe between pkg_init() and pkg_cleanup().
+ */
+int pkg_entry_name(const pkg_context_t *ctx, const pkg_entry_t *entry,
+                   char *buf, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
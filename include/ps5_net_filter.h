@@ -166,6 +166,10 @@ typedef enum {
  *
  * A connection is blocked when:
  *   (dest_addr & mask) == (network & mask)
+ *
+ * The mask must be a contiguous prefix (a CIDR /0../32): install() compiles
+ * the rules into sorted address ranges and rejects any other mask with
+ * PS5_NET_FILTER_ERR_INVALID_PARAM.
  */
 typedef struct {
     uint32_t network; /**< Network address (network byte order) */
@@ -179,7 +183,8 @@ typedef struct {
 /**
  * Runtime statistics collected by the kernel hook.
  *
- * @note All fields updated with atomic increments; safe to read at any time.
+ * @note The hook counts per CPU; each field is the sum over all CPUs at
+ *       the time of the read.  Safe to read at any time.
  */
 typedef struct {
     uint64_t blocked_total;     /**< Total connections blocked */
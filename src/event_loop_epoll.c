@@ -0,0 +1,312 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+/**
+ * @file event_loop_epoll.c
+ * @brief Event loop implementation using epoll (Linux)
+ *
+ * ARCHITECTURE:
+ *
+ *   epoll fd
+ *      │
+ *      ├── EPOLLIN  fd=listen  ──► accept callback
+ *      ├── EPOLLIN  fd=client1 ──► client callback
+ *      └── ...
+ *
+ * Same contract as event_loop_kqueue.c: handlers[fd] stores the
+ * callback and user data, epoll_event.data.fd is the index.  epoll
+ * reports read and write readiness in one event, so a callback may see
+ * EVENT_READ | EVENT_WRITE together.
+ */
+
+#include "event_loop.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#define MAX_EVENTS 1024
+#define HANDLERS_INITIAL 256U
+
+/*===========================================================================*
+ * HANDLER TABLE — handlers[fd] = {callback, data}
+ *===========================================================================*/
+
+typedef struct {
+  event_callback_t callback; /**< User callback, NULL = unused   */
+  void *data;                /**< User context                  */
+  uint32_t events;           /**< Registered EVENT_* mask       */
+} handler_entry_t;
+
+struct event_loop {
+  int epfd;
+  int running;
+  struct epoll_event *events;
+  size_t max_events;
+
+  handler_entry_t *handlers; /**< Indexed by fd */
+  size_t handler_cap;
+
+  event_tick_t tick;
+  void *tick_data;
+};
+
+static event_loop_t g_event_loop;
+static struct epoll_event g_event_storage[MAX_EVENTS];
+static int g_event_loop_in_use = 0;
+
+/*===========================================================================*
+ * HANDLER TABLE HELPERS
+ *===========================================================================*/
+
+static handler_entry_t *find_handler(event_loop_t *loop, int fd) {
+  if ((fd < 0) || ((size_t)fd >= loop->handler_cap)) {
+    return NULL;
+  }
+  handler_entry_t *h = &loop->handlers[fd];
+  return (h->callback != NULL) ? h : NULL;
+}
+
+/* Grow the table (doubling) until it covers fd */
+static handler_entry_t *slot_for(event_loop_t *loop, int fd) {
+  if ((size_t)fd >= loop->handler_cap) {
+    size_t cap = (loop->handler_cap != 0U) ? loop->handler_cap : HANDLERS_INITIAL;
+    while (cap <= (size_t)fd) {
+      cap *= 2U;
+    }
+    handler_entry_t *grown = realloc(loop->handlers, cap * sizeof(*grown));
+    if (grown == NULL) {
+      return NULL;
+    }
+    memset(grown + loop->handler_cap, 0,
+           (cap - loop->handler_cap) * sizeof(*grown));
+    loop->handlers = grown;
+    loop->handler_cap = cap;
+  }
+  return &loop->handlers[fd];
+}
+
+static uint32_t to_epoll(uint32_t events, int adding) {
+  uint32_t ev = 0U;
+  if ((events & EVENT_READ) != 0U) {
+    ev |= EPOLLIN;
+  }
+  if ((events & EVENT_WRITE) != 0U) {
+    ev |= EPOLLOUT;
+  }
+  if ((events & EVENT_EDGE) != 0U) {
+    ev |= EPOLLET;
+  }
+#ifdef EPOLLEXCLUSIVE
+  /* Only valid on EPOLL_CTL_ADD, and not together with EPOLLRDHUP */
+  if ((adding != 0) && ((events & EVENT_EXCLUSIVE) != 0U)) {
+    return ev | EPOLLEXCLUSIVE;
+  }
+#else
+  (void)adding;
+#endif
+  if ((events & EVENT_READ) != 0U) {
+    ev |= EPOLLRDHUP;
+  }
+  return ev;
+}
+
+/*===========================================================================*
+ * CREATE / DESTROY
+ *===========================================================================*/
+
+event_loop_t *event_loop_create(void) {
+  if (g_event_loop_in_use != 0) {
+    return &g_event_loop;
+  }
+
+  event_loop_t *loop = &g_event_loop;
+  memset(loop, 0, sizeof(*loop));
+
+  loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epfd < 0) {
+    return NULL;
+  }
+
+  loop->max_events = MAX_EVENTS;
+  loop->events = g_event_storage;
+  loop->handlers = NULL;
+  loop->handler_cap = 0U;
+  loop->running = 0;
+
+  g_event_loop_in_use = 1;
+  return loop;
+}
+
+void event_loop_destroy(event_loop_t *loop) {
+  if ((loop == NULL) || (loop != &g_event_loop)) {
+    return;
+  }
+  if (loop->epfd >= 0) {
+    close(loop->epfd);
+  }
+  loop->epfd = -1;
+  loop->running = 0;
+  loop->events = NULL;
+  loop->max_events = 0;
+  free(loop->handlers);
+  loop->handlers = NULL;
+  loop->handler_cap = 0U;
+  g_event_loop_in_use = 0;
+}
+
+/*===========================================================================*
+ * ADD / MODIFY / REMOVE
+ *===========================================================================*/
+
+int event_loop_add(event_loop_t *loop, int fd, uint32_t events,
+                   event_callback_t callback, void *data) {
+  if (loop == NULL || fd < 0 || callback == NULL) {
+    return -1;
+  }
+
+  handler_entry_t *h = slot_for(loop, fd);
+  if (h == NULL) {
+    return -1;
+  }
+
+  int adding = (h->callback == NULL);
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = to_epoll(events, adding);
+  ev.data.fd = fd;
+
+  if (epoll_ctl(loop->epfd, adding ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, fd, &ev) !=
+      0) {
+    /* A closed-and-reused fd can still be in the set after a missed remove */
+    if (!adding || (errno != EEXIST) ||
+        (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &ev) != 0)) {
+      return -1;
+    }
+  }
+
+  h->callback = callback;
+  h->data = data;
+  h->events = events;
+  return 0;
+}
+
+int event_loop_modify(event_loop_t *loop, int fd, uint32_t events) {
+  if (loop == NULL || fd < 0) {
+    return -1;
+  }
+
+  handler_entry_t *h = find_handler(loop, fd);
+  if (h == NULL) {
+    return -1;
+  }
+
+  return event_loop_add(loop, fd, events, h->callback, h->data);
+}
+
+int event_loop_remove(event_loop_t *loop, int fd) {
+  if (loop == NULL || fd < 0) {
+    return -1;
+  }
+
+  /* Ignore errors (fd may already be closed, which drops it) */
+  (void)epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+
+  handler_entry_t *h = find_handler(loop, fd);
+  if (h != NULL) {
+    h->callback = NULL;
+    h->data = NULL;
+    h->events = 0U;
+  }
+  return 0;
+}
+
+/*===========================================================================*
+ * RUN
+ *===========================================================================*/
+
+int event_loop_run(event_loop_t *loop) {
+  if (loop == NULL) {
+    return -1;
+  }
+
+  loop->running = 1;
+
+  while (loop->running) {
+    int nev = epoll_wait(loop->epfd, loop->events, (int)loop->max_events, 1000);
+
+    if (nev < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+
+    for (int i = 0; i < nev; i++) {
+      const struct epoll_event *e = &loop->events[i];
+      int fd = e->data.fd;
+
+      /* Earlier callbacks in this batch may have removed it */
+      handler_entry_t *h = find_handler(loop, fd);
+      if (h == NULL) {
+        continue;
+      }
+
+      uint32_t ev = 0;
+      if (e->events & EPOLLIN)
+        ev |= EVENT_READ;
+      if (e->events & EPOLLOUT)
+        ev |= EVENT_WRITE;
+      if (e->events & (EPOLLHUP | EPOLLRDHUP))
+        ev |= EVENT_CLOSE;
+      if (e->events & EPOLLERR)
+        ev |= EVENT_ERROR;
+
+      /* The callback may add fds and move the table */
+      int ret = h->callback(fd, ev, h->data);
+      if (ret < 0) {
+        event_loop_remove(loop, fd);
+      }
+    }
+
+    if (loop->tick != NULL) {
+      loop->tick(loop->tick_data);
+    }
+  }
+
+  return 0;
+}
+
+void event_loop_set_tick(event_loop_t *loop, event_tick_t tick, void *data) {
+  if (loop != NULL) {
+    loop->tick = tick;
+    loop->tick_data = data;
+  }
+}
+
+void event_loop_stop(event_loop_t *loop) {
+  if (loop != NULL) {
+    loop->running = 0;
+  }
+}
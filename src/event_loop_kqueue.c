@@ -34,12 +34,13 @@ SOFTWARE.
  *      ├── EVFILT_READ  fd=client2 ──► client callback
  *      └── ...
  *
- * Each monitored fd gets a handler_entry_t that stores both the
- * callback and user data, since kqueue only has one udata slot.
+ * handlers[fd] stores the callback and user data; events are looked up
+ * by kev->ident, so the table can be reallocated while it grows.
  */
 
 #include "event_loop.h"
 #include <errno.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <sys/event.h>
@@ -47,16 +48,16 @@ SOFTWARE.
 #include <unistd.h>
 
 #define MAX_EVENTS 1024
-#define MAX_HANDLERS 1024
+#define HANDLERS_INITIAL 256U
 
 /*===========================================================================*
- * HANDLER TABLE — maps fd → {callback, data}
+ * HANDLER TABLE — handlers[fd] = {callback, data}
  *===========================================================================*/
 
 typedef struct {
-  int fd;                    /**< File descriptor (-1 = unused) */
-  event_callback_t callback; /**< User callback                 */
+  event_callback_t callback; /**< User callback, NULL = unused   */
   void *data;                /**< User context                  */
+  uint32_t events;           /**< Registered EVENT_* mask       */
 } handler_entry_t;
 
 struct event_loop {
@@ -65,8 +66,11 @@ struct event_loop {
   struct kevent *events;
   size_t max_events;
 
-  handler_entry_t handlers[MAX_HANDLERS];
-  size_t handler_count;
+  handler_entry_t *handlers; /**< Indexed by fd */
+  size_t handler_cap;
+
+  event_tick_t tick;
+  void *tick_data;
 };
 
 static event_loop_t g_event_loop;
@@ -78,47 +82,61 @@ static int g_event_loop_in_use = 0;
  *===========================================================================*/
 
 static handler_entry_t *find_handler(event_loop_t *loop, int fd) {
-  for (size_t i = 0; i < loop->handler_count; i++) {
-    if (loop->handlers[i].fd == fd) {
-      return &loop->handlers[i];
-    }
+  if ((fd < 0) || ((size_t)fd >= loop->handler_cap)) {
+    return NULL;
   }
-  return NULL;
+  handler_entry_t *h = &loop->handlers[fd];
+  return (h->callback != NULL) ? h : NULL;
 }
 
-static handler_entry_t *add_handler(event_loop_t *loop, int fd,
-                                    event_callback_t cb, void *data) {
-  /* Check if already exists */
-  handler_entry_t *h = find_handler(loop, fd);
-  if (h != NULL) {
-    h->callback = cb;
-    h->data = data;
-    return h;
-  }
-
-  /* Find empty slot or append */
-  for (size_t i = 0; i < MAX_HANDLERS; i++) {
-    if (loop->handlers[i].fd < 0) {
-      loop->handlers[i].fd = fd;
-      loop->handlers[i].callback = cb;
-      loop->handlers[i].data = data;
-      if (i >= loop->handler_count) {
-        loop->handler_count = i + 1;
-      }
-      return &loop->handlers[i];
+/* Grow the table (doubling) until it covers fd */
+static handler_entry_t *slot_for(event_loop_t *loop, int fd) {
+  if ((size_t)fd >= loop->handler_cap) {
+    size_t cap = (loop->handler_cap != 0U) ? loop->handler_cap : HANDLERS_INITIAL;
+    while (cap <= (size_t)fd) {
+      cap *= 2U;
+    }
+    handler_entry_t *grown = realloc(loop->handlers, cap * sizeof(*grown));
+    if (grown == NULL) {
+      return NULL;
     }
+    memset(grown + loop->handler_cap, 0,
+           (cap - loop->handler_cap) * sizeof(*grown));
+    loop->handlers = grown;
+    loop->handler_cap = cap;
   }
-
-  return NULL; /* table full */
+  return &loop->handlers[fd];
 }
 
-static void remove_handler(event_loop_t *loop, int fd) {
-  handler_entry_t *h = find_handler(loop, fd);
-  if (h != NULL) {
-    h->fd = -1;
-    h->callback = NULL;
-    h->data = NULL;
+/* Register the filters in events, delete those in h->events only */
+static int apply_filters(event_loop_t *loop, int fd, handler_entry_t *h,
+                         uint32_t events) {
+  struct kevent kev[2];
+  int n = 0;
+  u_short add = ((events & EVENT_EDGE) != 0U)
+                    ? (u_short)(EV_ADD | EV_ENABLE | EV_CLEAR)
+                    : (u_short)(EV_ADD | EV_ENABLE);
+
+  if ((events & EVENT_READ) != 0U) {
+    EV_SET(&kev[n], fd, EVFILT_READ, add, 0, 0, NULL);
+    n++;
+  } else if ((h->events & EVENT_READ) != 0U) {
+    EV_SET(&kev[n], fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+    n++;
+  }
+  if ((events & EVENT_WRITE) != 0U) {
+    EV_SET(&kev[n], fd, EVFILT_WRITE, add, 0, 0, NULL);
+    n++;
+  } else if ((h->events & EVENT_WRITE) != 0U) {
+    EV_SET(&kev[n], fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+    n++;
   }
+
+  if ((n > 0) && (kevent(loop->kq, kev, n, NULL, 0, NULL) < 0)) {
+    return -1;
+  }
+  h->events = events;
+  return 0;
 }
 
 /*===========================================================================*
@@ -140,12 +158,8 @@ event_loop_t *event_loop_create(void) {
 
   loop->max_events = MAX_EVENTS;
   loop->events = g_event_storage;
-
-  /* Initialize all handler slots as unused */
-  for (size_t i = 0; i < MAX_HANDLERS; i++) {
-    loop->handlers[i].fd = -1;
-  }
-  loop->handler_count = 0;
+  loop->handlers = NULL;
+  loop->handler_cap = 0U;
   loop->running = 0;
 
   g_event_loop_in_use = 1;
@@ -163,12 +177,9 @@ void event_loop_destroy(event_loop_t *loop) {
   loop->running = 0;
   loop->events = NULL;
   loop->max_events = 0;
-  loop->handler_count = 0;
-  for (size_t i = 0; i < MAX_HANDLERS; i++) {
-    loop->handlers[i].fd = -1;
-    loop->handlers[i].callback = NULL;
-    loop->handlers[i].data = NULL;
-  }
+  free(loop->handlers);
+  loop->handlers = NULL;
+  loop->handler_cap = 0U;
   g_event_loop_in_use = 0;
 }
 
@@ -182,27 +193,19 @@ int event_loop_add(event_loop_t *loop, int fd, uint32_t events,
     return -1;
   }
 
-  handler_entry_t *h = add_handler(loop, fd, callback, data);
+  handler_entry_t *h = slot_for(loop, fd);
   if (h == NULL) {
     return -1;
   }
-
-  if (events & EVENT_READ) {
-    struct kevent kev;
-    EV_SET(&kev, fd, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, h);
-    if (kevent(loop->kq, &kev, 1, NULL, 0, NULL) < 0) {
-      return -1;
-    }
+  if (h->callback == NULL) {
+    h->events = 0U;
   }
+  h->callback = callback;
+  h->data = data;
 
-  if (events & EVENT_WRITE) {
-    struct kevent kev;
-    EV_SET(&kev, fd, EVFILT_WRITE, EV_ADD | EV_ENABLE, 0, 0, h);
-    if (kevent(loop->kq, &kev, 1, NULL, 0, NULL) < 0) {
-      return -1;
-    }
+  if (apply_filters(loop, fd, h, events) != 0) {
+    return -1;
   }
-
   return 0;
 }
 
@@ -216,7 +219,7 @@ int event_loop_modify(event_loop_t *loop, int fd, uint32_t events) {
     return -1;
   }
 
-  return event_loop_add(loop, fd, events, h->callback, h->data);
+  return apply_filters(loop, fd, h, events);
 }
 
 int event_loop_remove(event_loop_t *loop, int fd) {
@@ -231,7 +234,12 @@ int event_loop_remove(event_loop_t *loop, int fd) {
   /* Ignore errors (filter may not exist) */
   (void)kevent(loop->kq, kev, 2, NULL, 0, NULL);
 
-  remove_handler(loop, fd);
+  handler_entry_t *h = find_handler(loop, fd);
+  if (h != NULL) {
+    h->callback = NULL;
+    h->data = NULL;
+    h->events = 0U;
+  }
   return 0;
 }
 
@@ -261,9 +269,11 @@ int event_loop_run(event_loop_t *loop) {
 
     for (int i = 0; i < nev; i++) {
       struct kevent *kev = &loop->events[i];
-      handler_entry_t *h = (handler_entry_t *)kev->udata;
+      int fd = (int)kev->ident;
 
-      if (h == NULL || h->callback == NULL) {
+      /* Earlier callbacks in this batch may have removed it */
+      handler_entry_t *h = find_handler(loop, fd);
+      if (h == NULL) {
         continue;
       }
 
@@ -277,16 +287,28 @@ int event_loop_run(event_loop_t *loop) {
       if (kev->flags & EV_ERROR)
         ev |= EVENT_ERROR;
 
-      int ret = h->callback((int)kev->ident, ev, h->data);
+      /* The callback may add fds and move the table */
+      int ret = h->callback(fd, ev, h->data);
       if (ret < 0) {
-        event_loop_remove(loop, (int)kev->ident);
+        event_loop_remove(loop, fd);
       }
     }
+
+    if (loop->tick != NULL) {
+      loop->tick(loop->tick_data);
+    }
   }
 
   return 0;
 }
 
+void event_loop_set_tick(event_loop_t *loop, event_tick_t tick, void *data) {
+  if (loop != NULL) {
+    loop->tick = tick;
+    loop->tick_data = data;
+  }
+}
+
 void event_loop_stop(event_loop_t *loop) {
   if (loop != NULL) {
     loop->running = 0;
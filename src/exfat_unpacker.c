@@ -44,6 +44,12 @@
  *      instead of per-cluster malloc; respects the NoFatChain flag.
  *   7. Added exfat_extract_to_buffer() for in-memory extraction.
  *   8. fseeko() used for large-file offsets (> 2 GiB).
+ *   9. FAT read on demand in EXFAT_FAT_PAGE_SIZE pages behind a bounded
+ *      LRU cache instead of malloc'ing the whole table at init, so images
+ *      of any size open in constant memory.
+ *  10. File data read per extent (run of consecutive clusters) with
+ *      pread(), or copied in-kernel with copy_file_range() for fd output,
+ *      instead of one seek + read per cluster.
  */
 
 #include "exfat_unpacker.h"
@@ -59,10 +65,23 @@
 #  define ftello _ftelli64
 #  define lseek64 _lseeki64
 #else
-#  include <unistd.h>  /* write(), close() */
+#  include <unistd.h>  /* write(), close(), pread() */
 #  define lseek64 lseek
 #endif
 
+/*
+ * copy_file_range(2): Linux 4.5+, FreeBSD 13+.  The PS4/PS5 kernels are
+ * FreeBSD 9/11 derivatives and lack it.
+ */
+#if defined(__linux__)
+#  define EXFAT_HAVE_CFR 1
+#elif defined(__FreeBSD__) && !defined(PLATFORM_PS4) && !defined(PLATFORM_PS5)
+#  include <sys/param.h>
+#  if __FreeBSD_version >= 1300037
+#    define EXFAT_HAVE_CFR 1
+#  endif
+#endif
+
 /* ── Boot sector ────────────────────────────────────────────────────────── */
 
 int exfat_read_boot_sector(exfat_context_t *ctx) {
@@ -149,6 +168,10 @@ void exfat_print_boot_sector(const exfat_boot_sector_t *boot) {
 
 /* ── FAT ────────────────────────────────────────────────────────────────── */
 
+/*
+ * Only the geometry is checked here; FAT pages are read by
+ * exfat_get_next_cluster() as chains reach them.
+ */
 int exfat_read_fat(exfat_context_t *ctx) {
     if (!ctx || !ctx->image_file)
         return -1;
@@ -168,42 +191,99 @@ int exfat_read_fat(exfat_context_t *ctx) {
         return -1;
     }
 
-    ctx->fat_table = (uint32_t *)malloc(fat_size_bytes);
-    if (!ctx->fat_table) {
-        perror("[exFAT] malloc FAT");
-        return -1;
+    /* Entries past the last cluster are never followed */
+    ctx->fat_offset_bytes = fat_offset_bytes;
+    ctx->fat_entries      = min_entries;
+    ctx->fat_hot          = 0;
+    return 0;
+}
+
+/*
+ * Slot holding FAT page `page`, loading it over the least recently used
+ * slot on a miss.  The FILE position moves; every reader seeks first.
+ *
+ * @return slot index, or -1 on allocation or read failure
+ */
+static int exfat_fat_page(exfat_context_t *ctx, uint32_t page) {
+    exfat_fat_page_t *hot = &ctx->fat_cache[ctx->fat_hot];
+    if (hot->entries && hot->page == page)
+        return (int)ctx->fat_hot;   /* chains mostly stay on one page */
+
+    uint32_t victim = 0;
+    for (uint32_t i = 0; i < EXFAT_FAT_CACHE_PAGES; i++) {
+        exfat_fat_page_t *p = &ctx->fat_cache[i];
+        if (p->entries && p->page == page) {
+            ctx->fat_hot = i;
+            return (int)i;
+        }
+        /* Prefer an unused slot, else the oldest */
+        exfat_fat_page_t *v = &ctx->fat_cache[victim];
+        if (v->entries &&
+            (!p->entries || (ctx->fat_clock - p->last_use) >
+                            (ctx->fat_clock - v->last_use)))
+            victim = i;
     }
-    ctx->fat_entries = available;
 
-    if (fseeko(ctx->image_file, (off_t)fat_offset_bytes, SEEK_SET) != 0) {
+    exfat_fat_page_t *v = &ctx->fat_cache[victim];
+    if (!v->entries) {
+        v->entries = (uint32_t *)malloc(EXFAT_FAT_PAGE_SIZE);
+        if (!v->entries) {
+            perror("[exFAT] malloc FAT page");
+            return -1;
+        }
+    }
+
+    size_t first = (size_t)page * EXFAT_FAT_PAGE_ENTRIES;
+    size_t count = ctx->fat_entries - first;
+    if (count > EXFAT_FAT_PAGE_ENTRIES)
+        count = EXFAT_FAT_PAGE_ENTRIES;
+
+    v->page  = UINT32_MAX;   /* matches nothing until fully read */
+    v->count = 0;
+    if (fseeko(ctx->image_file,
+               (off_t)(ctx->fat_offset_bytes + (uint64_t)first * 4U),
+               SEEK_SET) != 0) {
         perror("[exFAT] fseeko FAT");
-        free(ctx->fat_table);
-        ctx->fat_table = NULL;
         return -1;
     }
-    if (fread(ctx->fat_table, fat_size_bytes, 1, ctx->image_file) != 1) {
+    if (fread(v->entries, sizeof(uint32_t), count, ctx->image_file) != count) {
         perror("[exFAT] fread FAT");
-        free(ctx->fat_table);
-        ctx->fat_table = NULL;
         return -1;
     }
-    return 0;
+    v->page  = page;
+    v->count = (uint32_t)count;
+    ctx->fat_hot = victim;
+    return (int)victim;
 }
 
-uint32_t exfat_get_next_cluster(const exfat_context_t *ctx, uint32_t cluster) {
-    if (!ctx || !ctx->fat_table)
+uint32_t exfat_get_next_cluster(exfat_context_t *ctx, uint32_t cluster) {
+    if (!ctx || !ctx->image_file)
         return EXFAT_FAT_END_OF_CHAIN;
     if (cluster >= (uint32_t)ctx->fat_entries)
         return EXFAT_FAT_END_OF_CHAIN;
-    return ctx->fat_table[cluster];
+
+    int slot = exfat_fat_page(ctx, cluster / EXFAT_FAT_PAGE_ENTRIES);
+    if (slot < 0)
+        return EXFAT_FAT_END_OF_CHAIN;
+
+    exfat_fat_page_t *p = &ctx->fat_cache[slot];
+    uint32_t idx = cluster % EXFAT_FAT_PAGE_ENTRIES;
+    if (idx >= p->count)
+        return EXFAT_FAT_END_OF_CHAIN;
+    p->last_use = ++ctx->fat_clock;
+    return p->entries[idx];
 }
 
 void exfat_free_fat(exfat_context_t *ctx) {
-    if (ctx && ctx->fat_table) {
-        free(ctx->fat_table);
-        ctx->fat_table  = NULL;
-        ctx->fat_entries = 0;
+    if (!ctx)
+        return;
+    for (uint32_t i = 0; i < EXFAT_FAT_CACHE_PAGES; i++) {
+        free(ctx->fat_cache[i].entries);
+        ctx->fat_cache[i].entries = NULL;
+        ctx->fat_cache[i].count   = 0;
     }
+    ctx->fat_entries = 0;
+    ctx->fat_hot     = 0;
 }
 
 /* ── Cluster I/O ────────────────────────────────────────────────────────── */
@@ -437,20 +517,124 @@ done:
 /*
  * Core read loop shared by all three extraction functions.
  *
- * Reads the file described by `info` in EXFAT_IO_CHUNK_SIZE blocks and
- * calls write_cb(write_arg, buf, len) for each.  Returns 0 on success.
- *
- * NoFatChain support: if info->no_fat_chain is set, advance clusters
- * sequentially instead of following the FAT.
+ * The cluster chain is coalesced into extents — runs of consecutive
+ * clusters — and each extent is read with EXFAT_IO_CHUNK_SIZE preads, or
+ * copied in-kernel when out_fd >= 0 and copy_file_range() is available.
+ * A NoFatChain file is a single extent; a fragmented one costs a request
+ * per run instead of one per cluster.  Bytes go to write_cb(write_arg,
+ * buf, len).  Returns 0 on success.
  */
 typedef int (*exfat_write_cb_t)(void *arg, const uint8_t *buf, size_t len);
 
+/*
+ * Length in clusters of the extent starting at *cluster, covering at most
+ * `want` bytes.  *cluster is advanced to the cluster after the extent: the
+ * next FAT link, or past the run for NoFatChain files.
+ */
+uint64_t exfat_next_extent(exfat_context_t *ctx,
+                           const exfat_file_info_t *info,
+                           uint32_t *cluster, uint64_t want) {
+    uint64_t bpc    = ctx->bytes_per_cluster;
+    uint64_t needed = (want + bpc - 1U) / bpc;
+    uint32_t first  = *cluster;
+
+    if (info->no_fat_chain) {
+        /* Stop at the end of the heap; the caller reports the shortfall */
+        if ((uint64_t)first >= (uint64_t)ctx->fat_entries) {
+            *cluster = EXFAT_FAT_END_OF_CHAIN;
+            return 0;
+        }
+        uint64_t avail = (uint64_t)ctx->fat_entries - first;
+        uint64_t run   = (needed < avail) ? needed : avail;
+        *cluster = (run == needed) ? (uint32_t)(first + run)
+                                   : EXFAT_FAT_END_OF_CHAIN;
+        return run;
+    }
+
+    uint64_t run = 1;
+    uint32_t cur = first;
+    for (;;) {
+        uint32_t next = exfat_get_next_cluster(ctx, cur);
+        if (run >= needed || next != cur + 1U) {
+            *cluster = next;
+            return run;
+        }
+        cur = next;
+        run++;
+    }
+}
+
+/* pread() every byte of [off, off + len), retrying EINTR and short reads */
+static int exfat_read_at(exfat_context_t *ctx, uint8_t *buf, size_t len,
+                         uint64_t off) {
+#if defined(_MSC_VER)
+    if (fseeko(ctx->image_file, (off_t)off, SEEK_SET) != 0 ||
+        fread(buf, 1, len, ctx->image_file) != len) {
+        perror("[exFAT] read file data");
+        return -1;
+    }
+    return 0;
+#else
+    int fd = fileno(ctx->image_file);
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, (off_t)off);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            if (n < 0) perror("[exFAT] pread file data");
+            return -1;  /* error, or image shorter than the extent */
+        }
+        buf += n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
+    }
+    return 0;
+#endif
+}
+
+/*
+ * Copy [off, off + len) of the image to out_fd's current position in the
+ * kernel.  *done counts the bytes copied; -1 with *done < len means the
+ * caller should finish with reads (copy_file_range refused or unavailable).
+ */
+static int exfat_copy_extent(exfat_context_t *ctx, int out_fd, uint64_t off,
+                             uint64_t len, uint64_t *done) {
+    *done = 0;
+#if defined(EXFAT_HAVE_CFR)
+    int in_fd = fileno(ctx->image_file);
+    while (*done < len) {
+        uint64_t left = len - *done;
+        size_t   n    = (left < (uint64_t)EXFAT_IO_CHUNK_SIZE * 16U) ?
+                        (size_t)left : (size_t)EXFAT_IO_CHUNK_SIZE * 16U;
+#if defined(__linux__)
+        loff_t in = (loff_t)(off + *done);
+#else
+        off_t in = (off_t)(off + *done);
+#endif
+        ssize_t got = copy_file_range(in_fd, &in, out_fd, NULL, n, 0U);
+        if (got > 0) {
+            *done += (uint64_t)got;
+            continue;
+        }
+        if (got < 0 && errno == EINTR)
+            continue;
+        return -1;      /* refused, or EOF: let reads decide */
+    }
+    return 0;
+#else
+    (void)ctx; (void)out_fd; (void)off; (void)len;
+    return -1;
+#endif
+}
+
 static int exfat_read_file_data(exfat_context_t *ctx,
                                  const exfat_file_info_t *info,
-                                 exfat_write_cb_t write_cb, void *write_arg) {
+                                 exfat_write_cb_t write_cb, void *write_arg,
+                                 int out_fd) {
     uint8_t  io_buf[EXFAT_IO_CHUNK_SIZE];  /* fixed stack buffer, no malloc */
     uint64_t remaining    = info->data_length;
     uint32_t cluster      = info->first_cluster;
+    int      kernel_copy  = (out_fd >= 0);
 
     if (!exfat_is_valid_cluster(cluster) && remaining > 0) {
         fprintf(stderr, "[exFAT] invalid first cluster %u\n", cluster);
@@ -458,50 +642,37 @@ static int exfat_read_file_data(exfat_context_t *ctx,
     }
 
     while (remaining > 0 && exfat_is_valid_cluster(cluster)) {
-        uint64_t cluster_off = exfat_get_cluster_offset(ctx, cluster);
-
-        /* How much of this cluster do we still need? */
-        uint64_t want = (remaining < ctx->bytes_per_cluster) ?
-                         remaining : ctx->bytes_per_cluster;
+        uint32_t first = cluster;
+        uint64_t run   = exfat_next_extent(ctx, info, &cluster, remaining);
+        uint64_t len   = run * ctx->bytes_per_cluster;
+        if (len > remaining)
+            len = remaining;
+
+        uint64_t off  = exfat_get_cluster_offset(ctx, first);
+        uint64_t done = 0;
+
+        if (kernel_copy &&
+            exfat_copy_extent(ctx, out_fd, off, len, &done) != 0) {
+            kernel_copy = 0;    /* not on this fs: reads from here on */
+        }
 
-        /* Read in EXFAT_IO_CHUNK_SIZE pieces within the cluster */
-        uint64_t cluster_done = 0;
-        while (cluster_done < want) {
-            uint64_t chunk = want - cluster_done;
+        while (done < len) {
+            uint64_t chunk = len - done;
             if (chunk > EXFAT_IO_CHUNK_SIZE)
                 chunk = EXFAT_IO_CHUNK_SIZE;
 
-            uint64_t abs_off = cluster_off + cluster_done;
-            if (fseeko(ctx->image_file, (off_t)abs_off, SEEK_SET) != 0) {
-                perror("[exFAT] fseeko file data");
+            if (exfat_read_at(ctx, io_buf, (size_t)chunk, off + done) != 0)
                 return -1;
-            }
-            size_t got = fread(io_buf, 1, (size_t)chunk, ctx->image_file);
-            if (got == 0)
-                return -1;  /* short read */
-
-            if (write_cb(write_arg, io_buf, got) != 0)
+            if (write_cb(write_arg, io_buf, (size_t)chunk) != 0)
                 return -1;
-
-            cluster_done += got;
+            done += chunk;
         }
 
-        remaining -= want;
-        if (remaining == 0)
+        remaining -= len;
+        if (remaining > 0 && exfat_is_end_of_chain(cluster)) {
+            fprintf(stderr, "[exFAT] chain ended with %llu bytes left\n",
+                    (unsigned long long)remaining);
             break;
-
-        /* Advance to next cluster */
-        if (info->no_fat_chain) {
-            cluster++;  /* contiguous layout */
-        } else {
-            uint32_t next = exfat_get_next_cluster(ctx, cluster);
-            if (exfat_is_end_of_chain(next)) {
-                if (remaining > 0)
-                    fprintf(stderr, "[exFAT] chain ended with %llu bytes left\n",
-                            (unsigned long long)remaining);
-                break;
-            }
-            cluster = next;
         }
     }
     return 0;
@@ -546,7 +717,7 @@ int exfat_extract_file(exfat_context_t *ctx, const exfat_file_info_t *info,
         return -1;
     FILE *f = fopen(output_path, "wb");
     if (!f) { perror("[exFAT] fopen output"); return -1; }
-    int rc = exfat_read_file_data(ctx, info, write_cb_file, f);
+    int rc = exfat_read_file_data(ctx, info, write_cb_file, f, -1);
     fclose(f);
     return rc;
 }
@@ -555,7 +726,7 @@ int exfat_extract_file_fd(exfat_context_t *ctx, const exfat_file_info_t *info,
                            int output_fd) {
     if (!ctx || !info || output_fd < 0)
         return -1;
-    return exfat_read_file_data(ctx, info, write_cb_fd, &output_fd);
+    return exfat_read_file_data(ctx, info, write_cb_fd, &output_fd, output_fd);
 }
 
 /*
@@ -575,7 +746,7 @@ ssize_t exfat_extract_to_buffer(exfat_context_t *ctx,
         return -1;
     }
     mem_ctx_t m = { buf, 0, buf_size };
-    if (exfat_read_file_data(ctx, info, write_cb_mem, &m) != 0)
+    if (exfat_read_file_data(ctx, info, write_cb_mem, &m, -1) != 0)
         return -1;
     return (ssize_t)m.pos;
 }
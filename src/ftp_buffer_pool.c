@@ -22,21 +22,31 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 /**
- * @file ftp_buffer_pool.h
- * @brief FTP stream buffer pool
+ * @file ftp_buffer_pool.c
+ * @brief Tiered stream buffer pool
  *
  * @author Seregon
  * @version 1.0.0
  *
- * PLATFORMS: FreeBSD (PS4/PS5 kqueue), Linux (epoll)
- * DESIGN: Single-threaded, non-blocking I/O
+ * Each class owns count x size bytes of one anonymous mapping, created
+ * by the first acquire.  Free buffers are a Treiber stack of slot
+ * indices (upper 32 bits of the head are an ABA tag), so the pool is no
+ * longer capped by the width of an atomic bitmask.  release() finds the
+ * class by address range, so callers do not pass a size back.
  *
+ * The per-thread magazine keeps FTP_BUFFER_MAGAZINE buffers per class;
+ * a session that streams file after file reuses its own buffer without
+ * touching the shared stack.  A thread's magazine is handed back when
+ * the thread exits (pthread key destructor).
  */
 #include "ftp_buffer_pool.h"
 
 #include "ftp_config.h"
+#include <pthread.h>
 #include <stdatomic.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <sys/mman.h>
 
 #ifndef FTP_STREAM_BUFFER_SIZE
 #define FTP_STREAM_BUFFER_SIZE 65536U
@@ -46,56 +56,242 @@ SOFTWARE.
 #define FTP_STREAM_BUFFER_COUNT FTP_MAX_SESSIONS
 #endif
 
-static _Alignas(64) uint8_t
-    g_stream_buffers[FTP_STREAM_BUFFER_COUNT][FTP_STREAM_BUFFER_SIZE];
-static atomic_uint_fast32_t g_stream_buffer_mask = ATOMIC_VAR_INIT(0U);
+#if !defined(MAP_ANON) && defined(MAP_ANONYMOUS)
+#define MAP_ANON MAP_ANONYMOUS
+#endif
 
-/*
- * VULN-06 fix: guard against 1U << i undefined behavior
- *
- *   FTP_MAX_SESSIONS up to 256 is allowed by ftp_config.h,
- *   but the bitmask is uint_fast32_t (may be 32-bit on ARM).
- *   If BUFFER_COUNT > bit width, slots beyond bit 31 are
- *   invisible and those sessions can never acquire a buffer.
- *
- *   This assert fires at compile time if misconfigured.
- */
-_Static_assert(FTP_STREAM_BUFFER_COUNT <= (sizeof(uint_fast32_t) * 8U),
-               "FTP_STREAM_BUFFER_COUNT exceeds atomic bitmask width "
-               "(reduce FTP_MAX_SESSIONS or widen the mask type)");
-
-void *ftp_buffer_acquire(void) {
-  for (;;) {
-    uint_fast32_t mask = atomic_load(&g_stream_buffer_mask);
-
-    uint_fast32_t found = 0U;
-    for (uint_fast32_t i = 0U; i < (uint_fast32_t)FTP_STREAM_BUFFER_COUNT;
-         i++) {
-      uint_fast32_t bit = 1U << i;
-      if ((mask & bit) != 0U) {
-        continue;
+#define POOL_SLOT(head) ((uint32_t)((head) & 0xFFFFFFFFU))
+#define POOL_HEAD(tag, slot1) (((uint64_t)(tag) << 32) | (uint64_t)(slot1))
+
+typedef struct {
+  size_t size;
+  uint32_t count;
+  atomic_uint *next;      /* free-list links (slot + 1, 0 = end) */
+  _Atomic uint64_t head;  /* tag << 32 | top slot + 1            */
+  _Atomic(uint8_t *) base;
+  uint32_t huge;
+  atomic_uint in_use;
+  atomic_uint high_water;
+  atomic_uint_fast64_t acquires;
+  atomic_uint_fast64_t waits;
+} pool_class_t;
+
+static atomic_uint g_next_small[FTP_BUFFER_SMALL_COUNT];
+static atomic_uint g_next_stream[FTP_STREAM_BUFFER_COUNT];
+static atomic_uint g_next_large[FTP_BUFFER_LARGE_COUNT];
+
+static pool_class_t g_classes[FTP_BUFFER_CLASSES] = {
+    {.size = FTP_BUFFER_SMALL_SIZE,
+     .count = FTP_BUFFER_SMALL_COUNT,
+     .next = g_next_small},
+    {.size = FTP_STREAM_BUFFER_SIZE,
+     .count = FTP_STREAM_BUFFER_COUNT,
+     .next = g_next_stream},
+    {.size = FTP_BUFFER_LARGE_SIZE,
+     .count = FTP_BUFFER_LARGE_COUNT,
+     .next = g_next_large},
+};
+
+static pthread_mutex_t g_map_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*===========================================================================*
+ * BACKING MAPPINGS
+ *===========================================================================*/
+
+static void *pool_mmap(size_t bytes, uint32_t *huge) {
+  void *p = MAP_FAILED;
+  *huge = 0U;
+#if FTP_BUFFER_HUGEPAGES
+#if defined(MAP_HUGETLB)
+  {
+    size_t two_mb = (size_t)2U << 20;
+    size_t rounded = (bytes + two_mb - 1U) & ~(two_mb - 1U);
+    p = mmap(NULL, rounded, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANON | MAP_HUGETLB, -1, 0);
+  }
+#elif defined(MAP_ALIGNED_SUPER)
+  p = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANON | MAP_ALIGNED_SUPER, -1, 0);
+#endif
+  if (p != MAP_FAILED) {
+    *huge = 1U;
+    return p;
+  }
+#endif
+  p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1,
+           0);
+  return (p == MAP_FAILED) ? NULL : p;
+}
+
+/* Create the class mapping and thread every slot onto the free list */
+static uint8_t *class_map(pool_class_t *c) {
+  uint8_t *base = atomic_load(&c->base);
+  if (base != NULL) {
+    return base;
+  }
+
+  pthread_mutex_lock(&g_map_lock);
+  base = atomic_load(&c->base);
+  if (base == NULL) {
+    base = (uint8_t *)pool_mmap(c->size * (size_t)c->count, &c->huge);
+    if (base != NULL) {
+      for (uint32_t i = 0U; i < c->count; i++) {
+        atomic_store(&c->next[i], (i + 1U < c->count) ? (i + 2U) : 0U);
       }
+      atomic_store(&c->head, POOL_HEAD(0U, 1U));
+      atomic_store(&c->base, base);
+    }
+  }
+  pthread_mutex_unlock(&g_map_lock);
+  return base;
+}
+
+static int class_of(const void *buffer, uint32_t *slot) {
+  const uint8_t *p = (const uint8_t *)buffer;
+  for (int i = 0; i < (int)FTP_BUFFER_CLASSES; i++) {
+    pool_class_t *c = &g_classes[i];
+    const uint8_t *base = atomic_load(&c->base);
+    if ((base != NULL) && (p >= base) &&
+        (p < base + (c->size * (size_t)c->count))) {
+      *slot = (uint32_t)((size_t)(p - base) / c->size);
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*===========================================================================*
+ * SHARED FREE LISTS
+ *===========================================================================*/
+
+static void *class_pop(pool_class_t *c) {
+  uint8_t *base = class_map(c);
+  if (base == NULL) {
+    return NULL;
+  }
+  uint64_t head = atomic_load(&c->head);
+  while (POOL_SLOT(head) != 0U) {
+    uint32_t slot = POOL_SLOT(head) - 1U;
+    uint64_t next =
+        POOL_HEAD((head >> 32) + 1U, atomic_load(&c->next[slot]));
+    if (atomic_compare_exchange_weak(&c->head, &head, next)) {
+      return base + ((size_t)slot * c->size);
+    }
+  }
+  return NULL;
+}
+
+static void class_push(pool_class_t *c, uint32_t slot) {
+  uint64_t head = atomic_load(&c->head);
+  uint64_t next;
+  do {
+    atomic_store(&c->next[slot], POOL_SLOT(head));
+    next = POOL_HEAD((head >> 32) + 1U, slot + 1U);
+  } while (!atomic_compare_exchange_weak(&c->head, &head, next));
+}
+
+/*===========================================================================*
+ * PER-THREAD MAGAZINES
+ *===========================================================================*/
+
+#if FTP_BUFFER_MAGAZINE > 0
+typedef struct {
+  void *buf[FTP_BUFFER_CLASSES][FTP_BUFFER_MAGAZINE];
+  uint32_t n[FTP_BUFFER_CLASSES];
+} magazine_t;
 
-      uint_fast32_t expected = mask;
-      uint_fast32_t desired = mask | bit;
-      if (atomic_compare_exchange_strong(&g_stream_buffer_mask, &expected,
-                                         desired)) {
-        return (void *)g_stream_buffers[i];
+static pthread_key_t g_mag_key;
+static pthread_once_t g_mag_once = PTHREAD_ONCE_INIT;
+static int g_mag_ok = 0;
+
+static void magazine_flush(void *arg) {
+  magazine_t *m = (magazine_t *)arg;
+  for (int i = 0; i < (int)FTP_BUFFER_CLASSES; i++) {
+    while (m->n[i] > 0U) {
+      void *b = m->buf[i][--m->n[i]];
+      uint32_t slot = 0U;
+      if (class_of(b, &slot) == i) {
+        class_push(&g_classes[i], slot);
       }
+    }
+  }
+  free(m);
+}
 
-      found = 1U;
-      break; /* CAS failed, re-read mask from outer loop */
+static void magazine_key_init(void) {
+  g_mag_ok = (pthread_key_create(&g_mag_key, magazine_flush) == 0) ? 1 : 0;
+}
+
+static magazine_t *magazine_get(int create) {
+  (void)pthread_once(&g_mag_once, magazine_key_init);
+  if (g_mag_ok == 0) {
+    return NULL;
+  }
+  magazine_t *m = (magazine_t *)pthread_getspecific(g_mag_key);
+  if ((m == NULL) && (create != 0)) {
+    m = calloc(1U, sizeof(*m));
+    if ((m != NULL) && (pthread_setspecific(g_mag_key, m) != 0)) {
+      free(m);
+      m = NULL;
     }
+  }
+  return m;
+}
+#endif
+
+/*===========================================================================*
+ * PUBLIC API
+ *===========================================================================*/
+
+static void note_acquire(pool_class_t *c) {
+  unsigned now = atomic_fetch_add(&c->in_use, 1U) + 1U;
+  unsigned peak = atomic_load(&c->high_water);
+  while ((now > peak) &&
+         !atomic_compare_exchange_weak(&c->high_water, &peak, now)) {
+  }
+  atomic_fetch_add(&c->acquires, 1U);
+}
+
+static void *class_acquire(int cls) {
+  pool_class_t *c = &g_classes[cls];
+  void *b = NULL;
+
+#if FTP_BUFFER_MAGAZINE > 0
+  magazine_t *m = magazine_get(0);
+  if ((m != NULL) && (m->n[cls] > 0U)) {
+    b = m->buf[cls][--m->n[cls]];
+  }
+#endif
+  if (b == NULL) {
+    b = class_pop(c);
+  }
+  if (b == NULL) {
+    atomic_fetch_add(&c->waits, 1U);
+    return NULL;
+  }
+  note_acquire(c);
+  return b;
+}
 
-    /*
-     * If CAS failed (found==1), the outer loop retries with a fresh mask.
-     * If no free slot was found (found==0), check if mask changed
-     * since we read it; if unchanged, all buffers are truly occupied.
-     */
-    if ((found == 0U) && (mask == atomic_load(&g_stream_buffer_mask))) {
-      return NULL;
+void *ftp_buffer_acquire(void) { return class_acquire(FTP_BUFFER_STREAM); }
+
+void *ftp_buffer_acquire_size(size_t want, size_t *size_out) {
+  for (int i = 0; i < (int)FTP_BUFFER_CLASSES; i++) {
+    if (g_classes[i].size < want) {
+      continue;
     }
+    void *b = class_acquire(i);
+    if (b != NULL) {
+      if (size_out != NULL) {
+        *size_out = g_classes[i].size;
+      }
+      return b;
+    }
+  }
+  if (size_out != NULL) {
+    *size_out = 0U;
   }
+  return NULL;
 }
 
 void ftp_buffer_release(void *buffer) {
@@ -103,13 +299,40 @@ void ftp_buffer_release(void *buffer) {
     return;
   }
 
-  for (uint_fast32_t i = 0U; i < (uint_fast32_t)FTP_STREAM_BUFFER_COUNT; i++) {
-    if ((void *)g_stream_buffers[i] == buffer) {
-      uint_fast32_t bit = 1U << i;
-      (void)atomic_fetch_and(&g_stream_buffer_mask, ~bit);
-      return;
-    }
+  uint32_t slot = 0U;
+  int cls = class_of(buffer, &slot);
+  if (cls < 0) {
+    return;
   }
+  pool_class_t *c = &g_classes[cls];
+  atomic_fetch_sub(&c->in_use, 1U);
+
+#if FTP_BUFFER_MAGAZINE > 0
+  magazine_t *m = magazine_get(1);
+  if ((m != NULL) && (m->n[cls] < FTP_BUFFER_MAGAZINE)) {
+    m->buf[cls][m->n[cls]++] =
+        atomic_load(&c->base) + ((size_t)slot * c->size);
+    return;
+  }
+#endif
+  class_push(c, slot);
 }
 
 size_t ftp_buffer_size(void) { return (size_t)FTP_STREAM_BUFFER_SIZE; }
+
+void ftp_buffer_get_stats(ftp_buffer_class_stats_t out[FTP_BUFFER_CLASSES]) {
+  if (out == NULL) {
+    return;
+  }
+  for (int i = 0; i < (int)FTP_BUFFER_CLASSES; i++) {
+    pool_class_t *c = &g_classes[i];
+    out[i].size = c->size;
+    out[i].count = c->count;
+    out[i].in_use = atomic_load(&c->in_use);
+    out[i].high_water = atomic_load(&c->high_water);
+    out[i].mapped = (atomic_load(&c->base) != NULL) ? 1U : 0U;
+    out[i].huge = c->huge;
+    out[i].acquires = (uint64_t)atomic_load(&c->acquires);
+    out[i].waits = (uint64_t)atomic_load(&c->waits);
+  }
+}
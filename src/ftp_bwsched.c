@@ -0,0 +1,437 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_bwsched.c
+ * @brief Server-wide bandwidth scheduler (global / per-IP / per-session)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * GRANT (one lock hold, then at most one sleep per round):
+ *
+ *   refill every limited bucket from elapsed time
+ *   n = min(want, fair slice of each level, tokens of each level)
+ *       slice = burst / sessions sharing the bucket  (>= BW_MIN_SLICE)
+ *   n >= min(want, BW_MIN_SLICE)?  yes -> take n from each, return n
+ *                                  no  -> sleep until the emptiest refills
+ *
+ *   Taking what is there (down to BW_MIN_SLICE) rather than waiting for a
+ *   whole slice means a bulk transfer and a small one sharing a bucket
+ *   wake at the same pace and split it instead of one starving the other.
+ *
+ *   Buckets hold at most FTP_BW_BURST_MS worth of tokens, so an idle
+ *   session cannot save up a large burst.  Refill only moves the clock
+ *   when at least one token was added: slow rates polled often still
+ *   accumulate.
+ */
+
+#include "ftp_bwsched.h"
+#include "ftp_config.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Smallest slice worth a sendfile()/send() call */
+#define BW_MIN_SLICE 4096U
+
+/** Longest single sleep inside ftp_bw_grant() (ns) */
+#define BW_MAX_SLEEP_NS 100000000ULL
+
+typedef struct {
+  uint32_t ip;
+  uint32_t refs; /* 0 = free slot */
+  ftp_bw_bucket_t b;
+} bw_ip_t;
+
+static _Atomic uint64_t g_bw_rate[FTP_BW_SCOPES] = {
+    (uint64_t)FTP_BW_GLOBAL_BPS, (uint64_t)FTP_BW_PER_IP_BPS,
+    (uint64_t)FTP_BW_SESSION_BPS};
+
+static pthread_mutex_t g_bw_lock = PTHREAD_MUTEX_INITIALIZER;
+static ftp_bw_bucket_t g_bw_global;
+static bw_ip_t g_bw_ips[FTP_BW_IP_SLOTS];
+static uint32_t g_bw_clients = 0U;
+static uint32_t g_bw_ips_used = 0U;
+static uint64_t g_bw_granted = 0U;
+static uint64_t g_bw_waits = 0U;
+static uint64_t g_bw_wait_ns = 0U;
+
+static uint64_t bw_now_ns(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 0U;
+  }
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t bw_cap(uint64_t rate) {
+  uint64_t cap = (rate * (uint64_t)FTP_BW_BURST_MS) / 1000ULL;
+  return (cap < BW_MIN_SLICE) ? BW_MIN_SLICE : cap;
+}
+
+static void bw_refill(ftp_bw_bucket_t *b, uint64_t rate, uint64_t now) {
+  uint64_t cap = bw_cap(rate);
+  if ((b->last_ns == 0U) || (now < b->last_ns) ||
+      ((now - b->last_ns) >= 1000000000ULL)) {
+    b->tokens = cap; /* first use, clock step, or idle > 1 s */
+    b->last_ns = now;
+    return;
+  }
+  uint64_t add = ((now - b->last_ns) * rate) / 1000000000ULL;
+  if (add > 0U) {
+    b->last_ns = now;
+    uint64_t t = b->tokens + add;
+    b->tokens = (t > cap) ? cap : t;
+  }
+}
+
+/* Fair slice of a bucket shared by @p sharers sessions */
+static uint64_t bw_slice(uint64_t rate, uint32_t sharers) {
+  uint64_t cap = bw_cap(rate);
+  uint64_t slice = cap / ((sharers > 0U) ? (uint64_t)sharers : 1ULL);
+  return (slice < BW_MIN_SLICE) ? BW_MIN_SLICE : slice;
+}
+
+/* Time until @p b holds @p need tokens (0 = now) */
+static uint64_t bw_wait_for(const ftp_bw_bucket_t *b, uint64_t rate,
+                            uint64_t need) {
+  if (b->tokens >= need) {
+    return 0U;
+  }
+  return (((need - b->tokens) * 1000000000ULL) + rate - 1U) / rate;
+}
+
+/*===========================================================================*
+ * CLIENTS
+ *===========================================================================*/
+
+void ftp_bw_attach(ftp_bw_client_t *c, uint32_t ip) {
+  if ((c == NULL) || (c->attached != 0)) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_bw_lock);
+  int slot = -1;
+  int free_slot = -1;
+  for (int i = 0; i < (int)FTP_BW_IP_SLOTS; i++) {
+    if (g_bw_ips[i].refs == 0U) {
+      if (free_slot < 0) {
+        free_slot = i;
+      }
+    } else if (g_bw_ips[i].ip == ip) {
+      slot = i;
+      break;
+    }
+  }
+  if ((slot < 0) && (free_slot >= 0)) {
+    slot = free_slot;
+    memset(&g_bw_ips[slot], 0, sizeof(g_bw_ips[slot]));
+    g_bw_ips[slot].ip = ip;
+    g_bw_ips_used++;
+  }
+  if (slot >= 0) {
+    g_bw_ips[slot].refs++;
+  }
+  g_bw_clients++;
+  pthread_mutex_unlock(&g_bw_lock);
+
+  memset(&c->own, 0, sizeof(c->own));
+  c->ip = ip;
+  c->ip_slot = slot;
+  c->attached = 1;
+}
+
+void ftp_bw_detach(ftp_bw_client_t *c) {
+  if ((c == NULL) || (c->attached == 0)) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_bw_lock);
+  if (c->ip_slot >= 0) {
+    bw_ip_t *e = &g_bw_ips[c->ip_slot];
+    if (e->refs > 0U) {
+      e->refs--;
+      if (e->refs == 0U) {
+        g_bw_ips_used--;
+      }
+    }
+  }
+  if (g_bw_clients > 0U) {
+    g_bw_clients--;
+  }
+  pthread_mutex_unlock(&g_bw_lock);
+
+  c->ip_slot = -1;
+  c->attached = 0;
+}
+
+/*===========================================================================*
+ * RATES
+ *===========================================================================*/
+
+void ftp_bw_set_rate(ftp_bw_scope_t scope, uint64_t bps) {
+  if ((unsigned)scope >= (unsigned)FTP_BW_SCOPES) {
+    return;
+  }
+  atomic_store(&g_bw_rate[scope], bps);
+}
+
+uint64_t ftp_bw_get_rate(ftp_bw_scope_t scope) {
+  if ((unsigned)scope >= (unsigned)FTP_BW_SCOPES) {
+    return 0U;
+  }
+  return atomic_load(&g_bw_rate[scope]);
+}
+
+int ftp_bw_limited(void) {
+  for (int i = 0; i < (int)FTP_BW_SCOPES; i++) {
+    if (atomic_load(&g_bw_rate[i]) != 0U) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+const char *ftp_bw_scope_name(ftp_bw_scope_t scope) {
+  switch (scope) {
+  case FTP_BW_GLOBAL:
+    return "global";
+  case FTP_BW_PER_IP:
+    return "ip";
+  case FTP_BW_SESSION:
+    return "session";
+  default:
+    return "?";
+  }
+}
+
+int ftp_bw_parse_rate(const char *text, uint64_t *out) {
+  if ((text == NULL) || (out == NULL) || (*text == '\0')) {
+    return -1;
+  }
+  if ((strcmp(text, "off") == 0) || (strcmp(text, "OFF") == 0)) {
+    *out = 0U;
+    return 0;
+  }
+
+  uint64_t v = 0U;
+  const char *p = text;
+  while ((*p >= '0') && (*p <= '9')) {
+    uint64_t d = (uint64_t)(*p - '0');
+    if (v > ((UINT64_MAX - d) / 10U)) {
+      return -1;
+    }
+    v = (v * 10U) + d;
+    p++;
+  }
+  if (p == text) {
+    return -1;
+  }
+
+  uint64_t mul = 1U;
+  switch (*p) {
+  case '\0':
+    break;
+  case 'k':
+  case 'K':
+    mul = 1024U;
+    break;
+  case 'm':
+  case 'M':
+    mul = 1024U * 1024U;
+    break;
+  case 'g':
+  case 'G':
+    mul = 1024U * 1024U * 1024U;
+    break;
+  default:
+    return -1;
+  }
+  if ((*p != '\0') && (p[1] != '\0')) {
+    return -1;
+  }
+  if ((v != 0U) && (v > (UINT64_MAX / mul))) {
+    return -1;
+  }
+
+  *out = v * mul;
+  return 0;
+}
+
+/*===========================================================================*
+ * GRANTS
+ *===========================================================================*/
+
+size_t ftp_bw_grant(ftp_bw_client_t *c, size_t want) {
+  if ((c == NULL) || (want == 0U)) {
+    return want;
+  }
+
+  uint64_t slept = 0U;
+  for (;;) {
+    uint64_t rate[FTP_BW_SCOPES];
+    for (int i = 0; i < (int)FTP_BW_SCOPES; i++) {
+      rate[i] = atomic_load(&g_bw_rate[i]);
+    }
+
+    pthread_mutex_lock(&g_bw_lock);
+    ftp_bw_bucket_t *b[FTP_BW_SCOPES] = {NULL, NULL, NULL};
+    uint32_t sharers[FTP_BW_SCOPES] = {g_bw_clients, 1U, 1U};
+    if (rate[FTP_BW_GLOBAL] != 0U) {
+      b[FTP_BW_GLOBAL] = &g_bw_global;
+    }
+    if ((rate[FTP_BW_PER_IP] != 0U) && (c->ip_slot >= 0)) {
+      b[FTP_BW_PER_IP] = &g_bw_ips[c->ip_slot].b;
+      sharers[FTP_BW_PER_IP] = g_bw_ips[c->ip_slot].refs;
+    }
+    if (rate[FTP_BW_SESSION] != 0U) {
+      b[FTP_BW_SESSION] = &c->own;
+    }
+
+    uint64_t now = bw_now_ns();
+    uint64_t n = (uint64_t)want;
+    int limited = 0;
+    for (int i = 0; i < (int)FTP_BW_SCOPES; i++) {
+      if (b[i] == NULL) {
+        continue;
+      }
+      limited = 1;
+      bw_refill(b[i], rate[i], now);
+      uint64_t slice = bw_slice(rate[i], sharers[i]);
+      if (n > slice) {
+        n = slice;
+      }
+    }
+    if (limited == 0) {
+      pthread_mutex_unlock(&g_bw_lock);
+      break; /* limits lifted while waiting */
+    }
+
+    /* Partial slices keep a large request from waiting behind small ones */
+    uint64_t need = (n < BW_MIN_SLICE) ? n : BW_MIN_SLICE;
+    uint64_t wait = 0U;
+    for (int i = 0; i < (int)FTP_BW_SCOPES; i++) {
+      if (b[i] != NULL) {
+        uint64_t w = bw_wait_for(b[i], rate[i], need);
+        if (w > wait) {
+          wait = w;
+        }
+        if (b[i]->tokens < n) {
+          n = b[i]->tokens;
+        }
+      }
+    }
+
+    if (wait == 0U) {
+      for (int i = 0; i < (int)FTP_BW_SCOPES; i++) {
+        if (b[i] != NULL) {
+          b[i]->tokens -= n;
+        }
+      }
+      g_bw_granted += n;
+      if (slept != 0U) {
+        g_bw_waits++;
+        g_bw_wait_ns += slept;
+      }
+      pthread_mutex_unlock(&g_bw_lock);
+      return (size_t)n;
+    }
+    pthread_mutex_unlock(&g_bw_lock);
+
+    if (wait > BW_MAX_SLEEP_NS) {
+      wait = BW_MAX_SLEEP_NS;
+    }
+    uint64_t t0 = bw_now_ns();
+    struct timespec ts = {(time_t)(wait / 1000000000ULL),
+                          (long)(wait % 1000000000ULL)};
+    while ((nanosleep(&ts, &ts) != 0) && (errno == EINTR)) {
+    }
+    uint64_t t1 = bw_now_ns();
+    slept += (t1 > t0) ? (t1 - t0) : 0U;
+  }
+
+  return want;
+}
+
+void ftp_bw_refund(ftp_bw_client_t *c, size_t granted, size_t used) {
+  if ((c == NULL) || (used >= granted)) {
+    return;
+  }
+  uint64_t back = (uint64_t)(granted - used);
+
+  pthread_mutex_lock(&g_bw_lock);
+  for (int i = 0; i < (int)FTP_BW_SCOPES; i++) {
+    uint64_t rate = atomic_load(&g_bw_rate[i]);
+    ftp_bw_bucket_t *b = NULL;
+    if (rate == 0U) {
+      continue;
+    }
+    if (i == (int)FTP_BW_GLOBAL) {
+      b = &g_bw_global;
+    } else if (i == (int)FTP_BW_PER_IP) {
+      b = (c->ip_slot >= 0) ? &g_bw_ips[c->ip_slot].b : NULL;
+    } else {
+      b = &c->own;
+    }
+    if (b != NULL) {
+      uint64_t cap = bw_cap(rate);
+      b->tokens = ((b->tokens + back) > cap) ? cap : (b->tokens + back);
+    }
+  }
+  if (g_bw_granted >= back) {
+    g_bw_granted -= back;
+  }
+  pthread_mutex_unlock(&g_bw_lock);
+}
+
+void ftp_bw_consume(ftp_bw_client_t *c, size_t bytes) {
+  while (bytes > 0U) {
+    size_t n = ftp_bw_grant(c, bytes);
+    if (n == 0U) {
+      break;
+    }
+    bytes -= n;
+  }
+}
+
+void ftp_bw_get_stats(ftp_bw_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  for (int i = 0; i < (int)FTP_BW_SCOPES; i++) {
+    out->rate[i] = atomic_load(&g_bw_rate[i]);
+  }
+  pthread_mutex_lock(&g_bw_lock);
+  out->clients = g_bw_clients;
+  out->ips = g_bw_ips_used;
+  out->granted_bytes = g_bw_granted;
+  out->waits = g_bw_waits;
+  out->wait_ns = g_bw_wait_ns;
+  pthread_mutex_unlock(&g_bw_lock);
+}
@@ -37,13 +37,30 @@ SOFTWARE.
 
 #include "ftp_commands.h"
 #include "ftp_buffer_pool.h"
+#include "ftp_bwsched.h"
+#include "ftp_copyjob.h"
 #include "ftp_crypto.h"
+#include "ftp_delta.h"
+#include "ftp_fsprofile.h"
+#include "ftp_fxp.h"
+#include "ftp_hash.h"
+#include "ftp_list.h"
 #include "ftp_log.h"
+#include "ftp_metrics.h"
+#include "ftp_pasv_pool.h"
+#include "ftp_prefetch.h"
+#include "ftp_segment.h"
+#include "ftp_stat_cache.h"
 #include "ftp_path.h"
 #include "ftp_session.h"
+#include "ftp_tar.h"
+#include "ftp_trace.h"
+#include "ftp_xfer_tune.h"
 #include "pal_fileio.h"
 #include "pal_filesystem.h"
 #include "pal_network.h"
+#include "pal_ring.h"
+#include "pal_thread.h"
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
@@ -51,20 +68,16 @@ SOFTWARE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/stat.h>
 #if defined(__APPLE__) ||                                                      \
     (defined(__FreeBSD__) && !defined(PLATFORM_PS4) && !defined(PLATFORM_PS5))
 #include <sys/mount.h>
 #endif
-#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
-#include <sys/mount.h>
-extern int _fstatfs(int, struct statfs *);
-#endif
 #include <pthread.h>
 #include <time.h>
 #include <unistd.h>
 #if defined(__linux__)
-#include <fcntl.h> /* posix_fadvise(POSIX_FADV_DONTNEED) */
 #endif
 
 /* Fallback: pal_fileio.h may be suppressed by a transitive include guard */
@@ -132,41 +145,15 @@ static ftp_error_t send_control_raw(ftp_session_t *session,
     return FTP_ERR_INVALID_PARAM;
   }
 
-  if (session->ctrl_fd < 0) {
-    return FTP_ERR_SOCKET_SEND;
-  }
-
-  size_t len = strlen(payload);
-  if (len == 0U) {
-    return FTP_OK;
-  }
-
-  ssize_t sent = pal_send_all(session->ctrl_fd, payload, len, 0);
-  if (sent != (ssize_t)len) {
-    return FTP_ERR_SOCKET_SEND;
+  ftp_error_t err = ftp_session_send_control(session, payload, strlen(payload));
+  if (err != FTP_OK) {
+    return err;
   }
 
   session->last_activity = time(NULL);
   return FTP_OK;
 }
 
-static const char *mlsx_type_from_mode(uint32_t mode) {
-  return (((mode & (uint32_t)S_IFMT) == (uint32_t)S_IFDIR)) ? "dir" : "file";
-}
-
-static void mlsx_format_modify_time(int64_t mtime, char *buffer,
-                                    size_t size) {
-  if ((buffer == NULL) || (size == 0U)) {
-    return;
-  }
-
-  time_t unix_time = (time_t)mtime;
-  struct tm tm_time;
-  memset(&tm_time, 0, sizeof(tm_time));
-  gmtime_r(&unix_time, &tm_time);
-  (void)strftime(buffer, size, "%Y%m%d%H%M%S", &tm_time);
-}
-
 static ftp_error_t ftp_path_to_client_path(const ftp_session_t *session,
                                            const char *resolved,
                                            char *output, size_t size) {
@@ -216,38 +203,6 @@ static ftp_error_t ftp_path_to_client_path(const ftp_session_t *session,
   return FTP_OK;
 }
 
-static ftp_error_t mlsx_format_line(const vfs_stat_t *st,
-                                    const char *display_name,
-                                    int leading_space, char *buffer,
-                                    size_t size) {
-  if ((st == NULL) || (display_name == NULL) || (buffer == NULL) ||
-      (size == 0U)) {
-    return FTP_ERR_INVALID_PARAM;
-  }
-
-  char timebuf[20];
-  memset(timebuf, 0, sizeof(timebuf));
-  mlsx_format_modify_time(st->mtime, timebuf, sizeof(timebuf));
-
-  const char *type_str = mlsx_type_from_mode(st->mode);
-  unsigned long long size_value =
-      (((st->mode & (uint32_t)S_IFMT) == (uint32_t)S_IFDIR))
-          ? 0ULL
-          : (unsigned long long)st->size;
-  unsigned mode_value = (unsigned)(st->mode & 07777U);
-  const char *prefix = (leading_space != 0) ? " " : "";
-
-  int n = snprintf(buffer, size,
-                   "%stype=%s;size=%llu;modify=%s;unix.mode=%04o; %s\r\n",
-                   prefix, type_str, size_value, timebuf, mode_value,
-                   display_name);
-  if ((n < 0) || ((size_t)n >= size)) {
-    return FTP_ERR_PATH_TOO_LONG;
-  }
-
-  return FTP_OK;
-}
-
 /*===========================================================================*
  * AUTHENTICATION AND CONTROL
  *===========================================================================*/
@@ -342,23 +297,27 @@ ftp_error_t cmd_CWD(ftp_session_t *session, const char *args) {
                                   "Invalid path.");
   }
 
-  /* Check if directory exists */
+  /* Check if directory exists (on disk or inside a mounted image) */
   int is_dir = pal_path_is_directory(resolved);
+  if ((is_dir != 1) && (vfs_is_image_path(resolved) != 0)) {
+    vfs_stat_t st;
+    is_dir = ((vfs_stat(resolved, &st) == FTP_OK) &&
+              ((st.mode & (uint32_t)S_IFMT) == (uint32_t)S_IFDIR))
+                 ? 1
+                 : 0;
+  }
 
   if (is_dir != 1) {
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
                                   "Not a directory.");
   }
 
-  /* Update CWD */
-  size_t len = strlen(resolved);
-  if (len >= sizeof(session->cwd)) {
+  /* Update CWD (drops the old cwd descriptor and cached resolutions) */
+  if (ftp_path_set_cwd(session, resolved) != FTP_OK) {
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
                                   "Path too long.");
   }
 
-  memcpy(session->cwd, resolved, len + 1U);
-
   return ftp_session_send_reply(session, FTP_REPLY_250_FILE_ACTION_OK,
                                 "Directory changed.");
 }
@@ -403,123 +362,23 @@ ftp_error_t cmd_PWD(ftp_session_t *session, const char *args) {
  * DIRECTORY LISTING
  *===========================================================================*/
 
-/**
- * @brief Helper: Send directory listing via data connection
+/*
+ * PROT P: run the data channel handshake as soon as the connection is
+ * open and 150 is out.  Left to the first send it never happens for an
+ * empty listing or file, and the client's handshake meets a closed
+ * socket.  On failure the data connection is closed.
  */
-static ftp_error_t send_directory_listing(ftp_session_t *session,
-                                          const char *path, int detailed) {
-  DIR *dir = opendir(path);
-  if (dir == NULL) {
-    return FTP_ERR_DIR_OPEN;
-  }
-
-  char line_buffer[FTP_LIST_LINE_SIZE];
-  struct dirent *entry;
-
-  int skip_stat = 0;
-  if (FTP_LIST_SAFE_MODE != 0) {
-    if ((strncmp(path, "/dev", 4) == 0) &&
-        ((path[4] == '\0') || (path[4] == '/'))) {
-      skip_stat = 1;
-    } else if ((strncmp(path, "/proc", 5) == 0) &&
-               ((path[5] == '\0') || (path[5] == '/'))) {
-      skip_stat = 1;
-    } else if ((strncmp(path, "/sys", 4) == 0) &&
-               ((path[4] == '\0') || (path[4] == '/'))) {
-      skip_stat = 1;
-    }
-#if defined(__APPLE__) ||                                                      \
-    (defined(__FreeBSD__) && !defined(PLATFORM_PS4) && !defined(PLATFORM_PS5))
-    if (skip_stat == 0) {
-      struct statfs sfs;
-      if (statfs(path, &sfs) == 0) {
-        const char *t = sfs.f_fstypename;
-        if ((t != NULL) &&
-            ((strcmp(t, "devfs") == 0) || (strcmp(t, "procfs") == 0) ||
-             (strcmp(t, "fdescfs") == 0) || (strcmp(t, "sysfs") == 0) ||
-             (strcmp(t, "linsysfs") == 0))) {
-          skip_stat = 1;
-        }
-      }
-    }
-#endif
-  }
-
-  while ((entry = readdir(dir)) != NULL) {
-    /* Skip . and .. */
-    if ((strcmp(entry->d_name, ".") == 0) ||
-        (strcmp(entry->d_name, "..") == 0)) {
-      continue;
-    }
-
-    if (detailed != 0) {
-      /* Detailed listing (ls -l format) */
-      vfs_stat_t st;
-      int have_stat = 0;
-      if (skip_stat == 0) {
-        char fullpath[FTP_PATH_MAX];
-        int n =
-            snprintf(fullpath, sizeof(fullpath), "%s/%s", path, entry->d_name);
-        if ((n >= 0) && ((size_t)n < sizeof(fullpath))) {
-          if (vfs_stat(fullpath, &st) == FTP_OK) {
-            have_stat = 1;
-          }
-        }
-      }
-      if (have_stat == 0) {
-        memset(&st, 0, sizeof(st));
-        if (entry->d_type == DT_DIR) {
-          st.mode = (uint32_t)S_IFDIR;
-        } else {
-          st.mode = (uint32_t)S_IFREG;
-        }
-      }
-
-      /* Format: -rw-r--r-- 1 user group size date filename */
-      char perms[11];
-      perms[0] = (((st.mode & S_IFMT) == S_IFDIR)) ? 'd' : '-';
-      perms[1] = ((st.mode & S_IRUSR) != 0U) ? 'r' : '-';
-      perms[2] = ((st.mode & S_IWUSR) != 0U) ? 'w' : '-';
-      perms[3] = ((st.mode & S_IXUSR) != 0U) ? 'x' : '-';
-      perms[4] = ((st.mode & S_IRGRP) != 0U) ? 'r' : '-';
-      perms[5] = ((st.mode & S_IWGRP) != 0U) ? 'w' : '-';
-      perms[6] = ((st.mode & S_IXGRP) != 0U) ? 'x' : '-';
-      perms[7] = ((st.mode & S_IROTH) != 0U) ? 'r' : '-';
-      perms[8] = ((st.mode & S_IWOTH) != 0U) ? 'w' : '-';
-      perms[9] = ((st.mode & S_IXOTH) != 0U) ? 'x' : '-';
-      perms[10] = '\0';
-
-      /* Format time */
-      struct tm tm_time;
-      time_t mtime = (time_t)st.mtime;
-      gmtime_r(&mtime, &tm_time);
-
-      char time_str[32];
-      strftime(time_str, sizeof(time_str), "%b %d %H:%M", &tm_time);
-
-      int n = snprintf(line_buffer, sizeof(line_buffer),
-                       "%s 1 ftp ftp %10lld %s %s\r\n", perms,
-                       (long long)st.size, time_str, entry->d_name);
-      if ((n < 0) || ((size_t)n >= sizeof(line_buffer))) {
-        continue;
-      }
-    } else {
-      /* Simple listing (names only) */
-      int n =
-          snprintf(line_buffer, sizeof(line_buffer), "%s\r\n", entry->d_name);
-
-      if ((n < 0) || ((size_t)n >= sizeof(line_buffer))) {
-        continue;
-      }
-    }
-
-    /* Send line */
-    (void)ftp_session_send_data(session, line_buffer, strlen(line_buffer));
+static ftp_error_t xfer_start_data_tls(ftp_session_t *session) {
+#if FTP_ENABLE_TLS
+  ftp_error_t err = ftp_session_start_data_tls(session);
+  if (err != FTP_OK) {
+    ftp_session_close_data_connection(session);
   }
-
-  closedir(dir);
-
+  return err;
+#else
+  (void)session;
   return FTP_OK;
+#endif
 }
 
 /**
@@ -557,6 +416,9 @@ ftp_error_t cmd_LIST(ftp_session_t *session, const char *args) {
   }
   ftp_log_line(FTP_LOG_INFO, "[DBG] LIST: data conn OK, sending 150");
   ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK, NULL);
+  if (xfer_start_data_tls(session) != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
 
   /* Protocol pacing: ensure the 150 reply is delivered as a
    * separate TCP segment before the data transfer + 226.
@@ -567,17 +429,23 @@ ftp_error_t cmd_LIST(ftp_session_t *session, const char *args) {
   usleep(50000); /* 50 ms */
 
   /* Send listing */
-  err = send_directory_listing(session, resolved, 1);
+  err = ftp_list_send_directory(session, resolved, FTP_LIST_UNIX);
 
   /* Close data connection */
   ftp_session_close_data_connection(session);
 
+  if (err == FTP_ERR_SOCKET_SEND) {
+    return ftp_session_send_reply(session, FTP_REPLY_426_TRANSFER_ABORTED,
+                                  NULL);
+  }
   if (err != FTP_OK) {
     return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
                                   "Error reading directory.");
   }
 
-  return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, NULL);
+  err = ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, NULL);
+  ftp_prefetch_listing(session, resolved);
+  return err;
 }
 
 /**
@@ -606,20 +474,29 @@ ftp_error_t cmd_NLST(ftp_session_t *session, const char *args) {
   }
 
   ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK, NULL);
+  if (xfer_start_data_tls(session) != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
 
   /* Protocol pacing: prevent 150 and 226 from merging */
   usleep(50000); /* 50 ms */
 
-  err = send_directory_listing(session, resolved, 0);
+  err = ftp_list_send_directory(session, resolved, FTP_LIST_NAMES);
 
   ftp_session_close_data_connection(session);
 
+  if (err == FTP_ERR_SOCKET_SEND) {
+    return ftp_session_send_reply(session, FTP_REPLY_426_TRANSFER_ABORTED,
+                                  NULL);
+  }
   if (err != FTP_OK) {
     return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
                                   "Error reading directory.");
   }
 
-  return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, NULL);
+  err = ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, NULL);
+  ftp_prefetch_listing(session, resolved);
+  return err;
 }
 
 /**
@@ -658,58 +535,23 @@ ftp_error_t cmd_MLSD(ftp_session_t *session, const char *args) {
   }
 
   ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK, NULL);
+  if (xfer_start_data_tls(session) != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
 
   /* Protocol pacing: prevent 150 and 226 from merging */
   usleep(50000); /* 50 ms */
 
-  /* Read directory and send machine-readable entries */
-  DIR *dir = opendir(resolved);
-  if (dir != NULL) {
-    struct dirent *entry;
-    char line_buffer[FTP_LIST_LINE_SIZE];
-
-    while ((entry = readdir(dir)) != NULL) {
-      /* Skip . and .. */
-      if ((strcmp(entry->d_name, ".") == 0) ||
-          (strcmp(entry->d_name, "..") == 0)) {
-        continue;
-      }
-
-      /* Stat the entry */
-      vfs_stat_t st;
-      int have_stat = 0;
-      char fullpath[FTP_PATH_MAX];
-      int n = snprintf(fullpath, sizeof(fullpath), "%s/%s", resolved,
-                       entry->d_name);
-      if ((n >= 0) && ((size_t)n < sizeof(fullpath))) {
-        if (vfs_stat(fullpath, &st) == FTP_OK) {
-          have_stat = 1;
-        }
-      }
-
-      if (have_stat == 0) {
-        memset(&st, 0, sizeof(st));
-        if (entry->d_type == DT_DIR) {
-          st.mode = (uint32_t)S_IFDIR;
-        } else {
-          st.mode = (uint32_t)S_IFREG;
-        }
-      }
-
-      if (mlsx_format_line(&st, entry->d_name, 0, line_buffer,
-                           sizeof(line_buffer)) == FTP_OK) {
-        size_t line_len = strlen(line_buffer);
-        (void)ftp_session_send_data(session, line_buffer, line_len);
-      }
-    }
-
-    closedir(dir);
-  }
+  /* Read directory and send machine-readable entries; an unreadable
+   * directory is an empty listing, as before */
+  (void)ftp_list_send_directory(session, resolved, FTP_LIST_MLSD);
 
   /* Close data connection */
   ftp_session_close_data_connection(session);
 
-  return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, NULL);
+  err = ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, NULL);
+  ftp_prefetch_listing(session, resolved);
+  return err;
 }
 
 /**
@@ -732,7 +574,7 @@ ftp_error_t cmd_MLST(ftp_session_t *session, const char *args) {
   }
 
   vfs_stat_t st;
-  err = vfs_stat(resolved, &st);
+  err = ftp_stat_cache_stat(resolved, &st);
   if (err != FTP_OK) {
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
                                   "File not found.");
@@ -747,9 +589,8 @@ ftp_error_t cmd_MLST(ftp_session_t *session, const char *args) {
   }
 
   char listing_line[FTP_LIST_LINE_SIZE];
-  err = mlsx_format_line(&st, client_path, 1, listing_line,
-                         sizeof(listing_line));
-  if (err != FTP_OK) {
+  if (ftp_list_format(FTP_LIST_MLST, &st, client_path, listing_line,
+                      sizeof(listing_line)) == 0U) {
     return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
                                   "MLST formatting failed.");
   }
@@ -778,139 +619,658 @@ ftp_error_t cmd_MLST(ftp_session_t *session, const char *args) {
  * FILE TRANSFER
  *===========================================================================*/
 
-/**
- * @brief RETR command - Retrieve (download) file
+/*
+ * Upload durability (FTP_STOR_SYNC_POLICY)
+ *
+ *   Policy 2: each time another FTP_STOR_SYNC_INTERVAL_MB has been
+ *   written, that window is handed to writeback without waiting and the
+ *   window before it is waited on:
+ *
+ *     [ on disk ][ waited ][ writing back ][ dirty, still arriving ]
+ *
+ *   Dirty page cache stays at about two windows, so the final flush has
+ *   little left to do and a multi-GB upload ends without a long stall.
  */
-ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
-  if ((session == NULL) || (args == NULL)) {
-    return FTP_ERR_INVALID_PARAM;
+typedef struct {
+  int fd;
+  int policy;   /* FTP_STOR_SYNC_POLICY, from the fs profile */
+  off_t done;   /* end of the range already waited on   */
+  off_t issued; /* end of the range handed to writeback */
+} stor_sync_t;
+
+static void stor_sync_init(stor_sync_t *s, int fd, off_t start, int policy) {
+  s->fd = fd;
+  s->policy = policy;
+  s->done = start;
+  s->issued = start;
+}
+
+/* @p end: file offset the upload has written up to */
+static void stor_sync_note(stor_sync_t *s, off_t end) {
+  const off_t interval = (off_t)FTP_STOR_SYNC_INTERVAL_MB * 1024 * 1024;
+  if ((s == NULL) || (s->policy != 2) || ((end - s->issued) < interval)) {
+    return;
   }
+  if (s->issued > s->done) {
+    (void)pal_file_writeback(s->fd, s->done, s->issued - s->done, 1);
+    s->done = s->issued;
+  }
+  (void)pal_file_writeback(s->fd, s->issued, end - s->issued, 0);
+  s->issued = end;
+}
 
-  /* Resolve path */
-  char resolved[FTP_PATH_MAX];
-  ftp_error_t err = ftp_path_resolve(session, args, resolved, sizeof(resolved));
+/*
+ * Large uploads bypass the page cache (FTP_STOR_DIRECT_MIN_MB)
+ *
+ *   Once the upload has reached the threshold (at once when ALLO
+ *   announced that much) writes go through pal_io_write() and a pool
+ *   buffer stage.  Without a spare buffer, or where the filesystem
+ *   refuses O_DIRECT, they simply stay buffered.
+ */
+typedef struct {
+  pal_io_writer_t io;
+  void *stage;
+  uint64_t from; /* switch once this many bytes are written */
+  int state;     /* 0 = not yet, 1 = direct, -1 = never     */
+  ftp_segment_t *seg; /* O_DIRECT only while no other stream shares the fd */
+} stor_direct_t;
+
+static void stor_direct_init(stor_direct_t *d, uint64_t announced,
+                             ftp_segment_t *seg) {
+  const uint64_t min = (uint64_t)FTP_STOR_DIRECT_MIN_MB * 1024U * 1024U;
+  d->stage = NULL;
+  d->seg = seg;
+  d->state = (min != 0U) ? 0 : -1;
+  d->from = (announced >= min) ? 0U : min;
+}
 
-  if (err != FTP_OK) {
-    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
-                                  "Invalid path.");
+/* @p written: bytes of this upload already on their way to the file */
+static ssize_t stor_direct_write(stor_direct_t *d, int fd, const void *buf,
+                                 size_t len, uint64_t written) {
+  if ((d != NULL) && (d->state == 0) && (written >= d->from)) {
+    d->state = -1;
+    d->stage = (ftp_segment_direct_begin(d->seg) != 0) ? ftp_buffer_acquire()
+                                                       : NULL;
+    if (d->stage != NULL) {
+      if (pal_io_write_begin(&d->io, fd, d->stage, ftp_buffer_size()) ==
+          FTP_OK) {
+        char msg[80];
+        snprintf(msg, sizeof(msg), "[STOR] O_DIRECT after %llu bytes",
+                 (unsigned long long)written);
+        ftp_log_line(FTP_LOG_INFO, msg);
+        d->state = 1;
+      } else {
+        ftp_buffer_release(d->stage);
+        d->stage = NULL;
+      }
+    }
+    if (d->state != 1) {
+      ftp_segment_direct_end(d->seg);
+    }
   }
+  if ((d != NULL) && (d->state == 1)) {
+    return pal_io_write(&d->io, buf, len);
+  }
+  return pal_file_write_all(fd, buf, len);
+}
 
-  vfs_node_t node;
-  err = vfs_open(&node, resolved);
-  if (err != FTP_OK) {
-    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
-                                  "Cannot open file.");
+/* @return 0, or -1 (errno set) when the staged tail could not be written */
+static int stor_direct_end(stor_direct_t *d) {
+  int rc = 0;
+  if (d->state == 1) {
+    rc = (pal_io_write_end(&d->io) == FTP_OK) ? 0 : -1;
+    ftp_segment_direct_end(d->seg);
+  }
+  d->state = -1;
+  ftp_buffer_release(d->stage);
+  d->stage = NULL;
+  return rc;
+}
+
+/*
+ * Disk time that kept recv() from running: a blocking write, or a wait
+ * for a free writer-ring slot.  Short ones are normal and not recorded.
+ */
+static void stor_trace_lag(ftp_session_t *session, uint64_t since) {
+  uint64_t now = ftp_trace_now_ns();
+  if ((now - since) >= ((uint64_t)FTP_TRACE_LAG_MIN_US * 1000U)) {
+    ftp_trace_mark(&session->trace, FTP_TRACE_WRITER_LAG, since, 0U, 1U);
   }
-  uint64_t file_size = vfs_get_size(&node);
+}
 
-  vfs_stat_t st;
-  int have_stat = 0;
-  if (vfs_stat(resolved, &st) == FTP_OK) {
-    have_stat = 1;
+/* End-of-upload flush: fdatasync() skips metadata where it exists */
+static void stor_flush(int fd, int policy) {
+  if (policy == 0) {
+    return;
   }
-  if (have_stat != 0) {
-    uint32_t fmt = (uint32_t)(st.mode & (uint32_t)S_IFMT);
-    if (fmt != (uint32_t)S_IFREG) {
-      vfs_close(&node);
-      session->restart_offset = 0;
-      return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
-                                    "Not a regular file.");
+#if defined(__linux__)
+  (void)fdatasync(fd);
+#else
+  (void)fsync(fd);
+#endif
+}
+
+/*
+ * Drop a STOR stream's hold on its file (ftp_segment.h).  The last
+ * stream out flushes and closes the shared fd, then removes or renames
+ * the file as the table decided.  Returns -1 when that rename failed.
+ */
+static int stor_settle(ftp_segment_t *seg, int ok, off_t end,
+                       const char *resolved, int policy,
+                       ftp_segment_end_t *res) {
+  ftp_segment_stor_end(seg, ok, end, res);
+  if (res->fd >= 0) {
+    if (res->discard == 0) {
+      stor_flush(res->fd, policy);
     }
+    pal_file_close(res->fd);
   }
-
-  /* Handle REST (resume) offset */
-  off_t offset = session->restart_offset;
-  if ((offset < 0) || ((uint64_t)offset > file_size)) {
-    vfs_close(&node);
-    session->restart_offset = 0;
-    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
-                                  "Invalid offset.");
+  if (res->discard != 0) {
+    (void)unlink(seg->write_path);
   }
-  vfs_set_offset(&node, (uint64_t)offset);
+  if ((res->rename != 0) && (rename(seg->write_path, resolved) != 0)) {
+    (void)unlink(seg->write_path);
+    return -1;
+  }
+  return 0;
+}
 
-  /* Open data connection */
-  ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK, NULL);
+/* A STOR that opened its file but never received: give the hold back */
+static void stor_abandon(ftp_session_t *session, ftp_segment_t *seg,
+                         const char *resolved) {
+  ftp_segment_end_t res;
+  (void)stor_settle(seg, 0, -1, resolved, 0, &res);
+  session->restart_offset = 0;
+}
 
-  err = ftp_session_open_data_connection(session);
-  if (err != FTP_OK) {
-    vfs_close(&node);
-    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+/* 426 for a STOR that failed after 150 */
+static ftp_error_t stor_fail_reply(ftp_session_t *session, int fail_stage,
+                                   int saved_errno) {
+  char detail[128];
+  if (fail_stage == 2) {
+    snprintf(detail, sizeof(detail),
+             "Transfer failed: network receive error (errno=%d).", saved_errno);
+  } else if (fail_stage == 3) {
+    snprintf(detail, sizeof(detail),
+             "Transfer failed: disk write error (errno=%d).", saved_errno);
+  } else {
+    snprintf(detail, sizeof(detail), "Transfer failed.");
   }
+  return ftp_session_send_reply(session, FTP_REPLY_426_TRANSFER_ABORTED,
+                                detail);
+}
 
-  size_t remaining = (size_t)(file_size - (uint64_t)offset);
-  uint64_t bytes_sent = 0U;
+/* pwrite() all of [buf, buf+len) at @p off; 0 or -1 (errno set) */
+static int stor_pwrite_all(int fd, const void *buf, size_t len, off_t off) {
+  const uint8_t *p = (const uint8_t *)buf;
+  while (len > 0U) {
+    ssize_t w = pwrite(fd, p, len, off);
+    if (w < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (w == 0) {
+      errno = EIO;
+      return -1;
+    }
+    p += w;
+    len -= (size_t)w;
+    off += (off_t)w;
+  }
+  return 0;
+}
 
-  /*
-   * sendfile eligibility: kernel-to-kernel transfer
-   *
-   *   Disabled when encryption is active (XOR must happen in userspace)
-   *   or when rate limiting is on (sendfile can't be throttled).
-   */
-  int use_sendfile = ((vfs_get_caps(&node) & VFS_CAP_SENDFILE) != 0U) &&
-                     (FTP_TRANSFER_RATE_LIMIT_BPS == 0U);
+#if HAS_IO_URING || HAS_SPLICE
+/*
+ * Progress hook for the pal_uring_*() / pal_splice_*() engines.
+ *
+ *   The engines bypass ftp_session_send_data()/recv_data(), so session
+ *   activity and byte counters are kept current from here instead.
+ *   RETR also advances its cache policy (drop-behind, read-ahead).
+ */
+typedef struct {
+  ftp_session_t *session;
+  uint64_t last;  /* cumulative bytes already accounted   */
+  int rx;         /* 1 = STOR (bytes_received)            */
+  pal_io_reader_t *io; /* RETR cache policy, NULL for STOR */
+  off_t base;     /* file offset the engine started from  */
+  stor_sync_t *sync; /* STOR periodic writeback, or NULL    */
+} xfer_progress_t;
+
+static int xfer_progress_cb(uint64_t cumulative, void *user_data) {
+  xfer_progress_t *p = (xfer_progress_t *)user_data;
+  uint64_t delta = cumulative - p->last;
+
+  p->session->last_activity = time(NULL);
+  if (delta > 0U) {
+    ftp_session_note_first_byte(p->session);
+  }
+  if (p->rx != 0) {
+    atomic_fetch_add(&p->session->stats.bytes_received, delta);
+    stor_sync_note(p->sync, p->base + (off_t)cumulative);
+  } else {
+    atomic_fetch_add(&p->session->stats.bytes_sent, delta);
+  }
+  pal_io_read_advance(p->io, p->base + (off_t)cumulative);
+  p->last = cumulative;
+  return 0;
+}
 
-  /* DIAGNOSTIC: log transfer configuration so bottlenecks are visible in klog */
-  {
-    char diag[256];
-#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
-    struct statfs sfs;
-    const char *fstype = "unknown";
-    if (_fstatfs(node.fd, &sfs) == 0) { fstype = sfs.f_fstypename; }
-    snprintf(diag, sizeof(diag),
-      "[RETR] file=%s size=%llu fs=%s sendfile=%d "
-      "chunk=%u cooldown=%u eagain_sleep=%u sndbuf=%u",
-      resolved, (unsigned long long)file_size, fstype, use_sendfile,
-      (unsigned)FTP_RETR_SENDFILE_CHUNK,
-      (unsigned)(4U << 20),
-      (unsigned)FTP_SENDFILE_EAGAIN_SLEEP_US,
-      (unsigned)FTP_TCP_DATA_SNDBUF);
-#else
-    snprintf(diag, sizeof(diag),
-      "[RETR] file=%s size=%llu sendfile=%d chunk=%u",
-      resolved, (unsigned long long)file_size, use_sendfile,
-      (unsigned)FTP_RETR_SENDFILE_CHUNK);
-#endif
-    ftp_log_line(FTP_LOG_INFO, diag);
+/*
+ * Kernel-side engines move bytes without passing them through the
+ * userspace hooks in ftp_session_send_data()/recv_data(), so — like
+ * sendfile — crypto keeps the classic loops.  A bandwidth limit cannot
+ * be metered inside one engine call either; sendfile can (xfer_sendfile).
+ */
+static int xfer_kernel_path_ok(const ftp_session_t *session) {
+  if (ftp_bw_limited() != 0) {
+    return 0;
   }
 #if FTP_ENABLE_CRYPTO
   if (session->crypto.active != 0U) {
-    use_sendfile = 0;
+    return 0;
+  }
+#endif
+#if FTP_ENABLE_TLS
+  if (session->prot_private != 0U) {
+    return 0;
   }
 #endif
+  if (session->transfer_mode != FTP_MODE_STREAM) {
+    return 0; /* MODE Z: bytes go through ftp_zstream */
+  }
+  return 1;
+}
+#endif /* HAS_IO_URING || HAS_SPLICE */
 
-  /*=========================================================================*
-   *  Transfer loop: sendfile with read() cooldown retry
-   *
-   *  PS4/PS5 exFAT driver stalls sendfile() after ~28 MB of continuous
-   *  kernel-to-kernel transfer (page cache pressure). Instead of falling
-   *  back to slow read() permanently, we alternate:
-   *
-   *     sendfile burst (kernel speed, ~28 MB)
-   *       -> stall detected
-   *       -> read() cooldown (1 MB, releases page pressure)
-   *       -> retry sendfile (if it works, another 28 MB burst)
-   *       -> repeat until file complete
-   *
-   *  If sendfile fails immediately on retry (0 bytes), the driver truly
-   *  cannot recover and we finish the rest via read().
-   *
-   *    ┌──────────┐    stall    ┌──────────────┐   1 MB done  ┌──────────┐
-   *    │ sendfile  │──────────►│ read cooldown │────────────►│ sendfile  │
-   *    │  burst    │           │   (1 MB)      │             │  retry    │
-   *    └─────┬────┘           └──────────────┘             └─────┬────┘
-   *     done │                                          0 bytes │ ok
-   *          ▼                                                  ▼
-   *        [226]                                    ┌───────────────┐
-   *                                                 │ read() finish │
+#if HAS_IO_URING
+static int xfer_uring_eligible(const ftp_session_t *session) {
+  return ((xfer_kernel_path_ok(session) != 0) && (pal_uring_available() != 0))
+             ? 1
+             : 0;
+}
+#endif
+
+#if HAS_SPLICE
+/*
+ * Run the splice receive path on an open upload fd.
+ *
+ *   Returns 1 when the transfer is finished (successfully or not; *ok and
+ *   friends say which), 0 when the caller must continue with its buffered
+ *   loop.  In the latter case *prefix bytes are already on disk and the fd
+ *   position has been moved past them.
+ */
+static int stor_try_splice(ftp_session_t *session, int fd, void *bounce,
+                           size_t bounce_sz, stor_sync_t *sync,
+                           uint64_t *prefix, int *ok, int *fail_stage,
+                           int *saved_errno) {
+  *prefix = 0U;
+  if ((bounce == NULL) || (xfer_kernel_path_ok(session) == 0)) {
+    return 0;
+  }
+
+  /* splice(2) refuses O_APPEND targets: write at EOF explicitly instead */
+  int fl = fcntl(fd, F_GETFL);
+  off_t soff;
+  if ((fl >= 0) && ((fl & O_APPEND) != 0)) {
+    soff = lseek(fd, 0, SEEK_END);
+    if ((soff < 0) || (fcntl(fd, F_SETFL, fl & ~O_APPEND) != 0)) {
+      return 0;
+    }
+  } else {
+    soff = lseek(fd, 0, SEEK_CUR);
+  }
+  if (soff < 0) {
+    return 0;
+  }
+
+  xfer_progress_t prog = {session, 0U, 1, NULL, soff, sync};
+  ftp_error_t serr = pal_splice_socket_to_file(session->data_fd, fd, &soff,
+                                               bounce, bounce_sz,
+                                               xfer_progress_cb, &prog, prefix);
+  if ((fl >= 0) && ((fl & O_APPEND) != 0)) {
+    (void)fcntl(fd, F_SETFL, fl);
+  }
+
+  if (serr == FTP_ERR_NOT_SUPPORTED) {
+    if (lseek(fd, soff, SEEK_SET) >= 0) {
+      return 0;
+    }
+    serr = FTP_ERR_FILE_WRITE;
+  }
+  if (serr != FTP_OK) {
+    *saved_errno = errno;
+    *fail_stage = (serr == FTP_ERR_FILE_WRITE) ? 3 : 2;
+    *ok = 0;
+  }
+  return 1;
+}
+#endif
+
+/*
+ * sendfile() sized by the bandwidth scheduler: the grant caps this
+ * call's chunk and the part the socket did not take is handed back, so
+ * a limited RETR keeps the zero-copy path instead of pausing.
+ */
+static ssize_t xfer_sendfile(ftp_session_t *session, int fd, off_t *offset,
+                             size_t len) {
+  size_t grant = ftp_bw_grant(&session->bw, len);
+  ssize_t sent = pal_sendfile(session->data_fd, fd, offset, grant);
+  ftp_bw_refund(&session->bw, grant, (sent > 0) ? (size_t)sent : 0U);
+  if (sent > 0) {
+    ftp_session_note_first_byte(session);
+  }
+  return sent;
+}
+
+#if (FTP_STOR_RING_MAX_DEPTH >= 2) || (FTP_RETR_PREFETCH_DEPTH >= 2)
+/* Ring slots are pool buffers */
+static void *xfer_ring_alloc(void *ctx) {
+  (void)ctx;
+  return ftp_buffer_acquire();
+}
+
+static void xfer_ring_release(void *buf, void *ctx) {
+  (void)ctx;
+  ftp_buffer_release(buf);
+}
+#endif
+
+#if FTP_RETR_PREFETCH_DEPTH >= 2
+/*===========================================================================*
+ *  READ-AHEAD RING — the STOR writer pipeline, reversed
+ *
+ *   ┌────────────┐  commit   ┌───────────────────┐  peek   ┌────────────┐
+ *   │ Reader thr │ ────────► │ pal_ring (K bufs) │ ──────► │ FTP thread │
+ *   │ vfs_read() │ ◄──────── │                   │ ◄────── │  send()    │
+ *   └────────────┘  acquire  └───────────────────┘ consume └────────────┘
+ *
+ *  For the read() paths of cmd_RETR: while one buffer is on the wire the
+ *  next ones are already being read.  A failed send (client gone, ABOR
+ *  closing the data connection, SO_SNDTIMEO) aborts the ring; the reader
+ *  stops at its next acquire and is joined before RETR replies.
+ *===========================================================================*/
+typedef struct {
+  pal_ring_t ring;
+  vfs_node_t *node;
+  size_t limit; /* bytes to read from the current offset */
+} retr_reader_t;
+
+static void *retr_reader_thread(void *arg) {
+  retr_reader_t *r = (retr_reader_t *)arg;
+  size_t left = r->limit;
+
+  while (left > 0U) {
+    void *buf = pal_ring_acquire(&r->ring);
+    if (buf == NULL) {
+      break; /* sender gave up */
+    }
+    size_t want = (left < r->ring.cfg.slot_size) ? left : r->ring.cfg.slot_size;
+    ssize_t n = vfs_read(r->node, buf, want);
+    if ((n < 0) && (errno == EINTR)) {
+      pal_ring_unacquire(&r->ring, buf);
+      continue;
+    }
+    if (n <= 0) {
+      pal_ring_unacquire(&r->ring, buf);
+      if (n < 0) {
+        pal_ring_abort(&r->ring, (errno != 0) ? errno : EIO);
+      }
+      break; /* n == 0: file shrank, the sender sees a short stream */
+    }
+    left -= (size_t)n;
+    pal_ring_commit(&r->ring, buf, (size_t)n);
+  }
+  pal_ring_close(&r->ring);
+  return NULL;
+}
+
+/*
+ * Send @p limit bytes of @p node from offset @p start (where the node
+ * stands), reading ahead on a second thread.
+ *
+ *   Returns 1 when the ring ran (*sent says how far it got), 0 when it
+ *   could not be set up; the caller then runs its lockstep loop with
+ *   *spare (released here, reacquired on fallback).  The pool may be
+ *   empty by then: *spare can come back NULL, and the caller must fail
+ *   the transfer rather than read into it.
+ */
+static int retr_prefetch_send(ftp_session_t *session, vfs_node_t *node,
+                              off_t start, size_t limit, void **spare,
+                              ftp_xfer_tune_t *tune, pal_io_reader_t *io,
+                              uint64_t *sent) {
+  pal_ring_config_t cfg;
+  cfg.initial_depth = FTP_RETR_PREFETCH_DEPTH;
+  cfg.max_depth = FTP_RETR_PREFETCH_DEPTH; /* a waiting reader is fine */
+  cfg.grow_after = 1U;
+  cfg.slot_size = ftp_buffer_size();
+  cfg.alloc = xfer_ring_alloc;
+  cfg.release = xfer_ring_release;
+  cfg.ctx = NULL;
+
+  retr_reader_t r;
+  r.node = node;
+  r.limit = limit;
+
+  ftp_buffer_release(*spare);
+  *spare = NULL;
+  if (pal_ring_init(&r.ring, &cfg) != 0) {
+    *spare = ftp_buffer_acquire();
+    return 0;
+  }
+  pthread_t reader;
+  if (pal_thread_create(&reader, NULL, PAL_THREAD_DATA, retr_reader_thread,
+                        &r) != 0) {
+    pal_ring_destroy(&r.ring);
+    *spare = ftp_buffer_acquire();
+    return 0;
+  }
+
+  uint64_t done = 0U;
+  pal_socket_cork(session->data_fd);
+  for (;;) {
+    size_t n = 0U;
+    void *buf = pal_ring_peek(&r.ring, &n);
+    if (buf == NULL) {
+      break; /* all read, or the reader failed */
+    }
+    ssize_t out = ftp_session_send_data(session, buf, n);
+    pal_ring_consume(&r.ring, buf);
+    if (out != (ssize_t)n) {
+      pal_ring_abort(&r.ring, (errno != 0) ? errno : EPIPE);
+      break;
+    }
+    done += (uint64_t)n;
+    ftp_xfer_tune_on_cooldown(tune, n);
+    ftp_trace_span(&session->trace, FTP_TRACE_COOLDOWN, (uint64_t)n);
+    session->last_activity = time(NULL);
+    pal_io_read_advance(io, start + (off_t)done);
+  }
+  pal_socket_uncork(session->data_fd);
+
+  (void)pthread_join(reader, NULL);
+  pal_ring_destroy(&r.ring);
+  *sent = done;
+  return 1;
+}
+#endif /* FTP_RETR_PREFETCH_DEPTH >= 2 */
+
+/**
+ * @brief RETR command - Retrieve (download) file
+ */
+ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
+  if ((session == NULL) || (args == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  /* Resolve path */
+  char resolved[FTP_PATH_MAX];
+  ftp_error_t err = ftp_path_resolve(session, args, resolved, sizeof(resolved));
+
+  if (err != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Invalid path.");
+  }
+
+  vfs_node_t node;
+  err = vfs_open(&node, resolved);
+  if (err != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Cannot open file.");
+  }
+  ftp_trace_begin(&session->trace, "RETR", resolved, session->session_id,
+                  session->cmd_start_ns);
+  ftp_prefetch_retr(session, resolved); /* warm the files that follow */
+  uint64_t file_size = vfs_get_size(&node);
+
+  vfs_stat_t st;
+  int have_stat = 0;
+  if (ftp_stat_cache_stat(resolved, &st) == FTP_OK) {
+    have_stat = 1;
+  }
+  if (have_stat != 0) {
+    uint32_t fmt = (uint32_t)(st.mode & (uint32_t)S_IFMT);
+    if (fmt != (uint32_t)S_IFREG) {
+      vfs_close(&node);
+      session->restart_offset = 0;
+      return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                    "Not a regular file.");
+    }
+  }
+
+  /* Handle REST (resume) offset */
+  off_t offset = session->restart_offset;
+  if ((offset < 0) || ((uint64_t)offset > file_size)) {
+    vfs_close(&node);
+    session->restart_offset = 0;
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Invalid offset.");
+  }
+  vfs_set_offset(&node, (uint64_t)offset);
+
+  /* Open data connection */
+  ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK, NULL);
+
+  err = ftp_session_open_data_connection(session);
+  if (err == FTP_OK) {
+    err = xfer_start_data_tls(session);
+  }
+  if (err != FTP_OK) {
+    vfs_close(&node);
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
+
+  size_t remaining = (size_t)(file_size - (uint64_t)offset);
+  uint64_t bytes_sent = 0U;
+
+  /* Counted with the other streams of a segmented download (pget) */
+  ftp_segment_t seg;
+  ftp_segment_retr_begin(session, resolved, file_size, &seg);
+
+  /*
+   * sendfile eligibility: kernel-to-kernel transfer
+   *
+   *   Disabled when encryption is active (XOR must happen in userspace).
+   *   Bandwidth limits size each call instead (xfer_sendfile).
+   */
+  int use_sendfile = ((vfs_get_caps(&node) & VFS_CAP_SENDFILE) != 0U);
+
+  /*
+   * Per-transfer sendfile controller: chunk, cooldown and EAGAIN backoff
+   * start from what worked last time on this filesystem type, else from
+   * its profile.
+   */
+  ftp_xfer_tune_t tune;
+  {
+    char fstype[FTP_XFER_TUNE_FSNAME_MAX];
+    ftp_fs_profile_t prof;
+    ftp_xfer_tune_fstype(node.fd, fstype, sizeof(fstype));
+    ftp_fs_profile_lookup(fstype, &prof);
+    ftp_xfer_tune_begin(&tune, fstype);
+    ftp_xfer_tune_default_chunk(&tune, prof.sendfile_chunk);
+    if (prof.sendfile == 0U) {
+      use_sendfile = 0;
+    }
+  }
+
+  /*
+   * Cache policy: a large file streams (read-ahead window, sent pages
+   * dropped) so it does not evict the hot small files; small ones and
+   * those already mostly cached keep their pages.
+   */
+  pal_io_reader_t io;
+  pal_io_policy_t io_policy = pal_io_read_begin(
+      &io, node.fd, offset, (uint64_t)remaining,
+      (uint64_t)FTP_IO_STREAM_MIN_MB * 1024U * 1024U,
+      (off_t)FTP_IO_READAHEAD_MB * 1024 * 1024);
+
+  /* DIAGNOSTIC: log transfer configuration so bottlenecks are visible in klog */
+  {
+    char diag[256];
+    snprintf(diag, sizeof(diag),
+      "[RETR] file=%s size=%llu fs=%s sendfile=%d "
+      "chunk=%u cooldown=%u eagain_sleep=%u sndbuf=%u tuned=%d cache=%s",
+      resolved, (unsigned long long)file_size, tune.fstype, use_sendfile,
+      (unsigned)tune.chunk,
+      (unsigned)tune.cooldown,
+      (unsigned)tune.eagain_sleep_us,
+      (unsigned)FTP_TCP_DATA_SNDBUF, tune.seeded,
+      (io_policy == PAL_IO_STREAM) ? "stream" : "cached");
+    ftp_log_line(FTP_LOG_INFO, diag);
+  }
+#if FTP_ENABLE_CRYPTO
+  if (session->crypto.active != 0U) {
+    use_sendfile = 0;
+  }
+#endif
+  /* MODE Z: the deflate stream lives in userspace */
+  if (session->transfer_mode != FTP_MODE_STREAM) {
+    use_sendfile = 0;
+  }
+#if FTP_ENABLE_TLS
+  /*
+   * PROT P: sendfile() on the raw fd is only valid when the kernel frames
+   * the records (kTLS TX).  Otherwise bytes must pass through
+   * pal_tls_send() in ftp_session_send_data().
+   */
+  if ((session->data_tls != NULL) &&
+      (pal_tls_ktls_send(session->data_tls) == 0)) {
+    use_sendfile = 0;
+  }
+#endif
+
+  /*=========================================================================*
+   *  Transfer loop: sendfile with read() cooldown retry
+   *
+   *  PS4/PS5 exFAT driver stalls sendfile() after ~28 MB of continuous
+   *  kernel-to-kernel transfer (page cache pressure). Instead of falling
+   *  back to slow read() permanently, we alternate:
+   *
+   *     sendfile burst (kernel speed, ~28 MB)
+   *       -> stall detected
+   *       -> read() cooldown (tune.cooldown, releases page pressure)
+   *       -> retry sendfile (if it works, another 28 MB burst)
+   *       -> repeat until file complete
+   *
+   *  If sendfile fails immediately on retry (0 bytes), the driver truly
+   *  cannot recover and we finish the rest via read().
+   *
+   *    ┌──────────┐    stall    ┌──────────────┐   1 MB done  ┌──────────┐
+   *    │ sendfile  │──────────►│ read cooldown │────────────►│ sendfile  │
+   *    │  burst    │           │   (1 MB)      │             │  retry    │
+   *    └─────┬────┘           └──────────────┘             └─────┬────┘
+   *     done │                                          0 bytes │ ok
+   *          ▼                                                  ▼
+   *        [226]                                    ┌───────────────┐
+   *                                                 │ read() finish │
    *                                                 └───────┬──────┘
    *                                                    done │
    *                                                         ▼
    *                                                       [226]
    *=========================================================================*/
 
-/* Cooldown: bytes of read() between sendfile retries */
-#define SENDFILE_COOLDOWN_BYTES (4U << 20) /* 4 MB — allineato a PAL_FILE_COPY_BUFFER_SIZE PS5; meno rientri nel path lento */
-
   void *buf = NULL;
   size_t buf_sz = 0U;
 
@@ -923,10 +1283,10 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
 
       while (remaining > 0U) {
         ssize_t sent =
-            pal_sendfile(session->data_fd, node.fd, &offset,
-                         (remaining > (size_t)FTP_RETR_SENDFILE_CHUNK)
-                             ? (size_t)FTP_RETR_SENDFILE_CHUNK
-                             : remaining);
+            xfer_sendfile(session, node.fd, &offset,
+                          (remaining > (size_t)tune.chunk)
+                              ? (size_t)tune.chunk
+                              : remaining);
 
         if (sent <= 0) {
           if ((sent < 0) && (errno == EINTR)) {
@@ -967,45 +1327,45 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
            * (B) Platform driver stall (PS5 exFAT / sendfile internal
            *     limit).  Retries do not recover; fall to read() cooldown.
            *
-           * Disambiguation strategy: retry up to FTP_SENDFILE_EAGAIN_RETRIES
-           * times, each time sleeping FTP_SENDFILE_EAGAIN_SLEEP_US µs.  If
-           * any retry sends bytes → (A), continue burst.  If all retries
-           * return 0 → (B), fall to cooldown.
+           * Disambiguation strategy: retry up to tune.eagain_retries times,
+           * each time sleeping tune.eagain_sleep_us µs.  If any retry sends
+           * bytes → (A), continue burst.  If all retries return 0 → (B),
+           * fall to cooldown.
            *
-           * With FTP_SENDFILE_EAGAIN_RETRIES = 256 and 1 ms sleep, we wait
-           * up to 256 ms before declaring a stall — enough to cover any
-           * realistic internet RTT and allow TCP ACKs to return.
+           * The controller trades sleep length against retry count, so the
+           * total wait before declaring a stall stays at
+           * FTP_SENDFILE_EAGAIN_RETRIES × FTP_SENDFILE_EAGAIN_SLEEP_US —
+           * enough to cover any realistic internet RTT.
            */
+          ftp_xfer_tune_on_eagain(&tune);
           int recovered = 0;
-          for (int r = 0; r < FTP_SENDFILE_EAGAIN_RETRIES; r++) {
-            usleep(FTP_SENDFILE_EAGAIN_SLEEP_US);
+          for (int r = 0; r < (int)tune.eagain_retries; r++) {
+            usleep(tune.eagain_sleep_us);
             ssize_t r_sent =
-                pal_sendfile(session->data_fd, node.fd, &offset,
-                             (remaining > (size_t)FTP_RETR_SENDFILE_CHUNK)
-                                 ? (size_t)FTP_RETR_SENDFILE_CHUNK
-                                 : remaining);
+                xfer_sendfile(session, node.fd, &offset,
+                              (remaining > (size_t)tune.chunk)
+                                  ? (size_t)tune.chunk
+                                  : remaining);
             if (r_sent > 0) {
               /* TCP backpressure cleared — count as sent and continue */
+              ftp_xfer_tune_on_recovered(&tune, (uint32_t)(r + 1));
+              ftp_xfer_tune_on_sent(&tune, (size_t)r_sent);
               sf_sent_any = 1;
               remaining -= (size_t)r_sent;
               bytes_sent += (uint64_t)r_sent;
               session->last_activity = time(NULL);
               atomic_fetch_add(&session->stats.bytes_sent, (uint64_t)r_sent);
-#if defined(POSIX_FADV_DONTNEED) && !defined(PLATFORM_PS4) && !defined(PS4)
-              if (node.fd >= 0) {
-                off_t evict_start = offset - (off_t)r_sent;
-                if (evict_start >= 0) {
-                  (void)posix_fadvise(node.fd, evict_start,
-                                      (off_t)r_sent, POSIX_FADV_DONTNEED);
-                }
-              }
-#endif
+              ftp_trace_span(&session->trace, FTP_TRACE_SENDFILE,
+                             (uint64_t)r_sent);
+              pal_io_read_advance(&io, offset);
               recovered = 1;
               break;
             }
             if ((r_sent < 0) && (errno == EINTR)) {
               r--; /* don't count EINTR as a retry */
+              continue;
             }
+            ftp_xfer_tune_on_eagain(&tune);
           }
 
           if (recovered != 0) {
@@ -1013,6 +1373,8 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
           }
 
           /* True driver stall (all retries failed) */
+          ftp_xfer_tune_on_stall(&tune);
+          ftp_trace_span(&session->trace, FTP_TRACE_STALL, 0U);
           vfs_set_offset(&node, (uint64_t)offset);
           if (sf_sent_any == 0) {
             use_sendfile = 0;
@@ -1020,44 +1382,24 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
           break;
         }
 
+        ftp_xfer_tune_on_sent(&tune, (size_t)sent);
         sf_sent_any = 1;
         remaining -= (size_t)sent;
         bytes_sent += (uint64_t)sent;
         session->last_activity = time(NULL);
         atomic_fetch_add(&session->stats.bytes_sent, (uint64_t)sent);
+        ftp_trace_span(&session->trace, FTP_TRACE_SENDFILE, (uint64_t)sent);
 
         /*
-         * Evict pages we have already sent from the kernel page cache.
-         *
-         *   Without this hint, the kernel caches every page of the source
-         *   file as it is DMA'd to the socket buffer.  For large transfers
-         *   (12–60 GB) the page cache fills all available RAM; the kernel
-         *   then spends increasing time on page reclaim, causing the
-         *   observed monotonic throughput drop from 260 Mbps toward 0.
+         * Drop the pages just sent and keep the read-ahead window full.
          *
-         *   POSIX_FADV_DONTNEED marks the just-sent pages as eligible for
-         *   immediate eviction (they remain accessible but are freed under
-         *   memory pressure before any other pages), keeping cache pressure
-         *   flat regardless of file size.
-         *
-         *   Safe on Linux AND FreeBSD/PS5: posix_fadvise(DONTNEED) on a
-         *   read-only fd simply marks pages as low-priority — it does not
-         *   write data or invalidate valid mappings.  The previous guard
-         *   "#if defined(__linux__)" was an oversight; PS5 also supports
-         *   posix_fadvise(2) and benefits from the same eviction hint.
-         *   (The sendfile-internal mapping concern in pal_fileio.c is about
-         *   F_NOCACHE on the same fd being passed to sendfile(), which is
-         *   a different code path — it does not apply here.)
+         *   Without this a 12–60 GB transfer fills all RAM with pages that
+         *   are never read again; reclaim then eats into throughput (the
+         *   observed drop from 260 Mbps toward 0) and the hot small files
+         *   are evicted with them.  pal_io_read_begin() chose whether this
+         *   file streams; for a cached one this is a no-op.
          */
-#if defined(POSIX_FADV_DONTNEED) && !defined(PLATFORM_PS4) && !defined(PS4)
-        if (node.fd >= 0) {
-          off_t evict_start = offset - (off_t)sent;
-          if (evict_start >= 0) {
-            (void)posix_fadvise(node.fd, evict_start,
-                                (off_t)sent, POSIX_FADV_DONTNEED);
-          }
-        }
-#endif
+        pal_io_read_advance(&io, offset);
       }
       pal_socket_uncork(session->data_fd);
 
@@ -1079,20 +1421,65 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
     }
 
     /*
-     * If sendfile is still eligible, run cooldown for SENDFILE_COOLDOWN_BYTES
+     * If sendfile is still eligible, run cooldown for tune.cooldown bytes
      * then break back to the outer loop to retry sendfile.
      * If sendfile is permanently disabled, run until transfer complete.
      */
     int can_retry_sf = ((vfs_get_caps(&node) & VFS_CAP_SENDFILE) != 0U) &&
                        (use_sendfile != 0) &&
                        (bytes_sent > 0U) &&
-                       (remaining > SENDFILE_COOLDOWN_BYTES);
+                       (remaining > (size_t)tune.cooldown);
 
-    size_t cooldown_left = can_retry_sf ? SENDFILE_COOLDOWN_BYTES : remaining;
+    size_t cooldown_left = can_retry_sf ? (size_t)tune.cooldown : remaining;
     int read_error = 0;
 
+#if HAS_IO_URING
+    /*
+     * Finishing with read(): sendfile is out for the rest of this file,
+     * so let io_uring overlap disk reads with socket sends in one thread.
+     * FTP_ERR_NOT_SUPPORTED means nothing moved; use the loop below.
+     */
+    if ((can_retry_sf == 0) && (node.fd >= 0) &&
+        ((vfs_get_caps(&node) & VFS_CAP_STREAM_ONLY) == 0U) &&
+        (xfer_uring_eligible(session) != 0)) {
+      off_t uoff = (off_t)(file_size - (uint64_t)remaining);
+      xfer_progress_t prog = {session, 0U, 0, &io, uoff, NULL};
+      uint64_t moved = 0U;
+      ftp_error_t uerr = pal_uring_file_to_socket(
+          session->data_fd, node.fd, &uoff, (uint64_t)remaining, buf, buf_sz,
+          xfer_progress_cb, &prog, &moved);
+      if (uerr != FTP_ERR_NOT_SUPPORTED) {
+        bytes_sent += moved;
+        remaining -= (size_t)moved;
+        break; /* remaining != 0 → 426 below */
+      }
+    }
+#endif
+
+#if FTP_RETR_PREFETCH_DEPTH >= 2
+    /*
+     * Reader thread ahead of the sender; worth a thread only for a few
+     * buffers' worth.  Falls back to the loop below if it cannot start.
+     */
+    if (cooldown_left >= (2U * buf_sz)) {
+      uint64_t moved = 0U;
+      off_t at = (off_t)(file_size - (uint64_t)remaining);
+      if (retr_prefetch_send(session, &node, at, cooldown_left, &buf, &tune,
+                             &io, &moved) != 0) {
+        bytes_sent += moved;
+        remaining -= (size_t)moved;
+        cooldown_left -= (size_t)moved;
+        if (cooldown_left > 0U) {
+          read_error = 1; /* ran short: 426 below */
+        }
+      } else if (buf == NULL) {
+        read_error = 1; /* spare not given back by the pool: 426 below */
+      }
+    }
+#endif
+
     pal_socket_cork(session->data_fd);
-    while ((remaining > 0U) && (cooldown_left > 0U)) {
+    while ((read_error == 0) && (remaining > 0U) && (cooldown_left > 0U)) {
       size_t want = (remaining < buf_sz) ? remaining : buf_sz;
       if (want > cooldown_left) {
         want = cooldown_left;
@@ -1106,7 +1493,8 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
         break;
       }
 
-      ssize_t sent = ftp_session_send_data(session, buf, (size_t)n);
+      /* buf may be handed to the kernel and replaced (MSG_ZEROCOPY) */
+      ssize_t sent = ftp_session_send_buffer(session, &buf, buf_sz, (size_t)n);
       if (sent != n) {
         remaining = 1U;
         read_error = 1;
@@ -1116,19 +1504,12 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
       bytes_sent += (uint64_t)sent;
       remaining -= (size_t)n;
       cooldown_left -= (size_t)n;
+      ftp_xfer_tune_on_cooldown(&tune, (size_t)n);
+      ftp_trace_span(&session->trace, FTP_TRACE_COOLDOWN, (uint64_t)n);
       session->last_activity = time(NULL);
 
-      /* Evict pages already sent; same rationale as the sendfile path. */
-#if defined(POSIX_FADV_DONTNEED) && !defined(PLATFORM_PS4) && !defined(PS4)
-      if (node.fd >= 0) {
-        off_t sent_end = (off_t)(file_size - (uint64_t)remaining);
-        off_t evict_start = sent_end - (off_t)sent;
-        if (evict_start >= 0) {
-          (void)posix_fadvise(node.fd, evict_start,
-                              (off_t)sent, POSIX_FADV_DONTNEED);
-        }
-      }
-#endif
+      /* Same cache policy as the sendfile path */
+      pal_io_read_advance(&io, (off_t)(file_size - (uint64_t)remaining));
     }
     pal_socket_uncork(session->data_fd);
 
@@ -1146,10 +1527,14 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
   }
 
   ftp_buffer_release(buf);
-#undef SENDFILE_COOLDOWN_BYTES
+  /* A throttled transfer measures the limit, not the filesystem */
+  ftp_xfer_tune_end(&tune,
+                    ((remaining == 0U) && (ftp_bw_limited() == 0)) ? 1 : 0);
 
   /* Cleanup */
   vfs_close(&node);
+  ftp_segment_retr_end(&seg);
+  ftp_trace_end(&session->trace, (remaining == 0U) ? 1 : 0, bytes_sent);
   ftp_session_close_data_connection(session);
   session->restart_offset = 0;
 
@@ -1165,9 +1550,12 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
          Instead log raw bytes; the surrounding timestamps in klog give elapsed. */
       char tput[128];
       snprintf(tput, sizeof(tput),
-               "[RETR] complete: bytes=%llu (%.1f MB)",
+               "[RETR] complete: bytes=%llu (%.1f MB) chunk=%u "
+               "cooldown=%u eagain_sleep=%u stalls=%u",
                (unsigned long long)bytes_sent,
-               (double)bytes_sent / (1024.0 * 1024.0));
+               (double)bytes_sent / (1024.0 * 1024.0),
+               (unsigned)tune.chunk, (unsigned)tune.cooldown,
+               (unsigned)tune.eagain_sleep_us, (unsigned)tune.stalls);
       ftp_log_line(FTP_LOG_INFO, tput);
     }
     return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE,
@@ -1180,104 +1568,305 @@ ftp_error_t cmd_RETR(ftp_session_t *session, const char *args) {
 }
 
 /*===========================================================================*
- *  DOUBLE-BUFFERED WRITER — overlaps recv() and write()
+ *  RING-BUFFERED WRITER — overlaps recv() and write()
  *
- *   ┌────────────┐  mutex+cond  ┌────────────┐
- *   │ FTP thread │ ──► swap ──► │ Writer thr │
- *   │  recv()    │              │  write()   │
- *   │  buf[0]    │              │  buf[1]    │
- *   └────────────┘              └────────────┘
+ *   ┌────────────┐  commit   ┌───────────────────┐  peek   ┌────────────┐
+ *   │ FTP thread │ ────────► │ pal_ring (K bufs) │ ──────► │ Writer thr │
+ *   │  recv()    │ ◄──────── │  K = 2 .. max     │ ◄────── │  write()   │
+ *   └────────────┘  acquire  └───────────────────┘ consume └────────────┘
  *
- *  The FTP thread fills the active buffer via recv(), then swaps
- *  buffers with the writer thread which drains the filled buffer
- *  to disk.  This overlaps network I/O with PFS crypto writes.
+ *  The FTP thread fills free buffers via recv() and commits them; the
+ *  writer thread drains them to disk in order.  A single PFS stall no
+ *  longer blocks recv() after one buffer: the producer keeps filling the
+ *  remaining slots, and if the writer lags on several consecutive
+ *  acquires the ring grows by one pool buffer (up to
+ *  FTP_STOR_RING_MAX_DEPTH), so the TCP window stays open.
  *===========================================================================*/
 
+#if FTP_STOR_RING_MAX_DEPTH >= 2
 typedef struct {
-  void *buf[2];     /* two buffers (from pool or malloc)     */
-  size_t len[2];    /* bytes stored in each buffer           */
-  int active;       /* index currently being filled by recv  */
+  pal_ring_t ring;
   int fd;           /* destination file descriptor           */
   int error;        /* writer error errno (0 = ok)           */
-  int done;         /* set by recv thread on EOF/error       */
   uint64_t written; /* total bytes flushed to disk           */
-  pthread_mutex_t mtx;
-  pthread_cond_t cv_ready; /* writer waits: "data ready to write" */
-  pthread_cond_t cv_free;  /* recv waits:  "buffer free to fill"  */
-} stor_pipe_t;
+  off_t base;       /* file offset of the first ring byte    */
+  stor_sync_t *sync;
+  stor_direct_t *direct;
+} stor_writer_t;
 
 static void *stor_writer_thread(void *arg) {
-  stor_pipe_t *p = (stor_pipe_t *)arg;
+  stor_writer_t *w = (stor_writer_t *)arg;
 
-  pthread_mutex_lock(&p->mtx);
   for (;;) {
-    /* Wait for data or done signal */
-    while ((p->len[1 - p->active] == 0U) && (p->done == 0)) {
-      pthread_cond_wait(&p->cv_ready, &p->mtx);
-    }
-
-    int drain = 1 - p->active;
-    size_t nbytes = p->len[drain];
-
-    if ((nbytes == 0U) && (p->done != 0)) {
-      break; /* recv finished, nothing left to write */
-    }
-
-    /* Unlock while writing (slow PFS crypto path) */
-    pthread_mutex_unlock(&p->mtx);
-
-    ssize_t w = pal_file_write_all(p->fd, p->buf[drain], nbytes);
-    int write_ok = (w == (ssize_t)nbytes) ? 1 : 0;
-
-    pthread_mutex_lock(&p->mtx);
-    if (write_ok != 0) {
-      p->written += (uint64_t)nbytes;
-    } else {
-      p->error = errno;
+    size_t nbytes = 0U;
+    void *buf = pal_ring_peek(&w->ring, &nbytes);
+    if (buf == NULL) {
+      break; /* EOF (ring closed and drained) or aborted */
     }
-    p->len[drain] = 0U;
-
-    /* Signal recv thread that buffer is free */
-    pthread_cond_signal(&p->cv_free);
 
-    if (write_ok == 0) {
-      break; /* write error */
+    ssize_t wr = stor_direct_write(w->direct, w->fd, buf, nbytes, w->written);
+    if (wr != (ssize_t)nbytes) {
+      w->error = (errno != 0) ? errno : EIO;
+      pal_ring_abort(&w->ring, w->error);
+      break;
     }
+    w->written += (uint64_t)nbytes;
+    pal_ring_consume(&w->ring, buf);
+    stor_sync_note(w->sync, w->base + (off_t)w->written);
   }
-  pthread_mutex_unlock(&p->mtx);
   return NULL;
 }
 
-/**
- * @brief STOR command - Store (upload) file
- *
- *  REST + STOR resume workflow
- *  ~~~~~~~~~~~~~~~~~~~~~~~~~~~
- *  Client:  REST 52428800        <- set offset = 50 MB
- *  Server:  350 Restart accepted
- *  Client:  STOR bigfile.pkg     <- resumes here
- *  Server:  opens file WITHOUT O_TRUNC, lseek(offset)
- *           receives remaining bytes and writes from offset
+/*
+ * Receive into the writer ring until EOF.
  *
- *  If restart_offset == 0 the file is truncated as usual.
+ *   Returns 1 when the transfer ran through the ring, 0 when the ring or
+ *   writer thread could not be set up; the caller then uses the
+ *   single-buffer loop with *spare (released here, reacquired on fallback).
  */
-ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
-  if ((session == NULL) || (args == NULL)) {
-    return FTP_ERR_INVALID_PARAM;
+static int stor_ring_receive(ftp_session_t *session, int fd, void **spare,
+                             unsigned depth, ftp_hash_ctx_t *hash,
+                             stor_sync_t *sync, stor_direct_t *direct,
+                             uint64_t *total_received, int *ok,
+                             int *fail_stage, int *saved_errno) {
+  pal_ring_config_t cfg;
+  cfg.initial_depth = depth;
+  cfg.max_depth = FTP_STOR_RING_MAX_DEPTH;
+  cfg.grow_after = FTP_STOR_RING_GROW_AFTER;
+  cfg.slot_size = ftp_buffer_size();
+  cfg.alloc = xfer_ring_alloc;
+  cfg.release = xfer_ring_release;
+  cfg.ctx = NULL;
+
+  stor_writer_t w;
+  w.fd = fd;
+  w.error = 0;
+  w.written = 0U;
+  w.base = lseek(fd, 0, SEEK_CUR);
+  w.sync = (w.base >= 0) ? sync : NULL;
+  w.direct = direct;
+
+  /* Let the ring draw its buffers from the pool instead of holding a spare */
+  ftp_buffer_release(*spare);
+  *spare = NULL;
+  if (pal_ring_init(&w.ring, &cfg) != 0) {
+    *spare = ftp_buffer_acquire();
+    return 0;
+  }
+
+  pthread_t writer;
+  if (pal_thread_create(&writer, NULL, PAL_THREAD_DISK, stor_writer_thread,
+                        &w) != 0) {
+    pal_ring_destroy(&w.ring);
+    *spare = ftp_buffer_acquire();
+    return 0;
+  }
+
+  size_t buf_sz = cfg.slot_size;
+  for (;;) {
+    uint64_t wait_start = ftp_trace_now_ns();
+    void *buf = pal_ring_acquire(&w.ring);
+    if (buf == NULL) {
+      break; /* writer aborted on a disk error */
+    }
+    stor_trace_lag(session, wait_start);
+
+    ssize_t n = ftp_session_recv_data(session, buf, buf_sz);
+    if (n < 0) {
+      if (errno == EINTR) {
+        pal_ring_unacquire(&w.ring, buf);
+        continue;
+      }
+      *saved_errno = errno;
+      *fail_stage = 2;
+      *ok = 0;
+      pal_ring_unacquire(&w.ring, buf);
+      break;
+    }
+    if (n == 0) {
+      pal_ring_unacquire(&w.ring, buf);
+      break; /* EOF */
+    }
+
+    if (hash != NULL) {
+      ftp_hash_update(hash, buf, (size_t)n);
+    }
+    *total_received += (uint64_t)n;
+    session->last_activity = time(NULL);
+    pal_ring_commit(&w.ring, buf, (size_t)n);
   }
 
-  /* Resolve path */
-  char resolved[FTP_PATH_MAX];
-  ftp_error_t err = ftp_path_resolve(session, args, resolved, sizeof(resolved));
+  /* Writer drains whatever is still queued, then sees EOF */
+  pal_ring_close(&w.ring);
+  (void)pthread_join(writer, NULL);
 
-  if (err != FTP_OK) {
-    session->restart_offset = 0;
-    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
-                                  "Invalid path.");
+  if (w.error != 0) {
+    *saved_errno = w.error;
+    *fail_stage = 3;
+    *ok = 0;
   }
 
-  /*
-   * Atomic write strategy
+  if (pal_ring_peak_depth(&w.ring) > depth) {
+    char msg[96];
+    snprintf(msg, sizeof(msg), "[STOR] writer lagged: ring grew to %u buffers",
+             pal_ring_peak_depth(&w.ring));
+    ftp_log_line(FTP_LOG_INFO, msg);
+  }
+
+  pal_ring_destroy(&w.ring);
+  return 1;
+}
+#endif
+
+/* Temp name for atomic uploads: /dir/.zftpd.tmp.basename */
+static void stor_temp_path(const char *resolved, char *out, size_t size) {
+  const char *slash = strrchr(resolved, '/');
+  if (slash != NULL) {
+    size_t dir_len = (size_t)(slash - resolved);
+    snprintf(out, size, "%.*s/.zftpd.tmp.%s", (int)dir_len, resolved,
+             slash + 1);
+  } else {
+    snprintf(out, size, ".zftpd.tmp.%s", resolved);
+  }
+}
+
+/*
+ * STOR of a file another STOR is writing: one segment of a multi-stream
+ * upload (ftp_segment.h).  It writes the shared fd with pwrite() from
+ * its REST offset, in the plain recv loop: splice, io_uring and the
+ * writer ring all work from the fd position the streams share.
+ */
+static ftp_error_t stor_join(ftp_session_t *session, ftp_segment_t *seg,
+                             const char *resolved, uint64_t alloc_size) {
+  off_t offset = session->restart_offset;
+  session->restart_offset = 0;
+  ftp_fs_profile_t prof;
+  ftp_fs_profile_for_path(resolved, &prof);
+  ftp_segment_end_t res;
+
+  if (seg->fd < 0) {
+    (void)stor_settle(seg, 0, -1, resolved, prof.sync_policy, &res);
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Cannot open file.");
+  }
+  if ((prof.preallocate != 0U) && (alloc_size > (uint64_t)offset) &&
+      (ftp_segment_reserve(seg, alloc_size) == FTP_ERR_FILE_WRITE)) {
+    (void)stor_settle(seg, 0, -1, resolved, prof.sync_policy, &res);
+    return ftp_session_send_reply(session, FTP_REPLY_452_INSUFFICIENT_STORAGE,
+                                  "Cannot reserve space for upload.");
+  }
+  ftp_trace_begin(&session->trace, "STOR", resolved, session->session_id,
+                  session->cmd_start_ns);
+
+  ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK, NULL);
+  if ((ftp_session_open_data_connection(session) != FTP_OK) ||
+      (xfer_start_data_tls(session) != FTP_OK)) {
+    ftp_trace_end(&session->trace, 0, 0U);
+    (void)stor_settle(seg, 0, -1, resolved, prof.sync_policy, &res);
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
+
+  void *buf = ftp_buffer_acquire();
+  size_t buf_sz = ftp_buffer_size();
+  uint64_t total = 0U;
+  int ok = 1;
+  int fail_stage = 0;
+  int saved_errno = 0;
+  while (1) {
+    if (buf == NULL) {
+      fail_stage = 1;
+      ok = 0;
+      break;
+    }
+    ssize_t n = ftp_session_recv_data(session, buf, buf_sz);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      saved_errno = errno;
+      fail_stage = 2;
+      ok = 0;
+      break;
+    }
+    if (n == 0) {
+      break;
+    }
+    uint64_t write_start = ftp_trace_now_ns();
+    int wr = stor_pwrite_all(seg->fd, buf, (size_t)n, offset + (off_t)total);
+    stor_trace_lag(session, write_start);
+    if (wr != 0) {
+      saved_errno = errno;
+      fail_stage = 3;
+      ok = 0;
+      break;
+    }
+    total += (uint64_t)n;
+    session->last_activity = time(NULL);
+  }
+  ftp_buffer_release(buf);
+
+  int renamed = stor_settle(seg, ok, offset + (off_t)total, resolved,
+                            prof.sync_policy, &res);
+  ftp_trace_end(&session->trace, ok, total);
+  ftp_session_close_data_connection(session);
+  ftp_list_cache_invalidate(resolved);
+
+  if ((ok != 0) && (renamed == 0)) {
+    atomic_fetch_add(&session->stats.files_received, 1U);
+    ftp_log_session_event(session, "STOR_OK", FTP_OK, total);
+    return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE,
+                                  NULL);
+  }
+  if (ok != 0) {
+    return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                  "Rename to final path failed.");
+  }
+  ftp_log_session_event(session, "STOR_FAIL", FTP_ERR_UNKNOWN, total);
+  return stor_fail_reply(session, fail_stage, saved_errno);
+}
+
+/**
+ * @brief STOR command - Store (upload) file
+ *
+ *  REST + STOR resume workflow
+ *  ~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ *  Client:  REST 52428800        <- set offset = 50 MB
+ *  Server:  350 Restart accepted
+ *  Client:  STOR bigfile.pkg     <- resumes here
+ *  Server:  opens file WITHOUT O_TRUNC, lseek(offset)
+ *           receives remaining bytes and writes from offset
+ *
+ *  If restart_offset == 0 the file is truncated as usual.
+ *
+ *  A preceding ALLO reserves the announced size before 150.
+ *
+ *  While another STOR of the same file runs, this one is a segment of
+ *  a multi-stream upload and writes into it (stor_join).
+ */
+ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
+  if ((session == NULL) || (args == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  uint64_t alloc_size = session->alloc_size; /* ALLO applies once */
+  session->alloc_size = 0U;
+
+  /* Resolve path */
+  char resolved[FTP_PATH_MAX];
+  ftp_error_t err = ftp_path_resolve(session, args, resolved, sizeof(resolved));
+
+  if (err != FTP_OK) {
+    session->restart_offset = 0;
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Invalid path.");
+  }
+
+  ftp_segment_t seg;
+  if (ftp_segment_stor_begin(session, resolved, &seg) == FTP_SEGMENT_JOINED) {
+    return stor_join(session, &seg, resolved, alloc_size);
+  }
+
+  /*
+   * Atomic write strategy
    * ~~~~~~~~~~~~~~~~~~~~~
    *   Fresh upload (offset == 0):
    *     write to  /path/.zftpd.tmp.FILENAME
@@ -1289,26 +1878,21 @@ ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
    */
   char tmp_path[FTP_PATH_MAX];
   int was_fresh_upload = (session->restart_offset == 0) ? 1 : 0;
-#if defined(PLATFORM_PS5) || defined(PLATFORM_PS4)
-  /* PS4/PS5 /data/: no ShadowMount watching, skip atomic temp→rename overhead.
-   * On PS4, PFS-encrypted writes through a temp file add ~40ms per 256 KB
-   * chunk; the double-buffer producer stalls waiting for the writer, the TCP
-   * recv buffer fills, and the FileZilla client times out after 20 s. */
-  int use_atomic = 0;
-#else
-  int use_atomic = (session->restart_offset == 0) ? 1 : 0;
-#endif
+
+  /*
+   * Filesystem profile (ftp_fsprofile.h): atomic rename, preallocation,
+   * flush policy and writer ring depth for this upload's filesystem.
+   * PS4/PS5 default to no temp→rename: PFS-encrypted writes through a
+   * temp file add ~40ms per 256 KB chunk, the TCP recv buffer fills and
+   * the FileZilla client times out after 20 s (FTP_STOR_ATOMIC).
+   */
+  ftp_fs_profile_t prof;
+  ftp_fs_profile_for_path(resolved, &prof);
+  int use_atomic =
+      ((prof.atomic_rename != 0U) && (was_fresh_upload != 0)) ? 1 : 0;
 
   if (use_atomic != 0) {
-    /* Build temp name: /dir/.zftpd.tmp.basename */
-    const char *slash = strrchr(resolved, '/');
-    if (slash != NULL) {
-      size_t dir_len = (size_t)(slash - resolved);
-      snprintf(tmp_path, sizeof(tmp_path), "%.*s/.zftpd.tmp.%s", (int)dir_len,
-               resolved, slash + 1);
-    } else {
-      snprintf(tmp_path, sizeof(tmp_path), ".zftpd.tmp.%s", resolved);
-    }
+    stor_temp_path(resolved, tmp_path, sizeof(tmp_path));
   }
 
   const char *write_path = (use_atomic != 0) ? tmp_path : resolved;
@@ -1346,6 +1930,7 @@ ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
     if (pfs_mutex_lock_timeout(&g_pfs_create_mtx, 10) == 0) {
       held_pfs_mtx = 1;
     } else {
+      ftp_segment_stor_opened(&seg, -1, write_path, 0, 0);
       session->restart_offset = 0;
       return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
                                     "Server busy, please retry.");
@@ -1358,6 +1943,7 @@ ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
     pthread_mutex_unlock(&g_pfs_create_mtx);
   }
 #endif
+  ftp_segment_stor_opened(&seg, fd, write_path, use_atomic, was_fresh_upload);
   if (fd < 0) {
     if (use_atomic != 0) {
       (void)unlink(tmp_path);
@@ -1366,33 +1952,43 @@ ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
                                   "Cannot create file.");
   }
+  ftp_trace_begin(&session->trace, "STOR", resolved, session->session_id,
+                  session->cmd_start_ns);
 
   /* Seek to restart offset for resume uploads */
   if (session->restart_offset > 0) {
     if (lseek(fd, session->restart_offset, SEEK_SET) < 0) {
-      pal_file_close(fd);
-      if (use_atomic != 0) {
-        (void)unlink(tmp_path);
-      } else if (was_fresh_upload != 0) {
-        (void)unlink(write_path);
-      }
-      session->restart_offset = 0;
+      stor_abandon(session, &seg, resolved);
       return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
                                     "Seek failed.");
     }
   }
 
+  /*
+   * ALLO: reserve the whole file while the client still waits for 150,
+   * like the open() above.  Out of space is reported before any data
+   * moves; a filesystem without fallocate just grows the file as before.
+   * The reserved tail is trimmed when the last stream of the file ends.
+   */
+  if ((prof.preallocate != 0U) && (alloc_size > 0U) &&
+      (alloc_size > (uint64_t)session->restart_offset) &&
+      (ftp_segment_reserve(&seg, alloc_size) == FTP_ERR_FILE_WRITE)) {
+    stor_abandon(session, &seg, resolved);
+    return ftp_session_send_reply(session, FTP_REPLY_452_INSUFFICIENT_STORAGE,
+                                  "Cannot reserve space for upload.");
+  }
+
+  stor_sync_t sync;
+  stor_sync_init(&sync, fd, session->restart_offset, prof.sync_policy);
+
   ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK, NULL);
 
   err = ftp_session_open_data_connection(session);
+  if (err == FTP_OK) {
+    err = xfer_start_data_tls(session);
+  }
   if (err != FTP_OK) {
-    pal_file_close(fd);
-    if (use_atomic != 0) {
-      (void)unlink(tmp_path);
-    } else if (was_fresh_upload != 0) {
-      (void)unlink(write_path);
-    }
-    session->restart_offset = 0;
+    stor_abandon(session, &seg, resolved);
     return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
   }
 
@@ -1439,39 +2035,110 @@ ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
    *
    *  PLATFORM DECISION
    *  ~~~~~~~~~~~~~~~~~
-   *  PS4/PS5 : acquire only one buffer → fall through to single-buffer path.
+   *  PS4/PS5 : FTP_STOR_RING_DEPTH = 0 → single-buffer path (a profile's
+   *            ring= can still enable the ring for one filesystem).
    *            SO_RCVBUF is unreliable; double-buffer causes zero-window
    *            stalls that trigger FileZilla's 20 s data-inactivity timeout.
-   *  Other   : acquire two buffers → double-buffer path.
+   *  Other   : writer ring (2 buffers, grows while the writer lags).
    *            SO_RCVBUF is fully controllable and the pipeline genuinely
    *            improves throughput.
    *=========================================================================*/
 
-#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
   /*
-   * Force single-buffer on PS4/PS5: acquire only buf0 and leave buf1 = NULL.
-   * The (buf0 == NULL || buf1 == NULL) branch below is the single-buffer path;
-   * it handles NULL buf1 correctly (ftp_buffer_release(NULL) is a no-op).
+   * buf0 serves the splice bounce area, the io_uring engine and the
+   * single-buffer loop.  The ring path (profile ring >= 2, i.e. not
+   * PS4/PS5 by default) hands it back and draws its own pool buffers.
    */
   void *buf0 = ftp_buffer_acquire();
-  void *buf1 = NULL; /* intentionally NULL — forces single-buffer path */
-#else
-  void *buf0 = ftp_buffer_acquire();
-  void *buf1 = ftp_buffer_acquire();
-#endif
   size_t buf_sz = ftp_buffer_size();
   uint64_t total_received = 0U;
   int ok = 1;
   int fail_stage = 0; /* 1 = no buffer, 2 = recv error, 3 = write error */
   int saved_errno = 0;
+  int kernel_done = 0;
+  uint64_t kernel_prefix = 0U; /* bytes a kernel path wrote before falling back */
+
+  /*
+   * Inline digest: a fresh upload from a client that chose a HASH
+   * algorithm is hashed as it arrives (userspace loops only).
+   */
+  ftp_hash_ctx_t stor_hash;
+  ftp_hash_ctx_t *hash = NULL;
+#if FTP_ENABLE_HASH && FTP_HASH_INLINE_STOR
+  if ((session->hash_chosen != 0U) && (was_fresh_upload != 0)) {
+    ftp_hash_init(&stor_hash, (ftp_hash_algo_t)session->hash_algo);
+    hash = &stor_hash;
+    kernel_done = -1; /* keep splice / io_uring out */
+  }
+#else
+  (void)stor_hash;
+#endif
+
+  /* An upload announced as large goes O_DIRECT: userspace loops only */
+  stor_direct_t direct;
+  stor_direct_init(&direct, alloc_size, &seg);
+  if ((direct.state == 0) && (direct.from == 0U)) {
+    kernel_done = -1;
+  }
+
+#if HAS_SPLICE
+  /*
+   * splice path: socket → pipe → file, no userspace copy at all.  The
+   * REST seek and atomic temp/rename handling above and below are
+   * unchanged; only the byte-moving loop is replaced.
+   */
+  if (kernel_done == 0) {
+    kernel_done = stor_try_splice(session, fd, buf0, buf_sz, &sync,
+                                  &kernel_prefix, &ok, &fail_stage,
+                                  &saved_errno);
+  }
+#endif
+
+#if HAS_IO_URING
+  /*
+   * io_uring path: recv of chunk N+1 overlaps the write of chunk N inside
+   * one ring, so the writer thread and its second buffer are not needed.
+   * Writes are positional from the current offset (REST already seeked).
+   */
+  if ((kernel_done == 0) && (buf0 != NULL) &&
+      (xfer_uring_eligible(session) != 0)) {
+    off_t uoff = lseek(fd, 0, SEEK_CUR);
+    if (uoff >= 0) {
+      xfer_progress_t prog = {session, 0U, 1, NULL, uoff, &sync};
+      uint64_t moved = 0U;
+      ftp_error_t uerr = pal_uring_socket_to_file(session->data_fd, fd, &uoff,
+                                                  buf0, buf_sz,
+                                                  xfer_progress_cb, &prog,
+                                                  &moved);
+      if (uerr != FTP_ERR_NOT_SUPPORTED) {
+        kernel_done = 1;
+        total_received = moved;
+        if (uerr != FTP_OK) {
+          saved_errno = errno;
+          fail_stage = (uerr == FTP_ERR_FILE_WRITE) ? 3 : 2;
+          ok = 0;
+        }
+      }
+    }
+  }
+#endif
 
-  if ((buf0 == NULL) || (buf1 == NULL)) {
+  if (kernel_done > 0) {
+    /* transfer already handled by the splice / io_uring engine */
+#if FTP_STOR_RING_MAX_DEPTH >= 2
+  } else if ((prof.stor_ring >= 2U) &&
+             (stor_ring_receive(session, fd, &buf0, prof.stor_ring, hash,
+                                &sync, &direct, &total_received, &ok,
+                                &fail_stage, &saved_errno) != 0)) {
+    /* transfer ran through the writer ring */
+#endif
+  } else {
     /*
-     * Fallback: if we can't get two buffers, use single-buffer mode.
-     * This happens when the pool is exhausted under heavy load.
+     * Single-buffer mode: PS4/PS5 by design, elsewhere when the pool is
+     * exhausted under heavy load or the writer thread cannot be created.
      */
-    void *buffer = (buf0 != NULL) ? buf0 : buf1;
-    ftp_buffer_release((buf0 != NULL) ? buf1 : buf0);
+    void *buffer = buf0;
+    off_t loop_base = lseek(fd, 0, SEEK_CUR);
 
     while (1) {
       if (buffer == NULL) {
@@ -1492,7 +2159,13 @@ ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
       if (n == 0) {
         break;
       }
-      ssize_t written = pal_file_write_all(fd, buffer, (size_t)n);
+      if (hash != NULL) {
+        ftp_hash_update(hash, buffer, (size_t)n);
+      }
+      uint64_t write_start = ftp_trace_now_ns();
+      ssize_t written =
+          stor_direct_write(&direct, fd, buffer, (size_t)n, total_received);
+      stor_trace_lag(session, write_start);
       if (written != n) {
         saved_errno = errno;
         fail_stage = 3;
@@ -1501,174 +2174,55 @@ ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
       }
       total_received += (uint64_t)n;
       session->last_activity = time(NULL);
-    }
-
-    ftp_buffer_release(buffer);
-  } else {
-    /*
-     * Double-buffered path: spawn a writer thread.
-     */
-    stor_pipe_t pipe;
-    pipe.buf[0] = buf0;
-    pipe.buf[1] = buf1;
-    pipe.len[0] = 0U;
-    pipe.len[1] = 0U;
-    pipe.active = 0;
-    pipe.fd = fd;
-    pipe.error = 0;
-    pipe.done = 0;
-    pipe.written = 0U;
-    pthread_mutex_init(&pipe.mtx, NULL);
-    pthread_cond_init(&pipe.cv_ready, NULL);
-    pthread_cond_init(&pipe.cv_free, NULL);
-
-    pthread_t writer;
-    int thread_ok =
-        (pthread_create(&writer, NULL, stor_writer_thread, &pipe) == 0) ? 1 : 0;
-    if (thread_ok == 0) {
-      /* Thread creation failed — fall back to single-buffer */
-      while (1) {
-        ssize_t n = ftp_session_recv_data(session, buf0, buf_sz);
-        if (n < 0) {
-          if (errno == EINTR) {
-            continue;
-          }
-          saved_errno = errno;
-          fail_stage = 2;
-          ok = 0;
-          break;
-        }
-        if (n == 0) {
-          break;
-        }
-        ssize_t written = pal_file_write_all(fd, buf0, (size_t)n);
-        if (written != n) {
-          saved_errno = errno;
-          fail_stage = 3;
-          ok = 0;
-          break;
-        }
-        total_received += (uint64_t)n;
-        session->last_activity = time(NULL);
-      }
-    } else {
-      /*
-       * Producer loop: fill buf[active], then hand off to writer.
-       */
-      while (1) {
-        pthread_mutex_lock(&pipe.mtx);
-
-        /* Wait for our active buffer to be free */
-        while (pipe.len[pipe.active] != 0U) {
-          if (pipe.error != 0) {
-            pthread_mutex_unlock(&pipe.mtx);
-            goto recv_done;
-          }
-          pthread_cond_wait(&pipe.cv_free, &pipe.mtx);
-        }
-
-        /* Check if writer hit an error */
-        if (pipe.error != 0) {
-          pthread_mutex_unlock(&pipe.mtx);
-          break;
-        }
-
-        int fill_idx = pipe.active;
-        pthread_mutex_unlock(&pipe.mtx);
-
-        /* Receive into the free buffer (slow, don't hold lock) */
-        ssize_t n = ftp_session_recv_data(session, pipe.buf[fill_idx], buf_sz);
-        if (n < 0) {
-          if (errno == EINTR) {
-            continue;
-          }
-          saved_errno = errno;
-          fail_stage = 2;
-          ok = 0;
-          break;
-        }
-        if (n == 0) {
-          break; /* EOF */
-        }
-
-        total_received += (uint64_t)n;
-        session->last_activity = time(NULL);
-
-        /* Hand the filled buffer to the writer */
-        pthread_mutex_lock(&pipe.mtx);
-        pipe.len[fill_idx] = (size_t)n;
-        pipe.active = 1 - fill_idx; /* swap to other buffer */
-        pthread_cond_signal(&pipe.cv_ready);
-        pthread_mutex_unlock(&pipe.mtx);
-      }
-
-    recv_done:
-      /* Signal writer that recv is done */
-      pthread_mutex_lock(&pipe.mtx);
-      pipe.done = 1;
-      pthread_cond_signal(&pipe.cv_ready);
-      pthread_mutex_unlock(&pipe.mtx);
-
-      (void)pthread_join(writer, NULL);
-
-      /* Collect writer result */
-      if (pipe.error != 0) {
-        saved_errno = pipe.error;
-        fail_stage = 3;
-        ok = 0;
+      if (loop_base >= 0) {
+        stor_sync_note(&sync, loop_base + (off_t)total_received);
       }
-      total_received = pipe.written + (total_received - pipe.written);
     }
-
-    pthread_mutex_destroy(&pipe.mtx);
-    pthread_cond_destroy(&pipe.cv_ready);
-    pthread_cond_destroy(&pipe.cv_free);
-    ftp_buffer_release(buf0);
-    ftp_buffer_release(buf1);
+  }
+  ftp_buffer_release(buf0);
+  total_received += kernel_prefix;
+  if ((stor_direct_end(&direct) != 0) && (ok != 0)) {
+    saved_errno = errno;
+    fail_stage = 3;
+    ok = 0;
   }
 
   /*
-   * Flush strategy — platform-specific
-   *
-   *   OrbisOS:  close() already flushes dirty pages to NVMe.
-   *             An explicit fsync() forces a full controller barrier
-   *             through PFS crypto — adds 5-15ms of pure overhead.
-   *
-   *   Linux:    fdatasync() flushes data only (skips metadata).
-   *
-   *   Other:    fsync() as safety default.
+   * Last stream of the file out: trim an ALLO larger than the upload,
+   * flush (profile sync policy, none on PS4/PS5 by default), close, and
+   * commit.  Atomic commit is rename temp → final: rename() is atomic
+   * on POSIX, so ShadowMount's stat() sees either the old file or the
+   * new complete one, never a half-written intermediate state.
    */
-#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
-  /* OrbisOS: close() flushes; skip explicit sync */
-  (void)0;
-#elif defined(__linux__)
-  if (ok != 0) {
-    (void)fdatasync(fd);
-  }
-#else
-  if (ok != 0) {
-    (void)fsync(fd);
-  }
-#endif
-  pal_file_close(fd);
+  ftp_segment_end_t res;
+  int renamed = stor_settle(&seg, ok,
+                            session->restart_offset + (off_t)total_received,
+                            resolved, prof.sync_policy, &res);
+  ftp_trace_end(&session->trace, ok, total_received);
   ftp_session_close_data_connection(session);
   session->restart_offset = 0;
 
   if (ok != 0) {
-    /*
-     * Atomic commit: rename temp → final
-     *
-     * rename() is atomic on POSIX: ShadowMount's stat() will
-     * see either the old file or the new complete file, never
-     * a half-written intermediate state.
-     */
-    if (use_atomic != 0) {
-      if (rename(tmp_path, resolved) != 0) {
-        (void)unlink(tmp_path);
-        return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
-                                      "Rename to final path failed.");
+    if (renamed != 0) {
+      ftp_list_cache_invalidate(resolved);
+      return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                    "Rename to final path failed.");
+    }
+    ftp_list_cache_invalidate(resolved);
+
+#if FTP_ENABLE_HASH
+    /* Other streams wrote parts this digest never saw */
+    if ((hash != NULL) && (res.segmented == 0)) {
+      struct stat st;
+      if ((pal_file_stat(resolved, &st) == FTP_OK) &&
+          ((uint64_t)st.st_size == hash->total)) {
+        uint8_t digest[FTP_HASH_MAX_DIGEST];
+        ftp_hash_final(hash, digest);
+        ftp_hash_cache_store(resolved, hash->algo, hash->total,
+                             (int64_t)st.st_mtime, digest);
       }
     }
+#endif
 
     atomic_fetch_add(&session->stats.files_received, 1U);
     ftp_log_session_event(session, "STOR_OK", FTP_OK, total_received);
@@ -1676,38 +2230,21 @@ ftp_error_t cmd_STOR(ftp_session_t *session, const char *args) {
                                   NULL);
   }
 
-  /* On failure, clean up partial file */
-  if (use_atomic != 0) {
-    (void)unlink(tmp_path);
-  } else if (was_fresh_upload != 0) {
-    /*
-     * Non-atomic path (PS4/PS5): the file was opened with O_CREAT|O_TRUNC
-     * directly on the destination.  If the transfer failed, an empty or
-     * partial file now sits on disk.  Delete it so that a subsequent LIST
-     * does not show a ghost file and cause the client to prompt for
-     * overwrite (or silently skip the upload).
-     *
-     * Resume uploads (was_fresh_upload == 0) are intentionally left alone
-     * so the client can attempt REST+STOR/APPE again.
-     */
-    (void)unlink(write_path);
-  }
+  /*
+   * On failure stor_settle() has cleaned up the partial file: the temp
+   * file, or on the non-atomic path (PS4/PS5) a fresh destination opened
+   * with O_CREAT|O_TRUNC, so that a subsequent LIST does not show a
+   * ghost file and cause the client to prompt for overwrite (or silently
+   * skip the upload).
+   *
+   * Resume uploads (was_fresh_upload == 0) are intentionally left alone
+   * so the client can attempt REST+STOR/APPE again, and so is a file
+   * other streams wrote segments of (ftp_segment.h).
+   */
+  ftp_list_cache_invalidate(resolved);
 
   ftp_log_session_event(session, "STOR_FAIL", FTP_ERR_UNKNOWN, total_received);
-
-  char detail[128];
-  if (fail_stage == 2) {
-    snprintf(detail, sizeof(detail),
-             "Transfer failed: network receive error (errno=%d).", saved_errno);
-  } else if (fail_stage == 3) {
-    snprintf(detail, sizeof(detail),
-             "Transfer failed: disk write error (errno=%d).", saved_errno);
-  } else {
-    snprintf(detail, sizeof(detail), "Transfer failed.");
-  }
-
-  return ftp_session_send_reply(session, FTP_REPLY_426_TRANSFER_ABORTED,
-                                detail);
+  return stor_fail_reply(session, fail_stage, saved_errno);
 }
 
 /**
@@ -1768,6 +2305,8 @@ ftp_error_t cmd_APPE(ftp_session_t *session, const char *args) {
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
                                   "Cannot open file.");
   }
+  ftp_trace_begin(&session->trace, "APPE", resolved, session->session_id,
+                  session->cmd_start_ns);
 
   /* Seek to restart offset when provided */
   if (session->restart_offset > 0) {
@@ -1782,6 +2321,9 @@ ftp_error_t cmd_APPE(ftp_session_t *session, const char *args) {
   ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK, NULL);
 
   err = ftp_session_open_data_connection(session);
+  if (err == FTP_OK) {
+    err = xfer_start_data_tls(session);
+  }
   if (err != FTP_OK) {
     pal_file_close(fd);
     session->restart_offset = 0;
@@ -1795,7 +2337,14 @@ ftp_error_t cmd_APPE(ftp_session_t *session, const char *args) {
   int fail_stage = 0; /* 1 = no buffer, 2 = recv error, 3 = write error */
   int saved_errno = 0;
 
-  while (1) {
+  int splice_done = 0;
+#if HAS_SPLICE
+  splice_done = stor_try_splice(session, fd, buffer, buf_sz, NULL,
+                                &total_received, &ok, &fail_stage,
+                                &saved_errno);
+#endif
+
+  while (splice_done == 0) {
     if (buffer == NULL) {
       fail_stage = 1;
       ok = 0;
@@ -1816,7 +2365,9 @@ ftp_error_t cmd_APPE(ftp_session_t *session, const char *args) {
       break;
     }
 
+    uint64_t write_start = ftp_trace_now_ns();
     ssize_t written = pal_file_write_all(fd, buffer, (size_t)n);
+    stor_trace_lag(session, write_start);
     if (written != n) {
       saved_errno = errno;
       fail_stage = 3;
@@ -1844,8 +2395,10 @@ ftp_error_t cmd_APPE(ftp_session_t *session, const char *args) {
 #endif
   pal_file_close(fd);
   ftp_buffer_release(buffer);
+  ftp_trace_end(&session->trace, ok, total_received);
   ftp_session_close_data_connection(session);
   session->restart_offset = 0;
+  ftp_list_cache_invalidate(resolved);
 
   if (ok != 0) {
     ftp_log_session_event(session, "APPE_OK", FTP_OK, total_received);
@@ -1893,19 +2446,57 @@ ftp_error_t cmd_REST(ftp_session_t *session, const char *args) {
                                 "Restart position accepted.");
 }
 
-/*===========================================================================*
- * FILE MANAGEMENT
- *===========================================================================*/
-
 /**
- * @brief DELE command - Delete file
+ * @brief ALLO command - Reserve space for the next STOR
+ *
+ *   Client:  ALLO 4294967296        (RFC 959: "ALLO <n> [R <m>]")
+ *   Server:  200 ALLO 4294967296 bytes.
+ *   Client:  STOR big.pkg           <- blocks reserved before recv()
+ *
+ *   The next STOR preallocates the file to n bytes so ext4/exFAT/PFS
+ *   lay it out in one go instead of growing it one write at a time.
+ *   A short upload is truncated back to what arrived.
  */
-ftp_error_t cmd_DELE(ftp_session_t *session, const char *args) {
+ftp_error_t cmd_ALLO(ftp_session_t *session, const char *args) {
   if ((session == NULL) || (args == NULL)) {
     return FTP_ERR_INVALID_PARAM;
   }
 
-  char resolved[FTP_PATH_MAX];
+  char *endptr;
+  errno = 0;
+  unsigned long long size = strtoull(args, &endptr, 10);
+  while (*endptr == ' ') {
+    endptr++;
+  }
+  if ((endptr == args) || (errno != 0) || (args[0] == '-') ||
+      ((*endptr != '\0') && (toupper((unsigned char)*endptr) != 'R'))) {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "Invalid size.");
+  }
+
+  if (FTP_STOR_PREALLOCATE == 0) {
+    return ftp_session_send_reply(session, FTP_REPLY_202_SUPERFLUOUS, NULL);
+  }
+  session->alloc_size = (uint64_t)size;
+
+  char msg[64];
+  snprintf(msg, sizeof(msg), "ALLO %llu bytes.", size);
+  return ftp_session_send_reply(session, FTP_REPLY_200_OK, msg);
+}
+
+/*===========================================================================*
+ * FILE MANAGEMENT
+ *===========================================================================*/
+
+/**
+ * @brief DELE command - Delete file
+ */
+ftp_error_t cmd_DELE(ftp_session_t *session, const char *args) {
+  if ((session == NULL) || (args == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  char resolved[FTP_PATH_MAX];
   ftp_error_t err = ftp_path_resolve(session, args, resolved, sizeof(resolved));
 
   if (err != FTP_OK) {
@@ -1920,6 +2511,7 @@ ftp_error_t cmd_DELE(ftp_session_t *session, const char *args) {
                                   "Cannot delete file.");
   }
 
+  ftp_list_cache_invalidate(resolved);
   return ftp_session_send_reply(session, FTP_REPLY_250_FILE_ACTION_OK,
                                 "File deleted.");
 }
@@ -1947,6 +2539,7 @@ ftp_error_t cmd_RMD(ftp_session_t *session, const char *args) {
                                   "Cannot remove directory.");
   }
 
+  ftp_list_cache_invalidate(resolved);
   return ftp_session_send_reply(session, FTP_REPLY_250_FILE_ACTION_OK,
                                 "Directory removed.");
 }
@@ -1985,6 +2578,8 @@ ftp_error_t cmd_MKD(ftp_session_t *session, const char *args) {
     }
   }
 
+  ftp_list_cache_invalidate(resolved);
+
   char reply[FTP_REPLY_BUFFER_SIZE];
   int n = snprintf(reply, sizeof(reply), "\"%s\" created.", resolved);
 
@@ -2021,7 +2616,7 @@ ftp_error_t cmd_RNFR(ftp_session_t *session, const char *args) {
 
   /* Store source path */
   size_t len = strlen(resolved);
-  if (len >= sizeof(session->rename_from)) {
+  if (len >= FTP_PATH_MAX) {
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
                                   "Path too long.");
   }
@@ -2066,6 +2661,11 @@ ftp_error_t cmd_RNTO(ftp_session_t *session, const char *args) {
     return async_err;
   }
 
+  if (err == FTP_OK) {
+    ftp_list_cache_invalidate(session->rename_from);
+    ftp_list_cache_invalidate(resolved);
+  }
+
   /* Clear rename_from */
   session->rename_from[0] = '\0';
 
@@ -2177,13 +2777,22 @@ ftp_error_t cmd_PORT(ftp_session_t *session, const char *args) {
    *   control IP:  session->client_ip  (e.g. "192.168.1.50")
    *   PORT IP:     ip                  (e.g. "192.168.1.1")
    *   mismatch  -> 501 rejected
+   *
+   *   FXP: a server on the ftp_fxp.h allow-list may be the target
+   *   instead, as long as the port is unprivileged (>= 1024).
    */
 #ifndef FTP_PORT_ALLOW_FOREIGN_IP
 #define FTP_PORT_ALLOW_FOREIGN_IP 0
 #endif
 
 #if !FTP_PORT_ALLOW_FOREIGN_IP
-  if (strcmp(ip, session->client_ip) != 0) {
+  if ((strcmp(ip, session->client_ip) != 0) && (port >= 1024U) &&
+      (ftp_fxp_allowed(session->data_addr.sin_addr.s_addr) != 0)) {
+    char dbg[128];
+    snprintf(dbg, sizeof(dbg), "[FXP] PORT client=%s target=%s:%u",
+             session->client_ip, ip, (unsigned)port);
+    ftp_log_line(FTP_LOG_INFO, dbg);
+  } else if (strcmp(ip, session->client_ip) != 0) {
     char dbg[128];
     snprintf(dbg, sizeof(dbg),
              "[SEC] PORT IP mismatch: client=%s port=%s (rejected)",
@@ -2201,80 +2810,60 @@ ftp_error_t cmd_PORT(ftp_session_t *session, const char *args) {
                                 "PORT command successful.");
 }
 
-/**
- * @brief PASV command - Passive mode data connection
+/*
+ * Lease a passive listener bound to the control connection's local IP.
+ *
+ * Listeners come from the server's pool (ftp_pasv_pool.h), already
+ * bound and listening, so PASV/EPSV normally costs no socket setup.
+ * A pooled listener is configured exactly like the old per-PASV one:
+ *
+ *   SO_REUSEADDR, then SO_RCVBUF on the LISTENING socket BEFORE
+ *   bind/listen.  On FreeBSD/PS4/PS5 the kernel copies the listening
+ *   socket's receive buffer size into each accepted connection during
+ *   the 3-way handshake.  Setting SO_RCVBUF on the accepted socket after
+ *   accept() is too late: the kernel caps post-connect increases to
+ *   kern.ipc.maxsockbuf (~1 MB on OrbisOS), which is why STOR transfers
+ *   stall after exactly 1 MB.
+ *
+ * SO_SNDBUF is intentionally NOT set on the listening socket.
+ *
+ * DESIGN RATIONALE — auto-tuning vs. explicit SNDBUF:
+ *
+ *   On both Linux (tcp_wmem) and FreeBSD (net.inet.tcp.sendbuf_auto),
+ *   calling setsockopt(SO_SNDBUF) explicitly on any socket — even
+ *   pre-bind — marks that socket as "manually sized" and DISABLES
+ *   the kernel's TCP send-buffer auto-tuning for it.
+ *
+ *   The HTTP server never sets SO_SNDBUF and relies on auto-tuning;
+ *   it achieves full link speed at any internet RTT because the kernel
+ *   grows the buffer to exactly BDP = RTT × bandwidth.
+ *
+ *   A previous version of this code set SO_SNDBUF = FTP_TCP_DATA_SNDBUF
+ *   (4 MB) here, hoping to bypass kern.ipc.maxsockbuf via the 3-way
+ *   handshake inheritance trick.  On OrbisOS the kernel still capped the
+ *   effective buffer (≈ 512 KB–1 MB) and, critically, disabled
+ *   auto-tuning — leaving FTP stuck at ≈ 30 Mbps while HTTP with
+ *   auto-tuning reached 80 Mbps on the same link.
+ *
+ *   SO_RCVBUF (STOR/uploads) cannot use auto-tuning because the kernel
+ *   does not auto-grow the receive buffer on FreeBSD; the explicit value
+ *   is required there to prevent zero-window stalls.  The send buffer
+ *   (RETR/downloads) has no such constraint — leave it for auto-tuning.
+ *
+ * The listener is bound to the specific interface — not INADDR_ANY.
+ * On OrbisOS/FreeBSD (PS4/PS5), binding to INADDR_ANY causes inbound
+ * SYNs to be silently dropped when the kernel routes the incoming
+ * connection via a specific interface that doesn't match the wildcard
+ * binding, even though the 227 reply advertises the correct IP.
+ * Binding to the exact local address fixes this.
+ *
+ * On success session->pasv_fd holds the lease; *ip_out is the address
+ * to advertise (host order) and *port_out the listener port.
  */
-ftp_error_t cmd_PASV(ftp_session_t *session, const char *args) {
-  (void)args; /* Unused */
-
-  if (session == NULL) {
-    return FTP_ERR_INVALID_PARAM;
-  }
-
-  if (session->pasv_fd >= 0) {
-    PAL_CLOSE(session->pasv_fd);
-    session->pasv_fd = -1;
-  }
-
-  /* Create passive listener socket */
-  int fd = PAL_SOCKET(AF_INET, SOCK_STREAM, 0);
-  if (fd < 0) {
-    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
-                                  "Cannot create socket.");
-  }
-
-  /* Enable address reuse */
-  (void)pal_socket_set_reuseaddr(fd);
-
-  /*
-   * Set SO_RCVBUF on the LISTENING socket BEFORE bind/listen.
-   *
-   * On FreeBSD/PS4/PS5 the kernel copies the listening socket's receive
-   * buffer size into each accepted connection during the 3-way handshake.
-   * Setting SO_RCVBUF on the accepted socket after accept() is too late:
-   * the kernel caps post-connect increases to kern.ipc.maxsockbuf (~1 MB
-   * on OrbisOS), which is why STOR transfers stall after exactly 1 MB.
-   * Setting it here propagates the full 4 MB to every accepted data socket.
-   */
-  {
-    int rcvbuf = (int)FTP_TCP_RCVBUF;
-    (void)PAL_SETSOCKOPT(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
-  }
-
-  /*
-   * SO_SNDBUF is intentionally NOT set on the listening socket.
-   *
-   * DESIGN RATIONALE — auto-tuning vs. explicit SNDBUF:
-   *
-   *   On both Linux (tcp_wmem) and FreeBSD (net.inet.tcp.sendbuf_auto),
-   *   calling setsockopt(SO_SNDBUF) explicitly on any socket — even
-   *   pre-bind — marks that socket as "manually sized" and DISABLES
-   *   the kernel's TCP send-buffer auto-tuning for it.
-   *
-   *   The HTTP server never sets SO_SNDBUF and relies on auto-tuning;
-   *   it achieves full link speed at any internet RTT because the kernel
-   *   grows the buffer to exactly BDP = RTT × bandwidth.
-   *
-   *   A previous version of this code set SO_SNDBUF = FTP_TCP_DATA_SNDBUF
-   *   (4 MB) here, hoping to bypass kern.ipc.maxsockbuf via the 3-way
-   *   handshake inheritance trick.  On OrbisOS the kernel still capped the
-   *   effective buffer (≈ 512 KB–1 MB) and, critically, disabled
-   *   auto-tuning — leaving FTP stuck at ≈ 30 Mbps while HTTP with
-   *   auto-tuning reached 80 Mbps on the same link.
-   *
-   *   SO_RCVBUF (STOR/uploads) cannot use auto-tuning because the kernel
-   *   does not auto-grow the receive buffer on FreeBSD; the explicit value
-   *   is required there to prevent zero-window stalls.  The send buffer
-   *   (RETR/downloads) has no such constraint — leave it for auto-tuning.
-   */
+static ftp_error_t pasv_open(ftp_session_t *session, uint32_t *ip_out,
+                             uint16_t *port_out) {
+  ftp_session_release_pasv(session);
 
-  /* Resolve the local IP from the control connection so the PASV
-   * listener is bound to the specific interface — not INADDR_ANY.
-   * On OrbisOS/FreeBSD (PS4/PS5), binding to INADDR_ANY causes
-   * inbound SYNs to be silently dropped when the kernel routes the
-   * incoming connection via a specific interface that doesn't match
-   * the wildcard binding, even though the 227 reply advertises the
-   * correct IP.  Binding to the exact local address fixes this. */
   uint32_t ip = 0U;
   {
     struct sockaddr_in local;
@@ -2295,43 +2884,60 @@ ftp_error_t cmd_PASV(ftp_session_t *session, const char *args) {
     }
   }
 
-  /* Bind to the resolved local IP, ephemeral port (port 0 = auto-assign) */
-  struct sockaddr_in addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.sin_family = AF_INET;
-  addr.sin_addr.s_addr = (ip != 0U) ? PAL_HTONL(ip) : PAL_HTONL(INADDR_ANY);
-  addr.sin_port = 0; /* Auto-assign port */
+  struct ftp_pasv_pool *pool =
+      (session->server_ctx != NULL) ? session->server_ctx->pasv_pool : NULL;
+  uint16_t port = 0U;
+  int fd = ftp_pasv_pool_lease(pool, ip, &port);
+  if (fd < 0) {
+    return (ftp_error_t)fd;
+  }
 
-  if (PAL_BIND(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-    PAL_CLOSE(fd);
-    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
-                                  "Bind failed.");
+  session->pasv_fd = fd;
+  session->data_mode = FTP_DATA_MODE_PASSIVE;
+  *ip_out = ip;
+  *port_out = port;
+  return FTP_OK;
+}
+
+/* 425 text for a failed pasv_open() */
+static const char *pasv_error_text(ftp_error_t err) {
+  switch (err) {
+  case FTP_ERR_SOCKET_CREATE:
+    return "Cannot create socket.";
+  case FTP_ERR_SOCKET_LISTEN:
+    return "Listen failed.";
+  default:
+    return "Bind failed.";
   }
+}
 
-  /* Listen */
-  if (PAL_LISTEN(fd, 1) < 0) {
-    PAL_CLOSE(fd);
-    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
-                                  "Listen failed.");
+/**
+ * @brief PASV command - Passive mode data connection
+ */
+ftp_error_t cmd_PASV(ftp_session_t *session, const char *args) {
+  (void)args; /* Unused */
+
+  if (session == NULL) {
+    return FTP_ERR_INVALID_PARAM;
   }
 
-  /* Get assigned port */
-  struct sockaddr_in pasv_addr;
-  socklen_t addr_len = sizeof(pasv_addr);
-  if (PAL_GETSOCKNAME(fd, (struct sockaddr *)&pasv_addr, &addr_len) < 0) {
-    PAL_CLOSE(fd);
+  uint32_t ip = 0U;
+  uint16_t port = 0U;
+  ftp_error_t err = pasv_open(session, &ip, &port);
+  if (err != FTP_OK) {
     return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
-                                  "Cannot get socket name.");
+                                  pasv_error_text(err));
   }
 
-  session->pasv_fd = fd;
-  session->data_mode = FTP_DATA_MODE_PASSIVE;
-
   /* Format reply: 227 Entering Passive Mode (h1,h2,h3,h4,p1,p2) */
   if (ip == 0U) {
-    ip = PAL_NTOHL(pasv_addr.sin_addr.s_addr);
+    struct sockaddr_in pasv_addr;
+    socklen_t addr_len = sizeof(pasv_addr);
+    if (PAL_GETSOCKNAME(session->pasv_fd, (struct sockaddr *)&pasv_addr,
+                        &addr_len) == 0) {
+      ip = PAL_NTOHL(pasv_addr.sin_addr.s_addr);
+    }
   }
-  uint16_t port = PAL_NTOHS(pasv_addr.sin_port);
 
   unsigned int h1 = (ip >> 24) & 0xFFU;
   unsigned int h2 = (ip >> 16) & 0xFFU;
@@ -2364,142 +2970,1434 @@ ftp_error_t cmd_EPSV(ftp_session_t *session, const char *args) {
     return FTP_ERR_INVALID_PARAM;
   }
 
-  /* Reuse PASV socket setup */
-  if (session->pasv_fd >= 0) {
-    PAL_CLOSE(session->pasv_fd);
-    session->pasv_fd = -1;
+  /* Same listener setup as PASV */
+  uint32_t ip = 0U;
+  uint16_t port = 0U;
+  ftp_error_t err = pasv_open(session, &ip, &port);
+  if (err != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
+                                  pasv_error_text(err));
+  }
+
+  /*
+   * RFC 2428: 229 Entering Extended Passive Mode (|||port|)
+   *
+   * The triple-pipe delimiter is protocol-agnostic (works for IPv4 + IPv6).
+   * The client already knows the server IP from the control connection.
+   */
+  char reply[FTP_REPLY_BUFFER_SIZE];
+  snprintf(reply, sizeof(reply), "Entering Extended Passive Mode (|||%u|).",
+           (unsigned)port);
+
+  return ftp_session_send_reply(session, FTP_REPLY_229_EPSV_MODE, reply);
+}
+
+/*---------------------------------------------------------------------------*
+ * OPTS  (RFC 2389 — Feature Negotiation)
+ *
+ *   Client:  OPTS UTF8 ON
+ *   Server:  200 UTF8 mode enabled.
+ *
+ *   Almost every modern client sends "OPTS UTF8 ON" right after FEAT.
+ *   Without this command, they get 500 Unknown Command → may disconnect.
+ *---------------------------------------------------------------------------*/
+
+ftp_error_t cmd_OPTS(ftp_session_t *session, const char *args) {
+  if (session == NULL) {
+    return FTP_ERR_INVALID_PARAM;
   }
 
-  int fd = PAL_SOCKET(AF_INET, SOCK_STREAM, 0);
-  if (fd < 0) {
-    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
-                                  "Cannot create socket.");
+  if (args == NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "OPTS requires an argument.");
   }
 
-  (void)pal_socket_set_reuseaddr(fd);
+  /* Case-insensitive check for "UTF8 ON" / "UTF8" / "utf8 on" */
+  char upper[64];
+  size_t len = strlen(args);
+  if (len >= sizeof(upper)) {
+    len = sizeof(upper) - 1U;
+  }
+  for (size_t i = 0U; i < len; i++) {
+    upper[i] = (char)toupper((unsigned char)args[i]);
+  }
+  upper[len] = '\0';
 
-  /* Set SO_RCVBUF on the listener — same rationale as cmd_PASV */
-  {
-    int rcvbuf = (int)FTP_TCP_RCVBUF;
-    (void)PAL_SETSOCKOPT(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  if ((strncmp(upper, "UTF8", 4) == 0) &&
+      (len == 4U || strcmp(upper + 4, " ON") == 0)) {
+    return ftp_session_send_reply(session, FTP_REPLY_200_OK,
+                                  "UTF8 mode enabled.");
   }
 
-  /* SO_SNDBUF intentionally NOT set — see cmd_PASV comment on auto-tuning. */
+  /*
+   *  OPTS MLST type*;size*;modify*;
+   *  Some clients send this to negotiate MLST facts.
+   *  Accept it silently.
+   */
+  if (strncmp(upper, "MLST", 4) == 0) {
+    return ftp_session_send_reply(session, FTP_REPLY_200_OK, "MLST OPTS set.");
+  }
 
-  /* Bind to the local IP of the control connection — not INADDR_ANY.
-   * Same rationale as cmd_PASV: on OrbisOS/FreeBSD, INADDR_ANY causes
-   * inbound SYNs to be silently dropped. */
-  uint32_t epsv_ip = 0U;
-  {
-    struct sockaddr_in local;
-    socklen_t local_len = (socklen_t)sizeof(local);
-    memset(&local, 0, sizeof(local));
-    if (PAL_GETSOCKNAME(session->ctrl_fd, (struct sockaddr *)&local,
-                        &local_len) == 0) {
-      epsv_ip = PAL_NTOHL(local.sin_addr.s_addr);
+#if FTP_ENABLE_HASH
+  /*
+   *  OPTS HASH            -> 200 SHA-256   (query)
+   *  OPTS HASH MD5        -> 200 MD5       (select)
+   */
+  if ((strncmp(upper, "HASH", 4) == 0) &&
+      ((upper[4] == '\0') || (upper[4] == ' '))) {
+    const char *name = args + 4;
+    while (*name == ' ') {
+      name++;
     }
+    if (*name != '\0') {
+      ftp_hash_algo_t algo;
+      if (ftp_hash_from_name(name, &algo) != 0) {
+        return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                      "Unknown algorithm.");
+      }
+      session->hash_algo = (uint8_t)algo;
+      session->hash_chosen = 1U;
+    }
+    return ftp_session_send_reply(
+        session, FTP_REPLY_200_OK,
+        ftp_hash_name((ftp_hash_algo_t)session->hash_algo));
   }
-  if (epsv_ip == 0U) {
-    char ip_str[INET_ADDRSTRLEN];
-    if (pal_network_get_primary_ip(ip_str, sizeof(ip_str)) == FTP_OK) {
-      struct in_addr ia;
-      if (PAL_INET_PTON(AF_INET, ip_str, &ia) == 1) {
-        epsv_ip = PAL_NTOHL(ia.s_addr);
+#endif
+
+  return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                "Option not recognized.");
+}
+
+/*---------------------------------------------------------------------------*
+ * SITE MRETR  (multi-file retrieval as one ustar stream)
+ *
+ *   Client:  PASV
+ *   Client:  SITE MRETR saves
+ *   Server:  150 Opening data connection for MRETR archive.
+ *            [hdr][body][pad] [hdr][body][pad] ... [2 zero blocks]
+ *   Server:  226 MRETR: 3200 files, 51200000 bytes, 0 skipped.
+ *
+ *   One data connection instead of PASV + RETR + 150/226 per file.
+ *   Arguments are files or directories (several allowed, space separated,
+ *   "quoted" when they contain spaces); each is confined by
+ *   ftp_path_resolve().  Directories are walked with lstat(): symlinks
+ *   and special files are skipped and the walk stays on the argument's
+ *   filesystem, so nothing outside the root is reachable.  Member names
+ *   are relative to the argument's parent ("saves/slot1.dat").
+ *
+ *   Bodies use sendfile when RETR would; headers are written between
+ *   them on the corked socket.  A file's size is fixed by its header: a
+ *   file that shrinks mid-transfer is zero-filled, one that grows is cut.
+ *---------------------------------------------------------------------------*/
+
+typedef struct {
+  ftp_session_t *session;
+  void *buf;
+  size_t buf_sz;
+  int use_sendfile; /* session allows sendfile (see cmd_RETR) */
+  int failed;       /* data connection broken                  */
+  dev_t dev;        /* filesystem of the current argument      */
+  uint64_t files;
+  uint64_t bytes;   /* archive bytes on the wire               */
+  uint64_t skipped;
+  size_t base;      /* member names start at path + base       */
+  char path[FTP_PATH_MAX];
+} mretr_t;
+
+static void mretr_send(mretr_t *mr, const void *data, size_t len) {
+  if ((mr->failed != 0) || (len == 0U)) {
+    return;
+  }
+  ssize_t sent = ftp_session_send_data(mr->session, data, len);
+  if ((sent < 0) || ((size_t)sent != len)) {
+    mr->failed = 1;
+    return;
+  }
+  mr->bytes += (uint64_t)len;
+}
+
+static void mretr_zeros(mretr_t *mr, uint64_t count) {
+  memset(mr->buf, 0, (count < mr->buf_sz) ? (size_t)count : mr->buf_sz);
+  while ((count > 0U) && (mr->failed == 0)) {
+    size_t n = (count < mr->buf_sz) ? (size_t)count : mr->buf_sz;
+    mretr_send(mr, mr->buf, n);
+    count -= n;
+  }
+}
+
+static int mretr_header(mretr_t *mr, ftp_tar_type_t type, uint64_t size,
+                        const struct stat *st) {
+  ftp_tar_member_t m;
+  m.name = mr->path + mr->base;
+  m.size = size;
+  m.mode = (uint32_t)st->st_mode;
+  m.mtime = (int64_t)st->st_mtime;
+  m.type = type;
+  if (m.name[0] == '\0') {
+    return 0; /* the session root itself has no entry */
+  }
+  size_t n = ftp_tar_header(mr->buf, mr->buf_sz, &m);
+  if (n == 0U) {
+    return -1;
+  }
+  mretr_send(mr, mr->buf, n);
+  return 0;
+}
+
+static void mretr_file(mretr_t *mr, const struct stat *st) {
+  vfs_node_t node;
+  if (vfs_open(&node, mr->path) != FTP_OK) {
+    mr->skipped++;
+    return;
+  }
+  uint64_t size = vfs_get_size(&node);
+  if (mretr_header(mr, FTP_TAR_FILE, size, st) != 0) {
+    vfs_close(&node);
+    mr->skipped++;
+    return;
+  }
+
+  uint64_t remaining = size;
+  if ((mr->use_sendfile != 0) &&
+      ((vfs_get_caps(&node) & VFS_CAP_SENDFILE) != 0U)) {
+    off_t offset = 0;
+    while ((remaining > 0U) && (mr->failed == 0)) {
+      size_t want = (remaining < (uint64_t)FTP_RETR_SENDFILE_CHUNK)
+                        ? (size_t)remaining
+                        : (size_t)FTP_RETR_SENDFILE_CHUNK;
+      ssize_t sent = xfer_sendfile(mr->session, node.fd, &offset, want);
+      if (sent <= 0) {
+        if ((sent < 0) && (errno == EINTR)) {
+          continue;
+        }
+        break; /* finish with read() */
+      }
+      remaining -= (uint64_t)sent;
+      mr->bytes += (uint64_t)sent;
+      atomic_fetch_add(&mr->session->stats.bytes_sent, (uint64_t)sent);
+    }
+    vfs_set_offset(&node, (uint64_t)offset);
+  }
+
+  while ((remaining > 0U) && (mr->failed == 0)) {
+    size_t want = (remaining < mr->buf_sz) ? (size_t)remaining : mr->buf_sz;
+    ssize_t n = vfs_read(&node, mr->buf, want);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
       }
+      break;
+    }
+    if (n == 0) {
+      break; /* shrank since the header was written */
     }
+    mretr_send(mr, mr->buf, (size_t)n);
+    remaining -= (uint64_t)n;
   }
+  vfs_close(&node);
 
-  struct sockaddr_in addr;
-  memset(&addr, 0, sizeof(addr));
-  addr.sin_family = AF_INET;
-  addr.sin_addr.s_addr = (epsv_ip != 0U) ? PAL_HTONL(epsv_ip) : PAL_HTONL(INADDR_ANY);
-  addr.sin_port = 0;
+  mretr_zeros(mr, remaining + ftp_tar_padding(size));
+  mr->files++;
+  mr->session->last_activity = time(NULL);
+}
 
-  if (PAL_BIND(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
-    PAL_CLOSE(fd);
-    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
-                                  "Bind failed.");
+static void mretr_walk(mretr_t *mr, const struct stat *st, uint32_t depth) {
+  if (mretr_header(mr, FTP_TAR_DIR, 0U, st) != 0) {
+    mr->skipped++;
+    return;
+  }
+  DIR *dir = opendir(mr->path);
+  if (dir == NULL) {
+    mr->skipped++;
+    return;
   }
 
-  if (PAL_LISTEN(fd, 1) < 0) {
-    PAL_CLOSE(fd);
-    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
-                                  "Listen failed.");
+  size_t len = strlen(mr->path);
+  size_t at = ((len > 0U) && (mr->path[len - 1U] == '/')) ? len : len + 1U;
+  struct dirent *entry;
+  while ((mr->failed == 0) && ((entry = readdir(dir)) != NULL)) {
+    const char *name = entry->d_name;
+    if ((strcmp(name, ".") == 0) || (strcmp(name, "..") == 0)) {
+      continue;
+    }
+    size_t name_len = strlen(name);
+    if ((at + name_len) >= sizeof(mr->path)) {
+      mr->skipped++;
+      continue;
+    }
+    mr->path[len] = '/';
+    memcpy(mr->path + at, name, name_len + 1U);
+
+    struct stat child;
+    if (lstat(mr->path, &child) != 0) {
+      mr->skipped++;
+    } else if (S_ISREG(child.st_mode)) {
+      mretr_file(mr, &child);
+    } else if (S_ISDIR(child.st_mode) && (child.st_dev == mr->dev) &&
+               (depth < FTP_MRETR_MAX_DEPTH)) {
+      mretr_walk(mr, &child, depth + 1U);
+    } else {
+      mr->skipped++; /* symlink, special file, mount point, too deep */
+    }
+    mr->path[len] = '\0';
   }
+  closedir(dir);
+}
 
-  struct sockaddr_in pasv_addr;
-  socklen_t addr_len = sizeof(pasv_addr);
-  if (PAL_GETSOCKNAME(fd, (struct sockaddr *)&pasv_addr, &addr_len) < 0) {
-    PAL_CLOSE(fd);
-    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA,
-                                  "Cannot get socket name.");
+/* Split off the next argument; "quotes" group words.  NULL when done. */
+static char *mretr_next_arg(char **cursor) {
+  char *p = *cursor;
+  while (*p == ' ') {
+    p++;
+  }
+  if (*p == '\0') {
+    return NULL;
+  }
+  char *start = p;
+  char end = ' ';
+  if (*p == '"') {
+    end = '"';
+    start = ++p;
+  }
+  while ((*p != '\0') && (*p != end)) {
+    p++;
   }
+  if (*p != '\0') {
+    *p++ = '\0';
+  }
+  *cursor = p;
+  return start;
+}
 
-  session->pasv_fd = fd;
-  session->data_mode = FTP_DATA_MODE_PASSIVE;
+static void mretr_arg(mretr_t *mr, const char *arg) {
+  if (ftp_path_resolve(mr->session, arg, mr->path, sizeof(mr->path)) !=
+      FTP_OK) {
+    mr->skipped++;
+    return;
+  }
+  struct stat st;
+  if (lstat(mr->path, &st) != 0) {
+    mr->skipped++;
+    return;
+  }
 
-  /*
-   * RFC 2428: 229 Entering Extended Passive Mode (|||port|)
-   *
-   * The triple-pipe delimiter is protocol-agnostic (works for IPv4 + IPv6).
-   * The client already knows the server IP from the control connection.
-   */
-  uint16_t port = PAL_NTOHS(pasv_addr.sin_port);
-  char reply[FTP_REPLY_BUFFER_SIZE];
-  snprintf(reply, sizeof(reply), "Entering Extended Passive Mode (|||%u|).",
-           (unsigned)port);
+  /* Name members from the argument's basename; the root has none */
+  size_t len = strlen(mr->path);
+  if ((strcmp(mr->path, mr->session->root_path) == 0) ||
+      (strcmp(mr->path, "/") == 0)) {
+    mr->base = (mr->path[len - 1U] == '/') ? len : len + 1U;
+  } else {
+    const char *slash = strrchr(mr->path, '/');
+    mr->base = (slash != NULL) ? (size_t)(slash - mr->path) + 1U : 0U;
+  }
 
-  return ftp_session_send_reply(session, FTP_REPLY_229_EPSV_MODE, reply);
+  mr->dev = st.st_dev;
+  if (S_ISREG(st.st_mode)) {
+    mretr_file(mr, &st);
+  } else if (S_ISDIR(st.st_mode)) {
+    mretr_walk(mr, &st, 0U);
+  } else {
+    mr->skipped++;
+  }
 }
 
-/*---------------------------------------------------------------------------*
- * OPTS  (RFC 2389 — Feature Negotiation)
+static ftp_error_t site_mretr(ftp_session_t *session, const char *args) {
+  while (*args == ' ') {
+    args++;
+  }
+  if (*args == '\0') {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "MRETR requires a path.");
+  }
+
+  /* One path that exists keeps its spaces; otherwise split the list */
+  char list[FTP_CMD_BUFFER_SIZE];
+  size_t args_len = strlen(args);
+  if (args_len >= sizeof(list)) {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "Argument list too long.");
+  }
+  memcpy(list, args, args_len + 1U);
+
+  mretr_t *mr = calloc(1U, sizeof(*mr));
+  if (mr == NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                  "Out of memory.");
+  }
+  mr->session = session;
+  int single = ((strchr(args, ' ') != NULL) &&
+                (ftp_path_resolve(session, args, mr->path,
+                                  sizeof(mr->path)) == FTP_OK) &&
+                (pal_path_exists(mr->path) == 1));
+
+  ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK,
+                         "Opening data connection for MRETR archive.");
+  ftp_error_t err = ftp_session_open_data_connection(session);
+  if (err == FTP_OK) {
+    err = xfer_start_data_tls(session);
+  }
+  if (err != FTP_OK) {
+    free(mr);
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
+
+  mr->buf = ftp_buffer_acquire();
+  mr->buf_sz = ftp_buffer_size();
+  if ((mr->buf == NULL) || (mr->buf_sz < (FTP_PATH_MAX + FTP_TAR_TRAILER +
+                                          FTP_TAR_BLOCK))) {
+    ftp_buffer_release(mr->buf);
+    ftp_session_close_data_connection(session);
+    free(mr);
+    return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                  "No transfer buffer.");
+  }
+
+  /* Same eligibility as cmd_RETR */
+  mr->use_sendfile = (session->transfer_mode == FTP_MODE_STREAM);
+#if FTP_ENABLE_CRYPTO
+  if (session->crypto.active != 0U) {
+    mr->use_sendfile = 0;
+  }
+#endif
+#if FTP_ENABLE_TLS
+  if ((session->data_tls != NULL) &&
+      (pal_tls_ktls_send(session->data_tls) == 0)) {
+    mr->use_sendfile = 0;
+  }
+#endif
+
+  pal_socket_cork(session->data_fd);
+  if (single != 0) {
+    mretr_arg(mr, args);
+  } else {
+    char *cursor = list;
+    char *arg;
+    while ((mr->failed == 0) && ((arg = mretr_next_arg(&cursor)) != NULL)) {
+      mretr_arg(mr, arg);
+    }
+  }
+  mretr_zeros(mr, FTP_TAR_TRAILER);
+  pal_socket_uncork(session->data_fd);
+
+  ftp_buffer_release(mr->buf);
+  ftp_session_close_data_connection(session);
+
+  char msg[128];
+  int failed = mr->failed;
+  uint64_t files = mr->files;
+  uint64_t bytes = mr->bytes;
+  (void)snprintf(msg, sizeof(msg), "MRETR: %llu files, %llu bytes, "
+                 "%llu skipped.", (unsigned long long)files,
+                 (unsigned long long)bytes,
+                 (unsigned long long)mr->skipped);
+  free(mr);
+
+  if (failed != 0) {
+    ftp_log_session_event(session, "MRETR_FAIL", FTP_ERR_UNKNOWN, bytes);
+    return ftp_session_send_reply(session, FTP_REPLY_426_TRANSFER_ABORTED,
+                                  "Transfer failed.");
+  }
+  atomic_fetch_add(&session->stats.files_sent, (uint32_t)files);
+  ftp_log_session_event(session, "MRETR_OK", FTP_OK, bytes);
+  return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, msg);
+}
+
+/*---------------------------------------------------------------------------*
+ * SITE MSTOR  (tar upload, unpacked as it arrives)
+ *
+ *   Client:  PASV
+ *   Client:  SITE MSTOR mods/patch1
+ *   Server:  150 Ready to receive MSTOR archive.
+ *   Client:  [tar stream] EOF
+ *   Server:  226 MSTOR: 812 files, 40 dirs, 73400320 bytes, 0 skipped.
+ *
+ *   The upload mirror of MRETR.  The target directory (default: CWD) must
+ *   exist; member paths are taken relative to it with leading '/' and
+ *   "." dropped.  A member with a ".." component, or whose parent path
+ *   crosses an existing symlink, is skipped, as are links and special
+ *   files, so nothing lands outside the target.
+ *
+ *   Each file takes the STOR route: temp name + rename() when atomic
+ *   (FTP_MSTOR_ATOMIC and the target's fs profile), blocks reserved from
+ *   the header size when it is at least FTP_MSTOR_PREALLOC_MIN and the
+ *   profile preallocates, written through pal_file_write_all().
+ *   Members completed before a failure are kept; the one in flight is
+ *   removed.
+ *---------------------------------------------------------------------------*/
+
+typedef struct {
+  ftp_session_t *session;
+  int fd;            /* member being written, -1 = none */
+  int saved_errno;
+  int fail_stage;    /* 2 = recv error, 3 = write error (as cmd_STOR) */
+  int64_t mtime;
+  uint64_t files;
+  uint64_t dirs;
+  uint64_t bytes;
+  uint64_t skipped;
+  size_t target_len;
+  int atomic;            /* FTP_MSTOR_ATOMIC and the target's fs profile */
+  uint32_t prealloc_min; /* 0 = never */
+  char dest[FTP_PATH_MAX];
+  char tmp[FTP_PATH_MAX];
+  ftp_tar_reader_t reader;
+} mstor_t;
+
+/*
+ * dest = target + "/" + sanitized member name.  Returns 0, 1 for a name
+ * that is empty after cleanup ("./"), or -1 for one that escapes with
+ * ".." or is too long.
+ */
+static int mstor_member_path(mstor_t *ms, const char *name) {
+  size_t at = ms->target_len;
+  const char *p = name;
+  while (*p != '\0') {
+    while (*p == '/') {
+      p++;
+    }
+    const char *end = strchr(p, '/');
+    size_t n = (end != NULL) ? (size_t)(end - p) : strlen(p);
+    if ((n == 1U) && (p[0] == '.')) {
+      p += n;
+      continue;
+    }
+    if ((n == 2U) && (p[0] == '.') && (p[1] == '.')) {
+      return -1;
+    }
+    if (n > 0U) {
+      if ((at + 1U + n) >= sizeof(ms->dest)) {
+        return -1;
+      }
+      ms->dest[at] = '/';
+      memcpy(ms->dest + at + 1U, p, n);
+      at += n + 1U;
+    }
+    p += n;
+  }
+  ms->dest[at] = '\0';
+  return (at > ms->target_len) ? 0 : 1;
+}
+
+/*
+ * Create the directories of dest below the target (all of dest when
+ * @p whole).  Existing components must be real directories.
+ */
+static int mstor_make_dirs(mstor_t *ms, int whole) {
+  size_t len = strlen(ms->dest);
+  for (size_t i = ms->target_len + 1U; i <= len; i++) {
+    if ((ms->dest[i] != '/') && ((ms->dest[i] != '\0') || (whole == 0))) {
+      continue;
+    }
+    char saved = ms->dest[i];
+    ms->dest[i] = '\0';
+    struct stat st;
+    int ok = 1;
+    if (lstat(ms->dest, &st) == 0) {
+      ok = S_ISDIR(st.st_mode) ? 1 : 0;
+    } else if (pal_dir_create(ms->dest, DIR_PERM) == FTP_OK) {
+      ftp_list_cache_invalidate(ms->dest);
+      ms->dirs++;
+    } else {
+      ok = 0;
+    }
+    ms->dest[i] = saved;
+    if (ok == 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static void mstor_discard(mstor_t *ms) {
+  if (ms->fd < 0) {
+    return;
+  }
+  pal_file_close(ms->fd);
+  ms->fd = -1;
+  (void)unlink((ms->atomic != 0) ? ms->tmp : ms->dest);
+}
+
+static int mstor_begin(void *ctx, const ftp_tar_entry_t *e) {
+  mstor_t *ms = (mstor_t *)ctx;
+  int is_file = ((e->type == '0') || (e->type == '7'));
+
+  int named = mstor_member_path(ms, e->name);
+  if ((named == 1) && (e->type == '5')) {
+    return 1; /* "./": the target itself */
+  }
+  if (((is_file == 0) && (e->type != '5')) || (named != 0) ||
+      (mstor_make_dirs(ms, (e->type == '5') ? 1 : 0) != 0)) {
+    ms->skipped++;
+    return 1;
+  }
+  if (is_file == 0) {
+    return 1; /* directory created above */
+  }
+
+  /* Never write through a symlink or over a directory */
+  struct stat st;
+  if ((lstat(ms->dest, &st) == 0) && !S_ISREG(st.st_mode)) {
+    ms->skipped++;
+    return 1;
+  }
+
+  const char *write_path = ms->dest;
+  if (ms->atomic != 0) {
+    stor_temp_path(ms->dest, ms->tmp, sizeof(ms->tmp));
+    write_path = ms->tmp;
+  }
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+  if (pfs_mutex_lock_timeout(&g_pfs_create_mtx, 10) != 0) {
+    ms->skipped++;
+    return 1;
+  }
+#endif
+  ms->fd = pal_file_open(write_path, O_WRONLY | O_CREAT | O_TRUNC, FILE_PERM);
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+  pthread_mutex_unlock(&g_pfs_create_mtx);
+#endif
+  if (ms->fd < 0) {
+    ms->skipped++;
+    return 1;
+  }
+
+  if ((ms->prealloc_min > 0U) && (e->size >= (uint64_t)ms->prealloc_min) &&
+      (pal_file_preallocate(ms->fd, (off_t)e->size) == FTP_ERR_FILE_WRITE)) {
+    ms->saved_errno = errno;
+    ms->fail_stage = 3;
+    mstor_discard(ms);
+    return FTP_ERR_FILE_WRITE; /* out of space: stop here */
+  }
+  ms->mtime = e->mtime;
+  return 0;
+}
+
+static int mstor_data(void *ctx, const void *buf, size_t len) {
+  mstor_t *ms = (mstor_t *)ctx;
+  if (pal_file_write_all(ms->fd, buf, len) != (ssize_t)len) {
+    ms->saved_errno = errno;
+    ms->fail_stage = 3;
+    mstor_discard(ms);
+    return FTP_ERR_FILE_WRITE;
+  }
+  ms->bytes += (uint64_t)len;
+  return 0;
+}
+
+static int mstor_end(void *ctx) {
+  mstor_t *ms = (mstor_t *)ctx;
+
+  /* Keep the archive's mtime, as tar does */
+  struct timespec times[2];
+  times[0].tv_sec = (time_t)ms->mtime;
+  times[0].tv_nsec = 0;
+  times[1] = times[0];
+  (void)futimens(ms->fd, times);
+  pal_file_close(ms->fd);
+  ms->fd = -1;
+
+  if ((ms->atomic != 0) && (rename(ms->tmp, ms->dest) != 0)) {
+    (void)unlink(ms->tmp);
+    ms->skipped++;
+    return 0;
+  }
+  ftp_list_cache_invalidate(ms->dest);
+  ms->files++;
+  ms->session->last_activity = time(NULL);
+  return 0;
+}
+
+static ftp_error_t site_mstor(ftp_session_t *session, const char *args) {
+  while (*args == ' ') {
+    args++;
+  }
+  mstor_t *ms = calloc(1U, sizeof(*ms));
+  if (ms == NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                  "Out of memory.");
+  }
+  ms->session = session;
+  ms->fd = -1;
+
+  struct stat st;
+  if ((ftp_path_resolve(session, (*args != '\0') ? args : ".", ms->dest,
+                        sizeof(ms->dest)) != FTP_OK) ||
+      (stat(ms->dest, &st) != 0) || !S_ISDIR(st.st_mode)) {
+    free(ms);
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Target is not a directory.");
+  }
+  ms->target_len = strlen(ms->dest);
+  if ((ms->target_len > 0U) && (ms->dest[ms->target_len - 1U] == '/')) {
+    ms->target_len--; /* "/" itself */
+  }
+
+  ftp_fs_profile_t prof;
+  ftp_fs_profile_for_path(ms->dest, &prof);
+  ms->atomic = ((FTP_MSTOR_ATOMIC != 0) && (prof.atomic_rename != 0U)) ? 1 : 0;
+  ms->prealloc_min = (prof.preallocate != 0U) ? FTP_MSTOR_PREALLOC_MIN : 0U;
+
+  ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK,
+                         "Ready to receive MSTOR archive.");
+  ftp_error_t err = ftp_session_open_data_connection(session);
+  if (err == FTP_OK) {
+    err = xfer_start_data_tls(session);
+  }
+  if (err != FTP_OK) {
+    free(ms);
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
+
+  ftp_tar_sink_t sink;
+  sink.begin = mstor_begin;
+  sink.data = mstor_data;
+  sink.end = mstor_end;
+  sink.ctx = ms;
+  ftp_tar_reader_init(&ms->reader, &sink);
+
+  void *buf = ftp_buffer_acquire();
+  size_t buf_sz = ftp_buffer_size();
+  err = (buf != NULL) ? FTP_OK : FTP_ERR_OUT_OF_MEMORY;
+  while (err == FTP_OK) {
+    ssize_t n = ftp_session_recv_data(session, buf, buf_sz);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ms->saved_errno = errno;
+      ms->fail_stage = 2;
+      err = FTP_ERR_SOCKET_RECV;
+      break;
+    }
+    if (n == 0) {
+      err = ftp_tar_reader_finish(&ms->reader);
+      break;
+    }
+    err = ftp_tar_reader_feed(&ms->reader, buf, (size_t)n);
+  }
+  ftp_buffer_release(buf);
+  mstor_discard(ms);
+  ftp_session_close_data_connection(session);
+
+  char msg[160];
+  uint64_t files = ms->files;
+  uint64_t bytes = ms->bytes;
+  if (err == FTP_OK) {
+    (void)snprintf(msg, sizeof(msg),
+                   "MSTOR: %llu files, %llu dirs, %llu bytes, %llu skipped.",
+                   (unsigned long long)files, (unsigned long long)ms->dirs,
+                   (unsigned long long)bytes,
+                   (unsigned long long)ms->skipped);
+  } else if (err == FTP_ERR_OUT_OF_MEMORY) {
+    (void)snprintf(msg, sizeof(msg), "No transfer buffer.");
+  } else if (ms->fail_stage == 2) {
+    (void)snprintf(msg, sizeof(msg),
+                   "Transfer failed: network receive error (errno=%d).",
+                   ms->saved_errno);
+  } else if (ms->fail_stage == 3) {
+    (void)snprintf(msg, sizeof(msg),
+                   "Transfer failed: disk write error (errno=%d).",
+                   ms->saved_errno);
+  } else {
+    (void)snprintf(msg, sizeof(msg),
+                   "Transfer failed: bad archive after %llu files.",
+                   (unsigned long long)files);
+  }
+  free(ms);
+
+  atomic_fetch_add(&session->stats.files_received, (uint32_t)files);
+  if (err != FTP_OK) {
+    ftp_log_session_event(session, "MSTOR_FAIL", err, bytes);
+    return ftp_session_send_reply(session, FTP_REPLY_426_TRANSFER_ABORTED,
+                                  msg);
+  }
+  ftp_log_session_event(session, "MSTOR_OK", FTP_OK, bytes);
+  return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, msg);
+}
+
+/*---------------------------------------------------------------------------*
+ * SITE DELTA SIG|PUT <path>  (rsync-style delta upload, ftp_delta.h)
+ *
+ *   Client:  PASV
+ *   Client:  SITE DELTA SIG images/disk.img
+ *   Server:  150 Opening data connection for DELTA signature.
+ *            [signature]
+ *   Server:  226 DELTA SIG: 163840 blocks of 262144 bytes (cached).
+ *
+ *   Client:  PASV
+ *   Client:  SITE DELTA PUT images/disk.img
+ *   Server:  150 Ready to receive DELTA stream.
+ *   Client:  [delta] EOF
+ *   Server:  226 DELTA: 42991616 literal, 42906999808 copied bytes.
+ *
+ *   PUT rebuilds the file beside the original under its STOR temp name:
+ *   copied blocks with copy_file_range(), literals with write().  The
+ *   result is read back once to check the client's SHA-256 and to sign
+ *   it for the next round, flushed as the fs profile says, and renamed
+ *   over the original, keeping its mode.  A delta made for another
+ *   version (size or mtime differ from the signature) is refused.  The
+ *   digest goes into the HASH index, so HASH right after is free.
+ *---------------------------------------------------------------------------*/
+
+typedef struct {
+  ftp_session_t *session; /* NULL = cache only (PUT re-sign) */
+  int cache_fd;           /* -1 = not caching                */
+  int cache_ok;
+  int failed;             /* data connection broken          */
+} delta_sig_out_t;
+
+static int delta_sig_emit(void *ctx, const void *data, size_t len) {
+  delta_sig_out_t *o = (delta_sig_out_t *)ctx;
+  if ((o->cache_fd >= 0) && (o->cache_ok != 0) &&
+      (pal_file_write_all(o->cache_fd, data, len) != (ssize_t)len)) {
+    o->cache_ok = 0;
+  }
+  if (o->session != NULL) {
+    ssize_t sent = ftp_session_send_data(o->session, data, len);
+    if ((sent < 0) || ((size_t)sent != len)) {
+      o->failed = 1;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static ftp_error_t delta_sig(ftp_session_t *session, const char *resolved) {
+  int fd = pal_file_open(resolved, O_RDONLY, 0);
+  struct stat st;
+  if ((fd < 0) || (fstat(fd, &st) != 0) || !S_ISREG(st.st_mode)) {
+    if (fd >= 0) {
+      pal_file_close(fd);
+    }
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Not a readable plain file.");
+  }
+  ftp_delta_basis_t basis;
+  basis.size = (uint64_t)st.st_size;
+  basis.mtime = (int64_t)st.st_mtime;
+  basis.block_size = ftp_delta_block_size(basis.size);
+
+  ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK,
+                         "Opening data connection for DELTA signature.");
+  ftp_error_t err = ftp_session_open_data_connection(session);
+  if (err == FTP_OK) {
+    err = xfer_start_data_tls(session);
+  }
+  if (err != FTP_OK) {
+    pal_file_close(fd);
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
+
+  void *buf = ftp_buffer_acquire();
+  size_t buf_sz = ftp_buffer_size();
+  delta_sig_out_t out;
+  out.session = session;
+  out.cache_fd = -1;
+  out.cache_ok = 1;
+  out.failed = 0;
+  int rc = -1;
+  int cached = 0;
+
+  int cfd = ftp_delta_sig_cache_open(resolved, &basis);
+  if ((buf != NULL) && (cfd >= 0)) {
+    cached = 1;
+    for (;;) {
+      ssize_t n = pal_file_read(cfd, buf, buf_sz);
+      if (n <= 0) {
+        rc = (n == 0) ? 0 : -1;
+        break;
+      }
+      if (delta_sig_emit(&out, buf, (size_t)n) != 0) {
+        break;
+      }
+    }
+  } else if (buf != NULL) {
+    char tmp[FTP_PATH_MAX];
+    if (basis.size >= FTP_DELTA_SIG_CACHE_MIN) {
+      out.cache_fd = ftp_delta_sig_cache_create(resolved, tmp, sizeof(tmp));
+    }
+    rc = ftp_delta_sig_fd(fd, &basis, buf, buf_sz, delta_sig_emit, &out, NULL);
+    /* Only a signature of a file that held still is worth keeping */
+    struct stat after;
+    int still = ((fstat(fd, &after) == 0) && (after.st_size == st.st_size) &&
+                 (after.st_mtime == st.st_mtime));
+    ftp_delta_sig_cache_commit(resolved, out.cache_fd, tmp,
+                               ((rc == 0) && (out.cache_ok != 0) &&
+                                (still != 0))
+                                   ? 1
+                                   : 0);
+  }
+  if (cfd >= 0) {
+    pal_file_close(cfd);
+  }
+  ftp_buffer_release(buf);
+  ftp_session_close_data_connection(session);
+  pal_file_close(fd);
+
+  if (rc != 0) {
+    return ftp_session_send_reply(session, (out.failed != 0)
+                                               ? FTP_REPLY_426_TRANSFER_ABORTED
+                                               : FTP_REPLY_451_LOCAL_ERROR,
+                                  "DELTA signature failed.");
+  }
+  char msg[128];
+  (void)snprintf(msg, sizeof(msg), "DELTA SIG: %llu blocks of %u bytes%s.",
+                 (unsigned long long)ftp_delta_block_count(&basis),
+                 (unsigned)basis.block_size, (cached != 0) ? " (cached)" : "");
+  return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, msg);
+}
+
+typedef struct {
+  int basis_fd;
+  int fd;            /* temp file being rebuilt */
+  int saved_errno;
+  int fail_stage;    /* 2 recv, 3 write, 4 stale basis, 5 digest mismatch */
+  int prealloc;
+  void *bounce;      /* copies where copy_file_range() is refused */
+  size_t bounce_sz;
+  ftp_delta_basis_t basis;
+  uint64_t literal;
+  uint64_t copied;
+  uint8_t digest[32];
+} delta_put_t;
+
+static int delta_put_begin(void *ctx, const ftp_delta_header_t *h) {
+  delta_put_t *dp = (delta_put_t *)ctx;
+  if ((h->basis.block_size != dp->basis.block_size) ||
+      (h->basis.size != dp->basis.size) ||
+      (h->basis.mtime != dp->basis.mtime)) {
+    dp->fail_stage = 4;
+    return FTP_ERR_PROTOCOL;
+  }
+  if ((dp->prealloc != 0) && (h->result_size > 0U) &&
+      (pal_file_preallocate(dp->fd, (off_t)h->result_size) ==
+       FTP_ERR_FILE_WRITE)) {
+    dp->saved_errno = errno;
+    dp->fail_stage = 3;
+    return FTP_ERR_FILE_WRITE;
+  }
+  return 0;
+}
+
+static int delta_put_copy(void *ctx, uint64_t offset, uint64_t len) {
+  delta_put_t *dp = (delta_put_t *)ctx;
+  if (ftp_delta_copy(dp->basis_fd, offset, dp->fd, len, dp->bounce,
+                     dp->bounce_sz) != 0) {
+    dp->saved_errno = errno;
+    dp->fail_stage = 3;
+    return FTP_ERR_FILE_WRITE;
+  }
+  dp->copied += len;
+  return 0;
+}
+
+static int delta_put_data(void *ctx, const void *buf, size_t len) {
+  delta_put_t *dp = (delta_put_t *)ctx;
+  if (pal_file_write_all(dp->fd, buf, len) != (ssize_t)len) {
+    dp->saved_errno = errno;
+    dp->fail_stage = 3;
+    return FTP_ERR_FILE_WRITE;
+  }
+  dp->literal += (uint64_t)len;
+  return 0;
+}
+
+static int delta_put_end(void *ctx, const uint8_t sha256[32]) {
+  delta_put_t *dp = (delta_put_t *)ctx;
+  memcpy(dp->digest, sha256, sizeof(dp->digest));
+  return 0;
+}
+
+/*
+ * Read the rebuilt file back: SHA-256 against the client's, and the
+ * signature of the new version into the cache.  Returns 0 on a match.
+ */
+static int delta_put_verify(delta_put_t *dp, const char *resolved,
+                            void *buf, size_t buf_sz, struct stat *st) {
+  if (fstat(dp->fd, st) != 0) {
+    dp->saved_errno = errno;
+    dp->fail_stage = 3;
+    return -1;
+  }
+  ftp_delta_basis_t next;
+  next.size = (uint64_t)st->st_size;
+  next.mtime = (int64_t)st->st_mtime;
+  next.block_size = ftp_delta_block_size(next.size);
+
+  delta_sig_out_t out;
+  char tmp[FTP_PATH_MAX];
+  out.session = NULL;
+  out.cache_ok = 1;
+  out.failed = 0;
+  out.cache_fd = (next.size >= FTP_DELTA_SIG_CACHE_MIN)
+                     ? ftp_delta_sig_cache_create(resolved, tmp, sizeof(tmp))
+                     : -1;
+
+  ftp_hash_ctx_t whole;
+  uint8_t digest[FTP_HASH_MAX_DIGEST];
+  ftp_hash_init(&whole, FTP_HASH_SHA256);
+  int rc = ftp_delta_sig_fd(dp->fd, &next, buf, buf_sz, delta_sig_emit, &out,
+                            &whole);
+  ftp_hash_final(&whole, digest);
+  if (rc != 0) {
+    dp->saved_errno = errno;
+    dp->fail_stage = 3;
+  } else if (memcmp(digest, dp->digest, sizeof(dp->digest)) != 0) {
+    dp->fail_stage = 5;
+    rc = -1;
+  }
+  /* Published now, found once the rename below makes it current */
+  ftp_delta_sig_cache_commit(resolved, out.cache_fd, tmp,
+                             ((rc == 0) && (out.cache_ok != 0)) ? 1 : 0);
+  return rc;
+}
+
+static ftp_error_t delta_put(ftp_session_t *session, const char *resolved) {
+  delta_put_t *dp = calloc(1U, sizeof(*dp));
+  if (dp == NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                  "Out of memory.");
+  }
+  dp->fd = -1;
+
+  struct stat st;
+  dp->basis_fd = pal_file_open(resolved, O_RDONLY, 0);
+  if ((dp->basis_fd < 0) || (fstat(dp->basis_fd, &st) != 0) ||
+      !S_ISREG(st.st_mode)) {
+    if (dp->basis_fd >= 0) {
+      pal_file_close(dp->basis_fd);
+    }
+    free(dp);
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Not a readable plain file.");
+  }
+  dp->basis.size = (uint64_t)st.st_size;
+  dp->basis.mtime = (int64_t)st.st_mtime;
+  dp->basis.block_size = ftp_delta_block_size(dp->basis.size);
+
+  ftp_fs_profile_t prof;
+  ftp_fs_profile_for_path(resolved, &prof);
+  dp->prealloc = (prof.preallocate != 0U) ? 1 : 0;
+
+  char tmp_path[FTP_PATH_MAX];
+  stor_temp_path(resolved, tmp_path, sizeof(tmp_path));
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+  if (pfs_mutex_lock_timeout(&g_pfs_create_mtx, 10) != 0) {
+    pal_file_close(dp->basis_fd);
+    free(dp);
+    return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                  "Server busy, please retry.");
+  }
+#endif
+  dp->fd = pal_file_open(tmp_path, O_RDWR | O_CREAT | O_TRUNC, FILE_PERM);
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+  pthread_mutex_unlock(&g_pfs_create_mtx);
+#endif
+  if (dp->fd < 0) {
+    pal_file_close(dp->basis_fd);
+    free(dp);
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Cannot create file.");
+  }
+  (void)fchmod(dp->fd, st.st_mode & 07777);
+
+  ftp_session_send_reply(session, FTP_REPLY_150_FILE_OK,
+                         "Ready to receive DELTA stream.");
+  ftp_error_t err = ftp_session_open_data_connection(session);
+  if (err == FTP_OK) {
+    err = xfer_start_data_tls(session);
+  }
+  if (err != FTP_OK) {
+    pal_file_close(dp->fd);
+    (void)unlink(tmp_path);
+    pal_file_close(dp->basis_fd);
+    free(dp);
+    return ftp_session_send_reply(session, FTP_REPLY_425_CANT_OPEN_DATA, NULL);
+  }
+
+  ftp_delta_sink_t sink;
+  sink.begin = delta_put_begin;
+  sink.copy = delta_put_copy;
+  sink.data = delta_put_data;
+  sink.end = delta_put_end;
+  sink.ctx = dp;
+  ftp_delta_reader_t reader;
+  ftp_delta_reader_init(&reader, &sink);
+
+  void *buf = ftp_buffer_acquire();
+  size_t buf_sz = ftp_buffer_size();
+  dp->bounce = ftp_buffer_acquire();
+  dp->bounce_sz = buf_sz;
+  err = ((buf != NULL) && (dp->bounce != NULL)) ? FTP_OK
+                                                : FTP_ERR_OUT_OF_MEMORY;
+  while (err == FTP_OK) {
+    ssize_t n = ftp_session_recv_data(session, buf, buf_sz);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      dp->saved_errno = errno;
+      dp->fail_stage = 2;
+      err = FTP_ERR_SOCKET_RECV;
+      break;
+    }
+    if (n == 0) {
+      err = ftp_delta_reader_finish(&reader);
+      break;
+    }
+    err = ftp_delta_reader_feed(&reader, buf, (size_t)n);
+  }
+  ftp_session_close_data_connection(session);
+
+  struct stat result;
+  if ((err == FTP_OK) &&
+      (delta_put_verify(dp, resolved, buf, buf_sz, &result) != 0)) {
+    err = FTP_ERR_FILE_WRITE;
+  }
+  ftp_buffer_release(dp->bounce);
+  ftp_buffer_release(buf);
+  pal_file_close(dp->basis_fd);
+  if (err == FTP_OK) {
+    stor_flush(dp->fd, (int)prof.sync_policy);
+  }
+  pal_file_close(dp->fd);
+  if ((err == FTP_OK) && (rename(tmp_path, resolved) != 0)) {
+    dp->saved_errno = errno;
+    dp->fail_stage = 3;
+    err = FTP_ERR_FILE_WRITE;
+  }
+  if (err != FTP_OK) {
+    (void)unlink(tmp_path);
+  }
+
+  char msg[160];
+  uint64_t literal = dp->literal;
+  if (err == FTP_OK) {
+    ftp_hash_cache_store(resolved, FTP_HASH_SHA256, (uint64_t)result.st_size,
+                         (int64_t)result.st_mtime, dp->digest);
+    ftp_list_cache_invalidate(resolved);
+    (void)snprintf(msg, sizeof(msg), "DELTA: %llu literal, %llu copied bytes.",
+                   (unsigned long long)literal,
+                   (unsigned long long)dp->copied);
+  } else if (err == FTP_ERR_OUT_OF_MEMORY) {
+    (void)snprintf(msg, sizeof(msg), "No transfer buffer.");
+  } else if (dp->fail_stage == 2) {
+    (void)snprintf(msg, sizeof(msg),
+                   "Transfer failed: network receive error (errno=%d).",
+                   dp->saved_errno);
+  } else if (dp->fail_stage == 3) {
+    (void)snprintf(msg, sizeof(msg),
+                   "Transfer failed: disk write error (errno=%d).",
+                   dp->saved_errno);
+  } else if (dp->fail_stage == 4) {
+    (void)snprintf(msg, sizeof(msg),
+                   "File changed since its signature; run DELTA SIG again.");
+  } else if (dp->fail_stage == 5) {
+    (void)snprintf(msg, sizeof(msg), "Transfer failed: result digest "
+                                     "mismatch.");
+  } else {
+    (void)snprintf(msg, sizeof(msg), "Transfer failed: bad delta stream.");
+  }
+  free(dp);
+
+  if (err != FTP_OK) {
+    ftp_log_session_event(session, "DELTA_FAIL", err, literal);
+    return ftp_session_send_reply(session, FTP_REPLY_426_TRANSFER_ABORTED,
+                                  msg);
+  }
+  atomic_fetch_add(&session->stats.files_received, 1U);
+  ftp_log_session_event(session, "DELTA_OK", FTP_OK, literal);
+  return ftp_session_send_reply(session, FTP_REPLY_226_TRANSFER_COMPLETE, msg);
+}
+
+static ftp_error_t site_delta(ftp_session_t *session, const char *args) {
+  while (*args == ' ') {
+    args++;
+  }
+  int put = (strncasecmp(args, "PUT ", 4) == 0);
+  if ((put == 0) && (strncasecmp(args, "SIG ", 4) != 0)) {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "Usage: SITE DELTA SIG|PUT <path>.");
+  }
+  args += 4;
+  while (*args == ' ') {
+    args++;
+  }
+
+  char resolved[FTP_PATH_MAX];
+  if ((*args == '\0') ||
+      (ftp_path_resolve(session, args, resolved, sizeof(resolved)) !=
+       FTP_OK)) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Invalid path.");
+  }
+  return (put != 0) ? delta_put(session, resolved)
+                    : delta_sig(session, resolved);
+}
+
+/*---------------------------------------------------------------------------*
+ * SITE BWLIMIT  (bandwidth scheduler)
+ *
+ *   Client:  SITE BWLIMIT
+ *   Server:  200 global=0 ip=0 session=0 (bytes/sec, 0 = unlimited)
+ *
+ *   Client:  SITE BWLIMIT GLOBAL 20M
+ *   Server:  200 BWLIMIT global set to 20971520 bytes/sec.
+ *
+ *   Levels: GLOBAL (whole server), IP (each client address), SESSION
+ *   (each control connection).  Rates take K/M/G suffixes (1024-based);
+ *   0 or OFF lifts the limit.  Changes apply to transfers in progress.
+ *---------------------------------------------------------------------------*/
+
+static ftp_error_t site_bwlimit(ftp_session_t *session, const char *args) {
+  char reply[FTP_REPLY_BUFFER_SIZE];
+
+  while (*args == ' ') {
+    args++;
+  }
+  if (*args == '\0') {
+    (void)snprintf(reply, sizeof(reply),
+                   "global=%llu ip=%llu session=%llu (bytes/sec, 0 = "
+                   "unlimited)",
+                   (unsigned long long)ftp_bw_get_rate(FTP_BW_GLOBAL),
+                   (unsigned long long)ftp_bw_get_rate(FTP_BW_PER_IP),
+                   (unsigned long long)ftp_bw_get_rate(FTP_BW_SESSION));
+    return ftp_session_send_reply(session, FTP_REPLY_200_OK, reply);
+  }
+
+  char level[16];
+  char rate_text[32];
+  size_t n = 0U;
+  while ((args[n] != ' ') && (args[n] != '\0') && (n < (sizeof(level) - 1U))) {
+    level[n] = (char)toupper((unsigned char)args[n]);
+    n++;
+  }
+  level[n] = '\0';
+  const char *p = args + n;
+  while (*p == ' ') {
+    p++;
+  }
+  size_t rl = strlen(p);
+  while ((rl > 0U) && (p[rl - 1U] == ' ')) {
+    rl--;
+  }
+
+  ftp_bw_scope_t scope;
+  if (strcmp(level, "GLOBAL") == 0) {
+    scope = FTP_BW_GLOBAL;
+  } else if (strcmp(level, "IP") == 0) {
+    scope = FTP_BW_PER_IP;
+  } else if (strcmp(level, "SESSION") == 0) {
+    scope = FTP_BW_SESSION;
+  } else {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "Usage: SITE BWLIMIT [GLOBAL|IP|SESSION "
+                                  "<bytes/sec>].");
+  }
+
+  uint64_t bps = 0U;
+  if ((rl == 0U) || (rl >= sizeof(rate_text))) {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "Missing or invalid rate.");
+  }
+  memcpy(rate_text, p, rl);
+  rate_text[rl] = '\0';
+  if (ftp_bw_parse_rate(rate_text, &bps) != 0) {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "Missing or invalid rate.");
+  }
+
+  ftp_bw_set_rate(scope, bps);
+  (void)snprintf(reply, sizeof(reply), "BWLIMIT %s set to %llu bytes/sec.",
+                 ftp_bw_scope_name(scope), (unsigned long long)bps);
+  ftp_log_line(FTP_LOG_INFO, reply);
+  return ftp_session_send_reply(session, FTP_REPLY_200_OK, reply);
+}
+
+/*---------------------------------------------------------------------------*
+ * SITE FXP  — show the FXP allow-list (ftp_fxp.h)
+ *
+ *   200 FXP allow: 192.168.1.20,10.0.0.0/24
+ *
+ *   Listed hosts may be a PORT target and may connect to this session's
+ *   passive listener in place of the client.  Read-only: the list lifts
+ *   bounce protection for every session, so no client may change it.
+ *---------------------------------------------------------------------------*/
+
+static ftp_error_t site_fxp(ftp_session_t *session, const char *args) {
+  char list[256];
+  char reply[FTP_REPLY_BUFFER_SIZE];
+
+  while (*args == ' ') {
+    args++;
+  }
+  if (*args != '\0') {
+    return ftp_session_send_reply(session, FTP_REPLY_504_NOT_IMPL_PARAM,
+                                  "FXP allow-list is set by FTP_FXP_ALLOW.");
+  }
+
+  ftp_fxp_format(list, sizeof(list));
+  (void)snprintf(reply, sizeof(reply), "FXP allow: %s", list);
+  return ftp_session_send_reply(session, FTP_REPLY_200_OK, reply);
+}
+
+/*---------------------------------------------------------------------------*
+ * SITE TRACE [n]  — this session's last n transfer timelines (default 1)
+ *
+ *   200-RETR /data/big.bin ok 1073741824B 9120.4ms
+ *   200- +0.2ms open 0.2ms
+ *   200- +3.9ms connect 3.6ms
+ *   200- +4.0ms first-byte
+ *   200- +4.0ms sendfile 9113.0ms 1073741824B x4096
+ *   200- +9117.8ms close 1073741824B
+ *   200 End
+ *---------------------------------------------------------------------------*/
+
+#define SITE_TRACE_MAX 4U
+
+static ftp_error_t site_trace(ftp_session_t *session, const char *args) {
+  while (*args == ' ') {
+    args++;
+  }
+  unsigned long want = 1UL;
+  if (*args != '\0') {
+    char *end = NULL;
+    want = strtoul(args, &end, 10);
+    if ((end == args) || (want == 0UL)) {
+      return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                    "Usage: SITE TRACE [count].");
+    }
+  }
+  if (want > SITE_TRACE_MAX) {
+    want = SITE_TRACE_MAX;
+  }
+
+  ftp_trace_t *traces = malloc(sizeof(ftp_trace_t) * SITE_TRACE_MAX);
+  size_t max_lines = (SITE_TRACE_MAX * (FTP_TRACE_EVENTS + 1U)) + 1U;
+  char *text = malloc(max_lines * 128U);
+  const char **lines = malloc(max_lines * sizeof(*lines));
+  if ((traces == NULL) || (text == NULL) || (lines == NULL)) {
+    free(traces);
+    free(text);
+    free(lines);
+    return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                  "Out of memory.");
+  }
+
+  size_t n = ftp_trace_recent(session->session_id, traces, (size_t)want);
+  size_t nl = 0U;
+  for (size_t i = 0U; i < n; i++) {
+    const ftp_trace_t *t = &traces[i];
+    const ftp_trace_event_t *last = &t->ev[t->events - 1U];
+    char *line = text + (nl * 128U);
+    int w = snprintf(line, 128U, "%s %s %s %lluB %.1fms", t->cmd, t->path,
+                     (t->ok != 0U) ? "ok" : "failed",
+                     (unsigned long long)last->bytes,
+                     (double)last->at_us / 1000.0);
+    if ((t->dropped != 0U) && (w > 0) && ((size_t)w < 128U)) {
+      (void)snprintf(line + w, 128U - (size_t)w, " (+%u events dropped)",
+                     (unsigned)t->dropped);
+    }
+    lines[nl++] = line;
+    for (size_t e = 0U; e < t->events; e++) {
+      line = text + (nl * 128U);
+      line[0] = ' ';
+      (void)ftp_trace_format_event(&t->ev[e], line + 1, 127U);
+      lines[nl++] = line;
+    }
+  }
+  lines[nl++] = (n == 0U) ? "No transfers traced yet." : "End";
+
+  ftp_error_t err = ftp_session_send_multiline_reply(session, FTP_REPLY_200_OK,
+                                                     lines, nl);
+  free(traces);
+  free(text);
+  free(lines);
+  return err;
+}
+
+/*---------------------------------------------------------------------------*
+ * SITE MOUNT / SITE UMOUNT  (exFAT images served in place)
  *
- *   Client:  OPTS UTF8 ON
- *   Server:  200 UTF8 mode enabled.
+ *   Client:  SITE MOUNT games.exfat games
+ *   Server:  200 Mounted games.exfat read-only.
+ *   Client:  CWD games
+ *   Client:  RETR CUSA00001/eboot.bin      (read from the image's extents)
+ *   Client:  SITE UMOUNT games
  *
- *   Almost every modern client sends "OPTS UTF8 ON" right after FEAT.
- *   Without this command, they get 500 Unknown Command → may disconnect.
+ *   The mount point must not exist yet; it is not shown in its parent's
+ *   listing.  Both arguments are confined by ftp_path_resolve() and may
+ *   be "quoted".  Mounts are server-wide and last until SITE UMOUNT.
  *---------------------------------------------------------------------------*/
 
-ftp_error_t cmd_OPTS(ftp_session_t *session, const char *args) {
-  if (session == NULL) {
-    return FTP_ERR_INVALID_PARAM;
+static ftp_error_t site_mount(ftp_session_t *session, const char *args,
+                              int mount) {
+  char list[FTP_CMD_BUFFER_SIZE];
+  size_t args_len = strlen(args);
+  if (args_len >= sizeof(list)) {
+    return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
+                                  "Argument list too long.");
   }
+  memcpy(list, args, args_len + 1U);
 
-  if (args == NULL) {
+  char *cursor = list;
+  char *first = mretr_next_arg(&cursor);
+  char *second = (mount != 0) ? mretr_next_arg(&cursor) : first;
+  if ((first == NULL) || (second == NULL) ||
+      (mretr_next_arg(&cursor) != NULL)) {
     return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
-                                  "OPTS requires an argument.");
+                                  (mount != 0)
+                                      ? "Usage: SITE MOUNT <image> <dir>."
+                                      : "Usage: SITE UMOUNT <dir>.");
   }
 
-  /* Case-insensitive check for "UTF8 ON" / "UTF8" / "utf8 on" */
-  char upper[64];
-  size_t len = strlen(args);
-  if (len >= sizeof(upper)) {
-    len = sizeof(upper) - 1U;
+  char at[FTP_PATH_MAX];
+  if (ftp_path_resolve(session, second, at, sizeof(at)) != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Invalid path.");
   }
-  for (size_t i = 0U; i < len; i++) {
-    upper[i] = (char)toupper((unsigned char)args[i]);
+  if (mount == 0) {
+    if (vfs_unmount_image(at) != FTP_OK) {
+      return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                    "Not a mount point.");
+    }
+    return ftp_session_send_reply(session, FTP_REPLY_200_OK, "Unmounted.");
   }
-  upper[len] = '\0';
 
-  if ((strncmp(upper, "UTF8", 4) == 0) &&
-      (len == 4U || strcmp(upper + 4, " ON") == 0)) {
-    return ftp_session_send_reply(session, FTP_REPLY_200_OK,
-                                  "UTF8 mode enabled.");
+  char image[FTP_PATH_MAX];
+  if (ftp_path_resolve(session, first, image, sizeof(image)) != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Invalid path.");
   }
-
-  /*
-   *  OPTS MLST type*;size*;modify*;
-   *  Some clients send this to negotiate MLST facts.
-   *  Accept it silently.
-   */
-  if (strncmp(upper, "MLST", 4) == 0) {
-    return ftp_session_send_reply(session, FTP_REPLY_200_OK, "MLST OPTS set.");
+  ftp_error_t err = vfs_mount_image(image, at);
+  const char *why = NULL;
+  switch (err) {
+  case FTP_OK:
+    break;
+  case FTP_ERR_DIR_EXISTS:
+    why = "Mount point exists or overlaps a mount.";
+    break;
+  case FTP_ERR_MAX_SESSIONS:
+    why = "Too many images mounted.";
+    break;
+  case FTP_ERR_FILE_OPEN:
+    why = "Not a readable exFAT image.";
+    break;
+  case FTP_ERR_FILE_READ:
+    why = "Image directory tree unreadable or too large.";
+    break;
+  default:
+    why = "Cannot mount image.";
+    break;
+  }
+  if (why != NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR, why);
   }
 
-  return ftp_session_send_reply(session, FTP_REPLY_501_SYNTAX_ARGS,
-                                "Option not recognized.");
+  char reply[FTP_REPLY_BUFFER_SIZE];
+  (void)snprintf(reply, sizeof(reply), "Mounted %.200s read-only.", first);
+  ftp_log_line(FTP_LOG_INFO, reply);
+  return ftp_session_send_reply(session, FTP_REPLY_200_OK, reply);
 }
 
 /*---------------------------------------------------------------------------*
@@ -2510,6 +4408,11 @@ ftp_error_t cmd_OPTS(ftp_session_t *session, const char *args) {
  *
  *   WinSCP sends SITE CHMOD after every upload. Without this
  *   command the client logs errors and some abort the transfer.
+ *
+ *   SITE MRETR <path...> streams many files as one tar, SITE MSTOR [dir]
+ *   unpacks one, SITE BWLIMIT shows or sets bandwidth limits, SITE TRACE
+ *   shows recent transfer timelines, SITE MOUNT / UMOUNT attach and
+ *   detach exFAT images (see above).
  *---------------------------------------------------------------------------*/
 
 ftp_error_t cmd_SITE(ftp_session_t *session, const char *args) {
@@ -2525,8 +4428,8 @@ ftp_error_t cmd_SITE(ftp_session_t *session, const char *args) {
   /* Accept CHMOD as a no-op (console filesystems don't use UNIX perms) */
   char upper[16];
   size_t len = strlen(args);
-  if (len > 5U) {
-    len = 5U;
+  if (len > 7U) {
+    len = 7U;
   }
   for (size_t i = 0U; i < len; i++) {
     upper[i] = (char)toupper((unsigned char)args[i]);
@@ -2538,6 +4441,46 @@ ftp_error_t cmd_SITE(ftp_session_t *session, const char *args) {
                                   "CHMOD command successful.");
   }
 
+  if ((strncmp(upper, "MRETR", 5) == 0) &&
+      ((args[5] == ' ') || (args[5] == '\0'))) {
+    return site_mretr(session, args + 5);
+  }
+
+  if ((strncmp(upper, "MSTOR", 5) == 0) &&
+      ((args[5] == ' ') || (args[5] == '\0'))) {
+    return site_mstor(session, args + 5);
+  }
+
+  if ((strncmp(upper, "TRACE", 5) == 0) &&
+      ((args[5] == ' ') || (args[5] == '\0'))) {
+    return site_trace(session, args + 5);
+  }
+
+  if ((strncmp(upper, "BWLIMIT", 7) == 0) &&
+      ((args[7] == ' ') || (args[7] == '\0'))) {
+    return site_bwlimit(session, args + 7);
+  }
+
+  if ((strncmp(upper, "DELTA", 5) == 0) &&
+      ((args[5] == ' ') || (args[5] == '\0'))) {
+    return site_delta(session, args + 5);
+  }
+
+  if ((strncmp(upper, "FXP", 3) == 0) &&
+      ((args[3] == ' ') || (args[3] == '\0'))) {
+    return site_fxp(session, args + 3);
+  }
+
+  if ((strncmp(upper, "MOUNT", 5) == 0) &&
+      ((args[5] == ' ') || (args[5] == '\0'))) {
+    return site_mount(session, args + 5, 1);
+  }
+
+  if ((strncmp(upper, "UMOUNT", 6) == 0) &&
+      ((args[6] == ' ') || (args[6] == '\0'))) {
+    return site_mount(session, args + 6, 0);
+  }
+
   return ftp_session_send_reply(session, FTP_REPLY_502_NOT_IMPLEMENTED,
                                 "SITE command not supported.");
 }
@@ -2584,7 +4527,7 @@ ftp_error_t cmd_SIZE(ftp_session_t *session, const char *args) {
   }
 
   vfs_stat_t st;
-  err = vfs_stat(resolved, &st);
+  err = ftp_stat_cache_stat(resolved, &st);
 
   if (err != FTP_OK) {
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
@@ -2613,8 +4556,8 @@ ftp_error_t cmd_MDTM(ftp_session_t *session, const char *args) {
                                   "Invalid path.");
   }
 
-  struct stat st;
-  err = pal_file_stat(resolved, &st);
+  vfs_stat_t st;
+  err = ftp_stat_cache_stat(resolved, &st);
 
   if (err != FTP_OK) {
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
@@ -2623,7 +4566,8 @@ ftp_error_t cmd_MDTM(ftp_session_t *session, const char *args) {
 
   /* Format: YYYYMMDDhhmmss */
   struct tm tm_time;
-  gmtime_r(&st.st_mtime, &tm_time);
+  time_t mtime = (time_t)st.mtime;
+  gmtime_r(&mtime, &tm_time);
 
   char reply[32];
   snprintf(reply, sizeof(reply), "%04d%02d%02d%02d%02d%02d",
@@ -2633,6 +4577,136 @@ ftp_error_t cmd_MDTM(ftp_session_t *session, const char *args) {
   return ftp_session_send_reply(session, FTP_REPLY_213_FILE_STATUS, reply);
 }
 
+#if FTP_ENABLE_HASH
+/*---------------------------------------------------------------------------*
+ * HASH / XCRC / XMD5 / XSHA1 / XSHA256
+ *
+ *   Client:  HASH big.pkg
+ *   Server:  213 SHA-256 0-4294967296 9f86d0...0a08 big.pkg
+ *
+ *   Digests are looked up by (path, size, mtime) first; a miss reads the
+ *   file through ftp_hash_fd() and remembers the result, so verifying
+ *   the same file again is answered from the index.
+ *---------------------------------------------------------------------------*/
+
+/**
+ * @brief Digest a file for a hashing command; sends the error reply itself
+ *
+ * @return FTP_OK with *hex and *size filled, or the reply's result with
+ *         *replied set
+ */
+static ftp_error_t hash_file(ftp_session_t *session, const char *args,
+                             ftp_hash_algo_t algo, char *hex, size_t hex_size,
+                             uint64_t *size, int *replied) {
+  *replied = 1;
+
+  char resolved[FTP_PATH_MAX];
+  ftp_error_t err = ftp_path_resolve(session, args, resolved, sizeof(resolved));
+  if (err != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Invalid path.");
+  }
+
+  struct stat st;
+  if (pal_file_stat(resolved, &st) != FTP_OK) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "File not found.");
+  }
+  if (!S_ISREG(st.st_mode)) {
+    return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                  "Not a plain file.");
+  }
+
+  uint8_t digest[FTP_HASH_MAX_DIGEST];
+  *size = (uint64_t)st.st_size;
+  if (ftp_hash_cache_lookup(resolved, algo, *size, (int64_t)st.st_mtime,
+                            digest) == 0) {
+    int fd = pal_file_open(resolved, O_RDONLY, 0);
+    if (fd < 0) {
+      return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
+                                    "Cannot open file.");
+    }
+    uint64_t hashed = 0U;
+    int rc = ftp_hash_fd(fd, algo, digest, &hashed);
+    pal_file_close(fd);
+    if (rc != 0) {
+      return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
+                                    "Read error.");
+    }
+    /* Only remember digests of files that did not change underneath us */
+    if (hashed == *size) {
+      ftp_hash_cache_store(resolved, algo, *size, (int64_t)st.st_mtime,
+                           digest);
+    }
+    *size = hashed;
+  }
+
+  ftp_hash_hex(digest, ftp_hash_digest_len(algo), hex, hex_size);
+  *replied = 0;
+  return FTP_OK;
+}
+
+/**
+ * @brief HASH command - draft-bryan-ftpext-hash
+ */
+ftp_error_t cmd_HASH(ftp_session_t *session, const char *args) {
+  if ((session == NULL) || (args == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  ftp_hash_algo_t algo = (ftp_hash_algo_t)session->hash_algo;
+  char hex[FTP_HASH_HEX_MAX];
+  uint64_t size = 0U;
+  int replied = 0;
+  ftp_error_t err =
+      hash_file(session, args, algo, hex, sizeof(hex), &size, &replied);
+  if (replied != 0) {
+    return err;
+  }
+
+  char reply[FTP_REPLY_BUFFER_SIZE];
+  (void)snprintf(reply, sizeof(reply), "%s 0-%llu %s %s", ftp_hash_name(algo),
+                 (unsigned long long)size, hex, args);
+  return ftp_session_send_reply(session, FTP_REPLY_213_FILE_STATUS, reply);
+}
+
+/**
+ * @brief Shared body of the X* digest commands (250 <hex>)
+ */
+static ftp_error_t hash_legacy(ftp_session_t *session, const char *args,
+                               ftp_hash_algo_t algo) {
+  if ((session == NULL) || (args == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  char hex[FTP_HASH_HEX_MAX];
+  uint64_t size = 0U;
+  int replied = 0;
+  ftp_error_t err =
+      hash_file(session, args, algo, hex, sizeof(hex), &size, &replied);
+  if (replied != 0) {
+    return err;
+  }
+  return ftp_session_send_reply(session, FTP_REPLY_250_FILE_ACTION_OK, hex);
+}
+
+ftp_error_t cmd_XCRC(ftp_session_t *session, const char *args) {
+  return hash_legacy(session, args, FTP_HASH_CRC32);
+}
+
+ftp_error_t cmd_XMD5(ftp_session_t *session, const char *args) {
+  return hash_legacy(session, args, FTP_HASH_MD5);
+}
+
+ftp_error_t cmd_XSHA1(ftp_session_t *session, const char *args) {
+  return hash_legacy(session, args, FTP_HASH_SHA1);
+}
+
+ftp_error_t cmd_XSHA256(ftp_session_t *session, const char *args) {
+  return hash_legacy(session, args, FTP_HASH_SHA256);
+}
+#endif /* FTP_ENABLE_HASH */
+
 /**
  * @brief STAT command - Status
  */
@@ -2703,15 +4777,57 @@ ftp_error_t cmd_FEAT(ftp_session_t *session, const char *args) {
 #endif
 #if FTP_ENABLE_CRYPTO
                             " XCRYPT",
+#endif
+#if FTP_ENABLE_MODEZ
+                            " MODE Z",
+#endif
+#if FTP_ENABLE_HASH
+                            " XCRC",
+                            " XMD5",
+                            " XSHA1",
+                            " XSHA256",
+#endif
+#if FTP_ENABLE_TLS
+                            " AUTH TLS",
+                            " PBSZ",
+                            " PROT",
 #endif
                             " CPFR",
                             " CPTO",
                             " COPY",
                             "End"};
 
+#if FTP_ENABLE_HASH
+  /* HASH line marks the session's current algorithm with '*' */
+  char hash_feat[64];
+  {
+    size_t n = 0U;
+    n += (size_t)snprintf(hash_feat, sizeof(hash_feat), " HASH ");
+    for (unsigned i = 0U; i < (unsigned)FTP_HASH_ALGO_COUNT; i++) {
+      int w = snprintf(hash_feat + n, sizeof(hash_feat) - n, "%s%s%s",
+                       (i == 0U) ? "" : ";", ftp_hash_name((ftp_hash_algo_t)i),
+                       (i == session->hash_algo) ? "*" : "");
+      if ((w < 0) || ((size_t)w >= (sizeof(hash_feat) - n))) {
+        break;
+      }
+      n += (size_t)w;
+    }
+  }
+  const char *lines[(sizeof(features) / sizeof(features[0])) + 1U];
+  size_t nlines = 0U;
+  for (size_t i = 0U; i < (sizeof(features) / sizeof(features[0])); i++) {
+    if (i == ((sizeof(features) / sizeof(features[0])) - 1U)) {
+      lines[nlines++] = hash_feat; /* before "End" */
+    }
+    lines[nlines++] = features[i];
+  }
+  return ftp_session_send_multiline_reply(session, FTP_REPLY_211_SYSTEM_STATUS,
+                                          lines, nlines);
+#else
   return ftp_session_send_multiline_reply(
       session, FTP_REPLY_211_SYSTEM_STATUS, features,
       sizeof(features) / sizeof(features[0]));
+#endif
 }
 
 /**
@@ -2727,7 +4843,7 @@ ftp_error_t cmd_HELP(ftp_session_t *session, const char *args) {
   const char *lines[] = {"Supported commands:",
                          " USER PASS QUIT NOOP CWD CDUP PWD",
                          " LIST NLST MLSD MLST",
-                         " RETR STOR APPE REST",
+                         " RETR STOR APPE REST ALLO",
                          " DELE RMD MKD RNFR RNTO",
                          " PORT PASV SIZE MDTM STAT",
                          " SYST FEAT HELP TYPE MODE STRU",
@@ -2741,54 +4857,14 @@ ftp_error_t cmd_HELP(ftp_session_t *session, const char *args) {
  * ASYNC BACKGROUND COPY
  *===========================================================================*/
 
-typedef struct {
-  ftp_session_t *session;
-  char src_path[FTP_PATH_MAX];
-  char dst_path[FTP_PATH_MAX];
-  int is_move;
-} ftp_copy_task_t;
-
-static void *ftp_copy_thread_func(void *arg) {
-  ftp_copy_task_t *task = (ftp_copy_task_t *)arg;
-  ftp_session_t *session = task->session;
-
-  ftp_log_line(FTP_LOG_INFO, "[COPY] Background task started");
-
-  /* Use pal_file_copy_recursive_ex so the OS errno is captured and visible
-   * in the failure log.  Previously pal_file_copy_recursive was called with
-   * no errno output, causing all error logs to show errno=0. */
-  int copy_errno = 0;
-  ftp_error_t err = pal_file_copy_recursive_ex(task->src_path, task->dst_path,
-                                               !task->is_move, NULL, NULL,
-                                               &copy_errno);
-
-  pthread_mutex_lock(&session->copy_mutex);
-  session->copy_in_progress = 0;
-  pthread_mutex_unlock(&session->copy_mutex);
-
-  if (err == FTP_OK) {
-    ftp_log_line(FTP_LOG_INFO, "[COPY] Background task completed successfully");
-  } else {
-    char msg[256];
-    snprintf(msg, sizeof(msg), "[COPY] Background task failed: err=%d errno=%d",
-             (int)err, copy_errno);
-    ftp_log_line(FTP_LOG_WARN, msg);
-  }
-
-  free(task);
-  return NULL;
-}
-
+/*
+ * COPY, CPTO and the cross-device RNTO fallback queue a job on the shared
+ * copy engine (ftp_copyjob.h) and reply at once; the session is free to
+ * go on, or to start more copies, while the workers run it.
+ */
 static ftp_error_t start_async_copy(ftp_session_t *session,
                                     const char *src_ftp_path,
                                     const char *dst_ftp_path, int is_move) {
-  pthread_mutex_lock(&session->copy_mutex);
-  if (session->copy_in_progress) {
-    pthread_mutex_unlock(&session->copy_mutex);
-    return ftp_session_send_reply(session, FTP_REPLY_450_FILE_UNAVAILABLE,
-                                  "Operation already in progress.");
-  }
-
   /* Validate paths */
   char src_resolved[FTP_PATH_MAX];
   char dst_resolved[FTP_PATH_MAX];
@@ -2796,53 +4872,31 @@ static ftp_error_t start_async_copy(ftp_session_t *session,
                        sizeof(src_resolved)) != FTP_OK ||
       ftp_path_resolve(session, dst_ftp_path, dst_resolved,
                        sizeof(dst_resolved)) != FTP_OK) {
-    pthread_mutex_unlock(&session->copy_mutex);
     return ftp_session_send_reply(session, FTP_REPLY_550_FILE_ERROR,
                                   "Invalid path.");
   }
 
   if (strcmp(src_resolved, dst_resolved) == 0) {
-    pthread_mutex_unlock(&session->copy_mutex);
     return ftp_session_send_reply(session, FTP_REPLY_553_FILENAME_INVALID,
                                   "Source and destination are the same.");
   }
 
-  ftp_copy_task_t *task = malloc(sizeof(ftp_copy_task_t));
-  if (task == NULL) {
-    pthread_mutex_unlock(&session->copy_mutex);
-    return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
-                                  "Memory allocation failed.");
-  }
-
-  task->session = session;
-  strncpy(task->src_path, src_resolved, sizeof(task->src_path) - 1);
-  task->src_path[sizeof(task->src_path) - 1] = '\0';
-  strncpy(task->dst_path, dst_resolved, sizeof(task->dst_path) - 1);
-  task->dst_path[sizeof(task->dst_path) - 1] = '\0';
-  task->is_move = is_move;
-
-  session->copy_in_progress = 1;
-
-  if (session->copy_thread_valid) {
-    pthread_join(session->copy_thread, NULL);
+  uint32_t job = 0U;
+  ftp_error_t err =
+      ftp_copyjob_submit(src_resolved, dst_resolved, is_move, 0U, &job);
+  if (err == FTP_ERR_MAX_SESSIONS) {
+    return ftp_session_send_reply(session, FTP_REPLY_450_FILE_UNAVAILABLE,
+                                  "Too many copies in progress.");
   }
-
-  if (pthread_create(&session->copy_thread, NULL, ftp_copy_thread_func, task) !=
-      0) {
-    session->copy_in_progress = 0;
-    session->copy_thread_valid = 0;
-    pthread_mutex_unlock(&session->copy_mutex);
-    free(task);
+  if (err != FTP_OK) {
     return ftp_session_send_reply(session, FTP_REPLY_451_LOCAL_ERROR,
-                                  "Failed to create background thread.");
+                                  "Failed to queue background copy.");
   }
 
-  session->copy_thread_valid = 1;
-  pthread_mutex_unlock(&session->copy_mutex);
-
-  return ftp_session_send_reply(session, FTP_REPLY_250_FILE_ACTION_OK,
-                                is_move ? "Move started in background."
-                                        : "Copy started in background.");
+  char msg[64];
+  snprintf(msg, sizeof(msg), "%s started in background (job %u).",
+           is_move ? "Move" : "Copy", (unsigned)job);
+  return ftp_session_send_reply(session, FTP_REPLY_250_FILE_ACTION_OK, msg);
 }
 
 ftp_error_t cmd_CPFR(ftp_session_t *session, const char *args) {
@@ -2868,8 +4922,8 @@ ftp_error_t cmd_CPFR(ftp_session_t *session, const char *args) {
                                   "Source does not exist.");
   }
 
-  strncpy(session->copy_from, args, sizeof(session->copy_from) - 1);
-  session->copy_from[sizeof(session->copy_from) - 1] = '\0';
+  strncpy(session->copy_from, args, FTP_PATH_MAX - 1U);
+  session->copy_from[FTP_PATH_MAX - 1U] = '\0';
 
   return ftp_session_send_reply(session, FTP_REPLY_350_PENDING,
                                 "File exists, ready for destination name.");
@@ -2974,8 +5028,19 @@ ftp_error_t cmd_MODE(ftp_session_t *session, const char *args) {
                                   "Mode set to Stream.");
   }
 
+#if FTP_ENABLE_MODEZ
+  if (((args[0] == 'Z') || (args[0] == 'z')) && (args[1] == '\0')) {
+    session->transfer_mode = FTP_MODE_ZLIB;
+    return ftp_session_send_reply(session, FTP_REPLY_200_OK,
+                                  "Mode set to Z (deflate).");
+  }
+
+  return ftp_session_send_reply(session, FTP_REPLY_504_NOT_IMPL_PARAM,
+                                "Only Stream and Z modes supported.");
+#else
   return ftp_session_send_reply(session, FTP_REPLY_504_NOT_IMPL_PARAM,
                                 "Only Stream mode supported.");
+#endif
 }
 
 /**
@@ -3050,22 +5115,18 @@ static int generate_nonce(uint8_t *buf, size_t len) {
   return 0;
 }
 
-ftp_error_t cmd_AUTH(ftp_session_t *session, const char *args) {
-  if ((session == NULL) || (args == NULL)) {
-    return FTP_ERR_INVALID_PARAM;
-  }
-
-  /* Only XCRYPT mechanism is supported */
-  if ((strcmp(args, "XCRYPT") != 0) && (strcmp(args, "xcrypt") != 0)) {
-    return ftp_session_send_reply(session, FTP_REPLY_504_NOT_IMPL_PARAM,
-                                  "Unsupported AUTH mechanism.");
-  }
-
-  /* Already encrypted? */
+static ftp_error_t auth_xcrypt(ftp_session_t *session) {
+  /* Already encrypted?  XCRYPT on top of TLS would bypass the TLS layer */
   if (session->crypto.active != 0U) {
     return ftp_session_send_reply(session, FTP_REPLY_503_BAD_SEQUENCE,
                                   "Already encrypted.");
   }
+#if FTP_ENABLE_TLS
+  if (session->ctrl_tls != NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_503_BAD_SEQUENCE,
+                                  "TLS already active.");
+  }
+#endif
 
   /* Generate 12-byte random nonce */
   uint8_t nonce[12];
@@ -3106,3 +5167,149 @@ ftp_error_t cmd_AUTH(ftp_session_t *session, const char *args) {
 }
 
 #endif /* FTP_ENABLE_CRYPTO */
+
+/*===========================================================================*
+ * FTPS (RFC 4217)
+ *
+ *    AUTH TLS ─────────────────────►
+ *             ◄───────────────────── 234 (plaintext)
+ *    ═══════════ TLS handshake on the control fd ═══════════
+ *    PBSZ 0   ─────────────────────► 200 PBSZ=0
+ *    PROT P   ─────────────────────► 200
+ *    PASV/RETR ... every data connection starts with its own handshake
+ *
+ *===========================================================================*/
+
+#if FTP_ENABLE_TLS
+
+/**
+ * @brief AUTH TLS: upgrade the control connection in place
+ */
+static ftp_error_t auth_tls(ftp_session_t *session) {
+  pal_tls_server_t *srv =
+      (session->server_ctx != NULL) ? session->server_ctx->tls : NULL;
+  if (srv == NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_431_NEED_SECURITY,
+                                  "TLS not configured.");
+  }
+
+  if (session->ctrl_tls != NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_503_BAD_SEQUENCE,
+                                  "TLS already active.");
+  }
+
+#if FTP_ENABLE_CRYPTO
+  if (session->crypto.active != 0U) {
+    return ftp_session_send_reply(session, FTP_REPLY_503_BAD_SEQUENCE,
+                                  "Already encrypted.");
+  }
+#endif
+
+  ftp_error_t err = ftp_session_send_reply(session, FTP_REPLY_234_AUTH_OK,
+                                           "AUTH TLS successful.");
+  if (err != FTP_OK) {
+    return err;
+  }
+
+  /*
+   * Anything pipelined after AUTH arrived in plaintext and must not be
+   * executed as if it had come over TLS (CVE-2011-0411 class).
+   */
+  session->ctrl_rx_len = 0U;
+  session->ctrl_rx_off = 0U;
+
+  session->ctrl_tls = pal_tls_accept(srv, session->ctrl_fd);
+  if (session->ctrl_tls == NULL) {
+    ftp_log_session_event(session, "TLS_FAIL", FTP_ERR_AUTH_FAILED, 0U);
+    /* Stream state is unknown: end the session */
+    (void)shutdown(session->ctrl_fd, SHUT_RDWR);
+    return FTP_ERR_AUTH_FAILED;
+  }
+
+  session->pbsz_set = 0U;
+  session->prot_private = 0U;
+
+  char desc[96];
+  char line[160];
+  (void)snprintf(line, sizeof(line), "[TLS] %s control: %s",
+                 session->client_ip,
+                 pal_tls_describe(session->ctrl_tls, desc, sizeof(desc)));
+  ftp_log_line(FTP_LOG_INFO, line);
+  return FTP_OK;
+}
+
+ftp_error_t cmd_PBSZ(ftp_session_t *session, const char *args) {
+  if ((session == NULL) || (args == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  if (session->ctrl_tls == NULL) {
+    return ftp_session_send_reply(session, FTP_REPLY_503_BAD_SEQUENCE,
+                                  "PBSZ requires AUTH TLS.");
+  }
+
+  session->pbsz_set = 1U;
+  return ftp_session_send_reply(session, FTP_REPLY_200_OK, "PBSZ=0");
+}
+
+ftp_error_t cmd_PROT(ftp_session_t *session, const char *args) {
+  if ((session == NULL) || (args == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  if ((session->ctrl_tls == NULL) || (session->pbsz_set == 0U)) {
+    return ftp_session_send_reply(session, FTP_REPLY_503_BAD_SEQUENCE,
+                                  "PROT requires AUTH TLS and PBSZ.");
+  }
+
+  char level = (char)toupper((unsigned char)args[0]);
+  if ((args[0] == '\0') || (args[1] != '\0')) {
+    level = '?';
+  }
+
+  switch (level) {
+  case 'P':
+    session->prot_private = 1U;
+    return ftp_session_send_reply(session, FTP_REPLY_200_OK,
+                                  "Protection level set to Private.");
+  case 'C':
+    session->prot_private = 0U;
+    return ftp_session_send_reply(session, FTP_REPLY_200_OK,
+                                  "Protection level set to Clear.");
+  case 'S':
+  case 'E':
+    return ftp_session_send_reply(session, FTP_REPLY_536_PROT_UNSUPPORTED,
+                                  NULL);
+  default:
+    return ftp_session_send_reply(session, FTP_REPLY_504_NOT_IMPL_PARAM,
+                                  "Unknown protection level.");
+  }
+}
+
+#endif /* FTP_ENABLE_TLS */
+
+#if FTP_ENABLE_CRYPTO || FTP_ENABLE_TLS
+
+ftp_error_t cmd_AUTH(ftp_session_t *session, const char *args) {
+  if ((session == NULL) || (args == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+#if FTP_ENABLE_TLS
+  if ((strcasecmp(args, "TLS") == 0) || (strcasecmp(args, "TLS-C") == 0) ||
+      (strcasecmp(args, "SSL") == 0)) {
+    return auth_tls(session);
+  }
+#endif
+
+#if FTP_ENABLE_CRYPTO
+  if (strcasecmp(args, "XCRYPT") == 0) {
+    return auth_xcrypt(session);
+  }
+#endif
+
+  return ftp_session_send_reply(session, FTP_REPLY_504_NOT_IMPL_PARAM,
+                                "Unsupported AUTH mechanism.");
+}
+
+#endif /* FTP_ENABLE_CRYPTO || FTP_ENABLE_TLS */
@@ -0,0 +1,1084 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_copyjob.c
+ * @brief Background copy/move/delete jobs on a shared, device-aware pool
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * A job goes through three kinds of work, all taken by the same workers
+ * under g_lock:
+ *
+ *   scan      walk the source, create the destination directories and
+ *             append one task per regular file (copying starts while
+ *             the walk is still running)
+ *   task      copy one file with pal_file_copy_file_ex(); the source is
+ *             unlinked afterwards for a move
+ *   finish    remove the emptied source directories (move), or the
+ *             destination root we created (failed or cancelled copy)
+ *
+ * Jobs are kept oldest first.  A pick hands out the scan of the first
+ * job that still needs one, else the next task of the first job whose
+ * devices have budget left.  A task that does not fit blocks its devices
+ * for the rest of the pick, so a large file waiting for a disk is not
+ * starved by small files of younger jobs queued on the same disk.
+ *
+ * A delete job scans nothing up front: its scan only queues the root, and
+ * each directory task removes the directory's entries and queues its
+ * subdirectories.  The finish rmdirs the emptied directories, children
+ * first.
+ *
+ * Pause is honoured at chunk granularity in the progress callback;
+ * a cancel or the first error stops handing out tasks and aborts the
+ * running ones the same way.
+ */
+
+#include "ftp_copyjob.h"
+#include "ftp_list.h"
+#include "pal_fileio.h"
+#include "pal_thread.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CJ_PICK_NONE 0
+#define CJ_PICK_SCAN 1
+#define CJ_PICK_TASK 2
+
+/* Devices a running task can hold: its source and its destination */
+#define CJ_DEVS_MAX (2U * FTP_COPYJOB_WORKERS)
+
+/* Removed entries are published to the job every this many unlinks */
+#define CJ_DELETE_BATCH 256U
+
+typedef struct {
+  char *rel; /* below the job roots; "" = the root itself */
+  uint64_t size;
+  dev_t dev; /* source device */
+  int is_dir; /* delete jobs: empty this directory */
+} cj_task_t;
+
+typedef struct {
+  uint32_t id;
+  int is_move;
+  int is_delete;
+  ftp_copyjob_state_t state; /* QUEUED, RUNNING or final */
+  atomic_int paused;
+  atomic_int stop; /* cancelled or failed: no new tasks, abort running */
+  int cancelled;
+  int scanning;
+  int scanned;
+  int finishing;
+  int created_root;
+  dev_t dst_dev;
+  cj_task_t *tasks;
+  size_t ntasks;
+  size_t tcap;
+  size_t next;
+  char **dirs; /* source directories, parents first */
+  size_t ndirs;
+  size_t dcap;
+  unsigned running;
+  uint32_t files_done;
+  _Atomic uint64_t bytes_done;
+  uint64_t bytes_scanned;
+  uint64_t hint;
+  int error_code;
+  int error_errno;
+  char src[FTP_PATH_MAX];
+  char dst[FTP_PATH_MAX]; /* delete: trash name the tree works under */
+} cj_job_t;
+
+typedef struct {
+  dev_t dev;
+  unsigned used;
+} cj_dev_t;
+
+typedef struct {
+  cj_job_t *job;
+  uint64_t last;
+} cj_progress_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_done_cv = PTHREAD_COND_INITIALIZER;
+
+static cj_job_t *g_jobs[FTP_COPYJOB_MAX]; /* oldest first */
+static size_t g_njobs = 0U;
+static uint32_t g_next_id = 1U;
+static uint32_t g_latest = 0U;
+static atomic_uint g_trash_seq;
+
+static cj_dev_t g_devs[CJ_DEVS_MAX];
+
+static pthread_t g_workers[FTP_COPYJOB_WORKERS];
+static unsigned g_nworkers = 0U;
+static int g_started = 0;
+static int g_stop = 0;
+
+/*===========================================================================*
+ * DEVICE BUDGET
+ *===========================================================================*/
+
+static unsigned task_cost(const cj_task_t *t) {
+  return (t->size > (uint64_t)FTP_COPYJOB_SMALL_FILE)
+             ? FTP_COPYJOB_DEVICE_SLOTS
+             : 1U;
+}
+
+static cj_dev_t *dev_find_locked(dev_t dev) {
+  for (unsigned k = 0U; k < CJ_DEVS_MAX; k++) {
+    if ((g_devs[k].used > 0U) && (g_devs[k].dev == dev)) {
+      return &g_devs[k];
+    }
+  }
+  return NULL;
+}
+
+static int dev_fits_locked(dev_t dev, unsigned cost) {
+  const cj_dev_t *d = dev_find_locked(dev);
+  return ((d == NULL) || (d->used + cost <= FTP_COPYJOB_DEVICE_SLOTS)) ? 1
+                                                                       : 0;
+}
+
+static void dev_take_locked(dev_t dev, unsigned cost) {
+  cj_dev_t *d = dev_find_locked(dev);
+  if (d == NULL) {
+    for (unsigned k = 0U; k < CJ_DEVS_MAX; k++) {
+      if (g_devs[k].used == 0U) {
+        d = &g_devs[k];
+        d->dev = dev;
+        break;
+      }
+    }
+  }
+  if (d != NULL) { /* always found: at most CJ_DEVS_MAX in use */
+    d->used += cost;
+  }
+}
+
+static void dev_give_locked(dev_t dev, unsigned cost) {
+  cj_dev_t *d = dev_find_locked(dev);
+  if (d != NULL) {
+    d->used = (d->used > cost) ? (d->used - cost) : 0U;
+  }
+}
+
+/*===========================================================================*
+ * JOB TABLE
+ *===========================================================================*/
+
+static int job_final(const cj_job_t *job) {
+  return ((job->state == FTP_COPYJOB_DONE) ||
+          (job->state == FTP_COPYJOB_FAILED) ||
+          (job->state == FTP_COPYJOB_CANCELLED))
+             ? 1
+             : 0;
+}
+
+static void job_free(cj_job_t *job) {
+  for (size_t i = 0U; i < job->ntasks; i++) {
+    free(job->tasks[i].rel);
+  }
+  for (size_t i = 0U; i < job->ndirs; i++) {
+    free(job->dirs[i]);
+  }
+  free(job->tasks);
+  free(job->dirs);
+  free(job);
+}
+
+static cj_job_t *job_find_locked(uint32_t id) {
+  for (size_t i = 0U; i < g_njobs; i++) {
+    if (g_jobs[i]->id == id) {
+      return g_jobs[i];
+    }
+  }
+  return NULL;
+}
+
+/* First failure wins; later ones are consequences of the stop */
+static void job_fail_locked(cj_job_t *job, ftp_error_t rc, int err) {
+  if ((atomic_load(&job->stop) == 0) && (job->error_code == 0)) {
+    job->error_code = (int)rc;
+    job->error_errno = err;
+  }
+  atomic_store(&job->stop, 1);
+}
+
+static void job_info_locked(const cj_job_t *job, ftp_copyjob_info_t *out) {
+  memset(out, 0, sizeof(*out));
+  out->id = job->id;
+  out->state = job->state;
+  if ((job_final(job) == 0) && (atomic_load(&job->paused) != 0)) {
+    out->state = FTP_COPYJOB_PAUSED;
+  }
+  out->is_move = job->is_move;
+  out->is_delete = job->is_delete;
+  out->scanned = job->scanned;
+  out->bytes_done = atomic_load(&job->bytes_done);
+  out->bytes_total = job->bytes_scanned;
+  if ((job->scanned == 0) && (job->hint > out->bytes_total)) {
+    out->bytes_total = job->hint;
+  }
+  out->files_done = job->files_done;
+  out->files_total = (job->is_delete != 0) ? job->files_done
+                                           : (uint32_t)job->ntasks;
+  out->error_code = job->error_code;
+  out->error_errno = job->error_errno;
+  memcpy(out->src, job->src, sizeof(out->src));
+  memcpy(out->dst, job->dst, sizeof(out->dst));
+}
+
+/*===========================================================================*
+ * SCHEDULING
+ *===========================================================================*/
+
+static int dev_listed(const dev_t *list, size_t n, dev_t dev) {
+  for (size_t i = 0U; i < n; i++) {
+    if (list[i] == dev) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int pick_locked(cj_job_t **out_job, size_t *out_task) {
+  dev_t blocked[2U * FTP_COPYJOB_MAX];
+  size_t nblocked = 0U;
+
+  for (size_t i = 0U; i < g_njobs; i++) {
+    cj_job_t *job = g_jobs[i];
+    if ((job_final(job) != 0) || (job->finishing != 0) ||
+        (atomic_load(&job->stop) != 0) || (atomic_load(&job->paused) != 0)) {
+      continue;
+    }
+    if ((job->scanned == 0) && (job->scanning == 0)) {
+      job->scanning = 1;
+      job->state = FTP_COPYJOB_RUNNING;
+      *out_job = job;
+      return CJ_PICK_SCAN;
+    }
+    if (job->next >= job->ntasks) {
+      continue;
+    }
+
+    const cj_task_t *t = &job->tasks[job->next];
+    unsigned cost = task_cost(t);
+    int fits = (dev_listed(blocked, nblocked, t->dev) == 0) &&
+               (dev_listed(blocked, nblocked, job->dst_dev) == 0) &&
+               (dev_fits_locked(t->dev, cost) != 0) &&
+               ((job->dst_dev == t->dev) ||
+                (dev_fits_locked(job->dst_dev, cost) != 0));
+    if (fits == 0) {
+      blocked[nblocked++] = t->dev;
+      blocked[nblocked++] = job->dst_dev;
+      continue;
+    }
+    dev_take_locked(t->dev, cost);
+    if (job->dst_dev != t->dev) {
+      dev_take_locked(job->dst_dev, cost);
+    }
+    job->running++;
+    *out_job = job;
+    *out_task = job->next++;
+    return CJ_PICK_TASK;
+  }
+  return CJ_PICK_NONE;
+}
+
+/* Nothing running and nothing left to hand out: time for the finish */
+static int claim_finish_locked(cj_job_t *job) {
+  if ((job->finishing != 0) || (job_final(job) != 0) ||
+      (job->scanning != 0) || (job->running > 0U)) {
+    return 0;
+  }
+  if ((atomic_load(&job->stop) == 0) &&
+      ((job->scanned == 0) || (job->next < job->ntasks))) {
+    return 0;
+  }
+  job->finishing = 1;
+  return 1;
+}
+
+/*===========================================================================*
+ * WORK
+ *===========================================================================*/
+
+static int join_path(char *out, size_t size, const char *root,
+                     const char *rel) {
+  int n = (rel[0] == '\0') ? snprintf(out, size, "%s", root)
+                           : snprintf(out, size, "%s/%s", root, rel);
+  return ((n < 0) || ((size_t)n >= size)) ? -1 : 0;
+}
+
+/* Root a delete job works under: the trash name, else the path itself */
+static const char *delete_root(const cj_job_t *job) {
+  return (job->dst[0] != '\0') ? job->dst : job->src;
+}
+
+static void wait_unpaused(const cj_job_t *job) {
+  while ((atomic_load(&job->paused) != 0) && (atomic_load(&job->stop) == 0)) {
+    usleep(100000); /* 100 ms */
+  }
+}
+
+static int cj_progress_cb(uint64_t bytes_copied, void *user_data) {
+  cj_progress_t *p = (cj_progress_t *)user_data;
+  cj_job_t *job = p->job;
+
+  atomic_fetch_add(&job->bytes_done, bytes_copied - p->last);
+  p->last = bytes_copied;
+
+  wait_unpaused(job);
+  return (atomic_load(&job->stop) != 0) ? -1 : 0;
+}
+
+static ftp_error_t delete_dir_entries(cj_job_t *job, const cj_task_t *t,
+                                      int *out_errno);
+
+static void run_task(cj_job_t *job, size_t index) {
+  pthread_mutex_lock(&g_lock);
+  cj_task_t t = job->tasks[index]; /* the array may grow during the scan */
+  pthread_mutex_unlock(&g_lock);
+
+  char src[FTP_PATH_MAX];
+  char dst[FTP_PATH_MAX];
+  ftp_error_t rc = FTP_OK;
+  int err = 0;
+  cj_progress_t prog = {job, 0U};
+
+  if (job->is_delete != 0) {
+    if (t.is_dir != 0) {
+      rc = delete_dir_entries(job, &t, &err);
+    } else if ((unlink(delete_root(job)) != 0) && (errno != ENOENT)) {
+      err = errno;
+      rc = FTP_ERR_PERMISSION;
+    }
+  } else if ((join_path(src, sizeof(src), job->src, t.rel) != 0) ||
+      (join_path(dst, sizeof(dst), job->dst, t.rel) != 0)) {
+    rc = FTP_ERR_PATH_TOO_LONG;
+  } else {
+    rc = pal_file_copy_file_ex(src, dst, cj_progress_cb, &prog, &err);
+    if ((rc == FTP_OK) && (job->is_move != 0) && (unlink(src) != 0)) {
+      err = errno;
+      rc = FTP_ERR_PERMISSION;
+    }
+  }
+
+  pthread_mutex_lock(&g_lock);
+  unsigned cost = task_cost(&t);
+  dev_give_locked(t.dev, cost);
+  if (job->dst_dev != t.dev) {
+    dev_give_locked(job->dst_dev, cost);
+  }
+  job->running--;
+  if (rc == FTP_OK) {
+    if ((job->is_delete == 0) || (t.is_dir == 0)) {
+      job->files_done++; /* directory tasks count as they go */
+    }
+  } else {
+    job_fail_locked(job, rc, err);
+  }
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_mutex_unlock(&g_lock);
+}
+
+static int grow(void **arr, size_t *cap, size_t used, size_t elem) {
+  if (used < *cap) {
+    return 0;
+  }
+  size_t ncap = (*cap == 0U) ? 64U : (*cap * 2U);
+  void *p = realloc(*arr, ncap * elem);
+  if (p == NULL) {
+    return -1;
+  }
+  *arr = p;
+  *cap = ncap;
+  return 0;
+}
+
+static int add_task(cj_job_t *job, const char *rel, uint64_t size,
+                    dev_t dev, int is_dir) {
+  char *copy = strdup(rel);
+  if (copy == NULL) {
+    return -1;
+  }
+  pthread_mutex_lock(&g_lock);
+  if (grow((void **)&job->tasks, &job->tcap, job->ntasks,
+           sizeof(cj_task_t)) != 0) {
+    pthread_mutex_unlock(&g_lock);
+    free(copy);
+    return -1;
+  }
+  job->tasks[job->ntasks].rel = copy;
+  job->tasks[job->ntasks].size = size;
+  job->tasks[job->ntasks].dev = dev;
+  job->tasks[job->ntasks].is_dir = is_dir;
+  job->ntasks++;
+  job->bytes_scanned += size;
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_mutex_unlock(&g_lock);
+  return 0;
+}
+
+/* Takes @p rel.  Copy jobs: only the scanning worker touches dirs until
+ * the finish; delete jobs: called with g_lock held */
+static int add_dir(cj_job_t *job, char *rel) {
+  if (grow((void **)&job->dirs, &job->dcap, job->ndirs, sizeof(char *)) !=
+      0) {
+    free(rel);
+    return -1;
+  }
+  job->dirs[job->ndirs++] = rel;
+  return 0;
+}
+
+static ftp_error_t stat_error(int err) {
+  return (err == ENOENT) ? FTP_ERR_NOT_FOUND : FTP_ERR_FILE_STAT;
+}
+
+/* mkdir that accepts an existing directory; 1 = created, 0 = existed */
+static int make_dir(const char *path, mode_t mode, int *out_errno) {
+  if (mkdir(path, mode) == 0) {
+    return 1;
+  }
+  struct stat st;
+  if ((errno == EEXIST) && (stat(path, &st) == 0) && S_ISDIR(st.st_mode)) {
+    return 0;
+  }
+  *out_errno = errno;
+  return -1;
+}
+
+static ftp_error_t scan_tree(cj_job_t *job, int *out_errno) {
+  char **stack = NULL;
+  size_t slen = 0U;
+  size_t scap = 0U;
+  ftp_error_t rc = FTP_OK;
+  char src[FTP_PATH_MAX];
+  char dst[FTP_PATH_MAX];
+  char rel[FTP_PATH_MAX];
+
+  char *root = strdup("");
+  if ((root == NULL) ||
+      (grow((void **)&stack, &scap, slen, sizeof(char *)) != 0)) {
+    free(root);
+    return FTP_ERR_OUT_OF_MEMORY;
+  }
+  stack[slen++] = root;
+
+  while ((slen > 0U) && (rc == FTP_OK) && (atomic_load(&job->stop) == 0)) {
+    char *dir = stack[--slen];
+    DIR *d = NULL;
+    if (add_dir(job, dir) != 0) {
+      rc = FTP_ERR_OUT_OF_MEMORY;
+      break;
+    }
+    if (join_path(src, sizeof(src), job->src, dir) != 0) {
+      rc = FTP_ERR_PATH_TOO_LONG;
+      break;
+    }
+    d = opendir(src);
+    if (d == NULL) {
+      *out_errno = errno;
+      rc = FTP_ERR_DIR_OPEN;
+      break;
+    }
+
+    struct dirent *ent;
+    while ((rc == FTP_OK) && (atomic_load(&job->stop) == 0) &&
+           ((ent = readdir(d)) != NULL)) {
+      if ((strcmp(ent->d_name, ".") == 0) ||
+          (strcmp(ent->d_name, "..") == 0)) {
+        continue;
+      }
+      int n = (dir[0] == '\0')
+                  ? snprintf(rel, sizeof(rel), "%s", ent->d_name)
+                  : snprintf(rel, sizeof(rel), "%s/%s", dir, ent->d_name);
+      if ((n < 0) || ((size_t)n >= sizeof(rel)) ||
+          (join_path(src, sizeof(src), job->src, rel) != 0) ||
+          (join_path(dst, sizeof(dst), job->dst, rel) != 0)) {
+        rc = FTP_ERR_PATH_TOO_LONG;
+        break;
+      }
+
+      /* Symlinks are copied as the file they point to; linked
+       * directories are not entered, which would risk a loop */
+      struct stat st;
+      if (lstat(src, &st) != 0) {
+        *out_errno = errno;
+        rc = stat_error(errno);
+        break;
+      }
+      if (S_ISLNK(st.st_mode) &&
+          ((stat(src, &st) != 0) || !S_ISREG(st.st_mode))) {
+        continue;
+      }
+
+      if (S_ISDIR(st.st_mode)) {
+        if (make_dir(dst, (mode_t)(st.st_mode & 0777), out_errno) < 0) {
+          rc = FTP_ERR_FILE_WRITE;
+          break;
+        }
+        char *copy = strdup(rel);
+        if ((copy == NULL) ||
+            (grow((void **)&stack, &scap, slen, sizeof(char *)) != 0)) {
+          free(copy);
+          rc = FTP_ERR_OUT_OF_MEMORY;
+          break;
+        }
+        stack[slen++] = copy;
+      } else if (S_ISREG(st.st_mode)) {
+        if (add_task(job, rel, (uint64_t)st.st_size, st.st_dev, 0) != 0) {
+          rc = FTP_ERR_OUT_OF_MEMORY;
+        }
+      }
+    }
+    (void)closedir(d);
+  }
+
+  while (slen > 0U) {
+    free(stack[--slen]);
+  }
+  free(stack);
+  return rc;
+}
+
+/*
+ * Empty one directory of a delete job.  Entries are removed relative to
+ * the directory fd, and d_type tells directories apart without a stat
+ * (fstatat() only for filesystems that report DT_UNKNOWN).  Symlinks are
+ * unlinked, never followed.
+ */
+static ftp_error_t delete_dir_entries(cj_job_t *job, const cj_task_t *t,
+                                      int *out_errno) {
+  char path[FTP_PATH_MAX];
+  char rel[FTP_PATH_MAX];
+  if (join_path(path, sizeof(path), delete_root(job), t->rel) != 0) {
+    return FTP_ERR_PATH_TOO_LONG;
+  }
+
+  int fd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0) {
+    *out_errno = errno;
+    return (errno == ENOENT) ? FTP_OK : FTP_ERR_DIR_OPEN;
+  }
+  DIR *d = fdopendir(fd);
+  if (d == NULL) {
+    *out_errno = errno;
+    (void)close(fd);
+    return FTP_ERR_DIR_OPEN;
+  }
+
+  ftp_error_t rc = FTP_OK;
+  uint32_t removed = 0U;
+  struct dirent *ent;
+  while ((rc == FTP_OK) && (atomic_load(&job->stop) == 0) &&
+         ((ent = readdir(d)) != NULL)) {
+    if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
+      continue;
+    }
+    wait_unpaused(job);
+
+    int is_dir = 0;
+#ifdef DT_DIR
+    if (ent->d_type == DT_DIR) {
+      is_dir = 1;
+    } else if (ent->d_type == DT_UNKNOWN)
+#endif
+    {
+      struct stat st;
+      if (fstatat(dirfd(d), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        continue; /* gone already */
+      }
+      is_dir = S_ISDIR(st.st_mode) ? 1 : 0;
+    }
+
+    if (is_dir != 0) {
+      int n = (t->rel[0] == '\0')
+                  ? snprintf(rel, sizeof(rel), "%s", ent->d_name)
+                  : snprintf(rel, sizeof(rel), "%s/%s", t->rel, ent->d_name);
+      char *copy = ((n < 0) || ((size_t)n >= sizeof(rel))) ? NULL : strdup(rel);
+      if (copy == NULL) {
+        rc = ((n < 0) || ((size_t)n >= sizeof(rel))) ? FTP_ERR_PATH_TOO_LONG
+                                                     : FTP_ERR_OUT_OF_MEMORY;
+        break;
+      }
+      pthread_mutex_lock(&g_lock);
+      int added = add_dir(job, copy);
+      pthread_mutex_unlock(&g_lock);
+      if ((added != 0) || (add_task(job, rel, 0U, t->dev, 1) != 0)) {
+        rc = FTP_ERR_OUT_OF_MEMORY;
+      }
+    } else if (unlinkat(dirfd(d), ent->d_name, 0) == 0) {
+      if (++removed == CJ_DELETE_BATCH) {
+        pthread_mutex_lock(&g_lock);
+        job->files_done += removed;
+        pthread_mutex_unlock(&g_lock);
+        removed = 0U;
+      }
+    } else if (errno != ENOENT) {
+      *out_errno = errno;
+      rc = FTP_ERR_PERMISSION;
+    }
+  }
+  (void)closedir(d);
+
+  pthread_mutex_lock(&g_lock);
+  job->files_done += removed;
+  pthread_mutex_unlock(&g_lock);
+  return rc;
+}
+
+/* Delete jobs: queue the root as a file or as the first directory task */
+static ftp_error_t scan_delete(cj_job_t *job, int *out_errno) {
+  struct stat st;
+  if (lstat(delete_root(job), &st) != 0) {
+    *out_errno = errno;
+    return stat_error(errno);
+  }
+  pthread_mutex_lock(&g_lock);
+  job->dst_dev = st.st_dev;
+  pthread_mutex_unlock(&g_lock);
+
+  int is_dir = S_ISDIR(st.st_mode) ? 1 : 0;
+  if (is_dir != 0) {
+    char *root = strdup("");
+    pthread_mutex_lock(&g_lock);
+    int added = (root != NULL) ? add_dir(job, root) : -1;
+    pthread_mutex_unlock(&g_lock);
+    if (added != 0) {
+      return FTP_ERR_OUT_OF_MEMORY;
+    }
+  }
+  return (add_task(job, "", 0U, st.st_dev, is_dir) != 0)
+             ? FTP_ERR_OUT_OF_MEMORY
+             : FTP_OK;
+}
+
+static void run_scan(cj_job_t *job) {
+  ftp_error_t rc = FTP_OK;
+  int err = 0;
+  struct stat st;
+
+  if (job->is_delete != 0) {
+    rc = scan_delete(job, &err);
+  } else if (stat(job->src, &st) != 0) {
+    err = errno;
+    rc = stat_error(err);
+  } else if (S_ISREG(st.st_mode)) {
+    if (add_task(job, "", (uint64_t)st.st_size, st.st_dev, 0) != 0) {
+      rc = FTP_ERR_OUT_OF_MEMORY;
+    }
+  } else if (!S_ISDIR(st.st_mode)) {
+    rc = FTP_ERR_INVALID_PARAM;
+  } else {
+    int made = make_dir(job->dst, (mode_t)(st.st_mode & 0777), &err);
+    if (made < 0) {
+      rc = FTP_ERR_FILE_WRITE;
+    } else {
+      job->created_root = made;
+      rc = scan_tree(job, &err);
+    }
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (rc != FTP_OK) {
+    job_fail_locked(job, rc, err);
+  }
+  job->scanning = 0;
+  job->scanned = 1;
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_mutex_unlock(&g_lock);
+}
+
+/* Delete jobs: remove the emptied directories; on a stop, put the rest
+ * back under its old name.  @return 0, or the errno of a failed rmdir */
+static int finish_delete(cj_job_t *job, int ok) {
+  char path[FTP_PATH_MAX];
+  int err = 0;
+  for (size_t i = job->ndirs; (ok != 0) && (i > 0U); i--) {
+    if ((join_path(path, sizeof(path), delete_root(job),
+                   job->dirs[i - 1U]) == 0) &&
+        (rmdir(path) != 0) && (errno != ENOENT)) {
+      err = errno;
+      ok = 0;
+    }
+  }
+  if ((ok == 0) && (job->dst[0] != '\0') && (rename(job->dst, job->src) == 0)) {
+    pthread_mutex_lock(&g_lock);
+    job->dst[0] = '\0';
+    pthread_mutex_unlock(&g_lock);
+  }
+  ftp_list_cache_invalidate(job->src);
+  return err;
+}
+
+static void run_finish(cj_job_t *job) {
+  pthread_mutex_lock(&g_lock);
+  int ok = ((job->error_code == 0) && (job->cancelled == 0)) ? 1 : 0;
+  pthread_mutex_unlock(&g_lock);
+
+  char path[FTP_PATH_MAX];
+  if (job->is_delete != 0) {
+    int err = finish_delete(job, ok);
+    if (err != 0) {
+      pthread_mutex_lock(&g_lock);
+      job_fail_locked(job, FTP_ERR_PERMISSION, err);
+      pthread_mutex_unlock(&g_lock);
+      ok = 0;
+    }
+  } else if ((ok != 0) && (job->is_move != 0)) {
+    /* Children were listed after their parents */
+    for (size_t i = job->ndirs; i > 0U; i--) {
+      if (join_path(path, sizeof(path), job->src, job->dirs[i - 1U]) == 0) {
+        (void)rmdir(path);
+      }
+    }
+    ftp_list_cache_invalidate(job->src);
+  } else if ((ok == 0) && (job->is_move == 0) && (job->created_root != 0)) {
+    (void)pal_dir_remove_recursive_pub(job->dst);
+  }
+  if (job->is_delete == 0) {
+    ftp_list_cache_invalidate(job->dst);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (ok != 0) {
+    job->state = FTP_COPYJOB_DONE;
+  } else {
+    job->state = (job->cancelled != 0) ? FTP_COPYJOB_CANCELLED
+                                       : FTP_COPYJOB_FAILED;
+  }
+  job->finishing = 0;
+  pthread_cond_broadcast(&g_done_cv);
+  pthread_mutex_unlock(&g_lock);
+}
+
+static void *worker_main(void *arg) {
+  (void)arg;
+  pthread_mutex_lock(&g_lock);
+  for (;;) {
+    cj_job_t *job = NULL;
+    size_t index = 0U;
+    int kind = CJ_PICK_NONE;
+    while ((g_stop == 0) &&
+           ((kind = pick_locked(&job, &index)) == CJ_PICK_NONE)) {
+      pthread_cond_wait(&g_work_cv, &g_lock);
+    }
+    if (kind == CJ_PICK_NONE) {
+      break; /* g_stop */
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (kind == CJ_PICK_SCAN) {
+      run_scan(job);
+    } else {
+      run_task(job, index);
+    }
+
+    pthread_mutex_lock(&g_lock);
+    if (claim_finish_locked(job) != 0) {
+      pthread_mutex_unlock(&g_lock);
+      run_finish(job);
+      pthread_mutex_lock(&g_lock);
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+  return NULL;
+}
+
+/*===========================================================================*
+ * LIFECYCLE
+ *===========================================================================*/
+
+static void start_locked(void) {
+  if (g_started != 0) {
+    return;
+  }
+  g_started = 1;
+  g_stop = 0;
+  for (unsigned k = 0U; k < FTP_COPYJOB_WORKERS; k++) {
+    if (pal_thread_create(&g_workers[g_nworkers], NULL, PAL_THREAD_BACKGROUND,
+                          worker_main, NULL) == 0) {
+      g_nworkers++;
+    }
+  }
+}
+
+void ftp_copyjob_shutdown(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_started == 0) {
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+  g_stop = 1;
+  for (size_t i = 0U; i < g_njobs; i++) {
+    g_jobs[i]->cancelled = 1;
+    atomic_store(&g_jobs[i]->stop, 1);
+  }
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_cond_broadcast(&g_done_cv);
+  pthread_mutex_unlock(&g_lock);
+
+  for (unsigned k = 0U; k < g_nworkers; k++) {
+    (void)pthread_join(g_workers[k], NULL);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  for (size_t i = 0U; i < g_njobs; i++) {
+    job_free(g_jobs[i]);
+    g_jobs[i] = NULL;
+  }
+  g_njobs = 0U;
+  g_latest = 0U;
+  memset(g_devs, 0, sizeof(g_devs));
+  g_nworkers = 0U;
+  g_started = 0;
+  pthread_mutex_unlock(&g_lock);
+}
+
+/*===========================================================================*
+ * PUBLIC API
+ *===========================================================================*/
+
+/* Takes @p job: queued on FTP_OK, freed otherwise */
+static ftp_error_t job_queue(cj_job_t *job, uint32_t *out_id) {
+  pthread_mutex_lock(&g_lock);
+  start_locked();
+  if (g_nworkers == 0U) {
+    g_started = 0;
+    pthread_mutex_unlock(&g_lock);
+    job_free(job);
+    return FTP_ERR_THREAD_CREATE;
+  }
+  if (g_njobs == FTP_COPYJOB_MAX) {
+    size_t i = 0U;
+    while ((i < g_njobs) && (job_final(g_jobs[i]) == 0)) {
+      i++;
+    }
+    if (i == g_njobs) {
+      pthread_mutex_unlock(&g_lock);
+      job_free(job);
+      return FTP_ERR_MAX_SESSIONS;
+    }
+    job_free(g_jobs[i]);
+    memmove(&g_jobs[i], &g_jobs[i + 1U],
+            (g_njobs - i - 1U) * sizeof(g_jobs[0]));
+    g_njobs--;
+  }
+  job->id = g_next_id++;
+  g_jobs[g_njobs++] = job;
+  if (job->is_delete == 0) {
+    g_latest = job->id;
+  }
+  *out_id = job->id;
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_mutex_unlock(&g_lock);
+  return FTP_OK;
+}
+
+ftp_error_t ftp_copyjob_submit(const char *src, const char *dst, int is_move,
+                               uint64_t total_hint, uint32_t *out_id) {
+  if ((src == NULL) || (dst == NULL) || (out_id == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  if ((strlen(src) >= FTP_PATH_MAX) || (strlen(dst) >= FTP_PATH_MAX)) {
+    return FTP_ERR_PATH_TOO_LONG;
+  }
+
+  cj_job_t *job = (cj_job_t *)calloc(1U, sizeof(*job));
+  if (job == NULL) {
+    return FTP_ERR_OUT_OF_MEMORY;
+  }
+  job->is_move = (is_move != 0) ? 1 : 0;
+  job->state = FTP_COPYJOB_QUEUED;
+  job->hint = total_hint;
+  (void)snprintf(job->src, sizeof(job->src), "%s", src);
+  (void)snprintf(job->dst, sizeof(job->dst), "%s", dst);
+
+  /* Everything lands on the device of the destination's parent */
+  char parent[FTP_PATH_MAX];
+  (void)snprintf(parent, sizeof(parent), "%s", dst);
+  char *slash = strrchr(parent, '/');
+  if (slash == parent) {
+    slash[1] = '\0';
+  } else if (slash != NULL) {
+    *slash = '\0';
+  }
+  struct stat st;
+  if (stat(parent, &st) == 0) {
+    job->dst_dev = st.st_dev;
+  }
+
+  return job_queue(job, out_id);
+}
+
+ftp_error_t ftp_copyjob_delete(const char *path, int use_trash,
+                               uint32_t *out_id) {
+  if ((path == NULL) || (out_id == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  if (strlen(path) >= FTP_PATH_MAX) {
+    return FTP_ERR_PATH_TOO_LONG;
+  }
+
+  cj_job_t *job = (cj_job_t *)calloc(1U, sizeof(*job));
+  if (job == NULL) {
+    return FTP_ERR_OUT_OF_MEMORY;
+  }
+  job->is_delete = 1;
+  job->state = FTP_COPYJOB_QUEUED;
+  (void)snprintf(job->src, sizeof(job->src), "%s", path);
+
+  if (use_trash != 0) {
+    /* A sibling is on the same filesystem, so the rename is atomic */
+    char parent[FTP_PATH_MAX];
+    (void)snprintf(parent, sizeof(parent), "%s", path);
+    char *slash = strrchr(parent, '/');
+    if (slash != NULL) {
+      *slash = '\0';
+      int n = snprintf(job->dst, sizeof(job->dst), "%s/.zftpd-trash.%ld.%u",
+                       parent, (long)getpid(),
+                       atomic_fetch_add(&g_trash_seq, 1U));
+      if ((n < 0) || ((size_t)n >= sizeof(job->dst)) ||
+          (rename(path, job->dst) != 0)) {
+        job->dst[0] = '\0'; /* delete in place */
+      }
+    }
+  }
+
+  char trash[FTP_PATH_MAX];
+  memcpy(trash, job->dst, sizeof(trash));
+  ftp_error_t rc = job_queue(job, out_id);
+  if ((rc != FTP_OK) && (trash[0] != '\0')) {
+    (void)rename(trash, path);
+  }
+  return rc;
+}
+
+int ftp_copyjob_get(uint32_t id, ftp_copyjob_info_t *out) {
+  if (out == NULL) {
+    return -1;
+  }
+  pthread_mutex_lock(&g_lock);
+  const cj_job_t *job = job_find_locked(id);
+  if (job != NULL) {
+    job_info_locked(job, out);
+  }
+  pthread_mutex_unlock(&g_lock);
+  return (job != NULL) ? 0 : -1;
+}
+
+size_t ftp_copyjob_list(ftp_copyjob_info_t *out, size_t max) {
+  size_t n = 0U;
+  pthread_mutex_lock(&g_lock);
+  for (size_t i = 0U; (i < g_njobs) && (n < max); i++) {
+    job_info_locked(g_jobs[i], &out[n++]);
+  }
+  pthread_mutex_unlock(&g_lock);
+  return n;
+}
+
+uint32_t ftp_copyjob_latest(void) {
+  pthread_mutex_lock(&g_lock);
+  uint32_t id = g_latest;
+  pthread_mutex_unlock(&g_lock);
+  return id;
+}
+
+int ftp_copyjob_pause(uint32_t id, int paused) {
+  pthread_mutex_lock(&g_lock);
+  cj_job_t *job = job_find_locked(id);
+  int rc = -1;
+  if ((job != NULL) && (job_final(job) == 0)) {
+    atomic_store(&job->paused, (paused != 0) ? 1 : 0);
+    pthread_cond_broadcast(&g_work_cv);
+    rc = 0;
+  }
+  pthread_mutex_unlock(&g_lock);
+  return rc;
+}
+
+int ftp_copyjob_cancel(uint32_t id) {
+  pthread_mutex_lock(&g_lock);
+  cj_job_t *job = job_find_locked(id);
+  int rc = -1;
+  if ((job != NULL) && (job_final(job) == 0)) {
+    if (atomic_load(&job->stop) == 0) {
+      job->cancelled = 1;
+      atomic_store(&job->stop, 1);
+    }
+    rc = 0;
+    /* A job no worker holds is finished here */
+    if (claim_finish_locked(job) != 0) {
+      pthread_mutex_unlock(&g_lock);
+      run_finish(job);
+      return 0;
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+  return rc;
+}
+
+int ftp_copyjob_wait(uint32_t id, unsigned timeout_ms) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  struct timespec deadline;
+  uint64_t ns =
+      ((uint64_t)tv.tv_usec * 1000U) + ((uint64_t)timeout_ms * 1000000U);
+  deadline.tv_sec = tv.tv_sec + (time_t)(ns / 1000000000U);
+  deadline.tv_nsec = (long)(ns % 1000000000U);
+
+  int rc = 0;
+  pthread_mutex_lock(&g_lock);
+  for (;;) {
+    const cj_job_t *job = job_find_locked(id);
+    if ((job == NULL) || (job_final(job) != 0)) {
+      break;
+    }
+    if (pthread_cond_timedwait(&g_done_cv, &g_lock, &deadline) ==
+        ETIMEDOUT) {
+      job = job_find_locked(id);
+      rc = ((job == NULL) || (job_final(job) != 0)) ? 0 : -1;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+  return rc;
+}
@@ -0,0 +1,661 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_delta.c
+ * @brief rsync-style delta uploads for SITE DELTA
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * CACHE FILE (FTP_DELTA_SIG_DIR/<sha256(path)[0..8]>.sig):
+ *
+ *   u32 path length, path, signature exactly as sent
+ *
+ * The path is stored so that a hash collision reads as a miss; size and
+ * mtime in the signature header make a changed file miss too.  Entries
+ * are rewritten in place of the old one for the same path, so the
+ * directory holds at most one signature per large file ever synced.
+ */
+
+#include "ftp_delta.h"
+#include "pal_fileio.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if FTP_HASH_SIMD && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define DELTA_HAVE_SSSE3 1
+#else
+#define DELTA_HAVE_SSSE3 0
+#endif
+
+#if defined(__linux__)
+#define DELTA_HAVE_CFR 1
+#elif defined(__FreeBSD__) && !defined(PLATFORM_PS4) &&                       \
+    !defined(PLATFORM_PS5)
+#include <sys/param.h>
+#if __FreeBSD_version >= 1300037
+#define DELTA_HAVE_CFR 1
+#endif
+#endif
+
+/* Bytes per copy_file_range() call */
+#define DELTA_CFR_CHUNK (8U * 1024U * 1024U)
+
+static const uint8_t SIG_MAGIC[4] = {'Z', 'D', 'S', 'G'};
+static const uint8_t DELTA_MAGIC[4] = {'Z', 'D', 'L', 'T'};
+
+static void put_be32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static void put_be64(uint8_t *p, uint64_t v) {
+  put_be32(p, (uint32_t)(v >> 32));
+  put_be32(p + 4, (uint32_t)v);
+}
+
+static uint32_t get_be32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t get_be64(const uint8_t *p) {
+  return ((uint64_t)get_be32(p) << 32) | (uint64_t)get_be32(p + 4);
+}
+
+uint32_t ftp_delta_block_size(uint64_t size) {
+  uint32_t bs = FTP_DELTA_BLOCK_MIN;
+  while ((bs < FTP_DELTA_BLOCK_MAX) && (((uint64_t)bs * bs) < size)) {
+    bs <<= 1;
+  }
+  return bs;
+}
+
+uint64_t ftp_delta_block_count(const ftp_delta_basis_t *b) {
+  if ((b == NULL) || (b->block_size == 0U)) {
+    return 0U;
+  }
+  return (b->size + b->block_size - 1U) / b->block_size;
+}
+
+/*===========================================================================*
+ * CHECKSUMS
+ *===========================================================================*/
+
+static atomic_int g_force_scalar = ATOMIC_VAR_INIT(0);
+
+void ftp_delta_force_scalar(int scalar) {
+  atomic_store_explicit(&g_force_scalar, (scalar != 0) ? 1 : 0,
+                        memory_order_relaxed);
+}
+
+/*
+ * b gains the running a after every byte, which adds up to
+ * sum((len - i) * x[i]).  Sums wrap mod 2^32; only the low 16 bits of
+ * each are kept.
+ */
+static void weak_scalar(const uint8_t *p, size_t len, uint32_t *a,
+                        uint32_t *b) {
+  for (size_t i = 0U; i < len; i++) {
+    *a += p[i];
+    *b += *a;
+  }
+}
+
+#if DELTA_HAVE_SSSE3
+/*
+ * 16 bytes per step: b += 16 * a + sum((16 - k) * x[k]), a += sum(x[k]).
+ * psadbw gives the byte sum, pmaddubsw + pmaddwd the weighted one.
+ */
+__attribute__((target("ssse3"))) static void
+weak_ssse3(const uint8_t *p, size_t len, uint32_t *a, uint32_t *b) {
+  const __m128i weights =
+      _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i zero = _mm_setzero_si128();
+  __m128i va = _mm_setzero_si128();
+  __m128i va_prior = _mm_setzero_si128();
+  __m128i vb = _mm_setzero_si128();
+
+  size_t chunks = len / 16U;
+  for (size_t i = 0U; i < chunks; i++) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(const void *)(p + (i * 16U)));
+    va_prior = _mm_add_epi32(va_prior, va);
+    va = _mm_add_epi32(va, _mm_sad_epu8(x, zero));
+    vb = _mm_add_epi32(vb,
+                       _mm_madd_epi16(_mm_maddubs_epi16(x, weights), ones));
+  }
+
+  va = _mm_add_epi32(va, _mm_shuffle_epi32(va, 0x4E));
+  va_prior = _mm_add_epi32(va_prior, _mm_shuffle_epi32(va_prior, 0x4E));
+  vb = _mm_add_epi32(vb, _mm_shuffle_epi32(vb, 0x4E));
+  vb = _mm_add_epi32(vb, _mm_shuffle_epi32(vb, 0xB1));
+
+  uint32_t sum_a = (uint32_t)_mm_cvtsi128_si32(va);
+  *b += (16U * ((uint32_t)chunks * *a + (uint32_t)_mm_cvtsi128_si32(va_prior))) +
+        (uint32_t)_mm_cvtsi128_si32(vb);
+  *a += sum_a;
+  weak_scalar(p + (chunks * 16U), len - (chunks * 16U), a, b);
+}
+
+static int ssse3_supported(void) {
+#if defined(PLATFORM_PS4) || defined(PS4) || defined(PLATFORM_PS5) ||         \
+    defined(PS5)
+  return 1; /* Jaguar and Zen2 */
+#else
+  unsigned a = 0U;
+  unsigned b = 0U;
+  unsigned c = 0U;
+  unsigned d = 0U;
+  if (__get_cpuid(1U, &a, &b, &c, &d) == 0) {
+    return 0;
+  }
+  return ((c & (1U << 9)) != 0U) ? 1 : 0;
+#endif
+}
+#endif /* DELTA_HAVE_SSSE3 */
+
+static int weak_accel(void) {
+#if DELTA_HAVE_SSSE3
+  static atomic_int cached = ATOMIC_VAR_INIT(-1);
+  int v = atomic_load_explicit(&cached, memory_order_relaxed);
+  if (v < 0) {
+    v = ssse3_supported();
+    atomic_store_explicit(&cached, v, memory_order_relaxed);
+  }
+  return (atomic_load_explicit(&g_force_scalar, memory_order_relaxed) == 0)
+             ? v
+             : 0;
+#else
+  return 0;
+#endif
+}
+
+uint32_t ftp_delta_weak(const void *data, size_t len) {
+  uint32_t a = 0U;
+  uint32_t b = 0U;
+  if (data != NULL) {
+#if DELTA_HAVE_SSSE3
+    if (weak_accel() != 0) {
+      weak_ssse3((const uint8_t *)data, len, &a, &b);
+      return (a & 0xFFFFU) | (b << 16);
+    }
+#endif
+    weak_scalar((const uint8_t *)data, len, &a, &b);
+  }
+  return (a & 0xFFFFU) | (b << 16);
+}
+
+uint32_t ftp_delta_roll(uint32_t weak, uint8_t out, uint8_t in, uint32_t len) {
+  uint32_t a = ((weak & 0xFFFFU) - out + in) & 0xFFFFU;
+  uint32_t b = ((weak >> 16) - (len * out) + a) & 0xFFFFU;
+  return a | (b << 16);
+}
+
+void ftp_delta_strong(const void *data, size_t len,
+                      uint8_t out[FTP_DELTA_STRONG_LEN]) {
+  ftp_hash_ctx_t ctx;
+  uint8_t digest[FTP_HASH_MAX_DIGEST];
+  ftp_hash_init(&ctx, FTP_HASH_SHA256);
+  ftp_hash_update(&ctx, data, len);
+  ftp_hash_final(&ctx, digest);
+  memcpy(out, digest, FTP_DELTA_STRONG_LEN);
+}
+
+const char *ftp_delta_kernel_name(void) {
+  return (weak_accel() != 0) ? "ssse3" : "scalar";
+}
+
+/*===========================================================================*
+ * SIGNATURES
+ *===========================================================================*/
+
+void ftp_delta_sig_header(uint8_t out[FTP_DELTA_SIG_HEADER],
+                          const ftp_delta_basis_t *b) {
+  memcpy(out, SIG_MAGIC, 4U);
+  put_be32(out + 4, b->block_size);
+  put_be64(out + 8, b->size);
+  put_be64(out + 16, (uint64_t)b->mtime);
+  put_be32(out + 24, FTP_DELTA_STRONG_LEN);
+  put_be32(out + 28, 0U);
+}
+
+int ftp_delta_sig_parse(const uint8_t in[FTP_DELTA_SIG_HEADER],
+                        ftp_delta_basis_t *b) {
+  if ((in == NULL) || (b == NULL) || (memcmp(in, SIG_MAGIC, 4U) != 0) ||
+      (get_be32(in + 24) != FTP_DELTA_STRONG_LEN)) {
+    return -1;
+  }
+  b->block_size = get_be32(in + 4);
+  b->size = get_be64(in + 8);
+  b->mtime = (int64_t)get_be64(in + 16);
+  return ((b->block_size == 0U) || (b->block_size > FTP_DELTA_BLOCK_MAX))
+             ? -1
+             : 0;
+}
+
+/* Entries are emitted in batches of this many */
+#define SIG_BATCH 64U
+
+int ftp_delta_sig_fd(int fd, const ftp_delta_basis_t *b, void *buf,
+                     size_t buf_size, ftp_delta_emit_t emit, void *ctx,
+                     ftp_hash_ctx_t *whole) {
+  if ((b == NULL) || (b->block_size == 0U) || (buf == NULL) ||
+      (buf_size < b->block_size) || (emit == NULL)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  uint8_t out[SIG_BATCH * FTP_DELTA_SIG_ENTRY];
+  ftp_delta_sig_header(out, b);
+  int rc = emit(ctx, out, FTP_DELTA_SIG_HEADER);
+  if (rc != 0) {
+    return rc;
+  }
+
+  size_t chunk = (buf_size / b->block_size) * b->block_size;
+  uint64_t off = 0U;
+  size_t batched = 0U;
+  while (off < b->size) {
+    size_t want = ((b->size - off) < chunk) ? (size_t)(b->size - off) : chunk;
+    size_t got = 0U;
+    while (got < want) {
+      ssize_t n = pread(fd, (uint8_t *)buf + got, want - got,
+                        (off_t)(off + got));
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return -1;
+      }
+      if (n == 0) {
+        errno = EIO; /* shrank underneath us */
+        return -1;
+      }
+      got += (size_t)n;
+    }
+    if (whole != NULL) {
+      ftp_hash_update(whole, buf, got);
+    }
+
+    for (size_t at = 0U; at < got; at += b->block_size) {
+      size_t n = ((got - at) < b->block_size) ? (got - at) : b->block_size;
+      const uint8_t *blk = (const uint8_t *)buf + at;
+      uint8_t *e = out + (batched * FTP_DELTA_SIG_ENTRY);
+      put_be32(e, ftp_delta_weak(blk, n));
+      ftp_delta_strong(blk, n, e + 4);
+      if (++batched == SIG_BATCH) {
+        rc = emit(ctx, out, batched * FTP_DELTA_SIG_ENTRY);
+        if (rc != 0) {
+          return rc;
+        }
+        batched = 0U;
+      }
+    }
+    off += got;
+  }
+  return (batched > 0U) ? emit(ctx, out, batched * FTP_DELTA_SIG_ENTRY) : 0;
+}
+
+/*===========================================================================*
+ * DELTA STREAM
+ *===========================================================================*/
+
+enum {
+  RD_HEADER = 0,
+  RD_TAG,
+  RD_COPY,
+  RD_LITLEN,
+  RD_LITERAL,
+  RD_END,
+  RD_DONE,
+};
+
+void ftp_delta_header(uint8_t out[FTP_DELTA_HEADER],
+                      const ftp_delta_header_t *h) {
+  memcpy(out, DELTA_MAGIC, 4U);
+  put_be32(out + 4, h->basis.block_size);
+  put_be64(out + 8, h->basis.size);
+  put_be64(out + 16, (uint64_t)h->basis.mtime);
+  put_be64(out + 24, h->result_size);
+}
+
+void ftp_delta_reader_init(ftp_delta_reader_t *r,
+                           const ftp_delta_sink_t *sink) {
+  memset(r, 0, sizeof(*r));
+  r->sink = *sink;
+  r->state = RD_HEADER;
+  r->need = FTP_DELTA_HEADER;
+}
+
+static void reader_expect(ftp_delta_reader_t *r, int state, size_t need) {
+  r->state = state;
+  r->need = need;
+  r->have = 0U;
+}
+
+/* A complete header or record is in rec[] */
+static ftp_error_t reader_record(ftp_delta_reader_t *r) {
+  int rc = 0;
+  switch (r->state) {
+  case RD_HEADER:
+    if (memcmp(r->rec, DELTA_MAGIC, 4U) != 0) {
+      return FTP_ERR_PROTOCOL;
+    }
+    r->hdr.basis.block_size = get_be32(r->rec + 4);
+    r->hdr.basis.size = get_be64(r->rec + 8);
+    r->hdr.basis.mtime = (int64_t)get_be64(r->rec + 16);
+    r->hdr.result_size = get_be64(r->rec + 24);
+    if (r->hdr.basis.block_size == 0U) {
+      return FTP_ERR_PROTOCOL;
+    }
+    rc = r->sink.begin(r->sink.ctx, &r->hdr);
+    reader_expect(r, RD_TAG, 1U);
+    break;
+
+  case RD_TAG:
+    if (r->rec[0] == (uint8_t)FTP_DELTA_COPY) {
+      reader_expect(r, RD_COPY, 12U);
+    } else if (r->rec[0] == (uint8_t)FTP_DELTA_LITERAL) {
+      reader_expect(r, RD_LITLEN, 4U);
+    } else if (r->rec[0] == (uint8_t)FTP_DELTA_END) {
+      reader_expect(r, RD_END, 32U);
+    } else {
+      return FTP_ERR_PROTOCOL;
+    }
+    break;
+
+  case RD_COPY: {
+    uint64_t first = get_be64(r->rec);
+    uint32_t count = get_be32(r->rec + 8);
+    uint64_t bs = r->hdr.basis.block_size;
+    uint64_t blocks = ftp_delta_block_count(&r->hdr.basis);
+    if ((count == 0U) || (first >= blocks) || (count > (blocks - first))) {
+      return FTP_ERR_PROTOCOL;
+    }
+    uint64_t offset = first * bs;
+    uint64_t end = (first + count) * bs;
+    uint64_t len = ((end < r->hdr.basis.size) ? end : r->hdr.basis.size) -
+                   offset;
+    if (len > (r->hdr.result_size - r->produced)) {
+      return FTP_ERR_PROTOCOL;
+    }
+    r->produced += len;
+    rc = r->sink.copy(r->sink.ctx, offset, len);
+    reader_expect(r, RD_TAG, 1U);
+    break;
+  }
+
+  case RD_LITLEN:
+    r->literal_left = get_be32(r->rec);
+    if (r->literal_left > (r->hdr.result_size - r->produced)) {
+      return FTP_ERR_PROTOCOL;
+    }
+    r->produced += r->literal_left;
+    reader_expect(r, (r->literal_left > 0U) ? RD_LITERAL : RD_TAG,
+                  (r->literal_left > 0U) ? 0U : 1U);
+    break;
+
+  case RD_END:
+    if (r->produced != r->hdr.result_size) {
+      return FTP_ERR_PROTOCOL;
+    }
+    rc = r->sink.end(r->sink.ctx, r->rec);
+    reader_expect(r, RD_DONE, 0U);
+    break;
+
+  default:
+    return FTP_ERR_PROTOCOL;
+  }
+  return (rc < 0) ? (ftp_error_t)rc : FTP_OK;
+}
+
+ftp_error_t ftp_delta_reader_feed(ftp_delta_reader_t *r, const void *data,
+                                  size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  while (len > 0U) {
+    if (r->state == RD_DONE) {
+      return FTP_ERR_PROTOCOL;
+    }
+    if (r->state == RD_LITERAL) {
+      size_t n = (len < r->literal_left) ? len : (size_t)r->literal_left;
+      int rc = r->sink.data(r->sink.ctx, p, n);
+      if (rc < 0) {
+        return (ftp_error_t)rc;
+      }
+      r->literal_left -= n;
+      p += n;
+      len -= n;
+      if (r->literal_left == 0U) {
+        reader_expect(r, RD_TAG, 1U);
+      }
+      continue;
+    }
+
+    size_t n = r->need - r->have;
+    n = (len < n) ? len : n;
+    memcpy(r->rec + r->have, p, n);
+    r->have += n;
+    p += n;
+    len -= n;
+    if (r->have == r->need) {
+      ftp_error_t err = reader_record(r);
+      if (err != FTP_OK) {
+        return err;
+      }
+    }
+  }
+  return FTP_OK;
+}
+
+ftp_error_t ftp_delta_reader_finish(const ftp_delta_reader_t *r) {
+  return (r->state == RD_DONE) ? FTP_OK : FTP_ERR_PROTOCOL;
+}
+
+int ftp_delta_copy(int src, uint64_t offset, int dst, uint64_t len, void *buf,
+                   size_t buf_size) {
+#if defined(DELTA_HAVE_CFR)
+  while (len > 0U) {
+#if defined(__linux__)
+    loff_t in = (loff_t)offset;
+#else
+    off_t in = (off_t)offset;
+#endif
+    size_t want =
+        (len < (uint64_t)DELTA_CFR_CHUNK) ? (size_t)len : DELTA_CFR_CHUNK;
+    ssize_t n = copy_file_range(src, &in, dst, NULL, want, 0U);
+    if (n > 0) {
+      offset += (uint64_t)n;
+      len -= (uint64_t)n;
+      continue;
+    }
+    if ((n < 0) && (errno == EINTR)) {
+      continue;
+    }
+    if ((n < 0) && (errno != ENOSYS) && (errno != EXDEV) &&
+        (errno != EINVAL) && (errno != EOPNOTSUPP)) {
+      return -1;
+    }
+    break; /* refused, or EOF: read() below tells which */
+  }
+#endif
+
+  while (len > 0U) {
+    size_t want = (len < (uint64_t)buf_size) ? (size_t)len : buf_size;
+    ssize_t n = pread(src, buf, want, (off_t)offset);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (n == 0) {
+      errno = EIO;
+      return -1;
+    }
+    if (pal_file_write_all(dst, buf, (size_t)n) != n) {
+      return -1;
+    }
+    offset += (uint64_t)n;
+    len -= (uint64_t)n;
+  }
+  return 0;
+}
+
+/*===========================================================================*
+ * SIGNATURE CACHE
+ *===========================================================================*/
+
+static char g_sig_dir[256] = FTP_DELTA_SIG_DIR;
+static pthread_mutex_t g_sig_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* <dir>/<16 hex>.sig; 0, or -1 when caching is off */
+static int sig_cache_name(const char *path, char *out, size_t size) {
+  uint8_t digest[FTP_HASH_MAX_DIGEST];
+  char hex[FTP_HASH_HEX_MAX];
+  ftp_hash_ctx_t ctx;
+  ftp_hash_init(&ctx, FTP_HASH_SHA256);
+  ftp_hash_update(&ctx, path, strlen(path));
+  ftp_hash_final(&ctx, digest);
+  ftp_hash_hex(digest, 8U, hex, sizeof(hex));
+
+  pthread_mutex_lock(&g_sig_lock);
+  int off = (g_sig_dir[0] == '\0') ? 1 : 0;
+  int w = snprintf(out, size, "%s/%s.sig", g_sig_dir, hex);
+  pthread_mutex_unlock(&g_sig_lock);
+  return ((off != 0) || (w < 0) || ((size_t)w >= size)) ? -1 : 0;
+}
+
+static int read_full(int fd, void *buf, size_t len) {
+  size_t got = 0U;
+  while (got < len) {
+    ssize_t n = read(fd, (uint8_t *)buf + got, len - got);
+    if ((n < 0) && (errno == EINTR)) {
+      continue;
+    }
+    if (n <= 0) {
+      return -1;
+    }
+    got += (size_t)n;
+  }
+  return 0;
+}
+
+int ftp_delta_sig_cache_open(const char *path, const ftp_delta_basis_t *b) {
+  char name[FTP_PATH_MAX];
+  if ((path == NULL) || (b == NULL) ||
+      (sig_cache_name(path, name, sizeof(name)) != 0)) {
+    return -1;
+  }
+  int fd = pal_file_open(name, O_RDONLY, 0);
+  if (fd < 0) {
+    return -1;
+  }
+
+  uint8_t rec[FTP_DELTA_SIG_HEADER];
+  char stored[FTP_PATH_MAX];
+  size_t plen = strlen(path);
+  ftp_delta_basis_t have;
+  if ((read_full(fd, rec, 4U) != 0) || (get_be32(rec) != plen) ||
+      (plen >= sizeof(stored)) || (read_full(fd, stored, plen) != 0) ||
+      (memcmp(stored, path, plen) != 0) ||
+      (read_full(fd, rec, sizeof(rec)) != 0) ||
+      (ftp_delta_sig_parse(rec, &have) != 0) ||
+      (have.block_size != b->block_size) || (have.size != b->size) ||
+      (have.mtime != b->mtime) ||
+      (lseek(fd, (off_t)(4U + plen), SEEK_SET) < 0)) {
+    pal_file_close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+int ftp_delta_sig_cache_create(const char *path, char *tmp, size_t tmp_size) {
+  char name[FTP_PATH_MAX];
+  if ((path == NULL) || (tmp == NULL) ||
+      (sig_cache_name(path, name, sizeof(name)) != 0)) {
+    return -1;
+  }
+  int w = snprintf(tmp, tmp_size, "%s.%lu.tmp", name,
+                   (unsigned long)pthread_self());
+  if ((w < 0) || ((size_t)w >= tmp_size)) {
+    return -1;
+  }
+
+  char *slash = strrchr(name, '/');
+  if (slash != NULL) {
+    *slash = '\0';
+    (void)mkdir(name, 0755);
+  }
+  int fd = pal_file_open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+  uint8_t len[4];
+  size_t plen = strlen(path);
+  put_be32(len, (uint32_t)plen);
+  if ((pal_file_write_all(fd, len, sizeof(len)) != (ssize_t)sizeof(len)) ||
+      (pal_file_write_all(fd, path, plen) != (ssize_t)plen)) {
+    pal_file_close(fd);
+    (void)unlink(tmp);
+    return -1;
+  }
+  return fd;
+}
+
+void ftp_delta_sig_cache_commit(const char *path, int fd, const char *tmp,
+                                int ok) {
+  char name[FTP_PATH_MAX];
+  if (fd < 0) {
+    return;
+  }
+  if (pal_file_close(fd) != FTP_OK) {
+    ok = 0;
+  }
+  if ((ok != 0) && (sig_cache_name(path, name, sizeof(name)) == 0) &&
+      (rename(tmp, name) == 0)) {
+    return;
+  }
+  (void)unlink(tmp);
+}
+
+void ftp_delta_sig_cache_reset(const char *dir) {
+  pthread_mutex_lock(&g_sig_lock);
+  (void)snprintf(g_sig_dir, sizeof(g_sig_dir), "%s",
+                 (dir != NULL) ? dir : FTP_DELTA_SIG_DIR);
+  pthread_mutex_unlock(&g_sig_lock);
+}
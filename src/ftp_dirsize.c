@@ -0,0 +1,1240 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_dirsize.c
+ * @brief Background, incrementally refreshed directory-size index
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * One node per indexed directory:
+ *
+ *   own    st_blocks * 512 of the regular files directly inside
+ *   total  own + total of every child directory
+ *   mtime  directory mtime when own and the child list were read
+ *
+ * A walk pops directories from a shared stack; FTP_DIRSIZE_THREADS
+ * walkers run it in parallel.  A directory whose mtime did not change
+ * is not re-read: the stored own size and child list are reused, so a
+ * revalidation costs one lstat() per directory instead of one per file.
+ * When the stack drains ("epoch" end), totals are summed in reverse
+ * visit order — children were always visited after their parent — and
+ * carried up to the ancestors of every directory visited.
+ *
+ * A directory is re-read ("dirty") when
+ *   - ftp_dirsize_invalidate() reports one of our own FTP/HTTP writes,
+ *   - its watch fires (inotify, or kqueue EVFILT_VNODE),
+ *   - its mtime differs during a revalidation.
+ * A directory modified within the last second is never trusted for
+ * reuse, since a second change in the same second keeps the mtime.
+ * kqueue only reports entries added or removed; files growing in place
+ * are caught by the revalidation of subtrees that are not fully
+ * watched, once a query finds them older than FTP_DIRSIZE_FRESH_S.
+ *
+ * ON-DISK FORMAT (FTP_DIRSIZE_INDEX_PATH, parents before children):
+ *
+ *   <mtime> <own-bytes> <flags> <path>\n
+ *
+ * Loaded nodes are unverified: answers are flagged stale until the first
+ * revalidation, which mostly costs one lstat() per directory.
+ */
+
+#include "ftp_dirsize.h"
+#include "ftp_config.h"
+#include "pal_thread.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#if (FTP_DIRSIZE_WATCH_MAX > 0) && defined(__linux__)
+#define DS_INOTIFY 1
+#include <poll.h>
+#include <sys/inotify.h>
+#elif (FTP_DIRSIZE_WATCH_MAX > 0) &&                                          \
+    (defined(__FreeBSD__) || defined(__APPLE__) || defined(PLATFORM_PS4) ||   \
+     defined(PLATFORM_PS5))
+#define DS_KQUEUE 1
+#include <sys/event.h>
+#endif
+
+#define DS_NIL UINT32_MAX
+#define DS_BUCKETS_MIN 1024U
+#define DS_WATCH_BUCKETS 1024U
+
+#define DS_READ 0x01U          /* own and kids come from a readdir      */
+#define DS_TRUST 0x02U         /* mtime old enough to detect changes    */
+#define DS_TRUNC 0x04U         /* FTP_DIRSIZE_MAX_DIRS dropped children */
+#define DS_DIRTY 0x08U         /* re-read queued by a change report     */
+#define DS_QUEUED 0x10U        /* on the walk stack                     */
+#define DS_MARK 0x20U          /* scratch while diffing child lists     */
+#define DS_SUMMED 0x40U        /* total / oldest / agg bits are set     */
+#define DS_AGG_PARTIAL 0x80U   /* subtree has unread or capped dirs     */
+#define DS_AGG_UNWATCHED 0x100U /* subtree has dirs without a watch     */
+
+/* Flags kept in the on-disk index */
+#define DS_SAVED_FLAGS (DS_READ | DS_TRUST | DS_TRUNC)
+
+typedef struct {
+  char *path; /* NULL = free node */
+  uint32_t parent;
+  uint32_t *kids;
+  uint32_t nkids;
+  uint32_t hnext;       /* path hash chain, or free list */
+  uint32_t wnext;       /* watch hash chain */
+  uint32_t serial;      /* bumped on free: stale stack items are dropped */
+  uint32_t dirty_below; /* dirty nodes in this subtree, self included */
+  uint32_t epoch;       /* last walk epoch that visited it */
+  uint32_t flags;
+  int wd; /* inotify watch or kqueue descriptor, -1 = none */
+  int64_t mtime;
+  int64_t verified; /* time() of the last visit, 0 = never (loaded) */
+  int64_t oldest;   /* min verified over the subtree */
+  uint64_t own;
+  uint64_t total;
+} ds_node_t;
+
+typedef struct {
+  uint32_t idx;
+  uint32_t serial;
+  int deep; /* also revisit the children already known */
+} ds_item_t;
+
+/* Result of reading one directory, built without the lock */
+typedef struct {
+  uint64_t own;
+  char *names; /* NUL-separated child directory names */
+  size_t len;
+  size_t cap;
+} ds_scan_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_done_cv = PTHREAD_COND_INITIALIZER;
+
+static ds_node_t *g_nodes;
+static uint32_t g_cap;
+static uint32_t g_used; /* slots ever handed out */
+static uint32_t g_free = DS_NIL;
+static uint32_t g_live;
+static uint32_t *g_buckets;
+static uint32_t g_nbuckets;
+static uint32_t g_wbuckets[DS_WATCH_BUCKETS];
+
+static ds_item_t *g_stack;
+static size_t g_slen;
+static size_t g_scap;
+static ds_item_t *g_order; /* visits of the running epoch */
+static size_t g_olen;
+static size_t g_ocap;
+static uint32_t g_busy;
+static uint32_t g_epoch = 1U;
+
+static int g_started;
+static int g_stop;
+static pthread_t g_walkers[FTP_DIRSIZE_THREADS];
+static unsigned g_nwalkers;
+static pthread_t g_watcher;
+static int g_have_watcher;
+static int g_watch_fd = -1;
+
+static char g_index_path[256] = FTP_DIRSIZE_INDEX_PATH;
+static int g_unsaved;
+static int64_t g_saved_at;
+static ftp_dirsize_stats_t g_stats;
+
+/*===========================================================================*
+ * NODES
+ *===========================================================================*/
+
+static uint32_t ds_hash(const char *s) {
+  uint32_t h = 2166136261U;
+  for (; *s != '\0'; s++) {
+    h ^= (uint8_t)*s;
+    h *= 16777619U;
+  }
+  return h;
+}
+
+static uint32_t find_locked(const char *path) {
+  if (g_nbuckets == 0U) {
+    return DS_NIL;
+  }
+  uint32_t i = g_buckets[ds_hash(path) & (g_nbuckets - 1U)];
+  while ((i != DS_NIL) && (strcmp(g_nodes[i].path, path) != 0)) {
+    i = g_nodes[i].hnext;
+  }
+  return i;
+}
+
+static int rehash_locked(uint32_t want) {
+  uint32_t n = DS_BUCKETS_MIN;
+  while (n < want) {
+    n <<= 1U;
+  }
+  uint32_t *b = malloc((size_t)n * sizeof(*b));
+  if (b == NULL) {
+    return -1;
+  }
+  for (uint32_t k = 0U; k < n; k++) {
+    b[k] = DS_NIL;
+  }
+  for (uint32_t i = 0U; i < g_used; i++) {
+    if (g_nodes[i].path != NULL) {
+      uint32_t h = ds_hash(g_nodes[i].path) & (n - 1U);
+      g_nodes[i].hnext = b[h];
+      b[h] = i;
+    }
+  }
+  free(g_buckets);
+  g_buckets = b;
+  g_nbuckets = n;
+  return 0;
+}
+
+/* Note: may move g_nodes — re-fetch node pointers afterwards */
+static uint32_t node_new_locked(const char *path) {
+  if (g_live >= FTP_DIRSIZE_MAX_DIRS) {
+    return DS_NIL;
+  }
+  if ((g_live >= g_nbuckets) && (rehash_locked(g_live + 1U) != 0)) {
+    return DS_NIL;
+  }
+  uint32_t i;
+  if (g_free != DS_NIL) {
+    i = g_free;
+  } else {
+    if (g_used == g_cap) {
+      uint32_t cap = (g_cap != 0U) ? (g_cap * 2U) : 256U;
+      ds_node_t *grown = realloc(g_nodes, (size_t)cap * sizeof(*grown));
+      if (grown == NULL) {
+        return DS_NIL;
+      }
+      g_nodes = grown;
+      g_cap = cap;
+    }
+    i = g_used;
+    g_nodes[i].serial = 0U;
+  }
+  char *copy = strdup(path);
+  if (copy == NULL) {
+    return DS_NIL;
+  }
+  if (i == g_free) {
+    g_free = g_nodes[i].hnext;
+  } else {
+    g_used++;
+  }
+
+  ds_node_t *n = &g_nodes[i];
+  uint32_t serial = n->serial;
+  memset(n, 0, sizeof(*n));
+  n->path = copy;
+  n->serial = serial;
+  n->parent = DS_NIL;
+  n->wd = -1;
+  uint32_t h = ds_hash(path) & (g_nbuckets - 1U);
+  n->hnext = g_buckets[h];
+  g_buckets[h] = i;
+  g_live++;
+  return i;
+}
+
+static int kid_push_locked(uint32_t p, uint32_t c) {
+  ds_node_t *n = &g_nodes[p];
+  uint32_t *grown = realloc(n->kids, ((size_t)n->nkids + 1U) * sizeof(*grown));
+  if (grown == NULL) {
+    return -1;
+  }
+  n->kids = grown;
+  n->kids[n->nkids++] = c;
+  g_nodes[c].parent = p;
+  return 0;
+}
+
+static void kid_remove_locked(uint32_t p, uint32_t c) {
+  ds_node_t *n = &g_nodes[p];
+  for (uint32_t k = 0U; k < n->nkids; k++) {
+    if (n->kids[k] == c) {
+      n->kids[k] = n->kids[--n->nkids];
+      return;
+    }
+  }
+}
+
+/* Add (or remove) @p count dirty nodes from @p from and its ancestors */
+static void dirty_chain_locked(uint32_t from, uint32_t count, int add) {
+  for (uint32_t j = from; j != DS_NIL; j = g_nodes[j].parent) {
+    if (add != 0) {
+      g_nodes[j].dirty_below += count;
+    } else {
+      g_nodes[j].dirty_below -= count;
+    }
+  }
+}
+
+/*===========================================================================*
+ * WATCHES
+ *===========================================================================*/
+
+static uint32_t watch_find_locked(int wd) {
+  uint32_t i = g_wbuckets[(unsigned)wd % DS_WATCH_BUCKETS];
+  while ((i != DS_NIL) && (g_nodes[i].wd != wd)) {
+    i = g_nodes[i].wnext;
+  }
+  return i;
+}
+
+static void watch_add_locked(uint32_t i) {
+  ds_node_t *n = &g_nodes[i];
+  if ((g_watch_fd < 0) || (n->wd >= 0) ||
+      (g_stats.watches >= FTP_DIRSIZE_WATCH_MAX)) {
+    return;
+  }
+  int wd = -1;
+#if defined(DS_INOTIFY)
+  wd = inotify_add_watch(g_watch_fd, n->path,
+                         IN_ONLYDIR | IN_DONT_FOLLOW | IN_CREATE | IN_DELETE |
+                             IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+                             IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+  /* Same inode under a second path: the first node keeps the watch */
+  if ((wd >= 0) && (watch_find_locked(wd) != DS_NIL)) {
+    return;
+  }
+#elif defined(DS_KQUEUE)
+#if defined(O_EVTONLY)
+  wd = open(n->path, O_EVTONLY | O_CLOEXEC);
+#else
+  wd = open(n->path, O_RDONLY | O_CLOEXEC);
+#endif
+  if (wd >= 0) {
+    struct kevent kev;
+    EV_SET(&kev, (uintptr_t)wd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+           NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME,
+           0, NULL);
+    if (kevent(g_watch_fd, &kev, 1, NULL, 0, NULL) != 0) {
+      (void)close(wd);
+      wd = -1;
+    }
+  }
+#endif
+  if (wd < 0) {
+    return;
+  }
+  n->wd = wd;
+  n->wnext = g_wbuckets[(unsigned)wd % DS_WATCH_BUCKETS];
+  g_wbuckets[(unsigned)wd % DS_WATCH_BUCKETS] = i;
+  g_stats.watches++;
+}
+
+/* @p gone: the kernel already dropped it (inotify IN_IGNORED) */
+static void watch_drop_locked(uint32_t i, int gone) {
+  ds_node_t *n = &g_nodes[i];
+  if (n->wd < 0) {
+    return;
+  }
+  uint32_t *link = &g_wbuckets[(unsigned)n->wd % DS_WATCH_BUCKETS];
+  while ((*link != DS_NIL) && (*link != i)) {
+    link = &g_nodes[*link].wnext;
+  }
+  if (*link == i) {
+    *link = n->wnext;
+  }
+#if defined(DS_INOTIFY)
+  if (gone == 0) {
+    (void)inotify_rm_watch(g_watch_fd, n->wd);
+  }
+#else
+  (void)gone;
+  (void)close(n->wd);
+#endif
+  n->wd = -1;
+  g_stats.watches--;
+}
+
+/*===========================================================================*
+ * TREE UPKEEP
+ *===========================================================================*/
+
+static void free_subtree_locked(uint32_t i) {
+  ds_node_t *n = &g_nodes[i];
+  for (uint32_t k = 0U; k < n->nkids; k++) {
+    free_subtree_locked(n->kids[k]);
+  }
+  watch_drop_locked(i, 0);
+
+  uint32_t *link = &g_buckets[ds_hash(n->path) & (g_nbuckets - 1U)];
+  while ((*link != DS_NIL) && (*link != i)) {
+    link = &g_nodes[*link].hnext;
+  }
+  if (*link == i) {
+    *link = n->hnext;
+  }
+  free(n->path);
+  free(n->kids);
+  n->path = NULL;
+  n->kids = NULL;
+  n->nkids = 0U;
+  n->serial++;
+  n->hnext = g_free;
+  g_free = i;
+  g_live--;
+}
+
+/* Directory gone: detach it from its parent and forget the subtree */
+static void remove_locked(uint32_t i) {
+  uint32_t p = g_nodes[i].parent;
+  if (p != DS_NIL) {
+    dirty_chain_locked(p, g_nodes[i].dirty_below, 0);
+    kid_remove_locked(p, i);
+  }
+  free_subtree_locked(i);
+  g_unsaved = 1;
+}
+
+static void enqueue_locked(uint32_t i, int deep) {
+  ds_node_t *n = &g_nodes[i];
+  if (((n->flags & DS_QUEUED) != 0U) && (deep == 0)) {
+    return;
+  }
+  if (g_slen == g_scap) {
+    size_t cap = (g_scap != 0U) ? (g_scap * 2U) : 256U;
+    ds_item_t *grown = realloc(g_stack, cap * sizeof(*grown));
+    if (grown == NULL) {
+      return;
+    }
+    g_stack = grown;
+    g_scap = cap;
+  }
+  g_stack[g_slen].idx = i;
+  g_stack[g_slen].serial = n->serial;
+  g_stack[g_slen].deep = deep;
+  g_slen++;
+  n->flags |= DS_QUEUED;
+  pthread_cond_signal(&g_work_cv);
+}
+
+/* A change under directory @p i: re-read it soon */
+static void touch_locked(uint32_t i) {
+  ds_node_t *n = &g_nodes[i];
+  if ((n->flags & DS_DIRTY) == 0U) {
+    n->flags |= DS_DIRTY;
+    dirty_chain_locked(i, 1U, 1);
+    g_stats.invalidations++;
+  }
+  enqueue_locked(i, 0);
+}
+
+static void node_sum_locked(uint32_t i) {
+  ds_node_t *n = &g_nodes[i];
+  uint64_t total = n->own;
+  int64_t oldest = n->verified;
+  uint32_t agg = 0U;
+  if (((n->flags & DS_READ) == 0U) || ((n->flags & DS_TRUNC) != 0U)) {
+    agg |= DS_AGG_PARTIAL;
+  }
+  if (n->wd < 0) {
+    agg |= DS_AGG_UNWATCHED;
+  }
+  for (uint32_t k = 0U; k < n->nkids; k++) {
+    const ds_node_t *c = &g_nodes[n->kids[k]];
+    if ((c->flags & DS_SUMMED) == 0U) {
+      agg |= DS_AGG_PARTIAL | DS_AGG_UNWATCHED;
+      oldest = 0;
+      continue;
+    }
+    total += c->total;
+    if (c->oldest < oldest) {
+      oldest = c->oldest;
+    }
+    agg |= c->flags & (DS_AGG_PARTIAL | DS_AGG_UNWATCHED);
+  }
+  n->total = total;
+  n->oldest = oldest;
+  n->flags = (n->flags & ~(DS_AGG_PARTIAL | DS_AGG_UNWATCHED)) | agg |
+             DS_SUMMED;
+}
+
+static int order_push_locked(uint32_t i) {
+  if (g_olen == g_ocap) {
+    size_t cap = (g_ocap != 0U) ? (g_ocap * 2U) : 256U;
+    ds_item_t *grown = realloc(g_order, cap * sizeof(*grown));
+    if (grown == NULL) {
+      return -1;
+    }
+    g_order = grown;
+    g_ocap = cap;
+  }
+  g_order[g_olen].idx = i;
+  g_order[g_olen].serial = g_nodes[i].serial;
+  g_order[g_olen].deep = 0;
+  g_olen++;
+  return 0;
+}
+
+static int order_valid(const ds_item_t *it) {
+  return ((g_nodes[it->idx].path != NULL) &&
+          (g_nodes[it->idx].serial == it->serial))
+             ? 1
+             : 0;
+}
+
+/* @p carry: also refresh ancestors that were not visited themselves */
+static void sum_order_locked(int carry) {
+  for (size_t k = g_olen; k-- > 0U;) {
+    if (order_valid(&g_order[k]) != 0) {
+      node_sum_locked(g_order[k].idx);
+    }
+  }
+  /* Ancestors that were not visited still carry the old totals */
+  for (size_t k = 0U; (carry != 0) && (k < g_olen); k++) {
+    if (order_valid(&g_order[k]) == 0) {
+      continue;
+    }
+    uint32_t p = g_nodes[g_order[k].idx].parent;
+    if ((p != DS_NIL) && (g_nodes[p].epoch != g_epoch)) {
+      for (; p != DS_NIL; p = g_nodes[p].parent) {
+        node_sum_locked(p);
+      }
+    }
+  }
+  g_olen = 0U;
+}
+
+/*===========================================================================*
+ * ON-DISK INDEX
+ *===========================================================================*/
+
+static void save_locked(void) {
+  g_unsaved = 0;
+  g_saved_at = (int64_t)time(NULL);
+  if ((g_index_path[0] == '\0') || (g_live == 0U)) {
+    return;
+  }
+  uint32_t *stack = malloc((size_t)g_live * sizeof(*stack));
+  if (stack == NULL) {
+    return;
+  }
+
+  char tmp[sizeof(g_index_path) + 8U];
+  (void)snprintf(tmp, sizeof(tmp), "%s.tmp", g_index_path);
+  FILE *f = fopen(tmp, "w");
+  if (f == NULL) {
+    free(stack);
+    return;
+  }
+
+  /* Depth-first from every root so parents precede their children */
+  for (uint32_t r = 0U; r < g_used; r++) {
+    if ((g_nodes[r].path == NULL) || (g_nodes[r].parent != DS_NIL)) {
+      continue;
+    }
+    size_t top = 0U;
+    stack[top++] = r;
+    while (top > 0U) {
+      const ds_node_t *n = &g_nodes[stack[--top]];
+      if (strpbrk(n->path, "\r\n") != NULL) {
+        continue; /* unrepresentable: its subtree is rebuilt on demand */
+      }
+      (void)fprintf(f, "%" PRId64 " %" PRIu64 " %u %s\n", n->mtime, n->own,
+                    (unsigned)(n->flags & DS_SAVED_FLAGS), n->path);
+      for (uint32_t k = 0U; (k < n->nkids) && (top < g_live); k++) {
+        stack[top++] = n->kids[k];
+      }
+    }
+  }
+  free(stack);
+
+  if (fclose(f) != 0) {
+    (void)remove(tmp);
+    return;
+  }
+  if (rename(tmp, g_index_path) != 0) {
+    (void)remove(tmp);
+  }
+}
+
+static void load_locked(void) {
+  if (g_index_path[0] == '\0') {
+    return;
+  }
+  FILE *f = fopen(g_index_path, "r");
+  if (f == NULL) {
+    return;
+  }
+
+  char line[FTP_PATH_MAX + 64U];
+  while (fgets(line, (int)sizeof(line), f) != NULL) {
+    long long mtime = 0LL;
+    unsigned long long own = 0ULL;
+    unsigned flags = 0U;
+    int consumed = 0;
+    if (sscanf(line, "%lld %llu %u %n", &mtime, &own, &flags, &consumed) !=
+        3) {
+      continue;
+    }
+    char *path = line + consumed;
+    path[strcspn(path, "\r\n")] = '\0';
+    if ((path[0] != '/') || (find_locked(path) != DS_NIL)) {
+      continue;
+    }
+    uint32_t i = node_new_locked(path);
+    if (i == DS_NIL) {
+      break;
+    }
+    ds_node_t *n = &g_nodes[i];
+    n->mtime = (int64_t)mtime;
+    n->own = (uint64_t)own;
+    n->flags = (uint32_t)flags & DS_SAVED_FLAGS;
+
+    char *slash = strrchr(path, '/');
+    if ((slash != NULL) && (slash[1] != '\0')) {
+      if (slash == path) {
+        slash[1] = '\0'; /* parent is "/" */
+      } else {
+        slash[0] = '\0';
+      }
+      uint32_t p = find_locked(path);
+      if (p != DS_NIL) {
+        (void)kid_push_locked(p, i);
+      }
+    }
+    (void)order_push_locked(i);
+  }
+  fclose(f);
+  sum_order_locked(0); /* every loaded node is in the order */
+}
+
+static void maybe_save_locked(void) {
+  if ((g_unsaved != 0) &&
+      ((int64_t)time(NULL) - g_saved_at >= FTP_DIRSIZE_SAVE_S)) {
+    save_locked();
+  }
+}
+
+/*===========================================================================*
+ * WALKERS
+ *===========================================================================*/
+
+static int scan_add(ds_scan_t *scan, const char *name) {
+  size_t len = strlen(name) + 1U;
+  if (scan->len + len > scan->cap) {
+    size_t cap = (scan->cap != 0U) ? scan->cap : 4096U;
+    while (scan->len + len > cap) {
+      cap *= 2U;
+    }
+    char *grown = realloc(scan->names, cap);
+    if (grown == NULL) {
+      return -1;
+    }
+    scan->names = grown;
+    scan->cap = cap;
+  }
+  memcpy(scan->names + scan->len, name, len);
+  scan->len += len;
+  return 0;
+}
+
+/* Pseudo filesystems under "/" (same set the listings hide) */
+static int skip_at_root(const char *name) {
+  return ((strcmp(name, "dev") == 0) || (strcmp(name, "proc") == 0) ||
+          (strcmp(name, "sys") == 0) || (strcmp(name, "kern") == 0))
+             ? 1
+             : 0;
+}
+
+/* An unreadable directory counts as empty, as the old walk did */
+static void scan_dir(const char *path, int is_root, ds_scan_t *scan) {
+  DIR *dir = opendir(path);
+  if (dir == NULL) {
+    return;
+  }
+  int dfd = dirfd(dir);
+  struct dirent *ent;
+  while ((ent = readdir(dir)) != NULL) {
+    const char *name = ent->d_name;
+    if ((strcmp(name, ".") == 0) || (strcmp(name, "..") == 0) ||
+        ((is_root != 0) && (skip_at_root(name) != 0))) {
+      continue;
+    }
+#if defined(DT_DIR)
+    if (ent->d_type == DT_DIR) {
+      (void)scan_add(scan, name);
+      continue;
+    }
+    if ((ent->d_type != DT_REG) && (ent->d_type != DT_UNKNOWN)) {
+      continue; /* symlinks, devices, ... */
+    }
+#endif
+    struct stat st;
+    if (fstatat(dfd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+      continue;
+    }
+    if (S_ISREG(st.st_mode)) {
+      scan->own += (uint64_t)st.st_blocks * 512U;
+    } else if (S_ISDIR(st.st_mode)) {
+      (void)scan_add(scan, name);
+    }
+  }
+  closedir(dir);
+}
+
+/* Replace the child list of @p i with the directories just read */
+static void apply_kids_locked(uint32_t i, const ds_scan_t *scan, int deep) {
+  uint32_t count = 0U;
+  for (size_t off = 0U; off < scan->len; off += strlen(scan->names + off) + 1U) {
+    count++;
+  }
+  uint32_t *fresh = NULL;
+  if ((count > 0U) && ((fresh = malloc((size_t)count * sizeof(*fresh))) == NULL)) {
+    g_nodes[i].flags |= DS_TRUNC;
+    return;
+  }
+  for (uint32_t k = 0U; k < g_nodes[i].nkids; k++) {
+    g_nodes[g_nodes[i].kids[k]].flags |= DS_MARK;
+  }
+
+  uint32_t nfresh = 0U;
+  char child[FTP_PATH_MAX];
+  for (size_t off = 0U; off < scan->len; off += strlen(scan->names + off) + 1U) {
+    const char *base = g_nodes[i].path;
+    int n = snprintf(child, sizeof(child), "%s%s%s", base,
+                     (strcmp(base, "/") == 0) ? "" : "/", scan->names + off);
+    if ((n < 0) || ((size_t)n >= sizeof(child))) {
+      continue;
+    }
+    uint32_t c = find_locked(child);
+    if (c == DS_NIL) {
+      c = node_new_locked(child);
+      if (c == DS_NIL) {
+        g_nodes[i].flags |= DS_TRUNC;
+        continue;
+      }
+    } else if (g_nodes[c].parent != i) {
+      /* Indexed on its own before this directory: adopt it */
+      if (g_nodes[c].parent != DS_NIL) {
+        dirty_chain_locked(g_nodes[c].parent, g_nodes[c].dirty_below, 0);
+        kid_remove_locked(g_nodes[c].parent, c);
+      }
+      dirty_chain_locked(i, g_nodes[c].dirty_below, 1);
+    }
+    g_nodes[c].parent = i;
+    g_nodes[c].flags &= ~DS_MARK;
+    fresh[nfresh++] = c;
+    if ((deep != 0) || ((g_nodes[c].flags & DS_READ) == 0U)) {
+      enqueue_locked(c, 1);
+    }
+  }
+
+  ds_node_t *n = &g_nodes[i];
+  for (uint32_t k = 0U; k < n->nkids; k++) {
+    uint32_t c = n->kids[k];
+    if ((g_nodes[c].flags & DS_MARK) != 0U) {
+      dirty_chain_locked(i, g_nodes[c].dirty_below, 0);
+      free_subtree_locked(c);
+    }
+  }
+  free(n->kids);
+  n->kids = fresh;
+  n->nkids = nfresh;
+}
+
+static void visit_locked(const ds_item_t *it, char *path, size_t path_size) {
+  uint32_t i = it->idx;
+  ds_node_t *n = &g_nodes[i];
+  n->flags &= ~DS_QUEUED;
+  int reuse = (((n->flags & (DS_READ | DS_TRUST | DS_TRUNC | DS_DIRTY)) ==
+                (DS_READ | DS_TRUST)))
+                  ? 1
+                  : 0;
+  if ((n->flags & DS_DIRTY) != 0U) {
+    n->flags &= ~DS_DIRTY;
+    dirty_chain_locked(i, 1U, 0);
+  }
+  int64_t old_mtime = n->mtime;
+  n->epoch = g_epoch;
+  (void)order_push_locked(i);
+  (void)snprintf(path, path_size, "%s", n->path);
+  int is_root = (strcmp(path, "/") == 0) ? 1 : 0;
+  g_busy++;
+  pthread_mutex_unlock(&g_lock);
+
+  struct stat st;
+  int exists = ((lstat(path, &st) == 0) && S_ISDIR(st.st_mode)) ? 1 : 0;
+  int64_t now = (int64_t)time(NULL);
+  int read_it = ((exists != 0) &&
+                 ((reuse == 0) || ((int64_t)st.st_mtime != old_mtime)))
+                    ? 1
+                    : 0;
+  ds_scan_t scan;
+  memset(&scan, 0, sizeof(scan));
+  if (read_it != 0) {
+    scan_dir(path, is_root, &scan);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  g_busy--;
+  n = &g_nodes[i];
+  if ((n->path == NULL) || (n->serial != it->serial)) {
+    free(scan.names); /* removed while we were reading it */
+    return;
+  }
+  if (exists == 0) {
+    remove_locked(i);
+    free(scan.names);
+    return;
+  }
+  n->verified = now;
+  if (read_it == 0) {
+    g_stats.reuses++;
+    for (uint32_t k = 0U; (it->deep != 0) && (k < n->nkids); k++) {
+      enqueue_locked(g_nodes[i].kids[k], 1);
+    }
+    watch_add_locked(i); /* loaded from disk: not watched yet */
+    return;
+  }
+
+  g_stats.reads++;
+  g_unsaved = 1;
+  n->own = scan.own;
+  n->mtime = (int64_t)st.st_mtime;
+  n->flags &= ~(DS_TRUST | DS_TRUNC);
+  n->flags |= DS_READ;
+  if (n->mtime < now - 1) {
+    n->flags |= DS_TRUST;
+  }
+  apply_kids_locked(i, &scan, it->deep);
+  free(scan.names);
+  watch_add_locked(i);
+}
+
+static void epoch_end_locked(void) {
+  sum_order_locked(1);
+  g_epoch++;
+  pthread_cond_broadcast(&g_done_cv);
+  maybe_save_locked();
+}
+
+static void *walker_main(void *arg) {
+  (void)arg;
+  char path[FTP_PATH_MAX];
+
+  pthread_mutex_lock(&g_lock);
+  while (g_stop == 0) {
+    if (g_slen == 0U) {
+      pthread_cond_wait(&g_work_cv, &g_lock);
+      continue;
+    }
+    ds_item_t it = g_stack[--g_slen];
+    if (order_valid(&it) != 0) {
+      visit_locked(&it, path, sizeof(path));
+    }
+    if ((g_slen == 0U) && (g_busy == 0U) && (g_stop == 0)) {
+      epoch_end_locked();
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+  return NULL;
+}
+
+/*===========================================================================*
+ * WATCHER
+ *===========================================================================*/
+
+/* Watch queue overflowed: nothing can be trusted without a re-read */
+static void forget_trust_locked(void) {
+  for (uint32_t i = 0U; i < g_used; i++) {
+    if (g_nodes[i].path != NULL) {
+      g_nodes[i].flags &= ~DS_TRUST;
+      g_nodes[i].verified = 0;
+      g_nodes[i].oldest = 0;
+    }
+  }
+}
+
+#if defined(DS_INOTIFY)
+static void *watcher_main(void *arg) {
+  (void)arg;
+  uint64_t buf[512];
+
+  for (;;) {
+    pthread_mutex_lock(&g_lock);
+    int stop = g_stop;
+    pthread_mutex_unlock(&g_lock);
+    if (stop != 0) {
+      break;
+    }
+    struct pollfd pfd = {g_watch_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 500) <= 0) {
+      continue;
+    }
+    ssize_t got = read(g_watch_fd, buf, sizeof(buf));
+    if (got <= 0) {
+      continue;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    const char *p = (const char *)buf;
+    const char *end = p + got;
+    while (p + sizeof(struct inotify_event) <= end) {
+      struct inotify_event ev;
+      memcpy(&ev, p, sizeof(ev));
+      p += sizeof(ev) + ev.len;
+      if ((ev.mask & IN_Q_OVERFLOW) != 0U) {
+        forget_trust_locked();
+        continue;
+      }
+      uint32_t i = watch_find_locked(ev.wd);
+      if (i == DS_NIL) {
+        continue;
+      }
+      if ((ev.mask & IN_IGNORED) != 0U) {
+        watch_drop_locked(i, 1);
+      } else if ((ev.mask & (IN_DELETE_SELF | IN_MOVE_SELF)) != 0U) {
+        uint32_t parent = g_nodes[i].parent;
+        touch_locked((parent != DS_NIL) ? parent : i);
+      } else {
+        touch_locked(i);
+      }
+    }
+    pthread_mutex_unlock(&g_lock);
+  }
+  return NULL;
+}
+#elif defined(DS_KQUEUE)
+static void *watcher_main(void *arg) {
+  (void)arg;
+  struct kevent evs[32];
+
+  for (;;) {
+    pthread_mutex_lock(&g_lock);
+    int stop = g_stop;
+    pthread_mutex_unlock(&g_lock);
+    if (stop != 0) {
+      break;
+    }
+    struct timespec ts = {0, 500000000L};
+    int got = kevent(g_watch_fd, NULL, 0, evs, 32, &ts);
+    if (got <= 0) {
+      continue;
+    }
+
+    pthread_mutex_lock(&g_lock);
+    for (int k = 0; k < got; k++) {
+      uint32_t i = watch_find_locked((int)evs[k].ident);
+      if (i == DS_NIL) {
+        continue;
+      }
+      if ((evs[k].fflags & (NOTE_DELETE | NOTE_RENAME)) != 0U) {
+        uint32_t parent = g_nodes[i].parent;
+        watch_drop_locked(i, 0);
+        touch_locked((parent != DS_NIL) ? parent : i);
+      } else {
+        touch_locked(i);
+      }
+    }
+    pthread_mutex_unlock(&g_lock);
+  }
+  return NULL;
+}
+#endif
+
+/*===========================================================================*
+ * LIFECYCLE
+ *===========================================================================*/
+
+static void start_locked(void) {
+  if (g_started != 0) {
+    return;
+  }
+  g_started = 1;
+  g_stop = 0;
+  for (unsigned k = 0U; k < DS_WATCH_BUCKETS; k++) {
+    g_wbuckets[k] = DS_NIL;
+  }
+  load_locked();
+  g_saved_at = (int64_t)time(NULL);
+
+#if defined(DS_INOTIFY)
+  g_watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#elif defined(DS_KQUEUE)
+  g_watch_fd = kqueue();
+#endif
+
+  pthread_attr_t attr;
+  int have_attr = (pthread_attr_init(&attr) == 0) ? 1 : 0;
+  if (have_attr != 0) {
+    (void)pthread_attr_setstacksize(&attr, 65536U + (2U * FTP_PATH_MAX));
+  }
+  for (unsigned k = 0U; k < FTP_DIRSIZE_THREADS; k++) {
+    if (pal_thread_create(&g_walkers[g_nwalkers],
+                          (have_attr != 0) ? &attr : NULL,
+                          PAL_THREAD_BACKGROUND, walker_main, NULL) == 0) {
+      g_nwalkers++;
+    }
+  }
+#if defined(DS_INOTIFY) || defined(DS_KQUEUE)
+  if ((g_watch_fd >= 0) &&
+      (pal_thread_create(&g_watcher, (have_attr != 0) ? &attr : NULL,
+                         PAL_THREAD_BACKGROUND, watcher_main, NULL) == 0)) {
+    g_have_watcher = 1;
+  }
+#endif
+  if (have_attr != 0) {
+    (void)pthread_attr_destroy(&attr);
+  }
+}
+
+void ftp_dirsize_preload(void) {
+  pthread_mutex_lock(&g_lock);
+  start_locked();
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_dirsize_save(void) {
+  pthread_mutex_lock(&g_lock);
+  if ((g_started != 0) && (g_unsaved != 0)) {
+    save_locked();
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_dirsize_shutdown(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_started == 0) {
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+  g_stop = 1;
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_cond_broadcast(&g_done_cv);
+  pthread_mutex_unlock(&g_lock);
+
+  for (unsigned k = 0U; k < g_nwalkers; k++) {
+    (void)pthread_join(g_walkers[k], NULL);
+  }
+  if (g_have_watcher != 0) {
+    (void)pthread_join(g_watcher, NULL);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (g_unsaved != 0) {
+    save_locked();
+  }
+  for (uint32_t i = 0U; i < g_used; i++) {
+    if ((g_nodes[i].path != NULL) && (g_nodes[i].parent == DS_NIL)) {
+      free_subtree_locked(i);
+    }
+  }
+  if (g_watch_fd >= 0) {
+    (void)close(g_watch_fd);
+    g_watch_fd = -1;
+  }
+  free(g_nodes);
+  free(g_buckets);
+  free(g_stack);
+  free(g_order);
+  g_nodes = NULL;
+  g_buckets = NULL;
+  g_stack = NULL;
+  g_order = NULL;
+  g_cap = g_used = g_live = g_nbuckets = 0U;
+  g_free = DS_NIL;
+  g_slen = g_scap = g_olen = g_ocap = 0U;
+  g_busy = 0U;
+  g_nwalkers = 0U;
+  g_have_watcher = 0;
+  g_started = 0;
+  memset(&g_stats, 0, sizeof(g_stats));
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_dirsize_reset(const char *index_path) {
+  ftp_dirsize_shutdown();
+  pthread_mutex_lock(&g_lock);
+  const char *p = (index_path != NULL) ? index_path : FTP_DIRSIZE_INDEX_PATH;
+  (void)snprintf(g_index_path, sizeof(g_index_path), "%s", p);
+  pthread_mutex_unlock(&g_lock);
+}
+
+/*===========================================================================*
+ * QUERIES
+ *===========================================================================*/
+
+static int aged(const ds_node_t *n, int64_t now) {
+  if (n->oldest == 0) {
+    return 1; /* loaded from disk or never summed */
+  }
+  return (((n->flags & DS_AGG_UNWATCHED) != 0U) &&
+          (now - n->oldest > FTP_DIRSIZE_FRESH_S))
+             ? 1
+             : 0;
+}
+
+static void info_locked(const ds_node_t *n, int64_t now,
+                        ftp_dirsize_info_t *out) {
+  out->bytes = n->total;
+  out->partial = (((n->flags & DS_SUMMED) == 0U) ||
+                  ((n->flags & DS_AGG_PARTIAL) != 0U))
+                     ? 1
+                     : 0;
+  out->stale = ((n->dirty_below > 0U) || (aged(n, now) != 0) ||
+                ((n->flags & DS_QUEUED) != 0U) ||
+                ((n->epoch == g_epoch) && ((g_slen > 0U) || (g_busy > 0U))))
+                   ? 1
+                   : 0;
+  out->age_s = ((n->oldest > 0) && (now > n->oldest))
+                   ? (uint32_t)(now - n->oldest)
+                   : 0U;
+}
+
+int ftp_dirsize_query(const char *path, unsigned wait_ms,
+                      ftp_dirsize_info_t *out) {
+  struct stat st;
+  if ((path == NULL) || (out == NULL) || (lstat(path, &st) != 0) ||
+      !S_ISDIR(st.st_mode)) {
+    return -1;
+  }
+  memset(out, 0, sizeof(*out));
+
+  pthread_mutex_lock(&g_lock);
+  start_locked();
+  int64_t now = (int64_t)time(NULL);
+  uint32_t i = find_locked(path);
+  if (i == DS_NIL) {
+    i = node_new_locked(path);
+    if (i == DS_NIL) {
+      pthread_mutex_unlock(&g_lock);
+      out->stale = 1;
+      out->partial = 1; /* FTP_DIRSIZE_MAX_DIRS reached */
+      return 0;
+    }
+  }
+  ds_node_t *n = &g_nodes[i];
+  if ((((n->flags & DS_READ) == 0U) ||
+       ((aged(n, now) != 0) && (n->epoch != g_epoch))) &&
+      ((n->flags & DS_QUEUED) == 0U)) {
+    enqueue_locked(i, 1);
+  }
+  int pending = (((n->flags & DS_QUEUED) != 0U) || (n->dirty_below > 0U) ||
+                 ((n->epoch == g_epoch) && ((g_slen > 0U) || (g_busy > 0U))))
+                    ? 1
+                    : 0;
+
+  if ((wait_ms > 0U) && (pending != 0)) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    struct timespec deadline;
+    uint64_t ns = ((uint64_t)tv.tv_usec * 1000U) +
+                  ((uint64_t)wait_ms * 1000000U);
+    deadline.tv_sec = tv.tv_sec + (time_t)(ns / 1000000000U);
+    deadline.tv_nsec = (long)(ns % 1000000000U);
+    uint32_t e0 = g_epoch;
+    while ((g_epoch == e0) && (g_stop == 0)) {
+      if (pthread_cond_timedwait(&g_done_cv, &g_lock, &deadline) ==
+          ETIMEDOUT) {
+        break;
+      }
+    }
+    i = find_locked(path);
+  }
+
+  if (i == DS_NIL) {
+    pthread_mutex_unlock(&g_lock);
+    return -1; /* removed while we waited */
+  }
+  info_locked(&g_nodes[i], (int64_t)time(NULL), out);
+  pthread_mutex_unlock(&g_lock);
+  return 0;
+}
+
+int ftp_dirsize_peek(const char *path, ftp_dirsize_info_t *out) {
+  if ((path == NULL) || (out == NULL)) {
+    return -1;
+  }
+  memset(out, 0, sizeof(*out));
+  pthread_mutex_lock(&g_lock);
+  uint32_t i = (g_started != 0) ? find_locked(path) : DS_NIL;
+  if (i != DS_NIL) {
+    info_locked(&g_nodes[i], (int64_t)time(NULL), out);
+  }
+  pthread_mutex_unlock(&g_lock);
+  return (i != DS_NIL) ? 0 : -1;
+}
+
+void ftp_dirsize_invalidate(const char *path) {
+  if ((path == NULL) || (path[0] != '/')) {
+    return;
+  }
+  char parent[FTP_PATH_MAX];
+  (void)snprintf(parent, sizeof(parent), "%s", path);
+  size_t len = strlen(parent);
+  while ((len > 1U) && (parent[len - 1U] == '/')) {
+    parent[--len] = '\0';
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (g_started == 0) {
+    pthread_mutex_unlock(&g_lock);
+    return; /* nothing indexed yet; a loaded index revalidates anyway */
+  }
+  uint32_t self = find_locked(parent);
+  if (self != DS_NIL) {
+    touch_locked(self);
+  }
+  char *slash = strrchr(parent, '/');
+  if ((slash != NULL) && (len > 1U)) {
+    if (slash == parent) {
+      slash[1] = '\0';
+    } else {
+      slash[0] = '\0';
+    }
+    uint32_t p = find_locked(parent);
+    if (p != DS_NIL) {
+      touch_locked(p);
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_dirsize_get_stats(ftp_dirsize_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&g_lock);
+  *out = g_stats;
+  out->dirs = g_live;
+  pthread_mutex_unlock(&g_lock);
+}
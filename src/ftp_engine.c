@@ -0,0 +1,471 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_engine.c
+ * @brief Event-driven session engine
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * See ftp_engine.h for the model.  Each loop owns the sessions parked on
+ * it; workers park a session by pushing it onto the loop's inbox and
+ * writing one byte to the loop's wake pipe.  The loop rebuilds its
+ * pollfd array every pass (at most FTP_MAX_SESSIONS + 1 entries) and
+ * checks idle timeouts once a second.
+ */
+
+#include "ftp_engine.h"
+#include "ftp_session.h"
+#include "pal_thread.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ENGINE_POLL_MS 1000
+#define ENGINE_STOP_TIMEOUT_S 5
+
+typedef struct {
+  struct ftp_engine *engine;
+  pthread_t tid;
+  int wake[2]; /* [0] polled by the loop, [1] written by workers */
+
+  pthread_mutex_t lock;
+  ftp_session_t *inbox; /* parked, not yet in parked[] */
+
+  /* Loop thread only */
+  ftp_session_t *parked[FTP_MAX_SESSIONS];
+  size_t nparked;
+} engine_loop_t;
+
+struct ftp_engine {
+  engine_loop_t loops[FTP_ENGINE_LOOPS_MAX];
+  unsigned nloops;
+  atomic_int stopping;
+
+  /* I/O pool — everything below is guarded by run_lock */
+  pthread_mutex_t run_lock;
+  pthread_cond_t run_cv;
+  pthread_cond_t exit_cv;
+  ftp_session_t *run_head;
+  ftp_session_t *run_tail;
+  unsigned queued;
+  unsigned workers;
+  unsigned idle_workers;
+  unsigned busy_workers;
+  uint64_t dispatches;
+
+  atomic_uint parked;
+};
+
+static void *engine_worker_thread(void *arg);
+
+/*===========================================================================*
+ * HELPERS
+ *===========================================================================*/
+
+static int engine_thread_start(pthread_t *tid, void *(*fn)(void *),
+                               void *arg) {
+  pthread_attr_t attr;
+  int attr_ok = (pthread_attr_init(&attr) == 0);
+  if (attr_ok != 0) {
+    (void)pthread_attr_setstacksize(&attr, (size_t)FTP_THREAD_STACK_SIZE);
+  }
+  int rc = pal_thread_create(tid, (attr_ok != 0) ? &attr : NULL,
+                             PAL_THREAD_CONTROL, fn, arg);
+  if (attr_ok != 0) {
+    (void)pthread_attr_destroy(&attr);
+  }
+  return (rc == 0) ? 0 : -1;
+}
+
+static unsigned engine_default_loops(void) {
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if (cpus < 1) {
+    return 1U;
+  }
+  if (cpus > (long)FTP_ENGINE_LOOPS_MAX) {
+    return FTP_ENGINE_LOOPS_MAX;
+  }
+  return (unsigned)cpus;
+}
+
+/* Spawn one more worker; run_lock held */
+static int engine_spawn_worker_locked(ftp_engine_t *engine) {
+  pthread_t tid;
+  if (engine_thread_start(&tid, engine_worker_thread, engine) != 0) {
+    return -1;
+  }
+  (void)pthread_detach(tid);
+  engine->workers++;
+  return 0;
+}
+
+/*===========================================================================*
+ * RUN QUEUE
+ *===========================================================================*/
+
+static ftp_error_t engine_dispatch(ftp_engine_t *engine,
+                                   ftp_session_t *session) {
+  ftp_error_t err = FTP_OK;
+
+  pthread_mutex_lock(&engine->run_lock);
+  session->engine_next = NULL;
+  if (engine->run_tail != NULL) {
+    engine->run_tail->engine_next = session;
+  } else {
+    engine->run_head = session;
+  }
+  engine->run_tail = session;
+  engine->queued++;
+  engine->dispatches++;
+
+  /* Idle workers that are already being woken cannot take this one */
+  if ((engine->queued > engine->idle_workers) &&
+      (engine->workers < FTP_ENGINE_IO_THREADS_MAX)) {
+    if ((engine_spawn_worker_locked(engine) != 0) &&
+        (engine->workers == 0U)) {
+      /* No worker exists, so the queue holds only this session */
+      engine->run_head = NULL;
+      engine->run_tail = NULL;
+      engine->queued = 0U;
+      err = FTP_ERR_THREAD_CREATE;
+    }
+  } else {
+    pthread_cond_signal(&engine->run_cv);
+  }
+  pthread_mutex_unlock(&engine->run_lock);
+
+  return err;
+}
+
+/* Hand the session to the loop that owns it */
+static void engine_park(ftp_engine_t *engine, ftp_session_t *session) {
+  engine_loop_t *loop = &engine->loops[session->session_id % engine->nloops];
+
+  pthread_mutex_lock(&loop->lock);
+  session->engine_next = loop->inbox;
+  loop->inbox = session;
+  pthread_mutex_unlock(&loop->lock);
+
+  atomic_fetch_add(&engine->parked, 1U);
+
+  char one = 0;
+  ssize_t w = write(loop->wake[1], &one, 1U);
+  (void)w; /* EAGAIN: a wake-up is already pending */
+}
+
+/*===========================================================================*
+ * I/O WORKERS
+ *===========================================================================*/
+
+/* Run whatever the session has to do now, then park or end it */
+static void engine_serve(ftp_engine_t *engine, ftp_session_t *session) {
+  if (session->engine_greeted == 0U) {
+    session->engine_greeted = 1U;
+    ftp_session_begin(session);
+  } else if (session->engine_expired != 0U) {
+    ftp_session_expire(session);
+    ftp_session_end(session);
+    return;
+  } else {
+    /* Drain pipelined commands before going back to the loop */
+    do {
+      if (ftp_session_serve_command(session) == FTP_SESSION_STEP_END) {
+        ftp_session_end(session);
+        return;
+      }
+    } while (ftp_session_input_pending(session) != 0);
+  }
+
+  engine_park(engine, session);
+}
+
+static void *engine_worker_thread(void *arg) {
+  ftp_engine_t *engine = (ftp_engine_t *)arg;
+
+  pthread_mutex_lock(&engine->run_lock);
+  for (;;) {
+    int retire = 0;
+    while ((engine->run_head == NULL) &&
+           (atomic_load(&engine->stopping) == 0)) {
+      int rc;
+      engine->idle_workers++;
+      if (engine->workers > FTP_ENGINE_IO_THREADS) {
+        struct timespec deadline;
+        (void)clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += (time_t)FTP_ENGINE_IO_IDLE_S;
+        rc = pthread_cond_timedwait(&engine->run_cv, &engine->run_lock,
+                                    &deadline);
+      } else {
+        rc = pthread_cond_wait(&engine->run_cv, &engine->run_lock);
+      }
+      engine->idle_workers--;
+      if ((rc == ETIMEDOUT) && (engine->run_head == NULL) &&
+          (engine->workers > FTP_ENGINE_IO_THREADS)) {
+        retire = 1;
+        break;
+      }
+    }
+    if ((retire != 0) || (engine->run_head == NULL)) {
+      break; /* surplus worker, or stopping with the queue drained */
+    }
+
+    ftp_session_t *session = engine->run_head;
+    engine->run_head = session->engine_next;
+    if (engine->run_head == NULL) {
+      engine->run_tail = NULL;
+    }
+    session->engine_next = NULL;
+    engine->queued--;
+    engine->busy_workers++;
+    pthread_mutex_unlock(&engine->run_lock);
+
+    engine_serve(engine, session);
+
+    pthread_mutex_lock(&engine->run_lock);
+    engine->busy_workers--;
+  }
+
+  engine->workers--;
+  pthread_cond_broadcast(&engine->exit_cv);
+  pthread_mutex_unlock(&engine->run_lock);
+  return NULL;
+}
+
+/*===========================================================================*
+ * LOOPS
+ *===========================================================================*/
+
+static void loop_take_inbox(ftp_engine_t *engine, engine_loop_t *loop) {
+  pthread_mutex_lock(&loop->lock);
+  ftp_session_t *list = loop->inbox;
+  loop->inbox = NULL;
+  pthread_mutex_unlock(&loop->lock);
+
+  while (list != NULL) {
+    ftp_session_t *next = list->engine_next;
+    list->engine_next = NULL;
+    if (loop->nparked < FTP_MAX_SESSIONS) {
+      loop->parked[loop->nparked++] = list;
+    } else {
+      /* Cannot happen (one loop slot per session); never drop it */
+      atomic_fetch_sub(&engine->parked, 1U);
+      (void)engine_dispatch(engine, list);
+    }
+    list = next;
+  }
+}
+
+static void loop_drain_wake(int fd) {
+  char buf[64];
+  while (read(fd, buf, sizeof(buf)) > 0) {
+  }
+}
+
+static void *engine_loop_thread(void *arg) {
+  engine_loop_t *loop = (engine_loop_t *)arg;
+  ftp_engine_t *engine = loop->engine;
+  struct pollfd fds[FTP_MAX_SESSIONS + 1U];
+
+  while (atomic_load(&engine->stopping) == 0) {
+    loop_take_inbox(engine, loop);
+
+    fds[0].fd = loop->wake[0];
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    for (size_t i = 0U; i < loop->nparked; i++) {
+      fds[i + 1U].fd = loop->parked[i]->ctrl_fd;
+      fds[i + 1U].events = POLLIN;
+      fds[i + 1U].revents = 0;
+    }
+
+    int rc = poll(fds, (nfds_t)(loop->nparked + 1U), ENGINE_POLL_MS);
+    if ((rc < 0) && (errno != EINTR)) {
+      usleep(10000U);
+      continue;
+    }
+    if ((fds[0].revents & POLLIN) != 0) {
+      loop_drain_wake(loop->wake[0]);
+    }
+
+    /* Backwards, so the swap-with-last removal never skips an entry */
+    time_t now = time(NULL);
+    for (size_t i = loop->nparked; i-- > 0U;) {
+      ftp_session_t *session = loop->parked[i];
+      int ready = ((fds[i + 1U].revents &
+                    (POLLIN | POLLHUP | POLLERR | POLLNVAL)) != 0);
+      if (ready == 0) {
+        if (ftp_session_idle_expired(session, now) == 0) {
+          continue;
+        }
+        session->engine_expired = 1U;
+      }
+      loop->parked[i] = loop->parked[--loop->nparked];
+      atomic_fetch_sub(&engine->parked, 1U);
+      (void)engine_dispatch(engine, session);
+    }
+  }
+
+  return NULL;
+}
+
+/*===========================================================================*
+ * PUBLIC API
+ *===========================================================================*/
+
+ftp_engine_t *ftp_engine_create(unsigned loops) {
+  ftp_engine_t *engine = calloc(1U, sizeof(*engine));
+  if (engine == NULL) {
+    return NULL;
+  }
+
+  if (loops == 0U) {
+    loops = engine_default_loops();
+  }
+  if (loops > FTP_ENGINE_LOOPS_MAX) {
+    loops = FTP_ENGINE_LOOPS_MAX;
+  }
+
+  atomic_store(&engine->stopping, 0);
+  atomic_store(&engine->parked, 0U);
+  (void)pthread_mutex_init(&engine->run_lock, NULL);
+  (void)pthread_cond_init(&engine->run_cv, NULL);
+  (void)pthread_cond_init(&engine->exit_cv, NULL);
+
+  for (unsigned i = 0U; i < loops; i++) {
+    engine_loop_t *loop = &engine->loops[engine->nloops];
+    loop->engine = engine;
+    if (pipe(loop->wake) != 0) {
+      break;
+    }
+    for (int k = 0; k < 2; k++) {
+      int fl = fcntl(loop->wake[k], F_GETFL, 0);
+      (void)fcntl(loop->wake[k], F_SETFL, fl | O_NONBLOCK);
+      (void)fcntl(loop->wake[k], F_SETFD, FD_CLOEXEC);
+    }
+    (void)pthread_mutex_init(&loop->lock, NULL);
+    if (engine_thread_start(&loop->tid, engine_loop_thread, loop) != 0) {
+      pthread_mutex_destroy(&loop->lock);
+      close(loop->wake[0]);
+      close(loop->wake[1]);
+      break;
+    }
+    engine->nloops++;
+  }
+
+  pthread_mutex_lock(&engine->run_lock);
+  while (engine->workers < FTP_ENGINE_IO_THREADS) {
+    if (engine_spawn_worker_locked(engine) != 0) {
+      break;
+    }
+  }
+  unsigned workers = engine->workers;
+  pthread_mutex_unlock(&engine->run_lock);
+
+  if ((engine->nloops == 0U) || (workers == 0U)) {
+    ftp_engine_destroy(engine);
+    return NULL;
+  }
+  return engine;
+}
+
+ftp_error_t ftp_engine_submit(ftp_engine_t *engine, ftp_session_t *session) {
+  if ((engine == NULL) || (session == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  session->engine_greeted = 0U;
+  session->engine_expired = 0U;
+  return engine_dispatch(engine, session);
+}
+
+void ftp_engine_get_stats(ftp_engine_t *engine, ftp_engine_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  if (engine == NULL) {
+    return;
+  }
+  out->loops = engine->nloops;
+  out->parked = atomic_load(&engine->parked);
+  pthread_mutex_lock(&engine->run_lock);
+  out->workers = engine->workers;
+  out->busy_workers = engine->busy_workers;
+  out->dispatches = engine->dispatches;
+  pthread_mutex_unlock(&engine->run_lock);
+}
+
+void ftp_engine_destroy(ftp_engine_t *engine) {
+  if (engine == NULL) {
+    return;
+  }
+
+  atomic_store(&engine->stopping, 1);
+
+  for (unsigned i = 0U; i < engine->nloops; i++) {
+    engine_loop_t *loop = &engine->loops[i];
+    char one = 0;
+    ssize_t w = write(loop->wake[1], &one, 1U);
+    (void)w;
+    (void)pthread_join(loop->tid, NULL);
+  }
+
+  /* Workers finish what is queued, then exit */
+  pthread_mutex_lock(&engine->run_lock);
+  pthread_cond_broadcast(&engine->run_cv);
+  struct timespec deadline;
+  (void)clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += (time_t)ENGINE_STOP_TIMEOUT_S;
+  while (engine->workers > 0U) {
+    if (pthread_cond_timedwait(&engine->exit_cv, &engine->run_lock,
+                               &deadline) == ETIMEDOUT) {
+      break;
+    }
+  }
+  unsigned left = engine->workers;
+  pthread_mutex_unlock(&engine->run_lock);
+
+  if (left > 0U) {
+    /* A worker is stuck in a transfer: leave the engine to it */
+    return;
+  }
+
+  for (unsigned i = 0U; i < engine->nloops; i++) {
+    engine_loop_t *loop = &engine->loops[i];
+    pthread_mutex_destroy(&loop->lock);
+    close(loop->wake[0]);
+    close(loop->wake[1]);
+  }
+  pthread_cond_destroy(&engine->run_cv);
+  pthread_cond_destroy(&engine->exit_cv);
+  pthread_mutex_destroy(&engine->run_lock);
+  free(engine);
+}
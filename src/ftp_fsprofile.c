@@ -0,0 +1,321 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_fsprofile.c
+ * @brief Per-filesystem I/O profiles
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Built-in profiles are written in the profile file syntax and go
+ * through the same parser, so a file line reads exactly like the entry
+ * it overrides.  The file's lines are kept as text and applied at lookup
+ * (a few dozen bytes per transfer).
+ */
+
+#include "ftp_fsprofile.h"
+#include "ftp_config.h"
+#include "ftp_log.h"
+#include "ftp_xfer_tune.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define FSP_LINE_MAX 160U
+
+/*
+ * Only what differs from the platform default.  Pseudo filesystems:
+ * stat() can block or have side effects and st_size means nothing, so
+ * no stat in LIST and no sendfile.  tmpfs: an fsync has nothing to do.
+ */
+static const char *const k_builtin[] = {
+    "devfs sendfile=0 skip_stat=1 prealloc=0",
+    "procfs sendfile=0 skip_stat=1 prealloc=0",
+    "linprocfs sendfile=0 skip_stat=1 prealloc=0",
+    "fdescfs sendfile=0 skip_stat=1 prealloc=0",
+    "linsysfs sendfile=0 skip_stat=1 prealloc=0",
+    "proc sendfile=0 skip_stat=1 prealloc=0",
+    "sysfs sendfile=0 skip_stat=1 prealloc=0",
+    "devpts sendfile=0 skip_stat=1 prealloc=0",
+    "tmpfs sync=0",
+};
+
+static pthread_mutex_t g_fsp_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_fsp_path[256] = FTP_FS_PROFILE_PATH;
+static char g_fsp_lines[FTP_FS_PROFILE_LINES][FSP_LINE_MAX];
+static size_t g_fsp_count = 0U;
+static int g_fsp_loaded = 0;
+static time_t g_fsp_mtime = 0;
+static time_t g_fsp_next_check = 0;
+
+static void fsp_defaults(ftp_fs_profile_t *p) {
+  memset(p, 0, sizeof(*p));
+  p->sendfile_chunk = FTP_RETR_SENDFILE_CHUNK;
+  p->sendfile = 1U;
+  p->stor_ring = (uint8_t)FTP_STOR_RING_DEPTH;
+  p->preallocate = (FTP_STOR_PREALLOCATE != 0) ? 1U : 0U;
+  p->atomic_rename = (FTP_STOR_ATOMIC != 0) ? 1U : 0U;
+  p->skip_stat = 0U;
+  p->sync_policy = (uint8_t)FTP_STOR_SYNC_POLICY;
+}
+
+/* First word of @p line into @p name; returns the rest */
+static const char *fsp_name(const char *line, char *name, size_t size) {
+  while ((*line == ' ') || (*line == '\t')) {
+    line++;
+  }
+  size_t n = 0U;
+  while ((line[n] != '\0') && (line[n] != ' ') && (line[n] != '\t')) {
+    n++;
+  }
+  if (n >= size) {
+    n = size - 1U; /* longer than any type name: cannot match */
+  }
+  memcpy(name, line, n);
+  name[n] = '\0';
+  while ((line[n] != '\0') && (line[n] != ' ') && (line[n] != '\t')) {
+    n++;
+  }
+  return line + n;
+}
+
+/* "N", "NK" or "NM" */
+static int fsp_size(const char *v, uint32_t *out) {
+  char *end = NULL;
+  errno = 0;
+  unsigned long n = strtoul(v, &end, 10);
+  if ((errno != 0) || (end == v)) {
+    return -1;
+  }
+  if ((*end == 'K') || (*end == 'k')) {
+    n *= 1024UL;
+    end++;
+  } else if ((*end == 'M') || (*end == 'm')) {
+    n *= 1024UL * 1024UL;
+    end++;
+  }
+  if ((*end != '\0') || (n == 0UL) || (n > 0x7FFFFFFFUL)) {
+    return -1;
+  }
+  *out = (uint32_t)n;
+  return 0;
+}
+
+/*
+ * Apply "key=value ..." to @p p.  Returns 0, or -1 at the first unknown
+ * key or bad value (keys before it stay applied).
+ */
+static int fsp_apply(ftp_fs_profile_t *p, const char *kv) {
+  char tok[64];
+  while (*kv != '\0') {
+    kv = fsp_name(kv, tok, sizeof(tok));
+    if (tok[0] == '\0') {
+      break;
+    }
+    char *eq = strchr(tok, '=');
+    if ((eq == NULL) || (eq[1] == '\0')) {
+      return -1;
+    }
+    *eq = '\0';
+    const char *val = eq + 1;
+    uint32_t n = 0U;
+    if (strcmp(tok, "chunk") == 0) {
+      if (fsp_size(val, &n) != 0) {
+        return -1;
+      }
+      p->sendfile_chunk = n;
+      continue;
+    }
+    if ((fsp_size(val, &n) != 0) && (strcmp(val, "0") != 0)) {
+      return -1;
+    }
+    if (strcmp(tok, "ring") == 0) {
+      if (n > FTP_STOR_RING_MAX_DEPTH) {
+        return -1;
+      }
+      p->stor_ring = (uint8_t)n;
+    } else if (strcmp(tok, "sync") == 0) {
+      if (n > 2U) {
+        return -1;
+      }
+      p->sync_policy = (uint8_t)n;
+    } else if (n > 1U) {
+      return -1;
+    } else if (strcmp(tok, "sendfile") == 0) {
+      p->sendfile = (uint8_t)n;
+    } else if (strcmp(tok, "prealloc") == 0) {
+      p->preallocate = (uint8_t)n;
+    } else if (strcmp(tok, "atomic") == 0) {
+      p->atomic_rename = (uint8_t)n;
+    } else if (strcmp(tok, "skip_stat") == 0) {
+      p->skip_stat = (uint8_t)n;
+    } else {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* Read the profile file; caller holds g_fsp_lock */
+static int fsp_load_locked(void) {
+  g_fsp_count = 0U;
+  g_fsp_mtime = 0;
+  if (g_fsp_path[0] == '\0') {
+    return 0;
+  }
+  FILE *f = fopen(g_fsp_path, "r");
+  if (f == NULL) {
+    return -1; /* a lookup treats this as "no overrides" */
+  }
+  struct stat st;
+  if (fstat(fileno(f), &st) == 0) {
+    g_fsp_mtime = st.st_mtime;
+  }
+
+  char line[FSP_LINE_MAX + 2U];
+  unsigned lineno = 0U;
+  while (fgets(line, sizeof(line), f) != NULL) {
+    lineno++;
+    line[strcspn(line, "#\r\n")] = '\0';
+    char name[FTP_XFER_TUNE_FSNAME_MAX];
+    const char *rest = fsp_name(line, name, sizeof(name));
+    if (name[0] == '\0') {
+      continue;
+    }
+    ftp_fs_profile_t probe;
+    fsp_defaults(&probe);
+    if ((strlen(line) >= FSP_LINE_MAX) || (fsp_apply(&probe, rest) != 0) ||
+        (g_fsp_count >= FTP_FS_PROFILE_LINES)) {
+      char msg[sizeof(g_fsp_path) + 160U];
+      snprintf(msg, sizeof(msg), "[FSPROFILE] %s:%u ignored: %.100s",
+               g_fsp_path, lineno, line);
+      ftp_log_line(FTP_LOG_WARN, msg);
+      continue;
+    }
+    memcpy(g_fsp_lines[g_fsp_count], line, strlen(line) + 1U);
+    g_fsp_count++;
+  }
+  fclose(f);
+  return (int)g_fsp_count;
+}
+
+/* Reload when the file changed, at most every FTP_FS_PROFILE_RECHECK_S */
+static void fsp_refresh_locked(void) {
+  time_t now = time(NULL);
+  if ((g_fsp_loaded != 0) && (now < g_fsp_next_check)) {
+    return;
+  }
+  g_fsp_next_check = now + (time_t)FTP_FS_PROFILE_RECHECK_S;
+  struct stat st;
+  time_t mtime = 0;
+  if ((g_fsp_path[0] != '\0') && (stat(g_fsp_path, &st) == 0)) {
+    mtime = st.st_mtime;
+  }
+  if ((g_fsp_loaded == 0) || (mtime != g_fsp_mtime)) {
+    (void)fsp_load_locked();
+    g_fsp_mtime = mtime;
+    g_fsp_loaded = 1;
+  }
+}
+
+/* Apply the file lines named @p fstype */
+static void fsp_apply_file_locked(ftp_fs_profile_t *p, const char *fstype) {
+  char name[FTP_XFER_TUNE_FSNAME_MAX];
+  for (size_t i = 0U; i < g_fsp_count; i++) {
+    const char *rest = fsp_name(g_fsp_lines[i], name, sizeof(name));
+    if (strcmp(name, fstype) == 0) {
+      (void)fsp_apply(p, rest);
+    }
+  }
+}
+
+void ftp_fs_profile_lookup(const char *fstype, ftp_fs_profile_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  fsp_defaults(out);
+
+  pthread_mutex_lock(&g_fsp_lock);
+  fsp_refresh_locked();
+  fsp_apply_file_locked(out, "*");
+  if ((fstype != NULL) && (strcmp(fstype, "*") != 0)) {
+    char name[FTP_XFER_TUNE_FSNAME_MAX];
+    for (size_t i = 0U; i < (sizeof(k_builtin) / sizeof(k_builtin[0])); i++) {
+      const char *rest = fsp_name(k_builtin[i], name, sizeof(name));
+      if (strcmp(name, fstype) == 0) {
+        (void)fsp_apply(out, rest);
+      }
+    }
+    fsp_apply_file_locked(out, fstype);
+  }
+  pthread_mutex_unlock(&g_fsp_lock);
+}
+
+void ftp_fs_profile_for_fd(int fd, ftp_fs_profile_t *out) {
+  char fstype[FTP_XFER_TUNE_FSNAME_MAX];
+  ftp_xfer_tune_fstype(fd, fstype, sizeof(fstype));
+  ftp_fs_profile_lookup(fstype, out);
+}
+
+void ftp_fs_profile_for_path(const char *path, ftp_fs_profile_t *out) {
+  int fd = -1;
+  if (path != NULL) {
+    /* Never open the file itself: it may be a device */
+    fd = open(path, O_RDONLY | O_DIRECTORY);
+    const char *slash = strrchr(path, '/');
+    if ((fd < 0) && ((errno == ENOENT) || (errno == ENOTDIR)) &&
+        (slash != NULL)) {
+      char dir[FTP_PATH_MAX];
+      size_t n = (slash == path) ? 1U : (size_t)(slash - path);
+      if (n < sizeof(dir)) {
+        memcpy(dir, path, n);
+        dir[n] = '\0';
+        fd = open(dir, O_RDONLY | O_DIRECTORY);
+      }
+    }
+  }
+  ftp_fs_profile_for_fd(fd, out); /* fd < 0: "unknown" */
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+int ftp_fs_profile_reset(const char *conf_path) {
+  pthread_mutex_lock(&g_fsp_lock);
+  snprintf(g_fsp_path, sizeof(g_fsp_path), "%s",
+           (conf_path != NULL) ? conf_path : "");
+  int rc = fsp_load_locked();
+  g_fsp_loaded = 1;
+  g_fsp_next_check = time(NULL) + (time_t)FTP_FS_PROFILE_RECHECK_S;
+  pthread_mutex_unlock(&g_fsp_lock);
+  return rc;
+}
@@ -0,0 +1,182 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_fxp.c
+ * @brief FXP (server-to-server) data connection allow-list
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ */
+
+#include "ftp_fxp.h"
+#include "ftp_config.h"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+typedef struct {
+  uint32_t net;  /* host order, masked */
+  uint32_t mask; /* host order         */
+} fxp_entry_t;
+
+static fxp_entry_t g_fxp[FTP_FXP_ALLOW_MAX];
+static size_t g_fxp_count = 0U;
+static int g_fxp_init = 0;
+static pthread_mutex_t g_fxp_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t fxp_mask(unsigned bits) {
+  return (bits == 0U) ? 0U : (0xFFFFFFFFU << (32U - bits));
+}
+
+/* "a.b.c.d" or "a.b.c.d/n", n >= FTP_FXP_PREFIX_MIN */
+static int fxp_parse_one(const char *text, size_t len, fxp_entry_t *out) {
+  char buf[INET_ADDRSTRLEN + 4];
+  if ((len == 0U) || (len >= sizeof(buf))) {
+    return -1;
+  }
+  memcpy(buf, text, len);
+  buf[len] = '\0';
+
+  unsigned bits = 32U;
+  char *slash = strchr(buf, '/');
+  if (slash != NULL) {
+    char *end = NULL;
+    unsigned long b = strtoul(slash + 1, &end, 10);
+    if ((end == (slash + 1)) || (*end != '\0') || (b > 32UL) ||
+        (b < (unsigned long)FTP_FXP_PREFIX_MIN)) {
+      return -1;
+    }
+    bits = (unsigned)b;
+    *slash = '\0';
+  }
+
+  struct in_addr ia;
+  if (inet_pton(AF_INET, buf, &ia) != 1) {
+    return -1;
+  }
+  out->mask = fxp_mask(bits);
+  out->net = ntohl(ia.s_addr) & out->mask;
+  return 0;
+}
+
+/* Caller holds g_fxp_lock */
+static int fxp_set_locked(const char *list) {
+  fxp_entry_t parsed[FTP_FXP_ALLOW_MAX];
+  size_t n = 0U;
+
+  const char *p = list;
+  while ((*p == ' ') || (*p == ',')) {
+    p++;
+  }
+  if ((strcasecmp(p, "off") != 0) && (*p != '\0')) {
+    while (*p != '\0') {
+      size_t len = strcspn(p, ", ");
+      if ((n >= FTP_FXP_ALLOW_MAX) ||
+          (fxp_parse_one(p, len, &parsed[n]) != 0)) {
+        return -1;
+      }
+      n++;
+      p += len;
+      while ((*p == ' ') || (*p == ',')) {
+        p++;
+      }
+    }
+  }
+
+  memcpy(g_fxp, parsed, n * sizeof(parsed[0]));
+  g_fxp_count = n;
+  g_fxp_init = 1;
+  return (int)n;
+}
+
+static void fxp_init_locked(void) {
+  if (g_fxp_init == 0) {
+    if (fxp_set_locked(FTP_FXP_ALLOW) < 0) {
+      g_fxp_count = 0U; /* malformed build default: FXP stays off */
+      g_fxp_init = 1;
+    }
+  }
+}
+
+int ftp_fxp_set_allow(const char *list) {
+  if (list == NULL) {
+    return -1;
+  }
+  pthread_mutex_lock(&g_fxp_lock);
+  int rc = fxp_set_locked(list);
+  pthread_mutex_unlock(&g_fxp_lock);
+  return rc;
+}
+
+void ftp_fxp_format(char *buf, size_t size) {
+  if ((buf == NULL) || (size == 0U)) {
+    return;
+  }
+  buf[0] = '\0';
+  pthread_mutex_lock(&g_fxp_lock);
+  fxp_init_locked();
+  size_t at = 0U;
+  for (size_t i = 0U; (i < g_fxp_count) && (at < size); i++) {
+    struct in_addr ia;
+    char ip[INET_ADDRSTRLEN];
+    ia.s_addr = htonl(g_fxp[i].net);
+    (void)inet_ntop(AF_INET, &ia, ip, sizeof(ip));
+    unsigned bits = 0U;
+    for (uint32_t m = g_fxp[i].mask; m != 0U; m <<= 1) {
+      bits++;
+    }
+    int w = (bits == 32U)
+                ? snprintf(buf + at, size - at, "%s%s", (i > 0U) ? "," : "",
+                           ip)
+                : snprintf(buf + at, size - at, "%s%s/%u",
+                           (i > 0U) ? "," : "", ip, bits);
+    if (w < 0) {
+      break;
+    }
+    at += (size_t)w;
+  }
+  if (g_fxp_count == 0U) {
+    (void)snprintf(buf, size, "off");
+  }
+  pthread_mutex_unlock(&g_fxp_lock);
+}
+
+int ftp_fxp_allowed(uint32_t ip) {
+  uint32_t host = ntohl(ip);
+  int ok = 0;
+  pthread_mutex_lock(&g_fxp_lock);
+  fxp_init_locked();
+  for (size_t i = 0U; i < g_fxp_count; i++) {
+    if ((host & g_fxp[i].mask) == g_fxp[i].net) {
+      ok = 1;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_fxp_lock);
+  return ok;
+}
@@ -0,0 +1,536 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_handoff.c
+ * @brief Zero-downtime restart: listening sockets passed to a new process
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * WIRE FORMAT (one message on a SOCK_STREAM UNIX socket):
+ *
+ *   new → old   "ZHOR"
+ *   old → new   { "ZHO1", u32 count, u8 kinds[FTP_HANDOFF_FDS_MAX] }
+ *               + SCM_RIGHTS carrying count fds, in kinds[] order
+ *   new → old   'A' (adopted) or 'N' / EOF (give up)
+ *
+ * TRUST: the socket sits in a directory only our user can enter (0700,
+ * ours), both ends check that the peer runs as the same user, and every
+ * descriptor received must be a listening stream socket.
+ */
+
+#include "ftp_handoff.h"
+#include "ftp_log.h"
+#include "pal_thread.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define HANDOFF_POLL_MS 250
+
+typedef struct {
+  char magic[4];
+  uint32_t count;
+  uint8_t kinds[FTP_HANDOFF_FDS_MAX];
+} handoff_msg_t;
+
+typedef union {
+  struct cmsghdr hdr;
+  char buf[CMSG_SPACE(sizeof(int) * FTP_HANDOFF_FDS_MAX)];
+} handoff_cmsg_t;
+
+static pthread_mutex_t g_ho_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t g_ho_thread;
+static int g_ho_started = 0;
+static int g_ho_fd = -1;
+static atomic_int g_ho_stop = ATOMIC_VAR_INIT(0);
+static atomic_int g_ho_released = ATOMIC_VAR_INIT(0);
+static char g_ho_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static ftp_handoff_ops_t g_ho_ops;
+
+/*===========================================================================*
+ * SETS AND MESSAGES
+ *===========================================================================*/
+
+int ftp_handoff_add(ftp_handoff_set_t *set, int fd, ftp_handoff_kind_t kind) {
+  if ((set == NULL) || (fd < 0) || (set->count >= FTP_HANDOFF_FDS_MAX)) {
+    return -1;
+  }
+  set->fds[set->count] = fd;
+  set->kinds[set->count] = (uint8_t)kind;
+  set->count++;
+  return 0;
+}
+
+uint32_t ftp_handoff_pick(const ftp_handoff_set_t *set,
+                          ftp_handoff_kind_t kind, int *fds, uint32_t max) {
+  uint32_t n = 0U;
+  if ((set == NULL) || (fds == NULL)) {
+    return 0U;
+  }
+  for (uint32_t i = 0U; (i < set->count) && (n < max); i++) {
+    if (set->kinds[i] == (uint8_t)kind) {
+      fds[n++] = set->fds[i];
+    }
+  }
+  return n;
+}
+
+int ftp_handoff_send(int sock, const ftp_handoff_set_t *set) {
+  if ((set == NULL) || (set->count == 0U) ||
+      (set->count > FTP_HANDOFF_FDS_MAX)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  handoff_msg_t msg;
+  memset(&msg, 0, sizeof(msg));
+  memcpy(msg.magic, "ZHO1", 4U);
+  msg.count = set->count;
+  memcpy(msg.kinds, set->kinds, set->count);
+
+  handoff_cmsg_t ctl;
+  memset(&ctl, 0, sizeof(ctl));
+  struct iovec iov;
+  iov.iov_base = &msg;
+  iov.iov_len = sizeof(msg);
+  struct msghdr mh;
+  memset(&mh, 0, sizeof(mh));
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = ctl.buf;
+  mh.msg_controllen = (socklen_t)CMSG_SPACE(sizeof(int) * set->count);
+  struct cmsghdr *c = CMSG_FIRSTHDR(&mh);
+  c->cmsg_level = SOL_SOCKET;
+  c->cmsg_type = SCM_RIGHTS;
+  c->cmsg_len = (socklen_t)CMSG_LEN(sizeof(int) * set->count);
+  memcpy(CMSG_DATA(c), set->fds, sizeof(int) * set->count);
+
+  ssize_t n;
+  do {
+    n = sendmsg(sock, &mh, 0);
+  } while ((n < 0) && (errno == EINTR));
+  if (n != (ssize_t)sizeof(msg)) {
+    if (n >= 0) {
+      errno = EPROTO;
+    }
+    return -1;
+  }
+  return 0;
+}
+
+/* The rest of a message whose first bytes came with the fds */
+static int recv_rest(int sock, char *p, size_t len) {
+  while (len > 0U) {
+    ssize_t n = recv(sock, p, len, 0);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    if (n == 0) {
+      errno = EPROTO;
+      return -1;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+/* Only listening stream sockets are adopted, whatever the peer claims */
+static int is_listener(int fd) {
+  int type = 0;
+  int listening = 0;
+  socklen_t len = (socklen_t)sizeof(type);
+  if ((getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) != 0) ||
+      (type != SOCK_STREAM)) {
+    return 0;
+  }
+  len = (socklen_t)sizeof(listening);
+  if ((getsockopt(fd, SOL_SOCKET, SO_ACCEPTCONN, &listening, &len) != 0) ||
+      (listening == 0)) {
+    return 0;
+  }
+  return 1;
+}
+
+int ftp_handoff_recv(int sock, ftp_handoff_set_t *set) {
+  if (set == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+  set->count = 0U;
+
+  handoff_msg_t msg;
+  handoff_cmsg_t ctl;
+  memset(&ctl, 0, sizeof(ctl));
+  struct iovec iov;
+  iov.iov_base = &msg;
+  iov.iov_len = sizeof(msg);
+  struct msghdr mh;
+  memset(&mh, 0, sizeof(mh));
+  mh.msg_iov = &iov;
+  mh.msg_iovlen = 1;
+  mh.msg_control = ctl.buf;
+  mh.msg_controllen = (socklen_t)sizeof(ctl.buf);
+
+  ssize_t n;
+  do {
+    n = recvmsg(sock, &mh, 0);
+  } while ((n < 0) && (errno == EINTR));
+  if (n <= 0) {
+    if (n == 0) {
+      errno = EPROTO;
+    }
+    return -1;
+  }
+
+  /* Whatever arrived is ours to close, valid message or not */
+  int got[FTP_HANDOFF_FDS_MAX];
+  uint32_t ngot = 0U;
+  for (struct cmsghdr *c = CMSG_FIRSTHDR(&mh); c != NULL;
+       c = CMSG_NXTHDR(&mh, c)) {
+    if ((c->cmsg_level != SOL_SOCKET) || (c->cmsg_type != SCM_RIGHTS)) {
+      continue;
+    }
+    size_t k = (c->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    const unsigned char *data = CMSG_DATA(c);
+    for (size_t i = 0U; i < k; i++) {
+      int fd;
+      memcpy(&fd, data + (i * sizeof(int)), sizeof(int));
+      if (ngot < FTP_HANDOFF_FDS_MAX) {
+        got[ngot++] = fd;
+      } else {
+        (void)close(fd);
+      }
+    }
+  }
+
+  int ok = ((mh.msg_flags & MSG_CTRUNC) == 0) &&
+           (recv_rest(sock, (char *)&msg + n, sizeof(msg) - (size_t)n) == 0) &&
+           (memcmp(msg.magic, "ZHO1", 4U) == 0) && (msg.count == ngot) &&
+           (ngot > 0U);
+  for (uint32_t i = 0U; ok && (i < ngot); i++) {
+    ok = (msg.kinds[i] >= (uint8_t)FTP_HANDOFF_FTP) &&
+         (msg.kinds[i] <= (uint8_t)FTP_HANDOFF_HTTP) &&
+         (is_listener(got[i]) != 0);
+  }
+  if (!ok) {
+    for (uint32_t i = 0U; i < ngot; i++) {
+      (void)close(got[i]);
+    }
+    errno = EPROTO;
+    return -1;
+  }
+
+  for (uint32_t i = 0U; i < ngot; i++) {
+    set->fds[i] = got[i];
+    set->kinds[i] = msg.kinds[i];
+  }
+  set->count = ngot;
+  return 0;
+}
+
+static void set_timeouts(int sock) {
+  struct timeval tv;
+  tv.tv_sec = (time_t)(FTP_HANDOFF_WAIT_MS / 1000U);
+  tv.tv_usec = (suseconds_t)((FTP_HANDOFF_WAIT_MS % 1000U) * 1000U);
+  (void)setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  (void)setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+static int unix_addr(const char *path, struct sockaddr_un *addr) {
+  size_t len = strlen(path);
+  if ((len == 0U) || (len >= sizeof(addr->sun_path))) {
+    return -1;
+  }
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  memcpy(addr->sun_path, path, len + 1U);
+  return 0;
+}
+
+/* 1 if the process at the other end of @p sock runs as our user */
+static int peer_is_us(int sock) {
+#if defined(__linux__)
+  struct ucred cred;
+  socklen_t len = (socklen_t)sizeof(cred);
+  if ((getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0) ||
+      (len != (socklen_t)sizeof(cred))) {
+    return 0;
+  }
+  return (cred.uid == geteuid()) ? 1 : 0;
+#else
+  uid_t uid;
+  gid_t gid;
+  if (getpeereid(sock, &uid, &gid) != 0) {
+    return 0;
+  }
+  return (uid == geteuid()) ? 1 : 0;
+#endif
+}
+
+/*
+ * The directory holding the socket: ours and closed to everyone else,
+ * or anyone who can connect is handed our ports.  The serving side
+ * creates it (0700) when missing.
+ */
+static int private_dir(const char *path, int create) {
+  char dir[sizeof(g_ho_path)];
+  const char *slash = strrchr(path, '/');
+  if ((slash == NULL) || (slash == path)) {
+    return -1; /* no parent of our own */
+  }
+  size_t len = (size_t)(slash - path);
+  memcpy(dir, path, len);
+  dir[len] = '\0';
+  if (create != 0) {
+    (void)mkdir(dir, 0700);
+  }
+
+  struct stat st;
+  if ((lstat(dir, &st) != 0) || !S_ISDIR(st.st_mode) ||
+      (st.st_uid != geteuid()) || ((st.st_mode & 077U) != 0U)) {
+    return -1;
+  }
+  return 0;
+}
+
+/*===========================================================================*
+ * OLD PROCESS
+ *===========================================================================*/
+
+/* One hand-off request on @p c; 1 = the peer adopted the listeners */
+static int serve_one(int c) {
+  char req[4];
+  if (peer_is_us(c) == 0) {
+    ftp_log_line(FTP_LOG_WARN, "[HANDOFF] peer is another user, refused");
+    return 0;
+  }
+  set_timeouts(c);
+  if ((recv_rest(c, req, sizeof(req)) != 0) ||
+      (memcmp(req, "ZHOR", 4U) != 0)) {
+    return 0;
+  }
+
+  ftp_handoff_set_t set;
+  memset(&set, 0, sizeof(set));
+  if ((g_ho_ops.collect(&set, g_ho_ops.user) != 0) || (set.count == 0U)) {
+    ftp_log_line(FTP_LOG_WARN, "[HANDOFF] request refused");
+    return 0;
+  }
+
+  /* Shared from now on: both processes poll() them */
+  for (uint32_t i = 0U; i < set.count; i++) {
+    if (set.kinds[i] != (uint8_t)FTP_HANDOFF_PASV) {
+      int flags = fcntl(set.fds[i], F_GETFL, 0);
+      if (flags >= 0) {
+        (void)fcntl(set.fds[i], F_SETFL, flags | O_NONBLOCK);
+      }
+    }
+  }
+
+  char ack = 'N';
+  if (ftp_handoff_send(c, &set) == 0) {
+    ssize_t n;
+    do {
+      n = recv(c, &ack, 1U, 0);
+    } while ((n < 0) && (errno == EINTR));
+    if (n != 1) {
+      ack = 'N';
+    }
+  }
+
+  int adopted = (ack == 'A') ? 1 : 0;
+  char msg[96];
+  (void)snprintf(msg, sizeof(msg), "[HANDOFF] %u listener(s) %s",
+                 (unsigned)set.count,
+                 (adopted != 0) ? "adopted by the new process"
+                                : "not adopted, still serving");
+  ftp_log_line((adopted != 0) ? FTP_LOG_INFO : FTP_LOG_WARN, msg);
+  g_ho_ops.done(&set, adopted, g_ho_ops.user);
+  return adopted;
+}
+
+static void *handoff_thread(void *arg) {
+  (void)arg;
+  while (atomic_load(&g_ho_stop) == 0) {
+    struct pollfd pfd;
+    pfd.fd = g_ho_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1U, HANDOFF_POLL_MS) <= 0) {
+      continue;
+    }
+    int c = accept(g_ho_fd, NULL, NULL);
+    if (c < 0) {
+      continue;
+    }
+    int adopted = serve_one(c);
+    (void)close(c);
+    if (adopted != 0) {
+      atomic_store(&g_ho_released, 1);
+      break; /* the path is the new process's now */
+    }
+  }
+  return NULL;
+}
+
+ftp_error_t ftp_handoff_serve(const char *path, const ftp_handoff_ops_t *ops) {
+  struct sockaddr_un addr;
+  if ((path == NULL) || (ops == NULL) || (ops->collect == NULL) ||
+      (ops->done == NULL) || (unix_addr(path, &addr) != 0)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  pthread_mutex_lock(&g_ho_lock);
+  if (g_ho_started != 0) {
+    pthread_mutex_unlock(&g_ho_lock);
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  if (private_dir(path, 1) != 0) {
+    pthread_mutex_unlock(&g_ho_lock);
+    return FTP_ERR_PERMISSION;
+  }
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    pthread_mutex_unlock(&g_ho_lock);
+    return FTP_ERR_SOCKET_CREATE;
+  }
+  (void)unlink(path); /* stale, or left by the instance we replaced */
+  if (bind(fd, (struct sockaddr *)&addr, (socklen_t)sizeof(addr)) != 0) {
+    (void)close(fd);
+    pthread_mutex_unlock(&g_ho_lock);
+    return FTP_ERR_SOCKET_BIND;
+  }
+  (void)chmod(path, 0600); /* the directory already keeps others out */
+  if (listen(fd, 1) != 0) {
+    (void)close(fd);
+    (void)unlink(path);
+    pthread_mutex_unlock(&g_ho_lock);
+    return FTP_ERR_SOCKET_LISTEN;
+  }
+
+  g_ho_fd = fd;
+  g_ho_ops = *ops;
+  memcpy(g_ho_path, addr.sun_path, sizeof(g_ho_path));
+  atomic_store(&g_ho_stop, 0);
+  atomic_store(&g_ho_released, 0);
+  if (pal_thread_create(&g_ho_thread, NULL, PAL_THREAD_BACKGROUND,
+                        handoff_thread, NULL) != 0) {
+    (void)close(fd);
+    (void)unlink(path);
+    g_ho_fd = -1;
+    pthread_mutex_unlock(&g_ho_lock);
+    return FTP_ERR_THREAD_CREATE;
+  }
+  g_ho_started = 1;
+  pthread_mutex_unlock(&g_ho_lock);
+  return FTP_OK;
+}
+
+void ftp_handoff_serve_stop(void) {
+  pthread_mutex_lock(&g_ho_lock);
+  if (g_ho_started != 0) {
+    atomic_store(&g_ho_stop, 1);
+    (void)pthread_join(g_ho_thread, NULL);
+    (void)close(g_ho_fd);
+    g_ho_fd = -1;
+    if (atomic_load(&g_ho_released) == 0) {
+      (void)unlink(g_ho_path);
+    }
+    g_ho_started = 0;
+  }
+  pthread_mutex_unlock(&g_ho_lock);
+}
+
+int ftp_handoff_released(void) {
+  return atomic_load(&g_ho_released);
+}
+
+/*===========================================================================*
+ * NEW PROCESS
+ *===========================================================================*/
+
+ftp_error_t ftp_handoff_take(const char *path, ftp_handoff_set_t *set,
+                             int *link) {
+  struct sockaddr_un addr;
+  if ((path == NULL) || (set == NULL) || (link == NULL) ||
+      (unix_addr(path, &addr) != 0)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  *link = -1;
+  set->count = 0U;
+  if (private_dir(path, 0) != 0) {
+    return FTP_ERR_NOT_FOUND;
+  }
+
+  int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sock < 0) {
+    return FTP_ERR_SOCKET_CREATE;
+  }
+  if (connect(sock, (struct sockaddr *)&addr, (socklen_t)sizeof(addr)) != 0) {
+    (void)close(sock);
+    return FTP_ERR_NOT_FOUND;
+  }
+  if (peer_is_us(sock) == 0) {
+    (void)close(sock);
+    return FTP_ERR_PERMISSION;
+  }
+  set_timeouts(sock);
+
+  ssize_t n;
+  do {
+    n = send(sock, "ZHOR", 4U, 0);
+  } while ((n < 0) && (errno == EINTR));
+  if ((n != 4) || (ftp_handoff_recv(sock, set) != 0)) {
+    int timed_out = ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 1 : 0;
+    (void)close(sock);
+    return (timed_out != 0) ? FTP_ERR_TIMEOUT : FTP_ERR_PROTOCOL;
+  }
+  *link = sock;
+  return FTP_OK;
+}
+
+void ftp_handoff_confirm(int link, int adopted) {
+  if (link < 0) {
+    return;
+  }
+  char ack = (adopted != 0) ? 'A' : 'N';
+  (void)send(link, &ack, 1U, 0);
+  (void)close(link);
+}
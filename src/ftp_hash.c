@@ -0,0 +1,796 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_hash.c
+ * @brief Streaming digests and the file read pipeline
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ */
+
+#include "ftp_hash.h"
+#include "ftp_config.h"
+#include "pal_alloc.h"
+#include "pal_ring.h"
+#include "pal_thread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+
+#if FTP_HASH_SIMD && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define HASH_HAVE_SHANI 1
+#else
+#define HASH_HAVE_SHANI 0
+#endif
+
+#if FTP_HASH_SIMD && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define HASH_HAVE_ARM_CRC 1
+#else
+#define HASH_HAVE_ARM_CRC 0
+#endif
+
+static atomic_int g_force_scalar = ATOMIC_VAR_INIT(0);
+
+void ftp_hash_force_scalar(int scalar) {
+  atomic_store_explicit(&g_force_scalar, (scalar != 0) ? 1 : 0,
+                        memory_order_relaxed);
+}
+
+static int use_scalar(void) {
+  return atomic_load_explicit(&g_force_scalar, memory_order_relaxed);
+}
+
+static uint32_t load_be32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint32_t load_le32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+static void store_be32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+static void store_le32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t rotl32(uint32_t x, unsigned n) {
+  return (x << n) | (x >> (32U - n));
+}
+
+static uint32_t rotr32(uint32_t x, unsigned n) {
+  return (x >> n) | (x << (32U - n));
+}
+
+/*===========================================================================*
+ * CRC-32 (IEEE 802.3, reflected 0xEDB88320)
+ *===========================================================================*/
+
+static uint32_t g_crc_table[8][256];
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+
+static void crc_table_init(void) {
+  for (uint32_t i = 0U; i < 256U; i++) {
+    uint32_t c = i;
+    for (unsigned k = 0U; k < 8U; k++) {
+      c = ((c & 1U) != 0U) ? (0xEDB88320U ^ (c >> 1)) : (c >> 1);
+    }
+    g_crc_table[0][i] = c;
+  }
+  for (uint32_t i = 0U; i < 256U; i++) {
+    for (unsigned t = 1U; t < 8U; t++) {
+      uint32_t prev = g_crc_table[t - 1U][i];
+      g_crc_table[t][i] = (prev >> 8) ^ g_crc_table[0][prev & 0xFFU];
+    }
+  }
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t *p, size_t len) {
+  while (len >= 8U) {
+    crc ^= load_le32(p);
+    uint32_t hi = load_le32(p + 4);
+    crc = g_crc_table[7][crc & 0xFFU] ^ g_crc_table[6][(crc >> 8) & 0xFFU] ^
+          g_crc_table[5][(crc >> 16) & 0xFFU] ^ g_crc_table[4][crc >> 24] ^
+          g_crc_table[3][hi & 0xFFU] ^ g_crc_table[2][(hi >> 8) & 0xFFU] ^
+          g_crc_table[1][(hi >> 16) & 0xFFU] ^ g_crc_table[0][hi >> 24];
+    p += 8;
+    len -= 8U;
+  }
+  while (len > 0U) {
+    crc = g_crc_table[0][(crc ^ *p) & 0xFFU] ^ (crc >> 8);
+    p++;
+    len--;
+  }
+  return crc;
+}
+
+#if HASH_HAVE_ARM_CRC
+static uint32_t crc32_armv8(uint32_t crc, const uint8_t *p, size_t len) {
+  while (len >= 8U) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v)); /* little-endian AArch64 */
+    crc = __crc32d(crc, v);
+    p += 8;
+    len -= 8U;
+  }
+  while (len > 0U) {
+    crc = __crc32b(crc, *p);
+    p++;
+    len--;
+  }
+  return crc;
+}
+#endif
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t len) {
+#if HASH_HAVE_ARM_CRC
+  if (use_scalar() == 0) {
+    return crc32_armv8(crc, p, len);
+  }
+#endif
+  return crc32_slice8(crc, p, len);
+}
+
+/*===========================================================================*
+ * MD5 (RFC 1321)
+ *===========================================================================*/
+
+static const uint32_t MD5_K[64] = {
+    0xd76aa478U, 0xe8c7b756U, 0x242070dbU, 0xc1bdceeeU, 0xf57c0fafU,
+    0x4787c62aU, 0xa8304613U, 0xfd469501U, 0x698098d8U, 0x8b44f7afU,
+    0xffff5bb1U, 0x895cd7beU, 0x6b901122U, 0xfd987193U, 0xa679438eU,
+    0x49b40821U, 0xf61e2562U, 0xc040b340U, 0x265e5a51U, 0xe9b6c7aaU,
+    0xd62f105dU, 0x02441453U, 0xd8a1e681U, 0xe7d3fbc8U, 0x21e1cde6U,
+    0xc33707d6U, 0xf4d50d87U, 0x455a14edU, 0xa9e3e905U, 0xfcefa3f8U,
+    0x676f02d9U, 0x8d2a4c8aU, 0xfffa3942U, 0x8771f681U, 0x6d9d6122U,
+    0xfde5380cU, 0xa4beea44U, 0x4bdecfa9U, 0xf6bb4b60U, 0xbebfbc70U,
+    0x289b7ec6U, 0xeaa127faU, 0xd4ef3085U, 0x04881d05U, 0xd9d4d039U,
+    0xe6db99e5U, 0x1fa27cf8U, 0xc4ac5665U, 0xf4292244U, 0x432aff97U,
+    0xab9423a7U, 0xfc93a039U, 0x655b59c3U, 0x8f0ccc92U, 0xffeff47dU,
+    0x85845dd1U, 0x6fa87e4fU, 0xfe2ce6e0U, 0xa3014314U, 0x4e0811a1U,
+    0xf7537e82U, 0xbd3af235U, 0x2ad7d2bbU, 0xeb86d391U};
+
+static const uint8_t MD5_S[64] = {
+    7U, 12U, 17U, 22U, 7U, 12U, 17U, 22U, 7U, 12U, 17U, 22U, 7U, 12U, 17U, 22U,
+    5U, 9U,  14U, 20U, 5U, 9U,  14U, 20U, 5U, 9U,  14U, 20U, 5U, 9U,  14U, 20U,
+    4U, 11U, 16U, 23U, 4U, 11U, 16U, 23U, 4U, 11U, 16U, 23U, 4U, 11U, 16U, 23U,
+    6U, 10U, 15U, 21U, 6U, 10U, 15U, 21U, 6U, 10U, 15U, 21U, 6U, 10U, 15U, 21U};
+
+static void md5_blocks(uint32_t h[8], const uint8_t *p, size_t blocks) {
+  while (blocks-- > 0U) {
+    uint32_t m[16];
+    for (unsigned i = 0U; i < 16U; i++) {
+      m[i] = load_le32(p + (i * 4U));
+    }
+    uint32_t a = h[0];
+    uint32_t b = h[1];
+    uint32_t c = h[2];
+    uint32_t d = h[3];
+    for (unsigned i = 0U; i < 64U; i++) {
+      uint32_t f;
+      unsigned g;
+      if (i < 16U) {
+        f = (b & c) | (~b & d);
+        g = i;
+      } else if (i < 32U) {
+        f = (d & b) | (~d & c);
+        g = ((5U * i) + 1U) & 15U;
+      } else if (i < 48U) {
+        f = b ^ c ^ d;
+        g = ((3U * i) + 5U) & 15U;
+      } else {
+        f = c ^ (b | ~d);
+        g = (7U * i) & 15U;
+      }
+      uint32_t tmp = d;
+      d = c;
+      c = b;
+      b = b + rotl32(a + f + MD5_K[i] + m[g], MD5_S[i]);
+      a = tmp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    p += 64;
+  }
+}
+
+/*===========================================================================*
+ * SHA-1 (FIPS 180-4)
+ *===========================================================================*/
+
+static void sha1_blocks(uint32_t h[8], const uint8_t *p, size_t blocks) {
+  while (blocks-- > 0U) {
+    uint32_t w[80];
+    for (unsigned i = 0U; i < 16U; i++) {
+      w[i] = load_be32(p + (i * 4U));
+    }
+    for (unsigned i = 16U; i < 80U; i++) {
+      w[i] = rotl32(w[i - 3U] ^ w[i - 8U] ^ w[i - 14U] ^ w[i - 16U], 1U);
+    }
+    uint32_t a = h[0];
+    uint32_t b = h[1];
+    uint32_t c = h[2];
+    uint32_t d = h[3];
+    uint32_t e = h[4];
+    for (unsigned i = 0U; i < 80U; i++) {
+      uint32_t f;
+      uint32_t k;
+      if (i < 20U) {
+        f = (b & c) | (~b & d);
+        k = 0x5A827999U;
+      } else if (i < 40U) {
+        f = b ^ c ^ d;
+        k = 0x6ED9EBA1U;
+      } else if (i < 60U) {
+        f = (b & c) | (b & d) | (c & d);
+        k = 0x8F1BBCDCU;
+      } else {
+        f = b ^ c ^ d;
+        k = 0xCA62C1D6U;
+      }
+      uint32_t t = rotl32(a, 5U) + f + e + k + w[i];
+      e = d;
+      d = c;
+      c = rotl32(b, 30U);
+      b = a;
+      a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    p += 64;
+  }
+}
+
+/*===========================================================================*
+ * SHA-256 (FIPS 180-4)
+ *===========================================================================*/
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU,
+    0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U, 0xd807aa98U, 0x12835b01U,
+    0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U,
+    0xc19bf174U, 0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU,
+    0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU, 0x983e5152U,
+    0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U,
+    0x06ca6351U, 0x14292967U, 0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU,
+    0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+    0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U,
+    0xd6990624U, 0xf40e3585U, 0x106aa070U, 0x19a4c116U, 0x1e376c08U,
+    0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU,
+    0x682e6ff3U, 0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U,
+    0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U};
+
+static void sha256_blocks_scalar(uint32_t h[8], const uint8_t *p,
+                                 size_t blocks) {
+  while (blocks-- > 0U) {
+    uint32_t w[64];
+    for (unsigned i = 0U; i < 16U; i++) {
+      w[i] = load_be32(p + (i * 4U));
+    }
+    for (unsigned i = 16U; i < 64U; i++) {
+      uint32_t s0 = rotr32(w[i - 15U], 7U) ^ rotr32(w[i - 15U], 18U) ^
+                    (w[i - 15U] >> 3);
+      uint32_t s1 = rotr32(w[i - 2U], 17U) ^ rotr32(w[i - 2U], 19U) ^
+                    (w[i - 2U] >> 10);
+      w[i] = w[i - 16U] + s0 + w[i - 7U] + s1;
+    }
+    uint32_t a = h[0];
+    uint32_t b = h[1];
+    uint32_t c = h[2];
+    uint32_t d = h[3];
+    uint32_t e = h[4];
+    uint32_t f = h[5];
+    uint32_t g = h[6];
+    uint32_t hh = h[7];
+    for (unsigned i = 0U; i < 64U; i++) {
+      uint32_t S1 = rotr32(e, 6U) ^ rotr32(e, 11U) ^ rotr32(e, 25U);
+      uint32_t ch = (e & f) ^ (~e & g);
+      uint32_t t1 = hh + S1 + ch + SHA256_K[i] + w[i];
+      uint32_t S0 = rotr32(a, 2U) ^ rotr32(a, 13U) ^ rotr32(a, 22U);
+      uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+      uint32_t t2 = S0 + maj;
+      hh = g;
+      g = f;
+      f = e;
+      e = d + t1;
+      d = c;
+      c = b;
+      b = a;
+      a = t1 + t2;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += hh;
+    p += 64;
+  }
+}
+
+#if HASH_HAVE_SHANI
+/*
+ * SHA-NI: the state lives as ABEF/CDGH vectors; each sha256rnds2 does two
+ * rounds, msg1/msg2 extend the schedule four words at a time.
+ */
+__attribute__((target("sha,sse4.1"))) static void
+sha256_blocks_shani(uint32_t h[8], const uint8_t *p, size_t blocks) {
+  const __m128i bswap =
+      _mm_set_epi64x(0x0c0d0e0f08090a0bLL, 0x0405060700010203LL);
+
+  __m128i tmp = _mm_loadu_si128((const __m128i *)(const void *)&h[0]);
+  __m128i state1 = _mm_loadu_si128((const __m128i *)(const void *)&h[4]);
+  tmp = _mm_shuffle_epi32(tmp, 0xB1);          /* CDAB */
+  state1 = _mm_shuffle_epi32(state1, 0x1B);    /* EFGH */
+  __m128i state0 = _mm_alignr_epi8(tmp, state1, 8); /* ABEF */
+  state1 = _mm_blend_epi16(state1, tmp, 0xF0);      /* CDGH */
+
+  while (blocks-- > 0U) {
+    __m128i abef = state0;
+    __m128i cdgh = state1;
+    __m128i w[4];
+
+    for (unsigned g = 0U; g < 16U; g++) {
+      if (g < 4U) {
+        w[g] = _mm_shuffle_epi8(
+            _mm_loadu_si128((const __m128i *)(const void *)(p + (g * 16U))),
+            bswap);
+      } else {
+        __m128i x = _mm_sha256msg1_epu32(w[g & 3U], w[(g + 1U) & 3U]);
+        x = _mm_add_epi32(
+            x, _mm_alignr_epi8(w[(g + 3U) & 3U], w[(g + 2U) & 3U], 4));
+        w[g & 3U] = _mm_sha256msg2_epu32(x, w[(g + 3U) & 3U]);
+      }
+      __m128i msg = _mm_add_epi32(
+          w[g & 3U],
+          _mm_loadu_si128((const __m128i *)(const void *)&SHA256_K[g * 4U]));
+      state1 = _mm_sha256rnds2_epu32(state1, state0, msg);
+      msg = _mm_shuffle_epi32(msg, 0x0E);
+      state0 = _mm_sha256rnds2_epu32(state0, state1, msg);
+    }
+
+    state0 = _mm_add_epi32(state0, abef);
+    state1 = _mm_add_epi32(state1, cdgh);
+    p += 64;
+  }
+
+  tmp = _mm_shuffle_epi32(state0, 0x1B);       /* FEBA */
+  state1 = _mm_shuffle_epi32(state1, 0xB1);    /* DCHG */
+  state0 = _mm_blend_epi16(tmp, state1, 0xF0); /* DCBA */
+  state1 = _mm_alignr_epi8(state1, tmp, 8);    /* HGFE */
+  _mm_storeu_si128((__m128i *)(void *)&h[0], state0);
+  _mm_storeu_si128((__m128i *)(void *)&h[4], state1);
+}
+
+static int shani_supported(void) {
+#if defined(PLATFORM_PS5) || defined(PS5)
+  return 1; /* Zen2 */
+#elif defined(PLATFORM_PS4) || defined(PS4)
+  return 0; /* Jaguar */
+#else
+  unsigned a = 0U;
+  unsigned b = 0U;
+  unsigned c = 0U;
+  unsigned d = 0U;
+  if (__get_cpuid_count(7U, 0U, &a, &b, &c, &d) == 0) {
+    return 0;
+  }
+  if ((b & (1U << 29)) == 0U) {
+    return 0;
+  }
+  /* SSSE3 + SSE4.1 for the shuffles/blend */
+  if (__get_cpuid(1U, &a, &b, &c, &d) == 0) {
+    return 0;
+  }
+  return (((c & (1U << 9)) != 0U) && ((c & (1U << 19)) != 0U)) ? 1 : 0;
+#endif
+}
+#endif /* HASH_HAVE_SHANI */
+
+static int sha256_accel(void) {
+#if HASH_HAVE_SHANI
+  static atomic_int cached = ATOMIC_VAR_INIT(-1);
+  int v = atomic_load_explicit(&cached, memory_order_relaxed);
+  if (v < 0) {
+    v = shani_supported();
+    atomic_store_explicit(&cached, v, memory_order_relaxed);
+  }
+  return (use_scalar() == 0) ? v : 0;
+#else
+  return 0;
+#endif
+}
+
+static void sha256_blocks(uint32_t h[8], const uint8_t *p, size_t blocks) {
+#if HASH_HAVE_SHANI
+  if (sha256_accel() != 0) {
+    sha256_blocks_shani(h, p, blocks);
+    return;
+  }
+#endif
+  sha256_blocks_scalar(h, p, blocks);
+}
+
+/*===========================================================================*
+ * GENERIC CONTEXT
+ *===========================================================================*/
+
+typedef void (*block_fn)(uint32_t h[8], const uint8_t *p, size_t blocks);
+
+static const struct {
+  const char *name;
+  size_t digest_len;
+  block_fn blocks;
+} g_algos[FTP_HASH_ALGO_COUNT] = {
+    [FTP_HASH_CRC32] = {"CRC32", 4U, NULL},
+    [FTP_HASH_MD5] = {"MD5", 16U, md5_blocks},
+    [FTP_HASH_SHA1] = {"SHA-1", 20U, sha1_blocks},
+    [FTP_HASH_SHA256] = {"SHA-256", 32U, sha256_blocks},
+};
+
+const char *ftp_hash_name(ftp_hash_algo_t algo) {
+  return ((unsigned)algo < (unsigned)FTP_HASH_ALGO_COUNT) ? g_algos[algo].name
+                                                          : "?";
+}
+
+int ftp_hash_from_name(const char *name, ftp_hash_algo_t *algo) {
+  if ((name == NULL) || (algo == NULL)) {
+    return -1;
+  }
+  for (unsigned i = 0U; i < (unsigned)FTP_HASH_ALGO_COUNT; i++) {
+    if (strcasecmp(name, g_algos[i].name) == 0) {
+      *algo = (ftp_hash_algo_t)i;
+      return 0;
+    }
+  }
+  /* Dash-less spellings seen in the wild */
+  if (strcasecmp(name, "SHA256") == 0) {
+    *algo = FTP_HASH_SHA256;
+    return 0;
+  }
+  if (strcasecmp(name, "SHA1") == 0) {
+    *algo = FTP_HASH_SHA1;
+    return 0;
+  }
+  return -1;
+}
+
+size_t ftp_hash_digest_len(ftp_hash_algo_t algo) {
+  return ((unsigned)algo < (unsigned)FTP_HASH_ALGO_COUNT)
+             ? g_algos[algo].digest_len
+             : 0U;
+}
+
+const char *ftp_hash_kernel_name(ftp_hash_algo_t algo) {
+  switch (algo) {
+  case FTP_HASH_CRC32:
+#if HASH_HAVE_ARM_CRC
+    return (use_scalar() == 0) ? "armv8-crc" : "slice8";
+#else
+    return "slice8";
+#endif
+  case FTP_HASH_SHA256:
+    return (sha256_accel() != 0) ? "sha-ni" : "scalar";
+  case FTP_HASH_MD5:
+  case FTP_HASH_SHA1:
+  case FTP_HASH_ALGO_COUNT:
+  default:
+    return "scalar";
+  }
+}
+
+void ftp_hash_init(ftp_hash_ctx_t *ctx, ftp_hash_algo_t algo) {
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->algo = algo;
+  switch (algo) {
+  case FTP_HASH_CRC32:
+    (void)pthread_once(&g_crc_once, crc_table_init);
+    ctx->h[0] = 0xFFFFFFFFU;
+    break;
+  case FTP_HASH_MD5:
+    ctx->h[0] = 0x67452301U;
+    ctx->h[1] = 0xefcdab89U;
+    ctx->h[2] = 0x98badcfeU;
+    ctx->h[3] = 0x10325476U;
+    break;
+  case FTP_HASH_SHA1:
+    ctx->h[0] = 0x67452301U;
+    ctx->h[1] = 0xEFCDAB89U;
+    ctx->h[2] = 0x98BADCFEU;
+    ctx->h[3] = 0x10325476U;
+    ctx->h[4] = 0xC3D2E1F0U;
+    break;
+  case FTP_HASH_SHA256:
+  case FTP_HASH_ALGO_COUNT:
+  default:
+    ctx->algo = FTP_HASH_SHA256;
+    ctx->h[0] = 0x6a09e667U;
+    ctx->h[1] = 0xbb67ae85U;
+    ctx->h[2] = 0x3c6ef372U;
+    ctx->h[3] = 0xa54ff53aU;
+    ctx->h[4] = 0x510e527fU;
+    ctx->h[5] = 0x9b05688cU;
+    ctx->h[6] = 0x1f83d9abU;
+    ctx->h[7] = 0x5be0cd19U;
+    break;
+  }
+}
+
+void ftp_hash_update(ftp_hash_ctx_t *ctx, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  ctx->total += (uint64_t)len;
+
+  if (ctx->algo == FTP_HASH_CRC32) {
+    ctx->h[0] = crc32_update(ctx->h[0], p, len);
+    return;
+  }
+
+  block_fn fn = g_algos[ctx->algo].blocks;
+  if (ctx->block_len > 0U) {
+    size_t take = 64U - (size_t)ctx->block_len;
+    if (take > len) {
+      take = len;
+    }
+    memcpy(ctx->block + ctx->block_len, p, take);
+    ctx->block_len += (uint32_t)take;
+    p += take;
+    len -= take;
+    if (ctx->block_len < 64U) {
+      return;
+    }
+    fn(ctx->h, ctx->block, 1U);
+    ctx->block_len = 0U;
+  }
+
+  size_t blocks = len / 64U;
+  if (blocks > 0U) {
+    fn(ctx->h, p, blocks);
+    p += blocks * 64U;
+    len -= blocks * 64U;
+  }
+
+  if (len > 0U) {
+    memcpy(ctx->block, p, len);
+    ctx->block_len = (uint32_t)len;
+  }
+}
+
+void ftp_hash_final(ftp_hash_ctx_t *ctx, uint8_t out[FTP_HASH_MAX_DIGEST]) {
+  if (ctx->algo == FTP_HASH_CRC32) {
+    store_be32(out, ~ctx->h[0]);
+    return;
+  }
+
+  /* Merkle–Damgård padding: 0x80, zeros, 64-bit bit length */
+  uint64_t bits = ctx->total * 8U;
+  uint8_t pad[72];
+  size_t pad_len = ((ctx->block_len < 56U) ? 56U : 120U) - ctx->block_len;
+  memset(pad, 0, sizeof(pad));
+  pad[0] = 0x80U;
+  for (unsigned i = 0U; i < 8U; i++) {
+    unsigned shift = (ctx->algo == FTP_HASH_MD5) ? (8U * i) : (56U - (8U * i));
+    pad[pad_len + i] = (uint8_t)(bits >> shift);
+  }
+  uint64_t total = ctx->total;
+  ftp_hash_update(ctx, pad, pad_len + 8U);
+  ctx->total = total;
+
+  size_t words = g_algos[ctx->algo].digest_len / 4U;
+  for (size_t i = 0U; i < words; i++) {
+    if (ctx->algo == FTP_HASH_MD5) {
+      store_le32(out + (i * 4U), ctx->h[i]);
+    } else {
+      store_be32(out + (i * 4U), ctx->h[i]);
+    }
+  }
+}
+
+void ftp_hash_hex(const uint8_t *digest, size_t len, char *out,
+                  size_t out_size) {
+  static const char hex[] = "0123456789abcdef";
+  if ((out == NULL) || (out_size == 0U)) {
+    return;
+  }
+  size_t n = 0U;
+  for (size_t i = 0U; (i < len) && ((n + 2U) < out_size); i++) {
+    out[n++] = hex[digest[i] >> 4];
+    out[n++] = hex[digest[i] & 0x0FU];
+  }
+  out[n] = '\0';
+}
+
+/*===========================================================================*
+ * READ PIPELINE
+ *===========================================================================*/
+
+typedef struct {
+  pal_ring_t ring;
+  int fd;
+} hash_reader_t;
+
+static void *hash_ring_alloc(void *ctx) {
+  (void)ctx;
+  return pal_malloc(FTP_HASH_READ_CHUNK);
+}
+
+static void hash_ring_release(void *buf, void *ctx) {
+  (void)ctx;
+  pal_free(buf);
+}
+
+static void *hash_reader_thread(void *arg) {
+  hash_reader_t *r = (hash_reader_t *)arg;
+
+  for (;;) {
+    void *buf = pal_ring_acquire(&r->ring);
+    if (buf == NULL) {
+      break;
+    }
+    ssize_t n;
+    do {
+      n = read(r->fd, buf, (size_t)FTP_HASH_READ_CHUNK);
+    } while ((n < 0) && (errno == EINTR));
+
+    if (n <= 0) {
+      pal_ring_unacquire(&r->ring, buf);
+      if (n < 0) {
+        pal_ring_abort(&r->ring, errno);
+      }
+      break;
+    }
+    pal_ring_commit(&r->ring, buf, (size_t)n);
+  }
+  pal_ring_close(&r->ring);
+  return NULL;
+}
+
+/* Serial fallback: one buffer, read then hash */
+static int hash_fd_serial(int fd, ftp_hash_ctx_t *ctx) {
+  uint8_t *buf = (uint8_t *)pal_malloc(FTP_HASH_READ_CHUNK);
+  uint8_t small[4096];
+  size_t cap = (size_t)FTP_HASH_READ_CHUNK;
+  if (buf == NULL) {
+    buf = small;
+    cap = sizeof(small);
+  }
+
+  int rc = 0;
+  for (;;) {
+    ssize_t n = read(fd, buf, cap);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      rc = -1;
+      break;
+    }
+    if (n == 0) {
+      break;
+    }
+    ftp_hash_update(ctx, buf, (size_t)n);
+  }
+
+  if (buf != small) {
+    int saved = errno;
+    pal_free(buf);
+    errno = saved;
+  }
+  return rc;
+}
+
+int ftp_hash_fd(int fd, ftp_hash_algo_t algo, uint8_t out[FTP_HASH_MAX_DIGEST],
+                uint64_t *bytes) {
+  if ((fd < 0) || (out == NULL) ||
+      ((unsigned)algo >= (unsigned)FTP_HASH_ALGO_COUNT)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (lseek(fd, 0, SEEK_SET) < 0) {
+    return -1;
+  }
+
+#if defined(POSIX_FADV_SEQUENTIAL) && !defined(PLATFORM_PS4) && !defined(PS4)
+  (void)posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  ftp_hash_ctx_t ctx;
+  ftp_hash_init(&ctx, algo);
+
+  hash_reader_t rd;
+  pal_ring_config_t cfg;
+  cfg.initial_depth = 2U;
+  cfg.max_depth = FTP_HASH_RING_MAX_DEPTH;
+  cfg.grow_after = 2U;
+  cfg.slot_size = (size_t)FTP_HASH_READ_CHUNK;
+  cfg.alloc = hash_ring_alloc;
+  cfg.release = hash_ring_release;
+  cfg.ctx = NULL;
+  rd.fd = fd;
+
+  int rc = 0;
+  pthread_t tid;
+  if (pal_ring_init(&rd.ring, &cfg) != 0) {
+    rc = hash_fd_serial(fd, &ctx);
+  } else if (pal_thread_create(&tid, NULL, PAL_THREAD_DATA, hash_reader_thread,
+                               &rd) != 0) {
+    pal_ring_destroy(&rd.ring);
+    rc = hash_fd_serial(fd, &ctx);
+  } else {
+    for (;;) {
+      size_t n = 0U;
+      void *buf = pal_ring_peek(&rd.ring, &n);
+      if (buf == NULL) {
+        break;
+      }
+      ftp_hash_update(&ctx, buf, n);
+      pal_ring_consume(&rd.ring, buf);
+    }
+    (void)pthread_join(tid, NULL);
+    int err = pal_ring_error(&rd.ring);
+    pal_ring_destroy(&rd.ring);
+    if (err != 0) {
+      errno = err;
+      rc = -1;
+    }
+  }
+
+  if (rc != 0) {
+    return -1;
+  }
+
+  if (bytes != NULL) {
+    *bytes = ctx.total;
+  }
+  ftp_hash_final(&ctx, out);
+  return 0;
+}
@@ -0,0 +1,272 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_hash_cache.c
+ * @brief Digest index keyed by (path, size, mtime)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * FTP_HASH_CACHE_SLOTS entries in memory, least recently used evicted.
+ * A file whose size or mtime changed simply misses: no invalidation
+ * hooks are needed in DELE/RNTO/STOR.
+ *
+ * ON-DISK FORMAT (FTP_HASH_CACHE_PATH, rewritten via rename on store):
+ *
+ *   <algo> <size> <mtime> <hex-digest> <path>\n
+ *
+ * The path is last so that it may contain spaces.  A missing or corrupt
+ * file just starts an empty index.
+ */
+
+#include "ftp_config.h"
+#include "ftp_hash.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  char *path; /* NULL = free slot */
+  ftp_hash_algo_t algo;
+  uint64_t size;
+  int64_t mtime;
+  uint64_t last_used;
+  uint8_t digest[FTP_HASH_MAX_DIGEST];
+} hash_entry_t;
+
+static hash_entry_t g_entries[FTP_HASH_CACHE_SLOTS];
+static uint64_t g_clock;
+static int g_loaded;
+static char g_index_path[256] = FTP_HASH_CACHE_PATH;
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int hex_nibble(char c) {
+  unsigned u = (unsigned char)c;
+  if ((u - (unsigned)'0') <= 9U) {
+    return (int)(u - (unsigned)'0');
+  }
+  u |= 0x20U; /* fold A-F onto a-f */
+  if ((u - (unsigned)'a') <= 5U) {
+    return (int)(u - (unsigned)'a' + 10U);
+  }
+  return -1;
+}
+
+static void clear_locked(void) {
+  for (unsigned i = 0U; i < FTP_HASH_CACHE_SLOTS; i++) {
+    free(g_entries[i].path);
+  }
+  memset(g_entries, 0, sizeof(g_entries));
+  g_clock = 0U;
+}
+
+static hash_entry_t *find_locked(const char *path, ftp_hash_algo_t algo) {
+  for (unsigned i = 0U; i < FTP_HASH_CACHE_SLOTS; i++) {
+    hash_entry_t *e = &g_entries[i];
+    if ((e->path != NULL) && (e->algo == algo) &&
+        (strcmp(e->path, path) == 0)) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/* Slot for a new entry: a free one, else the least recently used */
+static hash_entry_t *victim_locked(void) {
+  hash_entry_t *lru = &g_entries[0];
+  for (unsigned i = 0U; i < FTP_HASH_CACHE_SLOTS; i++) {
+    hash_entry_t *e = &g_entries[i];
+    if (e->path == NULL) {
+      return e;
+    }
+    if (e->last_used < lru->last_used) {
+      lru = e;
+    }
+  }
+  free(lru->path);
+  lru->path = NULL;
+  return lru;
+}
+
+static void put_locked(const char *path, ftp_hash_algo_t algo, uint64_t size,
+                       int64_t mtime, const uint8_t *digest) {
+  hash_entry_t *e = find_locked(path, algo);
+  if (e == NULL) {
+    char *copy = strdup(path);
+    if (copy == NULL) {
+      return;
+    }
+    e = victim_locked();
+    e->path = copy;
+    e->algo = algo;
+  }
+  e->size = size;
+  e->mtime = mtime;
+  e->last_used = ++g_clock;
+  memcpy(e->digest, digest, FTP_HASH_MAX_DIGEST);
+}
+
+static void load_locked(void) {
+  g_loaded = 1;
+  if (g_index_path[0] == '\0') {
+    return;
+  }
+  FILE *f = fopen(g_index_path, "r");
+  if (f == NULL) {
+    return;
+  }
+
+  char line[FTP_PATH_MAX + 160U];
+  while (fgets(line, (int)sizeof(line), f) != NULL) {
+    char name[16];
+    unsigned long long size = 0ULL;
+    long long mtime = 0LL;
+    char hex[FTP_HASH_HEX_MAX];
+    int consumed = 0;
+    if (sscanf(line, "%15s %llu %lld %64s %n", name, &size, &mtime, hex,
+               &consumed) != 4) {
+      continue;
+    }
+    char *path = line + consumed;
+    size_t plen = strcspn(path, "\r\n");
+    path[plen] = '\0';
+
+    ftp_hash_algo_t algo;
+    if ((plen == 0U) || (ftp_hash_from_name(name, &algo) != 0) ||
+        (strlen(hex) != (ftp_hash_digest_len(algo) * 2U))) {
+      continue;
+    }
+
+    uint8_t digest[FTP_HASH_MAX_DIGEST];
+    memset(digest, 0, sizeof(digest));
+    int bad = 0;
+    for (size_t i = 0U; i < ftp_hash_digest_len(algo); i++) {
+      int hi = hex_nibble(hex[i * 2U]);
+      int lo = hex_nibble(hex[(i * 2U) + 1U]);
+      if ((hi < 0) || (lo < 0)) {
+        bad = 1;
+        break;
+      }
+      digest[i] = (uint8_t)((hi << 4) | lo);
+    }
+    if (bad == 0) {
+      put_locked(path, algo, (uint64_t)size, (int64_t)mtime, digest);
+    }
+  }
+  fclose(f);
+}
+
+static void save_locked(void) {
+  if (g_index_path[0] == '\0') {
+    return;
+  }
+
+  char tmp[sizeof(g_index_path) + 8U];
+  (void)snprintf(tmp, sizeof(tmp), "%s.tmp", g_index_path);
+  FILE *f = fopen(tmp, "w");
+  if (f == NULL) {
+    return;
+  }
+
+  for (unsigned i = 0U; i < FTP_HASH_CACHE_SLOTS; i++) {
+    const hash_entry_t *e = &g_entries[i];
+    if (e->path == NULL) {
+      continue;
+    }
+    char hex[FTP_HASH_HEX_MAX];
+    ftp_hash_hex(e->digest, ftp_hash_digest_len(e->algo), hex, sizeof(hex));
+    (void)fprintf(f, "%s %" PRIu64 " %" PRId64 " %s %s\n",
+                  ftp_hash_name(e->algo), e->size, e->mtime, hex, e->path);
+  }
+
+  if (fclose(f) != 0) {
+    (void)remove(tmp);
+    return;
+  }
+  if (rename(tmp, g_index_path) != 0) {
+    (void)remove(tmp);
+  }
+}
+
+int ftp_hash_cache_lookup(const char *path, ftp_hash_algo_t algo,
+                          uint64_t size, int64_t mtime,
+                          uint8_t out[FTP_HASH_MAX_DIGEST]) {
+  if ((path == NULL) || (out == NULL)) {
+    return 0;
+  }
+
+  int hit = 0;
+  pthread_mutex_lock(&g_lock);
+  if (g_loaded == 0) {
+    load_locked();
+  }
+  hash_entry_t *e = find_locked(path, algo);
+  if ((e != NULL) && (e->size == size) && (e->mtime == mtime)) {
+    e->last_used = ++g_clock;
+    memcpy(out, e->digest, FTP_HASH_MAX_DIGEST);
+    hit = 1;
+  }
+  pthread_mutex_unlock(&g_lock);
+  return hit;
+}
+
+void ftp_hash_cache_store(const char *path, ftp_hash_algo_t algo,
+                          uint64_t size, int64_t mtime,
+                          const uint8_t digest[FTP_HASH_MAX_DIGEST]) {
+  if ((path == NULL) || (digest == NULL) ||
+      ((unsigned)algo >= (unsigned)FTP_HASH_ALGO_COUNT) ||
+      (strpbrk(path, "\r\n") != NULL)) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (g_loaded == 0) {
+    load_locked();
+  }
+  put_locked(path, algo, size, mtime, digest);
+  save_locked();
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_hash_cache_preload(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_loaded == 0) {
+    load_locked();
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_hash_cache_reset(const char *index_path) {
+  pthread_mutex_lock(&g_lock);
+  clear_locked();
+  const char *p = (index_path != NULL) ? index_path : FTP_HASH_CACHE_PATH;
+  (void)snprintf(g_index_path, sizeof(g_index_path), "%s", p);
+  load_locked();
+  pthread_mutex_unlock(&g_lock);
+}
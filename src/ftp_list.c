@@ -0,0 +1,1524 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_list.c
+ * @brief Directory listing engine
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ */
+
+#include "ftp_list.h"
+#include "ftp_buffer_pool.h"
+#include "ftp_dirsize.h"
+#include "ftp_fsprofile.h"
+#include "ftp_path.h"
+#include "ftp_session.h"
+#include "ftp_stat_cache.h"
+#include "pal_network.h"
+#include "pal_thread.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/*===========================================================================*
+ * FORMATTING
+ *===========================================================================*/
+
+static const char k_months[12][4] = {"Jan", "Feb", "Mar", "Apr",
+                                     "May", "Jun", "Jul", "Aug",
+                                     "Sep", "Oct", "Nov", "Dec"};
+
+typedef struct {
+  int64_t year;
+  unsigned month; /* 1..12 */
+  unsigned day;   /* 1..31 */
+  unsigned hour;
+  unsigned min;
+  unsigned sec;
+} list_tm_t;
+
+/*
+ * UTC broken-down time without gmtime_r (H. Hinnant's civil_from_days):
+ *
+ *   t ──► days since 1970-01-01 (floor) ──► era / year-of-era ──► y-m-d
+ */
+static void list_civil(int64_t t, list_tm_t *tm) {
+  int64_t days = t / 86400;
+  int64_t rem = t % 86400;
+  if (rem < 0) {
+    rem += 86400;
+    days -= 1;
+  }
+  tm->hour = (unsigned)(rem / 3600);
+  tm->min = (unsigned)((rem % 3600) / 60);
+  tm->sec = (unsigned)(rem % 60);
+
+  int64_t z = days + 719468;
+  int64_t era = ((z >= 0) ? z : (z - 146096)) / 146097;
+  int64_t doe = z - (era * 146097);
+  int64_t yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365;
+  int64_t doy = doe - ((365 * yoe) + (yoe / 4) - (yoe / 100));
+  int64_t mp = ((5 * doy) + 2) / 153; /* 0 = March .. 11 = February */
+  tm->day = (unsigned)(doy - (((153 * mp) + 2) / 5) + 1);
+  unsigned mpu = (unsigned)mp;
+  tm->month = (mpu < 10U) ? (mpu + 3U) : (mpu - 9U);
+  tm->year = yoe + (era * 400) + ((tm->month <= 2U) ? 1 : 0);
+}
+
+static char *put_2d(char *p, unsigned v) {
+  p[0] = (char)('0' + ((v / 10U) % 10U));
+  p[1] = (char)('0' + (v % 10U));
+  return p + 2;
+}
+
+/* Decimal digits of @p v into @p tmp (reversed); returns the count */
+static size_t u64_digits(uint64_t v, char tmp[20]) {
+  size_t n = 0U;
+  do {
+    tmp[n++] = (char)('0' + (int)(v % 10U));
+    v /= 10U;
+  } while (v != 0U);
+  return n;
+}
+
+/* @p v right-aligned in @p width columns (printf "%*llu") */
+static char *put_u64(char *p, uint64_t v, size_t width) {
+  char tmp[20];
+  size_t n = u64_digits(v, tmp);
+  while (width > n) {
+    *p++ = ' ';
+    width--;
+  }
+  while (n > 0U) {
+    *p++ = tmp[--n];
+  }
+  return p;
+}
+
+/* RFC 3659 time-val: YYYYMMDDHHMMSS */
+static char *put_time_val(char *p, int64_t mtime) {
+  list_tm_t tm;
+  list_civil(mtime, &tm);
+  int64_t y = tm.year;
+  if ((y < 0) || (y > 9999)) {
+    y = (y < 0) ? 0 : 9999;
+  }
+  p = put_2d(p, (unsigned)(y / 100));
+  p = put_2d(p, (unsigned)(y % 100));
+  p = put_2d(p, tm.month);
+  p = put_2d(p, tm.day);
+  p = put_2d(p, tm.hour);
+  p = put_2d(p, tm.min);
+  return put_2d(p, tm.sec);
+}
+
+static char *put_str(char *p, const char *s, size_t len) {
+  memcpy(p, s, len);
+  return p + len;
+}
+
+static int is_dir_mode(uint32_t mode) {
+  return ((mode & (uint32_t)S_IFMT) == (uint32_t)S_IFDIR) ? 1 : 0;
+}
+
+/*
+ * Worst-case bytes besides the name:
+ *   unix: 10 perms + " 1 ftp ftp " + 20 size + " Mmm dd hh:mm " + CRLF
+ *   mlsx: " type=file;size=" + 20 + ";modify=" + 14 + ";unix.mode=0000; "
+ *         + CRLF
+ */
+#define LIST_UNIX_FIXED 64U
+#define LIST_MLSX_FIXED 80U
+
+size_t ftp_list_format(ftp_list_format_t fmt, const vfs_stat_t *st,
+                       const char *name, char *out, size_t size) {
+  if ((name == NULL) || (out == NULL) ||
+      ((fmt != FTP_LIST_NAMES) && (st == NULL))) {
+    return 0U;
+  }
+
+  size_t name_len = strlen(name);
+  size_t fixed = 3U;
+  if (fmt == FTP_LIST_UNIX) {
+    fixed = LIST_UNIX_FIXED;
+  } else if ((fmt == FTP_LIST_MLSD) || (fmt == FTP_LIST_MLST)) {
+    fixed = LIST_MLSX_FIXED;
+  }
+  if ((name_len + fixed) > size) {
+    return 0U;
+  }
+
+  char *p = out;
+  if (fmt == FTP_LIST_UNIX) {
+    /* -rw-r--r-- 1 ftp ftp       1234 Feb 22 12:00 name */
+    uint32_t m = st->mode;
+    *p++ = (is_dir_mode(m) != 0) ? 'd' : '-';
+    *p++ = ((m & S_IRUSR) != 0U) ? 'r' : '-';
+    *p++ = ((m & S_IWUSR) != 0U) ? 'w' : '-';
+    *p++ = ((m & S_IXUSR) != 0U) ? 'x' : '-';
+    *p++ = ((m & S_IRGRP) != 0U) ? 'r' : '-';
+    *p++ = ((m & S_IWGRP) != 0U) ? 'w' : '-';
+    *p++ = ((m & S_IXGRP) != 0U) ? 'x' : '-';
+    *p++ = ((m & S_IROTH) != 0U) ? 'r' : '-';
+    *p++ = ((m & S_IWOTH) != 0U) ? 'w' : '-';
+    *p++ = ((m & S_IXOTH) != 0U) ? 'x' : '-';
+    p = put_str(p, " 1 ftp ftp ", 11U);
+    p = put_u64(p, st->size, 10U);
+    *p++ = ' ';
+
+    list_tm_t tm;
+    list_civil(st->mtime, &tm);
+    p = put_str(p, k_months[tm.month - 1U], 3U);
+    *p++ = ' ';
+    p = put_2d(p, tm.day);
+    *p++ = ' ';
+    p = put_2d(p, tm.hour);
+    *p++ = ':';
+    p = put_2d(p, tm.min);
+    *p++ = ' ';
+  } else if ((fmt == FTP_LIST_MLSD) || (fmt == FTP_LIST_MLST)) {
+    /* type=file;size=1234;modify=20250222120000;unix.mode=0644; name */
+    int dir = is_dir_mode(st->mode);
+    if (fmt == FTP_LIST_MLST) {
+      *p++ = ' ';
+    }
+    p = (dir != 0) ? put_str(p, "type=dir;size=", 14U)
+                   : put_str(p, "type=file;size=", 15U);
+    p = put_u64(p, (dir != 0) ? 0U : st->size, 0U);
+    p = put_str(p, ";modify=", 8U);
+    p = put_time_val(p, st->mtime);
+    p = put_str(p, ";unix.mode=", 11U);
+    uint32_t perm = st->mode & 07777U;
+    *p++ = (char)('0' + (int)((perm >> 9) & 7U));
+    *p++ = (char)('0' + (int)((perm >> 6) & 7U));
+    *p++ = (char)('0' + (int)((perm >> 3) & 7U));
+    *p++ = (char)('0' + (int)(perm & 7U));
+    *p++ = ';';
+    *p++ = ' ';
+  }
+
+  p = put_str(p, name, name_len);
+  *p++ = '\r';
+  *p++ = '\n';
+  *p = '\0';
+  return (size_t)(p - out);
+}
+
+/*===========================================================================*
+ * BATCHING WRITER
+ *===========================================================================*/
+
+void ftp_list_writer_open(ftp_list_writer_t *w, ftp_session_t *session) {
+  w->session = session;
+  w->len = 0U;
+  w->err = FTP_OK;
+  w->buf = (char *)ftp_buffer_acquire_size(FTP_BUFFER_SMALL_SIZE, &w->cap);
+  if (w->buf != NULL) {
+    w->pooled = 1;
+  } else {
+    w->buf = w->fallback;
+    w->cap = sizeof(w->fallback);
+    w->pooled = 0;
+  }
+  if (session->data_fd >= 0) {
+    pal_socket_cork(session->data_fd);
+  }
+}
+
+static void writer_flush(ftp_list_writer_t *w) {
+  if ((w->len == 0U) || (w->err != FTP_OK)) {
+    w->len = 0U;
+    return;
+  }
+  ssize_t n;
+  if (w->pooled != 0) {
+    /* The batch may stay with the kernel (MSG_ZEROCOPY): w->buf changes */
+    void *buf = w->buf;
+    n = ftp_session_send_buffer(w->session, &buf, w->cap, w->len);
+    w->buf = (char *)buf;
+  } else {
+    n = ftp_session_send_data(w->session, w->buf, w->len);
+  }
+  if ((n < 0) || ((size_t)n != w->len)) {
+    w->err = FTP_ERR_SOCKET_SEND;
+  }
+  w->len = 0U;
+}
+
+ftp_error_t ftp_list_writer_add(ftp_list_writer_t *w, ftp_list_format_t fmt,
+                                const vfs_stat_t *st, const char *name) {
+  if (w->err != FTP_OK) {
+    return w->err;
+  }
+
+  /* Every entry fits a FTP_LIST_LINE_SIZE line, as before batching */
+  if ((w->cap - w->len) < FTP_LIST_LINE_SIZE) {
+    writer_flush(w);
+    if (w->err != FTP_OK) {
+      return w->err;
+    }
+  }
+
+  size_t n = ftp_list_format(fmt, st, name, w->buf + w->len,
+                             FTP_LIST_LINE_SIZE);
+  if (n == 0U) {
+    return FTP_ERR_PATH_TOO_LONG;
+  }
+  w->len += n;
+  return FTP_OK;
+}
+
+ftp_error_t ftp_list_writer_close(ftp_list_writer_t *w) {
+  writer_flush(w);
+  if (w->session->data_fd >= 0) {
+    pal_socket_uncork(w->session->data_fd);
+  }
+  if (w->pooled != 0) {
+    ftp_buffer_release(w->buf);
+  }
+  w->buf = NULL;
+  w->pooled = 0;
+  return w->err;
+}
+
+/*===========================================================================*
+ * DIRECTORY WALK
+ *===========================================================================*/
+
+/*
+ * FTP_LIST_SAFE_MODE: stat() on device / pseudo filesystems can block or
+ * have side effects, so their entries are listed from d_type only.  The
+ * well-known mount points are matched by name; anything else by the
+ * skip_stat of its filesystem profile (devfs, procfs, ...).
+ */
+static int list_skip_stat(const char *path) {
+  if (FTP_LIST_SAFE_MODE == 0) {
+    return 0;
+  }
+  if ((strncmp(path, "/dev", 4) == 0) &&
+      ((path[4] == '\0') || (path[4] == '/'))) {
+    return 1;
+  }
+  if ((strncmp(path, "/proc", 5) == 0) &&
+      ((path[5] == '\0') || (path[5] == '/'))) {
+    return 1;
+  }
+  if ((strncmp(path, "/sys", 4) == 0) &&
+      ((path[4] == '\0') || (path[4] == '/'))) {
+    return 1;
+  }
+  ftp_fs_profile_t prof;
+  ftp_fs_profile_for_path(path, &prof);
+  return (prof.skip_stat != 0U) ? 1 : 0;
+}
+
+/*===========================================================================*
+ * LISTING CACHE
+ *
+ *   g_lc_head ⇄ ... ⇄ g_lc_tail       (most → least recently used)
+ *
+ * Entries are reference counted: a hit pins the entry, the lock is
+ * dropped while the blob goes out on the wire, and eviction of a pinned
+ * entry only unlinks it (the last reader frees it).
+ *===========================================================================*/
+
+#define LC_BLOBS 3 /* NAMES, UNIX, MLSD */
+#define LC_MAX_ENTRY_BYTES (FTP_LIST_CACHE_BYTES / 4U)
+
+typedef struct {
+  vfs_stat_t st;
+  uint32_t name_off;
+} list_item_t;
+
+typedef struct {
+  uint64_t dev;
+  uint64_t ino;
+  int64_t mtime_ns;
+  int64_t mtime_s;
+} list_dir_key_t;
+
+typedef struct list_entry {
+  struct list_entry *prev;
+  struct list_entry *next;
+  char *path;
+  uint32_t path_hash;
+  list_dir_key_t key;
+  time_t filled_at;
+  int has_stat; /* 0: NLST walk, d_type only */
+  int linked;
+  uint32_t refs;
+  size_t count;
+  list_item_t *items;
+  char *names;
+  char *blob[LC_BLOBS];
+  size_t blob_len[LC_BLOBS];
+  size_t bytes;
+} list_entry_t;
+
+/* Entries and names collected during a walk */
+typedef struct {
+  list_item_t *items;
+  size_t count;
+  size_t cap;
+  char *names;
+  size_t names_len;
+  size_t names_cap;
+  int failed;
+  int uncapped; /* snapshot walk: keep going past LC_MAX_ENTRY_BYTES */
+} list_builder_t;
+
+static pthread_mutex_t g_lc_lock = PTHREAD_MUTEX_INITIALIZER;
+static list_entry_t *g_lc_head = NULL;
+static list_entry_t *g_lc_tail = NULL;
+static size_t g_lc_bytes = 0U;
+static uint32_t g_lc_count = 0U;
+static uint64_t g_lc_gen = 0U;
+static uint64_t g_lc_hits = 0U;
+static uint64_t g_lc_misses = 0U;
+static uint64_t g_lc_invalidations = 0U;
+
+static uint32_t lc_hash(const char *s) {
+  uint32_t h = 2166136261U; /* FNV-1a */
+  while (*s != '\0') {
+    h ^= (uint32_t)(unsigned char)*s++;
+    h *= 16777619U;
+  }
+  return h;
+}
+
+static int lc_dir_key(const char *path, list_dir_key_t *key) {
+  struct stat st;
+  if ((stat(path, &st) != 0) || !S_ISDIR(st.st_mode)) {
+    return -1;
+  }
+  key->dev = (uint64_t)st.st_dev;
+  key->ino = (uint64_t)st.st_ino;
+  key->mtime_s = (int64_t)st.st_mtime;
+#if defined(__APPLE__)
+  key->mtime_ns = ((int64_t)st.st_mtimespec.tv_sec * 1000000000) +
+                  (int64_t)st.st_mtimespec.tv_nsec;
+#else
+  key->mtime_ns = ((int64_t)st.st_mtim.tv_sec * 1000000000) +
+                  (int64_t)st.st_mtim.tv_nsec;
+#endif
+  return 0;
+}
+
+static int lc_blob_index(ftp_list_format_t fmt) {
+  if (fmt == FTP_LIST_NAMES) {
+    return 0;
+  }
+  if (fmt == FTP_LIST_UNIX) {
+    return 1;
+  }
+  if (fmt == FTP_LIST_MLSD) {
+    return 2;
+  }
+  return -1;
+}
+
+static void lc_free(list_entry_t *e) {
+  for (int i = 0; i < LC_BLOBS; i++) {
+    free(e->blob[i]);
+  }
+  free(e->items);
+  free(e->names);
+  free(e->path);
+  free(e);
+}
+
+static void lc_unlink_locked(list_entry_t *e) {
+  if (e->linked == 0) {
+    return;
+  }
+  if (e->prev != NULL) {
+    e->prev->next = e->next;
+  } else {
+    g_lc_head = e->next;
+  }
+  if (e->next != NULL) {
+    e->next->prev = e->prev;
+  } else {
+    g_lc_tail = e->prev;
+  }
+  e->prev = NULL;
+  e->next = NULL;
+  e->linked = 0;
+  g_lc_bytes -= e->bytes;
+  g_lc_count--;
+  if (e->refs == 0U) {
+    lc_free(e);
+  }
+}
+
+static void lc_push_front_locked(list_entry_t *e) {
+  e->prev = NULL;
+  e->next = g_lc_head;
+  if (g_lc_head != NULL) {
+    g_lc_head->prev = e;
+  }
+  g_lc_head = e;
+  if (g_lc_tail == NULL) {
+    g_lc_tail = e;
+  }
+  e->linked = 1;
+  g_lc_bytes += e->bytes;
+  g_lc_count++;
+}
+
+static list_entry_t *lc_find_locked(const char *path, uint32_t h) {
+  for (list_entry_t *e = g_lc_head; e != NULL; e = e->next) {
+    if ((e->path_hash == h) && (strcmp(e->path, path) == 0)) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/* Pinned, validated entry for @p path, or NULL */
+static list_entry_t *lc_acquire(const char *path, const list_dir_key_t *key,
+                                int need_stat) {
+  uint32_t h = lc_hash(path);
+  time_t now = time(NULL);
+
+  pthread_mutex_lock(&g_lc_lock);
+  list_entry_t *e = lc_find_locked(path, h);
+  if (e != NULL) {
+    if ((e->key.dev != key->dev) || (e->key.ino != key->ino) ||
+        (e->key.mtime_ns != key->mtime_ns) ||
+        ((now - e->filled_at) >= (time_t)FTP_LIST_CACHE_TTL_S) ||
+        (now < e->filled_at)) {
+      lc_unlink_locked(e);
+      e = NULL;
+    } else if ((need_stat != 0) && (e->has_stat == 0)) {
+      e = NULL; /* NLST-only entry; the LIST walk replaces it */
+    }
+  }
+  if (e != NULL) {
+    e->refs++;
+    if (e != g_lc_head) {
+      lc_unlink_locked(e); /* refs > 0: not freed */
+      lc_push_front_locked(e);
+    }
+    g_lc_hits++;
+  } else {
+    g_lc_misses++;
+  }
+  pthread_mutex_unlock(&g_lc_lock);
+  return e;
+}
+
+static void lc_release(list_entry_t *e) {
+  pthread_mutex_lock(&g_lc_lock);
+  e->refs--;
+  if ((e->refs == 0U) && (e->linked == 0)) {
+    lc_free(e);
+  }
+  pthread_mutex_unlock(&g_lc_lock);
+}
+
+static uint64_t lc_generation(void) {
+  pthread_mutex_lock(&g_lc_lock);
+  uint64_t gen = g_lc_gen;
+  pthread_mutex_unlock(&g_lc_lock);
+  return gen;
+}
+
+static void lc_evict_for_locked(size_t need) {
+  while ((g_lc_tail != NULL) &&
+         ((g_lc_bytes + need) > (size_t)FTP_LIST_CACHE_BYTES)) {
+    lc_unlink_locked(g_lc_tail);
+  }
+}
+
+static void builder_free(list_builder_t *b) {
+  free(b->items);
+  free(b->names);
+  b->items = NULL;
+  b->names = NULL;
+  b->failed = 1;
+}
+
+static void builder_add(list_builder_t *b, const vfs_stat_t *st,
+                        const char *name) {
+  if (b->failed != 0) {
+    return;
+  }
+  size_t name_len = strlen(name) + 1U;
+  if (b->count == b->cap) {
+    size_t cap = (b->cap == 0U) ? 64U : (b->cap * 2U);
+    list_item_t *items = realloc(b->items, cap * sizeof(*items));
+    if (items == NULL) {
+      builder_free(b);
+      return;
+    }
+    b->items = items;
+    b->cap = cap;
+  }
+  if ((b->names_len + name_len) > b->names_cap) {
+    size_t cap = (b->names_cap == 0U) ? 4096U : b->names_cap;
+    while (cap < (b->names_len + name_len)) {
+      cap *= 2U;
+    }
+    char *names = realloc(b->names, cap);
+    if (names == NULL) {
+      builder_free(b);
+      return;
+    }
+    b->names = names;
+    b->names_cap = cap;
+  }
+  if ((b->uncapped == 0) &&
+      (((b->cap * sizeof(list_item_t)) + b->names_cap) >
+       (size_t)LC_MAX_ENTRY_BYTES)) {
+    builder_free(b); /* too big to be worth caching */
+    return;
+  }
+  b->items[b->count].st = *st;
+  b->items[b->count].name_off = (uint32_t)b->names_len;
+  memcpy(b->names + b->names_len, name, name_len);
+  b->names_len += name_len;
+  b->count++;
+}
+
+/* Unlinked, unpinned entry that takes over the builder's arrays */
+static list_entry_t *lc_entry_new(const char *path, const list_dir_key_t *key,
+                                  list_builder_t *b, int has_stat) {
+  list_entry_t *e = calloc(1U, sizeof(*e));
+  char *path_copy = strdup(path);
+  if ((e == NULL) || (path_copy == NULL)) {
+    free(e);
+    free(path_copy);
+    builder_free(b);
+    return NULL;
+  }
+  e->path = path_copy;
+  e->path_hash = lc_hash(path);
+  e->key = *key;
+  e->filled_at = time(NULL);
+  e->has_stat = has_stat;
+  e->count = b->count;
+  e->items = b->items;
+  e->names = b->names;
+  e->bytes = sizeof(*e) + strlen(path) + 1U +
+             (b->cap * sizeof(list_item_t)) + b->names_cap;
+  b->items = NULL;
+  b->names = NULL;
+  return e;
+}
+
+/*
+ * Link @p e at the head unless an invalidation ran since @p gen0 or it
+ * is over the per-entry budget.  An entry left unlinked is freed now if
+ * nobody pins it, otherwise by the last lc_release().
+ */
+static void lc_link(list_entry_t *e, uint64_t gen0) {
+  pthread_mutex_lock(&g_lc_lock);
+  if ((g_lc_gen != gen0) || (e->bytes > (size_t)LC_MAX_ENTRY_BYTES)) {
+    /* raced with STOR/DELE/...: may already be stale */
+    int unused = (e->refs == 0U) ? 1 : 0;
+    pthread_mutex_unlock(&g_lc_lock);
+    if (unused != 0) {
+      lc_free(e);
+    }
+    return;
+  }
+  list_entry_t *old = lc_find_locked(e->path, e->path_hash);
+  if (old != NULL) {
+    lc_unlink_locked(old);
+  }
+  lc_evict_for_locked(e->bytes);
+  lc_push_front_locked(e);
+  pthread_mutex_unlock(&g_lc_lock);
+}
+
+static void lc_publish(const char *path, const list_dir_key_t *key,
+                       uint64_t gen0, list_builder_t *b, int has_stat) {
+  list_entry_t *e = lc_entry_new(path, key, b, has_stat);
+  if (e != NULL) {
+    lc_link(e, gen0);
+  }
+}
+
+/* Format every cached entry into one blob; NULL on allocation failure */
+static char *lc_format_blob(const list_entry_t *e, ftp_list_format_t fmt,
+                            size_t *out_len) {
+  size_t cap = (e->count * 96U) + FTP_LIST_LINE_SIZE;
+  size_t len = 0U;
+  char *blob = malloc(cap);
+  if (blob == NULL) {
+    return NULL;
+  }
+  for (size_t i = 0U; i < e->count; i++) {
+    if ((cap - len) < FTP_LIST_LINE_SIZE) {
+      size_t ncap = cap * 2U;
+      char *nb = realloc(blob, ncap);
+      if (nb == NULL) {
+        free(blob);
+        return NULL;
+      }
+      blob = nb;
+      cap = ncap;
+    }
+    len += ftp_list_format(fmt, &e->items[i].st,
+                           e->names + e->items[i].name_off, blob + len,
+                           FTP_LIST_LINE_SIZE);
+  }
+  *out_len = len;
+  return blob;
+}
+
+static ftp_error_t lc_send_blob(ftp_session_t *session, const char *blob,
+                                size_t len) {
+  ftp_error_t err = FTP_OK;
+  if (session->data_fd >= 0) {
+    pal_socket_cork(session->data_fd);
+  }
+  size_t chunk_max = ftp_buffer_size();
+  while (len > 0U) {
+    size_t chunk = (len < chunk_max) ? len : chunk_max;
+    ssize_t n = ftp_session_send_data(session, blob, chunk);
+    if ((n < 0) || ((size_t)n != chunk)) {
+      err = FTP_ERR_SOCKET_SEND;
+      break;
+    }
+    blob += chunk;
+    len -= chunk;
+  }
+  if (session->data_fd >= 0) {
+    pal_socket_uncork(session->data_fd);
+  }
+  return err;
+}
+
+static ftp_error_t lc_serve(ftp_session_t *session, list_entry_t *e,
+                            ftp_list_format_t fmt) {
+  int idx = lc_blob_index(fmt);
+
+  pthread_mutex_lock(&g_lc_lock);
+  const char *blob = e->blob[idx];
+  size_t blob_len = e->blob_len[idx];
+  pthread_mutex_unlock(&g_lc_lock);
+  if (blob != NULL) {
+    return lc_send_blob(session, blob, blob_len);
+  }
+
+  char *fresh = lc_format_blob(e, fmt, &blob_len);
+  if (fresh == NULL) {
+    /* No memory for a blob: format straight into the batching writer */
+    ftp_list_writer_t w;
+    ftp_list_writer_open(&w, session);
+    for (size_t i = 0U; i < e->count; i++) {
+      if (ftp_list_writer_add(&w, fmt, &e->items[i].st,
+                              e->names + e->items[i].name_off) ==
+          FTP_ERR_SOCKET_SEND) {
+        break;
+      }
+    }
+    return ftp_list_writer_close(&w);
+  }
+
+  ftp_error_t err = lc_send_blob(session, fresh, blob_len);
+
+  /* Keep the blob for the next client when it still fits the budget */
+  pthread_mutex_lock(&g_lc_lock);
+  if ((e->linked != 0) && (e->blob[idx] == NULL) &&
+      ((g_lc_bytes + blob_len) <= (size_t)FTP_LIST_CACHE_BYTES)) {
+    e->blob[idx] = fresh;
+    e->blob_len[idx] = blob_len;
+    e->bytes += blob_len;
+    g_lc_bytes += blob_len;
+    fresh = NULL;
+  }
+  pthread_mutex_unlock(&g_lc_lock);
+  free(fresh);
+  return err;
+}
+
+void ftp_list_cache_invalidate(const char *path) {
+  if ((path == NULL) || (path[0] == '\0')) {
+    return;
+  }
+  ftp_path_cache_invalidate(); /* sessions re-resolve cached names */
+  ftp_stat_cache_invalidate(path);
+  ftp_dirsize_invalidate(path);
+
+  size_t len = strlen(path);
+  while ((len > 1U) && (path[len - 1U] == '/')) {
+    len--;
+  }
+  size_t parent_len = len;
+  while ((parent_len > 0U) && (path[parent_len - 1U] != '/')) {
+    parent_len--;
+  }
+  if (parent_len > 1U) {
+    parent_len--; /* drop the separator, keep "/" for top-level paths */
+  }
+
+  pthread_mutex_lock(&g_lc_lock);
+  g_lc_gen++;
+  g_lc_invalidations++;
+  list_entry_t *e = g_lc_head;
+  while (e != NULL) {
+    list_entry_t *next = e->next;
+    size_t elen = strlen(e->path);
+    int is_parent = ((parent_len > 0U) && (elen == parent_len) &&
+                     (strncmp(e->path, path, parent_len) == 0));
+    int is_self_or_below =
+        ((elen >= len) && (strncmp(e->path, path, len) == 0) &&
+         ((e->path[len] == '\0') || (e->path[len] == '/')));
+    if ((is_parent != 0) || (is_self_or_below != 0)) {
+      lc_unlink_locked(e);
+    }
+    e = next;
+  }
+  pthread_mutex_unlock(&g_lc_lock);
+}
+
+void ftp_list_cache_get_stats(ftp_list_cache_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&g_lc_lock);
+  out->hits = g_lc_hits;
+  out->misses = g_lc_misses;
+  out->invalidations = g_lc_invalidations;
+  out->entries = g_lc_count;
+  out->bytes = g_lc_bytes;
+  pthread_mutex_unlock(&g_lc_lock);
+}
+
+void ftp_list_cache_clear(void) {
+  pthread_mutex_lock(&g_lc_lock);
+  g_lc_gen++;
+  while (g_lc_head != NULL) {
+    lc_unlink_locked(g_lc_head);
+  }
+  pthread_mutex_unlock(&g_lc_lock);
+}
+
+/*
+ * SNAPSHOT FILE (same binary on both ends of a restart, so the structs
+ * are written as they are; the layout word rejects any other build):
+ *
+ *   "ZLC1" u32 layout  u32 count
+ *   count x { u32 path_len  path  key  i64 filled_at  u32 has_stat
+ *             u32 items  u32 names_len  items[]  names[] }
+ */
+#define LC_SNAP_MAGIC "ZLC1"
+#define LC_SNAP_LAYOUT                                                         \
+  ((uint32_t)((sizeof(list_item_t) << 16) | sizeof(list_dir_key_t)))
+
+static size_t lc_names_len(const list_entry_t *e) {
+  if (e->count == 0U) {
+    return 0U;
+  }
+  const char *last = e->names + e->items[e->count - 1U].name_off;
+  return (size_t)(last - e->names) + strlen(last) + 1U;
+}
+
+static int lc_snap_write(FILE *f, const list_entry_t *e) {
+  uint32_t path_len = (uint32_t)strlen(e->path);
+  int64_t filled_at = (int64_t)e->filled_at;
+  uint32_t has_stat = (uint32_t)e->has_stat;
+  uint32_t count = (uint32_t)e->count;
+  uint32_t names_len = (uint32_t)lc_names_len(e);
+  int ok = (fwrite(&path_len, sizeof(path_len), 1U, f) == 1U) &&
+           (fwrite(e->path, 1U, path_len, f) == path_len) &&
+           (fwrite(&e->key, sizeof(e->key), 1U, f) == 1U) &&
+           (fwrite(&filled_at, sizeof(filled_at), 1U, f) == 1U) &&
+           (fwrite(&has_stat, sizeof(has_stat), 1U, f) == 1U) &&
+           (fwrite(&count, sizeof(count), 1U, f) == 1U) &&
+           (fwrite(&names_len, sizeof(names_len), 1U, f) == 1U) &&
+           (fwrite(e->items, sizeof(list_item_t), count, f) == count) &&
+           (fwrite(e->names, 1U, names_len, f) == names_len);
+  return ok ? 0 : -1;
+}
+
+int ftp_list_cache_save(const char *path) {
+  if ((path == NULL) || (path[0] == '\0')) {
+    return -1;
+  }
+
+  /* Pin the entries, then write without holding the lock */
+  pthread_mutex_lock(&g_lc_lock);
+  uint32_t n = 0U;
+  list_entry_t **pinned = NULL;
+  if (g_lc_count > 0U) {
+    pinned = malloc((size_t)g_lc_count * sizeof(*pinned));
+  }
+  if (pinned != NULL) {
+    for (list_entry_t *e = g_lc_head; e != NULL; e = e->next) {
+      if (e->has_stat != 0) {
+        e->refs++;
+        pinned[n++] = e;
+      }
+    }
+  }
+  pthread_mutex_unlock(&g_lc_lock);
+
+  char tmp[FTP_PATH_MAX];
+  int written = -1;
+  FILE *f = NULL;
+  if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) < (int)sizeof(tmp)) {
+    f = fopen(tmp, "wb");
+  }
+  if (f != NULL) {
+    uint32_t layout = LC_SNAP_LAYOUT;
+    int ok = (fwrite(LC_SNAP_MAGIC, 4U, 1U, f) == 1U) &&
+             (fwrite(&layout, sizeof(layout), 1U, f) == 1U) &&
+             (fwrite(&n, sizeof(n), 1U, f) == 1U);
+    for (uint32_t i = 0U; ok && (i < n); i++) {
+      ok = (lc_snap_write(f, pinned[n - 1U - i]) == 0); /* LRU first */
+    }
+    if ((fclose(f) == 0) && ok && (rename(tmp, path) == 0)) {
+      written = (int)n;
+    } else {
+      (void)remove(tmp);
+    }
+  }
+
+  for (uint32_t i = 0U; i < n; i++) {
+    lc_release(pinned[i]);
+  }
+  free(pinned);
+  return written;
+}
+
+/* One saved entry into @p b; 0 = ok, -1 = malformed file */
+static int lc_snap_read(FILE *f, char *path, size_t path_size,
+                        list_dir_key_t *key, int64_t *filled_at,
+                        uint32_t *has_stat, list_builder_t *b) {
+  uint32_t path_len = 0U;
+  uint32_t count = 0U;
+  uint32_t names_len = 0U;
+  if ((fread(&path_len, sizeof(path_len), 1U, f) != 1U) ||
+      (path_len == 0U) || (path_len >= path_size) ||
+      (fread(path, 1U, path_len, f) != path_len)) {
+    return -1;
+  }
+  path[path_len] = '\0';
+  if ((fread(key, sizeof(*key), 1U, f) != 1U) ||
+      (fread(filled_at, sizeof(*filled_at), 1U, f) != 1U) ||
+      (fread(has_stat, sizeof(*has_stat), 1U, f) != 1U) ||
+      (fread(&count, sizeof(count), 1U, f) != 1U) ||
+      (fread(&names_len, sizeof(names_len), 1U, f) != 1U) ||
+      ((size_t)names_len > (size_t)LC_MAX_ENTRY_BYTES) ||
+      ((size_t)count > ((size_t)LC_MAX_ENTRY_BYTES / sizeof(list_item_t))) ||
+      ((count == 0U) != (names_len == 0U))) {
+    return -1;
+  }
+
+  memset(b, 0, sizeof(*b));
+  b->items = malloc(((size_t)count + 1U) * sizeof(list_item_t));
+  b->names = malloc((size_t)names_len + 1U);
+  if ((b->items == NULL) || (b->names == NULL)) {
+    builder_free(b);
+    return -1;
+  }
+  if ((fread(b->items, sizeof(list_item_t), count, f) != count) ||
+      (fread(b->names, 1U, names_len, f) != names_len) ||
+      ((names_len > 0U) && (b->names[names_len - 1U] != '\0'))) {
+    builder_free(b);
+    return -1;
+  }
+  for (uint32_t i = 0U; i < count; i++) {
+    if (b->items[i].name_off >= names_len) {
+      builder_free(b);
+      return -1;
+    }
+  }
+  b->count = count;
+  b->cap = count;
+  b->names_len = names_len;
+  b->names_cap = names_len;
+  return 0;
+}
+
+int ftp_list_cache_load(const char *path) {
+  if ((path == NULL) || (path[0] == '\0')) {
+    return -1;
+  }
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    return -1;
+  }
+
+  char magic[4];
+  uint32_t layout = 0U;
+  uint32_t n = 0U;
+  if ((fread(magic, 4U, 1U, f) != 1U) ||
+      (memcmp(magic, LC_SNAP_MAGIC, 4U) != 0) ||
+      (fread(&layout, sizeof(layout), 1U, f) != 1U) ||
+      (layout != LC_SNAP_LAYOUT) ||
+      (fread(&n, sizeof(n), 1U, f) != 1U)) {
+    fclose(f);
+    return -1;
+  }
+
+  char *dir = malloc(FTP_PATH_MAX);
+  if (dir == NULL) {
+    fclose(f);
+    return -1;
+  }
+  int loaded = 0;
+  time_t now = time(NULL);
+  for (uint32_t i = 0U; i < n; i++) {
+    list_dir_key_t saved;
+    list_dir_key_t cur;
+    int64_t filled_at = 0;
+    uint32_t has_stat = 0U;
+    list_builder_t b;
+    if (lc_snap_read(f, dir, FTP_PATH_MAX, &saved, &filled_at, &has_stat,
+                     &b) != 0) {
+      break;
+    }
+    if ((lc_dir_key(dir, &cur) != 0) || (cur.dev != saved.dev) ||
+        (cur.ino != saved.ino) || (cur.mtime_ns != saved.mtime_ns) ||
+        (now < (time_t)filled_at) ||
+        ((now - (time_t)filled_at) >= (time_t)FTP_LIST_CACHE_TTL_S)) {
+      builder_free(&b);
+      continue;
+    }
+    list_entry_t *e = lc_entry_new(dir, &cur, &b, (has_stat != 0U) ? 1 : 0);
+    if (e != NULL) {
+      e->filled_at = (time_t)filled_at; /* the TTL keeps running */
+      lc_link(e, lc_generation());
+      loaded++;
+    }
+  }
+  free(dir);
+  fclose(f);
+  return loaded;
+}
+
+/*===========================================================================*
+ * PARALLEL STAT
+ *
+ *   readdir ──► slots[0..n) ──► listing thread + helpers claim slots
+ *                               fstatat(dirfd, name)
+ *           ◄── batch done  ◄── format slots in readdir order
+ *
+ * Slots are claimed one at a time under the crew mutex: a stat on the
+ * slow filesystems this exists for takes milliseconds, so the lock is
+ * noise, and no helper can ever work on a stale batch.
+ *===========================================================================*/
+
+#if defined(AT_FDCWD)
+#define LIST_HAVE_FSTATAT 1
+#else
+#define LIST_HAVE_FSTATAT 0
+#endif
+
+typedef struct {
+  char name[256];
+  unsigned char d_type;
+  int have_stat;
+  vfs_stat_t st;
+} list_slot_t;
+
+typedef struct {
+  int dfd;                    /* dirfd() of the open DIR */
+  char prefix[FTP_PATH_MAX];  /* "<path>/" without fstatat() */
+  size_t prefix_len;
+} list_stat_ctx_t;
+
+typedef struct {
+  pthread_mutex_t mtx;
+  pthread_cond_t work_cv;
+  pthread_cond_t done_cv;
+  const list_stat_ctx_t *ctx;
+  list_slot_t *slots;
+  size_t count;
+  size_t next; /* next unclaimed slot */
+  size_t done; /* finished slots      */
+  int stop;
+  unsigned nthreads;
+  pthread_t tids[FTP_LIST_STAT_WORKERS];
+} list_crew_t;
+
+static atomic_uint g_stat_helpers = ATOMIC_VAR_INIT(0U);
+
+static int list_stat_ctx_init(list_stat_ctx_t *c, DIR *dir, const char *path) {
+  c->dfd = -1;
+  c->prefix_len = 0U;
+#if LIST_HAVE_FSTATAT
+  (void)path;
+  c->dfd = dirfd(dir);
+  return (c->dfd >= 0) ? 0 : -1;
+#else
+  (void)dir;
+  size_t len = strlen(path);
+  if ((len + 2U) > sizeof(c->prefix)) {
+    return -1;
+  }
+  memcpy(c->prefix, path, len);
+  if ((len == 0U) || (c->prefix[len - 1U] != '/')) {
+    c->prefix[len++] = '/';
+  }
+  c->prefix_len = len;
+  return 0;
+#endif
+}
+
+static void list_stat_slot(const list_stat_ctx_t *c, list_slot_t *sl) {
+#if LIST_HAVE_FSTATAT
+  struct stat st;
+  if (fstatat(c->dfd, sl->name, &st, 0) == 0) {
+    sl->st.mode = (uint32_t)st.st_mode;
+    sl->st.size = (uint64_t)st.st_size;
+    sl->st.mtime = (int64_t)st.st_mtime;
+    sl->have_stat = 1;
+  }
+#else
+  char full[FTP_PATH_MAX];
+  size_t name_len = strlen(sl->name);
+  if ((c->prefix_len + name_len) < sizeof(full)) {
+    memcpy(full, c->prefix, c->prefix_len);
+    memcpy(full + c->prefix_len, sl->name, name_len + 1U);
+    if (vfs_stat(full, &sl->st) == FTP_OK) {
+      sl->have_stat = 1;
+    }
+  }
+#endif
+}
+
+/* Claim and stat slots until the batch is exhausted; mtx held on entry */
+static void crew_work_locked(list_crew_t *crew) {
+  while (crew->next < crew->count) {
+    list_slot_t *sl = &crew->slots[crew->next++];
+    pthread_mutex_unlock(&crew->mtx);
+    list_stat_slot(crew->ctx, sl);
+    pthread_mutex_lock(&crew->mtx);
+    crew->done++;
+    if (crew->done == crew->count) {
+      pthread_cond_signal(&crew->done_cv);
+    }
+  }
+}
+
+static void *crew_thread(void *arg) {
+  list_crew_t *crew = (list_crew_t *)arg;
+  pthread_mutex_lock(&crew->mtx);
+  for (;;) {
+    while ((crew->stop == 0) && (crew->next >= crew->count)) {
+      pthread_cond_wait(&crew->work_cv, &crew->mtx);
+    }
+    if (crew->stop != 0) {
+      break;
+    }
+    crew_work_locked(crew);
+  }
+  pthread_mutex_unlock(&crew->mtx);
+  return NULL;
+}
+
+/* Start up to FTP_LIST_STAT_WORKERS helpers within the global cap */
+static int list_crew_start(list_crew_t *crew, const list_stat_ctx_t *ctx) {
+  unsigned want = 0U;
+  while (want < (unsigned)FTP_LIST_STAT_WORKERS) {
+    unsigned cur = atomic_load(&g_stat_helpers);
+    if (cur >= (unsigned)FTP_LIST_STAT_WORKERS_MAX) {
+      break;
+    }
+    if (atomic_compare_exchange_weak(&g_stat_helpers, &cur, cur + 1U)) {
+      want++;
+    }
+  }
+  if (want == 0U) {
+    return -1;
+  }
+
+  memset(crew, 0, sizeof(*crew));
+  crew->ctx = ctx;
+  if (pthread_mutex_init(&crew->mtx, NULL) != 0) {
+    (void)atomic_fetch_sub(&g_stat_helpers, want);
+    return -1;
+  }
+  (void)pthread_cond_init(&crew->work_cv, NULL);
+  (void)pthread_cond_init(&crew->done_cv, NULL);
+
+  pthread_attr_t attr;
+  int have_attr = (pthread_attr_init(&attr) == 0) ? 1 : 0;
+  if (have_attr != 0) {
+    (void)pthread_attr_setstacksize(&attr, 65536U + FTP_PATH_MAX);
+  }
+  for (unsigned i = 0U; i < want; i++) {
+    if (pal_thread_create(&crew->tids[crew->nthreads],
+                          (have_attr != 0) ? &attr : NULL, PAL_THREAD_DATA,
+                          crew_thread, crew) == 0) {
+      crew->nthreads++;
+    }
+  }
+  if (have_attr != 0) {
+    (void)pthread_attr_destroy(&attr);
+  }
+
+  if (crew->nthreads < want) {
+    (void)atomic_fetch_sub(&g_stat_helpers, want - crew->nthreads);
+  }
+  if (crew->nthreads == 0U) {
+    pthread_cond_destroy(&crew->work_cv);
+    pthread_cond_destroy(&crew->done_cv);
+    pthread_mutex_destroy(&crew->mtx);
+    return -1;
+  }
+  return 0;
+}
+
+/* Stat slots[0..n) with the helpers; returns when all are done */
+static void list_crew_run(list_crew_t *crew, list_slot_t *slots, size_t n) {
+  pthread_mutex_lock(&crew->mtx);
+  crew->slots = slots;
+  crew->count = n;
+  crew->next = 0U;
+  crew->done = 0U;
+  pthread_cond_broadcast(&crew->work_cv);
+  crew_work_locked(crew); /* the listing thread works too */
+  while (crew->done < crew->count) {
+    pthread_cond_wait(&crew->done_cv, &crew->mtx);
+  }
+  pthread_mutex_unlock(&crew->mtx);
+}
+
+static void list_crew_stop(list_crew_t *crew) {
+  pthread_mutex_lock(&crew->mtx);
+  crew->stop = 1;
+  pthread_cond_broadcast(&crew->work_cv);
+  pthread_mutex_unlock(&crew->mtx);
+  for (unsigned i = 0U; i < crew->nthreads; i++) {
+    (void)pthread_join(crew->tids[i], NULL);
+  }
+  (void)atomic_fetch_sub(&g_stat_helpers, crew->nthreads);
+  pthread_cond_destroy(&crew->work_cv);
+  pthread_cond_destroy(&crew->done_cv);
+  pthread_mutex_destroy(&crew->mtx);
+}
+
+/*===========================================================================*
+ * LISTING
+ *===========================================================================*/
+
+/*
+ * Read, stat and collect a whole directory in readdir order.  Entries go
+ * to the builder @p b and, when @p w is set, out through the writer.
+ *
+ * @return 1 if every entry was visited, 0 if the writer's client left
+ */
+static int list_walk(DIR *dir, const list_stat_ctx_t *ctx, int want_stat,
+                     list_builder_t *b, ftp_list_writer_t *w,
+                     ftp_list_format_t fmt) {
+  /* One batch of names; a single slot when memory is short */
+  list_slot_t one;
+  list_slot_t *slots = malloc((size_t)FTP_LIST_STAT_BATCH * sizeof(*slots));
+  size_t slot_cap = (size_t)FTP_LIST_STAT_BATCH;
+  if (slots == NULL) {
+    slots = &one;
+    slot_cap = 1U;
+  }
+
+  list_crew_t crew;
+  int crew_up = 0;
+
+  int complete = 1;
+  int eof = 0;
+  while ((eof == 0) && (complete != 0)) {
+    size_t n = 0U;
+    while (n < slot_cap) {
+      struct dirent *entry = readdir(dir);
+      if (entry == NULL) {
+        eof = 1;
+        break;
+      }
+      const char *name = entry->d_name;
+      if ((name[0] == '.') &&
+          ((name[1] == '\0') || ((name[1] == '.') && (name[2] == '\0')))) {
+        continue;
+      }
+      size_t name_len = strlen(name);
+      if (name_len >= sizeof(slots[n].name)) {
+        continue; /* longer than any listing line allows */
+      }
+      memcpy(slots[n].name, name, name_len + 1U);
+      slots[n].d_type = entry->d_type;
+      slots[n].have_stat = 0;
+      n++;
+    }
+
+    if (want_stat != 0) {
+      /* A directory that fills a whole batch gets helpers */
+      if ((crew_up == 0) && (n == (size_t)FTP_LIST_STAT_BATCH)) {
+        crew_up = (list_crew_start(&crew, ctx) == 0) ? 1 : 0;
+      }
+      if (crew_up != 0) {
+        list_crew_run(&crew, slots, n);
+      } else {
+        for (size_t i = 0U; i < n; i++) {
+          list_stat_slot(ctx, &slots[i]);
+        }
+      }
+    }
+
+    for (size_t i = 0U; i < n; i++) {
+      list_slot_t *sl = &slots[i];
+      if (sl->have_stat == 0) {
+        memset(&sl->st, 0, sizeof(sl->st));
+        sl->st.mode = (sl->d_type == DT_DIR) ? (uint32_t)S_IFDIR
+                                             : (uint32_t)S_IFREG;
+      }
+      builder_add(b, &sl->st, sl->name);
+      if ((w != NULL) &&
+          (ftp_list_writer_add(w, fmt, &sl->st, sl->name) ==
+           FTP_ERR_SOCKET_SEND)) {
+        complete = 0; /* client went away: stop stat'ing the rest */
+        break;
+      }
+    }
+  }
+
+  if (crew_up != 0) {
+    list_crew_stop(&crew);
+  }
+  if (slots != &one) {
+    free(slots);
+  }
+  return complete;
+}
+
+/*
+ * Directories of a mounted image (vfs_mount_image) come from its index:
+ * already in memory, immutable, so never cached here.
+ */
+typedef struct {
+  list_builder_t *b;
+  ftp_list_writer_t *w;
+  ftp_list_format_t fmt;
+} list_image_t;
+
+static int list_image_entry(void *user, const char *name,
+                            const vfs_stat_t *st) {
+  list_image_t *li = (list_image_t *)user;
+  if (li->b != NULL) {
+    builder_add(li->b, st, name);
+  }
+  if ((li->w != NULL) &&
+      (ftp_list_writer_add(li->w, li->fmt, st, name) == FTP_ERR_SOCKET_SEND)) {
+    return 1; /* client went away */
+  }
+  return 0;
+}
+
+ftp_error_t ftp_list_send_directory(ftp_session_t *session, const char *path,
+                                    ftp_list_format_t fmt) {
+  if ((session == NULL) || (path == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  if (vfs_is_image_path(path) != 0) {
+    ftp_list_writer_t w;
+    ftp_list_writer_open(&w, session);
+    list_image_t li = {NULL, &w, fmt};
+    ftp_error_t err = vfs_image_readdir(path, list_image_entry, &li);
+    ftp_error_t werr = ftp_list_writer_close(&w);
+    return (err != FTP_OK) ? FTP_ERR_DIR_OPEN : werr;
+  }
+
+  int want_stat = (fmt != FTP_LIST_NAMES) ? 1 : 0;
+  int skip_stat = list_skip_stat(path);
+  if (skip_stat != 0) {
+    want_stat = 0;
+  }
+
+  int cacheable = ((FTP_LIST_CACHE_ENABLE != 0) && (skip_stat == 0) &&
+                   (lc_blob_index(fmt) >= 0))
+                      ? 1
+                      : 0;
+  list_dir_key_t key;
+  memset(&key, 0, sizeof(key));
+  uint64_t gen0 = 0U;
+  if ((cacheable != 0) && (lc_dir_key(path, &key) != 0)) {
+    cacheable = 0;
+  }
+  if (cacheable != 0) {
+    list_entry_t *e = lc_acquire(path, &key, want_stat);
+    if (e != NULL) {
+      ftp_error_t err = lc_serve(session, e, fmt);
+      lc_release(e);
+      return err;
+    }
+    gen0 = lc_generation();
+  }
+
+  DIR *dir = opendir(path);
+  if (dir == NULL) {
+    return FTP_ERR_DIR_OPEN;
+  }
+
+  list_stat_ctx_t ctx;
+  if (list_stat_ctx_init(&ctx, dir, path) != 0) {
+    want_stat = 0;
+    cacheable = 0;
+  }
+
+  list_builder_t b;
+  memset(&b, 0, sizeof(b));
+  b.failed = (cacheable == 0) ? 1 : 0;
+
+  ftp_list_writer_t w;
+  ftp_list_writer_open(&w, session);
+  int complete = list_walk(dir, &ctx, want_stat, &b, &w, fmt);
+  closedir(dir);
+  ftp_error_t err = ftp_list_writer_close(&w);
+
+  /*
+   * Store only a complete walk of a directory whose mtime is at least two
+   * seconds old: with coarse timestamps (FAT/exFAT, second-granular
+   * stat) a change later in the same tick would otherwise go unnoticed.
+   */
+  if ((b.failed == 0) && (complete != 0) && (err == FTP_OK) &&
+      ((int64_t)time(NULL) - key.mtime_s >= 2)) {
+    lc_publish(path, &key, gen0, &b, want_stat);
+  } else {
+    builder_free(&b);
+  }
+  return err;
+}
+
+/*===========================================================================*
+ * SNAPSHOTS
+ *===========================================================================*/
+
+ftp_error_t ftp_list_snapshot(const char *path, ftp_list_snapshot_t *snap) {
+  if ((path == NULL) || (snap == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  snap->count = 0U;
+  snap->entry = NULL;
+
+  if (vfs_is_image_path(path) != 0) {
+    list_builder_t b;
+    memset(&b, 0, sizeof(b));
+    b.uncapped = 1;
+    list_image_t li = {&b, NULL, FTP_LIST_NAMES};
+    if (vfs_image_readdir(path, list_image_entry, &li) != FTP_OK) {
+      builder_free(&b);
+      return FTP_ERR_DIR_OPEN;
+    }
+    if (b.failed != 0) {
+      return FTP_ERR_OUT_OF_MEMORY;
+    }
+    list_dir_key_t key;
+    memset(&key, 0, sizeof(key));
+    list_entry_t *e = lc_entry_new(path, &key, &b, 1);
+    if (e == NULL) {
+      return FTP_ERR_OUT_OF_MEMORY;
+    }
+    e->refs = 1U;
+    snap->entry = e;
+    snap->count = e->count;
+    return FTP_OK;
+  }
+
+  int skip_stat = list_skip_stat(path);
+  int want_stat = (skip_stat == 0) ? 1 : 0;
+  int cacheable = ((FTP_LIST_CACHE_ENABLE != 0) && (skip_stat == 0)) ? 1 : 0;
+  list_dir_key_t key;
+  memset(&key, 0, sizeof(key));
+  uint64_t gen0 = 0U;
+  if ((cacheable != 0) && (lc_dir_key(path, &key) != 0)) {
+    cacheable = 0;
+  }
+  if (cacheable != 0) {
+    list_entry_t *e = lc_acquire(path, &key, 1);
+    if (e != NULL) {
+      snap->entry = e;
+      snap->count = e->count;
+      return FTP_OK;
+    }
+    gen0 = lc_generation();
+  }
+
+  DIR *dir = opendir(path);
+  if (dir == NULL) {
+    return FTP_ERR_DIR_OPEN;
+  }
+  list_stat_ctx_t ctx;
+  if (list_stat_ctx_init(&ctx, dir, path) != 0) {
+    want_stat = 0;
+    cacheable = 0;
+  }
+
+  /* The caller needs every entry, cacheable or not */
+  list_builder_t b;
+  memset(&b, 0, sizeof(b));
+  b.uncapped = 1;
+  (void)list_walk(dir, &ctx, want_stat, &b, NULL, FTP_LIST_NAMES);
+  closedir(dir);
+  if (b.failed != 0) {
+    return FTP_ERR_OUT_OF_MEMORY;
+  }
+
+  list_entry_t *e = lc_entry_new(path, &key, &b, want_stat);
+  if (e == NULL) {
+    return FTP_ERR_OUT_OF_MEMORY;
+  }
+  e->refs = 1U;
+  if ((cacheable != 0) && ((int64_t)time(NULL) - key.mtime_s >= 2)) {
+    lc_link(e, gen0);
+  }
+  snap->entry = e;
+  snap->count = e->count;
+  return FTP_OK;
+}
+
+const vfs_stat_t *ftp_list_snapshot_stat(const ftp_list_snapshot_t *snap,
+                                         size_t i) {
+  const list_entry_t *e = (const list_entry_t *)snap->entry;
+  return &e->items[i].st;
+}
+
+const char *ftp_list_snapshot_name(const ftp_list_snapshot_t *snap,
+                                   size_t i) {
+  const list_entry_t *e = (const list_entry_t *)snap->entry;
+  return e->names + e->items[i].name_off;
+}
+
+void ftp_list_snapshot_release(ftp_list_snapshot_t *snap) {
+  if ((snap == NULL) || (snap->entry == NULL)) {
+    return;
+  }
+  lc_release((list_entry_t *)snap->entry);
+  snap->entry = NULL;
+  snap->count = 0U;
+}
@@ -1,6 +1,13 @@
 #include "ftp_log.h"
+#include "pal_thread.h"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 static const char *level_str(ftp_log_level_t level)
 {
@@ -15,49 +22,376 @@ static const char *level_str(ftp_log_level_t level)
     }
 }
 
+static FILE *log_stream(void)
+{
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+    return stdout;
+#else
+    return stderr;
+#endif
+}
+
 void ftp_log_line(ftp_log_level_t level, const char *line)
 {
     if (line == NULL) {
         return;
     }
 
-#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
-    printf("[FTP][%s] %s\n", level_str(level), line);
-#else
-    fprintf(stderr, "[FTP][%s] %s\n", level_str(level), line);
-#endif
+    fprintf(log_stream(), "[FTP][%s] %s\n", level_str(level), line);
+}
+
+/*===========================================================================*
+ * SESSION RECORDS
+ *
+ *   session thread                          log thread
+ *   ──────────────                          ──────────
+ *   fill log_rec_t at head ──► [ring] ──►   merge rings by timestamp,
+ *   (drop + count if full)                  format, one write per batch
+ *
+ *   Rings are single-producer (the owning thread) / single-consumer
+ *   (whoever holds g_drain_lock).  A thread claims a free ring on its
+ *   first record and releases it from a pthread key destructor at exit;
+ *   the next thread to claim it keeps appending after what is left.
+ *===========================================================================*/
+
+#define LOG_NAME_MAX 16U
+
+typedef enum {
+    LOG_REC_CMD = 0,
+    LOG_REC_EVENT = 1
+} log_rec_kind_t;
+
+typedef struct {
+    uint64_t ts_ns;
+    uint64_t bytes;
+    uint32_t sid;
+    uint32_t ip; /* network order, 0 = unknown */
+    int32_t result;
+    uint8_t kind;
+    char name[LOG_NAME_MAX];
+} log_rec_t;
+
+static void log_format(const log_rec_t *r, char *buf, size_t size)
+{
+    char ip[INET_ADDRSTRLEN] = "unknown";
+    if (r->ip != 0U) {
+        struct in_addr a;
+        a.s_addr = r->ip;
+        (void)inet_ntop(AF_INET, &a, ip, sizeof(ip));
+    }
+
+    if (r->kind == (uint8_t)LOG_REC_CMD) {
+        (void)snprintf(buf, size,
+                       "[FTP][%s] SID=%u IP=%s CMD=%s RES=%d\n",
+                       level_str((r->result == 0) ? FTP_LOG_INFO : FTP_LOG_WARN),
+                       (unsigned)r->sid, ip, r->name, (int)r->result);
+    } else {
+        (void)snprintf(buf, size,
+                       "[FTP][%s] SID=%u IP=%s EVT=%s RES=%d BYTES=%llu\n",
+                       level_str((r->result == 0) ? FTP_LOG_INFO : FTP_LOG_WARN),
+                       (unsigned)r->sid, ip, r->name, (int)r->result,
+                       (unsigned long long)r->bytes);
+    }
+}
+
+static void log_fill(log_rec_t *r, const ftp_session_t *session,
+                     log_rec_kind_t kind, const char *name,
+                     ftp_error_t result, uint64_t bytes)
+{
+    struct timespec ts;
+    r->ts_ns = (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+                   ? ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec
+                   : 0U;
+    r->bytes = bytes;
+    r->sid = (session != NULL) ? session->session_id : 0U;
+    r->ip = (session != NULL) ? session->ctrl_addr.sin_addr.s_addr : 0U;
+    r->result = (int32_t)result;
+    r->kind = (uint8_t)kind;
+
+    const char *src = (name != NULL) ? name : "unknown";
+    size_t n = strlen(src);
+    if (n >= LOG_NAME_MAX) {
+        n = LOG_NAME_MAX - 1U;
+    }
+    memcpy(r->name, src, n);
+    r->name[n] = '\0';
+}
+
+static void log_write_direct(const log_rec_t *r)
+{
+    char buf[160];
+    log_format(r, buf, sizeof(buf));
+    (void)fputs(buf, log_stream());
 }
 
+#if FTP_LOG_ASYNC
+
+#define LOG_RING_MASK (FTP_LOG_RING_RECORDS - 1U)
+
+typedef struct {
+    atomic_uint owned;         /* 1 = a live thread produces into it */
+    _Atomic uint64_t head;     /* written by the producer            */
+    _Atomic uint64_t tail;     /* written by the consumer            */
+    _Atomic uint64_t dropped;
+    log_rec_t recs[FTP_LOG_RING_RECORDS];
+} log_ring_t;
+
+static _Atomic(log_ring_t *) g_rings[FTP_LOG_RINGS];
+static atomic_uint g_ring_count = 0U;
+static _Atomic uint64_t g_queued = 0U;
+static _Atomic uint64_t g_written = 0U;
+static _Atomic uint64_t g_direct = 0U;
+static uint64_t g_dropped_reported = 0U; /* under g_drain_lock */
+
+static pthread_mutex_t g_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_log_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_ring_key;
+static int g_log_ready = 0;
+static _Thread_local log_ring_t *t_ring = NULL;
+
+static void ring_release(void *arg)
+{
+    log_ring_t *ring = (log_ring_t *)arg;
+    if (ring != NULL) {
+        atomic_store_explicit(&ring->owned, 0U, memory_order_release);
+    }
+}
+
+/* Merge every ring's pending records by timestamp and write them */
+static void log_drain(void)
+{
+    char batch[8192];
+    size_t used = 0U;
+    log_ring_t *rings[FTP_LOG_RINGS];
+    uint64_t head[FTP_LOG_RINGS];
+    unsigned count = atomic_load(&g_ring_count);
+    uint64_t dropped = 0U;
+
+    pthread_mutex_lock(&g_drain_lock);
+    for (unsigned i = 0U; i < count; i++) {
+        rings[i] = atomic_load_explicit(&g_rings[i], memory_order_acquire);
+        head[i] = (rings[i] != NULL)
+                      ? atomic_load_explicit(&rings[i]->head, memory_order_acquire)
+                      : 0U;
+        if (rings[i] != NULL) {
+            dropped += atomic_load(&rings[i]->dropped);
+        }
+    }
+
+    for (;;) {
+        log_ring_t *pick = NULL;
+        uint64_t pick_ts = UINT64_MAX;
+        for (unsigned i = 0U; i < count; i++) {
+            if (rings[i] == NULL) {
+                continue;
+            }
+            uint64_t tail = atomic_load_explicit(&rings[i]->tail, memory_order_relaxed);
+            if (tail == head[i]) {
+                continue;
+            }
+            const log_rec_t *r = &rings[i]->recs[tail & LOG_RING_MASK];
+            if ((pick == NULL) || (r->ts_ns < pick_ts)) {
+                pick = rings[i];
+                pick_ts = r->ts_ns;
+            }
+        }
+        if (pick == NULL) {
+            break;
+        }
+
+        uint64_t tail = atomic_load_explicit(&pick->tail, memory_order_relaxed);
+        char line[160];
+        log_format(&pick->recs[tail & LOG_RING_MASK], line, sizeof(line));
+        atomic_store_explicit(&pick->tail, tail + 1U, memory_order_release);
+
+        size_t n = strlen(line);
+        if ((used + n) > sizeof(batch)) {
+            (void)fwrite(batch, 1U, used, log_stream());
+            used = 0U;
+        }
+        memcpy(batch + used, line, n);
+        used += n;
+        atomic_fetch_add(&g_written, 1U);
+    }
+
+    if (used > 0U) {
+        (void)fwrite(batch, 1U, used, log_stream());
+    }
+    if (dropped > g_dropped_reported) {
+        fprintf(log_stream(), "[FTP][WARN] log: dropped %llu records (total %llu)\n",
+                (unsigned long long)(dropped - g_dropped_reported),
+                (unsigned long long)dropped);
+        g_dropped_reported = dropped;
+    }
+    (void)fflush(log_stream());
+    pthread_mutex_unlock(&g_drain_lock);
+}
+
+static void *log_thread(void *arg)
+{
+    (void)arg;
+    for (;;) {
+        usleep((useconds_t)FTP_LOG_FLUSH_MS * 1000U);
+        log_drain();
+    }
+    return NULL;
+}
+
+static void log_init(void)
+{
+    if (pthread_key_create(&g_ring_key, ring_release) != 0) {
+        return;
+    }
+
+    pthread_attr_t attr;
+    pthread_t tid;
+    if (pthread_attr_init(&attr) != 0) {
+        return;
+    }
+    (void)pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    (void)pthread_attr_setstacksize(&attr, 64U * 1024U);
+    int rc = pal_thread_create(&tid, &attr, PAL_THREAD_BACKGROUND, log_thread,
+                               NULL);
+    (void)pthread_attr_destroy(&attr);
+    if (rc != 0) {
+        return;
+    }
+
+    (void)atexit(ftp_log_flush);
+    g_log_ready = 1;
+}
+
+/* This thread's ring: claim a released one, else allocate a new one */
+static log_ring_t *ring_get(void)
+{
+    if (t_ring != NULL) {
+        return t_ring;
+    }
+    (void)pthread_once(&g_log_once, log_init);
+    if (g_log_ready == 0) {
+        return NULL;
+    }
+
+    unsigned count = atomic_load(&g_ring_count);
+    for (unsigned i = 0U; i < count; i++) {
+        log_ring_t *ring = atomic_load(&g_rings[i]);
+        unsigned expected = 0U;
+        if ((ring != NULL) &&
+            atomic_compare_exchange_strong(&ring->owned, &expected, 1U)) {
+            t_ring = ring;
+            break;
+        }
+    }
+
+    if (t_ring == NULL) {
+        unsigned slot = atomic_fetch_add(&g_ring_count, 1U);
+        if (slot >= FTP_LOG_RINGS) {
+            atomic_fetch_sub(&g_ring_count, 1U);
+            return NULL;
+        }
+        log_ring_t *ring = calloc(1U, sizeof(*ring));
+        if (ring == NULL) {
+            return NULL; /* slot stays NULL; the drain skips it */
+        }
+        atomic_store(&ring->owned, 1U);
+        atomic_store_explicit(&g_rings[slot], ring, memory_order_release);
+        t_ring = ring;
+    }
+
+    (void)pthread_setspecific(g_ring_key, t_ring);
+    return t_ring;
+}
+
+static void log_submit(const ftp_session_t *session, log_rec_kind_t kind,
+                       const char *name, ftp_error_t result, uint64_t bytes)
+{
+    log_ring_t *ring = ring_get();
+    if (ring == NULL) {
+        log_rec_t r;
+        log_fill(&r, session, kind, name, result, bytes);
+        log_write_direct(&r);
+        atomic_fetch_add(&g_direct, 1U);
+        return;
+    }
+
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if ((head - tail) >= (uint64_t)FTP_LOG_RING_RECORDS) {
+        atomic_fetch_add_explicit(&ring->dropped, 1U, memory_order_relaxed);
+        return;
+    }
+    log_fill(&ring->recs[head & LOG_RING_MASK], session, kind, name, result,
+             bytes);
+    atomic_store_explicit(&ring->head, head + 1U, memory_order_release);
+    atomic_fetch_add_explicit(&g_queued, 1U, memory_order_relaxed);
+}
+
+void ftp_log_flush(void)
+{
+    if (g_log_ready != 0) {
+        log_drain();
+    }
+}
+
+void ftp_log_get_stats(ftp_log_stats_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    unsigned count = atomic_load(&g_ring_count);
+    for (unsigned i = 0U; (i < count) && (i < FTP_LOG_RINGS); i++) {
+        log_ring_t *ring = atomic_load(&g_rings[i]);
+        if (ring != NULL) {
+            out->dropped += atomic_load(&ring->dropped);
+            out->rings++;
+        }
+    }
+    out->queued = atomic_load(&g_queued);
+    out->written = atomic_load(&g_written);
+    out->direct = atomic_load(&g_direct);
+}
+
+#else /* !FTP_LOG_ASYNC */
+
+static _Atomic uint64_t g_direct = 0U;
+
+static void log_submit(const ftp_session_t *session, log_rec_kind_t kind,
+                       const char *name, ftp_error_t result, uint64_t bytes)
+{
+    log_rec_t r;
+    log_fill(&r, session, kind, name, result, bytes);
+    log_write_direct(&r);
+    atomic_fetch_add(&g_direct, 1U);
+}
+
+void ftp_log_flush(void)
+{
+    (void)fflush(log_stream());
+}
+
+void ftp_log_get_stats(ftp_log_stats_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    out->direct = atomic_load(&g_direct);
+}
+
+#endif /* FTP_LOG_ASYNC */
+
 void ftp_log_session_event(const ftp_session_t *session,
                            const char *event,
                            ftp_error_t result,
                            uint64_t bytes)
 {
-    const uint32_t sid = (session != NULL) ? session->session_id : 0U;
-    const char *ip = (session != NULL) ? session->client_ip : "unknown";
-    char buf[256];
-    (void)snprintf(buf, sizeof(buf),
-                   "SID=%u IP=%s EVT=%s RES=%d BYTES=%llu",
-                   (unsigned)sid,
-                   ip,
-                   (event != NULL) ? event : "unknown",
-                   (int)result,
-                   (unsigned long long)bytes);
-    ftp_log_line((result == FTP_OK) ? FTP_LOG_INFO : FTP_LOG_WARN, buf);
+    log_submit(session, LOG_REC_EVENT, event, result, bytes);
 }
 
 void ftp_log_session_cmd(const ftp_session_t *session,
                          const char *command,
                          ftp_error_t result)
 {
-    const uint32_t sid = (session != NULL) ? session->session_id : 0U;
-    const char *ip = (session != NULL) ? session->client_ip : "unknown";
-    char buf[256];
-    (void)snprintf(buf, sizeof(buf),
-                   "SID=%u IP=%s CMD=%s RES=%d",
-                   (unsigned)sid,
-                   ip,
-                   (command != NULL) ? command : "unknown",
-                   (int)result);
-    ftp_log_line((result == FTP_OK) ? FTP_LOG_INFO : FTP_LOG_WARN, buf);
+    log_submit(session, LOG_REC_CMD, command, result, 0U);
 }
@@ -0,0 +1,479 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_metrics.c
+ * @brief Metrics registry: sharded counters and log2 histograms
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Each shard is aligned to a cache line so threads recording into
+ * different shards never share one.  Threads take shards round-robin on
+ * first use; with more threads than shards two may share a shard, which
+ * costs contention on its atomics but never loses a count.
+ *
+ * Buckets are stored per bucket, not cumulatively; the scrape turns them
+ * into Prometheus' cumulative "le" series and derives _count from the
+ * same sums, so a scrape racing with writers stays self-consistent.
+ */
+
+#include "ftp_metrics.h"
+#include "ftp_buffer_pool.h"
+#include "ftp_config.h"
+#include "ftp_protocol.h"
+#include "ftp_server.h"
+#include "pal_alloc.h"
+#include "pal_scratch.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/** Upper bound of bucket 0 is 2^METRICS_BASE_SHIFT units */
+#define METRICS_BASE_SHIFT 10U
+
+#define METRICS_SLOTS (FTP_METRICS_BUCKETS + 1U) /* + the +Inf bucket */
+
+typedef struct {
+  _Atomic uint64_t bucket[METRICS_SLOTS];
+  _Atomic uint64_t sum;
+} metrics_hist_t;
+
+typedef struct {
+  _Alignas(64) _Atomic uint64_t counter[FTP_METRIC_COUNTERS];
+  metrics_hist_t hist[FTP_METRIC_HISTOGRAMS];
+  metrics_hist_t verb[FTP_METRICS_VERBS];
+} metrics_shard_t;
+
+static metrics_shard_t g_shards[FTP_METRICS_SHARDS];
+static atomic_uint g_next_shard = 0U;
+static _Thread_local metrics_shard_t *t_shard = NULL;
+
+static metrics_shard_t *shard_self(void) {
+  if (t_shard == NULL) {
+    unsigned i = atomic_fetch_add_explicit(&g_next_shard, 1U,
+                                           memory_order_relaxed);
+    t_shard = &g_shards[i % FTP_METRICS_SHARDS];
+  }
+  return t_shard;
+}
+
+static uint64_t metrics_now_ns(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 0U;
+  }
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+unsigned ftp_metrics_bucket(uint64_t value) {
+  if (value <= (1ULL << METRICS_BASE_SHIFT)) {
+    return 0U;
+  }
+  /* ceil(log2(value)) - base */
+  unsigned bits = 64U - (unsigned)__builtin_clzll(value - 1U);
+  unsigned i = bits - METRICS_BASE_SHIFT;
+  return (i > FTP_METRICS_BUCKETS) ? FTP_METRICS_BUCKETS : i;
+}
+
+static void hist_record(metrics_hist_t *h, uint64_t value) {
+  atomic_fetch_add_explicit(&h->bucket[ftp_metrics_bucket(value)], 1U,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&h->sum, value, memory_order_relaxed);
+}
+
+/*===========================================================================*
+ * RECORDING
+ *===========================================================================*/
+
+void ftp_metrics_add(ftp_metric_counter_t c, uint64_t n) {
+  if ((unsigned)c >= (unsigned)FTP_METRIC_COUNTERS) {
+    return;
+  }
+  atomic_fetch_add_explicit(&shard_self()->counter[c], n,
+                            memory_order_relaxed);
+}
+
+uint64_t ftp_metrics_counter(ftp_metric_counter_t c) {
+  if ((unsigned)c >= (unsigned)FTP_METRIC_COUNTERS) {
+    return 0U;
+  }
+  uint64_t total = 0U;
+  for (size_t s = 0U; s < FTP_METRICS_SHARDS; s++) {
+    total += atomic_load_explicit(&g_shards[s].counter[c],
+                                  memory_order_relaxed);
+  }
+  return total;
+}
+
+void ftp_metrics_observe(ftp_metric_hist_t h, uint64_t value) {
+  if ((unsigned)h >= (unsigned)FTP_METRIC_HISTOGRAMS) {
+    return;
+  }
+  hist_record(&shard_self()->hist[h], value);
+}
+
+void ftp_metrics_command(size_t verb, uint64_t ns) {
+  if (verb >= FTP_METRICS_VERBS) {
+    return;
+  }
+  hist_record(&shard_self()->verb[verb], ns);
+}
+
+int ftp_metrics_first_byte(_Atomic uint64_t *armed_ns) {
+  if ((armed_ns == NULL) ||
+      (atomic_load_explicit(armed_ns, memory_order_relaxed) == 0U)) {
+    return 0;
+  }
+  uint64_t t0 = atomic_exchange(armed_ns, 0U);
+  uint64_t now = metrics_now_ns();
+  if ((t0 == 0U) || (now < t0)) {
+    return 0;
+  }
+  ftp_metrics_observe(FTP_METRIC_FIRST_BYTE, now - t0);
+  return 1;
+}
+
+void ftp_metrics_transfer(int rx, uint64_t bytes, uint64_t ns) {
+  if ((bytes < (uint64_t)FTP_METRICS_RATE_MIN_BYTES) || (ns == 0U)) {
+    return;
+  }
+  double bps = ((double)bytes * 1e9) / (double)ns;
+  ftp_metrics_observe((rx != 0) ? FTP_METRIC_RATE_RECV : FTP_METRIC_RATE_SEND,
+                      (uint64_t)bps);
+}
+
+/*===========================================================================*
+ * EXPOSITION
+ *===========================================================================*/
+
+typedef struct {
+  char *buf;
+  size_t cap;
+  size_t len; /* may exceed cap: bytes the full output needs */
+} metrics_out_t;
+
+static void out_printf(metrics_out_t *o, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void out_printf(metrics_out_t *o, const char *fmt, ...) {
+  char *at = NULL;
+  size_t room = 0U;
+  if (o->len < o->cap) {
+    at = o->buf + o->len;
+    room = o->cap - o->len;
+  }
+  va_list ap;
+  va_start(ap, fmt);
+  int n = vsnprintf(at, room, fmt, ap);
+  va_end(ap);
+  if (n > 0) {
+    o->len += (size_t)n;
+  }
+}
+
+static void out_family(metrics_out_t *o, const char *name, const char *type,
+                       const char *help) {
+  out_printf(o, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* Sum one histogram (or one verb's) over the shards */
+static void hist_collect(int verb, size_t idx, uint64_t bucket[METRICS_SLOTS],
+                         uint64_t *sum) {
+  memset(bucket, 0, sizeof(uint64_t) * METRICS_SLOTS);
+  *sum = 0U;
+  for (size_t s = 0U; s < FTP_METRICS_SHARDS; s++) {
+    metrics_hist_t *h =
+        (verb != 0) ? &g_shards[s].verb[idx] : &g_shards[s].hist[idx];
+    for (size_t b = 0U; b < METRICS_SLOTS; b++) {
+      bucket[b] += atomic_load_explicit(&h->bucket[b], memory_order_relaxed);
+    }
+    *sum += atomic_load_explicit(&h->sum, memory_order_relaxed);
+  }
+}
+
+/*
+ * One histogram series.  @p label is "" or `key="value",` (trailing
+ * comma included); @p ns selects seconds (ns values) over plain units.
+ */
+static void out_hist(metrics_out_t *o, const char *name, const char *label,
+                     int ns, const uint64_t bucket[METRICS_SLOTS],
+                     uint64_t sum) {
+  uint64_t cum = 0U;
+  for (unsigned b = 0U; b < FTP_METRICS_BUCKETS; b++) {
+    uint64_t bound = 1ULL << (b + METRICS_BASE_SHIFT);
+    cum += bucket[b];
+    if (ns != 0) {
+      out_printf(o, "%s_bucket{%sle=\"%.9g\"} %" PRIu64 "\n", name, label,
+                 (double)bound / 1e9, cum);
+    } else {
+      out_printf(o, "%s_bucket{%sle=\"%" PRIu64 "\"} %" PRIu64 "\n", name,
+                 label, bound, cum);
+    }
+  }
+  cum += bucket[FTP_METRICS_BUCKETS];
+  out_printf(o, "%s_bucket{%sle=\"+Inf\"} %" PRIu64 "\n", name, label, cum);
+
+  /* Drop the trailing comma for _sum / _count */
+  size_t ll = strlen(label);
+  int lw = (ll > 0U) ? (int)(ll - 1U) : 0;
+  const char *open = (ll > 0U) ? "{" : "";
+  const char *close = (ll > 0U) ? "}" : "";
+  if (ns != 0) {
+    out_printf(o, "%s_sum%s%.*s%s %.9f\n", name, open, lw, label, close,
+               (double)sum / 1e9);
+  } else {
+    out_printf(o, "%s_sum%s%.*s%s %" PRIu64 "\n", name, open, lw, label,
+               close, sum);
+  }
+  out_printf(o, "%s_count%s%.*s%s %" PRIu64 "\n", name, open, lw, label,
+             close, cum);
+}
+
+static void render_histograms(metrics_out_t *o) {
+  uint64_t bucket[METRICS_SLOTS];
+  uint64_t sum = 0U;
+
+  size_t verbs = 0U;
+  const ftp_command_entry_t *table = ftp_get_command_table(&verbs);
+  out_family(o, "zftpd_command_duration_seconds", "histogram",
+             "Control command latency by verb");
+  for (size_t v = 0U; (v < verbs) && (v < FTP_METRICS_VERBS); v++) {
+    hist_collect(1, v, bucket, &sum);
+    uint64_t n = 0U;
+    for (size_t b = 0U; b < METRICS_SLOTS; b++) {
+      n += bucket[b];
+    }
+    if (n == 0U) {
+      continue; /* unused verbs would be 26 lines of zeros each */
+    }
+    char label[32];
+    (void)snprintf(label, sizeof(label), "verb=\"%s\",", table[v].name);
+    out_hist(o, "zftpd_command_duration_seconds", label, 1, bucket, sum);
+  }
+
+  hist_collect(0, FTP_METRIC_FIRST_BYTE, bucket, &sum);
+  out_family(o, "zftpd_transfer_first_byte_seconds", "histogram",
+             "Transfer command to first data byte");
+  out_hist(o, "zftpd_transfer_first_byte_seconds", "", 1, bucket, sum);
+
+  hist_collect(0, FTP_METRIC_PASV_ACCEPT, bucket, &sum);
+  out_family(o, "zftpd_pasv_accept_seconds", "histogram",
+             "Wait for the client to connect to a passive listener");
+  out_hist(o, "zftpd_pasv_accept_seconds", "", 1, bucket, sum);
+
+  out_family(o, "zftpd_transfer_throughput_bytes_per_second", "histogram",
+             "Data connection throughput");
+  hist_collect(0, FTP_METRIC_RATE_SEND, bucket, &sum);
+  out_hist(o, "zftpd_transfer_throughput_bytes_per_second",
+           "direction=\"send\",", 0, bucket, sum);
+  hist_collect(0, FTP_METRIC_RATE_RECV, bucket, &sum);
+  out_hist(o, "zftpd_transfer_throughput_bytes_per_second",
+           "direction=\"recv\",", 0, bucket, sum);
+
+  hist_collect(0, FTP_METRIC_TCP_RTT, bucket, &sum);
+  out_family(o, "zftpd_tcp_rtt_seconds", "histogram",
+             "Smoothed RTT sampled from data sockets");
+  out_hist(o, "zftpd_tcp_rtt_seconds", "", 1, bucket, sum);
+
+  hist_collect(0, FTP_METRIC_TCP_CWND, bucket, &sum);
+  out_family(o, "zftpd_tcp_cwnd_bytes", "histogram",
+             "Congestion window sampled from data sockets");
+  out_hist(o, "zftpd_tcp_cwnd_bytes", "", 0, bucket, sum);
+
+  hist_collect(0, FTP_METRIC_TCP_SENDQ, bucket, &sum);
+  out_family(o, "zftpd_tcp_send_queue_bytes", "histogram",
+             "Bytes queued in data socket send buffers");
+  out_hist(o, "zftpd_tcp_send_queue_bytes", "", 0, bucket, sum);
+
+  hist_collect(0, FTP_METRIC_SOCKBUF, bucket, &sum);
+  out_family(o, "zftpd_tcp_socket_buffer_bytes", "histogram",
+             "Data socket buffer size in the transfer direction");
+  out_hist(o, "zftpd_tcp_socket_buffer_bytes", "", 0, bucket, sum);
+}
+
+static void out_value(metrics_out_t *o, const char *name, const char *type,
+                      const char *help, uint64_t value) {
+  out_family(o, name, type, help);
+  out_printf(o, "%s %" PRIu64 "\n", name, value);
+}
+
+static void render_counters(metrics_out_t *o) {
+  out_value(o, "zftpd_sendfile_eagain_total", "counter",
+            "sendfile() calls that returned EAGAIN",
+            ftp_metrics_counter(FTP_METRIC_SENDFILE_EAGAIN));
+  out_value(o, "zftpd_sendfile_stalls_total", "counter",
+            "sendfile() stalls that fell back to a read() cooldown",
+            ftp_metrics_counter(FTP_METRIC_SENDFILE_STALLS));
+  out_value(o, "zftpd_sendfile_cooldown_bytes_total", "counter",
+            "Bytes sent with read()+send() during cooldowns",
+            ftp_metrics_counter(FTP_METRIC_COOLDOWN_BYTES));
+  out_value(o, "zftpd_tcp_retransmits_total", "counter",
+            "TCP retransmits seen while sampling data sockets",
+            ftp_metrics_counter(FTP_METRIC_TCP_RETRANS));
+  out_value(o, "zftpd_tcp_buffer_resizes_total", "counter",
+            "Data socket buffers grown by the auto-tuner",
+            ftp_metrics_counter(FTP_METRIC_SOCKBUF_RESIZES));
+  out_value(o, "zftpd_zerocopy_bytes_total", "counter",
+            "Data bytes sent with MSG_ZEROCOPY",
+            ftp_metrics_counter(FTP_METRIC_ZEROCOPY_BYTES));
+  out_value(o, "zftpd_zerocopy_copied_total", "counter",
+            "MSG_ZEROCOPY completions the kernel served by copying",
+            ftp_metrics_counter(FTP_METRIC_ZEROCOPY_COPIED));
+  out_value(o, "zftpd_prefetch_files_total", "counter",
+            "Files warmed ahead of a predicted RETR",
+            ftp_metrics_counter(FTP_METRIC_PREFETCH_FILES));
+  out_value(o, "zftpd_prefetch_bytes_total", "counter",
+            "Bytes brought into the page cache by prefetch",
+            ftp_metrics_counter(FTP_METRIC_PREFETCH_BYTES));
+  out_value(o, "zftpd_prefetch_hits_total", "counter",
+            "RETRs of a file that was predicted",
+            ftp_metrics_counter(FTP_METRIC_PREFETCH_HITS));
+  out_value(o, "zftpd_prefetch_cancelled_total", "counter",
+            "Predicted files dropped when the access pattern broke",
+            ftp_metrics_counter(FTP_METRIC_PREFETCH_CANCELLED));
+  out_value(o, "zftpd_segment_files_total", "counter",
+            "Files transferred by more than one data connection at once",
+            ftp_metrics_counter(FTP_METRIC_SEGMENT_FILES));
+  out_value(o, "zftpd_segment_joins_total", "counter",
+            "RETR/STOR streams that joined a file already in transfer",
+            ftp_metrics_counter(FTP_METRIC_SEGMENT_JOINS));
+
+  static const char *const class_name[FTP_BUFFER_CLASSES] = {"small",
+                                                             "stream",
+                                                             "large"};
+  ftp_buffer_class_stats_t bs[FTP_BUFFER_CLASSES];
+  ftp_buffer_get_stats(bs);
+  out_family(o, "zftpd_buffer_acquires_total", "counter",
+             "Buffer pool acquisitions by class");
+  for (size_t c = 0U; c < FTP_BUFFER_CLASSES; c++) {
+    out_printf(o, "zftpd_buffer_acquires_total{class=\"%s\"} %" PRIu64 "\n",
+               class_name[c], bs[c].acquires);
+  }
+  out_family(o, "zftpd_buffer_waits_total", "counter",
+             "Buffer pool requests that found the class exhausted");
+  for (size_t c = 0U; c < FTP_BUFFER_CLASSES; c++) {
+    out_printf(o, "zftpd_buffer_waits_total{class=\"%s\"} %" PRIu64 "\n",
+               class_name[c], bs[c].waits);
+  }
+  out_family(o, "zftpd_buffer_in_use", "gauge",
+             "Buffers currently held by callers");
+  for (size_t c = 0U; c < FTP_BUFFER_CLASSES; c++) {
+    out_printf(o, "zftpd_buffer_in_use{class=\"%s\"} %u\n", class_name[c],
+               (unsigned)bs[c].in_use);
+  }
+
+  pal_alloc_stats_t as;
+  pal_alloc_get_stats(&as);
+  out_value(o, "zftpd_alloc_calls_total", "counter",
+            "pal_alloc allocations (malloc, calloc, realloc, aligned)",
+            as.alloc_calls + as.calloc_calls + as.realloc_calls +
+                as.aligned_calls);
+  out_value(o, "zftpd_alloc_frees_total", "counter", "pal_alloc frees",
+            as.free_calls);
+  out_value(o, "zftpd_alloc_failures_total", "counter",
+            "pal_alloc requests that could not be served", as.failures);
+  out_value(o, "zftpd_alloc_bytes_in_use", "gauge",
+            "pal_alloc arena bytes allocated", as.bytes_in_use);
+  out_value(o, "zftpd_alloc_bytes_peak", "gauge",
+            "pal_alloc arena high-water mark", as.bytes_peak);
+
+  pal_scratch_stats_t ss;
+  pal_scratch_get_stats(&ss);
+  out_value(o, "zftpd_scratch_slot_acquires_total", "counter",
+            "Shared scratch slots handed out", ss.slot_acquires);
+  out_value(o, "zftpd_scratch_slot_busy_total", "counter",
+            "Scratch slot requests that found every slot taken", ss.slot_busy);
+  out_value(o, "zftpd_scratch_arena_allocs_total", "counter",
+            "Allocations served from a thread scratch arena", ss.arena_allocs);
+  out_value(o, "zftpd_scratch_fallbacks_total", "counter",
+            "Scratch requests served by malloc() instead", ss.fallbacks);
+  out_value(o, "zftpd_scratch_fallback_bytes_total", "counter",
+            "Bytes of scratch requests served by malloc()", ss.fallback_bytes);
+
+  pal_alloc_frag_t fr;
+  pal_alloc_get_frag(&fr);
+  out_family(o, "zftpd_alloc_free_bytes", "gauge",
+             "pal_alloc free bytes by arena region");
+  out_printf(o, "zftpd_alloc_free_bytes{region=\"buddy\"} %" PRIu64 "\n",
+             fr.buddy_free);
+  out_printf(o, "zftpd_alloc_free_bytes{region=\"large\"} %" PRIu64 "\n",
+             fr.large_free);
+  out_family(o, "zftpd_alloc_largest_free_bytes", "gauge",
+             "Largest single allocation each region could serve now");
+  out_printf(o,
+             "zftpd_alloc_largest_free_bytes{region=\"buddy\"} %" PRIu64 "\n",
+             fr.buddy_largest);
+  out_printf(o,
+             "zftpd_alloc_largest_free_bytes{region=\"large\"} %" PRIu64 "\n",
+             fr.large_largest);
+  out_value(o, "zftpd_alloc_large_extents", "gauge",
+            "Free extents in the large-block region",
+            (uint64_t)fr.large_extents);
+  out_family(o, "zftpd_alloc_free_blocks", "gauge",
+             "Free buddy blocks by block size");
+  for (uint32_t i = 0U; i < PAL_ALLOC_ORDERS; i++) {
+    uint64_t block = (uint64_t)32U << i;
+    if (block > fr.buddy_size) {
+      break;
+    }
+    out_printf(o, "zftpd_alloc_free_blocks{bytes=\"%" PRIu64 "\"} %u\n", block,
+               (unsigned)fr.free_blocks[i]);
+  }
+}
+
+static void render_server(metrics_out_t *o, const ftp_server_context_t *ctx) {
+  ftp_server_stats_t st;
+  ftp_server_get_stats_ex(ctx, &st);
+  out_value(o, "zftpd_sessions_active", "gauge", "Connected sessions",
+            (uint64_t)ftp_server_get_active_sessions(ctx));
+  out_value(o, "zftpd_connections_total", "counter", "Sessions started",
+            st.total_connections);
+  out_value(o, "zftpd_connection_errors_total", "counter",
+            "Rejected or failed session starts", (uint64_t)st.total_errors);
+  out_value(o, "zftpd_bytes_sent_total", "counter",
+            "Bytes sent on data connections", st.bytes_sent);
+  out_value(o, "zftpd_bytes_received_total", "counter",
+            "Bytes received on data connections", st.bytes_received);
+  out_family(o, "zftpd_accept_latency_max_seconds", "gauge",
+             "Worst accept() to session running since start");
+  out_printf(o, "zftpd_accept_latency_max_seconds %.9f\n",
+             (double)st.accept_latency_max_ns / 1e9);
+  out_value(o, "zftpd_start_queue_depth", "gauge",
+            "Accepted connections waiting for a session",
+            (uint64_t)st.start_queue_depth);
+}
+
+size_t ftp_metrics_render(const ftp_server_context_t *ctx, char *buf,
+                          size_t cap) {
+  metrics_out_t o = {buf, (buf != NULL) ? cap : 0U, 0U};
+  if (ctx != NULL) {
+    render_server(&o, ctx);
+  }
+  render_counters(&o);
+  render_histograms(&o);
+  return o.len;
+}
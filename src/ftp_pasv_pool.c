@@ -0,0 +1,366 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_pasv_pool.c
+ * @brief Pre-bound passive listener pool
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * A slot is FREE (fd < 0), IDLE (open, not leased) or LEASED.  The slot
+ * table is scanned under one mutex; a PASV takes it once, which is far
+ * cheaper than the four socket calls it saves.  Opening a listener
+ * happens outside the lock with the slot already marked LEASED.
+ */
+
+#include "ftp_pasv_pool.h"
+#include "ftp_config.h"
+#include "ftp_types.h"
+#include "pal_network.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  int fd;        /* -1 = FREE                   */
+  uint32_t ip;   /* bound address (host order)  */
+  uint8_t leased;
+  uint8_t _pad[3];
+} pasv_slot_t;
+
+struct ftp_pasv_pool {
+  pthread_mutex_t lock;
+  pasv_slot_t *slots;
+  uint32_t count;
+  uint16_t port_min;
+  uint16_t port_max;
+  uint64_t created;
+  uint64_t reused;
+  uint64_t spilled;
+};
+
+/* Rotates the first port tried, so back-to-back listeners spread out */
+static atomic_uint g_port_cursor;
+
+/*===========================================================================*
+ * LISTENERS
+ *===========================================================================*/
+
+static int pasv_bind(int fd, uint32_t ip, uint16_t port) {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = (ip != 0U) ? PAL_HTONL(ip) : PAL_HTONL(INADDR_ANY);
+  addr.sin_port = PAL_HTONS(port);
+  return PAL_BIND(fd, (struct sockaddr *)&addr, sizeof(addr));
+}
+
+int ftp_pasv_listen(uint32_t ip, uint16_t port_min, uint16_t port_max,
+                    uint16_t *port_out) {
+  int fd = PAL_SOCKET(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return FTP_ERR_SOCKET_CREATE;
+  }
+
+  (void)pal_socket_set_reuseaddr(fd);
+
+  /* Before bind/listen: accepted sockets inherit it (see cmd_PASV) */
+  {
+    int rcvbuf = (int)FTP_TCP_RCVBUF;
+    (void)PAL_SETSOCKOPT(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+  }
+
+  int bound = -1;
+  if ((port_min == 0U) || (port_max < port_min)) {
+    bound = pasv_bind(fd, ip, 0U);
+  } else {
+    uint32_t span = (uint32_t)port_max - (uint32_t)port_min + 1U;
+    uint32_t start = atomic_fetch_add(&g_port_cursor, 1U) % span;
+    for (uint32_t i = 0U; (i < span) && (bound < 0); i++) {
+      bound = pasv_bind(fd, ip, (uint16_t)(port_min + ((start + i) % span)));
+    }
+  }
+  if (bound < 0) {
+    PAL_CLOSE(fd);
+    return FTP_ERR_SOCKET_BIND;
+  }
+
+  if (PAL_LISTEN(fd, 1) < 0) {
+    PAL_CLOSE(fd);
+    return FTP_ERR_SOCKET_LISTEN;
+  }
+
+  struct sockaddr_in local;
+  socklen_t len = (socklen_t)sizeof(local);
+  if (PAL_GETSOCKNAME(fd, (struct sockaddr *)&local, &len) < 0) {
+    PAL_CLOSE(fd);
+    return FTP_ERR_SOCKET_BIND;
+  }
+  if (port_out != NULL) {
+    *port_out = PAL_NTOHS(local.sin_port);
+  }
+  return fd;
+}
+
+/* Accept and drop whatever is queued on an idle listener */
+static void pasv_drain(int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  if ((poll(&pfd, 1U, 0) <= 0) || ((pfd.revents & POLLIN) == 0)) {
+    return;
+  }
+
+  /* Non-blocking while draining: a queued peer may reset first */
+  int flags = fcntl(fd, F_GETFL, 0);
+  if ((flags < 0) || (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)) {
+    return;
+  }
+  for (;;) {
+    int c = PAL_ACCEPT(fd, NULL, NULL);
+    if (c < 0) {
+      break;
+    }
+    PAL_CLOSE(c);
+  }
+  (void)fcntl(fd, F_SETFL, flags);
+}
+
+/*===========================================================================*
+ * POOL
+ *===========================================================================*/
+
+ftp_pasv_pool_t *ftp_pasv_pool_create(uint32_t slots, uint16_t port_min,
+                                      uint16_t port_max) {
+  if ((slots == 0U) || ((port_min != 0U) && (port_max < port_min))) {
+    return NULL;
+  }
+
+  ftp_pasv_pool_t *pool = calloc(1U, sizeof(*pool));
+  if (pool == NULL) {
+    return NULL;
+  }
+  pool->slots = calloc((size_t)slots, sizeof(pool->slots[0]));
+  if ((pool->slots == NULL) || (pthread_mutex_init(&pool->lock, NULL) != 0)) {
+    free(pool->slots);
+    free(pool);
+    return NULL;
+  }
+  for (uint32_t i = 0U; i < slots; i++) {
+    pool->slots[i].fd = -1;
+  }
+  pool->count = slots;
+  pool->port_min = port_min;
+  pool->port_max = port_max;
+  return pool;
+}
+
+void ftp_pasv_pool_destroy(ftp_pasv_pool_t *pool) {
+  if (pool == NULL) {
+    return;
+  }
+  for (uint32_t i = 0U; i < pool->count; i++) {
+    if (pool->slots[i].fd >= 0) {
+      PAL_CLOSE(pool->slots[i].fd);
+    }
+  }
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->slots);
+  free(pool);
+}
+
+int ftp_pasv_pool_lease(ftp_pasv_pool_t *pool, uint32_t ip,
+                        uint16_t *port_out) {
+  if (pool == NULL) {
+    return ftp_pasv_listen(ip, 0U, 0U, port_out);
+  }
+
+  pasv_slot_t *hit = NULL;
+  pasv_slot_t *open = NULL;  /* FREE slot, or IDLE on another address */
+  int stale = -1;
+
+  pthread_mutex_lock(&pool->lock);
+  for (uint32_t i = 0U; i < pool->count; i++) {
+    pasv_slot_t *s = &pool->slots[i];
+    if (s->leased != 0U) {
+      continue;
+    }
+    if ((s->fd >= 0) && (s->ip == ip)) {
+      hit = s;
+      break;
+    }
+    if ((open == NULL) || ((open->fd >= 0) && (s->fd < 0))) {
+      open = s;
+    }
+  }
+  if (hit != NULL) {
+    hit->leased = 1U;
+    pool->reused++;
+  } else if (open != NULL) {
+    open->leased = 1U;
+    stale = open->fd;
+    open->fd = -1;
+  } else {
+    pool->spilled++;
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  if (hit != NULL) {
+    pasv_drain(hit->fd);
+    if (port_out != NULL) {
+      struct sockaddr_in local;
+      socklen_t len = (socklen_t)sizeof(local);
+      if (PAL_GETSOCKNAME(hit->fd, (struct sockaddr *)&local, &len) == 0) {
+        *port_out = PAL_NTOHS(local.sin_port);
+      }
+    }
+    return hit->fd;
+  }
+
+  if (stale >= 0) {
+    PAL_CLOSE(stale);
+  }
+
+  int fd = ftp_pasv_listen(ip, pool->port_min, pool->port_max, port_out);
+  if (open == NULL) {
+    return fd; /* spilled: not tracked, closed on return */
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  if (fd >= 0) {
+    open->fd = fd;
+    open->ip = ip;
+    pool->created++;
+  } else {
+    open->leased = 0U;
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return fd;
+}
+
+void ftp_pasv_pool_return(ftp_pasv_pool_t *pool, int fd) {
+  if (fd < 0) {
+    return;
+  }
+
+  pasv_slot_t *own = NULL;
+  if (pool != NULL) {
+    pthread_mutex_lock(&pool->lock);
+    for (uint32_t i = 0U; i < pool->count; i++) {
+      if ((pool->slots[i].fd == fd) && (pool->slots[i].leased != 0U)) {
+        own = &pool->slots[i];
+        break;
+      }
+    }
+    pthread_mutex_unlock(&pool->lock);
+  }
+
+  if (own == NULL) {
+    PAL_CLOSE(fd);
+    return;
+  }
+
+  /* Still leased while draining: nobody else can pick it up */
+  pasv_drain(fd);
+  pthread_mutex_lock(&pool->lock);
+  own->leased = 0U;
+  pthread_mutex_unlock(&pool->lock);
+}
+
+uint32_t ftp_pasv_pool_detach_idle(ftp_pasv_pool_t *pool, int *fds,
+                                   uint32_t max) {
+  uint32_t n = 0U;
+  if ((pool == NULL) || (fds == NULL)) {
+    return 0U;
+  }
+  pthread_mutex_lock(&pool->lock);
+  for (uint32_t i = 0U; (i < pool->count) && (n < max); i++) {
+    pasv_slot_t *s = &pool->slots[i];
+    if ((s->leased == 0U) && (s->fd >= 0)) {
+      fds[n++] = s->fd;
+      s->fd = -1;
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return n;
+}
+
+int ftp_pasv_pool_adopt(ftp_pasv_pool_t *pool, int fd) {
+  struct sockaddr_in local;
+  socklen_t len = (socklen_t)sizeof(local);
+  if ((pool == NULL) || (fd < 0) ||
+      (PAL_GETSOCKNAME(fd, (struct sockaddr *)&local, &len) < 0) ||
+      (local.sin_family != AF_INET)) {
+    return -1;
+  }
+  uint16_t port = PAL_NTOHS(local.sin_port);
+  if ((pool->port_min != 0U) &&
+      ((port < pool->port_min) || (port > pool->port_max))) {
+    return -1; /* outside this process's passive range */
+  }
+
+  int rc = -1;
+  pthread_mutex_lock(&pool->lock);
+  for (uint32_t i = 0U; i < pool->count; i++) {
+    pasv_slot_t *s = &pool->slots[i];
+    if ((s->leased == 0U) && (s->fd < 0)) {
+      s->fd = fd;
+      s->ip = PAL_NTOHL(local.sin_addr.s_addr);
+      rc = 0;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return rc;
+}
+
+void ftp_pasv_pool_get_stats(ftp_pasv_pool_t *pool,
+                             ftp_pasv_pool_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  if (pool == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&pool->lock);
+  out->slots = pool->count;
+  for (uint32_t i = 0U; i < pool->count; i++) {
+    if (pool->slots[i].leased != 0U) {
+      out->leased++;
+    } else if (pool->slots[i].fd >= 0) {
+      out->idle++;
+    }
+  }
+  out->created = pool->created;
+  out->reused = pool->reused;
+  out->spilled = pool->spilled;
+  pthread_mutex_unlock(&pool->lock);
+}
@@ -33,11 +33,18 @@ SOFTWARE.
  */
 
 #include "ftp_path.h"
+#include "ftp_stat_cache.h"
 #include "pal_fileio.h"
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 /* Maximum number of path components (for stack allocation) */
 #define MAX_PATH_COMPONENTS 128U
@@ -176,6 +183,146 @@ ftp_error_t ftp_path_normalize(const char *path,
  * PATH RESOLUTION
  *===========================================================================*/
 
+/*
+ * Namespace generation: bumped by ftp_path_cache_invalidate(), starts
+ * at 1 so a zeroed cache entry never matches.
+ */
+static atomic_uint g_path_gen = ATOMIC_VAR_INIT(1U);
+
+static uint32_t path_gen(void)
+{
+    return (uint32_t)atomic_load_explicit(&g_path_gen, memory_order_acquire);
+}
+
+#if FTP_PATH_CACHE_ENTRIES > 0
+static uint64_t path_now_ms(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return 0U;
+    }
+    return ((uint64_t)ts.tv_sec * 1000U) + ((uint64_t)ts.tv_nsec / 1000000U);
+}
+
+static int path_cache_lookup(const ftp_session_paths_t *p, const char *path,
+                             size_t path_len, char *output, size_t size)
+{
+    uint32_t gen = path_gen();
+    uint64_t now = 0U;
+    for (size_t i = 0U; i < (size_t)FTP_PATH_CACHE_ENTRIES; i++) {
+        const ftp_path_cache_entry_t *e = &p->cache[i];
+        if ((e->ns_gen != gen) || (e->key_len != path_len) ||
+            (memcmp(e->key, path, path_len) != 0)) {
+            continue;
+        }
+        if (now == 0U) {
+            now = path_now_ms();
+        }
+        if ((now - e->stamp_ms) >= (uint64_t)FTP_PATH_CACHE_TTL_MS) {
+            return 0;
+        }
+        size_t n = strlen(e->resolved);
+        if ((n + 1U) > size) {
+            return 0;
+        }
+        memcpy(output, e->resolved, n + 1U);
+        return 1;
+    }
+    return 0;
+}
+
+static void path_cache_store(ftp_session_paths_t *p, uint32_t gen, const char *path,
+                             size_t path_len, const char *resolved)
+{
+    size_t n = strlen(resolved);
+    if ((path_len >= (size_t)FTP_PATH_CACHE_KEY_MAX) || (n >= sizeof(p->cache[0].resolved))) {
+        return;
+    }
+    ftp_path_cache_entry_t *e = &p->cache[p->cache_next % FTP_PATH_CACHE_ENTRIES];
+    p->cache_next++;
+    e->stamp_ms = path_now_ms();
+    e->ns_gen = gen;
+    e->key_len = (uint32_t)path_len;
+    memcpy(e->key, path, path_len);
+    memcpy(e->resolved, resolved, n + 1U);
+}
+#endif
+
+/*
+ * Single component under the cwd: the cwd is already canonical and
+ * within root, so cwd + "/" + name is final unless name is a symlink.
+ * One fstatat() on the held cwd fd replaces the stat and realpath()
+ * walk of the general path, and its result seeds the shared stat cache
+ * for the SIZE / MDTM / RETR that usually follow.  Returns 0 when the
+ * general path must run.
+ */
+static int resolve_in_cwd(const ftp_session_t *session, ftp_session_paths_t *p,
+                          const char *path, size_t path_len, char *output, size_t size)
+{
+    if ((path_len == 0U) || (strchr(path, '/') != NULL) || (strcmp(path, ".") == 0) ||
+        (strcmp(path, "..") == 0)) {
+        return 0;
+    }
+
+    size_t cwd_len = strlen(session->cwd);
+    if ((cwd_len == 0U) || (session->cwd[0] != '/')) {
+        return 0;
+    }
+    if (session->cwd[cwd_len - 1U] == '/') {
+        cwd_len--; /* "/" */
+    }
+    if ((cwd_len + path_len + 2U) > size) {
+        return 0;
+    }
+
+    uint32_t gen = path_gen();
+    if ((p->cwd_fd >= 0) && (p->cwd_fd_gen != gen)) {
+        (void)close(p->cwd_fd); /* something was renamed or removed */
+        p->cwd_fd = -1;
+    }
+    if (p->cwd_fd < 0) {
+        int flags = O_RDONLY | O_CLOEXEC;
+#ifdef O_DIRECTORY
+        flags |= O_DIRECTORY;
+#endif
+        p->cwd_fd = open(session->cwd, flags);
+        if (p->cwd_fd < 0) {
+            return 0;
+        }
+        p->cwd_fd_gen = gen;
+    }
+
+    uint32_t stat_gen = ftp_stat_cache_generation();
+    struct stat st;
+    int found = 0;
+    if (fstatat(p->cwd_fd, path, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+        if (S_ISLNK(st.st_mode)) {
+            return 0;
+        }
+        found = 1;
+    } else if (errno != ENOENT) {
+        return 0;
+    }
+
+    memcpy(output, session->cwd, cwd_len);
+    output[cwd_len] = '/';
+    memcpy(output + cwd_len + 1U, path, path_len + 1U);
+    if (ftp_path_is_within_root(output, session->root_path) != 1) {
+        return 0;
+    }
+    if ((found != 0) && (vfs_is_image_path(output) == 0)) {
+        vfs_stat_t vst;
+        vst.mode = (uint32_t)st.st_mode;
+        vst.size = (uint64_t)st.st_size;
+        vst.mtime = (int64_t)st.st_mtime;
+        ftp_stat_cache_store(output, &vst, stat_gen);
+    }
+    return 1;
+}
+
+static ftp_error_t resolve_full(const ftp_session_t *session, const char *path,
+                                size_t path_len, char *output, size_t size);
+
 /**
  * @brief Resolve path relative to session CWD
  */
@@ -198,7 +345,37 @@ ftp_error_t ftp_path_resolve(const ftp_session_t *session,
     if (path_len >= FTP_PATH_MAX) {
         return FTP_ERR_PATH_TOO_LONG;
     }
-    
+
+    /* Sessions built without a paths block (tests) take the full path */
+    ftp_session_paths_t *p = session->paths;
+    if (p == NULL) {
+        return resolve_full(session, path, path_len, output, size);
+    }
+
+#if FTP_PATH_CACHE_ENTRIES > 0
+    if (path_cache_lookup(p, path, path_len, output, size) != 0) {
+        return FTP_OK;
+    }
+    uint32_t gen = path_gen();
+#endif
+
+    ftp_error_t err = FTP_OK;
+    if (resolve_in_cwd(session, p, path, path_len, output, size) == 0) {
+        err = resolve_full(session, path, path_len, output, size);
+    }
+
+#if FTP_PATH_CACHE_ENTRIES > 0
+    if (err == FTP_OK) {
+        path_cache_store(p, gen, path, path_len, output);
+    }
+#endif
+    return err;
+}
+
+/* Join with the cwd, normalize, then canonicalize through realpath() */
+static ftp_error_t resolve_full(const ftp_session_t *session, const char *path,
+                                size_t path_len, char *output, size_t size)
+{
     char temp[FTP_PATH_MAX];
     
     if ((path_len > 0U) && (path[0] == '/')) {
@@ -281,6 +458,58 @@ ftp_error_t ftp_path_resolve(const ftp_session_t *session,
     return FTP_OK;
 }
 
+/*===========================================================================*
+ * SESSION CWD AND RESOLUTION CACHE
+ *===========================================================================*/
+
+void ftp_path_cache_init(ftp_session_paths_t *paths)
+{
+    if (paths == NULL) {
+        return;
+    }
+    paths->cwd_fd = -1;
+    paths->cwd_fd_gen = 0U;
+#if FTP_PATH_CACHE_ENTRIES > 0
+    paths->cache_next = 0U;
+    for (size_t i = 0U; i < (size_t)FTP_PATH_CACHE_ENTRIES; i++) {
+        paths->cache[i].ns_gen = 0U;
+    }
+#endif
+}
+
+void ftp_path_cache_release(ftp_session_paths_t *paths)
+{
+    if (paths == NULL) {
+        return;
+    }
+    if (paths->cwd_fd >= 0) {
+        (void)close(paths->cwd_fd);
+    }
+    ftp_path_cache_init(paths);
+}
+
+void ftp_path_cache_invalidate(void)
+{
+    unsigned prev = atomic_fetch_add_explicit(&g_path_gen, 1U, memory_order_acq_rel);
+    if ((prev + 1U) == 0U) {
+        atomic_fetch_add_explicit(&g_path_gen, 1U, memory_order_acq_rel);
+    }
+}
+
+ftp_error_t ftp_path_set_cwd(ftp_session_t *session, const char *resolved)
+{
+    if ((session == NULL) || (resolved == NULL)) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    size_t len = strlen(resolved);
+    if (len >= FTP_PATH_MAX) {
+        return FTP_ERR_PATH_TOO_LONG;
+    }
+    memcpy(session->cwd, resolved, len + 1U);
+    ftp_path_cache_release(session->paths);
+    return FTP_OK;
+}
+
 /*===========================================================================*
  * PATH SECURITY CHECKS
  *===========================================================================*/
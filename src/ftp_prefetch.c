@@ -0,0 +1,556 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_prefetch.c
+ * @brief Predictive prefetch for mirror-style sequential downloads
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * One worker, one FIFO of jobs.  A job carries its own copy of the path
+ * and the generation of its session tracker; bumping the generation is
+ * all a cancel does to queued and running jobs.  Budget and slots are
+ * only touched by the session thread, under g_lock.
+ */
+
+#include "ftp_prefetch.h"
+#include "ftp_buffer_pool.h"
+#include "ftp_config.h"
+#include "ftp_list.h"
+#include "ftp_metrics.h"
+#include "pal_fileio.h"
+#include "pal_thread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define PF_ORDER_LISTING 0
+#define PF_ORDER_NAME 1
+#define PF_ORDERS 2
+
+#define PF_NONE UINT32_MAX
+
+/* Queued jobs, all sessions */
+#define PF_QUEUE (FTP_PREFETCH_FILES * 8U)
+
+/* Read size when the head is read rather than advised */
+#define PF_READ_CHUNK (256U * 1024U)
+
+typedef struct {
+  uint32_t idx;   /* listing index, PF_NONE = free */
+  uint64_t bytes; /* budget held */
+} pf_slot_t;
+
+struct ftp_prefetch {
+  unsigned refs;   /* session + queued/running jobs, under g_lock */
+  atomic_uint gen; /* bumped by every cancel                      */
+  uint32_t count;
+  char *names;          /* NUL-terminated, listing order */
+  uint32_t *name_off;   /* per listing index             */
+  uint64_t *size;       /* per listing index             */
+  uint32_t *by_name;    /* listing indices in strcmp order */
+  uint32_t *name_rank;  /* inverse of by_name            */
+  uint32_t last[PF_ORDERS];   /* position of the last RETR, PF_NONE */
+  uint32_t streak[PF_ORDERS]; /* RETRs in a row in that order       */
+  pf_slot_t slot[FTP_PREFETCH_FILES];
+  size_t dir_len;
+  char dir[FTP_PATH_MAX];
+};
+
+typedef struct {
+  struct ftp_prefetch *track;
+  unsigned gen;
+  uint64_t bytes;
+  char path[FTP_PATH_MAX];
+} pf_job_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_idle_cv = PTHREAD_COND_INITIALIZER;
+
+static pf_job_t g_queue[PF_QUEUE];
+static size_t g_head = 0U;
+static size_t g_len = 0U;
+static int g_running = 0; /* the worker holds a job */
+static uint64_t g_budget = 0U;
+
+static pthread_t g_worker;
+static int g_started = 0;
+static int g_stop = 0;
+
+/*===========================================================================*
+ * TRACKER
+ *===========================================================================*/
+
+static void track_unref_locked(struct ftp_prefetch *t) {
+  if (--t->refs == 0U) {
+    free(t->names);
+    free(t->name_off);
+    free(t->size);
+    free(t->by_name);
+    free(t->name_rank);
+    free(t);
+  }
+}
+
+/* Return the budget of every slot; queued and running jobs go stale */
+static void track_cancel_locked(struct ftp_prefetch *t) {
+  uint64_t dropped = 0U;
+  for (unsigned k = 0U; k < FTP_PREFETCH_FILES; k++) {
+    if (t->slot[k].idx != PF_NONE) {
+      g_budget -= t->slot[k].bytes;
+      t->slot[k].idx = PF_NONE;
+      t->slot[k].bytes = 0U;
+      dropped++;
+    }
+  }
+  atomic_fetch_add(&t->gen, 1U);
+  if (dropped > 0U) {
+    ftp_metrics_add(FTP_METRIC_PREFETCH_CANCELLED, dropped);
+  }
+}
+
+static void track_reset_listing(struct ftp_prefetch *t) {
+  free(t->names);
+  free(t->name_off);
+  free(t->size);
+  free(t->by_name);
+  free(t->name_rank);
+  t->names = NULL;
+  t->name_off = NULL;
+  t->size = NULL;
+  t->by_name = NULL;
+  t->name_rank = NULL;
+  t->count = 0U;
+  t->dir_len = 0U;
+  t->dir[0] = '\0';
+  for (unsigned o = 0U; o < PF_ORDERS; o++) {
+    t->last[o] = PF_NONE;
+    t->streak[o] = 0U;
+  }
+}
+
+typedef struct {
+  const char *name;
+  uint32_t idx;
+} pf_sort_t;
+
+static int sort_by_name(const void *a, const void *b) {
+  return strcmp(((const pf_sort_t *)a)->name, ((const pf_sort_t *)b)->name);
+}
+
+/* Regular, non-empty files of @p snap; 0 or -1 (no memory) */
+static int track_load(struct ftp_prefetch *t, const ftp_list_snapshot_t *snap) {
+  size_t bytes = 0U;
+  uint32_t n = 0U;
+  for (size_t i = 0U; i < snap->count; i++) {
+    const vfs_stat_t *st = ftp_list_snapshot_stat(snap, i);
+    if (((st->mode & (uint32_t)S_IFMT) == (uint32_t)S_IFREG) &&
+        (st->size > 0U)) {
+      bytes += strlen(ftp_list_snapshot_name(snap, i)) + 1U;
+      n++;
+    }
+  }
+  if (n < FTP_PREFETCH_TRIGGER) {
+    return 0; /* nothing to follow */
+  }
+
+  t->names = malloc(bytes);
+  t->name_off = malloc(n * sizeof(*t->name_off));
+  t->size = malloc(n * sizeof(*t->size));
+  t->by_name = malloc(n * sizeof(*t->by_name));
+  t->name_rank = malloc(n * sizeof(*t->name_rank));
+  pf_sort_t *sorted = malloc(n * sizeof(*sorted));
+  if ((t->names == NULL) || (t->name_off == NULL) || (t->size == NULL) ||
+      (t->by_name == NULL) || (t->name_rank == NULL) || (sorted == NULL)) {
+    free(sorted);
+    track_reset_listing(t);
+    return -1;
+  }
+
+  size_t off = 0U;
+  uint32_t k = 0U;
+  for (size_t i = 0U; i < snap->count; i++) {
+    const vfs_stat_t *st = ftp_list_snapshot_stat(snap, i);
+    if (((st->mode & (uint32_t)S_IFMT) != (uint32_t)S_IFREG) ||
+        (st->size == 0U)) {
+      continue;
+    }
+    const char *name = ftp_list_snapshot_name(snap, i);
+    size_t len = strlen(name) + 1U;
+    memcpy(t->names + off, name, len);
+    t->name_off[k] = (uint32_t)off;
+    t->size[k] = st->size;
+    sorted[k].name = t->names + off;
+    sorted[k].idx = k;
+    off += len;
+    k++;
+  }
+  qsort(sorted, n, sizeof(*sorted), sort_by_name);
+  for (uint32_t r = 0U; r < n; r++) {
+    t->by_name[r] = sorted[r].idx;
+    t->name_rank[sorted[r].idx] = r;
+  }
+  free(sorted);
+  t->count = n;
+  return 0;
+}
+
+/* Listing index of position @p pos in order @p o */
+static uint32_t order_index(const struct ftp_prefetch *t, unsigned o,
+                            uint32_t pos) {
+  return (o == PF_ORDER_LISTING) ? pos : t->by_name[pos];
+}
+
+static uint32_t order_pos(const struct ftp_prefetch *t, unsigned o,
+                          uint32_t idx) {
+  return (o == PF_ORDER_LISTING) ? idx : t->name_rank[idx];
+}
+
+/*===========================================================================*
+ * WORKER
+ *===========================================================================*/
+
+static int job_stale(const pf_job_t *job) {
+  return (atomic_load(&job->track->gen) != job->gen) ? 1 : 0;
+}
+
+/* Bring the head of the file into the page cache; bytes warmed */
+static uint64_t job_fetch(const pf_job_t *job) {
+  int fd = open(job->path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return 0U;
+  }
+  struct stat st;
+  uint64_t len = 0U;
+  if ((fstat(fd, &st) == 0) && S_ISREG(st.st_mode)) {
+    len = ((uint64_t)st.st_size < job->bytes) ? (uint64_t)st.st_size
+                                              : job->bytes;
+  }
+  if ((len == 0U) || (pal_io_prefetch(fd, 0, (off_t)len) == FTP_OK)) {
+    (void)close(fd);
+    return len;
+  }
+
+  /* No fadvise: read it, a chunk at a time, while still wanted */
+  size_t cap = 0U;
+  void *buf = ftp_buffer_acquire_size(PF_READ_CHUNK, &cap);
+  uint64_t done = 0U;
+  while ((buf != NULL) && (done < len) && (job_stale(job) == 0)) {
+    size_t want = ((len - done) < (uint64_t)cap) ? (size_t)(len - done) : cap;
+    ssize_t n = pread(fd, buf, want, (off_t)done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (n == 0) {
+      break;
+    }
+    done += (uint64_t)n;
+  }
+  if (buf != NULL) {
+    ftp_buffer_release(buf);
+  }
+  (void)close(fd);
+  return done;
+}
+
+static void *worker_main(void *arg) {
+  (void)arg;
+  static pf_job_t job; /* one worker: keeps FTP_PATH_MAX off its stack */
+  pthread_mutex_lock(&g_lock);
+  for (;;) {
+    while ((g_len == 0U) && (g_stop == 0)) {
+      pthread_cond_wait(&g_work_cv, &g_lock);
+    }
+    if (g_stop != 0) {
+      break;
+    }
+    job = g_queue[g_head];
+    g_head = (g_head + 1U) % PF_QUEUE;
+    g_len--;
+    g_running = 1;
+    pthread_mutex_unlock(&g_lock);
+
+    if (job_stale(&job) == 0) {
+      uint64_t warmed = job_fetch(&job);
+      if (warmed > 0U) {
+        ftp_metrics_add(FTP_METRIC_PREFETCH_FILES, 1U);
+        ftp_metrics_add(FTP_METRIC_PREFETCH_BYTES, warmed);
+      }
+    }
+
+    pthread_mutex_lock(&g_lock);
+    g_running = 0;
+    track_unref_locked(job.track);
+    if (g_len == 0U) {
+      pthread_cond_broadcast(&g_idle_cv);
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+  return NULL;
+}
+
+static int start_locked(void) {
+  if (g_started != 0) {
+    return 0;
+  }
+  g_stop = 0;
+  if (pal_thread_create(&g_worker, NULL, PAL_THREAD_DATA, worker_main,
+                        NULL) != 0) {
+    return -1;
+  }
+  g_started = 1;
+  return 0;
+}
+
+/* Queue listing index @p idx; 0, or -1 when full / over budget */
+static int queue_locked(struct ftp_prefetch *t, uint32_t idx) {
+  unsigned k = 0U;
+  while ((k < FTP_PREFETCH_FILES) && (t->slot[k].idx != PF_NONE)) {
+    k++;
+  }
+  uint64_t cap = (uint64_t)FTP_PREFETCH_FILE_MB * 1024U * 1024U;
+  uint64_t bytes = (t->size[idx] < cap) ? t->size[idx] : cap;
+  const char *name = t->names + t->name_off[idx];
+  size_t name_len = strlen(name);
+  if ((k == FTP_PREFETCH_FILES) || (g_len == PF_QUEUE) ||
+      (g_budget + bytes > (uint64_t)FTP_PREFETCH_BUDGET_MB * 1024U * 1024U) ||
+      (t->dir_len + 1U + name_len >= FTP_PATH_MAX) || (start_locked() != 0)) {
+    return -1;
+  }
+
+  pf_job_t *job = &g_queue[(g_head + g_len) % PF_QUEUE];
+  job->track = t;
+  job->gen = atomic_load(&t->gen);
+  job->bytes = bytes;
+  memcpy(job->path, t->dir, t->dir_len);
+  size_t at = t->dir_len;
+  if ((at == 0U) || (t->dir[at - 1U] != '/')) {
+    job->path[at++] = '/';
+  }
+  memcpy(job->path + at, name, name_len + 1U);
+  g_len++;
+  t->refs++;
+  t->slot[k].idx = idx;
+  t->slot[k].bytes = bytes;
+  g_budget += bytes;
+  pthread_cond_signal(&g_work_cv);
+  return 0;
+}
+
+/*===========================================================================*
+ * PUBLIC API
+ *===========================================================================*/
+
+void ftp_prefetch_listing(ftp_session_t *session, const char *dir) {
+  if ((FTP_PREFETCH_ENABLE == 0) || (session == NULL) || (dir == NULL) ||
+      (vfs_is_image_path(dir) != 0)) {
+    return;
+  }
+  size_t dir_len = strlen(dir);
+  while ((dir_len > 1U) && (dir[dir_len - 1U] == '/')) {
+    dir_len--;
+  }
+  if (dir_len >= FTP_PATH_MAX) {
+    return;
+  }
+
+  struct ftp_prefetch *t = session->prefetch;
+  if (t == NULL) {
+    t = calloc(1U, sizeof(*t));
+    if (t == NULL) {
+      return;
+    }
+    t->refs = 1U;
+    for (unsigned k = 0U; k < FTP_PREFETCH_FILES; k++) {
+      t->slot[k].idx = PF_NONE;
+    }
+    session->prefetch = t;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  track_cancel_locked(t);
+  pthread_mutex_unlock(&g_lock);
+  track_reset_listing(t);
+
+  ftp_list_snapshot_t snap;
+  if (ftp_list_snapshot(dir, &snap) != FTP_OK) {
+    return;
+  }
+  if ((snap.count <= (size_t)FTP_PREFETCH_LIST_MAX) &&
+      (track_load(t, &snap) == 0) && (t->count > 0U)) {
+    memcpy(t->dir, dir, dir_len);
+    t->dir[dir_len] = '\0';
+    t->dir_len = dir_len;
+  }
+  ftp_list_snapshot_release(&snap);
+}
+
+void ftp_prefetch_retr(ftp_session_t *session, const char *path) {
+  struct ftp_prefetch *t = (session != NULL) ? session->prefetch : NULL;
+  if ((t == NULL) || (path == NULL) || (t->count == 0U)) {
+    return;
+  }
+
+  /* Listing index of the file, PF_NONE when it is not in the listing */
+  uint32_t idx = PF_NONE;
+  const char *slash = strrchr(path, '/');
+  size_t parent = (slash != NULL) ? (size_t)(slash - path) : 0U;
+  if (parent == 0U) {
+    parent = 1U; /* "/a" lives in "/" */
+  }
+  if ((slash != NULL) && (parent == t->dir_len) &&
+      (memcmp(path, t->dir, parent) == 0)) {
+    for (uint32_t i = 0U; i < t->count; i++) {
+      if (strcmp(t->names + t->name_off[i], slash + 1) == 0) {
+        idx = i;
+        break;
+      }
+    }
+  }
+
+  unsigned active = PF_ORDERS;
+  for (unsigned o = 0U; o < PF_ORDERS; o++) {
+    if (idx == PF_NONE) {
+      t->last[o] = PF_NONE;
+      t->streak[o] = 0U;
+      continue;
+    }
+    uint32_t pos = order_pos(t, o, idx);
+    int next = (t->last[o] != PF_NONE) && (pos == t->last[o] + 1U);
+    t->streak[o] = (next != 0) ? (t->streak[o] + 1U) : 1U;
+    t->last[o] = pos;
+    /* Longest run wins: sorted names also line up now and then in
+     * readdir order */
+    if ((t->streak[o] >= FTP_PREFETCH_TRIGGER) &&
+        ((active == PF_ORDERS) || (t->streak[o] > t->streak[active]))) {
+      active = o;
+    }
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (active == PF_ORDERS) {
+    track_cancel_locked(t); /* no order (any more): drop the guesses */
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+
+  /* This file was predicted: its budget is spent.  Anything else held
+   * lies behind it, or off the order: give it back */
+  uint32_t pos = t->last[active];
+  uint64_t dropped = 0U;
+  for (unsigned k = 0U; k < FTP_PREFETCH_FILES; k++) {
+    uint32_t held = t->slot[k].idx;
+    if (held == PF_NONE) {
+      continue;
+    }
+    uint32_t hpos = order_pos(t, active, held);
+    if ((held == idx) || (hpos <= pos) ||
+        (hpos > pos + FTP_PREFETCH_FILES)) {
+      if (held == idx) {
+        ftp_metrics_add(FTP_METRIC_PREFETCH_HITS, 1U);
+      } else {
+        dropped++;
+      }
+      g_budget -= t->slot[k].bytes;
+      t->slot[k].idx = PF_NONE;
+      t->slot[k].bytes = 0U;
+    }
+  }
+  if (dropped > 0U) {
+    ftp_metrics_add(FTP_METRIC_PREFETCH_CANCELLED, dropped);
+  }
+
+  for (uint32_t q = pos + 1U;
+       (q <= pos + FTP_PREFETCH_FILES) && (q < t->count); q++) {
+    uint32_t next = order_index(t, active, q);
+    int held = 0;
+    for (unsigned k = 0U; k < FTP_PREFETCH_FILES; k++) {
+      held |= (t->slot[k].idx == next) ? 1 : 0;
+    }
+    if ((held == 0) && (queue_locked(t, next) != 0)) {
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_prefetch_session_end(ftp_session_t *session) {
+  if ((session == NULL) || (session->prefetch == NULL)) {
+    return;
+  }
+  struct ftp_prefetch *t = session->prefetch;
+  session->prefetch = NULL;
+  pthread_mutex_lock(&g_lock);
+  track_cancel_locked(t);
+  track_unref_locked(t);
+  pthread_mutex_unlock(&g_lock);
+}
+
+uint64_t ftp_prefetch_budget_used(void) {
+  pthread_mutex_lock(&g_lock);
+  uint64_t used = g_budget;
+  pthread_mutex_unlock(&g_lock);
+  return used;
+}
+
+void ftp_prefetch_quiesce(void) {
+  pthread_mutex_lock(&g_lock);
+  while ((g_started != 0) && ((g_len > 0U) || (g_running != 0))) {
+    pthread_cond_wait(&g_idle_cv, &g_lock);
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_prefetch_shutdown(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_started == 0) {
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+  g_stop = 1;
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_mutex_unlock(&g_lock);
+  (void)pthread_join(g_worker, NULL);
+
+  pthread_mutex_lock(&g_lock);
+  while (g_len > 0U) {
+    track_unref_locked(g_queue[g_head].track);
+    g_head = (g_head + 1U) % PF_QUEUE;
+    g_len--;
+  }
+  g_started = 0;
+  pthread_cond_broadcast(&g_idle_cv);
+  pthread_mutex_unlock(&g_lock);
+}
@@ -76,6 +76,7 @@ static const ftp_command_entry_t command_table[] = {
 #if FTP_ENABLE_REST
     {"REST", cmd_REST, FTP_ARGS_REQUIRED},
 #endif
+    {"ALLO", cmd_ALLO, FTP_ARGS_REQUIRED},
 
     /* File management */
     {"DELE", cmd_DELE, FTP_ARGS_REQUIRED},
@@ -105,6 +106,13 @@ static const ftp_command_entry_t command_table[] = {
 #endif
 #if FTP_ENABLE_MDTM
     {"MDTM", cmd_MDTM, FTP_ARGS_REQUIRED},
+#endif
+#if FTP_ENABLE_HASH
+    {"HASH", cmd_HASH, FTP_ARGS_REQUIRED},
+    {"XCRC", cmd_XCRC, FTP_ARGS_REQUIRED},
+    {"XMD5", cmd_XMD5, FTP_ARGS_REQUIRED},
+    {"XSHA1", cmd_XSHA1, FTP_ARGS_REQUIRED},
+    {"XSHA256", cmd_XSHA256, FTP_ARGS_REQUIRED},
 #endif
     {"STAT", cmd_STAT, FTP_ARGS_OPTIONAL},
     {"SYST", cmd_SYST, FTP_ARGS_NONE},
@@ -117,9 +125,13 @@ static const ftp_command_entry_t command_table[] = {
     {"STRU", cmd_STRU, FTP_ARGS_REQUIRED},
 
 /* Encryption */
-#if FTP_ENABLE_CRYPTO
+#if FTP_ENABLE_CRYPTO || FTP_ENABLE_TLS
     {"AUTH", cmd_AUTH, FTP_ARGS_REQUIRED},
 #endif
+#if FTP_ENABLE_TLS
+    {"PBSZ", cmd_PBSZ, FTP_ARGS_REQUIRED},
+    {"PROT", cmd_PROT, FTP_ARGS_REQUIRED},
+#endif
 };
 
 static const size_t command_table_size =
@@ -141,6 +153,8 @@ static const char *get_default_message(ftp_reply_code_t code) {
   /* 2xx - Positive Completion */
   case FTP_REPLY_200_OK:
     return "Command okay.";
+  case FTP_REPLY_202_SUPERFLUOUS:
+    return "Command not implemented, superfluous at this site.";
   case FTP_REPLY_211_SYSTEM_STATUS:
     return "System status.";
   case FTP_REPLY_214_HELP:
@@ -177,6 +191,8 @@ static const char *get_default_message(ftp_reply_code_t code) {
     return "Can't open data connection.";
   case FTP_REPLY_426_TRANSFER_ABORTED:
     return "Connection closed; transfer aborted.";
+  case FTP_REPLY_431_NEED_SECURITY:
+    return "Need some unavailable resource to process security.";
   case FTP_REPLY_450_FILE_UNAVAILABLE:
     return "Requested file action not taken.";
   case FTP_REPLY_451_LOCAL_ERROR:
@@ -193,6 +209,8 @@ static const char *get_default_message(ftp_reply_code_t code) {
     return "Bad sequence of commands.";
   case FTP_REPLY_530_NOT_LOGGED_IN:
     return "Not logged in.";
+  case FTP_REPLY_536_PROT_UNSUPPORTED:
+    return "Requested PROT level not supported by mechanism.";
   case FTP_REPLY_550_FILE_ERROR:
     return "Requested action not taken. File unavailable.";
   case FTP_REPLY_553_FILENAME_INVALID:
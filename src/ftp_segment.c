@@ -0,0 +1,450 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_segment.c
+ * @brief Server-wide table of files being transferred
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * A fixed table under one lock; entries are found by a linear scan (it
+ * holds one file per session at most).  The table only ever blocks for
+ * bookkeeping: opening, preallocating, trimming and closing the file
+ * happen outside the lock, with a reference held.
+ */
+
+#include "ftp_segment.h"
+#include "ftp_config.h"
+#include "ftp_metrics.h"
+#include "pal_fileio.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  const atomic_uint_fast64_t *ctr; /* session byte counter, NULL = free */
+  uint64_t base;                   /* its value when the stream joined  */
+} seg_holder_t;
+
+typedef struct {
+  char *path;       /* NULL = free entry */
+  char *write_path; /* STOR: temp or final name, for private fds */
+  int upload;
+  int opening; /* FIRST has not reported its open yet */
+  int fd;
+  int atomic;
+  int fresh;
+  int failed;
+  int direct;   /* a stream has the shared fd in O_DIRECT */
+  int reserved; /* fallocate succeeded                    */
+  uint64_t reserve_size;
+  off_t end; /* furthest offset any stream wrote up to */
+  uint32_t refs;
+  uint32_t peak;
+  uint64_t done; /* bytes of the streams that already left */
+  uint64_t size;
+  uint64_t start_ms;
+  seg_holder_t holder[FTP_SEGMENT_STREAMS];
+} seg_entry_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_open_cv = PTHREAD_COND_INITIALIZER;
+static seg_entry_t g_files[FTP_SEGMENT_FILES];
+
+static uint64_t now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000U) + ((uint64_t)ts.tv_nsec / 1000000U);
+}
+
+static void seg_reset(ftp_segment_t *seg) {
+  seg->slot = -1;
+  seg->holder = -1;
+  seg->fd = -1;
+  seg->own_fd = 0;
+  seg->atomic = 0;
+  seg->fresh = 0;
+  seg->reserved = 0;
+  seg->direct = 0;
+  seg->write_path[0] = '\0';
+}
+
+static int find_locked(const char *path, int upload) {
+  for (int i = 0; i < (int)FTP_SEGMENT_FILES; i++) {
+    const seg_entry_t *e = &g_files[i];
+    if ((e->path != NULL) && (e->upload == upload) &&
+        (strcmp(e->path, path) == 0)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/* Count one more stream on entry @p i */
+static void hold_locked(int i, ftp_session_t *session, ftp_segment_t *seg) {
+  seg_entry_t *e = &g_files[i];
+  e->refs++;
+  if (e->refs > e->peak) {
+    e->peak = e->refs;
+    if (e->peak == 2U) {
+      ftp_metrics_add(FTP_METRIC_SEGMENT_FILES, 1U);
+    }
+  }
+  seg->slot = i;
+  for (int h = 0; h < (int)FTP_SEGMENT_STREAMS; h++) {
+    if (e->holder[h].ctr == NULL) {
+      e->holder[h].ctr = (e->upload != 0) ? &session->stats.bytes_received
+                                          : &session->stats.bytes_sent;
+      e->holder[h].base = atomic_load(e->holder[h].ctr);
+      seg->holder = h;
+      break;
+    }
+  }
+}
+
+static int alloc_locked(const char *path, int upload, ftp_session_t *session,
+                        ftp_segment_t *seg) {
+  for (int i = 0; i < (int)FTP_SEGMENT_FILES; i++) {
+    seg_entry_t *e = &g_files[i];
+    if (e->path != NULL) {
+      continue;
+    }
+    e->path = strdup(path);
+    if (e->path == NULL) {
+      return -1;
+    }
+    e->upload = upload;
+    e->fd = -1;
+    e->end = -1;
+    e->start_ms = now_ms();
+    hold_locked(i, session, seg);
+    return i;
+  }
+  return -1;
+}
+
+/* Drop one stream; returns 1 when it was the last and the entry is free */
+static int release_locked(ftp_segment_t *seg) {
+  seg_entry_t *e = &g_files[seg->slot];
+  if (seg->holder >= 0) {
+    seg_holder_t *h = &e->holder[seg->holder];
+    e->done += atomic_load(h->ctr) - h->base;
+    h->ctr = NULL;
+  }
+  if (seg->direct != 0) {
+    e->direct = 0;
+    seg->direct = 0;
+  }
+  seg->slot = -1;
+  seg->holder = -1;
+  if (--e->refs > 0U) {
+    return 0;
+  }
+  free(e->path);
+  free(e->write_path);
+  memset(e, 0, sizeof(*e));
+  return 1;
+}
+
+/*===========================================================================*
+ * STOR
+ *===========================================================================*/
+
+ftp_segment_role_t ftp_segment_stor_begin(ftp_session_t *session,
+                                          const char *path,
+                                          ftp_segment_t *seg) {
+  seg_reset(seg);
+  if ((session == NULL) || (path == NULL)) {
+    return FTP_SEGMENT_ALONE;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  int i;
+  while (((i = find_locked(path, 1)) >= 0) && (g_files[i].opening != 0)) {
+    pthread_cond_wait(&g_open_cv, &g_lock);
+  }
+  if (i < 0) {
+    ftp_segment_role_t role = FTP_SEGMENT_ALONE;
+    if (alloc_locked(path, 1, session, seg) >= 0) {
+      g_files[seg->slot].opening = 1;
+      role = FTP_SEGMENT_FIRST;
+    }
+    pthread_mutex_unlock(&g_lock);
+    return role;
+  }
+
+  seg_entry_t *e = &g_files[i];
+  hold_locked(i, session, seg);
+  seg->fd = e->fd;
+  seg->atomic = e->atomic;
+  seg->fresh = e->fresh;
+  int private_fd = e->direct;
+  (void)snprintf(seg->write_path, sizeof(seg->write_path), "%s",
+                 (e->write_path != NULL) ? e->write_path : path);
+  pthread_mutex_unlock(&g_lock);
+  ftp_metrics_add(FTP_METRIC_SEGMENT_JOINS, 1U);
+
+  /* O_DIRECT is a property of the open file: keep this stream off it */
+  if (private_fd != 0) {
+    seg->fd = pal_file_open(seg->write_path, O_WRONLY, 0);
+    seg->own_fd = (seg->fd >= 0) ? 1 : 0;
+  }
+  return FTP_SEGMENT_JOINED;
+}
+
+void ftp_segment_stor_opened(ftp_segment_t *seg, int fd,
+                             const char *write_path, int atomic, int fresh) {
+  if ((seg == NULL) || (write_path == NULL)) {
+    return;
+  }
+  seg->fd = fd;
+  seg->atomic = atomic;
+  seg->fresh = fresh;
+  (void)snprintf(seg->write_path, sizeof(seg->write_path), "%s", write_path);
+  if (seg->slot < 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  seg_entry_t *e = &g_files[seg->slot];
+  e->opening = 0;
+  if (fd < 0) {
+    (void)release_locked(seg); /* nobody joined while it was opening */
+  } else {
+    e->fd = fd;
+    e->atomic = atomic;
+    e->fresh = fresh;
+    e->write_path = strdup(write_path);
+  }
+  pthread_cond_broadcast(&g_open_cv);
+  pthread_mutex_unlock(&g_lock);
+}
+
+ftp_error_t ftp_segment_reserve(ftp_segment_t *seg, uint64_t size) {
+  if ((seg == NULL) || (seg->fd < 0) || (size == 0U)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  if (seg->slot < 0) {
+    ftp_error_t err = pal_file_preallocate(seg->fd, (off_t)size);
+    seg->reserved = (err == FTP_OK) ? 1 : 0;
+    return err;
+  }
+
+  /* The largest announcement wins; smaller ones ride on it */
+  pthread_mutex_lock(&g_lock);
+  seg_entry_t *e = &g_files[seg->slot];
+  if (size <= e->reserve_size) {
+    pthread_mutex_unlock(&g_lock);
+    return FTP_OK;
+  }
+  e->reserve_size = size;
+  pthread_mutex_unlock(&g_lock);
+
+  ftp_error_t err = pal_file_preallocate(seg->fd, (off_t)size);
+  if (err == FTP_OK) {
+    pthread_mutex_lock(&g_lock);
+    g_files[seg->slot].reserved = 1;
+    pthread_mutex_unlock(&g_lock);
+  }
+  return err;
+}
+
+int ftp_segment_direct_begin(ftp_segment_t *seg) {
+  if ((seg == NULL) || (seg->own_fd != 0)) {
+    return 0;
+  }
+  if (seg->slot < 0) {
+    seg->direct = 1;
+    return 1;
+  }
+  pthread_mutex_lock(&g_lock);
+  seg_entry_t *e = &g_files[seg->slot];
+  if ((e->refs == 1U) && (e->direct == 0)) {
+    e->direct = 1;
+    seg->direct = 1;
+  }
+  pthread_mutex_unlock(&g_lock);
+  return seg->direct;
+}
+
+void ftp_segment_direct_end(ftp_segment_t *seg) {
+  if ((seg == NULL) || (seg->direct == 0)) {
+    return;
+  }
+  if (seg->slot >= 0) {
+    pthread_mutex_lock(&g_lock);
+    g_files[seg->slot].direct = 0;
+    pthread_mutex_unlock(&g_lock);
+  }
+  seg->direct = 0;
+}
+
+void ftp_segment_stor_end(ftp_segment_t *seg, int ok, off_t end,
+                          ftp_segment_end_t *res) {
+  res->fd = -1;
+  res->failed = (ok == 0) ? 1 : 0;
+  res->segmented = 0;
+  res->discard = 0;
+  res->rename = 0;
+  if (seg == NULL) {
+    return;
+  }
+
+  int fd = seg->fd;
+  int reserved = seg->reserved;
+  int fresh = seg->fresh;
+  int atomic = seg->atomic;
+  int last = 1;
+  if (seg->slot >= 0) {
+    pthread_mutex_lock(&g_lock);
+    seg_entry_t *e = &g_files[seg->slot];
+    if (ok == 0) {
+      e->failed = 1;
+    }
+    if (end > e->end) {
+      e->end = end;
+    }
+    fd = e->fd;
+    end = e->end;
+    reserved = e->reserved;
+    res->failed = e->failed;
+    res->segmented = (e->peak > 1U) ? 1 : 0;
+    last = release_locked(seg);
+    pthread_mutex_unlock(&g_lock);
+  }
+  if (seg->own_fd != 0) {
+    (void)pal_file_close(seg->fd);
+    seg->own_fd = 0;
+  }
+  seg->fd = -1;
+  seg->direct = 0;
+  if ((last == 0) || (fd < 0)) {
+    return;
+  }
+
+  /*
+   * Trim the ALLO tail; a fresh multi-stream file also ends where its
+   * furthest segment did.  A resumed one keeps its length: the segments
+   * sent again need not include the last one.
+   */
+  int grown = (reserved != 0) || ((res->segmented != 0) && (fresh != 0));
+  if ((end >= 0) && (grown != 0) &&
+      ((res->failed == 0) || (res->segmented != 0))) {
+    (void)pal_file_truncate(fd, end);
+  }
+  res->fd = fd;
+  res->discard =
+      ((res->failed != 0) && (res->segmented == 0) && (fresh != 0)) ? 1 : 0;
+  res->rename =
+      ((atomic != 0) && ((res->failed == 0) || (res->segmented != 0))) ? 1
+                                                                        : 0;
+}
+
+/*===========================================================================*
+ * RETR
+ *===========================================================================*/
+
+void ftp_segment_retr_begin(ftp_session_t *session, const char *path,
+                            uint64_t size, ftp_segment_t *seg) {
+  seg->slot = -1;
+  seg->holder = -1;
+  if ((session == NULL) || (path == NULL)) {
+    return;
+  }
+  pthread_mutex_lock(&g_lock);
+  int i = find_locked(path, 0);
+  if (i >= 0) {
+    hold_locked(i, session, seg);
+    ftp_metrics_add(FTP_METRIC_SEGMENT_JOINS, 1U);
+  } else {
+    i = alloc_locked(path, 0, session, seg);
+  }
+  if (i >= 0) {
+    g_files[i].size = size;
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+void ftp_segment_retr_end(ftp_segment_t *seg) {
+  if ((seg == NULL) || (seg->slot < 0)) {
+    return;
+  }
+  pthread_mutex_lock(&g_lock);
+  (void)release_locked(seg);
+  pthread_mutex_unlock(&g_lock);
+}
+
+/*===========================================================================*
+ * PROGRESS
+ *===========================================================================*/
+
+size_t ftp_segment_snapshot(ftp_segment_info_t *out, size_t max) {
+  if ((out == NULL) || (max == 0U)) {
+    return 0U;
+  }
+  uint64_t now = now_ms();
+  size_t n = 0U;
+
+  pthread_mutex_lock(&g_lock);
+  for (size_t i = 0U; (i < FTP_SEGMENT_FILES) && (n < max); i++) {
+    const seg_entry_t *e = &g_files[i];
+    if ((e->path == NULL) || (e->opening != 0)) {
+      continue;
+    }
+    ftp_segment_info_t info;
+    (void)snprintf(info.path, sizeof(info.path), "%s", e->path);
+    info.upload = e->upload;
+    info.streams = e->refs;
+    info.peak = e->peak;
+    info.bytes = e->done;
+    for (size_t h = 0U; h < FTP_SEGMENT_STREAMS; h++) {
+      if (e->holder[h].ctr != NULL) {
+        info.bytes += atomic_load(e->holder[h].ctr) - e->holder[h].base;
+      }
+    }
+    info.size = e->size;
+    if (e->upload != 0) {
+      uint64_t written = (e->end > 0) ? (uint64_t)e->end : 0U;
+      info.size = (e->reserve_size > written) ? e->reserve_size : written;
+    }
+    info.age_ms = now - e->start_ms;
+
+    /* Insertion sort: most streams first */
+    size_t k = n;
+    while ((k > 0U) && (out[k - 1U].streams < info.streams)) {
+      out[k] = out[k - 1U];
+      k--;
+    }
+    out[k] = info;
+    n++;
+  }
+  pthread_mutex_unlock(&g_lock);
+  return n;
+}
@@ -33,9 +33,16 @@ SOFTWARE.
  */
 
 #include "ftp_server.h"
+#include "ftp_engine.h"
+#include "ftp_pasv_pool.h"
 #include "ftp_session.h"
 #include "pal_network.h"
+#include "pal_thread.h"
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 #include <signal.h>
 
@@ -44,10 +51,176 @@ static void* server_accept_thread(void *arg);
 static ftp_session_t* allocate_session(ftp_server_context_t *ctx);
 static void free_session(ftp_server_context_t *ctx, ftp_session_t *session);
 
+/* Multi-acceptor state (see MULTI-ACCEPTOR below) */
+#define ACCEPTOR_POLL_MS 250
+
+typedef struct {
+    int fd;
+    struct sockaddr_in addr;
+    uint64_t accept_ns;
+} start_item_t;
+
+typedef struct {
+    struct ftp_acceptors *set;
+    int fd;
+    int started;
+    pthread_t tid;
+} acceptor_t;
+
+struct ftp_acceptors {
+    ftp_server_context_t *ctx;
+    uint32_t count;
+    acceptor_t a[FTP_ACCEPT_THREADS_MAX];
+
+    pthread_mutex_t lock;
+    pthread_cond_t cv;
+    start_item_t queue[FTP_ACCEPT_QUEUE];
+    uint32_t head;
+    uint32_t len;
+    uint32_t peak;
+    int stop;
+    int starter_started;
+    pthread_t starter;
+};
+
+static void server_start_session(ftp_server_context_t *ctx, int client_fd,
+                                 const struct sockaddr_in *client_addr,
+                                 uint64_t accept_ns);
+static ftp_error_t acceptors_start(ftp_server_context_t *ctx);
+static void acceptors_stop(ftp_server_context_t *ctx, int release);
+
+/* Monotonic clock for the accept-latency counters */
+static uint64_t server_now_ns(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+        return 0U;
+    }
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Open one control-port listener
+ *
+ * @param reuseport Set SO_REUSEPORT (acceptor threads share the port)
+ *
+ * @return Listening fd, or negative ftp_error_t
+ */
+static int listen_open(const struct sockaddr_in *addr, uint32_t backlog,
+                       int reuseport)
+{
+    int fd = PAL_SOCKET(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return FTP_ERR_SOCKET_CREATE;
+    }
+
+    /* Enable address reuse */
+    ftp_error_t err = pal_socket_set_reuseaddr(fd);
+    if (err != FTP_OK) {
+        PAL_CLOSE(fd);
+        return err;
+    }
+
+#if defined(SO_REUSEPORT)
+    if (reuseport != 0) {
+        int one = 1;
+        if (PAL_SETSOCKOPT(fd, SOL_SOCKET, SO_REUSEPORT, &one,
+                           sizeof(one)) != 0) {
+            PAL_CLOSE(fd);
+            return FTP_ERR_SOCKET_BIND;
+        }
+    }
+#else
+    (void)reuseport;
+#endif
+
+    if (PAL_BIND(fd, (const struct sockaddr*)addr, sizeof(*addr)) < 0) {
+        PAL_CLOSE(fd);
+        return FTP_ERR_SOCKET_BIND;
+    }
+
+    if (PAL_LISTEN(fd, (int)backlog) < 0) {
+        PAL_CLOSE(fd);
+        return FTP_ERR_SOCKET_LISTEN;
+    }
+
+    return fd;
+}
+
+/*
+ * accept() for the poll()ing accept loops.  Listeners handed over to or
+ * from another process are non-blocking (both processes poll them), and
+ * BSD accept() copies O_NONBLOCK to the new socket: sessions expect a
+ * blocking one.
+ */
+static int server_accept(int lfd, struct sockaddr_in *addr)
+{
+    socklen_t addr_len = sizeof(*addr);
+    int fd = PAL_ACCEPT(lfd, (struct sockaddr*)addr, &addr_len);
+#if !defined(__linux__)
+    if (fd >= 0) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        if ((flags >= 0) && ((flags & O_NONBLOCK) != 0)) {
+            (void)fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+        }
+    }
+#endif
+    return fd;
+}
+
 /*===========================================================================*
  * SERVER LIFECYCLE
  *===========================================================================*/
 
+/* Everything but the listener; on failure the caller closes its fds */
+static ftp_error_t server_init_state(ftp_server_context_t *ctx,
+                                     const char *root_path)
+{
+    /* Store root path */
+    size_t root_len = strlen(root_path);
+    if (root_len >= sizeof(ctx->root_path)) {
+        return FTP_ERR_PATH_TOO_LONG;
+    }
+    memcpy(ctx->root_path, root_path, root_len + 1U);
+    
+    /* Initialize server state */
+    atomic_store(&ctx->running, 0);
+    atomic_store(&ctx->accepting, 0);
+    atomic_store(&ctx->active_sessions, 0U);
+    ctx->event_engine = FTP_SESSION_ENGINE_EVENT;
+    ctx->engine = NULL;
+    ctx->acceptors = FTP_ACCEPT_THREADS;
+    atomic_store(&ctx->listen_backlog, (unsigned)FTP_LISTEN_BACKLOG);
+    ctx->acceptor_set = NULL;
+    ctx->accept_started = 0;
+    
+    /* Initialize session pool (slots are allocated on first use) */
+    atomic_store(&ctx->session_slots, 0U);
+    atomic_store(&ctx->session_free, (uint64_t)0U);
+    ctx->max_sessions = FTP_MAX_SESSIONS;
+    
+    /* Initialize session lock */
+    if (pthread_mutex_init(&ctx->session_lock, NULL) != 0) {
+        return FTP_ERR_THREAD_CREATE;
+    }
+
+    /* Passive listener pool (optional: PASV falls back to one per call) */
+    ctx->pasv_pool = NULL;
+#if FTP_PASV_POOL_SIZE > 0
+    ctx->pasv_pool = ftp_pasv_pool_create((uint32_t)FTP_PASV_POOL_SIZE,
+                                          (uint16_t)FTP_PASV_PORT_MIN,
+                                          (uint16_t)FTP_PASV_PORT_MAX);
+#endif
+    
+    /* Initialize statistics */
+    atomic_store(&ctx->stats.total_connections, 0U);
+    atomic_store(&ctx->stats.total_bytes_sent, 0U);
+    atomic_store(&ctx->stats.total_bytes_received, 0U);
+    atomic_store(&ctx->stats.total_errors, 0U);
+    
+    return FTP_OK;
+}
+
 /**
  * @brief Initialize FTP server
  */
@@ -74,74 +247,78 @@ ftp_error_t ftp_server_init(ftp_server_context_t *ctx,
         return err;
     }
     
-    /* Create listen socket */
-    int fd = PAL_SOCKET(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0) {
-        return FTP_ERR_SOCKET_CREATE;
-    }
-    
-    /* Enable address reuse */
-    err = pal_socket_set_reuseaddr(fd);
-    if (err != FTP_OK) {
-        PAL_CLOSE(fd);
-        return err;
-    }
-    
     /* Build bind address */
     err = pal_make_sockaddr(bind_ip, port, &ctx->listen_addr);
     if (err != FTP_OK) {
-        PAL_CLOSE(fd);
         return err;
     }
     
-    /* Bind socket */
-    if (PAL_BIND(fd, (struct sockaddr*)&ctx->listen_addr,
-                 sizeof(ctx->listen_addr)) < 0) {
-        PAL_CLOSE(fd);
-        return FTP_ERR_SOCKET_BIND;
-    }
-    
-    /* Listen for connections */
-    if (PAL_LISTEN(fd, FTP_LISTEN_BACKLOG) < 0) {
-        PAL_CLOSE(fd);
-        return FTP_ERR_SOCKET_LISTEN;
+    /* Create, bind and listen */
+    int fd = listen_open(&ctx->listen_addr, FTP_LISTEN_BACKLOG, 0);
+    if (fd < 0) {
+        return (ftp_error_t)fd;
     }
     
     ctx->listen_fd = fd;
     ctx->port = port;
     
-    /* Store root path */
-    size_t root_len = strlen(root_path);
-    if (root_len >= sizeof(ctx->root_path)) {
+    err = server_init_state(ctx, root_path);
+    if (err != FTP_OK) {
         PAL_CLOSE(fd);
-        return FTP_ERR_PATH_TOO_LONG;
+        ctx->listen_fd = -1;
     }
-    memcpy(ctx->root_path, root_path, root_len + 1U);
-    
-    /* Initialize server state */
-    atomic_store(&ctx->running, 0);
-    atomic_store(&ctx->active_sessions, 0U);
-    
-    /* Initialize session pool */
-    for (size_t i = 0U; i < FTP_MAX_SESSIONS; i++) {
-        memset(&ctx->sessions[i], 0, sizeof(ctx->sessions[i]));
-        ctx->sessions[i].ctrl_fd = -1;
-        ctx->sessions[i].data_fd = -1;
-        ctx->sessions[i].pasv_fd = -1;
+    return err;
+}
+
+/**
+ * @brief Initialize FTP server on inherited listeners
+ */
+ftp_error_t ftp_server_init_fds(ftp_server_context_t *ctx, const int *fds,
+                                uint32_t count, const char *root_path)
+{
+    ftp_error_t err = FTP_ERR_INVALID_PARAM;
+    if ((ctx != NULL) && (fds != NULL) && (root_path != NULL) &&
+        (count > 0U) && (count <= FTP_ACCEPT_THREADS_MAX)) {
+        memset(ctx, 0, sizeof(*ctx));
+        ctx->listen_fd = -1;
+        err = pal_network_init();
     }
-    
-    /* Initialize session lock */
-    if (pthread_mutex_init(&ctx->session_lock, NULL) != 0) {
-        PAL_CLOSE(fd);
-        return FTP_ERR_THREAD_CREATE;
+
+    /* Every fd must be an IPv4 listener on the first one's address */
+    for (uint32_t i = 0U; (err == FTP_OK) && (i < count); i++) {
+        struct sockaddr_in addr;
+        socklen_t len = (socklen_t)sizeof(addr);
+        if ((fds[i] < 0) ||
+            (PAL_GETSOCKNAME(fds[i], (struct sockaddr*)&addr, &len) < 0) ||
+            (addr.sin_family != AF_INET) ||
+            ((i > 0U) && (addr.sin_port != ctx->listen_addr.sin_port))) {
+            err = FTP_ERR_INVALID_PARAM;
+        } else if (i == 0U) {
+            ctx->listen_addr = addr;
+        }
+    }
+    if (err == FTP_OK) {
+        err = server_init_state(ctx, root_path);
+    }
+    if (err != FTP_OK) {
+        for (uint32_t i = 0U; (fds != NULL) && (i < count); i++) {
+            if (fds[i] >= 0) {
+                PAL_CLOSE(fds[i]);
+            }
+        }
+        if (ctx != NULL) {
+            ctx->listen_fd = -1;
+        }
+        return err;
+    }
+
+    ctx->listen_fd = fds[0];
+    ctx->port = PAL_NTOHS(ctx->listen_addr.sin_port);
+    ctx->acceptors = count;
+    ctx->inherited = count;
+    for (uint32_t i = 0U; i < count; i++) {
+        ctx->inherited_fds[i] = fds[i];
     }
-    
-    /* Initialize statistics */
-    atomic_store(&ctx->stats.total_connections, 0U);
-    atomic_store(&ctx->stats.total_bytes_sent, 0U);
-    atomic_store(&ctx->stats.total_bytes_received, 0U);
-    atomic_store(&ctx->stats.total_errors, 0U);
-    
     return FTP_OK;
 }
 
@@ -158,31 +335,54 @@ ftp_error_t ftp_server_start(ftp_server_context_t *ctx)
         return FTP_ERR_INVALID_PARAM;
     }
     
+    /* Event engine: loops and I/O pool exist before the first accept */
+    if ((ctx->event_engine != 0) && (ctx->engine == NULL)) {
+        ctx->engine = ftp_engine_create(FTP_ENGINE_LOOPS);
+        if (ctx->engine == NULL) {
+            return FTP_ERR_THREAD_CREATE;
+        }
+    }
+
     /* Set running flag */
     atomic_store(&ctx->running, 1);
+    atomic_store(&ctx->accepting, 1);
     
-    /* Create accept thread */
-    pthread_t accept_thread;
+    /* K acceptors on SO_REUSEPORT listeners (falls back to one) */
+    if (ctx->acceptors > 1U) {
+        ftp_error_t aerr = acceptors_start(ctx);
+        if (aerr != FTP_OK) {
+            atomic_store(&ctx->running, 0);
+            ftp_engine_destroy(ctx->engine);
+            ctx->engine = NULL;
+            return aerr;
+        }
+        if (ctx->acceptor_set != NULL) {
+            return FTP_OK;
+        }
+    }
+    
+    /* Create accept thread (joined by stop / release) */
     pthread_attr_t attr;
     int attr_ok = (pthread_attr_init(&attr) == 0);
     if (attr_ok != 0) {
         (void)pthread_attr_setstacksize(&attr, (size_t)FTP_THREAD_STACK_SIZE);
     }
     
-    if (pthread_create(&accept_thread, (attr_ok != 0) ? &attr : NULL, server_accept_thread, ctx) != 0) {
+    if (pal_thread_create(&ctx->accept_thread, (attr_ok != 0) ? &attr : NULL,
+                          PAL_THREAD_ACCEPT, server_accept_thread, ctx) != 0) {
         if (attr_ok != 0) {
             (void)pthread_attr_destroy(&attr);
         }
         atomic_store(&ctx->running, 0);
+        ftp_engine_destroy(ctx->engine);
+        ctx->engine = NULL;
         return FTP_ERR_THREAD_CREATE;
     }
     
     if (attr_ok != 0) {
         (void)pthread_attr_destroy(&attr);
     }
-    
-    /* Detach thread (we don't need to join it) */
-    pthread_detach(accept_thread);
+    ctx->accept_started = 1;
     
     return FTP_OK;
 }
@@ -194,12 +394,11 @@ ftp_error_t ftp_server_start(ftp_server_context_t *ctx)
  *
  *  1. Clear the running flag so the accept thread exits its loop check.
  *
- *  2. Close listen_fd immediately.
- *     WHY: PAL_ACCEPT() is a blocking syscall.  The accept thread only checks
- *     ctx->running AFTER accept() returns.  Without closing the socket, the
- *     thread blocks forever — even though running == 0.  Closing the fd
- *     makes accept() return EBADF/EINVAL immediately, allowing the thread to
- *     observe running == 0 and exit.
+ *  2. Join the accept thread, then close listen_fd (with K acceptors:
+ *     stop and join them, then the start queue).
+ *     WHY: the accept thread poll()s with ACCEPTOR_POLL_MS and re-checks
+ *     ctx->running, so the join is bounded; closing only afterwards means
+ *     the thread can never accept() on a recycled fd number.
  *
  *  3. Force shutdown(SHUT_RDWR) on every active session's ctrl_fd.
  *     WHY: Session threads block inside recv() waiting for the next FTP
@@ -226,20 +425,29 @@ void ftp_server_stop(ftp_server_context_t *ctx)
     /* Step 1 — signal stop */
     atomic_store(&ctx->running, 0);
 
-    /* Step 2 — unblock PAL_ACCEPT() in the accept thread */
-    if (ctx->listen_fd >= 0) {
-        PAL_CLOSE(ctx->listen_fd);
-        ctx->listen_fd = -1; /* ftp_server_cleanup() guards against double-close */
+    /* Step 2 — stop the accept thread(s), close the listener(s) */
+    if (ctx->acceptor_set != NULL) {
+        acceptors_stop(ctx, 0); /* joins acceptors and the starter */
+    } else {
+        if (ctx->accept_started != 0) {
+            (void)pthread_join(ctx->accept_thread, NULL);
+            ctx->accept_started = 0;
+        }
+        if (ctx->listen_fd >= 0) {
+            PAL_CLOSE(ctx->listen_fd);
+            ctx->listen_fd = -1; /* ftp_server_cleanup() guards against double-close */
+        }
     }
 
     /* Step 3 — interrupt blocking recv() in each session thread */
     pthread_mutex_lock(&ctx->session_lock);
-    for (size_t i = 0U; i < FTP_MAX_SESSIONS; i++) {
-        int state = atomic_load(&ctx->sessions[i].state);
+    uint32_t slots = atomic_load(&ctx->session_slots);
+    for (uint32_t i = 0U; i < slots; i++) {
+        int state = atomic_load(&ctx->sessions[i]->state);
         if ((state == FTP_STATE_CONNECTED)    ||
             (state == FTP_STATE_AUTHENTICATED)||
             (state == FTP_STATE_TRANSFERRING)) {
-            int cfd = ctx->sessions[i].ctrl_fd;
+            int cfd = ctx->sessions[i]->ctrl_fd;
             if (cfd >= 0) {
                 /*
                  * shutdown() injects EOF without closing the fd.
@@ -267,6 +475,163 @@ void ftp_server_stop(ftp_server_context_t *ctx)
 #undef SERVER_STOP_POLL_MS
 }
 
+/**
+ * @brief Control-port listeners (hand-off)
+ */
+uint32_t ftp_server_listeners(const ftp_server_context_t *ctx, int *fds,
+                              uint32_t max)
+{
+    uint32_t n = 0U;
+    if ((ctx == NULL) || (fds == NULL)) {
+        return 0U;
+    }
+    if (ctx->acceptor_set != NULL) {
+        for (uint32_t i = 0U; (i < ctx->acceptor_set->count) && (n < max); i++) {
+            fds[n++] = ctx->acceptor_set->a[i].fd;
+        }
+    } else if ((ctx->listen_fd >= 0) && (max > 0U)) {
+        fds[n++] = ctx->listen_fd;
+    }
+    return n;
+}
+
+/**
+ * @brief Stop accepting, keep the sessions (hand-off)
+ */
+void ftp_server_release_listeners(ftp_server_context_t *ctx)
+{
+    if (ctx == NULL) {
+        return;
+    }
+    atomic_store(&ctx->accepting, 0);
+    if (ctx->acceptor_set != NULL) {
+        acceptors_stop(ctx, 1);
+        return;
+    }
+    if (ctx->accept_started != 0) {
+        (void)pthread_join(ctx->accept_thread, NULL);
+        ctx->accept_started = 0;
+    }
+    if (ctx->listen_fd >= 0) {
+        PAL_CLOSE(ctx->listen_fd);
+        ctx->listen_fd = -1;
+    }
+}
+
+/**
+ * @brief Set the runtime session limit
+ */
+ftp_error_t ftp_server_set_max_sessions(ftp_server_context_t *ctx,
+                                        uint32_t max_sessions)
+{
+    if ((ctx == NULL) || (max_sessions == 0U) ||
+        (max_sessions > FTP_MAX_SESSIONS)) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    /* Lowering it keeps existing slots; new sessions wait for the count */
+    pthread_mutex_lock(&ctx->session_lock);
+    ctx->max_sessions = max_sessions;
+    pthread_mutex_unlock(&ctx->session_lock);
+    return FTP_OK;
+}
+
+/**
+ * @brief Choose the session engine before ftp_server_start()
+ */
+ftp_error_t ftp_server_set_event_engine(ftp_server_context_t *ctx,
+                                        int enable)
+{
+    if (ctx == NULL) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    if (atomic_load(&ctx->running) != 0) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    ctx->event_engine = (enable != 0) ? 1 : 0;
+    return FTP_OK;
+}
+
+/**
+ * @brief Choose the number of acceptor threads before ftp_server_start()
+ */
+ftp_error_t ftp_server_set_acceptors(ftp_server_context_t *ctx,
+                                     uint32_t acceptors)
+{
+    if ((ctx == NULL) || (acceptors == 0U) ||
+        (acceptors > FTP_ACCEPT_THREADS_MAX)) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    if ((atomic_load(&ctx->running) != 0) || (ctx->inherited != 0U)) {
+        return FTP_ERR_INVALID_PARAM; /* inherited: one thread per fd */
+    }
+#if !defined(SO_REUSEPORT)
+    if (acceptors > 1U) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+#endif
+    ctx->acceptors = acceptors;
+    return FTP_OK;
+}
+
+/**
+ * @brief Change the listen() backlog of the control port
+ */
+ftp_error_t ftp_server_set_listen_backlog(ftp_server_context_t *ctx,
+                                          uint32_t backlog)
+{
+    if ((ctx == NULL) || (backlog == 0U) || (backlog > (uint32_t)INT32_MAX)) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    atomic_store(&ctx->listen_backlog, backlog);
+
+    /* listen() on a listening socket only updates the backlog */
+    ftp_error_t err = FTP_OK;
+    if (ctx->acceptor_set != NULL) {
+        for (uint32_t i = 0U; i < ctx->acceptor_set->count; i++) {
+            if (PAL_LISTEN(ctx->acceptor_set->a[i].fd, (int)backlog) < 0) {
+                err = FTP_ERR_SOCKET_LISTEN;
+            }
+        }
+    } else if (ctx->listen_fd >= 0) {
+        if (PAL_LISTEN(ctx->listen_fd, (int)backlog) < 0) {
+            err = FTP_ERR_SOCKET_LISTEN;
+        }
+    }
+    return err;
+}
+
+#if FTP_ENABLE_TLS
+/**
+ * @brief Load a certificate and enable AUTH TLS (FTPS)
+ */
+ftp_error_t ftp_server_enable_tls(ftp_server_context_t *ctx,
+                                  const char *cert_file,
+                                  const char *key_file)
+{
+    if ((ctx == NULL) || (cert_file == NULL)) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+
+    if (pal_tls_global_init() != PAL_TLS_OK) {
+        return FTP_ERR_NOT_SUPPORTED;
+    }
+
+    pal_tls_server_cfg_t cfg = {
+        .cert_file = cert_file,
+        .key_file = key_file,
+        .ktls = FTP_TLS_KTLS,
+    };
+    pal_tls_server_t *srv = pal_tls_server_create(&cfg);
+    if (srv == NULL) {
+        return FTP_ERR_FILE_OPEN;
+    }
+
+    pal_tls_server_destroy(ctx->tls);
+    ctx->tls = srv;
+    return FTP_OK;
+}
+#endif
+
 /**
  * @brief Cleanup server resources
  *
@@ -284,7 +649,38 @@ void ftp_server_cleanup(ftp_server_context_t *ctx)
         PAL_CLOSE(ctx->listen_fd);
         ctx->listen_fd = -1;
     }
+    for (uint32_t i = 1U; i < ctx->inherited; i++) {
+        if (ctx->inherited_fds[i] >= 0) { /* never started */
+            PAL_CLOSE(ctx->inherited_fds[i]);
+            ctx->inherited_fds[i] = -1;
+        }
+    }
     
+    /* Sessions are drained by ftp_server_stop(); now the engine threads */
+    ftp_engine_destroy(ctx->engine);
+    ctx->engine = NULL;
+
+#if FTP_ENABLE_TLS
+    pal_tls_server_destroy(ctx->tls);
+    ctx->tls = NULL;
+#endif
+
+    /*
+     * Free the slots — unless a session outlived ftp_server_stop()'s
+     * timeout and may still be running on them.
+     */
+    if (atomic_load(&ctx->active_sessions) == 0U) {
+        uint32_t slots = atomic_load(&ctx->session_slots);
+        for (uint32_t i = 0U; i < slots; i++) {
+            free(ctx->sessions[i]);
+            ctx->sessions[i] = NULL;
+        }
+        atomic_store(&ctx->session_slots, 0U);
+        atomic_store(&ctx->session_free, (uint64_t)0U);
+        ftp_pasv_pool_destroy(ctx->pasv_pool);
+        ctx->pasv_pool = NULL;
+    }
+
     /* Destroy session lock */
     pthread_mutex_destroy(&ctx->session_lock);
     
@@ -298,6 +694,9 @@ void ftp_server_cleanup(ftp_server_context_t *ctx)
 
 /**
  * @brief Accept thread - handles incoming connections
+ *
+ * poll() with a timeout so that ftp_server_stop() and
+ * ftp_server_release_listeners() can join it.
  */
 static void* server_accept_thread(void *arg)
 {
@@ -307,103 +706,462 @@ static void* server_accept_thread(void *arg)
         return NULL;
     }
     
-    while (atomic_load(&ctx->running) != 0) {
-        /* Accept new connection */
+    int lfd = ctx->listen_fd;
+    while ((atomic_load(&ctx->running) != 0) &&
+           (atomic_load(&ctx->accepting) != 0)) {
+        struct pollfd pfd;
+        pfd.fd = lfd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1U, ACCEPTOR_POLL_MS) <= 0) {
+            continue;
+        }
+
+        /* Accept new connection (EAGAIN: another process took it) */
         struct sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
-        
-        int client_fd = PAL_ACCEPT(ctx->listen_fd,
-                                    (struct sockaddr*)&client_addr,
-                                    &addr_len);
-        
+        int client_fd = server_accept(lfd, &client_addr);
         if (client_fd < 0) {
-            /* Accept failed - check if server is stopping */
-            if (atomic_load(&ctx->running) == 0) {
-                break;
-            }
-            
-            continue; /* Try again */
-        }
-        
-        /* Configure client socket */
-        (void)pal_socket_configure(client_fd);
-        
-        /* Allocate session */
-        ftp_session_t *session = allocate_session(ctx);
-        
-        if (session == NULL) {
-            /* No available sessions - reject connection */
-            PAL_CLOSE(client_fd);
-            atomic_fetch_add(&ctx->stats.total_errors, 1U);
             continue;
         }
         
-        /* Initialize session */
-        static atomic_uint_fast32_t session_counter = ATOMIC_VAR_INIT(0);
-        uint32_t session_id = atomic_fetch_add(&session_counter, 1U);
-        
-        ftp_error_t err = ftp_session_init(session, client_fd, &client_addr,
-                                            session_id, ctx->root_path);
-        
-        if (err != FTP_OK) {
+        server_start_session(ctx, client_fd, &client_addr, server_now_ns());
+    }
+    
+    return NULL;
+}
+
+/*===========================================================================*
+ * SESSION START
+ *===========================================================================*/
+
+/* Latency (accept -> running) and per-second rate counters */
+static void note_session_started(ftp_server_context_t *ctx, uint64_t accept_ns)
+{
+    uint64_t now = server_now_ns();
+    uint64_t lat = (now > accept_ns) ? (now - accept_ns) : 0U;
+
+    atomic_fetch_add(&ctx->stats.start_count, 1U);
+    atomic_fetch_add(&ctx->stats.start_ns_total, lat);
+    uint_fast64_t peak = atomic_load(&ctx->stats.start_ns_max);
+    while ((lat > peak) && !atomic_compare_exchange_weak(
+                               &ctx->stats.start_ns_max, &peak, lat)) {
+    }
+
+    uint_fast64_t sec = now / 1000000000ULL;
+    uint_fast64_t cur = atomic_load(&ctx->stats.rate_sec);
+    if ((sec != cur) &&
+        atomic_compare_exchange_strong(&ctx->stats.rate_sec, &cur, sec)) {
+        uint_fast64_t n = atomic_exchange(&ctx->stats.rate_count, 0U);
+        atomic_store(&ctx->stats.rate_last, (sec == cur + 1U) ? n : 0U);
+    }
+    atomic_fetch_add(&ctx->stats.rate_count, 1U);
+}
+
+/**
+ * @brief Configure an accepted control socket and hand it to a session
+ *
+ * Runs on the accept thread (one acceptor) or the starter thread (K
+ * acceptors).  On any failure the fd is closed and total_errors bumped.
+ */
+static void server_start_session(ftp_server_context_t *ctx, int client_fd,
+                                 const struct sockaddr_in *client_addr,
+                                 uint64_t accept_ns)
+{
+    /* Configure client socket */
+    (void)pal_socket_configure(client_fd);
+    
+    /* Allocate session */
+    ftp_session_t *session = allocate_session(ctx);
+    
+    if (session == NULL) {
+        /* No available sessions - reject connection */
+        PAL_CLOSE(client_fd);
+        atomic_fetch_add(&ctx->stats.total_errors, 1U);
+        return;
+    }
+    
+    /* Initialize session */
+    static atomic_uint_fast32_t session_counter = ATOMIC_VAR_INIT(0);
+    uint32_t session_id = (uint32_t)atomic_fetch_add(&session_counter, 1U);
+    
+    uint32_t slot = session->pool_slot;
+    ftp_error_t err = ftp_session_init(session, client_fd, client_addr,
+                                        session_id, ctx->root_path);
+    session->pool_slot = slot; /* init zeroes the whole struct */
+    
+    if (err != FTP_OK) {
+        PAL_CLOSE(client_fd);
+        free_session(ctx, session);
+        atomic_fetch_add(&ctx->stats.total_errors, 1U);
+        return;
+    }
+
+    /*
+     * Store the back-pointer to the owning server context.
+     *
+     * WHY: The session thread calls ftp_server_release_session() on exit
+     * to decrement active_sessions and mark the slot as free.  Without
+     * this pointer the thread cannot reach the server context.
+     *
+     * Written here — before pthread_create() — so it is visible to the
+     * new thread without any additional synchronisation (pthread_create
+     * acts as a memory barrier).
+     */
+    session->server_ctx = ctx;
+
+    /*
+     * Event engine: no thread of its own, the I/O pool greets it.
+     * Counted before the hand-off — a worker may end the session
+     * (and decrement) before ftp_engine_submit() even returns.
+     */
+    if (ctx->engine != NULL) {
+        atomic_fetch_add(&ctx->active_sessions, 1U);
+        if (ftp_engine_submit(ctx->engine, session) != FTP_OK) {
+            atomic_fetch_sub(&ctx->active_sessions, 1U);
             PAL_CLOSE(client_fd);
             free_session(ctx, session);
             atomic_fetch_add(&ctx->stats.total_errors, 1U);
-            continue;
+            return;
         }
+        atomic_fetch_add(&ctx->stats.total_connections, 1U);
+        note_session_started(ctx, accept_ns);
+        return;
+    }
+    
+    /*
+     * Counted before the thread exists, as for the engine: the session
+     * may greet, end and call ftp_server_release_session() before
+     * pthread_create() returns (the restart drain waits on this count).
+     */
+    atomic_fetch_add(&ctx->stats.total_connections, 1U);
+    atomic_fetch_add(&ctx->active_sessions, 1U);
 
-        /*
-         * Store the back-pointer to the owning server context.
-         *
-         * WHY: The session thread calls ftp_server_release_session() on exit
-         * to decrement active_sessions and mark the slot as free.  Without
-         * this pointer the thread cannot reach the server context.
-         *
-         * Written here — before pthread_create() — so it is visible to the
-         * new thread without any additional synchronisation (pthread_create
-         * acts as a memory barrier).
-         */
-        session->server_ctx = ctx;
-        
-        /* Create session thread */
-        pthread_attr_t sess_attr;
-        int sess_attr_ok = (pthread_attr_init(&sess_attr) == 0);
+    /* Create session thread */
+    pthread_attr_t sess_attr;
+    int sess_attr_ok = (pthread_attr_init(&sess_attr) == 0);
+    if (sess_attr_ok != 0) {
+        (void)pthread_attr_setstacksize(&sess_attr, (size_t)FTP_THREAD_STACK_SIZE);
+    }
+    
+    if (pal_thread_create(&session->thread, (sess_attr_ok != 0) ? &sess_attr : NULL,
+                          PAL_THREAD_CONTROL, ftp_session_thread, session) != 0) {
         if (sess_attr_ok != 0) {
-            (void)pthread_attr_setstacksize(&sess_attr, (size_t)FTP_THREAD_STACK_SIZE);
+            (void)pthread_attr_destroy(&sess_attr);
         }
-        
-        if (pthread_create(&session->thread, (sess_attr_ok != 0) ? &sess_attr : NULL,
-                           ftp_session_thread, session) != 0) {
-            if (sess_attr_ok != 0) {
-                (void)pthread_attr_destroy(&sess_attr);
-            }
-            PAL_CLOSE(client_fd);
-            free_session(ctx, session);
-            atomic_fetch_add(&ctx->stats.total_errors, 1U);
+        atomic_fetch_sub(&ctx->stats.total_connections, 1U);
+        atomic_fetch_sub(&ctx->active_sessions, 1U);
+        PAL_CLOSE(client_fd);
+        free_session(ctx, session);
+        atomic_fetch_add(&ctx->stats.total_errors, 1U);
+        return;
+    }
+    
+    if (sess_attr_ok != 0) {
+        (void)pthread_attr_destroy(&sess_attr);
+    }
+    
+    /* Detach thread */
+    pthread_detach(session->thread);
+    
+    note_session_started(ctx, accept_ns);
+}
+
+/*===========================================================================*
+ * MULTI-ACCEPTOR (FTP_ACCEPT_THREADS > 1)
+ *
+ *   listener 0 ──► acceptor 0 ──┐
+ *   listener 1 ──► acceptor 1 ──┼──► start queue ──► starter ──► session
+ *   ...          (SO_REUSEPORT) ┘   (full: acceptor starts it inline)
+ *
+ * Acceptors only accept(), so the kernel queues drain at syscall speed
+ * during connection storms; socket setup, slot allocation and thread
+ * creation happen on the starter.  Acceptors poll() with a timeout so
+ * they notice ftp_server_stop() on kernels where closing a listener does
+ * not wake a blocked accept().
+ *===========================================================================*/
+
+static int start_queue_push(struct ftp_acceptors *set, int fd,
+                            const struct sockaddr_in *addr, uint64_t accept_ns)
+{
+    int queued = 0;
+    pthread_mutex_lock(&set->lock);
+    if ((set->stop == 0) && (set->len < FTP_ACCEPT_QUEUE)) {
+        start_item_t *it = &set->queue[(set->head + set->len) % FTP_ACCEPT_QUEUE];
+        it->fd = fd;
+        it->addr = *addr;
+        it->accept_ns = accept_ns;
+        set->len++;
+        if (set->len > set->peak) {
+            set->peak = set->len;
+        }
+        queued = 1;
+        pthread_cond_signal(&set->cv);
+    }
+    pthread_mutex_unlock(&set->lock);
+    return queued;
+}
+
+static void* server_starter_thread(void *arg)
+{
+    struct ftp_acceptors *set = (struct ftp_acceptors*)arg;
+
+    pthread_mutex_lock(&set->lock);
+    for (;;) {
+        while ((set->len == 0U) && (set->stop == 0)) {
+            pthread_cond_wait(&set->cv, &set->lock);
+        }
+        if (set->len == 0U) {
+            break; /* stop requested and drained */
+        }
+        start_item_t it = set->queue[set->head];
+        set->head = (set->head + 1U) % FTP_ACCEPT_QUEUE;
+        set->len--;
+        int stopping = set->stop;
+        pthread_mutex_unlock(&set->lock);
+
+        if (stopping != 0) {
+            PAL_CLOSE(it.fd); /* accepted during shutdown */
+        } else {
+            server_start_session(set->ctx, it.fd, &it.addr, it.accept_ns);
+        }
+
+        pthread_mutex_lock(&set->lock);
+    }
+    pthread_mutex_unlock(&set->lock);
+    return NULL;
+}
+
+static void* server_acceptor_thread(void *arg)
+{
+    acceptor_t *a = (acceptor_t*)arg;
+    struct ftp_acceptors *set = a->set;
+    ftp_server_context_t *ctx = set->ctx;
+
+    while ((atomic_load(&ctx->running) != 0) &&
+           (atomic_load(&ctx->accepting) != 0)) {
+        struct pollfd pfd;
+        pfd.fd = a->fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        if (poll(&pfd, 1U, ACCEPTOR_POLL_MS) <= 0) {
             continue;
         }
-        
-        if (sess_attr_ok != 0) {
-            (void)pthread_attr_destroy(&sess_attr);
+
+        struct sockaddr_in client_addr;
+        int client_fd = server_accept(a->fd, &client_addr);
+        if (client_fd < 0) {
+            continue;
+        }
+
+        uint64_t now = server_now_ns();
+        if (start_queue_push(set, client_fd, &client_addr, now) == 0) {
+            server_start_session(ctx, client_fd, &client_addr, now);
         }
-        
-        /* Detach thread */
-        pthread_detach(session->thread);
-        
-        /* Update statistics */
-        atomic_fetch_add(&ctx->stats.total_connections, 1U);
-        atomic_fetch_add(&ctx->active_sessions, 1U);
     }
-    
     return NULL;
 }
 
+static int spawn(pthread_t *tid, void *(*fn)(void *), void *arg)
+{
+    pthread_attr_t attr;
+    int attr_ok = (pthread_attr_init(&attr) == 0);
+    if (attr_ok != 0) {
+        (void)pthread_attr_setstacksize(&attr, (size_t)FTP_THREAD_STACK_SIZE);
+    }
+    int rc = pal_thread_create(tid, (attr_ok != 0) ? &attr : NULL,
+                               PAL_THREAD_ACCEPT, fn, arg);
+    if (attr_ok != 0) {
+        (void)pthread_attr_destroy(&attr);
+    }
+    return rc;
+}
+
+/**
+ * @brief Replace the init listener with ctx->acceptors SO_REUSEPORT ones
+ *
+ * The listener from ftp_server_init() was bound without SO_REUSEPORT,
+ * so it is closed and re-opened; the port is unbound for that instant
+ * (at start-up only).  Opening fewer listeners than asked is not an
+ * error; opening none falls back to the single accept thread
+ * (ctx->acceptor_set stays NULL).  Listeners from ftp_server_init_fds()
+ * are used as they are.
+ */
+static ftp_error_t acceptors_start(ftp_server_context_t *ctx)
+{
+    uint32_t backlog = atomic_load(&ctx->listen_backlog);
+    struct ftp_acceptors *set = calloc(1U, sizeof(*set));
+    if (set == NULL) {
+        return FTP_OK; /* single acceptor */
+    }
+    if (pthread_mutex_init(&set->lock, NULL) != 0) {
+        free(set);
+        return FTP_OK;
+    }
+    if (pthread_cond_init(&set->cv, NULL) != 0) {
+        pthread_mutex_destroy(&set->lock);
+        free(set);
+        return FTP_OK;
+    }
+    set->ctx = ctx;
+
+    if (ctx->inherited > 1U) {
+        for (uint32_t i = 0U; i < ctx->inherited; i++) {
+            set->a[i].set = set;
+            set->a[i].fd = ctx->inherited_fds[i];
+            ctx->inherited_fds[i] = -1; /* the set owns it now */
+            set->count++;
+        }
+    } else {
+        PAL_CLOSE(ctx->listen_fd);
+        ctx->listen_fd = -1;
+    }
+    for (uint32_t i = set->count; i < ctx->acceptors; i++) {
+        int fd = listen_open(&ctx->listen_addr, backlog, 1);
+        if (fd < 0) {
+            break;
+        }
+        set->a[i].set = set;
+        set->a[i].fd = fd;
+        set->count++;
+    }
+
+    if (set->count == 0U) {
+        pthread_cond_destroy(&set->cv);
+        pthread_mutex_destroy(&set->lock);
+        free(set);
+        int fd = listen_open(&ctx->listen_addr, backlog, 0);
+        if (fd < 0) {
+            return (ftp_error_t)fd;
+        }
+        ctx->listen_fd = fd;
+        ctx->acceptors = 1U;
+        return FTP_OK;
+    }
+    ctx->listen_fd = set->a[0].fd;
+    ctx->acceptors = set->count;
+    ctx->acceptor_set = set;
+
+    if (spawn(&set->starter, server_starter_thread, set) != 0) {
+        atomic_store(&ctx->running, 0);
+        acceptors_stop(ctx, 0);
+        return FTP_ERR_THREAD_CREATE;
+    }
+    set->starter_started = 1;
+    for (uint32_t i = 0U; i < set->count; i++) {
+        if (spawn(&set->a[i].tid, server_acceptor_thread, &set->a[i]) != 0) {
+            atomic_store(&ctx->running, 0);
+            acceptors_stop(ctx, 0);
+            return FTP_ERR_THREAD_CREATE;
+        }
+        set->a[i].started = 1;
+    }
+    return FTP_OK;
+}
+
+/*
+ * Join acceptors, then drain the start queue; running or accepting must
+ * be 0.  @p release (hand-off): the listeners are shared with another
+ * process, so no shutdown() (it would stop theirs too), and connections
+ * already queued are started rather than dropped.
+ */
+static void acceptors_stop(ftp_server_context_t *ctx, int release)
+{
+    struct ftp_acceptors *set = ctx->acceptor_set;
+    if (set == NULL) {
+        return;
+    }
+
+    for (uint32_t i = 0U; (release == 0) && (i < set->count); i++) {
+        (void)shutdown(set->a[i].fd, SHUT_RDWR);
+    }
+    for (uint32_t i = 0U; i < set->count; i++) {
+        if (set->a[i].started != 0) {
+            (void)pthread_join(set->a[i].tid, NULL);
+        }
+        PAL_CLOSE(set->a[i].fd);
+    }
+
+    pthread_mutex_lock(&set->lock);
+    while ((release != 0) && (set->len > 0U) && (set->starter_started != 0)) {
+        pthread_mutex_unlock(&set->lock);
+        usleep(1000U);
+        pthread_mutex_lock(&set->lock);
+    }
+    set->stop = 1;
+    pthread_cond_broadcast(&set->cv);
+    pthread_mutex_unlock(&set->lock);
+    if (set->starter_started != 0) {
+        (void)pthread_join(set->starter, NULL);
+    }
+
+    pthread_cond_destroy(&set->cv);
+    pthread_mutex_destroy(&set->lock);
+    ctx->acceptor_set = NULL;
+    ctx->listen_fd = -1;
+    free(set);
+}
+
 /*===========================================================================*
  * SESSION POOL MANAGEMENT
  *===========================================================================*/
 
+/* Free-list head encoding: ABA tag in the upper half, slot + 1 below */
+#define POOL_SLOT(head) ((uint32_t)((head) & 0xFFFFFFFFU))
+#define POOL_HEAD(tag, slot1) (((uint64_t)(tag) << 32) | (uint64_t)(slot1))
+
+static void pool_push(ftp_server_context_t *ctx, uint32_t slot)
+{
+    uint64_t head = atomic_load(&ctx->session_free);
+    uint64_t next;
+    do {
+        atomic_store(&ctx->session_next[slot], POOL_SLOT(head));
+        next = POOL_HEAD((head >> 32) + 1U, slot + 1U);
+    } while (!atomic_compare_exchange_weak(&ctx->session_free, &head, next));
+}
+
+static ftp_session_t *pool_pop(ftp_server_context_t *ctx)
+{
+    uint64_t head = atomic_load(&ctx->session_free);
+    while (POOL_SLOT(head) != 0U) {
+        uint32_t slot = POOL_SLOT(head) - 1U;
+        uint64_t next = POOL_HEAD((head >> 32) + 1U,
+                                  atomic_load(&ctx->session_next[slot]));
+        if (atomic_compare_exchange_weak(&ctx->session_free, &head, next)) {
+            return ctx->sessions[slot];
+        }
+    }
+    return NULL;
+}
+
+/* Slow path: add one slot, bounded by the runtime limit */
+static ftp_session_t *pool_grow(ftp_server_context_t *ctx)
+{
+    ftp_session_t *session = NULL;
+
+    pthread_mutex_lock(&ctx->session_lock);
+    uint32_t slots = atomic_load(&ctx->session_slots);
+    if (slots < ctx->max_sessions) {
+        session = calloc(1U, sizeof(*session));
+        if (session != NULL) {
+            session->ctrl_fd = -1;
+            session->data_fd = -1;
+            session->pasv_fd = -1;
+            session->pool_slot = slots;
+            ctx->sessions[slots] = session;
+            /* Publish after the slot pointer: readers bound by the count */
+            atomic_store(&ctx->session_slots, slots + 1U);
+        }
+    }
+    pthread_mutex_unlock(&ctx->session_lock);
+
+    return session;
+}
+
 /**
  * @brief Allocate session from pool
+ *
+ * Lock-free pop from the free list; grows the pool under session_lock
+ * only when every allocated slot is busy.
  */
 static ftp_session_t* allocate_session(ftp_server_context_t *ctx)
 {
@@ -411,23 +1169,17 @@ static ftp_session_t* allocate_session(ftp_server_context_t *ctx)
         return NULL;
     }
     
-    pthread_mutex_lock(&ctx->session_lock);
-    
-    /* Find free session slot */
-    ftp_session_t *session = NULL;
-    
-    for (size_t i = 0U; i < FTP_MAX_SESSIONS; i++) {
-        int state = atomic_load(&ctx->sessions[i].state);
-        
-        if ((state == FTP_STATE_INIT) || (state == FTP_STATE_TERMINATING)) {
-            /* Available slot */
-            session = &ctx->sessions[i];
-            atomic_store(&session->state, FTP_STATE_CONNECTED);
-            break;
-        }
+    if (atomic_load(&ctx->active_sessions) >= ctx->max_sessions) {
+        return NULL;
+    }
+
+    ftp_session_t *session = pool_pop(ctx);
+    if (session == NULL) {
+        session = pool_grow(ctx);
+    }
+    if (session != NULL) {
+        atomic_store(&session->state, FTP_STATE_CONNECTED);
     }
-    
-    pthread_mutex_unlock(&ctx->session_lock);
     
     return session;
 }
@@ -435,24 +1187,24 @@ static ftp_session_t* allocate_session(ftp_server_context_t *ctx)
 /**
  * @brief Free session back to pool (internal error-path helper).
  *
- * Used ONLY in server_accept_thread for early error paths — BEFORE
- * pthread_create() succeeds and BEFORE active_sessions is incremented.
+ * Used ONLY in server_start_session() for early error paths, when no
+ * session thread or engine worker owns the slot.
  *
  * WHY NO DECREMENT:
- *   active_sessions is incremented at line:
- *       atomic_fetch_add(&ctx->active_sessions, 1U);
- *   which occurs AFTER pthread_create() returns 0.  All calls to
- *   free_session() happen in error branches that execute BEFORE that
- *   line (ftp_session_init failure, pthread_create failure).
- *   Decrementing here would underflow the counter from 0 to UINT_FAST32_MAX,
- *   which would permanently prevent ftp_server_stop() from exiting even
- *   after all real sessions have finished.
+ *   active_sessions is incremented BEFORE the session is handed on
+ *   (ftp_engine_submit() or pal_thread_create()): the session may greet,
+ *   end and call ftp_server_release_session() before that call even
+ *   returns, and the restart drain waits on the count.  The error paths
+ *   that follow the increment undo it themselves with an explicit
+ *   atomic_fetch_sub() before calling free_session(); the one before it
+ *   (ftp_session_init failure) has nothing to undo.  Decrementing here
+ *   as well would count those failures twice and underflow the counter
+ *   to UINT_FAST32_MAX, so ftp_server_stop() would never see 0.
  *
- *   The only correct place to decrement active_sessions is
- *   ftp_server_release_session(), which is called from inside
- *   ftp_session_thread() — i.e. after the thread (and the increment) exist.
+ *   Once the hand-off succeeded, the only correct place to decrement is
+ *   ftp_server_release_session(), called when the session ends.
  *
- * @note Thread-safety: Protected by ctx->session_lock
+ * @note Thread-safety: Lock-free (free-list push)
  */
 static void free_session(ftp_server_context_t *ctx, ftp_session_t *session)
 {
@@ -460,12 +1212,9 @@ static void free_session(ftp_server_context_t *ctx, ftp_session_t *session)
         return;
     }
     
-    pthread_mutex_lock(&ctx->session_lock);
-    
     /* Reset slot state so it can be reused — no counter decrement here */
     atomic_store(&session->state, FTP_STATE_INIT);
-    
-    pthread_mutex_unlock(&ctx->session_lock);
+    pool_push(ctx, session->pool_slot);
 }
 
 /**
@@ -474,11 +1223,11 @@ static void free_session(ftp_server_context_t *ctx, ftp_session_t *session)
  * Called by ftp_session_thread() as its very last action, after
  * ftp_session_cleanup() has closed all file descriptors.
  *
- * INVARIANT: active_sessions was already incremented (in server_accept_thread,
- * after pthread_create() returned 0) before this thread started running.
- * This function performs the matching decrement.  free_session() (the internal
- * error-path helper) deliberately does NOT decrement — it is only called from
- * code paths that execute BEFORE the increment.
+ * INVARIANT: active_sessions was already incremented (in
+ * server_start_session(), before the thread was created or the session
+ * submitted to the engine).  This function performs the matching
+ * decrement.  free_session() (the internal error-path helper) deliberately
+ * does NOT decrement — its callers undo the increment themselves.
  *
  * @pre Called only from the session's own thread
  * @pre ftp_session_cleanup() already called (all FDs closed)
@@ -497,11 +1246,10 @@ void ftp_server_release_session(ftp_server_context_t *ctx,
      */
     session->server_ctx = NULL;
 
-    /* Reset slot state and decrement the active-session counter */
-    pthread_mutex_lock(&ctx->session_lock);
+    /* Reset slot state, return it and decrement the active-session counter */
     atomic_store(&session->state, FTP_STATE_INIT);
+    pool_push(ctx, session->pool_slot);
     atomic_fetch_sub(&ctx->active_sessions, 1U);
-    pthread_mutex_unlock(&ctx->session_lock);
 }
 
 /*===========================================================================*
@@ -548,11 +1296,13 @@ void ftp_server_get_stats(const ftp_server_context_t *ctx,
         *total_conn = atomic_load(&ctx->stats.total_connections);
     }
     
+    uint32_t slots = atomic_load(&ctx->session_slots);
+
     if (bytes_sent != NULL) {
         /* Sum all session statistics */
         uint64_t total = 0U;
-        for (size_t i = 0U; i < FTP_MAX_SESSIONS; i++) {
-            total += atomic_load(&ctx->sessions[i].stats.bytes_sent);
+        for (uint32_t i = 0U; i < slots; i++) {
+            total += atomic_load(&ctx->sessions[i]->stats.bytes_sent);
         }
         *bytes_sent = total;
     }
@@ -560,9 +1310,54 @@ void ftp_server_get_stats(const ftp_server_context_t *ctx,
     if (bytes_received != NULL) {
         /* Sum all session statistics */
         uint64_t total = 0U;
-        for (size_t i = 0U; i < FTP_MAX_SESSIONS; i++) {
-            total += atomic_load(&ctx->sessions[i].stats.bytes_received);
+        for (uint32_t i = 0U; i < slots; i++) {
+            total += atomic_load(&ctx->sessions[i]->stats.bytes_received);
         }
         *bytes_received = total;
     }
 }
+
+/**
+ * @brief Get server statistics, including the acceptor counters
+ */
+void ftp_server_get_stats_ex(const ftp_server_context_t *ctx,
+                             ftp_server_stats_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (ctx == NULL) {
+        return;
+    }
+
+    ftp_server_get_stats(ctx, &out->total_connections, &out->bytes_sent,
+                         &out->bytes_received);
+    out->total_errors = (uint32_t)atomic_load(&ctx->stats.total_errors);
+    out->acceptors = ctx->acceptors;
+    out->listen_backlog = atomic_load(&ctx->listen_backlog);
+
+    uint64_t starts = atomic_load(&ctx->stats.start_count);
+    if (starts > 0U) {
+        out->accept_latency_avg_ns =
+            atomic_load(&ctx->stats.start_ns_total) / starts;
+    }
+    out->accept_latency_max_ns = atomic_load(&ctx->stats.start_ns_max);
+
+    /* Full second before the current one; stale buckets read as 0 */
+    uint64_t sec = server_now_ns() / 1000000000ULL;
+    uint64_t bucket = atomic_load(&ctx->stats.rate_sec);
+    if (sec == bucket) {
+        out->connections_per_sec = (uint32_t)atomic_load(&ctx->stats.rate_last);
+    } else if (sec == bucket + 1U) {
+        out->connections_per_sec = (uint32_t)atomic_load(&ctx->stats.rate_count);
+    }
+
+    struct ftp_acceptors *set = ctx->acceptor_set;
+    if (set != NULL) {
+        pthread_mutex_lock(&set->lock);
+        out->start_queue_depth = set->len;
+        out->start_queue_peak = set->peak;
+        pthread_mutex_unlock(&set->lock);
+    }
+}
@@ -34,8 +34,14 @@ SOFTWARE.
 
 #include "ftp_session.h"
 #include "ftp_server.h"   /* ftp_server_release_session() — called at thread exit */
+#include "ftp_buffer_pool.h"
 #include "ftp_crypto.h"
+#include "ftp_fxp.h"
+#include "ftp_hash.h"
 #include "ftp_log.h"
+#include "ftp_metrics.h"
+#include "ftp_pasv_pool.h"
+#include "ftp_prefetch.h"
 #include "ftp_path.h"
 #include "ftp_protocol.h"
 #include "pal_fileio.h"
@@ -49,10 +55,76 @@ SOFTWARE.
 #include <time.h>
 #include <unistd.h>
 
+static int wait_fd_ready(int fd, int for_write, uint32_t timeout_ms);
+
 /*===========================================================================*
  * SESSION LIFECYCLE
  *===========================================================================*/
 
+/*
+ * Path block slab.  Blocks are recycled rather than freed so sessions
+ * that come and go (one connection per file) do not churn the heap;
+ * at most SESSION_PATHS_KEEP idle blocks are kept.
+ */
+#define SESSION_PATHS_KEEP 8U
+
+static pthread_mutex_t g_paths_lock = PTHREAD_MUTEX_INITIALIZER;
+static ftp_session_paths_t *g_paths_free = NULL;
+static unsigned g_paths_idle = 0U;
+
+static int session_paths_attach(ftp_session_t *session) {
+  pthread_mutex_lock(&g_paths_lock);
+  ftp_session_paths_t *p = g_paths_free;
+  if (p != NULL) {
+    g_paths_free = p->next_free;
+    g_paths_idle--;
+  }
+  pthread_mutex_unlock(&g_paths_lock);
+
+  if (p == NULL) {
+    p = malloc(sizeof(*p));
+    if (p == NULL) {
+      return -1;
+    }
+  }
+  p->next_free = NULL;
+  ftp_path_cache_init(p);
+  p->root_path[0] = '\0';
+  p->cwd[0] = '\0';
+  p->rename_from[0] = '\0';
+  p->copy_from[0] = '\0';
+
+  session->paths = p;
+  session->root_path = p->root_path;
+  session->cwd = p->cwd;
+  session->rename_from = p->rename_from;
+  session->copy_from = p->copy_from;
+  return 0;
+}
+
+static void session_paths_detach(ftp_session_t *session) {
+  ftp_session_paths_t *p = session->paths;
+  if (p == NULL) {
+    return;
+  }
+  session->paths = NULL;
+  session->root_path = NULL;
+  session->cwd = NULL;
+  session->rename_from = NULL;
+  session->copy_from = NULL;
+  ftp_path_cache_release(p);
+
+  pthread_mutex_lock(&g_paths_lock);
+  if (g_paths_idle < SESSION_PATHS_KEEP) {
+    p->next_free = g_paths_free;
+    g_paths_free = p;
+    g_paths_idle++;
+    p = NULL;
+  }
+  pthread_mutex_unlock(&g_paths_lock);
+  free(p);
+}
+
 /**
  * @brief Initialize session structure
  */
@@ -90,6 +162,8 @@ ftp_error_t ftp_session_init(ftp_session_t *session, int ctrl_fd,
   /* Data connection (initially closed) */
   session->data_fd = -1;
   session->pasv_fd = -1;
+  session->sock_tune.fd = -1;
+  pal_zc_begin(&session->zc, -1);
   session->data_mode = FTP_DATA_MODE_NONE;
 
   /* Session state */
@@ -100,11 +174,19 @@ ftp_error_t ftp_session_init(ftp_session_t *session, int ctrl_fd,
   session->transfer_mode = FTP_MODE_STREAM;
   session->file_structure = FTP_STRU_FILE;
   session->restart_offset = 0;
+  session->alloc_size = 0U;
+#if FTP_ENABLE_HASH
+  session->hash_algo = (uint8_t)FTP_HASH_SHA256;
+  session->hash_chosen = 0U;
+#endif
 
   size_t root_len = strlen(root_path);
-  if (root_len >= sizeof(session->root_path)) {
+  if (root_len >= FTP_PATH_MAX) {
     return FTP_ERR_PATH_TOO_LONG;
   }
+  if (session_paths_attach(session) != 0) {
+    return FTP_ERR_OUT_OF_MEMORY;
+  }
   memcpy(session->root_path, root_path, root_len + 1U);
   memcpy(session->cwd, root_path, root_len + 1U);
 
@@ -112,7 +194,7 @@ ftp_error_t ftp_session_init(ftp_session_t *session, int ctrl_fd,
     char real_buf[FTP_PATH_MAX];
     if (realpath(session->root_path, real_buf) != NULL) {
       size_t n = strlen(real_buf);
-      if (n < sizeof(session->root_path)) {
+      if (n < FTP_PATH_MAX) {
         memcpy(session->root_path, real_buf, n + 1U);
         memcpy(session->cwd, real_buf, n + 1U);
       }
@@ -121,9 +203,6 @@ ftp_error_t ftp_session_init(ftp_session_t *session, int ctrl_fd,
 
   session->rename_from[0] = '\0';
   session->copy_from[0] = '\0';
-  pthread_mutex_init(&session->copy_mutex, NULL);
-  session->copy_in_progress = 0;
-  session->copy_thread_valid = 0;
 
   /* Authentication */
   session->auth_attempts = 0U;
@@ -140,9 +219,6 @@ ftp_error_t ftp_session_init(ftp_session_t *session, int ctrl_fd,
   session->connect_time = time(NULL);
   session->last_activity = session->connect_time;
 
-  session->rl_tokens = 0U;
-  session->rl_last_ns = 0U;
-
   /* Crypto: start with encryption disabled (cleared by memset above) */
 #if FTP_ENABLE_CRYPTO
   ftp_crypto_reset(&session->crypto);
@@ -167,6 +243,9 @@ ftp_error_t ftp_session_init(ftp_session_t *session, int ctrl_fd,
   atomic_store(&session->stats.commands_processed, 0U);
   atomic_store(&session->stats.errors, 0U);
 
+  /* Bandwidth scheduler: counted toward the global and per-IP buckets */
+  ftp_bw_attach(&session->bw, session->ctrl_addr.sin_addr.s_addr);
+
   return FTP_OK;
 }
 
@@ -181,14 +260,19 @@ void ftp_session_cleanup(ftp_session_t *session) {
   /* Set state to terminating */
   atomic_store(&session->state, FTP_STATE_TERMINATING);
 
-  /* Wait for active copy to finish and destroy mutex */
-  if (session->copy_thread_valid) {
-    pthread_join(session->copy_thread, NULL);
-  }
-  pthread_mutex_destroy(&session->copy_mutex);
-
   /* Close data connection */
   ftp_session_close_data_connection(session);
+  ftp_trace_end(&session->trace, 0, 0U); /* publish a transfer cut short */
+  ftp_prefetch_session_end(session);
+
+#if FTP_ENABLE_TLS
+  if (session->ctrl_tls != NULL) {
+    pal_tls_close(session->ctrl_tls);
+    session->ctrl_tls = NULL;
+  }
+  session->pbsz_set = 0U;
+  session->prot_private = 0U;
+#endif
 
   /* Close control connection */
   if (session->ctrl_fd >= 0) {
@@ -200,72 +284,113 @@ void ftp_session_cleanup(ftp_session_t *session) {
 #if FTP_ENABLE_CRYPTO
   ftp_crypto_reset(&session->crypto);
 #endif
+
+  /* Path strings go back to the slab (copy thread joined above) */
+  session_paths_detach(session);
+
+  ftp_bw_detach(&session->bw);
 }
 
 /**
- * @brief Session thread entry point
+ * @brief Start a session: greeting and CONNECT log
  */
-void *ftp_session_thread(void *arg) {
-  ftp_session_t *session = (ftp_session_t *)arg;
-
+void ftp_session_begin(ftp_session_t *session) {
   if (session == NULL) {
-    return NULL;
+    return;
   }
 
   /* Send greeting */
   ftp_session_send_reply(session, FTP_REPLY_220_SERVICE_READY, NULL);
 
   ftp_log_session_event(session, "CONNECT", FTP_OK, 0U);
+}
 
-  /* Command processing loop */
+/**
+ * @brief Read and execute one command line
+ */
+ftp_session_step_t ftp_session_serve_command(ftp_session_t *session) {
+  if (session == NULL) {
+    return FTP_SESSION_STEP_END;
+  }
+
+  /* Read command line */
   char cmd_buffer[FTP_CMD_BUFFER_SIZE];
-  int should_quit = 0;
-
-  while (!should_quit) {
-    time_t now = time(NULL);
-    if ((now != (time_t)-1) && (now > session->last_activity)) {
-      if ((uint64_t)(now - session->last_activity) >
-          (uint64_t)FTP_SESSION_TIMEOUT) {
-        (void)ftp_session_send_reply(session, FTP_REPLY_421_SERVICE_UNAVAIL,
-                                     "Idle timeout.");
-        ftp_log_session_event(session, "IDLE_TIMEOUT", FTP_ERR_TIMEOUT, 0U);
-        break;
-      }
+  ssize_t n =
+      ftp_session_read_command(session, cmd_buffer, sizeof(cmd_buffer));
+
+  if (n == 0) {
+    return FTP_SESSION_STEP_END;
+  }
+  if (n < 0) {
+    if ((n == (ssize_t)FTP_ERR_TIMEOUT) || (n == (ssize_t)FTP_ERR_PROTOCOL)) {
+      return FTP_SESSION_STEP_IDLE;
     }
+    return FTP_SESSION_STEP_END;
+  }
 
-    /* Read command line */
-    ssize_t n =
-        ftp_session_read_command(session, cmd_buffer, sizeof(cmd_buffer));
+  /* Update activity timestamp */
+  session->last_activity = time(NULL);
 
-    if (n == 0) {
-      break;
-    }
-    if (n < 0) {
-      if (n == (ssize_t)FTP_ERR_TIMEOUT) {
-        continue;
-      }
-      if (n == (ssize_t)FTP_ERR_PROTOCOL) {
-        continue;
-      }
-      break;
-    }
+  /* Process command */
+  int result = ftp_session_process_command(session, cmd_buffer);
 
-    /* Update activity timestamp */
-    session->last_activity = time(NULL);
+  if (result != 0) {
+    /* QUIT (1) is a graceful exit, an error (< 0) terminates the session */
+    return FTP_SESSION_STEP_END;
+  }
 
-    /* Process command */
-    int result = ftp_session_process_command(session, cmd_buffer);
+  /* Increment command counter */
+  atomic_fetch_add(&session->stats.commands_processed, 1U);
+  return FTP_SESSION_STEP_MORE;
+}
 
-    if (result == 1) {
-      /* QUIT command: graceful exit */
-      should_quit = 1;
-    } else if (result < 0) {
-      /* Error: terminate session */
-      break;
-    }
+/**
+ * @brief Check the idle limit
+ */
+int ftp_session_idle_expired(const ftp_session_t *session, time_t now) {
+  if ((session == NULL) || (now == (time_t)-1) ||
+      (now <= session->last_activity)) {
+    return 0;
+  }
+  return ((uint64_t)(now - session->last_activity) >
+          (uint64_t)FTP_SESSION_TIMEOUT)
+             ? 1
+             : 0;
+}
 
-    /* Increment command counter */
-    atomic_fetch_add(&session->stats.commands_processed, 1U);
+/**
+ * @brief Send 421 and log the idle timeout
+ */
+void ftp_session_expire(ftp_session_t *session) {
+  (void)ftp_session_send_reply(session, FTP_REPLY_421_SERVICE_UNAVAIL,
+                               "Idle timeout.");
+  ftp_log_session_event(session, "IDLE_TIMEOUT", FTP_ERR_TIMEOUT, 0U);
+}
+
+/**
+ * @brief Check for control input readable without blocking
+ */
+int ftp_session_input_pending(ftp_session_t *session) {
+  if ((session == NULL) || (session->ctrl_fd < 0)) {
+    return 0;
+  }
+  if (session->ctrl_rx_off < session->ctrl_rx_len) {
+    return 1;
+  }
+#if FTP_ENABLE_TLS
+  if ((session->ctrl_tls != NULL) && (pal_tls_pending(session->ctrl_tls) > 0)) {
+    return 1;
+  }
+#endif
+  return (wait_fd_ready(session->ctrl_fd, 0, 0U) > 0) ? 1 : 0;
+}
+
+/**
+ * @brief Finish a session and release its slot
+ */
+void ftp_session_end(ftp_session_t *session) {
+  if (session == NULL) {
+    return;
   }
 
   /* Cleanup and exit */
@@ -302,10 +427,36 @@ void *ftp_session_thread(void *arg) {
    * session's FDs are still open.
    *
    * session->server_ctx is guaranteed non-NULL here: it is set in
-   * server_accept_thread before pthread_create(), and this function only
-   * runs inside the created thread.
+   * server_accept_thread before the session is handed to its thread or
+   * to the event engine.
    */
   ftp_server_release_session(session->server_ctx, session);
+}
+
+/**
+ * @brief Session thread entry point
+ */
+void *ftp_session_thread(void *arg) {
+  ftp_session_t *session = (ftp_session_t *)arg;
+
+  if (session == NULL) {
+    return NULL;
+  }
+
+  ftp_session_begin(session);
+
+  /* Command processing loop */
+  for (;;) {
+    if (ftp_session_idle_expired(session, time(NULL)) != 0) {
+      ftp_session_expire(session);
+      break;
+    }
+    if (ftp_session_serve_command(session) == FTP_SESSION_STEP_END) {
+      break;
+    }
+  }
+
+  ftp_session_end(session);
 
   return NULL;
 }
@@ -314,6 +465,34 @@ void *ftp_session_thread(void *arg) {
  * REPLY SENDING
  *===========================================================================*/
 
+/**
+ * @brief Send raw bytes on the control connection (TLS after AUTH TLS)
+ */
+ftp_error_t ftp_session_send_control(ftp_session_t *session,
+                                     const void *data, size_t len) {
+  if ((session == NULL) || (data == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  if (session->ctrl_fd < 0) {
+    return FTP_ERR_SOCKET_SEND;
+  }
+
+  if (len == 0U) {
+    return FTP_OK;
+  }
+
+#if FTP_ENABLE_TLS
+  if (session->ctrl_tls != NULL) {
+    int sent = pal_tls_send(session->ctrl_tls, data, len);
+    return (sent == (int)len) ? FTP_OK : FTP_ERR_SOCKET_SEND;
+  }
+#endif
+
+  ssize_t sent = pal_send_all(session->ctrl_fd, data, len, 0);
+  return (sent == (ssize_t)len) ? FTP_OK : FTP_ERR_SOCKET_SEND;
+}
+
 /**
  * @brief Send FTP reply to client
  */
@@ -336,12 +515,7 @@ ftp_error_t ftp_session_send_reply(ftp_session_t *session,
   }
 
   /* Send reply */
-  ssize_t sent = pal_send_all(session->ctrl_fd, buffer, (size_t)len, 0);
-  if (sent != len) {
-    return FTP_ERR_SOCKET_SEND;
-  }
-
-  return FTP_OK;
+  return ftp_session_send_control(session, buffer, (size_t)len);
 }
 
 /**
@@ -368,8 +542,7 @@ ftp_error_t ftp_session_send_multiline_reply(ftp_session_t *session,
       return FTP_ERR_INVALID_PARAM;
     }
 
-    ssize_t sent = pal_send_all(session->ctrl_fd, buffer, (size_t)n, 0);
-    if (sent != n) {
+    if (ftp_session_send_control(session, buffer, (size_t)n) != FTP_OK) {
       return FTP_ERR_SOCKET_SEND;
     }
   }
@@ -382,12 +555,7 @@ ftp_error_t ftp_session_send_multiline_reply(ftp_session_t *session,
     return FTP_ERR_INVALID_PARAM;
   }
 
-  ssize_t sent = pal_send_all(session->ctrl_fd, buffer, (size_t)n, 0);
-  if (sent != n) {
-    return FTP_ERR_SOCKET_SEND;
-  }
-
-  return FTP_OK;
+  return ftp_session_send_control(session, buffer, (size_t)n);
 }
 
 /*===========================================================================*
@@ -453,68 +621,6 @@ static uint64_t monotonic_ns(void) {
   return 0U;
 }
 
-static void rate_limit(ftp_session_t *session, size_t bytes) {
-  if ((session == NULL) || (bytes == 0U)) {
-    return;
-  }
-
-  uint64_t rate = (uint64_t)FTP_TRANSFER_RATE_LIMIT_BPS;
-  if (rate == 0U) {
-    return;
-  }
-
-  uint64_t burst = (uint64_t)FTP_TRANSFER_RATE_BURST_BYTES;
-  uint64_t cap = (burst != 0U) ? burst : rate;
-
-  uint64_t now = monotonic_ns();
-  if (now == 0U) {
-    return;
-  }
-
-  if (session->rl_last_ns == 0U) {
-    session->rl_last_ns = now;
-    session->rl_tokens = cap;
-  } else if (now > session->rl_last_ns) {
-    uint64_t elapsed = now - session->rl_last_ns;
-    uint64_t add = (elapsed * rate) / 1000000000ULL;
-    session->rl_last_ns = now;
-    if (add > 0U) {
-      uint64_t t = session->rl_tokens + add;
-      session->rl_tokens = (t > cap) ? cap : t;
-    }
-  }
-
-  uint64_t need = (uint64_t)bytes;
-  while (session->rl_tokens < need) {
-    uint64_t missing = need - session->rl_tokens;
-    uint64_t wait_ns = (missing * 1000000000ULL + rate - 1U) / rate;
-    uint64_t wait_us = (wait_ns + 999ULL) / 1000ULL;
-    if (wait_us > 500000ULL) {
-      wait_us = 500000ULL;
-    }
-    usleep((useconds_t)wait_us);
-
-    now = monotonic_ns();
-    if ((now != 0U) && (now > session->rl_last_ns)) {
-      uint64_t elapsed = now - session->rl_last_ns;
-      uint64_t add = (elapsed * rate) / 1000000000ULL;
-      session->rl_last_ns = now;
-      if (add > 0U) {
-        uint64_t t = session->rl_tokens + add;
-        session->rl_tokens = (t > cap) ? cap : t;
-      }
-    } else {
-      break;
-    }
-  }
-
-  if (session->rl_tokens >= need) {
-    session->rl_tokens -= need;
-  } else {
-    session->rl_tokens = 0U;
-  }
-}
-
 /**
  * @brief Open data connection
  */
@@ -527,6 +633,8 @@ ftp_error_t ftp_session_open_data_connection(ftp_session_t *session) {
     return FTP_ERR_INVALID_PARAM;
   }
 
+  uint64_t connect_start = monotonic_ns();
+
   if (session->data_mode == FTP_DATA_MODE_ACTIVE) {
     /* Active mode: Connect to client.
      * GoldHEN/ftpsrv uses a simple blocking connect().
@@ -588,25 +696,55 @@ ftp_error_t ftp_session_open_data_connection(ftp_session_t *session) {
     struct sockaddr_in client_addr;
     socklen_t addr_len = sizeof(client_addr);
 
-    int ready = wait_fd_ready(session->pasv_fd, 0, FTP_DATA_CONNECT_TIMEOUT_MS);
-    if (ready <= 0) {
-      PAL_CLOSE(session->pasv_fd);
-      session->pasv_fd = -1;
-      return FTP_ERR_TIMEOUT;
-    }
+    /*
+     * Pooled listeners sit on predictable ports, so only the control
+     * connection's peer (or an FXP server on the ftp_fxp.h allow-list) may
+     * connect (FTP_PASV_PEER_CHECK); anyone else is dropped and the wait
+     * continues until the connect timeout.
+     */
+    uint64_t wait_start = monotonic_ns();
+    uint64_t deadline =
+        wait_start + ((uint64_t)FTP_DATA_CONNECT_TIMEOUT_MS * 1000000ULL);
+    int fd = -1;
+    while (fd < 0) {
+      uint64_t now = monotonic_ns();
+      uint32_t wait_ms =
+          (now < deadline) ? (uint32_t)((deadline - now) / 1000000ULL) : 0U;
+      int ready = (wait_ms > 0U)
+                      ? wait_fd_ready(session->pasv_fd, 0, wait_ms)
+                      : 0;
+      if (ready <= 0) {
+        ftp_session_release_pasv(session);
+        return FTP_ERR_TIMEOUT;
+      }
 
-    int fd = PAL_ACCEPT(session->pasv_fd, (struct sockaddr *)&client_addr,
-                        &addr_len);
+      addr_len = sizeof(client_addr);
+      fd = PAL_ACCEPT(session->pasv_fd, (struct sockaddr *)&client_addr,
+                      &addr_len);
+      if (fd < 0) {
+        return FTP_ERR_SOCKET_ACCEPT;
+      }
 
-    if (fd < 0) {
-      return FTP_ERR_SOCKET_ACCEPT;
+#if FTP_PASV_PEER_CHECK
+      if ((session->ctrl_addr.sin_addr.s_addr != 0U) &&
+          (client_addr.sin_addr.s_addr !=
+           session->ctrl_addr.sin_addr.s_addr) &&
+          (ftp_fxp_allowed(client_addr.sin_addr.s_addr) == 0)) {
+        char dbg[96];
+        snprintf(dbg, sizeof(dbg), "[PASV] rejected data peer %s",
+                 inet_ntoa(client_addr.sin_addr));
+        ftp_log_line(FTP_LOG_WARN, dbg);
+        PAL_CLOSE(fd);
+        fd = -1;
+      }
+#endif
     }
 
     session->data_fd = fd;
+    ftp_metrics_observe(FTP_METRIC_PASV_ACCEPT, monotonic_ns() - wait_start);
 
-    /* Close passive listener (one connection only) */
-    PAL_CLOSE(session->pasv_fd);
-    session->pasv_fd = -1;
+    /* One connection per lease: the listener goes back to the pool */
+    ftp_session_release_pasv(session);
 
     /*
      * SO_RCVBUF post-accept: conditional bump only.
@@ -671,6 +809,16 @@ ftp_error_t ftp_session_open_data_connection(ftp_session_t *session) {
    */
   (void)pal_socket_configure_data(session->data_fd);
 
+  /* Metrics: first byte measured from the command, throughput from here */
+  atomic_store(&session->first_byte_ns, session->cmd_start_ns);
+  session->data_open_ns = monotonic_ns();
+  session->data_base_sent = atomic_load(&session->stats.bytes_sent);
+  session->data_base_received = atomic_load(&session->stats.bytes_received);
+  pal_sock_tune_begin(&session->sock_tune, session->data_fd, 0, 0U,
+                      session->data_open_ns);
+  pal_zc_begin(&session->zc, session->data_fd);
+  ftp_trace_mark(&session->trace, FTP_TRACE_CONNECT, connect_start, 0U, 0U);
+
   if (atomic_load(&session->state) != FTP_STATE_TERMINATING) {
     atomic_store(&session->state, FTP_STATE_TRANSFERRING);
   }
@@ -678,6 +826,43 @@ ftp_error_t ftp_session_open_data_connection(ftp_session_t *session) {
   return FTP_OK;
 }
 
+#if FTP_ENABLE_TLS
+/**
+ * @brief Run the TLS handshake on the data connection (PROT P)
+ *
+ * The client starts a handshake on every data connection (RFC 4217 §9);
+ * the server context's session cache lets it resume the control session
+ * instead of a full handshake.
+ */
+ftp_error_t ftp_session_start_data_tls(ftp_session_t *session) {
+  if (session == NULL) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  if ((session->prot_private == 0U) || (session->data_tls != NULL)) {
+    return FTP_OK;
+  }
+
+  if (session->data_fd < 0) {
+    return FTP_ERR_SOCKET_ACCEPT;
+  }
+
+  pal_tls_server_t *srv =
+      (session->server_ctx != NULL) ? session->server_ctx->tls : NULL;
+  session->data_tls = pal_tls_accept(srv, session->data_fd);
+  if (session->data_tls == NULL) {
+    ftp_log_line(FTP_LOG_WARN, "[TLS] data channel handshake failed");
+    return FTP_ERR_SOCKET_ACCEPT;
+  }
+
+  return FTP_OK;
+}
+#endif
+
+#if FTP_ENABLE_MODEZ
+static void zstream_end(ftp_session_t *session);
+#endif
+
 /**
  * @brief Close data connection
  */
@@ -686,6 +871,33 @@ void ftp_session_close_data_connection(ftp_session_t *session) {
     return;
   }
 
+#if FTP_ENABLE_MODEZ
+  zstream_end(session); /* final deflate block goes out before close */
+#endif
+
+#if FTP_ENABLE_TLS
+  if (session->data_tls != NULL) {
+    pal_tls_close(session->data_tls); /* close_notify, then plain close */
+    session->data_tls = NULL;
+  }
+#endif
+
+#if FTP_ZEROCOPY
+  /* Pages still referenced by the send queue go back only once freed */
+  void *zc_done[FTP_ZEROCOPY_INFLIGHT];
+  uint32_t zc_n = 0U;
+  if (session->zc.fd >= 0) {
+    zc_n = pal_zc_end(&session->zc,
+                      (uint32_t)FTP_DATA_LINGER_TIMEOUT_S * 1000U, zc_done);
+    if (session->zc.bytes != 0U) {
+      ftp_metrics_add(FTP_METRIC_ZEROCOPY_BYTES, session->zc.bytes);
+    }
+    if (session->zc.copied != 0U) {
+      ftp_metrics_add(FTP_METRIC_ZEROCOPY_COPIED, session->zc.copied);
+    }
+  }
+#endif
+
   if (session->data_fd >= 0) {
     /* Simple close — matches GoldHEN/ftpsrv exactly.
      *
@@ -698,12 +910,27 @@ void ftp_session_close_data_connection(ftp_session_t *session) {
     PAL_CLOSE(session->data_fd);
     session->data_fd = -1;
   }
+  session->sock_tune.fd = -1;
+#if FTP_ZEROCOPY
+  for (uint32_t i = 0U; i < zc_n; i++) {
+    ftp_buffer_release(zc_done[i]);
+  }
+  pal_zc_begin(&session->zc, -1);
+#endif
 
-  if (session->pasv_fd >= 0) {
-    PAL_CLOSE(session->pasv_fd);
-    session->pasv_fd = -1;
+  if (session->data_open_ns != 0U) {
+    uint64_t ns = monotonic_ns() - session->data_open_ns;
+    uint64_t tx = atomic_load(&session->stats.bytes_sent) -
+                  session->data_base_sent;
+    uint64_t rx = atomic_load(&session->stats.bytes_received) -
+                  session->data_base_received;
+    ftp_metrics_transfer((rx > tx) ? 1 : 0, (rx > tx) ? rx : tx, ns);
+    session->data_open_ns = 0U;
+    atomic_store(&session->first_byte_ns, 0U);
   }
 
+  ftp_session_release_pasv(session);
+
   session->data_mode = FTP_DATA_MODE_NONE;
   session->restart_offset = 0;
 
@@ -715,10 +942,129 @@ void ftp_session_close_data_connection(ftp_session_t *session) {
 }
 
 /**
- * @brief Send data via data connection
+ * @brief Give the passive listener back to the server's pool
  */
-ssize_t ftp_session_send_data(ftp_session_t *session, const void *buffer,
-                              size_t length) {
+void ftp_session_release_pasv(ftp_session_t *session) {
+  if ((session == NULL) || (session->pasv_fd < 0)) {
+    return;
+  }
+  struct ftp_pasv_pool *pool =
+      (session->server_ctx != NULL) ? session->server_ctx->pasv_pool : NULL;
+  ftp_pasv_pool_return(pool, session->pasv_fd);
+  session->pasv_fd = -1;
+}
+
+/*
+ * Sample the data socket every FTP_SOCK_TUNE_INTERVAL_MS and let
+ * pal_sock_tune_tick() grow its buffer when the BDP outruns it.  The
+ * direction is whichever counter moved: the tuner restarts on the
+ * receive side the first time uploads turn out to dominate.
+ */
+static void data_sock_tune(ftp_session_t *session) {
+  pal_sock_tune_t *t = &session->sock_tune;
+  if (t->fd < 0) {
+    return;
+  }
+  uint64_t now = monotonic_ns();
+  if (now < t->next_ns) {
+    return;
+  }
+
+  uint64_t tx = atomic_load(&session->stats.bytes_sent) -
+                session->data_base_sent;
+  uint64_t rx = atomic_load(&session->stats.bytes_received) -
+                session->data_base_received;
+  int dir_rx = (rx > tx) ? 1 : 0;
+  if (dir_rx != t->rx) {
+    pal_sock_tune_begin(t, t->fd, dir_rx, rx, now);
+    return;
+  }
+
+  uint32_t resizes = t->resizes;
+  if (pal_sock_tune_tick(t, (dir_rx != 0) ? rx : tx, now) == 0) {
+    return;
+  }
+  ftp_metrics_observe(FTP_METRIC_TCP_RTT, (uint64_t)t->info.rtt_us * 1000U);
+  ftp_metrics_observe(FTP_METRIC_TCP_CWND, t->info.cwnd_bytes);
+  ftp_metrics_observe(FTP_METRIC_TCP_SENDQ, t->info.sendq_bytes);
+  ftp_metrics_observe(FTP_METRIC_SOCKBUF, t->buf);
+  if (t->retrans_delta != 0U) {
+    ftp_metrics_add(FTP_METRIC_TCP_RETRANS, t->retrans_delta);
+  }
+  if (t->resizes != resizes) {
+    ftp_metrics_add(FTP_METRIC_SOCKBUF_RESIZES, t->resizes - resizes);
+  }
+}
+
+/**
+ * @brief Note that data bytes moved (time-to-first-byte)
+ */
+void ftp_session_note_first_byte(ftp_session_t *session) {
+  if (ftp_metrics_first_byte(&session->first_byte_ns) != 0) {
+    ftp_trace_mark(&session->trace, FTP_TRACE_FIRST_BYTE, 0U, 0U, 0U);
+  }
+  data_sock_tune(session);
+}
+
+#if FTP_ZEROCOPY
+/*
+ * Return the buffers the kernel is done with to the pool.  Waits only
+ * when every owner slot is taken, which is where a copying send would
+ * block on a full socket buffer anyway.
+ */
+static void zc_reap(ftp_session_t *session) {
+  pal_zc_t *zc = &session->zc;
+  if (zc->parked == 0U) {
+    return;
+  }
+  void *done[FTP_ZEROCOPY_INFLIGHT];
+  uint32_t wait_ms = (zc->parked >= FTP_ZEROCOPY_INFLIGHT)
+                         ? (uint32_t)FTP_DATA_IO_TIMEOUT_MS
+                         : 0U;
+  uint32_t n = pal_zc_reap(zc, wait_ms, done, FTP_ZEROCOPY_INFLIGHT);
+  for (uint32_t i = 0U; i < n; i++) {
+    ftp_buffer_release(done[i]);
+  }
+}
+
+/*
+ * Send pool buffer *buf (cap bytes) on the plain TCP data socket.  When
+ * it leaves zerocopy the session keeps it and *buf becomes a fresh
+ * buffer; otherwise this is pal_send_all().
+ */
+static ssize_t zc_send(ftp_session_t *session, void **buf, size_t cap,
+                       size_t length) {
+  zc_reap(session);
+  if ((length < FTP_ZEROCOPY_MIN) || (pal_zc_usable(&session->zc) == 0)) {
+    return pal_send_all(session->data_fd, *buf, length, 0);
+  }
+  void *fresh = ftp_buffer_acquire_size(cap, NULL);
+  if (fresh == NULL) {
+    return pal_send_all(session->data_fd, *buf, length, 0);
+  }
+  int parked = 0;
+  ssize_t sent = pal_zc_send(&session->zc, *buf, length, *buf, &parked);
+  if (parked != 0) {
+    *buf = fresh;
+  } else {
+    ftp_buffer_release(fresh);
+  }
+  return sent;
+}
+#endif
+
+/**
+ * @brief Put bytes on the data connection (after MODE Z, before the wire)
+ *
+ * @p owned, when not NULL, points at @p buffer as a pool buffer of
+ * @p cap bytes that may be kept for MSG_ZEROCOPY (see zc_send()).
+ */
+static ssize_t data_send_wire(ftp_session_t *session, const void *buffer,
+                              size_t length, void **owned, size_t cap) {
+#if !FTP_ZEROCOPY
+  (void)owned;
+  (void)cap;
+#endif
   if ((session == NULL) || (buffer == NULL) || (length == 0U)) {
     return FTP_ERR_INVALID_PARAM;
   }
@@ -727,7 +1073,14 @@ ssize_t ftp_session_send_data(ftp_session_t *session, const void *buffer,
     return FTP_ERR_SOCKET_SEND;
   }
 
-  rate_limit(session, length);
+#if FTP_ENABLE_TLS
+  if (ftp_session_start_data_tls(session) != FTP_OK) {
+    return FTP_ERR_SOCKET_SEND;
+  }
+#endif
+
+  ftp_bw_consume(&session->bw, length);
+  ftp_session_note_first_byte(session);
 
   /*
    * ChaCha20 encrypt before sending
@@ -743,6 +1096,32 @@ ssize_t ftp_session_send_data(ftp_session_t *session, const void *buffer,
     size_t todo = length;
     ssize_t total = 0;
 
+#if FTP_ZEROCOPY
+    /*
+     * Large sends XOR into a pool buffer instead: the copy happens
+     * anyway, and the ciphertext can then leave zerocopy.
+     */
+    size_t zcap = 0U;
+    void *zbuf = ((length >= FTP_ZEROCOPY_MIN) &&
+                  (pal_zc_usable(&session->zc) != 0))
+                     ? ftp_buffer_acquire_size(length, &zcap)
+                     : NULL;
+    while ((zbuf != NULL) && (todo > 0U)) {
+      size_t chunk = (todo < zcap) ? todo : zcap;
+      memcpy(zbuf, src, chunk);
+      ftp_crypto_xor(&session->crypto, zbuf, chunk);
+      ssize_t sent = zc_send(session, &zbuf, zcap, chunk);
+      if (sent <= 0) {
+        ftp_buffer_release(zbuf);
+        return (total > 0) ? total : sent;
+      }
+      total += sent;
+      src += chunk;
+      todo -= chunk;
+    }
+    ftp_buffer_release(zbuf);
+#endif
+
     while (todo > 0U) {
       uint8_t scratch[4096];
       size_t chunk = (todo < sizeof(scratch)) ? todo : sizeof(scratch);
@@ -764,7 +1143,27 @@ ssize_t ftp_session_send_data(ftp_session_t *session, const void *buffer,
   }
 #endif
 
-  ssize_t sent = pal_send_all(session->data_fd, buffer, length, 0);
+#if FTP_ENABLE_TLS
+  if (session->data_tls != NULL) {
+    int n = pal_tls_send(session->data_tls, buffer, length);
+    if (n <= 0) {
+      return (ssize_t)FTP_ERR_SOCKET_SEND;
+    }
+    session->last_activity = time(NULL);
+    atomic_fetch_add(&session->stats.bytes_sent, (uint64_t)n);
+    return (ssize_t)n;
+  }
+#endif
+
+  ssize_t sent;
+#if FTP_ZEROCOPY
+  if (owned != NULL) {
+    sent = zc_send(session, owned, cap, length);
+  } else
+#endif
+  {
+    sent = pal_send_all(session->data_fd, buffer, length, 0);
+  }
 
   if (sent > 0) {
     session->last_activity = time(NULL);
@@ -775,9 +1174,9 @@ ssize_t ftp_session_send_data(ftp_session_t *session, const void *buffer,
 }
 
 /**
- * @brief Receive data via data connection
+ * @brief Take bytes off the data connection (before MODE Z)
  */
-ssize_t ftp_session_recv_data(ftp_session_t *session, void *buffer,
+static ssize_t data_recv_wire(ftp_session_t *session, void *buffer,
                               size_t length) {
   if ((session == NULL) || (buffer == NULL) || (length == 0U)) {
     return FTP_ERR_INVALID_PARAM;
@@ -787,9 +1186,30 @@ ssize_t ftp_session_recv_data(ftp_session_t *session, void *buffer,
     return FTP_ERR_SOCKET_RECV;
   }
 
-  ssize_t received = PAL_RECV(session->data_fd, buffer, length, 0);
+#if FTP_ENABLE_TLS
+  if (ftp_session_start_data_tls(session) != FTP_OK) {
+    return FTP_ERR_SOCKET_RECV;
+  }
+#endif
+
+  ssize_t received;
+#if FTP_ENABLE_TLS
+  if (session->data_tls != NULL) {
+    int n = pal_tls_recv(session->data_tls, buffer, length);
+    if (n < 0) {
+      errno = (n == PAL_TLS_ERR_TIMEOUT) ? EAGAIN : EIO;
+      received = -1;
+    } else {
+      received = (ssize_t)n;
+    }
+  } else
+#endif
+  {
+    received = PAL_RECV(session->data_fd, buffer, length, 0);
+  }
 
   if (received > 0) {
+    ftp_session_note_first_byte(session);
     /*
      * ChaCha20 decrypt after receiving
      *
@@ -801,13 +1221,122 @@ ssize_t ftp_session_recv_data(ftp_session_t *session, void *buffer,
     }
 #endif
     session->last_activity = time(NULL);
-    rate_limit(session, (size_t)received);
+    ftp_bw_consume(&session->bw, (size_t)received);
     atomic_fetch_add(&session->stats.bytes_received, (uint64_t)received);
   }
 
   return received;
 }
 
+#if FTP_ENABLE_MODEZ
+static ssize_t zstream_sink(void *ctx, const void *buf, size_t len) {
+  return data_send_wire((ftp_session_t *)ctx, buf, len, NULL, 0U);
+}
+
+static ssize_t zstream_source(void *ctx, void *buf, size_t len) {
+  return data_recv_wire((ftp_session_t *)ctx, buf, len);
+}
+
+/**
+ * @brief Stream for this data connection, created on first use
+ */
+static ftp_zstream_t *zstream_get(ftp_session_t *session,
+                                  ftp_zstream_dir_t dir) {
+  if ((session->zstream != NULL) &&
+      (ftp_zstream_dir(session->zstream) != dir)) {
+    ftp_zstream_destroy(session->zstream);
+    session->zstream = NULL;
+  }
+  if (session->zstream == NULL) {
+    session->zstream = ftp_zstream_create(dir, FTP_MODEZ_LEVEL);
+  }
+  return session->zstream;
+}
+
+/**
+ * @brief Flush (deflate) and free the MODE Z stream of the data connection
+ */
+static void zstream_end(ftp_session_t *session) {
+  ftp_zstream_t *z = session->zstream;
+  if (z == NULL) {
+    return;
+  }
+  session->zstream = NULL;
+
+  if ((ftp_zstream_dir(z) == FTP_ZSTREAM_DEFLATE) && (session->data_fd >= 0)) {
+    (void)ftp_zstream_finish(z, zstream_sink, session);
+  }
+
+  uint64_t raw = 0U;
+  uint64_t wire = 0U;
+  int level = 0;
+  ftp_zstream_stats(z, &raw, &wire, &level);
+  char line[128];
+  (void)snprintf(line, sizeof(line),
+                 "[MODEZ] %s raw=%llu wire=%llu level=%d",
+                 (ftp_zstream_dir(z) == FTP_ZSTREAM_DEFLATE) ? "out" : "in",
+                 (unsigned long long)raw, (unsigned long long)wire, level);
+  ftp_log_line(FTP_LOG_INFO, line);
+
+  ftp_zstream_destroy(z);
+}
+#endif
+
+/**
+ * @brief Send data via data connection
+ */
+ssize_t ftp_session_send_data(ftp_session_t *session, const void *buffer,
+                              size_t length) {
+#if FTP_ENABLE_MODEZ
+  if ((session != NULL) && (session->transfer_mode == FTP_MODE_ZLIB) &&
+      (buffer != NULL) && (length > 0U) && (session->data_fd >= 0)) {
+    ftp_zstream_t *z = zstream_get(session, FTP_ZSTREAM_DEFLATE);
+    if (z == NULL) {
+      return FTP_ERR_OUT_OF_MEMORY;
+    }
+    ssize_t n = ftp_zstream_write(z, buffer, length, zstream_sink, session);
+    return (n < 0) ? (ssize_t)FTP_ERR_SOCKET_SEND : n;
+  }
+#endif
+
+  return data_send_wire(session, buffer, length, NULL, 0U);
+}
+
+/**
+ * @brief Send a pool buffer; it may stay with the kernel (MSG_ZEROCOPY)
+ */
+ssize_t ftp_session_send_buffer(ftp_session_t *session, void **buffer,
+                                size_t cap, size_t length) {
+  if ((buffer == NULL) || (*buffer == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+#if FTP_ENABLE_MODEZ
+  if ((session != NULL) && (session->transfer_mode == FTP_MODE_ZLIB)) {
+    return ftp_session_send_data(session, *buffer, length);
+  }
+#endif
+  return data_send_wire(session, *buffer, length, buffer, cap);
+}
+
+/**
+ * @brief Receive data via data connection
+ */
+ssize_t ftp_session_recv_data(ftp_session_t *session, void *buffer,
+                              size_t length) {
+#if FTP_ENABLE_MODEZ
+  if ((session != NULL) && (session->transfer_mode == FTP_MODE_ZLIB) &&
+      (buffer != NULL) && (length > 0U) && (session->data_fd >= 0)) {
+    ftp_zstream_t *z = zstream_get(session, FTP_ZSTREAM_INFLATE);
+    if (z == NULL) {
+      return FTP_ERR_OUT_OF_MEMORY;
+    }
+    return ftp_zstream_read(z, buffer, length, zstream_source, session);
+  }
+#endif
+
+  return data_recv_wire(session, buffer, length);
+}
+
 /*===========================================================================*
  * COMMAND PROCESSING
  *===========================================================================*/
@@ -890,8 +1419,24 @@ ssize_t ftp_session_read_command(ftp_session_t *session, char *buffer,
       session->ctrl_rx_len = 0U;
     }
 
-    ssize_t n = PAL_RECV(session->ctrl_fd, session->ctrl_rxbuf,
-                         sizeof(session->ctrl_rxbuf), 0);
+    ssize_t n;
+#if FTP_ENABLE_TLS
+    if (session->ctrl_tls != NULL) {
+      int r = pal_tls_recv(session->ctrl_tls, session->ctrl_rxbuf,
+                           sizeof(session->ctrl_rxbuf));
+      if (r == PAL_TLS_ERR_TIMEOUT) {
+        return (ssize_t)FTP_ERR_TIMEOUT;
+      }
+      if (r < 0) {
+        return (ssize_t)FTP_ERR_SOCKET_RECV;
+      }
+      n = (ssize_t)r;
+    } else
+#endif
+    {
+      n = PAL_RECV(session->ctrl_fd, session->ctrl_rxbuf,
+                   sizeof(session->ctrl_rxbuf), 0);
+    }
     if (n == 0) {
       return 0;
     }
@@ -944,6 +1489,7 @@ int ftp_session_process_command(ftp_session_t *session, const char *line) {
         (strcmp(command, "QUIT") != 0) && (strcmp(command, "NOOP") != 0) &&
         (strcmp(command, "FEAT") != 0) && (strcmp(command, "SYST") != 0) &&
         (strcmp(command, "AUTH") != 0) && (strcmp(command, "OPTS") != 0) &&
+        (strcmp(command, "PBSZ") != 0) && (strcmp(command, "PROT") != 0) &&
         (strcmp(command, "CLNT") != 0)) {
       ftp_session_send_reply(session, FTP_REPLY_530_NOT_LOGGED_IN,
                              "Please login with USER and PASS.");
@@ -961,7 +1507,11 @@ int ftp_session_process_command(ftp_session_t *session, const char *line) {
   }
 
   /* Execute command */
+  const ftp_command_entry_t *table = ftp_get_command_table(NULL);
+  session->cmd_start_ns = monotonic_ns();
   err = cmd->handler(session, cmd_args);
+  ftp_metrics_command((size_t)(cmd - table),
+                      monotonic_ns() - session->cmd_start_ns);
 
   if (FTP_LOG_COMMANDS != 0) {
     ftp_log_session_cmd(session, command, err);
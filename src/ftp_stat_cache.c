@@ -0,0 +1,315 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_stat_cache.c
+ * @brief Short-TTL file metadata cache shared by all sessions
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ *   hash(path) ──► shard (lock) ──► linear probe of its slots
+ *
+ * A lookup compares the 64-bit hash before the key, so a probe of a
+ * full shard touches one cache line per slot and one memcmp.
+ */
+
+#include "ftp_stat_cache.h"
+#include "ftp_config.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Generation: bumped by every invalidation, starts at 1 so a store
+ * made with a zeroed generation never lands.
+ */
+static atomic_uint g_gen = ATOMIC_VAR_INIT(1U);
+
+static _Atomic uint64_t g_hits;
+static _Atomic uint64_t g_misses;
+static _Atomic uint64_t g_invalidations;
+
+uint32_t ftp_stat_cache_generation(void) {
+  return (uint32_t)atomic_load_explicit(&g_gen, memory_order_acquire);
+}
+
+#if FTP_STAT_CACHE_ENTRIES > 0
+
+#define SC_WAYS (FTP_STAT_CACHE_ENTRIES / FTP_STAT_CACHE_SHARDS)
+
+typedef struct {
+  uint64_t hash;
+  uint64_t stamp_ms; /* 0 = empty */
+  uint32_t key_len;
+  vfs_stat_t st;
+  char key[FTP_STAT_CACHE_KEY_MAX];
+} sc_entry_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  uint32_t used;
+  sc_entry_t slot[SC_WAYS];
+} sc_shard_t;
+
+static sc_shard_t g_shards[FTP_STAT_CACHE_SHARDS];
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+
+static void sc_init(void) {
+  for (size_t s = 0U; s < (size_t)FTP_STAT_CACHE_SHARDS; s++) {
+    pthread_mutex_init(&g_shards[s].lock, NULL);
+  }
+}
+
+static uint64_t sc_now_ms(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 1U;
+  }
+  return ((uint64_t)ts.tv_sec * 1000U) + ((uint64_t)ts.tv_nsec / 1000000U) +
+         1U; /* never 0: 0 marks an empty slot */
+}
+
+/* FNV-1a */
+static uint64_t sc_hash(const char *s, size_t len) {
+  uint64_t h = 1469598103934665603ULL;
+  for (size_t i = 0U; i < len; i++) {
+    h ^= (uint8_t)s[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static sc_shard_t *sc_shard(uint64_t hash) {
+  return &g_shards[(hash >> 32) % FTP_STAT_CACHE_SHARDS];
+}
+
+static sc_entry_t *sc_find_locked(sc_shard_t *sh, uint64_t hash,
+                                  const char *path, size_t len) {
+  for (size_t i = 0U; i < (size_t)SC_WAYS; i++) {
+    sc_entry_t *e = &sh->slot[i];
+    if ((e->stamp_ms != 0U) && (e->hash == hash) && (e->key_len == len) &&
+        (memcmp(e->key, path, len) == 0)) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+static void sc_drop_locked(sc_shard_t *sh, sc_entry_t *e) {
+  e->stamp_ms = 0U;
+  sh->used--;
+}
+
+/* 1 = hit */
+static int sc_lookup(const char *path, size_t len, vfs_stat_t *out) {
+  uint64_t hash = sc_hash(path, len);
+  sc_shard_t *sh = sc_shard(hash);
+  int hit = 0;
+  pthread_mutex_lock(&sh->lock);
+  sc_entry_t *e = sc_find_locked(sh, hash, path, len);
+  if (e != NULL) {
+    if ((sc_now_ms() - e->stamp_ms) < (uint64_t)FTP_STAT_CACHE_TTL_MS) {
+      *out = e->st;
+      hit = 1;
+    } else {
+      sc_drop_locked(sh, e);
+    }
+  }
+  pthread_mutex_unlock(&sh->lock);
+  return hit;
+}
+
+/* @p path is the changed path; @p e is affected by the change */
+static int sc_affected(const sc_entry_t *e, const char *path, size_t len,
+                       size_t parent_len) {
+  if ((e->key_len >= len) && (memcmp(e->key, path, len) == 0) &&
+      ((e->key_len == len) || (e->key[len] == '/') ||
+       ((len == 1U) && (path[0] == '/')))) {
+    return 1; /* the path or below it */
+  }
+  return ((parent_len > 0U) && (e->key_len == parent_len) &&
+          (memcmp(e->key, path, parent_len) == 0))
+             ? 1
+             : 0;
+}
+
+#endif /* FTP_STAT_CACHE_ENTRIES > 0 */
+
+ftp_error_t ftp_stat_cache_stat(const char *path, vfs_stat_t *out) {
+  if ((path == NULL) || (out == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+#if FTP_STAT_CACHE_ENTRIES > 0
+  size_t len = strlen(path);
+  if (len < (size_t)FTP_STAT_CACHE_KEY_MAX) {
+    pthread_once(&g_once, sc_init);
+    if (sc_lookup(path, len, out) != 0) {
+      atomic_fetch_add(&g_hits, 1U);
+      return FTP_OK;
+    }
+  }
+  atomic_fetch_add(&g_misses, 1U);
+  uint32_t gen = ftp_stat_cache_generation();
+  ftp_error_t err = vfs_stat(path, out);
+  if (err == FTP_OK) {
+    ftp_stat_cache_store(path, out, gen);
+  }
+  return err;
+#else
+  atomic_fetch_add(&g_misses, 1U);
+  return vfs_stat(path, out);
+#endif
+}
+
+void ftp_stat_cache_store(const char *path, const vfs_stat_t *st,
+                          uint32_t gen) {
+#if FTP_STAT_CACHE_ENTRIES > 0
+  if ((path == NULL) || (st == NULL)) {
+    return;
+  }
+  size_t len = strlen(path);
+  if (len >= (size_t)FTP_STAT_CACHE_KEY_MAX) {
+    return;
+  }
+  pthread_once(&g_once, sc_init);
+  uint64_t hash = sc_hash(path, len);
+  sc_shard_t *sh = sc_shard(hash);
+  uint64_t now = sc_now_ms();
+
+  pthread_mutex_lock(&sh->lock);
+  /* Checked under the lock: an invalidation bumps first, then sweeps */
+  if (gen != ftp_stat_cache_generation()) {
+    pthread_mutex_unlock(&sh->lock);
+    return;
+  }
+  sc_entry_t *e = sc_find_locked(sh, hash, path, len);
+  if (e == NULL) {
+    sc_entry_t *oldest = &sh->slot[0];
+    for (size_t i = 0U; i < (size_t)SC_WAYS; i++) {
+      sc_entry_t *c = &sh->slot[i];
+      if ((c->stamp_ms == 0U) || ((now - c->stamp_ms) >=
+                                  (uint64_t)FTP_STAT_CACHE_TTL_MS)) {
+        e = c;
+        break;
+      }
+      if (c->stamp_ms < oldest->stamp_ms) {
+        oldest = c;
+      }
+    }
+    e = (e != NULL) ? e : oldest;
+    if (e->stamp_ms == 0U) {
+      sh->used++;
+    }
+    e->hash = hash;
+    e->key_len = (uint32_t)len;
+    memcpy(e->key, path, len);
+  }
+  e->st = *st;
+  e->stamp_ms = now;
+  pthread_mutex_unlock(&sh->lock);
+#else
+  (void)path;
+  (void)st;
+  (void)gen;
+#endif
+}
+
+void ftp_stat_cache_invalidate(const char *path) {
+  if ((path == NULL) || (path[0] == '\0')) {
+    return;
+  }
+  unsigned prev = atomic_fetch_add_explicit(&g_gen, 1U, memory_order_acq_rel);
+  if ((prev + 1U) == 0U) {
+    atomic_fetch_add_explicit(&g_gen, 1U, memory_order_acq_rel);
+  }
+#if FTP_STAT_CACHE_ENTRIES > 0
+  size_t len = strlen(path);
+  while ((len > 1U) && (path[len - 1U] == '/')) {
+    len--;
+  }
+  size_t parent_len = len;
+  while ((parent_len > 0U) && (path[parent_len - 1U] != '/')) {
+    parent_len--;
+  }
+  if (parent_len > 1U) {
+    parent_len--; /* drop the separator, keep "/" for top-level paths */
+  }
+  if (parent_len == len) {
+    parent_len = 0U; /* "/" has no parent */
+  }
+
+  pthread_once(&g_once, sc_init);
+  uint64_t dropped = 0U;
+  for (size_t s = 0U; s < (size_t)FTP_STAT_CACHE_SHARDS; s++) {
+    sc_shard_t *sh = &g_shards[s];
+    pthread_mutex_lock(&sh->lock);
+    for (size_t i = 0U; (i < (size_t)SC_WAYS) && (sh->used > 0U); i++) {
+      sc_entry_t *e = &sh->slot[i];
+      if ((e->stamp_ms != 0U) &&
+          (sc_affected(e, path, len, parent_len) != 0)) {
+        sc_drop_locked(sh, e);
+        dropped++;
+      }
+    }
+    pthread_mutex_unlock(&sh->lock);
+  }
+  atomic_fetch_add(&g_invalidations, dropped);
+#endif
+}
+
+void ftp_stat_cache_get_stats(ftp_stat_cache_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  out->hits = atomic_load(&g_hits);
+  out->misses = atomic_load(&g_misses);
+  out->invalidations = atomic_load(&g_invalidations);
+  out->entries = 0U;
+#if FTP_STAT_CACHE_ENTRIES > 0
+  pthread_once(&g_once, sc_init);
+  for (size_t s = 0U; s < (size_t)FTP_STAT_CACHE_SHARDS; s++) {
+    pthread_mutex_lock(&g_shards[s].lock);
+    out->entries += g_shards[s].used;
+    pthread_mutex_unlock(&g_shards[s].lock);
+  }
+#endif
+}
+
+void ftp_stat_cache_clear(void) {
+#if FTP_STAT_CACHE_ENTRIES > 0
+  pthread_once(&g_once, sc_init);
+  for (size_t s = 0U; s < (size_t)FTP_STAT_CACHE_SHARDS; s++) {
+    sc_shard_t *sh = &g_shards[s];
+    pthread_mutex_lock(&sh->lock);
+    for (size_t i = 0U; i < (size_t)SC_WAYS; i++) {
+      sh->slot[i].stamp_ms = 0U;
+    }
+    sh->used = 0U;
+    pthread_mutex_unlock(&sh->lock);
+  }
+#endif
+}
@@ -0,0 +1,525 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_tar.c
+ * @brief ustar header encoder and streaming reader
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ *   offset  field      offset  field
+ *   0       name[100]  257     magic[6] "ustar"
+ *   100     mode[8]    263     version[2] "00"
+ *   108     uid[8]     265     uname[32]
+ *   116     gid[8]     297     gname[32]
+ *   124     size[12]   329     devmajor[8]
+ *   136     mtime[12]  337     devminor[8]
+ *   148     chksum[8]  345     prefix[155]
+ *   156     typeflag
+ */
+
+#include "ftp_tar.h"
+#include <string.h>
+
+#define TAR_NAME_LEN 100U
+#define TAR_PREFIX_LEN 155U
+
+#define OFF_NAME 0U
+#define OFF_MODE 100U
+#define OFF_UID 108U
+#define OFF_GID 116U
+#define OFF_SIZE 124U
+#define OFF_MTIME 136U
+#define OFF_CHKSUM 148U
+#define OFF_TYPE 156U
+#define OFF_MAGIC 257U
+#define OFF_PREFIX 345U
+
+enum { RD_HEADER, RD_BODY, RD_EXT, RD_PAD, RD_DONE };
+
+/* Name as stored: directories carry a trailing '/' */
+typedef struct {
+  const char *s;
+  size_t len;   /* bytes in s            */
+  size_t total; /* len + appended slash  */
+} tar_name_t;
+
+static tar_name_t tar_name(const char *name, ftp_tar_type_t type) {
+  tar_name_t n;
+  n.s = name;
+  n.len = strlen(name);
+  n.total = n.len;
+  if ((type == FTP_TAR_DIR) && (n.len > 0U) && (name[n.len - 1U] != '/')) {
+    n.total++;
+  }
+  return n;
+}
+
+static void name_copy(char *dst, const tar_name_t *n, size_t from,
+                      size_t count) {
+  for (size_t i = 0U; i < count; i++) {
+    size_t at = from + i;
+    dst[i] = (at < n->len) ? n->s[at] : '/';
+  }
+}
+
+/*
+ * ustar prefix/name split: the cut is a '/' with at most 155 bytes before
+ * it and 1..100 after it.  Returns the cut index, or 0 if none.
+ */
+static size_t name_split(const tar_name_t *n) {
+  if ((n->total <= TAR_NAME_LEN) ||
+      (n->total > (TAR_PREFIX_LEN + 1U + TAR_NAME_LEN))) {
+    return 0U;
+  }
+  size_t k = n->total - TAR_NAME_LEN - 1U;
+  for (; (k <= TAR_PREFIX_LEN) && (k + 1U < n->total); k++) {
+    if ((k < n->len) && (n->s[k] == '/') && (k > 0U)) {
+      return k;
+    }
+  }
+  return 0U;
+}
+
+/* width-1 octal digits and a NUL, or GNU base-256 when it does not fit */
+static void put_number(char *field, size_t width, uint64_t v) {
+  size_t bits = (width - 1U) * 3U;
+  if ((bits >= 64U) || (v < ((uint64_t)1U << bits))) {
+    field[width - 1U] = '\0';
+    for (size_t i = width - 1U; i > 0U; i--) {
+      field[i - 1U] = (char)('0' + (int)(v & 7U));
+      v >>= 3;
+    }
+    return;
+  }
+  for (size_t i = width - 1U; i > 0U; i--) {
+    field[i] = (char)(v & 0xFFU);
+    v >>= 8;
+  }
+  field[0] = (char)0x80;
+}
+
+static void put_block(char *b, const tar_name_t *n, size_t name_from,
+                      size_t name_count, size_t prefix_count, uint64_t size,
+                      uint32_t mode, int64_t mtime, char type, int gnu) {
+  memset(b, 0, FTP_TAR_BLOCK);
+  name_copy(b + OFF_NAME, n, name_from, name_count);
+  if (prefix_count > 0U) {
+    name_copy(b + OFF_PREFIX, n, 0U, prefix_count);
+  }
+  put_number(b + OFF_MODE, 8U, (uint64_t)(mode & 07777U));
+  put_number(b + OFF_UID, 8U, 0U);
+  put_number(b + OFF_GID, 8U, 0U);
+  put_number(b + OFF_SIZE, 12U, size);
+  put_number(b + OFF_MTIME, 12U, (mtime > 0) ? (uint64_t)mtime : 0U);
+  b[OFF_TYPE] = type;
+  if (gnu != 0) {
+    memcpy(b + OFF_MAGIC, "ustar  ", 8U); /* GNU magic + version */
+  } else {
+    memcpy(b + OFF_MAGIC, "ustar", 6U);
+    memcpy(b + OFF_MAGIC + 6U, "00", 2U);
+  }
+
+  memset(b + OFF_CHKSUM, ' ', 8U);
+  uint32_t sum = 0U;
+  for (size_t i = 0U; i < FTP_TAR_BLOCK; i++) {
+    sum += (uint32_t)(unsigned char)b[i];
+  }
+  put_number(b + OFF_CHKSUM, 7U, sum);
+  b[OFF_CHKSUM + 7U] = ' ';
+}
+
+size_t ftp_tar_padding(uint64_t size) {
+  return (size_t)((FTP_TAR_BLOCK - (size % FTP_TAR_BLOCK)) % FTP_TAR_BLOCK);
+}
+
+size_t ftp_tar_header_size(const char *name, ftp_tar_type_t type) {
+  if ((name == NULL) || (name[0] == '\0')) {
+    return 0U;
+  }
+  tar_name_t n = tar_name(name, type);
+  if ((n.total <= TAR_NAME_LEN) || (name_split(&n) != 0U)) {
+    return FTP_TAR_BLOCK;
+  }
+  /* 'L' header + name (NUL terminated, padded) + real header */
+  return FTP_TAR_BLOCK + (n.total + 1U) + ftp_tar_padding(n.total + 1U) +
+         FTP_TAR_BLOCK;
+}
+
+size_t ftp_tar_header(void *out, size_t cap, const ftp_tar_member_t *m) {
+  if ((out == NULL) || (m == NULL) ||
+      ((m->type != FTP_TAR_FILE) && (m->type != FTP_TAR_DIR))) {
+    return 0U;
+  }
+  size_t need = ftp_tar_header_size(m->name, m->type);
+  if ((need == 0U) || (cap < need)) {
+    return 0U;
+  }
+
+  char *b = (char *)out;
+  tar_name_t n = tar_name(m->name, m->type);
+  uint64_t size = (m->type == FTP_TAR_DIR) ? 0U : m->size;
+
+  if (n.total <= TAR_NAME_LEN) {
+    put_block(b, &n, 0U, n.total, 0U, size, m->mode, m->mtime,
+              (char)m->type, 0);
+    return need;
+  }
+
+  size_t cut = name_split(&n);
+  if (cut != 0U) {
+    put_block(b, &n, cut + 1U, n.total - cut - 1U, cut, size, m->mode,
+              m->mtime, (char)m->type, 0);
+    return need;
+  }
+
+  /* GNU long name: the real header keeps the first 100 bytes */
+  static const tar_name_t link = {"././@LongLink", 13U, 13U};
+  put_block(b, &link, 0U, link.total, 0U, (uint64_t)(n.total + 1U), 0644U,
+            0, 'L', 1);
+  size_t data = need - (FTP_TAR_BLOCK * 2U);
+  memset(b + FTP_TAR_BLOCK, 0, data);
+  name_copy(b + FTP_TAR_BLOCK, &n, 0U, n.total);
+  put_block(b + FTP_TAR_BLOCK + data, &n, 0U, TAR_NAME_LEN, 0U, size,
+            m->mode, m->mtime, (char)m->type, 1);
+  return need;
+}
+
+/*===========================================================================*
+ * READER
+ *===========================================================================*/
+
+void ftp_tar_reader_init(ftp_tar_reader_t *r, const ftp_tar_sink_t *sink) {
+  if (r == NULL) {
+    return;
+  }
+  memset(r, 0, sizeof(*r));
+  if (sink != NULL) {
+    r->sink = *sink;
+  }
+  r->state = RD_HEADER;
+}
+
+/* Octal (space/NUL terminated) or GNU base-256 */
+static int get_number(const uint8_t *field, size_t width, uint64_t *out) {
+  uint64_t v = 0U;
+  if ((field[0] & 0x80U) != 0U) {
+    if ((field[0] & 0x40U) != 0U) {
+      return -1; /* negative */
+    }
+    v = (uint64_t)(field[0] & 0x3FU);
+    for (size_t i = 1U; i < width; i++) {
+      if ((v >> 56) != 0U) {
+        return -1;
+      }
+      v = (v << 8) | (uint64_t)field[i];
+    }
+    *out = v;
+    return 0;
+  }
+  size_t i = 0U;
+  while ((i < width) && (field[i] == ' ')) {
+    i++;
+  }
+  for (; (i < width) && (field[i] >= '0') && (field[i] <= '7'); i++) {
+    if ((v >> 61) != 0U) {
+      return -1;
+    }
+    v = (v << 3) | (uint64_t)(field[i] - '0');
+  }
+  if ((i < width) && (field[i] != '\0') && (field[i] != ' ')) {
+    return -1;
+  }
+  *out = v;
+  return 0;
+}
+
+/* Accepts the unsigned sum and, for old archivers, the signed one */
+static int checksum_ok(const uint8_t *b) {
+  uint64_t stored = 0U;
+  if (get_number(b + OFF_CHKSUM, 8U, &stored) != 0) {
+    return 0;
+  }
+  uint64_t usum = 0U;
+  int64_t ssum = 0;
+  for (size_t i = 0U; i < FTP_TAR_BLOCK; i++) {
+    uint8_t c = ((i >= OFF_CHKSUM) && (i < OFF_CHKSUM + 8U)) ? (uint8_t)' '
+                                                              : b[i];
+    usum += (uint64_t)c;
+    ssum += (int64_t)(int8_t)c;
+  }
+  return (stored == usum) || ((int64_t)stored == ssum);
+}
+
+static size_t field_len(const uint8_t *field, size_t width) {
+  size_t n = 0U;
+  while ((n < width) && (field[n] != 0U)) {
+    n++;
+  }
+  return n;
+}
+
+/* pax records: "<len> <key>=<value>\n", only path and size matter */
+static ftp_error_t pax_apply(ftp_tar_reader_t *r) {
+  size_t pos = 0U;
+  while (pos < r->ext_len) {
+    size_t rec = 0U;
+    size_t i = pos;
+    while ((i < r->ext_len) && (r->ext[i] >= '0') && (r->ext[i] <= '9')) {
+      rec = (rec * 10U) + (size_t)(r->ext[i] - '0');
+      i++;
+      if (rec > r->ext_len) {
+        return FTP_ERR_PROTOCOL;
+      }
+    }
+    if ((rec == 0U) || ((pos + rec) > r->ext_len) || (i >= pos + rec) ||
+        (r->ext[i] != ' ') || (r->ext[pos + rec - 1U] != '\n')) {
+      return FTP_ERR_PROTOCOL;
+    }
+    const char *key = r->ext + i + 1U;
+    const char *end = r->ext + pos + rec - 1U;
+    const char *eq = memchr(key, '=', (size_t)(end - key));
+    if (eq == NULL) {
+      return FTP_ERR_PROTOCOL;
+    }
+    size_t key_len = (size_t)(eq - key);
+    size_t val_len = (size_t)(end - eq - 1);
+    if ((key_len == 4U) && (memcmp(key, "path", 4U) == 0)) {
+      if (val_len >= sizeof(r->entry.name)) {
+        return FTP_ERR_PATH_TOO_LONG;
+      }
+      memcpy(r->entry.name, eq + 1, val_len);
+      r->entry.name[val_len] = '\0';
+      r->next_name = 1;
+    } else if ((key_len == 4U) && (memcmp(key, "size", 4U) == 0)) {
+      uint64_t v = 0U;
+      for (const char *c = eq + 1; c < end; c++) {
+        if ((*c < '0') || (*c > '9') || ((v >> 59) != 0U)) {
+          return FTP_ERR_PROTOCOL;
+        }
+        v = (v * 10U) + (uint64_t)(*c - '0');
+      }
+      r->next_size = v;
+      r->has_next_size = 1;
+    }
+    pos += rec;
+  }
+  return FTP_OK;
+}
+
+static ftp_error_t ext_done(ftp_tar_reader_t *r) {
+  if (r->ext_kind == 'L') {
+    size_t n = field_len((const uint8_t *)r->ext, r->ext_len);
+    if (n >= sizeof(r->entry.name)) {
+      return FTP_ERR_PATH_TOO_LONG;
+    }
+    memcpy(r->entry.name, r->ext, n);
+    r->entry.name[n] = '\0';
+    r->next_name = 1;
+    return FTP_OK;
+  }
+  if (r->ext_kind == 'x') {
+    return pax_apply(r);
+  }
+  return FTP_OK; /* 'g': global defaults are not used */
+}
+
+static ftp_error_t end_of_body(ftp_tar_reader_t *r) {
+  r->state = (r->pad > 0U) ? RD_PAD : RD_HEADER;
+  if (r->skip != 0) {
+    return FTP_OK;
+  }
+  int rc = (r->sink.end != NULL) ? r->sink.end(r->sink.ctx) : 0;
+  return (rc < 0) ? (ftp_error_t)rc : FTP_OK;
+}
+
+static ftp_error_t parse_header(ftp_tar_reader_t *r) {
+  const uint8_t *b = r->block;
+  size_t i = 0U;
+  while ((i < FTP_TAR_BLOCK) && (b[i] == 0U)) {
+    i++;
+  }
+  if (i == FTP_TAR_BLOCK) {
+    if (++r->zero_blocks >= 2U) {
+      r->state = RD_DONE;
+    }
+    return FTP_OK;
+  }
+  r->zero_blocks = 0U;
+  if (checksum_ok(b) == 0) {
+    return FTP_ERR_PROTOCOL;
+  }
+
+  uint64_t size = 0U;
+  uint64_t mode = 0U;
+  uint64_t mtime = 0U;
+  if ((get_number(b + OFF_SIZE, 12U, &size) != 0) ||
+      (get_number(b + OFF_MODE, 8U, &mode) != 0) ||
+      (get_number(b + OFF_MTIME, 12U, &mtime) != 0)) {
+    return FTP_ERR_PROTOCOL;
+  }
+  char type = (b[OFF_TYPE] == 0U) ? '0' : (char)b[OFF_TYPE];
+  r->pad = ftp_tar_padding(size);
+
+  if ((type == 'L') || (type == 'x') || (type == 'g')) {
+    if (size > (uint64_t)sizeof(r->ext)) {
+      return (type == 'L') ? FTP_ERR_PATH_TOO_LONG : FTP_ERR_PROTOCOL;
+    }
+    r->ext_kind = type;
+    r->ext_len = 0U;
+    r->left = size;
+    r->next_name = 0; /* a new record replaces an unused one */
+    if (size == 0U) {
+      r->state = RD_HEADER;
+      return ext_done(r);
+    }
+    r->state = RD_EXT;
+    return FTP_OK;
+  }
+
+  /* Name: extension record, else ustar prefix + name */
+  if (r->next_name == 0) {
+    size_t name_len = field_len(b + OFF_NAME, TAR_NAME_LEN);
+    size_t prefix_len = 0U;
+    if (memcmp(b + OFF_MAGIC, "ustar", 5U) == 0) {
+      prefix_len = field_len(b + OFF_PREFIX, TAR_PREFIX_LEN);
+    }
+    size_t at = 0U;
+    if (prefix_len > 0U) {
+      memcpy(r->entry.name, b + OFF_PREFIX, prefix_len);
+      r->entry.name[prefix_len] = '/';
+      at = prefix_len + 1U;
+    }
+    memcpy(r->entry.name + at, b + OFF_NAME, name_len);
+    r->entry.name[at + name_len] = '\0';
+  }
+  r->next_name = 0;
+  if (r->has_next_size != 0) {
+    size = r->next_size;
+    r->pad = ftp_tar_padding(size);
+    r->has_next_size = 0;
+  }
+
+  r->entry.size = size;
+  r->entry.mode = (uint32_t)(mode & 07777U);
+  r->entry.mtime = (int64_t)mtime;
+  r->entry.type = type;
+  r->left = size;
+
+  int want = 1;
+  if (r->sink.begin != NULL) {
+    want = r->sink.begin(r->sink.ctx, &r->entry);
+    if (want < 0) {
+      return (ftp_error_t)want;
+    }
+  }
+  r->skip = (want != 0) ? 1 : 0;
+  if (size == 0U) {
+    return end_of_body(r);
+  }
+  r->state = RD_BODY;
+  return FTP_OK;
+}
+
+ftp_error_t ftp_tar_reader_feed(ftp_tar_reader_t *r, const void *data,
+                                size_t len) {
+  if ((r == NULL) || ((data == NULL) && (len > 0U))) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  const uint8_t *p = (const uint8_t *)data;
+
+  while (len > 0U) {
+    size_t n;
+    ftp_error_t err = FTP_OK;
+
+    switch (r->state) {
+    case RD_HEADER:
+      n = FTP_TAR_BLOCK - r->have;
+      n = (n < len) ? n : len;
+      memcpy(r->block + r->have, p, n);
+      r->have += n;
+      if (r->have == FTP_TAR_BLOCK) {
+        r->have = 0U;
+        err = parse_header(r);
+      }
+      break;
+
+    case RD_BODY:
+      n = (r->left < (uint64_t)len) ? (size_t)r->left : len;
+      if ((r->skip == 0) && (r->sink.data != NULL)) {
+        int rc = r->sink.data(r->sink.ctx, p, n);
+        if (rc < 0) {
+          return (ftp_error_t)rc;
+        }
+      }
+      r->left -= (uint64_t)n;
+      if (r->left == 0U) {
+        err = end_of_body(r);
+      }
+      break;
+
+    case RD_EXT:
+      n = (r->left < (uint64_t)len) ? (size_t)r->left : len;
+      if (r->ext_kind != 'g') {
+        memcpy(r->ext + r->ext_len, p, n);
+        r->ext_len += n;
+      }
+      r->left -= (uint64_t)n;
+      if (r->left == 0U) {
+        r->state = (r->pad > 0U) ? RD_PAD : RD_HEADER;
+        err = ext_done(r);
+      }
+      break;
+
+    case RD_PAD:
+      n = (r->pad < len) ? r->pad : len;
+      r->pad -= n;
+      if (r->pad == 0U) {
+        r->state = RD_HEADER;
+      }
+      break;
+
+    default:
+      return FTP_OK; /* after the trailer: record padding */
+    }
+
+    if (err != FTP_OK) {
+      return err;
+    }
+    p += n;
+    len -= n;
+  }
+  return FTP_OK;
+}
+
+ftp_error_t ftp_tar_reader_finish(const ftp_tar_reader_t *r) {
+  if (r == NULL) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  if ((r->state == RD_DONE) || ((r->state == RD_HEADER) && (r->have == 0U))) {
+    return FTP_OK;
+  }
+  return FTP_ERR_PROTOCOL;
+}
@@ -0,0 +1,240 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_trace.c
+ * @brief Per-transfer timelines (SITE TRACE, /api/trace)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * Recording touches only the session's own ftp_trace_t; the history lock
+ * is taken once per transfer, to publish, and by readers.
+ */
+
+#include "ftp_trace.h"
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+static pthread_mutex_t g_trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static ftp_trace_t g_trace_ring[FTP_TRACE_HISTORY];
+static uint64_t g_trace_next = 0U; /* total ever published */
+
+static const char *const g_kind_name[FTP_TRACE_KINDS] = {
+    "open", "connect", "first-byte", "sendfile",
+    "stall", "cooldown", "writer-lag", "close"};
+
+uint64_t ftp_trace_now_ns(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 0U;
+  }
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/* Offset of @p ns from the command start, in microseconds */
+static uint64_t trace_rel_us(const ftp_trace_t *t, uint64_t ns) {
+  return (ns > t->start_ns) ? (ns - t->start_ns) / 1000U : 0U;
+}
+
+static uint16_t count_add(uint16_t have, uint32_t add) {
+  uint32_t sum = (uint32_t)have + add;
+  return (sum > UINT16_MAX) ? (uint16_t)UINT16_MAX : (uint16_t)sum;
+}
+
+/* Append, keeping the last slot for close */
+static ftp_trace_event_t *trace_push(ftp_trace_t *t, ftp_trace_kind_t kind) {
+  size_t limit = (kind == FTP_TRACE_CLOSE) ? FTP_TRACE_EVENTS
+                                           : (FTP_TRACE_EVENTS - 1U);
+  if (t->events >= limit) {
+    if (t->dropped < UINT16_MAX) {
+      t->dropped++;
+    }
+    return NULL;
+  }
+  ftp_trace_event_t *e = &t->ev[t->events++];
+  memset(e, 0, sizeof(*e));
+  e->kind = (uint16_t)kind;
+  return e;
+}
+
+/* Copy into the history ring; the caller's timeline becomes idle */
+static void trace_publish(ftp_trace_t *t) {
+  pthread_mutex_lock(&g_trace_lock);
+  g_trace_ring[g_trace_next % FTP_TRACE_HISTORY] = *t;
+  g_trace_next++;
+  pthread_mutex_unlock(&g_trace_lock);
+  t->start_ns = 0U;
+}
+
+/*===========================================================================*
+ * RECORDING
+ *===========================================================================*/
+
+void ftp_trace_begin(ftp_trace_t *t, const char *cmd, const char *path,
+                     uint32_t session_id, uint64_t start_ns) {
+  if (t == NULL) {
+    return;
+  }
+  if (t->start_ns != 0U) {
+    ftp_trace_end(t, 0, 0U); /* abandoned by an error return */
+  }
+
+  uint64_t now = ftp_trace_now_ns();
+  t->start_ns = ((start_ns != 0U) && (start_ns <= now)) ? start_ns : now;
+  if (t->start_ns == 0U) {
+    t->start_ns = 1U; /* clock unavailable: still mark the trace active */
+  }
+  t->wall = time(NULL);
+  t->session_id = session_id;
+  t->events = 0U;
+  t->dropped = 0U;
+  t->ok = 0U;
+  (void)snprintf(t->cmd, sizeof(t->cmd), "%s", (cmd != NULL) ? cmd : "");
+
+  /* Keep the tail: the file name matters more than the mount point */
+  const char *p = (path != NULL) ? path : "";
+  size_t len = strlen(p);
+  if (len >= sizeof(t->path)) {
+    p += len - (sizeof(t->path) - 1U);
+  }
+  (void)snprintf(t->path, sizeof(t->path), "%s", p);
+
+  ftp_trace_mark(t, FTP_TRACE_OPEN, t->start_ns, 0U, 0U);
+}
+
+int ftp_trace_active(const ftp_trace_t *t) {
+  return (t != NULL) && (t->start_ns != 0U);
+}
+
+void ftp_trace_mark(ftp_trace_t *t, ftp_trace_kind_t kind, uint64_t since_ns,
+                    uint64_t bytes, uint32_t count) {
+  if (!ftp_trace_active(t) || ((unsigned)kind >= (unsigned)FTP_TRACE_KINDS)) {
+    return;
+  }
+  uint64_t now = ftp_trace_now_ns();
+  uint64_t at = trace_rel_us(t, (since_ns != 0U) ? since_ns : now);
+  uint64_t end = trace_rel_us(t, now);
+
+  /* Same span kind again, soon after: extend instead of appending */
+  if ((t->events > 0U) &&
+      ((kind == FTP_TRACE_SENDFILE) || (kind == FTP_TRACE_COOLDOWN) ||
+       (kind == FTP_TRACE_WRITER_LAG))) {
+    ftp_trace_event_t *last = &t->ev[t->events - 1U];
+    uint64_t last_end = last->at_us + last->dur_us;
+    if ((last->kind == (uint16_t)kind) &&
+        (at <= last_end + ((uint64_t)FTP_TRACE_MERGE_MS * 1000U))) {
+      last->dur_us = (end > last->at_us) ? end - last->at_us : 0U;
+      last->bytes += bytes;
+      last->count = count_add(last->count, count);
+      return;
+    }
+  }
+
+  ftp_trace_event_t *e = trace_push(t, kind);
+  if (e == NULL) {
+    return;
+  }
+  e->at_us = at;
+  e->dur_us = (end > at) ? end - at : 0U;
+  e->bytes = bytes;
+  e->count = count_add(0U, count);
+}
+
+void ftp_trace_span(ftp_trace_t *t, ftp_trace_kind_t kind, uint64_t bytes) {
+  if (!ftp_trace_active(t)) {
+    return;
+  }
+  uint64_t since = 0U;
+  if (t->events > 0U) {
+    const ftp_trace_event_t *last = &t->ev[t->events - 1U];
+    since = t->start_ns + ((last->at_us + last->dur_us) * 1000U);
+  }
+  ftp_trace_mark(t, kind, since, bytes, 1U);
+}
+
+void ftp_trace_end(ftp_trace_t *t, int ok, uint64_t bytes) {
+  if (!ftp_trace_active(t)) {
+    return;
+  }
+  ftp_trace_mark(t, FTP_TRACE_CLOSE, 0U, bytes, 0U);
+  t->ok = (ok != 0) ? 1U : 0U;
+  trace_publish(t);
+}
+
+/*===========================================================================*
+ * READING
+ *===========================================================================*/
+
+size_t ftp_trace_recent(uint32_t session_id, ftp_trace_t *out, size_t max) {
+  if ((out == NULL) || (max == 0U)) {
+    return 0U;
+  }
+  size_t n = 0U;
+  pthread_mutex_lock(&g_trace_lock);
+  uint64_t have = (g_trace_next < FTP_TRACE_HISTORY) ? g_trace_next
+                                                     : FTP_TRACE_HISTORY;
+  for (uint64_t i = 0U; (i < have) && (n < max); i++) {
+    const ftp_trace_t *t =
+        &g_trace_ring[(g_trace_next - 1U - i) % FTP_TRACE_HISTORY];
+    if ((session_id == FTP_TRACE_ALL_SESSIONS) ||
+        (t->session_id == session_id)) {
+      out[n++] = *t;
+    }
+  }
+  pthread_mutex_unlock(&g_trace_lock);
+  return n;
+}
+
+const char *ftp_trace_kind_name(ftp_trace_kind_t kind) {
+  if ((unsigned)kind >= (unsigned)FTP_TRACE_KINDS) {
+    return "?";
+  }
+  return g_kind_name[kind];
+}
+
+int ftp_trace_format_event(const ftp_trace_event_t *e, char *buf,
+                           size_t cap) {
+  if ((e == NULL) || (buf == NULL) || (cap == 0U)) {
+    return 0;
+  }
+  int n = snprintf(buf, cap, "+%.1fms %s", (double)e->at_us / 1000.0,
+                   ftp_trace_kind_name((ftp_trace_kind_t)e->kind));
+  size_t len = (n > 0) ? (size_t)n : 0U;
+  if ((e->dur_us != 0U) && (len < cap)) {
+    n = snprintf(buf + len, cap - len, " %.1fms", (double)e->dur_us / 1000.0);
+    len += (n > 0) ? (size_t)n : 0U;
+  }
+  if ((e->bytes != 0U) && (len < cap)) {
+    n = snprintf(buf + len, cap - len, " %" PRIu64 "B", e->bytes);
+    len += (n > 0) ? (size_t)n : 0U;
+  }
+  if ((e->count != 0U) && (len < cap)) {
+    n = snprintf(buf + len, cap - len, " x%u", (unsigned)e->count);
+    len += (n > 0) ? (size_t)n : 0U;
+  }
+  return (int)len;
+}
@@ -0,0 +1,383 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_xfer_tune.c
+ * @brief Closed-loop sendfile tuning for cmd_RETR
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * CONTROL LAW (evaluated once per window):
+ *
+ *   zero-return rate >= FTP_RETR_TUNE_EAGAIN_PCT
+ *       -> chunk too large for the socket buffer / driver: halve it
+ *   bytes/sec > best + 5 %
+ *       -> keep going in the same direction (double or halve)
+ *   bytes/sec < best - 5 %
+ *       -> probe the other side of the best chunk; after two reversals
+ *          hold the best chunk
+ *   otherwise
+ *       -> hold (converged)
+ *
+ *   Backoff sleep: if back-pressure always clears on the first retry the
+ *   sleep is longer than the ACK round trip, shorten it by 1/4; if it
+ *   takes many retries, double it.  The total stall budget
+ *   (FTP_SENDFILE_EAGAIN_RETRIES × FTP_SENDFILE_EAGAIN_SLEEP_US) is kept.
+ *
+ *   Cooldown: a stall shortly after the previous cooldown means the
+ *   cooldown did not relieve the driver (exFAT page pressure), double it;
+ *   a long burst before the stall means it could be shorter.
+ */
+
+#include "ftp_xfer_tune.h"
+#include "ftp_config.h"
+#include "ftp_metrics.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#include <sys/mount.h>
+extern int _fstatfs(int, struct statfs *);
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+#include <sys/mount.h>
+#elif defined(__linux__)
+#include <sys/vfs.h>
+#endif
+
+/*===========================================================================*
+ * PER-FILESYSTEM MEMORY
+ *===========================================================================*/
+
+typedef struct {
+  char fstype[FTP_XFER_TUNE_FSNAME_MAX];
+  uint32_t chunk;
+  uint32_t cooldown;
+  uint32_t eagain_sleep_us;
+  uint64_t bps;
+  uint64_t stamp; /* LRU: last store */
+} tune_slot_t;
+
+static tune_slot_t g_tune_slots[FTP_RETR_TUNE_FS_SLOTS];
+static uint64_t g_tune_clock = 0U;
+static pthread_mutex_t g_tune_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Stall-detection budget kept constant across sleep changes (µs) */
+#define TUNE_STALL_BUDGET_US                                                   \
+  ((uint64_t)FTP_SENDFILE_EAGAIN_RETRIES * (uint64_t)FTP_SENDFILE_EAGAIN_SLEEP_US)
+
+static uint64_t tune_now_ns(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 0U;
+  }
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t tune_clamp(uint32_t v, uint32_t lo, uint32_t hi) {
+  if (v < lo) {
+    return lo;
+  }
+  if (v > hi) {
+    return hi;
+  }
+  return v;
+}
+
+static void tune_set_sleep(ftp_xfer_tune_t *t, uint32_t sleep_us) {
+  t->eagain_sleep_us = tune_clamp(sleep_us, FTP_RETR_TUNE_SLEEP_MIN_US,
+                                  FTP_RETR_TUNE_SLEEP_MAX_US);
+  uint64_t r = TUNE_STALL_BUDGET_US / (uint64_t)t->eagain_sleep_us;
+  t->eagain_retries = (r == 0U) ? 1U : (uint32_t)r;
+}
+
+static void tune_window_reset(ftp_xfer_tune_t *t) {
+  t->win_start_ns = tune_now_ns();
+  t->win_bytes = 0U;
+  t->win_calls = 0U;
+  t->win_eagain = 0U;
+  t->win_recoveries = 0U;
+  t->win_retry_sum = 0U;
+}
+
+void ftp_xfer_tune_fstype(int fd, char *out, size_t out_size) {
+  if ((out == NULL) || (out_size == 0U)) {
+    return;
+  }
+  snprintf(out, out_size, "%s", "unknown");
+  if (fd < 0) {
+    return;
+  }
+
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+  struct statfs sfs;
+  if (_fstatfs(fd, &sfs) == 0) {
+    snprintf(out, out_size, "%s", sfs.f_fstypename);
+  }
+#elif defined(__APPLE__) || defined(__FreeBSD__)
+  struct statfs sfs;
+  if (fstatfs(fd, &sfs) == 0) {
+    snprintf(out, out_size, "%s", sfs.f_fstypename);
+  }
+#elif defined(__linux__)
+  static const struct {
+    unsigned long magic;
+    const char *name;
+  } known[] = {
+      {0xEF53UL, "ext4"},      {0x58465342UL, "xfs"},
+      {0x9123683EUL, "btrfs"}, {0x2011BAB0UL, "exfat"},
+      {0x4D44UL, "msdosfs"},   {0x5346544EUL, "ntfs"},
+      {0x01021994UL, "tmpfs"}, {0x6969UL, "nfs"},
+      {0x794C7630UL, "overlay"}, {0xF2F52010UL, "f2fs"},
+      {0x9FA0UL, "proc"},      {0x62656572UL, "sysfs"},
+      {0x1CD1UL, "devpts"},
+  };
+  struct statfs sfs;
+  if (fstatfs(fd, &sfs) == 0) {
+    unsigned long magic = (unsigned long)sfs.f_type & 0xFFFFFFFFUL;
+    for (size_t i = 0U; i < (sizeof(known) / sizeof(known[0])); i++) {
+      if (known[i].magic == magic) {
+        snprintf(out, out_size, "%s", known[i].name);
+        return;
+      }
+    }
+    snprintf(out, out_size, "0x%lx", magic);
+  }
+#endif
+}
+
+void ftp_xfer_tune_begin(ftp_xfer_tune_t *t, const char *fstype) {
+  if (t == NULL) {
+    return;
+  }
+  memset(t, 0, sizeof(*t));
+  snprintf(t->fstype, sizeof(t->fstype), "%s",
+           (fstype != NULL) ? fstype : "unknown");
+
+  t->chunk = FTP_RETR_SENDFILE_CHUNK;
+  t->cooldown = FTP_RETR_TUNE_COOLDOWN;
+  tune_set_sleep(t, FTP_SENDFILE_EAGAIN_SLEEP_US);
+  t->dir = 1;
+
+#if FTP_RETR_ADAPTIVE
+  pthread_mutex_lock(&g_tune_lock);
+  for (size_t i = 0U; i < FTP_RETR_TUNE_FS_SLOTS; i++) {
+    const tune_slot_t *s = &g_tune_slots[i];
+    if ((s->stamp != 0U) && (strcmp(s->fstype, t->fstype) == 0)) {
+      t->chunk = s->chunk;
+      t->cooldown = s->cooldown;
+      tune_set_sleep(t, s->eagain_sleep_us);
+      t->seeded = 1;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_tune_lock);
+#endif
+
+  t->best_chunk = t->chunk;
+  tune_window_reset(t);
+}
+
+void ftp_xfer_tune_default_chunk(ftp_xfer_tune_t *t, uint32_t chunk) {
+  if ((t == NULL) || (t->seeded != 0) || (chunk == 0U)) {
+    return;
+  }
+  t->chunk = tune_clamp(chunk, FTP_RETR_TUNE_CHUNK_MIN,
+                        FTP_RETR_TUNE_CHUNK_MAX);
+  t->best_chunk = t->chunk;
+}
+
+/**
+ * @brief Close the current window and move the knobs
+ */
+static void tune_evaluate(ftp_xfer_tune_t *t) {
+  uint64_t now = tune_now_ns();
+  uint64_t elapsed = (now > t->win_start_ns) ? (now - t->win_start_ns) : 1U;
+  uint64_t bps = (uint64_t)(((double)t->win_bytes * 1e9) / (double)elapsed);
+  uint32_t eagain_pct =
+      (t->win_calls > 0U) ? ((t->win_eagain * 100U) / t->win_calls) : 0U;
+
+  /* chunk: hill-climb on bytes/sec, EAGAIN rate overrides */
+  if (eagain_pct >= FTP_RETR_TUNE_EAGAIN_PCT) {
+    t->chunk = tune_clamp(t->chunk / 2U, FTP_RETR_TUNE_CHUNK_MIN,
+                          FTP_RETR_TUNE_CHUNK_MAX);
+    t->dir = -1;
+    t->best_bps = 0U; /* conditions changed: re-learn from here */
+    t->best_chunk = t->chunk;
+    t->reversals = 0U;
+  } else if (bps > (t->best_bps + (t->best_bps / 20U))) {
+    t->best_bps = bps;
+    t->best_chunk = t->chunk;
+    uint32_t next = (t->dir > 0) ? (t->chunk * 2U) : (t->chunk / 2U);
+    t->chunk = tune_clamp(next, FTP_RETR_TUNE_CHUNK_MIN,
+                          FTP_RETR_TUNE_CHUNK_MAX);
+    t->reversals = 0U;
+  } else if ((bps + (bps / 20U)) < t->best_bps) {
+    /*
+     * Worse than the best chunk: probe the other side of it once.  After
+     * two reversals without improvement the best chunk is the optimum;
+     * hold it and let the baseline follow the link.
+     */
+    t->dir = -t->dir;
+    if (t->reversals < 2U) {
+      t->reversals++;
+      uint32_t next =
+          (t->dir > 0) ? (t->best_chunk * 2U) : (t->best_chunk / 2U);
+      t->chunk = tune_clamp(next, FTP_RETR_TUNE_CHUNK_MIN,
+                            FTP_RETR_TUNE_CHUNK_MAX);
+    } else {
+      if (t->chunk == t->best_chunk) {
+        t->best_bps = bps; /* the best chunk itself got slower */
+      }
+      t->chunk = t->best_chunk;
+    }
+  }
+
+  /* backoff sleep: match the observed back-pressure clear time */
+  if (t->win_recoveries > 0U) {
+    uint32_t avg = t->win_retry_sum / t->win_recoveries;
+    if (avg <= 1U) {
+      tune_set_sleep(t, t->eagain_sleep_us - (t->eagain_sleep_us / 4U));
+    } else if (avg > 8U) {
+      tune_set_sleep(t, t->eagain_sleep_us * 2U);
+    }
+  }
+
+  tune_window_reset(t);
+}
+
+void ftp_xfer_tune_on_sent(ftp_xfer_tune_t *t, size_t bytes) {
+  if (t == NULL) {
+    return;
+  }
+  t->win_calls++;
+  t->win_bytes += (uint64_t)bytes;
+  t->burst_bytes += (uint64_t)bytes;
+  t->total_bytes += (uint64_t)bytes;
+#if FTP_RETR_ADAPTIVE
+  if (t->win_bytes >= (uint64_t)FTP_RETR_TUNE_WINDOW_BYTES) {
+    tune_evaluate(t);
+  }
+#endif
+}
+
+void ftp_xfer_tune_on_eagain(ftp_xfer_tune_t *t) {
+  if (t == NULL) {
+    return;
+  }
+  ftp_metrics_add(FTP_METRIC_SENDFILE_EAGAIN, 1U);
+  t->win_calls++;
+  t->win_eagain++;
+}
+
+void ftp_xfer_tune_on_recovered(ftp_xfer_tune_t *t, uint32_t retries) {
+  if (t == NULL) {
+    return;
+  }
+  t->win_recoveries++;
+  t->win_retry_sum += retries;
+}
+
+void ftp_xfer_tune_on_stall(ftp_xfer_tune_t *t) {
+  if (t == NULL) {
+    return;
+  }
+  ftp_metrics_add(FTP_METRIC_SENDFILE_STALLS, 1U);
+  t->stalls++;
+#if FTP_RETR_ADAPTIVE
+  /*
+   * Second and later stalls: the burst since the previous cooldown tells
+   * us whether that cooldown was long enough.
+   */
+  if (t->stalls > 1U) {
+    if (t->burst_bytes < (2ULL * (uint64_t)t->cooldown)) {
+      t->cooldown = tune_clamp(t->cooldown * 2U, FTP_RETR_TUNE_COOLDOWN_MIN,
+                               FTP_RETR_TUNE_COOLDOWN_MAX);
+    } else if (t->burst_bytes > (8ULL * (uint64_t)t->cooldown)) {
+      t->cooldown = tune_clamp(t->cooldown - (t->cooldown / 4U),
+                               FTP_RETR_TUNE_COOLDOWN_MIN,
+                               FTP_RETR_TUNE_COOLDOWN_MAX);
+    }
+  }
+#endif
+  t->burst_bytes = 0U;
+}
+
+void ftp_xfer_tune_on_cooldown(ftp_xfer_tune_t *t, size_t bytes) {
+  if (t == NULL) {
+    return;
+  }
+  ftp_metrics_add(FTP_METRIC_COOLDOWN_BYTES, (uint64_t)bytes);
+  t->win_bytes += (uint64_t)bytes;
+  t->total_bytes += (uint64_t)bytes;
+}
+
+void ftp_xfer_tune_end(ftp_xfer_tune_t *t, int ok) {
+  if (t == NULL) {
+    return;
+  }
+#if FTP_RETR_ADAPTIVE
+  /* Short transfers never closed a window: nothing learned */
+  if ((ok == 0) || (t->total_bytes < (uint64_t)FTP_RETR_TUNE_WINDOW_BYTES)) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_tune_lock);
+  tune_slot_t *slot = NULL;
+  tune_slot_t *oldest = &g_tune_slots[0];
+  for (size_t i = 0U; i < FTP_RETR_TUNE_FS_SLOTS; i++) {
+    tune_slot_t *s = &g_tune_slots[i];
+    if ((s->stamp != 0U) && (strcmp(s->fstype, t->fstype) == 0)) {
+      slot = s;
+      break;
+    }
+    if (s->stamp < oldest->stamp) {
+      oldest = s;
+    }
+  }
+  if (slot == NULL) {
+    slot = oldest;
+    memset(slot, 0, sizeof(*slot));
+    snprintf(slot->fstype, sizeof(slot->fstype), "%s", t->fstype);
+  }
+  slot->chunk = (t->best_bps != 0U) ? t->best_chunk : t->chunk;
+  slot->cooldown = t->cooldown;
+  slot->eagain_sleep_us = t->eagain_sleep_us;
+  slot->bps = t->best_bps;
+  slot->stamp = ++g_tune_clock;
+  pthread_mutex_unlock(&g_tune_lock);
+#else
+  (void)ok;
+#endif
+}
+
+void ftp_xfer_tune_reset_table(void) {
+  pthread_mutex_lock(&g_tune_lock);
+  memset(g_tune_slots, 0, sizeof(g_tune_slots));
+  g_tune_clock = 0U;
+  pthread_mutex_unlock(&g_tune_lock);
+}
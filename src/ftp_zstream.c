@@ -0,0 +1,328 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file ftp_zstream.c
+ * @brief MODE Z (deflate) streaming for data connections (zlib)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ */
+
+#include "ftp_zstream.h"
+#include "ftp_config.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ZLIB_CONST
+#include <zlib.h>
+
+struct ftp_zstream {
+  z_stream zs;
+  ftp_zstream_dir_t dir;
+  ftp_zadapt_t adapt;
+  int pending_level; /* level to apply before the next deflate() */
+  int ended;         /* inflate saw Z_STREAM_END / source EOF    */
+  uint64_t raw_bytes;
+  uint64_t wire_bytes;
+  uint8_t buf[FTP_MODEZ_BUF_SIZE];
+};
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/*===========================================================================*
+ * LEVEL CONTROLLER
+ *===========================================================================*/
+
+void ftp_zadapt_init(ftp_zadapt_t *a, int level) {
+  memset(a, 0, sizeof(*a));
+  a->level = level;
+}
+
+int ftp_zadapt_window(ftp_zadapt_t *a) {
+  int level = a->level;
+
+  if (level == 0) {
+    /* Stored: nothing to measure, just wait before probing again */
+    a->stored_windows++;
+    if (a->stored_windows >= FTP_MODEZ_PROBE_WINDOWS) {
+      a->stored_windows = 0U;
+      level = 1;
+    }
+  } else if ((a->win_in > 0U) &&
+             ((a->win_out * 100U) >=
+              (a->win_in * (uint64_t)FTP_MODEZ_STORED_PCT))) {
+    level = 0; /* incompressible */
+    a->stored_windows = 0U;
+  } else if (a->win_deflate_ns > (2U * a->win_sink_ns)) {
+    if (level > FTP_MODEZ_LEVEL_MIN) {
+      level--;
+    }
+  } else if (a->win_sink_ns > (2U * a->win_deflate_ns)) {
+    if (level < FTP_MODEZ_LEVEL_MAX) {
+      level++;
+    }
+  }
+
+  a->level = level;
+  a->win_in = 0U;
+  a->win_out = 0U;
+  a->win_deflate_ns = 0U;
+  a->win_sink_ns = 0U;
+  return level;
+}
+
+/*===========================================================================*
+ * STREAM LIFECYCLE
+ *===========================================================================*/
+
+ftp_zstream_t *ftp_zstream_create(ftp_zstream_dir_t dir, int level) {
+  ftp_zstream_t *z = calloc(1U, sizeof(*z));
+  if (z == NULL) {
+    return NULL;
+  }
+
+  if (level < 0) {
+    level = 0;
+  } else if (level > 9) {
+    level = 9;
+  }
+
+  z->dir = dir;
+  int rc = (dir == FTP_ZSTREAM_DEFLATE)
+               ? deflateInit(&z->zs, level)
+               : inflateInit(&z->zs);
+  if (rc != Z_OK) {
+    free(z);
+    return NULL;
+  }
+
+  ftp_zadapt_init(&z->adapt, level);
+  z->pending_level = level;
+  return z;
+}
+
+void ftp_zstream_destroy(ftp_zstream_t *z) {
+  if (z == NULL) {
+    return;
+  }
+  if (z->dir == FTP_ZSTREAM_DEFLATE) {
+    (void)deflateEnd(&z->zs);
+  } else {
+    (void)inflateEnd(&z->zs);
+  }
+  free(z);
+}
+
+ftp_zstream_dir_t ftp_zstream_dir(const ftp_zstream_t *z) { return z->dir; }
+
+void ftp_zstream_stats(const ftp_zstream_t *z, uint64_t *raw, uint64_t *wire,
+                       int *level) {
+  if (raw != NULL) {
+    *raw = z->raw_bytes;
+  }
+  if (wire != NULL) {
+    *wire = z->wire_bytes;
+  }
+  if (level != NULL) {
+    *level = z->adapt.level;
+  }
+}
+
+/*===========================================================================*
+ * DEFLATE
+ *===========================================================================*/
+
+/* Send whatever deflate() left in z->buf; z->zs.avail_out tells how much */
+static int drain(ftp_zstream_t *z, ftp_zstream_sink_fn sink, void *ctx) {
+  size_t have = sizeof(z->buf) - (size_t)z->zs.avail_out;
+  if (have > 0U) {
+    uint64_t t0 = now_ns();
+    ssize_t sent = sink(ctx, z->buf, have);
+    z->adapt.win_sink_ns += now_ns() - t0;
+    if ((sent < 0) || ((size_t)sent != have)) {
+      return -1;
+    }
+    z->wire_bytes += (uint64_t)have;
+    z->adapt.win_out += (uint64_t)have;
+  }
+  z->zs.next_out = z->buf;
+  z->zs.avail_out = (uInt)sizeof(z->buf);
+  return 0;
+}
+
+/*
+ * deflateParams() compresses pending input with the old level and may
+ * need output space; it is only called with an empty z->buf.
+ */
+static int apply_level(ftp_zstream_t *z, ftp_zstream_sink_fn sink,
+                       void *ctx) {
+  for (;;) {
+    z->zs.next_out = z->buf;
+    z->zs.avail_out = (uInt)sizeof(z->buf);
+    int rc = deflateParams(&z->zs, z->pending_level, Z_DEFAULT_STRATEGY);
+    if (drain(z, sink, ctx) != 0) {
+      return -1;
+    }
+    if (rc != Z_BUF_ERROR) {
+      return (rc == Z_OK) ? 0 : -1;
+    }
+  }
+}
+
+ssize_t ftp_zstream_write(ftp_zstream_t *z, const void *buf, size_t len,
+                          ftp_zstream_sink_fn sink, void *ctx) {
+  if ((z == NULL) || (z->dir != FTP_ZSTREAM_DEFLATE) || (sink == NULL)) {
+    return -1;
+  }
+
+  const uint8_t *src = (const uint8_t *)buf;
+  size_t todo = len;
+
+  while (todo > 0U) {
+    if (z->adapt.win_in >= (uint64_t)FTP_MODEZ_WINDOW_BYTES) {
+      int next = ftp_zadapt_window(&z->adapt);
+      if (next != z->pending_level) {
+        z->pending_level = next;
+        if (apply_level(z, sink, ctx) != 0) {
+          return -1;
+        }
+      }
+    }
+
+    size_t chunk = (todo < (size_t)UINT_MAX) ? todo : (size_t)UINT_MAX;
+    z->zs.next_in = src;
+    z->zs.avail_in = (uInt)chunk;
+
+    while (z->zs.avail_in > 0U) {
+      z->zs.next_out = z->buf;
+      z->zs.avail_out = (uInt)sizeof(z->buf);
+
+      uint64_t t0 = now_ns();
+      int rc = deflate(&z->zs, Z_NO_FLUSH);
+      z->adapt.win_deflate_ns += now_ns() - t0;
+      if (rc == Z_STREAM_ERROR) {
+        return -1;
+      }
+
+      if (drain(z, sink, ctx) != 0) {
+        return -1;
+      }
+    }
+
+    z->raw_bytes += (uint64_t)chunk;
+    z->adapt.win_in += (uint64_t)chunk;
+    src += chunk;
+    todo -= chunk;
+  }
+
+  return (ssize_t)len;
+}
+
+int ftp_zstream_finish(ftp_zstream_t *z, ftp_zstream_sink_fn sink, void *ctx) {
+  if ((z == NULL) || (z->dir != FTP_ZSTREAM_DEFLATE) || (sink == NULL)) {
+    return -1;
+  }
+
+  z->zs.next_in = NULL;
+  z->zs.avail_in = 0U;
+  for (;;) {
+    z->zs.next_out = z->buf;
+    z->zs.avail_out = (uInt)sizeof(z->buf);
+    int rc = deflate(&z->zs, Z_FINISH);
+    if ((rc != Z_OK) && (rc != Z_STREAM_END) && (rc != Z_BUF_ERROR)) {
+      return -1;
+    }
+    if (drain(z, sink, ctx) != 0) {
+      return -1;
+    }
+    if (rc == Z_STREAM_END) {
+      return 0;
+    }
+  }
+}
+
+/*===========================================================================*
+ * INFLATE
+ *===========================================================================*/
+
+ssize_t ftp_zstream_read(ftp_zstream_t *z, void *buf, size_t len,
+                         ftp_zstream_source_fn source, void *ctx) {
+  if ((z == NULL) || (z->dir != FTP_ZSTREAM_INFLATE) || (source == NULL) ||
+      (buf == NULL) || (len == 0U)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  if (len > (size_t)UINT_MAX) {
+    len = (size_t)UINT_MAX;
+  }
+
+  for (;;) {
+    if (z->ended != 0) {
+      return 0;
+    }
+
+    if (z->zs.avail_in == 0U) {
+      ssize_t n = source(ctx, z->buf, sizeof(z->buf));
+      if (n < 0) {
+        return -1; /* errno from the wire */
+      }
+      if (n == 0) {
+        /* Peer closed: a missing stream trailer is tolerated */
+        z->ended = 1;
+        return 0;
+      }
+      z->wire_bytes += (uint64_t)n;
+      z->zs.next_in = z->buf;
+      z->zs.avail_in = (uInt)n;
+    }
+
+    z->zs.next_out = (Bytef *)buf;
+    z->zs.avail_out = (uInt)len;
+    int rc = inflate(&z->zs, Z_NO_FLUSH);
+    size_t produced = len - (size_t)z->zs.avail_out;
+
+    if (rc == Z_STREAM_END) {
+      z->ended = 1;
+    } else if ((rc != Z_OK) && (rc != Z_BUF_ERROR)) {
+      errno = EIO;
+      return -1;
+    }
+
+    if (produced > 0U) {
+      z->raw_bytes += (uint64_t)produced;
+      return (ssize_t)produced;
+    }
+  }
+}
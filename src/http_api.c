@@ -27,6 +27,7 @@ SOFTWARE.
  *
  * ENDPOINTS:
  *   GET /api/list?path=<dir>        Directory listing (JSON)
+ *       [&limit=&cursor=&sort=...]  Sorted, paged listing (JSON)
  *   GET /api/download?path=<file>   File download (binary)
  *   GET /                           Serve embedded index.html
  *   GET /style.css                  Serve embedded stylesheet
@@ -34,13 +35,29 @@ SOFTWARE.
  */
 
 #include "http_api.h"
+#include "ftp_buffer_pool.h"
+#include "ftp_bwsched.h"
+#include "ftp_copyjob.h"
+#include "ftp_dirsize.h"
 #include "ftp_path.h"
+#include "ftp_segment.h"
+#include "ftp_stat_cache.h"
 #include "ftp_server.h" /* ftp_server_context_t — for network reset endpoint */
+#include "ftp_list.h"
 #include "ftp_log.h"
+#include "ftp_metrics.h"
+#include "ftp_trace.h"
 #include "http_config.h"
+#include "http_fetch.h"
+#include "http_json.h"
+#include "http_resources.h"
+#include "http_sysmon.h"
+#include "http_thumb.h"
 #include "pal_fileio.h"
 #include "pal_network.h"      /* pal_network_reset_ftp_stack() */
 #include "pal_notification.h" /* pal_notification_send() — fallback notify */
+#include "pal_scratch.h"
+#include "pal_thread.h"
 #include "exfat_unpacker.h"  /* exFAT image parsing for game metadata */
 #include "pkg_unpacker.h"    /* PKG archive parsing for game metadata */
 #include <dirent.h>
@@ -186,27 +203,8 @@ extern int _fstatfs(int, struct statfs *);
 #endif
 #endif /* PLATFORM_PS4 || PLATFORM_PS5 || __FreeBSD__ */
 #include <time.h>
-#if defined(PLATFORM_LINUX) && __has_include(<sys/sysinfo.h>)
-#define HAS_SYSINFO 1
-#include <sys/sysinfo.h>
-#endif
-#if defined(PLATFORM_MACOS) || defined(PLATFORM_PS4) ||                        \
-    defined(PLATFORM_PS5) || defined(PS4) || defined(PS5) ||                   \
-    defined(__APPLE__)
-#include <sys/sysctl.h>
-#endif
-#if defined(PLATFORM_MACOS) || defined(__APPLE__)
-#include <mach/mach.h>
-#include <mach/vm_statistics.h>
-#endif
 #include <unistd.h>
 
-/*===========================================================================*
- * EMBEDDED RESOURCES (defined in http_resources.c)
- *===========================================================================*/
-
-extern const char *http_get_resource(const char *path, size_t *size);
-
 /*===========================================================================*
  * ROOT PATH CONFINEMENT
  *
@@ -338,6 +336,10 @@ static http_response_t *api_download(const http_request_t *request);
 static http_response_t *api_stats(const http_request_t *request);
 static http_response_t *api_stats_ram(const http_request_t *request);
 static http_response_t *api_stats_system(const http_request_t *request);
+static http_response_t *api_bwlimit(const http_request_t *request);
+static http_response_t *api_metrics(const http_request_t *request);
+static http_response_t *api_trace(const http_request_t *request);
+static http_response_t *api_segments(const http_request_t *request);
 static http_response_t *api_disk_info(const http_request_t *request);
 static http_response_t *api_disk_tree(const http_request_t *request);
 static http_response_t *api_processes(const http_request_t *request);
@@ -359,6 +361,7 @@ static http_response_t *api_delete(const http_request_t *request);
 static http_response_t *api_rename(const http_request_t *request);
 static http_response_t *api_copy(const http_request_t *request);
 static http_response_t *api_copy_progress(const http_request_t *request);
+static http_response_t *api_copy_jobs(const http_request_t *request);
 static http_response_t *api_copy_cancel(const http_request_t *request);
 static http_response_t *api_copy_pause(const http_request_t *request);
 #endif
@@ -797,6 +800,9 @@ static int count_dir_items(const char *path, uint32_t *out_count) {
  *   │  depth > 8      ──► skip subtree             │
  *   │  otherwise      ──► full scan, partial=false │
  *   └──────────────────────────────────────────────┘
+ *
+ * /api/dirsize answers from the background index (ftp_dirsize.h) and
+ * only borrows DIR_SIZE_TIMEOUT_MS as its wait budget.
  */
 #define DIR_SIZE_MAX_DEPTH    8
 #define DIR_SIZE_MAX_ENTRIES  10000
@@ -903,133 +909,6 @@ uint64_t http_dir_size_recursive(const char *path, int depth) {
   return dir_size_walk(path, depth, &ctx);
 }
 
-/**
- * @brief Same as http_dir_size_recursive but also reports whether
- *        the scan was truncated by the time/entry budget.
- */
-static uint64_t http_dir_size_with_partial(const char *path, int *out_partial) {
-  dir_size_ctx_t ctx;
-  gettimeofday(&ctx.deadline, NULL);
-  ctx.deadline.tv_usec += DIR_SIZE_TIMEOUT_MS * 1000;
-  if (ctx.deadline.tv_usec >= 1000000) {
-    ctx.deadline.tv_sec  += ctx.deadline.tv_usec / 1000000;
-    ctx.deadline.tv_usec  = ctx.deadline.tv_usec % 1000000;
-  }
-  ctx.entries = 0;
-  ctx.partial = 0;
-
-  uint64_t sz = dir_size_walk(path, 0, &ctx);
-  if (out_partial != NULL) {
-    *out_partial = ctx.partial;
-  }
-  return sz;
-}
-
-static int get_boot_epoch_seconds(uint64_t *out_epoch) {
-  if (out_epoch == NULL) {
-    return -1;
-  }
-
-#if defined(HAS_SYSINFO)
-  struct sysinfo info;
-  if (sysinfo(&info) != 0) {
-    return -1;
-  }
-  time_t now = time(NULL);
-  if (now < 0) {
-    return -1;
-  }
-  uint64_t now_u = (uint64_t)now;
-  uint64_t up_u = (uint64_t)info.uptime;
-  *out_epoch = (now_u >= up_u) ? (now_u - up_u) : 0U;
-  return 0;
-#elif defined(PLATFORM_MACOS) || defined(__APPLE__) ||                         \
-    defined(PLATFORM_PS4) || defined(PLATFORM_PS5) || defined(PS4) ||          \
-    defined(PS5)
-  struct timeval bt;
-  size_t sz = sizeof(bt);
-  if (sysctlbyname("kern.boottime", &bt, &sz, NULL, 0) != 0) {
-    return -1;
-  }
-  if (sz < sizeof(bt)) {
-    return -1;
-  }
-  if (bt.tv_sec < 0) {
-    return -1;
-  }
-  *out_epoch = (uint64_t)bt.tv_sec;
-  return 0;
-#else
-  (void)out_epoch;
-  return -1;
-#endif
-}
-
-static int get_cpu_temp_c(int32_t *out_c) {
-  if (out_c == NULL) {
-    return -1;
-  }
-
-#if defined(PLATFORM_PS4) || defined(PS4)
-  __attribute__((weak)) int32_t sceKernelGetCpuTemperature(
-      uint64_t *temperature);
-  if (sceKernelGetCpuTemperature != NULL) {
-    uint64_t raw = 0U;
-    int32_t rc = sceKernelGetCpuTemperature(&raw);
-    if (rc == 0) {
-      if ((raw >= 20U) && (raw <= 110U)) {
-        *out_c = (int32_t)raw;
-        return 0;
-      }
-    }
-  }
-#endif
-
-#if defined(PLATFORM_MACOS) || defined(PLATFORM_PS4) ||                        \
-    defined(PLATFORM_PS5) || defined(PS4) || defined(PS5)
-  const char *names[] = {
-      "dev.cpu.0.temperature",
-      "dev.cpu.0.coretemp.temperature",
-      "dev.cpu.0.temp",
-      "dev.amdtemp.0.temperature",
-      "dev.amdtemp.0.core0.sensor0",
-      "dev.thermal.0.temperature",
-      "hw.acpi.thermal.tz0.temperature",
-      "hw.temperature",
-      NULL,
-  };
-
-  for (size_t i = 0U; names[i] != NULL; i++) {
-    int v = 0;
-    size_t sz = sizeof(v);
-    if (sysctlbyname(names[i], &v, &sz, NULL, 0) != 0) {
-      continue;
-    }
-    if (sz != sizeof(v)) {
-      continue;
-    }
-
-    int32_t c = 0;
-    if (v > 1000) {
-      int32_t dk = (int32_t)v;
-      c = (dk - 2731 + 5) / 10;
-    } else {
-      c = (int32_t)v;
-    }
-    if ((c < -40) || (c > 200)) {
-      continue;
-    }
-    *out_c = c;
-    return 0;
-  }
-
-  return -1;
-#else
-  (void)out_c;
-  return -1;
-#endif
-}
-
 /*===========================================================================*
  * JSON HELPERS
  *===========================================================================*/
@@ -1037,59 +916,19 @@ static int get_cpu_temp_c(int32_t *out_c) {
 /**
  * @brief Append a JSON-escaped string to buffer
  *
- * Escapes: " \ / \b \f \n \r \t and control chars
+ * Escapes " \ and control chars (http_json_escape()); one byte is always
+ * left free for a terminating NUL.  Nothing is appended on overflow.
  */
 static int json_escape_append(char *buf, size_t cap, size_t *pos,
                               const char *str) {
-  size_t p = *pos;
-
-  for (const char *s = str; *s != '\0'; s++) {
-    unsigned char c = (unsigned char)*s;
-
-    if (p + 6 >= cap) {
-      return -1; /* would overflow */
-    }
-
-    switch (c) {
-    case '"':
-      buf[p++] = '\\';
-      buf[p++] = '"';
-      break;
-    case '\\':
-      buf[p++] = '\\';
-      buf[p++] = '\\';
-      break;
-    case '\b':
-      buf[p++] = '\\';
-      buf[p++] = 'b';
-      break;
-    case '\f':
-      buf[p++] = '\\';
-      buf[p++] = 'f';
-      break;
-    case '\n':
-      buf[p++] = '\\';
-      buf[p++] = 'n';
-      break;
-    case '\r':
-      buf[p++] = '\\';
-      buf[p++] = 'r';
-      break;
-    case '\t':
-      buf[p++] = '\\';
-      buf[p++] = 't';
-      break;
-    default:
-      if (c < 0x20) {
-        p += (size_t)snprintf(buf + p, cap - p, "\\u%04x", c);
-      } else {
-        buf[p++] = (char)c;
-      }
-      break;
-    }
+  if (*pos >= cap) {
+    return -1;
   }
-
-  *pos = p;
+  size_t n = http_json_escape(buf + *pos, cap - *pos - 1U, str, strlen(str));
+  if (n == (size_t)-1) {
+    return -1; /* would overflow */
+  }
+  *pos += n;
   return 0;
 }
 
@@ -1337,234 +1176,316 @@ static int is_safe_filename(const char *name) {
 
 /*===========================================================================*
  * REQUEST ROUTER
+ *
+ *   uri ──► path (up to '?') ──► FNV-1a ──► g_route_slot[] ──► g_routes[i]
+ *                                               (linear probe)     │
+ *            method ∉ methods ──► 405 ◄─────────────────────────────┤
+ *            POST on R_CSRF   ──► token check ──► handler ◄─────────┘
+ *
+ * Routes match the whole path, so "/api/download" no longer swallows
+ * "/api/download/start" and the table order carries no meaning.  The
+ * probe index is built on first use because the route set depends on
+ * ENABLE_WEB_UPLOAD; after that every lookup is one hash and, nearly
+ * always, one compare.  Unknown paths fall through to serve_static().
  *===========================================================================*/
 
 #include "http_csrf.h"
 
-http_response_t *http_api_handle(const http_request_t *request) {
-  if (request == NULL) {
-    return NULL;
-  }
+#define R_GET 0x01U  /* GET and HEAD */
+#define R_POST 0x02U
+#define R_ANY (R_GET | R_POST)
 
-#if ENABLE_WEB_UPLOAD
-  /* CSRF Protection for mutating requests */
-  if (request->method == HTTP_METHOD_POST) {
-    if (http_csrf_validate(request) != 0) {
-      return error_json(HTTP_STATUS_403_FORBIDDEN,
-                        "Invalid or missing CSRF token");
-    }
-  }
-#endif
+/*
+ * Per-route flags.  R_OFFLOAD marks routes that walk directory trees,
+ * read large metadata files or mutate the filesystem: on slow PFS/USB
+ * media these block for seconds, so the server runs them on its worker
+ * pool instead of the event-loop thread.
+ */
+#define R_OFFLOAD HTTP_ROUTE_OFFLOAD
+#define R_CSRF HTTP_ROUTE_CSRF
+#define R_CACHE HTTP_ROUTE_CACHE
+#define R_OFFLOAD_PAGED 0x80U /* offloaded only when list_is_paged() */
 
-  /*  /api/list?path=...  */
-  if (strncmp(request->uri, "/api/list", 9) == 0) {
-    return api_list(request);
-  }
+typedef http_response_t *(*api_handler_t)(const http_request_t *request);
 
-  /*  /api/dirsize?path=...  */
-  if (strncmp(request->uri, "/api/dirsize", 12) == 0) {
-    return api_dirsize(request);
-  }
+typedef struct {
+  const char *path;
+  api_handler_t handler;
+  uint8_t methods; /* R_GET | R_POST */
+  uint8_t flags;   /* R_OFFLOAD | R_CSRF | R_CACHE | R_OFFLOAD_PAGED */
+} api_route_t;
 
-  /*  Download manager — /api/download/start, status, pause, cancel
-   *
-   *  IMPORTANT: These longer-prefix routes MUST come BEFORE the
-   *  generic /api/download handler below, because strncmp matches
-   *  left-to-right and "/api/download" (13 chars) is a prefix of
-   *  "/api/download/start" (19 chars).
-   *
-   *  Route order:          Match example:
-   *    /api/download/start   → api_dl_start()     ✓
-   *    /api/download/status  → api_dl_status()    ✓
-   *    /api/download/pause   → api_dl_pause()     ✓
-   *    /api/download/cancel  → api_dl_cancel()    ✓
-   *    /api/download?path=   → api_download()     ✓  (file download)
-   */
-  if (strncmp(request->uri, "/api/download/start", 19) == 0) {
-    return api_dl_start(request);
-  }
-  if (strncmp(request->uri, "/api/download/status", 20) == 0) {
-    return api_dl_status(request);
-  }
-  if (strncmp(request->uri, "/api/download/pause", 19) == 0) {
-    return api_dl_pause(request);
-  }
-  if (strncmp(request->uri, "/api/download/cancel", 20) == 0) {
-    return api_dl_cancel(request);
-  }
+static http_response_t *api_legacy_stream_status(const http_request_t *request) {
+  (void)request;
+  return api_legacy_disabled_json(
+      "{\"ok\":true,\"enabled\":false,\"status\":\"offline\"}");
+}
 
-  /*
-   * Browser-safe alias for local file downloads. Some browsers/extensions
-   * block URLs named "/api/download" as suspicious/insecure downloads.
-   */
-  if (strncmp(request->uri, "/api/file/get", 13) == 0) {
-    return api_download(request);
-  }
+static http_response_t *api_legacy_stream(const http_request_t *request) {
+  (void)request;
+  return api_legacy_disabled_json(
+      "{\"ok\":false,\"message\":\"Stream disabled\"}");
+}
 
-  /*  /api/download?path=...  (file download — generic, MUST come after /start etc) */
-  if (strncmp(request->uri, "/api/download", 13) == 0) {
-    return api_download(request);
-  }
+static http_response_t *api_legacy_installed(const http_request_t *request) {
+  (void)request;
+  return api_legacy_disabled_json("{\"ok\":true,\"installed\":false}");
+}
 
-  /*  /api/stats/ram  */
-  if (strncmp(request->uri, "/api/stats/ram", 14) == 0) {
-    return api_stats_ram(request);
-  }
+static http_response_t *api_legacy_install(const http_request_t *request) {
+  (void)request;
+  return api_legacy_disabled_json(
+      "{\"ok\":false,\"message\":\"Install API not available\"}");
+}
 
-  /*  /api/stats/system  */
-  if (strncmp(request->uri, "/api/stats/system", 17) == 0) {
-    return api_stats_system(request);
-  }
+static const api_route_t g_routes[] = {
+    {"/api/list", api_list, R_GET, R_OFFLOAD_PAGED},
+    {"/api/dirsize", api_dirsize, R_GET, R_OFFLOAD},
+    {"/api/download", api_download, R_GET, 0U},
+    /* Alias: some browsers/extensions block URLs named "/api/download" */
+    {"/api/file/get", api_download, R_GET, 0U},
+    {"/api/download/start", api_dl_start, R_POST, R_CSRF},
+    {"/api/download/status", api_dl_status, R_GET, 0U},
+    {"/api/download/pause", api_dl_pause, R_POST, R_CSRF},
+    {"/api/download/cancel", api_dl_cancel, R_POST, R_CSRF},
+    {"/api/stats", api_stats, R_GET, 0U},
+    {"/api/stats/ram", api_stats_ram, R_GET, 0U},
+    {"/api/stats/system", api_stats_system, R_GET, 0U},
+    {"/api/trace", api_trace, R_GET, 0U},
+    {"/api/segments", api_segments, R_GET, 0U},
+    {"/api/metrics", api_metrics, R_GET, 0U},
+    {"/api/bwlimit", api_bwlimit, R_ANY, R_CSRF},
+    {"/api/disk/info", api_disk_info, R_GET, 0U},
+    {"/api/disk/tree", api_disk_tree, R_GET, R_OFFLOAD},
+    {"/api/processes", api_processes, R_GET, R_OFFLOAD},
+    {"/api/process/kill", api_process_kill, R_POST, R_CSRF},
+#if ENABLE_WEB_UPLOAD
+    {"/api/create_file", api_create_file, R_POST, R_OFFLOAD | R_CSRF},
+    {"/api/mkdir", api_mkdir, R_POST, R_OFFLOAD | R_CSRF},
+    {"/api/delete", api_delete, R_POST, R_OFFLOAD | R_CSRF},
+    {"/api/rename", api_rename, R_POST, R_OFFLOAD | R_CSRF},
+    {"/api/copy", api_copy, R_POST, R_CSRF},
+    {"/api/copy_progress", api_copy_progress, R_GET, 0U},
+    {"/api/copy_jobs", api_copy_jobs, R_GET, 0U},
+    {"/api/copy_pause", api_copy_pause, R_POST, R_CSRF},
+    {"/api/copy_cancel", api_copy_cancel, R_POST, R_CSRF},
+#endif
+    {"/api/game/meta", api_game_meta, R_GET, R_OFFLOAD | R_CACHE},
+    {"/api/game/icon", api_game_icon, R_GET, R_OFFLOAD | R_CACHE},
+    {"/api/extract", api_extract, R_POST, R_CSRF},
+    {"/api/extract_progress", api_extract_progress, R_GET, 0U},
+    {"/api/extract_cancel", api_extract_cancel, R_POST, R_CSRF},
+    {"/api/network/reset", api_network_reset, R_POST, R_CSRF},
+    {"/api/admin/fan", api_admin_fan, R_ANY, R_CSRF},
+    {"/api/admin/launch", api_admin_launch, R_ANY, R_CSRF},
+    {"/api/admin/games/installed", api_games_installed, R_GET, R_OFFLOAD},
+    {"/api/admin/games/icon", api_games_icon, R_GET, R_OFFLOAD | R_CACHE},
+    {"/api/admin/games/repair_visibility", api_games_repair_visibility, R_ANY,
+     R_CSRF},
+    {"/api/admin/games/uninstall", api_games_uninstall, R_ANY, R_CSRF},
+    {"/api/admin/games/install_status", api_games_install_status, R_GET, 0U},
+    {"/api/admin/games/install", api_games_install, R_ANY, R_CSRF},
+    {"/api/admin/games/reinstall", api_games_reinstall, R_ANY, R_CSRF},
+    /* Legacy frontend compatibility (old embedded UIs) */
+    {"/api/stream", api_legacy_stream, R_ANY, R_CSRF},
+    {"/api/stream/status", api_legacy_stream_status, R_ANY, R_CSRF},
+    {"/api/stream/start", api_legacy_stream, R_ANY, R_CSRF},
+    {"/api/stream/stop", api_legacy_stream, R_ANY, R_CSRF},
+    {"/api/admin/installed", api_legacy_installed, R_ANY, R_CSRF},
+    {"/api/admin/install", api_legacy_install, R_ANY, R_CSRF},
+};
 
-  /*  /api/stats?path=... (legacy widget)  */
-  if (strncmp(request->uri, "/api/stats", 10) == 0) {
-    return api_stats(request);
-  }
+#define ROUTE_COUNT (sizeof(g_routes) / sizeof(g_routes[0]))
+#define ROUTE_SLOTS 128U /* power of two, at least twice ROUTE_COUNT */
 
-  /*  /api/disk/info  */
-  if (strncmp(request->uri, "/api/disk/info", 14) == 0) {
-    return api_disk_info(request);
-  }
+_Static_assert(ROUTE_COUNT * 2U <= ROUTE_SLOTS, "grow ROUTE_SLOTS");
 
-  /*  /api/disk/tree?path=...  */
-  if (strncmp(request->uri, "/api/disk/tree", 14) == 0) {
-    return api_disk_tree(request);
-  }
+/* Slot value is route index + 1; 0 marks an empty slot */
+static uint8_t g_route_slot[ROUTE_SLOTS];
+static pthread_once_t g_route_once = PTHREAD_ONCE_INIT;
 
-  /*  POST /api/process/kill  */
-  if (strncmp(request->uri, "/api/process/kill", 17) == 0) {
-    return api_process_kill(request);
-  }
+typedef struct {
+  _Atomic uint64_t calls;
+  _Atomic uint64_t total_us;
+  _Atomic uint64_t max_us;
+} route_stats_t;
 
-  /*  GET /api/processes  */
-  if (strncmp(request->uri, "/api/processes", 14) == 0) {
-    return api_processes(request);
-  }
+static route_stats_t g_route_stats[ROUTE_COUNT];
 
-#if ENABLE_WEB_UPLOAD
-  /*  POST /api/create_file?path=...&name=...  */
-  if (strncmp(request->uri, "/api/create_file", 16) == 0) {
-    return api_create_file(request);
+static uint32_t route_hash(const char *path, size_t len) {
+  uint32_t h = 2166136261U;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint32_t)(unsigned char)path[i];
+    h *= 16777619U;
   }
+  return h;
+}
 
-  /*  POST /api/mkdir?path=...&name=...  */
-  if (strncmp(request->uri, "/api/mkdir", 10) == 0) {
-    return api_mkdir(request);
+static void route_index_build(void) {
+  for (size_t i = 0; i < ROUTE_COUNT; i++) {
+    const char *path = g_routes[i].path;
+    uint32_t slot = route_hash(path, strlen(path)) & (ROUTE_SLOTS - 1U);
+    while (g_route_slot[slot] != 0U) {
+      slot = (slot + 1U) & (ROUTE_SLOTS - 1U);
+    }
+    g_route_slot[slot] = (uint8_t)(i + 1U);
   }
+}
 
-  /*  POST /api/delete?path=...  */
-  if (strncmp(request->uri, "/api/delete", 11) == 0) {
-    return api_delete(request);
+/** Index into g_routes[] of the request's path, or -1 */
+static int route_find(const char *uri) {
+  (void)pthread_once(&g_route_once, route_index_build);
+  const char *q = strchr(uri, '?');
+  size_t len = (q != NULL) ? (size_t)(q - uri) : strlen(uri);
+  uint32_t slot = route_hash(uri, len) & (ROUTE_SLOTS - 1U);
+  while (g_route_slot[slot] != 0U) {
+    int idx = (int)g_route_slot[slot] - 1;
+    const char *path = g_routes[idx].path;
+    if ((strncmp(path, uri, len) == 0) && (path[len] == '\0')) {
+      return idx;
+    }
+    slot = (slot + 1U) & (ROUTE_SLOTS - 1U);
   }
+  return -1;
+}
 
-  /*  POST /api/rename?path=...&name=...  */
-  if (strncmp(request->uri, "/api/rename", 11) == 0) {
-    return api_rename(request);
+static unsigned route_method_bit(http_method_t method) {
+  if ((method == HTTP_METHOD_GET) || (method == HTTP_METHOD_HEAD)) {
+    return R_GET;
   }
+  return (method == HTTP_METHOD_POST) ? R_POST : 0U;
+}
 
-  /*  POST /api/copy?src=...&dst=...  */
-  if (strncmp(request->uri, "/api/copy_progress", 18) == 0) {
-    return api_copy_progress(request);
-  }
-  if (strncmp(request->uri, "/api/copy_cancel", 16) == 0) {
-    return api_copy_cancel(request);
-  }
-  if (strncmp(request->uri, "/api/copy_pause", 15) == 0) {
-    return api_copy_pause(request);
-  }
-  if (strncmp(request->uri, "/api/copy", 9) == 0) {
-    return api_copy(request);
+static uint64_t route_now_us(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 0U;
   }
-#endif
+  return ((uint64_t)ts.tv_sec * 1000000U) + ((uint64_t)ts.tv_nsec / 1000U);
+}
 
-  /*  GET /api/game/meta?path=... — game metadata (title, icon base64) */
-  if (strncmp(request->uri, "/api/game/meta", 14) == 0) {
-    return api_game_meta(request);
+static void route_record(int idx, uint64_t us) {
+  route_stats_t *st = &g_route_stats[idx];
+  atomic_fetch_add_explicit(&st->calls, 1U, memory_order_relaxed);
+  atomic_fetch_add_explicit(&st->total_us, us, memory_order_relaxed);
+  uint64_t max = atomic_load_explicit(&st->max_us, memory_order_relaxed);
+  while ((us > max) && !atomic_compare_exchange_weak_explicit(
+                           &st->max_us, &max, us, memory_order_relaxed,
+                           memory_order_relaxed)) {
   }
+}
 
-  /*  GET /api/game/icon?path=... — game cover art PNG */
-  if (strncmp(request->uri, "/api/game/icon", 14) == 0) {
-    return api_game_icon(request);
+/*
+ * Append per-route counters in text exposition format.  Latency covers
+ * building the response; a streamed or sendfile body is sent afterwards
+ * and is not included.  Returns the full length like snprintf().
+ */
+static size_t route_metrics_render(char *buf, size_t cap) {
+  size_t pos = 0U;
+#define ROUTE_OUT(...)                                                         \
+  do {                                                                         \
+    int n_ = snprintf(buf + ((pos < cap) ? pos : cap),                         \
+                      (pos < cap) ? (cap - pos) : 0U, __VA_ARGS__);            \
+    pos += (n_ > 0) ? (size_t)n_ : 0U;                                         \
+  } while (0)
+
+  static const struct {
+    const char *name;
+    const char *type;
+    const char *help;
+  } k_family[] = {
+      {"zftpd_http_route_requests_total", "counter",
+       "API requests dispatched per route"},
+      {"zftpd_http_route_duration_seconds_sum", "counter",
+       "Time spent building API responses per route"},
+      {"zftpd_http_route_duration_seconds_max", "gauge",
+       "Slowest API response build per route"},
+  };
+  for (size_t f = 0; f < sizeof(k_family) / sizeof(k_family[0]); f++) {
+    ROUTE_OUT("# HELP %s %s\n# TYPE %s %s\n", k_family[f].name,
+              k_family[f].help, k_family[f].name, k_family[f].type);
+    for (size_t i = 0; i < ROUTE_COUNT; i++) {
+      const route_stats_t *st = &g_route_stats[i];
+      uint64_t calls = atomic_load_explicit(&st->calls, memory_order_relaxed);
+      if (calls == 0U) {
+        continue;
+      }
+      if (f == 0U) {
+        ROUTE_OUT("%s{route=\"%s\"} %" PRIu64 "\n", k_family[f].name,
+                  g_routes[i].path, calls);
+      } else {
+        uint64_t us = atomic_load_explicit(
+            (f == 1U) ? &st->total_us : &st->max_us, memory_order_relaxed);
+        ROUTE_OUT("%s{route=\"%s\"} %" PRIu64 ".%06" PRIu64 "\n",
+                  k_family[f].name, g_routes[i].path, us / 1000000U,
+                  us % 1000000U);
+      }
+    }
   }
+#undef ROUTE_OUT
+  return pos;
+}
+
+static int list_is_paged(const char *query);
 
-  /*  POST /api/extract — archive extraction (libarchive) */
-  if (strncmp(request->uri, "/api/extract_progress", 21) == 0) {
-    return api_extract_progress(request);
+unsigned http_api_route_flags(const http_request_t *request) {
+  if (request == NULL) {
+    return 0U;
   }
-  if (strncmp(request->uri, "/api/extract_cancel", 19) == 0) {
-    return api_extract_cancel(request);
+  int idx = route_find(request->uri);
+  if (idx < 0) {
+    return 0U;
   }
-  if (strncmp(request->uri, "/api/extract", 12) == 0) {
-    return api_extract(request);
+  unsigned flags = g_routes[idx].flags;
+  /* A paged listing sorts the whole folder; the streamed one stays here */
+  if ((flags & R_OFFLOAD_PAGED) != 0U) {
+    const char *query = strchr(request->uri, '?');
+    if ((query != NULL) && list_is_paged(query)) {
+      flags |= R_OFFLOAD;
+    }
   }
+  return flags & (R_OFFLOAD | R_CSRF | R_CACHE);
+}
 
-  /*  POST /api/network/reset — flush TCP buffer accounting (Fix #4) */
-  if (strncmp(request->uri, "/api/network/reset", 18) == 0) {
-    return api_network_reset(request);
-  }
+int http_api_is_offloadable(const http_request_t *request) {
+  return ((http_api_route_flags(request) & R_OFFLOAD) != 0U) ? 1 : 0;
+}
 
-  /*  GET /api/admin/fan?threshold=... — set PS4/PS5 fan threshold */
-  if (strncmp(request->uri, "/api/admin/fan", 14) == 0) {
-    return api_admin_fan(request);
+http_response_t *http_api_handle(const http_request_t *request) {
+  if (request == NULL) {
+    return NULL;
   }
 
-  /* Games management API */
-  if (strncmp(request->uri, "/api/admin/games/installed",
-              sizeof("/api/admin/games/installed") - 1U) == 0) {
-    return api_games_installed(request);
-  }
-  if (strncmp(request->uri, "/api/admin/games/icon",
-              sizeof("/api/admin/games/icon") - 1U) == 0) {
-    return api_games_icon(request);
-  }
-  if (strncmp(request->uri, "/api/admin/games/repair_visibility",
-              sizeof("/api/admin/games/repair_visibility") - 1U) == 0) {
-    return api_games_repair_visibility(request);
-  }
-  if (strncmp(request->uri, "/api/admin/games/uninstall",
-              sizeof("/api/admin/games/uninstall") - 1U) == 0) {
-    return api_games_uninstall(request);
-  }
-  if (strncmp(request->uri, "/api/admin/games/install_status",
-              sizeof("/api/admin/games/install_status") - 1U) == 0) {
-    return api_games_install_status(request);
-  }
-  if (strncmp(request->uri, "/api/admin/games/install",
-              sizeof("/api/admin/games/install") - 1U) == 0) {
-    return api_games_install(request);
-  }
-  if (strncmp(request->uri, "/api/admin/games/reinstall",
-              sizeof("/api/admin/games/reinstall") - 1U) == 0) {
-    return api_games_reinstall(request);
+  int idx = route_find(request->uri);
+  if (idx < 0) {
+    /*  Static resources (index.html, style.css, app.js)  */
+    return serve_static(request);
   }
+  const api_route_t *route = &g_routes[idx];
 
-  /*  GET /api/admin/launch?id=... — launch PS4/PS5 app by title ID */
-  if (strncmp(request->uri, "/api/admin/launch", 17) == 0) {
-    return api_admin_launch(request);
+  unsigned method = route_method_bit(request->method);
+  if ((route->methods & method) == 0U) {
+    return error_json(HTTP_STATUS_405_METHOD_NOT_ALLOWED,
+                      ((route->methods & R_GET) != 0U)
+                          ? "Use GET for this endpoint"
+                          : "Use POST for this endpoint");
   }
 
-  /* Legacy frontend compatibility (old embedded UIs) */
-  if (strncmp(request->uri, "/api/stream/status", 18) == 0) {
-    return api_legacy_disabled_json(
-        "{\"ok\":true,\"enabled\":false,\"status\":\"offline\"}");
-  }
-  if (strncmp(request->uri, "/api/stream/start", 17) == 0 ||
-      strncmp(request->uri, "/api/stream/stop", 16) == 0 ||
-      strncmp(request->uri, "/api/stream", 11) == 0) {
-    return api_legacy_disabled_json(
-        "{\"ok\":false,\"message\":\"Stream disabled\"}");
-  }
-  if (strncmp(request->uri, "/api/admin/installed", 20) == 0) {
-    return api_legacy_disabled_json(
-        "{\"ok\":true,\"installed\":false}");
-  }
-  if (strncmp(request->uri, "/api/admin/install", 18) == 0) {
-    return api_legacy_disabled_json(
-        "{\"ok\":false,\"message\":\"Install API not available\"}");
+#if ENABLE_WEB_UPLOAD
+  /* CSRF Protection for mutating requests */
+  if ((method == R_POST) && ((route->flags & R_CSRF) != 0U)) {
+    if (http_csrf_validate(request) != 0) {
+      return error_json(HTTP_STATUS_403_FORBIDDEN,
+                        "Invalid or missing CSRF token");
+    }
   }
+#endif
 
-  /*  Static resources (index.html, style.css, app.js)  */
-  return serve_static(request);
+  uint64_t t0 = route_now_us();
+  http_response_t *resp = route->handler(request);
+  uint64_t t1 = route_now_us();
+  route_record(idx, (t1 > t0) ? (t1 - t0) : 0U);
+  return resp;
 }
 
 /*===========================================================================*
@@ -1580,42 +1501,358 @@ http_response_t *http_api_handle(const http_request_t *request) {
  *  }
  *===========================================================================*/
 
-static http_response_t *api_list(const http_request_t *request) {
-  /* Extract ?path= */
-  const char *query = strchr(request->uri, '?');
-  char path[1024] = "/";
+/*---------------------------------------------------------------------------*
+ * Paged listing — any of limit / cursor / sort / order / q / type /
+ * hidden / format selects it; a bare ?path= keeps the streamed reply.
+ *
+ *   sort    name (default) | size | mtime   — directories always first
+ *   order   asc (default) | desc
+ *   q       case-insensitive substring of the name
+ *   type    file | dir
+ *   hidden  0 drops dot-files
+ *   format  compact: entries are [name, "d"|"f", size, mtime] arrays
+ *   cursor  "next" of the previous page, with the same sort and filters
+ *
+ *  RESPONSE:
+ *  { "path": "/dir", "total": 31000, "next": "<cursor>" | null,
+ *    "entries": [ { "name": "a", "type": "file", "size": 1, "mtime": 2 } ] }
+ *
+ * Entries come from ftp_list_snapshot(), so the pages of one folder are
+ * cut from the same cached stat array instead of re-walking it.  The
+ * cursor is the sort key of the last entry sent (keyset pagination):
+ * files created or deleted between two pages neither repeat nor shift
+ * the window.
+ *---------------------------------------------------------------------------*/
 
-  if (query != NULL) {
-    (void)parse_path_param(query, path, sizeof(path));
+enum { LIST_SORT_NAME = 0, LIST_SORT_SIZE = 1, LIST_SORT_MTIME = 2 };
+
+typedef struct {
+  const char *name;
+  uint64_t size;
+  int64_t mtime;
+  uint8_t is_dir;
+  uint8_t key;  /* LIST_SORT_* */
+  uint8_t desc; /* same in every row; keeps the comparator context-free */
+} list_row_t;
+
+static int list_row_cmp(const void *pa, const void *pb) {
+  const list_row_t *a = (const list_row_t *)pa;
+  const list_row_t *b = (const list_row_t *)pb;
+  if (a->is_dir != b->is_dir) {
+    return (a->is_dir != 0U) ? -1 : 1;
+  }
+  int c = 0;
+  if (a->key == LIST_SORT_SIZE) {
+    c = (a->size < b->size) ? -1 : ((a->size > b->size) ? 1 : 0);
+  } else if (a->key == LIST_SORT_MTIME) {
+    c = (a->mtime < b->mtime) ? -1 : ((a->mtime > b->mtime) ? 1 : 0);
+  }
+  if (c == 0) {
+    c = strcasecmp(a->name, b->name);
+  }
+  if (c == 0) {
+    c = strcmp(a->name, b->name); /* total order: cursors stay exact */
+  }
+  return (a->desc != 0U) ? -c : c;
+}
+
+static int list_name_matches(const char *name, const char *q) {
+  size_t qlen = strlen(q);
+  for (const char *p = name; *p != '\0'; p++) {
+    if (strncasecmp(p, q, qlen) == 0) {
+      return 1;
+    }
   }
+  return (qlen == 0U) ? 1 : 0;
+}
 
-  char safe[FTP_PATH_MAX];
-  if (!validate_path(path, safe, sizeof(safe))) {
-    return error_json(HTTP_STATUS_403_FORBIDDEN,
-                      "Path traversal attempt detected");
+/* Cursor: hex of "<d>|<size>|<mtime>|<name>" for the last row sent */
+static int list_cursor_encode(const list_row_t *row, char *out, size_t cap) {
+  char raw[320];
+  int n = snprintf(raw, sizeof(raw), "%u|%" PRIu64 "|%" PRId64 "|%s",
+                   (unsigned)row->is_dir, row->size, row->mtime, row->name);
+  if ((n < 0) || ((size_t)n >= sizeof(raw)) ||
+      (((size_t)n * 2U) + 1U > cap)) {
+    return -1;
+  }
+  static const char hex[] = "0123456789abcdef";
+  for (int i = 0; i < n; i++) {
+    out[i * 2] = hex[(unsigned char)raw[i] >> 4];
+    out[(i * 2) + 1] = hex[(unsigned char)raw[i] & 0x0FU];
   }
+  out[n * 2] = '\0';
+  return 0;
+}
 
-  DIR *dir = opendir(safe);
-  if (dir == NULL) {
-    return error_json(HTTP_STATUS_404_NOT_FOUND, "Directory not found");
+static int list_cursor_decode(const char *in, list_row_t *row, char *name,
+                              size_t name_cap) {
+  char raw[320];
+  size_t n = strlen(in);
+  if (((n % 2U) != 0U) || ((n / 2U) >= sizeof(raw))) {
+    return -1;
+  }
+  for (size_t i = 0; i < n / 2U; i++) {
+    unsigned v = 0U;
+    if (sscanf(in + (i * 2U), "%2x", &v) != 1) {
+      return -1;
+    }
+    raw[i] = (char)v;
   }
+  raw[n / 2U] = '\0';
 
-  /*
-   * STREAMING JSON (Chunked Transfer Encoding)
-   * Instead of building the whole JSON in memory (which can exceed 512KB),
-   * we send the headers and the opening JSON, then let http_server.c
-   * stream the entries one by one.
-   */
+  unsigned d = 0U;
+  int consumed = 0;
+  if (sscanf(raw, "%u|%" SCNu64 "|%" SCNd64 "|%n", &d, &row->size,
+             &row->mtime, &consumed) != 3 ||
+      (consumed <= 0) || (strlen(raw + consumed) >= name_cap)) {
+    return -1;
+  }
+  memcpy(name, raw + consumed, strlen(raw + consumed) + 1U);
+  row->name = name;
+  row->is_dir = (d != 0U) ? 1U : 0U;
+  return 0;
+}
 
-  /* Build response headers */
-  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
-  http_response_add_header(resp, "Content-Type", "application/json");
-  http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
-  http_response_add_header(resp, "Transfer-Encoding", "chunked");
+static int list_is_paged(const char *query) {
+  static const char *const keys[] = {"limit", "cursor", "sort",   "order",
+                                     "q",     "type",   "hidden", "format"};
+  for (size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+    const char *p = query;
+    size_t klen = strlen(keys[i]);
+    while ((p = strstr(p, keys[i])) != NULL) {
+      if (((p == query) || (p[-1] == '?') || (p[-1] == '&')) &&
+          (p[klen] == '=')) {
+        return 1;
+      }
+      p += klen;
+    }
+  }
+  return 0;
+}
 
-  /* Prepare the opening JSON: {"path":"<escaped>","entries":[ */
-  char prefix[2048];
-  size_t pos = 0;
+static http_response_t *api_list_paged(const char *query, const char *path,
+                                       const char *safe) {
+  char arg[300];
+  size_t limit = (size_t)HTTP_LIST_PAGE_DEFAULT;
+  if (parse_query_param(query, "limit", arg, sizeof(arg)) == 0) {
+    unsigned long v = strtoul(arg, NULL, 10);
+    limit = (v == 0UL) ? 1U : (size_t)v;
+    if (limit > (size_t)HTTP_LIST_PAGE_MAX) {
+      limit = (size_t)HTTP_LIST_PAGE_MAX;
+    }
+  }
+  uint8_t key = LIST_SORT_NAME;
+  if (parse_query_param(query, "sort", arg, sizeof(arg)) == 0) {
+    if (strcmp(arg, "size") == 0) {
+      key = LIST_SORT_SIZE;
+    } else if (strcmp(arg, "mtime") == 0) {
+      key = LIST_SORT_MTIME;
+    }
+  }
+  uint8_t desc = ((parse_query_param(query, "order", arg, sizeof(arg)) == 0) &&
+                  (strcmp(arg, "desc") == 0))
+                     ? 1U
+                     : 0U;
+  int want_type = 0; /* 1 file, 2 dir */
+  if (parse_query_param(query, "type", arg, sizeof(arg)) == 0) {
+    want_type = (strcmp(arg, "dir") == 0) ? 2 : 1;
+  }
+  int hide_dot = ((parse_query_param(query, "hidden", arg, sizeof(arg)) == 0) &&
+                  (strcmp(arg, "0") == 0))
+                     ? 1
+                     : 0;
+  int compact = ((parse_query_param(query, "format", arg, sizeof(arg)) == 0) &&
+                 (strcmp(arg, "compact") == 0))
+                    ? 1
+                    : 0;
+  char q[256] = "";
+  (void)parse_query_param(query, "q", q, sizeof(q));
+
+  list_row_t after;
+  char after_name[300];
+  int have_cursor = 0;
+  if (parse_query_param(query, "cursor", arg, sizeof(arg)) == 0) {
+    if (list_cursor_decode(arg, &after, after_name, sizeof(after_name)) != 0) {
+      return error_json(HTTP_STATUS_400_BAD_REQUEST, "Invalid cursor");
+    }
+    after.key = key;
+    after.desc = desc;
+    have_cursor = 1;
+  }
+
+  ftp_list_snapshot_t snap;
+  if (ftp_list_snapshot(safe, &snap) != FTP_OK) {
+    return error_json(HTTP_STATUS_404_NOT_FOUND, "Directory not found");
+  }
+
+  list_row_t *rows =
+      malloc(((snap.count > 0U) ? snap.count : 1U) * sizeof(*rows));
+  if (rows == NULL) {
+    ftp_list_snapshot_release(&snap);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+  int at_root = (strcmp(safe, "/") == 0) ? 1 : 0;
+  size_t total = 0U;
+  for (size_t i = 0; i < snap.count; i++) {
+    const char *name = ftp_list_snapshot_name(&snap, i);
+    const vfs_stat_t *st = ftp_list_snapshot_stat(&snap, i);
+    uint8_t is_dir = S_ISDIR((mode_t)st->mode) ? 1U : 0U;
+    if (((at_root != 0) &&
+         ((strcmp(name, "dev") == 0) || (strcmp(name, "proc") == 0) ||
+          (strcmp(name, "sys") == 0) || (strcmp(name, "kern") == 0))) ||
+        ((hide_dot != 0) && (name[0] == '.')) ||
+        ((want_type == 1) && (is_dir != 0U)) ||
+        ((want_type == 2) && (is_dir == 0U)) ||
+        ((q[0] != '\0') && !list_name_matches(name, q))) {
+      continue;
+    }
+    rows[total].name = name;
+    rows[total].size = st->size;
+    rows[total].mtime = st->mtime;
+    rows[total].is_dir = is_dir;
+    rows[total].key = key;
+    rows[total].desc = desc;
+    total++;
+  }
+  qsort(rows, total, sizeof(*rows), list_row_cmp);
+
+  /* First row sorting after the cursor */
+  size_t first = 0U;
+  if (have_cursor != 0) {
+    size_t lo = 0U;
+    size_t hi = total;
+    while (lo < hi) {
+      size_t mid = lo + ((hi - lo) / 2U);
+      if (list_row_cmp(&rows[mid], &after) <= 0) {
+        lo = mid + 1U;
+      } else {
+        hi = mid;
+      }
+    }
+    first = lo;
+  }
+  size_t end = ((total - first) > limit) ? (first + limit) : total;
+
+  size_t cap = 256U + strlen(path) * 6U + (HTTP_LIST_CURSOR_MAX);
+  for (size_t i = first; i < end; i++) {
+    cap += (strlen(rows[i].name) * 6U) + 96U;
+  }
+  char *body = malloc(cap);
+  if (body == NULL) {
+    free(rows);
+    ftp_list_snapshot_release(&snap);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+
+  size_t pos = 0U;
+  int bad = 0;
+  bad |= buf_append_cstr(body, cap, &pos, "{\"path\":\"");
+  bad |= json_escape_append(body, cap, &pos, path);
+  bad |= buf_append_cstr(body, cap, &pos, "\",\"total\":");
+  bad |= buf_append_u64(body, cap, &pos, (uint64_t)total);
+  bad |= buf_append_cstr(body, cap, &pos, ",\"next\":");
+  if (end < total) {
+    char cursor[HTTP_LIST_CURSOR_MAX];
+    if (list_cursor_encode(&rows[end - 1U], cursor, sizeof(cursor)) == 0) {
+      bad |= buf_append_cstr(body, cap, &pos, "\"");
+      bad |= buf_append_cstr(body, cap, &pos, cursor);
+      bad |= buf_append_cstr(body, cap, &pos, "\"");
+    } else {
+      bad |= buf_append_cstr(body, cap, &pos, "null");
+    }
+  } else {
+    bad |= buf_append_cstr(body, cap, &pos, "null");
+  }
+  if (compact != 0) {
+    bad |= buf_append_cstr(
+        body, cap, &pos, ",\"fields\":[\"name\",\"type\",\"size\",\"mtime\"]");
+  }
+  /* Per-entry punctuation: [format][0 open, 1 file, 2 dir, 3 mid, 4 close] */
+  static const char *const k_row[2][5] = {
+      {"{\"name\":\"", "\",\"type\":\"file\",\"size\":",
+       "\",\"type\":\"directory\",\"size\":", ",\"mtime\":", "}"},
+      {"[\"", "\",\"f\",", "\",\"d\",", ",", "]"},
+  };
+  const char *const *fmt = k_row[compact];
+  bad |= buf_append_cstr(body, cap, &pos, ",\"entries\":[");
+  for (size_t i = first; (i < end) && (bad == 0); i++) {
+    const list_row_t *r = &rows[i];
+    if (i > first) {
+      bad |= buf_append_cstr(body, cap, &pos, ",");
+    }
+    bad |= buf_append_cstr(body, cap, &pos, fmt[0]);
+    bad |= json_escape_append(body, cap, &pos, r->name);
+    bad |= buf_append_cstr(body, cap, &pos, fmt[(r->is_dir != 0U) ? 2 : 1]);
+    bad |= buf_append_u64(body, cap, &pos, r->size);
+    bad |= buf_append_cstr(body, cap, &pos, fmt[3]);
+    bad |= buf_append_u64(body, cap, &pos,
+                          (r->mtime > 0) ? (uint64_t)r->mtime : 0U);
+    bad |= buf_append_cstr(body, cap, &pos, fmt[4]);
+  }
+  bad |= buf_append_cstr(body, cap, &pos, "]}");
+  free(rows);
+  ftp_list_snapshot_release(&snap);
+
+  if (bad != 0) {
+    free(body);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Listing too large");
+  }
+
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    free(body);
+    return NULL;
+  }
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
+  if (http_response_set_body_owned(resp, body, pos) != 0) {
+    free(body);
+    http_response_destroy(resp);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+  return resp;
+}
+
+static http_response_t *api_list(const http_request_t *request) {
+  /* Extract ?path= */
+  const char *query = strchr(request->uri, '?');
+  char path[1024] = "/";
+
+  if (query != NULL) {
+    (void)parse_path_param(query, path, sizeof(path));
+  }
+
+  char safe[FTP_PATH_MAX];
+  if (!validate_path(path, safe, sizeof(safe))) {
+    return error_json(HTTP_STATUS_403_FORBIDDEN,
+                      "Path traversal attempt detected");
+  }
+
+  if ((query != NULL) && list_is_paged(query)) {
+    return api_list_paged(query, path, safe);
+  }
+
+  DIR *dir = opendir(safe);
+  if (dir == NULL) {
+    return error_json(HTTP_STATUS_404_NOT_FOUND, "Directory not found");
+  }
+
+  /*
+   * STREAMING JSON (Chunked Transfer Encoding)
+   * Instead of building the whole JSON in memory (which can exceed 512KB),
+   * we send the headers and the opening JSON, then let http_server.c
+   * stream the entries one by one.
+   */
+
+  /* Build response headers */
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
+  http_response_add_header(resp, "Transfer-Encoding", "chunked");
+
+  /* Prepare the opening JSON: {"path":"<escaped>","entries":[ */
+  char prefix[2048];
+  size_t pos = 0;
   size_t cap = sizeof(prefix);
 
   pos += (size_t)snprintf(prefix + pos, cap - pos, "{\"path\":\"");
@@ -1652,7 +1889,15 @@ static http_response_t *api_list(const http_request_t *request) {
  *  Called lazily by the frontend after the listing is already rendered,
  *  so it does not block the initial directory load.
  *
- *  RESPONSE: {"path":"/some/dir","size":123456789}
+ *  Answered from the background size index (ftp_dirsize.h).  A tree seen
+ *  for the first time gets DIR_SIZE_TIMEOUT_MS to finish its walk; after
+ *  that the reply is partial and a later call returns the full size.
+ *  "stale" means a change is still being folded in or the subtree is
+ *  due for revalidation; "age" is the seconds since it was verified.
+ *
+ *  RESPONSE:
+ *  {"path":"/some/dir","size":123456789,"partial":false,"stale":false,
+ *   "age":3}
  *===========================================================================*/
 
 static http_response_t *api_dirsize(const http_request_t *request) {
@@ -1674,8 +1919,10 @@ static http_response_t *api_dirsize(const http_request_t *request) {
     return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a directory");
   }
 
-  int partial = 0;
-  uint64_t sz = http_dir_size_with_partial(safe, &partial);
+  ftp_dirsize_info_t info;
+  if (ftp_dirsize_query(safe, DIR_SIZE_TIMEOUT_MS, &info) != 0) {
+    return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a directory");
+  }
 
   char body[256];
   size_t pos = 0;
@@ -1684,10 +1931,15 @@ static http_response_t *api_dirsize(const http_request_t *request) {
   if (buf_append_cstr(body, cap, &pos, "{\"path\":\"") != 0 ||
       json_escape_append(body, cap, &pos, path) != 0 ||
       buf_append_cstr(body, cap, &pos, "\",\"size\":") != 0 ||
-      buf_append_u64(body, cap, &pos, sz) != 0 ||
+      buf_append_u64(body, cap, &pos, info.bytes) != 0 ||
+      buf_append_cstr(body, cap, &pos,
+                      info.partial ? ",\"partial\":true"
+                                   : ",\"partial\":false") != 0 ||
       buf_append_cstr(body, cap, &pos,
-                      partial ? ",\"partial\":true}"
-                              : ",\"partial\":false}") != 0) {
+                      info.stale ? ",\"stale\":true,\"age\":"
+                                 : ",\"stale\":false,\"age\":") != 0 ||
+      buf_append_u64(body, cap, &pos, (uint64_t)info.age_s) != 0 ||
+      buf_append_cstr(body, cap, &pos, "}") != 0) {
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
 
@@ -1704,9 +1956,21 @@ static http_response_t *api_dirsize(const http_request_t *request) {
  *
  *  Reads the file and sends it with Content-Disposition: attachment.
  *  For large files, uses the sendfile_fd field so the server can
- *  stream with sendfile() / read+write loop.
+ *  stream with sendfile() / read+write loop.  Files inside a mounted
+ *  exFAT image (SITE MOUNT) are streamed from the image's extents.
  *===========================================================================*/
 
+/* Close what api_download() opened on an early return */
+static void download_release(int fd, vfs_node_t *node) {
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (node != NULL) {
+    vfs_close(node);
+    free(node);
+  }
+}
+
 static http_response_t *api_download(const http_request_t *request) {
   const char *query = strchr(request->uri, '?');
   char path[1024] = "";
@@ -1725,24 +1989,101 @@ static http_response_t *api_download(const http_request_t *request) {
                       "Path traversal attempt detected");
   }
 
-  /* Open file */
-  int fd = open(safe, O_RDONLY);
-  if (fd < 0) {
-    return error_json(HTTP_STATUS_404_NOT_FOUND, "File not found");
-  }
-
+  /*
+   * Open file: a real one by fd, or one inside a mounted exFAT image as
+   * a vfs node (read from the image's extents, never sendfile).
+   */
+  int fd = -1;
+  vfs_node_t *node = NULL;
   struct stat st;
-  if (fstat(fd, &st) < 0 || S_ISDIR(st.st_mode)) {
-    close(fd);
-    return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a regular file");
+  if (vfs_is_image_path(safe) != 0) {
+    vfs_stat_t vst;
+    if ((vfs_stat(safe, &vst) != FTP_OK) ||
+        ((vst.mode & (uint32_t)S_IFMT) != (uint32_t)S_IFREG)) {
+      return error_json(HTTP_STATUS_404_NOT_FOUND, "File not found");
+    }
+    node = (vfs_node_t *)malloc(sizeof(*node));
+    if ((node == NULL) || (vfs_open(node, safe) != FTP_OK)) {
+      free(node);
+      return error_json(HTTP_STATUS_404_NOT_FOUND, "File not found");
+    }
+    memset(&st, 0, sizeof(st));
+    st.st_mode = (mode_t)vst.mode;
+    st.st_size = (off_t)vfs_get_size(node);
+    st.st_mtime = (time_t)vst.mtime;
+  } else {
+    fd = open(safe, O_RDONLY);
+    if (fd < 0) {
+      return error_json(HTTP_STATUS_404_NOT_FOUND, "File not found");
+    }
+    if (fstat(fd, &st) < 0 || S_ISDIR(st.st_mode)) {
+      close(fd);
+      return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a regular file");
+    }
   }
 
   /* Extract basename for Content-Disposition */
   const char *basename = strrchr(path, '/');
   basename = (basename != NULL) ? basename + 1 : path;
 
+  /*
+   * RANGE / RESUME
+   *
+   *   Range: bytes=...            → 206 + Content-Range, or 416
+   *   If-Range: <etag | date>     → honour Range only if the file is the
+   *                                 one the client already holds
+   *
+   * The ETag combines inode, size and mtime, so a replaced or rewritten
+   * file never matches a stale partial download.
+   */
+  uint64_t file_size = (uint64_t)st.st_size;
+  char etag[80];
+  (void)snprintf(etag, sizeof(etag), "\"%llx-%llx-%llx\"",
+                 (unsigned long long)st.st_ino, (unsigned long long)file_size,
+                 (unsigned long long)st.st_mtime);
+  char last_modified[64] = "";
+  {
+    struct tm tm_utc;
+    time_t mtime = st.st_mtime;
+    if (gmtime_r(&mtime, &tm_utc) != NULL) {
+      (void)strftime(last_modified, sizeof(last_modified),
+                     "%a, %d %b %Y %H:%M:%S GMT", &tm_utc);
+    }
+  }
+
+  uint64_t range_start = 0U;
+  uint64_t range_len = file_size;
+  int range_rc = 0;
+  const char *range = http_get_header(request, "Range");
+  if (range != NULL) {
+    const char *if_range = http_get_header(request, "If-Range");
+    if ((if_range == NULL) || (strcmp(if_range, etag) == 0) ||
+        ((last_modified[0] != '\0') &&
+         (strcmp(if_range, last_modified) == 0))) {
+      range_rc = http_parse_range(range, file_size, &range_start, &range_len);
+    }
+  }
+
+  char content_range[96];
+  if (range_rc < 0) {
+    download_release(fd, node);
+    http_response_t *err =
+        http_response_create(HTTP_STATUS_416_RANGE_NOT_SATISFIABLE);
+    if (err == NULL) {
+      return NULL;
+    }
+    (void)snprintf(content_range, sizeof(content_range), "bytes */%llu",
+                   (unsigned long long)file_size);
+    http_response_add_header(err, "Access-Control-Allow-Origin", "*");
+    http_response_add_header(err, "Accept-Ranges", "bytes");
+    http_response_add_header(err, "Content-Range", content_range);
+    http_response_set_body(err, "", 0U);
+    return err;
+  }
+
   /* Build response headers */
-  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  http_response_t *resp = http_response_create(
+      (range_rc > 0) ? HTTP_STATUS_206_PARTIAL_CONTENT : HTTP_STATUS_200_OK);
   /*
    * SAFETY: http_response_create() returns NULL when the response pool is
    * exhausted (HTTP_MAX_CONNECTIONS concurrent responses already in flight).
@@ -1756,7 +2097,7 @@ static http_response_t *api_download(const http_request_t *request) {
    * @post On NULL return: fd is closed, no resources are leaked
    */
   if (resp == NULL) {
-    close(fd);
+    download_release(fd, node);
     return NULL; /* http_handle_request() will synthesise a 500 response */
   }
   http_response_add_header(resp, "Content-Type", "application/octet-stream");
@@ -1767,8 +2108,21 @@ static http_response_t *api_download(const http_request_t *request) {
            basename);
   http_response_add_header(resp, "Content-Disposition", disposition);
 
+  http_response_add_header(resp, "Accept-Ranges", "bytes");
+  http_response_add_header(resp, "ETag", etag);
+  if (last_modified[0] != '\0') {
+    http_response_add_header(resp, "Last-Modified", last_modified);
+  }
+  if (range_rc > 0) {
+    (void)snprintf(content_range, sizeof(content_range),
+                   "bytes %llu-%llu/%llu", (unsigned long long)range_start,
+                   (unsigned long long)(range_start + range_len - 1U),
+                   (unsigned long long)file_size);
+    http_response_add_header(resp, "Content-Range", content_range);
+  }
+
   char len_str[32];
-  snprintf(len_str, sizeof(len_str), "%lld", (long long)st.st_size);
+  snprintf(len_str, sizeof(len_str), "%llu", (unsigned long long)range_len);
   http_response_add_header(resp, "Content-Length", len_str);
 
   /*
@@ -1780,15 +2134,20 @@ static http_response_t *api_download(const http_request_t *request) {
    * @post On failure: fd is closed, resp is freed, no resources are leaked
    */
   if (http_response_finalize(resp) != 0) {
-    close(fd);
+    download_release(fd, node);
     http_response_destroy(resp);
     return NULL;
   }
 
   /* Store fd so http_server.c can stream the file content */
   resp->sendfile_fd = fd;
-  resp->sendfile_offset = 0;
-  resp->sendfile_count = (size_t)st.st_size;
+  resp->sendfile_node = node;
+  resp->sendfile_offset = (off_t)range_start;
+  resp->sendfile_count = (size_t)range_len;
+  if (node != NULL) {
+    resp->sendfile_safe = 0; /* no fd: pread through the image */
+    return resp;
+  }
 
   /*
    * SENDFILE SAFETY CHECK — must happen before http_server.c touches the fd.
@@ -1876,11 +2235,15 @@ static http_response_t *api_stats(const http_request_t *request) {
   uint32_t items = 0U;
   int items_ok = count_dir_items(path, &items);
 
-  uint64_t boot_epoch = 0U;
-  int boot_ok = get_boot_epoch_seconds(&boot_epoch);
-
-  int32_t temp_c = 0;
-  int temp_ok = get_cpu_temp_c(&temp_c);
+  http_sysmon_sample_t sample;
+  if (http_sysmon_latest(&sample) != 0) {
+    sample.boot_ok = -1;
+    sample.temp_ok = -1;
+  }
+  uint64_t boot_epoch = sample.boot_epoch;
+  int boot_ok = sample.boot_ok;
+  int32_t temp_c = sample.cpu_temp;
+  int temp_ok = sample.temp_ok;
 
   char body[1024];
   size_t pos = 0U;
@@ -2015,6 +2378,7 @@ static http_response_t *api_create_file(const http_request_t *request) {
   }
 
   (void)pal_file_close(fd);
+  ftp_list_cache_invalidate(safe_full);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
@@ -2080,6 +2444,7 @@ static http_response_t *api_mkdir(const http_request_t *request) {
     snprintf(msg, sizeof(msg), "mkdir failed: %s", strerror(errno));
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR, msg);
   }
+  ftp_list_cache_invalidate(safe_full);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
@@ -2151,7 +2516,9 @@ static http_response_t *api_delete(const http_request_t *request) {
      * Strategy:
      *   1. Try rmdir() first — fast, safe, and correct for truly empty dirs.
      *   2. If that returns ENOTEMPTY and the caller passed ?recursive=1,
-     *      fall back to pal_dir_remove_recursive() (depth-first unlink tree).
+     *      queue a delete job (ftp_copyjob_delete) and answer at once with
+     *      its id; ?trash=1 renames the tree aside first so the path is
+     *      already gone when the response is sent.
      *   3. Without ?recursive=1 on a non-empty dir: return 409 Conflict
      *      with a clear message so the web UI can prompt for confirmation
      *      rather than silently succeeding or giving a generic 500.
@@ -2160,10 +2527,9 @@ static http_response_t *api_delete(const http_request_t *request) {
      * ?recursive=1.  A plain POST /api/delete?path=X on a non-empty dir
      * returns 409 instead of deleting everything silently.
      *
-     * @note pal_dir_remove_recursive() is the same depth-first cleanup
-     *       used in the rollback path of pal_copy_cross_device_r_ex, so
-     *       its error handling (unlink failures on locked files, etc.) is
-     *       already well-exercised.
+     * @note A tree of 100k files takes minutes to remove; the job empties
+     *       it on the copy worker pool and reports progress through
+     *       /api/copy_progress?job=N like a copy.
      */
     rc = pal_dir_remove(safe); /* try rmdir first */
 
@@ -2172,12 +2538,33 @@ static http_response_t *api_delete(const http_request_t *request) {
       const char *recursive_flag = strstr(query, "recursive=1");
       if (recursive_flag != NULL) {
         /* Caller explicitly requested recursive delete — proceed */
-        rc = pal_dir_remove_recursive_pub(safe);
+        char val[8];
+        int trash = ((parse_query_param(query, "trash", val, sizeof(val)) ==
+                      0) &&
+                     (strcmp(val, "1") == 0))
+                        ? 1
+                        : 0;
+        uint32_t job = 0U;
+        rc = ftp_copyjob_delete(safe, trash, &job);
+        if (rc == FTP_ERR_MAX_SESSIONS) {
+          return error_json(HTTP_STATUS_503_SERVICE_UNAVAILABLE,
+                            "Too many background jobs; try again later");
+        }
         if (rc != FTP_OK) {
-          return error_json(
-              HTTP_STATUS_500_INTERNAL_ERROR,
-              "Recursive delete failed (permission denied or I/O error)");
+          return error_json(HTTP_STATUS_500_INTERNAL_ERROR,
+                            "Failed to start recursive delete");
         }
+        ftp_list_cache_invalidate(safe);
+
+        char body[64];
+        int len = snprintf(body, sizeof(body),
+                           "{\"ok\":true,\"async\":true,\"job\":%" PRIu32 "}",
+                           job);
+        http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+        http_response_add_header(resp, "Content-Type", "application/json");
+        http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
+        http_response_set_body(resp, body, (size_t)len);
+        return resp;
       } else {
         /*
          * Return 409 Conflict — the directory is not empty and the
@@ -2200,6 +2587,8 @@ static http_response_t *api_delete(const http_request_t *request) {
     }
   }
 
+  ftp_list_cache_invalidate(safe);
+
   /* POST-DELETE VERIFICATION: Ensure the path was actually deleted */
   struct stat verify_st;
   if (stat(safe, &verify_st) == 0) {
@@ -2294,6 +2683,8 @@ static http_response_t *api_rename(const http_request_t *request) {
   if (rc != FTP_OK) {
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Rename failed");
   }
+  ftp_list_cache_invalidate(safe_old);
+  ftp_list_cache_invalidate(safe_new);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
@@ -2307,115 +2698,140 @@ static http_response_t *api_rename(const http_request_t *request) {
 }
 
 /*===========================================================================*
- * COPY PROGRESS TRACKING  (background pthread)
+ * COPY JOBS  (ftp_copyjob.h)
  *
  *   ┌──────────────────────────────────────────────────────┐
  *   │           Browser            Server                  │
- *   │    POST /api/copy ──────────►  spawn pthread         │
- *   │    ◄── {ok:true,async:true}       │                  │
- *   │                                   │ copy thread      │
- *   │    GET /api/copy_progress ◄────── atomic counters    │
- *   │    (polled every 500ms)            │                  │
- *   │                                   ▼                  │
+ *   │    POST /api/copy ──────────►  ftp_copyjob_submit    │
+ *   │    ◄── {ok:true,async:true,job:N}  │                 │
+ *   │                                    │ worker pool     │
+ *   │    GET /api/copy_progress?job=N ◄─ job counters      │
+ *   │    (polled every 500ms)            │                 │
+ *   │                                    ▼                 │
  *   │    GET /api/copy_progress ──► done=true              │
  *   └──────────────────────────────────────────────────────┘
+ *
+ * Several copies may run at once.  Without ?job= the progress, pause
+ * and cancel endpoints act on the most recent job, which keeps the
+ * single-copy UI working unchanged.
  *===========================================================================*/
 
-#include <pthread.h>
-
-typedef struct {
-  _Atomic uint64_t bytes_copied;
-  _Atomic uint64_t total_bytes;
-  _Atomic int active;      /* 1 while copy thread is running  */
-  _Atomic int done;        /* 1 when copy finished             */
-  _Atomic int error;       /* 1 if copy failed                 */
-  _Atomic int cancel;      /* 1 to request cancellation        */
-  _Atomic int paused;      /* 1 to pause, 0 to resume          */
-  _Atomic int error_code;  /* ftp_error_t value on failure     */
-  _Atomic int error_errno; /* errno captured at failure point */
-} copy_progress_t;
-
-static copy_progress_t g_copy_progress = {0};
-
-static int copy_progress_cb(uint64_t bytes_copied, void *user_data) {
-  (void)user_data;
-  atomic_store(&g_copy_progress.bytes_copied, bytes_copied);
-
-  /* Pause: spin-wait in 100 ms increments while the flag is set.
-   * Check cancel each iteration so the user can abort while paused. */
-  while (atomic_load(&g_copy_progress.paused) != 0) {
-    if (atomic_load(&g_copy_progress.cancel) != 0) {
-      return -1;
-    }
-    usleep(100000); /* 100 ms */
+/* ?job=N, else the latest job; 0 = none */
+static uint32_t copy_job_param(const http_request_t *request) {
+  const char *query = strchr(request->uri, '?');
+  char val[16];
+  if (parse_query_param(query, "job", val, sizeof(val)) == 0) {
+    return (uint32_t)strtoul(val, NULL, 10);
   }
+  return ftp_copyjob_latest();
+}
 
-  /* Check cancellation flag — return -1 to abort copy */
-  return (atomic_load(&g_copy_progress.cancel) != 0) ? -1 : 0;
+static int copy_job_active(const ftp_copyjob_info_t *info) {
+  return ((info->state == FTP_COPYJOB_QUEUED) ||
+          (info->state == FTP_COPYJOB_RUNNING) ||
+          (info->state == FTP_COPYJOB_PAUSED))
+             ? 1
+             : 0;
 }
 
-/* Background copy thread */
-typedef struct {
-  char src[FTP_PATH_MAX];
-  char dst[FTP_PATH_MAX];
-  int *out_errno; /* points to g_copy_progress.error_errno storage (unused;
-                     errno captured inside) */
-} copy_thread_args_t;
-
-static void *copy_thread_fn(void *arg) {
-  copy_thread_args_t *a = (copy_thread_args_t *)arg;
-
-  int saved_errno = 0;
-  ftp_error_t rc = pal_file_copy_recursive_ex(
-      a->src, a->dst, 1, copy_progress_cb, NULL, &saved_errno);
-  if ((rc != FTP_OK) || (atomic_load(&g_copy_progress.cancel) != 0)) {
-    atomic_store(&g_copy_progress.error, 1);
-    atomic_store(&g_copy_progress.error_code, (int)rc);
-    atomic_store(&g_copy_progress.error_errno, saved_errno);
-  }
-  atomic_store(&g_copy_progress.active, 0);
-  atomic_store(&g_copy_progress.done, 1);
-
-  free(a);
-  return NULL;
+/* One job as JSON; shared by /api/copy_progress and /api/events */
+static int copy_job_json(const ftp_copyjob_info_t *info, char *body,
+                         size_t cap) {
+  int active = copy_job_active(info);
+  int err = ((active == 0) && (info->state != FTP_COPYJOB_DONE)) ? 1 : 0;
+
+  return snprintf(body, cap,
+                  "{\"job\":%" PRIu32 ",\"kind\":\"%s\","
+                  "\"active\":%s,\"done\":%s,"
+                  "\"error\":%s,\"paused\":%s,\"cancelled\":%s,"
+                  "\"error_code\":%d,"
+                  "\"error_errno\":%d,"
+                  "\"bytes_copied\":%" PRIu64 ",\"total_bytes\":%" PRIu64 ","
+                  "\"files_copied\":%" PRIu32 ",\"total_files\":%" PRIu32 "}",
+                  info->id,
+                  (info->is_delete != 0) ? "delete"
+                                         : ((info->is_move != 0) ? "move"
+                                                                 : "copy"),
+                  active ? "true" : "false",
+                  active ? "false" : "true", err ? "true" : "false",
+                  (info->state == FTP_COPYJOB_PAUSED) ? "true" : "false",
+                  (info->state == FTP_COPYJOB_CANCELLED) ? "true" : "false",
+                  info->error_code, info->error_errno, info->bytes_done,
+                  info->bytes_total, info->files_done, info->files_total);
 }
 
-/*  GET /api/copy_progress  */
+/* Latest job, or an idle record before the first copy */
+static int copy_progress_json(char *body, size_t cap) {
+  ftp_copyjob_info_t info;
+  if (ftp_copyjob_get(ftp_copyjob_latest(), &info) != 0) {
+    return snprintf(body, cap,
+                    "{\"job\":0,\"kind\":\"copy\",\"active\":false,"
+                    "\"done\":false,"
+                    "\"error\":false,\"paused\":false,\"cancelled\":false,"
+                    "\"error_code\":0,\"error_errno\":0,\"bytes_copied\":0,"
+                    "\"total_bytes\":0,\"files_copied\":0,\"total_files\":0}");
+  }
+  return copy_job_json(&info, body, cap);
+}
+
+/*  GET /api/copy_progress[?job=N]  */
 static http_response_t *api_copy_progress(const http_request_t *request) {
-  (void)request;
+  ftp_copyjob_info_t info;
+  char body[512];
+  int len;
 
-  uint64_t copied = atomic_load(&g_copy_progress.bytes_copied);
-  uint64_t total = atomic_load(&g_copy_progress.total_bytes);
-  int active = atomic_load(&g_copy_progress.active);
-  int done = atomic_load(&g_copy_progress.done);
-  int err = atomic_load(&g_copy_progress.error);
-  int err_code = atomic_load(&g_copy_progress.error_code);
-  int err_errno = atomic_load(&g_copy_progress.error_errno);
+  const char *query = strchr(request->uri, '?');
+  char val[16];
+  if (parse_query_param(query, "job", val, sizeof(val)) != 0) {
+    len = copy_progress_json(body, sizeof(body));
+  } else if (ftp_copyjob_get((uint32_t)strtoul(val, NULL, 10), &info) == 0) {
+    len = copy_job_json(&info, body, sizeof(body));
+  } else {
+    return error_json(HTTP_STATUS_404_NOT_FOUND, "Unknown copy job");
+  }
 
-  int is_paused = atomic_load(&g_copy_progress.paused);
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
+  http_response_set_body(resp, body, (size_t)len);
+  return resp;
+}
 
-  char body[320];
-  int len =
-      snprintf(body, sizeof(body),
-               "{\"active\":%s,\"done\":%s,\"error\":%s,\"paused\":%s,"
-               "\"error_code\":%d,"
-               "\"error_errno\":%d,"
-               "\"bytes_copied\":%" PRIu64 ",\"total_bytes\":%" PRIu64 "}",
-               active ? "true" : "false", done ? "true" : "false",
-               err ? "true" : "false", is_paused ? "true" : "false", err_code,
-               err_errno, copied, total);
+/*  GET /api/copy_jobs — every remembered job, oldest first  */
+static http_response_t *api_copy_jobs(const http_request_t *request) {
+  (void)request;
+  ftp_copyjob_info_t *jobs =
+      (ftp_copyjob_info_t *)malloc(FTP_COPYJOB_MAX * sizeof(*jobs));
+  size_t cap = 32U + (FTP_COPYJOB_MAX * 512U);
+  char *body = (char *)malloc(cap);
+  if ((jobs == NULL) || (body == NULL)) {
+    free(jobs);
+    free(body);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+
+  size_t n = ftp_copyjob_list(jobs, FTP_COPYJOB_MAX);
+  size_t len = (size_t)snprintf(body, cap, "{\"jobs\":[");
+  for (size_t i = 0U; i < n; i++) {
+    if (i > 0U) {
+      body[len++] = ',';
+    }
+    len += (size_t)copy_job_json(&jobs[i], body + len, cap - len);
+  }
+  len += (size_t)snprintf(body + len, cap - len, "]}");
+  free(jobs);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
   http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
-  http_response_set_body(resp, body, (size_t)len);
+  http_response_set_body(resp, body, len);
+  free(body);
   return resp;
 }
 
-/*  POST /api/copy_cancel  */
+/*  POST /api/copy_cancel[?job=N]  */
 static http_response_t *api_copy_cancel(const http_request_t *request) {
-  (void)request;
-  atomic_store(&g_copy_progress.cancel, 1);
+  (void)ftp_copyjob_cancel(copy_job_param(request));
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
@@ -2425,12 +2841,17 @@ static http_response_t *api_copy_cancel(const http_request_t *request) {
   return resp;
 }
 
-/*  POST /api/copy_pause — toggle pause/resume  */
+/*  POST /api/copy_pause[?job=N] — toggle pause/resume  */
 static http_response_t *api_copy_pause(const http_request_t *request) {
-  (void)request;
-  int cur = atomic_load(&g_copy_progress.paused);
-  int next = (cur != 0) ? 0 : 1;
-  atomic_store(&g_copy_progress.paused, next);
+  ftp_copyjob_info_t info;
+  uint32_t id = copy_job_param(request);
+  int next = 0;
+  if (ftp_copyjob_get(id, &info) == 0) {
+    next = (info.state == FTP_COPYJOB_PAUSED) ? 0 : 1;
+    if (ftp_copyjob_pause(id, next) != 0) {
+      next = 0; /* already finished */
+    }
+  }
 
   char body[64];
   int len = snprintf(body, sizeof(body), "{\"ok\":true,\"paused\":%s}",
@@ -2539,12 +2960,6 @@ static http_response_t *api_copy(const http_request_t *request) {
                       "Use POST for this endpoint");
   }
 
-  /* Reject if a copy is already in progress */
-  if (atomic_load(&g_copy_progress.active) != 0) {
-    return error_json(HTTP_STATUS_400_BAD_REQUEST,
-                      "A copy operation is already in progress");
-  }
-
   const char *query = strchr(request->uri, '?');
   if (query == NULL) {
     return error_json(HTTP_STATUS_400_BAD_REQUEST, "Missing query string");
@@ -2603,210 +3018,401 @@ static http_response_t *api_copy(const http_request_t *request) {
   }
 
   /*
-   * Compute total size for progress UI.
-   * For a single file use stat(). For directories an exact total
-   * would require a full recursive scan — instead the browser
-   * passes an estimate via ?totalsize= from the original listing.
+   * Size shown until the job's scan has counted the tree: stat() for a
+   * file, or the ?totalsize= estimate the browser has from the listing.
    */
-  {
-    struct stat copy_st;
-    uint64_t total_est = 0U;
-    if (stat(safe_src, &copy_st) == 0) {
-      total_est = (uint64_t)copy_st.st_size;
-    }
-    /* Client may provide totalsize hint for dirs */
-    const char *ts_str = strstr(query, "totalsize=");
-    if (ts_str != NULL) {
-      uint64_t ts_val = (uint64_t)strtoull(ts_str + 10, NULL, 10);
-      if (ts_val > 0U) {
-        total_est = ts_val;
-      }
+  uint64_t total_est = 0U;
+  struct stat copy_st;
+  if ((stat(safe_src, &copy_st) == 0) && S_ISREG(copy_st.st_mode)) {
+    total_est = (uint64_t)copy_st.st_size;
+  }
+  const char *ts_str = strstr(query, "totalsize=");
+  if (ts_str != NULL) {
+    uint64_t ts_val = (uint64_t)strtoull(ts_str + 10, NULL, 10);
+    if (ts_val > 0U) {
+      total_est = ts_val;
     }
-    atomic_store(&g_copy_progress.bytes_copied, 0U);
-    atomic_store(&g_copy_progress.total_bytes, total_est);
-    atomic_store(&g_copy_progress.active, 1);
-    atomic_store(&g_copy_progress.done, 0);
-    atomic_store(&g_copy_progress.error, 0);
-    atomic_store(&g_copy_progress.error_code, 0);
-    atomic_store(&g_copy_progress.error_errno, 0);
-    atomic_store(&g_copy_progress.cancel, 0);
-    atomic_store(&g_copy_progress.paused, 0);
-  }
-
-  /* Spawn background copy thread so event loop stays responsive */
-  copy_thread_args_t *args =
-      (copy_thread_args_t *)malloc(sizeof(copy_thread_args_t));
-  if (args == NULL) {
-    atomic_store(&g_copy_progress.active, 0);
-    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
-  (void)strncpy(args->src, safe_src, sizeof(args->src) - 1U);
-  args->src[sizeof(args->src) - 1U] = '\0';
-  (void)strncpy(args->dst, safe_final, sizeof(args->dst) - 1U);
-  args->dst[sizeof(args->dst) - 1U] = '\0';
 
-  pthread_t tid;
-  if (pthread_create(&tid, NULL, copy_thread_fn, args) != 0) {
-    free(args);
-    atomic_store(&g_copy_progress.active, 0);
+  uint32_t job = 0U;
+  ftp_error_t rc = ftp_copyjob_submit(safe_src, safe_final, 0, total_est, &job);
+  if (rc == FTP_ERR_MAX_SESSIONS) {
+    return error_json(HTTP_STATUS_503_SERVICE_UNAVAILABLE,
+                      "Too many copy jobs in progress");
+  }
+  if (rc != FTP_OK) {
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR,
-                      "Failed to start copy thread");
+                      "Failed to queue copy job");
   }
-  (void)pthread_detach(tid);
 
   /* Return immediately -- client polls /api/copy_progress for status */
+  char body[64];
+  int len = snprintf(body, sizeof(body),
+                     "{\"ok\":true,\"async\":true,\"job\":%" PRIu32 "}", job);
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
   http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
-  const char *body = "{\"ok\":true,\"async\":true}";
-  http_response_set_body(resp, body, strlen(body));
+  http_response_set_body(resp, body, (size_t)len);
   return resp;
 }
 #endif
 
 /*===========================================================================*
- * GET /api/stats/ram  — RAM usage
+ * GET /api/stats/ram[?since=N]  — RAM usage
+ *
+ *  RESPONSE: { "used": N, "cached": N, "buffers": N, "free": N, "total": N,
+ *              "seq": N, "at": N,
+ *              "history"?: [ { "seq", "at", "used", "cached", "buffers",
+ *                              "free", "total" }, ... ] }
  *
- *  RESPONSE: { "used": N, "cached": N, "buffers": N, "free": N, "total": N }
+ *  Values are the latest sample of the background sampler (http_sysmon.h),
+ *  so any number of dashboards cost one sysctl/procfs round per period.
+ *  With ?since=N, "history" lists the samples after seq N, oldest first:
+ *  a chart keeps polling with the last "seq" it got.  "at" is epoch ms.
  *===========================================================================*/
 
-static int get_ram_stats(uint64_t *used, uint64_t *cached, uint64_t *buffers,
-                         uint64_t *free_b, uint64_t *total) {
-  if (!used || !cached || !buffers || !free_b || !total) {
-    return -1;
+/* Samples after ?since= (malloc'd), NULL without the parameter */
+static http_sysmon_sample_t *sysmon_since(const char *query, size_t *count) {
+  char value[24];
+  *count = 0U;
+  if (parse_query_param(query, "since", value, sizeof(value)) != 0) {
+    return NULL;
   }
-  *used = 0;
-  *cached = 0;
-  *buffers = 0;
-  *free_b = 0;
-  *total = 0;
+  http_sysmon_sample_t *h = malloc(HTTP_SYSMON_HISTORY * sizeof(*h));
+  if (h != NULL) {
+    *count = http_sysmon_history(strtoull(value, NULL, 10), h,
+                                 HTTP_SYSMON_HISTORY);
+  }
+  return h;
+}
 
-#if defined(HAS_SYSINFO)
-  struct sysinfo si;
-  if (sysinfo(&si) != 0) {
-    return -1;
+static http_response_t *api_stats_ram(const http_request_t *request) {
+  http_sysmon_sample_t cur;
+  if (http_sysmon_latest(&cur) != 0) {
+    memset(&cur, 0, sizeof(cur));
+  }
+  size_t n = 0U;
+  http_sysmon_sample_t *hist =
+      sysmon_since(strchr(request->uri, '?'), &n);
+
+  size_t cap = 320U + (n * 192U);
+  char *body = malloc(cap);
+  if (body == NULL) {
+    free(hist);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+  size_t pos = (size_t)snprintf(
+      body, cap,
+      "{\"used\":%" PRIu64 ",\"cached\":%" PRIu64 ",\"buffers\":%" PRIu64
+      ",\"free\":%" PRIu64 ",\"total\":%" PRIu64 ",\"seq\":%" PRIu64
+      ",\"at\":%" PRId64,
+      cur.ram_used, cur.ram_cached, cur.ram_buffers, cur.ram_free,
+      cur.ram_total, cur.seq, cur.at_ms);
+  if (hist != NULL) {
+    pos += (size_t)snprintf(body + pos, cap - pos, ",\"history\":[");
+    for (size_t i = 0U; i < n; i++) {
+      const http_sysmon_sample_t *h = &hist[i];
+      pos += (size_t)snprintf(
+          body + pos, cap - pos,
+          "%s{\"seq\":%" PRIu64 ",\"at\":%" PRId64 ",\"used\":%" PRIu64
+          ",\"cached\":%" PRIu64 ",\"buffers\":%" PRIu64 ",\"free\":%" PRIu64
+          ",\"total\":%" PRIu64 "}",
+          (i == 0U) ? "" : ",", h->seq, h->at_ms, h->ram_used, h->ram_cached,
+          h->ram_buffers, h->ram_free, h->ram_total);
+    }
+    pos += (size_t)snprintf(body + pos, cap - pos, "]");
+  }
+  pos += (size_t)snprintf(body + pos, cap - pos, "}");
+  free(hist);
+
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    free(body);
+    return NULL;
+  }
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Cache-Control", "no-store");
+  if (http_response_set_body_owned(resp, body, pos) != 0) {
+    free(body);
   }
-  uint64_t unit = (uint64_t)si.mem_unit;
-  *total = (uint64_t)si.totalram * unit;
-  *free_b = (uint64_t)si.freeram * unit;
-  *buffers = (uint64_t)si.bufferram * unit;
-  *cached = 0; /* not in sysinfo; /proc/meminfo would give it */
-  *used = (*total > *free_b + *buffers + *cached)
-              ? (*total - *free_b - *buffers - *cached)
-              : 0U;
-  /* Try /proc/meminfo for Cached */
-  FILE *fp = fopen("/proc/meminfo", "r");
-  if (fp) {
-    char line[128];
-    while (fgets(line, sizeof(line), fp)) {
-      uint64_t v = 0;
-      if (sscanf(line, "Cached: %" SCNu64, &v) == 1) {
-        *cached = v * 1024U;
-      } else if (sscanf(line, "MemAvailable: %" SCNu64, &v) == 1) {
-        /* recalculate used from MemAvailable */
-        uint64_t avail = v * 1024U;
-        *used = (*total > avail) ? (*total - avail) : 0U;
+  return resp;
+}
+
+/*===========================================================================*
+ * GET  /api/bwlimit                       — bandwidth scheduler state
+ * POST /api/bwlimit?scope=global&bps=20M  — set one level (0 / off = none)
+ *
+ *  RESPONSE: { "global": N, "ip": N, "session": N,  (bytes/sec)
+ *              "clients", "ips", "granted_bytes", "waits", "wait_ms" }
+ *
+ *  scope is global, ip or session; bps takes K/M/G suffixes (1024-based).
+ *===========================================================================*/
+
+static http_response_t *api_bwlimit(const http_request_t *request) {
+  if (request->method == HTTP_METHOD_POST) {
+    const char *query = strchr(request->uri, '?');
+    char scope_text[16];
+    char bps_text[32];
+    if ((parse_query_param(query, "scope", scope_text, sizeof(scope_text)) !=
+         0) ||
+        (parse_query_param(query, "bps", bps_text, sizeof(bps_text)) != 0)) {
+      return error_json(HTTP_STATUS_400_BAD_REQUEST,
+                        "Missing scope or bps parameter");
+    }
+
+    int scope = -1;
+    for (int i = 0; i < (int)FTP_BW_SCOPES; i++) {
+      if (strcmp(scope_text, ftp_bw_scope_name((ftp_bw_scope_t)i)) == 0) {
+        scope = i;
       }
     }
-    fclose(fp);
+    uint64_t bps = 0U;
+    if ((scope < 0) || (ftp_bw_parse_rate(bps_text, &bps) != 0)) {
+      return error_json(HTTP_STATUS_400_BAD_REQUEST, "Invalid scope or bps");
+    }
+    ftp_bw_set_rate((ftp_bw_scope_t)scope, bps);
+  } else if (request->method != HTTP_METHOD_GET) {
+    return error_json(HTTP_STATUS_405_METHOD_NOT_ALLOWED,
+                      "Use GET or POST for this endpoint");
   }
-  return 0;
-#elif defined(PLATFORM_MACOS) || defined(__APPLE__)
-  /* Total physical memory */
-  uint64_t mem_total = 0;
-  size_t sz = sizeof(mem_total);
-  if (sysctlbyname("hw.memsize", &mem_total, &sz, NULL, 0) != 0) {
-    return -1;
+
+  ftp_bw_stats_t st;
+  ftp_bw_get_stats(&st);
+
+  char body[384];
+  int len = snprintf(
+      body, sizeof(body),
+      "{\"global\":%" PRIu64 ",\"ip\":%" PRIu64 ",\"session\":%" PRIu64
+      ",\"clients\":%u,\"ips\":%u,\"granted_bytes\":%" PRIu64
+      ",\"waits\":%" PRIu64 ",\"wait_ms\":%" PRIu64 "}",
+      st.rate[FTP_BW_GLOBAL], st.rate[FTP_BW_PER_IP], st.rate[FTP_BW_SESSION],
+      (unsigned)st.clients, (unsigned)st.ips, st.granted_bytes, st.waits,
+      st.wait_ns / (uint64_t)1000000U);
+
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Cache-Control", "no-store");
+  http_response_set_body(resp, body, (size_t)len);
+  return resp;
+}
+
+/*===========================================================================*
+ * GET /api/metrics  — counters and histograms for Prometheus
+ *
+ *  RESPONSE: text exposition format 0.0.4 (ftp_metrics_render()).  The
+ *  size depends on how many verbs have been used, so render once to
+ *  measure when the first guess is too small.
+ *===========================================================================*/
+static http_response_t *api_metrics(const http_request_t *request) {
+  if (request->method != HTTP_METHOD_GET) {
+    return error_json(HTTP_STATUS_405_METHOD_NOT_ALLOWED,
+                      "Use GET for this endpoint");
   }
-  *total = mem_total;
 
-  /* Page size */
-  vm_size_t page_sz = 0;
-  if (host_page_size(mach_host_self(), &page_sz) != KERN_SUCCESS) {
-    page_sz = 4096;
+  size_t cap = 64U * 1024U;
+  char *body = malloc(cap);
+  if (body == NULL) {
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+  size_t len = ftp_metrics_render(g_ftp_server_ctx, body, cap);
+  if (len < cap) {
+    len += route_metrics_render(body + len, cap - len);
+  }
+  if (len >= cap) {
+    cap = len + 4096U; /* room for counters moving between the passes */
+    char *grown = realloc(body, cap);
+    if (grown == NULL) {
+      free(body);
+      return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+    }
+    body = grown;
+    len = ftp_metrics_render(g_ftp_server_ctx, body, cap);
+    if (len < cap) {
+      len += route_metrics_render(body + len, cap - len);
+    }
+    if (len >= cap) {
+      len = cap - 1U;
+    }
   }
 
-  /* VM stats via host_statistics64 — same source as vm_stat(1) */
-  vm_statistics64_data_t vmstat;
-  mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
-  if (host_statistics64(mach_host_self(), HOST_VM_INFO64,
-                        (host_info64_t)&vmstat, &count) != KERN_SUCCESS) {
-    return -1;
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  http_response_add_header(resp, "Content-Type",
+                           "text/plain; version=0.0.4; charset=utf-8");
+  http_response_add_header(resp, "Cache-Control", "no-store");
+  if (http_response_set_body_owned(resp, body, len) != 0) {
+    free(body);
   }
+  return resp;
+}
 
-  *free_b = (uint64_t)vmstat.free_count * (uint64_t)page_sz;
-  *used =
-      (uint64_t)(vmstat.active_count + vmstat.wire_count) * (uint64_t)page_sz;
-  *cached = (uint64_t)vmstat.inactive_count * (uint64_t)page_sz;
-  *buffers = (uint64_t)vmstat.speculative_count * (uint64_t)page_sz;
-  return 0;
-#elif defined(PLATFORM_PS4) || defined(PLATFORM_PS5) || defined(PS4) ||        \
-    defined(PS5)
-  /* PS4/PS5 FreeBSD-derived kernel */
-  uint64_t physmem = 0;
-  size_t psz = sizeof(physmem);
-  sysctlbyname("hw.physmem", &physmem, &psz, NULL, 0);
-  *total = physmem;
-
-  uint32_t page_sz32 = 16384;
-  psz = sizeof(page_sz32);
-  sysctlbyname("hw.pagesize", &page_sz32, &psz, NULL, 0);
-  uint64_t page_sz = (uint64_t)page_sz32;
-
-  uint32_t v_free = 0, v_active = 0, v_inactive = 0, v_wire = 0;
-  psz = sizeof(v_free);
-  sysctlbyname("vm.stats.vm.v_free_count", &v_free, &psz, NULL, 0);
-  psz = sizeof(v_active);
-  sysctlbyname("vm.stats.vm.v_active_count", &v_active, &psz, NULL, 0);
-  psz = sizeof(v_inactive);
-  sysctlbyname("vm.stats.vm.v_inactive_count", &v_inactive, &psz, NULL, 0);
-  psz = sizeof(v_wire);
-  sysctlbyname("vm.stats.vm.v_wire_count", &v_wire, &psz, NULL, 0);
-
-  *free_b = (uint64_t)v_free * page_sz;
-  *used = (uint64_t)(v_active + v_wire) * page_sz;
-  *cached = (uint64_t)v_inactive * page_sz;
-  *buffers = 0;
-  return 0;
-#else
-  return -1;
-#endif
+/*===========================================================================*
+ * GET /api/trace  — recent transfer timelines, newest first
+ *
+ *  QUERY:    session=N (only that session), limit=N (default 16)
+ *  RESPONSE: { "traces": [ { "session", "cmd", "path", "ok", "start",
+ *                            "dropped", "events": [ { "kind", "at_us",
+ *                            "dur_us", "bytes", "count" }, ... ] }, ... ] }
+ *
+ *  "start" is the wall-clock epoch of the command; event times are
+ *  microseconds relative to it.
+ *===========================================================================*/
+#define API_TRACE_BYTES ((FTP_TRACE_EVENTS * 128U) + 512U) /* per timeline */
+
+static http_response_t *api_trace(const http_request_t *request) {
+  if (request->method != HTTP_METHOD_GET) {
+    return error_json(HTTP_STATUS_405_METHOD_NOT_ALLOWED,
+                      "Use GET for this endpoint");
+  }
+
+  const char *query = strchr(request->uri, '?');
+  char value[16];
+  uint32_t sid = FTP_TRACE_ALL_SESSIONS;
+  size_t limit = 16U;
+  if (parse_query_param(query, "session", value, sizeof(value)) == 0) {
+    sid = (uint32_t)strtoul(value, NULL, 10);
+  }
+  if (parse_query_param(query, "limit", value, sizeof(value)) == 0) {
+    limit = (size_t)strtoul(value, NULL, 10);
+  }
+  if ((limit == 0U) || (limit > FTP_TRACE_HISTORY)) {
+    limit = FTP_TRACE_HISTORY;
+  }
+
+  ftp_trace_t *traces = malloc(sizeof(ftp_trace_t) * limit);
+  size_t cap = (limit * API_TRACE_BYTES) + 64U;
+  char *body = malloc(cap);
+  if ((traces == NULL) || (body == NULL)) {
+    free(traces);
+    free(body);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+
+  size_t n = ftp_trace_recent(sid, traces, limit);
+  size_t pos = (size_t)snprintf(body, cap, "{\"traces\":[");
+  for (size_t i = 0U; i < n; i++) {
+    const ftp_trace_t *t = &traces[i];
+    pos += (size_t)snprintf(body + pos, cap - pos,
+                            "%s{\"session\":%u,\"cmd\":\"%s\",\"path\":\"",
+                            (i == 0U) ? "" : ",", (unsigned)t->session_id,
+                            t->cmd);
+    (void)json_escape_append(body, cap, &pos, t->path);
+    pos += (size_t)snprintf(body + pos, cap - pos,
+                            "\",\"ok\":%s,\"start\":%lld,\"dropped\":%u,"
+                            "\"events\":[",
+                            (t->ok != 0U) ? "true" : "false",
+                            (long long)t->wall, (unsigned)t->dropped);
+    for (size_t e = 0U; e < t->events; e++) {
+      const ftp_trace_event_t *ev = &t->ev[e];
+      pos += (size_t)snprintf(
+          body + pos, cap - pos,
+          "%s{\"kind\":\"%s\",\"at_us\":%" PRIu64 ",\"dur_us\":%" PRIu64
+          ",\"bytes\":%" PRIu64 ",\"count\":%u}",
+          (e == 0U) ? "" : ",",
+          ftp_trace_kind_name((ftp_trace_kind_t)ev->kind), ev->at_us,
+          ev->dur_us, ev->bytes, (unsigned)ev->count);
+    }
+    pos += (size_t)snprintf(body + pos, cap - pos, "]}");
+  }
+  pos += (size_t)snprintf(body + pos, cap - pos, "]}");
+  free(traces);
+
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Cache-Control", "no-store");
+  if (http_response_set_body_owned(resp, body, pos) != 0) {
+    free(body);
+  }
+  return resp;
 }
 
-static http_response_t *api_stats_ram(const http_request_t *request) {
+/*===========================================================================*
+ * GET /api/segments  — files being transferred, most data connections first
+ *
+ *  RESPONSE: { "files": [ { "path", "upload", "streams", "peak", "bytes",
+ *                           "size", "age_ms" }, ... ] }
+ *
+ *  One entry per file however many RETR / STOR streams move it (lftp
+ *  pget, mirror --use-pget-n): "bytes" is what all of them moved so far,
+ *  "peak" the most that ran at once (ftp_segment.h).
+ *===========================================================================*/
+
+static http_response_t *api_segments(const http_request_t *request) {
   (void)request;
-  uint64_t used = 0, cached = 0, buffers = 0, free_b = 0, total = 0;
-  get_ram_stats(&used, &cached, &buffers, &free_b, &total);
+  ftp_segment_info_t *files = malloc(sizeof(*files) * FTP_SEGMENT_FILES);
+  if (files == NULL) {
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+  size_t n = ftp_segment_snapshot(files, FTP_SEGMENT_FILES);
+  size_t cap = 32U;
+  for (size_t i = 0U; i < n; i++) {
+    cap += (strlen(files[i].path) * 6U) + 192U; /* worst-case escaping */
+  }
+  char *body = malloc(cap);
+  if (body == NULL) {
+    free(files);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
 
-  char body[256];
-  int len = snprintf(body, sizeof(body),
-                     "{\"used\":%" PRIu64 ",\"cached\":%" PRIu64
-                     ",\"buffers\":%" PRIu64 ",\"free\":%" PRIu64
-                     ",\"total\":%" PRIu64 "}",
-                     used, cached, buffers, free_b, total);
+  size_t pos = (size_t)snprintf(body, cap, "{\"files\":[");
+  for (size_t i = 0U; i < n; i++) {
+    const ftp_segment_info_t *f = &files[i];
+    pos += (size_t)snprintf(body + pos, cap - pos, "%s{\"path\":\"",
+                            (i == 0U) ? "" : ",");
+    (void)json_escape_append(body, cap, &pos, f->path);
+    pos += (size_t)snprintf(body + pos, cap - pos,
+                            "\",\"upload\":%s,\"streams\":%" PRIu32
+                            ",\"peak\":%" PRIu32 ",\"bytes\":%" PRIu64
+                            ",\"size\":%" PRIu64 ",\"age_ms\":%" PRIu64 "}",
+                            (f->upload != 0) ? "true" : "false", f->streams,
+                            f->peak, f->bytes, f->size, f->age_ms);
+  }
+  pos += (size_t)snprintf(body + pos, cap - pos, "]}");
+  free(files);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    free(body);
+    return NULL;
+  }
   http_response_add_header(resp, "Content-Type", "application/json");
   http_response_add_header(resp, "Cache-Control", "no-store");
-  http_response_set_body(resp, body, (size_t)len);
+  if (http_response_set_body_owned(resp, body, pos) != 0) {
+    free(body);
+  }
   return resp;
 }
 
 /*===========================================================================*
- * GET /api/stats/system  — CPU temp, uptime, boot time
+ * GET /api/stats/system[?since=N]  — CPU temp, uptime, boot time, caches
  *
  *  RESPONSE: { "cpu_temp": N|null, "uptime_seconds": N|null,
- *               "boot_epoch": N|null }
+ *               "boot_epoch": N|null, "seq": N, "at": N,
+ *               "history"?: [ { "seq", "at", "cpu_temp" }, ... ],
+ *               "list_cache": { "hits", "misses", "invalidations",
+ *                               "entries", "bytes" },
+ *               "stat_cache": { "hits", "misses", "invalidations",
+ *                               "entries" },
+ *               "buffers": [ { "size", "count", "in_use", "high_water",
+ *                              "huge", "acquires", "waits" }, ... ] }
+ *
+ *  buffers[] is ordered small, stream, large.  Temperature and boot time
+ *  come from the sampler, like /api/stats/ram (same ?since= history).
  *===========================================================================*/
 
 static http_response_t *api_stats_system(const http_request_t *request) {
-  (void)request;
-
-  int32_t temp_c = 0;
-  int temp_ok = get_cpu_temp_c(&temp_c);
-
-  uint64_t boot_epoch = 0;
-  int boot_ok = get_boot_epoch_seconds(&boot_epoch);
+  http_sysmon_sample_t cur;
+  if (http_sysmon_latest(&cur) != 0) {
+    memset(&cur, 0, sizeof(cur));
+    cur.temp_ok = -1;
+    cur.boot_ok = -1;
+  }
+  int32_t temp_c = cur.cpu_temp;
+  int temp_ok = cur.temp_ok;
+  uint64_t boot_epoch = cur.boot_epoch;
+  int boot_ok = cur.boot_ok;
+  size_t n = 0U;
+  http_sysmon_sample_t *hist =
+      sysmon_since(strchr(request->uri, '?'), &n);
 
   uint64_t uptime_sec = 0;
   if (boot_ok == 0) {
@@ -2816,9 +3422,13 @@ static http_response_t *api_stats_system(const http_request_t *request) {
     }
   }
 
-  char body[512];
+  size_t cap = 1664U + (n * 72U);
+  char *body = malloc(cap);
+  if (body == NULL) {
+    free(hist);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
   size_t pos = 0;
-  size_t cap = sizeof(body);
 
   pos += (size_t)snprintf(body + pos, cap - pos, "{");
   if (temp_ok == 0) {
@@ -2836,12 +3446,76 @@ static http_response_t *api_stats_system(const http_request_t *request) {
     pos += (size_t)snprintf(body + pos, cap - pos,
                             ",\"uptime_seconds\":null,\"boot_epoch\":null");
   }
-  pos += (size_t)snprintf(body + pos, cap - pos, "}");
+  pos += (size_t)snprintf(body + pos, cap - pos,
+                          ",\"seq\":%" PRIu64 ",\"at\":%" PRId64, cur.seq,
+                          cur.at_ms);
+  if (hist != NULL) {
+    pos += (size_t)snprintf(body + pos, cap - pos, ",\"history\":[");
+    for (size_t i = 0U; i < n; i++) {
+      char temp[16] = "null";
+      if (hist[i].temp_ok == 0) {
+        (void)snprintf(temp, sizeof(temp), "%" PRId32, hist[i].cpu_temp);
+      }
+      pos += (size_t)snprintf(body + pos, cap - pos,
+                              "%s{\"seq\":%" PRIu64 ",\"at\":%" PRId64
+                              ",\"cpu_temp\":%s}",
+                              (i == 0U) ? "" : ",", hist[i].seq,
+                              hist[i].at_ms, temp);
+    }
+    pos += (size_t)snprintf(body + pos, cap - pos, "]");
+  }
+  free(hist);
+  ftp_list_cache_stats_t lcs;
+  ftp_list_cache_get_stats(&lcs);
+  pos += (size_t)snprintf(body + pos, cap - pos,
+                          ",\"list_cache\":{\"hits\":%" PRIu64
+                          ",\"misses\":%" PRIu64 ",\"invalidations\":%" PRIu64
+                          ",\"entries\":%" PRIu32 ",\"bytes\":%zu}",
+                          lcs.hits, lcs.misses, lcs.invalidations, lcs.entries,
+                          lcs.bytes);
+  ftp_stat_cache_stats_t scs;
+  ftp_stat_cache_get_stats(&scs);
+  pos += (size_t)snprintf(body + pos, cap - pos,
+                          ",\"stat_cache\":{\"hits\":%" PRIu64
+                          ",\"misses\":%" PRIu64 ",\"invalidations\":%" PRIu64
+                          ",\"entries\":%" PRIu32 "}",
+                          scs.hits, scs.misses, scs.invalidations,
+                          scs.entries);
+  ftp_buffer_class_stats_t bcs[FTP_BUFFER_CLASSES];
+  ftp_buffer_get_stats(bcs);
+  pos += (size_t)snprintf(body + pos, cap - pos, ",\"buffers\":[");
+  for (int i = 0; i < (int)FTP_BUFFER_CLASSES; i++) {
+    pos += (size_t)snprintf(
+        body + pos, cap - pos,
+        "%s{\"size\":%zu,\"count\":%" PRIu32 ",\"in_use\":%" PRIu32
+        ",\"high_water\":%" PRIu32 ",\"huge\":%s,\"acquires\":%" PRIu64
+        ",\"waits\":%" PRIu64 "}",
+        (i > 0) ? "," : "", bcs[i].size, bcs[i].count, bcs[i].in_use,
+        bcs[i].high_water, (bcs[i].huge != 0U) ? "true" : "false",
+        bcs[i].acquires, bcs[i].waits);
+  }
+  pal_io_stats_t ios;
+  pal_io_get_stats(&ios);
+  pos += (size_t)snprintf(
+      body + pos, cap - pos,
+      "],\"io\":{\"cached\":%" PRIu64 ",\"streamed\":%" PRIu64
+      ",\"direct\":%" PRIu64 ",\"readahead_bytes\":%" PRIu64
+      ",\"dropped_bytes\":%" PRIu64 ",\"direct_bytes\":%" PRIu64
+      ",\"probed_bytes\":%" PRIu64 ",\"resident_bytes\":%" PRIu64 "}}",
+      ios.cached, ios.streamed, ios.direct, ios.readahead_bytes,
+      ios.dropped_bytes, ios.direct_bytes, ios.probed_bytes,
+      ios.resident_bytes);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    free(body);
+    return NULL;
+  }
   http_response_add_header(resp, "Content-Type", "application/json");
   http_response_add_header(resp, "Cache-Control", "no-store");
-  http_response_set_body(resp, body, pos);
+  if (http_response_set_body_owned(resp, body, pos) != 0) {
+    free(body);
+  }
   return resp;
 }
 
@@ -2876,128 +3550,373 @@ static http_response_t *api_disk_info(const http_request_t *request) {
 }
 
 /*===========================================================================*
- * GET /api/disk/tree?path=X  — Directory tree (1 level deep, with sizes)
+ * GET /api/disk/tree?path=X[&depth=N][&top=N]  — Treemap of a directory
  *
- *  RESPONSE: { "name": "dirname", "type": "directory",
- *               "size": N, "children": [ { "name":..., "type":..., "size":...
- *}, ...] }
+ *  RESPONSE: { "name": "dirname", "type": "directory", "size": N,
+ *              "partial": bool, "stale": bool, "age": N,
+ *              "truncated": bool,
+ *              "children": [ { "name", "type", "size",
+ *                              "children"?: [...] },
+ *                            { "name": "", "type": "other", "size": N,
+ *                              "count": N }, ... ] }
+ *
+ *  Directory sizes come from the background size index (ftp_dirsize.h):
+ *  the request queues the root for its parallel walkers, waits up to
+ *  HTTP_TREE_WAIT_MS, and then only looks children up.  Each directory
+ *  lists its "top" largest children (default HTTP_TREE_TOP_DEFAULT);
+ *  the rest are folded into one "other" node.  Directories are expanded
+ *  down to "depth" levels (default 1, at most HTTP_TREE_DEPTH_MAX).
+ *  "partial"/"stale" are the index's flags for the root: the UI can ask
+ *  again to refine.  "truncated" means HTTP_TREE_MAX_NODES was reached.
+ *
+ *  The pruned tree is built in the worker as a flat node array; the JSON
+ *  is generated from it one chunk at a time while sending.
  *===========================================================================*/
 
-#define DISK_TREE_MAX_CHILDREN 512
+#define TREE_DIR 0U
+#define TREE_FILE 1U
+#define TREE_OTHER 2U
 
-static http_response_t *api_disk_tree(const http_request_t *request) {
-  const char *query = strchr(request->uri, '?');
-  char path[1024] = "/";
-  if (query != NULL) {
-    (void)parse_path_param(query, path, sizeof(path));
-  }
+/* Offset of the empty name, stored first in every name pool */
+#define TREE_NO_NAME 0U
 
-  char safe[FTP_PATH_MAX];
-  if (!validate_path(path, safe, sizeof(safe))) {
-    return error_json(HTTP_STATUS_403_FORBIDDEN, "Forbidden path");
-  }
+typedef struct {
+  uint64_t size;
+  uint32_t name;   /* offset in tree_t.names, TREE_NO_NAME = "" */
+  uint32_t first;  /* children are contiguous from here */
+  uint32_t kids;   /* 0 = file, other, or not expanded */
+  uint32_t folded; /* TREE_OTHER: entries it stands for */
+  uint8_t type;
+} tree_node_t;
 
-  DIR *dir = opendir(safe);
-  if (dir == NULL) {
-    return error_json(HTTP_STATUS_404_NOT_FOUND, "Directory not found");
-  }
+typedef struct {
+  tree_node_t *nodes;
+  uint32_t count;
+  uint32_t cap;
+  char *names;
+  size_t names_len;
+  size_t names_cap;
+  unsigned depth;
+  unsigned top;
+  int truncated;
+  ftp_dirsize_info_t root;
+
+  /* Generator state: open directories and the next child of each */
+  http_json_t json;
+  uint32_t stack[HTTP_TREE_DEPTH_MAX + 1U];
+  uint32_t next[HTTP_TREE_DEPTH_MAX + 1U];
+  unsigned sp;
+  int started;
+} tree_t;
 
-  /* Allocate a generous output buffer — tree JSON can be large */
-  size_t cap = 512 * 1024; /* 512 KB */
-  char *body = (char *)malloc(cap);
-  if (body == NULL) {
-    closedir(dir);
-    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+typedef struct {
+  uint64_t size;
+  uint32_t entry;
+  uint8_t type;
+} tree_pick_t;
+
+static void tree_free(void *ctx) {
+  tree_t *t = (tree_t *)ctx;
+  if (t != NULL) {
+    free(t->nodes);
+    free(t->names);
+    free(t);
   }
+}
 
-  size_t pos = 0;
-
-  /* Header: root node name */
-  const char *dirname = strrchr(safe, '/');
-  dirname = (dirname && dirname[1] != '\0') ? dirname + 1 : safe;
-
-  pos += (size_t)snprintf(body + pos, cap - pos, "{\"name\":\"");
-  (void)json_escape_append(body, cap, &pos, dirname);
-  pos += (size_t)snprintf(body + pos, cap - pos,
-                          "\",\"type\":\"directory\",\"children\":[");
+static int tree_pick_cmp(const void *a, const void *b) {
+  const tree_pick_t *x = (const tree_pick_t *)a;
+  const tree_pick_t *y = (const tree_pick_t *)b;
+  if (x->size != y->size) {
+    return (x->size < y->size) ? 1 : -1;
+  }
+  return (x->entry < y->entry) ? -1 : (x->entry > y->entry) ? 1 : 0;
+}
 
-  uint64_t dir_total = 0;
-  int first = 1;
-  int count = 0;
+/* Append @p name to the name pool; returns its offset or UINT32_MAX */
+static uint32_t tree_name(tree_t *t, const char *name) {
+  size_t len = strlen(name) + 1U;
+  if (t->names_len + len > t->names_cap) {
+    size_t cap = (t->names_cap == 0U) ? 4096U : t->names_cap * 2U;
+    while (cap < t->names_len + len) {
+      cap *= 2U;
+    }
+    char *grown = (char *)realloc(t->names, cap);
+    if (grown == NULL) {
+      return UINT32_MAX;
+    }
+    t->names = grown;
+    t->names_cap = cap;
+  }
+  if (t->names_len + len > (size_t)UINT32_MAX) {
+    return UINT32_MAX;
+  }
+  uint32_t off = (uint32_t)t->names_len;
+  memcpy(t->names + off, name, len);
+  t->names_len += len;
+  return off;
+}
 
-  for (;;) {
-    errno = 0;
-    struct dirent *ent = readdir(dir);
-    if (ent == NULL) {
-      break;
+/* Reserve @p n consecutive nodes; returns the first or UINT32_MAX */
+static uint32_t tree_alloc(tree_t *t, uint32_t n) {
+  if (t->count + n > HTTP_TREE_MAX_NODES) {
+    return UINT32_MAX;
+  }
+  if (t->count + n > t->cap) {
+    uint32_t cap = (t->cap == 0U) ? 256U : t->cap * 2U;
+    while (cap < t->count + n) {
+      cap *= 2U;
+    }
+    if (cap > HTTP_TREE_MAX_NODES) {
+      cap = HTTP_TREE_MAX_NODES;
     }
-    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) {
+    tree_node_t *grown =
+        (tree_node_t *)realloc(t->nodes, (size_t)cap * sizeof(*grown));
+    if (grown == NULL) {
+      return UINT32_MAX;
+    }
+    t->nodes = grown;
+    t->cap = cap;
+  }
+  uint32_t first = t->count;
+  memset(&t->nodes[first], 0, (size_t)n * sizeof(tree_node_t));
+  t->count += n;
+  return first;
+}
+
+/*
+ * Fill in the children of node @p idx (directory @p path): files with
+ * their listed size, directories with the index's total, largest first,
+ * then recurse while @p level is below the requested depth.
+ */
+static void tree_expand(tree_t *t, uint32_t idx, const char *path,
+                        unsigned level) {
+  ftp_list_snapshot_t snap;
+  if (ftp_list_snapshot(path, &snap) != FTP_OK) {
+    return;
+  }
+  int is_root = (strcmp(path, "/") == 0) ? 1 : 0;
+  tree_pick_t *picks =
+      (snap.count > 0U) ? (tree_pick_t *)malloc(snap.count * sizeof(*picks))
+                        : NULL;
+  size_t n = 0U;
+  for (size_t i = 0U; (picks != NULL) && (i < snap.count); i++) {
+    const char *name = ftp_list_snapshot_name(&snap, i);
+    if ((is_root != 0) &&
+        ((strcmp(name, "dev") == 0) || (strcmp(name, "proc") == 0) ||
+         (strcmp(name, "sys") == 0) || (strcmp(name, "kern") == 0))) {
       continue;
     }
-    if (count >= DISK_TREE_MAX_CHILDREN) {
-      break;
+    const vfs_stat_t *st = ftp_list_snapshot_stat(&snap, i);
+    picks[n].entry = (uint32_t)i;
+    picks[n].type = (uint8_t)(S_ISDIR(st->mode) ? TREE_DIR : TREE_FILE);
+    picks[n].size = st->size;
+    if (picks[n].type == TREE_DIR) {
+      char child[FTP_PATH_MAX];
+      ftp_dirsize_info_t info;
+      (void)snprintf(child, sizeof(child), "%s/%s", is_root ? "" : path, name);
+      picks[n].size =
+          (ftp_dirsize_peek(child, &info) == 0) ? info.bytes : 0U;
+    }
+    n++;
+  }
+  if (n > 1U) {
+    qsort(picks, n, sizeof(*picks), tree_pick_cmp);
+  }
+
+  /* The largest "top" entries, plus one "other" for the rest */
+  size_t keep = (n < (size_t)t->top) ? n : (size_t)t->top;
+  size_t room = (size_t)HTTP_TREE_MAX_NODES - t->count;
+  if (keep + ((keep < n) ? 1U : 0U) > room) {
+    keep = (room > 0U) ? room - 1U : 0U;
+    t->truncated = 1;
+  }
+  size_t want = keep + ((keep < n) ? 1U : 0U);
+  if (want > room) {
+    want = 0U;
+  }
+  uint32_t first = (want > 0U) ? tree_alloc(t, (uint32_t)want) : t->count;
+  if (first == UINT32_MAX) {
+    t->truncated = 1;
+    first = t->count;
+    want = 0U;
+  }
+  for (uint32_t k = 0U; k < (uint32_t)want; k++) {
+    tree_node_t *c = &t->nodes[first + k];
+    if (k < keep) {
+      c->type = picks[k].type;
+      c->size = picks[k].size;
+      c->name = tree_name(t, ftp_list_snapshot_name(&snap, picks[k].entry));
+      if (c->name == UINT32_MAX) {
+        c->name = TREE_NO_NAME;
+        t->truncated = 1;
+      }
+    } else {
+      c->type = TREE_OTHER;
+      c->name = TREE_NO_NAME;
+      for (size_t r = keep; r < n; r++) {
+        c->size += picks[r].size;
+      }
+      c->folded = (uint32_t)(n - keep);
     }
+  }
+  t->nodes[idx].first = first;
+  t->nodes[idx].kids = (uint32_t)want;
+  ftp_list_snapshot_release(&snap);
+  free(picks);
 
-    /* Build full child path */
+  if (level + 1U >= t->depth) {
+    return;
+  }
+  for (uint32_t k = 0U; k < (uint32_t)want; k++) {
+    const tree_node_t *c = &t->nodes[first + k];
+    if ((c->type != TREE_DIR) || (c->name == TREE_NO_NAME)) {
+      continue;
+    }
     char child[FTP_PATH_MAX];
-    if (strcmp(safe, "/") == 0) {
-      (void)snprintf(child, sizeof(child), "/%s", ent->d_name);
+    int len = snprintf(child, sizeof(child), "%s/%s", is_root ? "" : path,
+                       t->names + c->name);
+    if ((len > 0) && ((size_t)len < sizeof(child))) {
+      tree_expand(t, first + k, child, level + 1U);
+    }
+  }
+}
+
+/* One node; directories with children are left open for tree_fill() */
+static void tree_emit_node(tree_t *t, uint32_t idx) {
+  static const char *const k_type[] = {"directory", "file", "other"};
+  http_json_t *w = &t->json;
+  const tree_node_t *c = &t->nodes[idx];
+  http_json_object_begin(w);
+  http_json_key(w, "name");
+  http_json_string(w, t->names + c->name);
+  http_json_key(w, "type");
+  http_json_string(w, k_type[c->type]);
+  http_json_key(w, "size");
+  http_json_u64(w, c->size);
+  if (c->type == TREE_OTHER) {
+    http_json_key(w, "count");
+    http_json_u64(w, c->folded);
+  }
+  if (idx == 0U) {
+    http_json_key(w, "partial");
+    http_json_bool(w, t->root.partial);
+    http_json_key(w, "stale");
+    http_json_bool(w, t->root.stale);
+    http_json_key(w, "age");
+    http_json_u64(w, t->root.age_s);
+    http_json_key(w, "truncated");
+    http_json_bool(w, t->truncated);
+  }
+  if ((c->kids > 0U) || (idx == 0U)) {
+    http_json_key(w, "children");
+    http_json_array_begin(w);
+  } else {
+    http_json_object_end(w);
+  }
+}
+
+/* http_stream_fill_t: depth-first over the node array, one node a step */
+static size_t tree_fill(void *ctx, char *buf, size_t cap) {
+  tree_t *t = (tree_t *)ctx;
+  http_json_t *w = &t->json;
+  http_json_attach(w, buf, cap);
+  while ((t->started == 0) || (t->sp > 0U)) {
+    http_json_t mark = *w;
+    unsigned top = (t->sp > 0U) ? t->sp - 1U : 0U;
+    const tree_node_t *dir = &t->nodes[t->stack[top]];
+    int close = ((t->started != 0) && (t->next[top] == dir->kids)) ? 1 : 0;
+    uint32_t idx = (t->started != 0) ? dir->first + t->next[top] : 0U;
+    if (close != 0) {
+      http_json_array_end(w);
+      http_json_object_end(w);
+    } else {
+      tree_emit_node(t, idx);
+    }
+    if (w->overflow != 0) {
+      *w = mark; /* next chunk */
+      break;
+    }
+    if (t->started == 0) {
+      t->started = 1;
+      t->stack[0] = 0U;
+      t->next[0] = 0U;
+      t->sp = 1U;
+    } else if (close != 0) {
+      t->sp--;
     } else {
-      (void)snprintf(child, sizeof(child), "%s/%s", safe, ent->d_name);
+      t->next[top]++;
+      if (t->nodes[idx].kids > 0U) {
+        t->stack[t->sp] = idx;
+        t->next[t->sp] = 0U;
+        t->sp++;
+      }
     }
+  }
+  return w->pos;
+}
 
-    struct stat st;
-    if (stat(child, &st) != 0) {
-      continue;
+static http_response_t *api_disk_tree(const http_request_t *request) {
+  const char *query = strchr(request->uri, '?');
+  char path[1024] = "/";
+  char arg[32];
+  unsigned depth = 1U;
+  unsigned top = HTTP_TREE_TOP_DEFAULT;
+  if (query != NULL) {
+    (void)parse_path_param(query, path, sizeof(path));
+    if (parse_query_param(query, "depth", arg, sizeof(arg)) == 0) {
+      unsigned long v = strtoul(arg, NULL, 10);
+      depth = (v == 0UL) ? 1U
+              : (v > HTTP_TREE_DEPTH_MAX) ? HTTP_TREE_DEPTH_MAX
+                                          : (unsigned)v;
     }
-
-    uint64_t sz = (uint64_t)st.st_size;
-    const char *type = S_ISDIR(st.st_mode) ? "directory" : "file";
-
-    /* For directories, use statvfs block count as size approximation */
-    if (S_ISDIR(st.st_mode)) {
-      /* Use du-style: st_blocks * 512 */
-      sz = (uint64_t)st.st_blocks * 512U;
+    if (parse_query_param(query, "top", arg, sizeof(arg)) == 0) {
+      unsigned long v = strtoul(arg, NULL, 10);
+      top = (v == 0UL) ? 1U
+            : (v > HTTP_TREE_TOP_MAX) ? HTTP_TREE_TOP_MAX
+                                      : (unsigned)v;
     }
+  }
 
-    dir_total += sz;
-
-    if (!first) {
-      if (pos + 1 < cap) {
-        body[pos++] = ',';
-      }
-    }
-    first = 0;
+  char safe[FTP_PATH_MAX];
+  if (!validate_path(path, safe, sizeof(safe))) {
+    return error_json(HTTP_STATUS_403_FORBIDDEN, "Forbidden path");
+  }
 
-    /* Append child entry */
-    size_t name_start = pos;
-    pos += (size_t)snprintf(body + pos, cap - pos, "{\"name\":\"");
-    (void)json_escape_append(body, cap, &pos, ent->d_name);
-    pos +=
-        (size_t)snprintf(body + pos, cap - pos,
-                         "\",\"type\":\"%s\",\"size\":%" PRIu64 "}", type, sz);
-
-    /* Safety: if we are getting close to buffer limit, stop */
-    if (pos + 256 >= cap) {
-      /* Truncate last entry and break */
-      pos = name_start;
-      if (pos > 0 && body[pos - 1] == ',') {
-        pos--;
-      }
-      break;
-    }
-    count++;
+  tree_t *t = (tree_t *)calloc(1U, sizeof(*t));
+  if (t == NULL) {
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
-  closedir(dir);
+  if (ftp_dirsize_query(safe, HTTP_TREE_WAIT_MS, &t->root) != 0) {
+    tree_free(t);
+    return error_json(HTTP_STATUS_404_NOT_FOUND, "Directory not found");
+  }
+  t->depth = depth;
+  t->top = top;
+  http_json_init(&t->json);
 
-  pos += (size_t)snprintf(body + pos, cap - pos, "],\"size\":%" PRIu64 "}",
-                          dir_total);
+  const char *dirname = strrchr(safe, '/');
+  dirname = ((dirname != NULL) && (dirname[1] != '\0')) ? dirname + 1 : safe;
+  if ((tree_name(t, "") != TREE_NO_NAME) ||
+      (tree_alloc(t, 1U) == UINT32_MAX) ||
+      ((t->nodes[0].name = tree_name(t, dirname)) == UINT32_MAX)) {
+    tree_free(t);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+  t->nodes[0].size = t->root.bytes;
+  tree_expand(t, 0U, safe, 0U);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    tree_free(t);
+    return NULL;
+  }
   http_response_add_header(resp, "Content-Type", "application/json");
   http_response_add_header(resp, "Cache-Control", "no-store");
-  if (http_response_set_body_owned(resp, body, pos) != 0) {
-    free(body);
+  if (http_response_set_body_stream(resp, tree_fill, tree_free, t) != 0) {
+    tree_free(t);
+    http_response_destroy(resp);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
   return resp;
 }
@@ -3008,199 +3927,98 @@ static http_response_t *api_disk_tree(const http_request_t *request) {
  *  RESPONSE: [ { "pid": N, "name": "...", "user": "...",
  *                "cpu": F, "mem_mb": N, "status": "...",
  *                "killable": bool }, ... ]
+ *
+ *  Rows are the sampler's latest list (http_sysmon.h), ordered by pid;
+ *  "cpu" is percent of one core over the last sampling period.
  *===========================================================================*/
 
 #include <signal.h>
 
-#if defined(PLATFORM_MACOS) || defined(__APPLE__)
-#include <sys/proc.h>
-#include <sys/sysctl.h>
-#endif
-
-static http_response_t *api_processes(const http_request_t *request) {
-  (void)request;
-
-  size_t cap = 256 * 1024; /* 256 KB */
-  char *body = (char *)malloc(cap);
-  if (body == NULL) {
-    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+/* Body generator state for api_processes() */
+typedef struct {
+  http_json_t json;
+  int stage; /* 0 = "[" pending, 1 = rows, 2 = done */
+  const http_sysmon_procs_t *procs;
+  size_t next;
+} proc_gen_t;
+
+static void proc_free(void *ctx) {
+  proc_gen_t *g = (proc_gen_t *)ctx;
+  if (g != NULL) {
+    http_sysmon_procs_release(g->procs);
+    free(g);
   }
+}
 
-  size_t pos = 0;
-  pos += (size_t)snprintf(body + pos, cap - pos, "[");
-  int first = 1;
-
-#if defined(PLATFORM_MACOS) || defined(__APPLE__)
-  /* --- macOS: use KERN_PROC sysctl (no entitlements required) --- */
-  int mib[4] = {CTL_KERN, KERN_PROC, KERN_PROC_ALL, 0};
-  size_t buf_size = 0;
-  /* First call: get required size */
-  if (sysctl(mib, 4, NULL, &buf_size, NULL, 0) == 0 && buf_size > 0) {
-    /* Over-allocate slightly to handle races */
-    buf_size += buf_size / 8;
-    struct kinfo_proc *procs = (struct kinfo_proc *)malloc(buf_size);
-    if (procs) {
-      if (sysctl(mib, 4, procs, &buf_size, NULL, 0) == 0) {
-        int n = (int)(buf_size / sizeof(struct kinfo_proc));
-        for (int i = 0; i < n; i++) {
-          struct kinfo_proc *kp = &procs[i];
-          pid_t pid = kp->kp_proc.p_pid;
-          if (pid <= 0)
-            continue;
-
-          char name[MAXCOMLEN + 1];
-          strncpy(name, kp->kp_proc.p_comm, sizeof(name) - 1);
-          name[sizeof(name) - 1] = '\0';
-
-          unsigned int uid = (unsigned int)kp->kp_eproc.e_ucred.cr_uid;
-
-          /* p_stat: SSLEEP=1, SWAIT=2, SRUN=3, SIDL=4, SZOMB=5, SSTOP=6 */
-          const char *status = "running";
-          if (kp->kp_proc.p_stat == 1 || kp->kp_proc.p_stat == 2)
-            status = "sleep";
-          else if (kp->kp_proc.p_stat == 5)
-            status = "zombie";
-
-          /* RSS from e_vm — not always available, use 0 as fallback */
-          uint64_t mem_mb = 0;
-
-          int killable = (uid != 0) ? 1 : 0;
-
-          if (!first && pos + 2 < cap) {
-            body[pos++] = ',';
-          }
-          first = 0;
-
-          pos += (size_t)snprintf(body + pos, cap - pos,
-                                  "{\"pid\":%d,\"name\":\"", (int)pid);
-          (void)json_escape_append(body, cap, &pos, name);
-          pos += (size_t)snprintf(
-              body + pos, cap - pos,
-              "\",\"user\":\"%u\",\"cpu\":0.0,\"mem_mb\":%" PRIu64
-              ",\"status\":\"%s\",\"killable\":%s}",
-              uid, mem_mb, status, killable ? "true" : "false");
-
-          if (pos + 512 >= cap)
-            break;
-        }
-      }
-      free(procs);
-    }
-  }
-
-#elif defined(HAS_SYSINFO)
-  /* --- Linux: parse /proc --- */
-  DIR *proc_dir = opendir("/proc");
-  if (proc_dir) {
-    struct dirent *ent;
-    while ((ent = readdir(proc_dir)) != NULL) {
-      /* Only numeric entries are PIDs */
-      int pid = 0;
-      int is_pid = 1;
-      for (const char *c = ent->d_name; *c; c++) {
-        if (*c < '0' || *c > '9') {
-          is_pid = 0;
-          break;
-        }
-      }
-      if (!is_pid || ent->d_name[0] == '\0')
-        continue;
-      pid = atoi(ent->d_name);
-      if (pid <= 0)
-        continue;
-
-      /* /proc/<pid>/stat */
-      char stat_path[64];
-      snprintf(stat_path, sizeof(stat_path), "/proc/%d/stat", pid);
-      FILE *f = fopen(stat_path, "r");
-      if (!f)
-        continue;
-
-      char comm[256] = "";
-      char state = '?';
-      long rss = 0;
-      unsigned int uid = 0;
-
-      /* Read comm from /proc/<pid>/status for cleaner name */
-      char status_path[64];
-      snprintf(status_path, sizeof(status_path), "/proc/%d/status", pid);
-      FILE *sf = fopen(status_path, "r");
-      if (sf) {
-        char line[256];
-        while (fgets(line, sizeof(line), sf)) {
-          if (strncmp(line, "Name:", 5) == 0) {
-            sscanf(line + 5, " %255s", comm);
-          } else if (strncmp(line, "Uid:", 4) == 0) {
-            sscanf(line + 4, " %u", &uid);
-          }
-        }
-        fclose(sf);
-      }
-
-      /* Read utime/stime/rss from stat */
-      {
-        char tmp[2048];
-        if (fgets(tmp, sizeof(tmp), f)) {
-          /* format: pid (comm) state ppid ... utime stime ... rss */
-          char *p = strrchr(tmp, ')');
-          if (p) {
-            sscanf(p + 2,
-                   " %c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
-                   "%*lu %*lu %*d %*d %*d %*d %*d %*d %*u %*u %ld",
-                   &state, &rss);
-          }
-        }
+/* http_stream_fill_t: as many rows as fit, then the closing bracket */
+static size_t proc_fill(void *ctx, char *buf, size_t cap) {
+  proc_gen_t *g = (proc_gen_t *)ctx;
+  http_json_t *w = &g->json;
+  http_json_attach(w, buf, cap);
+  if (g->stage == 0) {
+    http_json_array_begin(w);
+    g->stage = 1;
+  }
+  while (g->stage == 1) {
+    if ((g->procs == NULL) || (g->next >= g->procs->count)) {
+      http_json_array_end(w);
+      if (w->overflow == 0) {
+        g->stage = 2;
       }
-      fclose(f);
-
-      if (comm[0] == '\0')
-        snprintf(comm, sizeof(comm), "pid%d", pid);
-
-      uint64_t mem_mb =
-          (uint64_t)((rss > 0 ? rss : 0) * 4096UL / (1024UL * 1024UL));
-      const char *status_str = "running";
-      if (state == 'S' || state == 'D')
-        status_str = "sleep";
-      else if (state == 'Z')
-        status_str = "zombie";
-      double cpu_pct = 0.0; /* snapshot only */
-      int killable = (uid != 0) ? 1 : 0;
-
-      if (!first && pos + 2 < cap) {
-        body[pos++] = ',';
-      }
-      first = 0;
-
-      pos += (size_t)snprintf(body + pos, cap - pos, "{\"pid\":%d,\"name\":\"",
-                              pid);
-      (void)json_escape_append(body, cap, &pos, comm);
-      pos += (size_t)snprintf(
-          body + pos, cap - pos,
-          "\",\"user\":\"%u\",\"cpu\":%.1f,\"mem_mb\":%" PRIu64
-          ",\"status\":\"%s\",\"killable\":%s}",
-          uid, cpu_pct, mem_mb, status_str, killable ? "true" : "false");
-
-      if (pos + 512 >= cap)
-        break;
+      break;
+    }
+    const http_sysmon_proc_t *r = &g->procs->rows[g->next];
+    char cpu[16];
+    int cpu_len = snprintf(cpu, sizeof(cpu), "%.1f", r->cpu);
+    http_json_t mark = *w;
+    http_json_object_begin(w);
+    http_json_key(w, "pid");
+    http_json_i64(w, r->pid);
+    http_json_key(w, "name");
+    http_json_string(w, r->name);
+    http_json_key(w, "user");
+    char uid[16];
+    (void)snprintf(uid, sizeof(uid), "%u", r->uid);
+    http_json_string(w, uid);
+    http_json_key(w, "cpu");
+    http_json_raw(w, cpu, (size_t)cpu_len);
+    http_json_key(w, "mem_mb");
+    http_json_u64(w, r->mem_mb);
+    http_json_key(w, "status");
+    http_json_string(w, r->status);
+    http_json_key(w, "killable");
+    http_json_bool(w, r->uid != 0U);
+    http_json_object_end(w);
+    if (w->overflow != 0) {
+      *w = mark; /* retried at the start of the next chunk */
+      break;
     }
-    closedir(proc_dir);
+    g->next++;
   }
+  return w->pos;
+}
 
-#else
-  /* Unsupported platform — return empty array */
-  (void)first;
-#endif
+static http_response_t *api_processes(const http_request_t *request) {
+  (void)request;
 
-  if (pos + 2 < cap) {
-    body[pos++] = ']';
-    body[pos] = '\0';
+  proc_gen_t *g = (proc_gen_t *)calloc(1U, sizeof(*g));
+  if (g == NULL) {
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
+  http_json_init(&g->json);
+  g->procs = http_sysmon_procs_acquire(); /* NULL = empty array */
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    proc_free(g);
+    return NULL;
+  }
   http_response_add_header(resp, "Content-Type", "application/json");
   http_response_add_header(resp, "Cache-Control", "no-store");
-  if (http_response_set_body_owned(resp, body, pos) != 0) {
-    free(body);
+  if (http_response_set_body_stream(resp, proc_fill, proc_free, g) != 0) {
+    proc_free(g);
+    http_response_destroy(resp);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
   return resp;
 }
@@ -3272,10 +4090,12 @@ static http_response_t *api_process_kill(const http_request_t *request) {
  *
  *   GET /api/game/meta?path=<file>
  *     Extracts param.json + icon0.png from sce_sys/ inside an exFAT image.
- *     Returns JSON: { title_id, title_name, version, category, icon_base64 }
+ *     Returns JSON: { title_id, title_name, version, category, content_id,
+ *     has_icon }; the icon itself is fetched separately.
  *
- *   GET /api/game/icon?path=<file>
- *     Returns the raw PNG icon directly (Content-Type: image/png).
+ *   GET /api/game/icon?path=<file>[&size=N]
+ *     Returns the PNG icon (Content-Type: image/png), downsampled when
+ *     size is given; see icon_response().
  *===========================================================================*/
 
 /* Simple SFO string extraction */
@@ -3404,7 +4224,8 @@ static int read_file_to_buffer(const char *path, uint8_t **out_data,
     return -1;
   }
 
-  uint8_t *buf = (uint8_t *)malloc((size_t)flen);
+  /* Thread scratch arena: the caller resets it when done */
+  uint8_t *buf = (uint8_t *)pal_scratch_alloc((size_t)flen);
   if (buf == NULL) {
     fclose(fp);
     return -1;
@@ -3413,7 +4234,6 @@ static int read_file_to_buffer(const char *path, uint8_t **out_data,
   size_t got = fread(buf, 1, (size_t)flen, fp);
   fclose(fp);
   if (got != (size_t)flen) {
-    free(buf);
     return -1;
   }
 
@@ -3438,9 +4258,11 @@ static int read_installed_game_sfo(const char *app_dir, char *title_id,
     }
   }
 
+  pal_scratch_mark_t mark = pal_scratch_mark();
   uint8_t *sfo = NULL;
   size_t sfo_size = 0U;
   if (read_file_to_buffer(sfo_path, &sfo, &sfo_size, 65536U) != 0) {
+    pal_scratch_reset(mark);
     return -1;
   }
 
@@ -3451,7 +4273,7 @@ static int read_installed_game_sfo(const char *app_dir, char *title_id,
                          title_name_size);
   }
 
-  free(sfo);
+  pal_scratch_reset(mark);
   return 0;
 }
 
@@ -3474,14 +4296,16 @@ static int read_installed_game_sfo_field(const char *app_dir,
     }
   }
 
+  pal_scratch_mark_t mark = pal_scratch_mark();
   uint8_t *sfo = NULL;
   size_t sfo_size = 0U;
   if (read_file_to_buffer(sfo_path, &sfo, &sfo_size, 65536U) != 0) {
+    pal_scratch_reset(mark);
     return -1;
   }
 
   int rc = sfo_get_string(sfo, sfo_size, key, out, out_size);
-  free(sfo);
+  pal_scratch_reset(mark);
   return (rc == 0 && out[0] != '\0') ? 0 : -1;
 }
 #endif
@@ -4435,78 +5259,87 @@ static int psx_repair_appdb_visibility_for_title(const char *title_id,
 }
 #endif
 
-static int append_installed_entries_from_base(const char *base,
-                                              char *body,
-                                              size_t cap,
-                                              size_t *pos,
-                                              int *first,
-                                              size_t *count_added) {
-  if (!base || !body || !pos || !first || !count_added) {
-    return -1;
-  }
+/* Body generator state for api_games_installed() */
+typedef struct {
+  http_json_t json;
+  int stage;   /* 0 = header pending, 1 = rows, 2 = done */
+  http_game_row_t *rows; /* http_games_installed() snapshot */
+  size_t count;
+  size_t next; /* first row not written yet */
+} installed_gen_t;
 
-  DIR *dir = opendir(base);
-  if (dir == NULL) {
-    return 0;
+static void installed_free(void *ctx) {
+  installed_gen_t *g = (installed_gen_t *)ctx;
+  if (g != NULL) {
+    free(g->rows);
+    free(g);
   }
+}
 
-  struct dirent *ent;
-  while ((ent = readdir(dir)) != NULL) {
-    if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
-      continue;
-    }
-
-    char app_dir[FTP_PATH_MAX];
-    int n = snprintf(app_dir, sizeof(app_dir), "%s/%s", base, ent->d_name);
-    if (n < 0 || (size_t)n >= sizeof(app_dir)) {
-      continue;
-    }
-
-    struct stat st;
-    if (stat(app_dir, &st) != 0 || !S_ISDIR(st.st_mode)) {
-      continue;
-    }
-
-    char title_id[64] = {0};
-    char title_name[256] = {0};
-    (void)snprintf(title_id, sizeof(title_id), "%s", ent->d_name);
-    (void)read_installed_game_sfo(app_dir, title_id, sizeof(title_id), title_name,
-                                  sizeof(title_name));
-    if (title_name[0] == '\0') {
-      (void)snprintf(title_name, sizeof(title_name), "%s", title_id);
-    }
-
-    char icon_path[FTP_PATH_MAX] = {0};
-    int has_icon = (resolve_installed_icon_path(title_id, app_dir, icon_path,
-                                                sizeof(icon_path)) == 0);
-
-    if (!*first) {
-      if (buf_append_cstr(body, cap, pos, ",") != 0) {
-        closedir(dir);
-        return -1;
+/* http_stream_fill_t: {"ok":true,"entries":[ rows ]} */
+static size_t installed_fill(void *ctx, char *buf, size_t cap) {
+  installed_gen_t *g = (installed_gen_t *)ctx;
+  http_json_t *w = &g->json;
+  http_json_attach(w, buf, cap);
+  if (g->stage == 0) {
+    http_json_object_begin(w);
+    http_json_key(w, "ok");
+    http_json_bool(w, 1);
+    http_json_key(w, "entries");
+    http_json_array_begin(w);
+    g->stage = 1;
+  }
+  while (g->stage == 1) {
+    if (g->next == g->count) {
+      http_json_array_end(w);
+      http_json_object_end(w);
+      if (w->overflow == 0) {
+        g->stage = 2;
       }
+      break;
     }
-    *first = 0;
-    (*count_added)++;
-
-    if (buf_append_cstr(body, cap, pos, "{\"id\":\"") != 0 ||
-        json_escape_append(body, cap, pos, title_id) != 0 ||
-        buf_append_cstr(body, cap, pos, "\",\"name\":\"") != 0 ||
-        json_escape_append(body, cap, pos, title_name) != 0 ||
-        buf_append_cstr(body, cap, pos, "\",\"path\":\"") != 0 ||
-        json_escape_append(body, cap, pos, app_dir) != 0 ||
-        buf_append_cstr(body, cap, pos, "\",\"source\":\"") != 0 ||
-        json_escape_append(body, cap, pos, base) != 0 ||
-        buf_append_cstr(body, cap, pos, "\",\"has_icon\":") != 0 ||
-        buf_append_cstr(body, cap, pos, has_icon ? "true" : "false") != 0 ||
-        buf_append_cstr(body, cap, pos, "}") != 0) {
-      closedir(dir);
-      return -1;
+    const http_game_row_t *r = &g->rows[g->next];
+    http_json_t mark = *w;
+    http_json_object_begin(w);
+    http_json_key(w, "id");
+    http_json_string(w, r->meta.id);
+    http_json_key(w, "name");
+    http_json_string(w, r->meta.name);
+    http_json_key(w, "path");
+    http_json_string(w, r->path);
+    http_json_key(w, "source");
+    http_json_string(w, r->source);
+    http_json_key(w, "has_icon");
+    http_json_bool(w, r->meta.has_icon);
+    http_json_object_end(w);
+    if (w->overflow != 0) {
+      *w = mark; /* retried at the start of the next chunk */
+      break;
     }
+    g->next++;
   }
+  return w->pos;
+}
 
-  closedir(dir);
-  return 0;
+/*
+ * Bytes of a plaintext PKG entry: a view into the PKG's mapped window when
+ * possible, else a copy in scratch memory (the caller holds the mark).
+ *
+ * @return Entry size (> 0 once *data is set), or a negative pkg_error_t
+ */
+static ssize_t game_pkg_entry(pkg_context_t *pkg, const pkg_entry_t *entry,
+                              const uint8_t **data) {
+  ssize_t n = pkg_entry_view(pkg, entry, data);
+  if ((n != (ssize_t)PKG_ERR_UNMAPPED) || (entry->size == 0U)) {
+    return n;
+  }
+  uint8_t *buf = (uint8_t *)pal_scratch_alloc((size_t)entry->size);
+  if (buf == NULL) {
+    return (ssize_t)PKG_ERR_NOMEM;
+  }
+  n = pkg_extract_to_buffer(pkg, entry, buf, (size_t)entry->size);
+  *data = (n > 0) ? buf : NULL;
+  return n;
 }
 
 static int extract_title_id_from_game_image(const char *safe_path,
@@ -4524,21 +5357,19 @@ static int extract_title_id_from_game_image(const char *safe_path,
     const pkg_entry_t *sfo_entry =
         pkg_find_entry_by_id(&pkg_ctx, PKG_ENTRY_ID_PARAM_SFO);
     if (sfo_entry && sfo_entry->size > 0U && sfo_entry->size <= 65536U) {
-      uint8_t *sfo_data = (uint8_t *)malloc((size_t)sfo_entry->size);
-      if (sfo_data != NULL) {
-        if (pkg_extract_to_buffer(&pkg_ctx, sfo_entry, sfo_data,
-                                  (size_t)sfo_entry->size) > 0) {
-          (void)sfo_get_string(sfo_data, (size_t)sfo_entry->size, "TITLE_ID",
-                               title_id, title_id_size);
-          if (title_id[0] == '\0') {
-            char cid[64] = "";
-            (void)sfo_get_string(sfo_data, (size_t)sfo_entry->size,
-                                 "CONTENT_ID", cid, sizeof(cid));
-            (void)title_id_from_content_id(cid, title_id, title_id_size);
-          }
+      pal_scratch_mark_t mark = pal_scratch_mark();
+      const uint8_t *sfo_data = NULL;
+      if (game_pkg_entry(&pkg_ctx, sfo_entry, &sfo_data) > 0) {
+        (void)sfo_get_string(sfo_data, (size_t)sfo_entry->size, "TITLE_ID",
+                             title_id, title_id_size);
+        if (title_id[0] == '\0') {
+          char cid[64] = "";
+          (void)sfo_get_string(sfo_data, (size_t)sfo_entry->size,
+                               "CONTENT_ID", cid, sizeof(cid));
+          (void)title_id_from_content_id(cid, title_id, title_id_size);
         }
-        free(sfo_data);
       }
+      pal_scratch_reset(mark);
     }
 
     if (title_id[0] == '\0') {
@@ -4583,7 +5414,8 @@ static int extract_title_id_from_game_image(const char *safe_path,
           sce_entries[j].data_length > 0U &&
           sce_entries[j].data_length <= 65536U) {
         size_t slen = (size_t)sce_entries[j].data_length;
-        uint8_t *sbuf = (uint8_t *)malloc(slen);
+        pal_scratch_mark_t mark = pal_scratch_mark();
+        uint8_t *sbuf = (uint8_t *)pal_scratch_alloc(slen);
         if (sbuf != NULL) {
           ssize_t got = exfat_extract_to_buffer(&ctx, &sce_entries[j], sbuf,
                                                 slen);
@@ -4597,8 +5429,8 @@ static int extract_title_id_from_game_image(const char *safe_path,
               (void)title_id_from_content_id(cid, title_id, title_id_size);
             }
           }
-          free(sbuf);
         }
+        pal_scratch_reset(mark);
       }
 
       if (title_id[0] == '\0' &&
@@ -4606,7 +5438,8 @@ static int extract_title_id_from_game_image(const char *safe_path,
           sce_entries[j].data_length > 0U &&
           sce_entries[j].data_length <= (256U * 1024U)) {
         size_t plen = (size_t)sce_entries[j].data_length;
-        uint8_t *pbuf = (uint8_t *)malloc(plen + 1U);
+        pal_scratch_mark_t mark = pal_scratch_mark();
+        uint8_t *pbuf = (uint8_t *)pal_scratch_alloc(plen + 1U);
         if (pbuf != NULL) {
           ssize_t got = exfat_extract_to_buffer(&ctx, &sce_entries[j], pbuf,
                                                 plen);
@@ -4629,8 +5462,8 @@ static int extract_title_id_from_game_image(const char *safe_path,
               (void)title_id_from_content_id(cid, title_id, title_id_size);
             }
           }
-          free(pbuf);
         }
+        pal_scratch_reset(mark);
       }
 
       if (title_id[0] != '\0') {
@@ -4649,21 +5482,8 @@ static int extract_title_id_from_game_image(const char *safe_path,
 #define GAME_META_MAX_PARAM  (256 * 1024)
 #define GAME_META_MAX_ICON   (2 * 1024 * 1024)
 
-static http_response_t *api_game_meta(const http_request_t *request) {
-  const char *query = strchr(request->uri, '?');
-  char path[1024] = "/";
-  if (query) (void)parse_path_param(query, path, sizeof(path));
-
-  char safe[FTP_PATH_MAX];
-  if (!validate_path(path, safe, sizeof(safe))) {
-    return error_json(HTTP_STATUS_403_FORBIDDEN, "Path traversal blocked");
-  }
-
-  char title_id[64]    = "";
-  char title_name[256] = "";
-  char version[64]     = "";
-  char category[64]    = "";
-  char content_id[48]  = "";
+/* Metadata of a PKG or exFAT image file; -1 if it is neither */
+static int load_game_image(const char *safe, http_game_meta_t *m) {
   uint8_t *icon_data   = NULL;
   size_t   icon_size   = 0;
 
@@ -4673,36 +5493,35 @@ static http_response_t *api_game_meta(const http_request_t *request) {
     fprintf(stderr, "[PKG] Successfully opened %s (entries: %u)\n", safe, pkg_ctx.header.entry_count);
     
     /* Always grab content_id from PKG header */
-    snprintf(content_id, sizeof(content_id), "%.36s", pkg_ctx.header.content_id);
+    snprintf(m->content_id, sizeof(m->content_id), "%.36s", pkg_ctx.header.content_id);
 
     const pkg_entry_t *sfo_entry = pkg_find_entry_by_id(&pkg_ctx, PKG_ENTRY_ID_PARAM_SFO);
     if (sfo_entry && sfo_entry->size > 0 && sfo_entry->size <= 65536) {
-      uint8_t *sfo_data = (uint8_t *)malloc((size_t)sfo_entry->size);
-      if (sfo_data) {
-        if (pkg_extract_to_buffer(&pkg_ctx, sfo_entry, sfo_data, (size_t)sfo_entry->size) > 0) {
-          sfo_get_string(sfo_data, (size_t)sfo_entry->size, "TITLE_ID", title_id, sizeof(title_id));
-          sfo_get_string(sfo_data, (size_t)sfo_entry->size, "TITLE", title_name, sizeof(title_name));
-          sfo_get_string(sfo_data, (size_t)sfo_entry->size, "APP_VER", version, sizeof(version));
-          sfo_get_string(sfo_data, (size_t)sfo_entry->size, "CATEGORY", category, sizeof(category));
-          /* Also try CONTENT_ID from SFO (more authoritative than PKG header) */
-          {
-            char sfo_cid[48] = "";
-            sfo_get_string(sfo_data, (size_t)sfo_entry->size, "CONTENT_ID", sfo_cid, sizeof(sfo_cid));
-            if (sfo_cid[0]) {
-              strncpy(content_id, sfo_cid, sizeof(content_id) - 1);
-              content_id[sizeof(content_id) - 1] = '\0';
-            }
+      pal_scratch_mark_t mark = pal_scratch_mark();
+      const uint8_t *sfo_data = NULL;
+      if (game_pkg_entry(&pkg_ctx, sfo_entry, &sfo_data) > 0) {
+        sfo_get_string(sfo_data, (size_t)sfo_entry->size, "TITLE_ID", m->id, sizeof(m->id));
+        sfo_get_string(sfo_data, (size_t)sfo_entry->size, "TITLE", m->name, sizeof(m->name));
+        sfo_get_string(sfo_data, (size_t)sfo_entry->size, "APP_VER", m->version, sizeof(m->version));
+        sfo_get_string(sfo_data, (size_t)sfo_entry->size, "CATEGORY", m->category, sizeof(m->category));
+        /* Also try CONTENT_ID from SFO (more authoritative than PKG header) */
+        {
+          char sfo_cid[48] = "";
+          sfo_get_string(sfo_data, (size_t)sfo_entry->size, "CONTENT_ID", sfo_cid, sizeof(sfo_cid));
+          if (sfo_cid[0]) {
+            strncpy(m->content_id, sfo_cid, sizeof(m->content_id) - 1);
+            m->content_id[sizeof(m->content_id) - 1] = '\0';
           }
         }
-        free(sfo_data);
       }
+      pal_scratch_reset(mark);
     }
 
-    if (!title_id[0]) {
-      snprintf(title_id, sizeof(title_id), "%.36s", pkg_ctx.header.content_id);
+    if (!m->id[0]) {
+      snprintf(m->id, sizeof(m->id), "%.36s", pkg_ctx.header.content_id);
     }
-    if (!title_name[0]) {
-      snprintf(title_name, sizeof(title_name), "%.36s", pkg_ctx.header.content_id);
+    if (!m->name[0]) {
+      snprintf(m->name, sizeof(m->name), "%.36s", pkg_ctx.header.content_id);
     }
 
     const pkg_entry_t *entry = pkg_find_entry_by_id(&pkg_ctx, PKG_ENTRY_ID_ICON0_PNG);
@@ -4716,18 +5535,16 @@ static http_response_t *api_game_meta(const http_request_t *request) {
       } else if (entry->size > GAME_META_MAX_ICON) {
         fprintf(stderr, "[PKG] Icon too large: %u\n", entry->size);
       } else {
-         icon_size = (size_t)entry->size;
-         icon_data = (uint8_t *)malloc(icon_size);
-         if (icon_data) {
-            ssize_t got = pkg_extract_to_buffer(&pkg_ctx, entry, icon_data, icon_size);
-            if (got > 0) {
-              icon_size = (size_t)got;
-              fprintf(stderr, "[PKG] Icon successfully extracted (%zu bytes)\n", icon_size);
-            } else { 
-              free(icon_data); icon_data = NULL; icon_size = 0; 
-              fprintf(stderr, "[PKG] Failed to extract icon (err: %zd)\n", got);
-            }
+         /* Only has_icon is reported: a mapped icon is not even read. */
+         pal_scratch_mark_t mark = pal_scratch_mark();
+         const uint8_t *icon = NULL;
+         ssize_t got = game_pkg_entry(&pkg_ctx, entry, &icon);
+         if (got > 0) {
+           m->has_icon = 1;
+         } else {
+           fprintf(stderr, "[PKG] Failed to extract icon (err: %zd)\n", got);
          }
+         pal_scratch_reset(mark);
       }
     } else {
       fprintf(stderr, "[PKG] Could not find any icon entry in PKG\n");
@@ -4737,7 +5554,7 @@ static http_response_t *api_game_meta(const http_request_t *request) {
     /* 2. Fall back to exFAT image */
     exfat_context_t ctx;
     if (exfat_init(&ctx, safe) != 0) {
-      return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a valid PKG or exFAT image");
+      return -1;
     }
 
     /* Scan root directory for sce_sys */
@@ -4764,25 +5581,26 @@ static http_response_t *api_game_meta(const http_request_t *request) {
             sce_entries[j].data_length > 0 &&
             sce_entries[j].data_length <= 65536) {
           size_t slen = (size_t)sce_entries[j].data_length;
-          uint8_t *sbuf = (uint8_t *)malloc(slen);
+          pal_scratch_mark_t mark = pal_scratch_mark();
+          uint8_t *sbuf = (uint8_t *)pal_scratch_alloc(slen);
           if (sbuf) {
             ssize_t got = exfat_extract_to_buffer(&ctx, &sce_entries[j], sbuf, slen);
             if (got > 0) {
-              sfo_get_string(sbuf, (size_t)got, "TITLE_ID", title_id, sizeof(title_id));
-              sfo_get_string(sbuf, (size_t)got, "TITLE", title_name, sizeof(title_name));
-              sfo_get_string(sbuf, (size_t)got, "APP_VER", version, sizeof(version));
-              sfo_get_string(sbuf, (size_t)got, "CATEGORY", category, sizeof(category));
+              sfo_get_string(sbuf, (size_t)got, "TITLE_ID", m->id, sizeof(m->id));
+              sfo_get_string(sbuf, (size_t)got, "TITLE", m->name, sizeof(m->name));
+              sfo_get_string(sbuf, (size_t)got, "APP_VER", m->version, sizeof(m->version));
+              sfo_get_string(sbuf, (size_t)got, "CATEGORY", m->category, sizeof(m->category));
               {
                 char sfo_cid[48] = "";
                 sfo_get_string(sbuf, (size_t)got, "CONTENT_ID", sfo_cid, sizeof(sfo_cid));
                 if (sfo_cid[0]) {
-                  strncpy(content_id, sfo_cid, sizeof(content_id) - 1U);
-                  content_id[sizeof(content_id) - 1U] = '\0';
+                  strncpy(m->content_id, sfo_cid, sizeof(m->content_id) - 1U);
+                  m->content_id[sizeof(m->content_id) - 1U] = '\0';
                 }
               }
             }
-            free(sbuf);
           }
+          pal_scratch_reset(mark);
         }
 
         /* param.json */
@@ -4790,41 +5608,43 @@ static http_response_t *api_game_meta(const http_request_t *request) {
             sce_entries[j].data_length > 0 &&
             sce_entries[j].data_length <= GAME_META_MAX_PARAM) {
           size_t plen = (size_t)sce_entries[j].data_length;
-          uint8_t *pbuf = (uint8_t *)malloc(plen + 1);
+          pal_scratch_mark_t mark = pal_scratch_mark();
+          uint8_t *pbuf = (uint8_t *)pal_scratch_alloc(plen + 1);
           if (pbuf) {
             ssize_t got = exfat_extract_to_buffer(&ctx, &sce_entries[j], pbuf, plen);
             if (got > 0) {
               pbuf[got] = '\0';
-              json_get_string((char *)pbuf, "titleId", title_id, sizeof(title_id));
-              if (!title_id[0])
-                json_get_string((char *)pbuf, "title_id", title_id, sizeof(title_id));
-              json_get_string((char *)pbuf, "titleName", title_name, sizeof(title_name));
-              json_get_string((char *)pbuf, "contentVersion", version, sizeof(version));
-              if (!version[0])
-                json_get_string((char *)pbuf, "appVer", version, sizeof(version));
-              json_get_string((char *)pbuf, "category", category, sizeof(category));
-              if (!content_id[0]) {
-                json_get_string((char *)pbuf, "contentId", content_id, sizeof(content_id));
-                if (!content_id[0]) {
-                  json_get_string((char *)pbuf, "content_id", content_id, sizeof(content_id));
+              json_get_string((char *)pbuf, "titleId", m->id, sizeof(m->id));
+              if (!m->id[0])
+                json_get_string((char *)pbuf, "title_id", m->id, sizeof(m->id));
+              json_get_string((char *)pbuf, "titleName", m->name, sizeof(m->name));
+              json_get_string((char *)pbuf, "contentVersion", m->version, sizeof(m->version));
+              if (!m->version[0])
+                json_get_string((char *)pbuf, "appVer", m->version, sizeof(m->version));
+              json_get_string((char *)pbuf, "category", m->category, sizeof(m->category));
+              if (!m->content_id[0]) {
+                json_get_string((char *)pbuf, "contentId", m->content_id, sizeof(m->content_id));
+                if (!m->content_id[0]) {
+                  json_get_string((char *)pbuf, "content_id", m->content_id, sizeof(m->content_id));
                 }
               }
             }
-            free(pbuf);
           }
+          pal_scratch_reset(mark);
         }
 
         /* icon0.png */
         if (strcasecmp(sce_entries[j].filename, "icon0.png") == 0 &&
             sce_entries[j].data_length > 0 &&
             sce_entries[j].data_length <= GAME_META_MAX_ICON) {
+          pal_scratch_put(icon_data);
           icon_size = (size_t)sce_entries[j].data_length;
-          icon_data = (uint8_t *)malloc(icon_size);
+          icon_data = (uint8_t *)pal_scratch_get(icon_size);
           if (icon_data) {
             ssize_t got = exfat_extract_to_buffer(&ctx, &sce_entries[j],
                                                    icon_data, icon_size);
-            if (got > 0) icon_size = (size_t)got;
-            else { free(icon_data); icon_data = NULL; icon_size = 0; }
+            if (got > 0) { icon_size = (size_t)got; m->has_icon = 1; }
+            else { pal_scratch_put(icon_data); icon_data = NULL; icon_size = 0; }
           }
         }
       }
@@ -4834,52 +5654,237 @@ static http_response_t *api_game_meta(const http_request_t *request) {
     exfat_cleanup(&ctx);
   }
 
-  if (!title_id[0] && content_id[0]) {
-    (void)title_id_from_content_id(content_id, title_id, sizeof(title_id));
+  if (!m->id[0] && m->content_id[0]) {
+    (void)title_id_from_content_id(m->content_id, m->id, sizeof(m->id));
+  }
+
+  pal_scratch_put(icon_data);
+  return 0;
+}
+
+/* Metadata of an installed app directory: param.sfo, else param.json */
+static int load_game_dir(const char *app_dir, http_game_meta_t *m, char *icon,
+                         size_t icon_size) {
+  static const char *const sfos[] = {"sce_sys/param.sfo", "param.sfo", NULL};
+  char p[FTP_PATH_MAX];
+  int rc = -1;
+
+  for (size_t k = 0; (sfos[k] != NULL) && (rc != 0); k++) {
+    int n = snprintf(p, sizeof(p), "%s/%s", app_dir, sfos[k]);
+    if (n < 0 || (size_t)n >= sizeof(p) || access(p, R_OK) != 0) {
+      continue;
+    }
+    pal_scratch_mark_t mark = pal_scratch_mark();
+    uint8_t *sfo = NULL;
+    size_t sfo_size = 0U;
+    if (read_file_to_buffer(p, &sfo, &sfo_size, 65536U) == 0) {
+      (void)sfo_get_string(sfo, sfo_size, "TITLE_ID", m->id, sizeof(m->id));
+      (void)sfo_get_string(sfo, sfo_size, "TITLE", m->name, sizeof(m->name));
+      if (m->name[0] == '\0') {
+        (void)sfo_get_string(sfo, sfo_size, "TITLE_01", m->name,
+                             sizeof(m->name));
+      }
+      (void)sfo_get_string(sfo, sfo_size, "APP_VER", m->version,
+                           sizeof(m->version));
+      (void)sfo_get_string(sfo, sfo_size, "CATEGORY", m->category,
+                           sizeof(m->category));
+      (void)sfo_get_string(sfo, sfo_size, "CONTENT_ID", m->content_id,
+                           sizeof(m->content_id));
+      rc = 0;
+    }
+    pal_scratch_reset(mark);
+  }
+
+  int n = snprintf(p, sizeof(p), "%s/sce_sys/param.json", app_dir);
+  if ((rc != 0) && n > 0 && (size_t)n < sizeof(p) && access(p, R_OK) == 0) {
+    pal_scratch_mark_t mark = pal_scratch_mark();
+    uint8_t *json = NULL;
+    size_t json_size = 0U;
+    if (read_file_to_buffer(p, &json, &json_size, GAME_META_MAX_PARAM) == 0) {
+      /* json_get_string() needs a terminated string */
+      char *text = (char *)pal_scratch_alloc(json_size + 1U);
+      if (text != NULL) {
+        memcpy(text, json, json_size);
+        text[json_size] = '\0';
+        (void)json_get_string(text, "titleId", m->id, sizeof(m->id));
+        (void)json_get_string(text, "titleName", m->name, sizeof(m->name));
+        (void)json_get_string(text, "contentVersion", m->version,
+                              sizeof(m->version));
+        (void)json_get_string(text, "applicationCategoryType", m->category,
+                              sizeof(m->category));
+        (void)json_get_string(text, "contentId", m->content_id,
+                              sizeof(m->content_id));
+        rc = 0;
+      }
+    }
+    pal_scratch_reset(mark);
+  }
+
+  if (!m->id[0] && m->content_id[0]) {
+    (void)title_id_from_content_id(m->content_id, m->id, sizeof(m->id));
+  }
+  m->has_icon = (resolve_installed_icon_path(m->id[0] ? m->id : NULL,
+                                             app_dir, icon, icon_size) == 0);
+  if (!m->has_icon) {
+    icon[0] = '\0';
+  }
+  return rc;
+}
+
+int http_api_load_game(const char *path, http_game_meta_t *out, char *icon,
+                       size_t icon_size) {
+  char found[FTP_PATH_MAX];
+  struct stat st;
+  if ((path == NULL) || (out == NULL) || (stat(path, &st) != 0)) {
+    return -1;
+  }
+  memset(out, 0, sizeof(*out));
+  found[0] = '\0';
+
+  int rc = S_ISDIR(st.st_mode) ? load_game_dir(path, out, found, sizeof(found))
+                               : load_game_image(path, out);
+  if ((icon != NULL) && (icon_size > 0U)) {
+    (void)snprintf(icon, icon_size, "%s", found);
+  }
+  return rc;
+}
+
+static http_response_t *api_game_meta(const http_request_t *request) {
+  const char *query = strchr(request->uri, '?');
+  char path[1024] = "/";
+  if (query) (void)parse_path_param(query, path, sizeof(path));
+
+  char safe[FTP_PATH_MAX];
+  if (!validate_path(path, safe, sizeof(safe))) {
+    return error_json(HTTP_STATUS_403_FORBIDDEN, "Path traversal blocked");
+  }
+
+  http_game_meta_t m;
+  if (http_games_meta(safe, &m, NULL, 0U) != 0) {
+    return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a valid PKG or exFAT image");
   }
 
   /* Build JSON response */
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
-  http_response_add_header(resp, "Cache-Control", "max-age=3600");
+  http_response_set_header(resp, "Cache-Control", "max-age=3600");
 
   size_t body_cap = 1024;
   char *body = (char *)malloc(body_cap);
   if (!body) {
-    if (icon_data) free(icon_data);
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
 
   int blen = snprintf(body, body_cap,
       "{\"title_id\":\"%s\",\"title_name\":\"%s\",\"version\":\"%s\","
       "\"category\":\"%s\",\"content_id\":\"%s\",\"has_icon\":%s}",
-      title_id, title_name, version, category, content_id,
-      (icon_data && icon_size > 0) ? "true" : "false");
+      m.id, m.name, m.version, m.category, m.content_id,
+      m.has_icon ? "true" : "false");
 
   http_response_set_body(resp, body, (size_t)blen);
 
   free(body);
-  if (icon_data) free(icon_data);
   return resp;
 }
 
-static http_response_t *api_game_icon(const http_request_t *request) {
-  const char *query = strchr(request->uri, '?');
-  char path[1024] = "/";
-  if (query) (void)parse_path_param(query, path, sizeof(path));
+/*---------------------------------------------------------------------------*
+ * Icon responses (/api/game/icon, /api/admin/games/icon)
+ *
+ *   ?size=N   64 / 128 / HTTP_THUMB_MAX_EDGE thumbnail from http_thumb.c;
+ *             omitted or larger = the icon as stored
+ *
+ * The ETag names the source version (path, size, mtime) and the edge,
+ * so If-None-Match / If-Modified-Since are answered with a 304 before
+ * the image is opened.
+ *---------------------------------------------------------------------------*/
 
-  char safe[FTP_PATH_MAX];
-  if (!validate_path(path, safe, sizeof(safe))) {
-    return error_json(HTTP_STATUS_403_FORBIDDEN, "Path traversal blocked");
+/**
+ * @return the icon, a 304, or NULL when @p load finds nothing
+ */
+static http_response_t *icon_response(const http_request_t *request,
+                                      const char *query, const char *source,
+                                      const struct stat *st,
+                                      const char *cache_control,
+                                      http_thumb_load_fn load, void *user) {
+  unsigned edge = 0U;
+  char size_arg[16];
+  if ((query != NULL) &&
+      (parse_query_param(query, "size", size_arg, sizeof(size_arg)) == 0)) {
+    edge = http_thumb_edge((unsigned)strtoul(size_arg, NULL, 10));
+  }
+
+  char key[FTP_PATH_MAX + 48];
+  (void)snprintf(key, sizeof(key), "%s|%llx|%llx", source,
+                 (unsigned long long)st->st_size,
+                 (unsigned long long)st->st_mtime);
+  char etag[48];
+  http_thumb_etag(key, edge, etag, sizeof(etag));
+  char last_modified[64] = "";
+  struct tm tm_utc;
+  time_t mtime = st->st_mtime;
+  if (gmtime_r(&mtime, &tm_utc) != NULL) {
+    (void)strftime(last_modified, sizeof(last_modified),
+                   "%a, %d %b %Y %H:%M:%S GMT", &tm_utc);
+  }
+
+  /* If-None-Match wins over If-Modified-Since (RFC 9110 13.1.3) */
+  const char *inm = http_get_header(request, "If-None-Match");
+  const char *ims = http_get_header(request, "If-Modified-Since");
+  int fresh = (inm != NULL) ? http_etag_match(inm, etag)
+                            : ((ims != NULL) && (last_modified[0] != '\0') &&
+                               (strcmp(ims, last_modified) == 0));
+
+  uint8_t *data = NULL;
+  size_t len = 0U;
+  if ((fresh == 0) &&
+      (http_thumb_get(key, edge, load, user, &data, &len) != 0)) {
+    return NULL;
+  }
+
+  http_response_t *resp = http_response_create(
+      (fresh != 0) ? HTTP_STATUS_304_NOT_MODIFIED : HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    free(data);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+  }
+  if (fresh == 0) {
+    http_response_add_header(resp, "Content-Type", "image/png");
+  }
+  http_response_set_header(resp, "Cache-Control", cache_control);
+  http_response_add_header(resp, "ETag", etag);
+  if (last_modified[0] != '\0') {
+    http_response_add_header(resp, "Last-Modified", last_modified);
+  }
+  if (fresh != 0) {
+    if (http_response_finalize(resp) != 0) {
+      http_response_destroy(resp);
+      return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
+    }
+    return resp;
+  }
+  if (http_response_set_body_owned(resp, data, len) != 0) {
+    free(data);
+    http_response_destroy(resp);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Failed to send icon");
   }
+  return resp;
+}
+
+typedef struct {
+  const char *path;
+  int not_image; /* neither a PKG nor an exFAT image */
+} image_icon_t;
 
+/* http_thumb_load_fn: icon0.png (or pic0.png) out of a PKG or exFAT image */
+static int image_icon_load(void *user, uint8_t **png, size_t *len) {
+  image_icon_t *src = (image_icon_t *)user;
   uint8_t *icon_data = NULL;
   size_t   icon_size = 0;
 
   /* 1. Try PKG archive first */
   pkg_context_t pkg_ctx;
-  if (pkg_init(&pkg_ctx, safe) == PKG_OK) {
-    fprintf(stderr, "[PKG-ICON] Successfully opened %s\n", safe);
+  if (pkg_init(&pkg_ctx, src->path) == PKG_OK) {
+    fprintf(stderr, "[PKG-ICON] Successfully opened %s\n", src->path);
     const pkg_entry_t *entry = pkg_find_entry_by_id(&pkg_ctx, PKG_ENTRY_ID_ICON0_PNG);
     if (!entry) {
       entry = pkg_find_entry_by_id(&pkg_ctx, PKG_ENTRY_ID_PIC0_PNG); /* fallback */
@@ -4904,8 +5909,9 @@ static http_response_t *api_game_icon(const http_request_t *request) {
   } else {
     /* 2. Fall back to exFAT image */
     exfat_context_t ctx;
-    if (exfat_init(&ctx, safe) != 0) {
-      return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a valid PKG or exFAT image");
+    if (exfat_init(&ctx, src->path) != 0) {
+      src->not_image = 1;
+      return -1;
     }
 
     exfat_file_info_t root_entries[GAME_META_MAX_ENTRIES];
@@ -4945,27 +5951,48 @@ static http_response_t *api_game_icon(const http_request_t *request) {
   }
 
   if (!icon_data || icon_size == 0) {
-    return error_json(HTTP_STATUS_404_NOT_FOUND, "Icon not found in image");
+    return -1;
   }
+  *png = icon_data;
+  *len = icon_size;
+  return 0;
+}
 
-  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
-  http_response_add_header(resp, "Content-Type", "image/png");
-  http_response_add_header(resp, "Cache-Control", "max-age=86400");
-  
-  if (http_response_set_body_owned(resp, icon_data, icon_size) != 0) {
-    free(icon_data);
-    http_response_destroy(resp);
-    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Failed to send icon");
+static http_response_t *api_game_icon(const http_request_t *request) {
+  const char *query = strchr(request->uri, '?');
+  char path[1024] = "/";
+  if (query) (void)parse_path_param(query, path, sizeof(path));
+
+  char safe[FTP_PATH_MAX];
+  if (!validate_path(path, safe, sizeof(safe))) {
+    return error_json(HTTP_STATUS_403_FORBIDDEN, "Path traversal blocked");
+  }
+  struct stat st;
+  if ((stat(safe, &st) != 0) || !S_ISREG(st.st_mode)) {
+    return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a valid PKG or exFAT image");
+  }
+
+  image_icon_t src = {safe, 0};
+  http_response_t *resp = icon_response(request, query, safe, &st,
+                                        "max-age=86400", image_icon_load,
+                                        &src);
+  if (resp != NULL) {
+    return resp;
   }
-  return resp;
+  if (src.not_image) {
+    return error_json(HTTP_STATUS_400_BAD_REQUEST, "Not a valid PKG or exFAT image");
+  }
+  return error_json(HTTP_STATUS_404_NOT_FOUND, "Icon not found in image");
 }
 
 /*===========================================================================*
  * ARCHIVE EXTRACTION (Phase 5 — libarchive)
  *
  *   POST /api/extract?path=<archive>&dst=<dir>
- *     Extracts an archive to the destination directory using libarchive.
- *     Runs in a background thread with progress tracking.
+ *     Extracts an archive to the destination directory.  PS4 PKGs are
+ *     unpacked natively (every plaintext entry, see pkg_extract_batch);
+ *     anything else goes through libarchive.  Runs in a background thread
+ *     with progress tracking.
  *
  *   GET  /api/extract_progress
  *     Returns extraction progress: { done, bytes_extracted, total_bytes, error }
@@ -4973,27 +6000,96 @@ static http_response_t *api_game_icon(const http_request_t *request) {
  *   POST /api/extract_cancel
  *     Cancels the active extraction.
  *
- * NOTE: libarchive must be linked (-larchive) for this to compile.
- *       When ENABLE_LIBARCHIVE is not defined, these return stub responses.
+ * NOTE: libarchive must be linked (-larchive) for non-PKG archives.
+ *       When ENABLE_LIBARCHIVE is not defined, only PKGs are accepted.
  *===========================================================================*/
 
+#include <pthread.h>
+
 /* Extraction state (single active extraction at a time) */
 static struct {
   volatile int active;
   volatile int done;
   volatile int cancelled;
   volatile int error;
-  volatile uint64_t bytes_extracted;
+  atomic_uint_fast64_t bytes_extracted; /* PKG workers add concurrently */
   volatile uint64_t total_bytes;
-  char archive_path[1024];
-  char dest_path[1024];
+  char archive_path[FTP_PATH_MAX];
+  char dest_path[FTP_PATH_MAX];
   char error_msg[256];
 } g_extract = {0};
 
+static void extract_pkg_progress(void *user, uint64_t bytes) {
+  (void)user;
+  atomic_fetch_add_explicit(&g_extract.bytes_extracted, bytes,
+                            memory_order_relaxed);
+}
+
+/* Every plaintext entry of the PKG in @p arg to dest_path/<entry name> */
+static void *extract_pkg_thread(void *arg) {
+  pkg_context_t *pkg = (pkg_context_t *)arg;
+  size_t n = 0U;
+  pkg_batch_item_t *items =
+      (pkg_batch_item_t *)calloc(pkg->num_entries, sizeof(*items));
+
+  if (items == NULL) {
+    snprintf(g_extract.error_msg, sizeof(g_extract.error_msg),
+             "Out of memory");
+    g_extract.error = 1;
+  } else {
+    const char *dst = g_extract.dest_path;
+    size_t dlen = strlen(dst);
+    const char *sep = ((dlen > 0U) && (dst[dlen - 1U] == '/')) ? "" : "/";
+    (void)pal_dir_create(dst, 0755);
+
+    for (size_t i = 0U; i < pkg->num_entries; i++) {
+      const pkg_entry_t *e = &pkg->entries[i];
+      char name[PKG_ENTRY_NAME_MAX];
+      if (pkg_entry_is_encrypted(e) ||
+          (pkg_entry_name(pkg, e, name, sizeof(name)) != PKG_OK)) {
+        continue;
+      }
+      size_t cap = dlen + strlen(sep) + strlen(name) + 1U;
+      char *path = (char *)malloc(cap);
+      if (path == NULL) {
+        continue;
+      }
+      snprintf(path, cap, "%s%s%s", dst, sep, name);
+      items[n].entry = e;
+      items[n].path = path;
+      n++;
+      g_extract.total_bytes += (uint64_t)e->size;
+    }
+
+    int rc = pkg_extract_batch(pkg, items, n, 0U, extract_pkg_progress, NULL,
+                               &g_extract.cancelled);
+    if (rc == PKG_ERR_CANCELLED) {
+      snprintf(g_extract.error_msg, sizeof(g_extract.error_msg), "Cancelled");
+    } else if (rc != PKG_OK) {
+      size_t failed = 0U;
+      for (size_t i = 0U; i < n; i++) {
+        failed += (items[i].result != PKG_OK) ? 1U : 0U;
+      }
+      snprintf(g_extract.error_msg, sizeof(g_extract.error_msg),
+               "%zu of %zu entries failed (%d)", failed, n, rc);
+      g_extract.error = 1;
+    }
+    for (size_t i = 0U; i < n; i++) {
+      free((void *)(uintptr_t)items[i].path);
+    }
+    free(items);
+  }
+
+  pkg_cleanup(pkg);
+  free(pkg);
+  g_extract.done = 1;
+  g_extract.active = 0;
+  return NULL;
+}
+
 #if defined(ENABLE_LIBARCHIVE) && ENABLE_LIBARCHIVE
 #include <archive.h>
 #include <archive_entry.h>
-#include <pthread.h>
 
 static void *extract_thread(void *arg) {
   (void)arg;
@@ -5127,16 +6223,40 @@ static http_response_t *api_extract(const http_request_t *request) {
     return error_json(HTTP_STATUS_403_FORBIDDEN, "Path traversal blocked");
   }
 
+  /* PKG first: native, no libarchive needed */
+  void *(*thread_fn)(void *) = NULL;
+  void *thread_arg = NULL;
+  pkg_context_t *pkg = (pkg_context_t *)malloc(sizeof(*pkg));
+  if (pkg != NULL) {
+    if (pkg_init(pkg, safe_path) == PKG_OK) {
+      thread_fn = extract_pkg_thread;
+      thread_arg = pkg;
+    } else {
+      pkg_cleanup(pkg);
+      free(pkg);
+      pkg = NULL;
+    }
+  }
 #if defined(ENABLE_LIBARCHIVE) && ENABLE_LIBARCHIVE
+  if (thread_fn == NULL) {
+    thread_fn = extract_thread;
+  }
+#endif
+  if (thread_fn == NULL) {
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR,
+                      "libarchive not available — compile with ENABLE_LIBARCHIVE=1");
+  }
+
   /* Set up extraction state */
   memset(&g_extract, 0, sizeof(g_extract));
-  strncpy(g_extract.archive_path, safe_path, sizeof(g_extract.archive_path) - 1);
-  strncpy(g_extract.dest_path, safe_dst, sizeof(g_extract.dest_path) - 1);
+  /* Same FTP_PATH_MAX capacity as the validated paths: no truncation */
+  memcpy(g_extract.archive_path, safe_path, strlen(safe_path) + 1U);
+  memcpy(g_extract.dest_path, safe_dst, strlen(safe_dst) + 1U);
   g_extract.active = 1;
 
-  /* Get archive size for progress tracking */
+  /* Get archive size for progress tracking (PKGs sum their entries) */
   struct stat st;
-  if (stat(safe_path, &st) == 0) {
+  if ((pkg == NULL) && (stat(safe_path, &st) == 0)) {
     g_extract.total_bytes = (uint64_t)st.st_size;
   }
 
@@ -5145,9 +6265,14 @@ static http_response_t *api_extract(const http_request_t *request) {
   pthread_attr_t attr;
   pthread_attr_init(&attr);
   pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-  if (pthread_create(&tid, &attr, extract_thread, NULL) != 0) {
+  if (pal_thread_create(&tid, &attr, PAL_THREAD_BACKGROUND, thread_fn,
+                        thread_arg) != 0) {
     g_extract.active = 0;
     pthread_attr_destroy(&attr);
+    if (pkg != NULL) {
+      pkg_cleanup(pkg);
+      free(pkg);
+    }
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Failed to start extraction thread");
   }
   pthread_attr_destroy(&attr);
@@ -5157,20 +6282,11 @@ static http_response_t *api_extract(const http_request_t *request) {
   const char *body = "{\"ok\":true,\"message\":\"Extraction started\"}";
   http_response_set_body(resp, body, strlen(body));
   return resp;
-#else
-  return error_json(HTTP_STATUS_500_INTERNAL_ERROR,
-                    "libarchive not available — compile with ENABLE_LIBARCHIVE=1");
-#endif
 }
 
-static http_response_t *api_extract_progress(const http_request_t *request) {
-  (void)request;
-  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
-  http_response_add_header(resp, "Content-Type", "application/json");
-  http_response_add_header(resp, "Cache-Control", "no-store");
-
-  char body[256];
-  int len = snprintf(body, sizeof(body),
+/* Extraction state as JSON; shared by the poll route and /api/events */
+static int extract_progress_json(char *body, size_t cap) {
+  return snprintf(body, cap,
       "{\"active\":%s,\"done\":%s,\"cancelled\":%s,\"error\":%s,"
       "\"bytes_extracted\":%" PRIu64 ",\"total_bytes\":%" PRIu64
       ",\"error_msg\":\"%s\"}",
@@ -5178,9 +6294,19 @@ static http_response_t *api_extract_progress(const http_request_t *request) {
       g_extract.done ? "true" : "false",
       g_extract.cancelled ? "true" : "false",
       g_extract.error ? "true" : "false",
-      (uint64_t)g_extract.bytes_extracted,
+      (uint64_t)atomic_load(&g_extract.bytes_extracted),
       (uint64_t)g_extract.total_bytes,
       g_extract.error_msg);
+}
+
+static http_response_t *api_extract_progress(const http_request_t *request) {
+  (void)request;
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Cache-Control", "no-store");
+
+  char body[256];
+  int len = extract_progress_json(body, sizeof(body));
   http_response_set_body(resp, body, (size_t)len);
   return resp;
 }
@@ -5216,23 +6342,20 @@ static http_response_t *api_extract_cancel(const http_request_t *request) {
 
 #define DL_MAX_ACTIVE 4
 #define DL_URL_MAX    2048
-#define DL_READ_BUF   (256 * 1024)
 
-/* Download entry state */
+/* Download entry state; progress, pause and cancel live in ctl */
 typedef struct {
   int         active;
   int         done;
-  int         paused;
   int         error;
   int         id;
   char        url[DL_URL_MAX];
   char        dst_path[1024];
   char        filename[256];
   char        error_msg[256];
-  uint64_t    total_size;
-  uint64_t    downloaded;
-  double      speed;         /* bytes/sec */
+  http_fetch_ctl_t ctl;
   time_t      start_time;
+  time_t      end_time;
 } dl_entry_t;
 
 static dl_entry_t g_downloads[DL_MAX_ACTIVE];
@@ -5339,79 +6462,30 @@ static void dl_extract_filename(const char *url, char *out, size_t out_size) {
 }
 
 #if defined(ENABLE_LIBCURL) && ENABLE_LIBCURL
-#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
-#include "pal_curl.h"
-#else
-#include <curl/curl.h>
-#endif
 #include <pthread.h>
 
-struct dl_write_ctx {
-  dl_entry_t *dl;
-  int fd;
-};
-
-static size_t dl_curl_write(void *ptr, size_t size, size_t nmemb, void *userdata) {
-  struct dl_write_ctx *ctx = (struct dl_write_ctx *)userdata;
-  size_t total = size * nmemb;
-  if (ctx->dl->paused) return CURL_WRITEFUNC_PAUSE;
-  ssize_t w = write(ctx->fd, ptr, total);
-  if (w <= 0) return 0;
-  ctx->dl->downloaded += (uint64_t)w;
-  return (size_t)w;
-}
-
+/*
+ * One thread per download.  http_fetch() splits the file over ranged
+ * connections when the server allows it and keeps "<file>.zdl" so a
+ * restart with the same URL and destination resumes the transfer.
+ */
 static void *dl_thread(void *arg) {
   dl_entry_t *dl = (dl_entry_t *)arg;
   char filepath[2048];
   snprintf(filepath, sizeof(filepath), "%s/%s", dl->dst_path, dl->filename);
 
-  int fd = open(filepath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-  if (fd < 0) {
-    snprintf(dl->error_msg, sizeof(dl->error_msg), "Cannot create file: %s", strerror(errno));
-    dl->error = 1;
-    dl->done = 1;
-    dl->active = 0;
-    return NULL;
-  }
-
-  CURL *curl = curl_easy_init();
-  if (!curl) {
-    close(fd);
-    snprintf(dl->error_msg, sizeof(dl->error_msg), "curl_easy_init failed");
+  char err[sizeof(dl->error_msg)] = "";
+  int rc = http_fetch(dl->url, filepath, &dl->ctl, err, sizeof(err));
+  if (rc == HTTP_FETCH_CANCELLED) {
+    snprintf(dl->error_msg, sizeof(dl->error_msg), "Cancelled by user");
     dl->error = 1;
-    dl->done = 1;
-    dl->active = 0;
-    return NULL;
-  }
-
-  struct dl_write_ctx wctx = { dl, fd };
-  curl_easy_setopt(curl, CURLOPT_URL, dl->url);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, dl_curl_write);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &wctx);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 10L);
-  curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
-  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
-  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
-  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
-
-  CURLcode res = curl_easy_perform(curl);
-  if (res != CURLE_OK) {
-    snprintf(dl->error_msg, sizeof(dl->error_msg), "curl: %s", curl_easy_strerror(res));
+  } else if (rc != HTTP_FETCH_OK) {
+    snprintf(dl->error_msg, sizeof(dl->error_msg), "%s", err);
     dl->error = 1;
   }
+  ftp_list_cache_invalidate(filepath);
 
-  double total_size = 0;
-  curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &total_size);
-  if (total_size > 0) dl->total_size = (uint64_t)total_size;
-
-  double speed = 0;
-  curl_easy_getinfo(curl, CURLINFO_SPEED_DOWNLOAD, &speed);
-  dl->speed = speed;
-
-  curl_easy_cleanup(curl);
-  close(fd);
+  dl->end_time = time(NULL);
   dl->done = 1;
   dl->active = 0;
   return NULL;
@@ -5491,7 +6565,7 @@ static http_response_t *api_dl_start(const http_request_t *request) {
   pthread_attr_t attr;
   pthread_attr_init(&attr);
   pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-  if (pthread_create(&tid, &attr, dl_thread, dl) != 0) {
+  if (pal_thread_create(&tid, &attr, PAL_THREAD_DISK, dl_thread, dl) != 0) {
     dl->active = 0;
     pthread_attr_destroy(&attr);
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Failed to start download thread");
@@ -5516,27 +6590,28 @@ static http_response_t *api_dl_start(const http_request_t *request) {
   return resp;
 }
 
-static http_response_t *api_dl_status(const http_request_t *request) {
-  (void)request;
-  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
-  http_response_add_header(resp, "Content-Type", "application/json");
-  http_response_add_header(resp, "Cache-Control", "no-store");
-
-  /* Build JSON array of all download entries */
-  char body[4096];
+/*
+ * Download table as JSON; shared by /api/download/status and /api/events.
+ * body must hold at least DL_STATUS_JSON_MAX bytes.
+ */
+#define DL_STATUS_JSON_MAX 4096
+static int dl_status_json(char *body) {
+  const size_t cap = DL_STATUS_JSON_MAX;
   int pos = 0;
-  pos += snprintf(body + pos, sizeof(body) - (size_t)pos, "{\"downloads\":[");
+  pos += snprintf(body + pos, cap - (size_t)pos, "{\"downloads\":[");
 
   int first = 1;
   for (int i = 0; i < DL_MAX_ACTIVE; i++) {
     dl_entry_t *dl = &g_downloads[i];
     if (dl->id == 0) continue;
-    if (!first) pos += snprintf(body + pos, sizeof(body) - (size_t)pos, ",");
+    if (!first) pos += snprintf(body + pos, cap - (size_t)pos, ",");
     first = 0;
 
+    uint64_t downloaded = atomic_load(&dl->ctl.downloaded);
+    uint64_t total_size = atomic_load(&dl->ctl.total);
     int progress = 0;
-    if (dl->total_size > 0) {
-      progress = (int)(dl->downloaded * 100 / dl->total_size);
+    if (total_size > 0) {
+      progress = (int)(downloaded * 100 / total_size);
       if (progress > 100) progress = 100;
     } else if (dl->done && !dl->error) {
       progress = 100;
@@ -5563,18 +6638,37 @@ static http_response_t *api_dl_status(const http_request_t *request) {
     esc_error[(esc_pos < sizeof(esc_error)) ? esc_pos
                                             : sizeof(esc_error) - 1U] = '\0';
 
-    pos += snprintf(body + pos, sizeof(body) - (size_t)pos,
+    /* Average over this run; bytes resumed from disk do not count */
+    time_t until = dl->done ? dl->end_time : time(NULL);
+    double secs = (until > dl->start_time) ? (double)(until - dl->start_time)
+                                           : 1.0;
+    double speed =
+        (double)(downloaded - atomic_load(&dl->ctl.resumed)) / secs;
+
+    pos += snprintf(body + pos, cap - (size_t)pos,
         "{\"id\":%d,\"name\":\"%s\",\"url\":\"%s\","
         "\"progress\":%d,\"downloaded\":%" PRIu64 ",\"total_size\":%" PRIu64 ","
-        "\"speed\":%.0f,\"done\":%s,\"error\":\"%s\",\"paused\":%s}",
+        "\"speed\":%.0f,\"done\":%s,\"error\":\"%s\",\"paused\":%s,"
+        "\"connections\":%d}",
         dl->id, esc_name, esc_url,
-        progress, (uint64_t)dl->downloaded, (uint64_t)dl->total_size,
-        dl->speed, dl->done ? "true" : "false",
+        progress, downloaded, total_size,
+        speed, dl->done ? "true" : "false",
         esc_error,
-        dl->paused ? "true" : "false");
+        atomic_load(&dl->ctl.paused) ? "true" : "false",
+        atomic_load(&dl->ctl.connections));
   }
-  pos += snprintf(body + pos, sizeof(body) - (size_t)pos, "]}");
+  pos += snprintf(body + pos, cap - (size_t)pos, "]}");
+  return pos;
+}
 
+static http_response_t *api_dl_status(const http_request_t *request) {
+  (void)request;
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Cache-Control", "no-store");
+
+  char body[DL_STATUS_JSON_MAX];
+  int pos = dl_status_json(body);
   http_response_set_body(resp, body, (size_t)pos);
   return resp;
 }
@@ -5597,13 +6691,15 @@ static http_response_t *api_dl_pause(const http_request_t *request) {
   dl_entry_t *dl = dl_find_by_id(id);
   if (!dl) return error_json(HTTP_STATUS_404_NOT_FOUND, "Download not found");
 
-  dl->paused = !dl->paused;
+  /* Ranged downloads close their connections and resume where they were */
+  int paused = !atomic_load(&dl->ctl.paused);
+  atomic_store(&dl->ctl.paused, paused);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
   char body[64];
   int len = snprintf(body, sizeof(body), "{\"ok\":true,\"paused\":%s}",
-                     dl->paused ? "true" : "false");
+                     paused ? "true" : "false");
   http_response_set_body(resp, body, (size_t)len);
   return resp;
 }
@@ -5625,10 +6721,8 @@ static http_response_t *api_dl_cancel(const http_request_t *request) {
   dl_entry_t *dl = dl_find_by_id(id);
   if (!dl) return error_json(HTTP_STATUS_404_NOT_FOUND, "Download not found");
 
-  dl->error = 1;
-  snprintf(dl->error_msg, sizeof(dl->error_msg), "Cancelled by user");
-  dl->done = 1;
-  dl->active = 0;
+  /* The download thread removes the partial file and marks it done */
+  atomic_store(&dl->ctl.cancel, 1);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "application/json");
@@ -5637,6 +6731,88 @@ static http_response_t *api_dl_cancel(const http_request_t *request) {
   return resp;
 }
 
+/*===========================================================================*
+ * EVENT STREAM — GET /api/events (Server-Sent Events)
+ *
+ *   Topic       Payload (same JSON as the poll route)
+ *   ─────────   ─────────────────────────────────────
+ *   copy        /api/copy_progress      (ENABLE_WEB_UPLOAD only)
+ *   extract     /api/extract_progress
+ *   downloads   /api/download/status
+ *   ftp         active sessions and transfer counters
+ *
+ * The HTTP server renders each topic once per tick and pushes the frame
+ * only to subscribers whose last copy differs, so an idle UI receives
+ * nothing but keep-alive comments.
+ *===========================================================================*/
+
+int http_api_is_event_stream(const http_request_t *request) {
+  if ((request == NULL) || (request->method != HTTP_METHOD_GET)) {
+    return 0;
+  }
+  return ((strncmp(request->uri, "/api/events", 11) == 0) &&
+          ((request->uri[11] == '\0') || (request->uri[11] == '?')))
+             ? 1
+             : 0;
+}
+
+static int ftp_events_json(char *body, size_t cap) {
+  if (g_ftp_server_ctx == NULL) {
+    return snprintf(body, cap, "{\"sessions\":0}");
+  }
+  uint64_t total_conn = 0U;
+  uint64_t sent = 0U;
+  uint64_t received = 0U;
+  ftp_server_get_stats(g_ftp_server_ctx, &total_conn, &sent, &received);
+  return snprintf(body, cap,
+                  "{\"sessions\":%u,\"total_connections\":%" PRIu64
+                  ",\"bytes_sent\":%" PRIu64 ",\"bytes_received\":%" PRIu64
+                  "}",
+                  (unsigned)ftp_server_get_active_sessions(g_ftp_server_ctx),
+                  total_conn, sent, received);
+}
+
+size_t http_api_event_render(size_t topic, char *out, size_t cap) {
+  static const char *const names[HTTP_EVENT_TOPICS] = {"copy", "extract",
+                                                       "downloads", "ftp"};
+  if ((topic >= (size_t)HTTP_EVENT_TOPICS) || (out == NULL) ||
+      (cap < DL_STATUS_JSON_MAX + 64U)) {
+    return 0U;
+  }
+
+  int head = snprintf(out, cap, "event: %s\ndata: ", names[topic]);
+  char *json = out + head;
+  size_t room = cap - (size_t)head - 3U; /* "\n\n" + NUL */
+  int len = 0;
+  switch (topic) {
+  case 0U:
+#if ENABLE_WEB_UPLOAD
+    len = copy_progress_json(json, room);
+    break;
+#else
+    return 0U;
+#endif
+  case 1U:
+    len = extract_progress_json(json, room);
+    break;
+  case 2U:
+    len = dl_status_json(json);
+    if (len >= DL_STATUS_JSON_MAX) {
+      len = 0; /* truncated table */
+    }
+    break;
+  default:
+    len = ftp_events_json(json, room);
+    break;
+  }
+  if ((len <= 0) || ((size_t)len >= room)) {
+    return 0U;
+  }
+  /* SSE ends a data line at any newline; the JSON here never has one */
+  memcpy(json + len, "\n\n", 3U);
+  return (size_t)head + (size_t)len + 2U;
+}
+
 /*===========================================================================*
  * STATIC RESOURCE SERVING
  *===========================================================================*/
@@ -5667,6 +6843,95 @@ static const char *mime_for_ext(const char *path) {
   return "application/octet-stream";
 }
 
+/*---------------------------------------------------------------------------*
+ * Static asset caching
+ *
+ *   "css/app.css?v=3"  versioned URI → cached for a year, never revalidated
+ *   "index.html"       plain URI     → cached, revalidated via ETag (304)
+ *---------------------------------------------------------------------------*/
+#define STATIC_CACHE_VERSIONED "public, max-age=31536000, immutable"
+#define STATIC_CACHE_REVALIDATE "no-cache"
+
+/**
+ * Answer If-None-Match with a bodiless 304 when `etag` matches.
+ * @return the 304 response, or NULL to serve the body
+ */
+static http_response_t *static_not_modified(const http_request_t *request,
+                                            const char *etag,
+                                            int versioned) {
+  const char *inm = http_get_header(request, "If-None-Match");
+  if ((inm == NULL) || !http_etag_match(inm, etag)) {
+    return NULL;
+  }
+  http_response_t *resp = http_response_create(HTTP_STATUS_304_NOT_MODIFIED);
+  if (resp == NULL) {
+    return NULL;
+  }
+  http_response_set_header(resp, "Cache-Control",
+                           versioned ? STATIC_CACHE_VERSIONED
+                                     : STATIC_CACHE_REVALIDATE);
+  http_response_add_header(resp, "ETag", etag);
+  http_response_add_header(resp, "Vary", "Accept-Encoding");
+  if (http_response_finalize(resp) != 0) {
+    http_response_destroy(resp);
+    return NULL;
+  }
+  return resp;
+}
+
+/**
+ * Serve an embedded asset, picking the smallest variant the client
+ * accepts.  Bodies point straight into the read-only blob.
+ */
+static http_response_t *serve_embedded(const http_request_t *request,
+                                       const http_resource_t *res,
+                                       const char *path, int versioned) {
+  const unsigned char *body = res->data;
+  size_t body_len = res->size;
+  const char *encoding = NULL;
+  const char *suffix = "";
+
+  const char *accept = http_get_header(request, "Accept-Encoding");
+  if ((res->br_data != NULL) && http_accepts_encoding(accept, "br")) {
+    body = res->br_data;
+    body_len = res->br_size;
+    encoding = "br";
+    suffix = "-br";
+  } else if ((res->gzip_data != NULL) &&
+             http_accepts_encoding(accept, "gzip")) {
+    body = res->gzip_data;
+    body_len = res->gzip_size;
+    encoding = "gzip";
+    suffix = "-gz";
+  }
+
+  char etag[48];
+  (void)snprintf(etag, sizeof(etag), "\"%s%s\"", res->hash, suffix);
+  http_response_t *resp = static_not_modified(request, etag, versioned);
+  if (resp != NULL) {
+    return resp;
+  }
+
+  resp = http_response_create(HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    return NULL;
+  }
+  http_response_add_header(resp, "Content-Type", mime_for_ext(path));
+  http_response_set_header(resp, "Cache-Control",
+                           versioned ? STATIC_CACHE_VERSIONED
+                                     : STATIC_CACHE_REVALIDATE);
+  http_response_add_header(resp, "ETag", etag);
+  http_response_add_header(resp, "Vary", "Accept-Encoding");
+  if (encoding != NULL) {
+    http_response_add_header(resp, "Content-Encoding", encoding);
+  }
+  if (http_response_set_body_ref(resp, body, body_len) != 0) {
+    http_response_destroy(resp);
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Response too large");
+  }
+  return resp;
+}
+
 /*---------------------------------------------------------------------------*
  * serve_static — read files from HTTP_WEB_ROOT on the filesystem.
  *
@@ -5713,8 +6978,10 @@ static http_response_t *serve_static(const http_request_t *request) {
    *  "css/base.css?v=3"  →  "css/base.css"
    *                 ^── stop here                        */
   char clean_path[1024];
+  int versioned = 0;
   {
     const char *qmark = strchr(path, '?');
+    versioned = ((qmark != NULL) && (strstr(qmark, "v=") != NULL)) ? 1 : 0;
     size_t plen = qmark ? (size_t)(qmark - path) : strlen(path);
     if (plen >= sizeof(clean_path)) plen = sizeof(clean_path) - 1;
     memcpy(clean_path, path, plen);
@@ -5737,10 +7004,16 @@ static http_response_t *serve_static(const http_request_t *request) {
   /* Open and stat the file */
   struct stat st;
   if (stat(fspath, &st) != 0 || !S_ISREG(st.st_mode)) {
-    /* Fallback: try embedded resources (backward compat during transition) */
-    size_t esize = 0;
-    const char *econtent = http_get_resource(path, &esize);
-    if (econtent != NULL) {
+    /* Fallback: embedded copy of the UI (precompressed, ETag-validated) */
+    const http_resource_t *res = NULL;
+    if ((http_resource_get(path, &res) == 0) &&
+        (strstr(path, "index.html") == NULL)) {
+      return serve_embedded(request, res, path, versioned);
+    }
+    if (res != NULL) {
+      /* index.html is patched at runtime, so it is always sent identity */
+      const char *econtent = (const char *)res->data;
+      size_t esize = res->size;
       http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
       http_response_add_header(resp, "Content-Type", mime_for_ext(path));
 
@@ -5793,6 +7066,21 @@ static http_response_t *serve_static(const http_request_t *request) {
 
   size_t size = (size_t)st.st_size;
 
+  /*
+   * Disk assets other than the patched index revalidate by size+mtime,
+   * so an unchanged file costs a stat() instead of a full read.
+   */
+  char disk_etag[48] = "";
+  if (strstr(path, "index.html") == NULL) {
+    (void)snprintf(disk_etag, sizeof(disk_etag), "\"%llx-%llx\"",
+                   (unsigned long long)st.st_size,
+                   (unsigned long long)st.st_mtime);
+    http_response_t *nm = static_not_modified(request, disk_etag, versioned);
+    if (nm != NULL) {
+      return nm;
+    }
+  }
+
   /* Read file into memory */
   FILE *fp = fopen(fspath, "rb");
   if (fp == NULL) {
@@ -5830,7 +7118,14 @@ static http_response_t *serve_static(const http_request_t *request) {
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", mime_for_ext(path));
-  http_response_add_header(resp, "Cache-Control", "no-cache");
+  if (disk_etag[0] != '\0') {
+    http_response_set_header(resp, "Cache-Control",
+                             versioned ? STATIC_CACHE_VERSIONED
+                                       : STATIC_CACHE_REVALIDATE);
+    http_response_add_header(resp, "ETag", disk_etag);
+  } else {
+    http_response_add_header(resp, "Cache-Control", "no-cache");
+  }
 
 #if ENABLE_WEB_UPLOAD
   /* Inject CSRF token into HTML */
@@ -5932,7 +7227,7 @@ static http_response_t *png_fallback_response(void) {
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   http_response_add_header(resp, "Content-Type", "image/png");
-  http_response_add_header(resp, "Cache-Control", "public, max-age=3600");
+  http_response_set_header(resp, "Cache-Control", "public, max-age=3600");
   http_response_set_body(resp, k_png_1x1, sizeof(k_png_1x1));
   return resp;
 }
@@ -6010,15 +7305,15 @@ static http_response_t *api_network_reset(const http_request_t *request) {
     return resp;
   }
 
-  int rc =
-      pal_network_reset_ftp_stack(g_ftp_server_ctx->sessions, FTP_MAX_SESSIONS);
+  unsigned slots = atomic_load(&g_ftp_server_ctx->session_slots);
+  int rc = pal_network_reset_ftp_stack(g_ftp_server_ctx->sessions, slots);
 
   if (rc == 0) {
     pal_notification_send("zftpd: network stack reset OK");
     (void)snprintf(
         body, sizeof(body),
         "{\"ok\":true,\"message\":\"Network stack reset (%u sessions)\"}",
-        (unsigned)FTP_MAX_SESSIONS);
+        slots);
   } else {
     /*
      * Partial failure (invalid args) — fall back to notification so the
@@ -6889,52 +8184,65 @@ static http_response_t *api_admin_launch(const http_request_t *request) {
 static http_response_t *api_games_installed(const http_request_t *request) {
   (void)request;
 
-  enum { GAMES_BODY_CAP = 512U * 1024U };
-  char *body = (char *)malloc(GAMES_BODY_CAP);
-  if (body == NULL) {
-    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
-  }
-
-  size_t pos = 0U;
-  if (buf_append_cstr(body, GAMES_BODY_CAP, &pos,
-                      "{\"ok\":true,\"entries\":[") != 0) {
-    free(body);
+  installed_gen_t *g = (installed_gen_t *)calloc(1U, sizeof(*g));
+  if (g == NULL) {
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
-
-  int first = 1;
-  size_t count_added = 0U;
-  const char *bases[] = {"/user/app", "/system_ex/app", "/mnt/ext0/user/app",
-                         NULL};
-  for (size_t bi = 0; bases[bi] != NULL; bi++) {
-    if (append_installed_entries_from_base(bases[bi], body, GAMES_BODY_CAP,
-                                           &pos, &first,
-                                           &count_added) != 0) {
-      free(body);
-      return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Response too large");
-    }
-  }
-
-  if (buf_append_cstr(body, GAMES_BODY_CAP, &pos, "]}") != 0) {
-    free(body);
-    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Response too large");
-  }
+  http_json_init(&g->json);
+  g->rows = http_games_installed(&g->count);
 
   http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
   if (resp == NULL) {
-    free(body);
+    installed_free(g);
     return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
   http_response_add_header(resp, "Content-Type", "application/json");
   http_response_add_header(resp, "Cache-Control", "no-store");
-  if (http_response_set_body_owned(resp, body, pos) != 0) {
-    free(body);
+  if (http_response_set_body_stream(resp, installed_fill, installed_free, g) !=
+      0) {
+    installed_free(g);
     http_response_destroy(resp);
-    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Body allocation failed");
+    return error_json(HTTP_STATUS_500_INTERNAL_ERROR, "Out of memory");
   }
   return resp;
 }
 
+/* http_thumb_load_fn: an installed title's icon0.png */
+static int file_icon_load(void *user, uint8_t **png, size_t *len) {
+  FILE *fp = fopen((const char *)user, "rb");
+  if (fp == NULL) {
+    return -1;
+  }
+  if (fseek(fp, 0, SEEK_END) != 0) {
+    fclose(fp);
+    return -1;
+  }
+  long flen = ftell(fp);
+  if (flen <= 0 || flen > (8 * 1024 * 1024)) {
+    fclose(fp);
+    return -1;
+  }
+  if (fseek(fp, 0, SEEK_SET) != 0) {
+    fclose(fp);
+    return -1;
+  }
+
+  uint8_t *buf = (uint8_t *)malloc((size_t)flen);
+  if (buf == NULL) {
+    fclose(fp);
+    return -1;
+  }
+  size_t got = fread(buf, 1, (size_t)flen, fp);
+  fclose(fp);
+  if (got != (size_t)flen) {
+    free(buf);
+    return -1;
+  }
+  *png = buf;
+  *len = got;
+  return 0;
+}
+
 static http_response_t *api_games_icon(const http_request_t *request) {
   const char *query = strchr(request->uri, '?');
   if (query == NULL) {
@@ -6959,52 +8267,31 @@ static http_response_t *api_games_icon(const http_request_t *request) {
   char path_hint[FTP_PATH_MAX] = {0};
   (void)parse_query_param(query, "path", path_hint, sizeof(path_hint));
 
+  /* The index knows where the icon of an installed title is */
+  char app_dir[FTP_PATH_MAX] = {0};
   char icon_path[FTP_PATH_MAX] = {0};
-  if (resolve_installed_icon_path((title_id[0] != '\0') ? title_id : NULL,
-                                  (path_hint[0] != '\0') ? path_hint : NULL,
-                                  icon_path, sizeof(icon_path)) != 0) {
-    return png_fallback_response();
-  }
-
-  FILE *fp = fopen(icon_path, "rb");
-  if (fp == NULL) {
-    return png_fallback_response();
-  }
-  if (fseek(fp, 0, SEEK_END) != 0) {
-    fclose(fp);
-    return png_fallback_response();
-  }
-  long flen = ftell(fp);
-  if (flen <= 0 || flen > (8 * 1024 * 1024)) {
-    fclose(fp);
-    return png_fallback_response();
-  }
-  if (fseek(fp, 0, SEEK_SET) != 0) {
-    fclose(fp);
-    return png_fallback_response();
-  }
-
-  uint8_t *buf = (uint8_t *)malloc((size_t)flen);
-  if (buf == NULL) {
-    fclose(fp);
-    return png_fallback_response();
-  }
-  size_t got = fread(buf, 1, (size_t)flen, fp);
-  fclose(fp);
-  if (got != (size_t)flen) {
-    free(buf);
+  http_game_meta_t meta;
+  if ((path_hint[0] == '\0') && (title_id[0] != '\0')) {
+    (void)http_games_find(title_id, app_dir, sizeof(app_dir));
+  }
+  const char *dir = (path_hint[0] != '\0') ? path_hint : app_dir;
+  if (((dir[0] == '\0') ||
+       (http_games_meta(dir, &meta, icon_path, sizeof(icon_path)) != 0) ||
+       (icon_path[0] == '\0')) &&
+      (resolve_installed_icon_path((title_id[0] != '\0') ? title_id : NULL,
+                                   (dir[0] != '\0') ? dir : NULL, icon_path,
+                                   sizeof(icon_path)) != 0)) {
     return png_fallback_response();
   }
 
-  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
-  http_response_add_header(resp, "Content-Type", "image/png");
-  http_response_add_header(resp, "Cache-Control", "no-store");
-  if (http_response_set_body_owned(resp, buf, got) != 0) {
-    free(buf);
-    http_response_destroy(resp);
+  struct stat st;
+  if ((stat(icon_path, &st) != 0) || !S_ISREG(st.st_mode)) {
     return png_fallback_response();
   }
-  return resp;
+  http_response_t *resp =
+      icon_response(request, query, icon_path, &st, "no-cache",
+                    file_icon_load, icon_path);
+  return (resp != NULL) ? resp : png_fallback_response();
 }
 
 static http_response_t *api_games_repair_visibility(const http_request_t *request) {
@@ -7268,6 +8555,7 @@ static http_response_t *api_games_uninstall(const http_request_t *request) {
     (void)snprintf(msg, sizeof(msg), "Uninstall failed: 0x%08X", (unsigned)rc);
     return status_json_200(0, msg, rc);
   }
+  http_games_refresh();
 
   char body[192];
   int n = snprintf(body, sizeof(body),
@@ -7339,6 +8627,7 @@ static http_response_t *api_games_install(const http_request_t *request) {
                    (unsigned)install_rc);
     return status_json_200(0, msg, install_rc);
   }
+  http_games_refresh();
 
     char body[512];
   int n = snprintf(
@@ -7422,6 +8711,7 @@ static http_response_t *api_games_reinstall(const http_request_t *request) {
                    (unsigned)install_rc);
     return status_json_200(0, msg, install_rc);
   }
+  http_games_refresh();
 
     char body[576];
   int n = snprintf(
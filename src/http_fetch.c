@@ -0,0 +1,701 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/**
+ * @file http_fetch.c
+ * @brief Remote URL downloads, split over parallel ranged connections
+ */
+
+#include "http_fetch.h"
+#include "ftp_log.h"
+#include "http_config.h"
+#include "pal_thread.h"
+
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+#include "pal_curl.h"
+#else
+#include <curl/curl.h>
+#endif
+#ifndef CURL_GLOBAL_ALL
+#define CURL_GLOBAL_ALL 3L /* pal_curl ignores the flags */
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Range table slots: the initial segments plus stolen halves */
+#define FETCH_SEG_MAX 32U
+/* Attempts without progress before the download gives up */
+#define FETCH_RETRIES 5U
+#define FETCH_RETRY_DELAY_US 500000U
+/* Stolen ranges start on this boundary */
+#define FETCH_ALIGN (64U * 1024U)
+#define FETCH_TICK_US 50000U
+
+#define FETCH_STATE_MAGIC 0x314C445AU /* "ZDL1" */
+#define FETCH_PATH_MAX 4096U
+
+typedef struct {
+  uint64_t pos;
+  uint64_t end; /* exclusive */
+} fetch_range_t;
+
+/* <file>.zdl: header, then FETCH_SEG_MAX ranges */
+typedef struct {
+  uint32_t magic;
+  uint32_t nseg;
+  uint64_t size;
+  uint64_t url_hash;
+} fetch_state_hdr_t;
+
+typedef struct {
+  const char *url;
+  const char *path;
+  http_fetch_ctl_t *ctl;
+  int fd;
+  uint64_t size;
+
+  pthread_mutex_t lock;
+  fetch_range_t seg[FETCH_SEG_MAX];
+  int busy[FETCH_SEG_MAX];
+  unsigned nseg;
+  unsigned failures; /* consecutive attempts without progress */
+  int failed;
+  unsigned workers; /* still running */
+  char err[256];
+} fetch_job_t;
+
+typedef struct {
+  fetch_job_t *job;
+  CURL *curl;
+  unsigned slot;
+  int code_checked;
+  int bad_range;
+  int io_errno;
+} fetch_conn_t;
+
+static pthread_once_t g_curl_once = PTHREAD_ONCE_INIT;
+
+static void curl_init_once(void) {
+  (void)curl_global_init(CURL_GLOBAL_ALL); /* not thread-safe itself */
+}
+
+/*===========================================================================*
+ * HELPERS
+ *===========================================================================*/
+
+static uint64_t url_hash(const char *url) {
+  uint64_t h = 1469598103934665603ULL; /* FNV-1a */
+  for (const unsigned char *p = (const unsigned char *)url; *p != 0U; p++) {
+    h = (h ^ *p) * 1099511628211ULL;
+  }
+  return h;
+}
+
+static void setopt_common(CURL *c, const char *url) {
+  curl_easy_setopt(c, CURLOPT_URL, url);
+  curl_easy_setopt(c, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(c, CURLOPT_MAXREDIRS, 10L);
+  curl_easy_setopt(c, CURLOPT_SSL_VERIFYPEER, 0L);
+  curl_easy_setopt(c, CURLOPT_CONNECTTIMEOUT, 30L);
+  curl_easy_setopt(c, CURLOPT_LOW_SPEED_LIMIT, 1L);
+  curl_easy_setopt(c, CURLOPT_LOW_SPEED_TIME, 60L);
+}
+
+static int write_all(int fd, const char *p, size_t len) {
+  while (len > 0U) {
+    ssize_t w = write(fd, p, len);
+    if (w < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    p += (size_t)w;
+    len -= (size_t)w;
+  }
+  return 0;
+}
+
+static int pwrite_all(int fd, const char *p, size_t len, uint64_t off) {
+  while (len > 0U) {
+    ssize_t w = pwrite(fd, p, len, (off_t)off);
+    if (w < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    p += (size_t)w;
+    len -= (size_t)w;
+    off += (uint64_t)w;
+  }
+  return 0;
+}
+
+static void state_path(char *out, size_t size, const char *path,
+                       const char *suffix) {
+  (void)snprintf(out, size, "%s.zdl%s", path, suffix);
+}
+
+/*===========================================================================*
+ * PROBE
+ *===========================================================================*/
+
+static size_t probe_write(void *ptr, size_t size, size_t nmemb, void *ud) {
+  (void)ptr;
+  size_t *got = (size_t *)ud;
+  *got += size * nmemb;
+  return (*got > 1U) ? 0U : (size * nmemb); /* only the one byte asked */
+}
+
+/* @return 1 if @p url has a known size and honours byte ranges */
+static int fetch_probe(const char *url, uint64_t *size_out) {
+  CURL *c = curl_easy_init();
+  if (c == NULL) {
+    return 0;
+  }
+
+  int ranged = 0;
+  long code = 0L;
+  curl_off_t len = -1;
+  setopt_common(c, url);
+  curl_easy_setopt(c, CURLOPT_NOBODY, 1L);
+  if ((curl_easy_perform(c) == CURLE_OK) &&
+      (curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &code) == CURLE_OK) &&
+      (code < 400L) &&
+      (curl_easy_getinfo(c, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &len) ==
+       CURLE_OK) &&
+      (len > 0)) {
+    *size_out = (uint64_t)len;
+
+    size_t got = 0U;
+    curl_easy_reset(c);
+    setopt_common(c, url);
+    curl_easy_setopt(c, CURLOPT_RANGE, "0-0");
+    curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, probe_write);
+    curl_easy_setopt(c, CURLOPT_WRITEDATA, &got);
+    (void)curl_easy_perform(c);
+    code = 0L;
+    (void)curl_easy_getinfo(c, CURLINFO_RESPONSE_CODE, &code);
+    ranged = ((code == 206L) && (got == 1U)) ? 1 : 0;
+  }
+  curl_easy_cleanup(c);
+  return ranged;
+}
+
+/*===========================================================================*
+ * SINGLE CONNECTION
+ *===========================================================================*/
+
+#ifdef CURLOPT_PAL_SINK_FD
+/* pal_curl writes the body itself; progress, pause and cancel come here */
+static int single_progress(void *ud, curl_off_t dltotal, curl_off_t dlnow,
+                           curl_off_t ultotal, curl_off_t ulnow) {
+  fetch_job_t *job = (fetch_job_t *)ud;
+  (void)dltotal;
+  (void)ultotal;
+  (void)ulnow;
+  while ((atomic_load(&job->ctl->paused) != 0) &&
+         (atomic_load(&job->ctl->cancel) == 0)) {
+    usleep(100000); /* 100 ms */
+  }
+  atomic_store(&job->ctl->downloaded, (uint64_t)dlnow);
+  return (atomic_load(&job->ctl->cancel) != 0) ? 1 : 0;
+}
+#else
+static size_t single_write(void *ptr, size_t size, size_t nmemb, void *ud) {
+  fetch_job_t *job = (fetch_job_t *)ud;
+  size_t total = size * nmemb;
+  while ((atomic_load(&job->ctl->paused) != 0) &&
+         (atomic_load(&job->ctl->cancel) == 0)) {
+    usleep(100000); /* 100 ms */
+  }
+  if ((atomic_load(&job->ctl->cancel) != 0) ||
+      (write_all(job->fd, (const char *)ptr, total) != 0)) {
+    return 0U;
+  }
+  atomic_fetch_add(&job->ctl->downloaded, (uint64_t)total);
+  return total;
+}
+#endif
+
+static int fetch_single(fetch_job_t *job) {
+  job->fd = open(job->path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (job->fd < 0) {
+    (void)snprintf(job->err, sizeof(job->err), "Cannot create file: %s",
+                   strerror(errno));
+    return HTTP_FETCH_FAILED;
+  }
+  CURL *c = curl_easy_init();
+  if (c == NULL) {
+    (void)close(job->fd);
+    (void)snprintf(job->err, sizeof(job->err), "curl_easy_init failed");
+    return HTTP_FETCH_FAILED;
+  }
+
+  setopt_common(c, job->url);
+#ifdef CURLOPT_PAL_SINK_FD
+  /* Received into pool buffers, written by a second thread */
+  curl_easy_setopt(c, CURLOPT_PAL_SINK_FD, (long)job->fd);
+  curl_easy_setopt(c, CURLOPT_NOPROGRESS, 0L);
+  curl_easy_setopt(c, CURLOPT_XFERINFOFUNCTION, single_progress);
+  curl_easy_setopt(c, CURLOPT_XFERINFODATA, job);
+#else
+  curl_easy_setopt(c, CURLOPT_WRITEFUNCTION, single_write);
+  curl_easy_setopt(c, CURLOPT_WRITEDATA, job);
+#endif
+  CURLcode res = curl_easy_perform(c);
+
+  curl_off_t len = 0;
+  (void)curl_easy_getinfo(c, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &len);
+  if (len > 0) {
+    atomic_store(&job->ctl->total, (uint64_t)len);
+  }
+  curl_easy_cleanup(c);
+  (void)close(job->fd);
+
+  if (atomic_load(&job->ctl->cancel) != 0) {
+    (void)unlink(job->path);
+    return HTTP_FETCH_CANCELLED;
+  }
+  if (res != CURLE_OK) {
+    (void)snprintf(job->err, sizeof(job->err), "curl: %s",
+                   curl_easy_strerror(res));
+    return HTTP_FETCH_FAILED;
+  }
+  return HTTP_FETCH_OK;
+}
+
+/*===========================================================================*
+ * SEGMENT TABLE
+ *===========================================================================*/
+
+/* An idle unfinished range, else the upper half of the largest busy one */
+static int take_locked(fetch_job_t *job) {
+  for (unsigned i = 0U; i < job->nseg; i++) {
+    if ((job->busy[i] == 0) && (job->seg[i].pos < job->seg[i].end)) {
+      return (int)i;
+    }
+  }
+
+  int victim = -1;
+  uint64_t best = 0U;
+  for (unsigned i = 0U; i < job->nseg; i++) {
+    uint64_t left = (job->seg[i].end > job->seg[i].pos)
+                        ? (job->seg[i].end - job->seg[i].pos)
+                        : 0U;
+    if ((job->busy[i] != 0) && (left > best)) {
+      best = left;
+      victim = (int)i;
+    }
+  }
+  if ((victim < 0) || (best < 2U * (uint64_t)HTTP_FETCH_STEAL_MIN)) {
+    return -1;
+  }
+
+  int slot = -1;
+  for (unsigned i = 0U; i < job->nseg; i++) {
+    if ((job->busy[i] == 0) && (job->seg[i].pos >= job->seg[i].end)) {
+      slot = (int)i;
+      break;
+    }
+  }
+  if ((slot < 0) && (job->nseg < FETCH_SEG_MAX)) {
+    slot = (int)job->nseg++;
+  }
+  if (slot < 0) {
+    return -1;
+  }
+
+  fetch_range_t *v = &job->seg[victim];
+  uint64_t mid = v->pos + (best / 2U);
+  mid -= mid % FETCH_ALIGN;
+  job->seg[slot].pos = mid;
+  job->seg[slot].end = v->end;
+  v->end = mid; /* the victim's connection stops at its new end */
+  return slot;
+}
+
+static uint64_t remaining_locked(const fetch_job_t *job) {
+  uint64_t left = 0U;
+  for (unsigned i = 0U; i < job->nseg; i++) {
+    if (job->seg[i].end > job->seg[i].pos) {
+      left += job->seg[i].end - job->seg[i].pos;
+    }
+  }
+  return left;
+}
+
+/* Data first, then the table that claims it; replaced with a rename */
+static void state_save(fetch_job_t *job) {
+  fetch_state_hdr_t hdr;
+  fetch_range_t seg[FETCH_SEG_MAX];
+
+  (void)fdatasync(job->fd);
+  pthread_mutex_lock(&job->lock);
+  hdr.magic = FETCH_STATE_MAGIC;
+  hdr.nseg = job->nseg;
+  hdr.size = job->size;
+  hdr.url_hash = url_hash(job->url);
+  memcpy(seg, job->seg, sizeof(seg));
+  pthread_mutex_unlock(&job->lock);
+
+  char tmp[FETCH_PATH_MAX];
+  char final[FETCH_PATH_MAX];
+  state_path(tmp, sizeof(tmp), job->path, ".tmp");
+  state_path(final, sizeof(final), job->path, "");
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return;
+  }
+  int ok = (write_all(fd, (const char *)&hdr, sizeof(hdr)) == 0) &&
+           (write_all(fd, (const char *)seg, sizeof(seg)) == 0);
+  (void)close(fd);
+  if ((ok == 0) || (rename(tmp, final) != 0)) {
+    (void)unlink(tmp);
+  }
+}
+
+/* @return 0 with the table loaded from a state file matching this download */
+static int state_load(fetch_job_t *job) {
+  char final[FETCH_PATH_MAX];
+  state_path(final, sizeof(final), job->path, "");
+  int fd = open(final, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return -1;
+  }
+  fetch_state_hdr_t hdr;
+  fetch_range_t seg[FETCH_SEG_MAX];
+  int ok = (read(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr)) &&
+           (read(fd, seg, sizeof(seg)) == (ssize_t)sizeof(seg));
+  (void)close(fd);
+
+  struct stat st;
+  if ((ok == 0) || (hdr.magic != FETCH_STATE_MAGIC) ||
+      (hdr.size != job->size) || (hdr.url_hash != url_hash(job->url)) ||
+      (hdr.nseg == 0U) || (hdr.nseg > FETCH_SEG_MAX) ||
+      (stat(job->path, &st) != 0) || ((uint64_t)st.st_size != job->size)) {
+    return -1;
+  }
+  for (unsigned i = 0U; i < hdr.nseg; i++) {
+    if ((seg[i].pos > seg[i].end) || (seg[i].end > job->size)) {
+      return -1;
+    }
+  }
+  memcpy(job->seg, seg, sizeof(seg));
+  job->nseg = hdr.nseg;
+  return 0;
+}
+
+/*===========================================================================*
+ * RANGED CONNECTIONS
+ *===========================================================================*/
+
+static size_t seg_write(void *ptr, size_t size, size_t nmemb, void *ud) {
+  fetch_conn_t *conn = (fetch_conn_t *)ud;
+  fetch_job_t *job = conn->job;
+  size_t total = size * nmemb;
+
+  if ((atomic_load(&job->ctl->paused) != 0) ||
+      (atomic_load(&job->ctl->cancel) != 0)) {
+    return 0U; /* drop the connection; the worker waits or exits */
+  }
+  if (conn->code_checked == 0) {
+    long code = 0L; /* 0 = not known yet (pal_curl) */
+    (void)curl_easy_getinfo(conn->curl, CURLINFO_RESPONSE_CODE, &code);
+    if ((code != 0L) && (code != 206L)) {
+      conn->bad_range = 1; /* a 200 would write the file's start here */
+      return 0U;
+    }
+    conn->code_checked = 1;
+  }
+
+  pthread_mutex_lock(&job->lock);
+  uint64_t pos = job->seg[conn->slot].pos;
+  uint64_t end = job->seg[conn->slot].end; /* lowered by a steal */
+  pthread_mutex_unlock(&job->lock);
+
+  size_t n = (end > pos) ? total : 0U;
+  if ((uint64_t)n > end - pos) {
+    n = (size_t)(end - pos);
+  }
+  if ((n > 0U) && (pwrite_all(job->fd, (const char *)ptr, n, pos) != 0)) {
+    conn->io_errno = errno;
+    return 0U;
+  }
+
+  pthread_mutex_lock(&job->lock);
+  job->seg[conn->slot].pos = pos + n; /* only this connection moves pos */
+  pthread_mutex_unlock(&job->lock);
+  atomic_fetch_add(&job->ctl->downloaded, (uint64_t)n);
+  return (n == total) ? total : 0U; /* range done: close early */
+}
+
+static void attempt_failed_locked(fetch_job_t *job, const fetch_conn_t *conn,
+                                  CURLcode res) {
+  if (conn->bad_range != 0) {
+    (void)snprintf(job->err, sizeof(job->err),
+                   "Server ignored the range request");
+    job->failures = FETCH_RETRIES; /* retrying will not help */
+  } else if (conn->io_errno != 0) {
+    (void)snprintf(job->err, sizeof(job->err), "Write failed: %s",
+                   strerror(conn->io_errno));
+    job->failures = FETCH_RETRIES;
+  } else if (res != CURLE_OK) {
+    (void)snprintf(job->err, sizeof(job->err), "curl: %s",
+                   curl_easy_strerror(res));
+  } else {
+    (void)snprintf(job->err, sizeof(job->err),
+                   "Connection closed before the range was complete");
+  }
+  if (++job->failures >= FETCH_RETRIES) {
+    job->failed = 1;
+  }
+}
+
+static void *seg_worker(void *arg) {
+  fetch_job_t *job = (fetch_job_t *)arg;
+  http_fetch_ctl_t *ctl = job->ctl;
+  fetch_conn_t conn;
+  memset(&conn, 0, sizeof(conn));
+  conn.job = job;
+  conn.curl = curl_easy_init();
+
+  pthread_mutex_lock(&job->lock);
+  while ((conn.curl != NULL) && (job->failed == 0) &&
+         (atomic_load(&ctl->cancel) == 0)) {
+    if (atomic_load(&ctl->paused) != 0) {
+      pthread_mutex_unlock(&job->lock);
+      usleep(100000); /* 100 ms */
+      pthread_mutex_lock(&job->lock);
+      continue;
+    }
+    int slot = take_locked(job);
+    if (slot < 0) {
+      break;
+    }
+    job->busy[slot] = 1;
+    uint64_t start = job->seg[slot].pos;
+    char range[48];
+    (void)snprintf(range, sizeof(range), "%" PRIu64 "-%" PRIu64, start,
+                   job->seg[slot].end - 1U);
+    pthread_mutex_unlock(&job->lock);
+
+    conn.slot = (unsigned)slot;
+    conn.code_checked = 0;
+    conn.bad_range = 0;
+    conn.io_errno = 0;
+    curl_easy_reset(conn.curl);
+    setopt_common(conn.curl, job->url);
+    curl_easy_setopt(conn.curl, CURLOPT_RANGE, range);
+    curl_easy_setopt(conn.curl, CURLOPT_WRITEFUNCTION, seg_write);
+    curl_easy_setopt(conn.curl, CURLOPT_WRITEDATA, &conn);
+    atomic_fetch_add(&ctl->connections, 1);
+    CURLcode res = curl_easy_perform(conn.curl);
+    atomic_fetch_sub(&ctl->connections, 1);
+
+    pthread_mutex_lock(&job->lock);
+    job->busy[slot] = 0;
+    fetch_range_t *s = &job->seg[slot];
+    if ((s->pos < s->end) && (atomic_load(&ctl->paused) == 0) &&
+        (atomic_load(&ctl->cancel) == 0)) {
+      if ((s->pos > start) && (conn.bad_range == 0) &&
+          (conn.io_errno == 0)) {
+        job->failures = 0U; /* it moved; just reconnect */
+      } else {
+        attempt_failed_locked(job, &conn, res);
+        pthread_mutex_unlock(&job->lock);
+        usleep(FETCH_RETRY_DELAY_US);
+        pthread_mutex_lock(&job->lock);
+      }
+    }
+  }
+  if (conn.curl == NULL) {
+    (void)snprintf(job->err, sizeof(job->err), "curl_easy_init failed");
+    job->failed = 1;
+  }
+  job->workers--;
+  pthread_mutex_unlock(&job->lock);
+
+  if (conn.curl != NULL) {
+    curl_easy_cleanup(conn.curl);
+  }
+  return NULL;
+}
+
+static int fetch_segmented(fetch_job_t *job) {
+  http_fetch_ctl_t *ctl = job->ctl;
+  char final[FETCH_PATH_MAX];
+  state_path(final, sizeof(final), job->path, "");
+
+  int resumed = (state_load(job) == 0) ? 1 : 0;
+  job->fd = open(job->path,
+                 O_WRONLY | O_CREAT | O_CLOEXEC | ((resumed != 0) ? 0 : O_TRUNC),
+                 0644);
+  if (job->fd < 0) {
+    (void)snprintf(job->err, sizeof(job->err), "Cannot create file: %s",
+                   strerror(errno));
+    return HTTP_FETCH_FAILED;
+  }
+
+  if (resumed == 0) {
+    int alloc_rc = -1;
+#if defined(__linux__)
+    alloc_rc = posix_fallocate(job->fd, 0, (off_t)job->size);
+#endif
+    if ((alloc_rc != 0) && (ftruncate(job->fd, (off_t)job->size) != 0)) {
+      (void)snprintf(job->err, sizeof(job->err), "Cannot allocate file: %s",
+                     strerror(errno));
+      (void)close(job->fd);
+      (void)unlink(job->path);
+      return HTTP_FETCH_FAILED;
+    }
+    uint64_t step = job->size / HTTP_FETCH_SEGMENTS;
+    step -= step % FETCH_ALIGN;
+    job->nseg = HTTP_FETCH_SEGMENTS;
+    for (unsigned i = 0U; i < job->nseg; i++) {
+      job->seg[i].pos = step * i;
+      job->seg[i].end = (i + 1U == job->nseg) ? job->size : step * (i + 1U);
+    }
+  }
+
+  uint64_t done = job->size - remaining_locked(job);
+  atomic_store(&ctl->downloaded, done);
+  atomic_store(&ctl->resumed, done);
+  {
+    char msg[192];
+    (void)snprintf(msg, sizeof(msg),
+                   "[DL] %u connections, %" PRIu64 " bytes%s",
+                   HTTP_FETCH_SEGMENTS, job->size, (resumed != 0) ? " (resumed)" : "");
+    ftp_log_line(FTP_LOG_INFO, msg);
+  }
+
+  pthread_t tids[HTTP_FETCH_SEGMENTS];
+  unsigned started = 0U;
+  pthread_mutex_lock(&job->lock);
+  for (unsigned k = 0U; k < HTTP_FETCH_SEGMENTS; k++) {
+    if (pal_thread_create(&tids[started], NULL, PAL_THREAD_DISK, seg_worker,
+                          job) == 0) {
+      started++;
+      job->workers++;
+    }
+  }
+  pthread_mutex_unlock(&job->lock);
+
+  /* Sync the table while the connections run */
+  unsigned since_save = 0U;
+  for (;;) {
+    pthread_mutex_lock(&job->lock);
+    unsigned running = job->workers;
+    pthread_mutex_unlock(&job->lock);
+    if (running == 0U) {
+      break;
+    }
+    usleep(FETCH_TICK_US);
+    since_save += FETCH_TICK_US / 1000U;
+    if (since_save >= HTTP_FETCH_STATE_MS) {
+      since_save = 0U;
+      state_save(job);
+    }
+  }
+  for (unsigned k = 0U; k < started; k++) {
+    (void)pthread_join(tids[k], NULL);
+  }
+
+  int rc;
+  if (atomic_load(&ctl->cancel) != 0) {
+    (void)close(job->fd);
+    (void)unlink(job->path);
+    (void)unlink(final);
+    rc = HTTP_FETCH_CANCELLED;
+  } else if (remaining_locked(job) == 0U) { /* workers joined */
+    (void)close(job->fd);
+    (void)unlink(final);
+    rc = HTTP_FETCH_OK;
+  } else {
+    state_save(job);
+    (void)close(job->fd);
+    if (started == 0U) {
+      (void)snprintf(job->err, sizeof(job->err),
+                     "Cannot start download threads");
+    }
+    rc = HTTP_FETCH_FAILED;
+  }
+  return rc;
+}
+
+/*===========================================================================*
+ * PUBLIC API
+ *===========================================================================*/
+
+int http_fetch(const char *url, const char *path, http_fetch_ctl_t *ctl,
+               char *err, size_t err_size) {
+  if ((url == NULL) || (path == NULL) || (ctl == NULL)) {
+    return HTTP_FETCH_FAILED;
+  }
+  (void)pthread_once(&g_curl_once, curl_init_once);
+
+  fetch_job_t *job = (fetch_job_t *)calloc(1U, sizeof(*job));
+  if (job == NULL) {
+    if ((err != NULL) && (err_size > 0U)) {
+      (void)snprintf(err, err_size, "Out of memory");
+    }
+    return HTTP_FETCH_FAILED;
+  }
+  job->url = url;
+  job->path = path;
+  job->ctl = ctl;
+  job->fd = -1;
+  (void)pthread_mutex_init(&job->lock, NULL);
+
+  int rc;
+  uint64_t size = 0U;
+  if ((fetch_probe(url, &size) != 0) &&
+      (size >= (uint64_t)HTTP_FETCH_SEGMENTED_MIN)) {
+    job->size = size;
+    atomic_store(&ctl->total, size);
+    rc = fetch_segmented(job);
+  } else {
+    if (size > 0U) {
+      atomic_store(&ctl->total, size);
+    }
+    rc = fetch_single(job);
+  }
+
+  if ((rc == HTTP_FETCH_FAILED) && (err != NULL) && (err_size > 0U)) {
+    (void)snprintf(err, err_size, "%s", job->err);
+  }
+  (void)pthread_mutex_destroy(&job->lock);
+  free(job);
+  return rc;
+}
@@ -0,0 +1,800 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file http_games.c
+ * @brief Game metadata and icon index behind the games/library APIs
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * One entry per path, chained in a hash table:
+ *
+ *   base   index of the base directory it was found under by a scan,
+ *          -1 for a path only ever looked up (an image file)
+ *   stamp  size + mtime of the metadata source when it was loaded
+ *   seen   last scan that found it; installed entries a scan did not
+ *          see are dropped at the end of that scan
+ *
+ * A scan costs one readdir per base and one stat() per title: only
+ * titles whose stamp changed go through http_api_load_game().  Loads
+ * run without the lock, so queries are never held up by a slow one.
+ *
+ * ON-DISK FORMAT (HTTP_GAMES_INDEX_PATH):
+ *
+ *   B <base> <mtime>\n
+ *   E <base> <size> <mtime> <has_icon>\t<id>\t<name>\t<version>\t
+ *     <category>\t<content_id>\t<icon>\t<path>\n
+ *
+ * Control characters in names are stored as spaces.  A missing or
+ * corrupt file just starts an empty index.
+ */
+
+#include "http_games.h"
+#include "ftp_config.h"
+#include "http_api.h"
+#include "http_config.h"
+#include "pal_thread.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+
+#define GI_NIL UINT32_MAX
+#define GI_BUCKETS 1024U
+#define GI_MAX_BASES 8U
+#define GI_UNTRUSTED INT64_MIN /* base mtime: rescan on the next query */
+
+typedef struct {
+  char *path; /* NULL = free slot */
+  char *icon; /* NULL = none */
+  uint32_t hnext; /* hash chain, or free list */
+  int base;
+  uint32_t seen;
+  uint64_t used; /* LRU clock of looked-up entries */
+  uint64_t size;
+  int64_t mtime;
+  http_game_meta_t meta;
+} gi_entry_t;
+
+/* Where installed titles live, scanned in this order */
+static const char *const k_default_bases[] = {
+    "/user/app", "/system_ex/app", "/mnt/ext0/user/app", NULL};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_done_cv = PTHREAD_COND_INITIALIZER;
+
+static gi_entry_t *g_entries;
+static uint32_t g_cap;
+static uint32_t g_used; /* slots ever handed out */
+static uint32_t g_free = GI_NIL;
+static uint32_t g_live;
+static uint32_t g_buckets[GI_BUCKETS];
+static uint64_t g_clock;
+
+static const char *const *g_bases = k_default_bases;
+static unsigned g_nbases;
+static int64_t g_base_mtime[GI_MAX_BASES]; /* at the last scan, -1 = none */
+
+static int g_started;
+static int g_stop;
+static int g_known;   /* rows are loaded or scanned */
+static int g_kick;    /* a scan is wanted */
+static int g_forced;  /* http_games_refresh() since the last scan start */
+static int g_scanning;
+static uint32_t g_scan;   /* scans started */
+static uint32_t g_done;   /* scans finished */
+static int64_t g_scanned_at;
+static int g_unsaved;
+static pthread_t g_scanner;
+static int g_have_scanner;
+static char g_index_path[256] = HTTP_GAMES_INDEX_PATH;
+
+/*===========================================================================*
+ * ENTRIES
+ *===========================================================================*/
+
+static uint32_t gi_hash(const char *s) {
+  uint32_t h = 2166136261U;
+  while (*s != '\0') {
+    h ^= (uint32_t)(unsigned char)*s++;
+    h *= 16777619U;
+  }
+  return h;
+}
+
+static uint32_t find_locked(const char *path) {
+  uint32_t i = g_buckets[gi_hash(path) % GI_BUCKETS];
+  while ((i != GI_NIL) && (strcmp(g_entries[i].path, path) != 0)) {
+    i = g_entries[i].hnext;
+  }
+  return i;
+}
+
+static void remove_locked(uint32_t i) {
+  gi_entry_t *e = &g_entries[i];
+  uint32_t *link = &g_buckets[gi_hash(e->path) % GI_BUCKETS];
+  while (*link != i) {
+    link = &g_entries[*link].hnext;
+  }
+  *link = e->hnext;
+  free(e->path);
+  free(e->icon);
+  memset(e, 0, sizeof(*e));
+  e->hnext = g_free;
+  g_free = i;
+  g_live--;
+}
+
+/* Least recently used entry that no scan owns, GI_NIL if none */
+static uint32_t victim_locked(void) {
+  uint32_t lru = GI_NIL;
+  for (uint32_t i = 0U; i < g_used; i++) {
+    const gi_entry_t *e = &g_entries[i];
+    if ((e->path != NULL) && (e->base < 0) &&
+        ((lru == GI_NIL) || (e->used < g_entries[lru].used))) {
+      lru = i;
+    }
+  }
+  return lru;
+}
+
+static uint32_t entry_new_locked(const char *path) {
+  if (g_live >= HTTP_GAMES_MAX) {
+    uint32_t v = victim_locked();
+    if (v == GI_NIL) {
+      return GI_NIL;
+    }
+    remove_locked(v);
+  }
+  char *copy = strdup(path);
+  if (copy == NULL) {
+    return GI_NIL;
+  }
+  uint32_t i = g_free;
+  if (i != GI_NIL) {
+    g_free = g_entries[i].hnext;
+  } else {
+    if (g_used == g_cap) {
+      uint32_t cap = (g_cap == 0U) ? 64U : g_cap * 2U;
+      gi_entry_t *grown = realloc(g_entries, (size_t)cap * sizeof(*grown));
+      if (grown == NULL) {
+        free(copy);
+        return GI_NIL;
+      }
+      g_entries = grown;
+      g_cap = cap;
+    }
+    i = g_used++;
+  }
+  gi_entry_t *e = &g_entries[i];
+  memset(e, 0, sizeof(*e));
+  e->path = copy;
+  e->base = -1;
+  uint32_t *bucket = &g_buckets[gi_hash(path) % GI_BUCKETS];
+  e->hnext = *bucket;
+  *bucket = i;
+  g_live++;
+  return i;
+}
+
+static void clean_field(char *s) {
+  for (; *s != '\0'; s++) {
+    if ((unsigned char)*s < 0x20U) {
+      *s = ' ';
+    }
+  }
+}
+
+/* Store a fresh load of @p path; GI_NIL when the index is full */
+static uint32_t put_locked(const char *path, const http_game_meta_t *meta,
+                           const char *icon, uint64_t size, int64_t mtime) {
+  uint32_t i = find_locked(path);
+  if (i == GI_NIL) {
+    i = entry_new_locked(path);
+    if (i == GI_NIL) {
+      return GI_NIL;
+    }
+  }
+  gi_entry_t *e = &g_entries[i];
+  e->meta = *meta;
+  clean_field(e->meta.id);
+  clean_field(e->meta.name);
+  clean_field(e->meta.version);
+  clean_field(e->meta.category);
+  clean_field(e->meta.content_id);
+  free(e->icon);
+  e->icon = ((icon != NULL) && (icon[0] != '\0')) ? strdup(icon) : NULL;
+  e->size = size;
+  e->mtime = mtime;
+  e->used = ++g_clock;
+  g_unsaved = 1;
+  return i;
+}
+
+/*
+ * Stamp of the metadata behind @p path: the first param file of an app
+ * directory (the directory itself if it has none), else the file.
+ */
+static int game_stamp(const char *path, uint64_t *size, int64_t *mtime) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return -1;
+  }
+  if (S_ISDIR(st.st_mode)) {
+    static const char *const params[] = {"sce_sys/param.sfo", "param.sfo",
+                                         "sce_sys/param.json", NULL};
+    char p[FTP_PATH_MAX];
+    for (size_t k = 0U; params[k] != NULL; k++) {
+      int n = snprintf(p, sizeof(p), "%s/%s", path, params[k]);
+      struct stat ps;
+      if ((n > 0) && ((size_t)n < sizeof(p)) && (stat(p, &ps) == 0) &&
+          S_ISREG(ps.st_mode)) {
+        st = ps;
+        break;
+      }
+    }
+  } else if (!S_ISREG(st.st_mode)) {
+    return -1;
+  }
+  *size = (uint64_t)st.st_size;
+  *mtime = (int64_t)st.st_mtime;
+  return 0;
+}
+
+/* An app directory always lists, named after itself when unreadable */
+static void dir_defaults(const char *path, http_game_meta_t *meta) {
+  if (meta->id[0] == '\0') {
+    const char *slash = strrchr(path, '/');
+    (void)snprintf(meta->id, sizeof(meta->id), "%.*s",
+                   (int)(sizeof(meta->id) - 1U),
+                   (slash != NULL) ? slash + 1 : path);
+  }
+  if (meta->name[0] == '\0') {
+    (void)snprintf(meta->name, sizeof(meta->name), "%s", meta->id);
+  }
+}
+
+/*===========================================================================*
+ * ON-DISK INDEX
+ *===========================================================================*/
+
+static void save_locked(void) {
+  g_unsaved = 0;
+  if (g_index_path[0] == '\0') {
+    return;
+  }
+  char tmp[sizeof(g_index_path) + 8U];
+  (void)snprintf(tmp, sizeof(tmp), "%s.tmp", g_index_path);
+  FILE *f = fopen(tmp, "w");
+  if (f == NULL) {
+    return;
+  }
+
+  for (unsigned b = 0U; b < g_nbases; b++) {
+    (void)fprintf(f, "B %u %" PRId64 "\n", b, g_base_mtime[b]);
+  }
+  for (uint32_t i = 0U; i < g_used; i++) {
+    const gi_entry_t *e = &g_entries[i];
+    if ((e->path == NULL) || (strpbrk(e->path, "\t\r\n") != NULL) ||
+        ((e->icon != NULL) && (strpbrk(e->icon, "\t\r\n") != NULL))) {
+      continue;
+    }
+    const http_game_meta_t *m = &e->meta;
+    (void)fprintf(f, "E %d %" PRIu64 " %" PRId64 " %d\t%s\t%s\t%s\t%s\t%s\t%s\t%s\n",
+                  e->base, e->size, e->mtime, m->has_icon, m->id, m->name,
+                  m->version, m->category, m->content_id,
+                  (e->icon != NULL) ? e->icon : "", e->path);
+  }
+
+  if (fclose(f) != 0) {
+    (void)remove(tmp);
+    return;
+  }
+  if (rename(tmp, g_index_path) != 0) {
+    (void)remove(tmp);
+  }
+}
+
+/* Next tab-separated field of @p *s into @p out; -1 at the end of line */
+static int next_field(char **s, char *out, size_t out_size) {
+  if (*s == NULL) {
+    return -1;
+  }
+  char *tab = strchr(*s, '\t');
+  size_t len = (tab != NULL) ? (size_t)(tab - *s) : strlen(*s);
+  (void)snprintf(out, out_size, "%.*s", (int)len, *s);
+  *s = (tab != NULL) ? tab + 1 : NULL;
+  return 0;
+}
+
+static void load_locked(void) {
+  if (g_index_path[0] == '\0') {
+    return;
+  }
+  FILE *f = fopen(g_index_path, "r");
+  if (f == NULL) {
+    return;
+  }
+  size_t cap = (2U * FTP_PATH_MAX) + 1024U;
+  char *line = malloc(cap);
+  char *icon = malloc(FTP_PATH_MAX);
+  if ((line == NULL) || (icon == NULL)) {
+    free(line);
+    free(icon);
+    fclose(f);
+    return;
+  }
+
+  while (fgets(line, (int)cap, f) != NULL) {
+    line[strcspn(line, "\r\n")] = '\0';
+    unsigned b = 0U;
+    long long mtime = 0LL;
+    if (sscanf(line, "B %u %lld", &b, &mtime) == 2) {
+      if (b < g_nbases) {
+        g_base_mtime[b] = (int64_t)mtime;
+        g_known = 1;
+      }
+      continue;
+    }
+
+    int base = -1;
+    unsigned long long size = 0ULL;
+    int has_icon = 0;
+    int consumed = 0;
+    if ((sscanf(line, "E %d %llu %lld %d%n", &base, &size, &mtime, &has_icon,
+                &consumed) != 4) ||
+        (line[consumed] != '\t') || (base >= (int)g_nbases)) {
+      continue;
+    }
+    char *s = line + consumed + 1;
+    http_game_meta_t m;
+    memset(&m, 0, sizeof(m));
+    m.has_icon = (has_icon != 0) ? 1 : 0;
+    if ((next_field(&s, m.id, sizeof(m.id)) != 0) ||
+        (next_field(&s, m.name, sizeof(m.name)) != 0) ||
+        (next_field(&s, m.version, sizeof(m.version)) != 0) ||
+        (next_field(&s, m.category, sizeof(m.category)) != 0) ||
+        (next_field(&s, m.content_id, sizeof(m.content_id)) != 0) ||
+        (next_field(&s, icon, FTP_PATH_MAX) != 0) || (s == NULL) ||
+        (s[0] != '/')) {
+      continue;
+    }
+    uint32_t i = put_locked(s, &m, icon, (uint64_t)size, (int64_t)mtime);
+    if (i == GI_NIL) {
+      break;
+    }
+    g_entries[i].base = (base < 0) ? -1 : base;
+  }
+  free(line);
+  free(icon);
+  fclose(f);
+  g_unsaved = 0;
+}
+
+/*===========================================================================*
+ * SCANNER
+ *===========================================================================*/
+
+/* One title found by a scan: keep it if unchanged, else reload it */
+static void scan_title(unsigned b, const char *path, uint32_t scan) {
+  uint64_t size = 0U;
+  int64_t mtime = 0;
+  if (game_stamp(path, &size, &mtime) != 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  uint32_t i = find_locked(path);
+  if ((i != GI_NIL) && (g_entries[i].size == size) &&
+      (g_entries[i].mtime == mtime)) {
+    if (g_entries[i].base != (int)b) {
+      g_entries[i].base = (int)b;
+      g_unsaved = 1;
+    }
+    g_entries[i].seen = scan;
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  http_game_meta_t m;
+  char icon[FTP_PATH_MAX];
+  memset(&m, 0, sizeof(m));
+  icon[0] = '\0';
+  (void)http_api_load_game(path, &m, icon, sizeof(icon));
+  dir_defaults(path, &m);
+
+  pthread_mutex_lock(&g_lock);
+  i = put_locked(path, &m, icon, size, mtime);
+  if (i != GI_NIL) {
+    g_entries[i].base = (int)b;
+    g_entries[i].seen = scan;
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+static void scan_base(unsigned b, const char *base, uint32_t scan,
+                      char *path, size_t path_size) {
+  struct stat st;
+  int64_t mtime = -1;
+  DIR *d = NULL;
+  if ((stat(base, &st) == 0) && S_ISDIR(st.st_mode)) {
+    mtime = (int64_t)st.st_mtime;
+    d = opendir(base);
+    /* A second change within the same second keeps the mtime */
+    if (mtime >= (int64_t)time(NULL) - 1) {
+      mtime = GI_UNTRUSTED;
+    }
+  }
+  pthread_mutex_lock(&g_lock);
+  g_base_mtime[b] = mtime;
+  pthread_mutex_unlock(&g_lock);
+  if (d == NULL) {
+    return;
+  }
+
+  struct dirent *ent;
+  while ((ent = readdir(d)) != NULL) {
+    if ((strcmp(ent->d_name, ".") == 0) || (strcmp(ent->d_name, "..") == 0)) {
+      continue;
+    }
+    int n = snprintf(path, path_size, "%s/%s", base, ent->d_name);
+    if ((n < 0) || ((size_t)n >= path_size) || (stat(path, &st) != 0) ||
+        !S_ISDIR(st.st_mode)) {
+      continue;
+    }
+    scan_title(b, path, scan);
+    pthread_mutex_lock(&g_lock);
+    int stop = g_stop;
+    pthread_mutex_unlock(&g_lock);
+    if (stop != 0) {
+      break;
+    }
+  }
+  closedir(d);
+}
+
+static void *scanner_main(void *arg) {
+  (void)arg;
+  char path[FTP_PATH_MAX];
+
+  pthread_mutex_lock(&g_lock);
+  while (g_stop == 0) {
+    if (g_kick == 0) {
+      pthread_cond_wait(&g_work_cv, &g_lock);
+      continue;
+    }
+    g_kick = 0;
+    g_forced = 0;
+    g_scanning = 1;
+    uint32_t scan = ++g_scan;
+    pthread_mutex_unlock(&g_lock);
+
+    for (unsigned b = 0U; b < g_nbases; b++) {
+      scan_base(b, g_bases[b], scan, path, sizeof(path));
+    }
+
+    pthread_mutex_lock(&g_lock);
+    if (g_stop == 0) {
+      for (uint32_t i = 0U; i < g_used; i++) {
+        gi_entry_t *e = &g_entries[i];
+        if ((e->path != NULL) && (e->base >= 0) && (e->seen != scan)) {
+          remove_locked(i);
+          g_unsaved = 1;
+        }
+      }
+      g_known = 1;
+      g_scanned_at = (int64_t)time(NULL);
+      if (g_unsaved != 0) {
+        save_locked();
+      }
+    }
+    g_scanning = 0;
+    g_done = scan;
+    pthread_cond_broadcast(&g_done_cv);
+  }
+  pthread_mutex_unlock(&g_lock);
+  return NULL;
+}
+
+static void start_locked(void) {
+  if (g_started != 0) {
+    return;
+  }
+  g_started = 1;
+  g_stop = 0;
+  for (unsigned k = 0U; k < GI_BUCKETS; k++) {
+    g_buckets[k] = GI_NIL;
+  }
+  g_nbases = 0U;
+  while ((g_nbases < GI_MAX_BASES) && (g_bases[g_nbases] != NULL)) {
+    g_base_mtime[g_nbases++] = -1;
+  }
+  load_locked();
+
+  pthread_attr_t attr;
+  int have_attr = (pthread_attr_init(&attr) == 0) ? 1 : 0;
+  if (have_attr != 0) {
+    (void)pthread_attr_setstacksize(&attr, 65536U + (4U * FTP_PATH_MAX));
+  }
+  if (pal_thread_create(&g_scanner, (have_attr != 0) ? &attr : NULL,
+                        PAL_THREAD_BACKGROUND, scanner_main, NULL) == 0) {
+    g_have_scanner = 1;
+  }
+  if (have_attr != 0) {
+    (void)pthread_attr_destroy(&attr);
+  }
+}
+
+/* A scan already running may have read a base before the change */
+static void kick_locked(void) {
+  g_kick = 1;
+  pthread_cond_signal(&g_work_cv);
+}
+
+/* Wait for a scan started after this call, at most HTTP_GAMES_WAIT_MS */
+static void wait_scan_locked(void) {
+  if (g_have_scanner == 0) {
+    return;
+  }
+  uint32_t want = g_scan + 1U;
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  struct timespec deadline;
+  uint64_t ns = ((uint64_t)tv.tv_usec * 1000U) +
+                ((uint64_t)HTTP_GAMES_WAIT_MS * 1000000U);
+  deadline.tv_sec = tv.tv_sec + (time_t)(ns / 1000000000U);
+  deadline.tv_nsec = (long)(ns % 1000000000U);
+  while (((int32_t)(g_done - want) < 0) && (g_stop == 0)) {
+    if (pthread_cond_timedwait(&g_done_cv, &g_lock, &deadline) ==
+        ETIMEDOUT) {
+      break;
+    }
+  }
+}
+
+void http_games_shutdown(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_started == 0) {
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+  g_stop = 1;
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_cond_broadcast(&g_done_cv);
+  pthread_mutex_unlock(&g_lock);
+
+  if (g_have_scanner != 0) {
+    (void)pthread_join(g_scanner, NULL);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (g_unsaved != 0) {
+    save_locked();
+  }
+  for (uint32_t i = 0U; i < g_used; i++) {
+    free(g_entries[i].path);
+    free(g_entries[i].icon);
+  }
+  free(g_entries);
+  g_entries = NULL;
+  g_cap = g_used = g_live = 0U;
+  g_free = GI_NIL;
+  g_clock = 0U;
+  g_known = g_kick = g_forced = g_scanning = 0;
+  g_scan = g_done = 0U;
+  g_scanned_at = 0;
+  g_unsaved = 0;
+  g_have_scanner = 0;
+  g_started = 0;
+  pthread_mutex_unlock(&g_lock);
+}
+
+void http_games_reset(const char *index_path, const char *const *bases) {
+  http_games_shutdown();
+  pthread_mutex_lock(&g_lock);
+  const char *p = (index_path != NULL) ? index_path : HTTP_GAMES_INDEX_PATH;
+  (void)snprintf(g_index_path, sizeof(g_index_path), "%s", p);
+  g_bases = (bases != NULL) ? bases : k_default_bases;
+  pthread_mutex_unlock(&g_lock);
+}
+
+/*===========================================================================*
+ * QUERIES
+ *===========================================================================*/
+
+int http_games_meta(const char *path, http_game_meta_t *out, char *icon,
+                    size_t icon_size) {
+  uint64_t size = 0U;
+  int64_t mtime = 0;
+  if ((path == NULL) || (out == NULL) || (path[0] != '/') ||
+      (strlen(path) >= FTP_PATH_MAX) ||
+      (game_stamp(path, &size, &mtime) != 0)) {
+    return -1;
+  }
+  if ((icon != NULL) && (icon_size > 0U)) {
+    icon[0] = '\0';
+  }
+
+  pthread_mutex_lock(&g_lock);
+  start_locked();
+  uint32_t i = find_locked(path);
+  if ((i != GI_NIL) && (g_entries[i].size == size) &&
+      (g_entries[i].mtime == mtime)) {
+    gi_entry_t *e = &g_entries[i];
+    e->used = ++g_clock;
+    *out = e->meta;
+    if ((icon != NULL) && (icon_size > 0U) && (e->icon != NULL)) {
+      (void)snprintf(icon, icon_size, "%s", e->icon);
+    }
+    pthread_mutex_unlock(&g_lock);
+    return 0;
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  http_game_meta_t m;
+  char found[FTP_PATH_MAX];
+  memset(&m, 0, sizeof(m));
+  found[0] = '\0';
+  if (http_api_load_game(path, &m, found, sizeof(found)) != 0) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  (void)put_locked(path, &m, found, size, mtime);
+  pthread_mutex_unlock(&g_lock);
+
+  *out = m;
+  if ((icon != NULL) && (icon_size > 0U)) {
+    (void)snprintf(icon, icon_size, "%s", found);
+  }
+  return 0;
+}
+
+static int row_cmp(const void *a, const void *b) {
+  const gi_entry_t *x = &g_entries[*(const uint32_t *)a];
+  const gi_entry_t *y = &g_entries[*(const uint32_t *)b];
+  if (x->base != y->base) {
+    return (x->base < y->base) ? -1 : 1;
+  }
+  return strcmp(x->path, y->path);
+}
+
+/* A base directory gained or lost entries since the last scan */
+static int bases_changed_locked(void) {
+  for (unsigned b = 0U; b < g_nbases; b++) {
+    struct stat st;
+    int64_t mtime = ((stat(g_bases[b], &st) == 0) && S_ISDIR(st.st_mode))
+                        ? (int64_t)st.st_mtime
+                        : -1;
+    if (mtime != g_base_mtime[b]) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+http_game_row_t *http_games_installed(size_t *count) {
+  if (count == NULL) {
+    return NULL;
+  }
+  *count = 0U;
+
+  pthread_mutex_lock(&g_lock);
+  start_locked();
+  int need = ((g_known == 0) || (g_forced != 0) ||
+              (bases_changed_locked() != 0))
+                 ? 1
+                 : 0;
+  if ((need != 0) ||
+      ((g_scanning == 0) &&
+       ((int64_t)time(NULL) - g_scanned_at >= HTTP_GAMES_FRESH_S))) {
+    kick_locked();
+  }
+  if (need != 0) {
+    wait_scan_locked();
+  }
+
+  uint32_t n = 0U;
+  size_t strings = 0U;
+  uint32_t *order = malloc(((size_t)g_live + 1U) * sizeof(*order));
+  if (order == NULL) {
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+  }
+  for (uint32_t i = 0U; i < g_used; i++) {
+    const gi_entry_t *e = &g_entries[i];
+    if ((e->path != NULL) && (e->base >= 0)) {
+      order[n++] = i;
+      strings += strlen(e->path) + strlen(g_bases[e->base]) + 2U;
+    }
+  }
+  if (n == 0U) {
+    free(order);
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+  }
+  qsort(order, n, sizeof(*order), row_cmp);
+
+  http_game_row_t *rows = malloc(((size_t)n * sizeof(*rows)) + strings);
+  if (rows != NULL) {
+    char *s = (char *)(rows + n);
+    for (uint32_t k = 0U; k < n; k++) {
+      const gi_entry_t *e = &g_entries[order[k]];
+      size_t plen = strlen(e->path) + 1U;
+      size_t blen = strlen(g_bases[e->base]) + 1U;
+      rows[k].meta = e->meta;
+      rows[k].path = s;
+      memcpy(s, e->path, plen);
+      s += plen;
+      rows[k].source = s;
+      memcpy(s, g_bases[e->base], blen);
+      s += blen;
+    }
+    *count = n;
+  }
+  pthread_mutex_unlock(&g_lock);
+  free(order);
+  return rows;
+}
+
+int http_games_find(const char *title_id, char *out, size_t out_size) {
+  if ((title_id == NULL) || (title_id[0] == '\0') || (out == NULL) ||
+      (out_size == 0U)) {
+    return -1;
+  }
+  int rc = -1;
+  pthread_mutex_lock(&g_lock);
+  start_locked();
+  for (uint32_t i = 0U; i < g_used; i++) {
+    const gi_entry_t *e = &g_entries[i];
+    if ((e->path != NULL) && (e->base >= 0) &&
+        (strcmp(e->meta.id, title_id) == 0)) {
+      int n = snprintf(out, out_size, "%s", e->path);
+      rc = ((n > 0) && ((size_t)n < out_size)) ? 0 : -1;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+  return rc;
+}
+
+void http_games_refresh(void) {
+  pthread_mutex_lock(&g_lock);
+  start_locked();
+  g_forced = 1;
+  kick_locked();
+  pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,256 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+/**
+ * @file http_json.c
+ * @brief Streaming JSON writer
+ */
+
+#include "http_json.h"
+#include "http_config.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#if HTTP_JSON_SIMD && (defined(__x86_64__) || defined(__i386__)) &&          \
+    defined(__SSE2__)
+#define JSON_HAVE_SSE2 1
+#include <emmintrin.h>
+#else
+#define JSON_HAVE_SSE2 0
+#endif
+
+#if HTTP_JSON_SIMD && defined(__aarch64__) && defined(__ARM_NEON)
+#define JSON_HAVE_NEON 1
+#include <arm_neon.h>
+#else
+#define JSON_HAVE_NEON 0
+#endif
+
+/*===========================================================================*
+ * ESCAPER
+ *
+ *   k_esc[c] == 0    copy c
+ *   k_esc[c] == 'u'  \u00XX
+ *   otherwise        backslash + k_esc[c]
+ *===========================================================================*/
+
+static const uint8_t k_esc[256] = {
+    /* 0x00 */ 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    /* 0x08 */ 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    /* 0x10 */ 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    /* 0x18 */ 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    ['"'] = '"',
+    ['\\'] = '\\',
+};
+
+/* Length of the leading run of @p s that needs no escaping */
+static size_t plain_run(const char *s, size_t len) {
+  size_t i = 0U;
+#if JSON_HAVE_SSE2
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i slash = _mm_set1_epi8('\\');
+  const __m128i ctl = _mm_set1_epi8(0x1F);
+  for (; i + 16U <= len; i += 16U) {
+    __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(s + i));
+    __m128i hit = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)),
+        _mm_cmpeq_epi8(_mm_max_epu8(v, ctl), ctl)); /* v <= 0x1F */
+    unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+    if (mask != 0U) {
+      return i + (size_t)__builtin_ctz(mask);
+    }
+  }
+#elif JSON_HAVE_NEON
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t slash = vdupq_n_u8('\\');
+  const uint8x16_t ctl = vdupq_n_u8(0x1F);
+  for (; i + 16U <= len; i += 16U) {
+    uint8x16_t v = vld1q_u8((const uint8_t *)s + i);
+    uint8x16_t hit = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, slash)),
+                              vcleq_u8(v, ctl));
+    if (vmaxvq_u8(hit) != 0U) {
+      break; /* the table finds the exact byte */
+    }
+  }
+#endif
+  while ((i < len) && (k_esc[(unsigned char)s[i]] == 0U)) {
+    i++;
+  }
+  return i;
+}
+
+size_t http_json_escape(char *dst, size_t cap, const char *s, size_t len) {
+  static const char k_hex[] = "0123456789abcdef";
+  size_t out = 0U;
+  size_t i = 0U;
+  while (i < len) {
+    size_t run = plain_run(s + i, len - i);
+    if (run > cap - out) {
+      return (size_t)-1;
+    }
+    memcpy(dst + out, s + i, run);
+    out += run;
+    i += run;
+    if (i == len) {
+      break;
+    }
+    unsigned char c = (unsigned char)s[i++];
+    uint8_t e = k_esc[c];
+    if (e == (uint8_t)'u') {
+      if (cap - out < 6U) {
+        return (size_t)-1;
+      }
+      memcpy(dst + out, "\\u00", 4U);
+      dst[out + 4U] = k_hex[c >> 4];
+      dst[out + 5U] = k_hex[c & 0x0FU];
+      out += 6U;
+    } else {
+      if (cap - out < 2U) {
+        return (size_t)-1;
+      }
+      dst[out] = '\\';
+      dst[out + 1U] = (char)e;
+      out += 2U;
+    }
+  }
+  return out;
+}
+
+/*===========================================================================*
+ * WRITER
+ *===========================================================================*/
+
+static void put(http_json_t *w, const char *data, size_t len) {
+  if ((w->overflow != 0) || (len > w->cap - w->pos)) {
+    w->overflow = 1;
+    return;
+  }
+  memcpy(w->buf + w->pos, data, len);
+  w->pos += len;
+}
+
+/* Comma before the second and later values at the current depth */
+static void separate(http_json_t *w) {
+  if (w->after_key != 0) {
+    w->after_key = 0;
+    return;
+  }
+  if (w->depth == 0U) {
+    return;
+  }
+  uint32_t bit = 1U << (w->depth - 1U);
+  if ((w->fresh & bit) != 0U) {
+    w->fresh &= ~bit;
+  } else {
+    put(w, ",", 1U);
+  }
+}
+
+static void open_scope(http_json_t *w, char c) {
+  separate(w);
+  put(w, &c, 1U);
+  if (w->depth >= HTTP_JSON_MAX_DEPTH) {
+    w->overflow = 1;
+    return;
+  }
+  w->fresh |= 1U << w->depth;
+  w->depth++;
+}
+
+static void close_scope(http_json_t *w, char c) {
+  if (w->depth > 0U) {
+    w->depth--;
+    w->fresh &= ~(1U << w->depth);
+  }
+  put(w, &c, 1U);
+}
+
+void http_json_init(http_json_t *w) {
+  memset(w, 0, sizeof(*w));
+}
+
+void http_json_attach(http_json_t *w, char *buf, size_t cap) {
+  w->buf = buf;
+  w->cap = (buf != NULL) ? cap : 0U;
+  w->pos = 0U;
+  w->overflow = 0;
+}
+
+void http_json_object_begin(http_json_t *w) { open_scope(w, '{'); }
+void http_json_object_end(http_json_t *w) { close_scope(w, '}'); }
+void http_json_array_begin(http_json_t *w) { open_scope(w, '['); }
+void http_json_array_end(http_json_t *w) { close_scope(w, ']'); }
+
+static void quoted(http_json_t *w, const char *s) {
+  put(w, "\"", 1U);
+  if (w->overflow == 0) {
+    size_t n = http_json_escape(w->buf + w->pos, w->cap - w->pos, s,
+                                strlen(s));
+    if (n == (size_t)-1) {
+      w->overflow = 1;
+      return;
+    }
+    w->pos += n;
+  }
+  put(w, "\"", 1U);
+}
+
+void http_json_key(http_json_t *w, const char *key) {
+  separate(w);
+  quoted(w, key);
+  put(w, ":", 1U);
+  w->after_key = 1;
+}
+
+void http_json_string(http_json_t *w, const char *s) {
+  separate(w);
+  quoted(w, (s != NULL) ? s : "");
+}
+
+void http_json_raw(http_json_t *w, const char *text, size_t len) {
+  separate(w);
+  put(w, text, len);
+}
+
+void http_json_u64(http_json_t *w, uint64_t v) {
+  char tmp[24];
+  int n = snprintf(tmp, sizeof(tmp), "%" PRIu64, v);
+  http_json_raw(w, tmp, (size_t)n);
+}
+
+void http_json_i64(http_json_t *w, int64_t v) {
+  char tmp[24];
+  int n = snprintf(tmp, sizeof(tmp), "%" PRId64, v);
+  http_json_raw(w, tmp, (size_t)n);
+}
+
+void http_json_bool(http_json_t *w, int v) {
+  if (v != 0) {
+    http_json_raw(w, "true", 4U);
+  } else {
+    http_json_raw(w, "false", 5U);
+  }
+}
+
+void http_json_null(http_json_t *w) { http_json_raw(w, "null", 4U); }
@@ -39,6 +39,7 @@ SOFTWARE.
 #include <ctype.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 
 /*===========================================================================*
  *  HELPERS
@@ -274,3 +275,269 @@ const char *http_get_header(const http_request_t *request, const char *name) {
 
   return NULL;
 }
+
+/*===========================================================================*
+ *  RANGE HEADER
+ *
+ *   bytes=0-499          first 500 bytes
+ *   bytes=500-           from offset 500 to the end
+ *   bytes=-500           last 500 bytes
+ *   bytes=0-99,100-199   merged into 0-199 (see http_parse_range())
+ *===========================================================================*/
+
+/**
+ * @brief Parse a decimal uint64_t, rejecting overflow
+ * @return Pointer past the digits, or NULL if there are none / overflow
+ */
+static const char *parse_u64(const char *p, uint64_t *out) {
+  uint64_t v = 0U;
+  const char *start = p;
+  while ((*p >= '0') && (*p <= '9')) {
+    uint64_t d = (uint64_t)(*p - '0');
+    if (v > (UINT64_MAX - d) / 10U) {
+      return NULL;
+    }
+    v = (v * 10U) + d;
+    p++;
+  }
+  if (p == start) {
+    return NULL;
+  }
+  *out = v;
+  return p;
+}
+
+static const char *skip_ows(const char *p) {
+  while ((*p == ' ') || (*p == '\t')) {
+    p++;
+  }
+  return p;
+}
+
+/**
+ * @brief Resolve a Range header value against a resource of `size` bytes
+ *
+ * Several ranges are served as their bounding span when the gaps between
+ * them add up to at most HTTP_RANGE_COALESCE_GAP bytes; otherwise the
+ * header is ignored and the caller sends the whole resource, which the
+ * RFC allows.  Unsatisfiable specs inside a list are skipped.
+ *
+ * @param value  Header value, e.g. "bytes=100-"
+ * @param size   Resource length in bytes
+ * @param start  [out] First byte to send
+ * @param len    [out] Number of bytes to send
+ *
+ * @return 1 for a satisfiable range (206), 0 to ignore the header (200),
+ *         -1 when no spec is satisfiable (416)
+ */
+int http_parse_range(const char *value, uint64_t size, uint64_t *start,
+                     uint64_t *len) {
+  if ((value == NULL) || (start == NULL) || (len == NULL)) {
+    return 0;
+  }
+
+  const char *p = skip_ows(value);
+  if (strncasecmp(p, "bytes=", 6) != 0) {
+    return 0; /* unknown unit */
+  }
+  p += 6;
+
+  uint64_t lo = UINT64_MAX;
+  uint64_t hi = 0U;      /* exclusive */
+  uint64_t covered = 0U; /* sum of spec lengths, overlaps counted twice */
+  size_t specs = 0U;
+  size_t satisfiable = 0U;
+
+  for (;;) {
+    p = skip_ows(p);
+    uint64_t first = 0U;
+    uint64_t last = 0U;
+    int ok = 0;
+
+    if (*p == '-') {
+      /* suffix-byte-range-spec */
+      uint64_t n = 0U;
+      p = parse_u64(p + 1, &n);
+      if (p == NULL) {
+        return 0;
+      }
+      if ((n > 0U) && (size > 0U)) {
+        first = (n < size) ? (size - n) : 0U;
+        last = size - 1U;
+        ok = 1;
+      }
+    } else {
+      p = parse_u64(p, &first);
+      if ((p == NULL) || (*p != '-')) {
+        return 0;
+      }
+      p++;
+      last = UINT64_MAX;
+      if ((*p >= '0') && (*p <= '9')) {
+        p = parse_u64(p, &last);
+        if ((p == NULL) || (last < first)) {
+          return 0;
+        }
+      }
+      if (first < size) {
+        if (last >= size) {
+          last = size - 1U;
+        }
+        ok = 1;
+      }
+    }
+
+    specs++;
+    if (ok) {
+      satisfiable++;
+      if (first < lo) {
+        lo = first;
+      }
+      if (last + 1U > hi) {
+        hi = last + 1U;
+      }
+      uint64_t n = (last - first) + 1U;
+      covered = (covered > UINT64_MAX - n) ? UINT64_MAX : covered + n;
+    }
+
+    p = skip_ows(p);
+    if (*p == '\0') {
+      break;
+    }
+    if (*p != ',') {
+      return 0;
+    }
+    p++;
+  }
+
+  if (satisfiable == 0U) {
+    return (specs > 0U) ? -1 : 0;
+  }
+  if ((satisfiable > 1U) && (covered < hi - lo) &&
+      ((hi - lo) - covered > (uint64_t)HTTP_RANGE_COALESCE_GAP)) {
+    return 0;
+  }
+
+  *start = lo;
+  *len = hi - lo;
+  return 1;
+}
+
+/*===========================================================================*
+ *  CONTENT NEGOTIATION / CONDITIONAL REQUESTS
+ *===========================================================================*/
+
+/**
+ * @brief Check whether an Accept-Encoding value allows `coding`
+ *
+ * "gzip, br;q=0.8" allows both; "br;q=0" and absent entries do not.
+ * A "*" entry allows any coding not listed explicitly.
+ *
+ * @return 1 if the client accepts the coding, 0 otherwise
+ */
+int http_accepts_encoding(const char *value, const char *coding) {
+  if ((value == NULL) || (coding == NULL)) {
+    return 0;
+  }
+
+  size_t coding_len = strlen(coding);
+  int wildcard = 0;
+  const char *p = value;
+  while (*p != '\0') {
+    p = skip_ows(p);
+    const char *tok = p;
+    while ((*p != '\0') && (*p != ',') && (*p != ';') && (*p != ' ') &&
+           (*p != '\t')) {
+      p++;
+    }
+    size_t tok_len = (size_t)(p - tok);
+
+    /* Parameters: only q matters; q=0 (0, 0.0, 0.000) refuses */
+    int refused = 0;
+    while ((*p != '\0') && (*p != ',')) {
+      p = skip_ows(p);
+      if (*p == ';') {
+        p = skip_ows(p + 1);
+        if (((p[0] == 'q') || (p[0] == 'Q')) && (p[1] == '=')) {
+          const char *q = p + 2;
+          if (*q == '0') {
+            q++;
+            if (*q == '.') {
+              q++;
+              while (*q == '0') {
+                q++;
+              }
+            }
+            refused = ((*q < '0') || (*q > '9')) ? 1 : 0;
+          }
+        }
+      }
+      if ((*p != '\0') && (*p != ',')) {
+        p++;
+      }
+    }
+
+    if ((tok_len == coding_len) && (strncasecmp(tok, coding, tok_len) == 0)) {
+      return refused ? 0 : 1;
+    }
+    if ((tok_len == 1U) && (tok[0] == '*')) {
+      wildcard = refused ? 0 : 1;
+    }
+    if (*p == ',') {
+      p++;
+    }
+  }
+  return wildcard;
+}
+
+/**
+ * @brief Weak comparison of an If-None-Match list against one ETag
+ *
+ * @param value  Header value: "*" or a comma-separated list of entity
+ *               tags, each optionally prefixed with W/
+ * @param etag   Quoted ETag the response would carry
+ *
+ * @return 1 on match (answer 304), 0 otherwise
+ */
+int http_etag_match(const char *value, const char *etag) {
+  if ((value == NULL) || (etag == NULL)) {
+    return 0;
+  }
+
+  const char *want = etag;
+  if (strncmp(want, "W/", 2) == 0) {
+    want += 2;
+  }
+  size_t want_len = strlen(want);
+
+  const char *p = skip_ows(value);
+  if ((p[0] == '*') && (*skip_ows(p + 1) == '\0')) {
+    return 1;
+  }
+  while (*p != '\0') {
+    p = skip_ows(p);
+    if (strncmp(p, "W/", 2) == 0) {
+      p += 2;
+    }
+    const char *tok = p;
+    if (*p == '"') {
+      p++;
+      while ((*p != '\0') && (*p != '"')) {
+        p++;
+      }
+      if (*p == '"') {
+        p++;
+      }
+    }
+    if (((size_t)(p - tok) == want_len) && (strncmp(tok, want, want_len) == 0)) {
+      return 1;
+    }
+    while ((*p != '\0') && (*p != ',')) {
+      p++;
+    }
+    if (*p == ',') {
+      p++;
+    }
+  }
+  return 0;
+}
@@ -28,14 +28,21 @@ SOFTWARE.
 
 #include "http_response.h"
 #include "http_config.h"
+#include "pal_filesystem.h"
 #include <dirent.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 
 static http_response_t g_response_pool[HTTP_MAX_CONNECTIONS];
 static unsigned char g_response_in_use[HTTP_MAX_CONNECTIONS];
+/* Worker-pool threads create and destroy responses too */
+static pthread_mutex_t g_response_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int ensure_space(http_response_t *resp, size_t extra);
 
 /*===========================================================================*
  * STATUS CODE → TEXT MAPPING
@@ -50,6 +57,8 @@ static const char *status_text(http_status_t status) {
     return "Created";
   case HTTP_STATUS_204_NO_CONTENT:
     return "No Content";
+  case HTTP_STATUS_206_PARTIAL_CONTENT:
+    return "Partial Content";
   /* 3xx */
   case HTTP_STATUS_301_MOVED:
     return "Moved Permanently";
@@ -66,9 +75,13 @@ static const char *status_text(http_status_t status) {
     return "Method Not Allowed";
   case HTTP_STATUS_409_CONFLICT:
     return "Conflict";
+  case HTTP_STATUS_416_RANGE_NOT_SATISFIABLE:
+    return "Range Not Satisfiable";
   /* 5xx */
   case HTTP_STATUS_500_INTERNAL_ERROR:
     return "Internal Server Error";
+  case HTTP_STATUS_503_SERVICE_UNAVAILABLE:
+    return "Service Unavailable";
   default:
     return "Unknown";
   }
@@ -78,8 +91,30 @@ static const char *status_text(http_status_t status) {
  * CREATE / DESTROY
  *===========================================================================*/
 
+/*
+ * Headers every response carries, prebuilt once instead of formatted
+ * header by header.  Cache-Control may be replaced afterwards with
+ * http_response_set_header().
+ */
+static const char k_default_headers[] =
+    "X-Content-Type-Options: nosniff\r\n"
+    "X-Frame-Options: DENY\r\n"
+    "Referrer-Policy: no-referrer\r\n"
+    "Cache-Control: no-store\r\n"
+    "Content-Security-Policy: "
+    "default-src 'self'; "
+    "connect-src *; "
+    "img-src 'self' data: blob:; "
+    "style-src 'self' 'unsafe-inline' https://fonts.googleapis.com; "
+    "style-src-elem 'self' 'unsafe-inline' https://fonts.googleapis.com; "
+    "font-src 'self' data: https://fonts.gstatic.com; "
+    "script-src 'self' 'unsafe-inline' blob:; "
+    "script-src-elem 'self' 'unsafe-inline' blob:; "
+    "object-src 'none'; base-uri 'none'; frame-ancestors 'none'\r\n";
+
 http_response_t *http_response_create(http_status_t status) {
   http_response_t *resp = NULL;
+  (void)pthread_mutex_lock(&g_response_lock);
   for (size_t i = 0; i < (size_t)HTTP_MAX_CONNECTIONS; i++) {
     if (g_response_in_use[i] == 0U) {
       g_response_in_use[i] = 1U;
@@ -87,6 +122,7 @@ http_response_t *http_response_create(http_status_t status) {
       break;
     }
   }
+  (void)pthread_mutex_unlock(&g_response_lock);
   if (resp == NULL) {
     return NULL;
   }
@@ -109,25 +145,13 @@ http_response_t *http_response_create(http_status_t status) {
     return NULL;
   }
 
-  if (http_response_add_header(resp, "X-Content-Type-Options", "nosniff") !=
-          0 ||
-      http_response_add_header(resp, "X-Frame-Options", "DENY") != 0 ||
-      http_response_add_header(resp, "Referrer-Policy", "no-referrer") != 0 ||
-      http_response_add_header(resp, "Cache-Control", "no-store") != 0 ||
-      http_response_add_header(resp, "Content-Security-Policy",
-                               "default-src 'self'; "
-                               "connect-src *; "
-                               "img-src 'self' data: blob:; "
-                               "style-src 'self' 'unsafe-inline' https://fonts.googleapis.com; "
-                               "style-src-elem 'self' 'unsafe-inline' https://fonts.googleapis.com; "
-                               "font-src 'self' data: https://fonts.gstatic.com; "
-                               "script-src 'self' 'unsafe-inline' blob:; "
-                               "script-src-elem 'self' 'unsafe-inline' blob:; "
-                               "object-src 'none'; base-uri 'none'; frame-ancestors 'none'") !=
-          0) {
+  if (ensure_space(resp, sizeof(k_default_headers) - 1U) < 0) {
     http_response_destroy(resp);
     return NULL;
   }
+  memcpy(resp->data + resp->used, k_default_headers,
+         sizeof(k_default_headers) - 1U);
+  resp->used += sizeof(k_default_headers) - 1U;
 
   return resp;
 }
@@ -141,10 +165,21 @@ void http_response_destroy(http_response_t *resp) {
     close(resp->sendfile_fd);
     resp->sendfile_fd = -1;
   }
+  if (resp->sendfile_node != NULL) {
+    vfs_close(resp->sendfile_node);
+    free(resp->sendfile_node);
+    resp->sendfile_node = NULL;
+  }
   if (resp->stream_dir != NULL) {
     closedir((DIR *)resp->stream_dir);
     resp->stream_dir = NULL;
   }
+  if (resp->stream_free != NULL) {
+    resp->stream_free(resp->stream_ctx);
+  }
+  resp->stream_fill = NULL;
+  resp->stream_free = NULL;
+  resp->stream_ctx = NULL;
   if (resp->mem_body_owned && resp->mem_body != NULL) {
     void *tmp;
     memcpy(&tmp, &resp->mem_body, sizeof(tmp));
@@ -156,7 +191,9 @@ void http_response_destroy(http_response_t *resp) {
   if ((resp >= &g_response_pool[0]) &&
       (resp < &g_response_pool[HTTP_MAX_CONNECTIONS])) {
     size_t idx = (size_t)(resp - &g_response_pool[0]);
+    (void)pthread_mutex_lock(&g_response_lock);
     g_response_in_use[idx] = 0U;
+    (void)pthread_mutex_unlock(&g_response_lock);
   }
 }
 
@@ -202,6 +239,74 @@ int http_response_add_header(http_response_t *resp, const char *name,
   return 0;
 }
 
+/**
+ * Replace the value of a header added earlier (e.g. one of the defaults
+ * from http_response_create()), or append it if absent.  Only valid
+ * before the header block is terminated.
+ */
+int http_response_set_header(http_response_t *resp, const char *name,
+                             const char *value) {
+  if (resp == NULL || name == NULL || value == NULL) {
+    return -1;
+  }
+
+  size_t name_len = strlen(name);
+  char *line = memchr(resp->data, '\n', resp->used); /* skip status line */
+  char *end = resp->data + resp->used;
+  while ((line != NULL) && (line + 1 < end)) {
+    line++;
+    char *eol = memchr(line, '\n', (size_t)(end - line));
+    if (eol == NULL) {
+      break;
+    }
+    if (((size_t)(eol - line) > name_len) && (line[name_len] == ':') &&
+        (strncasecmp(line, name, name_len) == 0)) {
+      /* Drop the old line, then append the new one */
+      size_t old_len = (size_t)(eol + 1 - line);
+      memmove(line, eol + 1, (size_t)(end - (eol + 1)));
+      resp->used -= old_len;
+      break;
+    }
+    line = eol;
+  }
+
+  return http_response_add_header(resp, name, value);
+}
+
+/**
+ * Whether the client can find the end of this response without the
+ * connection closing: a Content-Length, chunked encoding, or a status
+ * that never has a body.  Only such responses allow keep-alive.
+ */
+int http_response_is_framed(const http_response_t *resp) {
+  if ((resp == NULL) || (resp->used < 12U)) {
+    return 0;
+  }
+  if ((strncmp(resp->data + 9, "204", 3) == 0) ||
+      (strncmp(resp->data + 9, "304", 3) == 0)) {
+    return 1;
+  }
+
+  const char *line = memchr(resp->data, '\n', resp->used);
+  const char *end = resp->data + resp->used;
+  while ((line != NULL) && (line + 1 < end)) {
+    line++;
+    size_t left = (size_t)(end - line);
+    if ((left >= 2U) && (line[0] == '\r') && (line[1] == '\n')) {
+      break; /* end of headers */
+    }
+    if ((left > 15U) && (strncasecmp(line, "Content-Length:", 15) == 0)) {
+      return 1;
+    }
+    if ((left > 26U) &&
+        (strncasecmp(line, "Transfer-Encoding: chunked", 26) == 0)) {
+      return 1;
+    }
+    line = memchr(line, '\n', left);
+  }
+  return 0;
+}
+
 /*===========================================================================*
  * BODY
  *===========================================================================*/
@@ -322,6 +427,22 @@ int http_response_set_body_ref(http_response_t *resp, const void *body,
   return 0;
 }
 
+int http_response_set_body_stream(http_response_t *resp,
+                                  http_stream_fill_t fill,
+                                  void (*release)(void *ctx), void *ctx) {
+  if ((resp == NULL) || (fill == NULL) || (resp->stream_fill != NULL)) {
+    return -1;
+  }
+  if ((http_response_add_header(resp, "Transfer-Encoding", "chunked") != 0) ||
+      (http_response_finalize(resp) != 0)) {
+    return -1;
+  }
+  resp->stream_fill = fill;
+  resp->stream_free = release;
+  resp->stream_ctx = ctx;
+  return 0;
+}
+
 static int size_add_checked(size_t a, size_t b, size_t *out) {
   if (out == NULL) {
     return -1;
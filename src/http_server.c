@@ -45,29 +45,61 @@ SOFTWARE.
  *   │      ▼                     │
  *   │  close or keep-alive       │
  *   └────────────────────────────┘
+ *
+ * Routes flagged by http_api_is_offloadable() leave the loop after
+ * parsing: the client fd is unregistered, a worker thread runs the
+ * handler, and the finished http_response_t comes back through a pipe
+ * that the loop watches.  The loop then sends it and either closes the
+ * client or re-registers it, so a long tree scan never stalls other
+ * connections.
+ *
+ * HTTP/1.1 connections are persistent.  Requests are framed out of
+ * conn->buffer one at a time, so pipelined requests already sitting
+ * behind the current one are answered in order without another read().
+ * Only responses with a known length (Content-Length, chunked, or no
+ * body) leave the connection open; idle ones are reaped after
+ * HTTP_KEEPALIVE_TIMEOUT seconds.
+ *
+ * A download's file body is not sent in one go: after the headers the
+ * connection is handed to the download pump, which sends a fair quantum
+ * per writable wakeup and parks on EVENT_WRITE at EAGAIN, so parallel
+ * downloads and API calls interleave on the one loop thread.
+ *
+ * GET /api/events turns the connection into a Server-Sent Events
+ * subscriber.  From the loop tick, http_events_push() renders each topic
+ * (copy, extract, downloads, ftp) once and sends it only to streams that
+ * have not seen that exact frame, replacing the UI's progress polls.
  */
 
 #include "http_server.h"
 #include "ftp_config.h"
+#include "ftp_list.h"
 #include "http_api.h"
 #include "http_config.h"
+#include "http_games.h"
+#include "http_sysmon.h"
 #if ENABLE_WEB_UPLOAD
 #include "http_csrf.h"
+#include "http_upload.h"
 #endif
 #include "http_parser.h"
 #include "http_response.h"
 #include "pal_fileio.h"
 #include "pal_network.h"
+#include "pal_scratch.h"
+#include "pal_thread.h"
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h> /* TCP_NODELAY */
+#include <pthread.h>
 #include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -82,6 +114,7 @@ struct http_server {
   int listen_fd;
   uint16_t port;
   atomic_int connection_count;  /* Phase 4: thread-safe counter */
+  atomic_int release_listener;  /* hand-off: close listen_fd on the tick */
   char root_path[FTP_PATH_MAX]; /* filesystem confinement root */
 };
 
@@ -90,29 +123,32 @@ typedef struct {
   int fd;
   char buffer[HTTP_REQUEST_BUFFER_SIZE];
   size_t buffer_used;
+  size_t request_len; /* bytes of buffer taken by the request in progress */
+  int keep_alive;     /* reuse the connection after this response */
+  int offloaded;      /* a worker owns the request; the reaper skips it */
+  time_t last_active; /* last read or completed response */
+  int sse;            /* /api/events subscriber; never reads a request */
+  /*
+   * File body still being sent.  While set the socket is non-blocking
+   * and watched for EVENT_WRITE only; http_download_resume() moves up
+   * to HTTP_DOWNLOAD_QUANTUM bytes per wakeup.
+   */
+  http_response_t *download;
+  int download_framed;
+  uint8_t *dl_buf; /* PATH B: bytes read ahead of the socket */
+  size_t dl_cap;
+  size_t dl_len;
+  size_t dl_sent;
+  uint32_t sse_hash[HTTP_EVENT_TOPICS]; /* last frame pushed per topic */
 #if ENABLE_WEB_UPLOAD
-  int upload_active;
-  int upload_fd;
-  size_t upload_remaining;
   /*
-   * @field upload_chunk_buf
-   * Heap-allocated read buffer for streaming uploads.
-   * NULL when no upload is active.  Allocated to HTTP_UPLOAD_CHUNK_SIZE
-   * at upload start; freed in http_connection_release().
-   *
-   * WHY: the connection's header buffer (conn->buffer) is only
-   * HTTP_REQUEST_BUFFER_SIZE (8 KB).  Reading 8 KB per event-loop
-   * iteration limits upload throughput to a few MB/s.  A dedicated
-   * 256 KB buffer reduces the required syscall rate by 32× at the
-   * same throughput target.
-   *
-   * ISOLATION: this field is only accessed inside ENABLE_WEB_UPLOAD
-   * guards.  FTP paths, download paths, and internal copy are unaffected.
-   *
-   * @note Thread-safety: NOT thread-safe (single event-loop thread)
-   * @note Must be freed (not closed) in http_connection_release()
+   * Body of a POST /api/upload being received.  The loop only moves
+   * bytes off the socket (http_upload_feed()); the write-behind pool
+   * puts them on disk.  Read interest is dropped while the upload's
+   * ring is full and while the last bytes are flushed.
    */
-  uint8_t *upload_chunk_buf;
+  int upload_active;
+  http_upload_t *upload;
 #endif
 } http_connection_t;
 
@@ -127,9 +163,7 @@ static void http_connections_init(void) {
     g_http_connections[i].buffer_used = 0;
 #if ENABLE_WEB_UPLOAD
     g_http_connections[i].upload_active = 0;
-    g_http_connections[i].upload_fd = -1;
-    g_http_connections[i].upload_remaining = 0;
-    g_http_connections[i].upload_chunk_buf = NULL;
+    g_http_connections[i].upload = NULL;
 #endif
   }
 }
@@ -146,10 +180,10 @@ static http_connection_t *http_connection_acquire(http_server_t *server,
       conn->server = server;
       conn->fd = client_fd;
       conn->buffer_used = 0;
+      conn->last_active = time(NULL);
 #if ENABLE_WEB_UPLOAD
       conn->upload_active = 0;
-      conn->upload_fd = -1;
-      conn->upload_remaining = 0;
+      conn->upload = NULL;
 #endif
       return conn;
     }
@@ -161,18 +195,19 @@ static void http_connection_release(http_connection_t *conn) {
   if (conn == NULL) {
     return;
   }
+  if (conn->download != NULL) {
+    http_response_destroy(conn->download);
+    conn->download = NULL;
+  }
+  free(conn->dl_buf);
+  conn->dl_buf = NULL;
+  conn->dl_cap = 0U;
 #if ENABLE_WEB_UPLOAD
-  if (conn->upload_fd >= 0) {
-    (void)pal_file_close(conn->upload_fd);
-    conn->upload_fd = -1;
+  if (conn->upload != NULL) {
+    http_upload_release(conn->upload);
+    conn->upload = NULL;
   }
   conn->upload_active = 0;
-  conn->upload_remaining = 0;
-  /* Free the upload read buffer if it was allocated */
-  if (conn->upload_chunk_buf != NULL) {
-    free(conn->upload_chunk_buf);
-    conn->upload_chunk_buf = NULL;
-  }
 #endif
   conn->fd = -1;
   conn->server = NULL;
@@ -186,7 +221,15 @@ static void http_connection_release(http_connection_t *conn) {
 static int http_accept_callback(int fd, uint32_t events, void *data);
 static int http_client_callback(int fd, uint32_t events, void *data);
 static int http_handle_request(http_connection_t *conn);
+static int http_send_response(http_connection_t *conn,
+                              http_response_t *response);
 static void http_close_connection(http_connection_t *conn);
+static int http_process_buffer(http_connection_t *conn);
+static void http_server_tick(void *data);
+static int http_events_open(http_connection_t *conn);
+static void http_events_push(http_server_t *server, int force);
+static void http_consume_request(http_connection_t *conn);
+static int http_download_resume(http_connection_t *conn);
 
 /*===========================================================================*
  * SET NON-BLOCKING
@@ -200,6 +243,331 @@ static int set_nonblocking(int fd) {
   return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 }
 
+/*===========================================================================*
+ * WORKER POOL — blocking API routes run off the event-loop thread
+ *
+ *   loop thread                      worker thread
+ *   ───────────                      ─────────────
+ *   parse request
+ *   event_loop_remove(client)
+ *   enqueue {conn, request} ───────► http_api_handle()
+ *                                    [generated body: send it here]
+ *                                    write {conn, response} to pipe
+ *   http_done_callback() ◄──────────┘
+ *   send response (unless sent), close client or keep it alive
+ *
+ * While a job is queued or running the loop never touches the
+ * connection: its fd is unregistered and only the done callback or
+ * http_server_destroy() (after joining the workers) closes it.
+ *===========================================================================*/
+
+typedef struct {
+  http_connection_t *conn;
+  http_request_t request; /* header pointers refer to conn->buffer */
+} http_job_t;
+
+typedef struct {
+  http_connection_t *conn;
+  http_response_t *response;
+  int sent; /* the worker already sent it; rc is the result */
+  int rc;
+} http_done_t;
+
+typedef struct {
+  pthread_t threads[HTTP_WORKER_THREADS > 0U ? HTTP_WORKER_THREADS : 1U];
+  size_t nthreads;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  http_job_t jobs[HTTP_WORKER_QUEUE_DEPTH];
+  size_t head;
+  size_t count;
+  int stop;
+  int done_rd; /* watched by the loop, non-blocking */
+  int done_wr; /* written by workers, blocking */
+} http_workers_t;
+
+static http_workers_t g_http_workers = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .done_rd = -1,
+    .done_wr = -1,
+};
+
+static void *http_worker_main(void *arg) {
+  http_workers_t *w = (http_workers_t *)arg;
+  http_job_t job;
+
+  for (;;) {
+    (void)pthread_mutex_lock(&w->lock);
+    while ((w->count == 0U) && (w->stop == 0)) {
+      (void)pthread_cond_wait(&w->cond, &w->lock);
+    }
+    if (w->stop != 0) {
+      (void)pthread_mutex_unlock(&w->lock);
+      break;
+    }
+    job = w->jobs[w->head];
+    w->head = (w->head + 1U) % (size_t)HTTP_WORKER_QUEUE_DEPTH;
+    w->count--;
+    (void)pthread_mutex_unlock(&w->lock);
+
+    http_done_t done;
+    done.conn = job.conn;
+    done.response = http_api_handle(&job.request);
+    done.sent = 0;
+    done.rc = 0;
+
+    /*
+     * A generated body (stream_fill) may still read the disk while it
+     * formats, so it is sent from here rather than from the loop.
+     */
+    if ((done.response != NULL) && (done.response->stream_fill != NULL)) {
+      done.rc = http_send_response(job.conn, done.response);
+      done.response = NULL;
+      done.sent = 1;
+    }
+
+    /* Records are far below PIPE_BUF, so each write is atomic */
+    ssize_t n;
+    do {
+      n = write(w->done_wr, &done, sizeof(done));
+    } while ((n < 0) && (errno == EINTR));
+    if (n != (ssize_t)sizeof(done)) {
+      /* Unreachable in practice; the client is reaped at shutdown */
+      http_response_destroy(done.response);
+    }
+  }
+  return NULL;
+}
+
+static int http_done_callback(int fd, uint32_t events, void *data) {
+  (void)events;
+  (void)data;
+
+  http_done_t done;
+  while (read(fd, &done, sizeof(done)) == (ssize_t)sizeof(done)) {
+    http_connection_t *conn = done.conn;
+    conn->offloaded = 0;
+    int rc = (done.sent != 0) ? done.rc
+                              : http_send_response(conn, done.response);
+    if (rc > 0) {
+      continue; /* file body: the download pump resumes it */
+    }
+    if ((rc != 0) || (conn->keep_alive == 0)) {
+      http_close_connection(conn);
+      continue;
+    }
+    /* Persistent: watch the socket again and run any pipelined request */
+    conn->last_active = time(NULL);
+    http_consume_request(conn);
+    if (event_loop_add(conn->server->loop, conn->fd, EVENT_READ,
+                       http_client_callback, conn) != 0) {
+      http_close_connection(conn);
+      continue;
+    }
+    (void)http_process_buffer(conn);
+  }
+  return 0;
+}
+
+/**
+ * Start the pool.  Failure is not fatal: with no threads every route
+ * simply keeps running inline on the loop thread.
+ */
+static void http_workers_start(http_server_t *server) {
+  http_workers_t *w = &g_http_workers;
+  w->nthreads = 0U;
+  w->head = 0U;
+  w->count = 0U;
+  w->stop = 0;
+
+  if (HTTP_WORKER_THREADS == 0U) {
+    return;
+  }
+
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return;
+  }
+  (void)set_nonblocking(fds[0]);
+  if (event_loop_add(server->loop, fds[0], EVENT_READ, http_done_callback,
+                     server) != 0) {
+    close(fds[0]);
+    close(fds[1]);
+    return;
+  }
+  w->done_rd = fds[0];
+  w->done_wr = fds[1];
+
+  pthread_attr_t attr;
+  if (pthread_attr_init(&attr) != 0) {
+    return;
+  }
+  (void)pthread_attr_setstacksize(&attr, (size_t)HTTP_THREAD_STACK_SIZE);
+  for (size_t i = 0; i < (size_t)HTTP_WORKER_THREADS; i++) {
+    if (pal_thread_create(&w->threads[w->nthreads], &attr, PAL_THREAD_HTTP,
+                          http_worker_main, w) == 0) {
+      w->nthreads++;
+    }
+  }
+  (void)pthread_attr_destroy(&attr);
+}
+
+/**
+ * Join the workers, then finish whatever they already posted.  Queued
+ * jobs that never started are dropped; their connections are still in
+ * g_http_connections and get closed by the caller.
+ */
+static void http_workers_stop(http_server_t *server) {
+  http_workers_t *w = &g_http_workers;
+
+  (void)pthread_mutex_lock(&w->lock);
+  w->stop = 1;
+  (void)pthread_cond_broadcast(&w->cond);
+  (void)pthread_mutex_unlock(&w->lock);
+  for (size_t i = 0; i < w->nthreads; i++) {
+    (void)pthread_join(w->threads[i], NULL);
+  }
+  w->nthreads = 0U;
+  w->count = 0U;
+
+  if (w->done_rd >= 0) {
+    event_loop_remove(server->loop, w->done_rd);
+    http_done_t done;
+    while (read(w->done_rd, &done, sizeof(done)) == (ssize_t)sizeof(done)) {
+      http_response_destroy(done.response);
+    }
+    close(w->done_rd);
+    w->done_rd = -1;
+  }
+  if (w->done_wr >= 0) {
+    close(w->done_wr);
+    w->done_wr = -1;
+  }
+}
+
+/**
+ * Hand a parsed request to the pool.
+ *
+ * @return 0 if a worker now owns the connection, -1 to run it inline
+ */
+static int http_workers_submit(http_connection_t *conn,
+                               const http_request_t *request) {
+  http_workers_t *w = &g_http_workers;
+  if (w->nthreads == 0U) {
+    return -1;
+  }
+
+  (void)pthread_mutex_lock(&w->lock);
+  if (w->count >= (size_t)HTTP_WORKER_QUEUE_DEPTH) {
+    (void)pthread_mutex_unlock(&w->lock);
+    return -1;
+  }
+  /* Nothing more to read; keep EOF/HUP from closing it under the worker */
+  event_loop_remove(conn->server->loop, conn->fd);
+  conn->offloaded = 1;
+  size_t tail = (w->head + w->count) % (size_t)HTTP_WORKER_QUEUE_DEPTH;
+  w->jobs[tail].conn = conn;
+  w->jobs[tail].request = *request;
+  w->count++;
+  (void)pthread_cond_signal(&w->cond);
+  (void)pthread_mutex_unlock(&w->lock);
+  return 0;
+}
+
+#if ENABLE_WEB_UPLOAD
+/*===========================================================================*
+ * UPLOADS — body bytes go to the write-behind pool (http_upload.h)
+ *
+ *   EVENT_READ  ─► http_upload_feed()
+ *                    MORE      keep reading
+ *                    PAUSED    ring full: unregister until RESUME
+ *                    FLUSHING  body in: unregister until DONE
+ *   RESUME note ─► register again, feed
+ *   DONE note   ─► 200 or 500, close
+ *
+ * The loop never waits on the disk; a stalled write only stops the
+ * socket reads of its own upload.
+ *===========================================================================*/
+
+static void http_upload_reply(http_connection_t *conn, http_status_t status,
+                              const char *body) {
+  http_response_t *resp = http_response_create(status);
+  if (resp == NULL) {
+    return;
+  }
+  http_response_add_header(resp, "Content-Type", "application/json");
+  http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
+  http_response_set_body(resp, body, strlen(body));
+  if (resp->used > 0) {
+    (void)pal_send_all(conn->fd, resp->data, resp->used, 0);
+  }
+  http_response_destroy(resp);
+}
+
+static int http_upload_continue(http_connection_t *conn) {
+  int rc = http_upload_feed(conn->upload);
+  if (rc == HTTP_UPLOAD_FAILED) {
+    http_close_connection(conn);
+    return -1;
+  }
+  if (rc != HTTP_UPLOAD_MORE) {
+    event_loop_remove(conn->server->loop, conn->fd);
+  }
+  return 0;
+}
+
+static int http_upload_notes_callback(int fd, uint32_t events, void *data) {
+  (void)fd;
+  (void)events;
+  (void)data;
+
+  int kind = 0;
+  http_upload_t *up;
+  while ((up = http_upload_next_note(&kind)) != NULL) {
+    http_connection_t *conn = (http_connection_t *)http_upload_owner(up);
+    if ((conn != NULL) && (conn->upload == up)) {
+      conn->last_active = time(NULL);
+      if (kind == HTTP_UPLOAD_NOTE_DONE) {
+        if (http_upload_result(up) == 0) {
+          http_upload_reply(conn, HTTP_STATUS_200_OK, "{\"ok\":true}");
+        } else {
+          http_upload_reply(conn, HTTP_STATUS_500_INTERNAL_ERROR,
+                            "{\"error\":\"Write failed\"}");
+        }
+        http_close_connection(conn);
+      } else if (event_loop_add(conn->server->loop, conn->fd, EVENT_READ,
+                                http_client_callback, conn) != 0) {
+        http_close_connection(conn);
+      } else {
+        (void)http_upload_continue(conn);
+      }
+    }
+    http_upload_note_done(up);
+  }
+  return 0;
+}
+
+/** Failure leaves uploads disabled (503), never the whole server */
+static void http_uploads_start(http_server_t *server) {
+  if (http_upload_pool_start(HTTP_UPLOAD_WRITERS, HTTP_UPLOAD_SPLICE) != 0) {
+    return;
+  }
+  if (event_loop_add(server->loop, http_upload_notes_fd(), EVENT_READ,
+                     http_upload_notes_callback, server) != 0) {
+    http_upload_pool_stop();
+  }
+}
+
+static void http_uploads_stop(http_server_t *server) {
+  int fd = http_upload_notes_fd();
+  if (fd >= 0) {
+    event_loop_remove(server->loop, fd);
+    http_upload_pool_stop();
+  }
+}
+#endif
+
 static int http_parse_basic_request(const char *buf, char *method,
                                     size_t method_cap, char *uri,
                                     size_t uri_cap, size_t *header_len,
@@ -440,25 +808,22 @@ static int is_safe_filename_local(const char *name) {
  * CREATE / DESTROY
  *===========================================================================*/
 
-http_server_t *http_server_create(event_loop_t *loop, const char *bind_addr,
-                                  const char *root_path) {
-  if ((loop == NULL) || (bind_addr == NULL) || (root_path == NULL)) {
-    return NULL;
-  }
-
+/* Reset the server state for a new listener; 0 = ok */
+static int http_server_setup(event_loop_t *loop, const char *root_path) {
   if (atomic_load(&g_http_server_in_use) != 0) {
-    return NULL;
+    return -1;
   }
 
   memset(&g_http_server, 0, sizeof(g_http_server));
   g_http_server.listen_fd = -1;
   g_http_server.loop = loop;
   atomic_store(&g_http_server.connection_count, 0);
+  atomic_store(&g_http_server.release_listener, 0);
 
   /* Store root path for filesystem confinement */
   size_t rlen = strlen(root_path);
   if (rlen >= sizeof(g_http_server.root_path)) {
-    return NULL;
+    return -1;
   }
   memcpy(g_http_server.root_path, root_path, rlen + 1U);
 
@@ -466,6 +831,41 @@ http_server_t *http_server_create(event_loop_t *loop, const char *bind_addr,
   http_api_set_root(root_path);
 
   http_connections_init();
+  return 0;
+}
+
+/* Serve g_http_server.listen_fd; closes it on failure */
+static http_server_t *http_server_run(event_loop_t *loop) {
+  /* Non-blocking accept */
+  (void)set_nonblocking(g_http_server.listen_fd);
+
+  /* Register with event loop */
+  if (event_loop_add(loop, g_http_server.listen_fd, EVENT_READ,
+                     http_accept_callback, &g_http_server) != 0) {
+    close(g_http_server.listen_fd);
+    g_http_server.listen_fd = -1;
+    return NULL;
+  }
+
+  http_workers_start(&g_http_server);
+#if ENABLE_WEB_UPLOAD
+  http_uploads_start(&g_http_server);
+#endif
+  event_loop_set_tick(loop, http_server_tick, &g_http_server);
+
+  atomic_store(&g_http_server_in_use, 1);
+  return &g_http_server;
+}
+
+http_server_t *http_server_create(event_loop_t *loop, const char *bind_addr,
+                                  const char *root_path) {
+  if ((loop == NULL) || (bind_addr == NULL) || (root_path == NULL)) {
+    return NULL;
+  }
+
+  if (http_server_setup(loop, root_path) != 0) {
+    return NULL;
+  }
 
   /* Parse bind address (supports "[::1]:8888" and "0.0.0.0:8888") */
   struct sockaddr_storage addr_storage;
@@ -519,29 +919,60 @@ http_server_t *http_server_create(event_loop_t *loop, const char *bind_addr,
     return NULL;
   }
 
-  /* Non-blocking accept */
-  (void)set_nonblocking(g_http_server.listen_fd);
+  return http_server_run(loop);
+}
 
-  /* Register with event loop */
-  if (event_loop_add(loop, g_http_server.listen_fd, EVENT_READ,
-                     http_accept_callback, &g_http_server) != 0) {
-    close(g_http_server.listen_fd);
-    g_http_server.listen_fd = -1;
+http_server_t *http_server_create_fd(event_loop_t *loop, int listen_fd,
+                                     const char *root_path) {
+  if ((loop == NULL) || (listen_fd < 0) || (root_path == NULL)) {
     return NULL;
   }
 
-  atomic_store(&g_http_server_in_use, 1);
-  return &g_http_server;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_len = sizeof(addr_storage);
+  if ((getsockname(listen_fd, (struct sockaddr *)&addr_storage, &addr_len) !=
+       0) ||
+      (http_server_setup(loop, root_path) != 0)) {
+    close(listen_fd);
+    return NULL;
+  }
+  if (addr_storage.ss_family == AF_INET6) {
+    g_http_server.port =
+        ntohs(((struct sockaddr_in6 *)&addr_storage)->sin6_port);
+  } else {
+    g_http_server.port =
+        ntohs(((struct sockaddr_in *)&addr_storage)->sin_port);
+  }
+  g_http_server.listen_fd = listen_fd;
+  return http_server_run(loop);
+}
+
+int http_server_listen_fd(const http_server_t *server) {
+  return (server != NULL) ? server->listen_fd : -1;
+}
+
+void http_server_release_listener(http_server_t *server) {
+  if (server != NULL) {
+    atomic_store(&server->release_listener, 1);
+  }
 }
 
 void http_server_destroy(http_server_t *server) {
   if (server != NULL) {
     if (server == &g_http_server) {
+      event_loop_set_tick(server->loop, NULL, NULL);
+      http_workers_stop(server);
       for (size_t i = 0; i < (size_t)HTTP_MAX_CONNECTIONS; i++) {
         if (g_http_connections[i].fd >= 0) {
           http_close_connection(&g_http_connections[i]);
         }
       }
+#if ENABLE_WEB_UPLOAD
+      /* After the connections: their released uploads finish here */
+      http_uploads_stop(server);
+#endif
+      http_games_shutdown();
+      http_sysmon_shutdown();
       if (server->listen_fd >= 0) {
         event_loop_remove(server->loop, server->listen_fd);
         close(server->listen_fd);
@@ -553,66 +984,255 @@ void http_server_destroy(http_server_t *server) {
 }
 
 /*===========================================================================*
- * ACCEPT CALLBACK — new client connecting
+ * IDLE REAPER — runs from the event-loop tick
  *===========================================================================*/
 
-static int http_accept_callback(int fd, uint32_t events, void *data) {
-  http_server_t *server = (http_server_t *)data;
-  (void)events;
-
-  struct sockaddr_storage client_addr;
-  socklen_t addr_len = sizeof(client_addr);
+/**
+ * Close connections that have gone quiet: HTTP_REQUEST_TIMEOUT while a
+ * request (or upload body) is half received, HTTP_KEEPALIVE_TIMEOUT
+ * between requests.  Connections owned by a worker are left alone, and
+ * event-stream subscribers are kept alive by http_events_push() pings.
+ */
+static void http_reap_idle(http_server_t *server) {
+  static time_t last_sweep = 0;
+  time_t now = time(NULL);
+  if (now == last_sweep) {
+    return;
+  }
+  last_sweep = now;
 
-  int client_fd = accept(fd, (struct sockaddr *)&client_addr, &addr_len);
-  if (client_fd < 0) {
-    return 0; /* EAGAIN or error, keep listening */
+  for (size_t i = 0; i < (size_t)HTTP_MAX_CONNECTIONS; i++) {
+    http_connection_t *conn = &g_http_connections[i];
+    if ((conn->fd < 0) || (conn->server != server) ||
+        (conn->offloaded != 0) || (conn->sse != 0)) {
+      continue;
+    }
+    int busy = (conn->buffer_used > 0U) || (conn->download != NULL);
+#if ENABLE_WEB_UPLOAD
+    busy = busy || (conn->upload_active != 0);
+#endif
+    time_t limit = busy ? (time_t)HTTP_REQUEST_TIMEOUT
+                        : (time_t)HTTP_KEEPALIVE_TIMEOUT;
+    if ((now - conn->last_active) > limit) {
+      http_close_connection(conn);
+    }
   }
+}
 
-  /*
-   * SOCKET TUNING FOR UPLOAD THROUGHPUT
-   *
-   * TCP_NODELAY
-   *   Disable Nagle's algorithm on the server's outgoing path.
-   *   Nagle batches small writes, adding up to 200 ms of latency for
-   *   ACKs and HTTP response headers.  Disabling it ensures the 200-byte
-   *   "HTTP/1.1 200 OK" response after upload completes is sent immediately
-   *   rather than waiting for the kernel to accumulate more data.
-   *   Has no effect on incoming data (upload body direction).
-   *
-   * SO_RCVBUF
-   *   Hint the kernel to allocate a 2 MB receive buffer for this socket.
-   *   A larger receive buffer allows the kernel to acknowledge incoming
-   *   data in larger batches, keeping the sender's congestion window open
-   *   between event-loop wakeups.  Without this, the default receive buffer
-   *   (~87 KB on Linux, ~256 KB on FreeBSD) can be drained faster than the
-   *   event loop wakes up, forcing the remote sender to pause.
-   *
-   *   IMPORTANT: setsockopt(SO_RCVBUF) is a hint.  The kernel caps it at
-   *   net.core.rmem_max (Linux) or kern.ipc.maxsockbuf (FreeBSD/PS5) and
-   *   silently ignores requests above the system maximum.  Setting it here
-   *   is therefore always safe — worst case it has no effect.
-   *
-   * @note These options apply to ALL HTTP client connections, not just
-   *       uploads.  TCP_NODELAY is universally beneficial for request/
-   *       response HTTP.  The SO_RCVBUF hint is harmless for short API
-   *       requests (the kernel won't actually allocate the full buffer
-   *       until data arrives).
-   *
-   * @note Thread-safety: called only in the accept callback (single
-   *       event-loop thread).
-   */
-  {
-    int nodelay = 1;
-    (void)setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY,
-                     &nodelay, sizeof(nodelay));
+/*===========================================================================*
+ * EVENT STREAM — /api/events subscribers
+ *===========================================================================*/
 
-    int rcvbuf = (int)HTTP_UPLOAD_RCVBUF_SIZE;
-    (void)setsockopt(client_fd, SOL_SOCKET, SO_RCVBUF,
-                     &rcvbuf, sizeof(rcvbuf));
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 /* SIGPIPE is ignored process-wide */
+#endif
 
-#if (HTTP_SNDBUF_SIZE) > 0U
-    /*
-     * SO_SNDBUF — bypass OrbisOS TCP send-buffer clamping.
+static const char k_sse_head[] = "HTTP/1.1 200 OK\r\n"
+                                 "Content-Type: text/event-stream\r\n"
+                                 "Cache-Control: no-store\r\n"
+                                 "X-Content-Type-Options: nosniff\r\n"
+                                 "Access-Control-Allow-Origin: *\r\n"
+                                 "\r\n"
+                                 "retry: 3000\n\n";
+
+/*
+ * Frames are a few hundred bytes, so a healthy socket always takes them
+ * whole.  A subscriber whose send buffer is full is dropped rather than
+ * allowed to stall the loop; EventSource reconnects on its own.
+ */
+static int http_events_write(http_connection_t *conn, const char *buf,
+                             size_t len) {
+  ssize_t n = send(conn->fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if ((n < 0) || ((size_t)n != len)) {
+    return -1;
+  }
+  conn->last_active = time(NULL);
+  return 0;
+}
+
+static uint32_t http_events_hash(const char *buf, size_t len) {
+  uint32_t h = 2166136261U; /* FNV-1a */
+  for (size_t i = 0; i < len; i++) {
+    h ^= (uint8_t)buf[i];
+    h *= 16777619U;
+  }
+  return h | 1U; /* 0 means "nothing pushed yet" */
+}
+
+/**
+ * Turn the connection into a subscriber.  The current state of every
+ * topic is pushed straight away; afterwards only changes are sent.
+ *
+ * @return 1 once the stream is open, -1 if the connection must close
+ */
+static int http_events_open(http_connection_t *conn) {
+  size_t open = 0U;
+  for (size_t i = 0; i < (size_t)HTTP_MAX_CONNECTIONS; i++) {
+    if ((g_http_connections[i].fd >= 0) && (g_http_connections[i].sse != 0)) {
+      open++;
+    }
+  }
+  if (open >= (size_t)HTTP_SSE_MAX_CLIENTS) {
+    http_response_t *resp =
+        http_response_create(HTTP_STATUS_503_SERVICE_UNAVAILABLE);
+    if (resp != NULL) {
+      const char *msg = "Too many event streams";
+      http_response_add_header(resp, "Retry-After", "5");
+      http_response_set_body(resp, msg, strlen(msg));
+    }
+    (void)http_send_response(conn, resp);
+    return -1;
+  }
+
+  if (pal_send_all(conn->fd, k_sse_head, sizeof(k_sse_head) - 1U, 0) !=
+      (ssize_t)(sizeof(k_sse_head) - 1U)) {
+    return -1;
+  }
+  conn->sse = 1;
+  memset(conn->sse_hash, 0, sizeof(conn->sse_hash));
+  conn->buffer_used = 0U;
+  conn->buffer[0] = '\0';
+  conn->last_active = time(NULL);
+  http_events_push(conn->server, 1);
+  return 1;
+}
+
+/**
+ * Render each topic once and send it to the subscribers that have not
+ * seen this exact frame; quiet streams get a keep-alive comment.
+ */
+static void http_events_push(http_server_t *server, int force) {
+  static uint64_t last_ms = 0U;
+  static char frame[HTTP_EVENT_FRAME_MAX];
+
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now_ms =
+      ((uint64_t)ts.tv_sec * 1000U) + ((uint64_t)ts.tv_nsec / 1000000U);
+  if ((force == 0) && ((now_ms - last_ms) < (uint64_t)HTTP_SSE_PUSH_MS)) {
+    return;
+  }
+  last_ms = now_ms;
+
+  http_connection_t *subs[HTTP_SSE_MAX_CLIENTS];
+  size_t nsubs = 0U;
+  for (size_t i = 0; (i < (size_t)HTTP_MAX_CONNECTIONS) &&
+                     (nsubs < (size_t)HTTP_SSE_MAX_CLIENTS);
+       i++) {
+    http_connection_t *conn = &g_http_connections[i];
+    if ((conn->fd >= 0) && (conn->sse != 0) && (conn->server == server)) {
+      subs[nsubs++] = conn;
+    }
+  }
+  if (nsubs == 0U) {
+    return;
+  }
+
+  for (size_t t = 0; t < (size_t)HTTP_EVENT_TOPICS; t++) {
+    size_t len = http_api_event_render(t, frame, sizeof(frame));
+    if (len == 0U) {
+      continue;
+    }
+    uint32_t h = http_events_hash(frame, len);
+    for (size_t k = 0; k < nsubs; k++) {
+      http_connection_t *conn = subs[k];
+      if ((conn->fd < 0) || (conn->sse_hash[t] == h)) {
+        continue;
+      }
+      if (http_events_write(conn, frame, len) != 0) {
+        http_close_connection(conn);
+        continue;
+      }
+      conn->sse_hash[t] = h;
+    }
+  }
+
+  time_t now = time(NULL);
+  for (size_t k = 0; k < nsubs; k++) {
+    http_connection_t *conn = subs[k];
+    if ((conn->fd >= 0) &&
+        ((now - conn->last_active) >= (time_t)HTTP_SSE_PING_SECONDS) &&
+        (http_events_write(conn, ": ping\n\n", 8U) != 0)) {
+      http_close_connection(conn);
+    }
+  }
+}
+
+/* Loop housekeeping: event pushes, then the idle sweep */
+static void http_server_tick(void *data) {
+  http_server_t *server = (http_server_t *)data;
+  if ((atomic_load(&server->release_listener) != 0) &&
+      (server->listen_fd >= 0)) {
+    /* Another process accepts on it now: no shutdown(), just let go */
+    event_loop_remove(server->loop, server->listen_fd);
+    close(server->listen_fd);
+    server->listen_fd = -1;
+  }
+  http_events_push(server, 0);
+  http_reap_idle(server);
+}
+
+/*===========================================================================*
+ * ACCEPT CALLBACK — new client connecting
+ *===========================================================================*/
+
+static int http_accept_callback(int fd, uint32_t events, void *data) {
+  http_server_t *server = (http_server_t *)data;
+  (void)events;
+
+  struct sockaddr_storage client_addr;
+  socklen_t addr_len = sizeof(client_addr);
+
+  int client_fd = accept(fd, (struct sockaddr *)&client_addr, &addr_len);
+  if (client_fd < 0) {
+    return 0; /* EAGAIN or error, keep listening */
+  }
+
+  /*
+   * SOCKET TUNING FOR UPLOAD THROUGHPUT
+   *
+   * TCP_NODELAY
+   *   Disable Nagle's algorithm on the server's outgoing path.
+   *   Nagle batches small writes, adding up to 200 ms of latency for
+   *   ACKs and HTTP response headers.  Disabling it ensures the 200-byte
+   *   "HTTP/1.1 200 OK" response after upload completes is sent immediately
+   *   rather than waiting for the kernel to accumulate more data.
+   *   Has no effect on incoming data (upload body direction).
+   *
+   * SO_RCVBUF
+   *   Hint the kernel to allocate a 2 MB receive buffer for this socket.
+   *   A larger receive buffer allows the kernel to acknowledge incoming
+   *   data in larger batches, keeping the sender's congestion window open
+   *   between event-loop wakeups.  Without this, the default receive buffer
+   *   (~87 KB on Linux, ~256 KB on FreeBSD) can be drained faster than the
+   *   event loop wakes up, forcing the remote sender to pause.
+   *
+   *   IMPORTANT: setsockopt(SO_RCVBUF) is a hint.  The kernel caps it at
+   *   net.core.rmem_max (Linux) or kern.ipc.maxsockbuf (FreeBSD/PS5) and
+   *   silently ignores requests above the system maximum.  Setting it here
+   *   is therefore always safe — worst case it has no effect.
+   *
+   * @note These options apply to ALL HTTP client connections, not just
+   *       uploads.  TCP_NODELAY is universally beneficial for request/
+   *       response HTTP.  The SO_RCVBUF hint is harmless for short API
+   *       requests (the kernel won't actually allocate the full buffer
+   *       until data arrives).
+   *
+   * @note Thread-safety: called only in the accept callback (single
+   *       event-loop thread).
+   */
+  {
+    int nodelay = 1;
+    (void)setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY,
+                     &nodelay, sizeof(nodelay));
+
+    int rcvbuf = (int)HTTP_UPLOAD_RCVBUF_SIZE;
+    (void)setsockopt(client_fd, SOL_SOCKET, SO_RCVBUF,
+                     &rcvbuf, sizeof(rcvbuf));
+
+#if (HTTP_SNDBUF_SIZE) > 0U
+    /*
+     * SO_SNDBUF — bypass OrbisOS TCP send-buffer clamping.
      *
      * Without this, PS5/PS4 accepted sockets keep the kernel default
      * (~256 KB), causing pal_send_all() to block as soon as the buffer
@@ -658,6 +1278,19 @@ static int http_client_callback(int fd, uint32_t events, void *data) {
   http_connection_t *conn = (http_connection_t *)data;
   (void)fd;
 
+  /*
+   * A download only waits for room in the send buffer.  A half-close
+   * from the client (RDHUP) is not an error here: the next send fails
+   * if the peer is really gone.
+   */
+  if (conn->download != NULL) {
+    if ((events & EVENT_ERROR) != 0U) {
+      http_close_connection(conn);
+      return -1;
+    }
+    return http_download_resume(conn);
+  }
+
   /* Connection closed or error */
   if (events & (EVENT_CLOSE | EVENT_ERROR)) {
     http_close_connection(conn);
@@ -667,138 +1300,8 @@ static int http_client_callback(int fd, uint32_t events, void *data) {
   if (events & EVENT_READ) {
 #if ENABLE_WEB_UPLOAD
     if (conn->upload_active != 0) {
-      /*
-       * UPLOAD STREAMING READ
-       *
-       * Use the pre-allocated upload_chunk_buf (HTTP_UPLOAD_CHUNK_SIZE =
-       * 256 KB) instead of conn->buffer (HTTP_REQUEST_BUFFER_SIZE = 8 KB).
-       *
-       * WHY: reading 8 KB per event-loop iteration caps throughput because
-       * each iteration requires a kqueue/epoll round-trip (typically
-       * 5-20 µs).  At 8 KB × 50 000 wakeups/s the ceiling is ~400 MB/s in
-       * theory, but in practice kernel scheduling overhead and interrupt
-       * coalescing bring the real ceiling much lower (measured ~5 MB/s).
-       *
-       * At 256 KB the required syscall rate for 113 MB/s drops to ~440/s,
-       * well within the event-loop budget.  Each read() drains a much
-       * larger window of TCP receive-buffer data in one call, so the kernel
-       * spends far more time in DMA and far less in context switches.
-       *
-       * FALLBACK: if malloc failed during upload initialisation,
-       * upload_chunk_buf is NULL and we fall back to conn->buffer (8 KB).
-       * This preserves correctness at the cost of performance.
-       *
-       * ISOLATION: only active when upload_active != 0.  All other HTTP
-       * paths (headers, download, API) continue to use conn->buffer.
-       * FTP and internal copy are completely unaffected.
-       *
-       * @pre  conn->upload_chunk_buf allocated at upload start (or NULL)
-       * @pre  conn->upload_remaining > 0
-       * @post conn->upload_remaining decremented by bytes written to file
-       */
-      uint8_t *rd_buf  = (conn->upload_chunk_buf != NULL)
-                             ? conn->upload_chunk_buf
-                             : (uint8_t *)conn->buffer;
-      size_t   rd_cap  = (conn->upload_chunk_buf != NULL)
-                             ? (size_t)HTTP_UPLOAD_CHUNK_SIZE
-                             : sizeof(conn->buffer);
-
-      ssize_t n = read(conn->fd, rd_buf, rd_cap);
-      if (n <= 0) {
-        http_close_connection(conn);
-        return -1;
-      }
-
-      size_t got = (size_t)n;
-      if (got > conn->upload_remaining) {
-        got = conn->upload_remaining;
-      }
-
-      if ((got > 0U) && (conn->upload_fd >= 0)) {
-        /*
-         * DIRECT WRITE — bypass pal_file_write_all()
-         *
-         * pal_file_write_all() subdivides writes into PAL_FILE_WRITE_CHUNK_MAX
-         * (128 KB on PS5, 64 KB on PS4).  That limit exists for FTP STOR to
-         * prevent TCP recv-buffer stalls while the kernel is busy with a long
-         * write: the FTP STOR loop reads from the socket and writes to disk
-         * serially, so a slow 4 MB write would stall socket reads long enough
-         * to fill the TCP window and trigger a client inactivity timeout.
-         *
-         * HTTP upload is different:
-         *   - We already have the full chunk (up to 256 KB) in rd_buf.
-         *   - The socket read and the disk write are NOT interleaved inside a
-         *     single loop iteration, so TCP flow control is not a concern.
-         *   - Writing 256 KB in a single write() call instead of two 128 KB
-         *     calls halves the number of PFS AES-XTS context setups per MB.
-         *     This is the primary reason /data uploads were capped at ~25 MB/s
-         *     while USB (no encryption) reached 80 MB/s.
-         *
-         * We reproduce the same direct-write loop used by pal_file_copy_atomic
-         * (which bypasses pal_file_write_all for identical reasons) and handle
-         * the PS4/PS5 PFS silent-ENOSPC (write() == 0) quirk.
-         *
-         * @pre  rd_buf[0..got-1] contains valid data to write
-         * @pre  conn->upload_fd is a valid open writable file descriptor
-         */
-        const uint8_t *wr_p   = rd_buf;
-        size_t         wr_rem = got;
-        int            wr_ok  = 1;
-
-        while (wr_rem > 0U) {
-          ssize_t w = write(conn->upload_fd, wr_p, wr_rem);
-          if (w > 0) {
-            wr_p   += (size_t)w;
-            wr_rem -= (size_t)w;
-            continue;
-          }
-          if ((w < 0) && (errno == EINTR)) {
-            continue;
-          }
-          /* w == 0: PS4/PS5 PFS silent ENOSPC */
-          wr_ok = 0;
-          break;
-        }
-
-        if (wr_ok == 0) {
-          http_close_connection(conn);
-          return -1;
-        }
-      }
-
-      conn->upload_remaining -= got;
-      if (conn->upload_remaining == 0U) {
-        if (conn->upload_fd >= 0) {
-          (void)pal_file_close(conn->upload_fd);
-          conn->upload_fd = -1;
-        }
-
-        http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
-        if (resp != NULL) {
-          http_response_add_header(resp, "Content-Type", "application/json");
-          http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
-          const char *body = "{\"ok\":true}";
-          http_response_set_body(resp, body, strlen(body));
-          if (resp->used > 0) {
-            size_t total = 0;
-            size_t remain = resp->used;
-            while (remain > 0) {
-              ssize_t sent = write(conn->fd, resp->data + total, remain);
-              if (sent <= 0) {
-                break;
-              }
-              total += (size_t)sent;
-              remain -= (size_t)sent;
-            }
-          }
-          http_response_destroy(resp);
-        }
-
-        http_close_connection(conn);
-        return -1;
-      }
-
-      return 0;
+      conn->last_active = time(NULL);
+      return http_upload_continue(conn);
     }
 #endif
 
@@ -819,424 +1322,637 @@ static int http_client_callback(int fd, uint32_t events, void *data) {
     conn->buffer_used += (size_t)n;
     conn->buffer[conn->buffer_used] = '\0';
 
+    conn->last_active = time(NULL);
+    return http_process_buffer(conn);
+  }
+
+  return 0;
+}
+
+/*===========================================================================*
+ * PROCESS BUFFER — dispatch every complete (pipelined) request
+ *===========================================================================*/
+
+/**
+ * Run the requests sitting in conn->buffer in order.  After a response
+ * on a persistent connection the request is consumed and the next one,
+ * if already received, is handled straight away.
+ *
+ * @return 0 to keep watching the connection, -1 once it has been closed
+ */
+static int http_process_buffer(http_connection_t *conn) {
+  if (conn->sse != 0) {
+    /* Subscribers only listen; anything they send is dropped */
+    conn->buffer_used = 0U;
+    conn->buffer[0] = '\0';
+    return 0;
+  }
+  for (;;) {
     /* Check for complete HTTP request (headers end with \r\n\r\n) */
     const char *end = strstr(conn->buffer, "\r\n\r\n");
-    if (end != NULL) {
-      char method[8];
-      char uri[HTTP_URI_MAX_LENGTH];
-      size_t header_len = 0U;
-      size_t content_length = 0U;
-
-      if (http_parse_basic_request(conn->buffer, method, sizeof(method), uri,
-                                   sizeof(uri), &header_len,
-                                   &content_length) != 0) {
-        http_close_connection(conn);
-        return -1;
-      }
+    if (end == NULL) {
+      return 0;
+    }
+
+    char method[8];
+    char uri[HTTP_URI_MAX_LENGTH];
+    size_t header_len = 0U;
+    size_t content_length = 0U;
+
+    if (http_parse_basic_request(conn->buffer, method, sizeof(method), uri,
+                                 sizeof(uri), &header_len,
+                                 &content_length) != 0) {
+      http_close_connection(conn);
+      return -1;
+    }
 
 #if ENABLE_WEB_UPLOAD
-      if ((strcmp(method, "POST") == 0) &&
-          (strncmp(uri, "/api/upload", 11) == 0)) {
-        http_request_t up_req;
-        if ((http_parse_request(conn->buffer, conn->buffer_used, &up_req) <
-             0) ||
-            (http_csrf_validate(&up_req) != 0)) {
-          http_response_t *resp =
-              http_response_create(HTTP_STATUS_403_FORBIDDEN);
-          if (resp != NULL) {
-            http_response_add_header(resp, "Content-Type", "application/json");
-            http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
-            const char *body = "{\"error\":\"Invalid or missing CSRF token\"}";
-            http_response_set_body(resp, body, strlen(body));
-            if (resp->used > 0) {
-              (void)write(conn->fd, resp->data, resp->used);
-            }
-            http_response_destroy(resp);
+    if ((strcmp(method, "POST") == 0) &&
+        (strncmp(uri, "/api/upload", 11) == 0)) {
+      http_request_t up_req;
+      if ((http_parse_request(conn->buffer, conn->buffer_used, &up_req) <
+           0) ||
+          (http_csrf_validate(&up_req) != 0)) {
+        http_response_t *resp =
+            http_response_create(HTTP_STATUS_403_FORBIDDEN);
+        if (resp != NULL) {
+          http_response_add_header(resp, "Content-Type", "application/json");
+          http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
+          const char *body = "{\"error\":\"Invalid or missing CSRF token\"}";
+          http_response_set_body(resp, body, strlen(body));
+          if (resp->used > 0) {
+            (void)write(conn->fd, resp->data, resp->used);
           }
-          http_close_connection(conn);
-          return -1;
+          http_response_destroy(resp);
         }
+        http_close_connection(conn);
+        return -1;
+      }
 
-        if (content_length == 0U) {
-          http_response_t *resp =
-              http_response_create(HTTP_STATUS_400_BAD_REQUEST);
-          if (resp != NULL) {
-            const char *msg = "Missing Content-Length";
-            http_response_set_body(resp, msg, strlen(msg));
-            if (resp->used > 0) {
-              (void)write(conn->fd, resp->data, resp->used);
-            }
-            http_response_destroy(resp);
+      if (content_length == 0U) {
+        http_response_t *resp =
+            http_response_create(HTTP_STATUS_400_BAD_REQUEST);
+        if (resp != NULL) {
+          const char *msg = "Missing Content-Length";
+          http_response_set_body(resp, msg, strlen(msg));
+          if (resp->used > 0) {
+            (void)write(conn->fd, resp->data, resp->used);
           }
-          http_close_connection(conn);
-          return -1;
-        }
-
-        char dir_path[1024];
-        char file_name[256];
-        if ((get_query_param(uri, "path", dir_path, sizeof(dir_path)) != 0) ||
-            (get_query_param(uri, "name", file_name, sizeof(file_name)) != 0)) {
-          http_close_connection(conn);
-          return -1;
-        }
-        if (!is_safe_path_local(dir_path) ||
-            !is_safe_filename_local(file_name)) {
-          http_close_connection(conn);
-          return -1;
+          http_response_destroy(resp);
         }
+        http_close_connection(conn);
+        return -1;
+      }
 
-        char full[1024];
-        if (strcmp(dir_path, "/") == 0) {
-          (void)snprintf(full, sizeof(full), "/%s", file_name);
-        } else {
-          (void)snprintf(full, sizeof(full), "%s/%s", dir_path, file_name);
-        }
-        if (!is_safe_path_local(full)) {
-          http_close_connection(conn);
-          return -1;
-        }
+      char dir_path[1024];
+      char file_name[256];
+      if ((get_query_param(uri, "path", dir_path, sizeof(dir_path)) != 0) ||
+          (get_query_param(uri, "name", file_name, sizeof(file_name)) != 0)) {
+        http_close_connection(conn);
+        return -1;
+      }
+      if (!is_safe_path_local(dir_path) ||
+          !is_safe_filename_local(file_name)) {
+        http_close_connection(conn);
+        return -1;
+      }
 
-        /*
-         * VULN-02 fix: confine upload path to the HTTP root
-         *
-         *   is_safe_path_local()  blocks ".." and "//"
-         *   http_api_get_root()   confines to server root directory
-         */
-        {
-          const char *http_root = http_api_get_root();
-          if (http_root[0] != '\0') {
-            size_t rlen = strlen(http_root);
-            /* root "/" allows everything */
-            if (!(rlen == 1U && http_root[0] == '/')) {
-              if (strncmp(full, http_root, rlen) != 0 ||
-                  (full[rlen] != '/' && full[rlen] != '\0')) {
-                http_close_connection(conn);
-                return -1;
-              }
-            }
-          }
-        }
+      char full[1024];
+      if (strcmp(dir_path, "/") == 0) {
+        (void)snprintf(full, sizeof(full), "/%s", file_name);
+      } else {
+        (void)snprintf(full, sizeof(full), "%s/%s", dir_path, file_name);
+      }
+      if (!is_safe_path_local(full)) {
+        http_close_connection(conn);
+        return -1;
+      }
 
-        /* Create intermediate directories if needed (for folder uploads) */
-        char dir_buf[1024];
-        const char *last_slash = strrchr(full, '/');
-        if (last_slash != NULL && last_slash != full) {
-          size_t dir_len = (size_t)(last_slash - full);
-          if (dir_len < sizeof(dir_buf)) {
-            strncpy(dir_buf, full, dir_len);
-            dir_buf[dir_len] = '\0';
-            if (mkdir_recursive(dir_buf) != 0) {
-              /* Directory creation failed — send HTTP 500 error */
-              http_response_t *resp = http_response_create(HTTP_STATUS_500_INTERNAL_ERROR);
-              if (resp != NULL) {
-                http_response_add_header(resp, "Content-Type", "application/json");
-                http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
-                const char *body = "{\"error\":\"Failed to create directory\"}";
-                http_response_set_body(resp, body, strlen(body));
-                if (resp->used > 0) {
-                  (void)write(conn->fd, resp->data, resp->used);
-                }
-                http_response_destroy(resp);
-              }
+      /*
+       * VULN-02 fix: confine upload path to the HTTP root
+       *
+       *   is_safe_path_local()  blocks ".." and "//"
+       *   http_api_get_root()   confines to server root directory
+       */
+      {
+        const char *http_root = http_api_get_root();
+        if (http_root[0] != '\0') {
+          size_t rlen = strlen(http_root);
+          /* root "/" allows everything */
+          if (!(rlen == 1U && http_root[0] == '/')) {
+            if (strncmp(full, http_root, rlen) != 0 ||
+                (full[rlen] != '/' && full[rlen] != '\0')) {
               http_close_connection(conn);
               return -1;
             }
           }
         }
+      }
 
-        int out_fd = pal_file_open(full, O_WRONLY | O_CREAT | O_TRUNC, 0666);
-        if (out_fd < 0) {
-          http_response_t *resp = http_response_create(HTTP_STATUS_500_INTERNAL_ERROR);
-          if (resp != NULL) {
-            http_response_add_header(resp, "Content-Type", "application/json");
-            http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
-            const char *body = "{\"error\":\"Failed to open file for writing\"}";
-            http_response_set_body(resp, body, strlen(body));
-            if (resp->used > 0) {
-              (void)write(conn->fd, resp->data, resp->used);
+      /* Create intermediate directories if needed (for folder uploads) */
+      char dir_buf[1024];
+      const char *last_slash = strrchr(full, '/');
+      if (last_slash != NULL && last_slash != full) {
+        size_t dir_len = (size_t)(last_slash - full);
+        if (dir_len < sizeof(dir_buf)) {
+          strncpy(dir_buf, full, dir_len);
+          dir_buf[dir_len] = '\0';
+          if (mkdir_recursive(dir_buf) != 0) {
+            /* Directory creation failed — send HTTP 500 error */
+            http_response_t *resp = http_response_create(HTTP_STATUS_500_INTERNAL_ERROR);
+            if (resp != NULL) {
+              http_response_add_header(resp, "Content-Type", "application/json");
+              http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
+              const char *body = "{\"error\":\"Failed to create directory\"}";
+              http_response_set_body(resp, body, strlen(body));
+              if (resp->used > 0) {
+                (void)write(conn->fd, resp->data, resp->used);
+              }
+              http_response_destroy(resp);
             }
-            http_response_destroy(resp);
-          }
-          http_close_connection(conn);
-          return -1;
-        }
-        conn->upload_fd = out_fd;
-        conn->upload_active = 1;
-
-        /*
-         * Allocate the large upload read buffer (HTTP_UPLOAD_CHUNK_SIZE =
-         * 256 KB).  If malloc fails we fall back to conn->buffer (8 KB) —
-         * correctness is preserved, only throughput is affected.
-         *
-         * The buffer is freed in http_connection_release() regardless of
-         * how the connection terminates (success, error, or timeout).
-         */
-        if (conn->upload_chunk_buf == NULL) {
-          conn->upload_chunk_buf = (uint8_t *)malloc(HTTP_UPLOAD_CHUNK_SIZE);
-          /* malloc failure is non-fatal: fallback path uses conn->buffer */
-        }
-
-        size_t in_buf = 0U;
-        if (conn->buffer_used > header_len) {
-          in_buf = conn->buffer_used - header_len;
-          if (in_buf > content_length) {
-            in_buf = content_length;
-          }
-        }
-
-        if (in_buf > 0U) {
-          if (pal_file_write_all(out_fd, conn->buffer + header_len, in_buf) <
-              0) {
             http_close_connection(conn);
             return -1;
           }
         }
+      }
 
-        conn->upload_remaining = content_length - in_buf;
-        conn->buffer_used = 0;
-        conn->buffer[0] = '\0';
-
-        if (conn->upload_remaining == 0U) {
-          (void)pal_file_close(conn->upload_fd);
-          conn->upload_fd = -1;
-          conn->upload_active = 0;
-          http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
-          if (resp != NULL) {
-            http_response_add_header(resp, "Content-Type", "application/json");
-            http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
-            const char *body = "{\"ok\":true}";
-            http_response_set_body(resp, body, strlen(body));
-            if (resp->used > 0) {
-              (void)write(conn->fd, resp->data, resp->used);
-            }
-            http_response_destroy(resp);
+      int out_fd = pal_file_open(full, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (out_fd < 0) {
+        http_response_t *resp = http_response_create(HTTP_STATUS_500_INTERNAL_ERROR);
+        if (resp != NULL) {
+          http_response_add_header(resp, "Content-Type", "application/json");
+          http_response_add_header(resp, "Access-Control-Allow-Origin", "*");
+          const char *body = "{\"error\":\"Failed to open file for writing\"}";
+          http_response_set_body(resp, body, strlen(body));
+          if (resp->used > 0) {
+            (void)write(conn->fd, resp->data, resp->used);
           }
-          http_close_connection(conn);
-          return -1;
+          http_response_destroy(resp);
         }
+        http_close_connection(conn);
+        return -1;
+      }
+      ftp_list_cache_invalidate(full);
 
-        return 0;
+      /*
+       * Body bytes that arrived with the headers go first; from here on
+       * the loop only feeds the socket into the upload's ring (or pipe)
+       * and the write-behind pool does every disk write.
+       */
+      size_t in_buf = 0U;
+      if (conn->buffer_used > header_len) {
+        in_buf = conn->buffer_used - header_len;
+        if (in_buf > content_length) {
+          in_buf = content_length;
+        }
+      }
+      conn->upload = http_upload_open(out_fd, (uint64_t)content_length,
+                                      conn->fd, conn);
+      if ((conn->upload == NULL) ||
+          (http_upload_prefill(conn->upload, conn->buffer + header_len,
+                               in_buf) != 0)) {
+        if (conn->upload == NULL) {
+          (void)pal_file_close(out_fd);
+        }
+        http_upload_reply(conn, HTTP_STATUS_503_SERVICE_UNAVAILABLE,
+                          "{\"error\":\"Upload unavailable\"}");
+        http_close_connection(conn);
+        return -1;
       }
+      conn->upload_active = 1;
+      conn->buffer_used = 0;
+      conn->buffer[0] = '\0';
+
+      return http_upload_continue(conn);
+    }
 #endif
 
-      if (content_length > 0U) {
-        /*
-         * OVERFLOW-SAFE size check.
-         *
-         * WHY: a malicious client can send
-         *   Content-Length: 18446744073709551615  (SIZE_MAX on 64-bit)
-         * Without the pre-addition guard, (header_len + SIZE_MAX) wraps to
-         * (header_len - 1) via unsigned overflow, which is LESS than the
-         * buffer limit.  Both the "too large" rejection and the "wait for
-         * more data" guard would then pass silently, dispatching a request
-         * to the handler with a fabricated body pointer.
-         *
-         * Fix: reject if content_length alone already exceeds the available
-         * space before performing the addition.  This makes overflow
-         * impossible because after the guard content_length <=
-         * (sizeof(conn->buffer) - 1), and header_len is always < that same
-         * limit (we have already confirmed \r\n\r\n fits inside the buffer).
-         *
-         * @pre  header_len > 0 (guaranteed by the strstr("\r\n\r\n") check)
-         * @post content_length + header_len <= SIZE_MAX (no wrap possible)
-         */
-        const size_t buf_limit = sizeof(conn->buffer) - 1U;
-        if (content_length > buf_limit ||
-            (header_len + content_length) > buf_limit) {
-          http_response_t *resp =
-              http_response_create(HTTP_STATUS_400_BAD_REQUEST);
-          if (resp != NULL) {
-            const char *msg = "Request too large";
-            http_response_set_body(resp, msg, strlen(msg));
-            if (resp->used > 0) {
-              (void)write(conn->fd, resp->data, resp->used);
-            }
-            http_response_destroy(resp);
+    if (content_length > 0U) {
+      /*
+       * OVERFLOW-SAFE size check.
+       *
+       * WHY: a malicious client can send
+       *   Content-Length: 18446744073709551615  (SIZE_MAX on 64-bit)
+       * Without the pre-addition guard, (header_len + SIZE_MAX) wraps to
+       * (header_len - 1) via unsigned overflow, which is LESS than the
+       * buffer limit.  Both the "too large" rejection and the "wait for
+       * more data" guard would then pass silently, dispatching a request
+       * to the handler with a fabricated body pointer.
+       *
+       * Fix: reject if content_length alone already exceeds the available
+       * space before performing the addition.  This makes overflow
+       * impossible because after the guard content_length <=
+       * (sizeof(conn->buffer) - 1), and header_len is always < that same
+       * limit (we have already confirmed \r\n\r\n fits inside the buffer).
+       *
+       * @pre  header_len > 0 (guaranteed by the strstr("\r\n\r\n") check)
+       * @post content_length + header_len <= SIZE_MAX (no wrap possible)
+       */
+      const size_t buf_limit = sizeof(conn->buffer) - 1U;
+      if (content_length > buf_limit ||
+          (header_len + content_length) > buf_limit) {
+        http_response_t *resp =
+            http_response_create(HTTP_STATUS_400_BAD_REQUEST);
+        if (resp != NULL) {
+          const char *msg = "Request too large";
+          http_response_set_body(resp, msg, strlen(msg));
+          if (resp->used > 0) {
+            (void)write(conn->fd, resp->data, resp->used);
           }
-          http_close_connection(conn);
-          return -1;
+          http_response_destroy(resp);
         }
+        http_close_connection(conn);
+        return -1;
+      }
 
-        if (conn->buffer_used < (header_len + content_length)) {
-          return 0;
-        }
+      if (conn->buffer_used < (header_len + content_length)) {
+        return 0;
       }
+    }
 
-      (void)http_handle_request(conn);
+    conn->request_len = header_len + content_length;
+    int rc = http_handle_request(conn);
+    if (rc > 0) {
+      /* A worker, the event stream or the download pump owns it now */
+      return 0;
+    }
+    if ((rc < 0) || (conn->keep_alive == 0)) {
       http_close_connection(conn);
       return -1;
     }
+    http_consume_request(conn);
   }
-
-  return 0;
 }
 
 /*===========================================================================*
  * HANDLE REQUEST — parse, route, respond
  *===========================================================================*/
 
+/**
+ * HTTP/1.1 connections persist unless the client sends
+ * "Connection: close"; HTTP/1.0 ones are closed after the response.
+ */
+static int http_wants_keep_alive(const http_request_t *request) {
+  if ((request->version_major != 1) || (request->version_minor < 1)) {
+    return 0;
+  }
+  const char *value = http_get_header(request, "Connection");
+  if (value == NULL) {
+    return 1;
+  }
+  /* Token list, e.g. "keep-alive, Upgrade" */
+  for (const char *p = value; *p != '\0'; p++) {
+    if ((strncasecmp(p, "close", 5) == 0) &&
+        ((p == value) || (p[-1] == ' ') || (p[-1] == ',')) &&
+        ((p[5] == '\0') || (p[5] == ' ') || (p[5] == ','))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * @return 1 if the request was handed to the worker pool, opened an
+ *         event stream or left a file body to the download pump, 0 once
+ *         the response has been sent inline and the connection may be
+ *         reused, -1 on error or when it must be closed
+ */
 static int http_handle_request(http_connection_t *conn) {
   http_request_t request;
-  if (http_parse_request(conn->buffer, conn->buffer_used, &request) < 0) {
+  if (http_parse_request(conn->buffer, conn->request_len, &request) < 0) {
     return -1;
   }
+  conn->keep_alive = http_wants_keep_alive(&request);
 
-  http_response_t *response = http_api_handle(&request);
-  if (response == NULL) {
-    response = http_response_create(HTTP_STATUS_500_INTERNAL_ERROR);
-    if (response == NULL) {
-      return -1;
-    }
-    const char *msg = "Internal Server Error";
-    http_response_set_body(response, msg, strlen(msg));
+  if (http_api_is_event_stream(&request)) {
+    return http_events_open(conn);
   }
 
-  /* Send response headers (+ body if no sendfile) */
-  if (response->used > 0) {
-    if (pal_send_all(conn->fd, response->data, response->used, 0) < 0) {
-      http_response_destroy(response);
-      return -1;
-    }
+  if (http_api_is_offloadable(&request) &&
+      (http_workers_submit(conn, &request) == 0)) {
+    return 1;
   }
 
-  /*
-   *  ┌────────────────────────────────────────────────────┐
-   *  │  MEMORY BODY PATH — stream embedded static assets   │
-   *  └────────────────────────────────────────────────────┘
-   */
-  if ((response->mem_seg_count > 0U) &&
-      (response->mem_seg_index < response->mem_seg_count)) {
-    while (response->mem_seg_index < response->mem_seg_count) {
-      const void *seg = response->mem_segs[response->mem_seg_index];
-      size_t seg_len = response->mem_lens[response->mem_seg_index];
-      if ((seg == NULL) || (seg_len == 0U)) {
-        response->mem_seg_index++;
-        response->mem_seg_sent = 0U;
+  int rc = http_send_response(conn, http_api_handle(&request));
+  if (rc != 0) {
+    return rc;
+  }
+  conn->last_active = time(NULL);
+  return 0;
+}
+
+/**
+ * Drop the request just answered from the front of conn->buffer,
+ * keeping any pipelined bytes that arrived behind it.
+ */
+static void http_consume_request(http_connection_t *conn) {
+  size_t len = conn->request_len;
+  if (len > conn->buffer_used) {
+    len = conn->buffer_used;
+  }
+  size_t rest = conn->buffer_used - len;
+  if (rest > 0U) {
+    memmove(conn->buffer, conn->buffer + len, rest);
+  }
+  conn->buffer_used = rest;
+  conn->buffer[rest] = '\0';
+  conn->request_len = 0U;
+}
+
+/*===========================================================================*
+ * SEND RESPONSE — headers, then memory / file / directory body
+ *===========================================================================*/
+
+/*===========================================================================*
+ * DOWNLOAD PUMP — file bodies sent without blocking the loop
+ *
+ *   headers sent ──► O_NONBLOCK, watch EVENT_WRITE
+ *        │
+ *        ▼  (each wakeup, level-triggered)
+ *   sendfile / pread+send ── EAGAIN ─────────► wait for EVENT_WRITE
+ *        │               ── quantum used ───► yield to other fds
+ *        ▼  (last byte)
+ *   blocking again, watch EVENT_READ ──► next pipelined request
+ *
+ * Every writable download gets one HTTP_DOWNLOAD_QUANTUM per loop pass,
+ * so concurrent downloads share the link and API requests on other
+ * connections are answered between two quanta.
+ *
+ * Two body paths, chosen by api_download() through sendfile_safe:
+ *
+ * PATH A: sendfile_safe == 1  (Linux, macOS, FreeBSD ufs/zfs)
+ *   pal_sendfile() → zero-copy DMA from page-cache to NIC.
+ *
+ * PATH B: sendfile_safe == 0  (PS5/PS4 exFAT, PFS, nullfs, msdosfs)
+ *   pread() + send() — explicit userspace copy.  Files inside a mounted
+ *   image (sendfile_node) always take this path, through vfs_pread().
+ *
+ *   WHY: On PS5/PS4 (FreeBSD), calling sendfile(2) on exFAT, msdosfs,
+ *   nullfs, pfsmnt or pfs vnodes dereferences a null pager function
+ *   pointer inside the kernel and causes an IMMEDIATE KERNEL PANIC.
+ *   errno is never set — execution never returns to userspace.
+ *   The EINVAL fallback in pal_sendfile() therefore never executes.
+ *   The ONLY safe solution is to never call sendfile() on these FSes.
+ *
+ *   api_download() (http_api.c) sets sendfile_safe via fstatfs() on
+ *   the open fd before returning the http_response_t to us.
+ *===========================================================================*/
+
+static int set_blocking(int fd) {
+  int flags = fcntl(fd, F_GETFL, 0);
+  if (flags < 0) {
+    return -1;
+  }
+  return fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+}
+
+/**
+ * Hand a response whose headers are out to the pump.
+ *
+ * @return 0 if the connection now waits for EVENT_WRITE, -1 otherwise
+ *         (the response stays with the caller)
+ */
+static int http_download_start(http_connection_t *conn,
+                               http_response_t *response, int framed) {
+  if (set_nonblocking(conn->fd) != 0) {
+    return -1;
+  }
+  /* Write interest only: pipelined requests wait behind the body */
+  if (event_loop_add(conn->server->loop, conn->fd, EVENT_WRITE,
+                     http_client_callback, conn) != 0) {
+    (void)set_blocking(conn->fd);
+    return -1;
+  }
+  conn->download = response;
+  conn->download_framed = framed;
+  conn->dl_len = 0U;
+  conn->dl_sent = 0U;
+  return 0;
+}
+
+/**
+ * Move up to one quantum of conn->download.
+ *
+ * @return 1 once the whole body is out, 0 on EAGAIN or an exhausted
+ *         quantum, -1 on a read or send error
+ */
+static int http_download_step(http_connection_t *conn) {
+  http_response_t *r = conn->download;
+  size_t budget = (size_t)HTTP_DOWNLOAD_QUANTUM;
+
+  while (budget > 0U) {
+    if (r->sendfile_safe) {
+      /* PATH A: zero-copy sendfile */
+      if (r->sendfile_count == 0U) {
+        return 1;
+      }
+      size_t chunk = r->sendfile_count;
+      if (chunk > (size_t)HTTP_SENDFILE_CHUNK_SIZE) {
+        chunk = (size_t)HTTP_SENDFILE_CHUNK_SIZE;
+      }
+      if (chunk > budget) {
+        chunk = budget;
+      }
+      off_t off = r->sendfile_offset;
+      errno = 0;
+      ssize_t sent = pal_sendfile(conn->fd, r->sendfile_fd, &off, chunk);
+      if (sent > 0) {
+        r->sendfile_offset = off;
+        r->sendfile_count -= (size_t)sent;
+        budget -= (size_t)sent;
+        conn->last_active = time(NULL);
         continue;
       }
-      if (response->mem_seg_sent >= seg_len) {
-        response->mem_seg_index++;
-        response->mem_seg_sent = 0U;
+      if (errno == EINTR) {
         continue;
       }
-      const unsigned char *p = (const unsigned char *)seg;
-      const unsigned char *start = p + response->mem_seg_sent;
-      size_t remaining = seg_len - response->mem_seg_sent;
-      if (pal_send_all(conn->fd, start, remaining, 0) < 0) {
-        http_response_destroy(response);
+      /* 0 without EAGAIN: the file shrank under us */
+      return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? 0 : -1;
+    }
+
+    /* PATH B: pread + send (PS5/PS4 safe) */
+    if (conn->dl_sent == conn->dl_len) {
+      if (r->sendfile_count == 0U) {
+        return 1;
+      }
+      if (conn->dl_buf == NULL) {
+        /*
+         * Heap, not stack: 2 MB would overflow the loop thread's stack
+         * on PS5.  Short on memory the transfer slows down rather than
+         * failing.
+         */
+        conn->dl_cap = (size_t)HTTP_DOWNLOAD_PREAD_CHUNK;
+        conn->dl_buf = (uint8_t *)malloc(conn->dl_cap);
+        if (conn->dl_buf == NULL) {
+          conn->dl_cap = 64U * 1024U;
+          conn->dl_buf = (uint8_t *)malloc(conn->dl_cap);
+          if (conn->dl_buf == NULL) {
+            conn->dl_cap = 0U;
+            return -1;
+          }
+        }
+      }
+      size_t want = (r->sendfile_count < conn->dl_cap) ? r->sendfile_count
+                                                       : conn->dl_cap;
+      ssize_t nr = (r->sendfile_node != NULL)
+                       ? vfs_pread(r->sendfile_node, conn->dl_buf, want,
+                                   (uint64_t)r->sendfile_offset)
+                       : pread(r->sendfile_fd, conn->dl_buf, want,
+                               r->sendfile_offset);
+      if (nr <= 0) {
+        if ((nr < 0) && (errno == EINTR)) {
+          continue;
+        }
         return -1;
       }
-      response->mem_seg_sent = seg_len;
+      conn->dl_len = (size_t)nr;
+      conn->dl_sent = 0U;
+      r->sendfile_offset += (off_t)nr;
+      r->sendfile_count -= (size_t)nr;
     }
+    ssize_t sent = send(conn->fd, conn->dl_buf + conn->dl_sent,
+                        conn->dl_len - conn->dl_sent, MSG_NOSIGNAL);
+    if (sent > 0) {
+      conn->dl_sent += (size_t)sent;
+      budget -= ((size_t)sent < budget) ? (size_t)sent : budget;
+      conn->last_active = time(NULL);
+      continue;
+    }
+    if ((sent < 0) && (errno == EINTR)) {
+      continue;
+    }
+    return ((sent < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+               ? 0
+               : -1;
+  }
+  return 0;
+}
+
+/**
+ * Loop callback for a connection with a download in progress.  Once
+ * the body is complete the connection goes back to reading requests,
+ * or closes.
+ *
+ * @return 0 while the connection lives, -1 once it has been closed
+ */
+static int http_download_resume(http_connection_t *conn) {
+  int rc = http_download_step(conn);
+  if (rc == 0) {
+    return 0;
   }
 
-  if ((response->mem_body != NULL) &&
-      (response->mem_sent < response->mem_length)) {
-    const unsigned char *p = (const unsigned char *)response->mem_body;
-    const unsigned char *start = p + response->mem_sent;
-    size_t remaining = response->mem_length - response->mem_sent;
-    if (pal_send_all(conn->fd, start, remaining, 0) < 0) {
-      http_response_destroy(response);
+  int framed = conn->download_framed;
+  http_response_destroy(conn->download); /* closes the file */
+  conn->download = NULL;
+  free(conn->dl_buf);
+  conn->dl_buf = NULL;
+  conn->dl_cap = 0U;
+  pal_socket_uncork(conn->fd);
+
+  if ((rc < 0) || (framed == 0) || (conn->keep_alive == 0) ||
+      (set_blocking(conn->fd) != 0)) {
+    http_close_connection(conn);
+    return -1;
+  }
+  conn->last_active = time(NULL);
+  http_consume_request(conn);
+  if (event_loop_add(conn->server->loop, conn->fd, EVENT_READ,
+                     http_client_callback, conn) != 0) {
+    http_close_connection(conn);
+    return -1;
+  }
+  return http_process_buffer(conn);
+}
+
+/**
+ * Write a handler's response to the client and destroy it.  A NULL
+ * response is answered with a 500.  A file body is only started here:
+ * the download pump owns the response from then on.
+ *
+ * @return 0 once sent and the connection may be reused, 1 if a file
+ *         body continues from the loop, -1 if the connection must close
+ */
+static int http_send_response(http_connection_t *conn,
+                              http_response_t *response) {
+  if (response == NULL) {
+    response = http_response_create(HTTP_STATUS_500_INTERNAL_ERROR);
+    if (response == NULL) {
       return -1;
     }
-    response->mem_sent = response->mem_length;
+    const char *msg = "Internal Server Error";
+    http_response_set_body(response, msg, strlen(msg));
   }
 
+  int framed = http_response_is_framed(response);
+  int failed = 0;
+
   /*
-   *  ┌────────────────────────────────────────┐
-   *  │  SENDFILE PATH — stream file content   │
-   *  │  Used by /api/download                 │
-   *  └────────────────────────────────────────┘
-   */
-  /*
-   *  ┌────────────────────────────────────────┐
-   *  │  SENDFILE PATH — stream file content   │
-   *  │  Used by /api/download                 │
-   *  └────────────────────────────────────────┘
+   *  ┌─────────────────────────────────────────────────────────┐
+   *  │  HEADERS + MEMORY BODY — one gathered sendmsg()          │
+   *  │  headers │ mem segments (injected HTML) │ mem_body       │
+   *  └─────────────────────────────────────────────────────────┘
    */
-  if (response->sendfile_fd >= 0) {
-    /*
-     * FILE DOWNLOAD — two paths based on filesystem safety
-     *
-     * PATH A: sendfile_safe == 1  (Linux, macOS, FreeBSD ufs/zfs)
-     *   pal_sendfile() → zero-copy DMA from page-cache to NIC.
-     *
-     * PATH B: sendfile_safe == 0  (PS5/PS4 exFAT, PFS, nullfs, msdosfs)
-     *   pread() + pal_send_all() — explicit userspace copy.
-     *
-     *   WHY: On PS5/PS4 (FreeBSD), calling sendfile(2) on exFAT, msdosfs,
-     *   nullfs, pfsmnt or pfs vnodes dereferences a null pager function
-     *   pointer inside the kernel and causes an IMMEDIATE KERNEL PANIC.
-     *   errno is never set — execution never returns to userspace.
-     *   The EINVAL fallback in pal_sendfile() therefore never executes.
-     *   The ONLY safe solution is to never call sendfile() on these FSes.
-     *
-     *   api_download() (http_api.c) sets sendfile_safe via fstatfs() on
-     *   the open fd before returning the http_response_t to us.
-     */
-    off_t  sf_offset    = (off_t)response->sendfile_offset;
-    size_t sf_remaining = response->sendfile_count;
-
-    if (response->sendfile_safe) {
-      /* PATH A: zero-copy sendfile */
-      while (sf_remaining > 0U) {
-        size_t chunk = sf_remaining;
-        if (chunk > (size_t)HTTP_SENDFILE_CHUNK_SIZE) {
-          chunk = (size_t)HTTP_SENDFILE_CHUNK_SIZE;
-        }
-        ssize_t sent = pal_sendfile(conn->fd, response->sendfile_fd,
-                                    &sf_offset, chunk);
-        if (sent < 0) { break; }
-        if (sent == 0) {
-          if (errno == EINTR) { continue; }
-          break;
-        }
-        sf_remaining -= (size_t)sent;
-      }
+  struct iovec iov[5];
+  int iovcnt = 0;
+  if (response->used > 0) {
+    iov[iovcnt].iov_base = response->data;
+    iov[iovcnt].iov_len = response->used;
+    iovcnt++;
+  }
+  for (size_t i = response->mem_seg_index; i < response->mem_seg_count; i++) {
+    size_t skip = (i == response->mem_seg_index) ? response->mem_seg_sent : 0U;
+    if ((response->mem_segs[i] == NULL) || (response->mem_lens[i] <= skip)) {
+      continue;
+    }
+    /* iov_base is not const; sendmsg() only reads it */
+    iov[iovcnt].iov_base =
+        (void *)(uintptr_t)((const unsigned char *)response->mem_segs[i] + skip);
+    iov[iovcnt].iov_len = response->mem_lens[i] - skip;
+    iovcnt++;
+  }
+  response->mem_seg_index = response->mem_seg_count;
+  response->mem_seg_sent = 0U;
+  if ((response->mem_body != NULL) &&
+      (response->mem_sent < response->mem_length)) {
+    iov[iovcnt].iov_base = (void *)(uintptr_t)(
+        (const unsigned char *)response->mem_body + response->mem_sent);
+    iov[iovcnt].iov_len = response->mem_length - response->mem_sent;
+    iovcnt++;
+    response->mem_sent = response->mem_length;
+  }
 
-    } else {
-      /* PATH B: pread + send_all (PS5/PS4 safe) */
-      /*
-       * Heap-allocate the read buffer — HTTP_DOWNLOAD_PREAD_CHUNK (2 MB)
-       * on the stack would overflow the event-loop thread's stack on PS5.
-       * On malloc failure, fall back to a small on-stack buffer so the
-       * transfer degrades in speed rather than aborting.
-       */
-      uint8_t  dl_stack[4096];
-      uint8_t *dl_buf = (uint8_t *)malloc(HTTP_DOWNLOAD_PREAD_CHUNK);
-      size_t   dl_cap = (dl_buf != NULL)
-                            ? (size_t)HTTP_DOWNLOAD_PREAD_CHUNK
-                            : sizeof(dl_stack);
-      if (dl_buf == NULL) {
-        dl_buf = dl_stack;
-      }
+  /* Hold the headers back so they share a segment with the file data */
+  int corked = 0;
+  if ((response->sendfile_fd >= 0) || (response->sendfile_node != NULL) ||
+      (response->stream_dir != NULL) || (response->stream_fill != NULL)) {
+    pal_socket_cork(conn->fd);
+    corked = 1;
+  }
 
-      int dl_err = 0;
-      while (sf_remaining > 0U) {
-        size_t  want = (sf_remaining < dl_cap) ? sf_remaining : dl_cap;
-        ssize_t nr   = pread(response->sendfile_fd, dl_buf, want,
-                             sf_offset);
-        if (nr <= 0) {
-          if ((nr < 0) && (errno == EINTR)) { continue; }
-          dl_err = 1;
-          break;
-        }
-        if (pal_send_all(conn->fd, dl_buf, (size_t)nr, 0) < 0) {
-          dl_err = 1;
-          break;
-        }
-        sf_offset    += (off_t)nr;
-        sf_remaining -= (size_t)nr;
-      }
-      (void)dl_err;
+  if ((iovcnt > 0) && (pal_sendv_all(conn->fd, iov, iovcnt, 0) < 0)) {
+    if (corked) {
+      pal_socket_uncork(conn->fd);
+    }
+    http_response_destroy(response);
+    return -1;
+  }
 
-      if (dl_buf != dl_stack) {
-        free(dl_buf);
+  /*
+   *  ┌────────────────────────────────────────────────────────┐
+   *  │  FILE BODY — /api/download, sent by the download pump  │
+   *  └────────────────────────────────────────────────────────┘
+   */
+  if ((response->sendfile_fd >= 0) || (response->sendfile_node != NULL)) {
+    if (response->sendfile_count > 0U) {
+      if (http_download_start(conn, response, framed) == 0) {
+        return 1; /* corked until the last byte; the pump uncorks */
       }
+      failed = 1;
+    }
+    if (response->sendfile_fd >= 0) {
+      close(response->sendfile_fd);
+      response->sendfile_fd = -1;
     }
-
-    close(response->sendfile_fd);
-    response->sendfile_fd = -1;
   }
 
   /*
@@ -1307,12 +2023,12 @@ static int http_handle_request(http_connection_t *conn) {
       int header_len =
           snprintf(chunk_header, sizeof(chunk_header), "%zx\r\n", pos);
 
-      if (pal_send_all(conn->fd, chunk_header, (size_t)header_len, 0) < 0)
-        break;
-      if (pal_send_all(conn->fd, buffer, pos, 0) < 0)
-        break;
-      if (pal_send_all(conn->fd, "\r\n", 2, 0) < 0)
+      if ((pal_send_all(conn->fd, chunk_header, (size_t)header_len, 0) < 0) ||
+          (pal_send_all(conn->fd, buffer, pos, 0) < 0) ||
+          (pal_send_all(conn->fd, "\r\n", 2, 0) < 0)) {
+        failed = 1;
         break;
+      }
     }
 
     closedir(dir);
@@ -1324,16 +2040,62 @@ static int http_handle_request(http_connection_t *conn) {
     char chunk_header[32];
     int header_len =
         snprintf(chunk_header, sizeof(chunk_header), "%zx\r\n", closer_len);
-    (void)pal_send_all(conn->fd, chunk_header, (size_t)header_len, 0);
-    (void)pal_send_all(conn->fd, closer, closer_len, 0);
-    (void)pal_send_all(conn->fd, "\r\n", 2, 0);
+    if ((failed == 0) &&
+        ((pal_send_all(conn->fd, chunk_header, (size_t)header_len, 0) < 0) ||
+         (pal_send_all(conn->fd, closer, closer_len, 0) < 0) ||
+         (pal_send_all(conn->fd, "\r\n", 2, 0) < 0) ||
+         /* End of stream: 0\r\n\r\n */
+         (pal_send_all(conn->fd, "0\r\n\r\n", 5, 0) < 0))) {
+      failed = 1;
+    }
+  }
 
-    /* End of stream: 0\r\n\r\n */
-    (void)pal_send_all(conn->fd, "0\r\n\r\n", 5, 0);
+  /*
+   *  ┌─────────────────────────────────────────────────────────┐
+   *  │  CHUNKED GENERATOR — handler-built state, formatted     │
+   *  │  one HTTP_STREAM_CHUNK_SIZE chunk at a time             │
+   *  └─────────────────────────────────────────────────────────┘
+   */
+  if (response->stream_fill != NULL) {
+    char *chunk = (char *)pal_scratch_get(HTTP_STREAM_CHUNK_SIZE);
+    if (chunk == NULL) {
+      failed = 1;
+    }
+    while (failed == 0) {
+      size_t n = response->stream_fill(response->stream_ctx, chunk,
+                                       HTTP_STREAM_CHUNK_SIZE);
+      if (n == 0U) {
+        if (pal_send_all(conn->fd, "0\r\n\r\n", 5, 0) < 0) {
+          failed = 1;
+        }
+        break;
+      }
+      char chunk_header[32];
+      int header_len =
+          snprintf(chunk_header, sizeof(chunk_header), "%zx\r\n", n);
+      struct iovec civ[3];
+      civ[0].iov_base = chunk_header;
+      civ[0].iov_len = (size_t)header_len;
+      civ[1].iov_base = chunk;
+      civ[1].iov_len = n;
+      civ[2].iov_base = (void *)(uintptr_t)"\r\n";
+      civ[2].iov_len = 2U;
+      if (pal_sendv_all(conn->fd, civ, 3, 0) < 0) {
+        failed = 1;
+      }
+    }
+    if (chunk != NULL) {
+      pal_scratch_put(chunk);
+    }
   }
 
+  if (corked) {
+    pal_socket_uncork(conn->fd);
+  }
   http_response_destroy(response);
-  return 0;
+
+  /* Only a complete, self-delimited response leaves the stream reusable */
+  return ((failed == 0) && (framed != 0)) ? 0 : -1;
 }
 
 /*===========================================================================*
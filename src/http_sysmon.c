@@ -0,0 +1,893 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file http_sysmon.c
+ * @brief Background sampler behind the system stats endpoints
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * RING: slot = seq % HTTP_SYSMON_HISTORY.  The sampler is the only
+ * writer; a slot's stamp is 2*seq - 1 while seq is written and 2*seq
+ * once it is complete, so a reader knows both that the copy is whole
+ * and that it is the sample it asked for.
+ *
+ * PROCESS LIST: taken on the sampler tick only while someone polls it
+ * (HTTP_SYSMON_IDLE_S).  CPU% comes from the utime + stime delta since
+ * the previous list (Linux; 0 elsewhere).
+ */
+
+#include "http_sysmon.h"
+#include "http_config.h"
+#include "pal_thread.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(PLATFORM_LINUX) && __has_include(<sys/sysinfo.h>)
+#define HAS_SYSINFO 1
+#include <sys/sysinfo.h>
+#endif
+#if defined(PLATFORM_MACOS) || defined(PLATFORM_PS4) ||                        \
+    defined(PLATFORM_PS5) || defined(PS4) || defined(PS5) ||                   \
+    defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#endif
+#if defined(PLATFORM_MACOS) || defined(__APPLE__)
+#include <mach/mach.h>
+#include <mach/vm_statistics.h>
+#include <sys/proc.h>
+#endif
+
+#if (HTTP_SYSMON_HISTORY & (HTTP_SYSMON_HISTORY - 1U)) != 0U
+#error "HTTP_SYSMON_HISTORY must be a power of two"
+#endif
+
+typedef struct {
+  atomic_uint_fast64_t stamp;
+  http_sysmon_sample_t s;
+} slot_t;
+
+/* A published process list and its readers */
+typedef struct {
+  atomic_uint refs;
+  http_sysmon_procs_t list;
+  http_sysmon_proc_t rows[];
+} procs_box_t;
+
+static slot_t g_ring[HTTP_SYSMON_HISTORY];
+static atomic_uint_fast64_t g_head;      /* seq of the newest sample */
+static atomic_int_fast64_t g_head_mono;  /* when it was taken (ms) */
+static atomic_int_fast64_t g_read_mono;  /* last sample reader (ms) */
+static atomic_int_fast64_t g_procs_mono; /* last process list reader */
+static atomic_int g_running;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_work_cv = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t g_done_cv = PTHREAD_COND_INITIALIZER;
+static int g_started;
+static int g_stop;
+static int g_kick;
+static int g_have_sampler;
+static pthread_t g_sampler;
+static unsigned g_interval_ms = HTTP_SYSMON_INTERVAL_MS;
+static procs_box_t *g_procs;  /* latest list, one reference held here */
+static uint64_t g_procs_gen;
+
+/* Previous list's CPU ticks by pid (sampler thread only) */
+static int *g_prev_pid;
+static uint64_t *g_prev_ticks;
+static size_t g_prev_n;
+static int64_t g_prev_mono;
+
+static int64_t mono_ms(void) {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
+    return 0;
+  }
+  return ((int64_t)ts.tv_sec * 1000) + (int64_t)(ts.tv_nsec / 1000000);
+}
+
+static int64_t wall_ms(void) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return ((int64_t)tv.tv_sec * 1000) + (int64_t)(tv.tv_usec / 1000);
+}
+
+/*===========================================================================*
+ * PLATFORM PROBES
+ *===========================================================================*/
+
+static int get_boot_epoch_seconds(uint64_t *out_epoch) {
+  if (out_epoch == NULL) {
+    return -1;
+  }
+
+#if defined(HAS_SYSINFO)
+  struct sysinfo info;
+  if (sysinfo(&info) != 0) {
+    return -1;
+  }
+  time_t now = time(NULL);
+  if (now < 0) {
+    return -1;
+  }
+  uint64_t now_u = (uint64_t)now;
+  uint64_t up_u = (uint64_t)info.uptime;
+  *out_epoch = (now_u >= up_u) ? (now_u - up_u) : 0U;
+  return 0;
+#elif defined(PLATFORM_MACOS) || defined(__APPLE__) ||                         \
+    defined(PLATFORM_PS4) || defined(PLATFORM_PS5) || defined(PS4) ||          \
+    defined(PS5)
+  struct timeval bt;
+  size_t sz = sizeof(bt);
+  if (sysctlbyname("kern.boottime", &bt, &sz, NULL, 0) != 0) {
+    return -1;
+  }
+  if (sz < sizeof(bt)) {
+    return -1;
+  }
+  if (bt.tv_sec < 0) {
+    return -1;
+  }
+  *out_epoch = (uint64_t)bt.tv_sec;
+  return 0;
+#else
+  (void)out_epoch;
+  return -1;
+#endif
+}
+
+static int get_cpu_temp_c(int32_t *out_c) {
+  if (out_c == NULL) {
+    return -1;
+  }
+
+#if defined(PLATFORM_PS4) || defined(PS4)
+  __attribute__((weak)) int32_t sceKernelGetCpuTemperature(
+      uint64_t *temperature);
+  if (sceKernelGetCpuTemperature != NULL) {
+    uint64_t raw = 0U;
+    int32_t rc = sceKernelGetCpuTemperature(&raw);
+    if (rc == 0) {
+      if ((raw >= 20U) && (raw <= 110U)) {
+        *out_c = (int32_t)raw;
+        return 0;
+      }
+    }
+  }
+#endif
+
+#if defined(PLATFORM_MACOS) || defined(PLATFORM_PS4) ||                        \
+    defined(PLATFORM_PS5) || defined(PS4) || defined(PS5)
+  const char *names[] = {
+      "dev.cpu.0.temperature",
+      "dev.cpu.0.coretemp.temperature",
+      "dev.cpu.0.temp",
+      "dev.amdtemp.0.temperature",
+      "dev.amdtemp.0.core0.sensor0",
+      "dev.thermal.0.temperature",
+      "hw.acpi.thermal.tz0.temperature",
+      "hw.temperature",
+      NULL,
+  };
+
+  for (size_t i = 0U; names[i] != NULL; i++) {
+    int v = 0;
+    size_t sz = sizeof(v);
+    if (sysctlbyname(names[i], &v, &sz, NULL, 0) != 0) {
+      continue;
+    }
+    if (sz != sizeof(v)) {
+      continue;
+    }
+
+    int32_t c = 0;
+    if (v > 1000) {
+      int32_t dk = (int32_t)v;
+      c = (dk - 2731 + 5) / 10;
+    } else {
+      c = (int32_t)v;
+    }
+    if ((c < -40) || (c > 200)) {
+      continue;
+    }
+    *out_c = c;
+    return 0;
+  }
+
+  return -1;
+#else
+  (void)out_c;
+  return -1;
+#endif
+}
+
+static int get_ram_stats(uint64_t *used, uint64_t *cached, uint64_t *buffers,
+                         uint64_t *free_b, uint64_t *total) {
+  if (!used || !cached || !buffers || !free_b || !total) {
+    return -1;
+  }
+  *used = 0;
+  *cached = 0;
+  *buffers = 0;
+  *free_b = 0;
+  *total = 0;
+
+#if defined(HAS_SYSINFO)
+  struct sysinfo si;
+  if (sysinfo(&si) != 0) {
+    return -1;
+  }
+  uint64_t unit = (uint64_t)si.mem_unit;
+  *total = (uint64_t)si.totalram * unit;
+  *free_b = (uint64_t)si.freeram * unit;
+  *buffers = (uint64_t)si.bufferram * unit;
+  *cached = 0; /* not in sysinfo; /proc/meminfo would give it */
+  *used = (*total > *free_b + *buffers + *cached)
+              ? (*total - *free_b - *buffers - *cached)
+              : 0U;
+  /* Try /proc/meminfo for Cached */
+  FILE *fp = fopen("/proc/meminfo", "r");
+  if (fp) {
+    char line[128];
+    while (fgets(line, sizeof(line), fp)) {
+      uint64_t v = 0;
+      if (sscanf(line, "Cached: %" SCNu64, &v) == 1) {
+        *cached = v * 1024U;
+      } else if (sscanf(line, "MemAvailable: %" SCNu64, &v) == 1) {
+        /* recalculate used from MemAvailable */
+        uint64_t avail = v * 1024U;
+        *used = (*total > avail) ? (*total - avail) : 0U;
+      }
+    }
+    fclose(fp);
+  }
+  return 0;
+#elif defined(PLATFORM_MACOS) || defined(__APPLE__)
+  /* Total physical memory */
+  uint64_t mem_total = 0;
+  size_t sz = sizeof(mem_total);
+  if (sysctlbyname("hw.memsize", &mem_total, &sz, NULL, 0) != 0) {
+    return -1;
+  }
+  *total = mem_total;
+
+  /* Page size */
+  vm_size_t page_sz = 0;
+  if (host_page_size(mach_host_self(), &page_sz) != KERN_SUCCESS) {
+    page_sz = 4096;
+  }
+
+  /* VM stats via host_statistics64 — same source as vm_stat(1) */
+  vm_statistics64_data_t vmstat;
+  mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+  if (host_statistics64(mach_host_self(), HOST_VM_INFO64,
+                        (host_info64_t)&vmstat, &count) != KERN_SUCCESS) {
+    return -1;
+  }
+
+  *free_b = (uint64_t)vmstat.free_count * (uint64_t)page_sz;
+  *used =
+      (uint64_t)(vmstat.active_count + vmstat.wire_count) * (uint64_t)page_sz;
+  *cached = (uint64_t)vmstat.inactive_count * (uint64_t)page_sz;
+  *buffers = (uint64_t)vmstat.speculative_count * (uint64_t)page_sz;
+  return 0;
+#elif defined(PLATFORM_PS4) || defined(PLATFORM_PS5) || defined(PS4) ||        \
+    defined(PS5)
+  /* PS4/PS5 FreeBSD-derived kernel */
+  uint64_t physmem = 0;
+  size_t psz = sizeof(physmem);
+  sysctlbyname("hw.physmem", &physmem, &psz, NULL, 0);
+  *total = physmem;
+
+  uint32_t page_sz32 = 16384;
+  psz = sizeof(page_sz32);
+  sysctlbyname("hw.pagesize", &page_sz32, &psz, NULL, 0);
+  uint64_t page_sz = (uint64_t)page_sz32;
+
+  uint32_t v_free = 0, v_active = 0, v_inactive = 0, v_wire = 0;
+  psz = sizeof(v_free);
+  sysctlbyname("vm.stats.vm.v_free_count", &v_free, &psz, NULL, 0);
+  psz = sizeof(v_active);
+  sysctlbyname("vm.stats.vm.v_active_count", &v_active, &psz, NULL, 0);
+  psz = sizeof(v_inactive);
+  sysctlbyname("vm.stats.vm.v_inactive_count", &v_inactive, &psz, NULL, 0);
+  psz = sizeof(v_wire);
+  sysctlbyname("vm.stats.vm.v_wire_count", &v_wire, &psz, NULL, 0);
+
+  *free_b = (uint64_t)v_free * page_sz;
+  *used = (uint64_t)(v_active + v_wire) * page_sz;
+  *cached = (uint64_t)v_inactive * page_sz;
+  *buffers = 0;
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+
+/*===========================================================================*
+ * PROCESS LIST
+ *===========================================================================*/
+
+/* Walk state of one listing */
+typedef struct {
+#if defined(PLATFORM_MACOS) || defined(__APPLE__)
+  struct kinfo_proc *procs;
+  size_t count;
+  size_t next;
+#elif defined(HAS_SYSINFO)
+  DIR *proc_dir;
+#endif
+  int unused;
+} proc_scan_t;
+
+/* Take the process snapshot (macOS) or open /proc (Linux) */
+static void proc_open(proc_scan_t *g) {
+  memset(g, 0, sizeof(*g));
+#if defined(PLATFORM_MACOS) || defined(__APPLE__)
+  /* --- macOS: use KERN_PROC sysctl (no entitlements required) --- */
+  int mib[4] = {CTL_KERN, KERN_PROC, KERN_PROC_ALL, 0};
+  size_t buf_size = 0;
+  /* First call: get required size */
+  if (sysctl(mib, 4, NULL, &buf_size, NULL, 0) == 0 && buf_size > 0) {
+    /* Over-allocate slightly to handle races */
+    buf_size += buf_size / 8;
+    g->procs = (struct kinfo_proc *)malloc(buf_size);
+    if (g->procs == NULL) {
+      return;
+    }
+    if (sysctl(mib, 4, g->procs, &buf_size, NULL, 0) == 0) {
+      g->count = buf_size / sizeof(struct kinfo_proc);
+    }
+  }
+#elif defined(HAS_SYSINFO)
+  /* --- Linux: parse /proc --- */
+  g->proc_dir = opendir("/proc");
+#endif
+}
+
+static void proc_close(proc_scan_t *g) {
+#if defined(PLATFORM_MACOS) || defined(__APPLE__)
+  free(g->procs);
+#elif defined(HAS_SYSINFO)
+  if (g->proc_dir != NULL) {
+    closedir(g->proc_dir);
+  }
+#else
+  (void)g;
+#endif
+}
+
+/* Next process into *r and its CPU ticks; 0 at the end */
+static int proc_next(proc_scan_t *g, http_sysmon_proc_t *r, uint64_t *ticks) {
+  *ticks = 0U;
+#if defined(PLATFORM_MACOS) || defined(__APPLE__)
+  while (g->next < g->count) {
+    struct kinfo_proc *kp = &g->procs[g->next++];
+    pid_t pid = kp->kp_proc.p_pid;
+    if (pid <= 0)
+      continue;
+
+    r->pid = (int)pid;
+    (void)snprintf(r->name, sizeof(r->name), "%.*s", MAXCOMLEN,
+                   kp->kp_proc.p_comm);
+    r->uid = (unsigned int)kp->kp_eproc.e_ucred.cr_uid;
+
+    /* p_stat: SSLEEP=1, SWAIT=2, SRUN=3, SIDL=4, SZOMB=5, SSTOP=6 */
+    r->status = "running";
+    if (kp->kp_proc.p_stat == 1 || kp->kp_proc.p_stat == 2)
+      r->status = "sleep";
+    else if (kp->kp_proc.p_stat == 5)
+      r->status = "zombie";
+
+    /* RSS from e_vm — not always available, use 0 as fallback */
+    r->mem_mb = 0;
+    return 1;
+  }
+#elif defined(HAS_SYSINFO)
+  struct dirent *ent;
+  while ((g->proc_dir != NULL) && ((ent = readdir(g->proc_dir)) != NULL)) {
+    /* Only numeric entries are PIDs */
+    int pid = 0;
+    int is_pid = 1;
+    for (const char *c = ent->d_name; *c; c++) {
+      if (*c < '0' || *c > '9') {
+        is_pid = 0;
+        break;
+      }
+    }
+    if (!is_pid || ent->d_name[0] == '\0')
+      continue;
+    pid = atoi(ent->d_name);
+    if (pid <= 0)
+      continue;
+
+    /* /proc/<pid>/stat */
+    char stat_path[64];
+    snprintf(stat_path, sizeof(stat_path), "/proc/%d/stat", pid);
+    FILE *f = fopen(stat_path, "r");
+    if (!f)
+      continue;
+
+    char comm[256] = "";
+    char state = '?';
+    unsigned long utime = 0;
+    unsigned long stime = 0;
+    long rss = 0;
+    unsigned int uid = 0;
+
+    /* Read comm from /proc/<pid>/status for cleaner name */
+    char status_path[64];
+    snprintf(status_path, sizeof(status_path), "/proc/%d/status", pid);
+    FILE *sf = fopen(status_path, "r");
+    if (sf) {
+      char line[256];
+      while (fgets(line, sizeof(line), sf)) {
+        if (strncmp(line, "Name:", 5) == 0) {
+          sscanf(line + 5, " %255s", comm);
+        } else if (strncmp(line, "Uid:", 4) == 0) {
+          sscanf(line + 4, " %u", &uid);
+        }
+      }
+      fclose(sf);
+    }
+
+    /* Read utime/stime/rss from stat */
+    {
+      char tmp[2048];
+      if (fgets(tmp, sizeof(tmp), f)) {
+        /* format: pid (comm) state ppid ... utime stime ... rss */
+        char *p = strrchr(tmp, ')');
+        if (p) {
+          sscanf(p + 2,
+                 " %c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u "
+                 "%lu %lu %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+                 &state, &utime, &stime, &rss);
+        }
+      }
+    }
+    fclose(f);
+
+    if (comm[0] == '\0')
+      snprintf(comm, sizeof(comm), "pid%d", pid);
+
+    r->pid = pid;
+    r->uid = uid;
+    memcpy(r->name, comm, sizeof(r->name));
+    r->mem_mb = ((uint64_t)(rss > 0 ? rss : 0) * 4096U) / (1024U * 1024U);
+    r->status = "running";
+    if (state == 'S' || state == 'D')
+      r->status = "sleep";
+    else if (state == 'Z')
+      r->status = "zombie";
+    *ticks = (uint64_t)utime + (uint64_t)stime;
+    return 1;
+  }
+#else
+  (void)g;
+  (void)r;
+#endif
+  return 0;
+}
+
+static int row_by_pid(const void *a, const void *b) {
+  int pa = ((const http_sysmon_proc_t *)a)->pid;
+  int pb = ((const http_sysmon_proc_t *)b)->pid;
+  return (pa > pb) - (pa < pb);
+}
+
+/* CPU ticks of @p pid in the previous list, or -1 */
+static int64_t prev_ticks(int pid) {
+  size_t lo = 0U;
+  size_t hi = g_prev_n;
+  while (lo < hi) {
+    size_t mid = lo + ((hi - lo) / 2U);
+    if (g_prev_pid[mid] == pid) {
+      return (int64_t)g_prev_ticks[mid];
+    }
+    if (g_prev_pid[mid] < pid) {
+      lo = mid + 1U;
+    } else {
+      hi = mid;
+    }
+  }
+  return -1;
+}
+
+static procs_box_t *list_procs(void) {
+  size_t cap = 256U;
+  procs_box_t *box = malloc(sizeof(*box) + (cap * sizeof(box->rows[0])));
+  uint64_t *ticks = malloc(cap * sizeof(*ticks));
+  if ((box == NULL) || (ticks == NULL)) {
+    free(box);
+    free(ticks);
+    return NULL;
+  }
+
+  proc_scan_t scan;
+  proc_open(&scan);
+  size_t n = 0U;
+  http_sysmon_proc_t row;
+  uint64_t t;
+  while (proc_next(&scan, &row, &t) != 0) {
+    if (n == cap) {
+      size_t ncap = cap * 2U;
+      procs_box_t *grown =
+          realloc(box, sizeof(*box) + (ncap * sizeof(box->rows[0])));
+      if (grown == NULL) {
+        break;
+      }
+      box = grown;
+      uint64_t *tgrown = realloc(ticks, ncap * sizeof(*ticks));
+      if (tgrown == NULL) {
+        break;
+      }
+      ticks = tgrown;
+      cap = ncap;
+    }
+    row.cpu = (double)t; /* ticks until sorted, see below */
+    box->rows[n++] = row;
+  }
+  proc_close(&scan);
+  qsort(box->rows, n, sizeof(box->rows[0]), row_by_pid);
+
+  int64_t now = mono_ms();
+  double hz = 100.0;
+#if defined(HAS_SYSINFO)
+  long clk = sysconf(_SC_CLK_TCK);
+  if (clk > 0) {
+    hz = (double)clk;
+  }
+#endif
+  int64_t dt = now - g_prev_mono;
+  int *pids = malloc((n + 1U) * sizeof(*pids));
+  for (size_t i = 0U; i < n; i++) {
+    http_sysmon_proc_t *r = &box->rows[i];
+    ticks[i] = (uint64_t)r->cpu;
+    int64_t before = (g_prev_mono != 0) ? prev_ticks(r->pid) : -1;
+    r->cpu = 0.0;
+    if ((before >= 0) && ((uint64_t)before <= ticks[i]) && (dt > 0)) {
+      r->cpu = ((double)(ticks[i] - (uint64_t)before) * 100000.0) /
+               (hz * (double)dt);
+    }
+    if (pids != NULL) {
+      pids[i] = r->pid;
+    }
+  }
+  free(g_prev_pid);
+  free(g_prev_ticks);
+  g_prev_pid = pids;
+  g_prev_ticks = ticks;
+  g_prev_n = (pids != NULL) ? n : 0U;
+  g_prev_mono = now;
+
+  atomic_init(&box->refs, 1U);
+  box->list.at_ms = wall_ms();
+  box->list.count = n;
+  box->list.rows = box->rows;
+  return box;
+}
+
+static void box_release(procs_box_t *box) {
+  if ((box != NULL) && (atomic_fetch_sub(&box->refs, 1U) == 1U)) {
+    free(box);
+  }
+}
+
+/*===========================================================================*
+ * SAMPLER
+ *===========================================================================*/
+
+static void take_sample(http_sysmon_sample_t *s) {
+  memset(s, 0, sizeof(*s));
+  s->at_ms = wall_ms();
+  s->ram_ok = get_ram_stats(&s->ram_used, &s->ram_cached, &s->ram_buffers,
+                            &s->ram_free, &s->ram_total);
+  s->temp_ok = get_cpu_temp_c(&s->cpu_temp);
+  s->boot_ok = get_boot_epoch_seconds(&s->boot_epoch);
+}
+
+static void publish(const http_sysmon_sample_t *s) {
+  uint64_t seq = atomic_load_explicit(&g_head, memory_order_relaxed) + 1U;
+  slot_t *slot = &g_ring[seq & (HTTP_SYSMON_HISTORY - 1U)];
+  atomic_store_explicit(&slot->stamp, (seq * 2U) - 1U, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot->s = *s;
+  slot->s.seq = seq;
+  atomic_store_explicit(&slot->stamp, seq * 2U, memory_order_release);
+  atomic_store_explicit(&g_head_mono, mono_ms(), memory_order_relaxed);
+  atomic_store_explicit(&g_head, seq, memory_order_release);
+}
+
+/* Copy sample @p seq; -1 if it was overwritten or is being written */
+static int read_slot(uint64_t seq, http_sysmon_sample_t *out) {
+  const slot_t *slot = &g_ring[seq & (HTTP_SYSMON_HISTORY - 1U)];
+  for (int tries = 0; tries < 4; tries++) {
+    uint64_t before = atomic_load_explicit(&slot->stamp, memory_order_acquire);
+    if (before != seq * 2U) {
+      return -1;
+    }
+    *out = slot->s;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->stamp, memory_order_relaxed) == before) {
+      return 0;
+    }
+  }
+  return -1;
+}
+
+static void deadline_in(struct timespec *deadline, unsigned ms) {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  uint64_t ns = ((uint64_t)tv.tv_usec * 1000U) + ((uint64_t)ms * 1000000U);
+  deadline->tv_sec = tv.tv_sec + (time_t)(ns / 1000000000U);
+  deadline->tv_nsec = (long)(ns % 1000000000U);
+}
+
+static void *sampler_main(void *arg) {
+  (void)arg;
+  const int64_t idle_ms = (int64_t)HTTP_SYSMON_IDLE_S * 1000;
+
+  pthread_mutex_lock(&g_lock);
+  while (g_stop == 0) {
+    int64_t now = mono_ms();
+    int64_t read_at = atomic_load(&g_read_mono);
+    int64_t procs_at = atomic_load(&g_procs_mono);
+    int want_procs = (procs_at != 0) && (now - procs_at <= idle_ms);
+    if ((g_kick == 0) && (want_procs == 0) &&
+        ((read_at == 0) || (now - read_at > idle_ms))) {
+      pthread_cond_wait(&g_work_cv, &g_lock); /* parked */
+      continue;
+    }
+    g_kick = 0;
+    unsigned interval = g_interval_ms;
+    pthread_mutex_unlock(&g_lock);
+
+    http_sysmon_sample_t s;
+    take_sample(&s);
+    publish(&s);
+    if (want_procs != 0) {
+      /* Stats readers need not wait for the listing */
+      pthread_mutex_lock(&g_lock);
+      pthread_cond_broadcast(&g_done_cv);
+      pthread_mutex_unlock(&g_lock);
+    }
+    procs_box_t *box = (want_procs != 0) ? list_procs() : NULL;
+
+    pthread_mutex_lock(&g_lock);
+    if (box != NULL) {
+      procs_box_t *old = g_procs;
+      g_procs = box;
+      g_procs_gen++;
+      box_release(old);
+    }
+    pthread_cond_broadcast(&g_done_cv);
+
+    struct timespec deadline;
+    deadline_in(&deadline, interval);
+    while ((g_stop == 0) && (g_kick == 0)) {
+      if (pthread_cond_timedwait(&g_work_cv, &g_lock, &deadline) ==
+          ETIMEDOUT) {
+        break;
+      }
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+  return NULL;
+}
+
+static void start_locked(void) {
+  if (g_started != 0) {
+    return;
+  }
+  g_started = 1;
+  g_stop = 0;
+  pthread_attr_t attr;
+  int have_attr = (pthread_attr_init(&attr) == 0) ? 1 : 0;
+  if (have_attr != 0) {
+    (void)pthread_attr_setstacksize(&attr, 65536U);
+  }
+  if (pal_thread_create(&g_sampler, (have_attr != 0) ? &attr : NULL,
+                        PAL_THREAD_BACKGROUND, sampler_main, NULL) == 0) {
+    g_have_sampler = 1;
+  }
+  if (have_attr != 0) {
+    (void)pthread_attr_destroy(&attr);
+  }
+  atomic_store(&g_running, 1);
+}
+
+/*
+ * Note a reader; when the newest sample is older than two periods the
+ * sampler was parked (or never ran), so wake it and wait for a new one.
+ */
+static void touch(atomic_int_fast64_t *reader) {
+  int64_t now = mono_ms();
+  atomic_store(reader, now);
+  if (atomic_load(&g_running) == 0) {
+    pthread_mutex_lock(&g_lock);
+    start_locked();
+    pthread_mutex_unlock(&g_lock);
+  }
+  uint64_t head = atomic_load_explicit(&g_head, memory_order_acquire);
+  if ((head != 0U) &&
+      (now - atomic_load(&g_head_mono) <= 2 * (int64_t)g_interval_ms)) {
+    return;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (g_have_sampler != 0) {
+    g_kick = 1;
+    pthread_cond_signal(&g_work_cv);
+    struct timespec deadline;
+    deadline_in(&deadline, HTTP_SYSMON_WAIT_MS);
+    while ((atomic_load(&g_head) == head) && (g_stop == 0)) {
+      if (pthread_cond_timedwait(&g_done_cv, &g_lock, &deadline) ==
+          ETIMEDOUT) {
+        break;
+      }
+    }
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+int http_sysmon_latest(http_sysmon_sample_t *out) {
+  if (out == NULL) {
+    return -1;
+  }
+  touch(&g_read_mono);
+  for (int tries = 0; tries < 4; tries++) {
+    uint64_t head = atomic_load_explicit(&g_head, memory_order_acquire);
+    if (head == 0U) {
+      return -1;
+    }
+    if (read_slot(head, out) == 0) {
+      return 0;
+    }
+  }
+  return -1;
+}
+
+size_t http_sysmon_history(uint64_t since, http_sysmon_sample_t *out,
+                           size_t max) {
+  if ((out == NULL) || (max == 0U)) {
+    return 0U;
+  }
+  touch(&g_read_mono);
+  uint64_t head = atomic_load_explicit(&g_head, memory_order_acquire);
+  uint64_t first = since + 1U;
+  if ((head >= HTTP_SYSMON_HISTORY) &&
+      (first < head - HTTP_SYSMON_HISTORY + 1U)) {
+    first = head - HTTP_SYSMON_HISTORY + 1U;
+  }
+  if ((head >= max) && (first < head - max + 1U)) {
+    first = head - max + 1U;
+  }
+  size_t n = 0U;
+  for (uint64_t seq = first; (seq <= head) && (seq != 0U); seq++) {
+    if (read_slot(seq, &out[n]) == 0) {
+      n++;
+    }
+  }
+  return n;
+}
+
+const http_sysmon_procs_t *http_sysmon_procs_acquire(void) {
+  int64_t now = mono_ms();
+  int64_t before = atomic_exchange(&g_procs_mono, now);
+  if (atomic_load(&g_running) == 0) {
+    pthread_mutex_lock(&g_lock);
+    start_locked();
+    pthread_mutex_unlock(&g_lock);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  /* Not listed since the last poll went idle: wait for a fresh list */
+  if ((g_procs == NULL) ||
+      (now - before > (int64_t)HTTP_SYSMON_IDLE_S * 1000)) {
+    uint64_t gen = g_procs_gen;
+    g_kick = 1;
+    pthread_cond_signal(&g_work_cv);
+    struct timespec deadline;
+    deadline_in(&deadline, HTTP_SYSMON_WAIT_MS);
+    while ((g_have_sampler != 0) && (g_procs_gen == gen) && (g_stop == 0)) {
+      if (pthread_cond_timedwait(&g_done_cv, &g_lock, &deadline) ==
+          ETIMEDOUT) {
+        break;
+      }
+    }
+  }
+  procs_box_t *box = g_procs;
+  if (box != NULL) {
+    atomic_fetch_add(&box->refs, 1U);
+  }
+  pthread_mutex_unlock(&g_lock);
+  return (box != NULL) ? &box->list : NULL;
+}
+
+void http_sysmon_procs_release(const http_sysmon_procs_t *procs) {
+  if (procs != NULL) {
+    uintptr_t box = (uintptr_t)procs - offsetof(procs_box_t, list);
+    box_release((procs_box_t *)box);
+  }
+}
+
+void http_sysmon_shutdown(void) {
+  pthread_mutex_lock(&g_lock);
+  if (g_started == 0) {
+    pthread_mutex_unlock(&g_lock);
+    return;
+  }
+  g_stop = 1;
+  pthread_cond_broadcast(&g_work_cv);
+  pthread_cond_broadcast(&g_done_cv);
+  pthread_mutex_unlock(&g_lock);
+
+  if (g_have_sampler != 0) {
+    (void)pthread_join(g_sampler, NULL);
+  }
+
+  pthread_mutex_lock(&g_lock);
+  box_release(g_procs);
+  g_procs = NULL;
+  free(g_prev_pid);
+  free(g_prev_ticks);
+  g_prev_pid = NULL;
+  g_prev_ticks = NULL;
+  g_prev_n = 0U;
+  g_prev_mono = 0;
+  for (size_t i = 0U; i < HTTP_SYSMON_HISTORY; i++) {
+    atomic_store(&g_ring[i].stamp, 0U);
+  }
+  atomic_store(&g_head, 0U);
+  atomic_store(&g_head_mono, 0);
+  atomic_store(&g_read_mono, 0);
+  atomic_store(&g_procs_mono, 0);
+  g_kick = 0;
+  g_have_sampler = 0;
+  g_started = 0;
+  atomic_store(&g_running, 0);
+  pthread_mutex_unlock(&g_lock);
+}
+
+void http_sysmon_reset(unsigned interval_ms) {
+  http_sysmon_shutdown();
+  pthread_mutex_lock(&g_lock);
+  g_interval_ms = (interval_ms != 0U) ? interval_ms : HTTP_SYSMON_INTERVAL_MS;
+  pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,1152 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file http_thumb.c
+ * @brief Downsampled game icons, cached on disk
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * PNG in:  chunks ─► IDAT ─► inflate ─► unfilter ─► RGB(A) rows
+ * PNG out: box filter ─► per-row filter (min sum of |residual|) ─►
+ *          deflate (LZ77 over a hash chain, fixed Huffman) ─► chunks
+ *
+ * The inflater follows the canonical-Huffman decoder of zlib's puff.c:
+ * small, and fast enough for a few hundred KB once per icon.
+ *
+ * CACHE: HTTP_THUMB_DIR/<fnv64(key)>-<edge>.png, written to a .tmp file
+ * and renamed into place.  A hit touches the file's mtime, which is the
+ * LRU order used when the directory grows past HTTP_THUMB_CACHE_MAX.
+ */
+
+#include "http_thumb.h"
+#include "ftp_hash.h"
+#include "http_config.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_dir[256] = HTTP_THUMB_DIR;
+static int g_sized;      /* g_total was summed from the directory */
+static uint64_t g_total; /* bytes in the cache directory */
+static atomic_uint g_tmp_seq;
+
+static const uint16_t k_len_base[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t k_len_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                        1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                        4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t k_dist_base[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const uint8_t k_dist_extra[30] = {0, 0, 0, 0, 1, 1, 2,  2,  3,  3,
+                                         4, 4, 5, 5, 6, 6, 7,  7,  8,  8,
+                                         9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static uint32_t be32(const uint8_t *p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+         ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static void put_be32(uint8_t *p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+/*===========================================================================*
+ * INFLATE
+ *===========================================================================*/
+
+typedef struct {
+  const uint8_t *in;
+  size_t in_len;
+  size_t pos;
+  uint32_t bitbuf;
+  unsigned bitcnt;
+  uint8_t *out;
+  size_t out_len;
+  size_t out_cap;
+} inf_t;
+
+typedef struct {
+  uint16_t count[16];  /* codes of each length */
+  uint16_t symbol[288]; /* symbols ordered by code */
+} huff_t;
+
+static int inf_bits(inf_t *s, unsigned need, uint32_t *v) {
+  uint32_t val = s->bitbuf;
+  while (s->bitcnt < need) {
+    if (s->pos >= s->in_len) {
+      return -1;
+    }
+    val |= (uint32_t)s->in[s->pos++] << s->bitcnt;
+    s->bitcnt += 8U;
+  }
+  s->bitbuf = (need < 32U) ? (val >> need) : 0U;
+  s->bitcnt -= need;
+  *v = val & ((1U << need) - 1U);
+  return 0;
+}
+
+static int inf_decode(inf_t *s, const huff_t *h) {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (int len = 1; len < 16; len++) {
+    uint32_t b;
+    if (inf_bits(s, 1U, &b) != 0) {
+      return -1;
+    }
+    code |= (int)b;
+    int count = h->count[len];
+    if (code - count < first) {
+      return h->symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+/* @return 0 complete, > 0 incomplete, < 0 over-subscribed */
+static int inf_construct(huff_t *h, const uint8_t *length, int n) {
+  uint16_t offs[16];
+  memset(h->count, 0, sizeof(h->count));
+  for (int sym = 0; sym < n; sym++) {
+    h->count[length[sym]]++;
+  }
+  if (h->count[0] == n) {
+    return 0;
+  }
+  int left = 1;
+  for (int len = 1; len < 16; len++) {
+    left <<= 1;
+    left -= h->count[len];
+    if (left < 0) {
+      return left;
+    }
+  }
+  offs[1] = 0;
+  for (int len = 1; len < 15; len++) {
+    offs[len + 1] = (uint16_t)(offs[len] + h->count[len]);
+  }
+  for (int sym = 0; sym < n; sym++) {
+    if (length[sym] != 0U) {
+      h->symbol[offs[length[sym]]++] = (uint16_t)sym;
+    }
+  }
+  return left;
+}
+
+static int inf_codes(inf_t *s, const huff_t *lencode, const huff_t *distcode) {
+  for (;;) {
+    int sym = inf_decode(s, lencode);
+    if (sym < 0) {
+      return -1;
+    }
+    if (sym < 256) {
+      if (s->out_len >= s->out_cap) {
+        return -1;
+      }
+      s->out[s->out_len++] = (uint8_t)sym;
+      continue;
+    }
+    if (sym == 256) {
+      return 0;
+    }
+    sym -= 257;
+    if (sym >= 29) {
+      return -1;
+    }
+    uint32_t extra;
+    if (inf_bits(s, k_len_extra[sym], &extra) != 0) {
+      return -1;
+    }
+    size_t len = (size_t)k_len_base[sym] + extra;
+    int dsym = inf_decode(s, distcode);
+    if ((dsym < 0) || (dsym >= 30) ||
+        (inf_bits(s, k_dist_extra[dsym], &extra) != 0)) {
+      return -1;
+    }
+    size_t dist = (size_t)k_dist_base[dsym] + extra;
+    if ((dist > s->out_len) || (len > s->out_cap - s->out_len)) {
+      return -1;
+    }
+    for (size_t k = 0U; k < len; k++) {
+      s->out[s->out_len] = s->out[s->out_len - dist];
+      s->out_len++;
+    }
+  }
+}
+
+static int inf_stored(inf_t *s) {
+  s->bitbuf = 0U;
+  s->bitcnt = 0U;
+  if (s->in_len - s->pos < 4U) {
+    return -1;
+  }
+  size_t len = (size_t)s->in[s->pos] | ((size_t)s->in[s->pos + 1U] << 8);
+  size_t nlen = (size_t)s->in[s->pos + 2U] | ((size_t)s->in[s->pos + 3U] << 8);
+  s->pos += 4U;
+  if ((len != (~nlen & 0xFFFFU)) || (len > s->in_len - s->pos) ||
+      (len > s->out_cap - s->out_len)) {
+    return -1;
+  }
+  memcpy(s->out + s->out_len, s->in + s->pos, len);
+  s->out_len += len;
+  s->pos += len;
+  return 0;
+}
+
+static int inf_fixed(inf_t *s) {
+  huff_t lencode;
+  huff_t distcode;
+  uint8_t lengths[288];
+  int sym = 0;
+  for (; sym < 144; sym++) {
+    lengths[sym] = 8U;
+  }
+  for (; sym < 256; sym++) {
+    lengths[sym] = 9U;
+  }
+  for (; sym < 280; sym++) {
+    lengths[sym] = 7U;
+  }
+  for (; sym < 288; sym++) {
+    lengths[sym] = 8U;
+  }
+  (void)inf_construct(&lencode, lengths, 288);
+  for (sym = 0; sym < 30; sym++) {
+    lengths[sym] = 5U;
+  }
+  (void)inf_construct(&distcode, lengths, 30);
+  return inf_codes(s, &lencode, &distcode);
+}
+
+static int inf_dynamic(inf_t *s) {
+  static const uint8_t order[19] = {16, 17, 18, 0, 8,  7, 9,  6, 10, 5,
+                                    11, 4,  12, 3, 13, 2, 14, 1, 15};
+  uint8_t lengths[320];
+  huff_t lencode;
+  huff_t distcode;
+  uint32_t v;
+  if (inf_bits(s, 5U, &v) != 0) {
+    return -1;
+  }
+  int nlen = (int)(v + 257U);
+  if (inf_bits(s, 5U, &v) != 0) {
+    return -1;
+  }
+  int ndist = (int)(v + 1U);
+  if (inf_bits(s, 4U, &v) != 0) {
+    return -1;
+  }
+  int ncode = (int)(v + 4U);
+  if ((nlen > 286) || (ndist > 30)) {
+    return -1;
+  }
+
+  int index = 0;
+  for (; index < ncode; index++) {
+    if (inf_bits(s, 3U, &v) != 0) {
+      return -1;
+    }
+    lengths[order[index]] = (uint8_t)v;
+  }
+  for (; index < 19; index++) {
+    lengths[order[index]] = 0U;
+  }
+  if (inf_construct(&lencode, lengths, 19) != 0) {
+    return -1;
+  }
+
+  index = 0;
+  while (index < nlen + ndist) {
+    int sym = inf_decode(s, &lencode);
+    if (sym < 0) {
+      return -1;
+    }
+    if (sym < 16) {
+      lengths[index++] = (uint8_t)sym;
+      continue;
+    }
+    uint8_t len = 0U;
+    uint32_t rep;
+    if (sym == 16) {
+      if ((index == 0) || (inf_bits(s, 2U, &rep) != 0)) {
+        return -1;
+      }
+      len = lengths[index - 1];
+      rep += 3U;
+    } else if (sym == 17) {
+      if (inf_bits(s, 3U, &rep) != 0) {
+        return -1;
+      }
+      rep += 3U;
+    } else {
+      if (inf_bits(s, 7U, &rep) != 0) {
+        return -1;
+      }
+      rep += 11U;
+    }
+    if ((int)rep > nlen + ndist - index) {
+      return -1;
+    }
+    while (rep-- > 0U) {
+      lengths[index++] = len;
+    }
+  }
+  if (lengths[256] == 0U) {
+    return -1;
+  }
+
+  int err = inf_construct(&lencode, lengths, nlen);
+  if ((err < 0) || ((err > 0) && (nlen - lencode.count[0] != 1))) {
+    return -1;
+  }
+  err = inf_construct(&distcode, lengths + nlen, ndist);
+  if ((err < 0) || ((err > 0) && (ndist - distcode.count[0] != 1))) {
+    return -1;
+  }
+  return inf_codes(s, &lencode, &distcode);
+}
+
+/* Raw deflate data into out[cap]; @return bytes written, -1 on error */
+static ssize_t inflate_raw(const uint8_t *in, size_t in_len, uint8_t *out,
+                           size_t cap) {
+  inf_t s;
+  memset(&s, 0, sizeof(s));
+  s.in = in;
+  s.in_len = in_len;
+  s.out = out;
+  s.out_cap = cap;
+  uint32_t last;
+  do {
+    uint32_t type;
+    if ((inf_bits(&s, 1U, &last) != 0) || (inf_bits(&s, 2U, &type) != 0)) {
+      return -1;
+    }
+    int rc = (type == 0U)   ? inf_stored(&s)
+             : (type == 1U) ? inf_fixed(&s)
+             : (type == 2U) ? inf_dynamic(&s)
+                            : -1;
+    if (rc != 0) {
+      return -1;
+    }
+  } while (last == 0U);
+  return (ssize_t)s.out_len;
+}
+
+/*===========================================================================*
+ * DEFLATE (LZ77 + fixed Huffman)
+ *===========================================================================*/
+
+#define DF_WINDOW 32768U
+#define DF_HASH_BITS 15U
+#define DF_CHAIN 32U
+#define DF_MAX_MATCH 258U
+
+typedef struct {
+  uint8_t *out;
+  size_t cap;
+  size_t n;
+  uint32_t bitbuf;
+  unsigned bitcnt;
+} bw_t;
+
+static void bw_bits(bw_t *w, uint32_t v, unsigned n) {
+  w->bitbuf |= v << w->bitcnt;
+  w->bitcnt += n;
+  while (w->bitcnt >= 8U) {
+    if (w->n < w->cap) {
+      w->out[w->n] = (uint8_t)w->bitbuf;
+    }
+    w->n++;
+    w->bitbuf >>= 8;
+    w->bitcnt -= 8U;
+  }
+}
+
+/* Huffman codes go most significant bit first */
+static void bw_code(bw_t *w, uint32_t code, unsigned len) {
+  uint32_t rev = 0U;
+  for (unsigned k = 0U; k < len; k++) {
+    rev = (rev << 1) | ((code >> k) & 1U);
+  }
+  bw_bits(w, rev, len);
+}
+
+static void df_symbol(bw_t *w, unsigned sym) {
+  if (sym < 144U) {
+    bw_code(w, 0x30U + sym, 8U);
+  } else if (sym < 256U) {
+    bw_code(w, 0x190U + (sym - 144U), 9U);
+  } else if (sym < 280U) {
+    bw_code(w, sym - 256U, 7U);
+  } else {
+    bw_code(w, 0xC0U + (sym - 280U), 8U);
+  }
+}
+
+static void df_match(bw_t *w, unsigned len, unsigned dist) {
+  unsigned i = 28U;
+  while (k_len_base[i] > len) {
+    i--;
+  }
+  df_symbol(w, 257U + i);
+  bw_bits(w, len - k_len_base[i], k_len_extra[i]);
+  unsigned d = 29U;
+  while (k_dist_base[d] > dist) {
+    d--;
+  }
+  bw_code(w, d, 5U);
+  bw_bits(w, dist - k_dist_base[d], k_dist_extra[d]);
+}
+
+static uint32_t df_hash(const uint8_t *p) {
+  uint32_t v = ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+  return (v * 2654435761U) >> (32U - DF_HASH_BITS);
+}
+
+/* One fixed-Huffman block; @return bytes written, 0 if @p cap was short */
+static size_t deflate_raw(const uint8_t *in, size_t len, uint8_t *out,
+                          size_t cap) {
+  int32_t *head = malloc(((size_t)1U << DF_HASH_BITS) * sizeof(*head));
+  int32_t *prev = malloc(DF_WINDOW * sizeof(*prev));
+  if ((head == NULL) || (prev == NULL)) {
+    free(head);
+    free(prev);
+    return 0U;
+  }
+  for (size_t k = 0U; k < ((size_t)1U << DF_HASH_BITS); k++) {
+    head[k] = -1;
+  }
+
+  bw_t w = {out, cap, 0U, 0U, 0U};
+  bw_bits(&w, 1U, 1U); /* last block */
+  bw_bits(&w, 1U, 2U); /* fixed Huffman */
+  size_t i = 0U;
+  while (i < len) {
+    unsigned best = 0U;
+    size_t best_dist = 0U;
+    if (len - i >= 3U) {
+      uint32_t h = df_hash(in + i);
+      int32_t cand = head[h];
+      size_t max = len - i;
+      if (max > DF_MAX_MATCH) {
+        max = DF_MAX_MATCH;
+      }
+      for (unsigned chain = 0U;
+           (cand >= 0) && (chain < DF_CHAIN) && (i - (size_t)cand <= DF_WINDOW);
+           chain++) {
+        const uint8_t *a = in + cand;
+        const uint8_t *b = in + i;
+        if (a[best] == b[best]) {
+          unsigned m = 0U;
+          while ((m < max) && (a[m] == b[m])) {
+            m++;
+          }
+          if (m > best) {
+            best = m;
+            best_dist = i - (size_t)cand;
+            if (m == max) {
+              break;
+            }
+          }
+        }
+        int32_t next = prev[(size_t)cand % DF_WINDOW];
+        if (next >= cand) {
+          break;
+        }
+        cand = next;
+      }
+    }
+
+    size_t step = (best >= 3U) ? best : 1U;
+    if (best >= 3U) {
+      df_match(&w, best, (unsigned)best_dist);
+    } else {
+      df_symbol(&w, in[i]);
+    }
+    for (size_t k = 0U; k < step; k++, i++) {
+      if (i + 2U < len) {
+        uint32_t h = df_hash(in + i);
+        prev[i % DF_WINDOW] = head[h];
+        head[h] = (int32_t)i;
+      }
+    }
+  }
+  df_symbol(&w, 256U);
+  bw_bits(&w, 0U, 7U); /* flush the last partial byte */
+  free(head);
+  free(prev);
+  return (w.n <= cap) ? w.n : 0U;
+}
+
+/*===========================================================================*
+ * PNG
+ *===========================================================================*/
+
+static const uint8_t k_png_sig[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+typedef struct {
+  uint32_t w;
+  uint32_t h;
+  int alpha;    /* any pixel may be transparent */
+  uint8_t *rgba; /* w * h * 4 */
+} image_t;
+
+static uint8_t paeth(uint8_t a, uint8_t b, uint8_t c) {
+  int p = (int)a + (int)b - (int)c;
+  int pa = abs(p - (int)a);
+  int pb = abs(p - (int)b);
+  int pc = abs(p - (int)c);
+  if ((pa <= pb) && (pa <= pc)) {
+    return a;
+  }
+  return (pb <= pc) ? b : c;
+}
+
+/* Undo the per-row filters in place; @p raw holds h * (1 + stride) bytes */
+static int unfilter(uint8_t *raw, uint32_t h, size_t stride, size_t bpp) {
+  const uint8_t *up = NULL;
+  for (uint32_t y = 0U; y < h; y++) {
+    uint8_t *row = raw + ((size_t)y * (stride + 1U));
+    uint8_t type = row[0];
+    uint8_t *px = row + 1;
+    for (size_t i = 0U; i < stride; i++) {
+      uint8_t a = (i >= bpp) ? px[i - bpp] : 0U;
+      uint8_t b = (up != NULL) ? up[i] : 0U;
+      uint8_t c = ((up != NULL) && (i >= bpp)) ? up[i - bpp] : 0U;
+      switch (type) {
+      case 0:
+        break;
+      case 1:
+        px[i] = (uint8_t)(px[i] + a);
+        break;
+      case 2:
+        px[i] = (uint8_t)(px[i] + b);
+        break;
+      case 3:
+        px[i] = (uint8_t)(px[i] + (uint8_t)(((unsigned)a + b) / 2U));
+        break;
+      case 4:
+        px[i] = (uint8_t)(px[i] + paeth(a, b, c));
+        break;
+      default:
+        return -1;
+      }
+    }
+    up = px;
+  }
+  return 0;
+}
+
+static int png_decode(const uint8_t *png, size_t len, image_t *img) {
+  if ((len < sizeof(k_png_sig)) ||
+      (memcmp(png, k_png_sig, sizeof(k_png_sig)) != 0)) {
+    return -1;
+  }
+  uint32_t w = 0U;
+  uint32_t h = 0U;
+  uint8_t ctype = 0U;
+  uint8_t palette[256][4];
+  uint32_t pal_n = 0U;
+  int trns = 0;
+  uint16_t trns_key[3] = {0U, 0U, 0U};
+  uint8_t *idat = NULL;
+  size_t idat_len = 0U;
+  int ok = 0;
+
+  for (size_t k = 0U; k < 256U; k++) {
+    palette[k][0] = palette[k][1] = palette[k][2] = 0U;
+    palette[k][3] = 255U;
+  }
+
+  size_t pos = sizeof(k_png_sig);
+  while (len - pos >= 12U) {
+    uint32_t clen = be32(png + pos);
+    const uint8_t *type = png + pos + 4U;
+    const uint8_t *data = png + pos + 8U;
+    if (clen > len - pos - 12U) {
+      break;
+    }
+    if (memcmp(type, "IHDR", 4) == 0) {
+      if ((clen < 13U) || (data[8] != 8U) || (data[10] != 0U) ||
+          (data[11] != 0U) || (data[12] != 0U)) {
+        break; /* only 8-bit, deflate, standard filters, not interlaced */
+      }
+      w = be32(data);
+      h = be32(data + 4);
+      ctype = data[9];
+      if ((w == 0U) || (h == 0U) || (w > HTTP_THUMB_MAX_SRC) ||
+          (h > HTTP_THUMB_MAX_SRC) ||
+          ((ctype != 0U) && (ctype != 2U) && (ctype != 3U) && (ctype != 4U) &&
+           (ctype != 6U))) {
+        break;
+      }
+    } else if (memcmp(type, "PLTE", 4) == 0) {
+      pal_n = clen / 3U;
+      if (pal_n > 256U) {
+        pal_n = 256U;
+      }
+      for (uint32_t k = 0U; k < pal_n; k++) {
+        memcpy(palette[k], data + (k * 3U), 3U);
+      }
+    } else if (memcmp(type, "tRNS", 4) == 0) {
+      trns = 1;
+      if (ctype == 3U) {
+        for (uint32_t k = 0U; (k < clen) && (k < 256U); k++) {
+          palette[k][3] = data[k];
+        }
+      } else if ((ctype == 0U) && (clen >= 2U)) {
+        trns_key[0] = (uint16_t)((data[0] << 8) | data[1]);
+      } else if ((ctype == 2U) && (clen >= 6U)) {
+        for (size_t k = 0U; k < 3U; k++) {
+          trns_key[k] = (uint16_t)((data[k * 2U] << 8) | data[(k * 2U) + 1U]);
+        }
+      }
+    } else if (memcmp(type, "IDAT", 4) == 0) {
+      uint8_t *grown = realloc(idat, idat_len + clen + 1U);
+      if (grown == NULL) {
+        break;
+      }
+      idat = grown;
+      memcpy(idat + idat_len, data, clen);
+      idat_len += clen;
+    } else if (memcmp(type, "IEND", 4) == 0) {
+      ok = 1;
+      break;
+    }
+    pos += (size_t)clen + 12U;
+  }
+  if ((ok == 0) || (w == 0U) || (idat_len < 2U) ||
+      ((idat[0] & 0x0FU) != 8U) || ((idat[1] & 0x20U) != 0U) ||
+      ((((unsigned)idat[0] << 8) | idat[1]) % 31U != 0U)) {
+    free(idat);
+    return -1;
+  }
+
+  static const uint8_t k_channels[7] = {1, 0, 3, 1, 2, 0, 4};
+  size_t bpp = k_channels[ctype];
+  size_t stride = (size_t)w * bpp;
+  size_t raw_len = (size_t)h * (stride + 1U);
+  uint8_t *raw = malloc(raw_len);
+  img->rgba = malloc((size_t)w * h * 4U);
+  if ((raw == NULL) || (img->rgba == NULL) ||
+      (inflate_raw(idat + 2, idat_len - 2U, raw, raw_len) != (ssize_t)raw_len) ||
+      (unfilter(raw, h, stride, bpp) != 0)) {
+    free(idat);
+    free(raw);
+    free(img->rgba);
+    img->rgba = NULL;
+    return -1;
+  }
+  free(idat);
+
+  img->w = w;
+  img->h = h;
+  img->alpha = (ctype == 4U) || (ctype == 6U) || (trns != 0);
+  for (uint32_t y = 0U; y < h; y++) {
+    const uint8_t *s = raw + ((size_t)y * (stride + 1U)) + 1U;
+    uint8_t *d = img->rgba + ((size_t)y * w * 4U);
+    for (uint32_t x = 0U; x < w; x++, s += bpp, d += 4) {
+      switch (ctype) {
+      case 0:
+        d[0] = d[1] = d[2] = s[0];
+        d[3] = ((trns != 0) && (s[0] == trns_key[0])) ? 0U : 255U;
+        break;
+      case 2:
+        memcpy(d, s, 3U);
+        d[3] = ((trns != 0) && (s[0] == trns_key[0]) && (s[1] == trns_key[1]) &&
+                (s[2] == trns_key[2]))
+                   ? 0U
+                   : 255U;
+        break;
+      case 3:
+        memcpy(d, palette[s[0]], 4U);
+        break;
+      case 4:
+        d[0] = d[1] = d[2] = s[0];
+        d[3] = s[1];
+        break;
+      default:
+        memcpy(d, s, 4U);
+        break;
+      }
+    }
+  }
+  free(raw);
+  return 0;
+}
+
+/* Box filter; colour is weighted by alpha so transparent edges stay clean */
+static int downsample(const image_t *src, uint32_t dw, uint32_t dh,
+                      image_t *dst) {
+  dst->rgba = malloc((size_t)dw * dh * 4U);
+  if (dst->rgba == NULL) {
+    return -1;
+  }
+  dst->w = dw;
+  dst->h = dh;
+  dst->alpha = src->alpha;
+  for (uint32_t y = 0U; y < dh; y++) {
+    uint32_t y0 = (uint32_t)(((uint64_t)y * src->h) / dh);
+    uint32_t y1 = (uint32_t)(((uint64_t)(y + 1U) * src->h) / dh);
+    if (y1 <= y0) {
+      y1 = y0 + 1U;
+    }
+    for (uint32_t x = 0U; x < dw; x++) {
+      uint32_t x0 = (uint32_t)(((uint64_t)x * src->w) / dw);
+      uint32_t x1 = (uint32_t)(((uint64_t)(x + 1U) * src->w) / dw);
+      if (x1 <= x0) {
+        x1 = x0 + 1U;
+      }
+      uint64_t sum[3] = {0U, 0U, 0U};
+      uint64_t asum = 0U;
+      for (uint32_t sy = y0; sy < y1; sy++) {
+        const uint8_t *p = src->rgba + (((size_t)sy * src->w) + x0) * 4U;
+        for (uint32_t sx = x0; sx < x1; sx++, p += 4) {
+          sum[0] += (uint64_t)p[0] * p[3];
+          sum[1] += (uint64_t)p[1] * p[3];
+          sum[2] += (uint64_t)p[2] * p[3];
+          asum += p[3];
+        }
+      }
+      uint64_t n = (uint64_t)(x1 - x0) * (y1 - y0);
+      uint8_t *d = dst->rgba + (((size_t)y * dw) + x) * 4U;
+      for (size_t c = 0U; c < 3U; c++) {
+        d[c] = (uint8_t)((asum != 0U) ? ((sum[c] + (asum / 2U)) / asum) : 0U);
+      }
+      d[3] = (uint8_t)((asum + (n / 2U)) / n);
+    }
+  }
+  return 0;
+}
+
+static uint32_t adler32(const uint8_t *p, size_t len) {
+  uint32_t a = 1U;
+  uint32_t b = 0U;
+  while (len > 0U) {
+    size_t n = (len > 5552U) ? 5552U : len; /* no overflow before % */
+    len -= n;
+    while (n-- > 0U) {
+      a += *p++;
+      b += a;
+    }
+    a %= 65521U;
+    b %= 65521U;
+  }
+  return (b << 16) | a;
+}
+
+static uint8_t *put_chunk(uint8_t *p, const char *type, const uint8_t *data,
+                          uint32_t len) {
+  ftp_hash_ctx_t ctx;
+  uint8_t crc[FTP_HASH_MAX_DIGEST];
+  put_be32(p, len);
+  memcpy(p + 4, type, 4U);
+  if (len > 0U) {
+    memmove(p + 8, data, len);
+  }
+  ftp_hash_init(&ctx, FTP_HASH_CRC32);
+  ftp_hash_update(&ctx, p + 4, (size_t)len + 4U);
+  ftp_hash_final(&ctx, crc);
+  memcpy(p + 8 + len, crc, 4U);
+  return p + 12 + len;
+}
+
+static int png_encode(const image_t *img, uint8_t **out, size_t *out_len) {
+  size_t bpp = (img->alpha != 0) ? 4U : 3U;
+  size_t stride = (size_t)img->w * bpp;
+  size_t raw_len = (size_t)img->h * (stride + 1U);
+  uint8_t *raw = malloc(raw_len);
+  uint8_t *cur = malloc(stride);
+  uint8_t *prev = calloc(1U, stride);
+  uint8_t *trial = malloc(stride);
+  int rc = -1;
+  uint8_t *png = NULL;
+  if ((raw == NULL) || (cur == NULL) || (prev == NULL) || (trial == NULL)) {
+    goto done;
+  }
+
+  for (uint32_t y = 0U; y < img->h; y++) {
+    const uint8_t *s = img->rgba + ((size_t)y * img->w * 4U);
+    for (uint32_t x = 0U; x < img->w; x++) {
+      memcpy(cur + ((size_t)x * bpp), s + ((size_t)x * 4U), bpp);
+    }
+    /* Pick the filter whose residuals are smallest as signed bytes */
+    uint8_t *row = raw + ((size_t)y * (stride + 1U));
+    uint64_t best = UINT64_MAX;
+    for (uint8_t type = 0U; type < 5U; type++) {
+      uint64_t cost = 0U;
+      for (size_t i = 0U; i < stride; i++) {
+        uint8_t a = (i >= bpp) ? cur[i - bpp] : 0U;
+        uint8_t b = (y > 0U) ? prev[i] : 0U;
+        uint8_t c = ((y > 0U) && (i >= bpp)) ? prev[i - bpp] : 0U;
+        uint8_t pred = (type == 0U)   ? 0U
+                       : (type == 1U) ? a
+                       : (type == 2U) ? b
+                       : (type == 3U) ? (uint8_t)(((unsigned)a + b) / 2U)
+                                      : paeth(a, b, c);
+        trial[i] = (uint8_t)(cur[i] - pred);
+        cost += (uint64_t)abs((int)(int8_t)trial[i]);
+      }
+      if (cost < best) {
+        best = cost;
+        row[0] = type;
+        memcpy(row + 1, trial, stride);
+      }
+    }
+    uint8_t *swap = prev;
+    prev = cur;
+    cur = swap;
+  }
+
+  /* signature + IHDR + IDAT header/zlib + IEND; fixed Huffman <= 9 bits/byte */
+  size_t cap = raw_len + (raw_len / 8U) + 64U;
+  png = malloc(sizeof(k_png_sig) + 25U + 12U + 6U + cap + 12U);
+  if (png == NULL) {
+    goto done;
+  }
+  uint8_t ihdr[13];
+  put_be32(ihdr, img->w);
+  put_be32(ihdr + 4, img->h);
+  ihdr[8] = 8U;
+  ihdr[9] = (img->alpha != 0) ? 6U : 2U;
+  ihdr[10] = ihdr[11] = ihdr[12] = 0U;
+  memcpy(png, k_png_sig, sizeof(k_png_sig));
+  uint8_t *p = put_chunk(png + sizeof(k_png_sig), "IHDR", ihdr, 13U);
+
+  uint8_t *z = p + 8;
+  z[0] = 0x78U;
+  z[1] = 0x01U;
+  size_t zlen = deflate_raw(raw, raw_len, z + 2, cap);
+  if (zlen == 0U) {
+    goto done;
+  }
+  put_be32(z + 2 + zlen, adler32(raw, raw_len));
+  p = put_chunk(p, "IDAT", z, (uint32_t)(zlen + 6U));
+  p = put_chunk(p, "IEND", NULL, 0U);
+
+  *out = png;
+  *out_len = (size_t)(p - png);
+  png = NULL;
+  rc = 0;
+done:
+  free(png);
+  free(raw);
+  free(cur);
+  free(prev);
+  free(trial);
+  return rc;
+}
+
+int http_thumb_scale(const uint8_t *png, size_t len, unsigned edge,
+                     uint8_t **out, size_t *out_len) {
+  image_t src;
+  image_t dst;
+  memset(&src, 0, sizeof(src));
+  memset(&dst, 0, sizeof(dst));
+  if ((png == NULL) || (out == NULL) || (out_len == NULL) || (edge == 0U) ||
+      (png_decode(png, len, &src) != 0)) {
+    return -1;
+  }
+  if ((src.w <= edge) && (src.h <= edge)) {
+    free(src.rgba);
+    return 1;
+  }
+  uint32_t dw = edge;
+  uint32_t dh = edge;
+  if (src.w > src.h) {
+    dh = (uint32_t)(((uint64_t)src.h * edge + (src.w / 2U)) / src.w);
+  } else if (src.h > src.w) {
+    dw = (uint32_t)(((uint64_t)src.w * edge + (src.h / 2U)) / src.h);
+  }
+  dw = (dw == 0U) ? 1U : dw;
+  dh = (dh == 0U) ? 1U : dh;
+  int rc = downsample(&src, dw, dh, &dst);
+  free(src.rgba);
+  if (rc == 0) {
+    rc = png_encode(&dst, out, out_len);
+  }
+  free(dst.rgba);
+  return rc;
+}
+
+/*===========================================================================*
+ * CACHE
+ *===========================================================================*/
+
+unsigned http_thumb_edge(unsigned requested) {
+  if ((requested == 0U) || (requested > HTTP_THUMB_MAX_EDGE)) {
+    return 0U;
+  }
+  if (requested <= 64U) {
+    return 64U;
+  }
+  return (requested <= 128U) ? 128U : HTTP_THUMB_MAX_EDGE;
+}
+
+static uint64_t fnv64(const char *s) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+  while (*s != '\0') {
+    h ^= (uint8_t)*s++;
+    h *= 0x100000001b3ULL;
+  }
+  return h;
+}
+
+void http_thumb_etag(const char *key, unsigned edge, char *out,
+                     size_t out_size) {
+  if ((out == NULL) || (out_size == 0U)) {
+    return;
+  }
+  (void)snprintf(out, out_size, "\"%016llx-%u\"",
+                 (unsigned long long)fnv64((key != NULL) ? key : ""), edge);
+}
+
+static int read_all(const char *path, uint8_t **data, size_t *len) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  struct stat st;
+  if ((fstat(fd, &st) != 0) || (st.st_size <= 0) ||
+      (st.st_size > (off_t)HTTP_THUMB_CACHE_MAX)) {
+    close(fd);
+    return -1;
+  }
+  uint8_t *buf = malloc((size_t)st.st_size);
+  size_t got = 0U;
+  while ((buf != NULL) && (got < (size_t)st.st_size)) {
+    ssize_t n = read(fd, buf + got, (size_t)st.st_size - got);
+    if (n <= 0) {
+      if ((n < 0) && (errno == EINTR)) {
+        continue;
+      }
+      break;
+    }
+    got += (size_t)n;
+  }
+  close(fd);
+  if ((buf == NULL) || (got != (size_t)st.st_size)) {
+    free(buf);
+    return -1;
+  }
+  *data = buf;
+  *len = got;
+  return 0;
+}
+
+typedef struct {
+  char name[40];
+  time_t mtime;
+  uint64_t size;
+} cached_t;
+
+static int cached_older(const void *a, const void *b) {
+  time_t ta = ((const cached_t *)a)->mtime;
+  time_t tb = ((const cached_t *)b)->mtime;
+  return (ta > tb) - (ta < tb);
+}
+
+/* Sum the directory and, if @p trim, drop the least recently served
+ * files down to 3/4 of the budget (hysteresis: no trim on every store). */
+static void scan_locked(int trim) {
+  DIR *d = opendir(g_dir);
+  if (d == NULL) {
+    return;
+  }
+  cached_t *list = NULL;
+  size_t n = 0U;
+  size_t cap = 0U;
+  uint64_t total = 0U;
+  struct dirent *de;
+  char path[512];
+  while ((de = readdir(d)) != NULL) {
+    size_t nlen = strlen(de->d_name);
+    if ((nlen < 5U) || (nlen >= sizeof(list->name)) ||
+        (strcmp(de->d_name + nlen - 4U, ".png") != 0)) {
+      continue;
+    }
+    struct stat st;
+    (void)snprintf(path, sizeof(path), "%s/%s", g_dir, de->d_name);
+    if ((stat(path, &st) != 0) || !S_ISREG(st.st_mode)) {
+      continue;
+    }
+    total += (uint64_t)st.st_size;
+    if (trim == 0) {
+      continue;
+    }
+    if (n == cap) {
+      size_t ncap = (cap == 0U) ? 64U : cap * 2U;
+      cached_t *grown = realloc(list, ncap * sizeof(*list));
+      if (grown == NULL) {
+        break;
+      }
+      list = grown;
+      cap = ncap;
+    }
+    memcpy(list[n].name, de->d_name, nlen + 1U);
+    list[n].mtime = st.st_mtime;
+    list[n].size = (uint64_t)st.st_size;
+    n++;
+  }
+  closedir(d);
+
+  if ((trim != 0) && (total > HTTP_THUMB_CACHE_MAX)) {
+    qsort(list, n, sizeof(*list), cached_older);
+    uint64_t goal = ((uint64_t)HTTP_THUMB_CACHE_MAX * 3U) / 4U;
+    for (size_t i = 0U; (i < n) && (total > goal); i++) {
+      (void)snprintf(path, sizeof(path), "%s/%s", g_dir, list[i].name);
+      if (unlink(path) == 0) {
+        total -= list[i].size;
+      }
+    }
+  }
+  free(list);
+  g_total = total;
+  g_sized = 1;
+}
+
+static void store(const char *path, const uint8_t *data, size_t len) {
+  char tmp[600];
+  (void)snprintf(tmp, sizeof(tmp), "%s.%u.tmp", path,
+                 atomic_fetch_add(&g_tmp_seq, 1U));
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    pthread_mutex_lock(&g_lock);
+    char parent[256];
+    (void)snprintf(parent, sizeof(parent), "%s", g_dir);
+    char *slash = strrchr(parent, '/');
+    if ((slash != NULL) && (slash != parent)) {
+      *slash = '\0';
+      (void)mkdir(parent, 0755);
+    }
+    (void)mkdir(g_dir, 0755);
+    pthread_mutex_unlock(&g_lock);
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      return;
+    }
+  }
+  size_t done = 0U;
+  while (done < len) {
+    ssize_t n = write(fd, data + done, len - done);
+    if (n <= 0) {
+      if ((n < 0) && (errno == EINTR)) {
+        continue;
+      }
+      break;
+    }
+    done += (size_t)n;
+  }
+  if ((close(fd) != 0) || (done != len) || (rename(tmp, path) != 0)) {
+    (void)unlink(tmp);
+    return;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  if (g_sized == 0) {
+    scan_locked(0); /* already counts the new file */
+  } else {
+    g_total += len;
+  }
+  if (g_total > HTTP_THUMB_CACHE_MAX) {
+    scan_locked(1);
+  }
+  pthread_mutex_unlock(&g_lock);
+}
+
+int http_thumb_get(const char *key, unsigned edge, http_thumb_load_fn load,
+                   void *user, uint8_t **data, size_t *len) {
+  if ((key == NULL) || (load == NULL) || (data == NULL) || (len == NULL)) {
+    return -1;
+  }
+  if (edge == 0U) {
+    return load(user, data, len);
+  }
+
+  char path[512];
+  path[0] = '\0';
+  pthread_mutex_lock(&g_lock);
+  if (g_dir[0] != '\0') {
+    (void)snprintf(path, sizeof(path), "%s/%016llx-%u.png", g_dir,
+                   (unsigned long long)fnv64(key), edge);
+  }
+  pthread_mutex_unlock(&g_lock);
+
+  if ((path[0] != '\0') && (read_all(path, data, len) == 0)) {
+    (void)utimes(path, NULL); /* LRU order for the trim */
+    return 0;
+  }
+
+  uint8_t *png = NULL;
+  size_t png_len = 0U;
+  if (load(user, &png, &png_len) != 0) {
+    return -1;
+  }
+  uint8_t *thumb = NULL;
+  size_t thumb_len = 0U;
+  if (http_thumb_scale(png, png_len, edge, &thumb, &thumb_len) == 0) {
+    free(png);
+    png = thumb;
+    png_len = thumb_len;
+  }
+  /* Undecodable or already small: cache it as is, it is still the answer */
+  if (path[0] != '\0') {
+    store(path, png, png_len);
+  }
+  *data = png;
+  *len = png_len;
+  return 0;
+}
+
+void http_thumb_reset(const char *dir) {
+  pthread_mutex_lock(&g_lock);
+  (void)snprintf(g_dir, sizeof(g_dir), "%s",
+                 (dir != NULL) ? dir : HTTP_THUMB_DIR);
+  g_sized = 0;
+  g_total = 0U;
+  pthread_mutex_unlock(&g_lock);
+}
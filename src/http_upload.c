@@ -0,0 +1,730 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+/**
+ * @file http_upload.c
+ * @brief Write-behind pipeline for zhttpd uploads
+ */
+
+#include "http_upload.h"
+#include "http_config.h"
+#include "pal_fileio.h"
+#include "pal_ring.h"
+#include "pal_thread.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Bytes one writer pass moves before the next upload gets a turn */
+#define UPLOAD_PASS_QUANTUM (4U * (size_t)HTTP_UPLOAD_CHUNK_SIZE)
+
+#define UPLOAD_RING 0
+#define UPLOAD_SPLICE 1
+
+struct http_upload {
+  atomic_int refs;
+  atomic_int scheduled; /* a writer pass is queued or running */
+  atomic_int paused;    /* the loop is waiting for free space */
+  atomic_int finished;  /* file closed, result valid          */
+  atomic_int result;
+  atomic_int cancel;    /* released by the loop               */
+  atomic_int mode;
+  http_upload_t *next;  /* pool queue link                    */
+
+  void *owner;
+  int sock_fd;
+  int file_fd;
+  off_t woff;           /* writer-private: next file offset   */
+  uint8_t *head;        /* prefill, written first             */
+  size_t head_len;
+
+  /* loop-private */
+  uint64_t remaining;
+  int flushing;
+  int spliced;          /* a byte went through the pipe       */
+
+  /* UPLOAD_RING */
+  int ring_ready;
+  pal_ring_t ring;
+  uint8_t *cur;
+  size_t cur_len;
+
+  /* UPLOAD_SPLICE */
+  int pipe_rd;
+  int pipe_wr;
+  size_t pipe_cap;
+  atomic_size_t in_pipe;
+  atomic_int eof;
+  int nosplice_out;     /* writer-private: filesystem refused */
+  uint8_t *bounce;
+};
+
+typedef struct {
+  http_upload_t *up;
+  int kind;
+} upload_note_t;
+
+typedef struct {
+  pthread_t threads[HTTP_UPLOAD_WRITERS > 0U ? HTTP_UPLOAD_WRITERS : 1U];
+  size_t nthreads;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  http_upload_t *head;
+  http_upload_t *tail;
+  int stop;
+  int splice;
+  int note_rd; /* watched by the loop, non-blocking */
+  int note_wr; /* written by writers, blocking */
+} upload_pool_t;
+
+static upload_pool_t g_pool = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .note_rd = -1,
+    .note_wr = -1,
+};
+
+/*===========================================================================*
+ * LIFETIME
+ *===========================================================================*/
+
+static void *slot_alloc(void *ctx) {
+  (void)ctx;
+  return malloc(HTTP_UPLOAD_CHUNK_SIZE);
+}
+
+static void slot_free(void *buf, void *ctx) {
+  (void)ctx;
+  free(buf);
+}
+
+static void upload_unref(http_upload_t *up) {
+  if (atomic_fetch_sub(&up->refs, 1) != 1) {
+    return;
+  }
+  if (up->ring_ready != 0) {
+    pal_ring_destroy(&up->ring);
+  }
+  if (up->file_fd >= 0) {
+    (void)pal_file_close(up->file_fd);
+  }
+  if (up->pipe_rd >= 0) {
+    close(up->pipe_rd);
+  }
+  if (up->pipe_wr >= 0) {
+    close(up->pipe_wr);
+  }
+  free(up->head);
+  free(up->bounce);
+  free(up);
+}
+
+static int ring_start(http_upload_t *up) {
+  pal_ring_config_t cfg;
+  memset(&cfg, 0, sizeof(cfg));
+  cfg.initial_depth = HTTP_UPLOAD_RING_DEPTH;
+  cfg.max_depth = HTTP_UPLOAD_RING_MAX_DEPTH;
+  cfg.grow_after = HTTP_UPLOAD_RING_GROW_AFTER;
+  cfg.slot_size = HTTP_UPLOAD_CHUNK_SIZE;
+  cfg.alloc = slot_alloc;
+  cfg.release = slot_free;
+  if (pal_ring_init(&up->ring, &cfg) != 0) {
+    return -1;
+  }
+  up->ring_ready = 1;
+  return 0;
+}
+
+/*===========================================================================*
+ * NOTES AND SCHEDULING
+ *===========================================================================*/
+
+static void upload_note(http_upload_t *up, int kind) {
+  upload_note_t note = {up, kind};
+  atomic_fetch_add(&up->refs, 1);
+  /* Records are far below PIPE_BUF, so each write is atomic */
+  ssize_t n;
+  do {
+    n = write(g_pool.note_wr, &note, sizeof(note));
+  } while ((n < 0) && (errno == EINTR));
+  if (n != (ssize_t)sizeof(note)) {
+    upload_unref(up);
+  }
+}
+
+static int upload_pass(http_upload_t *up);
+
+static void upload_schedule(http_upload_t *up) {
+  if (atomic_exchange(&up->scheduled, 1) != 0) {
+    return;
+  }
+  atomic_fetch_add(&up->refs, 1);
+  if (g_pool.nthreads == 0U) {
+    while (upload_pass(up) != 0) {
+    }
+    return;
+  }
+  (void)pthread_mutex_lock(&g_pool.lock);
+  up->next = NULL;
+  if (g_pool.tail != NULL) {
+    g_pool.tail->next = up;
+  } else {
+    g_pool.head = up;
+  }
+  g_pool.tail = up;
+  (void)pthread_cond_signal(&g_pool.cond);
+  (void)pthread_mutex_unlock(&g_pool.lock);
+}
+
+/*===========================================================================*
+ * WRITER SIDE
+ *===========================================================================*/
+
+static int write_at(int fd, const uint8_t *p, size_t len, off_t *off) {
+  while (len > 0U) {
+    ssize_t w = pwrite(fd, p, len, *off);
+    if (w > 0) {
+      p += (size_t)w;
+      len -= (size_t)w;
+      *off += (off_t)w;
+      continue;
+    }
+    if ((w < 0) && (errno == EINTR)) {
+      continue;
+    }
+    /* w == 0: PS4/PS5 PFS silent ENOSPC */
+    return -1;
+  }
+  return 0;
+}
+
+static void upload_finish(http_upload_t *up, int result) {
+  if (up->file_fd >= 0) {
+    if ((pal_file_close(up->file_fd) != FTP_OK) && (result == 0)) {
+      result = -1;
+    }
+    up->file_fd = -1;
+  }
+  if ((result != 0) && (up->ring_ready != 0)) {
+    pal_ring_abort(&up->ring, EIO); /* the loop stops getting slots */
+  }
+  atomic_store(&up->result, result);
+  atomic_store(&up->finished, 1);
+  if (atomic_load(&up->cancel) == 0) {
+    upload_note(up, HTTP_UPLOAD_NOTE_DONE);
+  }
+}
+
+/** @return bytes written, 0 if idle, -1 on error, -2 at end of body */
+static ssize_t pass_ring(http_upload_t *up) {
+  void *buf = NULL;
+  size_t len = 0U;
+  int rc = pal_ring_try_peek(&up->ring, &buf, &len);
+  if (rc <= 0) {
+    return (rc == 0) ? 0 : -2;
+  }
+  int ok = write_at(up->file_fd, (const uint8_t *)buf, len, &up->woff);
+  pal_ring_consume(&up->ring, buf);
+  return (ok == 0) ? (ssize_t)len : -1;
+}
+
+static ssize_t pass_splice(http_upload_t *up) {
+  int eof = atomic_load(&up->eof);
+  size_t avail = atomic_load(&up->in_pipe);
+  if (avail == 0U) {
+    return (eof != 0) ? -2 : 0;
+  }
+#if HAS_SPLICE
+  if (up->nosplice_out == 0) {
+    loff_t off = (loff_t)up->woff;
+    ssize_t out = splice(up->pipe_rd, NULL, up->file_fd, &off, avail,
+                         SPLICE_F_MOVE);
+    if (out > 0) {
+      up->woff = (off_t)off;
+      atomic_fetch_sub(&up->in_pipe, (size_t)out);
+      return out;
+    }
+    if ((out < 0) && (errno == EINTR)) {
+      return 0;
+    }
+    if ((out == 0) ||
+        ((errno != EINVAL) && (errno != ENOSYS) && (errno != EOPNOTSUPP))) {
+      return -1;
+    }
+    /* No splice_write on this filesystem: bounce what the pipe holds */
+    up->nosplice_out = 1;
+  }
+#endif
+  if (up->bounce == NULL) {
+    up->bounce = (uint8_t *)malloc(HTTP_UPLOAD_CHUNK_SIZE);
+    if (up->bounce == NULL) {
+      return -1;
+    }
+  }
+  size_t want = (avail < (size_t)HTTP_UPLOAD_CHUNK_SIZE)
+                    ? avail
+                    : (size_t)HTTP_UPLOAD_CHUNK_SIZE;
+  ssize_t r = read(up->pipe_rd, up->bounce, want);
+  if (r <= 0) {
+    return ((r < 0) && (errno == EINTR)) ? 0 : -1;
+  }
+  atomic_fetch_sub(&up->in_pipe, (size_t)r);
+  if (write_at(up->file_fd, up->bounce, (size_t)r, &up->woff) != 0) {
+    return -1;
+  }
+  return r;
+}
+
+static int upload_pending(http_upload_t *up) {
+  if ((atomic_load(&up->cancel) != 0) || (up->head != NULL)) {
+    return 1;
+  }
+  if (atomic_load(&up->mode) == UPLOAD_RING) {
+    return pal_ring_pending(&up->ring);
+  }
+  return (atomic_load(&up->in_pipe) > 0U) || (atomic_load(&up->eof) != 0);
+}
+
+/**
+ * One turn of writes for @p up.  Only one pass per upload runs at a time
+ * (the scheduled flag), and it owns one reference.
+ *
+ * @return 1 if the quantum ran out and the upload must be queued again
+ *         (still scheduled, reference kept), 0 once the reference is gone
+ */
+static int upload_pass(http_upload_t *up) {
+  size_t moved = 0U;
+  for (;;) {
+    if (atomic_load(&up->finished) != 0) {
+      break;
+    }
+    if (atomic_load(&up->cancel) != 0) {
+      upload_finish(up, -1);
+      break;
+    }
+    if (up->head != NULL) {
+      int ok = write_at(up->file_fd, up->head, up->head_len, &up->woff);
+      free(up->head);
+      up->head = NULL;
+      if (ok != 0) {
+        upload_finish(up, -1);
+        break;
+      }
+      continue;
+    }
+
+    ssize_t n = (atomic_load(&up->mode) == UPLOAD_RING) ? pass_ring(up)
+                                                         : pass_splice(up);
+    if (n < 0) {
+      upload_finish(up, (n == -2) ? 0 : -1);
+      break;
+    }
+    if (n > 0) {
+      if (atomic_exchange(&up->paused, 0) != 0) {
+        upload_note(up, HTTP_UPLOAD_NOTE_RESUME);
+      }
+      moved += (size_t)n;
+      if (moved >= UPLOAD_PASS_QUANTUM) {
+        return 1;
+      }
+      continue;
+    }
+
+    /* Idle.  Re-check after clearing the flag so a racing commit from
+     * the loop either sees it clear or is seen here. */
+    atomic_store(&up->scheduled, 0);
+    if ((upload_pending(up) == 0) ||
+        (atomic_exchange(&up->scheduled, 1) != 0)) {
+      upload_unref(up);
+      return 0;
+    }
+  }
+  atomic_store(&up->scheduled, 0);
+  upload_unref(up);
+  return 0;
+}
+
+static void *upload_writer_main(void *arg) {
+  upload_pool_t *p = (upload_pool_t *)arg;
+  for (;;) {
+    (void)pthread_mutex_lock(&p->lock);
+    while ((p->head == NULL) && (p->stop == 0)) {
+      (void)pthread_cond_wait(&p->cond, &p->lock);
+    }
+    http_upload_t *up = p->head;
+    if (up == NULL) {
+      (void)pthread_mutex_unlock(&p->lock);
+      break; /* stopping and nothing left */
+    }
+    p->head = up->next;
+    if (p->head == NULL) {
+      p->tail = NULL;
+    }
+    (void)pthread_mutex_unlock(&p->lock);
+
+    if (upload_pass(up) != 0) {
+      (void)pthread_mutex_lock(&p->lock);
+      up->next = NULL;
+      if (p->tail != NULL) {
+        p->tail->next = up;
+      } else {
+        p->head = up;
+      }
+      p->tail = up;
+      (void)pthread_mutex_unlock(&p->lock);
+    }
+  }
+  return NULL;
+}
+
+/*===========================================================================*
+ * POOL
+ *===========================================================================*/
+
+int http_upload_pool_start(unsigned writers, int splice) {
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return -1;
+  }
+  int flags = fcntl(fds[0], F_GETFL, 0);
+  (void)fcntl(fds[0], F_SETFL, flags | O_NONBLOCK);
+  g_pool.note_rd = fds[0];
+  g_pool.note_wr = fds[1];
+  g_pool.head = NULL;
+  g_pool.tail = NULL;
+  g_pool.stop = 0;
+  g_pool.splice = splice;
+  g_pool.nthreads = 0U;
+
+  if (writers > (unsigned)(sizeof(g_pool.threads) / sizeof(g_pool.threads[0]))) {
+    writers = (unsigned)(sizeof(g_pool.threads) / sizeof(g_pool.threads[0]));
+  }
+  pthread_attr_t attr;
+  if ((writers == 0U) || (pthread_attr_init(&attr) != 0)) {
+    return 0; /* inline writes */
+  }
+  (void)pthread_attr_setstacksize(&attr, (size_t)HTTP_THREAD_STACK_SIZE);
+  for (unsigned i = 0U; i < writers; i++) {
+    if (pal_thread_create(&g_pool.threads[g_pool.nthreads], &attr,
+                          PAL_THREAD_DISK, upload_writer_main, &g_pool) == 0) {
+      g_pool.nthreads++;
+    }
+  }
+  (void)pthread_attr_destroy(&attr);
+  return 0;
+}
+
+void http_upload_pool_stop(void) {
+  (void)pthread_mutex_lock(&g_pool.lock);
+  g_pool.stop = 1;
+  (void)pthread_cond_broadcast(&g_pool.cond);
+  (void)pthread_mutex_unlock(&g_pool.lock);
+  for (size_t i = 0; i < g_pool.nthreads; i++) {
+    (void)pthread_join(g_pool.threads[i], NULL);
+  }
+  g_pool.nthreads = 0U;
+
+  if (g_pool.note_rd >= 0) {
+    int kind;
+    http_upload_t *up;
+    while ((up = http_upload_next_note(&kind)) != NULL) {
+      http_upload_note_done(up);
+    }
+    close(g_pool.note_rd);
+    g_pool.note_rd = -1;
+  }
+  if (g_pool.note_wr >= 0) {
+    close(g_pool.note_wr);
+    g_pool.note_wr = -1;
+  }
+}
+
+int http_upload_notes_fd(void) { return g_pool.note_rd; }
+
+http_upload_t *http_upload_next_note(int *kind) {
+  upload_note_t note;
+  if ((g_pool.note_rd < 0) ||
+      (read(g_pool.note_rd, &note, sizeof(note)) != (ssize_t)sizeof(note))) {
+    return NULL;
+  }
+  if (kind != NULL) {
+    *kind = note.kind;
+  }
+  return note.up;
+}
+
+void http_upload_note_done(http_upload_t *up) {
+  if (up != NULL) {
+    upload_unref(up);
+  }
+}
+
+/*===========================================================================*
+ * LOOP SIDE
+ *===========================================================================*/
+
+http_upload_t *http_upload_open(int file_fd, uint64_t length, int sock_fd,
+                                void *owner) {
+  if ((file_fd < 0) || (sock_fd < 0) || (g_pool.note_wr < 0)) {
+    return NULL;
+  }
+  http_upload_t *up = (http_upload_t *)calloc(1U, sizeof(*up));
+  if (up == NULL) {
+    return NULL;
+  }
+  atomic_init(&up->refs, 1);
+  up->owner = owner;
+  up->sock_fd = sock_fd;
+  up->file_fd = file_fd;
+  up->remaining = length;
+  up->pipe_rd = -1;
+  up->pipe_wr = -1;
+
+  int mode = UPLOAD_RING;
+#if HAS_SPLICE
+  int pfd[2];
+  if ((g_pool.splice != 0) && (pipe2(pfd, O_CLOEXEC) == 0)) {
+    up->pipe_rd = pfd[0];
+    up->pipe_wr = pfd[1];
+    /* Best effort: unprivileged callers are capped by fs.pipe-max-size */
+    int sz = fcntl(pfd[1], F_SETPIPE_SZ, (int)HTTP_UPLOAD_PIPE_SIZE);
+    up->pipe_cap = (sz > 0) ? (size_t)sz : (size_t)65536U;
+    mode = UPLOAD_SPLICE;
+  }
+#endif
+  if ((mode == UPLOAD_RING) && (ring_start(up) != 0)) {
+    up->file_fd = -1; /* still the caller's */
+    upload_unref(up);
+    return NULL;
+  }
+  atomic_init(&up->mode, mode);
+
+  int flags = fcntl(sock_fd, F_GETFL, 0);
+  if (flags >= 0) {
+    (void)fcntl(sock_fd, F_SETFL, flags | O_NONBLOCK);
+  }
+  return up;
+}
+
+int http_upload_prefill(http_upload_t *up, const void *data, size_t len) {
+  if ((up == NULL) || ((uint64_t)len > up->remaining) || (up->head != NULL)) {
+    return -1;
+  }
+  if (len == 0U) {
+    return 0;
+  }
+  up->head = (uint8_t *)malloc(len);
+  if (up->head == NULL) {
+    return -1;
+  }
+  memcpy(up->head, data, len);
+  up->head_len = len;
+  up->remaining -= (uint64_t)len;
+  upload_schedule(up);
+  return 0;
+}
+
+static void ring_commit_cur(http_upload_t *up) {
+  if (up->cur_len > 0U) {
+    pal_ring_commit(&up->ring, up->cur, up->cur_len);
+  } else {
+    pal_ring_unacquire(&up->ring, up->cur);
+  }
+  up->cur = NULL;
+  up->cur_len = 0U;
+  upload_schedule(up);
+}
+
+/** @return HTTP_UPLOAD_* result, or -2 to keep receiving */
+static int feed_ring(http_upload_t *up) {
+  if (up->cur == NULL) {
+    up->cur = (uint8_t *)pal_ring_try_acquire(&up->ring);
+    if (up->cur == NULL) {
+      /* Announce the wait, then look once more: a slot freed in between
+       * would otherwise never post RESUME. */
+      atomic_store(&up->paused, 1);
+      up->cur = (uint8_t *)pal_ring_try_acquire(&up->ring);
+      if (up->cur == NULL) {
+        return HTTP_UPLOAD_PAUSED;
+      }
+      (void)atomic_exchange(&up->paused, 0);
+    }
+    up->cur_len = 0U;
+  }
+
+  size_t want = (size_t)HTTP_UPLOAD_CHUNK_SIZE - up->cur_len;
+  if ((uint64_t)want > up->remaining) {
+    want = (size_t)up->remaining;
+  }
+  ssize_t n = recv(up->sock_fd, up->cur + up->cur_len, want, MSG_DONTWAIT);
+  if (n < 0) {
+    if (errno == EINTR) {
+      return -2;
+    }
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+      /* Socket drained: hand over a partial slot if the disk is idle */
+      if ((up->cur_len > 0U) && (atomic_load(&up->scheduled) == 0)) {
+        ring_commit_cur(up);
+      }
+      return HTTP_UPLOAD_MORE;
+    }
+    return HTTP_UPLOAD_FAILED;
+  }
+  if (n == 0) {
+    return HTTP_UPLOAD_FAILED; /* client closed before the body ended */
+  }
+  up->cur_len += (size_t)n;
+  up->remaining -= (uint64_t)n;
+  if ((up->cur_len == (size_t)HTTP_UPLOAD_CHUNK_SIZE) ||
+      (up->remaining == 0U)) {
+    ring_commit_cur(up);
+    return HTTP_UPLOAD_MORE; /* one slot per wakeup */
+  }
+  return -2;
+}
+
+static int feed_splice(http_upload_t *up) {
+#if HAS_SPLICE
+  size_t want = up->pipe_cap;
+  if ((uint64_t)want > up->remaining) {
+    want = (size_t)up->remaining;
+  }
+  for (int attempt = 0;; attempt++) {
+    ssize_t n = splice(up->sock_fd, NULL, up->pipe_wr, NULL, want,
+                       SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0) {
+      if (attempt > 0) {
+        (void)atomic_exchange(&up->paused, 0);
+      }
+      up->spliced = 1;
+      up->remaining -= (uint64_t)n;
+      atomic_fetch_add(&up->in_pipe, (size_t)n);
+      upload_schedule(up);
+      return HTTP_UPLOAD_MORE;
+    }
+    if (n == 0) {
+      return HTTP_UPLOAD_FAILED;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+      if ((up->spliced == 0) && ((errno == EINVAL) || (errno == ENOSYS))) {
+        /* Socket refused before anything moved: plain ring instead */
+        if (ring_start(up) != 0) {
+          return HTTP_UPLOAD_FAILED;
+        }
+        atomic_store(&up->mode, UPLOAD_RING);
+        return -2;
+      }
+      return HTTP_UPLOAD_FAILED;
+    }
+    if (attempt > 0) {
+      return HTTP_UPLOAD_PAUSED;
+    }
+    /* EAGAIN from an empty socket or from a full pipe */
+    char probe;
+    ssize_t peek = recv(up->sock_fd, &probe, 1U, MSG_PEEK | MSG_DONTWAIT);
+    if (peek == 0) {
+      return HTTP_UPLOAD_FAILED;
+    }
+    if (peek < 0) {
+      return ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+                 ? HTTP_UPLOAD_MORE
+                 : HTTP_UPLOAD_FAILED;
+    }
+    atomic_store(&up->paused, 1);
+  }
+#else
+  (void)up;
+  return HTTP_UPLOAD_FAILED;
+#endif
+}
+
+int http_upload_feed(http_upload_t *up) {
+  if (up == NULL) {
+    return HTTP_UPLOAD_FAILED;
+  }
+  if (atomic_load(&up->finished) != 0) {
+    /* The writer gave up early; its DONE note carries the result */
+    return HTTP_UPLOAD_PAUSED;
+  }
+  while (up->remaining > 0U) {
+    int rc = (atomic_load(&up->mode) == UPLOAD_RING) ? feed_ring(up)
+                                                      : feed_splice(up);
+    if (rc != -2) {
+      if ((rc != HTTP_UPLOAD_MORE) || (up->remaining > 0U)) {
+        return rc;
+      }
+    }
+  }
+  if (up->flushing == 0) {
+    up->flushing = 1;
+    if (atomic_load(&up->mode) == UPLOAD_RING) {
+      if (up->cur != NULL) {
+        ring_commit_cur(up);
+      }
+      pal_ring_close(&up->ring);
+    } else {
+      atomic_store(&up->eof, 1);
+    }
+    upload_schedule(up);
+  }
+  return HTTP_UPLOAD_FLUSHING;
+}
+
+void *http_upload_owner(const http_upload_t *up) {
+  if ((up == NULL) || (atomic_load(&up->cancel) != 0)) {
+    return NULL;
+  }
+  return up->owner;
+}
+
+int http_upload_result(const http_upload_t *up) {
+  if ((up == NULL) || (atomic_load(&up->finished) == 0)) {
+    return -1;
+  }
+  return atomic_load(&up->result);
+}
+
+void http_upload_release(http_upload_t *up) {
+  if (up == NULL) {
+    return;
+  }
+  atomic_store(&up->cancel, 1);
+  if (up->ring_ready != 0) {
+    if (up->cur != NULL) {
+      pal_ring_unacquire(&up->ring, up->cur);
+      up->cur = NULL;
+    }
+    pal_ring_abort(&up->ring, ECANCELED);
+  }
+  /* The writer closes the file off the loop thread */
+  upload_schedule(up);
+  upload_unref(up);
+}
@@ -35,10 +35,19 @@ SOFTWARE.
  */
 
 #include "ftp_config.h"
+#include "ftp_copyjob.h"
+#include "ftp_dirsize.h"
+#include "ftp_fsprofile.h"
+#include "ftp_handoff.h"
+#include "ftp_hash.h"
+#include "ftp_list.h"
+#include "ftp_pasv_pool.h"
+#include "ftp_prefetch.h"
 #include "ftp_server.h"
 #include "pal_fileio.h"
 #include "pal_network.h"
 #include "pal_notification.h"
+#include "pal_thread.h"
 #include <errno.h>
 #include <getopt.h>
 #include <inttypes.h>
@@ -47,6 +56,7 @@ SOFTWARE.
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 /*---------------------------------------------------------------------------*
@@ -92,7 +102,8 @@ static int start_http_thread(pthread_t *thread, event_loop_t *loop) {
 
   rc = pthread_attr_setstacksize(&attr, (size_t)HTTP_THREAD_STACK_SIZE);
   if (rc == 0) {
-    rc = pthread_create(thread, &attr, http_event_loop_thread, loop);
+    rc = pal_thread_create(thread, &attr, PAL_THREAD_HTTP,
+                           http_event_loop_thread, loop);
   }
 
   (void)pthread_attr_destroy(&attr);
@@ -241,6 +252,7 @@ int main(void) {
   printf("[zftpd - ps4] Initializing...\n");
 
   (void)pal_notification_init();
+  (void)pal_thread_config(FTP_THREAD_PLACEMENT);
 
   (void)syscall(SYS_thr_set_name, -1, "zftpd.elf");
 
@@ -427,6 +439,9 @@ int main(void) {
 
   ftp_server_stop(&g_server_ctx);
   ftp_server_cleanup(&g_server_ctx);
+  ftp_copyjob_shutdown();
+  ftp_dirsize_shutdown();
+  ftp_prefetch_shutdown();
   pal_notification_shutdown();
 
   printf("[zftpd - ps4] Stopped\n");
@@ -501,6 +516,7 @@ int main(void) {
   (void)syscall(SYS_thr_set_name, -1, "zftpd.elf");
   signal(SIGPIPE, SIG_IGN);
   (void)pal_notification_init();
+  (void)pal_thread_config(FTP_THREAD_PLACEMENT);
 
   pid_t existing = find_pid_by_name("zftpd.elf");
   if (existing > 0) {
@@ -739,6 +755,9 @@ int main(void) {
 
   ftp_server_stop(&g_server_ctx);
   ftp_server_cleanup(&g_server_ctx);
+  ftp_copyjob_shutdown();
+  ftp_dirsize_shutdown();
+  ftp_prefetch_shutdown();
   pal_notification_shutdown();
 
   printf("[zftpd - ps5] Goodbye!\n");
@@ -748,6 +767,120 @@ int main(void) {
 
 #else /* POSIX / Linux */
 
+/*===========================================================================*
+ * RESTART HAND-OFF (see ftp_handoff.h)
+ *===========================================================================*/
+
+/* Old process: when the listeners went to the new one */
+static time_t g_handoff_at = 0;
+
+/* New process: listeners received, not yet claimed (-1 once claimed) */
+static ftp_handoff_set_t g_handoff_in;
+static int g_handoff_link = -1;
+
+/* Hand-off thread: persist the caches, then give up the listeners */
+static int handoff_collect(ftp_handoff_set_t *set, void *user) {
+  (void)user;
+  int fds[FTP_ACCEPT_THREADS_MAX];
+  uint32_t n = ftp_server_listeners(&g_server_ctx, fds,
+                                    (uint32_t)FTP_ACCEPT_THREADS_MAX);
+  if (n == 0U) {
+    return -1;
+  }
+  (void)ftp_list_cache_save(FTP_LIST_CACHE_SNAPSHOT);
+  ftp_dirsize_save(); /* the digest index is saved on every store */
+
+  for (uint32_t i = 0U; i < n; i++) {
+    (void)ftp_handoff_add(set, fds[i], FTP_HANDOFF_FTP);
+  }
+#if ENABLE_ZHTTPD
+  if (g_http_server != NULL) {
+    int hfd = http_server_listen_fd(g_http_server);
+    if (hfd >= 0) {
+      (void)ftp_handoff_add(set, hfd, FTP_HANDOFF_HTTP);
+    }
+  }
+#endif
+  /* Idle passive listeners fill the rest of the message */
+  int pasv[FTP_HANDOFF_FDS_MAX];
+  uint32_t np = ftp_pasv_pool_detach_idle(
+      g_server_ctx.pasv_pool, pasv, (uint32_t)FTP_HANDOFF_FDS_MAX - set->count);
+  for (uint32_t i = 0U; i < np; i++) {
+    (void)ftp_handoff_add(set, pasv[i], FTP_HANDOFF_PASV);
+  }
+  return 0;
+}
+
+static void handoff_done(const ftp_handoff_set_t *set, int adopted,
+                         void *user) {
+  (void)user;
+  int pasv[FTP_HANDOFF_FDS_MAX];
+  uint32_t np = ftp_handoff_pick(set, FTP_HANDOFF_PASV, pasv,
+                                 (uint32_t)FTP_HANDOFF_FDS_MAX);
+  for (uint32_t i = 0U; i < np; i++) {
+    if ((adopted != 0) ||
+        (ftp_pasv_pool_adopt(g_server_ctx.pasv_pool, pasv[i]) != 0)) {
+      PAL_CLOSE(pasv[i]);
+    }
+  }
+  if (adopted == 0) {
+    return;
+  }
+  g_handoff_at = time(NULL);
+  ftp_server_release_listeners(&g_server_ctx);
+#if ENABLE_ZHTTPD
+  if (g_http_server != NULL) {
+    http_server_release_listener(g_http_server);
+  }
+#endif
+}
+
+/* Main loop: stop once handed off and the sessions drained */
+static int handoff_drained(void) {
+  if (ftp_handoff_released() == 0) {
+    return 0;
+  }
+  return ((ftp_server_get_active_sessions(&g_server_ctx) == 0U) ||
+          ((time(NULL) - g_handoff_at) >= (time_t)FTP_HANDOFF_DRAIN_S))
+             ? 1
+             : 0;
+}
+
+/* Move the received fds of @p kind to the caller */
+static uint32_t handoff_claim(ftp_handoff_kind_t kind, int *fds,
+                              uint32_t max) {
+  uint32_t n = 0U;
+  for (uint32_t i = 0U; (i < g_handoff_in.count) && (n < max); i++) {
+    if ((g_handoff_in.kinds[i] == (uint8_t)kind) &&
+        (g_handoff_in.fds[i] >= 0)) {
+      fds[n++] = g_handoff_in.fds[i];
+      g_handoff_in.fds[i] = -1;
+    }
+  }
+  return n;
+}
+
+/* Close what nobody claimed, then answer the old process */
+static void handoff_finish(int adopted) {
+  for (uint32_t i = 0U; i < g_handoff_in.count; i++) {
+    if (g_handoff_in.fds[i] >= 0) {
+      PAL_CLOSE(g_handoff_in.fds[i]);
+      g_handoff_in.fds[i] = -1;
+    }
+  }
+  ftp_handoff_confirm(g_handoff_link, adopted);
+  g_handoff_link = -1;
+}
+
+/* New process: warm the caches the old one persisted */
+static void handoff_preload(void) {
+  int lists = ftp_list_cache_load(FTP_LIST_CACHE_SNAPSHOT);
+  (void)remove(FTP_LIST_CACHE_SNAPSHOT);
+  ftp_hash_cache_preload();
+  ftp_dirsize_preload();
+  printf("Caches:         %d listing(s) restored\n", (lists > 0) ? lists : 0);
+}
+
 /**
  * @brief Print usage information
  */
@@ -762,6 +895,19 @@ static void print_usage(const char *program) {
 #if ENABLE_ZHTTPD
   printf("  -w PORT       HTTP listen port (default: %u)\n", HTTP_DEFAULT_PORT);
 #endif
+#if FTP_ENABLE_TLS
+  printf("  -c CERT       PEM certificate, enables AUTH TLS (FTPS)\n");
+  printf("  -k KEY        PEM private key (default: read from CERT)\n");
+#endif
+  printf("  -E            Event-driven sessions (poll loops + I/O pool)\n");
+  printf("  -A N          Control-port acceptor threads (SO_REUSEPORT, max %u)\n",
+         (unsigned)FTP_ACCEPT_THREADS_MAX);
+  printf("  -B N          Control-port listen backlog (default: %u)\n",
+         (unsigned)FTP_LISTEN_BACKLOG);
+  printf("  -F FILE       Filesystem I/O profiles (default: %s)\n",
+         FTP_FS_PROFILE_PATH);
+  printf("  -R            Take over the listeners of a running instance\n");
+  printf("  -T SPEC       Thread placement, e.g. \"data=2-3/-5 disk=4\"\n");
   printf("  -h            Show this help message\n");
   printf("\n");
   printf("Example:\n");
@@ -775,9 +921,17 @@ static void print_usage(const char *program) {
 int main(int argc, char **argv) {
   uint16_t port = FTP_DEFAULT_PORT;
   char root_path[FTP_PATH_MAX];
+  int event_engine = FTP_SESSION_ENGINE_EVENT;
+  uint32_t acceptors = FTP_ACCEPT_THREADS;
+  uint32_t backlog = FTP_LISTEN_BACKLOG;
+  int take_over = 0;
 #if ENABLE_ZHTTPD
   uint16_t http_port = HTTP_DEFAULT_PORT;
 #endif
+#if FTP_ENABLE_TLS
+  const char *tls_cert = NULL;
+  const char *tls_key = NULL;
+#endif
 
   /* Get current directory as default */
   if (getcwd(root_path, sizeof(root_path)) == NULL) {
@@ -785,13 +939,23 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+  (void)pal_thread_config(FTP_THREAD_PLACEMENT);
+
   /* Parse command-line arguments */
   int opt;
 #if ENABLE_ZHTTPD
-  while ((opt = getopt(argc, argv, "p:d:w:h")) != -1) {
+#define MAIN_OPTS_HTTP "w:"
 #else
-  while ((opt = getopt(argc, argv, "p:d:h")) != -1) {
+#define MAIN_OPTS_HTTP ""
 #endif
+#if FTP_ENABLE_TLS
+#define MAIN_OPTS_TLS "c:k:"
+#else
+#define MAIN_OPTS_TLS ""
+#endif
+  while ((opt = getopt(argc, argv,
+                       "p:d:EA:B:F:RT:" MAIN_OPTS_HTTP MAIN_OPTS_TLS "h")) !=
+         -1) {
     switch (opt) {
     case 'p': {
       long port_arg = strtol(optarg, NULL, 10);
@@ -811,6 +975,46 @@ int main(int argc, char **argv) {
       memcpy(root_path, optarg, len + 1U);
     } break;
 
+    case 'E':
+      event_engine = 1;
+      break;
+
+    case 'A': {
+      long n = strtol(optarg, NULL, 10);
+      if ((n <= 0) || (n > (long)FTP_ACCEPT_THREADS_MAX)) {
+        fprintf(stderr, "Error: Invalid acceptor count: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      acceptors = (uint32_t)n;
+    } break;
+
+    case 'B': {
+      long n = strtol(optarg, NULL, 10);
+      if ((n <= 0) || (n > 65535)) {
+        fprintf(stderr, "Error: Invalid backlog: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      backlog = (uint32_t)n;
+    } break;
+
+    case 'F':
+      if (ftp_fs_profile_reset(optarg) < 0) {
+        fprintf(stderr, "Error: Cannot read profiles: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+
+    case 'R':
+      take_over = 1;
+      break;
+
+    case 'T':
+      if (pal_thread_config(optarg) < 0) {
+        fprintf(stderr, "Error: Invalid thread placement: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+
 #if ENABLE_ZHTTPD
     case 'w': {
       long wp = strtol(optarg, NULL, 10);
@@ -822,6 +1026,16 @@ int main(int argc, char **argv) {
     } break;
 #endif
 
+#if FTP_ENABLE_TLS
+    case 'c':
+      tls_cert = optarg;
+      break;
+
+    case 'k':
+      tls_key = optarg;
+      break;
+#endif
+
     case 'h':
       print_usage(argv[0]);
       return EXIT_SUCCESS;
@@ -831,6 +1045,8 @@ int main(int argc, char **argv) {
       return EXIT_FAILURE;
     }
   }
+#undef MAIN_OPTS_HTTP
+#undef MAIN_OPTS_TLS
 
   /* Install signal handlers */
   install_signal_handlers();
@@ -843,12 +1059,39 @@ int main(int argc, char **argv) {
   printf("HTTP port:      %u\n", http_port);
 #endif
   printf("Max sessions:   %u\n", FTP_MAX_SESSIONS);
+  {
+    char placement[256];
+    if (pal_thread_describe(placement, sizeof(placement)) > 0U) {
+      printf("Threads:        %s\n", placement);
+    }
+  }
   printf("=====================================\n");
 
   (void)pal_notification_init();
 
-  /* Initialize FTP server */
-  ftp_error_t err = ftp_server_init(&g_server_ctx, "0.0.0.0", port, root_path);
+  /* Initialize FTP server: on the running instance's listeners with -R */
+  ftp_error_t err;
+  if ((take_over != 0) &&
+      (ftp_handoff_take(FTP_HANDOFF_PATH, &g_handoff_in, &g_handoff_link) ==
+       FTP_OK)) {
+    int fds[FTP_ACCEPT_THREADS_MAX];
+    uint32_t n = handoff_claim(FTP_HANDOFF_FTP, fds,
+                               (uint32_t)FTP_ACCEPT_THREADS_MAX);
+    err = ftp_server_init_fds(&g_server_ctx, fds, n, root_path);
+    if (err != FTP_OK) {
+      handoff_finish(0);
+    } else {
+      port = g_server_ctx.port;
+      printf("Hand-off:       %u listener(s) taken over\n",
+             (unsigned)g_handoff_in.count);
+      handoff_preload();
+    }
+  } else {
+    if (take_over != 0) {
+      fprintf(stderr, "Warning: No instance to take over, binding\n");
+    }
+    err = ftp_server_init(&g_server_ctx, "0.0.0.0", port, root_path);
+  }
 
   if (err != FTP_OK) {
     fprintf(stderr, "Error: FTP server initialization failed: %d\n", (int)err);
@@ -861,17 +1104,58 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+#if FTP_ENABLE_TLS
+  if (tls_cert != NULL) {
+    err = ftp_server_enable_tls(&g_server_ctx, tls_cert, tls_key);
+    if (err != FTP_OK) {
+      fprintf(stderr, "Error: Cannot load TLS certificate %s: %d\n", tls_cert,
+              (int)err);
+      ftp_server_cleanup(&g_server_ctx);
+      handoff_finish(0);
+      return EXIT_FAILURE;
+    }
+    printf("FTPS:           AUTH TLS enabled\n");
+  }
+#endif
+
+  (void)ftp_server_set_event_engine(&g_server_ctx, event_engine);
+  if (g_server_ctx.inherited != 0U) {
+    acceptors = g_server_ctx.acceptors; /* one per inherited listener */
+  } else if (ftp_server_set_acceptors(&g_server_ctx, acceptors) != FTP_OK) {
+    fprintf(stderr, "Warning: %u acceptors not supported, using 1\n",
+            (unsigned)acceptors);
+  }
+  if (backlog != FTP_LISTEN_BACKLOG) {
+    (void)ftp_server_set_listen_backlog(&g_server_ctx, backlog);
+  }
+
   /* Start FTP server */
   err = ftp_server_start(&g_server_ctx);
 
   if (err != FTP_OK) {
     fprintf(stderr, "Error: Failed to start FTP server: %d\n", (int)err);
     ftp_server_cleanup(&g_server_ctx);
+    handoff_finish(0);
     return EXIT_FAILURE;
   }
 
+  /* Inherited idle passive listeners go straight into the pool */
+  {
+    int pasv[FTP_HANDOFF_FDS_MAX];
+    uint32_t np = handoff_claim(FTP_HANDOFF_PASV, pasv,
+                                (uint32_t)FTP_HANDOFF_FDS_MAX);
+    for (uint32_t i = 0U; i < np; i++) {
+      if (ftp_pasv_pool_adopt(g_server_ctx.pasv_pool, pasv[i]) != 0) {
+        PAL_CLOSE(pasv[i]);
+      }
+    }
+  }
+
   printf("\n");
   printf("FTP server started on 0.0.0.0:%u\n", port);
+  if (event_engine != 0) {
+    printf("Sessions:       event engine\n");
+  }
 
   /*=========================================================================*
    * ZHTTPD — Start Web File Explorer
@@ -880,12 +1164,19 @@ int main(int argc, char **argv) {
   if (http_csrf_init() != 0) {
     ftp_log_line(FTP_LOG_WARN, "CSRF init failed: web upload disabled");
   }
+  /* FTP context feeds /api/metrics and the /api/events "ftp" topic */
+  http_api_set_server_ctx(&g_server_ctx);
   g_event_loop = event_loop_create();
   if (g_event_loop != NULL) {
     char http_bind[64];
     (void)snprintf(http_bind, sizeof(http_bind), "[::]:%u",
                    (unsigned)http_port);
-    g_http_server = http_server_create(g_event_loop, http_bind, root_path);
+    int http_fd = -1;
+    if (handoff_claim(FTP_HANDOFF_HTTP, &http_fd, 1U) == 1U) {
+      g_http_server = http_server_create_fd(g_event_loop, http_fd, root_path);
+    } else {
+      g_http_server = http_server_create(g_event_loop, http_bind, root_path);
+    }
     if (g_http_server != NULL) {
       pthread_t http_thread;
       int rc = start_http_thread(&http_thread, g_event_loop);
@@ -911,6 +1202,22 @@ int main(int argc, char **argv) {
   }
 #endif
 
+  /* Accepting on everything that was handed over: the old process may go */
+  if (g_handoff_link >= 0) {
+    handoff_finish(1);
+  }
+  {
+    ftp_handoff_ops_t ops;
+    ops.collect = handoff_collect;
+    ops.done = handoff_done;
+    ops.user = NULL;
+    if ((FTP_HANDOFF_PATH[0] != '\0') &&
+        (ftp_handoff_serve(FTP_HANDOFF_PATH, &ops) != FTP_OK)) {
+      fprintf(stderr, "Warning: Restart hand-off unavailable on %s\n",
+              FTP_HANDOFF_PATH);
+    }
+  }
+
   printf("\nPress Ctrl+C to stop.\n\n");
 
   {
@@ -922,9 +1229,13 @@ int main(int argc, char **argv) {
 
   /* Main loop */
   uint64_t last_total_conn = 0U;
+  unsigned ticks = 0U;
 
-  while (!g_shutdown_requested) {
-    sleep(5);
+  while (!g_shutdown_requested && (handoff_drained() == 0)) {
+    sleep(1);
+    if ((++ticks % 5U) != 0U) {
+      continue;
+    }
 
     /* Display periodic statistics */
     uint32_t active = ftp_server_get_active_sessions(&g_server_ctx);
@@ -946,9 +1257,15 @@ int main(int argc, char **argv) {
   }
 
   /* Graceful shutdown */
-  printf("\nShutdown requested...\n");
+  if (ftp_handoff_released() != 0) {
+    printf("\nHanded off, sessions drained.\n");
+  } else {
+    printf("\nShutdown requested...\n");
+  }
+  ftp_handoff_serve_stop();
 
 #if ENABLE_ZHTTPD
+  http_api_set_server_ctx(NULL);
   if (g_event_loop != NULL) {
     event_loop_stop(g_event_loop);
   }
@@ -965,6 +1282,9 @@ int main(int argc, char **argv) {
 
   ftp_server_stop(&g_server_ctx);
   ftp_server_cleanup(&g_server_ctx);
+  ftp_copyjob_shutdown();
+  ftp_dirsize_shutdown();
+  ftp_prefetch_shutdown();
   pal_notification_shutdown();
 
   printf("FTP server stopped.\n");
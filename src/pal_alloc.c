@@ -31,9 +31,27 @@ SOFTWARE.
  * PLATFORMS: FreeBSD (PS4/PS5 kqueue), Linux (epoll)
  * DESIGN: Single-threaded, non-blocking I/O
  * 
+ * A buddy allocator over one fixed arena, behind a spinlock.  Requests
+ * up to PAL_ALLOC_SLAB_MAX bytes skip it:
+ *
+ *   malloc ──► thread magazine ──► class free list ──► new slab page
+ *   free   ──► thread magazine ──► class free list
+ *
+ * Slab objects carry the usual header (order = size class, used =
+ * PAL_ALLOC_USED_SLAB), so free(), realloc() and the aligned-alloc
+ * back pointer work on either kind.  Counters live in per-thread
+ * shards and are only summed by pal_allocator_get_stats().
+ *
+ *   arena: [ buddy area (2^max_order) | large-block region (extents) ]
+ *
+ * Requests of PAL_ALLOC_LARGE_MIN bytes and up go to the second region
+ * (used = PAL_ALLOC_USED_LARGE, pad = block bytes), so they do not
+ * depend on the buddy area keeping its top orders whole.
  */
 #include "pal_alloc.h"
 
+#include <limits.h>
+#include <pthread.h>
 #include <stdatomic.h>
 #include <stdalign.h>
 #include <string.h>
@@ -53,6 +71,12 @@ SOFTWARE.
 
 #define PAL_ALLOC_MAGIC 0xA11C0A7U
 
+/* pal_alloc_hdr_t.used */
+#define PAL_ALLOC_USED_BUDDY 1U
+#define PAL_ALLOC_USED_SLAB 2U
+#define PAL_ALLOC_FREE_SLAB 3U
+#define PAL_ALLOC_USED_LARGE 4U
+
 #ifndef PAL_ALLOC_HARD_FAIL
 #if defined(FTP_DEBUG) && (FTP_DEBUG != 0)
 #define PAL_ALLOC_HARD_FAIL 1
@@ -79,14 +103,7 @@ static pal_allocator_t g_alloc = {
     .max_order = 0U,
     .lock = ATOMIC_FLAG_INIT,
     .initialized = ATOMIC_VAR_INIT(0),
-    .alloc_calls = ATOMIC_VAR_INIT(0),
-    .free_calls = ATOMIC_VAR_INIT(0),
-    .calloc_calls = ATOMIC_VAR_INIT(0),
-    .realloc_calls = ATOMIC_VAR_INIT(0),
-    .aligned_calls = ATOMIC_VAR_INIT(0),
-    .failures = ATOMIC_VAR_INIT(0),
-    .bytes_in_use = ATOMIC_VAR_INIT(0),
-    .bytes_peak = ATOMIC_VAR_INIT(0),
+    .epoch = ATOMIC_VAR_INIT(0),
     .free_lists = {0},
 };
 
@@ -120,6 +137,13 @@ static void pal_alloc_fail_fast(void)
 }
 #endif
 
+static void bad_pointer(void)
+{
+#if PAL_ALLOC_HARD_FAIL
+    pal_alloc_fail_fast();
+#endif
+}
+
 static uint32_t floor_log2_u64(uint64_t v)
 {
     uint32_t r = 0U;
@@ -138,6 +162,46 @@ static uint32_t ceil_log2_u64(uint64_t v)
     return f + 1U;
 }
 
+/*===========================================================================*
+ * STATISTICS SHARDS
+ *===========================================================================*/
+
+static atomic_uint g_shard_next = ATOMIC_VAR_INIT(0);
+static _Thread_local unsigned t_shard = UINT_MAX;
+
+static pal_alloc_shard_t *shard_of(pal_allocator_t *a)
+{
+    if (t_shard == UINT_MAX) {
+        t_shard = atomic_fetch_add_explicit(&g_shard_next, 1U, memory_order_relaxed) %
+                  PAL_ALLOC_STAT_SHARDS;
+    }
+    return &a->shards[t_shard];
+}
+
+static void stat_add(atomic_uint_fast64_t *c, uint64_t v)
+{
+    atomic_fetch_add_explicit(c, v, memory_order_relaxed);
+}
+
+static void shards_clear(pal_allocator_t *a)
+{
+    for (uint32_t i = 0U; i < PAL_ALLOC_STAT_SHARDS; i++) {
+        pal_alloc_shard_t *s = &a->shards[i];
+        atomic_store_explicit(&s->alloc_calls, 0U, memory_order_relaxed);
+        atomic_store_explicit(&s->free_calls, 0U, memory_order_relaxed);
+        atomic_store_explicit(&s->calloc_calls, 0U, memory_order_relaxed);
+        atomic_store_explicit(&s->realloc_calls, 0U, memory_order_relaxed);
+        atomic_store_explicit(&s->aligned_calls, 0U, memory_order_relaxed);
+        atomic_store_explicit(&s->failures, 0U, memory_order_relaxed);
+        atomic_store_explicit(&s->bytes_alloc, 0U, memory_order_relaxed);
+        atomic_store_explicit(&s->bytes_freed, 0U, memory_order_relaxed);
+    }
+}
+
+/*===========================================================================*
+ * BUDDY ALLOCATOR
+ *===========================================================================*/
+
 static pal_alloc_free_node_t *list_pop(pal_allocator_t *a, uint32_t order)
 {
     uint32_t idx = order - PAL_ALLOC_MIN_ORDER;
@@ -188,7 +252,7 @@ static void prefault_pages(uint8_t *base, size_t size)
     base[size - 1U] = 0U;
 }
 
-static int ptr_in_arena(pal_allocator_t *a, const void *p)
+static int ptr_in_buddy(const pal_allocator_t *a, const void *p)
 {
     if (p == NULL || a == NULL || a->base == NULL || a->size == 0U) {
         return 0;
@@ -197,6 +261,57 @@ static int ptr_in_arena(pal_allocator_t *a, const void *p)
     return (bp >= a->base) && (bp < (a->base + a->size));
 }
 
+static int ptr_in_large(const pal_allocator_t *a, const void *p)
+{
+    if (p == NULL || a == NULL || a->large_base == NULL) {
+        return 0;
+    }
+    const uint8_t *bp = (const uint8_t *)p;
+    return (bp >= a->large_base) && (bp < (a->large_base + a->large_size));
+}
+
+static int ptr_in_arena(pal_allocator_t *a, const void *p)
+{
+    return ptr_in_buddy(a, p) || ptr_in_large(a, p);
+}
+
+static pal_alloc_hdr_t *hdr_before(void *ptr)
+{
+    uint8_t *p = (uint8_t *)ptr;
+    return (pal_alloc_hdr_t *)PAL_ASSUME_ALIGNED((p - sizeof(pal_alloc_hdr_t)),
+                                                 alignof(pal_alloc_hdr_t));
+}
+
+static int hdr_live(const pal_alloc_hdr_t *h)
+{
+    return (h->magic == PAL_ALLOC_MAGIC) &&
+           ((h->used == PAL_ALLOC_USED_BUDDY) || (h->used == PAL_ALLOC_USED_SLAB) ||
+            (h->used == PAL_ALLOC_USED_LARGE));
+}
+
+/*
+ * Header of a live allocation: directly in front of @p ptr, or in front
+ * of the raw block an aligned allocation points back to.  NULL for
+ * anything else (double free, foreign pointer).
+ */
+static pal_alloc_hdr_t *hdr_of(pal_allocator_t *a, void *ptr)
+{
+    pal_alloc_hdr_t *hdr = hdr_before(ptr);
+    if (hdr_live(hdr)) {
+        return hdr;
+    }
+    if (((uintptr_t)ptr % alignof(void *)) == 0U) {
+        void *raw = *((void **)ptr - 1);
+        if (ptr_in_arena(a, raw)) {
+            pal_alloc_hdr_t *rh = hdr_before(raw);
+            if (hdr_live(rh)) {
+                return rh;
+            }
+        }
+    }
+    return NULL;
+}
+
 void pal_allocator_get_stats(pal_allocator_t *a, pal_alloc_stats_t *out)
 {
     if (out == NULL) {
@@ -206,14 +321,25 @@ void pal_allocator_get_stats(pal_allocator_t *a, pal_alloc_stats_t *out)
     if (a == NULL || atomic_load(&a->initialized) == 0) {
         return;
     }
-    out->alloc_calls = atomic_load(&a->alloc_calls);
-    out->free_calls = atomic_load(&a->free_calls);
-    out->calloc_calls = atomic_load(&a->calloc_calls);
-    out->realloc_calls = atomic_load(&a->realloc_calls);
-    out->aligned_calls = atomic_load(&a->aligned_calls);
-    out->failures = atomic_load(&a->failures);
-    out->bytes_in_use = atomic_load(&a->bytes_in_use);
-    out->bytes_peak = atomic_load(&a->bytes_peak);
+    uint64_t in = 0U;
+    uint64_t outb = 0U;
+    for (uint32_t i = 0U; i < PAL_ALLOC_STAT_SHARDS; i++) {
+        pal_alloc_shard_t *s = &a->shards[i];
+        out->alloc_calls += atomic_load_explicit(&s->alloc_calls, memory_order_relaxed);
+        out->free_calls += atomic_load_explicit(&s->free_calls, memory_order_relaxed);
+        out->calloc_calls += atomic_load_explicit(&s->calloc_calls, memory_order_relaxed);
+        out->realloc_calls += atomic_load_explicit(&s->realloc_calls, memory_order_relaxed);
+        out->aligned_calls += atomic_load_explicit(&s->aligned_calls, memory_order_relaxed);
+        out->failures += atomic_load_explicit(&s->failures, memory_order_relaxed);
+        in += atomic_load_explicit(&s->bytes_alloc, memory_order_relaxed);
+        outb += atomic_load_explicit(&s->bytes_freed, memory_order_relaxed);
+    }
+    out->bytes_in_use = (in > outb) ? (in - outb) : 0U;
+
+    pal_alloc_lock(a);
+    out->bytes_peak = a->arena_peak;
+    out->slab_bytes = a->slab_bytes;
+    pal_alloc_unlock(a);
 }
 
 void pal_allocator_reset_stats(pal_allocator_t *a)
@@ -221,14 +347,15 @@ void pal_allocator_reset_stats(pal_allocator_t *a)
     if (a == NULL) {
         return;
     }
-    atomic_store(&a->alloc_calls, 0U);
-    atomic_store(&a->free_calls, 0U);
-    atomic_store(&a->calloc_calls, 0U);
-    atomic_store(&a->realloc_calls, 0U);
-    atomic_store(&a->aligned_calls, 0U);
-    atomic_store(&a->failures, 0U);
-    atomic_store(&a->bytes_in_use, 0U);
-    atomic_store(&a->bytes_peak, 0U);
+    /* Live bytes stay accounted so later frees do not underflow */
+    pal_alloc_stats_t cur;
+    pal_allocator_get_stats(a, &cur);
+    shards_clear(a);
+    atomic_store_explicit(&a->shards[0].bytes_alloc, cur.bytes_in_use, memory_order_relaxed);
+
+    pal_alloc_lock(a);
+    a->arena_peak = a->arena_in_use;
+    pal_alloc_unlock(a);
 }
 
 int pal_allocator_init(pal_allocator_t *a, void *buffer, size_t size)
@@ -249,7 +376,15 @@ int pal_allocator_init(pal_allocator_t *a, void *buffer, size_t size)
     uint8_t *base = (uint8_t *)aligned;
     size_t usable = size - adj;
 
-    uint32_t max_order = floor_log2_u64((uint64_t)usable);
+    size_t large = 0U;
+#if PAL_ALLOC_LARGE_DIV > 0
+    large = (usable / PAL_ALLOC_LARGE_DIV) & ~(size_t)(PAL_ALLOC_LARGE_GRAIN - 1U);
+    if (large < (2U * (size_t)PAL_ALLOC_LARGE_MIN)) {
+        large = 0U;
+    }
+#endif
+
+    uint32_t max_order = floor_log2_u64((uint64_t)(usable - large));
     if (max_order > PAL_ALLOC_MAX_ORDER) {
         max_order = PAL_ALLOC_MAX_ORDER;
     }
@@ -258,6 +393,10 @@ int pal_allocator_init(pal_allocator_t *a, void *buffer, size_t size)
     }
 
     size_t arena_size = (size_t)1U << max_order;
+    if (large != 0U) {
+        /* Everything the buddy area cannot use */
+        large = (usable - arena_size) & ~(size_t)(PAL_ALLOC_LARGE_GRAIN - 1U);
+    }
 
     pal_alloc_lock(a);
     a->base = base;
@@ -266,9 +405,22 @@ int pal_allocator_init(pal_allocator_t *a, void *buffer, size_t size)
     for (size_t i = 0U; i < (sizeof(a->free_lists) / sizeof(a->free_lists[0])); i++) {
         a->free_lists[i] = NULL;
     }
-    pal_allocator_reset_stats(a);
-
-    prefault_pages(base, arena_size);
+    for (uint32_t i = 0U; i < PAL_ALLOC_SLAB_CLASSES; i++) {
+        atomic_flag_clear(&a->slabs[i].lock);
+        a->slabs[i].head = NULL;
+        a->slabs[i].count = 0U;
+    }
+    a->arena_in_use = 0U;
+    a->arena_peak = 0U;
+    a->slab_bytes = 0U;
+    a->large_base = (large != 0U) ? (base + arena_size) : NULL;
+    a->large_size = large;
+    a->large_free = NULL;
+    shards_clear(a);
+    /* Magazines still holding objects of a previous arena drop them */
+    atomic_fetch_add(&a->epoch, 1U);
+
+    prefault_pages(base, arena_size + large);
 
     pal_alloc_free_node_t *root =
         (pal_alloc_free_node_t *)PAL_ASSUME_ALIGNED(base, alignof(pal_alloc_free_node_t));
@@ -279,6 +431,17 @@ int pal_allocator_init(pal_allocator_t *a, void *buffer, size_t size)
     root->next = NULL;
     list_push(a, max_order, root);
 
+    if (a->large_base != NULL) {
+        pal_alloc_free_node_t *ext = (pal_alloc_free_node_t *)PAL_ASSUME_ALIGNED(
+            a->large_base, alignof(pal_alloc_free_node_t));
+        ext->hdr.magic = PAL_ALLOC_MAGIC;
+        ext->hdr.order = 0U;
+        ext->hdr.used = 0U;
+        ext->hdr.pad = (uint64_t)large;
+        ext->next = NULL;
+        a->large_free = (void *)ext;
+    }
+
     atomic_store(&a->initialized, 1);
     pal_alloc_unlock(a);
 
@@ -303,7 +466,7 @@ size_t pal_alloc_arena_size(void)
     if (atomic_load(&g_alloc.initialized) == 0) {
         return 0U;
     }
-    return g_alloc.size;
+    return g_alloc.size + g_alloc.large_size;
 }
 
 size_t pal_alloc_arena_free_approx(void)
@@ -322,6 +485,10 @@ size_t pal_alloc_arena_free_approx(void)
             n = n->next;
         }
     }
+    for (pal_alloc_free_node_t *e = (pal_alloc_free_node_t *)g_alloc.large_free; e != NULL;
+         e = e->next) {
+        free_total += (size_t)e->hdr.pad;
+    }
     pal_alloc_unlock(&g_alloc);
     return free_total;
 }
@@ -336,14 +503,9 @@ void pal_alloc_reset_stats(void)
     pal_allocator_reset_stats(&g_alloc);
 }
 
-static void bump_peak(pal_allocator_t *a, uint64_t in_use)
+void pal_alloc_get_frag(pal_alloc_frag_t *out)
 {
-    uint64_t peak = atomic_load(&a->bytes_peak);
-    while (in_use > peak) {
-        if (atomic_compare_exchange_weak(&a->bytes_peak, &peak, in_use)) {
-            break;
-        }
-    }
+    pal_allocator_get_frag(&g_alloc, out);
 }
 
 static void *alloc_locked(pal_allocator_t *a, size_t size)
@@ -399,94 +561,27 @@ static void *alloc_locked(pal_allocator_t *a, size_t size)
 
     node->hdr.magic = PAL_ALLOC_MAGIC;
     node->hdr.order = (uint16_t)order;
-    node->hdr.used = 1U;
+    node->hdr.used = PAL_ALLOC_USED_BUDDY;
     node->hdr.pad = 0U;
 
-    return (void *)((uint8_t *)node + sizeof(pal_alloc_hdr_t));
-}
-
-void *pal_allocator_malloc(pal_allocator_t *a, size_t size)
-{
-    if (a == NULL) {
-        return NULL;
-    }
-    if (atomic_load(&a->initialized) == 0) {
-        return NULL;
+    a->arena_in_use += (uint64_t)1U << order;
+    if (a->arena_in_use > a->arena_peak) {
+        a->arena_peak = a->arena_in_use;
     }
 
-    pal_alloc_lock(a);
-    void *p = alloc_locked(a, size);
-    if (p != NULL) {
-        atomic_fetch_add(&a->alloc_calls, 1U);
-        pal_alloc_hdr_t *hdr =
-            (pal_alloc_hdr_t *)PAL_ASSUME_ALIGNED(((uint8_t *)p - sizeof(pal_alloc_hdr_t)),
-                                                 alignof(pal_alloc_hdr_t));
-        uint64_t bytes = (uint64_t)((size_t)1U << (uint32_t)hdr->order);
-        uint64_t in_use = atomic_fetch_add(&a->bytes_in_use, bytes) + bytes;
-        bump_peak(a, in_use);
-    } else {
-        atomic_fetch_add(&a->failures, 1U);
-    }
-    pal_alloc_unlock(a);
-    return p;
+    return (void *)((uint8_t *)node + sizeof(pal_alloc_hdr_t));
 }
 
-static void free_locked(pal_allocator_t *a, void *ptr)
+static void free_locked(pal_allocator_t *a, pal_alloc_hdr_t *hdr)
 {
-    if (ptr == NULL) {
-        return;
-    }
-
-    uint8_t *p = (uint8_t *)ptr;
-    pal_alloc_hdr_t *hdr =
-        (pal_alloc_hdr_t *)PAL_ASSUME_ALIGNED((p - sizeof(pal_alloc_hdr_t)), alignof(pal_alloc_hdr_t));
-    if (hdr->magic != PAL_ALLOC_MAGIC || hdr->used == 0U) {
-        if (((uintptr_t)ptr % alignof(void *)) == 0U) {
-            void *raw = *((void **)ptr - 1);
-            if (ptr_in_arena(a, raw)) {
-                uint8_t *rp = (uint8_t *)raw;
-                pal_alloc_hdr_t *rh =
-                    (pal_alloc_hdr_t *)PAL_ASSUME_ALIGNED((rp - sizeof(pal_alloc_hdr_t)),
-                                                         alignof(pal_alloc_hdr_t));
-                if ((rh->magic == PAL_ALLOC_MAGIC) && (rh->used != 0U)) {
-                    hdr = rh;
-                } else {
-#if PAL_ALLOC_HARD_FAIL
-                    pal_alloc_fail_fast();
-#endif
-                    return;
-                }
-            } else {
-#if PAL_ALLOC_HARD_FAIL
-                pal_alloc_fail_fast();
-#endif
-                return;
-            }
-        } else {
-#if PAL_ALLOC_HARD_FAIL
-            pal_alloc_fail_fast();
-#endif
-            return;
-        }
-    }
-
     uint32_t order = (uint32_t)hdr->order;
-    if (order < PAL_ALLOC_MIN_ORDER || order > a->max_order) {
-#if PAL_ALLOC_HARD_FAIL
-        pal_alloc_fail_fast();
-#endif
-        return;
-    }
-
-    uint64_t bytes = (uint64_t)((size_t)1U << order);
-    atomic_fetch_add(&a->free_calls, 1U);
-    atomic_fetch_sub(&a->bytes_in_use, bytes);
+    size_t block_size = (size_t)1U << order;
+    a->arena_in_use -= (uint64_t)block_size;
 
     hdr->used = 0U;
     pal_alloc_free_node_t *node = (pal_alloc_free_node_t *)hdr;
     node->next = NULL;
 
-    size_t block_size = (size_t)1U << order;
     size_t offset = (size_t)((uint8_t *)node - a->base);
 
     while (order < a->max_order) {
@@ -525,6 +620,416 @@ static void free_locked(pal_allocator_t *a, void *ptr)
     list_push(a, order, node);
 }
 
+/*===========================================================================*
+ * LARGE-BLOCK REGION
+ *===========================================================================*/
+
+/*
+ * Best fit over the extent list.  The block is cut from the tail of the
+ * extent, so a partly used extent keeps its place in the list.
+ */
+static void *large_alloc_locked(pal_allocator_t *a, size_t size)
+{
+    if (size > a->large_size) {
+        return NULL;
+    }
+    size_t need = (size + sizeof(pal_alloc_hdr_t) + (PAL_ALLOC_LARGE_GRAIN - 1U)) &
+                  ~(size_t)(PAL_ALLOC_LARGE_GRAIN - 1U);
+
+    pal_alloc_free_node_t *best = NULL;
+    pal_alloc_free_node_t *best_prev = NULL;
+    pal_alloc_free_node_t *prev = NULL;
+    for (pal_alloc_free_node_t *e = (pal_alloc_free_node_t *)a->large_free; e != NULL;
+         prev = e, e = e->next) {
+        if ((e->hdr.pad >= need) && ((best == NULL) || (e->hdr.pad < best->hdr.pad))) {
+            best = e;
+            best_prev = prev;
+            if (e->hdr.pad == need) {
+                break;
+            }
+        }
+    }
+    if (best == NULL) {
+        return NULL;
+    }
+
+    pal_alloc_hdr_t *hdr = NULL;
+    if (best->hdr.pad > need) {
+        best->hdr.pad -= need;
+        hdr = (pal_alloc_hdr_t *)PAL_ASSUME_ALIGNED(((uint8_t *)best + best->hdr.pad),
+                                                    alignof(pal_alloc_hdr_t));
+    } else {
+        if (best_prev != NULL) {
+            best_prev->next = best->next;
+        } else {
+            a->large_free = (void *)best->next;
+        }
+        hdr = &best->hdr;
+    }
+    hdr->magic = PAL_ALLOC_MAGIC;
+    hdr->order = 0U;
+    hdr->used = PAL_ALLOC_USED_LARGE;
+    hdr->pad = (uint64_t)need;
+
+    a->arena_in_use += (uint64_t)need;
+    if (a->arena_in_use > a->arena_peak) {
+        a->arena_peak = a->arena_in_use;
+    }
+    return (void *)(hdr + 1);
+}
+
+/* Back into address order, merged with the neighbours it touches */
+static void large_free_locked(pal_allocator_t *a, pal_alloc_hdr_t *hdr)
+{
+    uint64_t len = hdr->pad;
+    a->arena_in_use -= len;
+
+    pal_alloc_free_node_t *node = (pal_alloc_free_node_t *)hdr;
+    pal_alloc_free_node_t *prev = NULL;
+    pal_alloc_free_node_t *next = (pal_alloc_free_node_t *)a->large_free;
+    while ((next != NULL) && ((uint8_t *)next < (uint8_t *)node)) {
+        prev = next;
+        next = next->next;
+    }
+
+    hdr->used = 0U;
+    if ((next != NULL) && (((uint8_t *)node + len) == (uint8_t *)next)) {
+        len += next->hdr.pad;
+        next = next->next;
+    }
+    if ((prev != NULL) && (((uint8_t *)prev + prev->hdr.pad) == (uint8_t *)node)) {
+        prev->hdr.pad += len;
+        prev->next = next;
+        return;
+    }
+    node->hdr.pad = len;
+    node->next = next;
+    if (prev != NULL) {
+        prev->next = node;
+    } else {
+        a->large_free = (void *)node;
+    }
+}
+
+void pal_allocator_get_frag(pal_allocator_t *a, pal_alloc_frag_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    memset(out, 0, sizeof(*out));
+    if (a == NULL || atomic_load(&a->initialized) == 0) {
+        return;
+    }
+
+    pal_alloc_lock(a);
+    out->buddy_size = (uint64_t)a->size;
+    for (uint32_t order = PAL_ALLOC_MIN_ORDER; order <= a->max_order; order++) {
+        uint32_t idx = order - PAL_ALLOC_MIN_ORDER;
+        uint32_t count = 0U;
+        for (pal_alloc_free_node_t *n = (pal_alloc_free_node_t *)a->free_lists[idx];
+             n != NULL; n = n->next) {
+            count++;
+        }
+        out->free_blocks[idx] = count;
+        if (count > 0U) {
+            out->buddy_free += (uint64_t)count << order;
+            out->buddy_largest = (uint64_t)1U << order;
+        }
+    }
+    out->large_size = (uint64_t)a->large_size;
+    for (pal_alloc_free_node_t *e = (pal_alloc_free_node_t *)a->large_free; e != NULL;
+         e = e->next) {
+        out->large_extents++;
+        out->large_free += e->hdr.pad;
+        if (e->hdr.pad > out->large_largest) {
+            out->large_largest = e->hdr.pad;
+        }
+    }
+    pal_alloc_unlock(a);
+}
+
+/*===========================================================================*
+ * SMALL-OBJECT SLABS
+ *===========================================================================*/
+
+static uint32_t slab_class(size_t size)
+{
+    uint32_t order = ceil_log2_u64((uint64_t)size);
+    return (order <= 4U) ? 0U : (order - 4U);
+}
+
+static size_t slab_size(uint32_t cls)
+{
+    return (size_t)16U << cls;
+}
+
+static size_t slab_stride(uint32_t cls)
+{
+    return slab_size(cls) + sizeof(pal_alloc_hdr_t);
+}
+
+/* Free objects are linked through their first payload word */
+static void **slab_link(pal_alloc_hdr_t *h)
+{
+    return (void **)(void *)(h + 1);
+}
+
+static void slab_lock(pal_alloc_slab_t *s)
+{
+    while (atomic_flag_test_and_set_explicit(&s->lock, memory_order_acquire)) {
+    }
+}
+
+static void slab_unlock(pal_alloc_slab_t *s)
+{
+    atomic_flag_clear_explicit(&s->lock, memory_order_release);
+}
+
+static uint32_t slab_pop(pal_alloc_slab_t *s, pal_alloc_hdr_t **out, uint32_t max)
+{
+    uint32_t n = 0U;
+    slab_lock(s);
+    while ((n < max) && (s->head != NULL)) {
+        pal_alloc_hdr_t *h = (pal_alloc_hdr_t *)s->head;
+        s->head = *slab_link(h);
+        out[n++] = h;
+    }
+    s->count -= n;
+    slab_unlock(s);
+    return n;
+}
+
+static void slab_push(pal_alloc_slab_t *s, pal_alloc_hdr_t *const *objs, uint32_t n)
+{
+    slab_lock(s);
+    for (uint32_t i = 0U; i < n; i++) {
+        *slab_link(objs[i]) = s->head;
+        s->head = (void *)objs[i];
+    }
+    s->count += n;
+    slab_unlock(s);
+}
+
+/*
+ * Carve a new slab page for @p cls.  Up to @p max objects go to @p out,
+ * the rest onto the class free list.
+ *
+ * @return objects placed in @p out (0 once the slab share is used up)
+ */
+static uint32_t slab_grow(pal_allocator_t *a, uint32_t cls, pal_alloc_hdr_t **out,
+                          uint32_t max)
+{
+    uint8_t *page = NULL;
+    pal_alloc_lock(a);
+    if ((a->slab_bytes + PAL_ALLOC_SLAB_PAGE) <= (a->size / PAL_ALLOC_SLAB_SHARE)) {
+        page = (uint8_t *)alloc_locked(a, PAL_ALLOC_SLAB_PAGE - sizeof(pal_alloc_hdr_t));
+        if (page != NULL) {
+            a->slab_bytes += PAL_ALLOC_SLAB_PAGE;
+        }
+    }
+    pal_alloc_unlock(a);
+    if (page == NULL) {
+        return 0U;
+    }
+
+    size_t stride = slab_stride(cls);
+    uint32_t count = (uint32_t)((PAL_ALLOC_SLAB_PAGE - sizeof(pal_alloc_hdr_t)) / stride);
+    pal_alloc_hdr_t *spill = NULL;
+    pal_alloc_hdr_t *spill_tail = NULL;
+    uint32_t kept = 0U;
+    for (uint32_t i = 0U; i < count; i++) {
+        pal_alloc_hdr_t *h = (pal_alloc_hdr_t *)PAL_ASSUME_ALIGNED(
+            (page + ((size_t)i * stride)), alignof(pal_alloc_hdr_t));
+        h->magic = PAL_ALLOC_MAGIC;
+        h->order = (uint16_t)cls;
+        h->used = PAL_ALLOC_FREE_SLAB;
+        h->pad = 0U;
+        if (kept < max) {
+            out[kept++] = h;
+            continue;
+        }
+        *slab_link(h) = NULL;
+        if (spill_tail != NULL) {
+            *slab_link(spill_tail) = (void *)h;
+        } else {
+            spill = h;
+        }
+        spill_tail = h;
+    }
+
+    if (spill != NULL) {
+        pal_alloc_slab_t *s = &a->slabs[cls];
+        slab_lock(s);
+        *slab_link(spill_tail) = s->head;
+        s->head = (void *)spill;
+        s->count += count - kept;
+        slab_unlock(s);
+    }
+    return kept;
+}
+
+#if PAL_ALLOC_MAGAZINE > 0
+typedef struct {
+    pal_allocator_t *owner;
+    unsigned epoch;
+    uint32_t n[PAL_ALLOC_SLAB_CLASSES];
+    pal_alloc_hdr_t *obj[PAL_ALLOC_SLAB_CLASSES][PAL_ALLOC_MAGAZINE];
+} pal_alloc_magazine_t;
+
+/*
+ * One magazine per thread, serving the first allocator the thread
+ * touches (in practice the global one); other allocators go straight
+ * to the class free lists.  Handed back on thread exit.
+ */
+static _Thread_local pal_alloc_magazine_t t_mag;
+static pthread_key_t g_mag_key;
+static pthread_once_t g_mag_once = PTHREAD_ONCE_INIT;
+static int g_mag_ok = 0;
+
+static uint32_t mag_cap(uint32_t cls)
+{
+    size_t n = PAL_ALLOC_MAGAZINE_BYTES / slab_stride(cls);
+    if (n < 1U) {
+        n = 1U;
+    }
+    return (n > PAL_ALLOC_MAGAZINE) ? PAL_ALLOC_MAGAZINE : (uint32_t)n;
+}
+
+static void magazine_flush(void *arg)
+{
+    pal_alloc_magazine_t *m = (pal_alloc_magazine_t *)arg;
+    pal_allocator_t *a = m->owner;
+    if ((a != NULL) && (atomic_load(&a->initialized) != 0) &&
+        (atomic_load(&a->epoch) == m->epoch)) {
+        for (uint32_t i = 0U; i < PAL_ALLOC_SLAB_CLASSES; i++) {
+            slab_push(&a->slabs[i], m->obj[i], m->n[i]);
+        }
+    }
+    memset(m->n, 0, sizeof(m->n));
+    m->owner = NULL;
+}
+
+static void magazine_key_init(void)
+{
+    g_mag_ok = (pthread_key_create(&g_mag_key, magazine_flush) == 0) ? 1 : 0;
+}
+
+static pal_alloc_magazine_t *magazine_get(pal_allocator_t *a)
+{
+    pal_alloc_magazine_t *m = &t_mag;
+    unsigned epoch = atomic_load_explicit(&a->epoch, memory_order_relaxed);
+    if (m->owner == NULL) {
+        (void)pthread_once(&g_mag_once, magazine_key_init);
+        if ((g_mag_ok == 0) || (pthread_setspecific(g_mag_key, m) != 0)) {
+            return NULL;
+        }
+        m->owner = a;
+        m->epoch = epoch;
+    }
+    if (m->owner != a) {
+        return NULL;
+    }
+    if (m->epoch != epoch) {
+        memset(m->n, 0, sizeof(m->n));
+        m->epoch = epoch;
+    }
+    return m;
+}
+#endif
+
+static pal_alloc_hdr_t *slab_take(pal_allocator_t *a, uint32_t cls)
+{
+    pal_alloc_slab_t *s = &a->slabs[cls];
+#if PAL_ALLOC_MAGAZINE > 0
+    pal_alloc_magazine_t *m = magazine_get(a);
+    if (m != NULL) {
+        if (m->n[cls] == 0U) {
+            uint32_t want = (mag_cap(cls) + 1U) / 2U;
+            m->n[cls] = slab_pop(s, m->obj[cls], want);
+            if (m->n[cls] == 0U) {
+                m->n[cls] = slab_grow(a, cls, m->obj[cls], want);
+            }
+        }
+        return (m->n[cls] > 0U) ? m->obj[cls][--m->n[cls]] : NULL;
+    }
+#endif
+    pal_alloc_hdr_t *h = NULL;
+    if (slab_pop(s, &h, 1U) == 0U) {
+        (void)slab_grow(a, cls, &h, 1U);
+    }
+    return h;
+}
+
+static void slab_give(pal_allocator_t *a, pal_alloc_hdr_t *h)
+{
+    uint32_t cls = (uint32_t)h->order;
+    pal_alloc_slab_t *s = &a->slabs[cls];
+    h->used = PAL_ALLOC_FREE_SLAB;
+#if PAL_ALLOC_MAGAZINE > 0
+    pal_alloc_magazine_t *m = magazine_get(a);
+    if (m != NULL) {
+        uint32_t cap = mag_cap(cls);
+        if (m->n[cls] >= cap) {
+            /* Hand the colder half back, keep the recently freed ones */
+            uint32_t give = cap - (cap / 2U);
+            slab_push(s, m->obj[cls], give);
+            memmove(m->obj[cls], m->obj[cls] + give,
+                    (size_t)(m->n[cls] - give) * sizeof(m->obj[cls][0]));
+            m->n[cls] -= give;
+        }
+        m->obj[cls][m->n[cls]++] = h;
+        return;
+    }
+#endif
+    slab_push(s, &h, 1U);
+}
+
+/*===========================================================================*
+ * PUBLIC API
+ *===========================================================================*/
+
+void *pal_allocator_malloc(pal_allocator_t *a, size_t size)
+{
+    if (a == NULL) {
+        return NULL;
+    }
+    if (atomic_load(&a->initialized) == 0) {
+        return NULL;
+    }
+    pal_alloc_shard_t *sh = shard_of(a);
+
+    if (size <= PAL_ALLOC_SLAB_MAX) {
+        uint32_t cls = slab_class((size == 0U) ? 1U : size);
+        pal_alloc_hdr_t *h = slab_take(a, cls);
+        if (h != NULL) {
+            h->used = PAL_ALLOC_USED_SLAB;
+            stat_add(&sh->alloc_calls, 1U);
+            stat_add(&sh->bytes_alloc, (uint64_t)slab_stride(cls));
+            return (void *)(h + 1);
+        }
+    }
+
+    void *p = NULL;
+    pal_alloc_lock(a);
+    if ((a->large_base != NULL) && (size >= PAL_ALLOC_LARGE_MIN - sizeof(pal_alloc_hdr_t))) {
+        p = large_alloc_locked(a, size);
+    }
+    if (p == NULL) {
+        p = alloc_locked(a, size);
+    }
+    pal_alloc_unlock(a);
+    if (p != NULL) {
+        pal_alloc_hdr_t *h = hdr_before(p);
+        stat_add(&sh->alloc_calls, 1U);
+        stat_add(&sh->bytes_alloc, (h->used == PAL_ALLOC_USED_LARGE)
+                                       ? h->pad
+                                       : (uint64_t)1U << (uint32_t)h->order);
+    } else {
+        stat_add(&sh->failures, 1U);
+    }
+    return p;
+}
+
 void pal_allocator_free(pal_allocator_t *a, void *ptr)
 {
     if (ptr == NULL) {
@@ -533,8 +1038,49 @@ void pal_allocator_free(pal_allocator_t *a, void *ptr)
     if (a == NULL || atomic_load(&a->initialized) == 0) {
         return;
     }
+    pal_alloc_hdr_t *hdr = hdr_of(a, ptr);
+    if ((hdr == NULL) || !ptr_in_arena(a, hdr)) {
+        bad_pointer();
+        return;
+    }
+    pal_alloc_shard_t *sh = shard_of(a);
+
+    if (hdr->used == PAL_ALLOC_USED_SLAB) {
+        uint32_t cls = (uint32_t)hdr->order;
+        if (cls >= PAL_ALLOC_SLAB_CLASSES) {
+            bad_pointer();
+            return;
+        }
+        stat_add(&sh->free_calls, 1U);
+        stat_add(&sh->bytes_freed, (uint64_t)slab_stride(cls));
+        slab_give(a, hdr);
+        return;
+    }
+
+    if (hdr->used == PAL_ALLOC_USED_LARGE) {
+        uint64_t len = hdr->pad;
+        if (!ptr_in_large(a, hdr) || (len == 0U) || ((len % PAL_ALLOC_LARGE_GRAIN) != 0U) ||
+            (len > (uint64_t)((a->large_base + a->large_size) - (uint8_t *)hdr))) {
+            bad_pointer();
+            return;
+        }
+        stat_add(&sh->free_calls, 1U);
+        stat_add(&sh->bytes_freed, len);
+        pal_alloc_lock(a);
+        large_free_locked(a, hdr);
+        pal_alloc_unlock(a);
+        return;
+    }
+
+    uint32_t order = (uint32_t)hdr->order;
+    if (!ptr_in_buddy(a, hdr) || order < PAL_ALLOC_MIN_ORDER || order > a->max_order) {
+        bad_pointer();
+        return;
+    }
+    stat_add(&sh->free_calls, 1U);
+    stat_add(&sh->bytes_freed, (uint64_t)1U << order);
     pal_alloc_lock(a);
-    free_locked(a, ptr);
+    free_locked(a, hdr);
     pal_alloc_unlock(a);
 }
 
@@ -561,7 +1107,7 @@ void *pal_allocator_calloc(pal_allocator_t *a, size_t nmemb, size_t size)
     if (a == NULL) {
         return NULL;
     }
-    atomic_fetch_add(&a->calloc_calls, 1U);
+    stat_add(&shard_of(a)->calloc_calls, 1U);
 
     if (nmemb == 0U || size == 0U) {
         return pal_allocator_malloc(a, 0U);
@@ -592,7 +1138,7 @@ void *pal_allocator_realloc(pal_allocator_t *a, void *ptr, size_t size)
     if (a == NULL) {
         return NULL;
     }
-    atomic_fetch_add(&a->realloc_calls, 1U);
+    stat_add(&shard_of(a)->realloc_calls, 1U);
 
     if (ptr == NULL) {
         return pal_allocator_malloc(a, size);
@@ -605,18 +1151,20 @@ void *pal_allocator_realloc(pal_allocator_t *a, void *ptr, size_t size)
         return NULL;
     }
 
-    uint8_t *p = (uint8_t *)ptr;
-    pal_alloc_hdr_t *hdr =
-        (pal_alloc_hdr_t *)PAL_ASSUME_ALIGNED((p - sizeof(pal_alloc_hdr_t)), alignof(pal_alloc_hdr_t));
-    if (hdr->magic != PAL_ALLOC_MAGIC || hdr->used == 0U) {
-#if PAL_ALLOC_HARD_FAIL
-        pal_alloc_fail_fast();
-#endif
+    pal_alloc_hdr_t *hdr = hdr_before(ptr);
+    if (!hdr_live(hdr)) {
+        bad_pointer();
         return NULL;
     }
 
-    uint32_t order = (uint32_t)hdr->order;
-    size_t cap = ((size_t)1U << order) - sizeof(pal_alloc_hdr_t);
+    size_t cap = 0U;
+    if (hdr->used == PAL_ALLOC_USED_SLAB) {
+        cap = slab_size((uint32_t)hdr->order);
+    } else if (hdr->used == PAL_ALLOC_USED_LARGE) {
+        cap = (size_t)hdr->pad - sizeof(pal_alloc_hdr_t);
+    } else {
+        cap = ((size_t)1U << (uint32_t)hdr->order) - sizeof(pal_alloc_hdr_t);
+    }
     if (size <= cap) {
         return ptr;
     }
@@ -645,7 +1193,7 @@ void *pal_allocator_aligned_alloc(pal_allocator_t *a, size_t alignment, size_t s
     if (a == NULL) {
         return NULL;
     }
-    atomic_fetch_add(&a->aligned_calls, 1U);
+    stat_add(&shard_of(a)->aligned_calls, 1U);
 
     if (alignment < sizeof(void *)) {
         alignment = sizeof(void *);
@@ -13,16 +13,20 @@
  *   curl_easy_perform()
  *     └─ perform_one()          ← one HTTP transaction (no redirect logic)
  *           ├─ url_parse()
- *           ├─ net_connect()    ← getaddrinfo + non-blocking connect/select
+ *           ├─ pool_take()      ← idle keep-alive socket to the same host:port
+ *           ├─ net_connect()    ← cached getaddrinfo + non-blocking connect
  *           ├─ build_request()  ← assemble HTTP/1.1 request headers
  *           ├─ send_all()       ← write-loop with EINTR retry
  *           ├─ http_recv_headers()  ← accumulate until \r\n\r\n
  *           ├─ parse_status_line()
  *           ├─ parse_header_fields() ← Content-Length / Transfer-Encoding / Location
- *           └─ stream_body_*()  ← one of three body readers:
- *                 stream_body_known_length()   content-length based
- *                 stream_body_chunked()        chunked/TE decoder
- *                 stream_body_until_close()    read-until-EOF
+ *           ├─ stream_body_*()  ← one of four body readers:
+ *           │     stream_body_known_length()   content-length based
+ *           │     stream_body_chunked()        chunked/TE decoder
+ *           │     stream_body_until_close()    read-until-EOF
+ *           │     stream_body_sink()           any of the above, into
+ *           │                                  CURLOPT_PAL_SINK_FD
+ *           └─ pool_put()       ← socket kept if the response ended cleanly
  *
  * ── KEY DESIGN DECISIONS ────────────────────────────────────────────────────
  *
@@ -49,9 +53,21 @@
  * HTTP/1.1 with chunked Transfer-Encoding:
  *   HTTP/1.0 was used to avoid chunked decoding.  Modern servers (even on
  *   local networks) frequently respond with HTTP/1.1 chunked even to
- *   HTTP/1.0 requests.  We now send HTTP/1.1 + Connection: close and
- *   implement a proper state-machine chunked decoder (chunked_process()).
- *   Connection: close ensures no keep-alive complexity.
+ *   HTTP/1.0 requests.  We now send HTTP/1.1 and implement a proper
+ *   state-machine chunked decoder (chunked_process()).
+ *
+ * Keep-alive pool and DNS cache:
+ *   Batch installs and ranged downloads issue many requests to one host;
+ *   a fresh getaddrinfo + TCP handshake per request cost more than small
+ *   files take to transfer.  Requests now ask for Connection: keep-alive.
+ *   When the body ended exactly where its framing says (Content-Length
+ *   reached, or the last chunk and trailers consumed) and the server did
+ *   not answer Connection: close, the socket goes to a process-wide pool
+ *   keyed by host and port (the shim only speaks http://, so the scheme
+ *   is implied).  Idle sockets expire after PAL_POOL_IDLE_SEC; a pooled
+ *   socket the server closed meanwhile is detected before reuse, and a
+ *   request that gets no response on a reused socket is sent again on a
+ *   new connection.  Resolved addresses are cached for PAL_DNS_TTL_SEC.
  *
  * Overflow-safe arithmetic:
  *   content_length was previously read with strtod(), which loses precision
@@ -63,6 +79,15 @@
  *   All send()/recv() calls are retried on EINTR.  A signal (e.g. from
  *   the debugger or a real-time timer) no longer produces spurious I/O errors.
  *
+ * Disk sink (CURLOPT_PAL_SINK_FD):
+ *   Going through the write callback, the download thread alternated
+ *   between recv() and a slow PFS write().  With a sink fd the body is
+ *   received straight into large ftp_buffer_pool buffers and handed to a
+ *   writer thread over a pal_ring, the same pipeline as FTP STOR, so the
+ *   next buffer fills while the previous one is written.  Chunked bodies
+ *   are decoded in place: chunked_process() moves the payload down over
+ *   the chunk headers in the same buffer instead of copying it out.
+ *
  * CURL_WRITEFUNC_PAUSE:
  *   The original code looped forever on PAUSE with only usleep().
  *   We retry up to PAL_PAUSE_MAX_RETRIES times then abort with
@@ -74,6 +99,7 @@
  *               to avoid deeply-nested if-else ladders.
  *   Rule 21.3 — dynamic memory: malloc/free used only for body_buf
  *               and curl_slist nodes.  The ctx itself uses calloc/free.
+ *               Sink buffers come from ftp_buffer_pool.
  *   Rule 13.1 — side effects in initializers: none present.
  * ═══════════════════════════════════════════════════════════════════════════ */
 
@@ -85,6 +111,10 @@
 #endif
 
 #include "pal_curl.h"
+#include "ftp_buffer_pool.h"
+#include "pal_fileio.h"
+#include "pal_ring.h"
+#include "pal_thread.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -104,6 +134,7 @@
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <netdb.h>
+#include <pthread.h>
 
 int gettimeofday(struct timeval *tv, void *tz);
 
@@ -126,6 +157,22 @@ int gettimeofday(struct timeval *tv, void *tz);
 /** Sleep between PAUSE retries (100 ms). */
 #define PAL_PAUSE_DELAY_US      100000U
 
+/** Sink ring: pool buffers up front, growth limit, stalls per growth. */
+#define PAL_SINK_RING_DEPTH     3U
+#define PAL_SINK_RING_MAX_DEPTH 8U
+#define PAL_SINK_GROW_AFTER     2U
+
+/** Idle keep-alive sockets kept across transfers (all hosts together). */
+#define PAL_POOL_MAX            8U
+/** Idle sockets older than this are closed instead of reused. */
+#define PAL_POOL_IDLE_SEC       15
+/** Hosts remembered by the resolver cache. */
+#define PAL_DNS_MAX             16U
+/** Addresses kept per cached host. */
+#define PAL_DNS_ADDRS           4U
+/** Lifetime of a cached resolution (getaddrinfo reports no TTL). */
+#define PAL_DNS_TTL_SEC         60
+
 /* ── Internal context ──────────────────────────────────────────────────── */
 
 typedef struct {
@@ -155,10 +202,11 @@ typedef struct {
     int     post;               /* 1 = POST */
     int     verbose;            /* 1 = print debug to stderr */
     int     noprogress;         /* 1 = suppress xferinfo callback */
+    int     sink_fd;            /* CURLOPT_PAL_SINK_FD, -1 = off */
 
     /* ── Response info (populated by perform) ───────────────────── */
     long    response_code;
-    double  content_length_download;
+    curl_off_t content_length_download; /* -1 if unknown */
     double  speed_download;
     double  size_download;
     double  total_time;
@@ -171,6 +219,7 @@ typedef struct {
     int64_t content_length;     /* -1 if absent */
     int     chunked;            /* Transfer-Encoding: chunked */
     char    location[2048U];    /* Redirect target, if any */
+    int     keep_alive;         /* HTTP/1.1 without Connection: close */
 } http_resp_t;
 
 /* ── Chunked transfer decoder state ─────────────────────────────────────── */
@@ -189,6 +238,8 @@ typedef struct {
     size_t          size_pos;
     uint64_t        remaining;      /* Bytes left in current chunk */
     int             crlf_pos;       /* 0 or 1 while consuming post-data \r\n */
+    size_t          line_len;       /* Length of the current trailer line */
+    int             overrun;        /* Bytes followed the terminal chunk */
 } chunked_ctx_t;
 
 /* ── Speed guard (CURLOPT_LOW_SPEED_*) ─────────────────────────────────── */
@@ -199,6 +250,31 @@ typedef struct {
     int      slow_count;    /* consecutive seconds below threshold */
 } speed_guard_t;
 
+/* ── Resolver cache and keep-alive pool (process-wide) ─────────────────── */
+
+typedef struct {
+    int       used;
+    int       port;
+    time_t    expires;
+    size_t    naddr;
+    int       family[PAL_DNS_ADDRS];
+    socklen_t addrlen[PAL_DNS_ADDRS];
+    struct sockaddr_storage addr[PAL_DNS_ADDRS];
+    char      host[256U];
+} dns_entry_t;
+
+typedef struct {
+    int       used;
+    int       sock;
+    int       port;
+    time_t    idle_since;
+    char      host[256U];
+} pool_entry_t;
+
+static pthread_mutex_t g_net_lock = PTHREAD_MUTEX_INITIALIZER;
+static dns_entry_t     g_dns[PAL_DNS_MAX];
+static pool_entry_t    g_pool[PAL_POOL_MAX];
+
 /* ═══════════════════════════════════════════════════════════════════════════
  * §1 — String and error-buffer helpers
  * ═════════════════════════════════════════════════════════════════════════*/
@@ -365,7 +441,195 @@ static CURLcode url_parse(const char *url,
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §3 — Network utilities
+ * §3 — Resolver cache and keep-alive pool
+ * ═════════════════════════════════════════════════════════════════════════*/
+
+/**
+ * @brief Copy the cached addresses of host:port into out.
+ *
+ * @return 1 on a hit that has not expired, 0 otherwise.
+ *
+ * @note Thread-safety: safe (g_net_lock).
+ */
+static int dns_lookup(const char *host, int port, dns_entry_t *out)
+{
+    int hit = 0;
+    time_t now = time(NULL);
+
+    (void)pthread_mutex_lock(&g_net_lock);
+    for (size_t i = 0U; i < PAL_DNS_MAX; i++) {
+        const dns_entry_t *e = &g_dns[i];
+        if (e->used && (e->port == port) && (e->expires > now) &&
+            (strcmp(e->host, host) == 0)) {
+            *out = *e;
+            hit = 1;
+            break;
+        }
+    }
+    (void)pthread_mutex_unlock(&g_net_lock);
+    return hit;
+}
+
+/** @brief Drop the cache entry of host:port, if any. */
+static void dns_forget(const char *host, int port)
+{
+    (void)pthread_mutex_lock(&g_net_lock);
+    for (size_t i = 0U; i < PAL_DNS_MAX; i++) {
+        dns_entry_t *e = &g_dns[i];
+        if (e->used && (e->port == port) && (strcmp(e->host, host) == 0)) {
+            e->used = 0;
+        }
+    }
+    (void)pthread_mutex_unlock(&g_net_lock);
+}
+
+/**
+ * @brief Resolve host:port with getaddrinfo() and cache the result.
+ *
+ * Keeps the first PAL_DNS_ADDRS addresses in resolver order.  A full
+ * cache replaces the entry closest to expiry.
+ *
+ * @return 0 with out filled, -1 if the name does not resolve.
+ *
+ * @note Thread-safety: safe; the lookup itself runs unlocked.
+ */
+static int dns_resolve(const char *host, int port, dns_entry_t *out)
+{
+    char port_str[12U];
+    (void)snprintf(port_str, sizeof(port_str), "%d", port);
+
+    struct addrinfo hints;
+    (void)memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    struct addrinfo *result = NULL;
+    if (getaddrinfo(host, port_str, &hints, &result) != 0) { return -1; }
+
+    (void)memset(out, 0, sizeof(*out));
+    for (const struct addrinfo *rp = result;
+         (rp != NULL) && (out->naddr < PAL_DNS_ADDRS); rp = rp->ai_next) {
+        if ((size_t)rp->ai_addrlen > sizeof(out->addr[0])) { continue; }
+        out->family[out->naddr]  = rp->ai_family;
+        out->addrlen[out->naddr] = (socklen_t)rp->ai_addrlen;
+        (void)memcpy(&out->addr[out->naddr], rp->ai_addr,
+                     (size_t)rp->ai_addrlen);
+        out->naddr++;
+    }
+    freeaddrinfo(result);
+    if (out->naddr == 0U) { return -1; }
+
+    out->used    = 1;
+    out->port    = port;
+    out->expires = time(NULL) + PAL_DNS_TTL_SEC;
+    (void)snprintf(out->host, sizeof(out->host), "%s", host);
+
+    (void)pthread_mutex_lock(&g_net_lock);
+    size_t slot = 0U;
+    for (size_t i = 0U; i < PAL_DNS_MAX; i++) {
+        if (!g_dns[i].used) { slot = i; break; }
+        if (g_dns[i].expires < g_dns[slot].expires) { slot = i; }
+    }
+    g_dns[slot] = *out;
+    (void)pthread_mutex_unlock(&g_net_lock);
+    return 0;
+}
+
+/**
+ * @brief Check that an idle keep-alive socket is still usable.
+ *
+ * A healthy idle connection has nothing to read.  Readability means the
+ * server closed it (EOF) or sent something unsolicited; either way the
+ * next response could not be trusted.
+ *
+ * @return 1 if the socket can carry another request.
+ */
+static int pool_socket_alive(int sock)
+{
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(sock, &fds);
+    struct timeval tv = { 0, 0 };
+    return select(sock + 1, &fds, NULL, NULL, &tv) == 0;
+}
+
+/**
+ * @brief Take an idle connection to host:port out of the pool.
+ *
+ * Expired or server-closed sockets met on the way are closed.
+ *
+ * @return Socket fd, or -1 if none is available.
+ *
+ * @note Thread-safety: safe (g_net_lock).
+ */
+static int pool_take(const char *host, int port)
+{
+    int sock = -1;
+    time_t now = time(NULL);
+
+    (void)pthread_mutex_lock(&g_net_lock);
+    for (size_t i = 0U; (i < PAL_POOL_MAX) && (sock < 0); i++) {
+        pool_entry_t *e = &g_pool[i];
+        if (!e->used) { continue; }
+        if ((now - e->idle_since) >= PAL_POOL_IDLE_SEC) {
+            close(e->sock);
+            e->used = 0;
+            continue;
+        }
+        if ((e->port != port) || (strcmp(e->host, host) != 0)) { continue; }
+        e->used = 0;
+        if (pool_socket_alive(e->sock)) {
+            sock = e->sock;
+        } else {
+            close(e->sock);
+        }
+    }
+    (void)pthread_mutex_unlock(&g_net_lock);
+    return sock;
+}
+
+/**
+ * @brief Park a connection whose last response ended cleanly.
+ *
+ * A full pool closes its oldest idle socket to make room.
+ *
+ * @note Thread-safety: safe (g_net_lock).
+ */
+static void pool_put(const char *host, int port, int sock)
+{
+    (void)pthread_mutex_lock(&g_net_lock);
+    size_t slot = 0U;
+    for (size_t i = 0U; i < PAL_POOL_MAX; i++) {
+        if (!g_pool[i].used) { slot = i; break; }
+        if (g_pool[i].idle_since < g_pool[slot].idle_since) { slot = i; }
+    }
+    pool_entry_t *e = &g_pool[slot];
+    if (e->used) { close(e->sock); }
+    e->used       = 1;
+    e->sock       = sock;
+    e->port       = port;
+    e->idle_since = time(NULL);
+    (void)snprintf(e->host, sizeof(e->host), "%s", host);
+    (void)pthread_mutex_unlock(&g_net_lock);
+}
+
+/** @brief Close every pooled socket and forget every cached host. */
+static void pool_drain(void)
+{
+    (void)pthread_mutex_lock(&g_net_lock);
+    for (size_t i = 0U; i < PAL_POOL_MAX; i++) {
+        if (g_pool[i].used) {
+            close(g_pool[i].sock);
+            g_pool[i].used = 0;
+        }
+    }
+    (void)memset(g_dns, 0, sizeof(g_dns));
+    (void)pthread_mutex_unlock(&g_net_lock);
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ * §4 — Network utilities
  * ═════════════════════════════════════════════════════════════════════════*/
 
 /**
@@ -398,77 +662,48 @@ static int socket_wait(int sock, int for_write, long timeout_ms)
 }
 
 /**
- * @brief Resolve host and connect with an optional timeout.
+ * @brief Connect one resolved address with an optional timeout.
  *
- * Uses getaddrinfo() for IPv4/IPv6 support and tries each returned address
- * in order until one connects.  If timeout_ms > 0, the socket is set to
- * non-blocking for the connect() call and restored to blocking on success.
- *
- * @param host        NUL-terminated hostname or IP address.
- * @param port        TCP port [1, 65535].
- * @param timeout_ms  Connect timeout in ms (0 = blocking with no timeout).
- * @param err_out     Receives CURLE_COULDNT_RESOLVE_HOST or
- *                    CURLE_COULDNT_CONNECT on failure.
+ * If timeout_ms > 0, the socket is set to non-blocking for the connect()
+ * call and restored to blocking on success.
  *
- * @return Non-negative socket fd on success, -1 on failure.
+ * @return Connected socket fd, or -1.
  *
- * @note Thread-safety: getaddrinfo() is thread-safe on POSIX.
- * @note WCET: up to timeout_ms ms (DNS resolution not bounded).
+ * @note Thread-safety: pure, no shared state.
+ * @note WCET: up to timeout_ms ms.
  */
-static int net_connect(const char *host, int port, long timeout_ms,
-                        CURLcode *err_out)
+static int connect_addr(int family, const struct sockaddr *addr,
+                         socklen_t addrlen, long timeout_ms)
 {
-    *err_out = CURLE_COULDNT_CONNECT;
-
-    char port_str[12U];
-    (void)snprintf(port_str, sizeof(port_str), "%d", port);
-
-    struct addrinfo hints;
-    (void)memset(&hints, 0, sizeof(hints));
-    hints.ai_family   = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
-
-    struct addrinfo *result = NULL;
-    if (getaddrinfo(host, port_str, &hints, &result) != 0) {
-        *err_out = CURLE_COULDNT_RESOLVE_HOST;
-        return -1;
-    }
-
-    int sock = -1;
-    for (struct addrinfo *rp = result; rp != NULL; rp = rp->ai_next) {
-        sock = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-        if (sock < 0) { continue; }
+    int sock = socket(family, SOCK_STREAM, IPPROTO_TCP);
+    if (sock < 0) { return -1; }
 
-        if (timeout_ms > 0L) {
-            int flags = fcntl(sock, F_GETFL, 0);
-            if (fcntl(sock, F_SETFL, flags | O_NONBLOCK) != 0) {
-                close(sock); sock = -1; continue;
-            }
+    if (timeout_ms > 0L) {
+        int flags = fcntl(sock, F_GETFL, 0);
+        if (fcntl(sock, F_SETFL, flags | O_NONBLOCK) != 0) {
+            close(sock);
+            return -1;
         }
+    }
 
-        int r = connect(sock, rp->ai_addr, rp->ai_addrlen);
-
-        if (r == 0) { break; } /* Immediate success */
+    int r = connect(sock, addr, addrlen);
+    int ok = (r == 0); /* Immediate success */
 
-        if ((r < 0) && (errno == EINPROGRESS) && (timeout_ms > 0L)) {
-            int sel = socket_wait(sock, 1, timeout_ms);
-            if (sel > 0) {
-                int   so_err = 0;
-                socklen_t sl = (socklen_t)sizeof(so_err);
-                (void)getsockopt(sock, SOL_SOCKET, SO_ERROR, &so_err, &sl);
-                if (so_err == 0) { break; } /* Connected */
-            }
+    if ((r < 0) && (errno == EINPROGRESS) && (timeout_ms > 0L)) {
+        int sel = socket_wait(sock, 1, timeout_ms);
+        if (sel > 0) {
+            int   so_err = 0;
+            socklen_t sl = (socklen_t)sizeof(so_err);
+            (void)getsockopt(sock, SOL_SOCKET, SO_ERROR, &so_err, &sl);
+            ok = (so_err == 0); /* Connected */
         }
+    }
 
+    if (!ok) {
         close(sock);
-        sock = -1;
+        return -1;
     }
 
-    freeaddrinfo(result);
-
-    if (sock < 0) { return -1; }
-
     /* Restore blocking mode. */
     if (timeout_ms > 0L) {
         int flags = fcntl(sock, F_GETFL, 0);
@@ -482,6 +717,54 @@ static int net_connect(const char *host, int port, long timeout_ms,
     return sock;
 }
 
+/**
+ * @brief Resolve host (through the cache) and connect with an optional
+ *        timeout.
+ *
+ * Uses getaddrinfo() for IPv4/IPv6 support and tries each returned address
+ * in order until one connects.  A cached resolution whose addresses all
+ * fail is dropped and the host is resolved again once, so a server that
+ * moved is found without waiting for PAL_DNS_TTL_SEC.
+ *
+ * @param host        NUL-terminated hostname or IP address.
+ * @param port        TCP port [1, 65535].
+ * @param timeout_ms  Connect timeout in ms (0 = blocking with no timeout).
+ * @param err_out     Receives CURLE_COULDNT_RESOLVE_HOST or
+ *                    CURLE_COULDNT_CONNECT on failure.
+ *
+ * @return Non-negative socket fd on success, -1 on failure.
+ *
+ * @note Thread-safety: safe (the cache is locked; getaddrinfo() is
+ *       thread-safe on POSIX).
+ * @note WCET: up to timeout_ms ms per address (DNS resolution not bounded).
+ */
+static int net_connect(const char *host, int port, long timeout_ms,
+                        CURLcode *err_out)
+{
+    *err_out = CURLE_COULDNT_CONNECT;
+
+    dns_entry_t res;
+    int cached = dns_lookup(host, port, &res);
+
+    for (;;) {
+        if (!cached && (dns_resolve(host, port, &res) != 0)) {
+            *err_out = CURLE_COULDNT_RESOLVE_HOST;
+            return -1;
+        }
+
+        for (size_t i = 0U; i < res.naddr; i++) {
+            int sock = connect_addr(res.family[i],
+                                    (const struct sockaddr *)&res.addr[i],
+                                    res.addrlen[i], timeout_ms);
+            if (sock >= 0) { return sock; }
+        }
+
+        if (!cached) { return -1; }
+        dns_forget(host, port);
+        cached = 0; /* stale entry: resolve once more */
+    }
+}
+
 /**
  * @brief Reliably write all len bytes to sock, retrying on EINTR and
  *        partial writes.  Respects timeout_ms between attempts.
@@ -533,13 +816,13 @@ static ssize_t recv_timed(int sock, void *buf, size_t len, long timeout_ms)
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §4 — HTTP request builder
+ * §5 — HTTP request builder
  * ═════════════════════════════════════════════════════════════════════════*/
 
 /**
  * @brief Assemble an HTTP/1.1 request into buf.
  *
- * Includes Host, User-Agent, Accept, Connection: close, and optionally:
+ * Includes Host, User-Agent, Accept, Connection: keep-alive, and optionally:
  * Range, Content-Type/Content-Length (for POST), and caller-supplied
  * headers (curl_slist).
  *
@@ -568,7 +851,7 @@ static int build_request(const pal_curl_ctx_t *ctx,
                    "Host: %s:%d\r\n"
                    "User-Agent: %s\r\n"
                    "Accept: */*\r\n"
-                   "Connection: close\r\n",
+                   "Connection: keep-alive\r\n",
                    method, path, host, port, ua) != 0) { return -1; }
 
     if (ctx->range[0] != '\0') {
@@ -597,7 +880,7 @@ static int build_request(const pal_curl_ctx_t *ctx,
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §5 — HTTP response header reader and parser
+ * §6 — HTTP response header reader and parser
  * ═════════════════════════════════════════════════════════════════════════*/
 
 /**
@@ -687,6 +970,7 @@ static int parse_status_line(const char *hdr_buf, long *status_out)
  *   Content-Length     → info->content_length  (int64_t; -1 if absent)
  *   Transfer-Encoding  → info->chunked          (1 if "chunked")
  *   Location           → info->location[]
+ *   Connection         → info->keep_alive       (HTTP/1.1 default: 1)
  *
  * @param hdr_buf   Writable header buffer (NUL-terminated).
  * @param hdr_len   Byte count of header block, excluding terminal \r\n\r\n.
@@ -701,6 +985,7 @@ static void parse_header_fields(char *hdr_buf, size_t hdr_len,
     info->content_length = -1;
     info->chunked        = 0;
     info->location[0]    = '\0';
+    info->keep_alive     = (strncmp(hdr_buf, "HTTP/1.1", 8U) == 0) ? 1 : 0;
 
     /* Skip the status line. */
     char *p = strstr(hdr_buf, "\r\n");
@@ -730,6 +1015,13 @@ static void parse_header_fields(char *hdr_buf, size_t hdr_len,
             const char *loc = skip_ws(val);
             strncpy(info->location, loc, sizeof(info->location) - 1U);
             info->location[sizeof(info->location) - 1U] = '\0';
+        } else if ((val = header_field(p, "Connection:", 11U)) != NULL) {
+            const char *tok = skip_ws(val);
+            if (strncasecmp(tok, "close", 5U) == 0) {
+                info->keep_alive = 0;
+            } else if (strncasecmp(tok, "keep-alive", 10U) == 0) {
+                info->keep_alive = 1;
+            }
         }
 
         p[line_len] = saved;
@@ -739,7 +1031,7 @@ static void parse_header_fields(char *hdr_buf, size_t hdr_len,
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §6 — Chunked Transfer-Encoding decoder
+ * §7 — Chunked Transfer-Encoding decoder
  * ═════════════════════════════════════════════════════════════════════════*/
 
 /** Sentinel: chunked_process() sets this to signal the final zero chunk. */
@@ -756,7 +1048,8 @@ static void parse_header_fields(char *hdr_buf, size_t hdr_len,
  *   CS_SIZE    Accumulating the hex chunk-size line (+ optional extensions).
  *   CS_DATA    Forwarding chunk payload bytes to the write callback.
  *   CS_CRLF    Consuming the mandatory \r\n after payload.
- *   CS_TRAILER Consuming optional trailers after the zero-length chunk.
+ *   CS_TRAILER Consuming trailer lines up to the empty line that ends
+ *              the message, so the connection can carry the next one.
  *   CS_DONE    Terminal state; further calls return PAL_CHUNKED_DONE.
  *
  * @param cc          Persistent decoder state (caller-allocated).
@@ -764,7 +1057,12 @@ static void parse_header_fields(char *hdr_buf, size_t hdr_len,
  * @param in_len      Byte count in in[].
  * @param write_cb    Write callback (may be NULL).
  * @param write_data  Userdata for write_cb.
- * @param written_out Incremented with decoded bytes written to callback.
+ * @param out         In-place mode: payload is moved to out + *out_len
+ *                    instead of going to write_cb.  out may alias in as
+ *                    long as out + *out_len <= in (the payload only ever
+ *                    moves down).  NULL = callback mode.
+ * @param out_len     In/out fill level of out (in-place mode only).
+ * @param written_out Incremented with decoded bytes delivered.
  *
  * @return CURLE_OK to continue, PAL_CHUNKED_DONE when complete,
  *         CURLE_WRITE_ERROR or CURLE_RECV_ERROR on errors.
@@ -775,6 +1073,7 @@ static void parse_header_fields(char *hdr_buf, size_t hdr_len,
 static int chunked_process(chunked_ctx_t *cc,
                             const uint8_t *in, size_t in_len,
                             curl_write_callback write_cb, void *write_data,
+                            uint8_t *out, size_t *out_len,
                             uint64_t *written_out)
 {
     size_t i = 0U;
@@ -810,7 +1109,11 @@ static int chunked_process(chunked_ctx_t *cc,
             size_t to_write = (avail < (size_t)cc->remaining)
                               ? avail : (size_t)cc->remaining;
 
-            if ((to_write > 0U) && (write_cb != NULL)) {
+            if ((to_write > 0U) && (out != NULL)) {
+                (void)memmove(out + *out_len, in + i, to_write);
+                *out_len     += to_write;
+                *written_out += to_write;
+            } else if ((to_write > 0U) && (write_cb != NULL)) {
                 size_t wrote = write_cb((void *)(uintptr_t)(in + i), 1U, to_write,
                                         write_data);
                 if (wrote == (size_t)CURL_WRITEFUNC_PAUSE) {
@@ -845,14 +1148,24 @@ static int chunked_process(chunked_ctx_t *cc,
             i++;
             break;
 
-        case CS_TRAILER:
+        case CS_TRAILER: {
             /*
-             * Trailer headers after "0\r\n".  With Connection: close we
-             * will not reuse the connection, so we declare done immediately
-             * rather than parsing trailer key-value pairs.
+             * Trailer headers after "0\r\n", ignored, then the empty line.
+             * Anything after it would belong to no request we sent.
              */
-            cc->state = CS_DONE;
-            return PAL_CHUNKED_DONE;
+            char c = (char)in[i++];
+            if (c == '\n') {
+                if (cc->line_len == 0U) {
+                    cc->state   = CS_DONE;
+                    cc->overrun = (i < in_len) ? 1 : 0;
+                    return PAL_CHUNKED_DONE;
+                }
+                cc->line_len = 0U;
+            } else if (c != '\r') {
+                cc->line_len++;
+            }
+            break;
+        }
 
         case CS_DONE:
             return PAL_CHUNKED_DONE;
@@ -866,7 +1179,7 @@ static int chunked_process(chunked_ctx_t *cc,
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §7 — Speed guard
+ * §8 — Speed guard
  * ═════════════════════════════════════════════════════════════════════════*/
 
 static void speed_guard_init(speed_guard_t *sg, const pal_curl_ctx_t *ctx)
@@ -919,7 +1232,7 @@ static int speed_guard_update(speed_guard_t *sg, size_t new_bytes,
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §8 — Write-callback wrapper (PAUSE handling)
+ * §9 — Write-callback wrapper (PAUSE handling)
  * ═════════════════════════════════════════════════════════════════════════*/
 
 /**
@@ -960,7 +1273,7 @@ static CURLcode invoke_write_cb(curl_write_callback cb, const void *ptr,
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §9 — Body streaming
+ * §10 — Body streaming
  * ═════════════════════════════════════════════════════════════════════════*/
 
 /**
@@ -977,6 +1290,8 @@ static CURLcode invoke_write_cb(curl_write_callback cb, const void *ptr,
  * @param buf               Heap buffer (BODY_BUF_SIZE bytes).
  * @param buf_size          sizeof(buf).
  * @param bytes_out         Incremented with bytes delivered to callback.
+ * @param clean_end         Set to 1 if the connection ends exactly at the
+ *                           body end (nothing beyond it was received).
  *
  * @return CURLE_OK, CURLE_PARTIAL_FILE, CURLE_RECV_ERROR,
  *         CURLE_WRITE_ERROR, CURLE_OPERATION_TIMEDOUT,
@@ -990,12 +1305,14 @@ static CURLcode stream_body_known_length(int sock,
                                           uint64_t total,
                                           pal_curl_ctx_t *ctx,
                                           uint8_t *buf, size_t buf_size,
-                                          uint64_t *bytes_out)
+                                          uint64_t *bytes_out,
+                                          int *clean_end)
 {
     speed_guard_t sg;
     speed_guard_init(&sg, ctx);
 
     uint64_t remaining = total;
+    *clean_end = ((uint64_t)body_prefix_len <= total) ? 1 : 0;
 
     /* Drain prefix */
     if (body_prefix_len > 0U) {
@@ -1039,7 +1356,8 @@ static CURLcode stream_body_known_length(int sock,
  * @brief Stream a chunked-encoded body.
  *
  * Passes bytes to the chunked state machine, which decodes and forwards
- * payload to write_cb.
+ * payload to write_cb.  *clean_end is set to 1 once the terminal chunk
+ * and trailers were consumed with no further bytes behind them.
  *
  * @note Thread-safety: NOT thread-safe.
  */
@@ -1048,11 +1366,13 @@ static CURLcode stream_body_chunked(int sock,
                                      size_t body_prefix_len,
                                      pal_curl_ctx_t *ctx,
                                      uint8_t *buf, size_t buf_size,
-                                     uint64_t *bytes_out)
+                                     uint64_t *bytes_out,
+                                     int *clean_end)
 {
     chunked_ctx_t cc;
     (void)memset(&cc, 0, sizeof(cc));
     cc.state = CS_SIZE;
+    *clean_end = 0;
 
     speed_guard_t sg;
     speed_guard_init(&sg, ctx);
@@ -1060,8 +1380,12 @@ static CURLcode stream_body_chunked(int sock,
     /* Process any body bytes that arrived with the headers. */
     if (body_prefix_len > 0U) {
         int r = chunked_process(&cc, body_prefix, body_prefix_len,
-                                 ctx->write_cb, ctx->write_data, bytes_out);
-        if (r == PAL_CHUNKED_DONE) { return CURLE_OK; }
+                                 ctx->write_cb, ctx->write_data, NULL, NULL,
+                                 bytes_out);
+        if (r == PAL_CHUNKED_DONE) {
+            *clean_end = (cc.state == CS_DONE) && !cc.overrun;
+            return CURLE_OK;
+        }
         if (r != CURLE_OK)         { return (CURLcode)r; }
     }
 
@@ -1076,12 +1400,16 @@ static CURLcode stream_body_chunked(int sock,
 
         uint64_t prev = *bytes_out;
         int r = chunked_process(&cc, buf, (size_t)n,
-                                 ctx->write_cb, ctx->write_data, bytes_out);
+                                 ctx->write_cb, ctx->write_data, NULL, NULL,
+                                 bytes_out);
 
         if (!speed_guard_update(&sg, (size_t)(*bytes_out - prev), ctx)) {
             return CURLE_OPERATION_TIMEDOUT;
         }
-        if (r == PAL_CHUNKED_DONE) { return CURLE_OK; }
+        if (r == PAL_CHUNKED_DONE) {
+            *clean_end = (cc.state == CS_DONE) && !cc.overrun;
+            return CURLE_OK;
+        }
         if (r != CURLE_OK)         { return (CURLcode)r; }
 
         if ((ctx->xferinfo_cb != NULL) && (ctx->noprogress == 0)) {
@@ -1138,8 +1466,301 @@ static CURLcode stream_body_until_close(int sock,
     return CURLE_OK;
 }
 
+/**
+ * @brief Dispatch to the body reader matching the response framing.
+ *
+ * @param clean_end  Set to 1 if the connection may carry another request.
+ *
+ * @note Thread-safety: NOT thread-safe.
+ */
+static CURLcode stream_body(int sock, const uint8_t *body_prefix,
+                             size_t body_prefix_len, const http_resp_t *resp,
+                             pal_curl_ctx_t *ctx, uint64_t *bytes_out,
+                             int *clean_end)
+{
+    uint8_t *body_buf = (uint8_t *)malloc(BODY_BUF_SIZE);
+    if (body_buf == NULL) {
+        set_errbuf(ctx, "Out of memory for body buffer");
+        return CURLE_OUT_OF_MEMORY;
+    }
+
+    CURLcode rc;
+    *clean_end = 0;
+    if (resp->chunked != 0) {
+        rc = stream_body_chunked(sock, body_prefix, body_prefix_len, ctx,
+                                  body_buf, BODY_BUF_SIZE, bytes_out,
+                                  clean_end);
+    } else if (resp->content_length >= 0) {
+        rc = stream_body_known_length(sock, body_prefix, body_prefix_len,
+                                       (uint64_t)resp->content_length,
+                                       ctx, body_buf, BODY_BUF_SIZE,
+                                       bytes_out, clean_end);
+    } else {
+        rc = stream_body_until_close(sock, body_prefix, body_prefix_len, ctx,
+                                      body_buf, BODY_BUF_SIZE, bytes_out);
+    }
+
+    free(body_buf);
+    return rc;
+}
+
+/* ── Disk sink ──────────────────────────────────────────────────────────── */
+
+typedef struct {
+    pal_ring_t ring;
+    int        fd;
+} sink_writer_t;
+
+static void *sink_ring_alloc(void *arg)
+{
+    (void)arg;
+    return ftp_buffer_acquire();
+}
+
+static void sink_ring_release(void *buf, void *arg)
+{
+    (void)arg;
+    ftp_buffer_release(buf);
+}
+
+/** @brief Write every whole buffer to the sink fd, in ring order. */
+static void *sink_writer_thread(void *arg)
+{
+    sink_writer_t *w = (sink_writer_t *)arg;
+
+    for (;;) {
+        size_t len = 0U;
+        const uint8_t *buf = (const uint8_t *)pal_ring_peek(&w->ring, &len);
+        if (buf == NULL) { break; } /* drained after close, or aborted */
+
+        size_t off = 0U;
+        while (off < len) {
+            ssize_t n = write(w->fd, buf + off, len - off);
+            if ((n < 0) && (errno == EINTR)) { continue; }
+            if (n <= 0) {
+                pal_ring_abort(&w->ring, ((n < 0) && (errno != 0)) ? errno : EIO);
+                return NULL;
+            }
+            off += (size_t)n;
+        }
+        pal_ring_consume(&w->ring, (void *)(uintptr_t)buf);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Fallback write callback: the sink fd written synchronously, for
+ *        when the pipeline cannot be set up (pool exhausted, no thread).
+ */
+static size_t sink_fd_write(void *ptr, size_t size, size_t nmemb,
+                            void *userdata)
+{
+    int fd = *(const int *)userdata;
+    const char *p = (const char *)ptr;
+    size_t left = size * nmemb;
+
+    while (left > 0U) {
+        ssize_t n = write(fd, p, left);
+        if ((n < 0) && (errno == EINTR)) { continue; }
+        if (n <= 0) { return 0U; }
+        p    += (size_t)n;
+        left -= (size_t)n;
+    }
+    return size * nmemb;
+}
+
+/**
+ * @brief Stream the body into ctx->sink_fd through a receive/write
+ *        pipeline.
+ *
+ * The calling thread receives directly into pool buffers (chunked
+ * framing is stripped in place) and commits each full buffer to a ring;
+ * sink_writer_thread() writes them out.  A known Content-Length is
+ * preallocated, and trimmed back if the transfer ends short.  Whatever
+ * was received is written even when the transfer fails, so the file
+ * always holds exactly *bytes_out bytes from its starting offset.
+ *
+ * @return Same codes as the other readers; CURLE_WRITE_ERROR if the
+ *         writer failed.
+ *
+ * @note Thread-safety: NOT thread-safe (starts one writer thread).
+ */
+static CURLcode stream_body_sink(int sock, const uint8_t *body_prefix,
+                                  size_t body_prefix_len,
+                                  const http_resp_t *resp,
+                                  pal_curl_ctx_t *ctx, uint64_t *bytes_out,
+                                  int *clean_end)
+{
+    CURLcode rc;
+    *clean_end = 0;
+
+    sink_writer_t w;
+    pal_ring_config_t cfg;
+    cfg.initial_depth = PAL_SINK_RING_DEPTH;
+    cfg.max_depth     = PAL_SINK_RING_MAX_DEPTH;
+    cfg.grow_after    = PAL_SINK_GROW_AFTER;
+    cfg.slot_size     = ftp_buffer_size();
+    cfg.alloc         = sink_ring_alloc;
+    cfg.release       = sink_ring_release;
+    cfg.ctx           = NULL;
+    w.fd = ctx->sink_fd;
+
+    pthread_t writer;
+    int piped = (cfg.slot_size >= HDR_BUF_SIZE) &&
+                (pal_ring_init(&w.ring, &cfg) == 0);
+    if (piped && (pal_thread_create(&writer, NULL, PAL_THREAD_DISK,
+                                    sink_writer_thread, &w) != 0)) {
+        pal_ring_destroy(&w.ring);
+        piped = 0;
+    }
+    if (!piped) {
+        curl_write_callback cb = ctx->write_cb;
+        void *cb_data          = ctx->write_data;
+        ctx->write_cb   = sink_fd_write;
+        ctx->write_data = &ctx->sink_fd;
+        rc = stream_body(sock, body_prefix, body_prefix_len, resp, ctx,
+                         bytes_out, clean_end);
+        ctx->write_cb   = cb;
+        ctx->write_data = cb_data;
+        return rc;
+    }
+
+    int64_t total = (resp->chunked != 0) ? -1 : resp->content_length;
+    off_t   start = lseek(ctx->sink_fd, 0, SEEK_CUR);
+    int     preallocated = 0;
+    if ((total > 0) && (start >= 0)) {
+        preallocated = (pal_file_preallocate(ctx->sink_fd,
+                                             start + (off_t)total) == FTP_OK);
+    }
+
+    chunked_ctx_t cc;
+    (void)memset(&cc, 0, sizeof(cc));
+    cc.state = CS_SIZE;
+    speed_guard_t sg;
+    speed_guard_init(&sg, ctx);
+
+    uint64_t remaining = (total >= 0) ? (uint64_t)total : UINT64_MAX;
+    int      overrun   = (total >= 0) && ((uint64_t)body_prefix_len > remaining);
+    int      done      = 0;
+    size_t   slot      = cfg.slot_size;
+    size_t   fill      = 0U;
+    uint8_t *buf       = (uint8_t *)pal_ring_acquire(&w.ring);
+    rc = CURLE_OK;
+
+    /* Body bytes that arrived with the headers (≤ HDR_BUF_SIZE ≤ slot). */
+    if ((buf != NULL) && (body_prefix_len > 0U)) {
+        if (resp->chunked != 0) {
+            int r = chunked_process(&cc, body_prefix, body_prefix_len,
+                                    NULL, NULL, buf, &fill, bytes_out);
+            if (r == PAL_CHUNKED_DONE) {
+                done       = 1;
+                *clean_end = !cc.overrun;
+            } else if (r != CURLE_OK) {
+                rc = (CURLcode)r;
+            }
+        } else {
+            size_t n = ((uint64_t)body_prefix_len > remaining)
+                       ? (size_t)remaining : body_prefix_len;
+            (void)memcpy(buf, body_prefix, n);
+            fill        = n;
+            *bytes_out += n;
+            if (total >= 0) { remaining -= (uint64_t)n; }
+        }
+    }
+    if ((total >= 0) && (remaining == 0U)) {
+        done       = 1;
+        *clean_end = !overrun;
+    }
+
+    while ((rc == CURLE_OK) && !done) {
+        if (buf == NULL) { rc = CURLE_WRITE_ERROR; break; } /* writer failed */
+        if (fill == slot) {
+            pal_ring_commit(&w.ring, buf, fill);
+            buf  = (uint8_t *)pal_ring_acquire(&w.ring);
+            fill = 0U;
+            continue;
+        }
+
+        size_t want = slot - fill;
+        if ((total >= 0) && (remaining < (uint64_t)want)) {
+            want = (size_t)remaining;
+        }
+        ssize_t n = recv_timed(sock, buf + fill, want, ctx->timeout_ms);
+        if (n < 0) { rc = CURLE_RECV_ERROR; break; }
+        if (n == 0) {
+            /* EOF: the end only for a body without framing. */
+            if (resp->chunked != 0) {
+                rc = (cc.state == CS_TRAILER) ? CURLE_OK : CURLE_PARTIAL_FILE;
+            } else if (total >= 0) {
+                rc = CURLE_PARTIAL_FILE;
+            }
+            break;
+        }
+
+        uint64_t prev = *bytes_out;
+        if (resp->chunked != 0) {
+            /* Payload moves down over the chunk framing: out ≤ in. */
+            int r = chunked_process(&cc, buf + fill, (size_t)n, NULL, NULL,
+                                    buf, &fill, bytes_out);
+            if (r == PAL_CHUNKED_DONE) {
+                done       = 1;
+                *clean_end = !cc.overrun;
+            } else if (r != CURLE_OK) {
+                rc = (CURLcode)r;
+                break;
+            }
+        } else {
+            fill       += (size_t)n;
+            *bytes_out += (uint64_t)n;
+            if (total >= 0) {
+                remaining -= (uint64_t)n;
+                if (remaining == 0U) {
+                    done       = 1;
+                    *clean_end = !overrun;
+                }
+            }
+        }
+
+        if (!speed_guard_update(&sg, (size_t)(*bytes_out - prev), ctx)) {
+            rc = CURLE_OPERATION_TIMEDOUT;
+            break;
+        }
+        if ((ctx->xferinfo_cb != NULL) && (ctx->noprogress == 0)) {
+            int pr = ctx->xferinfo_cb(ctx->xferinfo_data,
+                                      (curl_off_t)((total >= 0) ? total : 0),
+                                      (curl_off_t)*bytes_out, 0, 0);
+            if (pr != 0) { rc = CURLE_ABORTED_BY_CALLBACK; }
+        }
+    }
+
+    /* Flush what was received, even on failure; the writer drains it. */
+    if (buf != NULL) {
+        if (fill > 0U) {
+            pal_ring_commit(&w.ring, buf, fill);
+        } else {
+            pal_ring_unacquire(&w.ring, buf);
+        }
+    }
+    pal_ring_close(&w.ring);
+    (void)pthread_join(writer, NULL);
+    if (pal_ring_error(&w.ring) != 0) {
+        set_errbuf(ctx, "Failed to write the body to the sink file");
+        rc = CURLE_WRITE_ERROR;
+        *clean_end = 0;
+    }
+    pal_ring_destroy(&w.ring);
+
+    if (preallocated) {
+        off_t end = lseek(ctx->sink_fd, 0, SEEK_CUR);
+        if ((end >= 0) && (end < start + (off_t)total)) {
+            (void)ftruncate(ctx->sink_fd, end); /* FreeBSD grew it */
+        }
+    }
+    return rc;
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
- * §10 — Redirect URL resolver
+ * §11 — Redirect URL resolver
  * ═════════════════════════════════════════════════════════════════════════*/
 
 /**
@@ -1187,7 +1808,7 @@ static void resolve_redirect(const char *base_url, const char *location,
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §11 — Single-request performer
+ * §12 — Single-request performer
  * ═════════════════════════════════════════════════════════════════════════*/
 
 /**
@@ -1217,18 +1838,7 @@ static CURLcode perform_one(pal_curl_ctx_t *ctx, const char *url,
         return rc;
     }
 
-    /* ── Connect ────────────────────────────────────────────────── */
-    CURLcode conn_err;
-    long conn_to = (ctx->connect_timeout_ms > 0L) ? ctx->connect_timeout_ms
-                                                   : DEFAULT_CONN_MS;
-    int sock = net_connect(host, port, conn_to, &conn_err);
-    if (sock < 0) {
-        set_errbuf(ctx, "Connection failed");
-        return conn_err;
-    }
-    PAL_LOG(ctx, "Connected to %s:%d\n", host, port);
-
-    /* ── Build and send request ─────────────────────────────────── */
+    /* ── Build request ──────────────────────────────────────────── */
     char req_buf[REQ_BUF_SIZE];
     const char *method = (ctx->nobody != 0) ? "HEAD"
                        : (ctx->post   != 0) ? "POST"
@@ -1236,42 +1846,65 @@ static CURLcode perform_one(pal_curl_ctx_t *ctx, const char *url,
     int req_len = build_request(ctx, method, host, port, path,
                                 req_buf, sizeof(req_buf));
     if (req_len <= 0) {
-        close(sock);
         set_errbuf(ctx, "Request too large for buffer");
         return CURLE_SEND_ERROR;
     }
 
+    long conn_to = (ctx->connect_timeout_ms > 0L) ? ctx->connect_timeout_ms
+                                                   : DEFAULT_CONN_MS;
     long send_to = (ctx->timeout_ms > 0L) ? ctx->timeout_ms : conn_to;
-    if (send_all(sock, req_buf, (size_t)req_len, send_to) != 0) {
-        close(sock);
-        set_errbuf(ctx, "Failed to send request headers");
-        return CURLE_SEND_ERROR;
-    }
-    PAL_LOG(ctx, "→ %s %s\n", method, path);
+    long recv_to = (ctx->timeout_ms > 0L) ? ctx->timeout_ms : DEFAULT_CONN_MS;
+    char   hdr_buf[HDR_BUF_SIZE];
+    size_t hdr_len       = 0U;
+    size_t body_pfx_len  = 0U;
+    int    sock;
 
-    /* ── Send POST body ─────────────────────────────────────────── */
-    if ((ctx->post != 0) && (ctx->postfields != NULL)) {
-        long plen = (ctx->postfieldsize > 0L) ? ctx->postfieldsize
-                                               : (long)strlen(ctx->postfields);
-        if (send_all(sock, ctx->postfields, (size_t)plen, send_to) != 0) {
+    /*
+     * A pooled socket may have been closed by the server after the idle
+     * check: if it fails before any response byte, the request is sent
+     * again, on the next pooled socket or a new connection.
+     */
+    for (;;) {
+        /* ── Connect ────────────────────────────────────────────── */
+        sock = pool_take(host, port);
+        int reused = (sock >= 0);
+        if (!reused) {
+            CURLcode conn_err;
+            sock = net_connect(host, port, conn_to, &conn_err);
+            if (sock < 0) {
+                set_errbuf(ctx, "Connection failed");
+                return conn_err;
+            }
+            PAL_LOG(ctx, "Connected to %s:%d\n", host, port);
+        } else {
+            PAL_LOG(ctx, "Reusing connection to %s:%d\n", host, port);
+        }
+
+        /* ── Send request (and POST body) ───────────────────────── */
+        int sent = (send_all(sock, req_buf, (size_t)req_len, send_to) == 0);
+        if (sent && (ctx->post != 0) && (ctx->postfields != NULL)) {
+            long plen = (ctx->postfieldsize > 0L) ? ctx->postfieldsize
+                                                   : (long)strlen(ctx->postfields);
+            sent = (send_all(sock, ctx->postfields, (size_t)plen, send_to) == 0);
+        }
+        if (!sent) {
             close(sock);
-            set_errbuf(ctx, "Failed to send POST body");
+            if (reused) { continue; }
+            set_errbuf(ctx, "Failed to send request");
             return CURLE_SEND_ERROR;
         }
-    }
-
-    /* ── Read response headers ──────────────────────────────────── */
-    char   hdr_buf[HDR_BUF_SIZE];
-    size_t hdr_len       = 0U;
-    size_t body_pfx_len  = 0U;
-    long   recv_to = (ctx->timeout_ms > 0L) ? ctx->timeout_ms : DEFAULT_CONN_MS;
+        PAL_LOG(ctx, "→ %s %s\n", method, path);
 
-    rc = http_recv_headers(sock, recv_to, hdr_buf, sizeof(hdr_buf),
-                           &hdr_len, &body_pfx_len);
-    if (rc != CURLE_OK) {
-        close(sock);
-        set_errbuf(ctx, "Failed to receive response headers");
-        return rc;
+        /* ── Read response headers ──────────────────────────────── */
+        rc = http_recv_headers(sock, recv_to, hdr_buf, sizeof(hdr_buf),
+                               &hdr_len, &body_pfx_len);
+        if (rc != CURLE_OK) {
+            close(sock);
+            if (reused) { continue; }
+            set_errbuf(ctx, "Failed to receive response headers");
+            return rc;
+        }
+        break;
     }
 
     /* ── Parse status line ──────────────────────────────────────── */
@@ -1294,7 +1927,7 @@ static CURLcode perform_one(pal_curl_ctx_t *ctx, const char *url,
     resp.status_code = *status_out;
 
     ctx->content_length_download = (resp.content_length >= 0)
-                                   ? (double)resp.content_length : -1.0;
+                                   ? (curl_off_t)resp.content_length : -1;
 
     /* ── Redirect URL ────────────────────────────────────────────── */
     if ((redirect_out != NULL) && (resp.location[0] != '\0')) {
@@ -1305,42 +1938,37 @@ static CURLcode perform_one(pal_curl_ctx_t *ctx, const char *url,
 
     /* ── HEAD / error: no body to read ─────────────────────────── */
     if ((ctx->nobody != 0) || (*status_out >= 400)) {
-        close(sock);
+        if ((ctx->nobody != 0) && resp.keep_alive && (body_pfx_len == 0U)) {
+            pool_put(host, port, sock);
+        } else {
+            close(sock); /* an error body is left unread */
+        }
         *bytes_out = 0U;
         return CURLE_OK;
     }
 
-    /* ── Allocate body streaming buffer ─────────────────────────── */
-    uint8_t *body_buf = (uint8_t *)malloc(BODY_BUF_SIZE);
-    if (body_buf == NULL) {
-        close(sock);
-        set_errbuf(ctx, "Out of memory for body buffer");
-        return CURLE_OUT_OF_MEMORY;
-    }
-
     const uint8_t *pfx = (const uint8_t *)(hdr_buf + hdr_len);
 
     /* ── Stream body ─────────────────────────────────────────────── */
-    if (resp.chunked != 0) {
-        rc = stream_body_chunked(sock, pfx, body_pfx_len, ctx,
-                                  body_buf, BODY_BUF_SIZE, bytes_out);
-    } else if (resp.content_length >= 0) {
-        rc = stream_body_known_length(sock, pfx, body_pfx_len,
-                                       (uint64_t)resp.content_length,
-                                       ctx, body_buf, BODY_BUF_SIZE,
-                                       bytes_out);
+    int clean_end = 0;
+    if ((ctx->sink_fd >= 0) && (*status_out >= 200L) && (*status_out < 300L)) {
+        rc = stream_body_sink(sock, pfx, body_pfx_len, &resp, ctx,
+                              bytes_out, &clean_end);
     } else {
-        rc = stream_body_until_close(sock, pfx, body_pfx_len, ctx,
-                                      body_buf, BODY_BUF_SIZE, bytes_out);
+        rc = stream_body(sock, pfx, body_pfx_len, &resp, ctx, bytes_out,
+                         &clean_end);
     }
 
-    free(body_buf);
-    close(sock);
+    if ((rc == CURLE_OK) && resp.keep_alive && clean_end) {
+        pool_put(host, port, sock);
+    } else {
+        close(sock);
+    }
     return rc;
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §12 — Public API
+ * §13 — Public API
  * ═════════════════════════════════════════════════════════════════════════*/
 
 CURLcode curl_global_init(long flags)
@@ -1351,7 +1979,7 @@ CURLcode curl_global_init(long flags)
 
 void curl_global_cleanup(void)
 {
-    /* No-op. */
+    pool_drain();
 }
 
 CURL *curl_easy_init(void)
@@ -1362,7 +1990,8 @@ CURL *curl_easy_init(void)
     ctx->connect_timeout_ms  = DEFAULT_CONN_MS;
     ctx->timeout_ms          = DEFAULT_TIMEOUT_MS;
     ctx->noprogress          = 1;
-    ctx->content_length_download = -1.0;
+    ctx->sink_fd             = -1;
+    ctx->content_length_download = -1;
     return (CURL *)ctx;
 }
 
@@ -1375,7 +2004,8 @@ void curl_easy_reset(CURL *handle)
     ctx->connect_timeout_ms      = DEFAULT_CONN_MS;
     ctx->timeout_ms              = DEFAULT_TIMEOUT_MS;
     ctx->noprogress              = 1;
-    ctx->content_length_download = -1.0;
+    ctx->sink_fd                 = -1;
+    ctx->content_length_download = -1;
 }
 
 void curl_easy_cleanup(CURL *handle)
@@ -1481,6 +2111,9 @@ CURLcode curl_easy_setopt(CURL *handle, CURLoption option, ...)
     case CURLOPT_LOW_SPEED_TIME:
         ctx->low_speed_time = va_arg(ap, long);
         break;
+    case CURLOPT_PAL_SINK_FD:
+        ctx->sink_fd = (int)va_arg(ap, long);
+        break;
     case CURLOPT_SSL_VERIFYPEER:
         (void)va_arg(ap, long); /* accepted, ignored */
         break;
@@ -1518,7 +2151,7 @@ CURLcode curl_easy_perform(CURL *handle)
     ctx->size_download           = 0.0;
     ctx->speed_download          = 0.0;
     ctx->total_time              = 0.0;
-    ctx->content_length_download = -1.0;
+    ctx->content_length_download = -1;
 
     struct timeval tv_start, tv_end;
     (void)gettimeofday(&tv_start, NULL);
@@ -1593,7 +2226,12 @@ CURLcode curl_easy_getinfo(CURL *handle, CURLINFO info, ...)
     }
     case CURLINFO_CONTENT_LENGTH_DOWNLOAD: {
         double *dp = va_arg(ap, double *);
-        if (dp != NULL) { *dp = ctx->content_length_download; }
+        if (dp != NULL) { *dp = (double)ctx->content_length_download; }
+        break;
+    }
+    case CURLINFO_CONTENT_LENGTH_DOWNLOAD_T: {
+        curl_off_t *op = va_arg(ap, curl_off_t *);
+        if (op != NULL) { *op = ctx->content_length_download; }
         break;
     }
     case CURLINFO_SIZE_DOWNLOAD: {
@@ -1650,7 +2288,7 @@ const char *curl_version(void)
 }
 
 /* ═══════════════════════════════════════════════════════════════════════════
- * §13 — curl_slist
+ * §14 — curl_slist
  * ═════════════════════════════════════════════════════════════════════════*/
 
 curl_slist *curl_slist_append(curl_slist *list, const char *data)
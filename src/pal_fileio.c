@@ -36,6 +36,7 @@ SOFTWARE.
 #include "ftp_log.h"
 #include "pal_alloc.h"
 #include "pal_network.h"
+#include "pal_thread.h"
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -46,6 +47,10 @@ SOFTWARE.
 #include <sys/statvfs.h>
 #include <unistd.h>
 
+#if defined(__linux__)
+#include <sys/mman.h> /* mincore() residency probe */
+#endif
+
 /* Fallback buffer size for non-sendfile platforms */
 #define FALLBACK_BUFFER_SIZE FTP_BUFFER_SIZE
 
@@ -133,13 +138,13 @@ SOFTWARE.
 #endif
 
 /*---------------------------------------------------------------------------*
- * DOUBLE-BUFFER COPY PIPELINE (PS4 and PS5)
+ * RING COPY PIPELINE (PS4 and PS5)
  *
- * Two buffers alternate between a reader thread (USB exFAT) and the
+ * A pal_ring of buffers sits between a reader thread (USB exFAT) and the
  * calling thread (NVMe/HDD PFS writer), fully overlapping I/O:
  *
  *   Cycle N:    [read buf A from USB]  [write buf B to storage]
- *   Cycle N+1:  [read buf B from USB]  [write buf A to storage]
+ *   Cycle N+1:  [read buf C from USB]  [write buf A to storage]
  *
  * PS5: writer (NVMe, ~215 MB/s) is the bottleneck; reader (USB, ~363 MB/s)
  *      always finishes first.  Net throughput: 215 MB/s.
@@ -147,76 +152,68 @@ SOFTWARE.
  *      always finishes first.  Net throughput: ~85 MB/s (vs ~67 MB/s serial).
  *
  * Thread roles:
- *   Main thread   — writer: drains the filled buffer to dst_fd, calls
- *                           the progress callback, signals cv_free.
- *   Reader thread — reads from src_fd into the free buffer, signals
- *                           cv_ready when a full chunk is available.
+ *   Main thread   — consumer: drains filled buffers to dst_fd, calls the
+ *                             progress callback, returns them to the ring.
+ *   Reader thread — producer: reads src_fd into free buffers and commits
+ *                             them; closes the ring on EOF or error.
  *
- * State machine (protected by pipe_mtx):
- *   fill_idx    — buffer currently being read into (0 or 1)
- *   drain_idx   — buffer currently being written out (1-fill_idx)
- *   len[i]      — bytes available in buffer i (0 = free, >0 = ready)
- *   done        — reader has hit EOF or error
- *   reader_err  — non-zero errno set by reader on error
+ * The ring starts at two buffers (the old double buffer) and grows up to
+ * PAL_FILE_COPY_RING_MAX_DEPTH when the writer stalls repeatedly, e.g.
+ * during PFS journal flushes.  Growth stops quietly once pal_malloc()
+ * fails, so the arena budget is never exceeded.
  *---------------------------------------------------------------------------*/
+#include "pal_ring.h"
 #include <pthread.h>
 
+#ifndef PAL_FILE_COPY_RING_MAX_DEPTH
+#define PAL_FILE_COPY_RING_MAX_DEPTH 4U
+#endif
+
+#ifndef PAL_FILE_COPY_RING_GROW_AFTER
+#define PAL_FILE_COPY_RING_GROW_AFTER 2U
+#endif
+
 typedef struct {
-  uint8_t *buf[2]; /* two PAL_FILE_COPY_BUFFER_SIZE buffers          */
-  size_t len[2];   /* bytes filled in each buffer (0 = free)         */
-  int fill_idx;    /* index reader is filling right now              */
-  int src_fd;      /* source file descriptor                         */
-  size_t buf_sz;   /* PAL_FILE_COPY_BUFFER_SIZE                      */
-  int done;        /* reader set to 1 on EOF or error                */
-  int reader_err;  /* errno from reader (0 = ok)                     */
-  pthread_mutex_t mtx;
-  pthread_cond_t cv_ready; /* writer waits: "buffer filled and ready"        */
-  pthread_cond_t cv_free;  /* reader waits: "buffer drained and free"        */
-} copy_pipe_t;
+  pal_ring_t ring;
+  int src_fd;     /* source file descriptor                         */
+  int reader_err; /* errno from reader (0 = ok)                     */
+} copy_reader_t;
+
+static void *copy_ring_alloc(void *ctx) {
+  (void)ctx;
+  return pal_malloc(PAL_FILE_COPY_BUFFER_SIZE);
+}
+
+static void copy_ring_release(void *buf, void *ctx) {
+  (void)ctx;
+  pal_free(buf);
+}
 
 static void *copy_reader_thread(void *arg) {
-  copy_pipe_t *p = (copy_pipe_t *)arg;
+  copy_reader_t *r = (copy_reader_t *)arg;
 
-  pthread_mutex_lock(&p->mtx);
   for (;;) {
-    int fi = p->fill_idx;
-
-    /* Wait until the fill buffer is free (len[fi] == 0) */
-    while ((p->len[fi] != 0U) && (p->done == 0)) {
-      pthread_cond_wait(&p->cv_free, &p->mtx);
-    }
-    if (p->done != 0) {
+    uint8_t *buf = (uint8_t *)pal_ring_acquire(&r->ring);
+    if (buf == NULL) {
       break; /* main thread requested stop (write error or cancel) */
     }
 
-    pthread_mutex_unlock(&p->mtx);
-
-    /* Read without holding the lock — this is the slow USB read */
+    /* Slow USB read — no lock held anywhere on this path */
     ssize_t n;
     do {
-      n = read(p->src_fd, p->buf[fi], p->buf_sz);
+      n = read(r->src_fd, buf, (size_t)PAL_FILE_COPY_BUFFER_SIZE);
     } while ((n < 0) && (errno == EINTR));
 
-    pthread_mutex_lock(&p->mtx);
-
-    if (n < 0) {
-      p->reader_err = errno;
-      p->done = 1;
-      pthread_cond_signal(&p->cv_ready);
-      break;
-    }
-    if (n == 0) {
-      /* EOF */
-      p->done = 1;
-      pthread_cond_signal(&p->cv_ready);
-      break;
+    if (n <= 0) {
+      if (n < 0) {
+        r->reader_err = errno;
+      }
+      pal_ring_unacquire(&r->ring, buf);
+      break; /* EOF or error */
     }
-
-    p->len[fi] = (size_t)n;
-    p->fill_idx = 1 - fi; /* swap to the other buffer */
-    pthread_cond_signal(&p->cv_ready);
+    pal_ring_commit(&r->ring, buf, (size_t)n);
   }
-  pthread_mutex_unlock(&p->mtx);
+  pal_ring_close(&r->ring);
   return NULL;
 }
 
@@ -417,6 +414,354 @@ ssize_t pal_sendfile(int sock_fd, int file_fd, off_t *offset, size_t count) {
 #endif
 }
 
+/*===========================================================================*
+ * ZERO-COPY FILE RECEIVE (Linux splice)
+ *
+ *   socket ──splice──► pipe ──splice──► file
+ *
+ *   Pages move from the socket receive queue into the pipe and from the
+ *   pipe into the page cache of the target file; no byte is copied through
+ *   userspace.  The pipe is the only intermediate, so the caller's buffer is
+ *   needed only as a bounce area when the filesystem rejects splice_write
+ *   mid-stream (the bytes already sitting in the pipe must not be lost).
+ *===========================================================================*/
+
+ftp_error_t pal_splice_socket_to_file(int sock_fd, int file_fd, off_t *offset,
+                                      void *bounce, size_t bounce_sz,
+                                      pal_copy_progress_cb_t cb,
+                                      void *user_data, uint64_t *out_bytes) {
+  if (out_bytes != NULL) {
+    *out_bytes = 0U;
+  }
+  if ((sock_fd < 0) || (file_fd < 0) || (offset == NULL) || (*offset < 0) ||
+      (bounce == NULL) || (bounce_sz == 0U) || (out_bytes == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+#if HAS_SPLICE
+  int pfd[2];
+  if (pipe2(pfd, O_CLOEXEC) != 0) {
+    return FTP_ERR_NOT_SUPPORTED;
+  }
+  /* Best effort: unprivileged callers are capped by fs.pipe-max-size */
+  int pipe_sz = fcntl(pfd[1], F_SETPIPE_SZ, (int)FTP_SPLICE_PIPE_SIZE);
+  size_t chunk = (pipe_sz > 0) ? (size_t)pipe_sz : (size_t)65536U;
+
+  loff_t off = (loff_t)*offset;
+  uint64_t written = 0U;
+  ftp_error_t result = FTP_OK;
+
+  for (;;) {
+    ssize_t in = splice(sock_fd, NULL, pfd[1], NULL, chunk,
+                        SPLICE_F_MOVE | SPLICE_F_MORE);
+    if (in < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      /* Socket side refused before anything moved: plain fallback */
+      result = ((written == 0U) && ((errno == EINVAL) || (errno == ENOSYS)))
+                   ? FTP_ERR_NOT_SUPPORTED
+                   : FTP_ERR_SOCKET_RECV;
+      break;
+    }
+    if (in == 0) {
+      break; /* EOF */
+    }
+
+    size_t pending = (size_t)in;
+    while (pending > 0U) {
+      ssize_t out = splice(pfd[0], NULL, file_fd, &off, pending,
+                           SPLICE_F_MOVE | SPLICE_F_MORE);
+      if (out > 0) {
+        pending -= (size_t)out;
+        written += (uint64_t)out;
+        continue;
+      }
+      if ((out < 0) && (errno == EINTR)) {
+        continue;
+      }
+      if (out == 0) {
+        errno = ENOSPC;
+      }
+      if ((errno != EINVAL) && (errno != ENOSYS) && (errno != EOPNOTSUPP)) {
+        result = FTP_ERR_FILE_WRITE;
+        break;
+      }
+
+      /*
+       * Filesystem has no splice_write (or rejects this fd).  Drain what
+       * the pipe already holds through the bounce buffer, then report
+       * NOT_SUPPORTED so the caller resumes its buffered loop at *offset.
+       */
+      result = FTP_ERR_NOT_SUPPORTED;
+      while (pending > 0U) {
+        size_t want = (pending < bounce_sz) ? pending : bounce_sz;
+        ssize_t r = read(pfd[0], bounce, want);
+        if ((r < 0) && (errno == EINTR)) {
+          continue;
+        }
+        if (r <= 0) {
+          result = FTP_ERR_FILE_WRITE;
+          break;
+        }
+        size_t done = 0U;
+        while (done < (size_t)r) {
+          ssize_t w = pwrite(file_fd, (const uint8_t *)bounce + done,
+                             (size_t)r - done, (off_t)off);
+          if ((w < 0) && (errno == EINTR)) {
+            continue;
+          }
+          if (w <= 0) {
+            if (w == 0) {
+              errno = ENOSPC;
+            }
+            result = FTP_ERR_FILE_WRITE;
+            break;
+          }
+          done += (size_t)w;
+          off += (loff_t)w;
+          written += (uint64_t)w;
+        }
+        if (result == FTP_ERR_FILE_WRITE) {
+          break;
+        }
+        pending -= (size_t)r;
+      }
+      break;
+    }
+    if (result != FTP_OK) {
+      break;
+    }
+
+    if ((cb != NULL) && (cb(written, user_data) < 0)) {
+      result = FTP_ERR_SOCKET_RECV;
+      break;
+    }
+  }
+
+  int saved_errno = errno;
+  (void)close(pfd[0]);
+  (void)close(pfd[1]);
+  errno = saved_errno;
+
+  *offset = (off_t)off;
+  *out_bytes = written;
+  return result;
+#else
+  (void)cb;
+  (void)user_data;
+  return FTP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/*---------------------------------------------------------------------------*
+ * KERNEL COPY TIERS
+ *
+ * Before any byte goes through the ring pipeline the kernel gets a chance
+ * to copy the file itself, best first:
+ *
+ *   FICLONE           reflink: the copy shares the source extents
+ *                     (Btrfs, XFS, bcachefs) — instant, no data moved
+ *   copy_file_range   in-kernel copy; server-side on NFS/SMB, and since
+ *                     Linux 5.3 across filesystems too (FreeBSD 13+)
+ *   splice            file → pipe → file, still no userspace buffer
+ *
+ * Tiers copy from *off with positional I/O and report every
+ * PAL_FILE_COPY_BUFFER_SIZE to the progress callback, so pause and cancel
+ * behave as in the pipeline.  A tier the kernel or filesystem refuses
+ * hands over to the next one at the same offset; the userspace pipeline
+ * copies whatever is left.  PS4/PS5 kernels have none of the three.
+ *---------------------------------------------------------------------------*/
+#ifndef PAL_FILE_COPY_KERNEL
+#define PAL_FILE_COPY_KERNEL 1
+#endif
+
+#if PAL_FILE_COPY_KERNEL && defined(__linux__)
+#include <sys/ioctl.h>
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int) /* <linux/fs.h> clashes with libc headers */
+#endif
+#define COPY_HAVE_FICLONE 1
+#define COPY_HAVE_CFR 1
+#elif PAL_FILE_COPY_KERNEL && defined(__FreeBSD__) &&                          \
+    !defined(PLATFORM_PS4) && !defined(PLATFORM_PS5)
+#include <sys/param.h>
+#if __FreeBSD_version >= 1300037
+#define COPY_HAVE_CFR 1
+#endif
+#endif
+
+#if PAL_FILE_COPY_KERNEL && HAS_SPLICE
+#define COPY_HAVE_SPLICE 1
+#endif
+
+#if defined(COPY_HAVE_FICLONE) || defined(COPY_HAVE_CFR) ||                   \
+    defined(COPY_HAVE_SPLICE)
+#define COPY_HAVE_TIERS 1
+
+#define COPY_TIER_NEXT 0 /* refused: continue with the next tier at *off */
+#define COPY_TIER_DONE 1 /* copied up to EOF                            */
+#define COPY_TIER_FAIL 2 /* I/O error (*out_errno) or cancel (errno 0)  */
+
+/* Errors meaning "not here", as opposed to a failing disk */
+static int copy_tier_refused(int e) {
+  switch (e) {
+  case ENOSYS:
+  case EXDEV:
+  case EINVAL:
+  case EBADF:
+  case EOPNOTSUPP:
+#if defined(ENOTSUP) && (ENOTSUP != EOPNOTSUPP)
+  case ENOTSUP:
+#endif
+    return 1;
+  default:
+    return 0;
+  }
+}
+
+static int copy_tier_progress(uint64_t n, pal_copy_progress_cb_t cb,
+                              void *user_data, uint64_t *cumulative) {
+  if ((cb == NULL) || (cumulative == NULL)) {
+    return 0;
+  }
+  *cumulative += n;
+  return cb(*cumulative, user_data);
+}
+
+/**
+ * @return COPY_TIER_*; *off is the number of bytes in place either way,
+ *         *tier the name of the tier that finished the copy
+ */
+static int copy_kernel_tiers(int src_fd, int dst_fd, uint64_t size,
+                             uint64_t *off, pal_copy_progress_cb_t cb,
+                             void *user_data, uint64_t *cumulative,
+                             int *out_errno, const char **tier) {
+#if defined(COPY_HAVE_FICLONE)
+  if ((*off == 0U) && (ioctl(dst_fd, FICLONE, src_fd) == 0)) {
+    *off = size;
+    *tier = "reflink";
+    if (copy_tier_progress(size, cb, user_data, cumulative) < 0) {
+      *out_errno = 0;
+      return COPY_TIER_FAIL;
+    }
+    return COPY_TIER_DONE;
+  }
+#endif
+
+#if defined(COPY_HAVE_CFR)
+  for (;;) {
+#if defined(__linux__)
+    loff_t in = (loff_t)*off;
+    loff_t out = (loff_t)*off;
+#else
+    off_t in = (off_t)*off;
+    off_t out = (off_t)*off;
+#endif
+    ssize_t n = copy_file_range(src_fd, &in, dst_fd, &out,
+                                (size_t)PAL_FILE_COPY_BUFFER_SIZE, 0U);
+    if (n > 0) {
+      *off += (uint64_t)n;
+      if (copy_tier_progress((uint64_t)n, cb, user_data, cumulative) < 0) {
+        *out_errno = 0;
+        return COPY_TIER_FAIL;
+      }
+      continue;
+    }
+    if (n == 0) {
+      if (*off >= size) {
+        *tier = "copy_file_range";
+        return COPY_TIER_DONE;
+      }
+      break; /* short of st_size: let read() find the real EOF */
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if (copy_tier_refused(errno) != 0) {
+      break;
+    }
+    *out_errno = errno;
+    return COPY_TIER_FAIL;
+  }
+#endif
+
+#if defined(COPY_HAVE_SPLICE)
+  int pfd[2];
+  if (pipe2(pfd, O_CLOEXEC) != 0) {
+    return COPY_TIER_NEXT;
+  }
+  int pipe_sz = fcntl(pfd[1], F_SETPIPE_SZ, (int)FTP_SPLICE_PIPE_SIZE);
+  size_t chunk = (pipe_sz > 0) ? (size_t)pipe_sz : (size_t)65536U;
+  int rc = COPY_TIER_NEXT;
+  uint64_t reported = 0U;
+
+  for (;;) {
+    loff_t in = (loff_t)*off;
+    ssize_t got = splice(src_fd, &in, pfd[1], NULL, chunk, SPLICE_F_MOVE);
+    if (got < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (copy_tier_refused(errno) == 0) {
+        *out_errno = errno;
+        rc = COPY_TIER_FAIL;
+      }
+      break;
+    }
+    if (got == 0) {
+      if (*off >= size) {
+        *tier = "splice";
+        rc = COPY_TIER_DONE;
+      }
+      break;
+    }
+
+    /* Only what reached the file counts: a refused drain leaves the
+     * rest in the pipe, and the next tier re-reads it from *off */
+    size_t pending = (size_t)got;
+    while (pending > 0U) {
+      loff_t out = (loff_t)*off;
+      ssize_t put = splice(pfd[0], NULL, dst_fd, &out, pending, SPLICE_F_MOVE);
+      if (put > 0) {
+        pending -= (size_t)put;
+        *off += (uint64_t)put;
+        continue;
+      }
+      if ((put < 0) && (errno == EINTR)) {
+        continue;
+      }
+      if ((put == 0) || (copy_tier_refused(errno) == 0)) {
+        *out_errno = (put == 0) ? ENOSPC : errno;
+        rc = COPY_TIER_FAIL;
+      }
+      break;
+    }
+    if (pending > 0U) {
+      break;
+    }
+    if (*off - reported >= (uint64_t)PAL_FILE_COPY_BUFFER_SIZE) {
+      if (copy_tier_progress(*off - reported, cb, user_data, cumulative) < 0) {
+        *out_errno = 0;
+        rc = COPY_TIER_FAIL;
+        break;
+      }
+      reported = *off;
+    }
+  }
+  if ((rc != COPY_TIER_FAIL) && (*off > reported) &&
+      (copy_tier_progress(*off - reported, cb, user_data, cumulative) < 0)) {
+    *out_errno = 0;
+    rc = COPY_TIER_FAIL;
+  }
+  (void)close(pfd[0]);
+  (void)close(pfd[1]);
+  return rc;
+#else
+  return COPY_TIER_NEXT;
+#endif
+}
+#endif /* COPY_HAVE_TIERS */
+
 /*===========================================================================*
  * FILE OPERATIONS
  *===========================================================================*/
@@ -656,6 +1001,48 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
     goto cleanup;
   }
 
+  /* Bytes the pipeline below still has to move */
+  uint64_t left_to_copy = (uint64_t)st.st_size;
+
+#if defined(COPY_HAVE_TIERS)
+  {
+    uint64_t done = 0U;
+    int tier_errno = 0;
+    const char *tier = NULL;
+    int rc = copy_kernel_tiers(src_fd, dst_fd, (uint64_t)st.st_size, &done,
+                               cb, user_data, cumulative, &tier_errno, &tier);
+    if (rc == COPY_TIER_DONE) {
+      char msg[256];
+      snprintf(msg, sizeof(msg), "[XDEV] %s copy: %llu bytes dst=%s", tier,
+               (unsigned long long)done, dst_path);
+      ftp_log_line(FTP_LOG_INFO, msg);
+      goto copy_done;
+    }
+    if (rc == COPY_TIER_FAIL) {
+      if (tier_errno == 0) {
+        out_err = FTP_ERR_UNKNOWN; /* cancelled by progress callback */
+      } else {
+        char msg[256];
+        snprintf(msg, sizeof(msg),
+                 "[XDEV] kernel copy failed: errno=%d at=%llu dst=%s",
+                 tier_errno, (unsigned long long)done, dst_path);
+        ftp_log_line(FTP_LOG_WARN, msg);
+        if (out_errno != NULL) {
+          *out_errno = tier_errno;
+        }
+        out_err = FTP_ERR_FILE_WRITE;
+      }
+      goto cleanup;
+    }
+    if (done > 0U) {
+      /* Partly copied before a refusal: the pipeline resumes there */
+      (void)lseek(src_fd, (off_t)done, SEEK_SET);
+      (void)lseek(dst_fd, (off_t)done, SEEK_SET);
+      left_to_copy = (left_to_copy > done) ? (left_to_copy - done) : 0U;
+    }
+  }
+#endif
+
   /*
    * DESIGN RATIONALE — heap vs. static _Thread_local:
    *
@@ -677,51 +1064,48 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
    *=========================================================================*/
 
   /*-----------------------------------------------------------------------*
-   * Double-buffer copy pipeline
+   * Ring copy pipeline
    *
-   * Allocate both buffers up-front.  If either malloc fails, fall through
-   * to the serial path (pal_malloc returns NULL gracefully).
+   * pal_ring_init() allocates the first two buffers up-front.  If that
+   * fails, fall through to the serial path (pal_malloc returns NULL
+   * gracefully).  A remainder that fits in one buffer has nothing to overlap:
+   * it takes the serial path directly, without a reader thread.
    *-----------------------------------------------------------------------*/
-  {
-    uint8_t *dbuf0 = (uint8_t *)pal_malloc(PAL_FILE_COPY_BUFFER_SIZE);
-    uint8_t *dbuf1 = (uint8_t *)pal_malloc(PAL_FILE_COPY_BUFFER_SIZE);
-
-    /* Log arena state immediately after the two allocs so we can correlate
+  if (left_to_copy > (uint64_t)PAL_FILE_COPY_BUFFER_SIZE) {
+    copy_reader_t rd;
+    pal_ring_config_t rcfg;
+    rcfg.initial_depth = 2U;
+    rcfg.max_depth = PAL_FILE_COPY_RING_MAX_DEPTH;
+    rcfg.grow_after = PAL_FILE_COPY_RING_GROW_AFTER;
+    rcfg.slot_size = (size_t)PAL_FILE_COPY_BUFFER_SIZE;
+    rcfg.alloc = copy_ring_alloc;
+    rcfg.release = copy_ring_release;
+    rcfg.ctx = NULL;
+    rd.src_fd = src_fd;
+    rd.reader_err = 0;
+    int ring_ok = (pal_ring_init(&rd.ring, &rcfg) == 0) ? 1 : 0;
+
+    /* Log arena state immediately after the allocs so we can correlate
      * with SceShellCore heap pressure messages in the system log. */
     {
       pal_alloc_stats_t ast;
       pal_alloc_get_stats(&ast);
       char msg[256];
       snprintf(msg, sizeof(msg),
-               "[XDEV] pipeline alloc: buf0=%s buf1=%s "
+               "[XDEV] pipeline alloc: ring=%s "
                "arena_inuse=%llu peak=%llu failures=%llu file=%s",
-               (dbuf0 != NULL) ? "ok" : "NULL",
-               (dbuf1 != NULL) ? "ok" : "NULL",
+               (ring_ok != 0) ? "ok" : "NULL",
                (unsigned long long)ast.bytes_in_use,
                (unsigned long long)ast.bytes_peak,
                (unsigned long long)ast.failures,
                src_path);
-      ftp_log_line((dbuf0 && dbuf1) ? FTP_LOG_INFO : FTP_LOG_WARN, msg);
-    }
-
-    if ((dbuf0 != NULL) && (dbuf1 != NULL)) {
-      /* Initialise pipeline state */
-      copy_pipe_t pipe;
-      pipe.buf[0] = dbuf0;
-      pipe.buf[1] = dbuf1;
-      pipe.len[0] = 0U;
-      pipe.len[1] = 0U;
-      pipe.fill_idx = 0;
-      pipe.src_fd = src_fd;
-      pipe.buf_sz = (size_t)PAL_FILE_COPY_BUFFER_SIZE;
-      pipe.done = 0;
-      pipe.reader_err = 0;
-      pthread_mutex_init(&pipe.mtx, NULL);
-      pthread_cond_init(&pipe.cv_ready, NULL);
-      pthread_cond_init(&pipe.cv_free, NULL);
+      ftp_log_line((ring_ok != 0) ? FTP_LOG_INFO : FTP_LOG_WARN, msg);
+    }
 
+    if (ring_ok != 0) {
       pthread_t reader_tid;
-      int pt_ret = pthread_create(&reader_tid, NULL, copy_reader_thread, &pipe);
+      int pt_ret = pal_thread_create(&reader_tid, NULL, PAL_THREAD_DATA,
+                                     copy_reader_thread, &rd);
       int thread_ok = (pt_ret == 0) ? 1 : 0;
 
       /* Log pthread_create result — on PS4 this can fail with EAGAIN (thread
@@ -736,27 +1120,19 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
       }
 
       if (thread_ok != 0) {
-        /* Writer loop: drain the buffer that the reader just filled */
+        /* Writer loop: drain buffers in the order the reader filled them */
         ssize_t written = 0; /* last write result — checked after join */
         int write_errno = 0; /* saved errno from the last failed write();
                               * hoisted outside the for loop so it remains
                               * accessible after break for the post-join log */
-        pthread_mutex_lock(&pipe.mtx);
+        int cancelled = 0;
         for (;;) {
-          /* Wait for a filled buffer or EOF/error */
-          while ((pipe.len[1 - pipe.fill_idx] == 0U) && (pipe.done == 0)) {
-            pthread_cond_wait(&pipe.cv_ready, &pipe.mtx);
-          }
-
-          int drain_idx = 1 - pipe.fill_idx;
-          size_t nbytes = pipe.len[drain_idx];
-
-          if ((nbytes == 0U) && (pipe.done != 0)) {
-            break; /* EOF — pipeline drained */
+          size_t nbytes = 0U;
+          uint8_t *drain = (uint8_t *)pal_ring_peek(&rd.ring, &nbytes);
+          if (drain == NULL) {
+            break; /* EOF or read error — pipeline drained */
           }
 
-          pthread_mutex_unlock(&pipe.mtx);
-
           /*
            * Write the full buffer in a single write() call.
            *
@@ -768,9 +1144,9 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
            * extent, avoiding per-chunk AES-XTS context setup overhead.
            */
           written = 0;
-          write_errno = 0; /* reset each iteration; saved before mutex lock */
+          write_errno = 0;
           {
-            const uint8_t *p_out = pipe.buf[drain_idx];
+            const uint8_t *p_out = drain;
             size_t remaining = nbytes;
             while (remaining > 0U) {
               ssize_t w = write(dst_fd, p_out, remaining);
@@ -784,10 +1160,6 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
                 continue;
               }
               /*
-               * Save errno NOW — pthread_mutex_lock() below can
-               * overwrite it on success (POSIX does not guarantee
-               * errno is untouched on a successful call).
-               *
                * IMPORTANT — w == 0 case (PS4/PS5 PFS quirk):
                * POSIX does not define write() returning 0 for a
                * positive count on a regular file.  On Orbis/Prospero
@@ -801,18 +1173,15 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
             }
           }
 
-          pthread_mutex_lock(&pipe.mtx);
-
           if (written < 0) {
             /*
-             * Write error — signal reader to stop, then break.
+             * Write error — stop the reader, then break.
              * We log below after joining the reader thread.
              */
             if (out_errno != NULL) {
               *out_errno = write_errno;
             }
-            pipe.done = 1;
-            pthread_cond_signal(&pipe.cv_free);
+            pal_ring_abort(&rd.ring, write_errno);
             out_err = FTP_ERR_FILE_WRITE;
             break;
           }
@@ -821,18 +1190,15 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
           if ((cb != NULL) && (cumulative != NULL)) {
             *cumulative += (uint64_t)written;
             if (cb(*cumulative, user_data) < 0) {
-              pipe.done = 1;
-              pthread_cond_signal(&pipe.cv_free);
-              out_err = FTP_ERR_UNKNOWN; /* cancelled */
+              pal_ring_abort(&rd.ring, 0);
+              cancelled = 1;
               break;
             }
           }
 
-          /* Mark buffer as free and wake reader */
-          pipe.len[drain_idx] = 0U;
-          pthread_cond_signal(&pipe.cv_free);
+          /* Hand the buffer back to the reader */
+          pal_ring_consume(&rd.ring, drain);
         }
-        pthread_mutex_unlock(&pipe.mtx);
 
         /* Join reader; collect any read-side error */
         (void)pthread_join(reader_tid, NULL);
@@ -841,18 +1207,10 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
          * Post-join result resolution.
          *
          * Priority: write error > read error > cancellation > success.
-         *
-         * IMPORTANT: do NOT use `out_err` to detect write failures here.
-         * `out_err` is initialised to FTP_ERR_FILE_WRITE (line ~376) and
-         * is only changed during the loop for cancellation (FTP_ERR_UNKNOWN)
-         * or left at its initial value on both success AND write failure.
-         * Using it as a success/failure discriminator therefore confuses the
-         * two cases and causes a successful pipeline copy to return
-         * FTP_ERR_FILE_WRITE.  Use `written < 0` instead — it is set to -1
-         * exclusively by the write-error break path.
+         * `written < 0` is set exclusively by the write-error break path.
          */
         if (written < 0) {
-          /* write() failed — write_errno was captured before mutex lock */
+          /* write() failed — write_errno was captured right after write() */
           char msg[256];
           snprintf(msg, sizeof(msg), "[COPY] write failed: errno=%d dst=%s",
                    write_errno, dst_path);
@@ -861,32 +1219,35 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
             *out_errno = write_errno;
           }
           out_err = FTP_ERR_FILE_WRITE;
-        } else if (pipe.reader_err != 0) {
+        } else if (rd.reader_err != 0) {
           char msg[256];
           snprintf(msg, sizeof(msg), "[COPY] read failed: errno=%d src=%s",
-                   pipe.reader_err, src_path);
+                   rd.reader_err, src_path);
           ftp_log_line(FTP_LOG_WARN, msg);
           if (out_errno != NULL) {
-            *out_errno = pipe.reader_err;
+            *out_errno = rd.reader_err;
           }
           out_err = FTP_ERR_FILE_READ;
-        } else if (out_err == FTP_ERR_UNKNOWN) {
-          /* cancelled by progress callback — out_err already set */
+        } else if (cancelled != 0) {
+          out_err = FTP_ERR_UNKNOWN; /* cancelled by progress callback */
         } else {
           /* Pipeline completed successfully */
           out_err = FTP_OK;
         }
+
+        if (pal_ring_peak_depth(&rd.ring) > 2U) {
+          char msg[128];
+          snprintf(msg, sizeof(msg),
+                   "[COPY] writer lagged: ring grew to %u buffers",
+                   pal_ring_peak_depth(&rd.ring));
+          ftp_log_line(FTP_LOG_INFO, msg);
+        }
       } else {
         /* pthread_create failed — fall through to serial path below */
         out_err = FTP_ERR_FILE_WRITE; /* will be overwritten by serial path */
       }
 
-      pthread_mutex_destroy(&pipe.mtx);
-      pthread_cond_destroy(&pipe.cv_ready);
-      pthread_cond_destroy(&pipe.cv_free);
-
-      pal_free(dbuf0);
-      pal_free(dbuf1);
+      pal_ring_destroy(&rd.ring);
 
       if (thread_ok != 0) {
         /* Pipeline ran (success or failure) — skip serial fallback */
@@ -897,24 +1258,13 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
       }
       /* thread_ok == 0: fall through to serial path (already logged above) */
     } else {
-      /* One or both malloc failed — free whichever succeeded and fall through */
-      {
-        char msg[256];
-        snprintf(msg, sizeof(msg),
-                 "[XDEV] pipeline malloc failed (buf0=%s buf1=%s) — "
-                 "falling back to serial copy for %s",
-                 (dbuf0 != NULL) ? "ok" : "NULL",
-                 (dbuf1 != NULL) ? "ok" : "NULL",
-                 src_path);
-        ftp_log_line(FTP_LOG_WARN, msg);
-      }
-      pal_free(dbuf0);
-      pal_free(dbuf1);
+      ftp_log_line(FTP_LOG_WARN, "[XDEV] pipeline malloc failed — "
+                                 "falling back to serial copy");
     }
   }
-  /* --- Serial fallback (malloc failure or pthread_create failure) --- */
+  /* --- Serial path (small file, malloc or pthread_create failure) --- */
 
-  {
+  if (left_to_copy > (uint64_t)PAL_FILE_COPY_BUFFER_SIZE) {
     char msg[256];
     snprintf(msg, sizeof(msg),
              "[XDEV] serial copy starting: file_size=%llu buf=%u src=%s",
@@ -924,7 +1274,16 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
     ftp_log_line(FTP_LOG_INFO, msg);
   }
 
-  copy_buf = (uint8_t *)pal_malloc(PAL_FILE_COPY_BUFFER_SIZE);
+  /* A small file gets a buffer its own size (one spare byte to see EOF
+   * in the first read); copy jobs run many of them side by side */
+  size_t copy_len = (size_t)PAL_FILE_COPY_BUFFER_SIZE;
+  if (left_to_copy < (uint64_t)copy_len) {
+    copy_len = (size_t)left_to_copy + 1U;
+    if (copy_len < 4096U) {
+      copy_len = 4096U;
+    }
+  }
+  copy_buf = (uint8_t *)pal_malloc(copy_len);
   if (copy_buf == NULL) {
     {
       pal_alloc_stats_t ast;
@@ -936,7 +1295,7 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
                (unsigned long long)ast.bytes_in_use,
                (unsigned long long)ast.bytes_peak,
                (unsigned long long)ast.failures,
-               (unsigned)PAL_FILE_COPY_BUFFER_SIZE,
+               (unsigned)copy_len,
                src_path);
       ftp_log_line(FTP_LOG_WARN, msg);
     }
@@ -951,7 +1310,7 @@ pal_file_copy_atomic_ex(const char *src_path, const char *dst_path,
     const uint64_t LOG_INTERVAL = 64U * 1024U * 1024U;
 
     for (;;) {
-      ssize_t r = read(src_fd, copy_buf, (size_t)PAL_FILE_COPY_BUFFER_SIZE);
+      ssize_t r = read(src_fd, copy_buf, copy_len);
       if (r > 0) {
         /*
          * Write the full buffer in a single write() loop — do NOT call
@@ -1405,6 +1764,408 @@ ftp_error_t pal_file_truncate(int fd, off_t len) {
   return FTP_OK;
 }
 
+/**
+ * @brief Reserve disk blocks
+ */
+ftp_error_t pal_file_preallocate(int fd, off_t len) {
+  if ((fd < 0) || (len < 0)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+  if (len == 0) {
+    return FTP_OK;
+  }
+
+#if defined(__linux__)
+  /*
+   * fallocate(2), not posix_fallocate(3): glibc emulates the latter.
+   * KEEP_SIZE: blocks are reserved past EOF, a short upload never shows
+   * a zero tail.
+   */
+  if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, len) == 0) {
+    return FTP_OK;
+  }
+  return ((errno == EOPNOTSUPP) || (errno == ENOSYS)) ? FTP_ERR_NOT_SUPPORTED
+                                                      : FTP_ERR_FILE_WRITE;
+#elif defined(__FreeBSD__) && !defined(PLATFORM_PS4) && !defined(PLATFORM_PS5)
+  int rc = posix_fallocate(fd, 0, len);
+  if (rc == 0) {
+    return FTP_OK;
+  }
+  return ((rc == EOPNOTSUPP) || (rc == EINVAL) || (rc == ENODEV))
+             ? FTP_ERR_NOT_SUPPORTED
+             : FTP_ERR_FILE_WRITE;
+#elif defined(__APPLE__)
+  /* Contiguous first, any extents second; the file size is unchanged */
+  fstore_t fst;
+  memset(&fst, 0, sizeof(fst));
+  fst.fst_flags = F_ALLOCATECONTIG;
+  fst.fst_posmode = F_PEOFPOSMODE;
+  fst.fst_offset = 0;
+  fst.fst_length = len;
+  if (fcntl(fd, F_PREALLOCATE, &fst) == 0) {
+    return FTP_OK;
+  }
+  fst.fst_flags = F_ALLOCATEALL;
+  if (fcntl(fd, F_PREALLOCATE, &fst) == 0) {
+    return FTP_OK;
+  }
+  return (errno == ENOSPC) ? FTP_ERR_FILE_WRITE : FTP_ERR_NOT_SUPPORTED;
+#else
+  return FTP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * @brief Range writeback
+ */
+ftp_error_t pal_file_writeback(int fd, off_t offset, off_t len, int wait) {
+  if ((fd < 0) || (offset < 0) || (len < 0)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+#if defined(__linux__)
+  unsigned int flags = SYNC_FILE_RANGE_WRITE;
+  if (wait != 0) {
+    flags |= SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WAIT_AFTER;
+  }
+  return (sync_file_range(fd, offset, len, flags) == 0) ? FTP_OK
+                                                        : FTP_ERR_FILE_WRITE;
+#else
+  if (wait == 0) {
+    return FTP_ERR_NOT_SUPPORTED;
+  }
+  return (fsync(fd) == 0) ? FTP_OK : FTP_ERR_FILE_WRITE;
+#endif
+}
+
+/*===========================================================================*
+ * PER-TRANSFER CACHE POLICY
+ *===========================================================================*/
+
+#if !defined(PLATFORM_PS4) && !defined(PS4)
+#define PAL_IO_FADVISE 1 /* PS4: fadvise hints stay off, as everywhere else */
+#else
+#define PAL_IO_FADVISE 0
+#endif
+
+#if defined(O_DIRECT) && !defined(PLATFORM_PS4) && !defined(PLATFORM_PS5)
+#define PAL_IO_HAS_DIRECT 1 /* PFS rejects unaligned uncached writes */
+#else
+#define PAL_IO_HAS_DIRECT 0
+#endif
+
+/* Pages sampled per residency probe */
+#define PAL_IO_PROBE_PAGES 64U
+
+static struct {
+  atomic_uint_fast64_t cached;
+  atomic_uint_fast64_t streamed;
+  atomic_uint_fast64_t direct;
+  atomic_uint_fast64_t readahead_bytes;
+  atomic_uint_fast64_t dropped_bytes;
+  atomic_uint_fast64_t direct_bytes;
+  atomic_uint_fast64_t probed_bytes;
+  atomic_uint_fast64_t resident_bytes;
+} g_io_stats;
+
+/*
+ * Estimate how much of [start, start + len) is in the page cache by
+ * testing PAL_IO_PROBE_PAGES evenly spaced pages.
+ *
+ * @return Estimated resident bytes, or UINT64_MAX when unknown
+ */
+static uint64_t io_resident_estimate(int fd, off_t start, uint64_t len) {
+#if defined(__linux__)
+  long pg = sysconf(_SC_PAGESIZE);
+  if ((pg <= 0) || (len == 0U)) {
+    return UINT64_MAX;
+  }
+  off_t first = start - (start % (off_t)pg);
+  uint64_t span = len + (uint64_t)(start - first);
+  if (span > (uint64_t)SIZE_MAX) {
+    return UINT64_MAX;
+  }
+  void *map = mmap(NULL, (size_t)span, PROT_READ, MAP_SHARED, fd, first);
+  if (map == MAP_FAILED) {
+    return UINT64_MAX;
+  }
+
+  uint64_t pages = (span + (uint64_t)pg - 1U) / (uint64_t)pg;
+  uint64_t step = (pages > PAL_IO_PROBE_PAGES) ? (pages / PAL_IO_PROBE_PAGES)
+                                               : 1U;
+  uint64_t hit = 0U;
+  uint64_t tested = 0U;
+  for (uint64_t i = 0U; (i < pages) && (tested < PAL_IO_PROBE_PAGES);
+       i += step) {
+    unsigned char vec = 0U;
+    if (mincore((uint8_t *)map + (i * (uint64_t)pg), (size_t)pg, &vec) == 0) {
+      tested++;
+      if ((vec & 1U) != 0U) {
+        hit++;
+      }
+    }
+  }
+  (void)munmap(map, (size_t)span);
+  if (tested == 0U) {
+    return UINT64_MAX;
+  }
+  return (len / tested) * hit;
+#else
+  (void)fd;
+  (void)start;
+  (void)len;
+  return UINT64_MAX;
+#endif
+}
+
+pal_io_policy_t pal_io_read_begin(pal_io_reader_t *r, int fd, off_t start,
+                                  uint64_t len, uint64_t stream_min,
+                                  off_t window) {
+  if (r == NULL) {
+    return PAL_IO_CACHED;
+  }
+  r->fd = fd;
+  r->policy = PAL_IO_CACHED;
+  r->end = start + (off_t)len;
+  r->window = (window > 0) ? window : 0;
+  r->ahead = start;
+  r->dropped = start;
+
+  if ((PAL_IO_FADVISE == 0) || (fd < 0) || (stream_min == 0U) ||
+      (len < stream_min)) {
+    atomic_fetch_add(&g_io_stats.cached, 1U);
+    return PAL_IO_CACHED;
+  }
+
+  /* Mostly cached already: serving it from memory beats dropping it */
+  uint64_t resident = io_resident_estimate(fd, start, len);
+  if (resident != UINT64_MAX) {
+    atomic_fetch_add(&g_io_stats.probed_bytes, len);
+    atomic_fetch_add(&g_io_stats.resident_bytes, resident);
+    if (resident >= (len / 2U)) {
+      atomic_fetch_add(&g_io_stats.cached, 1U);
+      return PAL_IO_CACHED;
+    }
+  }
+
+  r->policy = PAL_IO_STREAM;
+  atomic_fetch_add(&g_io_stats.streamed, 1U);
+#if PAL_IO_FADVISE && defined(POSIX_FADV_SEQUENTIAL)
+  (void)posix_fadvise(fd, start, (off_t)len, POSIX_FADV_SEQUENTIAL);
+#endif
+  pal_io_read_advance(r, start);
+  return PAL_IO_STREAM;
+}
+
+void pal_io_read_advance(pal_io_reader_t *r, off_t pos) {
+  if ((r == NULL) || (r->policy != PAL_IO_STREAM)) {
+    return;
+  }
+  if (pos > r->end) {
+    pos = r->end;
+  }
+
+#if PAL_IO_FADVISE && defined(POSIX_FADV_DONTNEED)
+  if (pos > r->dropped) {
+    (void)posix_fadvise(r->fd, r->dropped, pos - r->dropped,
+                        POSIX_FADV_DONTNEED);
+    atomic_fetch_add(&g_io_stats.dropped_bytes, (uint64_t)(pos - r->dropped));
+    r->dropped = pos;
+  }
+#endif
+
+  /* Top the window up once half of it has been consumed */
+#if PAL_IO_FADVISE && defined(POSIX_FADV_WILLNEED)
+  if ((r->window > 0) && ((r->ahead - pos) < (r->window / 2)) &&
+      (r->ahead < r->end)) {
+    off_t from = (r->ahead > pos) ? r->ahead : pos;
+    off_t to = pos + r->window;
+    if (to > r->end) {
+      to = r->end;
+    }
+    if (to > from) {
+      (void)posix_fadvise(r->fd, from, to - from, POSIX_FADV_WILLNEED);
+      atomic_fetch_add(&g_io_stats.readahead_bytes, (uint64_t)(to - from));
+      r->ahead = to;
+    }
+  }
+#endif
+}
+
+ftp_error_t pal_io_prefetch(int fd, off_t offset, off_t len) {
+#if PAL_IO_FADVISE && defined(POSIX_FADV_WILLNEED)
+  if ((fd >= 0) && (len > 0) &&
+      (posix_fadvise(fd, offset, len, POSIX_FADV_WILLNEED) == 0)) {
+    return FTP_OK;
+  }
+#else
+  (void)fd;
+  (void)offset;
+  (void)len;
+#endif
+  return FTP_ERR_NOT_SUPPORTED;
+}
+
+#if PAL_IO_HAS_DIRECT
+static int io_set_direct(int fd, int on) {
+  int fl = fcntl(fd, F_GETFL);
+  if (fl < 0) {
+    return -1;
+  }
+  fl = (on != 0) ? (fl | O_DIRECT) : (fl & ~O_DIRECT);
+  return fcntl(fd, F_SETFL, fl);
+}
+
+/* Write the full stage; a refusal of O_DIRECT finishes it buffered */
+static int io_flush_stage(pal_io_writer_t *w) {
+  size_t done = 0U;
+  while ((w->direct != 0) && (done < w->staged)) {
+    ssize_t n = write(w->fd, w->stage + done, w->staged - done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno != EINVAL) {
+        return -1;
+      }
+      n = 0; /* filesystem refuses O_DIRECT: fall through to the cache */
+    }
+    done += (size_t)n;
+    atomic_fetch_add(&g_io_stats.direct_bytes, (uint64_t)n);
+    if ((n == 0) || (((size_t)n % PAL_IO_ALIGN) != 0U)) {
+      /* Offset no longer aligned: the rest of the upload is buffered */
+      (void)io_set_direct(w->fd, 0);
+      w->direct = 0;
+    }
+  }
+  if (done < w->staged) {
+    size_t rest = w->staged - done;
+    if (pal_file_write_all(w->fd, w->stage + done, rest) != (ssize_t)rest) {
+      return -1;
+    }
+  }
+  w->staged = 0U;
+  return 0;
+}
+#endif
+
+ftp_error_t pal_io_write_begin(pal_io_writer_t *w, int fd, void *stage,
+                               size_t cap) {
+  if ((w == NULL) || (fd < 0) || (stage == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+#if PAL_IO_HAS_DIRECT
+  if ((((uintptr_t)stage % PAL_IO_ALIGN) != 0U) || (cap == 0U) ||
+      ((cap % PAL_IO_ALIGN) != 0U)) {
+    return FTP_ERR_NOT_SUPPORTED;
+  }
+  off_t pos = lseek(fd, 0, SEEK_CUR);
+  if (pos < 0) {
+    return FTP_ERR_NOT_SUPPORTED;
+  }
+  w->fd = fd;
+  w->direct = 0;
+  w->stage = (uint8_t *)stage;
+  w->cap = cap;
+  w->staged = 0U;
+  w->lead = (size_t)((PAL_IO_ALIGN - ((uint64_t)pos % PAL_IO_ALIGN)) %
+                     PAL_IO_ALIGN);
+  if (w->lead == 0U) {
+    if (io_set_direct(fd, 1) != 0) {
+      return FTP_ERR_NOT_SUPPORTED;
+    }
+    w->direct = 1;
+  }
+  atomic_fetch_add(&g_io_stats.direct, 1U);
+  return FTP_OK;
+#else
+  (void)cap;
+  return FTP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+ssize_t pal_io_write(pal_io_writer_t *w, const void *buf, size_t len) {
+  if ((w == NULL) || ((buf == NULL) && (len > 0U))) {
+    errno = EINVAL;
+    return -1;
+  }
+#if PAL_IO_HAS_DIRECT
+  const uint8_t *p = (const uint8_t *)buf;
+  size_t left = len;
+
+  if (w->lead > 0U) {
+    size_t n = (left < w->lead) ? left : w->lead;
+    if (pal_file_write_all(w->fd, p, n) != (ssize_t)n) {
+      return -1;
+    }
+    p += n;
+    left -= n;
+    w->lead -= n;
+    if (w->lead == 0U) {
+      w->direct = (io_set_direct(w->fd, 1) == 0) ? 1 : 0;
+    }
+  }
+  if ((w->direct == 0) && (w->staged == 0U)) {
+    if ((left > 0U) && (pal_file_write_all(w->fd, p, left) != (ssize_t)left)) {
+      return -1;
+    }
+    return (ssize_t)len;
+  }
+
+  while (left > 0U) {
+    size_t n = w->cap - w->staged;
+    if (n > left) {
+      n = left;
+    }
+    memcpy(w->stage + w->staged, p, n);
+    w->staged += n;
+    p += n;
+    left -= n;
+    if ((w->staged == w->cap) && (io_flush_stage(w) != 0)) {
+      return -1;
+    }
+  }
+  return (ssize_t)len;
+#else
+  return pal_file_write_all(w->fd, buf, len);
+#endif
+}
+
+ftp_error_t pal_io_write_end(pal_io_writer_t *w) {
+  if (w == NULL) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+#if PAL_IO_HAS_DIRECT
+  /* The tail is shorter than a block: clear O_DIRECT first */
+  if (w->direct != 0) {
+    (void)io_set_direct(w->fd, 0);
+    w->direct = 0;
+  }
+  if (w->staged > 0U) {
+    size_t rest = w->staged;
+    w->staged = 0U;
+    if (pal_file_write_all(w->fd, w->stage, rest) != (ssize_t)rest) {
+      return FTP_ERR_FILE_WRITE;
+    }
+  }
+#endif
+  return FTP_OK;
+}
+
+void pal_io_get_stats(pal_io_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  out->cached = atomic_load(&g_io_stats.cached);
+  out->streamed = atomic_load(&g_io_stats.streamed);
+  out->direct = atomic_load(&g_io_stats.direct);
+  out->readahead_bytes = atomic_load(&g_io_stats.readahead_bytes);
+  out->dropped_bytes = atomic_load(&g_io_stats.dropped_bytes);
+  out->direct_bytes = atomic_load(&g_io_stats.direct_bytes);
+  out->probed_bytes = atomic_load(&g_io_stats.probed_bytes);
+  out->resident_bytes = atomic_load(&g_io_stats.resident_bytes);
+}
+
 /**
  * @brief Delete file
  */
@@ -1455,37 +2216,29 @@ ftp_error_t pal_file_delete(const char *path) {
  *===========================================================================*/
 
 /**
- * @brief Remove a directory tree recursively (depth-first).
+ * @brief Remove the contents of the directory open as @p dfd.
  *
- * Used to clean up the source tree after a successful cross-device
- * copy, or to roll back a partial destination on failure.
+ * Entries are removed relative to the directory fd, so no path string is
+ * built per entry, and d_type separates directories from the rest without
+ * a stat (fstatat() only when the filesystem reports DT_UNKNOWN).
+ * Symlinks are unlinked, never followed.
  */
-static ftp_error_t pal_dir_remove_recursive(const char *path, unsigned depth) {
-  if (path == NULL) {
-    return FTP_ERR_INVALID_PARAM;
-  }
+static ftp_error_t pal_dir_remove_entries_at(int dfd, unsigned depth) {
   if (depth > PAL_MOVE_MAX_DEPTH) {
+    (void)close(dfd);
     return FTP_ERR_PATH_TOO_LONG;
   }
 
-  DIR *dir = opendir(path);
+  DIR *dir = fdopendir(dfd);
   if (dir == NULL) {
-    if (errno == ENOENT) {
-      return FTP_OK;
-    }
-    {
-      char msg[256];
-      snprintf(msg, sizeof(msg),
-               "[XDEV] opendir(cleanup) failed: errno=%d path=%s", errno, path);
-      ftp_log_line(FTP_LOG_WARN, msg);
-    }
+    (void)close(dfd);
     return FTP_ERR_DIR_OPEN;
   }
 
   struct dirent *ent;
   ftp_error_t err = FTP_OK;
 
-  while ((ent = readdir(dir)) != NULL) {
+  while ((err == FTP_OK) && ((ent = readdir(dir)) != NULL)) {
     /* Skip "." and ".." */
     if ((ent->d_name[0] == '.') &&
         ((ent->d_name[1] == '\0') ||
@@ -1493,40 +2246,73 @@ static ftp_error_t pal_dir_remove_recursive(const char *path, unsigned depth) {
       continue;
     }
 
-    char child[FTP_PATH_MAX];
-    int n = snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
-    if ((n < 0) || ((size_t)n >= sizeof(child))) {
-      err = FTP_ERR_PATH_TOO_LONG;
-      break;
+    int is_dir = 0;
+#ifdef DT_DIR
+    if (ent->d_type == DT_DIR) {
+      is_dir = 1;
+    } else if (ent->d_type == DT_UNKNOWN)
+#endif
+    {
+      struct stat st;
+      if (fstatat(dirfd(dir), ent->d_name, &st, AT_SYMLINK_NOFOLLOW) < 0) {
+        err = (errno == ENOENT) ? FTP_OK : FTP_ERR_FILE_STAT;
+        continue;
+      }
+      is_dir = S_ISDIR(st.st_mode) ? 1 : 0;
     }
 
-    struct stat st;
-    if (stat(child, &st) < 0) {
-      err = FTP_ERR_FILE_STAT;
-      break;
+    int flags = 0;
+    if (is_dir != 0) {
+      int child = openat(dirfd(dir), ent->d_name,
+                         O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      err = (child < 0) ? FTP_ERR_DIR_OPEN
+                        : pal_dir_remove_entries_at(child, depth + 1U);
+      flags = AT_REMOVEDIR;
     }
-
-    if (S_ISDIR(st.st_mode)) {
-      err = pal_dir_remove_recursive(child, depth + 1U);
-    } else {
-      if (unlink(child) != 0) {
-        {
-          char msg[256];
-          snprintf(msg, sizeof(msg),
-                   "[XDEV] unlink(cleanup) failed: errno=%d path=%s", errno,
-                   child);
-          ftp_log_line(FTP_LOG_WARN, msg);
-        }
-        err = FTP_ERR_FILE_WRITE;
+    if ((err == FTP_OK) && (unlinkat(dirfd(dir), ent->d_name, flags) != 0) &&
+        (errno != ENOENT)) {
+      {
+        char msg[64 + sizeof(ent->d_name)];
+        snprintf(msg, sizeof(msg),
+                 "[XDEV] unlink(cleanup) failed: errno=%d name=%s", errno,
+                 ent->d_name);
+        ftp_log_line(FTP_LOG_WARN, msg);
       }
+      err = FTP_ERR_FILE_WRITE;
     }
+  }
 
-    if (err != FTP_OK) {
-      break;
+  (void)closedir(dir); /* closes dfd */
+  return err;
+}
+
+/**
+ * @brief Remove a directory tree recursively (depth-first).
+ *
+ * Used to clean up the source tree after a successful cross-device
+ * copy, or to roll back a partial destination on failure.  Holds one
+ * directory fd per level of the tree.
+ */
+static ftp_error_t pal_dir_remove_recursive(const char *path, unsigned depth) {
+  if (path == NULL) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+
+  int dfd = open(path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (dfd < 0) {
+    if (errno == ENOENT) {
+      return FTP_OK;
+    }
+    {
+      char msg[256];
+      snprintf(msg, sizeof(msg),
+               "[XDEV] opendir(cleanup) failed: errno=%d path=%s", errno, path);
+      ftp_log_line(FTP_LOG_WARN, msg);
     }
+    return FTP_ERR_DIR_OPEN;
   }
 
-  (void)closedir(dir);
+  ftp_error_t err = pal_dir_remove_entries_at(dfd, depth);
 
   if (err == FTP_OK) {
     if (rmdir(path) < 0) {
@@ -1790,6 +2576,13 @@ ftp_error_t pal_file_copy_recursive_ex(const char *src, const char *dst,
                                     out_errno);
 }
 
+ftp_error_t pal_file_copy_file_ex(const char *src, const char *dst,
+                                  pal_copy_progress_cb_t cb, void *user_data,
+                                  int *out_errno) {
+  uint64_t cum = 0U;
+  return pal_file_copy_atomic_ex(src, dst, cb, user_data, &cum, out_errno);
+}
+
 /*===========================================================================*
  * DIRECTORY OPERATIONS
  *===========================================================================*/
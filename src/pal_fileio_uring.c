@@ -0,0 +1,656 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file pal_fileio_uring.c
+ * @brief Platform Abstraction Layer - io_uring data-path engine (Linux)
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * Talks to the kernel through the raw io_uring_setup/enter/register
+ * syscalls so there is no liburing dependency.  Every other platform (and
+ * Linux kernels without IORING_FEAT_EXT_ARG) gets FTP_ERR_NOT_SUPPORTED and
+ * the caller keeps its sendfile / read+send / recv+write loop.
+ *
+ * PIPELINE (one ring per transfer, one registered buffer split in halves)
+ *
+ *      enter #1        enter #2              enter #3
+ *   ┌──────────┐   ┌──────────────────┐   ┌──────────────────┐
+ *   │ read  A  │──►│ send A │ read  B │──►│ send B │ read  A │──► ...
+ *   └──────────┘   └──────────────────┘   └──────────────────┘
+ *
+ *   STOR is the mirror image (recv B overlaps write A).  Each step is a
+ *   single io_uring_enter() instead of two blocking syscalls, and the disk
+ *   side overlaps the network side without a helper thread.
+ *
+ *   The two SQEs of a step are deliberately NOT linked: a stream socket
+ *   may legally return fewer bytes than requested, and a fixed-length
+ *   linked write/send would then push stale buffer bytes.  The step
+ *   boundary is where the real length becomes known.
+ */
+
+#include "pal_fileio.h"
+#include <errno.h>
+#include <string.h>
+
+#if HAS_IO_URING
+#include <linux/io_uring.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#if HAS_IO_URING
+
+/*===========================================================================*
+ * RAW RING
+ *===========================================================================*/
+
+/** SQ/CQ depth: two in-flight ops per step, rounded up for headroom */
+#define URING_ENTRIES 8U
+
+/** user_data tags */
+#define URING_TAG_NET  1U
+#define URING_TAG_DISK 2U
+
+typedef struct {
+  int fd;
+  int fixed; /* 1 = buffer registered, use READ_FIXED/WRITE_FIXED */
+  void *sq_map;
+  size_t sq_map_sz;
+  void *cq_map;
+  size_t cq_map_sz;
+  struct io_uring_sqe *sqes;
+  size_t sqes_sz;
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+  unsigned sq_local;  /* tail including SQEs not yet published */
+  unsigned to_submit; /* published SQEs the kernel has not consumed */
+} uring_t;
+
+/** Result of one in-flight operation */
+typedef struct {
+  int done;
+  int res;
+} uring_op_t;
+
+static int uring_sys_setup(unsigned entries, struct io_uring_params *p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int uring_sys_enter(int fd, unsigned to_submit, unsigned min_complete,
+                           unsigned flags, const void *arg, size_t argsz) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      arg, argsz);
+}
+
+static int uring_sys_register(int fd, unsigned opcode, const void *arg,
+                              unsigned nr_args) {
+  return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static void uring_teardown(uring_t *u) {
+  if (u->sqes != NULL) {
+    (void)munmap(u->sqes, u->sqes_sz);
+  }
+  if ((u->cq_map != NULL) && (u->cq_map != u->sq_map)) {
+    (void)munmap(u->cq_map, u->cq_map_sz);
+  }
+  if (u->sq_map != NULL) {
+    (void)munmap(u->sq_map, u->sq_map_sz);
+  }
+  if (u->fd >= 0) {
+    (void)close(u->fd);
+  }
+  memset(u, 0, sizeof(*u));
+  u->fd = -1;
+}
+
+/**
+ * @brief Create a ring and map SQ/CQ/SQE arrays
+ *
+ * Requires IORING_FEAT_EXT_ARG (Linux 5.11+) so io_uring_enter() can wait
+ * with a timeout: SO_SNDTIMEO / SO_RCVTIMEO on the data socket are not
+ * honoured by io_uring, and a vanished client must not pin the session
+ * thread forever.
+ */
+static int uring_setup(uring_t *u) {
+  struct io_uring_params p;
+  memset(&p, 0, sizeof(p));
+  memset(u, 0, sizeof(*u));
+  u->fd = -1;
+
+  int fd = uring_sys_setup(URING_ENTRIES, &p);
+  if (fd < 0) {
+    return -1;
+  }
+  u->fd = fd;
+
+  if ((p.features & IORING_FEAT_EXT_ARG) == 0U) {
+    uring_teardown(u);
+    errno = ENOSYS;
+    return -1;
+  }
+
+  u->sq_map_sz = (size_t)p.sq_off.array + ((size_t)p.sq_entries * sizeof(unsigned));
+  u->cq_map_sz = (size_t)p.cq_off.cqes +
+                 ((size_t)p.cq_entries * sizeof(struct io_uring_cqe));
+  if ((p.features & IORING_FEAT_SINGLE_MMAP) != 0U) {
+    if (u->cq_map_sz > u->sq_map_sz) {
+      u->sq_map_sz = u->cq_map_sz;
+    }
+    u->cq_map_sz = u->sq_map_sz;
+  }
+
+  void *sq = mmap(NULL, u->sq_map_sz, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, (off_t)IORING_OFF_SQ_RING);
+  if (sq == MAP_FAILED) {
+    uring_teardown(u);
+    return -1;
+  }
+  u->sq_map = sq;
+
+  if ((p.features & IORING_FEAT_SINGLE_MMAP) != 0U) {
+    u->cq_map = sq;
+  } else {
+    void *cq = mmap(NULL, u->cq_map_sz, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, (off_t)IORING_OFF_CQ_RING);
+    if (cq == MAP_FAILED) {
+      uring_teardown(u);
+      return -1;
+    }
+    u->cq_map = cq;
+  }
+
+  u->sqes_sz = (size_t)p.sq_entries * sizeof(struct io_uring_sqe);
+  void *sqes = mmap(NULL, u->sqes_sz, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, (off_t)IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    uring_teardown(u);
+    return -1;
+  }
+  u->sqes = (struct io_uring_sqe *)sqes;
+
+  unsigned char *sqb = (unsigned char *)u->sq_map;
+  unsigned char *cqb = (unsigned char *)u->cq_map;
+  u->sq_head = (unsigned *)(void *)(sqb + p.sq_off.head);
+  u->sq_tail = (unsigned *)(void *)(sqb + p.sq_off.tail);
+  u->sq_mask = (unsigned *)(void *)(sqb + p.sq_off.ring_mask);
+  u->sq_array = (unsigned *)(void *)(sqb + p.sq_off.array);
+  u->cq_head = (unsigned *)(void *)(cqb + p.cq_off.head);
+  u->cq_tail = (unsigned *)(void *)(cqb + p.cq_off.tail);
+  u->cq_mask = (unsigned *)(void *)(cqb + p.cq_off.ring_mask);
+  u->cqes = (struct io_uring_cqe *)(void *)(cqb + p.cq_off.cqes);
+  u->sq_local = *u->sq_tail;
+  return 0;
+}
+
+/**
+ * @brief Register the transfer buffer (READ_FIXED / WRITE_FIXED)
+ *
+ * Pinning the pool buffer once per transfer saves the kernel a
+ * get_user_pages() walk on every disk op.  RLIMIT_MEMLOCK can refuse it
+ * on older kernels; the engine then simply uses plain READ/WRITE.
+ */
+static void uring_register_buffer(uring_t *u, void *buf, size_t len) {
+  struct iovec iov;
+  iov.iov_base = buf;
+  iov.iov_len = len;
+  u->fixed = (uring_sys_register(u->fd, IORING_REGISTER_BUFFERS, &iov, 1U) == 0)
+                 ? 1
+                 : 0;
+}
+
+static struct io_uring_sqe *uring_get_sqe(uring_t *u) {
+  unsigned head = __atomic_load_n(u->sq_head, __ATOMIC_ACQUIRE);
+  unsigned tail = u->sq_local;
+  if ((tail - head) >= (*u->sq_mask + 1U)) {
+    return NULL;
+  }
+  unsigned idx = tail & *u->sq_mask;
+  struct io_uring_sqe *sqe = &u->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  u->sq_array[idx] = idx;
+  u->sq_local++;
+  u->to_submit++;
+  return sqe;
+}
+
+static void uring_prep_disk(uring_t *u, int write, int fd, void *addr,
+                            size_t len, off_t off) {
+  struct io_uring_sqe *sqe = uring_get_sqe(u);
+  if (u->fixed != 0) {
+    sqe->opcode = (uint8_t)((write != 0) ? IORING_OP_WRITE_FIXED
+                                         : IORING_OP_READ_FIXED);
+    sqe->buf_index = 0U;
+  } else {
+    sqe->opcode = (uint8_t)((write != 0) ? IORING_OP_WRITE : IORING_OP_READ);
+  }
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)addr;
+  sqe->len = (uint32_t)len;
+  sqe->off = (uint64_t)off;
+  sqe->user_data = URING_TAG_DISK;
+}
+
+static void uring_prep_net(uring_t *u, int send_op, int fd, void *addr,
+                           size_t len) {
+  struct io_uring_sqe *sqe = uring_get_sqe(u);
+  sqe->opcode = (uint8_t)((send_op != 0) ? IORING_OP_SEND : IORING_OP_RECV);
+  sqe->fd = fd;
+  sqe->addr = (uint64_t)(uintptr_t)addr;
+  sqe->len = (uint32_t)len;
+  /*
+   * send: MSG_WAITALL makes the kernel retry short sends internally.
+   * recv: a plain recv returns as soon as data is available, exactly like
+   *       the blocking recv() loop it replaces.
+   */
+  sqe->msg_flags = (send_op != 0) ? (uint32_t)(MSG_NOSIGNAL | MSG_WAITALL) : 0U;
+  sqe->user_data = URING_TAG_NET;
+}
+
+/**
+ * @brief Submit queued SQEs and wait until both ops of a step completed
+ *
+ * @return 0 on success, -1 with errno (ETIME on inactivity timeout)
+ */
+static int uring_step(uring_t *u, uring_op_t *net, uring_op_t *disk,
+                      unsigned expected) {
+  struct __kernel_timespec ts;
+  ts.tv_sec = (long long)(FTP_DATA_IO_TIMEOUT_MS / 1000U);
+  ts.tv_nsec = (long long)(FTP_DATA_IO_TIMEOUT_MS % 1000U) * 1000000LL;
+
+  struct io_uring_getevents_arg arg;
+  memset(&arg, 0, sizeof(arg));
+  arg.ts = (uint64_t)(uintptr_t)&ts;
+
+  __atomic_store_n(u->sq_tail, u->sq_local, __ATOMIC_RELEASE);
+
+  unsigned reaped = 0U;
+  while (reaped < expected) {
+    unsigned head = *u->cq_head;
+    unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    while ((head != tail) && (reaped < expected)) {
+      const struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+      uring_op_t *op = (cqe->user_data == URING_TAG_NET) ? net : disk;
+      op->done = 1;
+      op->res = cqe->res;
+      head++;
+      reaped++;
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    if (reaped >= expected) {
+      break;
+    }
+
+    int rc = uring_sys_enter(u->fd, u->to_submit, 1U,
+                             IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                             &arg, sizeof(arg));
+    if (rc < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    u->to_submit -= ((unsigned)rc < u->to_submit) ? (unsigned)rc : u->to_submit;
+  }
+  return 0;
+}
+
+/**
+ * @brief Abort in-flight ops after a timeout and drain their CQEs
+ *
+ * shutdown() completes any pending send/recv on the socket immediately;
+ * a pending disk op completes on its own.  The ring must not be torn
+ * down while the kernel still owns the buffer.
+ */
+static void uring_abort(uring_t *u, int sock_fd, uring_op_t *net,
+                        uring_op_t *disk) {
+  (void)shutdown(sock_fd, SHUT_RDWR);
+  unsigned pending = ((net->done == 0) ? 1U : 0U) + ((disk->done == 0) ? 1U : 0U);
+  uring_op_t scratch_net = *net;
+  uring_op_t scratch_disk = *disk;
+  while (pending > 0U) {
+    unsigned head = *u->cq_head;
+    unsigned tail = __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE);
+    while ((head != tail) && (pending > 0U)) {
+      const struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+      uring_op_t *op = (cqe->user_data == URING_TAG_NET) ? &scratch_net
+                                                          : &scratch_disk;
+      op->done = 1;
+      head++;
+      pending--;
+    }
+    __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    if (pending == 0U) {
+      break;
+    }
+    if ((uring_sys_enter(u->fd, 0U, 1U, IORING_ENTER_GETEVENTS, NULL, 0U) < 0) &&
+        (errno != EINTR)) {
+      break;
+    }
+  }
+}
+
+/** Number of bytes in each half of the transfer buffer (page aligned) */
+static size_t uring_half(size_t buf_sz) {
+  return (buf_sz / 2U) & ~(size_t)4095U;
+}
+
+#endif /* HAS_IO_URING */
+
+/*===========================================================================*
+ * PUBLIC API
+ *===========================================================================*/
+
+/**
+ * @brief Probe io_uring once per process
+ */
+int pal_uring_available(void) {
+#if HAS_IO_URING
+  static atomic_int probed = ATOMIC_VAR_INIT(0); /* 0 = unknown, 1 = yes, 2 = no */
+  int state = atomic_load(&probed);
+  if (state == 0) {
+    uring_t u;
+    state = (uring_setup(&u) == 0) ? 1 : 2;
+    if (state == 1) {
+      uring_teardown(&u);
+    }
+    atomic_store(&probed, state);
+  }
+  return (state == 1) ? 1 : 0;
+#else
+  return 0;
+#endif
+}
+
+ftp_error_t pal_uring_file_to_socket(int sock_fd, int file_fd, off_t *offset,
+                                     uint64_t count, void *buf, size_t buf_sz,
+                                     pal_copy_progress_cb_t cb, void *user_data,
+                                     uint64_t *out_bytes) {
+  if (out_bytes != NULL) {
+    *out_bytes = 0U;
+  }
+  if ((sock_fd < 0) || (file_fd < 0) || (offset == NULL) || (*offset < 0) ||
+      (buf == NULL) || (out_bytes == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+#if HAS_IO_URING
+  size_t half = uring_half(buf_sz);
+  if ((half == 0U) || (pal_uring_available() == 0)) {
+    return FTP_ERR_NOT_SUPPORTED;
+  }
+
+  uring_t u;
+  if (uring_setup(&u) != 0) {
+    return FTP_ERR_NOT_SUPPORTED;
+  }
+  uring_register_buffer(&u, buf, half * 2U);
+
+  unsigned char *slot[2];
+  slot[0] = (unsigned char *)buf;
+  slot[1] = (unsigned char *)buf + half;
+
+  ftp_error_t result = FTP_OK;
+  off_t read_off = *offset;   /* next file offset to read            */
+  uint64_t to_read = count;   /* bytes not yet handed to a read op   */
+  uint64_t sent = 0U;
+  int cur = 0;
+  size_t cur_len = 0U;        /* bytes waiting in slot[cur] to send  */
+
+  /* Prime: fill slot 0 */
+  if (to_read > 0U) {
+    uring_op_t net = {1, 0};
+    uring_op_t disk = {0, 0};
+    size_t want = (to_read < (uint64_t)half) ? (size_t)to_read : half;
+    uring_prep_disk(&u, 0, file_fd, slot[0], want, read_off);
+    if (uring_step(&u, &net, &disk, 1U) != 0) {
+      uring_abort(&u, sock_fd, &net, &disk);
+      result = FTP_ERR_TIMEOUT;
+    } else if (disk.res <= 0) {
+      errno = (disk.res < 0) ? -disk.res : EIO;
+      result = FTP_ERR_FILE_READ;
+    } else {
+      cur_len = (size_t)disk.res;
+      read_off += (off_t)disk.res;
+      to_read -= (uint64_t)disk.res;
+    }
+  }
+
+  while ((result == FTP_OK) && (cur_len > 0U)) {
+    uring_op_t net = {0, 0};
+    uring_op_t disk = {1, 0};
+    unsigned expected = 1U;
+    int nxt = 1 - cur;
+
+    uring_prep_net(&u, 1, sock_fd, slot[cur], cur_len);
+    if (to_read > 0U) {
+      size_t want = (to_read < (uint64_t)half) ? (size_t)to_read : half;
+      uring_prep_disk(&u, 0, file_fd, slot[nxt], want, read_off);
+      disk.done = 0;
+      expected = 2U;
+    }
+
+    if (uring_step(&u, &net, &disk, expected) != 0) {
+      uring_abort(&u, sock_fd, &net, &disk);
+      result = FTP_ERR_TIMEOUT;
+      break;
+    }
+
+    /* Network side first: the bytes in slot[cur] are the older data */
+    if (net.res < 0) {
+      errno = -net.res;
+      result = FTP_ERR_SOCKET_SEND;
+      break;
+    }
+    size_t done = (size_t)net.res;
+    while (done < cur_len) {
+      /* MSG_WAITALL is best-effort on older kernels: finish inline */
+      ssize_t n = send(sock_fd, slot[cur] + done, cur_len - done, MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        break;
+      }
+      done += (size_t)n;
+    }
+    sent += (uint64_t)done;
+    if (done < cur_len) {
+      result = FTP_ERR_SOCKET_SEND;
+      break;
+    }
+    if ((cb != NULL) && (cb(sent, user_data) < 0)) {
+      result = FTP_ERR_SOCKET_SEND;
+      break;
+    }
+
+    cur_len = 0U;
+    if (expected == 2U) {
+      if (disk.res <= 0) {
+        errno = (disk.res < 0) ? -disk.res : EIO;
+        result = FTP_ERR_FILE_READ; /* file shrank or I/O error */
+        break;
+      }
+      cur_len = (size_t)disk.res;
+      read_off += (off_t)disk.res;
+      to_read -= (uint64_t)disk.res;
+      cur = nxt;
+    }
+  }
+
+  uring_teardown(&u);
+  *offset += (off_t)sent;
+  *out_bytes = sent;
+  if ((result == FTP_OK) && (sent != count)) {
+    result = FTP_ERR_FILE_READ;
+  }
+  return result;
+#else
+  (void)buf_sz;
+  (void)count;
+  (void)cb;
+  (void)user_data;
+  return FTP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+ftp_error_t pal_uring_socket_to_file(int sock_fd, int file_fd, off_t *offset,
+                                     void *buf, size_t buf_sz,
+                                     pal_copy_progress_cb_t cb, void *user_data,
+                                     uint64_t *out_bytes) {
+  if (out_bytes != NULL) {
+    *out_bytes = 0U;
+  }
+  if ((sock_fd < 0) || (file_fd < 0) || (offset == NULL) || (*offset < 0) ||
+      (buf == NULL) || (out_bytes == NULL)) {
+    return FTP_ERR_INVALID_PARAM;
+  }
+#if HAS_IO_URING
+  size_t half = uring_half(buf_sz);
+  if ((half == 0U) || (pal_uring_available() == 0)) {
+    return FTP_ERR_NOT_SUPPORTED;
+  }
+
+  uring_t u;
+  if (uring_setup(&u) != 0) {
+    return FTP_ERR_NOT_SUPPORTED;
+  }
+  uring_register_buffer(&u, buf, half * 2U);
+
+  unsigned char *slot[2];
+  slot[0] = (unsigned char *)buf;
+  slot[1] = (unsigned char *)buf + half;
+
+  ftp_error_t result = FTP_OK;
+  off_t write_off = *offset;
+  uint64_t written = 0U;
+  uint64_t received = 0U;
+  int cur = 0;
+  size_t cur_len = 0U; /* bytes waiting in slot[cur] to be written */
+  int eof = 0;
+
+  for (;;) {
+    uring_op_t net = {1, 0};
+    uring_op_t disk = {1, 0};
+    unsigned expected = 0U;
+    int nxt = (cur_len > 0U) ? (1 - cur) : cur;
+
+    if (cur_len > 0U) {
+      uring_prep_disk(&u, 1, file_fd, slot[cur], cur_len, write_off);
+      disk.done = 0;
+      expected++;
+    }
+    if (eof == 0) {
+      uring_prep_net(&u, 0, sock_fd, slot[nxt], half);
+      net.done = 0;
+      expected++;
+    }
+    if (expected == 0U) {
+      break; /* EOF seen and everything flushed */
+    }
+
+    if (uring_step(&u, &net, &disk, expected) != 0) {
+      uring_abort(&u, sock_fd, &net, &disk);
+      result = FTP_ERR_TIMEOUT;
+      break;
+    }
+
+    /* Disk side first: it holds the older bytes */
+    if (cur_len > 0U) {
+      if (disk.res < 0) {
+        errno = -disk.res;
+        result = FTP_ERR_FILE_WRITE;
+        break;
+      }
+      size_t done = (size_t)disk.res;
+      while (done < cur_len) {
+        ssize_t w = pwrite(file_fd, slot[cur] + done, cur_len - done,
+                           write_off + (off_t)done);
+        if (w < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          break;
+        }
+        if (w == 0) {
+          errno = ENOSPC;
+          break;
+        }
+        done += (size_t)w;
+      }
+      if (done < cur_len) {
+        result = FTP_ERR_FILE_WRITE;
+        break;
+      }
+      write_off += (off_t)cur_len;
+      written += (uint64_t)cur_len;
+      cur_len = 0U;
+    }
+
+    if (eof == 0) {
+      if (net.res < 0) {
+        if (net.res == -EINTR) {
+          continue;
+        }
+        errno = -net.res;
+        result = FTP_ERR_SOCKET_RECV;
+        break;
+      }
+      if (net.res == 0) {
+        eof = 1;
+      } else {
+        received += (uint64_t)net.res;
+        cur_len = (size_t)net.res;
+        cur = nxt;
+        if ((cb != NULL) && (cb(received, user_data) < 0)) {
+          result = FTP_ERR_SOCKET_RECV;
+          break;
+        }
+      }
+    }
+  }
+
+  uring_teardown(&u);
+  *offset = write_off;
+  *out_bytes = written;
+  return result;
+#else
+  (void)buf_sz;
+  (void)cb;
+  (void)user_data;
+  return FTP_ERR_NOT_SUPPORTED;
+#endif
+}
@@ -41,6 +41,7 @@ SOFTWARE.
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
 #include <sys/mount.h> /* fstatfs, struct statfs */
@@ -57,14 +58,27 @@ extern int _fstatfs(int, struct statfs *);
 int psx_vfs_try_open_self(vfs_node_t *node, const char *path);
 ftp_error_t psx_vfs_stat(const char *path, vfs_stat_t *out);
 ssize_t psx_vfs_read(vfs_node_t *node, void *buffer, size_t length);
+void psx_vfs_close(vfs_node_t *node);
 #endif
 
+/* Mounted exFAT images (pal_filesystem_image.c) */
+ftp_error_t image_vfs_stat(const char *path, vfs_stat_t *out);
+ftp_error_t image_vfs_open(vfs_node_t *node, const char *path);
+ssize_t image_vfs_pread(vfs_node_t *node, void *buffer, size_t length,
+                        uint64_t offset);
+void image_vfs_close(vfs_node_t *node);
+
 ftp_error_t vfs_stat(const char *path, vfs_stat_t *out)
 {
     if ((path == NULL) || (out == NULL)) {
         return FTP_ERR_INVALID_PARAM;
     }
 
+    ftp_error_t img_err = image_vfs_stat(path, out);
+    if (img_err != FTP_ERR_UNKNOWN) {
+        return img_err;
+    }
+
 #if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
     ftp_error_t psx_err = psx_vfs_stat(path, out);
     if (psx_err != FTP_ERR_UNKNOWN) {
@@ -93,6 +107,11 @@ ftp_error_t vfs_open(vfs_node_t *node, const char *path)
     memset(node, 0, sizeof(*node));
     node->fd = -1;
 
+    ftp_error_t img_err = image_vfs_open(node, path);
+    if (img_err != FTP_ERR_UNKNOWN) {
+        return img_err;
+    }
+
     /*
      * PLATFORM PS4/PS5 — raw file transfer, NOT MAP_SELF
      *
@@ -209,13 +228,14 @@ void vfs_close(vfs_node_t *node)
         return;
     }
 
+    if ((node->caps & VFS_CAP_IMAGE) != 0U) {
+        image_vfs_close(node);
+        return;
+    }
+
 #if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
     if ((node->caps & VFS_CAP_STREAM_ONLY) != 0U) {
-        if (node->psx.self_fd >= 0) {
-            pal_file_close(node->psx.self_fd);
-        }
-        node->psx.self_fd = -1;
-        node->private_ctx = NULL;
+        psx_vfs_close(node);
         return;
     }
 #endif
@@ -252,6 +272,14 @@ ssize_t vfs_read(vfs_node_t *node, void *buffer, size_t length)
         return -1;
     }
 
+    if ((node->caps & VFS_CAP_IMAGE) != 0U) {
+        ssize_t got = image_vfs_pread(node, buffer, length, node->offset);
+        if (got > 0) {
+            node->offset += (uint64_t)got;
+        }
+        return got;
+    }
+
 #if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
     if ((node->caps & VFS_CAP_STREAM_ONLY) != 0U) {
         return psx_vfs_read(node, buffer, length);
@@ -269,3 +297,32 @@ ssize_t vfs_read(vfs_node_t *node, void *buffer, size_t length)
     }
     return n;
 }
+
+ssize_t vfs_pread(vfs_node_t *node, void *buffer, size_t length,
+                  uint64_t offset)
+{
+    if ((node == NULL) || (buffer == NULL) || (length == 0U)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if ((node->caps & VFS_CAP_IMAGE) != 0U) {
+        return image_vfs_pread(node, buffer, length, offset);
+    }
+
+#if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
+    if ((node->caps & VFS_CAP_STREAM_ONLY) != 0U) {
+        uint64_t saved = node->offset;
+        node->offset = offset;
+        ssize_t got = psx_vfs_read(node, buffer, length);
+        node->offset = saved;
+        return got;
+    }
+#endif
+
+    if (node->fd < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    return pread(node->fd, buffer, length, (off_t)offset);
+}
@@ -0,0 +1,690 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+/**
+ * @file pal_filesystem_image.c
+ * @brief Read-only VFS backend for mounted exFAT images
+ *
+ * @author Seregon
+ * @version 1.0.0
+ *
+ *   vfs_mount_image()                       vfs_open() / vfs_pread()
+ *        │                                          │
+ *        ▼  breadth-first exfat_read_directory()    ▼
+ *   entries[] ──► index[hash(path)]  ──►  entry ──► extent cursor ──► pread
+ *
+ * The tree is read once at mount time.  Every directory's children are
+ * stored contiguously, so a listing is a slice of entries[]; a lookup is
+ * one FNV-1a hash and a short probe.  An open file keeps the extent it
+ * read last: sequential reads follow the chain one extent at a time, a
+ * seek backwards (REST, Range) starts over from the first cluster.
+ *
+ * THREAD SAFETY: the mount table is guarded by g_image_lock; an image's
+ * index never changes after mount.  The exFAT context is shared by every
+ * open file of the image, so FAT lookups take its fat_lock; data reads
+ * are pread() on the image fd and need no lock.  A vfs_node_t itself is
+ * used by one thread at a time.
+ */
+#include "pal_filesystem.h"
+
+#include "exfat_unpacker.h"
+#include "ftp_config.h"
+#include "pal_fileio.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+ftp_error_t image_vfs_stat(const char *path, vfs_stat_t *out);
+ftp_error_t image_vfs_open(vfs_node_t *node, const char *path);
+ssize_t image_vfs_pread(vfs_node_t *node, void *buffer, size_t length,
+                        uint64_t offset);
+void image_vfs_close(vfs_node_t *node);
+
+/* Directories list their children as entries[child_first, +child_count) */
+typedef struct {
+    uint32_t path_off;      /* into names[]; "" for the root */
+    uint32_t hash;          /* FNV-1a of the path */
+    uint32_t first_cluster;
+    uint32_t child_first;
+    uint32_t child_count;
+    uint8_t is_dir;
+    uint8_t no_fat_chain;
+    uint64_t size;
+    int64_t mtime;
+} image_entry_t;
+
+typedef struct {
+    char at[FTP_PATH_MAX];      /* mount point */
+    size_t at_len;
+    exfat_context_t ctx;
+    int fd;                     /* fileno(ctx.image_file) */
+    pthread_mutex_t fat_lock;
+    image_entry_t *entries;
+    uint32_t count;
+    char *names;
+    size_t names_len;
+    uint32_t *index;            /* entry + 1, 0 = empty */
+    uint32_t index_mask;
+    unsigned refs;              /* mount table + open files */
+} image_t;
+
+/* An open file: the image, the entry and the last extent read */
+typedef struct {
+    image_t *img;
+    exfat_file_info_t info;     /* first_cluster, data_length, no_fat_chain */
+    uint64_t ext_pos;           /* file offset of the extent */
+    uint64_t ext_len;           /* its length in bytes, 0 = none yet */
+    uint64_t ext_phys;          /* its image offset */
+    uint32_t next;              /* cluster after the extent */
+} image_file_t;
+
+static pthread_mutex_t g_image_lock = PTHREAD_MUTEX_INITIALIZER;
+static image_t *g_images[FTP_VFS_IMAGE_MOUNTS];
+static atomic_uint g_image_count = ATOMIC_VAR_INIT(0U);
+
+/*===========================================================================*
+ * INDEX
+ *===========================================================================*/
+
+static uint32_t path_hash(const char *s, size_t len)
+{
+    uint32_t h = 2166136261U;
+    for (size_t i = 0U; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619U;
+    }
+    return h;
+}
+
+static const char *entry_path(const image_t *img, const image_entry_t *e)
+{
+    return img->names + e->path_off;
+}
+
+static const image_entry_t *image_lookup(const image_t *img, const char *rel)
+{
+    size_t len = strlen(rel);
+    uint32_t h = path_hash(rel, len);
+    uint32_t s = h & img->index_mask;
+
+    while (img->index[s] != 0U) {
+        const image_entry_t *e = &img->entries[img->index[s] - 1U];
+        if ((e->hash == h) && (strcmp(entry_path(img, e), rel) == 0)) {
+            return e;
+        }
+        s = (s + 1U) & img->index_mask;
+    }
+    return NULL;
+}
+
+static int build_index(image_t *img)
+{
+    uint32_t slots = 16U;
+    while (slots < (img->count * 2U)) {
+        slots <<= 1U; /* count <= FTP_VFS_IMAGE_MAX_ENTRIES: no overflow */
+    }
+    img->index = (uint32_t *)calloc((size_t)slots, sizeof(uint32_t));
+    if (img->index == NULL) {
+        return -1;
+    }
+    img->index_mask = slots - 1U;
+
+    for (uint32_t i = 0U; i < img->count; i++) {
+        uint32_t s = img->entries[i].hash & img->index_mask;
+        while (img->index[s] != 0U) {
+            s = (s + 1U) & img->index_mask;
+        }
+        img->index[s] = i + 1U;
+    }
+    return 0;
+}
+
+/* Room for @p need more bytes in names[] */
+static int names_reserve(image_t *img, size_t *cap, size_t need)
+{
+    if ((img->names_len + need) > (size_t)UINT32_MAX) {
+        return -1;
+    }
+    if ((img->names_len + need) <= *cap) {
+        return 0;
+    }
+    size_t ncap = (*cap == 0U) ? 4096U : *cap;
+    while (ncap < (img->names_len + need)) {
+        ncap *= 2U;
+    }
+    char *names = (char *)realloc(img->names, ncap);
+    if (names == NULL) {
+        return -1;
+    }
+    img->names = names;
+    *cap = ncap;
+    return 0;
+}
+
+/*
+ * Every entry of a directory: exfat_read_directory() fills a fixed array,
+ * so read again with twice the room while it comes back full.
+ */
+static int read_dir_all(image_t *img, uint32_t first_cluster,
+                        exfat_file_info_t **out)
+{
+    int cap = 64;
+    for (;;) {
+        exfat_file_info_t *infos =
+            (exfat_file_info_t *)malloc((size_t)cap * sizeof(*infos));
+        if (infos == NULL) {
+            return -1;
+        }
+        int n = exfat_read_directory(&img->ctx, first_cluster, infos, cap);
+        if ((n < cap) || (cap >= (int)FTP_VFS_IMAGE_MAX_ENTRIES)) {
+            if (n < 0) {
+                free(infos);
+                return -1;
+            }
+            *out = infos;
+            return n;
+        }
+        free(infos);
+        cap *= 2;
+    }
+}
+
+static int entry_push(image_t *img, uint32_t *cap)
+{
+    if (img->count >= (uint32_t)FTP_VFS_IMAGE_MAX_ENTRIES) {
+        return -1;
+    }
+    if (img->count == *cap) {
+        uint32_t ncap = (*cap == 0U) ? 256U : (*cap * 2U);
+        image_entry_t *e = (image_entry_t *)realloc(
+            img->entries, (size_t)ncap * sizeof(*e));
+        if (e == NULL) {
+            return -1;
+        }
+        img->entries = e;
+        *cap = ncap;
+    }
+    memset(&img->entries[img->count], 0, sizeof(img->entries[0]));
+    return 0;
+}
+
+static int64_t dos_mtime(uint32_t dos_time)
+{
+    time_t t = exfat_dos_time_to_unix(dos_time);
+    return (t == (time_t)-1) ? 0 : (int64_t)t;
+}
+
+/*
+ * Breadth-first walk from the root directory.  A directory's children
+ * are appended together, which is what makes them a contiguous slice.
+ * Names that cannot be path components ("", ".", "..", containing '/')
+ * are skipped.
+ */
+static int build_tree(image_t *img, int64_t root_mtime)
+{
+    uint32_t cap = 0U;
+    size_t names_cap = 0U;
+
+    if ((entry_push(img, &cap) != 0) ||
+        (names_reserve(img, &names_cap, 1U) != 0)) {
+        return -1;
+    }
+    img->names[img->names_len++] = '\0';
+    img->entries[0].path_off = 0U;
+    img->entries[0].hash = path_hash("", 0U);
+    img->entries[0].first_cluster = img->ctx.boot_sector.root_dir_first_cluster;
+    img->entries[0].is_dir = 1U;
+    img->entries[0].mtime = root_mtime;
+    img->count = 1U;
+
+    for (uint32_t d = 0U; d < img->count; d++) {
+        if (img->entries[d].is_dir == 0U) {
+            continue;
+        }
+        exfat_file_info_t *infos = NULL;
+        int n = read_dir_all(img, img->entries[d].first_cluster, &infos);
+        if (n < 0) {
+            return -1;
+        }
+        img->entries[d].child_first = img->count;
+
+        for (int i = 0; i < n; i++) {
+            const exfat_file_info_t *fi = &infos[i];
+            const char *name = fi->filename;
+            if ((name[0] == '\0') || (strchr(name, '/') != NULL) ||
+                (strcmp(name, ".") == 0) || (strcmp(name, "..") == 0)) {
+                continue;
+            }
+
+            size_t plen = strlen(img->names + img->entries[d].path_off);
+            size_t nlen = strlen(name);
+            size_t need = plen + ((plen > 0U) ? 1U : 0U) + nlen + 1U;
+            if ((img->at_len + 1U + need) > FTP_PATH_MAX) {
+                continue; /* would not fit a resolved path */
+            }
+            if ((entry_push(img, &cap) != 0) ||
+                (names_reserve(img, &names_cap, need) != 0)) {
+                free(infos);
+                return -1;
+            }
+
+            uint32_t off = (uint32_t)img->names_len;
+            char *p = img->names + off;
+            memcpy(p, img->names + img->entries[d].path_off, plen);
+            if (plen > 0U) {
+                p[plen++] = '/';
+            }
+            memcpy(p + plen, name, nlen + 1U);
+            img->names_len += need;
+
+            image_entry_t *e = &img->entries[img->count];
+            e->path_off = off;
+            e->hash = path_hash(p, plen + nlen);
+            e->first_cluster = fi->first_cluster;
+            e->is_dir = (fi->is_directory != 0) ? 1U : 0U;
+            e->no_fat_chain = (fi->no_fat_chain != 0) ? 1U : 0U;
+            e->size = (e->is_dir != 0U) ? 0U : fi->data_length;
+            e->mtime = dos_mtime(fi->last_modified_time);
+            img->count++;
+            img->entries[d].child_count++;
+        }
+        free(infos);
+    }
+    return 0;
+}
+
+/*===========================================================================*
+ * MOUNT TABLE
+ *===========================================================================*/
+
+static void image_free(image_t *img)
+{
+    exfat_cleanup(&img->ctx);
+    pthread_mutex_destroy(&img->fat_lock);
+    free(img->entries);
+    free(img->names);
+    free(img->index);
+    free(img);
+}
+
+static void image_release(image_t *img)
+{
+    pthread_mutex_lock(&g_image_lock);
+    unsigned left = --img->refs;
+    pthread_mutex_unlock(&g_image_lock);
+    if (left == 0U) {
+        image_free(img);
+    }
+}
+
+/* Path below the mount point ("" for the mount point itself), or NULL */
+static const char *image_rel(const image_t *img, const char *path)
+{
+    if (strncmp(path, img->at, img->at_len) != 0) {
+        return NULL;
+    }
+    if (path[img->at_len] == '\0') {
+        return path + img->at_len;
+    }
+    return (path[img->at_len] == '/') ? (path + img->at_len + 1U) : NULL;
+}
+
+/*
+ * Find the entry for @p path and take a reference on its image.
+ * Returns the image (release with image_release()), or NULL.
+ */
+static image_t *image_find(const char *path, const image_entry_t **entry)
+{
+    if (atomic_load_explicit(&g_image_count, memory_order_acquire) == 0U) {
+        return NULL;
+    }
+    image_t *found = NULL;
+    pthread_mutex_lock(&g_image_lock);
+    for (size_t i = 0U; i < (size_t)FTP_VFS_IMAGE_MOUNTS; i++) {
+        image_t *img = g_images[i];
+        const char *rel = (img != NULL) ? image_rel(img, path) : NULL;
+        if (rel == NULL) {
+            continue;
+        }
+        *entry = image_lookup(img, rel);
+        if (*entry != NULL) {
+            img->refs++;
+            found = img;
+        }
+        break;
+    }
+    pthread_mutex_unlock(&g_image_lock);
+    return found;
+}
+
+static int paths_overlap(const char *a, size_t a_len, const char *b,
+                         size_t b_len)
+{
+    size_t n = (a_len < b_len) ? a_len : b_len;
+    if (strncmp(a, b, n) != 0) {
+        return 0;
+    }
+    const char *longer = (a_len > b_len) ? a : b;
+    return ((a_len == b_len) || (longer[n] == '/')) ? 1 : 0;
+}
+
+ftp_error_t vfs_mount_image(const char *image, const char *at)
+{
+    if ((image == NULL) || (at == NULL) || (at[0] != '/')) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    size_t at_len = strlen(at);
+    while ((at_len > 1U) && (at[at_len - 1U] == '/')) {
+        at_len--;
+    }
+    if ((at_len <= 1U) || (at_len >= FTP_PATH_MAX)) {
+        return FTP_ERR_PATH_INVALID; /* never shadow the whole root */
+    }
+    if (pal_path_exists(at) == 1) {
+        return FTP_ERR_DIR_EXISTS;
+    }
+
+    image_t *img = (image_t *)calloc(1U, sizeof(*img));
+    if (img == NULL) {
+        return FTP_ERR_OUT_OF_MEMORY;
+    }
+    memcpy(img->at, at, at_len);
+    img->at[at_len] = '\0';
+    img->at_len = at_len;
+    img->refs = 1U;
+    if (pthread_mutex_init(&img->fat_lock, NULL) != 0) {
+        free(img);
+        return FTP_ERR_OUT_OF_MEMORY;
+    }
+
+    if (exfat_init(&img->ctx, image) != 0) {
+        pthread_mutex_destroy(&img->fat_lock);
+        free(img);
+        return FTP_ERR_FILE_OPEN;
+    }
+    img->fd = fileno(img->ctx.image_file);
+
+    struct stat st;
+    int64_t mtime = (fstat(img->fd, &st) == 0) ? (int64_t)st.st_mtime : 0;
+    if ((build_tree(img, mtime) != 0) || (build_index(img) != 0)) {
+        image_free(img);
+        return FTP_ERR_FILE_READ;
+    }
+
+    ftp_error_t err = FTP_ERR_MAX_SESSIONS;
+    pthread_mutex_lock(&g_image_lock);
+    size_t slot = (size_t)FTP_VFS_IMAGE_MOUNTS;
+    for (size_t i = 0U; i < (size_t)FTP_VFS_IMAGE_MOUNTS; i++) {
+        if (g_images[i] == NULL) {
+            if (slot == (size_t)FTP_VFS_IMAGE_MOUNTS) {
+                slot = i;
+            }
+        } else if (paths_overlap(g_images[i]->at, g_images[i]->at_len,
+                                 img->at, img->at_len) != 0) {
+            err = FTP_ERR_DIR_EXISTS;
+            slot = (size_t)FTP_VFS_IMAGE_MOUNTS;
+            break;
+        }
+    }
+    if (slot < (size_t)FTP_VFS_IMAGE_MOUNTS) {
+        g_images[slot] = img;
+        atomic_fetch_add_explicit(&g_image_count, 1U, memory_order_release);
+        err = FTP_OK;
+    }
+    pthread_mutex_unlock(&g_image_lock);
+
+    if (err != FTP_OK) {
+        image_free(img);
+    }
+    return err;
+}
+
+ftp_error_t vfs_unmount_image(const char *at)
+{
+    if (at == NULL) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    size_t at_len = strlen(at);
+    while ((at_len > 1U) && (at[at_len - 1U] == '/')) {
+        at_len--;
+    }
+
+    image_t *img = NULL;
+    pthread_mutex_lock(&g_image_lock);
+    for (size_t i = 0U; i < (size_t)FTP_VFS_IMAGE_MOUNTS; i++) {
+        if ((g_images[i] != NULL) && (g_images[i]->at_len == at_len) &&
+            (strncmp(g_images[i]->at, at, at_len) == 0)) {
+            img = g_images[i];
+            g_images[i] = NULL;
+            atomic_fetch_sub_explicit(&g_image_count, 1U,
+                                      memory_order_release);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_image_lock);
+
+    if (img == NULL) {
+        return FTP_ERR_NOT_FOUND;
+    }
+    image_release(img);
+    return FTP_OK;
+}
+
+int vfs_is_image_path(const char *path)
+{
+    if ((path == NULL) ||
+        (atomic_load_explicit(&g_image_count, memory_order_acquire) == 0U)) {
+        return 0;
+    }
+    int hit = 0;
+    pthread_mutex_lock(&g_image_lock);
+    for (size_t i = 0U; (i < (size_t)FTP_VFS_IMAGE_MOUNTS) && (hit == 0);
+         i++) {
+        hit = ((g_images[i] != NULL) && (image_rel(g_images[i], path) != NULL))
+                  ? 1
+                  : 0;
+    }
+    pthread_mutex_unlock(&g_image_lock);
+    return hit;
+}
+
+/*===========================================================================*
+ * VFS HOOKS (called from pal_filesystem.c)
+ *===========================================================================*/
+
+static void entry_stat(const image_entry_t *e, vfs_stat_t *out)
+{
+    out->mode = (e->is_dir != 0U) ? ((uint32_t)S_IFDIR | 0555U)
+                                  : ((uint32_t)S_IFREG | 0444U);
+    out->size = e->size;
+    out->mtime = e->mtime;
+}
+
+/* FTP_ERR_UNKNOWN: not below a mount point, use the real filesystem */
+ftp_error_t image_vfs_stat(const char *path, vfs_stat_t *out)
+{
+    const image_entry_t *e = NULL;
+    image_t *img = image_find(path, &e);
+    if (img == NULL) {
+        return (vfs_is_image_path(path) != 0) ? FTP_ERR_NOT_FOUND
+                                              : FTP_ERR_UNKNOWN;
+    }
+    entry_stat(e, out);
+    image_release(img);
+    return FTP_OK;
+}
+
+ftp_error_t image_vfs_open(vfs_node_t *node, const char *path)
+{
+    const image_entry_t *e = NULL;
+    image_t *img = image_find(path, &e);
+    if (img == NULL) {
+        return (vfs_is_image_path(path) != 0) ? FTP_ERR_FILE_OPEN
+                                              : FTP_ERR_UNKNOWN;
+    }
+    if (e->is_dir != 0U) {
+        image_release(img);
+        return FTP_ERR_FILE_OPEN;
+    }
+
+    image_file_t *f = (image_file_t *)calloc(1U, sizeof(*f));
+    if (f == NULL) {
+        image_release(img);
+        return FTP_ERR_OUT_OF_MEMORY;
+    }
+    f->img = img;
+    f->info.first_cluster = e->first_cluster;
+    f->info.data_length = e->size;
+    f->info.no_fat_chain = e->no_fat_chain;
+
+    node->fd = -1;
+    node->private_ctx = f;
+    node->size = e->size;
+    node->offset = 0U;
+    node->caps = VFS_CAP_IMAGE; /* no fd: never sendfile */
+    return FTP_OK;
+}
+
+/*
+ * Move f's cursor to the extent holding file offset @p off.  Forward
+ * seeks walk on from the current extent, backward ones restart.
+ */
+static int image_seek_extent(image_file_t *f, uint64_t off)
+{
+    image_t *img = f->img;
+
+    if ((f->ext_len == 0U) || (off < f->ext_pos)) {
+        f->ext_pos = 0U;
+        f->ext_len = 0U;
+        f->next = f->info.first_cluster;
+    }
+
+    while (off >= (f->ext_pos + f->ext_len)) {
+        f->ext_pos += f->ext_len;
+        f->ext_len = 0U;
+        uint32_t first = f->next;
+        if (!exfat_is_valid_cluster(first)) {
+            return -1; /* chain shorter than the file */
+        }
+        pthread_mutex_lock(&img->fat_lock);
+        uint64_t run = exfat_next_extent(&img->ctx, &f->info, &f->next,
+                                         f->info.data_length - f->ext_pos);
+        pthread_mutex_unlock(&img->fat_lock);
+        if (run == 0U) {
+            return -1;
+        }
+        f->ext_len = run * img->ctx.bytes_per_cluster;
+        f->ext_phys = exfat_get_cluster_offset(&img->ctx, first);
+    }
+    return 0;
+}
+
+ssize_t image_vfs_pread(vfs_node_t *node, void *buffer, size_t length,
+                        uint64_t offset)
+{
+    image_file_t *f = (image_file_t *)node->private_ctx;
+    if (f == NULL) {
+        errno = EBADF;
+        return -1;
+    }
+    if (offset >= f->info.data_length) {
+        return 0;
+    }
+    if ((uint64_t)length > (f->info.data_length - offset)) {
+        length = (size_t)(f->info.data_length - offset);
+    }
+
+    size_t done = 0U;
+    while (done < length) {
+        uint64_t at = offset + (uint64_t)done;
+        if (image_seek_extent(f, at) != 0) {
+            break;
+        }
+        uint64_t avail = (f->ext_pos + f->ext_len) - at;
+        size_t want = length - done;
+        if ((uint64_t)want > avail) {
+            want = (size_t)avail;
+        }
+        ssize_t n = pread(f->img->fd, (uint8_t *)buffer + done, want,
+                          (off_t)(f->ext_phys + (at - f->ext_pos)));
+        if ((n < 0) && (errno == EINTR)) {
+            continue;
+        }
+        if (n <= 0) {
+            break; /* read error, or the image is shorter than its heap */
+        }
+        done += (size_t)n;
+    }
+
+    if ((done == 0U) && (length > 0U)) {
+        errno = EIO;
+        return -1;
+    }
+    return (ssize_t)done;
+}
+
+void image_vfs_close(vfs_node_t *node)
+{
+    image_file_t *f = (image_file_t *)node->private_ctx;
+    if (f != NULL) {
+        image_release(f->img);
+        free(f);
+    }
+    node->private_ctx = NULL;
+    node->caps = 0U;
+}
+
+ftp_error_t vfs_image_readdir(const char *path, vfs_dir_fn fn, void *user)
+{
+    if ((path == NULL) || (fn == NULL)) {
+        return FTP_ERR_INVALID_PARAM;
+    }
+    const image_entry_t *dir = NULL;
+    image_t *img = image_find(path, &dir);
+    if (img == NULL) {
+        return FTP_ERR_NOT_FOUND;
+    }
+    if (dir->is_dir == 0U) {
+        image_release(img);
+        return FTP_ERR_NOT_FOUND;
+    }
+
+    for (uint32_t i = 0U; i < dir->child_count; i++) {
+        const image_entry_t *e = &img->entries[dir->child_first + i];
+        const char *p = entry_path(img, e);
+        const char *name = strrchr(p, '/');
+        name = (name != NULL) ? (name + 1) : p;
+
+        vfs_stat_t st;
+        entry_stat(e, &st);
+        if (fn(user, name, &st) != 0) {
+            break;
+        }
+    }
+    image_release(img);
+    return FTP_OK;
+}
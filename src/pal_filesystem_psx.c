@@ -37,6 +37,7 @@ SOFTWARE.
 #if defined(PLATFORM_PS4) || defined(PLATFORM_PS5)
 
 #include "ftp_types.h"
+#include "pal_alloc.h"
 #include "pal_fileio.h"
 #include <elf.h>
 #include <errno.h>
@@ -57,6 +58,7 @@ SOFTWARE.
 ftp_error_t psx_vfs_stat(const char *path, vfs_stat_t *out);
 int psx_vfs_try_open_self(vfs_node_t *node, const char *path);
 ssize_t psx_vfs_read(vfs_node_t *node, void *buffer, size_t length);
+void psx_vfs_close(vfs_node_t *node);
 
 #if defined(PLATFORM_PS5) && defined(__has_include)
 #if __has_include(<ps5/kernel.h>)
@@ -305,17 +307,13 @@ static int self_parse_headers(int fd, self_head_t *head, uint64_t *elf_off, Elf6
     return 0;
 }
 
-static int self_find_entry(int fd, uint16_t num_entries, uint16_t segment_index, uint64_t entry_table_off,
-                           self_entry_t *out)
+static int self_find_entry(const vfs_node_t *node, uint16_t segment_index, self_entry_t *out)
 {
-    for (uint16_t i = 0; i < num_entries; i++) {
-        self_entry_t ent;
-        off_t off = (off_t)(entry_table_off + (uint64_t)i * (uint64_t)sizeof(self_entry_t));
-        if (read_exact(fd, &ent, sizeof(ent), off) != 0) {
-            return -1;
-        }
-        if ((ent.props.segment_index == segment_index) && (ent.props.has_blocks != 0U)) {
-            *out = ent;
+    const self_entry_t *ents = (const self_entry_t *)node->psx.entries;
+
+    for (uint16_t i = 0; i < node->psx.num_entries; i++) {
+        if ((ents[i].props.segment_index == segment_index) && (ents[i].props.has_blocks != 0U)) {
+            *out = ents[i];
             return 0;
         }
     }
@@ -360,22 +358,16 @@ static void *self_map_segment(int fd, const Elf64_Phdr *phdr, uint16_t ind)
     return p;
 }
 
-static uint64_t self_compute_elf_size(int fd, uint64_t elf_off, const Elf64_Ehdr *ehdr)
+static uint64_t self_compute_elf_size(const Elf64_Phdr *phdrs, uint16_t phnum)
 {
     uint64_t max_end = 0U;
 
-    for (uint16_t i = 0; i < (uint16_t)ehdr->e_phnum; i++) {
-        Elf64_Phdr phdr;
-        off_t off = (off_t)(elf_off + (uint64_t)ehdr->e_phoff + (uint64_t)i * (uint64_t)sizeof(phdr));
-        if (read_exact(fd, &phdr, sizeof(phdr), off) != 0) {
-            return 0U;
-        }
-
-        if (phdr.p_filesz == 0U) {
+    for (uint16_t i = 0; i < phnum; i++) {
+        if (phdrs[i].p_filesz == 0U) {
             continue;
         }
 
-        uint64_t end = (uint64_t)phdr.p_offset + (uint64_t)phdr.p_filesz;
+        uint64_t end = (uint64_t)phdrs[i].p_offset + (uint64_t)phdrs[i].p_filesz;
         if (end > max_end) {
             max_end = end;
         }
@@ -384,6 +376,174 @@ static uint64_t self_compute_elf_size(int fd, uint64_t elf_off, const Elf64_Ehdr
     return max_end;
 }
 
+/*
+ * Read the SELF entry table and the ELF program-header table once, at
+ * open: psx_vfs_read() looks segments up in memory instead of issuing
+ * preads per call.
+ */
+static int self_load_tables(vfs_node_t *node, int fd, uint64_t elf_off, const Elf64_Ehdr *ehdr,
+                            uint16_t num_entries)
+{
+    size_t ph_bytes = (size_t)ehdr->e_phnum * sizeof(Elf64_Phdr);
+    size_t ent_bytes = (size_t)num_entries * sizeof(self_entry_t);
+
+    if (ph_bytes == 0U) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    Elf64_Phdr *phdrs = pal_malloc(ph_bytes);
+    self_entry_t *ents = (ent_bytes > 0U) ? pal_malloc(ent_bytes) : NULL;
+    if ((phdrs == NULL) || ((ent_bytes > 0U) && (ents == NULL))) {
+        pal_free(phdrs);
+        pal_free(ents);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    if ((read_exact(fd, phdrs, ph_bytes, (off_t)(elf_off + (uint64_t)ehdr->e_phoff)) != 0) ||
+        ((ent_bytes > 0U) && (read_exact(fd, ents, ent_bytes, (off_t)sizeof(self_head_t)) != 0))) {
+        pal_free(phdrs);
+        pal_free(ents);
+        return -1;
+    }
+
+    node->psx.phdrs = phdrs;
+    node->psx.entries = ents;
+    node->psx.last_seg = 0U;
+    return 0;
+}
+
+/*===========================================================================*
+ * SEGMENT CACHE
+ *
+ *   MAP_SELF decrypts on page fault, so a mapping that stays around
+ *   serves every later read of its segment at memory speed:
+ *
+ *     read ─► (dev, ino, mtime, segment) hit? ─yes─► memcpy from mapping
+ *                                        │ no
+ *                                        ▼
+ *             unmap idle LRU entries until it fits ─► self_map_segment()
+ *
+ *   One table for all sessions, under g_self_map_lock (which already
+ *   serialises ps5_mmap_self's pager swap).  An entry being copied from
+ *   (refs > 0) is never unmapped; a segment that cannot be cached is
+ *   mapped for the one read, as before.
+ *===========================================================================*/
+
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    int64_t mtime;
+    uint16_t index;
+    void *map;         /* NULL = free slot */
+    size_t len;
+    uint32_t refs;
+    uint64_t last_use;
+} self_seg_t;
+
+static self_seg_t g_self_segs[FTP_SELF_CACHE_SLOTS];
+static size_t g_self_seg_bytes = 0U;
+static uint64_t g_self_seg_tick = 0U;
+
+/* Unmap idle entries, oldest first, until @p len more bytes fit; @return free slot or -1 */
+static int self_seg_make_room(size_t len)
+{
+    const size_t budget = (size_t)FTP_SELF_CACHE_MB * 1024U * 1024U;
+
+    if (len > budget) {
+        return -1;
+    }
+
+    for (;;) {
+        int free_slot = -1;
+        int victim = -1;
+        for (int i = 0; i < (int)FTP_SELF_CACHE_SLOTS; i++) {
+            const self_seg_t *e = &g_self_segs[i];
+            if (e->map == NULL) {
+                if (free_slot < 0) {
+                    free_slot = i;
+                }
+            } else if ((e->refs == 0U) &&
+                       ((victim < 0) || (e->last_use < g_self_segs[victim].last_use))) {
+                victim = i;
+            }
+        }
+
+        if ((free_slot >= 0) && ((g_self_seg_bytes + len) <= budget)) {
+            return free_slot;
+        }
+        if (victim < 0) {
+            return -1; /* everything left is in use */
+        }
+
+        (void)munmap(g_self_segs[victim].map, g_self_segs[victim].len);
+        g_self_seg_bytes -= g_self_segs[victim].len;
+        g_self_segs[victim].map = NULL;
+    }
+}
+
+/*
+ * Mapping of segment @p ind, cached when possible.
+ *
+ * @param slot Output: cache slot holding a reference, or -1 when the
+ *             mapping is private to this call (self_seg_release unmaps it)
+ */
+static const uint8_t *self_seg_acquire(const vfs_node_t *node, const Elf64_Phdr *phdr, uint16_t ind,
+                                       int *slot)
+{
+    const size_t len = (size_t)phdr->p_filesz;
+
+    pthread_mutex_lock(&g_self_map_lock);
+    g_self_seg_tick++;
+
+    for (int i = 0; i < (int)FTP_SELF_CACHE_SLOTS; i++) {
+        self_seg_t *e = &g_self_segs[i];
+        if ((e->map != NULL) && (e->index == ind) && (e->ino == node->psx.ino) &&
+            (e->dev == node->psx.dev) && (e->mtime == node->psx.mtime)) {
+            e->refs++;
+            e->last_use = g_self_seg_tick;
+            *slot = i;
+            pthread_mutex_unlock(&g_self_map_lock);
+            return (const uint8_t *)e->map;
+        }
+    }
+
+    int free_slot = self_seg_make_room(len);
+    void *map = self_map_segment(node->psx.self_fd, phdr, ind);
+    if (map == NULL) {
+        pthread_mutex_unlock(&g_self_map_lock);
+        return NULL;
+    }
+
+    if (free_slot >= 0) {
+        self_seg_t *e = &g_self_segs[free_slot];
+        e->dev = node->psx.dev;
+        e->ino = node->psx.ino;
+        e->mtime = node->psx.mtime;
+        e->index = ind;
+        e->map = map;
+        e->len = len;
+        e->refs = 1U;
+        e->last_use = g_self_seg_tick;
+        g_self_seg_bytes += len;
+    }
+    *slot = free_slot;
+    pthread_mutex_unlock(&g_self_map_lock);
+    return (const uint8_t *)map;
+}
+
+static void self_seg_release(const uint8_t *map, size_t len, int slot)
+{
+    pthread_mutex_lock(&g_self_map_lock);
+    if (slot >= 0) {
+        g_self_segs[slot].refs--;
+    } else {
+        (void)munmap((void *)(uintptr_t)map, len);
+    }
+    pthread_mutex_unlock(&g_self_map_lock);
+}
+
 ftp_error_t psx_vfs_stat(const char *path, vfs_stat_t *out)
 {
     if ((path == NULL) || (out == NULL)) {
@@ -454,8 +614,18 @@ int psx_vfs_try_open_self(vfs_node_t *node, const char *path)
         return 0;
     }
 
-    uint64_t elf_size = self_compute_elf_size(fd, elf_off, &ehdr);
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || (self_load_tables(node, fd, elf_off, &ehdr, head.num_entries) != 0)) {
+        pal_file_close(fd);
+        return -1;
+    }
+
+    uint64_t elf_size = self_compute_elf_size((const Elf64_Phdr *)node->psx.phdrs, (uint16_t)ehdr.e_phnum);
     if (elf_size == 0U) {
+        pal_free(node->psx.phdrs);
+        pal_free(node->psx.entries);
+        node->psx.phdrs = NULL;
+        node->psx.entries = NULL;
         pal_file_close(fd);
         return -1;
     }
@@ -472,44 +642,56 @@ int psx_vfs_try_open_self(vfs_node_t *node, const char *path)
     node->psx.phoff = (uint64_t)ehdr.e_phoff;
     node->psx.file_size = head.file_size;
     node->psx.magic = head.magic;
+    node->psx.dev = (uint64_t)st.st_dev;
+    node->psx.ino = (uint64_t)st.st_ino;
+    node->psx.mtime = (int64_t)st.st_mtime;
 
     return 1;
 }
 
-static int find_covering_phdr(int fd, const vfs_node_t *node, uint64_t offset, Elf64_Phdr *out, uint16_t *out_index)
+void psx_vfs_close(vfs_node_t *node)
 {
-    uint64_t elf_off = node->psx.elf_off;
-    uint64_t phoff = node->psx.phoff;
-    uint16_t phnum = node->psx.phnum;
+    if (node == NULL) {
+        return;
+    }
+    if (node->psx.self_fd >= 0) {
+        pal_file_close(node->psx.self_fd);
+    }
+    node->psx.self_fd = -1;
+    pal_free(node->psx.phdrs);
+    pal_free(node->psx.entries);
+    node->psx.phdrs = NULL;
+    node->psx.entries = NULL;
+    node->private_ctx = NULL;
+}
 
-    uint64_t best_next = UINT64_MAX;
-    int found = 0;
+static int phdr_covers(const Elf64_Phdr *phdr, uint64_t offset)
+{
+    uint64_t start = (uint64_t)phdr->p_offset;
+    return (phdr->p_filesz != 0U) && (offset >= start) && (offset < (start + (uint64_t)phdr->p_filesz));
+}
 
-    for (uint16_t i = 0; i < phnum; i++) {
-        Elf64_Phdr phdr;
-        off_t off = (off_t)(elf_off + phoff + (uint64_t)i * (uint64_t)sizeof(phdr));
-        if (read_exact(fd, &phdr, sizeof(phdr), off) != 0) {
-            return -1;
-        }
+/* Sequential reads stay in one segment: try the last hit before scanning */
+static int find_covering_phdr(vfs_node_t *node, uint64_t offset, Elf64_Phdr *out, uint16_t *out_index)
+{
+    const Elf64_Phdr *phdrs = (const Elf64_Phdr *)node->psx.phdrs;
+    uint16_t phnum = node->psx.phnum;
 
-        uint64_t start = (uint64_t)phdr.p_offset;
-        uint64_t end = start + (uint64_t)phdr.p_filesz;
+    if ((node->psx.last_seg < phnum) && phdr_covers(&phdrs[node->psx.last_seg], offset)) {
+        *out = phdrs[node->psx.last_seg];
+        *out_index = node->psx.last_seg;
+        return 1;
+    }
 
-        if ((phdr.p_filesz != 0U) && (offset >= start) && (offset < end)) {
-            *out = phdr;
-            if (out_index != NULL) {
-                *out_index = i;
-            }
+    for (uint16_t i = 0; i < phnum; i++) {
+        if (phdr_covers(&phdrs[i], offset)) {
+            *out = phdrs[i];
+            *out_index = i;
+            node->psx.last_seg = i;
             return 1;
         }
-
-        if ((phdr.p_filesz != 0U) && (start > offset) && (start < best_next)) {
-            best_next = start;
-            found = 0;
-        }
     }
 
-    (void)found;
     return 0;
 }
 
@@ -538,20 +720,12 @@ ssize_t psx_vfs_read(vfs_node_t *node, void *buffer, size_t length)
     uint8_t *dst = (uint8_t *)buffer;
     size_t done = 0U;
 
-    const uint64_t entry_table_off = (uint64_t)sizeof(self_head_t);
-
     while (done < to_read) {
         uint64_t cur_off = pos + (uint64_t)done;
 
         Elf64_Phdr phdr;
         uint16_t seg_index = 0U;
-        int phdr_res = find_covering_phdr(node->psx.self_fd, node, cur_off, &phdr, &seg_index);
-
-        if (phdr_res < 0) {
-            return -1;
-        }
-
-        if (phdr_res == 0) {
+        if (find_covering_phdr(node, cur_off, &phdr, &seg_index) == 0) {
             size_t zero_len = to_read - done;
             memset(dst + done, 0, zero_len);
             done += zero_len;
@@ -578,7 +752,7 @@ ssize_t psx_vfs_read(vfs_node_t *node, void *buffer, size_t length)
         }
 
         self_entry_t ent;
-        if (self_find_entry(node->psx.self_fd, node->psx.num_entries, seg_index, entry_table_off, &ent) != 0) {
+        if (self_find_entry(node, seg_index, &ent) != 0) {
             memset(dst + done, 0, chunk);
             done += chunk;
             continue;
@@ -594,16 +768,14 @@ ssize_t psx_vfs_read(vfs_node_t *node, void *buffer, size_t length)
             continue;
         }
 
-        pthread_mutex_lock(&g_self_map_lock);
-        void *map = self_map_segment(node->psx.self_fd, &phdr, seg_index);
+        int slot = -1;
+        const uint8_t *map = self_seg_acquire(node, &phdr, seg_index, &slot);
         if (map == NULL) {
-            pthread_mutex_unlock(&g_self_map_lock);
             return -1;
         }
 
-        memcpy(dst + done, (const uint8_t *)map + delta, chunk);
-        (void)munmap(map, (size_t)phdr.p_filesz);
-        pthread_mutex_unlock(&g_self_map_lock);
+        memcpy(dst + done, map + delta, chunk);
+        self_seg_release(map, (size_t)phdr.p_filesz, slot);
 
         done += chunk;
     }
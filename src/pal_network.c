@@ -35,13 +35,24 @@ SOFTWARE.
 #include "pal_network.h"
 #include "ftp_config.h"
 #include "ftp_log.h"
+#include "ftp_pasv_pool.h"
 #include <errno.h>
 #include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/time.h>
+#include <time.h>
 #include <unistd.h>
 
+#if (defined(__FreeBSD__) || defined(__APPLE__)) && !defined(PLATFORM_PS4) && \
+    !defined(PLATFORM_PS5)
+#define PAL_SOCKBUF_SYSCTL 1
+#include <sys/sysctl.h>
+#endif
+
 #if FTP_SOCKET_TELEMETRY
 static void pal_socket_telemetry(socket_t fd) {
   int sndbuf = -1;
@@ -465,6 +476,654 @@ ssize_t pal_send_all(socket_t fd, const void *buffer, size_t length,
   return (ssize_t)total;
 }
 
+ssize_t pal_sendv_all(socket_t fd, struct iovec *iov, int iovcnt, int flags) {
+  if ((iov == NULL) || (iovcnt <= 0)) {
+    errno = EINVAL;
+    return -1;
+  }
+  if (fd < 0) {
+    errno = EBADF;
+    return -1;
+  }
+
+  size_t total = 0U;
+  while (iovcnt > 0) {
+    if (iov->iov_len == 0U) {
+      iov++;
+      iovcnt--;
+      continue;
+    }
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+#if defined(__linux__)
+    msg.msg_iovlen = (size_t)iovcnt;
+#else
+    msg.msg_iovlen = iovcnt;
+#endif
+    ssize_t n = sendmsg(fd, &msg, flags);
+    if (n > 0) {
+      size_t left = (size_t)n;
+      total += left;
+      while ((iovcnt > 0) && (left >= iov->iov_len)) {
+        left -= iov->iov_len;
+        iov++;
+        iovcnt--;
+      }
+      if (iovcnt > 0) {
+        iov->iov_base = (uint8_t *)iov->iov_base + left;
+        iov->iov_len -= left;
+      }
+      continue;
+    }
+    if (n == 0) {
+      errno = EPIPE;
+      return -1;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+      usleep(1000);
+      continue;
+    }
+    return -1;
+  }
+
+  return (ssize_t)total;
+}
+
+/*===========================================================================*
+ * TCP_INFO SAMPLING AND BUFFER AUTO-TUNING
+ *===========================================================================*/
+
+/*
+ * getsockopt() units: Linux reports twice what setsockopt() asked for
+ * (the extra half pays for skb overhead); the BSDs report the value set.
+ */
+#if defined(__linux__)
+#define SOCKBUF_REPORT_SCALE 2U
+#else
+#define SOCKBUF_REPORT_SCALE 1U
+#endif
+
+static uint32_t sockopt_u32(socket_t fd, int level, int name) {
+  int v = 0;
+  socklen_t len = (socklen_t)sizeof(v);
+  if ((PAL_GETSOCKOPT(fd, level, name, &v, &len) != 0) || (v < 0)) {
+    return 0U;
+  }
+  return (uint32_t)v;
+}
+
+int pal_socket_tcp_info(int fd, pal_tcp_info_t *out) {
+  if ((fd < 0) || (out == NULL)) {
+    return -1;
+  }
+  memset(out, 0, sizeof(*out));
+  out->sndbuf = sockopt_u32(fd, SOL_SOCKET, SO_SNDBUF);
+  out->rcvbuf = sockopt_u32(fd, SOL_SOCKET, SO_RCVBUF);
+
+#if defined(__linux__) && defined(TCP_INFO)
+  struct tcp_info ti;
+  socklen_t len = (socklen_t)sizeof(ti);
+  memset(&ti, 0, sizeof(ti));
+  if (PAL_GETSOCKOPT(fd, IPPROTO_TCP, TCP_INFO, &ti, &len) != 0) {
+    return -1;
+  }
+  out->rtt_us = ti.tcpi_rtt;
+  out->rttvar_us = ti.tcpi_rttvar;
+  out->mss = ti.tcpi_snd_mss;
+  out->cwnd_bytes = ti.tcpi_snd_cwnd * ti.tcpi_snd_mss; /* segments */
+  out->retrans = ti.tcpi_total_retrans;
+  out->inflight_bytes = ti.tcpi_unacked * ti.tcpi_snd_mss;
+  int queued = 0;
+  if ((ioctl(fd, TIOCOUTQ, &queued) == 0) && (queued > 0)) { /* SIOCOUTQ */
+    out->sendq_bytes = (uint32_t)queued;
+  }
+  return 0;
+#elif (defined(__FreeBSD__) || defined(PLATFORM_PS4) ||                        \
+       defined(PLATFORM_PS5)) && defined(TCP_INFO)
+  struct tcp_info ti;
+  socklen_t len = (socklen_t)sizeof(ti);
+  memset(&ti, 0, sizeof(ti));
+  if (PAL_GETSOCKOPT(fd, IPPROTO_TCP, TCP_INFO, &ti, &len) != 0) {
+    return -1;
+  }
+  out->rtt_us = ti.tcpi_rtt;
+  out->rttvar_us = ti.tcpi_rttvar;
+  out->mss = ti.tcpi_snd_mss;
+  out->cwnd_bytes = ti.tcpi_snd_cwnd; /* already bytes */
+#if !defined(PLATFORM_PS4)
+  out->retrans = ti.tcpi_snd_rexmitpack;
+#endif
+  int queued = 0;
+  if ((ioctl(fd, FIONWRITE, &queued) == 0) && (queued > 0)) {
+    out->sendq_bytes = (uint32_t)queued;
+  }
+  /* No unacked count: in flight is bounded by both queue and window */
+  out->inflight_bytes = (out->sendq_bytes < out->cwnd_bytes)
+                            ? out->sendq_bytes
+                            : out->cwnd_bytes;
+  return 0;
+#elif defined(__APPLE__) && defined(TCP_CONNECTION_INFO)
+  struct tcp_connection_info ci;
+  socklen_t len = (socklen_t)sizeof(ci);
+  memset(&ci, 0, sizeof(ci));
+  if (PAL_GETSOCKOPT(fd, IPPROTO_TCP, TCP_CONNECTION_INFO, &ci, &len) != 0) {
+    return -1;
+  }
+  out->rtt_us = ci.tcpi_srtt * 1000U; /* ms */
+  out->rttvar_us = ci.tcpi_rttvar * 1000U;
+  out->mss = ci.tcpi_maxseg;
+  out->cwnd_bytes = ci.tcpi_snd_cwnd;
+  out->retrans = (uint32_t)ci.tcpi_txretransmitpackets;
+  out->sendq_bytes = ci.tcpi_snd_sbbytes;
+  out->inflight_bytes = (out->sendq_bytes < out->cwnd_bytes)
+                            ? out->sendq_bytes
+                            : out->cwnd_bytes;
+  return 0;
+#else
+  return -1;
+#endif
+}
+
+#if defined(__linux__)
+/* Field @p field (0-based) of a /proc/sys file of numbers, 0 on failure */
+static uint32_t proc_sys_u32(const char *path, int field) {
+  FILE *f = fopen(path, "r");
+  if (f == NULL) {
+    return 0U;
+  }
+  unsigned long v[3] = {0UL, 0UL, 0UL};
+  int n = fscanf(f, "%lu %lu %lu", &v[0], &v[1], &v[2]);
+  fclose(f);
+  if ((n <= field) || (v[field] > 0xFFFFFFFFUL)) {
+    return 0U;
+  }
+  return (uint32_t)v[field];
+}
+#endif
+
+#if defined(PAL_SOCKBUF_SYSCTL)
+static uint32_t sysctl_u32(const char *name) {
+  unsigned long v = 0UL;
+  size_t len = sizeof(v);
+  if (sysctlbyname(name, &v, &len, NULL, 0) != 0) {
+    return 0U;
+  }
+  if (len == sizeof(unsigned int)) { /* some are int-sized */
+    unsigned int w = 0U;
+    memcpy(&w, &v, sizeof(w));
+    return w;
+  }
+  return (v > 0xFFFFFFFFUL) ? 0xFFFFFFFFU : (uint32_t)v;
+}
+#endif
+
+/* [rx][0] = autotuning ceiling, [rx][1] = explicit maximum; read once */
+static _Atomic uint32_t g_sockbuf_limit[2][2];
+static atomic_int g_sockbuf_limit_ready = 0;
+
+static void sockbuf_limits_load(void) {
+  uint32_t lim[2][2] = {{0U, (uint32_t)FTP_SOCK_TUNE_MAX_BUF},
+                        {0U, (uint32_t)FTP_SOCK_TUNE_MAX_BUF}};
+#if defined(__linux__)
+  lim[0][0] = proc_sys_u32("/proc/sys/net/ipv4/tcp_wmem", 2);
+  lim[1][0] = proc_sys_u32("/proc/sys/net/ipv4/tcp_rmem", 2);
+  lim[0][1] = 2U * proc_sys_u32("/proc/sys/net/core/wmem_max", 0);
+  lim[1][1] = 2U * proc_sys_u32("/proc/sys/net/core/rmem_max", 0);
+#elif defined(PAL_SOCKBUF_SYSCTL)
+#if defined(__APPLE__)
+  lim[0][0] = sysctl_u32("net.inet.tcp.autosndbufmax");
+  lim[1][0] = sysctl_u32("net.inet.tcp.autorcvbufmax");
+#else
+  lim[0][0] = sysctl_u32("net.inet.tcp.sendbuf_max");
+  lim[1][0] = sysctl_u32("net.inet.tcp.recvbuf_max");
+#endif
+  /* sb_max counts mbuf overhead: usable = sb_max * MCLBYTES / (MSIZE + MCLBYTES) */
+  uint32_t sb_max = sysctl_u32("kern.ipc.maxsockbuf");
+  lim[0][1] = (uint32_t)(((uint64_t)sb_max * 2048U) / 2304U);
+  lim[1][1] = lim[0][1];
+#endif
+  for (int rx = 0; rx < 2; rx++) {
+    for (int k = 0; k < 2; k++) {
+      atomic_store_explicit(&g_sockbuf_limit[rx][k], lim[rx][k],
+                            memory_order_relaxed);
+    }
+  }
+  atomic_store_explicit(&g_sockbuf_limit_ready, 1, memory_order_release);
+}
+
+static void sockbuf_limits(int rx, pal_sock_limits_t *lim) {
+  if (atomic_load_explicit(&g_sockbuf_limit_ready, memory_order_acquire) ==
+      0) {
+    sockbuf_limits_load(); /* racing loaders store the same values */
+  }
+  lim->auto_max =
+      atomic_load_explicit(&g_sockbuf_limit[rx][0], memory_order_relaxed);
+  lim->set_max =
+      atomic_load_explicit(&g_sockbuf_limit[rx][1], memory_order_relaxed);
+
+  /*
+   * Who owns the buffer today: SO_RCVBUF is always set on data sockets
+   * (FTP_TCP_RCVBUF, before connect/listen); SO_SNDBUF only on consoles
+   * (pal_socket_configure_data), elsewhere the kernel autotunes it.
+   */
+  if (rx != 0) {
+    lim->kernel_auto = 0;
+  } else {
+#if (defined(PS5) || defined(PLATFORM_PS5) || defined(PS4) ||                  \
+     defined(PLATFORM_PS4)) &&                                                 \
+    defined(FTP_TCP_DATA_SNDBUF) && (FTP_TCP_DATA_SNDBUF > 0U)
+    lim->kernel_auto = 0;
+#else
+    lim->kernel_auto = 1;
+#endif
+  }
+}
+
+uint32_t pal_sock_tune_target(const pal_tcp_info_t *info, uint64_t rate_bps,
+                              uint32_t retrans, uint32_t cur,
+                              const pal_sock_limits_t *lim) {
+  if ((info == NULL) || (lim == NULL) || (info->rtt_us == 0U)) {
+    return 0U;
+  }
+
+  /* Losses: the path, not the buffer, is the limit — hold */
+  if (retrans != 0U) {
+    return 0U;
+  }
+
+  uint64_t bdp = (rate_bps * (uint64_t)info->rtt_us) / 1000000ULL;
+  if ((uint64_t)info->inflight_bytes > bdp) {
+    bdp = info->inflight_bytes;
+  }
+  uint64_t need = 2U * bdp;
+
+  uint64_t cap = (uint64_t)FTP_SOCK_TUNE_MAX_BUF;
+  if ((lim->set_max != 0U) && ((uint64_t)lim->set_max < cap)) {
+    cap = lim->set_max;
+  }
+  if (need > cap) {
+    need = cap;
+  }
+
+  /* Less than 25% more is not worth a setsockopt() */
+  if ((need * 4U) <= ((uint64_t)cur * 5U)) {
+    return 0U;
+  }
+
+  /*
+   * An explicit size switches kernel autotuning off for good, so only
+   * take over once the kernel could not get there by itself.
+   */
+  if ((lim->kernel_auto != 0) &&
+      ((lim->auto_max == 0U) || (need <= (uint64_t)lim->auto_max))) {
+    return 0U;
+  }
+
+  return (uint32_t)need;
+}
+
+void pal_sock_tune_begin(pal_sock_tune_t *t, int fd, int rx,
+                         uint64_t bytes, uint64_t now_ns) {
+  if (t == NULL) {
+    return;
+  }
+  memset(t, 0, sizeof(*t));
+  t->fd = fd;
+  t->rx = (rx != 0) ? 1 : 0;
+  t->last_ns = now_ns;
+  t->last_bytes = bytes;
+  t->next_ns = now_ns + ((uint64_t)FTP_SOCK_TUNE_INTERVAL_MS * 1000000ULL);
+  sockbuf_limits(t->rx, &t->lim);
+  if ((fd < 0) || (pal_socket_tcp_info(fd, &t->info) != 0)) {
+    t->fd = -1; /* nothing to sample on this platform */
+    return;
+  }
+  t->buf = (t->rx != 0) ? t->info.rcvbuf : t->info.sndbuf;
+}
+
+int pal_sock_tune_tick(pal_sock_tune_t *t, uint64_t bytes, uint64_t now_ns) {
+#if FTP_SOCK_TUNE
+  if ((t == NULL) || (t->fd < 0) || (now_ns < t->next_ns)) {
+    return 0;
+  }
+  t->next_ns = now_ns + ((uint64_t)FTP_SOCK_TUNE_INTERVAL_MS * 1000000ULL);
+
+  pal_tcp_info_t info;
+  if (pal_socket_tcp_info(t->fd, &info) != 0) {
+    t->fd = -1; /* closed under us, or TCP_INFO went away */
+    return 0;
+  }
+
+  uint64_t us = (now_ns - t->last_ns) / 1000U;
+  uint64_t moved = (bytes > t->last_bytes) ? (bytes - t->last_bytes) : 0U;
+  t->rate_bps = (us > 0U) ? ((moved * 1000000ULL) / us) : 0U;
+  t->retrans_delta =
+      (info.retrans > t->info.retrans) ? (info.retrans - t->info.retrans) : 0U;
+  t->info = info;
+  t->last_ns = now_ns;
+  t->last_bytes = bytes;
+  t->buf = (t->rx != 0) ? info.rcvbuf : info.sndbuf;
+
+  uint32_t want =
+      pal_sock_tune_target(&info, t->rate_bps, t->retrans_delta, t->buf,
+                           &t->lim);
+  if (want == 0U) {
+    return 1;
+  }
+
+  int opt = (t->rx != 0) ? SO_RCVBUF : SO_SNDBUF;
+  int v = (int)(want / SOCKBUF_REPORT_SCALE);
+  if (PAL_SETSOCKOPT(t->fd, SOL_SOCKET, opt, &v, sizeof(v)) != 0) {
+    t->lim.set_max = t->buf; /* refused (FreeBSD: past sb_max) */
+    return 1;
+  }
+  t->lim.kernel_auto = 0; /* ours now */
+
+  uint32_t got = sockopt_u32(t->fd, SOL_SOCKET, opt);
+  if (got < want) {
+    t->lim.set_max = got; /* clamped: do not ask again */
+  }
+  if (got > t->buf) {
+    char line[160];
+    (void)snprintf(line, sizeof(line),
+                   "[TUNE] fd=%d %s %u -> %u (rtt=%uus rate=%lluB/s "
+                   "inflight=%u)",
+                   t->fd, (t->rx != 0) ? "rcvbuf" : "sndbuf", t->buf, got,
+                   info.rtt_us, (unsigned long long)t->rate_bps,
+                   info.inflight_bytes);
+    ftp_log_line(FTP_LOG_INFO, line);
+    t->resizes++;
+    t->buf = got;
+  }
+  return 1;
+#else
+  (void)t;
+  (void)bytes;
+  (void)now_ns;
+  return 0;
+#endif
+}
+
+/*===========================================================================*
+ * MSG_ZEROCOPY
+ *===========================================================================*/
+
+#if FTP_ZEROCOPY && defined(__linux__) && defined(SO_ZEROCOPY) &&            \
+    defined(MSG_ZEROCOPY)
+#define PAL_ZC_AVAILABLE 1
+#include <linux/errqueue.h>
+#include <poll.h>
+#else
+#define PAL_ZC_AVAILABLE 0
+#endif
+
+/* a at or after b, modulo 2^32 */
+static int zc_seq_ge(uint32_t a, uint32_t b) {
+  return ((uint32_t)(a - b) < 0x80000000U) ? 1 : 0;
+}
+
+void pal_zc_begin(pal_zc_t *zc, int fd) {
+  if (zc == NULL) {
+    return;
+  }
+  memset(zc, 0, sizeof(*zc));
+  zc->fd = -1;
+#if PAL_ZC_AVAILABLE
+  int one = 1;
+  if ((fd >= 0) &&
+      (PAL_SETSOCKOPT(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0)) {
+    zc->fd = fd;
+  }
+#else
+  (void)fd;
+#endif
+}
+
+int pal_zc_usable(const pal_zc_t *zc) {
+  return ((zc != NULL) && (zc->fd >= 0) && (zc->copied == 0U) &&
+          (zc->parked < FTP_ZEROCOPY_INFLIGHT))
+             ? 1
+             : 0;
+}
+
+ssize_t pal_zc_send(pal_zc_t *zc, const void *buf, size_t len, void *owner,
+                    int *parked) {
+  if (parked != NULL) {
+    *parked = 0;
+  }
+  if ((zc == NULL) || (pal_zc_usable(zc) == 0)) {
+    errno = EINVAL;
+    return -1;
+  }
+#if PAL_ZC_AVAILABLE
+  if ((buf == NULL) || (len == 0U)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  const uint8_t *p = (const uint8_t *)buf;
+  size_t total = 0U;
+  int used = 0;
+  int zc_ok = 1;
+  ssize_t ret = 0;
+
+  while (total < len) {
+    /* Sequence numbers past the window go out copied (see header) */
+    int flags = 0;
+    if ((zc_ok != 0) &&
+        ((uint32_t)(zc->next_seq - zc->done_seq) < PAL_ZC_WINDOW)) {
+      flags = MSG_ZEROCOPY;
+    }
+    ssize_t n = PAL_SEND(zc->fd, p + total, len - total, flags);
+    if (n > 0) {
+      if (flags != 0) {
+        zc->next_seq++;
+        zc->bytes += (uint64_t)n;
+        used = 1;
+      }
+      total += (size_t)n;
+      continue;
+    }
+    if (n == 0) {
+      errno = EPIPE;
+      ret = -1;
+      break;
+    }
+    if (errno == EINTR) {
+      continue;
+    }
+    if ((errno == ENOBUFS) && (flags != 0)) {
+      zc_ok = 0; /* optmem_max reached: finish this buffer copied */
+      continue;
+    }
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+      usleep(1000);
+      continue;
+    }
+    ret = -1;
+    break;
+  }
+
+  if (used != 0) {
+    int saved = errno;
+    zc->owner[zc->parked] = owner;
+    zc->owner_end[zc->parked] = zc->next_seq;
+    zc->parked++;
+    if (parked != NULL) {
+      *parked = 1;
+    }
+    errno = saved;
+  }
+  return (ret < 0) ? -1 : (ssize_t)total;
+#else
+  (void)buf;
+  (void)len;
+  (void)owner;
+  errno = EOPNOTSUPP;
+  return -1;
+#endif
+}
+
+#if PAL_ZC_AVAILABLE
+/* Fold one completed range [lo, hi] into done_seq / done_mask */
+static void zc_complete(pal_zc_t *zc, uint32_t lo, uint32_t hi) {
+  for (uint32_t s = lo;; s++) {
+    uint32_t off = s - zc->done_seq;
+    if (off < PAL_ZC_WINDOW) {
+      zc->done_mask |= (1ULL << off);
+    }
+    if (s == hi) {
+      break;
+    }
+  }
+  while ((zc->done_mask & 1ULL) != 0ULL) {
+    zc->done_mask >>= 1;
+    zc->done_seq++;
+  }
+}
+
+/* Drain the error queue without blocking */
+static void zc_read_errqueue(pal_zc_t *zc) {
+  for (;;) {
+    char control[128];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    if (recvmsg(zc->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return; /* EAGAIN: queue empty */
+    }
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+         cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!(((cm->cmsg_level == SOL_IP) && (cm->cmsg_type == IP_RECVERR)) ||
+            ((cm->cmsg_level == SOL_IPV6) &&
+             (cm->cmsg_type == IPV6_RECVERR)))) {
+        continue;
+      }
+      struct sock_extended_err ee;
+      memcpy(&ee, CMSG_DATA(cm), sizeof(ee));
+      if ((ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY) || (ee.ee_errno != 0U)) {
+        continue;
+      }
+      if ((ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0U) {
+        zc->copied++;
+      }
+      zc_complete(zc, ee.ee_info, ee.ee_data);
+    }
+  }
+}
+#endif
+
+/* Move owners whose sends all completed to out[] */
+static uint32_t zc_collect(pal_zc_t *zc, void **out, uint32_t max) {
+  uint32_t n = 0U;
+  uint32_t keep = 0U;
+  for (uint32_t i = 0U; i < zc->parked; i++) {
+    if ((n < max) && (zc_seq_ge(zc->done_seq, zc->owner_end[i]) != 0)) {
+      out[n++] = zc->owner[i];
+      continue;
+    }
+    zc->owner[keep] = zc->owner[i];
+    zc->owner_end[keep] = zc->owner_end[i];
+    keep++;
+  }
+  zc->parked = keep;
+  return n;
+}
+
+uint32_t pal_zc_reap(pal_zc_t *zc, uint32_t wait_ms, void **out,
+                     uint32_t max) {
+  if ((zc == NULL) || (out == NULL) || (zc->parked == 0U)) {
+    return 0U;
+  }
+#if PAL_ZC_AVAILABLE
+  zc_read_errqueue(zc);
+  uint32_t n = zc_collect(zc, out, max);
+  if ((n > 0U) || (wait_ms == 0U) || (max == 0U)) {
+    return n;
+  }
+
+  /* Notifications raise POLLERR; nothing else is asked for */
+  struct timespec ts;
+  (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+  int64_t deadline_ms =
+      ((int64_t)ts.tv_sec * 1000) + (ts.tv_nsec / 1000000) + wait_ms;
+  for (;;) {
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t left = deadline_ms - (((int64_t)ts.tv_sec * 1000) +
+                                  (ts.tv_nsec / 1000000));
+    if (left <= 0) {
+      return 0U;
+    }
+    struct pollfd pfd;
+    pfd.fd = zc->fd;
+    pfd.events = 0;
+    pfd.revents = 0;
+    int rc = poll(&pfd, 1, (int)left);
+    if ((rc < 0) && (errno != EINTR)) {
+      return 0U;
+    }
+    zc_read_errqueue(zc);
+    n = zc_collect(zc, out, max);
+    if (n > 0U) {
+      return n;
+    }
+    if ((rc > 0) && ((pfd.revents & POLLNVAL) != 0)) {
+      return 0U;
+    }
+    if ((rc > 0) && ((pfd.revents & POLLHUP) != 0)) {
+      usleep(1000); /* hung up: POLLHUP stays raised, do not spin */
+    }
+  }
+#else
+  (void)wait_ms;
+  (void)max;
+  return 0U;
+#endif
+}
+
+uint32_t pal_zc_end(pal_zc_t *zc, uint32_t wait_ms,
+                    void *out[FTP_ZEROCOPY_INFLIGHT]) {
+  if ((zc == NULL) || (out == NULL)) {
+    return 0U;
+  }
+  uint32_t n = 0U;
+  while (zc->parked > 0U) {
+    uint32_t got = pal_zc_reap(zc, wait_ms, out + n,
+                               FTP_ZEROCOPY_INFLIGHT - n);
+    if (got == 0U) {
+      break;
+    }
+    n += got;
+  }
+
+  if (zc->parked > 0U) {
+    /*
+     * Never acknowledged: reset on close so the kernel frees the queued
+     * segments (and their references to our pages) right away.
+     */
+    struct linger lg;
+    lg.l_onoff = 1;
+    lg.l_linger = 0;
+    (void)PAL_SETSOCKOPT(zc->fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+    zc->aborted = 1U;
+    for (uint32_t i = 0U; i < zc->parked; i++) {
+      out[n++] = zc->owner[i];
+    }
+    zc->parked = 0U;
+  }
+  zc->fd = -1;
+  return n;
+}
+
 /*===========================================================================*
  * UTILITY FUNCTIONS
  *===========================================================================*/
@@ -709,8 +1368,8 @@ ftp_error_t pal_network_get_primary_ip(char *buffer, size_t size) {
  *   - It is NOT a substitute for a full reboot; it only flushes buffer
  *     accounting within the current process lifetime.
  *
- * @param sessions  Pointer to the server's session pool array
- * @param count     Number of slots in the pool (FTP_MAX_SESSIONS)
+ * @param sessions  The server's session slot array (ctx->sessions)
+ * @param count     Number of allocated slots (ctx->session_slots)
  *
  * @return 0 on success, -1 on partial failure (sessions still reset)
  *
@@ -728,16 +1387,20 @@ ftp_error_t pal_network_get_primary_ip(char *buffer, size_t size) {
  * Addresses the progressive network degradation observed after transfers to
  * the internal SSD or M.2 on PS4/PS5 (Issues #3 and #7).
  */
-int pal_network_reset_ftp_stack(ftp_session_t *sessions, size_t count)
+int pal_network_reset_ftp_stack(ftp_session_t *const *sessions, size_t count)
 {
-    if ((sessions == NULL) || (count == 0U)) {
+    /* count == 0 is fine: no slot has been allocated yet */
+    if (sessions == NULL) {
         return -1;
     }
 
     int resets = 0;
 
     for (size_t i = 0U; i < count; i++) {
-        ftp_session_t *s = &sessions[i];
+        ftp_session_t *s = sessions[i];
+        if (s == NULL) {
+            continue;
+        }
         int state = atomic_load(&s->state);
 
         /*
@@ -789,7 +1452,11 @@ int pal_network_reset_ftp_stack(ftp_session_t *sessions, size_t count)
             s->data_fd = -1;
         }
         if ((s->pasv_fd >= 0) && (state != FTP_STATE_TRANSFERRING)) {
-            PAL_CLOSE(s->pasv_fd);
+            /* Pooled listeners go back to the pool, others are closed */
+            ftp_pasv_pool_return((s->server_ctx != NULL)
+                                     ? s->server_ctx->pasv_pool
+                                     : NULL,
+                                 s->pasv_fd);
             s->pasv_fd = -1;
         }
     }
@@ -0,0 +1,343 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file pal_ring.c
+ * @brief Platform Abstraction Layer - Adaptive SPSC buffer ring
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ * @date 2026-02-13
+ *
+ * WAKEUP PROTOCOL (no lost wakeups without locking the fast path)
+ *
+ *   sleeper:  lock → sleeping = 1 → re-check queue → wait → sleeping = 0
+ *   waker:    publish index → if (sleeping) { lock → signal → unlock }
+ *
+ *   Both the flag and the queue indices are sequentially consistent, so
+ *   either the waker sees sleeping == 1 (and signals under the lock the
+ *   sleeper is holding or waiting on), or the sleeper's re-check sees the
+ *   new index and never waits.
+ */
+#include "pal_ring.h"
+
+#include <string.h>
+
+#define RING_MASK (PAL_RING_MAX_SLOTS - 1U)
+
+_Static_assert((PAL_RING_MAX_SLOTS & (PAL_RING_MAX_SLOTS - 1U)) == 0U,
+               "PAL_RING_MAX_SLOTS must be a power of two");
+
+static void ring_wake(pal_ring_t *ring, pthread_cond_t *cv)
+{
+    pthread_mutex_lock(&ring->mtx);
+    pthread_cond_broadcast(cv);
+    pthread_mutex_unlock(&ring->mtx);
+}
+
+int pal_ring_init(pal_ring_t *ring, const pal_ring_config_t *cfg)
+{
+    if ((ring == NULL) || (cfg == NULL) || (cfg->alloc == NULL) ||
+        (cfg->release == NULL) || (cfg->slot_size == 0U) ||
+        (cfg->initial_depth < 2U) || (cfg->max_depth < cfg->initial_depth) ||
+        (cfg->max_depth > PAL_RING_MAX_SLOTS)) {
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->cfg = *cfg;
+    if (ring->cfg.grow_after == 0U) {
+        ring->cfg.grow_after = 1U;
+    }
+    atomic_init(&ring->full_head, 0U);
+    atomic_init(&ring->full_tail, 0U);
+    atomic_init(&ring->free_head, 0U);
+    atomic_init(&ring->free_tail, 0U);
+    atomic_init(&ring->closed, 0);
+    atomic_init(&ring->aborted, 0);
+    atomic_init(&ring->error, 0);
+    atomic_init(&ring->prod_sleeping, 0);
+    atomic_init(&ring->cons_sleeping, 0);
+    atomic_init(&ring->peak_depth, 0U);
+
+    for (unsigned i = 0U; i < cfg->initial_depth; i++) {
+        void *b = cfg->alloc(cfg->ctx);
+        if (b == NULL) {
+            break;
+        }
+        ring->owned[ring->depth] = b;
+        ring->free_q[ring->depth] = b;
+        ring->depth++;
+    }
+    if (ring->depth < 2U) {
+        for (unsigned i = 0U; i < ring->depth; i++) {
+            cfg->release(ring->owned[i], cfg->ctx);
+        }
+        ring->depth = 0U;
+        return -1;
+    }
+    atomic_store(&ring->free_head, ring->depth);
+    atomic_store(&ring->peak_depth, ring->depth);
+
+    pthread_mutex_init(&ring->mtx, NULL);
+    pthread_cond_init(&ring->cv_prod, NULL);
+    pthread_cond_init(&ring->cv_cons, NULL);
+    return 0;
+}
+
+void pal_ring_destroy(pal_ring_t *ring)
+{
+    if ((ring == NULL) || (ring->depth == 0U)) {
+        return;
+    }
+    for (unsigned i = 0U; i < ring->depth; i++) {
+        ring->cfg.release(ring->owned[i], ring->cfg.ctx);
+        ring->owned[i] = NULL;
+    }
+    ring->depth = 0U;
+    pthread_mutex_destroy(&ring->mtx);
+    pthread_cond_destroy(&ring->cv_prod);
+    pthread_cond_destroy(&ring->cv_cons);
+}
+
+/*===========================================================================*
+ * PRODUCER
+ *===========================================================================*/
+
+static void *ring_pop_free(pal_ring_t *ring)
+{
+    unsigned t = atomic_load(&ring->free_tail);
+    if (t == atomic_load(&ring->free_head)) {
+        return NULL;
+    }
+    void *b = ring->free_q[t & RING_MASK];
+    atomic_store(&ring->free_tail, t + 1U);
+    return b;
+}
+
+void *pal_ring_acquire(pal_ring_t *ring)
+{
+    if (ring->spare != NULL) {
+        void *b = ring->spare;
+        ring->spare = NULL;
+        return b;
+    }
+
+    int waited = 0;
+    for (;;) {
+        if (atomic_load(&ring->aborted) != 0) {
+            return NULL;
+        }
+
+        void *b = ring_pop_free(ring);
+        if (b != NULL) {
+            ring->stall_streak = (waited != 0) ? (ring->stall_streak + 1U) : 0U;
+            return b;
+        }
+
+        /*
+         * Consumer is lagging.  After a sustained stall, add a buffer
+         * instead of sleeping so the producer keeps draining the socket.
+         */
+        if ((ring->stall_streak >= ring->cfg.grow_after) &&
+            (ring->depth < ring->cfg.max_depth)) {
+            b = ring->cfg.alloc(ring->cfg.ctx);
+            if (b != NULL) {
+                ring->owned[ring->depth] = b;
+                ring->depth++;
+                atomic_store(&ring->peak_depth, ring->depth);
+                ring->stall_streak = 0U;
+                return b;
+            }
+            ring->cfg.max_depth = ring->depth; /* allocator dry: stop trying */
+        }
+
+        waited = 1;
+        pthread_mutex_lock(&ring->mtx);
+        atomic_store(&ring->prod_sleeping, 1);
+        while ((atomic_load(&ring->free_tail) == atomic_load(&ring->free_head)) &&
+               (atomic_load(&ring->aborted) == 0)) {
+            pthread_cond_wait(&ring->cv_prod, &ring->mtx);
+        }
+        atomic_store(&ring->prod_sleeping, 0);
+        pthread_mutex_unlock(&ring->mtx);
+    }
+}
+
+void *pal_ring_try_acquire(pal_ring_t *ring)
+{
+    if (ring->spare != NULL) {
+        void *b = ring->spare;
+        ring->spare = NULL;
+        return b;
+    }
+    if (atomic_load(&ring->aborted) != 0) {
+        return NULL;
+    }
+
+    void *b = ring_pop_free(ring);
+    if (b != NULL) {
+        return b;
+    }
+
+    ring->stall_streak++;
+    if ((ring->stall_streak >= ring->cfg.grow_after) &&
+        (ring->depth < ring->cfg.max_depth)) {
+        b = ring->cfg.alloc(ring->cfg.ctx);
+        if (b != NULL) {
+            ring->owned[ring->depth] = b;
+            ring->depth++;
+            atomic_store(&ring->peak_depth, ring->depth);
+            ring->stall_streak = 0U;
+            return b;
+        }
+        ring->cfg.max_depth = ring->depth;
+    }
+    return NULL;
+}
+
+void pal_ring_commit(pal_ring_t *ring, void *buf, size_t len)
+{
+    unsigned h = atomic_load(&ring->full_head);
+    ring->full[h & RING_MASK].buf = buf;
+    ring->full[h & RING_MASK].len = len;
+    atomic_store(&ring->full_head, h + 1U);
+    if (atomic_load(&ring->cons_sleeping) != 0) {
+        ring_wake(ring, &ring->cv_cons);
+    }
+}
+
+void pal_ring_unacquire(pal_ring_t *ring, void *buf)
+{
+    ring->spare = buf;
+}
+
+void pal_ring_close(pal_ring_t *ring)
+{
+    atomic_store(&ring->closed, 1);
+    ring_wake(ring, &ring->cv_cons);
+}
+
+/*===========================================================================*
+ * CONSUMER
+ *===========================================================================*/
+
+void *pal_ring_peek(pal_ring_t *ring, size_t *len)
+{
+    for (;;) {
+        if (atomic_load(&ring->aborted) != 0) {
+            return NULL;
+        }
+
+        unsigned t = atomic_load(&ring->full_tail);
+        if (t != atomic_load(&ring->full_head)) {
+            pal_ring_entry_t e = ring->full[t & RING_MASK];
+            atomic_store(&ring->full_tail, t + 1U);
+            if (len != NULL) {
+                *len = e.len;
+            }
+            return e.buf;
+        }
+
+        /* closed is stored after the last commit: empty + closed = EOF */
+        if (atomic_load(&ring->closed) != 0) {
+            if (t == atomic_load(&ring->full_head)) {
+                return NULL;
+            }
+            continue;
+        }
+
+        pthread_mutex_lock(&ring->mtx);
+        atomic_store(&ring->cons_sleeping, 1);
+        while ((atomic_load(&ring->full_tail) == atomic_load(&ring->full_head)) &&
+               (atomic_load(&ring->closed) == 0) &&
+               (atomic_load(&ring->aborted) == 0)) {
+            pthread_cond_wait(&ring->cv_cons, &ring->mtx);
+        }
+        atomic_store(&ring->cons_sleeping, 0);
+        pthread_mutex_unlock(&ring->mtx);
+    }
+}
+
+int pal_ring_try_peek(pal_ring_t *ring, void **buf, size_t *len)
+{
+    if (atomic_load(&ring->aborted) != 0) {
+        return -1;
+    }
+    /* Read closed first: a commit that precedes it is then visible below */
+    int closed = atomic_load(&ring->closed);
+    unsigned t = atomic_load(&ring->full_tail);
+    if (t != atomic_load(&ring->full_head)) {
+        pal_ring_entry_t e = ring->full[t & RING_MASK];
+        atomic_store(&ring->full_tail, t + 1U);
+        *buf = e.buf;
+        if (len != NULL) {
+            *len = e.len;
+        }
+        return 1;
+    }
+    return (closed != 0) ? -1 : 0;
+}
+
+int pal_ring_pending(pal_ring_t *ring)
+{
+    return (atomic_load(&ring->full_tail) != atomic_load(&ring->full_head)) ||
+           (atomic_load(&ring->closed) != 0) ||
+           (atomic_load(&ring->aborted) != 0);
+}
+
+void pal_ring_consume(pal_ring_t *ring, void *buf)
+{
+    unsigned h = atomic_load(&ring->free_head);
+    ring->free_q[h & RING_MASK] = buf;
+    atomic_store(&ring->free_head, h + 1U);
+    if (atomic_load(&ring->prod_sleeping) != 0) {
+        ring_wake(ring, &ring->cv_prod);
+    }
+}
+
+/*===========================================================================*
+ * EITHER SIDE
+ *===========================================================================*/
+
+void pal_ring_abort(pal_ring_t *ring, int err)
+{
+    int expected = 0;
+    (void)atomic_compare_exchange_strong(&ring->error, &expected, err);
+    atomic_store(&ring->aborted, 1);
+    pthread_mutex_lock(&ring->mtx);
+    pthread_cond_broadcast(&ring->cv_prod);
+    pthread_cond_broadcast(&ring->cv_cons);
+    pthread_mutex_unlock(&ring->mtx);
+}
+
+int pal_ring_error(pal_ring_t *ring)
+{
+    return atomic_load(&ring->error);
+}
+
+unsigned pal_ring_peak_depth(pal_ring_t *ring)
+{
+    return atomic_load(&ring->peak_depth);
+}
@@ -30,31 +30,106 @@ SOFTWARE.
  * @version 1.0.0
  * @date 2026-02-13
  * 
+ * Slots are static and claimed through one busy bitmask; each is
+ * prefaulted the first time it is used.  Thread arenas are malloc'd on
+ * a thread's first pal_scratch_alloc() and freed by a pthread key
+ * destructor.  Allocations that do not fit the arena are malloc'd and
+ * chained on it (newest first), so pal_scratch_reset() can free the
+ * ones made after the mark.
  */
 #include "pal_scratch.h"
 
+#include <pthread.h>
 #include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
 
-#ifndef PAL_SCRATCH_SIZE
-#define PAL_SCRATCH_SIZE (1024U * 1024U)
-#endif
+#define SCRATCH_ALIGN 16U
 
-static _Alignas(4096) uint8_t g_scratch[PAL_SCRATCH_SIZE];
-static atomic_int g_scratch_busy = ATOMIC_VAR_INIT(0);
-static atomic_int g_scratch_prefaulted = ATOMIC_VAR_INIT(0);
+static _Alignas(4096) uint8_t g_scratch[PAL_SCRATCH_SLOTS][PAL_SCRATCH_SIZE];
+static atomic_uint g_scratch_busy = ATOMIC_VAR_INIT(0U);
+static atomic_uint g_scratch_prefaulted = ATOMIC_VAR_INIT(0U);
 
-static void pal_scratch_prefault_once(void)
+static atomic_uint_fast64_t g_slot_acquires;
+static atomic_uint_fast64_t g_slot_busy;
+static atomic_uint_fast64_t g_arena_allocs;
+static atomic_uint_fast64_t g_fallbacks;
+static atomic_uint_fast64_t g_fallback_bytes;
+static atomic_uint g_arenas;
+
+typedef struct scratch_spill {
+    struct scratch_spill *next;
+    _Alignas(SCRATCH_ALIGN) uint8_t data[];
+} scratch_spill_t;
+
+typedef struct {
+    size_t used;
+    scratch_spill_t *spill;
+    _Alignas(SCRATCH_ALIGN) uint8_t data[];
+} scratch_arena_t;
+
+static pthread_once_t g_arena_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_arena_key;
+static int g_arena_key_ok = 0;
+static _Thread_local scratch_arena_t *t_arena = NULL;
+
+static void pal_scratch_prefault_once(unsigned slot)
 {
-    int expected = 0;
-    if (!atomic_compare_exchange_strong(&g_scratch_prefaulted, &expected, 1)) {
+    unsigned bit = 1U << slot;
+    if ((atomic_fetch_or(&g_scratch_prefaulted, bit) & bit) != 0U) {
         return;
     }
 
+    uint8_t *base = g_scratch[slot];
     for (size_t i = 0U; i < (size_t)PAL_SCRATCH_SIZE; i += 4096U) {
-        g_scratch[i] = 0U;
+        base[i] = 0U;
+    }
+    base[PAL_SCRATCH_SIZE - 1U] = 0U;
+}
+
+/* Claim a free slot; -1 when all are taken */
+static int slot_take(void)
+{
+    unsigned busy = atomic_load(&g_scratch_busy);
+    for (;;) {
+        unsigned slot = 0U;
+        while ((slot < PAL_SCRATCH_SLOTS) && ((busy & (1U << slot)) != 0U)) {
+            slot++;
+        }
+        if (slot == PAL_SCRATCH_SLOTS) {
+            atomic_fetch_add_explicit(&g_slot_busy, 1U, memory_order_relaxed);
+            return -1;
+        }
+        if (atomic_compare_exchange_weak(&g_scratch_busy, &busy, busy | (1U << slot))) {
+            atomic_fetch_add_explicit(&g_slot_acquires, 1U, memory_order_relaxed);
+            pal_scratch_prefault_once(slot);
+            return (int)slot;
+        }
+    }
+}
+
+/* Slot index of @p ptr, or -1 if it is not a slot base */
+static int slot_of(const void *ptr)
+{
+    const uint8_t *p = (const uint8_t *)ptr;
+    if ((p < g_scratch[0]) || (p >= g_scratch[0] + sizeof(g_scratch))) {
+        return -1;
+    }
+    size_t off = (size_t)(p - g_scratch[0]);
+    if ((off % (size_t)PAL_SCRATCH_SIZE) != 0U) {
+        return -1;
     }
-    g_scratch[PAL_SCRATCH_SIZE - 1U] = 0U;
+    return (int)(off / (size_t)PAL_SCRATCH_SIZE);
+}
+
+static void *heap_fallback(size_t size)
+{
+    void *p = malloc(size);
+    if (p != NULL) {
+        atomic_fetch_add_explicit(&g_fallbacks, 1U, memory_order_relaxed);
+        atomic_fetch_add_explicit(&g_fallback_bytes, (uint64_t)size, memory_order_relaxed);
+    }
+    return p;
 }
 
 int pal_scratch_acquire(uint8_t **out, size_t need)
@@ -68,27 +143,174 @@ int pal_scratch_acquire(uint8_t **out, size_t need)
         return -1;
     }
 
-    pal_scratch_prefault_once();
-
-    int expected = 0;
-    if (!atomic_compare_exchange_strong(&g_scratch_busy, &expected, 1)) {
+    int slot = slot_take();
+    if (slot < 0) {
         return -1;
     }
 
-    memset(g_scratch, 0, need);
-    *out = g_scratch;
+    memset(g_scratch[slot], 0, need);
+    *out = g_scratch[slot];
     return 0;
 }
 
 void pal_scratch_release(uint8_t *ptr)
 {
-    if (ptr != g_scratch) {
+    int slot = slot_of(ptr);
+    if (slot < 0) {
         return;
     }
-    atomic_store(&g_scratch_busy, 0);
+    atomic_fetch_and(&g_scratch_busy, ~(1U << (unsigned)slot));
 }
 
 size_t pal_scratch_capacity(void)
 {
     return (size_t)PAL_SCRATCH_SIZE;
 }
+
+void *pal_scratch_get(size_t need)
+{
+    if (need == 0U) {
+        return NULL;
+    }
+    if (need <= (size_t)PAL_SCRATCH_SIZE) {
+        int slot = slot_take();
+        if (slot >= 0) {
+            return g_scratch[slot];
+        }
+    }
+    return heap_fallback(need);
+}
+
+void pal_scratch_put(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+    if (slot_of(ptr) >= 0) {
+        pal_scratch_release((uint8_t *)ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+/*===========================================================================*
+ * THREAD ARENAS
+ *===========================================================================*/
+
+static void spill_free_to(scratch_arena_t *arena, const scratch_spill_t *stop)
+{
+    while ((arena->spill != NULL) && (arena->spill != stop)) {
+        scratch_spill_t *s = arena->spill;
+        arena->spill = s->next;
+        free(s);
+    }
+}
+
+static void arena_release(void *arg)
+{
+    scratch_arena_t *arena = (scratch_arena_t *)arg;
+    if (arena == NULL) {
+        return;
+    }
+    spill_free_to(arena, NULL);
+    free(arena);
+    atomic_fetch_sub(&g_arenas, 1U);
+}
+
+static void arena_init(void)
+{
+    g_arena_key_ok = (pthread_key_create(&g_arena_key, arena_release) == 0) ? 1 : 0;
+}
+
+static scratch_arena_t *arena_get(void)
+{
+    if (t_arena != NULL) {
+        return t_arena;
+    }
+    (void)pthread_once(&g_arena_once, arena_init);
+    if (g_arena_key_ok == 0) {
+        return NULL;
+    }
+
+    scratch_arena_t *arena = malloc(sizeof(*arena) + (size_t)PAL_SCRATCH_ARENA_SIZE);
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->used = 0U;
+    arena->spill = NULL;
+    if (pthread_setspecific(g_arena_key, arena) != 0) {
+        free(arena);
+        return NULL;
+    }
+    atomic_fetch_add(&g_arenas, 1U);
+    t_arena = arena;
+    return arena;
+}
+
+pal_scratch_mark_t pal_scratch_mark(void)
+{
+    pal_scratch_mark_t mark = {0U, NULL};
+    scratch_arena_t *arena = t_arena;
+    if (arena != NULL) {
+        mark.used = arena->used;
+        mark.spill = arena->spill;
+    }
+    return mark;
+}
+
+void *pal_scratch_alloc(size_t size)
+{
+    if ((size == 0U) || (size > (SIZE_MAX - sizeof(scratch_spill_t) - SCRATCH_ALIGN))) {
+        return NULL;
+    }
+    scratch_arena_t *arena = arena_get();
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    size_t n = (size + (SCRATCH_ALIGN - 1U)) & ~(size_t)(SCRATCH_ALIGN - 1U);
+    if (n <= ((size_t)PAL_SCRATCH_ARENA_SIZE - arena->used)) {
+        void *p = arena->data + arena->used;
+        arena->used += n;
+        atomic_fetch_add_explicit(&g_arena_allocs, 1U, memory_order_relaxed);
+        return p;
+    }
+
+    scratch_spill_t *s = heap_fallback(sizeof(*s) + size);
+    if (s == NULL) {
+        return NULL;
+    }
+    s->next = arena->spill;
+    arena->spill = s;
+    return s->data;
+}
+
+void pal_scratch_reset(pal_scratch_mark_t mark)
+{
+    scratch_arena_t *arena = t_arena;
+    if (arena == NULL) {
+        return;
+    }
+    spill_free_to(arena, (const scratch_spill_t *)mark.spill);
+    if (mark.used <= arena->used) {
+        arena->used = mark.used;
+    }
+}
+
+void pal_scratch_get_stats(pal_scratch_stats_t *out)
+{
+    if (out == NULL) {
+        return;
+    }
+    out->slot_acquires = atomic_load_explicit(&g_slot_acquires, memory_order_relaxed);
+    out->slot_busy = atomic_load_explicit(&g_slot_busy, memory_order_relaxed);
+    out->arena_allocs = atomic_load_explicit(&g_arena_allocs, memory_order_relaxed);
+    out->fallbacks = atomic_load_explicit(&g_fallbacks, memory_order_relaxed);
+    out->fallback_bytes = atomic_load_explicit(&g_fallback_bytes, memory_order_relaxed);
+    unsigned busy = atomic_load(&g_scratch_busy);
+    out->slots_in_use = 0U;
+    for (; busy != 0U; busy &= busy - 1U) {
+        out->slots_in_use++;
+    }
+    out->arenas = (uint32_t)atomic_load(&g_arenas);
+}
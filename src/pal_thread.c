@@ -0,0 +1,423 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file pal_thread.c
+ * @brief Platform Abstraction Layer - Thread roles and placement
+ *
+ * @author SeregonWar
+ * @version 1.0.0
+ *
+ * The table is tiny and read once per thread start, so one mutex guards
+ * it; the trampoline gets its own copy of the placement and never looks
+ * at the table again.
+ */
+#include "pal_thread.h"
+#include "ftp_log.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PAL_THREAD_AFFINITY 1
+#elif defined(__FreeBSD__) && !defined(PS4) && !defined(PLATFORM_PS4)
+#include <pthread_np.h>
+#include <sys/cpuset.h>
+#define PAL_THREAD_AFFINITY 1
+#else
+#define PAL_THREAD_AFFINITY 0
+#endif
+
+#define CPU_WORDS (PAL_THREAD_CPUS_MAX / 64U)
+
+static const char *const k_role_name[PAL_THREAD_ROLES] = {
+    "accept", "control", "data", "disk", "http", "background",
+};
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pal_thread_place_t g_place[PAL_THREAD_ROLES];
+
+static _Atomic uint64_t g_started[PAL_THREAD_ROLES];
+static _Atomic uint64_t g_placed;
+static _Atomic uint64_t g_refused;
+static atomic_int g_refusal_logged;
+
+typedef struct {
+  void *(*fn)(void *);
+  void *arg;
+  pal_thread_role_t role;
+  pal_thread_place_t place;
+} trampoline_t;
+
+/*===========================================================================*
+ * SPEC PARSING
+ *===========================================================================*/
+
+static int place_empty(const pal_thread_place_t *p) {
+  if (p->has_nice != 0) {
+    return 0;
+  }
+  for (size_t i = 0U; i < CPU_WORDS; i++) {
+    if (p->cpus[i] != 0U) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static int parse_uint(const char **s, const char *end, unsigned *out) {
+  const char *p = *s;
+  unsigned v = 0U;
+  if ((p >= end) || (*p < '0') || (*p > '9')) {
+    return -1;
+  }
+  while ((p < end) && (*p >= '0') && (*p <= '9')) {
+    v = (v * 10U) + (unsigned)(*p - '0');
+    if (v >= PAL_THREAD_CPUS_MAX) {
+      return -1;
+    }
+    p++;
+  }
+  *s = p;
+  *out = v;
+  return 0;
+}
+
+/* "0-3,6" in [s, end) */
+static int parse_cpus(const char *s, const char *end, uint64_t *cpus) {
+  while (s < end) {
+    unsigned lo = 0U;
+    unsigned hi = 0U;
+    if (parse_uint(&s, end, &lo) != 0) {
+      return -1;
+    }
+    hi = lo;
+    if ((s < end) && (*s == '-')) {
+      s++;
+      if ((parse_uint(&s, end, &hi) != 0) || (hi < lo)) {
+        return -1;
+      }
+    }
+    for (unsigned c = lo; c <= hi; c++) {
+      cpus[c / 64U] |= (1ULL << (c % 64U));
+    }
+    if (s < end) {
+      if (*s != ',') {
+        return -1;
+      }
+      s++;
+      if (s == end) {
+        return -1; /* trailing comma */
+      }
+    }
+  }
+  return 0;
+}
+
+/* "-20".."19" in [s, end) */
+static int parse_nice(const char *s, const char *end, int *out) {
+  int neg = 0;
+  if ((s < end) && ((*s == '-') || (*s == '+'))) {
+    neg = (*s == '-') ? 1 : 0;
+    s++;
+  }
+  unsigned v = 0U;
+  if ((parse_uint(&s, end, &v) != 0) || (s != end)) {
+    return -1;
+  }
+  int n = (neg != 0) ? -(int)v : (int)v;
+  if ((n < -20) || (n > 19)) {
+    return -1;
+  }
+  *out = n;
+  return 0;
+}
+
+/* One "role=CPUS/NICE" entry in [s, end) */
+static int parse_entry(const char *s, const char *end,
+                       pal_thread_place_t table[PAL_THREAD_ROLES]) {
+  const char *eq = memchr(s, '=', (size_t)(end - s));
+  if (eq == NULL) {
+    return -1;
+  }
+  int role = -1;
+  for (int r = 0; r < (int)PAL_THREAD_ROLES; r++) {
+    size_t n = strlen(k_role_name[r]);
+    if (((size_t)(eq - s) == n) && (memcmp(s, k_role_name[r], n) == 0)) {
+      role = r;
+      break;
+    }
+  }
+  if (role < 0) {
+    return -1;
+  }
+
+  pal_thread_place_t p;
+  memset(&p, 0, sizeof(p));
+  const char *cpus = eq + 1;
+  const char *slash = memchr(cpus, '/', (size_t)(end - cpus));
+  const char *cpus_end = (slash != NULL) ? slash : end;
+  if (parse_cpus(cpus, cpus_end, p.cpus) != 0) {
+    return -1;
+  }
+  if (slash != NULL) {
+    if (parse_nice(slash + 1, end, &p.nice) != 0) {
+      return -1;
+    }
+    p.has_nice = 1;
+  }
+  if (place_empty(&p) != 0) {
+    return -1; /* "data=" says nothing */
+  }
+  table[role] = p;
+  return 0;
+}
+
+int pal_thread_config(const char *spec) {
+  pal_thread_place_t table[PAL_THREAD_ROLES];
+  memset(table, 0, sizeof(table));
+
+  const char *s = (spec != NULL) ? spec : "";
+  while (*s != '\0') {
+    if ((*s == ' ') || (*s == ';') || (*s == '\t')) {
+      s++;
+      continue;
+    }
+    const char *end = s + strcspn(s, " ;\t");
+    if (parse_entry(s, end, table) != 0) {
+      return -1;
+    }
+    s = end;
+  }
+
+  pthread_mutex_lock(&g_lock);
+  memcpy(g_place, table, sizeof(g_place));
+  pthread_mutex_unlock(&g_lock);
+  return 0;
+}
+
+void pal_thread_get_place(pal_thread_role_t role, pal_thread_place_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  memset(out, 0, sizeof(*out));
+  if ((unsigned)role >= (unsigned)PAL_THREAD_ROLES) {
+    return;
+  }
+  pthread_mutex_lock(&g_lock);
+  *out = g_place[role];
+  pthread_mutex_unlock(&g_lock);
+}
+
+const char *pal_thread_role_name(pal_thread_role_t role) {
+  return ((unsigned)role < (unsigned)PAL_THREAD_ROLES) ? k_role_name[role]
+                                                        : NULL;
+}
+
+static int cpu_isset(const uint64_t *cpus, unsigned c) {
+  return ((cpus[c / 64U] >> (c % 64U)) & 1U) != 0U;
+}
+
+size_t pal_thread_describe(char *out, size_t size) {
+  if ((out == NULL) || (size == 0U)) {
+    return 0U;
+  }
+  pal_thread_place_t table[PAL_THREAD_ROLES];
+  pthread_mutex_lock(&g_lock);
+  memcpy(table, g_place, sizeof(table));
+  pthread_mutex_unlock(&g_lock);
+
+  char buf[1024];
+  size_t len = 0U;
+  buf[0] = '\0';
+  for (int r = 0; r < (int)PAL_THREAD_ROLES; r++) {
+    const pal_thread_place_t *p = &table[r];
+    if (place_empty(p) != 0) {
+      continue;
+    }
+    len += (size_t)snprintf(buf + len, sizeof(buf) - len, "%s%s=",
+                            (len > 0U) ? " " : "", k_role_name[r]);
+    int first = 1;
+    for (unsigned c = 0U; (c < PAL_THREAD_CPUS_MAX) && (len < sizeof(buf));
+         c++) {
+      if (cpu_isset(p->cpus, c) == 0) {
+        continue;
+      }
+      unsigned hi = c;
+      while (((hi + 1U) < PAL_THREAD_CPUS_MAX) &&
+             (cpu_isset(p->cpus, hi + 1U) != 0)) {
+        hi++;
+      }
+      if (hi == c) {
+        len += (size_t)snprintf(buf + len, sizeof(buf) - len, "%s%u",
+                                (first != 0) ? "" : ",", c);
+      } else {
+        len += (size_t)snprintf(buf + len, sizeof(buf) - len, "%s%u-%u",
+                                (first != 0) ? "" : ",", c, hi);
+      }
+      first = 0;
+      c = hi;
+    }
+    if ((p->has_nice != 0) && (len < sizeof(buf))) {
+      len += (size_t)snprintf(buf + len, sizeof(buf) - len, "/%d", p->nice);
+    }
+    if (len >= sizeof(buf)) {
+      len = sizeof(buf) - 1U;
+      break;
+    }
+  }
+  (void)snprintf(out, size, "%s", buf);
+  return strlen(out);
+}
+
+/*===========================================================================*
+ * PLACEMENT (runs on the new thread)
+ *===========================================================================*/
+
+/* 0, or the error that refused it */
+static int apply_affinity(const uint64_t *cpus) {
+  int any = 0;
+  for (size_t i = 0U; i < CPU_WORDS; i++) {
+    any |= (cpus[i] != 0U) ? 1 : 0;
+  }
+  if (any == 0) {
+    return 0;
+  }
+#if PAL_THREAD_AFFINITY
+#if defined(__linux__)
+  cpu_set_t set;
+#else
+  cpuset_t set;
+#endif
+  CPU_ZERO(&set);
+  for (unsigned c = 0U; c < PAL_THREAD_CPUS_MAX; c++) {
+    if ((cpu_isset(cpus, c) != 0) && (c < (unsigned)CPU_SETSIZE)) {
+      CPU_SET(c, &set);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+  return ENOTSUP;
+#endif
+}
+
+static int apply_nice(int nice) {
+#if defined(__linux__)
+  /* Linux nice values are per thread (task) */
+  pid_t tid = (pid_t)syscall(SYS_gettid);
+  return (setpriority(PRIO_PROCESS, (id_t)tid, nice) == 0) ? 0 : errno;
+#else
+  /* Shift within the policy's range: nice 19 lowers by about half of it */
+  int policy = 0;
+  struct sched_param sp;
+  int rc = pthread_getschedparam(pthread_self(), &policy, &sp);
+  if (rc != 0) {
+    return rc;
+  }
+  int lo = sched_get_priority_min(policy);
+  int hi = sched_get_priority_max(policy);
+  if ((lo < 0) || (hi <= lo)) {
+    return ENOTSUP;
+  }
+  int prio = sp.sched_priority - ((nice * (hi - lo)) / 40);
+  sp.sched_priority = (prio < lo) ? lo : ((prio > hi) ? hi : prio);
+  return pthread_setschedparam(pthread_self(), policy, &sp);
+#endif
+}
+
+static void *trampoline(void *raw) {
+  trampoline_t t = *(trampoline_t *)raw;
+  free(raw);
+
+  int refused = apply_affinity(t.place.cpus);
+  if (t.place.has_nice != 0) {
+    int rc = apply_nice(t.place.nice);
+    refused = (refused != 0) ? refused : rc;
+  }
+  if (refused == 0) {
+    atomic_fetch_add(&g_placed, 1U);
+  } else {
+    atomic_fetch_add(&g_refused, 1U);
+    if (atomic_exchange(&g_refusal_logged, 1) == 0) {
+      char line[128];
+      (void)snprintf(line, sizeof(line),
+                     "[THREAD] placement of a %s thread refused (%s)",
+                     k_role_name[t.role], strerror(refused));
+      ftp_log_line(FTP_LOG_WARN, line);
+    }
+  }
+  return t.fn(t.arg);
+}
+
+int pal_thread_create(pthread_t *tid, const pthread_attr_t *attr,
+                      pal_thread_role_t role, void *(*fn)(void *),
+                      void *arg) {
+  if ((tid == NULL) || (fn == NULL) ||
+      ((unsigned)role >= (unsigned)PAL_THREAD_ROLES)) {
+    return EINVAL;
+  }
+
+  pal_thread_place_t place;
+  pal_thread_get_place(role, &place);
+  trampoline_t *t = NULL;
+  if (place_empty(&place) == 0) {
+    t = malloc(sizeof(*t)); /* NULL: start unplaced rather than fail */
+  }
+
+  int rc;
+  if (t != NULL) {
+    t->fn = fn;
+    t->arg = arg;
+    t->role = role;
+    t->place = place;
+    rc = pthread_create(tid, attr, trampoline, t);
+    if (rc != 0) {
+      free(t);
+    }
+  } else {
+    rc = pthread_create(tid, attr, fn, arg);
+  }
+  if (rc == 0) {
+    atomic_fetch_add(&g_started[role], 1U);
+  }
+  return rc;
+}
+
+void pal_thread_get_stats(pal_thread_stats_t *out) {
+  if (out == NULL) {
+    return;
+  }
+  for (size_t r = 0U; r < PAL_THREAD_ROLES; r++) {
+    out->started[r] = atomic_load(&g_started[r]);
+  }
+  out->placed = atomic_load(&g_placed);
+  out->refused = atomic_load(&g_refused);
+}
@@ -0,0 +1,337 @@
+/*
+ * pal_tls_openssl.c — pal_tls.h on OpenSSL 3.x (Linux / FreeBSD hosts)
+ *
+ * Client (pal_tls_connect) and server (pal_tls_accept) sessions over a
+ * caller-owned blocking socket.
+ *
+ * ── Kernel TLS ───────────────────────────────────────────────────────────
+ * With SSL_OP_ENABLE_KTLS, OpenSSL installs the negotiated keys into the
+ * kernel (Linux TCP_ULP "tls" + TLS_TX/TLS_RX, FreeBSD TCP_TXTLS_ENABLE /
+ * TCP_RXTLS_ENABLE) right after the handshake, when the kernel supports
+ * the cipher.  From then on the kernel frames and encrypts records, so
+ * sendfile() on the raw fd produces valid TLS: encrypted RETR keeps the
+ * zero-copy path.  When offload is not possible OpenSSL stays in
+ * userspace and pal_tls_ktls_send() reports 0.
+ *
+ *   handshake (userspace) ──► keys ──► kernel ──► sendfile()/send() = TLS
+ *
+ * ── Timeouts ─────────────────────────────────────────────────────────────
+ * The fd keeps its SO_RCVTIMEO/SO_SNDTIMEO.  An expired timeout surfaces
+ * from OpenSSL as WANT_READ/WANT_WRITE and is reported as
+ * PAL_TLS_ERR_TIMEOUT.
+ */
+
+#include "pal_tls.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+struct pal_tls_session {
+    SSL     *ssl;
+    SSL_CTX *own_ctx;   /* client sessions own their context */
+    int      fd;
+    int      ktls_tx;
+    int      ktls_rx;
+};
+
+struct pal_tls_server {
+    SSL_CTX *ctx;
+};
+
+/* ── Global lifecycle ────────────────────────────────────────────────── */
+
+int pal_tls_global_init(void)
+{
+    if (OPENSSL_init_ssl(0, NULL) != 1) {
+        return PAL_TLS_ERR_INIT;
+    }
+    return PAL_TLS_OK;
+}
+
+void pal_tls_global_cleanup(void)
+{
+    /* OpenSSL 3 releases its globals at exit */
+}
+
+/* ── Helpers ─────────────────────────────────────────────────────────── */
+
+static pal_tls_session_t *session_wrap(SSL *ssl, SSL_CTX *own_ctx, int fd)
+{
+    pal_tls_session_t *sess = calloc(1U, sizeof(*sess));
+    if (sess == NULL) {
+        return NULL;
+    }
+    sess->ssl = ssl;
+    sess->own_ctx = own_ctx;
+    sess->fd = fd;
+#if defined(BIO_get_ktls_send)
+    sess->ktls_tx = (BIO_get_ktls_send(SSL_get_wbio(ssl)) != 0) ? 1 : 0;
+    sess->ktls_rx = (BIO_get_ktls_recv(SSL_get_rbio(ssl)) != 0) ? 1 : 0;
+#endif
+    return sess;
+}
+
+/*
+ * Map an SSL_get_error() result to PAL_TLS_ERR_*.  WANT_* on a blocking
+ * socket only happens when SO_*TIMEO fired.
+ */
+static int map_io_error(SSL *ssl, int ret, int fallback)
+{
+    int e = SSL_get_error(ssl, ret);
+    ERR_clear_error();
+    if ((e == SSL_ERROR_WANT_READ) || (e == SSL_ERROR_WANT_WRITE)) {
+        return PAL_TLS_ERR_TIMEOUT;
+    }
+    if ((e == SSL_ERROR_SYSCALL) &&
+        ((errno == EAGAIN) || (errno == EWOULDBLOCK))) {
+        return PAL_TLS_ERR_TIMEOUT;
+    }
+    return fallback;
+}
+
+static int load_ca_pem(SSL_CTX *ctx, const char *pem)
+{
+    BIO *bio = BIO_new_mem_buf(pem, -1);
+    if (bio == NULL) {
+        return -1;
+    }
+    X509_STORE *store = SSL_CTX_get_cert_store(ctx);
+    int added = 0;
+    for (;;) {
+        X509 *cert = PEM_read_bio_X509(bio, NULL, NULL, NULL);
+        if (cert == NULL) {
+            break;
+        }
+        if (X509_STORE_add_cert(store, cert) == 1) {
+            added++;
+        }
+        X509_free(cert);
+    }
+    ERR_clear_error();
+    BIO_free(bio);
+    return (added > 0) ? 0 : -1;
+}
+
+/* ── Client ──────────────────────────────────────────────────────────── */
+
+pal_tls_session_t *pal_tls_connect(int fd, const pal_tls_cfg_t *cfg)
+{
+    if ((fd < 0) || (cfg == NULL) || (cfg->hostname == NULL)) {
+        return NULL;
+    }
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (ctx == NULL) {
+        return NULL;
+    }
+    (void)SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+    if ((cfg->verify_peer != 0) && (cfg->ca_chain_pem != NULL)) {
+        if (load_ca_pem(ctx, cfg->ca_chain_pem) != 0) {
+            SSL_CTX_free(ctx);
+            return NULL;
+        }
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, NULL);
+    } else {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+    }
+
+    SSL *ssl = SSL_new(ctx);
+    if (ssl == NULL) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    (void)SSL_set_tlsext_host_name(ssl, cfg->hostname);
+    if (cfg->verify_peer != 0) {
+        (void)SSL_set1_host(ssl, cfg->hostname);
+    }
+
+    if ((SSL_set_fd(ssl, fd) != 1) || (SSL_connect(ssl) != 1)) {
+        ERR_clear_error();
+        SSL_free(ssl);
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+
+    pal_tls_session_t *sess = session_wrap(ssl, ctx, fd);
+    if (sess == NULL) {
+        SSL_free(ssl);
+        SSL_CTX_free(ctx);
+    }
+    return sess;
+}
+
+/* ── Server ──────────────────────────────────────────────────────────── */
+
+pal_tls_server_t *pal_tls_server_create(const pal_tls_server_cfg_t *cfg)
+{
+    if ((cfg == NULL) || (cfg->cert_file == NULL)) {
+        return NULL;
+    }
+
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    if (ctx == NULL) {
+        return NULL;
+    }
+    (void)SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+
+    /*
+     * Many FTP clients close the data connection without close_notify; the
+     * FTP reply on the control channel is what marks a complete transfer.
+     */
+    uint64_t opts = SSL_OP_IGNORE_UNEXPECTED_EOF;
+#if defined(SSL_OP_ENABLE_KTLS)
+    if (cfg->ktls != 0) {
+        opts |= SSL_OP_ENABLE_KTLS;
+    }
+#endif
+    (void)SSL_CTX_set_options(ctx, opts);
+
+    const char *key = (cfg->key_file != NULL) ? cfg->key_file : cfg->cert_file;
+    if ((SSL_CTX_use_certificate_chain_file(ctx, cfg->cert_file) != 1) ||
+        (SSL_CTX_use_PrivateKey_file(ctx, key, SSL_FILETYPE_PEM) != 1) ||
+        (SSL_CTX_check_private_key(ctx) != 1)) {
+        ERR_clear_error();
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+
+    /* Data connections resume the control connection's session */
+    static const unsigned char sid_ctx[] = "zftpd";
+    (void)SSL_CTX_set_session_id_context(ctx, sid_ctx,
+                                         (unsigned int)(sizeof(sid_ctx) - 1U));
+    (void)SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+
+    pal_tls_server_t *srv = calloc(1U, sizeof(*srv));
+    if (srv == NULL) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    srv->ctx = ctx;
+    return srv;
+}
+
+void pal_tls_server_destroy(pal_tls_server_t *srv)
+{
+    if (srv == NULL) {
+        return;
+    }
+    SSL_CTX_free(srv->ctx);
+    free(srv);
+}
+
+pal_tls_session_t *pal_tls_accept(pal_tls_server_t *srv, int fd)
+{
+    if ((srv == NULL) || (fd < 0)) {
+        return NULL;
+    }
+
+    SSL *ssl = SSL_new(srv->ctx);
+    if (ssl == NULL) {
+        return NULL;
+    }
+    if ((SSL_set_fd(ssl, fd) != 1) || (SSL_accept(ssl) != 1)) {
+        ERR_clear_error();
+        SSL_free(ssl);
+        return NULL;
+    }
+
+    pal_tls_session_t *sess = session_wrap(ssl, NULL, fd);
+    if (sess == NULL) {
+        SSL_free(ssl);
+    }
+    return sess;
+}
+
+int pal_tls_ktls_send(const pal_tls_session_t *sess)
+{
+    return (sess != NULL) ? sess->ktls_tx : 0;
+}
+
+int pal_tls_ktls_recv(const pal_tls_session_t *sess)
+{
+    return (sess != NULL) ? sess->ktls_rx : 0;
+}
+
+int pal_tls_pending(const pal_tls_session_t *sess)
+{
+    return ((sess != NULL) && (sess->ssl != NULL)) ? SSL_pending(sess->ssl) : 0;
+}
+
+const char *pal_tls_describe(const pal_tls_session_t *sess, char *buf,
+                             size_t buf_size)
+{
+    if ((buf == NULL) || (buf_size == 0U)) {
+        return "";
+    }
+    if ((sess == NULL) || (sess->ssl == NULL)) {
+        buf[0] = '\0';
+        return buf;
+    }
+    (void)snprintf(buf, buf_size, "%s %s%s", SSL_get_version(sess->ssl),
+                   SSL_get_cipher_name(sess->ssl),
+                   (sess->ktls_tx != 0) ? " ktls" : "");
+    return buf;
+}
+
+/* ── I/O ─────────────────────────────────────────────────────────────── */
+
+int pal_tls_send(pal_tls_session_t *sess, const void *buf, size_t len)
+{
+    if ((sess == NULL) || (buf == NULL) || (len == 0U) ||
+        (len > (size_t)INT_MAX)) {
+        return PAL_TLS_ERR_PARAM;
+    }
+
+    size_t written = 0U;
+    if (SSL_write_ex(sess->ssl, buf, len, &written) != 1) {
+        return map_io_error(sess->ssl, 0, PAL_TLS_ERR_SEND);
+    }
+    return (int)written;
+}
+
+int pal_tls_recv(pal_tls_session_t *sess, void *buf, size_t len)
+{
+    if ((sess == NULL) || (buf == NULL) || (len == 0U)) {
+        return PAL_TLS_ERR_PARAM;
+    }
+    if (len > (size_t)INT_MAX) {
+        len = (size_t)INT_MAX;
+    }
+
+    size_t got = 0U;
+    if (SSL_read_ex(sess->ssl, buf, len, &got) != 1) {
+        int e = SSL_get_error(sess->ssl, 0);
+        if (e == SSL_ERROR_ZERO_RETURN) {
+            ERR_clear_error();
+            return 0; /* close_notify */
+        }
+        return map_io_error(sess->ssl, 0, PAL_TLS_ERR_RECV);
+    }
+    return (int)got;
+}
+
+void pal_tls_close(pal_tls_session_t *sess)
+{
+    if (sess == NULL) {
+        return;
+    }
+    if (sess->ssl != NULL) {
+        /* One-way close_notify; do not wait for the peer's */
+        (void)SSL_shutdown(sess->ssl);
+        ERR_clear_error();
+        SSL_free(sess->ssl);
+    }
+    if (sess->own_ctx != NULL) {
+        SSL_CTX_free(sess->own_ctx);
+    }
+    free(sess);
+}
@@ -19,9 +19,26 @@
  *   Before any addition or comparison against the 64-bit file size, they are
  *   widened with an explicit cast to prevent silent wrap-around.
  *
+ * One mapping, one index, no file position:
+ *   pkg_init() maps the first PKG_MAP_WINDOW bytes read-only and decodes
+ *   the header and entry table straight from the mapping (one pread each
+ *   when the mapping is unavailable).  Entries are indexed by id in an
+ *   open-addressed table at most half full, so the metadata endpoints can
+ *   open hundreds of PKGs and fetch param.sfo / icon0.png from each with
+ *   a couple of page faults and no copies.  All other reads use pread(),
+ *   which keeps extraction free of shared state.
+ *
  * No dynamic allocation after pkg_init():
  *   pkg_extract_to_buffer() and pkg_extract_file_fd() use only the
  *   caller-supplied buffer or a stack buffer (COPY_BUF_SIZE bytes).
+ *   pkg_extract_batch() is the exception: its work list, plus one
+ *   PKG_BATCH_BUF_SIZE buffer per worker that falls back to pread/pwrite.
+ *
+ * Batch extraction in offset order:
+ *   Whole-PKG extraction writes hundreds of outputs.  Workers take them in
+ *   ascending offset order, so reads stay close to sequential even with
+ *   PKG_BATCH_WORKERS threads, and each output is copied without a
+ *   userspace bounce when possible (mapping → pwrite, copy_file_range).
  *
  * No fprintf / perror in library code:
  *   Side-effects on stderr are inappropriate for a library.  All diagnostics
@@ -35,7 +52,8 @@
  * Partial-read detection in pkg_extract_file_fd():
  *   The original code checked only `got == 0` as an fread error.  A short
  *   read (0 < got < to_read) silently corrupted the extracted data.  We now
- *   require `got == to_read` and return PKG_ERR_IO otherwise.
+ *   require the full count (read_at() loops over short preads) and return
+ *   PKG_ERR_IO otherwise.
  *
  * Encryption guard on all extraction paths:
  *   flags1 bit 31 (PKG_ENTRY_FLAG_ENCRYPTED) was parsed in the original
@@ -57,19 +75,51 @@
 #endif
 
 #include "pkg_unpacker.h"
+#include "pal_thread.h"
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 #include <limits.h>     /* SSIZE_MAX */
+#include <ctype.h>
+
+#include <fcntl.h>
+#include <sys/stat.h>
 
 #if defined(_MSC_VER)
 #  include <io.h>
-#  define fseeko    _fseeki64
-#  define ftello    _ftelli64
+#  define open      _open
+#  define close     _close
+#  define fstat     _fstat64
+#  define stat      _stat64
 #  define write     _write
 #  define SSIZE_MAX _I64_MAX
+#  ifndef O_BINARY
+#    define O_BINARY 0
+#  endif
 #else
+#  include <pthread.h>
+#  include <sys/mman.h>
 #  include <unistd.h>
+#  define O_BINARY  0
+#  define PKG_HAVE_MMAP    1
+#  define PKG_HAVE_THREADS 1
+#endif
+
+/*
+ * copy_file_range(2): Linux 4.5+, FreeBSD 13+.  The PS4/PS5 kernels are
+ * FreeBSD 9/11 derivatives and lack it.
+ */
+#if defined(__linux__)
+#  define PKG_HAVE_CFR 1
+#elif defined(__FreeBSD__) && !defined(PLATFORM_PS4) && !defined(PLATFORM_PS5)
+#  include <sys/param.h>
+#  if __FreeBSD_version >= 1300037
+#    define PKG_HAVE_CFR 1
+#  endif
+#endif
+
+#ifndef O_CLOEXEC
+#  define O_CLOEXEC 0
 #endif
 
 /* ── Internal constants ─────────────────────────────────────────────────── */
@@ -79,7 +129,7 @@
  *
  * DESIGN RATIONALE — why 64 KiB:
  *   Matches one typical OS page-cache read-ahead quantum.  Large enough to
- *   amortise the per-fread overhead; small enough to live on the stack without
+ *   amortise the per-read overhead; small enough to live on the stack without
  *   risk of overflow on embedded targets with reduced stack sizes.
  */
 #define COPY_BUF_SIZE   65536U
@@ -150,46 +200,107 @@ static uint32_t read_be32(const uint8_t *p)
             ((uint32_t)p[3]);
 }
 
-/* ── File-size helper ────────────────────────────────────────────────────── */
+/* ── Positional I/O ──────────────────────────────────────────────────────── */
 
 /**
- * @brief Determine total byte size of an open file without disturbing the
- *        current file position.
- *
- * Saves the current position with ftello(), seeks to SEEK_END, queries the
- * position, then restores the saved position.
+ * @brief Read exactly @p len bytes at absolute offset @p off.
  *
- * @param[in]  fp   Open file handle; must not be NULL.
- * @param[out] out  Receives the file size on PKG_OK; must not be NULL.
+ * Served from the mapping when [off, off+len) lies inside it, otherwise
+ * with pread() (retrying EINTR and short reads).  Never touches a file
+ * position, so concurrent callers on one context do not interfere.
  *
- * @return PKG_OK on success, PKG_ERR_IO if any stdio call fails.
+ * @return PKG_OK, or PKG_ERR_IO on error or premature EOF.
  *
- * @note Thread-safety: NOT thread-safe (modifies fp's position transiently).
- * @note WCET: O(1) on most OS/FS implementations (no I/O read required).
+ * @note Thread-safety: safe; reads ctx only.
+ * @note WCET: O(len); disk I/O outside the mapping.
  */
-static int get_file_size(FILE *fp, uint64_t *out)
+static int read_at(const pkg_context_t *ctx, uint64_t off,
+                   uint8_t *buf, size_t len)
 {
-    off_t saved = ftello(fp);
-    if (saved == (off_t)-1) {
-        return PKG_ERR_IO;
+    if ((ctx->map != NULL) && (off <= (uint64_t)ctx->map_len) &&
+        ((uint64_t)len <= ((uint64_t)ctx->map_len - off))) {
+        (void)memcpy(buf, ctx->map + (size_t)off, len);
+        return PKG_OK;
     }
 
-    if (fseeko(fp, (off_t)0, SEEK_END) != 0) {
-        return PKG_ERR_IO;
+    while (len > 0U) {
+#if defined(_MSC_VER)
+        /* No pread: callers on Windows must serialise per context. */
+        unsigned int chunk = (len > 0x40000000U) ? 0x40000000U
+                                                 : (unsigned int)len;
+        if (_lseeki64(ctx->fd, (__int64)off, SEEK_SET) < 0) {
+            return PKG_ERR_IO;
+        }
+        int n = _read(ctx->fd, buf, chunk);
+#else
+        ssize_t n = pread(ctx->fd, buf, len, (off_t)off);
+#endif
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return PKG_ERR_IO;
+        }
+        if (n == 0) {
+            return PKG_ERR_IO;  /* File shrank below a validated entry. */
+        }
+        buf += (size_t)n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
     }
+    return PKG_OK;
+}
 
-    off_t end = ftello(fp);
+/* ── Id index ─────────────────────────────────────────────────────────────── */
 
-    /* Restore position before any return, even on error. */
-    if (fseeko(fp, saved, SEEK_SET) != 0) {
-        return PKG_ERR_IO;
+/**
+ * @brief Bucket for @p id: Fibonacci hashing, top bits masked.
+ *
+ * Entry ids are small and clustered (0x1000, 0x1200, 0x1220, ...), so the
+ * multiplicative mix spreads them before the mask keeps the low bits.
+ */
+static uint32_t index_slot(uint32_t id, uint32_t mask)
+{
+    return ((id * 0x9E3779B1U) >> 16U) & mask;
+}
+
+/**
+ * @brief Build ctx->index over ctx->entries[0, num_entries).
+ *
+ * The slot count is the smallest power of two >= 2 * num_entries, so a
+ * probe sequence ends on an empty slot after a couple of steps on average.
+ * Slots hold entry index + 1; 0 marks an empty slot.  A repeated id keeps
+ * its first entry, matching the linear scan it replaces.
+ *
+ * @return PKG_OK or PKG_ERR_NOMEM.
+ */
+static int build_index(pkg_context_t *ctx)
+{
+    uint32_t slots = 16U;
+    while (slots < (uint32_t)(ctx->num_entries * 2U)) {
+        slots <<= 1U;   /* num_entries <= PKG_MAX_ENTRY_COUNT: no overflow */
     }
 
-    if (end < (off_t)0) {
-        return PKG_ERR_IO;
+    ctx->index = (uint32_t *)calloc((size_t)slots, sizeof(uint32_t));
+    if (ctx->index == NULL) {
+        return PKG_ERR_NOMEM;
     }
+    ctx->index_mask = slots - 1U;
+
+    for (size_t i = 0U; i < ctx->num_entries; i++) {
+        uint32_t id = ctx->entries[i].id;
+        uint32_t s  = index_slot(id, ctx->index_mask);
 
-    *out = (uint64_t)end;
+        while (ctx->index[s] != 0U) {
+            if (ctx->entries[ctx->index[s] - 1U].id == id) {
+                break;
+            }
+            s = (s + 1U) & ctx->index_mask;
+        }
+        if (ctx->index[s] == 0U) {
+            ctx->index[s] = (uint32_t)i + 1U;
+        }
+    }
     return PKG_OK;
 }
 
@@ -208,21 +319,24 @@ int pkg_init(pkg_context_t *ctx, const char *pkg_path)
      * on ctx at any point below, even before all fields are populated.
      */
     (void)memset(ctx, 0, sizeof(*ctx));
+    ctx->fd = -1;
 
     /* ── Open file ──────────────────────────────────────────────────────── */
-    ctx->file = fopen(pkg_path, "rb");
-    if (ctx->file == NULL) {
-        /* errno is set by fopen; caller may inspect it. */
+    ctx->fd = open(pkg_path, O_RDONLY | O_BINARY | O_CLOEXEC);
+    if (ctx->fd < 0) {
+        /* errno is set by open; caller may inspect it. */
+        ctx->fd = -1;
         return PKG_ERR_IO;
     }
 
     /* ── Determine file size ────────────────────────────────────────────── */
     {
-        int rc = get_file_size(ctx->file, &ctx->file_size);
-        if (rc != PKG_OK) {
+        struct stat st;
+        if ((fstat(ctx->fd, &st) != 0) || (st.st_size < 0)) {
             pkg_cleanup(ctx);
-            return rc;
+            return PKG_ERR_IO;
         }
+        ctx->file_size = (uint64_t)st.st_size;
     }
 
     if (ctx->file_size < (uint64_t)PKG_HEADER_SIZE) {
@@ -230,11 +344,30 @@ int pkg_init(pkg_context_t *ctx, const char *pkg_path)
         return PKG_ERR_FORMAT;
     }
 
+    /* ── Map the metadata window ────────────────────────────────────────── */
+#if defined(PKG_HAVE_MMAP)
+    {
+        size_t len = (ctx->file_size < (uint64_t)PKG_MAP_WINDOW)
+                     ? (size_t)ctx->file_size
+                     : (size_t)PKG_MAP_WINDOW;
+        void *m = mmap(NULL, len, PROT_READ, MAP_SHARED, ctx->fd, (off_t)0);
+        if (m != MAP_FAILED) {
+            ctx->map     = (const uint8_t *)m;
+            ctx->map_len = len;
+        }
+        /* else: keep going on pread alone. */
+    }
+#endif
+
     /* ── Read the header block ──────────────────────────────────────────── */
-    uint8_t hdr_buf[PKG_HEADER_SIZE];
-    if (fread(hdr_buf, 1U, sizeof(hdr_buf), ctx->file) != sizeof(hdr_buf)) {
-        pkg_cleanup(ctx);
-        return PKG_ERR_IO;
+    uint8_t hdr_copy[PKG_HEADER_SIZE];
+    const uint8_t *hdr_buf = ctx->map;
+    if (hdr_buf == NULL) {
+        if (read_at(ctx, 0U, hdr_copy, sizeof(hdr_copy)) != PKG_OK) {
+            pkg_cleanup(ctx);
+            return PKG_ERR_IO;
+        }
+        hdr_buf = hdr_copy;
     }
 
     /* ── Validate magic ─────────────────────────────────────────────────── */
@@ -324,19 +457,36 @@ int pkg_init(pkg_context_t *ctx, const char *pkg_path)
         return PKG_ERR_NOMEM;
     }
 
-    /* ── Parse each entry record ────────────────────────────────────────── */
-    if (fseeko(ctx->file, (off_t)table_offset, SEEK_SET) != 0) {
-        pkg_cleanup(ctx);
-        return PKG_ERR_IO;
-    }
-
-    for (uint32_t i = 0U; i < entry_count; i++) {
-        uint8_t e_buf[PKG_ENTRY_RECORD_SIZE];
-
-        if (fread(e_buf, 1U, sizeof(e_buf), ctx->file) != sizeof(e_buf)) {
+    /* ── Fetch the entry table ──────────────────────────────────────────── */
+    /*
+     * Decoded in place when the table is inside the mapping; otherwise read
+     * with a single pread (at most PKG_MAX_ENTRY_COUNT * 32 = 320 000 bytes)
+     * instead of one read per record.
+     */
+    const uint8_t *table   = NULL;
+    uint8_t       *tbl_buf = NULL;
+
+    if ((ctx->map != NULL) && (table_end <= (uint64_t)ctx->map_len)) {
+        table = ctx->map + table_offset;
+    } else {
+        tbl_buf = (uint8_t *)malloc((size_t)table_bytes);
+        if (tbl_buf == NULL) {
+            pkg_cleanup(ctx);
+            return PKG_ERR_NOMEM;
+        }
+        if (read_at(ctx, (uint64_t)table_offset, tbl_buf,
+                    (size_t)table_bytes) != PKG_OK) {
+            free(tbl_buf);
             pkg_cleanup(ctx);
             return PKG_ERR_IO;
         }
+        table = tbl_buf;
+    }
+
+    /* ── Parse each entry record ────────────────────────────────────────── */
+    for (uint32_t i = 0U; i < entry_count; i++) {
+        const uint8_t *e_buf = table +
+                               ((size_t)i * (size_t)PKG_ENTRY_RECORD_SIZE);
 
         pkg_entry_t *e = &ctx->entries[i];
 
@@ -358,12 +508,23 @@ int pkg_init(pkg_context_t *ctx, const char *pkg_path)
         uint64_t entry_end = (uint64_t)e->offset + (uint64_t)e->size;
         if ((entry_end < (uint64_t)e->offset) || /* addition overflow guard */
             (entry_end > ctx->file_size)) {
+            free(tbl_buf);
             pkg_cleanup(ctx);
             return PKG_ERR_FORMAT;
         }
     }
+    free(tbl_buf);
 
     ctx->num_entries = (size_t)entry_count;
+
+    /* ── Index entries by id ────────────────────────────────────────────── */
+    {
+        int rc = build_index(ctx);
+        if (rc != PKG_OK) {
+            pkg_cleanup(ctx);
+            return rc;
+        }
+    }
     return PKG_OK;
 }
 
@@ -373,9 +534,17 @@ void pkg_cleanup(pkg_context_t *ctx)
         return;
     }
 
-    if (ctx->file != NULL) {
-        (void)fclose(ctx->file);
-        ctx->file = NULL;
+#if defined(PKG_HAVE_MMAP)
+    if (ctx->map != NULL) {
+        (void)munmap((void *)(uintptr_t)ctx->map, ctx->map_len);
+    }
+#endif
+    ctx->map     = NULL;
+    ctx->map_len = 0U;
+
+    if (ctx->fd >= 0) {
+        (void)close(ctx->fd);
+        ctx->fd = -1;
     }
 
     if (ctx->entries != NULL) {
@@ -383,6 +552,12 @@ void pkg_cleanup(pkg_context_t *ctx)
         ctx->entries = NULL;
     }
 
+    if (ctx->index != NULL) {
+        free(ctx->index);
+        ctx->index = NULL;
+    }
+
+    ctx->index_mask  = 0U;
     ctx->num_entries = 0U;
     ctx->file_size   = 0U;
 }
@@ -393,18 +568,52 @@ void pkg_cleanup(pkg_context_t *ctx)
 
 const pkg_entry_t *pkg_find_entry_by_id(const pkg_context_t *ctx, uint32_t id)
 {
-    if ((ctx == NULL) || (ctx->entries == NULL)) {
+    if ((ctx == NULL) || (ctx->entries == NULL) || (ctx->index == NULL)) {
         return NULL;
     }
 
-    for (size_t i = 0U; i < ctx->num_entries; i++) {
-        if (ctx->entries[i].id == id) {
-            return &ctx->entries[i];
+    uint32_t s = index_slot(id, ctx->index_mask);
+
+    /* The table is at most half full, so an empty slot ends every probe. */
+    while (ctx->index[s] != 0U) {
+        const pkg_entry_t *e = &ctx->entries[ctx->index[s] - 1U];
+        if (e->id == id) {
+            return e;
         }
+        s = (s + 1U) & ctx->index_mask;
     }
     return NULL;
 }
 
+ssize_t pkg_entry_view(const pkg_context_t *ctx, const pkg_entry_t *entry,
+                       const uint8_t **data)
+{
+    if (data != NULL) {
+        *data = NULL;
+    }
+    if ((ctx == NULL) || (entry == NULL) || (data == NULL)) {
+        return (ssize_t)PKG_ERR_PARAM;
+    }
+
+    if (pkg_entry_is_encrypted(entry)) {
+        return (ssize_t)PKG_ERR_ENCRYPTED;
+    }
+
+    if (entry->size > PKG_MAX_ENTRY_SIZE) {
+        return (ssize_t)PKG_ERR_RANGE;
+    }
+
+    /* Widened: offset + size cannot wrap (both u32, sum fits in u64). */
+    if ((ctx->map == NULL) ||
+        (((uint64_t)entry->offset + (uint64_t)entry->size) >
+         (uint64_t)ctx->map_len)) {
+        return (ssize_t)PKG_ERR_UNMAPPED;
+    }
+
+    *data = ctx->map + entry->offset;
+    return (ssize_t)entry->size;
+}
+
 /* ═══════════════════════════════════════════════════════════════════════════
  * Extraction
  * ═════════════════════════════════════════════════════════════════════════*/
@@ -412,7 +621,7 @@ const pkg_entry_t *pkg_find_entry_by_id(const pkg_context_t *ctx, uint32_t id)
 ssize_t pkg_extract_to_buffer(pkg_context_t *ctx, const pkg_entry_t *entry,
                                uint8_t *buf, size_t buf_size)
 {
-    if ((ctx == NULL) || (ctx->file == NULL) ||
+    if ((ctx == NULL) || (ctx->fd < 0) ||
         (entry == NULL) || (buf == NULL) || (buf_size == 0U)) {
         return (ssize_t)PKG_ERR_PARAM;
     }
@@ -448,12 +657,8 @@ ssize_t pkg_extract_to_buffer(pkg_context_t *ctx, const pkg_entry_t *entry,
         return (ssize_t)0;
     }
 
-    if (fseeko(ctx->file, (off_t)entry->offset, SEEK_SET) != 0) {
-        return (ssize_t)PKG_ERR_IO;
-    }
-
-    size_t got = fread(buf, 1U, (size_t)entry->size, ctx->file);
-    if (got != (size_t)entry->size) {
+    if (read_at(ctx, (uint64_t)entry->offset, buf,
+                (size_t)entry->size) != PKG_OK) {
         /*
          * A short read indicates either an I/O error or that the file was
          * truncated between pkg_init() and this call.  Either way, the
@@ -462,13 +667,13 @@ ssize_t pkg_extract_to_buffer(pkg_context_t *ctx, const pkg_entry_t *entry,
         return (ssize_t)PKG_ERR_IO;
     }
 
-    return (ssize_t)got;
+    return (ssize_t)entry->size;
 }
 
 int pkg_extract_file_fd(pkg_context_t *ctx, const pkg_entry_t *entry,
                         int output_fd)
 {
-    if ((ctx == NULL) || (ctx->file == NULL) ||
+    if ((ctx == NULL) || (ctx->fd < 0) ||
         (entry == NULL) || (output_fd < 0)) {
         return PKG_ERR_PARAM;
     }
@@ -481,34 +686,25 @@ int pkg_extract_file_fd(pkg_context_t *ctx, const pkg_entry_t *entry,
         return PKG_ERR_RANGE;
     }
 
-    if (fseeko(ctx->file, (off_t)entry->offset, SEEK_SET) != 0) {
-        return PKG_ERR_IO;
-    }
-
     /* Stack-allocated copy buffer — no heap allocation in this function. */
     uint8_t copy_buf[COPY_BUF_SIZE];
     uint32_t remaining = entry->size;
+    uint64_t pos       = (uint64_t)entry->offset;
 
     while (remaining > 0U) {
         size_t to_read = (remaining < (uint32_t)COPY_BUF_SIZE)
                          ? (size_t)remaining
                          : (size_t)COPY_BUF_SIZE;
 
-        size_t got = fread(copy_buf, 1U, to_read, ctx->file);
-
-        if (got == 0U) {
-            /* EOF or hard read error before we consumed entry->size bytes. */
-            return PKG_ERR_IO;
-        }
-
-        if (got != to_read) {
+        if (read_at(ctx, pos, copy_buf, to_read) != PKG_OK) {
             /*
-             * Partial read: the file is shorter than entry->size claimed.
-             * The original code silently continued with a smaller chunk,
-             * producing a corrupt output file.  We fail fast instead.
+             * EOF or hard read error: the file is shorter than entry->size
+             * claimed.  The original code silently continued with a smaller
+             * chunk, producing a corrupt output file.  We fail fast instead.
              */
             return PKG_ERR_IO;
         }
+        size_t got = to_read;
 
         /*
          * Write the full buffer to output_fd.
@@ -552,7 +748,389 @@ int pkg_extract_file_fd(pkg_context_t *ctx, const pkg_entry_t *entry,
          * so remaining - got >= 0 and no uint32_t underflow is possible.
          */
         remaining -= (uint32_t)got;
+        pos       += (uint64_t)got;
+    }
+
+    return PKG_OK;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ * Entry names
+ * ═════════════════════════════════════════════════════════════════════════*/
+
+int pkg_entry_name(const pkg_context_t *ctx, const pkg_entry_t *entry,
+                   char *buf, size_t size)
+{
+    if ((ctx == NULL) || (entry == NULL) || (buf == NULL) || (size == 0U)) {
+        return PKG_ERR_PARAM;
+    }
+
+    char name[PKG_ENTRY_NAME_MAX];
+    name[0] = '\0';
+
+    /* ── Name table ─────────────────────────────────────────────────────── */
+    const pkg_entry_t *tbl = pkg_find_entry_by_id(ctx, PKG_ENTRY_ID_ENTRY_NAMES);
+    if ((tbl != NULL) && (entry->filename_offset != 0U) &&
+        (entry->filename_offset < tbl->size) && !pkg_entry_is_encrypted(tbl)) {
+        uint32_t avail = tbl->size - entry->filename_offset;
+        size_t   len   = (avail < (uint32_t)(sizeof(name) - 1U))
+                         ? (size_t)avail : (sizeof(name) - 1U);
+        uint64_t off   = (uint64_t)tbl->offset +
+                         (uint64_t)entry->filename_offset;
+
+        if (read_at(ctx, off, (uint8_t *)name, len) == PKG_OK) {
+            name[len] = '\0';
+            for (size_t i = 0U; name[i] != '\0'; i++) {
+                unsigned char c = (unsigned char)name[i];
+                if ((c == '/') || (c == '\\') || (iscntrl(c) != 0)) {
+                    name[i] = '_';
+                }
+            }
+            if ((strcmp(name, ".") == 0) || (strcmp(name, "..") == 0)) {
+                name[0] = '\0';
+            }
+        } else {
+            name[0] = '\0';
+        }
+    }
+
+    /* ── Well-known ids, then the hex fallback ──────────────────────────── */
+    if (name[0] == '\0') {
+        const char *known = NULL;
+        switch (entry->id) {
+        case PKG_ENTRY_ID_PARAM_SFO: known = "param.sfo"; break;
+        case PKG_ENTRY_ID_ICON0_PNG: known = "icon0.png"; break;
+        case PKG_ENTRY_ID_ICON1_PNG: known = "icon1.png"; break;
+        case PKG_ENTRY_ID_PIC0_PNG:  known = "pic0.png";  break;
+        case PKG_ENTRY_ID_PIC1_PNG:  known = "pic1.png";  break;
+        default:                     break;
+        }
+        if (known != NULL) {
+            (void)snprintf(name, sizeof(name), "%s", known);
+        } else {
+            (void)snprintf(name, sizeof(name), "%08X.bin", entry->id);
+        }
+    }
+
+    size_t n = strlen(name);
+    if (n >= size) {
+        return PKG_ERR_BUFFER_SMALL;
+    }
+    (void)memcpy(buf, name, n + 1U);
+    return PKG_OK;
+}
+
+/* ═══════════════════════════════════════════════════════════════════════════
+ * Batch extraction
+ * ═════════════════════════════════════════════════════════════════════════*/
+
+/* One item of the work list, keyed by the offset it reads from. */
+typedef struct {
+    uint64_t offset;
+    size_t   item;
+} batch_slot_t;
+
+/*
+ * Shared by the workers of one pkg_extract_batch() call.  order[] is the
+ * work list sorted by entry offset; next is the first slot not taken.
+ */
+typedef struct {
+    pkg_context_t      *ctx;
+    pkg_batch_item_t   *items;
+    batch_slot_t       *order;
+    size_t              count;
+    size_t              next;
+    pkg_progress_fn     progress;
+    void               *user;
+    const volatile int *cancel;
+#if defined(PKG_HAVE_THREADS)
+    pthread_mutex_t     lock;
+#endif
+} batch_t;
+
+static int batch_cmp(const void *a, const void *b)
+{
+    const batch_slot_t *sa = (const batch_slot_t *)a;
+    const batch_slot_t *sb = (const batch_slot_t *)b;
+    if (sa->offset != sb->offset) {
+        return (sa->offset > sb->offset) ? 1 : -1;
+    }
+    /* Same data twice: keep the caller's order. */
+    return (sa->item > sb->item) - (sa->item < sb->item);
+}
+
+static int batch_cancelled(const batch_t *b)
+{
+    return (b->cancel != NULL) && (*b->cancel != 0);
+}
+
+/**
+ * @brief pwrite() all of [p, p+len) at @p off, retrying EINTR.
+ * @return PKG_OK or PKG_ERR_IO.
+ */
+static int write_all_at(int fd, const uint8_t *p, size_t len, uint64_t off)
+{
+    while (len > 0U) {
+#if defined(_MSC_VER)
+        unsigned int chunk = (len > 0x40000000U) ? 0x40000000U
+                                                 : (unsigned int)len;
+        if (_lseeki64(fd, (__int64)off, SEEK_SET) < 0) {
+            return PKG_ERR_IO;
+        }
+        int n = _write(fd, p, chunk);
+#else
+        ssize_t n = pwrite(fd, p, len, (off_t)off);
+#endif
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return PKG_ERR_IO;
+        }
+        if (n == 0) {
+            return PKG_ERR_IO;
+        }
+        p   += (size_t)n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
+    }
+    return PKG_OK;
+}
+
+/**
+ * @brief Copy one entry into @p out_fd, reporting progress per chunk.
+ *
+ * @param[in,out] buf  Worker buffer (PKG_BATCH_BUF_SIZE), allocated on the
+ *                     first fallback copy so mapped/kernel copies never
+ *                     pay for it.
+ */
+static int batch_copy(batch_t *b, const pkg_entry_t *e, int out_fd,
+                      uint8_t **buf)
+{
+    const uint64_t size = (uint64_t)e->size;
+    uint64_t done = 0U;
+
+    /* ── Mapped: write straight from the page cache mapping ─────────────── */
+    const uint8_t *view = NULL;
+    if (pkg_entry_view(b->ctx, e, &view) >= 0) {
+        while (done < size) {
+            if (batch_cancelled(b)) {
+                return PKG_ERR_CANCELLED;
+            }
+            uint64_t left = size - done;
+            size_t n = (left < (uint64_t)PKG_BATCH_BUF_SIZE)
+                       ? (size_t)left : (size_t)PKG_BATCH_BUF_SIZE;
+            if (write_all_at(out_fd, view + done, n, done) != PKG_OK) {
+                return PKG_ERR_IO;
+            }
+            done += (uint64_t)n;
+            if (b->progress != NULL) {
+                b->progress(b->user, (uint64_t)n);
+            }
+        }
+        return PKG_OK;
+    }
+
+    /* ── In-kernel copy ─────────────────────────────────────────────────── */
+#if defined(PKG_HAVE_CFR)
+    while (done < size) {
+        if (batch_cancelled(b)) {
+            return PKG_ERR_CANCELLED;
+        }
+        uint64_t left = size - done;
+        size_t want = (left < (uint64_t)PKG_BATCH_BUF_SIZE)
+                      ? (size_t)left : (size_t)PKG_BATCH_BUF_SIZE;
+#if defined(__linux__)
+        loff_t in  = (loff_t)((uint64_t)e->offset + done);
+        loff_t out = (loff_t)done;
+#else
+        off_t in  = (off_t)((uint64_t)e->offset + done);
+        off_t out = (off_t)done;
+#endif
+        ssize_t n = copy_file_range(b->ctx->fd, &in, out_fd, &out, want, 0U);
+        if (n > 0) {
+            done += (uint64_t)n;
+            if (b->progress != NULL) {
+                b->progress(b->user, (uint64_t)n);
+            }
+            continue;
+        }
+        if ((n < 0) && (errno == EINTR)) {
+            continue;
+        }
+        if (n == 0) {
+            return PKG_ERR_IO;  /* EOF inside a validated entry: truncated */
+        }
+        if ((errno == ENOSYS) || (errno == EXDEV) || (errno == EINVAL) ||
+            (errno == EBADF) || (errno == EOPNOTSUPP)) {
+            break;              /* not here: finish with pread/pwrite */
+        }
+        return PKG_ERR_IO;
     }
+#endif
 
+    /* ── pread/pwrite ───────────────────────────────────────────────────── */
+    if ((done < size) && (*buf == NULL)) {
+        *buf = (uint8_t *)malloc(PKG_BATCH_BUF_SIZE);
+        if (*buf == NULL) {
+            return PKG_ERR_NOMEM;
+        }
+    }
+    while (done < size) {
+        if (batch_cancelled(b)) {
+            return PKG_ERR_CANCELLED;
+        }
+        uint64_t left = size - done;
+        size_t n = (left < (uint64_t)PKG_BATCH_BUF_SIZE)
+                   ? (size_t)left : (size_t)PKG_BATCH_BUF_SIZE;
+        if ((read_at(b->ctx, (uint64_t)e->offset + done, *buf, n) != PKG_OK) ||
+            (write_all_at(out_fd, *buf, n, done) != PKG_OK)) {
+            return PKG_ERR_IO;
+        }
+        done += (uint64_t)n;
+        if (b->progress != NULL) {
+            b->progress(b->user, (uint64_t)n);
+        }
+    }
+    return PKG_OK;
+}
+
+static int batch_one(batch_t *b, pkg_batch_item_t *it, uint8_t **buf)
+{
+    if ((it->entry == NULL) || (it->path == NULL)) {
+        return PKG_ERR_PARAM;
+    }
+    if (pkg_entry_is_encrypted(it->entry)) {
+        return PKG_ERR_ENCRYPTED;
+    }
+    if (batch_cancelled(b)) {
+        return PKG_ERR_CANCELLED;
+    }
+
+    int fd = open(it->path, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY | O_CLOEXEC,
+                  0644);
+    if (fd < 0) {
+        return PKG_ERR_IO;
+    }
+    int rc = batch_copy(b, it->entry, fd, buf);
+    if (close(fd) != 0) {
+        if (rc == PKG_OK) {
+            rc = PKG_ERR_IO;
+        }
+    }
+    if (rc != PKG_OK) {
+        (void)unlink(it->path);
+    }
+    return rc;
+}
+
+static void *batch_worker(void *arg)
+{
+    batch_t *b   = (batch_t *)arg;
+    uint8_t *buf = NULL;
+
+    for (;;) {
+        size_t k;
+#if defined(PKG_HAVE_THREADS)
+        (void)pthread_mutex_lock(&b->lock);
+#endif
+        k = b->next;
+        if (k < b->count) {
+            b->next++;
+        }
+#if defined(PKG_HAVE_THREADS)
+        (void)pthread_mutex_unlock(&b->lock);
+#endif
+        if (k >= b->count) {
+            break;
+        }
+        pkg_batch_item_t *it = &b->items[b->order[k].item];
+        it->result = batch_one(b, it, &buf);
+    }
+
+    free(buf);
+    return NULL;
+}
+
+int pkg_extract_batch(pkg_context_t *ctx, pkg_batch_item_t *items,
+                      size_t count, unsigned workers,
+                      pkg_progress_fn progress, void *user,
+                      const volatile int *cancel)
+{
+    if ((ctx == NULL) || (ctx->fd < 0) || ((items == NULL) && (count > 0U))) {
+        return PKG_ERR_PARAM;
+    }
+    if (count == 0U) {
+        return PKG_OK;
+    }
+
+    batch_t b;
+    (void)memset(&b, 0, sizeof(b));
+    b.ctx      = ctx;
+    b.items    = items;
+    b.count    = count;
+    b.progress = progress;
+    b.user     = user;
+    b.cancel   = cancel;
+
+    if (count > (SIZE_MAX / sizeof(batch_slot_t))) {
+        return PKG_ERR_RANGE;
+    }
+    b.order = (batch_slot_t *)malloc(count * sizeof(batch_slot_t));
+    if (b.order == NULL) {
+        return PKG_ERR_NOMEM;
+    }
+
+    /* Items without an entry sort first and fail at once. */
+    for (size_t i = 0U; i < count; i++) {
+        items[i].result   = PKG_ERR_CANCELLED;
+        b.order[i].offset = (items[i].entry != NULL)
+                            ? (uint64_t)items[i].entry->offset : 0U;
+        b.order[i].item   = i;
+    }
+    qsort(b.order, count, sizeof(batch_slot_t), batch_cmp);
+
+    if (workers == 0U) {
+        workers = PKG_BATCH_WORKERS;
+    }
+    if (workers > PKG_BATCH_MAX_WORKERS) {
+        workers = PKG_BATCH_MAX_WORKERS;
+    }
+    if ((size_t)workers > count) {
+        workers = (unsigned)count;
+    }
+
+#if defined(PKG_HAVE_THREADS)
+    pthread_t tids[PKG_BATCH_MAX_WORKERS];
+    unsigned  started = 0U;
+
+    (void)pthread_mutex_init(&b.lock, NULL);
+    /* The calling thread is worker 0; a failed spawn just means fewer. */
+    for (unsigned i = 1U; i < workers; i++) {
+        if (pal_thread_create(&tids[started], NULL, PAL_THREAD_BACKGROUND,
+                              batch_worker, &b) == 0) {
+            started++;
+        }
+    }
+    (void)batch_worker(&b);
+    for (unsigned i = 0U; i < started; i++) {
+        (void)pthread_join(tids[i], NULL);
+    }
+    (void)pthread_mutex_destroy(&b.lock);
+#else
+    (void)workers;
+    (void)batch_worker(&b);
+#endif
+
+    free(b.order);
+
+    if (batch_cancelled(&b)) {
+        return PKG_ERR_CANCELLED;
+    }
+    for (size_t i = 0U; i < count; i++) {
+        if (items[i].result != PKG_OK) {
+            return items[i].result;
+        }
+    }
     return PKG_OK;
 }
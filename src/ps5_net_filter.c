@@ -21,7 +21,7 @@
  *
  *      [0x000 – 0x3FF]  hook_sys_connect() machine code  (~200 bytes)
  *      [0x400 – 0x47F]  hook_sys_sendto() machine code   (~100 bytes)
- *      [0x480 – 0x4FF]  ps5_hook_shared_t (config block) (128 bytes)
+ *      [0x480 – 0x9BF]  ps5_hook_shared_t (config block) (1344 bytes)
  *
  *    The config block is accessed by the hooks via a RIP-relative address
  *    baked in at install time.  No pointers to userland memory appear in
@@ -57,7 +57,7 @@
  *      a) If td->td_proc->p_pid == g_shared.zftpd_pid  → allow (fast path)
  *      b) Extract destination IP from sockaddr argument via copyin()
  *      c) If dest IP is RFC-1918 or loopback                → allow
- *      d) If dest IP matches any rule in g_shared.rules[]   → ENETUNREACH
+ *      d) If dest IP is in a range of g_shared.ranges[]     → ENETUNREACH
  *      e) Otherwise                                          → allow
  *
  * 4. FIRMWARE TABLE
@@ -78,6 +78,7 @@
 #include "ftp_log.h"
 #include "pal_notification.h"
 
+#include <arpa/inet.h>
 #include <errno.h>
 #include <stdatomic.h>
 #include <stddef.h>
@@ -429,6 +430,25 @@ static const ps5_net_filter_rule_t g_default_rules[] = {
 _Static_assert(DEFAULT_RULE_COUNT <= PS5_NET_FILTER_MAX_RULES,
                "Default rule count exceeds PS5_NET_FILTER_MAX_RULES");
 
+/*===========================================================================*
+ * PER-CPU AREA
+ *===========================================================================*/
+
+/**
+ * Offset of pc_cpuid in struct pcpu (FreeBSD 11 amd64), read by the hooks
+ * through %gs to pick their stat slot:
+ *   pc_curthread, pc_idlethread, pc_fpcurthread, pc_deadthread, pc_curpcb
+ *   (5 × 8), pc_switchtime (8), pc_switchticks (4), pc_cpuid.
+ */
+#define PCPU_CPUID_OFFSET 0x34U
+
+/**
+ * Stat slots in the shared block (power of two).  The PS5 exposes 16
+ * logical CPUs; a larger id wraps onto a shared slot, which the hook's
+ * locked add keeps exact.
+ */
+#define HOOK_STAT_SLOTS 16U
+
 /*===========================================================================*
  * KERNEL HOOK SHARED DATA BLOCK
  *
@@ -441,7 +461,26 @@ _Static_assert(DEFAULT_RULE_COUNT <= PS5_NET_FILTER_MAX_RULES,
  *===========================================================================*/
 
 /** @cond internal */
-typedef struct __attribute__((aligned(16))) {
+
+/** Inclusive IPv4 range, HOST byte order. */
+typedef struct {
+  uint32_t first;
+  uint32_t last;
+} ps5_hook_range_t;
+
+/**
+ * One CPU's counters, a cache line of its own so the hooks running on
+ * different cores never write to the same line.
+ */
+typedef struct __attribute__((aligned(64))) {
+  volatile int64_t blocked;
+  volatile int64_t allowed_self;
+  volatile int64_t allowed_local;
+  volatile int64_t allowed_other;
+  volatile int64_t hook_calls;
+} ps5_hook_stat_slot_t;
+
+typedef struct __attribute__((aligned(64))) {
 
   /** Original connect syscall handler (restored on uninstall). */
   uintptr_t original_connect;
@@ -452,14 +491,8 @@ typedef struct __attribute__((aligned(16))) {
   /** PID of the zftpd process: connections from this PID always pass. */
   int32_t zftpd_pid;
 
-  /** Number of valid entries in rules[]. */
-  uint32_t rule_count;
-
-  /**
-   * IP subnet block rules (network byte order).
-   * Embedded directly: no pointer, no userland reference.
-   */
-  ps5_net_filter_rule_t rules[PS5_NET_FILTER_MAX_RULES];
+  /** Number of valid entries in ranges[]. */
+  uint32_t range_count;
 
   /** Kernel-side struct thread td_proc offset. */
   uint32_t td_proc_offset;
@@ -467,16 +500,42 @@ typedef struct __attribute__((aligned(16))) {
   /** Kernel-side struct proc p_pid offset. */
   uint32_t proc_pid_offset;
 
-  /* ---- Statistics (atomic, written by kernel hook, read by userland) ---- */
-  volatile int64_t stat_blocked;
-  volatile int64_t stat_allowed_self;
-  volatile int64_t stat_allowed_local;
-  volatile int64_t stat_allowed_other;
-  volatile int64_t stat_hook_calls;
+  /** Offset of pc_cpuid in the per-CPU area (%gs). */
+  uint32_t pcpu_cpuid_offset;
+  uint32_t _pad;
+
+  /**
+   * Block list compiled by compile_ranges(): sorted by first, merged,
+   * disjoint.  Embedded directly: no pointer, no userland reference.
+   */
+  ps5_hook_range_t ranges[PS5_NET_FILTER_MAX_RULES];
+
+  /* ---- Statistics (per CPU, written by kernel hook, summed by userland) */
+  ps5_hook_stat_slot_t stats[HOOK_STAT_SLOTS];
 
 } ps5_hook_shared_t;
 /** @endcond */
 
+/* Offsets hard-coded in ps5_net_filter_hook.c (SHARED_* / STAT_*) */
+_Static_assert(offsetof(ps5_hook_shared_t, range_count) == 0x14U,
+               "hook SHARED_RANGE_COUNT_OFF mismatch");
+_Static_assert(offsetof(ps5_hook_shared_t, td_proc_offset) == 0x18U,
+               "hook SHARED_TD_PROC_OFF mismatch");
+_Static_assert(offsetof(ps5_hook_shared_t, proc_pid_offset) == 0x1CU,
+               "hook SHARED_PROC_PID_OFF mismatch");
+_Static_assert(offsetof(ps5_hook_shared_t, pcpu_cpuid_offset) == 0x20U,
+               "hook SHARED_PCPU_CPUID_OFF mismatch");
+_Static_assert(offsetof(ps5_hook_shared_t, ranges) == 0x28U,
+               "hook SHARED_RANGES_OFF mismatch");
+_Static_assert(offsetof(ps5_hook_shared_t, stats) == 0x140U,
+               "hook SHARED_STATS_OFF mismatch");
+_Static_assert(sizeof(ps5_hook_stat_slot_t) == 64U,
+               "hook STAT_SLOT_SIZE mismatch");
+_Static_assert(offsetof(ps5_hook_stat_slot_t, hook_calls) == 0x20U,
+               "hook STAT_CALLS mismatch");
+_Static_assert((HOOK_SHARED_DATA_OFFSET % 64U) == 0U,
+               "stat slots must start on a cache line");
+
 _Static_assert(sizeof(ps5_hook_shared_t) <=
                    (HOOK_PAGE_SIZE - HOOK_SHARED_DATA_OFFSET),
                "ps5_hook_shared_t does not fit in hook page");
@@ -494,6 +553,66 @@ static uintptr_t g_hook_page_kaddr = 0;
 /** Userland mirror of the hook page (for reading stats). */
 static uint8_t g_hook_page_mirror[HOOK_PAGE_SIZE];
 
+/*===========================================================================*
+ * RULE COMPILATION
+ *===========================================================================*/
+
+/**
+ * @brief Compile mask rules into the sorted, merged range table.
+ *
+ * Each rule becomes the inclusive host-order range [network & mask,
+ * network | ~mask].  The ranges are sorted by first address and merged
+ * where they overlap or touch, so the hook can answer with a single
+ * binary search.  Merging only ever shrinks the table, hence at most
+ * PS5_NET_FILTER_MAX_RULES entries.
+ *
+ * @param rules  Rules, network byte order.
+ * @param count  Number of rules (<= PS5_NET_FILTER_MAX_RULES).
+ * @param out    Range table (PS5_NET_FILTER_MAX_RULES entries).
+ *
+ * @return Number of ranges, or -1 if a mask is not a contiguous prefix
+ *         (such a rule matches a scattered set, not one range).
+ */
+static int compile_ranges(const ps5_net_filter_rule_t *rules, uint32_t count,
+                          ps5_hook_range_t *out) {
+  uint32_t n = 0U;
+
+  for (uint32_t i = 0U; i < count; i++) {
+    uint32_t mask = ntohl(rules[i].mask);
+    uint32_t host = ~mask;
+    if ((host & (host + 1U)) != 0U) {
+      return -1;
+    }
+    ps5_hook_range_t r;
+    r.first = ntohl(rules[i].network) & mask;
+    r.last = r.first | host;
+
+    /* Insertion sort by first address (at most 32 entries) */
+    uint32_t j = n;
+    while ((j > 0U) && (out[j - 1U].first > r.first)) {
+      out[j] = out[j - 1U];
+      j--;
+    }
+    out[j] = r;
+    n++;
+  }
+
+  /* Merge overlapping or adjacent ranges in place */
+  uint32_t m = 0U;
+  for (uint32_t i = 0U; i < n; i++) {
+    if ((m > 0U) && ((out[m - 1U].last == UINT32_MAX) ||
+                     (out[i].first <= out[m - 1U].last + 1U))) {
+      if (out[i].last > out[m - 1U].last) {
+        out[m - 1U].last = out[i].last;
+      }
+      continue;
+    }
+    out[m++] = out[i];
+  }
+
+  return (int)m;
+}
+
 /*===========================================================================*
  * HOOK MACHINE CODE
  *
@@ -570,14 +689,14 @@ static const uint8_t g_hook_connect_code[] = {
      *      ; 172.16-31.x (0xAC100000/12)
      *      ; 192.168.x.x (0xC0A80000/16)
      *
-     *  11. ; Iterate rules[0..rule_count-1]:
-     *      ;   if (ip & rule.mask) == (rule.network & rule.mask): ENETUNREACH
+     *  11. ; Binary search ranges[0..range_count-1] (host byte order):
+     *      ;   last range with first <= ip, and ip <= last: ENETUNREACH
      *
      *  12. .allow_other:
      *      ; Tail-call original_connect via jmp [rip + shared.original_connect]
      *
      *  13. .block:
-     *      ; __atomic_fetch_add(&shared.stat_blocked, 1, __ATOMIC_RELAXED)
+     *      ; lock add [shared.stats[cpuid].blocked], 1
      *      ; mov eax, ENETUNREACH (51)
      *      ; ret
      *
@@ -1070,6 +1189,15 @@ int ps5_net_filter_install(const ps5_net_filter_config_t *cfg) {
     goto fail;
   }
 
+  /* Compile the rules into the range table the hook searches */
+  ps5_hook_range_t ranges[PS5_NET_FILTER_MAX_RULES];
+  int range_count =
+      compile_ranges(resolved_cfg.rules, resolved_cfg.rule_count, ranges);
+  if (range_count < 0) {
+    rc = PS5_NET_FILTER_ERR_INVALID_PARAM;
+    goto fail;
+  }
+
   /* ------------------------------------------------------------------ */
   /* Step 2: Detect firmware version                                      */
   /* ------------------------------------------------------------------ */
@@ -1205,12 +1333,12 @@ int ps5_net_filter_install(const ps5_net_filter_config_t *cfg) {
   shared.original_sendto =
       (resolved_cfg.hook_sendto != 0U) ? original_sendto : 0U;
   shared.zftpd_pid = (int32_t)getpid();
-  shared.rule_count = resolved_cfg.rule_count;
+  shared.range_count = (uint32_t)range_count;
   shared.td_proc_offset = (uint32_t)fw_entry->thread_proc_off;
   shared.proc_pid_offset = (uint32_t)fw_entry->proc_pid_off;
+  shared.pcpu_cpuid_offset = PCPU_CPUID_OFFSET;
 
-  memcpy(shared.rules, resolved_cfg.rules,
-         resolved_cfg.rule_count * sizeof(ps5_net_filter_rule_t));
+  memcpy(shared.ranges, ranges, (size_t)range_count * sizeof(ranges[0]));
 
   memcpy(g_hook_page_mirror + HOOK_SHARED_DATA_OFFSET, &shared, sizeof(shared));
 
@@ -1397,23 +1525,28 @@ int ps5_net_filter_get_stats(ps5_net_filter_stats_t *out) {
   }
 
   /*
-   * Copy the shared block from the kernel page.
+   * Copy the per-CPU stat slots from the kernel page and sum them.
    * Use kernel_copyout() for an up-to-date snapshot.
    *
-   * The stat fields are volatile int64_t updated with LOCK XADD by the
-   * hook, so we don't need additional synchronisation beyond the copy itself.
+   * Each counter is an aligned int64_t bumped with a locked add, so every
+   * value read is whole; the sum is a snapshot that may trail in-flight
+   * hooks by a few calls, which is fine for statistics.
    */
-  ps5_hook_shared_t shared;
-  memset(&shared, 0, sizeof(shared));
-
-  uintptr_t shared_kaddr = g_hook_page_kaddr + HOOK_SHARED_DATA_OFFSET;
-  (void)kernel_copyout((intptr_t)shared_kaddr, &shared, sizeof(shared));
-
-  out->blocked_total = (uint64_t)shared.stat_blocked;
-  out->allowed_self = (uint64_t)shared.stat_allowed_self;
-  out->allowed_local = (uint64_t)shared.stat_allowed_local;
-  out->allowed_other = (uint64_t)shared.stat_allowed_other;
-  out->hook_calls_total = (uint64_t)shared.stat_hook_calls;
+  ps5_hook_stat_slot_t slots[HOOK_STAT_SLOTS];
+  memset(slots, 0, sizeof(slots));
+
+  uintptr_t stats_kaddr = g_hook_page_kaddr + HOOK_SHARED_DATA_OFFSET +
+                          offsetof(ps5_hook_shared_t, stats);
+  (void)kernel_copyout((intptr_t)stats_kaddr, slots, sizeof(slots));
+
+  memset(out, 0, sizeof(*out));
+  for (uint32_t i = 0U; i < HOOK_STAT_SLOTS; i++) {
+    out->blocked_total += (uint64_t)slots[i].blocked;
+    out->allowed_self += (uint64_t)slots[i].allowed_self;
+    out->allowed_local += (uint64_t)slots[i].allowed_local;
+    out->allowed_other += (uint64_t)slots[i].allowed_other;
+    out->hook_calls_total += (uint64_t)slots[i].hook_calls;
+  }
 
   return PS5_NET_FILTER_OK;
 }
@@ -87,15 +87,27 @@
  *   +0x00   uintptr_t  original_connect    (8 bytes)
  *   +0x08   uintptr_t  original_sendto     (8 bytes)
  *   +0x10   int32_t    zftpd_pid           (4 bytes)
- *   +0x14   uint32_t   rule_count          (4 bytes)
- *   +0x18   rule_t     rules[32]           (32 × 8 = 256 bytes)
- *   +0x118  uint32_t   td_proc_offset      (4 bytes)
- *   +0x11C  uint32_t   proc_pid_offset     (4 bytes)
- *   +0x120  int64_t    stat_blocked        (8 bytes)
- *   +0x128  int64_t    stat_allowed_self   (8 bytes)
- *   +0x130  int64_t    stat_allowed_local  (8 bytes)
- *   +0x138  int64_t    stat_allowed_other  (8 bytes)
- *   +0x140  int64_t    stat_hook_calls     (8 bytes)
+ *   +0x14   uint32_t   range_count         (4 bytes)
+ *   +0x18   uint32_t   td_proc_offset      (4 bytes)
+ *   +0x1C   uint32_t   proc_pid_offset     (4 bytes)
+ *   +0x20   uint32_t   pcpu_cpuid_offset   (4 bytes)
+ *   +0x28   range_t    ranges[32]          (32 × 8 = 256 bytes)
+ *   +0x140  stat_slot  stats[16]           (16 × 64 = 1024 bytes)
+ *
+ * ranges[] is the block list compiled at install time: inclusive
+ * [first, last] IPv4 ranges in HOST byte order, sorted by first, merged so
+ * that no two overlap or touch.  One binary search answers "blocked?".
+ *
+ * stats[] holds one 64-byte slot per CPU (indexed by pcpu cpuid, masked to
+ * the slot count).  A hook only writes the slot of the CPU it runs on, so
+ * the counter lines never bounce between cores; userland sums the slots.
+ *
+ *   Slot    Field
+ *   +0x00   int64_t    blocked
+ *   +0x08   int64_t    allowed_self
+ *   +0x10   int64_t    allowed_local
+ *   +0x18   int64_t    allowed_other
+ *   +0x20   int64_t    hook_calls
  */
 
 #ifdef PS5_HOOK_BUILD
@@ -144,18 +156,29 @@ typedef signed long long s64;
 #define SHARED_ORIGINAL_CONNECT_OFF  0x00U
 #define SHARED_ORIGINAL_SENDTO_OFF   0x08U
 #define SHARED_ZFTPD_PID_OFF         0x10U
-#define SHARED_RULE_COUNT_OFF        0x14U
-#define SHARED_RULES_OFF             0x18U   /* rule_t rules[32] */
-#define SHARED_TD_PROC_OFF           0x118U
-#define SHARED_PROC_PID_OFF          0x11CU
-#define SHARED_STAT_BLOCKED_OFF      0x120U
-#define SHARED_STAT_SELF_OFF         0x128U
-#define SHARED_STAT_LOCAL_OFF        0x130U
-#define SHARED_STAT_OTHER_OFF        0x138U
-#define SHARED_STAT_CALLS_OFF        0x140U
-
-/** Size of one rule_t entry (network u32 + mask u32) */
-#define RULE_SIZE  8U
+#define SHARED_RANGE_COUNT_OFF       0x14U
+#define SHARED_TD_PROC_OFF           0x18U
+#define SHARED_PROC_PID_OFF          0x1CU
+#define SHARED_PCPU_CPUID_OFF        0x20U
+#define SHARED_RANGES_OFF            0x28U   /* range_t ranges[32] */
+#define SHARED_STATS_OFF             0x140U  /* stat_slot stats[16] */
+
+/** Size of one range_t entry (first u32 + last u32) */
+#define RANGE_SIZE  8U
+
+/** Capacity of ranges[] (PS5_NET_FILTER_MAX_RULES) */
+#define RANGE_MAX   32U
+
+/** Per-CPU stat slots: one cache line each, count is a power of two */
+#define STAT_SLOTS      16U
+#define STAT_SLOT_SIZE  64U
+
+/** Counter offsets within a stat slot */
+#define STAT_BLOCKED    0x00U
+#define STAT_SELF       0x08U
+#define STAT_LOCAL      0x10U
+#define STAT_OTHER      0x18U
+#define STAT_CALLS      0x20U
 
 /*===========================================================================*
  * KERNEL copyin / copyout PROTOTYPES
@@ -252,66 +275,82 @@ int is_local_address(u32 ip_nbo)
 }
 
 /*===========================================================================*
- * HELPER: MATCH IP AGAINST RULE TABLE
+ * HELPER: MATCH IP AGAINST THE RANGE TABLE
  *===========================================================================*/
 
 /**
- * @brief Check if ip_nbo matches any rule in the block table.
+ * @brief Check if ip_host falls in one of the compiled block ranges.
  *
- * @param ip_nbo     Destination IP (network byte order, LE-loaded u32).
- * @param rules_ptr  Kernel VA of rules[] in the shared block.
- * @param rule_count Number of rules (bounded by PS5_NET_FILTER_MAX_RULES).
+ * @param ip_host     Destination IP in HOST byte order.
+ * @param ranges      Kernel VA of ranges[] in the shared block.
+ * @param range_count Number of ranges (bounded by RANGE_MAX).
  *
  * @return 1 if the IP should be blocked, 0 otherwise.
  *
- * @note  WCET: O(rule_count) — at most 32 iterations.
- *        Each iteration: 3 reads + 2 ANDs + 1 compare = ~8 cycles.
- *        Total worst-case: ~256 cycles ≈ 0.1 µs @ 3.5 GHz.  Negligible.
+ * @note  ranges[] is sorted and disjoint, so the only candidate is the last
+ *        range whose first address is <= ip_host.  Lower-bound search:
+ *        WCET O(log2 range_count) — at most 6 probes for 32 ranges, against
+ *        32 mask-and-compare rounds for the linear rule scan it replaces.
  */
 static inline __attribute__((always_inline))
-int ip_matches_blocklist(u32 ip_nbo,
-                         const u64 *rules_ptr,
-                         u32 rule_count)
+int ip_in_ranges(u32 ip_host, const volatile u8 *ranges, u32 range_count)
 {
-    /*
-     * rules_ptr points to an array of rule_t:
-     *   struct rule_t { u32 network; u32 mask; };
-     *
-     * Stored as two consecutive u32 (network byte order in memory).
-     * We read them as two u32 from the kernel page directly.
-     */
-
-    if (rule_count > 32U) {
-        rule_count = 32U;  /* Defensive clamp — should never be needed */
+    if (range_count > RANGE_MAX) {
+        range_count = RANGE_MAX;  /* Defensive clamp — should never be needed */
     }
 
-    for (u32 i = 0U; i < rule_count; i++) {
-        /*
-         * Each rule is 8 bytes: [network:4][mask:4]
-         * We cast rules_ptr to a byte stream for clarity.
-         */
-        const u8 *rule_bytes = (const u8 *)rules_ptr + (u64)(i * 8U);
+    u32 lo = 0U;
+    u32 hi = range_count;
+    while (lo < hi) {
+        u32 mid = (lo + hi) >> 1U;
+        u32 first;
+        __builtin_memcpy(&first, (const u8 *)ranges + (u64)(mid * RANGE_SIZE),
+                         sizeof(u32));
+        if (first <= ip_host) {
+            lo = mid + 1U;
+        } else {
+            hi = mid;
+        }
+    }
 
-        u32 network;
-        u32 mask;
+    if (lo == 0U) {
+        return 0;  /* Below the first range */
+    }
 
-        /* Safe kernel-memory reads (already in kernel space, no copyin needed) */
-        __builtin_memcpy(&network, rule_bytes,     sizeof(u32));
-        __builtin_memcpy(&mask,    rule_bytes + 4U, sizeof(u32));
+    u32 last;
+    __builtin_memcpy(&last,
+                     (const u8 *)ranges + (u64)((lo - 1U) * RANGE_SIZE) + 4U,
+                     sizeof(u32));
+    return (ip_host <= last) ? 1 : 0;
+}
 
-        /*
-         * Match condition: (ip & mask) == (network & mask)
-         *
-         * Both ip_nbo and the stored network/mask are in the same byte
-         * order (LE-loaded network-byte-order u32), so the comparison
-         * is direct.
-         */
-        if ((ip_nbo & mask) == (network & mask)) {
-            return 1;
-        }
-    }
+/*===========================================================================*
+ * HELPER: PER-CPU STAT INCREMENT
+ *===========================================================================*/
 
-    return 0;
+/**
+ * @brief Increment one counter in the current CPU's stat slot.
+ *
+ * The CPU id comes from the per-CPU area (%gs:pc_cpuid, offset patched in
+ * the shared block).  The add keeps its LOCK prefix: the thread may migrate
+ * between reading the id and the add, so two CPUs can occasionally hit the
+ * same slot.  In the common case the line is already owned by this core and
+ * the locked add never leaves its L1.
+ */
+static inline __attribute__((always_inline))
+void stat_bump(const volatile u8 *sh, u32 counter)
+{
+    u32 cpuid_off;
+    u32 cpu;
+    __builtin_memcpy(&cpuid_off, sh + SHARED_PCPU_CPUID_OFF, sizeof(u32));
+    __asm__ __volatile__ ("movl %%gs:(%1), %0"
+                          : "=r" (cpu) : "r" ((u64)cpuid_off));
+
+    volatile s64 *p = (volatile s64 *)(sh + SHARED_STATS_OFF +
+                                       (u64)((cpu & (STAT_SLOTS - 1U)) *
+                                             STAT_SLOT_SIZE) +
+                                       counter);
+    __asm__ __volatile__ ("lock addq $1, (%0)" : : "r" (p) : "memory");
 }
 
 /*===========================================================================*
@@ -368,15 +407,7 @@ int hook_sys_connect(void *td, void *uap)
     }
 
     /* ── stat: increment total hook calls ──────────────────────────────── */
-    {
-        volatile s64 *p_calls = (volatile s64 *)(sh + SHARED_STAT_CALLS_OFF);
-        __asm__ __volatile__ (
-            "lock xaddq %0, (%1)"
-            : "+r" ((s64){1})
-            : "r"  (p_calls)
-            : "memory"
-        );
-    }
+    stat_bump(sh, STAT_CALLS);
 
     /* ── Extract zftpd PID and current process PID ──────────────────────── */
     s32 zftpd_pid;
@@ -414,9 +445,7 @@ int hook_sys_connect(void *td, void *uap)
 
     /* ── FAST PATH: zftpd's own connections always allowed ──────────────── */
     if (caller_pid == zftpd_pid) {
-        volatile s64 *p_self = (volatile s64 *)(sh + SHARED_STAT_SELF_OFF);
-        __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                              : "+r" ((s64){1}) : "r" (p_self) : "memory");
+        stat_bump(sh, STAT_SELF);
         goto call_original;
     }
 
@@ -496,34 +525,23 @@ int hook_sys_connect(void *td, void *uap)
         goto allow_local;
     }
 
-    /* ── Check against the block list ──────────────────────────────────── */
-    u32 rule_count;
-    __builtin_memcpy(&rule_count, sh + SHARED_RULE_COUNT_OFF, sizeof(u32));
+    /* ── Check against the compiled block ranges (host byte order) ─────── */
+    u32 range_count;
+    __builtin_memcpy(&range_count, sh + SHARED_RANGE_COUNT_OFF, sizeof(u32));
 
-    const u64 *rules_ptr = (const u64 *)(sh + SHARED_RULES_OFF);
-
-    if (ip_matches_blocklist(dest_ip, rules_ptr, rule_count) != 0) {
+    if (ip_in_ranges(__builtin_bswap32(dest_ip), sh + SHARED_RANGES_OFF,
+                     range_count) != 0) {
         /* BLOCK: increment stat and return ENETUNREACH */
-        volatile s64 *p_blocked = (volatile s64 *)(sh + SHARED_STAT_BLOCKED_OFF);
-        __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                              : "+r" ((s64){1}) : "r" (p_blocked) : "memory");
+        stat_bump(sh, STAT_BLOCKED);
         return ENETUNREACH;
     }
 
 allow_other:
-    {
-        volatile s64 *p_other = (volatile s64 *)(sh + SHARED_STAT_OTHER_OFF);
-        __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                              : "+r" ((s64){1}) : "r" (p_other) : "memory");
-    }
+    stat_bump(sh, STAT_OTHER);
     goto call_original;
 
 allow_local:
-    {
-        volatile s64 *p_local = (volatile s64 *)(sh + SHARED_STAT_LOCAL_OFF);
-        __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                              : "+r" ((s64){1}) : "r" (p_local) : "memory");
-    }
+    stat_bump(sh, STAT_LOCAL);
 
 call_original:
     {
@@ -581,11 +599,7 @@ int hook_sys_sendto(void *td, void *uap)
     }
 
     /* Increment total call count */
-    {
-        volatile s64 *p_calls = (volatile s64 *)(sh + SHARED_STAT_CALLS_OFF);
-        __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                              : "+r" ((s64){1}) : "r" (p_calls) : "memory");
-    }
+    stat_bump(sh, STAT_CALLS);
 
     /* Quick PID check */
     s32 zftpd_pid;
@@ -600,9 +614,7 @@ int hook_sys_sendto(void *td, void *uap)
         s32 caller_pid = -1;
         __builtin_memcpy(&caller_pid, (const u8 *)td_proc + proc_pid_off, sizeof(s32));
         if (caller_pid == zftpd_pid) {
-            volatile s64 *p = (volatile s64 *)(sh + SHARED_STAT_SELF_OFF);
-            __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                                  : "+r" ((s64){1}) : "r" (p) : "memory");
+            stat_bump(sh, STAT_SELF);
             goto sendto_call_original;
         }
     }
@@ -642,29 +654,21 @@ int hook_sys_sendto(void *td, void *uap)
     __builtin_memcpy(&dest_ip, sa_buf + SIN_ADDR_OFFSET, sizeof(u32));
 
     if (is_local_address(dest_ip) != 0) {
-        volatile s64 *p = (volatile s64 *)(sh + SHARED_STAT_LOCAL_OFF);
-        __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                              : "+r" ((s64){1}) : "r" (p) : "memory");
+        stat_bump(sh, STAT_LOCAL);
         goto sendto_call_original;
     }
 
-    u32 rule_count;
-    __builtin_memcpy(&rule_count, sh + SHARED_RULE_COUNT_OFF, sizeof(u32));
-    const u64 *rules_ptr = (const u64 *)(sh + SHARED_RULES_OFF);
+    u32 range_count;
+    __builtin_memcpy(&range_count, sh + SHARED_RANGE_COUNT_OFF, sizeof(u32));
 
-    if (ip_matches_blocklist(dest_ip, rules_ptr, rule_count) != 0) {
-        volatile s64 *p = (volatile s64 *)(sh + SHARED_STAT_BLOCKED_OFF);
-        __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                              : "+r" ((s64){1}) : "r" (p) : "memory");
+    if (ip_in_ranges(__builtin_bswap32(dest_ip), sh + SHARED_RANGES_OFF,
+                     range_count) != 0) {
+        stat_bump(sh, STAT_BLOCKED);
         return ENETUNREACH;
     }
 
 sendto_allow_other:
-    {
-        volatile s64 *p = (volatile s64 *)(sh + SHARED_STAT_OTHER_OFF);
-        __asm__ __volatile__ ("lock xaddq %0, (%1)"
-                              : "+r" ((s64){1}) : "r" (p) : "memory");
-    }
+    stat_bump(sh, STAT_OTHER);
 
 sendto_call_original:
     {
@@ -0,0 +1,128 @@
+#include "ftp_server.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define ACCEPTORS 4U
+#define CLIENTS 32
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+/* Connect only; the greeting is read later */
+static int dial(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval tv = {5, 0};
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    (void)inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int greeted(int fd)
+{
+    char buf[256];
+    ssize_t n = recv(fd, buf, sizeof(buf) - 1U, 0);
+    return (n >= 3) && (strncmp(buf, "220", 3) == 0);
+}
+
+int main(void)
+{
+    static ftp_server_context_t ctx;
+    uint16_t port = (uint16_t)(30000 + ((getpid() + 7) % 20000));
+
+    if (ftp_server_init(&ctx, "127.0.0.1", port, "/tmp") != FTP_OK) {
+        printf("acceptors: cannot listen on %u\n", port);
+        return 1;
+    }
+    CHECK(ftp_server_set_acceptors(&ctx, 0U) != FTP_OK, "zero rejected");
+    CHECK(ftp_server_set_acceptors(&ctx, FTP_ACCEPT_THREADS_MAX + 1U) !=
+              FTP_OK,
+          "above the cap rejected");
+    CHECK(ftp_server_set_acceptors(&ctx, ACCEPTORS) == FTP_OK, "acceptors");
+    CHECK(ftp_server_set_listen_backlog(&ctx, 0U) != FTP_OK,
+          "zero backlog rejected");
+    CHECK(ftp_server_set_listen_backlog(&ctx, 128U) == FTP_OK, "backlog");
+    CHECK(ftp_server_set_max_sessions(&ctx, CLIENTS) == FTP_OK, "limit");
+
+    if (ftp_server_start(&ctx) != FTP_OK) {
+        ftp_server_cleanup(&ctx);
+        return 1;
+    }
+    CHECK(ftp_server_set_acceptors(&ctx, 1U) != FTP_OK,
+          "acceptors fixed once running");
+
+    ftp_server_stats_t st;
+    ftp_server_get_stats_ex(&ctx, &st);
+    CHECK(st.acceptors == ACCEPTORS, "all listeners opened");
+    CHECK(st.listen_backlog == 128U, "backlog reported");
+
+    /* Connection storm: everyone connects before anyone reads */
+    int fds[CLIENTS];
+    for (int i = 0; i < CLIENTS; i++) {
+        fds[i] = dial(port);
+        CHECK(fds[i] >= 0, "connect");
+    }
+    int ok = 0;
+    for (int i = 0; i < CLIENTS; i++) {
+        if ((fds[i] >= 0) && greeted(fds[i])) {
+            ok++;
+        }
+    }
+    CHECK(ok == CLIENTS, "every client greeted");
+
+    ftp_server_get_stats_ex(&ctx, &st);
+    CHECK(st.total_connections == (uint64_t)CLIENTS, "connections counted");
+    CHECK(st.accept_latency_max_ns > 0U, "latency measured");
+    CHECK(st.accept_latency_avg_ns <= st.accept_latency_max_ns,
+          "avg <= max");
+    CHECK(st.start_queue_peak >= 1U, "starts went through the queue");
+    CHECK(st.start_queue_depth == 0U, "queue drained");
+
+    /* Backlog changes on the running listeners */
+    CHECK(ftp_server_set_listen_backlog(&ctx, 64U) == FTP_OK,
+          "backlog while running");
+
+    for (int i = 0; i < CLIENTS; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+
+    ftp_server_stop(&ctx);
+    CHECK(ftp_server_get_active_sessions(&ctx) == 0U, "drained on stop");
+    int late = dial(port);
+    CHECK(late < 0, "port closed after stop");
+    if (late >= 0) {
+        close(late);
+    }
+    ftp_server_cleanup(&ctx);
+
+    if (failures != 0) {
+        printf("acceptors: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("acceptors: OK\n");
+    return 0;
+}
@@ -69,6 +69,180 @@ static void *worker(void *arg)
     return NULL;
 }
 
+#define SMALL_OBJS 2000
+#define PRIVATE_ARENA_SIZE (256U * 1024U)
+
+static _Alignas(4096) uint8_t g_private_arena[PRIVATE_ARENA_SIZE];
+
+/* Small objects allocated here, freed by the main thread */
+static void *small_producer(void *arg)
+{
+    void **objs = (void **)arg;
+    for (int i = 0; i < SMALL_OBJS; i++) {
+        objs[i] = pal_malloc((size_t)(i % 4096) + 1U);
+        if (objs[i] == NULL) {
+            return (void *)1;
+        }
+        memset(objs[i], 0x5A, (size_t)(i % 4096) + 1U);
+    }
+    return NULL;
+}
+
+static int test_slabs(void)
+{
+    /* A freed small object is the next one handed out on this thread */
+    void *p = pal_malloc(100U);
+    if (p == NULL) {
+        return 30;
+    }
+    pal_free(p);
+    if (pal_malloc(100U) != p) {
+        return 31;
+    }
+    void *grown = pal_realloc(p, 128U);
+    if (grown != p) {
+        return 32; /* still inside the 128-byte class */
+    }
+    grown = pal_realloc(p, 5000U);
+    if ((grown == NULL) || (grown == p)) {
+        return 33;
+    }
+    pal_free(grown);
+
+    static void *objs[SMALL_OBJS];
+    pthread_t th;
+    void *ret = NULL;
+    if ((pthread_create(&th, NULL, small_producer, objs) != 0) ||
+        (pthread_join(th, &ret) != 0) || (ret != NULL)) {
+        return 34;
+    }
+    for (int i = 0; i < SMALL_OBJS; i++) {
+        pal_free(objs[i]);
+    }
+
+    /* Slab pages stay within their share of a private arena */
+    static pal_allocator_t arena;
+    if (pal_allocator_init(&arena, g_private_arena, sizeof(g_private_arena)) != 0) {
+        return 35;
+    }
+    static void *small[PRIVATE_ARENA_SIZE / 64U];
+    size_t n = 0U;
+    while (n < (sizeof(small) / sizeof(small[0]))) {
+        small[n] = pal_allocator_malloc(&arena, 48U);
+        if (small[n] == NULL) {
+            break;
+        }
+        n++;
+    }
+    pal_alloc_stats_t st;
+    pal_allocator_get_stats(&arena, &st);
+    if ((st.slab_bytes == 0U) || (st.slab_bytes > PRIVATE_ARENA_SIZE / PAL_ALLOC_SLAB_SHARE)) {
+        return 36;
+    }
+    if ((st.alloc_calls != n) || (st.failures != 1U) || (n < 2000U)) {
+        return 37; /* the buddy path took over past the slab share */
+    }
+    for (size_t i = 0U; i < n; i++) {
+        pal_allocator_free(&arena, small[i]);
+    }
+    pal_allocator_get_stats(&arena, &st);
+    if ((st.bytes_in_use != 0U) || (st.free_calls != n)) {
+        return 38;
+    }
+    return 0;
+}
+
+#define LARGE_ARENA_SIZE (2U * 1024U * 1024U)
+#define LARGE_BLOCK (300U * 1024U)
+
+static _Alignas(4096) uint8_t g_large_arena[LARGE_ARENA_SIZE];
+
+static int test_large(void)
+{
+    /* Small and mid-size blocks leave the large region alone */
+    pal_alloc_frag_t f0;
+    pal_alloc_get_frag(&f0);
+    if ((f0.large_size == 0U) || (f0.large_extents != 1U) || (f0.large_free != f0.large_size)) {
+        return 40;
+    }
+    static void *mid[512];
+    for (size_t i = 0U; i < 512U; i++) {
+        mid[i] = pal_malloc(8192U + i);
+        if (mid[i] == NULL) {
+            return 41;
+        }
+    }
+    pal_alloc_frag_t f;
+    pal_alloc_get_frag(&f);
+    if ((f.large_free != f0.large_size) || (f.buddy_free >= f0.buddy_free)) {
+        return 42;
+    }
+
+    /* Three large blocks, then free the middle one: a hole */
+    uint8_t *blk[3];
+    for (size_t i = 0U; i < 3U; i++) {
+        blk[i] = (uint8_t *)pal_malloc(1024U * 1024U);
+        if (blk[i] == NULL) {
+            return 43;
+        }
+        memset(blk[i], (int)i + 1, 1024U * 1024U);
+    }
+    pal_free(blk[1]);
+    pal_alloc_get_frag(&f);
+    if ((f.large_extents != 2U) || (f.large_largest >= f.large_free)) {
+        return 44;
+    }
+    /* Best fit refills the hole instead of cutting the big extent */
+    uint8_t *hole = blk[1];
+    blk[1] = (uint8_t *)pal_malloc(1000U * 1024U);
+    if ((blk[1] < hole) || (blk[1] >= hole + 1024U * 1024U)) {
+        return 45;
+    }
+    blk[0] = (uint8_t *)pal_realloc(blk[0], 3U * 1024U * 1024U);
+    if ((blk[0] == NULL) || (blk[0][0] != 1U) || (blk[0][1024U * 1024U - 1U] != 1U)) {
+        return 46;
+    }
+    for (size_t i = 0U; i < 3U; i++) {
+        pal_free(blk[i]);
+    }
+    for (size_t i = 0U; i < 512U; i++) {
+        pal_free(mid[i]);
+    }
+    pal_alloc_get_frag(&f);
+    if ((f.large_extents != 1U) || (f.large_largest != f.large_size) ||
+        (f.buddy_free != f0.buddy_free) || (f.buddy_largest != f0.buddy_largest)) {
+        return 47; /* everything coalesced back */
+    }
+
+    /* A full large region spills into the buddy area */
+    static pal_allocator_t arena;
+    if ((pal_allocator_init(&arena, g_large_arena, sizeof(g_large_arena)) != 0) ||
+        (arena.large_base == NULL)) {
+        return 48;
+    }
+    void *big[4];
+    for (size_t i = 0U; i < 4U; i++) {
+        big[i] = pal_allocator_malloc(&arena, LARGE_BLOCK);
+        if (big[i] == NULL) {
+            return 49;
+        }
+    }
+    uint8_t *spill = (uint8_t *)big[3];
+    if ((spill < arena.base) || (spill >= arena.base + arena.size)) {
+        return 50;
+    }
+    for (size_t i = 0U; i < 4U; i++) {
+        pal_allocator_free(&arena, big[i]);
+    }
+    pal_allocator_free(&arena, big[0]);
+    pal_alloc_stats_t st;
+    pal_allocator_get_stats(&arena, &st);
+    if ((st.bytes_in_use != 0U) || (st.free_calls != 4U)) {
+        return 51; /* the double free was refused */
+    }
+    return 0;
+}
+
 int main(void)
 {
     if (pal_alloc_init(g_test_arena, sizeof(g_test_arena)) != 0) {
@@ -127,6 +301,15 @@ int main(void)
     }
     pal_free(m);
 
+    int rc = test_slabs();
+    if (rc != 0) {
+        return rc;
+    }
+    rc = test_large();
+    if (rc != 0) {
+        return rc;
+    }
+
     pal_alloc_stats_t st;
     pal_alloc_get_stats(&st);
     if (st.failures != 0U) {
@@ -37,5 +37,55 @@ int main(void)
         ftp_buffer_release(bufs[i]);
     }
  
+    /* Size classes: best fit first, next class up when exhausted */
+    size_t got = 0U;
+    void *small = ftp_buffer_acquire_size(1U, &got);
+    if ((small == NULL) || (got != (size_t)FTP_BUFFER_SMALL_SIZE)) {
+        return 5;
+    }
+    ftp_buffer_release(small);
+
+    void *large = ftp_buffer_acquire_size((size_t)FTP_STREAM_BUFFER_SIZE + 1U,
+                                          &got);
+    if ((large == NULL) || (got != (size_t)FTP_BUFFER_LARGE_SIZE)) {
+        return 6;
+    }
+    ftp_buffer_release(large);
+
+    if (ftp_buffer_acquire_size((size_t)FTP_BUFFER_LARGE_SIZE + 1U, &got) !=
+        NULL || got != 0U) {
+        return 7;
+    }
+
+    for (size_t i = 0U; i < (size_t)FTP_MAX_SESSIONS; i++) {
+        bufs[i] = ftp_buffer_acquire();
+    }
+    void *spill = ftp_buffer_acquire_size((size_t)FTP_BUFFER_SMALL_SIZE + 1U,
+                                          &got);
+    if ((spill == NULL) || (got != (size_t)FTP_BUFFER_LARGE_SIZE)) {
+        return 8;
+    }
+
+    ftp_buffer_class_stats_t st[FTP_BUFFER_CLASSES];
+    ftp_buffer_get_stats(st);
+    if ((st[FTP_BUFFER_STREAM].in_use != (uint32_t)FTP_MAX_SESSIONS) ||
+        (st[FTP_BUFFER_STREAM].waits < 2U) ||
+        (st[FTP_BUFFER_LARGE].in_use != 1U) ||
+        (st[FTP_BUFFER_SMALL].high_water != 1U) ||
+        (st[FTP_BUFFER_SMALL].mapped != 1U)) {
+        return 9;
+    }
+
+    ftp_buffer_release(spill);
+    for (size_t i = 0U; i < (size_t)FTP_MAX_SESSIONS; i++) {
+        ftp_buffer_release(bufs[i]);
+    }
+    ftp_buffer_get_stats(st);
+    for (int c = 0; c < (int)FTP_BUFFER_CLASSES; c++) {
+        if (st[c].in_use != 0U) {
+            return 10;
+        }
+    }
+
     return 0;
 }
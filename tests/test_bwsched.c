@@ -0,0 +1,132 @@
+#include "ftp_bwsched.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define RATE (1024U * 1024U)
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+static void test_parse(void)
+{
+    uint64_t v = 1U;
+    CHECK((ftp_bw_parse_rate("0", &v) == 0) && (v == 0U), "0");
+    CHECK((ftp_bw_parse_rate("off", &v) == 0) && (v == 0U), "off");
+    CHECK((ftp_bw_parse_rate("500000", &v) == 0) && (v == 500000U), "plain");
+    CHECK((ftp_bw_parse_rate("512K", &v) == 0) && (v == 524288U), "K");
+    CHECK((ftp_bw_parse_rate("20m", &v) == 0) && (v == 20971520U), "m");
+    CHECK((ftp_bw_parse_rate("1G", &v) == 0) && (v == 1073741824U), "G");
+    CHECK(ftp_bw_parse_rate("", &v) != 0, "empty");
+    CHECK(ftp_bw_parse_rate("M", &v) != 0, "no digits");
+    CHECK(ftp_bw_parse_rate("10MB", &v) != 0, "trailing junk");
+    CHECK(ftp_bw_parse_rate("99999999999999999999", &v) != 0, "overflow");
+    CHECK(ftp_bw_parse_rate("99999999999999G", &v) != 0, "suffix overflow");
+}
+
+typedef struct {
+    ftp_bw_client_t *c;
+    size_t want;
+    double until;
+    uint64_t bytes;
+} runner_t;
+
+static void *run(void *arg)
+{
+    runner_t *r = arg;
+    while (now_s() < r->until) {
+        r->bytes += ftp_bw_grant(r->c, r->want);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    test_parse();
+
+    /* Nothing limited: grants pass through */
+    ftp_bw_client_t a;
+    ftp_bw_client_t b;
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    ftp_bw_attach(&a, 0x0100007FU);
+    ftp_bw_attach(&b, 0x0100007FU);
+    CHECK(ftp_bw_limited() == 0, "unlimited at start");
+    CHECK(ftp_bw_grant(&a, 1U << 30) == (1U << 30), "unlimited grant");
+
+    ftp_bw_stats_t st;
+    ftp_bw_get_stats(&st);
+    CHECK((st.clients == 2U) && (st.ips == 1U), "same address shares a bucket");
+
+    /* Limited: a grant is a fair slice of the burst */
+    ftp_bw_set_rate(FTP_BW_GLOBAL, RATE);
+    CHECK(ftp_bw_limited() != 0, "limited");
+    size_t g = ftp_bw_grant(&a, 1U << 30);
+    CHECK((g > 0U) && (g <= RATE / 10U / 2U + 1U), "grant capped by slice");
+    ftp_bw_refund(&a, g, 0U);
+
+    /* Average rate holds over a long consume */
+    double t0 = now_s();
+    ftp_bw_consume(&a, 3U * RATE / 10U);
+    double dt = now_s() - t0;
+    CHECK((dt > 0.12) && (dt < 0.6), "consume paced at the rate");
+
+    /* Two sessions on one bucket split it evenly */
+    runner_t bulk = {&a, 1U << 20, now_s() + 0.6, 0U};
+    runner_t small = {&b, 4096U, bulk.until, 0U};
+    pthread_t th[2];
+    pthread_create(&th[0], NULL, run, &bulk);
+    pthread_create(&th[1], NULL, run, &small);
+    pthread_join(th[0], NULL);
+    pthread_join(th[1], NULL);
+    uint64_t total = bulk.bytes + small.bytes;
+    CHECK(total < (uint64_t)RATE, "total within the limit");
+    CHECK(small.bytes > total / 5U, "small sender not starved");
+    CHECK(bulk.bytes > total / 5U, "bulk sender not starved");
+
+    /* Per-session and per-IP levels stack with the global one */
+    ftp_bw_set_rate(FTP_BW_GLOBAL, 0U);
+    ftp_bw_set_rate(FTP_BW_SESSION, 64U * 1024U);
+    t0 = now_s();
+    ftp_bw_consume(&b, 32U * 1024U);
+    dt = now_s() - t0;
+    CHECK((dt > 0.3) && (dt < 1.0), "session rate");
+    ftp_bw_set_rate(FTP_BW_SESSION, 0U);
+
+    ftp_bw_set_rate(FTP_BW_PER_IP, RATE);
+    g = ftp_bw_grant(&b, 1U << 30);
+    CHECK((g > 0U) && (g <= RATE / 10U / 2U + 1U), "per-IP slice");
+    ftp_bw_set_rate(FTP_BW_PER_IP, 0U);
+    CHECK(ftp_bw_limited() == 0, "limits lifted");
+
+    ftp_bw_get_stats(&st);
+    CHECK(st.waits > 0U, "waits counted");
+
+    ftp_bw_detach(&a);
+    ftp_bw_detach(&b);
+    ftp_bw_detach(&b);
+    ftp_bw_get_stats(&st);
+    CHECK((st.clients == 0U) && (st.ips == 0U), "detached");
+
+    if (failures != 0) {
+        printf("bwsched: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("bwsched: OK\n");
+    return 0;
+}
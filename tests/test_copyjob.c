@@ -0,0 +1,313 @@
+#include "ftp_copyjob.h"
+#include "pal_alloc.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+/* The default arena is too small for the 4 MB copy buffers */
+static _Alignas(4096) unsigned char g_arena[64U * 1024U * 1024U];
+
+#define SMALL_FILES 40U
+#define BIG_SIZE (6U * 1024U * 1024U) /* > FTP_COPYJOB_SMALL_FILE */
+/* Enough files that a job is still running right after its submit */
+#define MANY_FILES 800U
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static void write_file(const char *path, size_t size, unsigned seed)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    unsigned char buf[4096];
+    size_t done = 0U;
+    while (done < size) {
+        size_t n = (size - done < sizeof(buf)) ? (size - done) : sizeof(buf);
+        for (size_t i = 0U; i < n; i++) {
+            buf[i] = (unsigned char)((done + i) * 31U + seed);
+        }
+        (void)write(fd, buf, n);
+        done += n;
+    }
+    close(fd);
+}
+
+static int same_file(const char *a, const char *b)
+{
+    FILE *fa = fopen(a, "rb");
+    FILE *fb = fopen(b, "rb");
+    int same = ((fa != NULL) && (fb != NULL)) ? 1 : 0;
+    while (same != 0) {
+        int ca = fgetc(fa);
+        int cb = fgetc(fb);
+        if (ca != cb) {
+            same = 0;
+        }
+        if (ca == EOF) {
+            break;
+        }
+    }
+    if (fa != NULL) {
+        fclose(fa);
+    }
+    if (fb != NULL) {
+        fclose(fb);
+    }
+    return same;
+}
+
+/* src/{big.bin, d<k>/f<i>.txt} */
+static void make_tree(const char *root, unsigned seed)
+{
+    char path[FTP_PATH_MAX];
+    (void)mkdir(root, 0755);
+    snprintf(path, sizeof(path), "%s/big.bin", root);
+    write_file(path, BIG_SIZE, seed);
+    for (unsigned i = 0U; i < SMALL_FILES; i++) {
+        snprintf(path, sizeof(path), "%s/d%u", root, i % 4U);
+        (void)mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/d%u/f%u.txt", root, i % 4U, i);
+        write_file(path, 100U + (i * 37U), seed + i);
+    }
+}
+
+/* root/m<k>/f<i> */
+static void make_many(const char *root)
+{
+    char path[FTP_PATH_MAX];
+    (void)mkdir(root, 0755);
+    for (unsigned i = 0U; i < MANY_FILES; i++) {
+        snprintf(path, sizeof(path), "%s/m%u", root, i % 8U);
+        (void)mkdir(path, 0755);
+        snprintf(path, sizeof(path), "%s/m%u/f%u", root, i % 8U, i);
+        write_file(path, 64U, i);
+    }
+}
+
+static int same_tree(const char *a, const char *b)
+{
+    char pa[FTP_PATH_MAX];
+    char pb[FTP_PATH_MAX];
+    snprintf(pa, sizeof(pa), "%s/big.bin", a);
+    snprintf(pb, sizeof(pb), "%s/big.bin", b);
+    int same = same_file(pa, pb);
+    for (unsigned i = 0U; (i < SMALL_FILES) && (same != 0); i++) {
+        snprintf(pa, sizeof(pa), "%s/d%u/f%u.txt", a, i % 4U, i);
+        snprintf(pb, sizeof(pb), "%s/d%u/f%u.txt", b, i % 4U, i);
+        same = same_file(pa, pb);
+    }
+    return same;
+}
+
+static void remove_tree(const char *root)
+{
+    char cmd[FTP_PATH_MAX + 16];
+    snprintf(cmd, sizeof(cmd), "rm -rf '%s'", root);
+    (void)system(cmd);
+}
+
+int main(void)
+{
+    if (pal_alloc_init(g_arena, sizeof(g_arena)) != 0) {
+        return 1;
+    }
+    char base_template[] = "/tmp/zftpd-copyjob-XXXXXX";
+    char *base = mkdtemp(base_template);
+    if (base == NULL) {
+        return 1;
+    }
+    char src1[FTP_PATH_MAX];
+    char src2[FTP_PATH_MAX];
+    char dst1[FTP_PATH_MAX];
+    char dst2[FTP_PATH_MAX];
+    snprintf(src1, sizeof(src1), "%s/src1", base);
+    snprintf(src2, sizeof(src2), "%s/src2", base);
+    snprintf(dst1, sizeof(dst1), "%s/dst1", base);
+    snprintf(dst2, sizeof(dst2), "%s/dst2", base);
+    make_tree(src1, 1U);
+    make_tree(src2, 2U);
+    char many[FTP_PATH_MAX];
+    snprintf(many, sizeof(many), "%s/many", base);
+    make_many(many);
+
+    ftp_copyjob_info_t info;
+
+    /* Two jobs at once, each with many small files and a large one */
+    uint32_t id1 = 0U;
+    uint32_t id2 = 0U;
+    CHECK(ftp_copyjob_submit(src1, dst1, 0, 0U, &id1) == FTP_OK, "submit 1");
+    CHECK(ftp_copyjob_submit(src2, dst2, 0, 0U, &id2) == FTP_OK, "submit 2");
+    CHECK((id1 != 0U) && (id2 > id1), "ids increase");
+    CHECK(ftp_copyjob_latest() == id2, "latest job");
+    CHECK(ftp_copyjob_wait(id1, 30000U) == 0, "job 1 finishes");
+    CHECK(ftp_copyjob_wait(id2, 30000U) == 0, "job 2 finishes");
+    CHECK((ftp_copyjob_get(id1, &info) == 0) &&
+              (info.state == FTP_COPYJOB_DONE),
+          "job 1 done");
+    CHECK((info.files_total == SMALL_FILES + 1U) &&
+              (info.files_done == info.files_total) && (info.scanned == 1),
+          "job 1 file counts");
+    CHECK(info.bytes_done == info.bytes_total, "job 1 bytes");
+    CHECK(same_tree(src1, dst1) != 0, "tree 1 copied");
+    CHECK(same_tree(src2, dst2) != 0, "tree 2 copied");
+
+    ftp_copyjob_info_t list[4];
+    size_t n = ftp_copyjob_list(list, 4U);
+    CHECK((n == 2U) && (list[0].id == id1) && (list[1].id == id2),
+          "list oldest first");
+
+    /* Move: the source disappears once everything is copied */
+    char moved[FTP_PATH_MAX];
+    snprintf(moved, sizeof(moved), "%s/moved", base);
+    uint32_t id3 = 0U;
+    CHECK(ftp_copyjob_submit(dst2, moved, 1, 0U, &id3) == FTP_OK, "submit move");
+    CHECK(ftp_copyjob_wait(id3, 30000U) == 0, "move finishes");
+    CHECK((ftp_copyjob_get(id3, &info) == 0) &&
+              (info.state == FTP_COPYJOB_DONE),
+          "move done");
+    CHECK(same_tree(src2, moved) != 0, "moved tree intact");
+    CHECK(access(dst2, F_OK) != 0, "move source removed");
+
+    /* Single file */
+    char one_src[FTP_PATH_MAX];
+    char one_dst[FTP_PATH_MAX];
+    snprintf(one_src, sizeof(one_src), "%s/big.bin", src1);
+    snprintf(one_dst, sizeof(one_dst), "%s/one.bin", base);
+    uint32_t id4 = 0U;
+    CHECK(ftp_copyjob_submit(one_src, one_dst, 0, 0U, &id4) == FTP_OK,
+          "submit file");
+    CHECK(ftp_copyjob_wait(id4, 30000U) == 0, "file finishes");
+    CHECK(same_file(one_src, one_dst) != 0, "file copied");
+
+    /* Pause holds the job still; resume lets it finish */
+    char paused_dst[FTP_PATH_MAX];
+    snprintf(paused_dst, sizeof(paused_dst), "%s/paused", base);
+    uint32_t id5 = 0U;
+    CHECK(ftp_copyjob_submit(many, paused_dst, 0, 123U, &id5) == FTP_OK,
+          "submit paused");
+    CHECK(ftp_copyjob_pause(id5, 1) == 0, "pause");
+    usleep(200000);
+    ftp_copyjob_info_t before;
+    CHECK((ftp_copyjob_get(id5, &before) == 0) &&
+              (before.state == FTP_COPYJOB_PAUSED),
+          "paused state");
+    usleep(200000);
+    CHECK((ftp_copyjob_get(id5, &info) == 0) &&
+              (info.bytes_done == before.bytes_done) &&
+              (info.files_done == before.files_done),
+          "no progress while paused");
+    CHECK(ftp_copyjob_pause(id5, 0) == 0, "resume");
+    CHECK(ftp_copyjob_wait(id5, 30000U) == 0, "resumed job finishes");
+    CHECK((ftp_copyjob_get(id5, &info) == 0) &&
+              (info.state == FTP_COPYJOB_DONE) &&
+              (info.files_done == MANY_FILES),
+          "resumed tree copied");
+
+    /* Cancel rolls back the destination a copy created */
+    char cancel_dst[FTP_PATH_MAX];
+    snprintf(cancel_dst, sizeof(cancel_dst), "%s/cancelled", base);
+    uint32_t id6 = 0U;
+    CHECK(ftp_copyjob_submit(many, cancel_dst, 0, 0U, &id6) == FTP_OK,
+          "submit cancelled");
+    CHECK(ftp_copyjob_pause(id6, 1) == 0, "pause before cancel");
+    CHECK(ftp_copyjob_cancel(id6) == 0, "cancel");
+    CHECK(ftp_copyjob_wait(id6, 30000U) == 0, "cancelled job finishes");
+    CHECK((ftp_copyjob_get(id6, &info) == 0) &&
+              (info.state == FTP_COPYJOB_CANCELLED),
+          "cancelled state");
+    CHECK(access(cancel_dst, F_OK) != 0, "cancelled destination removed");
+    CHECK(ftp_copyjob_cancel(id6) == -1, "cancel of a finished job");
+
+    /* Missing source fails with the scan error */
+    char missing[FTP_PATH_MAX];
+    snprintf(missing, sizeof(missing), "%s/missing", base);
+    uint32_t id7 = 0U;
+    CHECK(ftp_copyjob_submit(missing, one_dst, 0, 0U, &id7) == FTP_OK,
+          "submit missing");
+    CHECK(ftp_copyjob_wait(id7, 30000U) == 0, "missing finishes");
+    CHECK((ftp_copyjob_get(id7, &info) == 0) &&
+              (info.state == FTP_COPYJOB_FAILED) &&
+              (info.error_code == FTP_ERR_NOT_FOUND),
+          "missing source fails");
+
+    /* Finished jobs make room for new ones */
+    uint32_t last = 0U;
+    for (unsigned i = 0U; i < FTP_COPYJOB_MAX + 2U; i++) {
+        CHECK(ftp_copyjob_submit(one_src, one_dst, 0, 0U, &last) == FTP_OK,
+              "submit over the table size");
+        CHECK(ftp_copyjob_wait(last, 30000U) == 0, "refill finishes");
+    }
+    CHECK(ftp_copyjob_get(id1, &info) == -1, "oldest job dropped");
+    CHECK(ftp_copyjob_get(last, &info) == 0, "newest job kept");
+
+    /* Recursive delete in place; a symlink to a directory is unlinked,
+     * not followed */
+    char keep[FTP_PATH_MAX];
+    char link_path[FTP_PATH_MAX];
+    snprintf(keep, sizeof(keep), "%s/keep", base);
+    make_tree(keep, 3U);
+    snprintf(link_path, sizeof(link_path), "%s/m0/link", paused_dst);
+    CHECK(symlink(keep, link_path) == 0, "symlink");
+    uint32_t latest = ftp_copyjob_latest();
+    uint32_t id8 = 0U;
+    CHECK(ftp_copyjob_delete(paused_dst, 0, &id8) == FTP_OK, "submit delete");
+    CHECK(ftp_copyjob_latest() == latest, "delete is not the latest copy");
+    CHECK(ftp_copyjob_wait(id8, 30000U) == 0, "delete finishes");
+    CHECK((ftp_copyjob_get(id8, &info) == 0) &&
+              (info.state == FTP_COPYJOB_DONE) && (info.is_delete == 1) &&
+              (info.files_done == MANY_FILES + 1U),
+          "delete done");
+    CHECK(access(paused_dst, F_OK) != 0, "deleted tree gone");
+    CHECK(same_tree(src1, keep) == 0, "link target untouched");
+    snprintf(link_path, sizeof(link_path), "%s/big.bin", keep);
+    CHECK(access(link_path, F_OK) == 0, "link target kept");
+
+    /* Trash mode: the path is gone before the job runs */
+    uint32_t id9 = 0U;
+    CHECK(ftp_copyjob_delete(keep, 1, &id9) == FTP_OK, "submit trash");
+    CHECK(access(keep, F_OK) != 0, "trashed path gone at once");
+    CHECK(ftp_copyjob_wait(id9, 30000U) == 0, "trash delete finishes");
+    CHECK((ftp_copyjob_get(id9, &info) == 0) &&
+              (info.state == FTP_COPYJOB_DONE) && (access(info.dst, F_OK) != 0),
+          "trash emptied");
+
+    /* A cancelled trash delete puts the tree back */
+    uint32_t id10 = 0U;
+    CHECK(ftp_copyjob_delete(many, 1, &id10) == FTP_OK, "submit trash 2");
+    CHECK(ftp_copyjob_pause(id10, 1) == 0, "pause delete");
+    CHECK(ftp_copyjob_cancel(id10) == 0, "cancel delete");
+    CHECK(ftp_copyjob_wait(id10, 30000U) == 0, "cancelled delete finishes");
+    CHECK((ftp_copyjob_get(id10, &info) == 0) &&
+              (info.state == FTP_COPYJOB_CANCELLED),
+          "cancelled delete state");
+    CHECK(access(many, F_OK) == 0, "cancelled delete restored");
+
+    /* A single file */
+    uint32_t id11 = 0U;
+    CHECK(ftp_copyjob_delete(one_dst, 1, &id11) == FTP_OK, "submit file delete");
+    CHECK(ftp_copyjob_wait(id11, 30000U) == 0, "file delete finishes");
+    CHECK(access(one_dst, F_OK) != 0, "file deleted");
+
+    ftp_copyjob_shutdown();
+    CHECK(ftp_copyjob_latest() == 0U, "shutdown forgets jobs");
+    remove_tree(base);
+
+    if (failures != 0) {
+        printf("copyjob: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("copyjob: OK\n");
+    return 0;
+}
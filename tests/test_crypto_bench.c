@@ -0,0 +1,70 @@
+/*
+ * ChaCha20 keystream throughput, one line per backend built in and
+ * supported by this CPU.  Always exits 0 unless allocation fails; the
+ * bit-exactness checks live in test_crypto.
+ */
+#include "ftp_crypto.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if FTP_ENABLE_CRYPTO
+
+#define BENCH_BUF (1U * 1024U * 1024U)
+#define BENCH_TOTAL (64U * 1024U * 1024U)
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+int main(void)
+{
+    static const ftp_crypto_backend_t backends[] = {
+        FTP_CRYPTO_BACKEND_SCALAR, FTP_CRYPTO_BACKEND_SSE2,
+        FTP_CRYPTO_BACKEND_AVX2, FTP_CRYPTO_BACKEND_NEON};
+    uint8_t key[32];
+    uint8_t nonce[12];
+    ftp_crypto_ctx_t ctx;
+
+    uint8_t *buf = malloc(BENCH_BUF);
+    if (buf == NULL) {
+        return 1;
+    }
+    memset(buf, 0x5A, BENCH_BUF);
+    memset(key, 0x11, sizeof(key));
+    memset(nonce, 0x22, sizeof(nonce));
+
+    for (size_t b = 0U; b < sizeof(backends) / sizeof(backends[0]); b++) {
+        if (ftp_crypto_set_backend(backends[b]) != 0) {
+            continue;
+        }
+        ftp_crypto_init(&ctx, key, nonce);
+        double t0 = now_sec();
+        for (size_t done = 0U; done < BENCH_TOTAL; done += BENCH_BUF) {
+            ftp_crypto_xor(&ctx, buf, BENCH_BUF);
+        }
+        double dt = now_sec() - t0;
+        printf("test_crypto_bench: %-6s %8.1f MB/s\n",
+               ftp_crypto_backend_name(),
+               ((double)BENCH_TOTAL / (1024.0 * 1024.0)) /
+                   ((dt > 0.0) ? dt : 1e-9));
+    }
+    (void)ftp_crypto_set_backend(FTP_CRYPTO_BACKEND_AUTO);
+    free(buf);
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("test_crypto_bench: skipped (FTP_ENABLE_CRYPTO=0)\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,440 @@
+#include "ftp_config.h"
+#include "ftp_delta.h"
+#include "ftp_hash.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define BASIS_SIZE (300U * 1024U + 123U)
+
+static uint32_t rng = 12345U;
+
+static uint8_t next_byte(void)
+{
+    rng = (rng * 1103515245U) + 12345U;
+    return (uint8_t)(rng >> 16);
+}
+
+static uint32_t be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/* Growable byte buffer */
+typedef struct {
+    uint8_t *p;
+    size_t len;
+    size_t cap;
+} bytes_t;
+
+static int bytes_put(void *ctx, const void *data, size_t len)
+{
+    bytes_t *b = (bytes_t *)ctx;
+    if ((b->len + len) > b->cap) {
+        size_t cap = (b->cap * 2U) + len;
+        uint8_t *p = realloc(b->p, cap);
+        if (p == NULL) {
+            return 1;
+        }
+        b->p = p;
+        b->cap = cap;
+    }
+    memcpy(b->p + b->len, data, len);
+    b->len += len;
+    return 0;
+}
+
+static void put_u32(bytes_t *b, uint32_t v)
+{
+    uint8_t x[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8),
+                    (uint8_t)v};
+    (void)bytes_put(b, x, 4U);
+}
+
+static void flush_literal(bytes_t *out, const uint8_t *data, size_t from,
+                          size_t to)
+{
+    if (to > from) {
+        (void)bytes_put(out, "L", 1U);
+        put_u32(out, (uint32_t)(to - from));
+        (void)bytes_put(out, data + from, to - from);
+    }
+}
+
+/*
+ * Reference encoder: full blocks of the signature matched anywhere in
+ * @p data by rolling weak sum, confirmed by strong sum; everything else
+ * literal.
+ */
+static void encode(const bytes_t *sig, const uint8_t *data, size_t len,
+                   bytes_t *out, size_t *copies)
+{
+    ftp_delta_basis_t b;
+    (void)ftp_delta_sig_parse(sig->p, &b);
+    uint64_t blocks = ftp_delta_block_count(&b);
+    uint32_t bs = b.block_size;
+    uint64_t full = b.size / bs;
+
+    ftp_delta_header_t h;
+    uint8_t hdr[FTP_DELTA_HEADER];
+    h.basis = b;
+    h.result_size = len;
+    ftp_delta_header(hdr, &h);
+    (void)bytes_put(out, hdr, sizeof(hdr));
+
+    size_t lit = 0U;
+    size_t i = 0U;
+    uint32_t weak = (len >= bs) ? ftp_delta_weak(data, bs) : 0U;
+    *copies = 0U;
+    while ((i + bs) <= len) {
+        int64_t hit = -1;
+        for (uint64_t k = 0U; (k < full) && (k < blocks); k++) {
+            const uint8_t *e = sig->p + FTP_DELTA_SIG_HEADER +
+                               (k * FTP_DELTA_SIG_ENTRY);
+            uint8_t strong[FTP_DELTA_STRONG_LEN];
+            if (be32(e) != weak) {
+                continue;
+            }
+            ftp_delta_strong(data + i, bs, strong);
+            if (memcmp(strong, e + 4, sizeof(strong)) == 0) {
+                hit = (int64_t)k;
+                break;
+            }
+        }
+        if (hit >= 0) {
+            flush_literal(out, data, lit, i);
+            uint8_t rec[13] = {'C'};
+            uint64_t first = (uint64_t)hit;
+            for (int s = 0; s < 8; s++) {
+                rec[1 + s] = (uint8_t)(first >> (56 - (8 * s)));
+            }
+            rec[9] = 0;
+            rec[10] = 0;
+            rec[11] = 0;
+            rec[12] = 1;
+            (void)bytes_put(out, rec, sizeof(rec));
+            (*copies)++;
+            i += bs;
+            lit = i;
+            if ((i + bs) <= len) {
+                weak = ftp_delta_weak(data + i, bs);
+            }
+            continue;
+        }
+        if ((i + bs) < len) {
+            weak = ftp_delta_roll(weak, data[i], data[i + bs], bs);
+        }
+        i++;
+    }
+    flush_literal(out, data, lit, len);
+
+    ftp_hash_ctx_t ctx;
+    uint8_t digest[FTP_HASH_MAX_DIGEST];
+    ftp_hash_init(&ctx, FTP_HASH_SHA256);
+    ftp_hash_update(&ctx, data, len);
+    ftp_hash_final(&ctx, digest);
+    (void)bytes_put(out, "E", 1U);
+    (void)bytes_put(out, digest, 32U);
+}
+
+/* Applying sink: rebuilds into memory from an in-memory basis */
+typedef struct {
+    const uint8_t *basis;
+    bytes_t out;
+    uint8_t digest[32];
+    int begun;
+    int ended;
+} apply_t;
+
+static int ap_begin(void *ctx, const ftp_delta_header_t *h)
+{
+    apply_t *a = (apply_t *)ctx;
+    a->begun = (h->basis.size == BASIS_SIZE) ? 1 : -1;
+    return 0;
+}
+
+static int ap_copy(void *ctx, uint64_t offset, uint64_t len)
+{
+    apply_t *a = (apply_t *)ctx;
+    return bytes_put(&a->out, a->basis + offset, (size_t)len);
+}
+
+static int ap_data(void *ctx, const void *buf, size_t len)
+{
+    apply_t *a = (apply_t *)ctx;
+    return bytes_put(&a->out, buf, len);
+}
+
+static int ap_end(void *ctx, const uint8_t sha256[32])
+{
+    apply_t *a = (apply_t *)ctx;
+    memcpy(a->digest, sha256, 32U);
+    a->ended = 1;
+    return 0;
+}
+
+static ftp_error_t apply(const uint8_t *basis, const bytes_t *delta,
+                         size_t step, apply_t *a)
+{
+    ftp_delta_sink_t sink = {ap_begin, ap_copy, ap_data, ap_end, a};
+    ftp_delta_reader_t r;
+    memset(a, 0, sizeof(*a));
+    a->basis = basis;
+    ftp_delta_reader_init(&r, &sink);
+    for (size_t at = 0U; at < delta->len; at += step) {
+        size_t n = ((delta->len - at) < step) ? (delta->len - at) : step;
+        ftp_error_t err = ftp_delta_reader_feed(&r, delta->p + at, n);
+        if (err != FTP_OK) {
+            return err;
+        }
+    }
+    return ftp_delta_reader_finish(&r);
+}
+
+int main(void)
+{
+    /* --- Block size ------------------------------------------------------ */
+    CHECK(ftp_delta_block_size(0U) == FTP_DELTA_BLOCK_MIN, "empty file");
+    CHECK(ftp_delta_block_size(1024U * 1024U) == 2048U, "1 MB");
+    CHECK(ftp_delta_block_size(40ULL << 30) == FTP_DELTA_BLOCK_MAX, "40 GB");
+    CHECK(ftp_delta_block_size(BASIS_SIZE) == FTP_DELTA_BLOCK_MIN,
+          "small file");
+
+    /* --- Weak checksum: kernels agree, rolling matches recomputing ------ */
+    static uint8_t basis[BASIS_SIZE];
+    for (size_t i = 0U; i < sizeof(basis); i++) {
+        basis[i] = next_byte();
+    }
+    int agree = 1;
+    for (size_t len = 0U; len < 300U; len++) {
+        ftp_delta_force_scalar(0);
+        uint32_t fast = ftp_delta_weak(basis + 7, len);
+        ftp_delta_force_scalar(1);
+        agree &= (fast == ftp_delta_weak(basis + 7, len)) ? 1 : 0;
+    }
+    ftp_delta_force_scalar(0);
+    uint32_t fast = ftp_delta_weak(basis, 256U * 1024U);
+    ftp_delta_force_scalar(1);
+    agree &= (fast == ftp_delta_weak(basis, 256U * 1024U)) ? 1 : 0;
+    ftp_delta_force_scalar(0);
+    CHECK(agree == 1, "kernels agree");
+    CHECK(strcmp(ftp_delta_kernel_name(), "scalar") == 0 ||
+              strcmp(ftp_delta_kernel_name(), "ssse3") == 0,
+          "kernel name");
+
+    int rolls = 1;
+    uint32_t w = ftp_delta_weak(basis, 2048U);
+    for (size_t i = 0U; i < 4096U; i++) {
+        w = ftp_delta_roll(w, basis[i], basis[i + 2048U], 2048U);
+        rolls &= (w == ftp_delta_weak(basis + i + 1U, 2048U)) ? 1 : 0;
+    }
+    CHECK(rolls == 1, "rolling sum");
+
+    /* --- Signature of a file -------------------------------------------- */
+    char dir[] = "/tmp/zftpd-delta-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        return 1;
+    }
+    char path[96];
+    snprintf(path, sizeof(path), "%s/basis.bin", dir);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0 && write(fd, basis, sizeof(basis)) == (ssize_t)sizeof(basis),
+          "basis written");
+
+    ftp_delta_basis_t b = {2048U, BASIS_SIZE, 1700000000};
+    static uint8_t buf[64U * 1024U];
+    bytes_t sig = {NULL, 0U, 0U};
+    ftp_hash_ctx_t whole;
+    ftp_hash_init(&whole, FTP_HASH_SHA256);
+    CHECK(ftp_delta_sig_fd(fd, &b, buf, sizeof(buf), bytes_put, &sig,
+                           &whole) == 0,
+          "signature");
+    uint64_t blocks = ftp_delta_block_count(&b);
+    CHECK(blocks == (BASIS_SIZE + 2047U) / 2048U, "block count");
+    CHECK(sig.len == FTP_DELTA_SIG_HEADER + (blocks * FTP_DELTA_SIG_ENTRY),
+          "signature length");
+
+    ftp_delta_basis_t parsed;
+    CHECK(ftp_delta_sig_parse(sig.p, &parsed) == 0 &&
+              parsed.block_size == b.block_size && parsed.size == b.size &&
+              parsed.mtime == b.mtime,
+          "header round trip");
+    const uint8_t *last = sig.p + FTP_DELTA_SIG_HEADER +
+                          ((blocks - 1U) * FTP_DELTA_SIG_ENTRY);
+    uint8_t strong[FTP_DELTA_STRONG_LEN];
+    ftp_delta_strong(basis + ((blocks - 1U) * 2048U), BASIS_SIZE % 2048U,
+                     strong);
+    CHECK(be32(last) == ftp_delta_weak(basis + ((blocks - 1U) * 2048U),
+                                       BASIS_SIZE % 2048U) &&
+              memcmp(last + 4, strong, sizeof(strong)) == 0,
+          "short last block");
+
+    uint8_t d1[FTP_HASH_MAX_DIGEST];
+    uint8_t d2[FTP_HASH_MAX_DIGEST];
+    ftp_hash_final(&whole, d1);
+    ftp_hash_ctx_t direct;
+    ftp_hash_init(&direct, FTP_HASH_SHA256);
+    ftp_hash_update(&direct, basis, sizeof(basis));
+    ftp_hash_final(&direct, d2);
+    CHECK(memcmp(d1, d2, 32U) == 0, "whole-file digest on the side");
+
+    bytes_t junk = {NULL, 0U, 0U};
+    ftp_delta_basis_t longer = b;
+    longer.size += 1U;
+    CHECK(ftp_delta_sig_fd(fd, &longer, buf, sizeof(buf), bytes_put, &junk,
+                           NULL) == -1,
+          "file shorter than announced");
+    CHECK(ftp_delta_sig_fd(fd, &b, buf, 100U, bytes_put, &junk, NULL) == -1,
+          "buffer smaller than a block");
+    free(junk.p);
+
+    /* --- Delta: edits, an insertion, a deletion ------------------------- */
+    static uint8_t next[BASIS_SIZE + 4096U];
+    size_t nlen = 0U;
+    memcpy(next, basis, 100000U);                        /* unchanged head  */
+    nlen = 100000U;
+    for (int i = 0; i < 777; i++) {
+        next[nlen++] = next_byte();                      /* inserted bytes  */
+    }
+    memcpy(next + nlen, basis + 110000U, 150000U);       /* 10000 deleted   */
+    nlen += 150000U;
+    next[nlen - 5000U] ^= 0xFFU;                         /* one flipped byte */
+    memcpy(next + nlen, basis + 260000U, BASIS_SIZE - 260000U);
+    nlen += BASIS_SIZE - 260000U;
+
+    bytes_t delta = {NULL, 0U, 0U};
+    size_t copies = 0U;
+    encode(&sig, next, nlen, &delta, &copies);
+    CHECK(copies > 130U, "most blocks matched");
+    CHECK(delta.len < (nlen / 10U), "delta is small");
+
+    apply_t a;
+    CHECK(apply(basis, &delta, delta.len, &a) == FTP_OK, "apply");
+    CHECK(a.begun == 1 && a.ended == 1, "callbacks");
+    CHECK(a.out.len == nlen && memcmp(a.out.p, next, nlen) == 0,
+          "rebuilt file");
+    free(a.out.p);
+    CHECK(apply(basis, &delta, 1U, &a) == FTP_OK && a.out.len == nlen &&
+              memcmp(a.out.p, next, nlen) == 0,
+          "byte at a time");
+    free(a.out.p);
+
+    /* --- Malformed streams ---------------------------------------------- */
+    bytes_t bad = {NULL, 0U, 0U};
+    (void)bytes_put(&bad, delta.p, delta.len - 1U);
+    CHECK(apply(basis, &bad, bad.len, &a) == FTP_ERR_PROTOCOL, "truncated");
+    free(a.out.p);
+    (void)bytes_put(&bad, delta.p + delta.len - 1U, 1U);
+    (void)bytes_put(&bad, "L", 1U);
+    CHECK(apply(basis, &bad, bad.len, &a) == FTP_ERR_PROTOCOL,
+          "bytes after the end");
+    free(a.out.p);
+
+    bad.len = 0U;
+    (void)bytes_put(&bad, delta.p, FTP_DELTA_HEADER);
+    uint8_t far[13] = {'C', 0, 0, 0, 0, 0, 0, 0x10, 0, 0, 0, 0, 1};
+    (void)bytes_put(&bad, far, sizeof(far));
+    CHECK(apply(basis, &bad, bad.len, &a) == FTP_ERR_PROTOCOL,
+          "copy past the basis");
+    free(a.out.p);
+
+    bad.len = 0U;
+    (void)bytes_put(&bad, delta.p, FTP_DELTA_HEADER);
+    (void)bytes_put(&bad, "L", 1U);
+    put_u32(&bad, (uint32_t)nlen + 1U);
+    CHECK(apply(basis, &bad, bad.len, &a) == FTP_ERR_PROTOCOL,
+          "more output than announced");
+    free(a.out.p);
+
+    bad.len = 0U;
+    (void)bytes_put(&bad, "ZDXX", 4U);
+    (void)bytes_put(&bad, delta.p + 4, delta.len - 4U);
+    CHECK(apply(basis, &bad, bad.len, &a) == FTP_ERR_PROTOCOL, "bad magic");
+    free(a.out.p);
+    free(bad.p);
+
+    /* --- In-kernel block copy ------------------------------------------- */
+    char copy[96];
+    snprintf(copy, sizeof(copy), "%s/copy.bin", dir);
+    int cfd = open(copy, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    CHECK(cfd >= 0, "copy target");
+    CHECK(write(cfd, "head", 4U) == 4, "head");
+    CHECK(ftp_delta_copy(fd, 4096U, cfd, 70000U, buf, 4096U) == 0, "copy");
+    CHECK(write(cfd, "tail", 4U) == 4, "position follows the copy");
+    static uint8_t back[70008U];
+    CHECK(pread(cfd, back, sizeof(back), 0) == (ssize_t)sizeof(back) &&
+              memcmp(back + 4, basis + 4096U, 70000U) == 0 &&
+              memcmp(back + 70004U, "tail", 4U) == 0,
+          "copied bytes");
+    CHECK(ftp_delta_copy(fd, BASIS_SIZE - 10U, cfd, 20U, buf, 4096U) == -1,
+          "copy past EOF");
+    close(cfd);
+    (void)unlink(copy);
+
+    /* --- Signature cache ------------------------------------------------ */
+    char cache[96];
+    char tmp[FTP_PATH_MAX];
+    snprintf(cache, sizeof(cache), "%s/sig", dir);
+    ftp_delta_sig_cache_reset(cache);
+    CHECK(ftp_delta_sig_cache_open(path, &b) == -1, "cold cache");
+    int w_fd = ftp_delta_sig_cache_create(path, tmp, sizeof(tmp));
+    CHECK(w_fd >= 0 && write(w_fd, sig.p, sig.len) == (ssize_t)sig.len,
+          "cache written");
+    ftp_delta_sig_cache_commit(path, w_fd, tmp, 1);
+    CHECK(access(tmp, F_OK) != 0, "temp renamed");
+
+    int r_fd = ftp_delta_sig_cache_open(path, &b);
+    CHECK(r_fd >= 0, "cache hit");
+    if (r_fd >= 0) {
+        static uint8_t again[FTP_DELTA_SIG_HEADER + (200U *
+                                                     FTP_DELTA_SIG_ENTRY)];
+        ssize_t n = read(r_fd, again, sizeof(again));
+        CHECK(n == (ssize_t)sig.len && memcmp(again, sig.p, sig.len) == 0,
+              "cached signature");
+        close(r_fd);
+    }
+    ftp_delta_basis_t touched = b;
+    touched.mtime += 1;
+    CHECK(ftp_delta_sig_cache_open(path, &touched) == -1, "mtime miss");
+    CHECK(ftp_delta_sig_cache_open(copy, &b) == -1, "other path misses");
+
+    w_fd = ftp_delta_sig_cache_create(path, tmp, sizeof(tmp));
+    ftp_delta_sig_cache_commit(path, w_fd, tmp, 0);
+    r_fd = ftp_delta_sig_cache_open(path, &b);
+    CHECK(r_fd >= 0, "dropped write keeps the old entry");
+    if (r_fd >= 0) {
+        close(r_fd);
+    }
+
+    ftp_delta_sig_cache_reset("");
+    CHECK(ftp_delta_sig_cache_create(path, tmp, sizeof(tmp)) == -1,
+          "cache off");
+    ftp_delta_sig_cache_reset(NULL);
+
+    close(fd);
+    char cmd[160];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dir);
+    (void)system(cmd);
+    free(sig.p);
+    free(delta.p);
+
+    if (failures != 0) {
+        printf("delta: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("delta: OK\n");
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "ftp_config.h"
+#include "ftp_dirsize.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static char g_root[64];
+
+/* Write @p bytes to root/rel; returns what the index will count */
+static uint64_t put_file(const char *rel, size_t bytes)
+{
+    char path[FTP_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", g_root, rel);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 0U;
+    }
+    char buf[4096];
+    memset(buf, 'z', sizeof(buf));
+    for (size_t done = 0U; done < bytes;) {
+        size_t n = bytes - done;
+        if (n > sizeof(buf)) {
+            n = sizeof(buf);
+        }
+        if (write(fd, buf, n) != (ssize_t)n) {
+            break;
+        }
+        done += n;
+    }
+    (void)fsync(fd);
+    close(fd);
+    struct stat st;
+    return (stat(path, &st) == 0) ? (uint64_t)st.st_blocks * 512U : 0U;
+}
+
+static void make_dir(const char *rel)
+{
+    char path[FTP_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", g_root, rel);
+    (void)mkdir(path, 0755);
+}
+
+/* Directory mtimes old enough for the index to trust them */
+static void age_dir(const char *rel)
+{
+    char path[FTP_PATH_MAX];
+    snprintf(path, sizeof(path), "%s%s%s", g_root, (rel[0] != '\0') ? "/" : "",
+             rel);
+    struct timeval tv[2];
+    gettimeofday(&tv[0], NULL);
+    tv[0].tv_sec -= 100;
+    tv[1] = tv[0];
+    (void)utimes(path, tv);
+}
+
+static void rel_path(char *out, size_t size, const char *rel)
+{
+    snprintf(out, size, "%s/%s", g_root, rel);
+}
+
+int main(void)
+{
+    char tmpl[] = "/tmp/zftpd-dsize-XXXXXX";
+    if (mkdtemp(tmpl) == NULL) {
+        return 1;
+    }
+    snprintf(g_root, sizeof(g_root), "%s", tmpl);
+    char index[96];
+    snprintf(index, sizeof(index), "%s.idx", g_root);
+    ftp_dirsize_reset(index);
+
+    make_dir("d1");
+    make_dir("d1/d2");
+    make_dir("d3");
+    uint64_t f1 = put_file("f1", 10000U);
+    uint64_t expect = f1;
+    expect += put_file("d1/f2", 50000U);
+    expect += put_file("d1/d2/f3", 70000U);
+    const char *dirs[] = {"", "d1", "d1/d2", "d3"};
+    for (size_t i = 0U; i < 4U; i++) {
+        age_dir(dirs[i]);
+    }
+
+    /* First query walks the tree */
+    ftp_dirsize_info_t info;
+    CHECK(ftp_dirsize_query(g_root, 5000U, &info) == 0, "first query");
+    CHECK(info.bytes == expect, "walked size");
+    CHECK(info.partial == 0, "complete walk");
+    ftp_dirsize_stats_t st;
+    ftp_dirsize_get_stats(&st);
+    CHECK((st.dirs == 4U) && (st.reads == 4U), "four directories read");
+
+    char d1[FTP_PATH_MAX];
+    rel_path(d1, sizeof(d1), "d1");
+    CHECK((ftp_dirsize_query(d1, 0U, &info) == 0) && (info.partial == 0) &&
+              (info.bytes == expect - f1),
+          "subtree answered from the index");
+
+    /* Saved at shutdown, answered at once after a restart */
+    ftp_dirsize_shutdown();
+    ftp_dirsize_reset(index);
+    CHECK(ftp_dirsize_query(g_root, 0U, &info) == 0, "query after reload");
+    CHECK((info.bytes == expect) && (info.stale == 1) && (info.partial == 0),
+          "loaded size flagged stale");
+    CHECK(ftp_dirsize_query(g_root, 5000U, &info) == 0, "revalidation");
+    ftp_dirsize_get_stats(&st);
+    CHECK((st.reads == 0U) && (st.reuses == 4U),
+          "unchanged directories are not re-read");
+    CHECK((info.bytes == expect) && (info.stale == 0),
+          "revalidated size is fresh");
+
+    /* Our own write: only the touched directory is re-read */
+    char f4[FTP_PATH_MAX];
+    rel_path(f4, sizeof(f4), "d3/f4");
+    expect += put_file("d3/f4", 30000U);
+    ftp_dirsize_invalidate(f4);
+    CHECK(ftp_dirsize_query(g_root, 5000U, &info) == 0, "query after write");
+    CHECK(info.bytes == expect, "new file counted");
+
+    /* A removed subtree drops out of the index */
+    char path[FTP_PATH_MAX];
+    rel_path(path, sizeof(path), "d1/d2/f3");
+    struct stat fst;
+    uint64_t f3 = 0U;
+    if (stat(path, &fst) == 0) {
+        f3 = (uint64_t)fst.st_blocks * 512U;
+    }
+    (void)unlink(path);
+    rel_path(path, sizeof(path), "d1/d2");
+    (void)rmdir(path);
+    ftp_dirsize_invalidate(path);
+    CHECK(ftp_dirsize_query(g_root, 5000U, &info) == 0, "query after rmdir");
+    CHECK(info.bytes == expect - f3, "removed subtree subtracted");
+    ftp_dirsize_get_stats(&st);
+    CHECK(st.dirs == 3U, "removed directory forgotten");
+
+    CHECK(ftp_dirsize_query(f4, 0U, &info) == -1, "file is not a directory");
+
+    ftp_dirsize_reset("");
+    (void)unlink(index);
+    const char *files[] = {"d3/f4", "d1/f2", "f1"};
+    for (size_t i = 0U; i < 3U; i++) {
+        rel_path(path, sizeof(path), files[i]);
+        (void)unlink(path);
+    }
+    const char *rm[] = {"d3", "d1"};
+    for (size_t i = 0U; i < 2U; i++) {
+        rel_path(path, sizeof(path), rm[i]);
+        (void)rmdir(path);
+    }
+    (void)rmdir(g_root);
+
+    if (failures != 0) {
+        printf("dirsize: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("dirsize: OK\n");
+    return 0;
+}
@@ -0,0 +1,172 @@
+#include "ftp_engine.h"
+#include "ftp_server.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define CLIENTS 24
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static int dial(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval tv = {5, 0};
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    (void)inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Read until `lines` CRLF-terminated replies arrived */
+static int read_replies(int fd, char *buf, size_t size, int lines)
+{
+    size_t len = 0U;
+    int seen = 0;
+    while ((seen < lines) && (len + 1U < size)) {
+        ssize_t n = recv(fd, buf + len, size - len - 1U, 0);
+        if (n <= 0) {
+            break;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[len + (size_t)i] == '\n') {
+                seen++;
+            }
+        }
+        len += (size_t)n;
+    }
+    buf[len] = '\0';
+    return seen;
+}
+
+static void wait_parked(ftp_engine_t *engine, uint32_t want)
+{
+    ftp_engine_stats_t st;
+    for (int i = 0; i < 200; i++) {
+        ftp_engine_get_stats(engine, &st);
+        if ((st.parked == want) && (st.busy_workers == 0U)) {
+            return;
+        }
+        usleep(10000U);
+    }
+}
+
+int main(void)
+{
+    static ftp_server_context_t ctx;
+    uint16_t port = (uint16_t)(30000 + (getpid() % 20000));
+
+    if (ftp_server_init(&ctx, "127.0.0.1", port, "/tmp") != FTP_OK) {
+        printf("engine: cannot listen on %u\n", port);
+        return 1;
+    }
+    CHECK(ftp_server_set_event_engine(&ctx, 1) == FTP_OK, "select engine");
+    CHECK(ftp_server_set_max_sessions(&ctx, CLIENTS) == FTP_OK, "limit");
+    CHECK(ftp_server_set_max_sessions(&ctx, FTP_MAX_SESSIONS + 1U) != FTP_OK,
+          "limit above the compile-time cap");
+    if (ftp_server_start(&ctx) != FTP_OK) {
+        ftp_server_cleanup(&ctx);
+        return 1;
+    }
+    CHECK(ftp_server_set_event_engine(&ctx, 0) != FTP_OK,
+          "engine is fixed once running");
+
+    int fds[CLIENTS];
+    char buf[1024];
+    for (int i = 0; i < CLIENTS; i++) {
+        fds[i] = dial(port);
+        CHECK(fds[i] >= 0, "connect");
+        if (fds[i] >= 0) {
+            CHECK(read_replies(fds[i], buf, sizeof(buf), 1) == 1, "greeting");
+            CHECK(strncmp(buf, "220", 3) == 0, "220");
+        }
+    }
+
+    /* Every idle session sits on a loop; the pool stays small */
+    wait_parked(ctx.engine, CLIENTS);
+    ftp_engine_stats_t st;
+    ftp_engine_get_stats(ctx.engine, &st);
+    CHECK(st.parked == CLIENTS, "all sessions parked");
+    CHECK(st.busy_workers == 0U, "no worker held by an idle session");
+    CHECK(st.workers < CLIENTS, "pool smaller than the session count");
+
+    /* Slots were allocated on demand; the limit turns the next one away */
+    CHECK(atomic_load(&ctx.session_slots) == CLIENTS, "slots on demand");
+    int extra = dial(port);
+    if (extra >= 0) {
+        CHECK(recv(extra, buf, sizeof(buf), 0) <= 0, "over the limit");
+        close(extra);
+    }
+
+    /* Round trip on every session, in reverse order */
+    for (int i = CLIENTS - 1; i >= 0; i--) {
+        if (fds[i] < 0) {
+            continue;
+        }
+        (void)send(fds[i], "NOOP\r\n", 6U, 0);
+        CHECK(read_replies(fds[i], buf, sizeof(buf), 1) == 1, "NOOP reply");
+        CHECK(strncmp(buf, "200", 3) == 0, "200");
+    }
+
+    /* Pipelined commands are all served in one wake-up */
+    (void)send(fds[0], "NOOP\r\nSYST\r\nNOOP\r\n", 18U, 0);
+    CHECK(read_replies(fds[0], buf, sizeof(buf), 3) == 3, "pipelined");
+
+    /* QUIT releases the slot */
+    (void)send(fds[1], "QUIT\r\n", 6U, 0);
+    CHECK(read_replies(fds[1], buf, sizeof(buf), 1) == 1, "QUIT reply");
+    CHECK(recv(fds[1], buf, sizeof(buf), 0) == 0, "closed after QUIT");
+    for (int i = 0; (i < 200) &&
+                    (ftp_server_get_active_sessions(&ctx) != CLIENTS - 1);
+         i++) {
+        usleep(10000U);
+    }
+    CHECK(ftp_server_get_active_sessions(&ctx) == CLIENTS - 1,
+          "active count follows QUIT");
+
+    /* The freed slot is reused, not a new one allocated */
+    close(fds[1]);
+    fds[1] = dial(port);
+    CHECK((fds[1] >= 0) && (read_replies(fds[1], buf, sizeof(buf), 1) == 1) &&
+              (strncmp(buf, "220", 3) == 0),
+          "reconnect after QUIT");
+    CHECK(atomic_load(&ctx.session_slots) == CLIENTS, "slot recycled");
+
+    for (int i = 0; i < CLIENTS; i++) {
+        if (fds[i] >= 0) {
+            close(fds[i]);
+        }
+    }
+
+    ftp_server_stop(&ctx);
+    CHECK(ftp_server_get_active_sessions(&ctx) == 0U, "drained on stop");
+    ftp_server_cleanup(&ctx);
+
+    if (failures != 0) {
+        printf("engine: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("engine: OK\n");
+    return 0;
+}
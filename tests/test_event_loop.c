@@ -0,0 +1,135 @@
+#include "event_loop.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define PAIRS 8U
+#define HIGH_FD 1500U
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static event_loop_t *g_loop;
+static int g_fds[PAIRS][2];
+static int g_hits[PAIRS];
+static int g_write_hits;
+static int g_pending;
+
+static int on_read(int fd, uint32_t events, void *data)
+{
+    int idx = (int)(intptr_t)data;
+    if ((events & EVENT_READ) != 0U) {
+        char buf[16];
+        (void)read(fd, buf, sizeof(buf));
+        g_hits[idx]++;
+    }
+    g_pending--;
+    if (g_pending == 0) {
+        event_loop_stop(g_loop);
+    }
+    /* Odd pairs unregister themselves through the return value */
+    return ((idx & 1) != 0) ? -1 : 0;
+}
+
+static int on_write(int fd, uint32_t events, void *data)
+{
+    (void)fd;
+    (void)data;
+    if ((events & EVENT_WRITE) != 0U) {
+        g_write_hits++;
+    }
+    event_loop_stop(g_loop);
+    return 0;
+}
+
+static int move_high(int fd, int min)
+{
+    int hi = fcntl(fd, F_DUPFD, min);
+    if (hi < 0) {
+        return fd; /* fd limit too low: keep the original */
+    }
+    close(fd);
+    return hi;
+}
+
+int main(void)
+{
+    struct rlimit rl;
+    if ((getrlimit(RLIMIT_NOFILE, &rl) == 0) && (rl.rlim_cur < (rlim_t)(HIGH_FD + 64U)) &&
+        (rl.rlim_max >= (rlim_t)(HIGH_FD + 64U))) {
+        rl.rlim_cur = (rlim_t)(HIGH_FD + 64U);
+        (void)setrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    g_loop = event_loop_create();
+    CHECK(g_loop != NULL, "create");
+    if (g_loop == NULL) {
+        return 1;
+    }
+
+    /* fds past the old 1024-entry table, registered out of order */
+    for (unsigned k = 0U; k < PAIRS; k++) {
+        unsigned i = PAIRS - 1U - k;
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, g_fds[i]) == 0, "socketpair");
+        g_fds[i][0] = move_high(g_fds[i][0], (int)(HIGH_FD + 2U * i));
+        uint32_t ev = EVENT_READ | (((i % 3U) == 0U) ? EVENT_EDGE : 0U);
+        CHECK(event_loop_add(g_loop, g_fds[i][0], ev, on_read, (void *)(intptr_t)i) == 0,
+              "add");
+    }
+
+    /* Round 1: every pair readable once */
+    for (unsigned i = 0U; i < PAIRS; i++) {
+        CHECK(write(g_fds[i][1], "x", 1U) == 1, "write");
+    }
+    g_pending = (int)PAIRS;
+    CHECK(event_loop_run(g_loop) == 0, "run");
+    for (unsigned i = 0U; i < PAIRS; i++) {
+        CHECK(g_hits[i] == 1, "one read event per pair");
+    }
+
+    /* Round 2: odd pairs removed themselves and stay quiet */
+    for (unsigned i = 0U; i < PAIRS; i++) {
+        CHECK(write(g_fds[i][1], "y", 1U) == 1, "write");
+    }
+    g_pending = (int)(PAIRS / 2U);
+    CHECK(event_loop_run(g_loop) == 0, "run");
+    for (unsigned i = 0U; i < PAIRS; i++) {
+        int want = ((i & 1U) != 0U) ? 1 : 2;
+        CHECK(g_hits[i] == want, "removed handlers are silent");
+    }
+    CHECK(event_loop_modify(g_loop, g_fds[1][0], EVENT_READ) != 0,
+          "modify of a removed fd fails");
+
+    /* Modify swaps read interest for write interest */
+    CHECK(event_loop_remove(g_loop, g_fds[0][0]) == 0, "remove");
+    CHECK(event_loop_add(g_loop, g_fds[0][0], EVENT_READ, on_write, NULL) == 0, "re-add");
+    CHECK(event_loop_modify(g_loop, g_fds[0][0], EVENT_WRITE) == 0, "modify");
+    CHECK(write(g_fds[0][1], "z", 1U) == 1, "write");
+    CHECK(event_loop_run(g_loop) == 0, "run");
+    CHECK(g_write_hits == 1, "write readiness after modify");
+    CHECK(g_hits[0] == 2, "read interest dropped by modify");
+
+    for (unsigned i = 0U; i < PAIRS; i++) {
+        (void)event_loop_remove(g_loop, g_fds[i][0]);
+        close(g_fds[i][0]);
+        close(g_fds[i][1]);
+    }
+    event_loop_destroy(g_loop);
+
+    if (failures != 0) {
+        printf("event_loop: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("event_loop: OK\n");
+    return 0;
+}
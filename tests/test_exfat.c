@@ -0,0 +1,229 @@
+#include "exfat_unpacker.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+/* 512-byte sectors and clusters; a FAT spanning 20 cache pages */
+#define SECTOR      512U
+#define CLUSTERS    (20U * EXFAT_FAT_PAGE_ENTRIES)
+#define FAT_BYTES   ((CLUSTERS + 2U) * 4U)
+#define FAT_SECTORS ((FAT_BYTES + SECTOR - 1U) / SECTOR)
+#define HEAP_SECTOR (1U + FAT_SECTORS)
+#define STRIDE      7919U   /* prime: the chain hops between pages */
+
+/* Fragmented file: one cluster in each of four distant pages */
+static const uint32_t frag[4] = {100U, 250000U, 17U, 320000U};
+
+/* Two extents, 600-602 then 900-901; the FAT links are patched in */
+static const uint32_t runs[5] = {600U, 601U, 602U, 900U, 901U};
+
+/* NoFatChain file: clusters 700-707, FAT ignored */
+#define CONTIG_FIRST 700U
+#define CONTIG_COUNT 8U
+
+static uint32_t chain_at(uint32_t i)
+{
+    return 2U + (uint32_t)(((uint64_t)i * STRIDE) % CLUSTERS);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static void build_image(const char *path)
+{
+    uint8_t *img = calloc(1U, (size_t)HEAP_SECTOR * SECTOR);
+    CHECK(img != NULL, "alloc image");
+    if (img == NULL) {
+        return;
+    }
+
+    memcpy(img + 3, EXFAT_FS_NAME, EXFAT_FS_NAME_LEN);
+    put_le32(img + 0x50, 1U);              /* FatOffset         */
+    put_le32(img + 0x54, FAT_SECTORS);     /* FatLength         */
+    put_le32(img + 0x58, HEAP_SECTOR);     /* ClusterHeapOffset */
+    put_le32(img + 0x5C, CLUSTERS);        /* ClusterCount      */
+    put_le32(img + 0x60, 2U);              /* root directory    */
+    img[0x6C] = 9U;
+    img[0x6D] = 0U;
+    img[0x6E] = 1U;
+    img[0x1FE] = 0x55U;
+    img[0x1FF] = 0xAAU;
+
+    /* Every cluster on one long chain in STRIDE order... */
+    uint8_t *fat = img + SECTOR;
+    for (uint32_t i = 0U; i < CLUSTERS; i++) {
+        uint32_t next = (i + 1U < CLUSTERS) ? chain_at(i + 1U)
+                                            : EXFAT_FAT_END_OF_CHAIN;
+        put_le32(fat + (size_t)chain_at(i) * 4U, next);
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0, "create image");
+    CHECK(write(fd, img, (size_t)HEAP_SECTOR * SECTOR) ==
+          (ssize_t)((size_t)HEAP_SECTOR * SECTOR), "write image");
+
+    /* ...except the test files, which get their own chains and data */
+    for (uint32_t i = 0U; i < 5U; i++) {
+        uint8_t e[4];
+        put_le32(e, (i < 4U) ? runs[i + 1U] : EXFAT_FAT_END_OF_CHAIN);
+        CHECK(pwrite(fd, e, 4U, (off_t)SECTOR + (off_t)runs[i] * 4) == 4,
+              "runs fat");
+    }
+    for (uint32_t c = 2U; c < 1000U; c++) {
+        uint8_t data[SECTOR];
+        for (uint32_t k = 0U; k < SECTOR; k++) {
+            data[k] = (uint8_t)(c * 31U + k);
+        }
+        off_t at = (off_t)(HEAP_SECTOR + (c - 2U)) * SECTOR;
+        CHECK(pwrite(fd, data, sizeof(data), at) == (ssize_t)sizeof(data),
+              "cluster data");
+    }
+    for (uint32_t i = 0U; i < 4U; i++) {
+        uint8_t e[4];
+        put_le32(e, (i < 3U) ? frag[i + 1U] : EXFAT_FAT_END_OF_CHAIN);
+        CHECK(pwrite(fd, e, 4U, (off_t)SECTOR + (off_t)frag[i] * 4) == 4,
+              "frag fat");
+        uint8_t data[SECTOR];
+        memset(data, 'A' + (int)i, sizeof(data));
+        off_t at = (off_t)(HEAP_SECTOR + (frag[i] - 2U)) * SECTOR;
+        CHECK(pwrite(fd, data, sizeof(data), at) == (ssize_t)sizeof(data),
+              "frag data");
+    }
+    close(fd);
+    free(img);
+}
+
+/* Pattern build_image() wrote into clusters 2-999 */
+static int cluster_matches(const uint8_t *p, uint32_t c, size_t len)
+{
+    for (size_t k = 0U; k < len; k++) {
+        if (p[k] != (uint8_t)(c * 31U + (uint32_t)k)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static unsigned resident_pages(const exfat_context_t *ctx)
+{
+    unsigned n = 0U;
+    for (unsigned i = 0U; i < EXFAT_FAT_CACHE_PAGES; i++) {
+        n += (ctx->fat_cache[i].entries != NULL) ? 1U : 0U;
+    }
+    return n;
+}
+
+int main(void)
+{
+    char path[] = "/tmp/zftpd-exfat-XXXXXX";
+    int tmp = mkstemp(path);
+    CHECK(tmp >= 0, "mkstemp");
+    close(tmp);
+    build_image(path);
+
+    exfat_context_t ctx;
+    CHECK(exfat_init(&ctx, path) == 0, "init");
+    CHECK(resident_pages(&ctx) == 0U, "nothing loaded at init");
+    CHECK(ctx.fat_entries == CLUSTERS + 2U, "fat entries");
+
+    /* Long chain across all 20 pages: bounded cache, correct links */
+    int ok = 1;
+    for (uint32_t i = 0U; i + 1U < CLUSTERS; i++) {
+        uint32_t c = chain_at(i);
+        int is_frag = 0;
+        for (uint32_t k = 0U; k < 5U; k++) {
+            is_frag |= ((k < 4U) && (c == frag[k])) || (c == runs[k]);
+        }
+        if (!is_frag) {
+            ok &= (exfat_get_next_cluster(&ctx, c) == chain_at(i + 1U));
+        }
+    }
+    CHECK(ok, "chain links");
+    CHECK(resident_pages(&ctx) == EXFAT_FAT_CACHE_PAGES, "cache bounded");
+    CHECK(exfat_get_next_cluster(&ctx, CLUSTERS + 2U) ==
+          EXFAT_FAT_END_OF_CHAIN, "out of range");
+
+    /* Fragmented file through the cache */
+    exfat_file_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.first_cluster = frag[0];
+    info.data_length   = 4U * SECTOR - 10U;
+    uint8_t buf[4U * SECTOR];
+    CHECK(exfat_extract_to_buffer(&ctx, &info, buf, sizeof(buf)) ==
+          (ssize_t)(4U * SECTOR - 10U), "extract");
+    CHECK((buf[0] == 'A') && (buf[SECTOR] == 'B') &&
+          (buf[2U * SECTOR] == 'C') && (buf[4U * SECTOR - 11U] == 'D'),
+          "fragment order");
+
+    /* Two extents, to a buffer and to an fd (kernel copy where possible) */
+    static uint8_t big[CONTIG_COUNT * SECTOR];
+    memset(&info, 0, sizeof(info));
+    info.first_cluster = runs[0];
+    info.data_length   = 5U * SECTOR - 100U;
+    CHECK(exfat_extract_to_buffer(&ctx, &info, big, sizeof(big)) ==
+          (ssize_t)(5U * SECTOR - 100U), "extents to buffer");
+    ok = 1;
+    for (uint32_t i = 0U; i < 5U; i++) {
+        size_t len = (i < 4U) ? SECTOR : SECTOR - 100U;
+        ok &= cluster_matches(big + (size_t)i * SECTOR, runs[i], len);
+    }
+    CHECK(ok, "extent bytes");
+
+    char out[] = "/tmp/zftpd-exfat-out-XXXXXX";
+    int ofd = mkstemp(out);
+    CHECK(ofd >= 0, "mkstemp out");
+    CHECK(write(ofd, "hdr", 3U) == 3, "prefix");
+    CHECK(exfat_extract_file_fd(&ctx, &info, ofd) == 0, "extents to fd");
+    memset(big, 0, sizeof(big));
+    CHECK(pread(ofd, big, sizeof(big), 3) == (ssize_t)(5U * SECTOR - 100U),
+          "fd length");
+    CHECK(cluster_matches(big, runs[0], SECTOR) &&
+          cluster_matches(big + 3U * SECTOR, runs[3], SECTOR),
+          "fd bytes after the prefix");
+
+    /* NoFatChain: one extent straight off the heap */
+    memset(&info, 0, sizeof(info));
+    info.first_cluster = CONTIG_FIRST;
+    info.data_length   = CONTIG_COUNT * SECTOR;
+    info.no_fat_chain  = 1;
+    CHECK(ftruncate(ofd, 0) == 0 && lseek(ofd, 0, SEEK_SET) == 0, "reset");
+    CHECK(exfat_extract_file_fd(&ctx, &info, ofd) == 0, "contiguous to fd");
+    CHECK(pread(ofd, big, sizeof(big), 0) == (ssize_t)sizeof(big),
+          "contiguous length");
+    ok = 1;
+    for (uint32_t i = 0U; i < CONTIG_COUNT; i++) {
+        ok &= cluster_matches(big + (size_t)i * SECTOR, CONTIG_FIRST + i,
+                              SECTOR);
+    }
+    CHECK(ok, "contiguous bytes");
+    close(ofd);
+    unlink(out);
+
+    exfat_cleanup(&ctx);
+    CHECK(resident_pages(&ctx) == 0U, "cleanup frees pages");
+    unlink(path);
+
+    if (failures != 0) {
+        printf("exfat: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("exfat: OK\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+#include "pal_alloc.h"
+#include "pal_fileio.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+/* Room for the pipeline when the kernel tiers are unavailable */
+static _Alignas(4096) unsigned char g_arena[64U * 1024U * 1024U];
+
+#define BIG_SIZE (12U * 1024U * 1024U + 4321U)
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+typedef struct {
+    uint64_t last;
+    unsigned calls;
+    int monotonic;
+    uint64_t cancel_at; /* 0 = never */
+} progress_t;
+
+static int on_progress(uint64_t bytes, void *user_data)
+{
+    progress_t *p = (progress_t *)user_data;
+    if (bytes < p->last) {
+        p->monotonic = 0;
+    }
+    p->last = bytes;
+    p->calls++;
+    return ((p->cancel_at != 0U) && (bytes >= p->cancel_at)) ? -1 : 0;
+}
+
+static void write_file(const char *path, size_t size)
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return;
+    }
+    static unsigned char buf[65536];
+    size_t done = 0U;
+    while (done < size) {
+        size_t n = (size - done < sizeof(buf)) ? (size - done) : sizeof(buf);
+        for (size_t i = 0U; i < n; i++) {
+            buf[i] = (unsigned char)(((done + i) * 131U) >> 3);
+        }
+        (void)write(fd, buf, n);
+        done += n;
+    }
+    close(fd);
+}
+
+static int same_file(const char *a, const char *b)
+{
+    FILE *fa = fopen(a, "rb");
+    FILE *fb = fopen(b, "rb");
+    int same = ((fa != NULL) && (fb != NULL)) ? 1 : 0;
+    static char ba[65536];
+    static char bb[65536];
+    while (same != 0) {
+        size_t na = fread(ba, 1U, sizeof(ba), fa);
+        size_t nb = fread(bb, 1U, sizeof(bb), fb);
+        if ((na != nb) || (memcmp(ba, bb, na) != 0)) {
+            same = 0;
+        }
+        if (na == 0U) {
+            break;
+        }
+    }
+    if (fa != NULL) {
+        fclose(fa);
+    }
+    if (fb != NULL) {
+        fclose(fb);
+    }
+    return same;
+}
+
+static int dir_has_temp(const char *dir)
+{
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "ls -A '%s' | grep -q '^\\.zftpd\\.'", dir);
+    return (system(cmd) == 0) ? 1 : 0;
+}
+
+int main(void)
+{
+    if (pal_alloc_init(g_arena, sizeof(g_arena)) != 0) {
+        return 1;
+    }
+    char dir_template[] = "/tmp/zftpd-fcopy-XXXXXX";
+    char *dir = mkdtemp(dir_template);
+    if (dir == NULL) {
+        return 1;
+    }
+    char src[256];
+    char dst[256];
+    char small[256];
+    char small_dst[256];
+    snprintf(src, sizeof(src), "%s/src.bin", dir);
+    snprintf(dst, sizeof(dst), "%s/dst.bin", dir);
+    snprintf(small, sizeof(small), "%s/small.txt", dir);
+    snprintf(small_dst, sizeof(small_dst), "%s/small.copy", dir);
+    write_file(src, BIG_SIZE);
+    write_file(small, 777U);
+
+    progress_t p = {0U, 0U, 1, 0U};
+    int err = 0;
+    ftp_error_t rc = pal_file_copy_file_ex(src, dst, on_progress, &p, &err);
+    CHECK(rc == FTP_OK, "large copy");
+    CHECK(same_file(src, dst) != 0, "large copy content");
+    CHECK(p.last == BIG_SIZE, "progress reaches the file size");
+    CHECK(p.monotonic != 0, "progress is cumulative");
+    CHECK(p.calls >= 1U, "progress reported");
+    struct stat st;
+    CHECK((stat(dst, &st) == 0) && ((st.st_mode & 0777) == 0644),
+          "mode kept");
+
+    /* Cancel from the callback: nothing left behind */
+    (void)unlink(dst);
+    progress_t c = {0U, 0U, 1, 1U}; /* first report */
+    rc = pal_file_copy_file_ex(src, dst, on_progress, &c, &err);
+    CHECK(rc != FTP_OK, "cancelled copy fails");
+    CHECK(access(dst, F_OK) != 0, "cancelled copy not renamed in");
+    CHECK(dir_has_temp(dir) == 0, "cancelled temp file removed");
+
+    /* Small file, no callback */
+    rc = pal_file_copy_file_ex(small, small_dst, NULL, NULL, &err);
+    CHECK(rc == FTP_OK, "small copy");
+    CHECK(same_file(small, small_dst) != 0, "small copy content");
+
+    /* Missing source */
+    char missing[256];
+    snprintf(missing, sizeof(missing), "%s/missing", dir);
+    CHECK(pal_file_copy_file_ex(missing, dst, NULL, NULL, &err) ==
+              FTP_ERR_NOT_FOUND,
+          "missing source");
+
+    (void)unlink(src);
+    (void)unlink(dst);
+    (void)unlink(small);
+    (void)unlink(small_dst);
+    (void)rmdir(dir);
+
+    if (failures != 0) {
+        printf("file_copy: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("file_copy: OK\n");
+    return 0;
+}
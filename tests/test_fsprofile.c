@@ -0,0 +1,124 @@
+#include "ftp_config.h"
+#include "ftp_fsprofile.h"
+#include "ftp_xfer_tune.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static void write_conf(const char *path, const char *text)
+{
+    FILE *f = fopen(path, "w");
+    if (f != NULL) {
+        fputs(text, f);
+        fclose(f);
+    }
+}
+
+int main(void)
+{
+    ftp_fs_profile_t p;
+
+    /* --- Built-ins over the compile-time defaults ----------------------- */
+    CHECK(ftp_fs_profile_reset("") == 0, "no file");
+    ftp_fs_profile_lookup("ext4", &p);
+    CHECK(p.sendfile == 1U, "default sendfile");
+    CHECK(p.sendfile_chunk == FTP_RETR_SENDFILE_CHUNK, "default chunk");
+    CHECK(p.stor_ring == FTP_STOR_RING_DEPTH, "default ring");
+    CHECK(p.atomic_rename == ((FTP_STOR_ATOMIC != 0) ? 1U : 0U),
+          "default atomic");
+    CHECK(p.sync_policy == FTP_STOR_SYNC_POLICY, "default sync");
+    CHECK(p.skip_stat == 0U, "default stats");
+
+    ftp_fs_profile_lookup("devfs", &p);
+    CHECK(p.skip_stat == 1U && p.sendfile == 0U, "devfs built-in");
+    ftp_fs_profile_lookup("tmpfs", &p);
+    CHECK(p.sync_policy == 0U, "tmpfs never syncs");
+    ftp_fs_profile_lookup(NULL, &p);
+    CHECK(p.sendfile == 1U && p.skip_stat == 0U, "NULL type: defaults");
+
+    /* --- Profile file ----------------------------------------------------- */
+    char dir[] = "/tmp/zftpd-fsp-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        return 1;
+    }
+    char conf[64];
+    snprintf(conf, sizeof(conf), "%s/fsprofile.conf", dir);
+    write_conf(conf, "# comment\n"
+                     "*      sync=2\n"
+                     "exfat  chunk=1M ring=3 atomic=0   # trailing\n"
+                     "exfat  prealloc=0\n"
+                     "ext4   ring=99\n"
+                     "ext4   colour=blue\n"
+                     "devfs  sendfile=1\n"
+                     "\n");
+    CHECK(ftp_fs_profile_reset(conf) == 4, "valid lines kept");
+
+    ftp_fs_profile_lookup("exfat", &p);
+    CHECK(p.sendfile_chunk == 1024U * 1024U, "chunk with suffix");
+    CHECK(p.stor_ring == 3U, "ring depth");
+    CHECK(p.atomic_rename == 0U, "atomic off");
+    CHECK(p.preallocate == 0U, "later line adds to the earlier one");
+    CHECK(p.sync_policy == 2U, "'*' line applies");
+
+    ftp_fs_profile_lookup("ext4", &p);
+    CHECK(p.stor_ring == FTP_STOR_RING_DEPTH, "out-of-range line ignored");
+    CHECK(p.sync_policy == 2U, "'*' line applies to every type");
+
+    ftp_fs_profile_lookup("devfs", &p);
+    CHECK(p.sendfile == 1U, "file overrides the built-in");
+    CHECK(p.skip_stat == 1U, "built-in keys not overridden stay");
+
+    /* --- Lookup by path: a missing file goes through its directory ------ */
+    ftp_fs_profile_t by_dir;
+    ftp_fs_profile_t by_file;
+    char missing[96];
+    snprintf(missing, sizeof(missing), "%s/not-yet-uploaded.bin", dir);
+    ftp_fs_profile_for_path(dir, &by_dir);
+    ftp_fs_profile_for_path(missing, &by_file);
+    CHECK(memcmp(&by_dir, &by_file, sizeof(by_dir)) == 0,
+          "fresh upload uses the directory's filesystem");
+    int fd = open(dir, O_RDONLY);
+    ftp_fs_profile_for_fd(fd, &by_file);
+    CHECK(memcmp(&by_dir, &by_file, sizeof(by_dir)) == 0, "fd and path agree");
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    /* --- The RETR controller starts from the profile chunk -------------- */
+    ftp_xfer_tune_reset_table();
+    ftp_xfer_tune_t t;
+    ftp_xfer_tune_begin(&t, "exfat");
+    ftp_xfer_tune_default_chunk(&t, 1024U * 1024U);
+    CHECK(t.chunk == 1024U * 1024U && t.best_chunk == t.chunk,
+          "profile chunk");
+    ftp_xfer_tune_default_chunk(&t, 1U);
+    CHECK(t.chunk == FTP_RETR_TUNE_CHUNK_MIN, "chunk clamped");
+
+    CHECK(ftp_fs_profile_reset("/nonexistent/fsprofile.conf") == -1,
+          "unreadable file");
+    ftp_fs_profile_lookup("exfat", &p);
+    CHECK(p.stor_ring == FTP_STOR_RING_DEPTH, "overrides dropped");
+
+    ftp_fs_profile_reset("");
+    (void)unlink(conf);
+    (void)rmdir(dir);
+
+    if (failures != 0) {
+        printf("fsprofile: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("fsprofile: OK\n");
+    return 0;
+}
@@ -0,0 +1,242 @@
+#include "ftp_server.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#if FTP_ENABLE_TLS
+#include "pal_tls.h"
+#endif
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#if FTP_ENABLE_TLS
+static char g_dir[64];
+
+static int dial(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval tv = {5, 0};
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    (void)inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* One reply line, in the clear or over the control TLS session */
+static int reply(int fd, pal_tls_session_t *tls)
+{
+    char line[256];
+    size_t len = 0U;
+    while (len + 1U < sizeof(line)) {
+        char c;
+        int n = (tls != NULL) ? pal_tls_recv(tls, &c, 1U)
+                              : (int)recv(fd, &c, 1U, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        line[len++] = c;
+        if (c == '\n') {
+            break;
+        }
+    }
+    line[len] = '\0';
+    return atoi(line);
+}
+
+static int command(pal_tls_session_t *tls, const char *cmd)
+{
+    char line[128];
+    int len = snprintf(line, sizeof(line), "%s\r\n", cmd);
+    if (pal_tls_send(tls, line, (size_t)len) != len) {
+        return -1;
+    }
+    return reply(-1, tls);
+}
+
+/* PASV over the protected control connection; returns the data port */
+static uint16_t pasv(pal_tls_session_t *tls)
+{
+    char line[128];
+    size_t len = 0U;
+    (void)pal_tls_send(tls, "PASV\r\n", 6U);
+    while (len + 1U < sizeof(line)) {
+        if (pal_tls_recv(tls, &line[len], 1U) != 1) {
+            return 0U;
+        }
+        if (line[len++] == '\n') {
+            break;
+        }
+    }
+    line[len] = '\0';
+    unsigned h[6];
+    const char *p = strchr(line, '(');
+    if ((strncmp(line, "227", 3) != 0) || (p == NULL) ||
+        (sscanf(p, "(%u,%u,%u,%u,%u,%u)", &h[0], &h[1], &h[2], &h[3], &h[4],
+                &h[5]) != 6)) {
+        return 0U;
+    }
+    return (uint16_t)((h[4] << 8) | h[5]);
+}
+
+/*
+ * Run one data command under PROT P and return the payload size, or -1.
+ * The data handshake has to complete even when nothing follows it.
+ */
+static long transfer(pal_tls_session_t *ctrl, const char *cmd)
+{
+    const pal_tls_cfg_t cfg = {.hostname = "localhost", .verify_peer = 0};
+    uint16_t port = pasv(ctrl);
+    CHECK(port != 0U, "227");
+    int fd = dial(port);
+    CHECK(fd >= 0, "data connect");
+    if (fd < 0) {
+        return -1;
+    }
+
+    CHECK(command(ctrl, cmd) == 150, "150");
+    pal_tls_session_t *data = pal_tls_connect(fd, &cfg);
+    CHECK(data != NULL, "data channel handshake");
+
+    long total = -1;
+    if (data != NULL) {
+        char buf[512];
+        int n;
+        total = 0;
+        while ((n = pal_tls_recv(data, buf, sizeof(buf))) > 0) {
+            total += n;
+        }
+        pal_tls_close(data);
+    }
+    close(fd);
+    CHECK(reply(-1, ctrl) == 226, "226");
+    return total;
+}
+
+static void test_prot_p(uint16_t port)
+{
+    const pal_tls_cfg_t cfg = {.hostname = "localhost", .verify_peer = 0};
+    int fd = dial(port);
+    CHECK(fd >= 0, "connect");
+    if (fd < 0) {
+        return;
+    }
+    CHECK(reply(fd, NULL) == 220, "greeting");
+    (void)send(fd, "AUTH TLS\r\n", 10U, 0);
+    CHECK(reply(fd, NULL) == 234, "AUTH TLS");
+
+    pal_tls_session_t *ctrl = pal_tls_connect(fd, &cfg);
+    CHECK(ctrl != NULL, "control handshake");
+    if (ctrl == NULL) {
+        close(fd);
+        return;
+    }
+#if FTP_ENABLE_CRYPTO
+    CHECK(command(ctrl, "AUTH XCRYPT") == 503, "XCRYPT refused under TLS");
+#endif
+    CHECK(command(ctrl, "USER test") == 230, "USER");
+    CHECK(command(ctrl, "PBSZ 0") == 200, "PBSZ");
+    CHECK(command(ctrl, "PROT P") == 200, "PROT P");
+
+    CHECK(transfer(ctrl, "LIST empty") == 0, "empty LIST");
+    CHECK(transfer(ctrl, "NLST empty") == 0, "empty NLST");
+    CHECK(transfer(ctrl, "RETR zero") == 0, "0-byte RETR");
+    CHECK(transfer(ctrl, "RETR five") == 5, "RETR still carries data");
+
+    (void)command(ctrl, "QUIT");
+    pal_tls_close(ctrl);
+    close(fd);
+}
+#endif
+
+int main(void)
+{
+#if !FTP_ENABLE_TLS
+    printf("ftps: skipped (FTP_ENABLE_TLS=0)\n");
+    return 0;
+#else
+    static ftp_server_context_t ctx;
+    uint16_t port = (uint16_t)(30000 + (getpid() % 20000));
+    char path[128];
+    char cmd[384];
+
+    snprintf(g_dir, sizeof(g_dir), "/tmp/zftpd-ftps-%d", (int)getpid());
+    (void)mkdir(g_dir, 0755);
+    snprintf(path, sizeof(path), "%s/empty", g_dir);
+    (void)mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/zero", g_dir);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        close(fd);
+    }
+    snprintf(path, sizeof(path), "%s/five", g_dir);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        CHECK(write(fd, "hello", 5U) == 5, "write");
+        close(fd);
+    }
+
+    snprintf(cmd, sizeof(cmd),
+             "openssl req -x509 -newkey rsa:2048 -nodes -days 1 "
+             "-subj /CN=localhost -keyout %s/key.pem -out %s/cert.pem "
+             ">/dev/null 2>&1",
+             g_dir, g_dir);
+    if (system(cmd) != 0) {
+        printf("ftps: skipped (no openssl to make a certificate)\n");
+        snprintf(cmd, sizeof(cmd), "rm -rf %s", g_dir);
+        (void)system(cmd);
+        return 0;
+    }
+
+    if (ftp_server_init(&ctx, "127.0.0.1", port, g_dir) != FTP_OK) {
+        printf("ftps: cannot listen on %u\n", port);
+        return 1;
+    }
+    char cert[96];
+    char key[96];
+    snprintf(cert, sizeof(cert), "%s/cert.pem", g_dir);
+    snprintf(key, sizeof(key), "%s/key.pem", g_dir);
+    CHECK(ftp_server_enable_tls(&ctx, cert, key) == FTP_OK, "enable TLS");
+    if (ftp_server_start(&ctx) != FTP_OK) {
+        ftp_server_cleanup(&ctx);
+        return 1;
+    }
+
+    test_prot_p(port);
+
+    ftp_server_stop(&ctx);
+    ftp_server_cleanup(&ctx);
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", g_dir);
+    (void)system(cmd);
+
+    if (failures != 0) {
+        printf("ftps: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("ftps: OK\n");
+    return 0;
+#endif
+}
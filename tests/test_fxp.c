@@ -0,0 +1,168 @@
+#include "ftp_config.h"
+#include "ftp_fxp.h"
+#include "ftp_server.h"
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static int allowed(const char *ip)
+{
+    struct in_addr ia;
+    if (inet_pton(AF_INET, ip, &ia) != 1) {
+        return -1;
+    }
+    return ftp_fxp_allowed(ia.s_addr);
+}
+
+static int dial(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval tv = {5, 0};
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    (void)inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Send one command, return the reply line in @p buf and its code */
+static int command(int fd, const char *cmd, char *buf, size_t size)
+{
+    if (cmd != NULL) {
+        (void)send(fd, cmd, strlen(cmd), 0);
+    }
+    ssize_t n = recv(fd, buf, size - 1U, 0);
+    if (n < 3) {
+        buf[0] = '\0';
+        return 0;
+    }
+    buf[n] = '\0';
+    return atoi(buf);
+}
+
+/* A logged-in client may look at the list but never change it */
+static void test_site_fxp(void)
+{
+    static ftp_server_context_t ctx;
+    uint16_t port = (uint16_t)(30000 + ((getpid() + 7) % 20000));
+    char buf[256];
+    char before[256];
+
+    if (ftp_server_init(&ctx, "127.0.0.1", port, "/tmp") != FTP_OK) {
+        printf("fxp: cannot listen on %u\n", port);
+        failures++;
+        return;
+    }
+    CHECK(ftp_server_start(&ctx) == FTP_OK, "server started");
+    CHECK(ftp_fxp_set_allow("192.168.1.20") == 1, "host sets the list");
+    ftp_fxp_format(before, sizeof(before));
+
+    int fd = dial(port);
+    CHECK(fd >= 0, "connect");
+    if (fd >= 0) {
+        CHECK(command(fd, NULL, buf, sizeof(buf)) == 220, "greeting");
+        CHECK(command(fd, "USER test\r\n", buf, sizeof(buf)) == 230, "USER");
+        CHECK(command(fd, "SITE FXP 0.0.0.0/0\r\n", buf, sizeof(buf)) == 504,
+              "SITE FXP <list> refused");
+        CHECK(command(fd, "SITE FXP OFF\r\n", buf, sizeof(buf)) == 504,
+              "SITE FXP OFF refused");
+        CHECK(command(fd, "SITE FXP\r\n", buf, sizeof(buf)) == 200,
+              "SITE FXP shows the list");
+        CHECK(strstr(buf, "192.168.1.20") != NULL, "list in the reply");
+        close(fd);
+    }
+
+    ftp_fxp_format(buf, sizeof(buf));
+    CHECK(strcmp(buf, before) == 0, "list unchanged by the session");
+    CHECK(allowed("203.0.113.9") == 0, "no bounce to others");
+
+    ftp_server_stop(&ctx);
+    ftp_server_cleanup(&ctx);
+}
+
+int main(void)
+{
+    char buf[256];
+
+    /* --- Build default: no FXP ----------------------------------------- */
+    if (FTP_FXP_ALLOW[0] == '\0') {
+        CHECK(allowed("192.168.1.20") == 0, "off by default");
+        ftp_fxp_format(buf, sizeof(buf));
+        CHECK(strcmp(buf, "off") == 0, "default formats as off");
+    }
+
+    /* --- Hosts and CIDR blocks ----------------------------------------- */
+    CHECK(ftp_fxp_set_allow("192.168.1.20, 10.0.0.77/24") == 2, "two entries");
+    CHECK(allowed("192.168.1.20") == 1, "exact host");
+    CHECK(allowed("192.168.1.21") == 0, "neighbour host");
+    CHECK(allowed("10.0.0.1") == 1 && allowed("10.0.0.254") == 1,
+          "inside the block");
+    CHECK(allowed("10.0.1.1") == 0, "outside the block");
+    ftp_fxp_format(buf, sizeof(buf));
+    CHECK(strcmp(buf, "192.168.1.20,10.0.0.0/24") == 0,
+          "formatted with the network address");
+
+    /* --- Bad input leaves the list alone -------------------------------- */
+    CHECK(ftp_fxp_set_allow("10.0.0.0/33") == -1, "prefix too long");
+    CHECK(ftp_fxp_set_allow("10.0.0/8") == -1, "short address");
+    CHECK(ftp_fxp_set_allow("1.2.3.4,host.example") == -1, "hostname");
+    CHECK(ftp_fxp_set_allow("1.2.3.4/") == -1, "empty prefix");
+    CHECK(allowed("192.168.1.20") == 1, "list unchanged after errors");
+
+    char many[FTP_FXP_ALLOW_MAX * 16U + 16U];
+    size_t at = 0U;
+    for (unsigned i = 0U; i <= FTP_FXP_ALLOW_MAX; i++) {
+        at += (size_t)snprintf(many + at, sizeof(many) - at, "%s10.1.0.%u",
+                               (i > 0U) ? "," : "", i + 1U);
+    }
+    CHECK(ftp_fxp_set_allow(many) == -1, "too many entries");
+
+    /* --- Blocks wider than FTP_FXP_PREFIX_MIN are refused ---------------- */
+    char wide[32];
+    (void)snprintf(wide, sizeof(wide), "10.0.0.0/%u",
+                   (unsigned)FTP_FXP_PREFIX_MIN - 1U);
+    CHECK(ftp_fxp_set_allow("0.0.0.0/0") == -1, "/0 refused");
+    CHECK(ftp_fxp_set_allow(wide) == -1, "wider than the minimum");
+    CHECK(allowed("203.0.113.9") == 0, "no host opened");
+    (void)snprintf(wide, sizeof(wide), "10.0.0.0/%u",
+                   (unsigned)FTP_FXP_PREFIX_MIN);
+    CHECK(ftp_fxp_set_allow(wide) == 1, "minimum prefix accepted");
+
+    /* --- OFF clears ------------------------------------------------------ */
+    CHECK(ftp_fxp_set_allow("OFF") == 0, "off");
+    CHECK(allowed("10.0.0.1") == 0, "off clears");
+    CHECK(ftp_fxp_set_allow("") == 0, "empty clears");
+    CHECK(ftp_fxp_set_allow(NULL) == -1, "NULL");
+
+    test_site_fxp();
+
+    if (failures != 0) {
+        printf("fxp: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("fxp: OK\n");
+    return 0;
+}
@@ -0,0 +1,363 @@
+#include "ftp_handoff.h"
+#include "ftp_list.h"
+#include "ftp_pasv_pool.h"
+#include "ftp_server.h"
+#include <arpa/inet.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+/* The "old" process of the in-process hand-off */
+static ftp_server_context_t g_old;
+static atomic_int g_done_calls;
+static atomic_int g_done_adopted;
+
+static int collect(ftp_handoff_set_t *set, void *user)
+{
+    (void)user;
+    int fds[FTP_ACCEPT_THREADS_MAX];
+    uint32_t n = ftp_server_listeners(&g_old, fds, FTP_ACCEPT_THREADS_MAX);
+    for (uint32_t i = 0U; i < n; i++) {
+        (void)ftp_handoff_add(set, fds[i], FTP_HANDOFF_FTP);
+    }
+    return (n > 0U) ? 0 : -1;
+}
+
+static void done(const ftp_handoff_set_t *set, int adopted, void *user)
+{
+    (void)set;
+    (void)user;
+    if (adopted != 0) {
+        ftp_server_release_listeners(&g_old);
+    }
+    atomic_store(&g_done_adopted, adopted);
+    atomic_fetch_add(&g_done_calls, 1);
+}
+
+static int dial(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct timeval tv = {5, 0};
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    (void)inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Reply code of the next line, 0 on timeout / EOF */
+static int reply(int fd)
+{
+    char buf[256];
+    ssize_t n = recv(fd, buf, sizeof(buf) - 1U, 0);
+    if (n < 3) {
+        return 0;
+    }
+    buf[n] = '\0';
+    return atoi(buf);
+}
+
+static uint16_t local_port(int fd)
+{
+    struct sockaddr_in a;
+    socklen_t len = (socklen_t)sizeof(a);
+    if (getsockname(fd, (struct sockaddr *)&a, &len) != 0) {
+        return 0U;
+    }
+    return ntohs(a.sin_port);
+}
+
+static void wait_done(int calls)
+{
+    for (int i = 0; (i < 500) && (atomic_load(&g_done_calls) < calls); i++) {
+        usleep(10000);
+    }
+}
+
+static void test_messages(void)
+{
+    ftp_handoff_set_t out;
+    ftp_handoff_set_t in;
+    memset(&out, 0, sizeof(out));
+    CHECK(ftp_handoff_send(-1, &out) != 0, "empty set not sent");
+
+    uint16_t port = 0U;
+    int l1 = ftp_pasv_listen(0x7F000001U, 0U, 0U, &port);
+    int l2 = ftp_pasv_listen(0x7F000001U, 0U, 0U, NULL);
+    CHECK((l1 >= 0) && (l2 >= 0), "listeners");
+    CHECK(ftp_handoff_add(&out, l1, FTP_HANDOFF_FTP) == 0, "add");
+    CHECK(ftp_handoff_add(&out, l2, FTP_HANDOFF_PASV) == 0, "add");
+    CHECK(ftp_handoff_add(&out, -1, FTP_HANDOFF_PASV) != 0, "bad fd");
+
+    int sp[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sp) == 0, "socketpair");
+    CHECK(ftp_handoff_send(sp[0], &out) == 0, "send");
+    CHECK(ftp_handoff_recv(sp[1], &in) == 0, "recv");
+    CHECK(in.count == 2U, "both fds");
+    CHECK((in.kinds[0] == FTP_HANDOFF_FTP) &&
+              (in.kinds[1] == FTP_HANDOFF_PASV),
+          "kinds in order");
+    CHECK((in.fds[0] != l1) && (local_port(in.fds[0]) == port),
+          "new descriptor, same socket");
+
+    int pick[4];
+    CHECK(ftp_handoff_pick(&in, FTP_HANDOFF_PASV, pick, 4U) == 1U &&
+              (pick[0] == in.fds[1]),
+          "pick by kind");
+    CHECK(ftp_handoff_pick(&in, FTP_HANDOFF_HTTP, pick, 4U) == 0U,
+          "no http");
+
+    /* A connected socket is not a listener: the whole message fails */
+    int sp2[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sp2) == 0, "socketpair");
+    memset(&out, 0, sizeof(out));
+    CHECK(ftp_handoff_add(&out, l1, FTP_HANDOFF_FTP) == 0, "add");
+    CHECK(ftp_handoff_add(&out, sp2[1], FTP_HANDOFF_PASV) == 0, "add");
+    CHECK(ftp_handoff_send(sp[0], &out) == 0, "send");
+    CHECK(ftp_handoff_recv(sp[1], &in) != 0, "non-listener rejected");
+    CHECK(in.count == 0U, "nothing handed back");
+    close(sp2[0]);
+    close(sp2[1]);
+
+    /* Garbage instead of a message */
+    (void)send(sp[0], "junk", 4U, 0);
+    close(sp[0]);
+    CHECK(ftp_handoff_recv(sp[1], &in) != 0, "malformed rejected");
+    close(sp[1]);
+    close(l1);
+    close(l2);
+    close(pick[0]);
+    close(in.fds[0]);
+}
+
+static void test_pasv_pool(void)
+{
+    ftp_pasv_pool_t *a = ftp_pasv_pool_create(4U, 0U, 0U);
+    ftp_pasv_pool_t *b = ftp_pasv_pool_create(4U, 0U, 0U);
+    int l1 = ftp_pasv_pool_lease(a, 0x7F000001U, NULL);
+    int l2 = ftp_pasv_pool_lease(a, 0x7F000001U, NULL);
+    ftp_pasv_pool_return(a, l1);
+    ftp_pasv_pool_return(a, l2);
+
+    int fds[4];
+    CHECK(ftp_pasv_pool_detach_idle(a, fds, 4U) == 2U, "two idle detached");
+    ftp_pasv_pool_stats_t st;
+    ftp_pasv_pool_get_stats(a, &st);
+    CHECK(st.idle == 0U, "pool emptied");
+
+    CHECK(ftp_pasv_pool_adopt(b, fds[0]) == 0, "adopt");
+    CHECK(ftp_pasv_pool_adopt(b, fds[1]) == 0, "adopt");
+    CHECK(ftp_pasv_pool_adopt(b, 0) != 0, "not a socket");
+    uint16_t port = 0U;
+    int l = ftp_pasv_pool_lease(b, 0x7F000001U, &port);
+    ftp_pasv_pool_get_stats(b, &st);
+    CHECK((st.reused == 1U) && (st.created == 0U), "adopted listener leased");
+    CHECK((l >= 0) && (port == local_port(l)), "port reported");
+    ftp_pasv_pool_return(b, l);
+
+    ftp_pasv_pool_destroy(a);
+    ftp_pasv_pool_destroy(b);
+}
+
+static void test_list_snapshot(void)
+{
+    char dir[] = "/tmp/zftpd-ho-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        failures++;
+        return;
+    }
+    char file[64];
+    char snap[64];
+    (void)snprintf(file, sizeof(file), "%s/a.bin", dir);
+    (void)snprintf(snap, sizeof(snap), "%s.snap", dir);
+    FILE *f = fopen(file, "w");
+    if (f != NULL) {
+        fclose(f);
+    }
+    /* An mtime older than a second is trusted by the cache */
+    struct timeval tv[2];
+    gettimeofday(&tv[0], NULL);
+    tv[0].tv_sec -= 10;
+    tv[1] = tv[0];
+    (void)utimes(dir, tv);
+
+    ftp_list_cache_clear();
+    ftp_list_snapshot_t s;
+    CHECK(ftp_list_snapshot(dir, &s) == FTP_OK && s.count == 1U, "listed");
+    ftp_list_snapshot_release(&s);
+
+    CHECK(ftp_list_cache_save(snap) == 1, "one listing saved");
+    ftp_list_cache_clear();
+    CHECK(ftp_list_cache_load(snap) == 1, "loaded back");
+    ftp_list_cache_stats_t st;
+    ftp_list_cache_get_stats(&st);
+    uint64_t hits = st.hits;
+    CHECK(st.entries == 1U, "entry restored");
+    CHECK(ftp_list_snapshot(dir, &s) == FTP_OK && s.count == 1U,
+          "listed again");
+    ftp_list_snapshot_release(&s);
+    ftp_list_cache_get_stats(&st);
+    CHECK(st.hits == hits + 1U, "served from the restored entry");
+
+    /* A directory that changed since the save is not restored */
+    ftp_list_cache_clear();
+    (void)unlink(file);
+    CHECK(ftp_list_cache_load(snap) == 0, "stale listing skipped");
+    CHECK(ftp_list_cache_load("/nonexistent/list.snap") == -1, "no file");
+    f = fopen(snap, "w");
+    if (f != NULL) {
+        fputs("ZLC0 garbage", f);
+        fclose(f);
+    }
+    CHECK(ftp_list_cache_load(snap) == -1, "bad header");
+
+    (void)unlink(snap);
+    (void)rmdir(dir);
+    ftp_list_cache_clear();
+}
+
+static void test_server_handoff(void)
+{
+    static ftp_server_context_t next;
+    char dir[64];
+    char path[80];
+    (void)snprintf(dir, sizeof(dir), "/tmp/zftpd-ho-%d", (int)getpid());
+    (void)snprintf(path, sizeof(path), "%s/handoff.sock", dir);
+    uint16_t port = (uint16_t)(30000 + ((getpid() + 11) % 20000));
+
+    ftp_handoff_set_t in;
+    int link = -1;
+    ftp_handoff_ops_t ops = {collect, done, NULL};
+    CHECK(ftp_handoff_take(path, &in, &link) == FTP_ERR_NOT_FOUND,
+          "nobody serving");
+
+    /* Only a directory closed to others may hold the socket */
+    CHECK(mkdir(dir, 0755) == 0, "open directory");
+    CHECK(ftp_handoff_serve(path, &ops) == FTP_ERR_PERMISSION,
+          "refused in an open directory");
+    CHECK(rmdir(dir) == 0, "rmdir");
+
+    if (ftp_server_init(&g_old, "127.0.0.1", port, "/tmp") != FTP_OK) {
+        printf("handoff: cannot listen on %u\n", port);
+        failures++;
+        return;
+    }
+    CHECK(ftp_server_start(&g_old) == FTP_OK, "old started");
+    CHECK(ftp_handoff_serve(path, &ops) == FTP_OK, "serving");
+    struct stat st;
+    CHECK((stat(dir, &st) == 0) && ((st.st_mode & 0777U) == 0700U),
+          "private directory created");
+    CHECK(ftp_handoff_serve(path, &ops) != FTP_OK, "one server");
+
+    /* A session of the old process, open across the hand-off */
+    int before = dial(port);
+    CHECK((before >= 0) && (reply(before) == 220), "old greets");
+
+    /* Declined: the old process keeps accepting */
+    CHECK(ftp_handoff_take(path, &in, &link) == FTP_OK, "taken");
+    for (uint32_t i = 0U; i < in.count; i++) {
+        close(in.fds[i]);
+    }
+    ftp_handoff_confirm(link, 0);
+    wait_done(1);
+    CHECK((atomic_load(&g_done_calls) == 1) &&
+              (atomic_load(&g_done_adopted) == 0),
+          "declined");
+    CHECK(ftp_handoff_released() == 0, "not released");
+    int c = dial(port);
+    CHECK((c >= 0) && (reply(c) == 220), "old still accepts");
+    if (c >= 0) {
+        close(c);
+    }
+
+    /* Adopted */
+    CHECK(ftp_handoff_take(path, &in, &link) == FTP_OK, "taken again");
+    int fds[FTP_ACCEPT_THREADS_MAX];
+    uint32_t n = ftp_handoff_pick(&in, FTP_HANDOFF_FTP, fds,
+                                  FTP_ACCEPT_THREADS_MAX);
+    CHECK(ftp_server_init_fds(&next, fds, n, "/tmp") == FTP_OK, "adopted");
+    CHECK(next.port == port, "same port");
+    CHECK(ftp_server_set_acceptors(&next, 2U) != FTP_OK,
+          "acceptors fixed by the inherited set");
+    CHECK(ftp_server_start(&next) == FTP_OK, "new started");
+    ftp_handoff_confirm(link, 1);
+    wait_done(2);
+    for (int i = 0; (i < 100) && (ftp_handoff_released() == 0); i++) {
+        usleep(10000);
+    }
+    CHECK(ftp_handoff_released() == 1, "released");
+
+    uint32_t fds_left = ftp_server_listeners(&g_old, fds, 1U);
+    CHECK(fds_left == 0U, "old listeners closed");
+    c = dial(port);
+    CHECK((c >= 0) && (reply(c) == 220), "new greets");
+    if (c >= 0) {
+        close(c);
+    }
+    CHECK(ftp_server_get_active_sessions(&g_old) == 1U, "old drains");
+    if (before >= 0) {
+        (void)send(before, "NOOP\r\n", 6U, 0);
+        CHECK(reply(before) == 200, "old session still served");
+        close(before);
+    }
+
+    /* The old process going away leaves the port with the new one */
+    ftp_server_stop(&g_old);
+    ftp_server_cleanup(&g_old);
+    ftp_handoff_serve_stop();
+    CHECK(access(path, F_OK) == 0, "socket file left to the new process");
+    c = dial(port);
+    CHECK((c >= 0) && (reply(c) == 220), "port survives the old process");
+    if (c >= 0) {
+        close(c);
+    }
+
+    ftp_server_stop(&next);
+    ftp_server_cleanup(&next);
+    c = dial(port);
+    CHECK(c < 0, "port closed with the last owner");
+    if (c >= 0) {
+        close(c);
+    }
+    (void)unlink(path);
+    (void)rmdir(dir);
+}
+
+int main(void)
+{
+    test_messages();
+    test_pasv_pool();
+    test_list_snapshot();
+    test_server_handoff();
+
+    if (failures != 0) {
+        printf("handoff: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("handoff: OK\n");
+    return 0;
+}
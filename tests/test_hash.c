@@ -0,0 +1,219 @@
+#include "ftp_config.h"
+#include <stdio.h>
+
+#if FTP_ENABLE_HASH
+
+#include "ftp_hash.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+static void hex_of(ftp_hash_algo_t algo, const void *data, size_t len,
+                   char *out, size_t out_size)
+{
+    ftp_hash_ctx_t ctx;
+    uint8_t d[FTP_HASH_MAX_DIGEST];
+    ftp_hash_init(&ctx, algo);
+    ftp_hash_update(&ctx, data, len);
+    ftp_hash_final(&ctx, d);
+    ftp_hash_hex(d, ftp_hash_digest_len(algo), out, out_size);
+}
+
+static void expect(ftp_hash_algo_t algo, const char *msg, const char *want)
+{
+    char hex[FTP_HASH_HEX_MAX];
+    hex_of(algo, msg, strlen(msg), hex, sizeof(hex));
+    if (strcmp(hex, want) != 0) {
+        printf("FAIL %s(\"%s\") [%s] = %s, want %s\n", ftp_hash_name(algo),
+               msg, ftp_hash_kernel_name(algo), hex, want);
+        failures++;
+    }
+}
+
+static void test_vectors(void)
+{
+    expect(FTP_HASH_CRC32, "123456789", "cbf43926");
+    expect(FTP_HASH_CRC32, "", "00000000");
+    expect(FTP_HASH_MD5, "", "d41d8cd98f00b204e9800998ecf8427e");
+    expect(FTP_HASH_MD5, "abc", "900150983cd24fb0d6963f7d28e17f72");
+    expect(FTP_HASH_SHA1, "", "da39a3ee5e6b4b0d3255bfef95601890afd80709");
+    expect(FTP_HASH_SHA1, "abc", "a9993e364706816aba3e25717850c26c9cd0d89d");
+    expect(FTP_HASH_SHA256, "",
+           "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    expect(FTP_HASH_SHA256, "abc",
+           "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    expect(FTP_HASH_SHA256,
+           "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+           "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+}
+
+/* Accelerated vs portable kernels, fed in odd-sized pieces */
+static void test_cross_check(void)
+{
+    size_t len = 1U << 20;
+    uint8_t *buf = malloc(len);
+    if (buf == NULL) {
+        failures++;
+        return;
+    }
+    uint32_t x = 0x12345678U;
+    for (size_t i = 0U; i < len; i++) {
+        x = x * 1103515245U + 12345U;
+        buf[i] = (uint8_t)(x >> 16);
+    }
+
+    for (int a = 0; a < (int)FTP_HASH_ALGO_COUNT; a++) {
+        ftp_hash_algo_t algo = (ftp_hash_algo_t)a;
+        char fast[FTP_HASH_HEX_MAX];
+        char slow[FTP_HASH_HEX_MAX];
+        hex_of(algo, buf, len, fast, sizeof(fast));
+
+        ftp_hash_force_scalar(1);
+        ftp_hash_ctx_t ctx;
+        uint8_t d[FTP_HASH_MAX_DIGEST];
+        ftp_hash_init(&ctx, algo);
+        size_t off = 0U;
+        size_t step = 1U;
+        while (off < len) {
+            size_t n = (len - off < step) ? (len - off) : step;
+            ftp_hash_update(&ctx, buf + off, n);
+            off += n;
+            step = (step * 7U + 3U) % 4099U;
+        }
+        ftp_hash_final(&ctx, d);
+        ftp_hash_hex(d, ftp_hash_digest_len(algo), slow, sizeof(slow));
+        ftp_hash_force_scalar(0);
+
+        if (strcmp(fast, slow) != 0) {
+            printf("FAIL %s kernel %s: %s != scalar %s\n", ftp_hash_name(algo),
+                   ftp_hash_kernel_name(algo), fast, slow);
+            failures++;
+        }
+    }
+    free(buf);
+}
+
+static void test_fd_and_cache(void)
+{
+    char path[] = "/tmp/zftpd-test-hash-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        failures++;
+        return;
+    }
+    /* Larger than one read chunk so the pipeline cycles buffers */
+    size_t len = (size_t)FTP_HASH_READ_CHUNK * 3U + 17U;
+    uint8_t *buf = malloc(len);
+    if (buf == NULL) {
+        close(fd);
+        unlink(path);
+        failures++;
+        return;
+    }
+    for (size_t i = 0U; i < len; i++) {
+        buf[i] = (uint8_t)(i * 31U);
+    }
+    if (write(fd, buf, len) != (ssize_t)len) {
+        failures++;
+    }
+
+    char want[FTP_HASH_HEX_MAX];
+    char got[FTP_HASH_HEX_MAX];
+    hex_of(FTP_HASH_SHA256, buf, len, want, sizeof(want));
+    uint8_t d[FTP_HASH_MAX_DIGEST];
+    uint64_t bytes = 0U;
+    if (ftp_hash_fd(fd, FTP_HASH_SHA256, d, &bytes) != 0 ||
+        bytes != (uint64_t)len) {
+        printf("FAIL ftp_hash_fd bytes=%llu\n", (unsigned long long)bytes);
+        failures++;
+    }
+    ftp_hash_hex(d, 32U, got, sizeof(got));
+    if (strcmp(got, want) != 0) {
+        printf("FAIL ftp_hash_fd digest %s != %s\n", got, want);
+        failures++;
+    }
+    close(fd);
+
+    char idx[] = "/tmp/zftpd-test-hidx-XXXXXX";
+    int ifd = mkstemp(idx);
+    if (ifd >= 0) {
+        close(ifd);
+    }
+    ftp_hash_cache_reset(idx);
+
+    uint8_t hit[FTP_HASH_MAX_DIGEST];
+    if (ftp_hash_cache_lookup(path, FTP_HASH_SHA256, len, 1000, hit) != 0) {
+        printf("FAIL cache hit on empty index\n");
+        failures++;
+    }
+    ftp_hash_cache_store(path, FTP_HASH_SHA256, len, 1000, d);
+    if (ftp_hash_cache_lookup(path, FTP_HASH_SHA256, len, 1000, hit) != 1 ||
+        memcmp(hit, d, 32U) != 0) {
+        printf("FAIL cache miss after store\n");
+        failures++;
+    }
+    if (ftp_hash_cache_lookup(path, FTP_HASH_SHA256, len, 1001, hit) != 0) {
+        printf("FAIL cache hit on changed mtime\n");
+        failures++;
+    }
+    if (ftp_hash_cache_lookup(path, FTP_HASH_MD5, len, 1000, hit) != 0) {
+        printf("FAIL cache hit on other algorithm\n");
+        failures++;
+    }
+
+    /* Survives a reload from disk */
+    ftp_hash_cache_reset(idx);
+    memset(hit, 0, sizeof(hit));
+    if (ftp_hash_cache_lookup(path, FTP_HASH_SHA256, len, 1000, hit) != 1 ||
+        memcmp(hit, d, 32U) != 0) {
+        printf("FAIL cache entry not persisted\n");
+        failures++;
+    }
+
+    ftp_hash_cache_reset("");
+    unlink(idx);
+    unlink(path);
+    free(buf);
+}
+
+static void test_names(void)
+{
+    ftp_hash_algo_t a;
+    if (ftp_hash_from_name("sha-256", &a) != 0 || a != FTP_HASH_SHA256 ||
+        ftp_hash_from_name("CRC32", &a) != 0 || a != FTP_HASH_CRC32 ||
+        ftp_hash_from_name("XXH3", &a) == 0) {
+        printf("FAIL ftp_hash_from_name\n");
+        failures++;
+    }
+}
+
+int main(void)
+{
+    test_vectors();
+    test_cross_check();
+    test_fd_and_cache();
+    test_names();
+
+    if (failures != 0) {
+        printf("test_hash: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("test_hash: OK (sha256=%s crc32=%s)\n",
+           ftp_hash_kernel_name(FTP_HASH_SHA256),
+           ftp_hash_kernel_name(FTP_HASH_CRC32));
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("test_hash: skipped (FTP_ENABLE_HASH=0)\n");
+    return 0;
+}
+
+#endif
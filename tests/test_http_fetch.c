@@ -0,0 +1,348 @@
+#include "http_fetch.h"
+#include "http_config.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define FILE_SIZE (24U * 1024U * 1024U + 4321U)
+
+/* Server behaviour, switched by the test between fetches */
+static atomic_int g_ranges = 1;      /* 0 = ignore Range, always 200 */
+static atomic_int g_slow_first = 0;  /* throttle the range starting at 0 */
+static atomic_int g_fail_after = 0;  /* MB served before every GET gets 503 */
+static atomic_int g_throttle = 0;    /* throttle every body */
+static atomic_uint g_range_gets = 0; /* ranged GETs answered with 206 */
+static atomic_uint g_open = 0;
+static atomic_uint g_max_open = 0;
+static _Atomic uint64_t g_served = 0;
+
+static uint8_t pattern(uint64_t off)
+{
+    return (uint8_t)((off * 131U) ^ (off >> 11));
+}
+
+static int send_all(int fd, const void *buf, size_t len)
+{
+    const char *p = (const char *)buf;
+    while (len > 0U) {
+        ssize_t w = send(fd, p, len, MSG_NOSIGNAL);
+        if (w <= 0) {
+            return -1;
+        }
+        p += (size_t)w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+static void *serve_one(void *arg)
+{
+    int fd = (int)(intptr_t)arg;
+    unsigned open_now = atomic_fetch_add(&g_open, 1U) + 1U;
+    unsigned seen = atomic_load(&g_max_open);
+    while ((open_now > seen) &&
+           !atomic_compare_exchange_weak(&g_max_open, &seen, open_now)) {
+    }
+
+    char req[4096];
+    req[0] = '\0';
+    size_t got = 0U;
+    while ((got < sizeof(req) - 1U) && (strstr(req, "\r\n\r\n") == NULL)) {
+        ssize_t n = recv(fd, req + got, sizeof(req) - 1U - got, 0);
+        if (n <= 0) {
+            break;
+        }
+        got += (size_t)n;
+        req[got] = '\0';
+    }
+    req[got] = '\0';
+
+    int head = (strncmp(req, "HEAD ", 5U) == 0) ? 1 : 0;
+    uint64_t from = 0U;
+    uint64_t to = FILE_SIZE - 1U;
+    int ranged = 0;
+    const char *r = strcasestr(req, "\r\nRange: bytes=");
+    if ((r != NULL) && (atomic_load(&g_ranges) != 0)) {
+        char *end = NULL;
+        from = strtoull(r + 15, &end, 10);
+        if ((end != NULL) && (*end == '-') && (end[1] >= '0') &&
+            (end[1] <= '9')) {
+            to = strtoull(end + 1, NULL, 10);
+        }
+        if (to >= FILE_SIZE) {
+            to = FILE_SIZE - 1U;
+        }
+        ranged = 1;
+    }
+
+    int fail_mb = atomic_load(&g_fail_after);
+    char hdr[256];
+    int hl;
+    if ((head == 0) && (fail_mb > 0) &&
+        (atomic_load(&g_served) >= (uint64_t)fail_mb * 1024U * 1024U)) {
+        hl = snprintf(hdr, sizeof(hdr),
+                      "HTTP/1.1 503 Busy\r\nContent-Length: 0\r\n"
+                      "Connection: close\r\n\r\n");
+        (void)send_all(fd, hdr, (size_t)hl);
+        goto out;
+    }
+    if (ranged != 0) {
+        hl = snprintf(hdr, sizeof(hdr),
+                      "HTTP/1.1 206 Partial Content\r\n"
+                      "Content-Length: %llu\r\n"
+                      "Content-Range: bytes %llu-%llu/%u\r\n"
+                      "Connection: close\r\n\r\n",
+                      (unsigned long long)(to - from + 1U),
+                      (unsigned long long)from, (unsigned long long)to,
+                      FILE_SIZE);
+        if (head == 0) {
+            atomic_fetch_add(&g_range_gets, 1U);
+        }
+    } else {
+        hl = snprintf(hdr, sizeof(hdr),
+                      "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n"
+                      "Accept-Ranges: %s\r\nConnection: close\r\n\r\n",
+                      FILE_SIZE, atomic_load(&g_ranges) ? "bytes" : "none");
+    }
+    if ((send_all(fd, hdr, (size_t)hl) != 0) || (head != 0)) {
+        goto out;
+    }
+
+    int slow = (ranged != 0) && (from == 0U) && (to > 0U) &&
+               (atomic_load(&g_slow_first) != 0);
+    static __thread uint8_t chunk[65536];
+    uint64_t off = from;
+    while (off <= to) {
+        size_t n = sizeof(chunk);
+        if ((uint64_t)n > to - off + 1U) {
+            n = (size_t)(to - off + 1U);
+        }
+        for (size_t i = 0U; i < n; i++) {
+            chunk[i] = pattern(off + i);
+        }
+        if (send_all(fd, chunk, n) != 0) {
+            break;
+        }
+        off += n;
+        uint64_t served = atomic_fetch_add(&g_served, (uint64_t)n) + n;
+        if ((fail_mb > 0) && (served >= (uint64_t)fail_mb * 1024U * 1024U)) {
+            break; /* drop mid-body; reconnects get 503 */
+        }
+        if ((slow != 0) || (atomic_load(&g_throttle) != 0)) {
+            usleep(20000); /* ~3 MB/s */
+        }
+    }
+out:
+    close(fd);
+    atomic_fetch_sub(&g_open, 1U);
+    return NULL;
+}
+
+static void *server_main(void *arg)
+{
+    int lfd = (int)(intptr_t)arg;
+    for (;;) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) {
+            break;
+        }
+        pthread_t t;
+        if (pthread_create(&t, NULL, serve_one, (void *)(intptr_t)fd) == 0) {
+            pthread_detach(t);
+        } else {
+            close(fd);
+        }
+    }
+    return NULL;
+}
+
+static int file_ok(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        return 0;
+    }
+    uint64_t off = 0U;
+    int c;
+    int ok = 1;
+    while ((c = fgetc(f)) != EOF) {
+        if ((uint8_t)c != pattern(off)) {
+            ok = 0;
+            break;
+        }
+        off++;
+    }
+    fclose(f);
+    return (ok != 0) && (off == FILE_SIZE);
+}
+
+typedef struct {
+    const char *url;
+    const char *path;
+    http_fetch_ctl_t *ctl;
+    int rc;
+} fetch_arg_t;
+
+static void *fetch_thread(void *arg)
+{
+    fetch_arg_t *a = (fetch_arg_t *)arg;
+    char err[256];
+    a->rc = http_fetch(a->url, a->path, a->ctl, err, sizeof(err));
+    return NULL;
+}
+
+static void wait_bytes(http_fetch_ctl_t *ctl, uint64_t bytes)
+{
+    for (int i = 0; (i < 1000) && (atomic_load(&ctl->downloaded) < bytes);
+         i++) {
+        usleep(10000);
+    }
+}
+
+int main(void)
+{
+    signal(SIGPIPE, SIG_IGN);
+
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t sl = sizeof(sa);
+    if ((lfd < 0) || (bind(lfd, (struct sockaddr *)&sa, sizeof(sa)) != 0) ||
+        (listen(lfd, 64) != 0) ||
+        (getsockname(lfd, (struct sockaddr *)&sa, &sl) != 0)) {
+        printf("http_fetch: cannot listen\n");
+        return 1;
+    }
+    pthread_t srv;
+    pthread_create(&srv, NULL, server_main, (void *)(intptr_t)lfd);
+
+    char url[128];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/file.pkg",
+             (unsigned)ntohs(sa.sin_port));
+    char dir_template[] = "/tmp/zftpd-fetch-XXXXXX";
+    char *dir = mkdtemp(dir_template);
+    if (dir == NULL) {
+        return 1;
+    }
+    char path[512];
+    char state[600];
+    snprintf(path, sizeof(path), "%s/file.pkg", dir);
+    snprintf(state, sizeof(state), "%s.zdl", path);
+    char err[256];
+
+    /* Ranged: several connections, one file, no state left behind */
+    http_fetch_ctl_t ctl;
+    memset(&ctl, 0, sizeof(ctl));
+    CHECK(http_fetch(url, path, &ctl, err, sizeof(err)) == HTTP_FETCH_OK,
+          "ranged fetch");
+    CHECK(file_ok(path) != 0, "ranged file intact");
+    CHECK(access(state, F_OK) != 0, "state removed");
+    CHECK(atomic_load(&g_max_open) >= 2U, "parallel connections");
+    CHECK((atomic_load(&ctl.downloaded) == FILE_SIZE) &&
+              (atomic_load(&ctl.total) == FILE_SIZE),
+          "ranged counters");
+
+    /* A slow connection gives away the tail of its range */
+    atomic_store(&g_range_gets, 0U);
+    atomic_store(&g_slow_first, 1);
+    memset(&ctl, 0, sizeof(ctl));
+    CHECK(http_fetch(url, path, &ctl, err, sizeof(err)) == HTTP_FETCH_OK,
+          "fetch with a slow connection");
+    atomic_store(&g_slow_first, 0);
+    CHECK(file_ok(path) != 0, "stolen ranges intact");
+    CHECK(atomic_load(&g_range_gets) > 1U + HTTP_FETCH_SEGMENTS,
+          "work was stolen");
+
+    /* No range support: one plain connection */
+    atomic_store(&g_ranges, 0);
+    atomic_store(&g_range_gets, 0U);
+    memset(&ctl, 0, sizeof(ctl));
+    CHECK(http_fetch(url, path, &ctl, err, sizeof(err)) == HTTP_FETCH_OK,
+          "plain fetch");
+    CHECK(file_ok(path) != 0, "plain file intact");
+    CHECK(atomic_load(&g_range_gets) == 0U, "no ranged requests");
+    atomic_store(&g_ranges, 1);
+
+    /* Pause closes the connections and holds the position */
+    fetch_arg_t fa = {url, path, &ctl, -99};
+    pthread_t ft;
+    memset(&ctl, 0, sizeof(ctl));
+    atomic_store(&g_throttle, 1);
+    pthread_create(&ft, NULL, fetch_thread, &fa);
+    wait_bytes(&ctl, 2U * 1024U * 1024U);
+    atomic_store(&ctl.paused, 1);
+    usleep(300000);
+    uint64_t held = atomic_load(&ctl.downloaded);
+    usleep(300000);
+    CHECK(atomic_load(&ctl.connections) == 0, "paused: no connections");
+    CHECK(atomic_load(&ctl.downloaded) == held, "paused: no progress");
+    CHECK(held < FILE_SIZE, "paused before the end");
+    atomic_store(&g_throttle, 0);
+    atomic_store(&ctl.paused, 0);
+    pthread_join(ft, NULL);
+    CHECK(fa.rc == HTTP_FETCH_OK, "resumed after pause");
+    CHECK(file_ok(path) != 0, "paused file intact");
+
+    /* A failing server leaves a state file; the next fetch resumes */
+    atomic_store(&g_served, 0U);
+    atomic_store(&g_fail_after, 10);
+    memset(&ctl, 0, sizeof(ctl));
+    CHECK(http_fetch(url, path, &ctl, err, sizeof(err)) == HTTP_FETCH_FAILED,
+          "fetch fails");
+    CHECK(access(state, F_OK) == 0, "state kept after a failure");
+    atomic_store(&g_fail_after, 0);
+    atomic_store(&g_served, 0U);
+    memset(&ctl, 0, sizeof(ctl));
+    CHECK(http_fetch(url, path, &ctl, err, sizeof(err)) == HTTP_FETCH_OK,
+          "resumed fetch");
+    CHECK(atomic_load(&ctl.resumed) >= 8U * 1024U * 1024U,
+          "resume kept the earlier bytes");
+    CHECK(atomic_load(&g_served) <= FILE_SIZE - atomic_load(&ctl.resumed) +
+                                        1024U * 1024U,
+          "resume skipped the earlier bytes");
+    CHECK(file_ok(path) != 0, "resumed file intact");
+    CHECK(access(state, F_OK) != 0, "state removed after resume");
+
+    /* Cancel removes the partial file and its state */
+    memset(&ctl, 0, sizeof(ctl));
+    atomic_store(&g_throttle, 1);
+    fa.rc = -99;
+    pthread_create(&ft, NULL, fetch_thread, &fa);
+    wait_bytes(&ctl, 1024U * 1024U);
+    atomic_store(&ctl.cancel, 1);
+    pthread_join(ft, NULL);
+    atomic_store(&g_throttle, 0);
+    CHECK(fa.rc == HTTP_FETCH_CANCELLED, "cancelled");
+    CHECK((access(path, F_OK) != 0) && (access(state, F_OK) != 0),
+          "cancel cleans up");
+
+    (void)rmdir(dir);
+    if (failures != 0) {
+        printf("http_fetch: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("http_fetch: OK\n");
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include "ftp_config.h"
+#include "http_games.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static char g_root[64];
+static char g_base[96];
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    put_le16(p, (uint16_t)v);
+    put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void write_file(const char *path, const void *data, size_t len)
+{
+    FILE *f = fopen(path, "wb");
+    if (f != NULL) {
+        (void)fwrite(data, 1, len, f);
+        fclose(f);
+    }
+}
+
+/* param.sfo with utf-8 string values for keys[i] = values[i] */
+static void write_sfo(const char *path, const char *const *keys,
+                      const char *const *values, uint32_t count)
+{
+    uint8_t buf[2048];
+    memset(buf, 0, sizeof(buf));
+    uint32_t key_ofs = 0x14U + (count * 16U);
+    uint32_t klen = 0U;
+    for (uint32_t i = 0U; i < count; i++) {
+        klen += (uint32_t)strlen(keys[i]) + 1U;
+    }
+    uint32_t data_ofs = (key_ofs + klen + 3U) & ~3U;
+
+    put_le32(buf, 0x46535000U);
+    put_le32(buf + 0x04, 0x101U);
+    put_le32(buf + 0x08, key_ofs);
+    put_le32(buf + 0x0C, data_ofs);
+    put_le32(buf + 0x10, count);
+    uint32_t k = 0U;
+    uint32_t d = 0U;
+    for (uint32_t i = 0U; i < count; i++) {
+        uint8_t *e = buf + 0x14 + (i * 16U);
+        uint32_t vlen = (uint32_t)strlen(values[i]) + 1U;
+        put_le16(e, (uint16_t)k);
+        put_le16(e + 2, 0x0204U);
+        put_le32(e + 4, vlen);
+        put_le32(e + 8, vlen);
+        put_le32(e + 12, d);
+        memcpy(buf + key_ofs + k, keys[i], strlen(keys[i]));
+        memcpy(buf + data_ofs + d, values[i], vlen);
+        k += (uint32_t)strlen(keys[i]) + 1U;
+        d += vlen;
+    }
+    write_file(path, buf, data_ofs + d);
+}
+
+static void make_title(const char *dir, const char *title, int with_icon)
+{
+    char path[FTP_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", g_base, dir);
+    (void)mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/%s/sce_sys", g_base, dir);
+    (void)mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/%s/sce_sys/param.sfo", g_base, dir);
+    const char *keys[] = {"APP_VER", "CATEGORY", "CONTENT_ID", "TITLE",
+                          "TITLE_ID"};
+    const char *values[] = {"01.00", "gd", "UP0000-CUSA00001_00-TEST", title,
+                            "CUSA00001"};
+    write_sfo(path, keys, values, 5U);
+    if (with_icon != 0) {
+        snprintf(path, sizeof(path), "%s/%s/sce_sys/icon0.png", g_base, dir);
+        write_file(path, "\x89PNG", 4U);
+    }
+}
+
+static void remove_title(const char *dir)
+{
+    const char *files[] = {"sce_sys/param.sfo", "sce_sys/icon0.png",
+                           "sce_sys/param.json", "sce_sys", ""};
+    char path[FTP_PATH_MAX];
+    for (size_t i = 0U; i < 5U; i++) {
+        snprintf(path, sizeof(path), "%s/%s/%s", g_base, dir, files[i]);
+        if (unlink(path) != 0) {
+            (void)rmdir(path);
+        }
+    }
+}
+
+int main(void)
+{
+    char tmpl[] = "/tmp/zftpd-games-XXXXXX";
+    if (mkdtemp(tmpl) == NULL) {
+        return 1;
+    }
+    snprintf(g_root, sizeof(g_root), "%s", tmpl);
+    snprintf(g_base, sizeof(g_base), "%s/app", g_root);
+    (void)mkdir(g_base, 0755);
+    const char *bases[] = {g_base, NULL};
+    char index[128];
+    snprintf(index, sizeof(index), "%s/games.idx", g_root);
+
+    make_title("CUSA00001", "First Game", 1);
+    char path[FTP_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/PPSA00002", g_base);
+    (void)mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/PPSA00002/sce_sys", g_base);
+    (void)mkdir(path, 0755);
+    snprintf(path, sizeof(path), "%s/PPSA00002/sce_sys/param.json", g_base);
+    const char *json = "{\"titleId\":\"PPSA00002\",\"titleName\":\"Second\","
+                       "\"contentVersion\":\"02.00\"}";
+    write_file(path, json, strlen(json));
+
+    /* --- Scan: both titles, sorted, with metadata and icons ----------- */
+    http_games_reset(index, bases);
+    size_t count = 0U;
+    http_game_row_t *rows = http_games_installed(&count);
+    CHECK(rows != NULL && count == 2U, "two installed titles");
+    if (rows != NULL && count == 2U) {
+        CHECK(strcmp(rows[0].meta.id, "CUSA00001") == 0, "sfo title id");
+        CHECK(strcmp(rows[0].meta.name, "First Game") == 0, "sfo title");
+        CHECK(strcmp(rows[0].meta.version, "01.00") == 0, "sfo version");
+        CHECK(rows[0].meta.has_icon == 1, "icon found");
+        CHECK(strcmp(rows[0].source, g_base) == 0, "source is the base");
+        CHECK(strcmp(rows[1].meta.id, "PPSA00002") == 0, "json title id");
+        CHECK(strcmp(rows[1].meta.name, "Second") == 0, "json title");
+        CHECK(rows[1].meta.has_icon == 0, "no icon");
+    }
+    free(rows);
+
+    char found[FTP_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/CUSA00001", g_base);
+    CHECK(http_games_find("CUSA00001", found, sizeof(found)) == 0 &&
+              strcmp(found, path) == 0,
+          "find by title id");
+    CHECK(http_games_find("NONE00000", found, sizeof(found)) == -1,
+          "unknown title id");
+
+    http_game_meta_t meta;
+    char icon[FTP_PATH_MAX];
+    char want_icon[FTP_PATH_MAX + 32];
+    snprintf(want_icon, sizeof(want_icon), "%s/sce_sys/icon0.png", path);
+    CHECK(http_games_meta(path, &meta, icon, sizeof(icon)) == 0 &&
+              strcmp(icon, want_icon) == 0,
+          "icon path from the index");
+
+    /* --- A changed param.sfo reloads the entry ------------------------ */
+    make_title("CUSA00001", "First Game: Remastered", 1);
+    CHECK(http_games_meta(path, &meta, NULL, 0U) == 0 &&
+              strcmp(meta.name, "First Game: Remastered") == 0,
+          "stamp change reloads");
+
+    /* --- Added and removed titles are picked up ----------------------- */
+    remove_title("PPSA00002");
+    make_title("CUSA00003", "Third", 0);
+    http_games_refresh();
+    rows = http_games_installed(&count);
+    CHECK(rows != NULL && count == 2U, "one added, one removed");
+    if (rows != NULL && count == 2U) {
+        CHECK(strcmp(rows[0].meta.name, "First Game: Remastered") == 0,
+              "updated title listed");
+        CHECK(strstr(rows[1].path, "CUSA00003") != NULL, "new title listed");
+    }
+    free(rows);
+
+    /* --- The index survives a restart ----------------------------------- */
+    http_games_shutdown();
+    CHECK(access(index, R_OK) == 0, "index saved");
+    http_games_reset(index, bases);
+    CHECK(http_games_find("CUSA00001", found, sizeof(found)) == 0,
+          "loaded from disk before any scan");
+
+    CHECK(http_games_meta("/nonexistent/game.pkg", &meta, NULL, 0U) == -1,
+          "missing path");
+    CHECK(http_games_meta(index, &meta, NULL, 0U) == -1,
+          "not a game image");
+
+    http_games_reset("", NULL);
+    (void)unlink(index);
+    remove_title("CUSA00001");
+    remove_title("CUSA00003");
+    (void)rmdir(g_base);
+    (void)rmdir(g_root);
+
+    if (failures != 0) {
+        printf("http_games: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("http_games: OK\n");
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include "http_json.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+  do {                                                                         \
+    if (!(cond)) {                                                             \
+      printf("FAIL %s (line %d)\n", msg, __LINE__);                            \
+      failures++;                                                              \
+    }                                                                          \
+  } while (0)
+
+/* Byte-at-a-time reference for http_json_escape() */
+static size_t escape_ref(char *dst, const unsigned char *s, size_t len) {
+  size_t out = 0U;
+  for (size_t i = 0U; i < len; i++) {
+    unsigned char c = s[i];
+    const char *e = NULL;
+    switch (c) {
+    case '"':  e = "\\\""; break;
+    case '\\': e = "\\\\"; break;
+    case '\b': e = "\\b"; break;
+    case '\f': e = "\\f"; break;
+    case '\n': e = "\\n"; break;
+    case '\r': e = "\\r"; break;
+    case '\t': e = "\\t"; break;
+    default: break;
+    }
+    if (e != NULL) {
+      memcpy(dst + out, e, 2U);
+      out += 2U;
+    } else if (c < 0x20U) {
+      out += (size_t)sprintf(dst + out, "\\u%04x", c);
+    } else {
+      dst[out++] = (char)c;
+    }
+  }
+  return out;
+}
+
+static void test_escape(void) {
+  /* Every byte value at every offset of a SIMD block */
+  static unsigned char src[64];
+  static char got[64 * 6];
+  static char want[64 * 6];
+  for (unsigned c = 1U; c < 256U; c++) {
+    for (size_t at = 0U; at < 40U; at++) {
+      memset(src, 'a', sizeof(src));
+      src[at] = (unsigned char)c;
+      size_t n = http_json_escape(got, sizeof(got), (const char *)src, 48U);
+      size_t m = escape_ref(want, src, 48U);
+      if ((n != m) || (memcmp(got, want, m) != 0)) {
+        printf("FAIL escape byte 0x%02x at %zu\n", c, at);
+        failures++;
+        return;
+      }
+    }
+  }
+
+  /* UTF-8 passes through; tight capacity is reported, not overrun */
+  const char *utf8 = "caf\xc3\xa9 \xe2\x9c\x93";
+  char out[32];
+  CHECK(http_json_escape(out, sizeof(out), utf8, strlen(utf8)) ==
+            strlen(utf8),
+        "utf8 copied");
+  CHECK(http_json_escape(out, 3U, "abcd", 4U) == (size_t)-1, "short run");
+  CHECK(http_json_escape(out, 5U, "\x01", 1U) == (size_t)-1, "short \\u");
+  CHECK(http_json_escape(out, 6U, "\x01", 1U) == 6U, "exact \\u");
+}
+
+static void test_writer(void) {
+  char buf[256];
+  http_json_t w;
+  http_json_init(&w);
+  http_json_attach(&w, buf, sizeof(buf));
+  http_json_object_begin(&w);
+  http_json_key(&w, "a");
+  http_json_array_begin(&w);
+  http_json_u64(&w, 1U);
+  http_json_i64(&w, -2);
+  http_json_string(&w, "x\"y");
+  http_json_object_begin(&w);
+  http_json_object_end(&w);
+  http_json_array_end(&w);
+  http_json_key(&w, "b");
+  http_json_bool(&w, 1);
+  http_json_key(&w, "c");
+  http_json_null(&w);
+  http_json_object_end(&w);
+  buf[w.pos] = '\0';
+  CHECK((w.overflow == 0) &&
+            (strcmp(buf, "{\"a\":[1,-2,\"x\\\"y\",{}],\"b\":true,\"c\":null}") ==
+             0),
+        "commas and nesting");
+
+  /* Records rolled back at a chunk boundary continue in the next one */
+  char out[512];
+  size_t len = 0U;
+  unsigned next = 0U;
+  int opened = 0;
+  int closed = 0;
+  http_json_init(&w);
+  while (closed == 0) {
+    char chunk[24];
+    http_json_attach(&w, chunk, sizeof(chunk));
+    if (opened == 0) {
+      http_json_array_begin(&w);
+      opened = 1;
+    }
+    for (;;) {
+      http_json_t mark = w;
+      if (next == 10U) {
+        http_json_array_end(&w);
+      } else {
+        http_json_object_begin(&w);
+        http_json_key(&w, "n");
+        http_json_u64(&w, next);
+        http_json_object_end(&w);
+      }
+      if (w.overflow != 0) {
+        w = mark;
+        break;
+      }
+      if (next++ == 10U) {
+        closed = 1;
+        break;
+      }
+    }
+    memcpy(out + len, chunk, w.pos);
+    len += w.pos;
+  }
+  out[len] = '\0';
+  CHECK(strcmp(out, "[{\"n\":0},{\"n\":1},{\"n\":2},{\"n\":3},{\"n\":4},"
+                    "{\"n\":5},{\"n\":6},{\"n\":7},{\"n\":8},{\"n\":9}]") == 0,
+        "chunked records");
+}
+
+int main(void) {
+  test_escape();
+  test_writer();
+  if (failures != 0) {
+    printf("http_json: %d failure(s)\n", failures);
+    return 1;
+  }
+  printf("http_json: OK\n");
+  return 0;
+}
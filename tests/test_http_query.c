@@ -1,7 +1,12 @@
+#include "ftp_dirsize.h"
 #include "http_api.h"
 #include <dirent.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 static int starts_with(const char *s, const char *prefix) {
   if ((s == NULL) || (prefix == NULL)) {
@@ -11,6 +16,465 @@ static int starts_with(const char *s, const char *prefix) {
   return (strncmp(s, prefix, n) == 0) ? 1 : 0;
 }
 
+static int test_range_parse(void) {
+  uint64_t start = 0U;
+  uint64_t len = 0U;
+
+  if ((http_parse_range("bytes=0-99", 1000U, &start, &len) != 1) ||
+      (start != 0U) || (len != 100U)) {
+    return 20;
+  }
+  if ((http_parse_range("bytes=900-", 1000U, &start, &len) != 1) ||
+      (start != 900U) || (len != 100U)) {
+    return 21;
+  }
+  if ((http_parse_range("bytes=-2000", 1000U, &start, &len) != 1) ||
+      (start != 0U) || (len != 1000U)) {
+    return 22;
+  }
+  if ((http_parse_range("bytes=990-5000", 1000U, &start, &len) != 1) ||
+      (start != 990U) || (len != 10U)) {
+    return 23;
+  }
+  if (http_parse_range("bytes=1000-", 1000U, &start, &len) != -1) {
+    return 24;
+  }
+  if (http_parse_range("bytes=-0", 1000U, &start, &len) != -1) {
+    return 25;
+  }
+  /* Malformed or foreign units are ignored, not rejected */
+  if ((http_parse_range("bytes=5-1", 1000U, &start, &len) != 0) ||
+      (http_parse_range("items=0-1", 1000U, &start, &len) != 0) ||
+      (http_parse_range("bytes=x", 1000U, &start, &len) != 0)) {
+    return 26;
+  }
+  /* Adjacent ranges merge; distant ones fall back to the full body */
+  if ((http_parse_range("bytes=0-99, 100-199", 1000U, &start, &len) != 1) ||
+      (start != 0U) || (len != 200U)) {
+    return 27;
+  }
+  if (http_parse_range("bytes=0-9,900-909", 1000U, &start, &len) != 0) {
+    return 28;
+  }
+  return 0;
+}
+
+static int test_range_download(void) {
+  char path[] = "/tmp/zftpd_range_XXXXXX";
+  int fd = mkstemp(path);
+  if (fd < 0) {
+    return 30;
+  }
+  char data[1000];
+  memset(data, 'r', sizeof(data));
+  if (write(fd, data, sizeof(data)) != (ssize_t)sizeof(data)) {
+    close(fd);
+    (void)unlink(path);
+    return 31;
+  }
+  close(fd);
+
+  http_request_t req;
+  memset(&req, 0, sizeof(req));
+  req.method = HTTP_METHOD_GET;
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/download?path=%s", path);
+  char range_name[] = "Range";
+  char range_value[32] = "bytes=-100";
+  req.headers[0].name = range_name;
+  req.headers[0].value = range_value;
+  req.num_headers = 1U;
+
+  int rc = 0;
+  http_response_t *resp = http_api_handle(&req);
+  if ((resp == NULL) || !starts_with(resp->data, "HTTP/1.1 206") ||
+      (strstr(resp->data, "Content-Range: bytes 900-999/1000\r\n") == NULL) ||
+      (resp->sendfile_offset != 900) || (resp->sendfile_count != 100U)) {
+    rc = 32;
+  }
+  http_response_destroy(resp);
+
+  /* A stale validator means the client gets the whole new file */
+  char if_range_name[] = "If-Range";
+  char if_range_value[] = "\"0-0-0\"";
+  req.headers[1].name = if_range_name;
+  req.headers[1].value = if_range_value;
+  req.num_headers = 2U;
+  resp = http_api_handle(&req);
+  if ((rc == 0) && ((resp == NULL) || !starts_with(resp->data, "HTTP/1.1 200") ||
+                    (resp->sendfile_count != 1000U))) {
+    rc = 33;
+  }
+  http_response_destroy(resp);
+
+  (void)snprintf(range_value, sizeof(range_value), "bytes=2000-");
+  req.num_headers = 1U;
+  resp = http_api_handle(&req);
+  if ((rc == 0) &&
+      ((resp == NULL) || !starts_with(resp->data, "HTTP/1.1 416") ||
+       (strstr(resp->data, "Content-Range: bytes */1000\r\n") == NULL))) {
+    rc = 34;
+  }
+  http_response_destroy(resp);
+
+  (void)unlink(path);
+  return rc;
+}
+
+static int test_negotiation(void) {
+  if (!http_accepts_encoding("gzip, deflate, br", "br") ||
+      !http_accepts_encoding("gzip;q=0.5", "gzip") ||
+      http_accepts_encoding("gzip;q=0, br", "gzip") ||
+      http_accepts_encoding("gzip;q=0.000", "gzip") ||
+      http_accepts_encoding("identity", "gzip") ||
+      http_accepts_encoding(NULL, "gzip") ||
+      !http_accepts_encoding("*", "br") ||
+      http_accepts_encoding("*, br;q=0", "br")) {
+    return 40;
+  }
+  if (!http_etag_match("\"a\", \"b\"", "\"b\"") ||
+      !http_etag_match("W/\"b\"", "\"b\"") || !http_etag_match("*", "\"b\"") ||
+      http_etag_match("\"bc\"", "\"b\"") || http_etag_match("", "\"b\"")) {
+    return 41;
+  }
+  return 0;
+}
+
+static int test_static_cache(void) {
+  http_request_t req;
+  memset(&req, 0, sizeof(req));
+  req.method = HTTP_METHOD_GET;
+  (void)snprintf(req.uri, sizeof(req.uri), "/css/base.css?v=3");
+
+  http_response_t *resp = http_api_handle(&req);
+  if ((resp == NULL) || !starts_with(resp->data, "HTTP/1.1 200")) {
+    http_response_destroy(resp);
+    return 0; /* web/ not reachable from this cwd: nothing to check */
+  }
+  const char *tag = strstr(resp->data, "ETag: ");
+  char etag[64] = "";
+  if (tag != NULL) {
+    (void)sscanf(tag + 6, "%63[^\r]", etag);
+  }
+  int rc = 0;
+  if ((etag[0] == '\0') || (strstr(resp->data, "no-store") != NULL) ||
+      (strstr(resp->data, "immutable") == NULL)) {
+    rc = 50;
+  }
+  http_response_destroy(resp);
+
+  char inm_name[] = "If-None-Match";
+  req.headers[0].name = inm_name;
+  req.headers[0].value = etag;
+  req.num_headers = 1U;
+  resp = http_api_handle(&req);
+  if ((rc == 0) && ((resp == NULL) || !starts_with(resp->data, "HTTP/1.1 304") ||
+                    (resp->mem_body != NULL))) {
+    rc = 51;
+  }
+  http_response_destroy(resp);
+  return rc;
+}
+
+static int test_framing(void) {
+  /* Only self-delimited responses may leave a keep-alive stream open */
+  http_response_t *resp = http_response_create(HTTP_STATUS_200_OK);
+  if (resp == NULL) {
+    return 60;
+  }
+  int rc = http_response_is_framed(resp) ? 61 : 0;
+  if ((rc == 0) && ((http_response_set_body(resp, "ok", 2U) != 0) ||
+                    !http_response_is_framed(resp))) {
+    rc = 62;
+  }
+  http_response_destroy(resp);
+
+  resp = http_response_create(HTTP_STATUS_304_NOT_MODIFIED);
+  if ((rc == 0) && ((resp == NULL) || !http_response_is_framed(resp))) {
+    rc = 63;
+  }
+  http_response_destroy(resp);
+  return rc;
+}
+
+static int test_event_stream(void) {
+  http_request_t req;
+  memset(&req, 0, sizeof(req));
+  req.method = HTTP_METHOD_GET;
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/events");
+  if (http_api_is_event_stream(&req) != 1) {
+    return 70;
+  }
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/eventsx");
+  if (http_api_is_event_stream(&req) != 0) {
+    return 71;
+  }
+
+  char frame[HTTP_EVENT_FRAME_MAX];
+  size_t len = http_api_event_render(2U, frame, sizeof(frame));
+  if ((len == 0U) || (strncmp(frame, "event: downloads\ndata: {", 24) != 0) ||
+      (strcmp(frame + len - 2U, "\n\n") != 0) ||
+      (memchr(frame + 24, '\n', len - 26U) != NULL)) {
+    return 72;
+  }
+  if (http_api_event_render(HTTP_EVENT_TOPICS, frame, sizeof(frame)) != 0U) {
+    return 73;
+  }
+  return 0;
+}
+
+/* NUL-terminated copy of an in-memory response body */
+static const char *body_text(const http_response_t *resp, char *out,
+                             size_t cap) {
+  if ((resp == NULL) || (resp->mem_body == NULL) ||
+      (resp->mem_length >= cap)) {
+    return NULL;
+  }
+  memcpy(out, resp->mem_body, resp->mem_length);
+  out[resp->mem_length] = '\0';
+  return out;
+}
+
+/* Paged /api/list: sorted pages chained by the "next" cursor */
+static int test_paged_list(void) {
+  char dir[] = "/tmp/zftpd_page_XXXXXX";
+  if (mkdtemp(dir) == NULL) {
+    return 80;
+  }
+  for (int i = 1; i <= 3; i++) {
+    char path[64];
+    (void)snprintf(path, sizeof(path), "%s/f%d", dir, i);
+    FILE *f = fopen(path, "w");
+    if (f != NULL) {
+      (void)fwrite("xxxx", 1U, (size_t)i, f);
+      fclose(f);
+    }
+  }
+
+  http_request_t req;
+  memset(&req, 0, sizeof(req));
+  req.method = HTTP_METHOD_GET;
+  (void)snprintf(req.uri, sizeof(req.uri),
+                 "/api/list?path=%s&limit=2&sort=size&order=desc", dir);
+
+  int rc = 0;
+  if (http_api_is_offloadable(&req) != 1) {
+    rc = 81;
+  }
+  char cursor[HTTP_LIST_CURSOR_MAX] = "";
+  http_response_t *resp = http_api_handle(&req);
+  char text[4096];
+  const char *body = body_text(resp, text, sizeof(text));
+  const char *next = (body != NULL) ? strstr(body, "\"next\":\"") : NULL;
+  if ((rc == 0) &&
+      ((body == NULL) || (strstr(body, "\"total\":3") == NULL) ||
+       (strstr(body, "\"f3\"") == NULL) || (strstr(body, "\"f2\"") == NULL) ||
+       (strstr(body, "\"f1\"") != NULL) ||
+       (strstr(body, "\"f3\"") > strstr(body, "\"f2\"")) ||
+       (next == NULL) || (sscanf(next + 8, "%639[0-9a-f]", cursor) != 1))) {
+    rc = 82;
+  }
+  http_response_destroy(resp);
+
+  (void)snprintf(req.uri, sizeof(req.uri),
+                 "/api/list?path=%s&limit=2&sort=size&order=desc&cursor=%s",
+                 dir, cursor);
+  resp = (rc == 0) ? http_api_handle(&req) : NULL;
+  body = body_text(resp, text, sizeof(text));
+  if ((rc == 0) &&
+      ((body == NULL) || (strstr(body, "\"f1\"") == NULL) ||
+       (strstr(body, "\"f2\"") != NULL) ||
+       (strstr(body, "\"next\":null") == NULL))) {
+    rc = 83;
+  }
+  http_response_destroy(resp);
+
+  for (int i = 1; i <= 3; i++) {
+    char path[64];
+    (void)snprintf(path, sizeof(path), "%s/f%d", dir, i);
+    (void)unlink(path);
+  }
+  (void)rmdir(dir);
+  return rc;
+}
+
+/* Run a generated body to its end; 0 if it does not fit @p cap */
+static size_t drain_stream(http_response_t *resp, char *out, size_t cap) {
+  static char chunk[HTTP_STREAM_CHUNK_SIZE];
+  size_t len = 0U;
+  if ((resp == NULL) || (resp->stream_fill == NULL)) {
+    return 0U;
+  }
+  for (;;) {
+    size_t n = resp->stream_fill(resp->stream_ctx, chunk, sizeof(chunk));
+    if (n == 0U) {
+      break;
+    }
+    if (len + n >= cap) {
+      return 0U;
+    }
+    memcpy(out + len, chunk, n);
+    len += n;
+  }
+  out[len] = '\0';
+  return len;
+}
+
+static void put_file(const char *dir, const char *name, size_t len) {
+  char path[128];
+  (void)snprintf(path, sizeof(path), "%s/%s", dir, name);
+  FILE *f = fopen(path, "w");
+  if (f != NULL) {
+    for (size_t i = 0U; i < len; i++) {
+      (void)fputc('x', f);
+    }
+    fclose(f);
+  }
+}
+
+/* Treemap: largest children first, the rest folded into "other" */
+static int test_disk_tree(void) {
+  char dir[] = "/tmp/zftpd_tree_XXXXXX";
+  if (mkdtemp(dir) == NULL) {
+    return 90;
+  }
+  char big[64];
+  (void)snprintf(big, sizeof(big), "%s/big", dir);
+  (void)mkdir(big, 0755);
+  put_file(big, "inner", 65536U);
+  put_file(dir, "a", 3000U);
+  put_file(dir, "b", 20U);
+  put_file(dir, "c", 10U);
+  ftp_dirsize_reset("");
+
+  http_request_t req;
+  memset(&req, 0, sizeof(req));
+  req.method = HTTP_METHOD_GET;
+  (void)snprintf(req.uri, sizeof(req.uri),
+                 "/api/disk/tree?path=%s&depth=2&top=2", dir);
+  http_response_t *resp = http_api_handle(&req);
+  int rc = 0;
+  if ((resp == NULL) || (resp->stream_fill == NULL) ||
+      !http_response_is_framed(resp)) {
+    rc = 91;
+  }
+
+  static char text[65536];
+  size_t len = (rc == 0) ? drain_stream(resp, text, sizeof(text)) : 0U;
+  if ((rc == 0) && (len == 0U)) {
+    rc = 92;
+  }
+  const char *pbig = strstr(text, "\"name\":\"big\"");
+  const char *pa = strstr(text, "\"name\":\"a\"");
+  if ((rc == 0) &&
+      ((strstr(text, "\"partial\":false") == NULL) || (pbig == NULL) ||
+       (pa == NULL) || (pbig > pa) ||
+       (strstr(text, "\"name\":\"inner\",\"type\":\"file\","
+                     "\"size\":65536}") == NULL) ||
+       (strstr(text, "\"name\":\"b\"") != NULL) ||
+       (strstr(text, "\"type\":\"other\",\"size\":30,\"count\":2}") ==
+        NULL) ||
+       (strcmp(text + len - 2U, "]}") != 0))) {
+    rc = 93;
+  }
+  http_response_destroy(resp);
+  ftp_dirsize_shutdown();
+
+  const char *names[] = {"big/inner", "a", "b", "c"};
+  for (size_t i = 0U; i < sizeof(names) / sizeof(names[0]); i++) {
+    char path[128];
+    (void)snprintf(path, sizeof(path), "%s/%s", dir, names[i]);
+    (void)unlink(path);
+  }
+  (void)rmdir(big);
+  (void)rmdir(dir);
+  return rc;
+}
+
+/* Process and installed-title lists are generated while sending */
+static int test_generated_lists(void) {
+  http_request_t req;
+  memset(&req, 0, sizeof(req));
+  req.method = HTTP_METHOD_GET;
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/processes");
+  http_response_t *resp = http_api_handle(&req);
+  static char text[1024 * 1024];
+  size_t len = drain_stream(resp, text, sizeof(text));
+  int rc = 0;
+  if ((len < 2U) || (text[0] != '[') || (text[len - 1U] != ']') ||
+      !http_response_is_framed(resp)) {
+    rc = 100;
+  }
+#if defined(__linux__)
+  if ((rc == 0) && (strstr(text, "{\"pid\":1,") == NULL) &&
+      (strstr(text, "\"killable\":") == NULL)) {
+    rc = 101;
+  }
+#endif
+  http_response_destroy(resp);
+
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/admin/games/installed");
+  resp = (rc == 0) ? http_api_handle(&req) : NULL;
+  len = drain_stream(resp, text, sizeof(text));
+  if ((rc == 0) && ((len == 0U) ||
+                    (strncmp(text, "{\"ok\":true,\"entries\":[", 22) != 0) ||
+                    (strcmp(text + len - 2U, "]}") != 0))) {
+    rc = 102;
+  }
+  http_response_destroy(resp);
+  return rc;
+}
+
+/* Whole-path routing: no prefix collisions, methods, flags, counters */
+static int test_routes(void) {
+  http_request_t req;
+  memset(&req, 0, sizeof(req));
+  req.method = HTTP_METHOD_GET;
+
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/game/icon?path=/x");
+  if (http_api_route_flags(&req) != (HTTP_ROUTE_OFFLOAD | HTTP_ROUTE_CACHE)) {
+    return 110;
+  }
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/list?path=/&limit=5");
+  if (http_api_is_offloadable(&req) != 1) {
+    return 111;
+  }
+  /* A longer name sharing a prefix is not the shorter route */
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/disk/treetop");
+  if (http_api_route_flags(&req) != 0U) {
+    return 112;
+  }
+
+  /* Mutating route over GET, reader over POST */
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/download/start");
+  http_response_t *resp = http_api_handle(&req);
+  int rc = ((resp == NULL) || !starts_with(resp->data, "HTTP/1.1 405")) ? 113
+                                                                          : 0;
+  http_response_destroy(resp);
+  req.method = HTTP_METHOD_POST;
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/metrics");
+  resp = (rc == 0) ? http_api_handle(&req) : NULL;
+  if ((rc == 0) && ((resp == NULL) || !starts_with(resp->data, "HTTP/1.1 405"))) {
+    rc = 114;
+  }
+  http_response_destroy(resp);
+
+  /* Earlier tests dispatched /api/list; the counters show it */
+  req.method = HTTP_METHOD_GET;
+  resp = (rc == 0) ? http_api_handle(&req) : NULL;
+  static char text[256 * 1024];
+  const char *body = body_text(resp, text, sizeof(text));
+  if ((rc == 0) &&
+      ((body == NULL) ||
+       (strstr(body, "zftpd_http_route_requests_total{route=\"/api/list\"} ") ==
+        NULL) ||
+       (strstr(body, "zftpd_http_route_duration_seconds_max{route=") ==
+        NULL))) {
+    rc = 115;
+  }
+  http_response_destroy(resp);
+  return rc;
+}
+
 int main(void) {
   http_request_t req;
   memset(&req, 0, sizeof(req));
@@ -62,5 +526,47 @@ int main(void) {
     http_response_destroy(resp);
   }
 
-  return 0;
+  /* Tree scans go to the worker pool; listings and downloads stay inline */
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/disk/tree?path=/");
+  if (http_api_is_offloadable(&req) != 1) {
+    return 6;
+  }
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/list?path=/");
+  if (http_api_is_offloadable(&req) != 0) {
+    return 7;
+  }
+  (void)snprintf(req.uri, sizeof(req.uri), "/api/download?path=/x");
+  if (http_api_is_offloadable(&req) != 0) {
+    return 8;
+  }
+
+  int rc = test_range_parse();
+  if (rc == 0) {
+    rc = test_range_download();
+  }
+  if (rc == 0) {
+    rc = test_negotiation();
+  }
+  if (rc == 0) {
+    rc = test_static_cache();
+  }
+  if (rc == 0) {
+    rc = test_framing();
+  }
+  if (rc == 0) {
+    rc = test_event_stream();
+  }
+  if (rc == 0) {
+    rc = test_paged_list();
+  }
+  if (rc == 0) {
+    rc = test_disk_tree();
+  }
+  if (rc == 0) {
+    rc = test_generated_lists();
+  }
+  if (rc == 0) {
+    rc = test_routes();
+  }
+  return rc;
 }
@@ -0,0 +1,124 @@
+#include "http_sysmon.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static void sleep_ms(unsigned ms)
+{
+    struct timespec ts = {(time_t)(ms / 1000U), (long)(ms % 1000U) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static const http_sysmon_proc_t *find_self(const http_sysmon_procs_t *p)
+{
+    for (size_t i = 0U; (p != NULL) && (i < p->count); i++) {
+        if (p->rows[i].pid == (int)getpid()) {
+            return &p->rows[i];
+        }
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    http_sysmon_reset(20U);
+
+    /* --- First reader starts the sampler and gets a sample ------------ */
+    http_sysmon_sample_t cur;
+    CHECK(http_sysmon_latest(&cur) == 0, "first sample");
+    CHECK(cur.seq >= 1U && cur.at_ms > 0, "sample stamped");
+#if defined(PLATFORM_LINUX)
+    CHECK(cur.ram_ok == 0 && cur.ram_total > 0U &&
+              cur.ram_used <= cur.ram_total,
+          "ram counters");
+    CHECK(cur.boot_ok == 0 && cur.boot_epoch > 0U, "boot time");
+#endif
+
+    /* --- History: consecutive, oldest first, after ?since= ------------ */
+    sleep_ms(150U);
+    http_sysmon_sample_t hist[64];
+    size_t n = http_sysmon_history(0U, hist, 64U);
+    CHECK(n >= 3U, "samples accumulate");
+    int ordered = (n > 0U) && (hist[0].seq >= 1U);
+    for (size_t i = 1U; i < n; i++) {
+        ordered &= hist[i].seq == hist[i - 1U].seq + 1U;
+    }
+    CHECK(ordered, "history is consecutive");
+    if (n > 0U) {
+        uint64_t last = hist[n - 1U].seq;
+        size_t newer = http_sysmon_history(last, hist, 64U);
+        CHECK(newer == 0U || hist[0].seq == last + 1U, "since is exclusive");
+        CHECK(http_sysmon_history(0U, hist, 2U) == 2U, "max is honoured");
+        CHECK(http_sysmon_latest(&cur) == 0 && cur.seq >= last,
+              "latest is the head");
+        CHECK(hist[1].seq == hist[0].seq + 1U && hist[1].seq >= last,
+              "a short history keeps the newest");
+    }
+
+    /* --- Process list: listed on demand, includes us -------------------- */
+#if defined(PLATFORM_LINUX)
+    const http_sysmon_procs_t *procs = http_sysmon_procs_acquire();
+    CHECK(procs != NULL && procs->count > 0U, "process list");
+    const http_sysmon_proc_t *self = find_self(procs);
+    CHECK(self != NULL && self->name[0] != '\0', "own process listed");
+    int sorted = (procs != NULL);
+    for (size_t i = 1U; (procs != NULL) && (i < procs->count); i++) {
+        sorted &= procs->rows[i - 1U].pid < procs->rows[i].pid;
+    }
+    CHECK(sorted, "ordered by pid");
+
+    /* Burn CPU across a few listings; the held list stays valid */
+    sleep_ms(60U);
+    struct timespec t0;
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    clock_t used = clock();
+    volatile uint64_t spin = 0U;
+    double cpu = 0.0;
+    do {
+        for (int k = 0; k < 100000; k++) {
+            spin += (uint64_t)k;
+        }
+        const http_sysmon_procs_t *now = http_sysmon_procs_acquire();
+        const http_sysmon_proc_t *busy = find_self(now);
+        if ((busy != NULL) && (busy->cpu > cpu)) {
+            cpu = busy->cpu;
+        }
+        http_sysmon_procs_release(now);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+    } while ((t1.tv_sec - t0.tv_sec) * 1000 +
+                 (t1.tv_nsec - t0.tv_nsec) / 1000000 <
+             300);
+    used = clock() - used;
+    /* Starved by a loaded machine: too few ticks to see */
+    CHECK(cpu > 0.0 || used < CLOCKS_PER_SEC / 5, "cpu measured between lists");
+    const http_sysmon_procs_t *later = http_sysmon_procs_acquire();
+    CHECK(later != NULL && later != procs, "list refreshed");
+    CHECK(self != NULL && self->pid == (int)getpid(), "old list still held");
+    http_sysmon_procs_release(procs);
+    http_sysmon_procs_release(later);
+#endif
+
+    /* --- Shutdown drops the history; the next reader starts over ------- */
+    http_sysmon_shutdown();
+    CHECK(http_sysmon_latest(&cur) == 0 && cur.seq <= 2U, "restarted");
+    http_sysmon_reset(0U);
+
+    if (failures != 0) {
+        printf("http_sysmon: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("http_sysmon: OK\n");
+    return 0;
+}
@@ -0,0 +1,424 @@
+#include "ftp_config.h"
+#include "ftp_hash.h"
+#include "http_thumb.h"
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(FTP_ENABLE_MODEZ) && FTP_ENABLE_MODEZ
+#include <zlib.h>
+#endif
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint8_t *chunk(uint8_t *p, const char *type, const uint8_t *data,
+                      uint32_t len)
+{
+    ftp_hash_ctx_t ctx;
+    uint8_t crc[FTP_HASH_MAX_DIGEST];
+    put_be32(p, len);
+    memcpy(p + 4, type, 4);
+    if (len > 0U) {
+        memcpy(p + 8, data, len);
+    }
+    ftp_hash_init(&ctx, FTP_HASH_CRC32);
+    ftp_hash_update(&ctx, p + 4, len + 4U);
+    ftp_hash_final(&ctx, crc);
+    memcpy(p + 8 + len, crc, 4);
+    return p + 12 + len;
+}
+
+/* PNG of w x h pixels of @p bpp bytes, rows unfiltered, stored deflate */
+static uint8_t *make_png(uint32_t w, uint32_t h, uint8_t ctype, size_t bpp,
+                         const uint8_t *pixels, const uint8_t *plte,
+                         uint32_t plte_len, int interlace, size_t *out_len)
+{
+    size_t raw_len = (size_t)h * (1U + (w * bpp));
+    uint8_t *raw = malloc(raw_len);
+    for (uint32_t y = 0U; y < h; y++) {
+        raw[y * (1U + (w * bpp))] = 0U;
+        memcpy(raw + (y * (1U + (w * bpp))) + 1U, pixels + (y * w * bpp),
+               w * bpp);
+    }
+    size_t blocks = (raw_len / 65535U) + 1U;
+    size_t zlen = 2U + raw_len + (blocks * 5U) + 4U;
+    uint8_t *z = malloc(zlen);
+    size_t zp = 0U;
+    z[zp++] = 0x78U;
+    z[zp++] = 0x01U;
+    for (size_t off = 0U; off < raw_len || off == 0U;) {
+        size_t n = raw_len - off;
+        if (n > 65535U) {
+            n = 65535U;
+        }
+        z[zp++] = (off + n == raw_len) ? 1U : 0U;
+        z[zp++] = (uint8_t)n;
+        z[zp++] = (uint8_t)(n >> 8);
+        z[zp++] = (uint8_t)~n;
+        z[zp++] = (uint8_t)(~n >> 8);
+        memcpy(z + zp, raw + off, n);
+        zp += n;
+        off += n;
+        if (off == raw_len) {
+            break;
+        }
+    }
+    uint32_t a = 1U;
+    uint32_t b = 0U;
+    for (size_t i = 0U; i < raw_len; i++) {
+        a = (a + raw[i]) % 65521U;
+        b = (b + a) % 65521U;
+    }
+    put_be32(z + zp, (b << 16) | a);
+    zp += 4U;
+
+    uint8_t *png = malloc(8U + 25U + 12U + plte_len + 12U + zp + 12U);
+    memcpy(png, "\x89PNG\r\n\x1a\n", 8);
+    uint8_t ihdr[13];
+    put_be32(ihdr, w);
+    put_be32(ihdr + 4, h);
+    ihdr[8] = 8U;
+    ihdr[9] = ctype;
+    ihdr[10] = 0U;
+    ihdr[11] = 0U;
+    ihdr[12] = (uint8_t)interlace;
+    uint8_t *p = chunk(png + 8, "IHDR", ihdr, 13U);
+    if (plte != NULL) {
+        p = chunk(p, "PLTE", plte, plte_len);
+    }
+    p = chunk(p, "IDAT", z, (uint32_t)zp);
+    p = chunk(p, "IEND", NULL, 0U);
+    *out_len = (size_t)(p - png);
+    free(raw);
+    free(z);
+    return png;
+}
+
+#if defined(FTP_ENABLE_MODEZ) && FTP_ENABLE_MODEZ
+static uint8_t paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) {
+        return (uint8_t)a;
+    }
+    return (uint8_t)((pb <= pc) ? b : c);
+}
+
+/* Decode one of our thumbnails with zlib; returns w*h*bpp pixels */
+static uint8_t *decode_png(const uint8_t *png, size_t len, uint32_t *w,
+                           uint32_t *h, size_t *bpp)
+{
+    if (len < 33U || memcmp(png + 12, "IHDR", 4) != 0) {
+        return NULL;
+    }
+    *w = get_be32(png + 16);
+    *h = get_be32(png + 20);
+    *bpp = (png[25] == 6U) ? 4U : 3U;
+    const uint8_t *idat = png + 33;
+    if (memcmp(idat + 4, "IDAT", 4) != 0) {
+        return NULL;
+    }
+    size_t stride = *w * *bpp;
+    uLongf raw_len = (uLongf)(*h * (stride + 1U));
+    uint8_t *raw = malloc(raw_len);
+    if (uncompress(raw, &raw_len, idat + 8, get_be32(idat)) != Z_OK ||
+        raw_len != *h * (stride + 1U)) {
+        free(raw);
+        return NULL;
+    }
+    uint8_t *px = calloc(1U, *h * stride);
+    for (uint32_t y = 0U; y < *h; y++) {
+        const uint8_t *r = raw + (y * (stride + 1U));
+        uint8_t *d = px + (y * stride);
+        const uint8_t *up = (y > 0U) ? d - stride : NULL;
+        for (size_t i = 0U; i < stride; i++) {
+            int a = (i >= *bpp) ? d[i - *bpp] : 0;
+            int b = (up != NULL) ? up[i] : 0;
+            int c = (up != NULL && i >= *bpp) ? up[i - *bpp] : 0;
+            int pred = (r[0] == 1U)   ? a
+                       : (r[0] == 2U) ? b
+                       : (r[0] == 3U) ? (a + b) / 2
+                       : (r[0] == 4U) ? paeth(a, b, c)
+                                      : 0;
+            d[i] = (uint8_t)(r[1 + i] + pred);
+        }
+    }
+    free(raw);
+    return px;
+}
+#endif
+
+static int g_loads = 0;
+static const uint8_t *g_src;
+static size_t g_src_len;
+
+static int load_src(void *user, uint8_t **png, size_t *len)
+{
+    (void)user;
+    g_loads++;
+    if (g_src == NULL) {
+        return -1;
+    }
+    *png = malloc(g_src_len);
+    memcpy(*png, g_src, g_src_len);
+    *len = g_src_len;
+    return 0;
+}
+
+static size_t count_cached(const char *dir)
+{
+    size_t n = 0U;
+    DIR *d = opendir(dir);
+    struct dirent *de;
+    while (d != NULL && (de = readdir(d)) != NULL) {
+        n += (strstr(de->d_name, ".png") != NULL) ? 1U : 0U;
+    }
+    if (d != NULL) {
+        closedir(d);
+    }
+    return n;
+}
+
+int main(void)
+{
+    /* --- Edges and ETags ------------------------------------------------ */
+    CHECK(http_thumb_edge(0U) == 0U, "no size = original");
+    CHECK(http_thumb_edge(40U) == 64U, "rounded up to 64");
+    CHECK(http_thumb_edge(100U) == 128U, "rounded up to 128");
+    CHECK(http_thumb_edge(256U) == 256U, "largest edge");
+    CHECK(http_thumb_edge(1024U) == 0U, "too large = original");
+    char e1[48];
+    char e2[48];
+    char e3[48];
+    http_thumb_etag("/a|1|2", 64U, e1, sizeof(e1));
+    http_thumb_etag("/a|1|2", 128U, e2, sizeof(e2));
+    http_thumb_etag("/a|1|3", 64U, e3, sizeof(e3));
+    CHECK(e1[0] == '"' && e1[strlen(e1) - 1U] == '"', "quoted etag");
+    CHECK(strcmp(e1, e2) != 0, "etag depends on the edge");
+    CHECK(strcmp(e1, e3) != 0, "etag depends on the key");
+
+    /* --- RGB: solid colour survives the round trip ---------------------- */
+    uint8_t *rgb = malloc(100U * 60U * 3U);
+    for (size_t i = 0U; i < 100U * 60U; i++) {
+        rgb[i * 3U] = 200U;
+        rgb[(i * 3U) + 1U] = 100U;
+        rgb[(i * 3U) + 2U] = 50U;
+    }
+    size_t png_len = 0U;
+    uint8_t *png = make_png(100U, 60U, 2U, 3U, rgb, NULL, 0U, 0, &png_len);
+    uint8_t *out = NULL;
+    size_t out_len = 0U;
+    CHECK(http_thumb_scale(png, png_len, 64U, &out, &out_len) == 0,
+          "rgb scaled");
+    CHECK(out != NULL && get_be32(out + 16) == 64U &&
+              get_be32(out + 20) == 38U,
+          "aspect ratio kept");
+    uint8_t *again = NULL;
+    size_t again_len = 0U;
+    CHECK(out != NULL &&
+              http_thumb_scale(out, out_len, 64U, &again, &again_len) == 1,
+          "own output decodes and is already small");
+#if defined(FTP_ENABLE_MODEZ) && FTP_ENABLE_MODEZ
+    uint32_t w = 0U;
+    uint32_t h = 0U;
+    size_t bpp = 0U;
+    uint8_t *px = (out != NULL) ? decode_png(out, out_len, &w, &h, &bpp) : NULL;
+    CHECK(px != NULL && bpp == 3U, "zlib reads the thumbnail");
+    int solid = (px != NULL);
+    for (size_t i = 0U; px != NULL && i < (size_t)w * h; i++) {
+        solid &= px[i * 3U] == 200U && px[(i * 3U) + 1U] == 100U &&
+                 px[(i * 3U) + 2U] == 50U;
+    }
+    CHECK(solid, "solid colour preserved");
+    free(px);
+#endif
+    free(out);
+    free(png);
+    free(rgb);
+
+    /* --- RGBA: transparent pixels do not tint the average --------------- */
+    uint8_t *rgba = calloc(1U, 512U * 512U * 4U);
+    for (uint32_t y = 0U; y < 512U; y++) {
+        for (uint32_t x = 0U; x < 512U; x++) {
+            uint8_t *p = rgba + (((y * 512U) + x) * 4U);
+            if ((x / 2U) % 2U == 0U) {
+                p[0] = 255U; /* transparent red */
+            } else {
+                p[1] = 255U;
+                p[3] = 255U;
+            }
+        }
+    }
+    png = make_png(512U, 512U, 6U, 4U, rgba, NULL, 0U, 0, &png_len);
+    CHECK(http_thumb_scale(png, png_len, 128U, &out, &out_len) == 0,
+          "rgba scaled");
+    CHECK(out != NULL && out_len < png_len / 20U, "thumbnail is small");
+#if defined(FTP_ENABLE_MODEZ) && FTP_ENABLE_MODEZ
+    px = (out != NULL) ? decode_png(out, out_len, &w, &h, &bpp) : NULL;
+    CHECK(px != NULL && w == 128U && h == 128U && bpp == 4U, "rgba kept");
+    CHECK(px != NULL && px[0] == 0U && px[1] == 255U && px[2] == 0U &&
+              px[3] == 128U,
+          "alpha-weighted colour");
+    free(px);
+#endif
+    free(out);
+    free(png);
+
+    /* --- Detailed RGB: LZ77 matches at every distance decode ------------ */
+    uint32_t seed = 1U;
+    for (size_t i = 0U; i < 512U * 512U * 4U; i++) {
+        seed = (seed * 1103515245U) + 12345U;
+        rgba[i] = ((i / 4096U) % 3U == 0U) ? (uint8_t)(seed >> 24)
+                                           : (uint8_t)(i / 7U);
+        if (i % 4U == 3U) {
+            rgba[i] = 255U;
+        }
+    }
+    png = make_png(512U, 512U, 6U, 4U, rgba, NULL, 0U, 0, &png_len);
+    CHECK(http_thumb_scale(png, png_len, 256U, &out, &out_len) == 0,
+          "noisy image scaled");
+    again = NULL;
+    CHECK(out != NULL &&
+              http_thumb_scale(out, out_len, 128U, &again, &again_len) == 0,
+          "noisy thumbnail decodes again");
+#if defined(FTP_ENABLE_MODEZ) && FTP_ENABLE_MODEZ
+    px = (out != NULL) ? decode_png(out, out_len, &w, &h, &bpp) : NULL;
+    CHECK(px != NULL && w == 256U, "zlib agrees with our deflate");
+    /* Opaque 2x2 boxes of the source, averaged */
+    int exact = (px != NULL);
+    for (uint32_t y = 0U; px != NULL && y < 256U; y += 37U) {
+        for (uint32_t x = 0U; x < 256U; x += 41U) {
+            for (size_t c = 0U; c < 3U; c++) {
+                unsigned sum = 0U;
+                for (uint32_t k = 0U; k < 4U; k++) {
+                    uint32_t sx = (x * 2U) + (k & 1U);
+                    uint32_t sy = (y * 2U) + (k >> 1);
+                    sum += rgba[(((sy * 512U) + sx) * 4U) + c];
+                }
+                exact &= px[(((y * 256U) + x) * 4U) + c] ==
+                         (uint8_t)((sum + 2U) / 4U);
+            }
+        }
+    }
+    CHECK(exact, "box filter averages");
+    free(px);
+#endif
+    free(again);
+    free(out);
+    free(png);
+    free(rgba);
+
+    /* --- Palette and gray decode; interlaced and garbage do not --------- */
+    uint8_t idx[32U * 32U];
+    for (size_t i = 0U; i < sizeof(idx); i++) {
+        idx[i] = (uint8_t)(i % 3U);
+    }
+    const uint8_t plte[9] = {255, 0, 0, 0, 255, 0, 0, 0, 255};
+    png = make_png(32U, 32U, 3U, 1U, idx, plte, 9U, 0, &png_len);
+    CHECK(http_thumb_scale(png, png_len, 16U, &out, &out_len) == 0,
+          "palette scaled");
+    free(out);
+    free(png);
+    png = make_png(32U, 32U, 0U, 1U, idx, NULL, 0U, 0, &png_len);
+    CHECK(http_thumb_scale(png, png_len, 16U, &out, &out_len) == 0,
+          "gray scaled");
+    free(out);
+    free(png);
+    png = make_png(32U, 32U, 0U, 1U, idx, NULL, 0U, 1, &png_len);
+    CHECK(http_thumb_scale(png, png_len, 16U, &out, &out_len) == -1,
+          "interlaced refused");
+    png[40] ^= 0xFFU;
+    CHECK(http_thumb_scale(png, png_len, 16U, &out, &out_len) == -1,
+          "garbage refused");
+    free(png);
+
+    /* --- Cache: built once, then read from disk ------------------------- */
+    char dir[] = "/tmp/zftpd-thumbs-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        return 1;
+    }
+    http_thumb_reset(dir);
+    rgb = malloc(300U * 300U * 3U);
+    for (size_t i = 0U; i < 300U * 300U * 3U; i++) {
+        rgb[i] = (uint8_t)(i / 900U);
+    }
+    png = make_png(300U, 300U, 2U, 3U, rgb, NULL, 0U, 0, &png_len);
+    g_src = png;
+    g_src_len = png_len;
+    uint8_t *first = NULL;
+    size_t first_len = 0U;
+    CHECK(http_thumb_get("icon|1", 64U, load_src, NULL, &first, &first_len) ==
+              0,
+          "thumbnail built");
+    CHECK(g_loads == 1 && count_cached(dir) == 1U, "stored on disk");
+    CHECK(http_thumb_get("icon|1", 64U, load_src, NULL, &out, &out_len) == 0 &&
+              g_loads == 1 && out_len == first_len &&
+              memcmp(out, first, out_len) == 0,
+          "served from disk");
+    free(out);
+    CHECK(http_thumb_get("icon|1", 0U, load_src, NULL, &out, &out_len) == 0 &&
+              g_loads == 2 && out_len == png_len && count_cached(dir) == 1U,
+          "full size bypasses the cache");
+    free(out);
+    CHECK(http_thumb_get("icon|2", 128U, load_src, NULL, &out, &out_len) ==
+              0 &&
+              g_loads == 3 && count_cached(dir) == 2U,
+          "new stamp misses");
+    free(out);
+    g_src = NULL;
+    CHECK(http_thumb_get("icon|3", 64U, load_src, NULL, &out, &out_len) == -1,
+          "no source");
+    free(first);
+    free(png);
+    free(rgb);
+
+    DIR *d = opendir(dir);
+    struct dirent *de;
+    char path[FTP_PATH_MAX];
+    while (d != NULL && (de = readdir(d)) != NULL) {
+        if (de->d_name[0] != '.') {
+            snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+            (void)unlink(path);
+        }
+    }
+    if (d != NULL) {
+        closedir(d);
+    }
+    (void)rmdir(dir);
+    http_thumb_reset(NULL);
+
+    if (failures != 0) {
+        printf("http_thumb: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("http_thumb: OK\n");
+    return 0;
+}
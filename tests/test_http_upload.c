@@ -0,0 +1,227 @@
+#include "http_upload.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define UPLOADS 3U
+#define BODY_SIZE (5U * 1024U * 1024U + 123U)
+#define PREFILL 1000U
+
+static uint8_t pattern(size_t off, unsigned seed)
+{
+    return (uint8_t)((off * 131U + seed * 7U) >> 3);
+}
+
+typedef struct {
+    int fd;
+    unsigned seed;
+    size_t from;
+    size_t len;
+} peer_t;
+
+static void *peer_writer(void *arg)
+{
+    peer_t *p = (peer_t *)arg;
+    static __thread uint8_t chunk[65536];
+    size_t off = p->from;
+    while (off < p->len) {
+        size_t n = p->len - off;
+        if (n > sizeof(chunk)) {
+            n = sizeof(chunk);
+        }
+        for (size_t i = 0U; i < n; i++) {
+            chunk[i] = pattern(off + i, p->seed);
+        }
+        ssize_t w = send(p->fd, chunk, n, 0);
+        if (w <= 0) {
+            break;
+        }
+        off += (size_t)w;
+    }
+    return NULL;
+}
+
+static int file_matches(const char *path, unsigned seed, size_t len)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    static uint8_t buf[65536];
+    size_t off = 0U;
+    int ok = 1;
+    for (;;) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+            break;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != pattern(off + (size_t)i, seed)) {
+                ok = 0;
+            }
+        }
+        off += (size_t)n;
+    }
+    close(fd);
+    return ok && (off == len);
+}
+
+/* Drive UPLOADS concurrent bodies the way http_server.c does */
+static void run(unsigned writers, int splice, const char *label)
+{
+    CHECK(http_upload_pool_start(writers, splice) == 0, label);
+
+    char path[UPLOADS][64];
+    int sv[UPLOADS][2];
+    pthread_t tid[UPLOADS];
+    peer_t peer[UPLOADS];
+    http_upload_t *up[UPLOADS];
+    int reading[UPLOADS];
+    int done[UPLOADS];
+    int result[UPLOADS];
+
+    for (unsigned i = 0U; i < UPLOADS; i++) {
+        snprintf(path[i], sizeof(path[i]), "/tmp/zftpd-upload-XXXXXX");
+        int fd = mkstemp(path[i]);
+        CHECK((fd >= 0) && (socketpair(AF_UNIX, SOCK_STREAM, 0, sv[i]) == 0),
+              "setup");
+        up[i] = http_upload_open(fd, BODY_SIZE, sv[i][0], &up[i]);
+        CHECK(up[i] != NULL, "open");
+
+        /* Bytes that came in with the headers */
+        uint8_t head[PREFILL];
+        for (size_t k = 0U; k < PREFILL; k++) {
+            head[k] = pattern(k, i);
+        }
+        CHECK(http_upload_prefill(up[i], head, PREFILL) == 0, "prefill");
+
+        peer[i].fd = sv[i][1];
+        peer[i].seed = i;
+        peer[i].from = PREFILL;
+        peer[i].len = BODY_SIZE;
+        (void)pthread_create(&tid[i], NULL, peer_writer, &peer[i]);
+        reading[i] = 1;
+        done[i] = 0;
+        result[i] = -1;
+    }
+
+    unsigned finished = 0U;
+    while (finished < UPLOADS) {
+        struct pollfd pfd[UPLOADS + 1U];
+        unsigned map[UPLOADS];
+        nfds_t n = 0;
+        for (unsigned i = 0U; i < UPLOADS; i++) {
+            if ((reading[i] != 0) && (done[i] == 0)) {
+                pfd[n].fd = sv[i][0];
+                pfd[n].events = POLLIN;
+                map[n++] = i;
+            }
+        }
+        pfd[n].fd = http_upload_notes_fd();
+        pfd[n].events = POLLIN;
+        if (poll(pfd, n + 1U, 10000) <= 0) {
+            CHECK(0, "stalled");
+            break;
+        }
+        for (nfds_t k = 0; k < n; k++) {
+            if (pfd[k].revents == 0) {
+                continue;
+            }
+            unsigned i = map[k];
+            int rc = http_upload_feed(up[i]);
+            CHECK(rc != HTTP_UPLOAD_FAILED, "feed");
+            if (rc != HTTP_UPLOAD_MORE) {
+                reading[i] = 0;
+            }
+        }
+        int kind = 0;
+        http_upload_t *note;
+        while ((note = http_upload_next_note(&kind)) != NULL) {
+            http_upload_t **owner = (http_upload_t **)http_upload_owner(note);
+            CHECK(owner != NULL, "note for a live upload");
+            if (owner != NULL) {
+                unsigned i = (unsigned)(owner - up);
+                if (kind == HTTP_UPLOAD_NOTE_RESUME) {
+                    reading[i] = 1;
+                } else if (done[i] == 0) {
+                    done[i] = 1;
+                    result[i] = http_upload_result(note);
+                    finished++;
+                }
+            }
+            http_upload_note_done(note);
+        }
+    }
+
+    for (unsigned i = 0U; i < UPLOADS; i++) {
+        (void)pthread_join(tid[i], NULL);
+        CHECK(result[i] == 0, "result");
+        http_upload_release(up[i]);
+        CHECK(file_matches(path[i], i, BODY_SIZE), label);
+        close(sv[i][0]);
+        close(sv[i][1]);
+        unlink(path[i]);
+    }
+    http_upload_pool_stop();
+}
+
+/* A client that disappears half way: nothing leaks, no DONE for it */
+static void run_abandoned(void)
+{
+    CHECK(http_upload_pool_start(2U, 0) == 0, "abandon start");
+    char path[] = "/tmp/zftpd-upload-XXXXXX";
+    int fd = mkstemp(path);
+    int sv[2];
+    CHECK((fd >= 0) && (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0),
+          "abandon setup");
+    http_upload_t *up = http_upload_open(fd, BODY_SIZE, sv[0], NULL);
+    CHECK(up != NULL, "abandon open");
+
+    static uint8_t part[100000];
+    memset(part, 'x', sizeof(part));
+    CHECK(send(sv[1], part, sizeof(part), 0) == (ssize_t)sizeof(part),
+          "abandon send");
+    close(sv[1]);
+    int rc = HTTP_UPLOAD_MORE;
+    for (int i = 0; (i < 1000) && (rc == HTTP_UPLOAD_MORE); i++) {
+        rc = http_upload_feed(up);
+    }
+    CHECK(rc == HTTP_UPLOAD_FAILED, "early EOF fails the feed");
+    http_upload_release(up);
+    close(sv[0]);
+    http_upload_pool_stop();
+    unlink(path);
+}
+
+int main(void)
+{
+    run(2U, 1, "splice, pooled");
+    run(2U, 0, "ring, pooled");
+    run(0U, 0, "ring, inline");
+    run(0U, 1, "splice, inline");
+    run_abandoned();
+
+    if (failures != 0) {
+        printf("http_upload: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("http_upload: OK\n");
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include "pal_fileio.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FILE_SIZE (4U * 1024U * 1024U + 777U)
+#define STAGE_SIZE (64U * 1024U)
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static int temp_file(char *path)
+{
+    int fd = mkstemp(path);
+    if (fd >= 0) {
+        (void)unlink(path);
+    }
+    return fd;
+}
+
+/* Odd-sized writes from an unaligned start, read back byte for byte */
+static void test_writer(const uint8_t *src)
+{
+    char path[] = "/var/tmp/zftpd_io_XXXXXX";
+    int fd = temp_file(path);
+    CHECK(fd >= 0, "temp file");
+    if (fd < 0) {
+        return;
+    }
+    uint8_t *stage = aligned_alloc(PAL_IO_ALIGN, STAGE_SIZE);
+    CHECK(stage != NULL, "stage");
+    if (stage == NULL) {
+        close(fd);
+        return;
+    }
+
+    pal_io_writer_t w;
+    CHECK(pal_io_write_begin(&w, fd, stage + 1, STAGE_SIZE) ==
+              FTP_ERR_NOT_SUPPORTED,
+          "misaligned stage refused");
+    CHECK(pal_io_write_begin(&w, fd, stage, STAGE_SIZE - 1U) ==
+              FTP_ERR_NOT_SUPPORTED,
+          "odd stage size refused");
+
+    CHECK(write(fd, src, 100U) == 100, "unaligned prefix");
+    pal_io_stats_t before;
+    pal_io_get_stats(&before);
+    ftp_error_t err = pal_io_write_begin(&w, fd, stage, STAGE_SIZE);
+    if (err == FTP_ERR_NOT_SUPPORTED) {
+        printf("io_policy: O_DIRECT unavailable, writer skipped\n");
+        free(stage);
+        close(fd);
+        return;
+    }
+    CHECK(err == FTP_OK, "begin");
+
+    size_t done = 100U;
+    size_t step = 1U;
+    while (done < FILE_SIZE) {
+        size_t n = (step < FILE_SIZE - done) ? step : FILE_SIZE - done;
+        CHECK(pal_io_write(&w, src + done, n) == (ssize_t)n, "write");
+        done += n;
+        step = (step * 3U + 4093U) % 200000U;
+    }
+    CHECK(pal_io_write_end(&w) == FTP_OK, "end");
+#if defined(O_DIRECT)
+    CHECK((fcntl(fd, F_GETFL) & O_DIRECT) == 0, "O_DIRECT cleared");
+#endif
+
+    pal_io_stats_t after;
+    pal_io_get_stats(&after);
+    CHECK(after.direct == before.direct + 1U, "direct transfer counted");
+    CHECK(after.direct_bytes > before.direct_bytes, "direct bytes counted");
+    CHECK((after.direct_bytes - before.direct_bytes) % PAL_IO_ALIGN == 0U,
+          "direct writes are whole blocks");
+
+    uint8_t *back = malloc(FILE_SIZE);
+    CHECK((back != NULL) && (pread(fd, back, FILE_SIZE, 0) ==
+                             (ssize_t)FILE_SIZE),
+          "read back");
+    if (back != NULL) {
+        CHECK(memcmp(back, src, FILE_SIZE) == 0, "content intact");
+        free(back);
+    }
+    free(stage);
+    close(fd);
+}
+
+static void test_reader(const uint8_t *src)
+{
+    char path[] = "/var/tmp/zftpd_io_XXXXXX";
+    int fd = temp_file(path);
+    CHECK(fd >= 0, "temp file");
+    if (fd < 0) {
+        return;
+    }
+    CHECK(write(fd, src, FILE_SIZE) == (ssize_t)FILE_SIZE, "fill");
+    (void)fsync(fd);
+
+    pal_io_reader_t r;
+    CHECK(pal_io_read_begin(&r, fd, 0, FILE_SIZE, FILE_SIZE + 1U,
+                            256 * 1024) == PAL_IO_CACHED,
+          "below threshold stays cached");
+    CHECK(pal_io_read_begin(&r, fd, 0, FILE_SIZE, 0U, 256 * 1024) ==
+              PAL_IO_CACHED,
+          "threshold 0 never streams");
+    CHECK(pal_io_read_begin(NULL, fd, 0, FILE_SIZE, 1U, 0) == PAL_IO_CACHED,
+          "NULL reader");
+    pal_io_read_advance(NULL, 4096);
+
+#if defined(__linux__)
+    /* Freshly written pages are resident: keep them */
+    CHECK(pal_io_read_begin(&r, fd, 0, FILE_SIZE, 1U, 256 * 1024) ==
+              PAL_IO_CACHED,
+          "resident file stays cached");
+
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    pal_io_stats_t before;
+    pal_io_get_stats(&before);
+    CHECK(pal_io_read_begin(&r, fd, 0, FILE_SIZE, 1U, 256 * 1024) ==
+              PAL_IO_STREAM,
+          "cold large file streams");
+    for (off_t pos = 0; pos < (off_t)FILE_SIZE; pos += 100000) {
+        pal_io_read_advance(&r, pos);
+        CHECK((r.ahead - pos) <= (256 * 1024), "window bounded");
+        CHECK(r.dropped == pos, "dropped behind");
+    }
+    pal_io_read_advance(&r, (off_t)FILE_SIZE + 5);
+    CHECK(r.dropped == (off_t)FILE_SIZE, "clamped at end");
+    CHECK(r.ahead == (off_t)FILE_SIZE, "read-ahead reached the end");
+
+    pal_io_stats_t after;
+    pal_io_get_stats(&after);
+    CHECK(after.streamed == before.streamed + 1U, "stream counted");
+    CHECK(after.dropped_bytes - before.dropped_bytes == FILE_SIZE,
+          "every byte dropped once");
+    CHECK(after.readahead_bytes - before.readahead_bytes == FILE_SIZE,
+          "every byte read ahead once");
+    CHECK(after.probed_bytes - before.probed_bytes == FILE_SIZE,
+          "probe counted");
+    CHECK(after.resident_bytes - before.resident_bytes < FILE_SIZE / 2U,
+          "probe saw a cold file");
+#endif
+    close(fd);
+}
+
+int main(void)
+{
+    uint8_t *src = malloc(FILE_SIZE);
+    if (src == NULL) {
+        return 1;
+    }
+    for (size_t i = 0U; i < FILE_SIZE; i++) {
+        src[i] = (uint8_t)((i * 13U) ^ (i >> 9));
+    }
+
+    test_writer(src);
+    test_reader(src);
+    free(src);
+
+    if (failures != 0) {
+        printf("io_policy: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("io_policy: OK\n");
+    return 0;
+}
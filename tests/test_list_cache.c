@@ -0,0 +1,242 @@
+#include "ftp_list.h"
+#include "ftp_session.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define BIG_FILES 700U /* > FTP_LIST_STAT_BATCH */
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+/* Drain whatever the listing wrote to the data socket */
+static size_t drain(int fd, char *buf, size_t size)
+{
+    size_t total = 0U;
+    int flags = fcntl(fd, F_GETFL, 0);
+    (void)fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    for (;;) {
+        ssize_t n = recv(fd, buf + total, size - total - 1U, 0);
+        if (n <= 0) {
+            break;
+        }
+        total += (size_t)n;
+    }
+    (void)fcntl(fd, F_SETFL, flags);
+    buf[total] = '\0';
+    return total;
+}
+
+static void touch(const char *dir, const char *name)
+{
+    char path[FTP_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0) {
+        (void)write(fd, "data", 4U);
+        close(fd);
+    }
+}
+
+/* Directory mtime far enough in the past for the entry to be stored */
+static void age_dir(const char *dir, long secs_ago)
+{
+    struct timeval tv[2];
+    gettimeofday(&tv[0], NULL);
+    tv[0].tv_sec -= secs_ago;
+    tv[1] = tv[0];
+    (void)utimes(dir, tv);
+}
+
+int main(void)
+{
+#if !FTP_LIST_CACHE_ENABLE
+    printf("list_cache: skipped (FTP_LIST_CACHE_ENABLE=0)\n");
+    return 0;
+#else
+    char root_template[] = "/tmp/zftpd-lcache-XXXXXX";
+    char *root = mkdtemp(root_template);
+    if (root == NULL) {
+        return 1;
+    }
+    touch(root, "a.txt");
+    touch(root, "b.txt");
+    age_dir(root, 100);
+
+    int ctrl[2];
+    int data[2];
+    if ((socketpair(AF_UNIX, SOCK_STREAM, 0, ctrl) != 0) ||
+        (socketpair(AF_UNIX, SOCK_STREAM, 0, data) != 0)) {
+        return 1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    (void)inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    ftp_session_t session;
+    if (ftp_session_init(&session, ctrl[0], &addr, 1U, root) != FTP_OK) {
+        return 1;
+    }
+    session.data_fd = data[0];
+
+    ftp_list_cache_clear();
+    ftp_list_cache_stats_t st0;
+    ftp_list_cache_get_stats(&st0);
+
+    static char first[65536];
+    static char again[65536];
+    static char listing[262144];
+
+    /* miss, then hit with identical bytes */
+    CHECK(ftp_list_send_directory(&session, root, FTP_LIST_UNIX) == FTP_OK,
+          "first LIST");
+    size_t n1 = drain(data[1], first, sizeof(first));
+    CHECK(ftp_list_send_directory(&session, root, FTP_LIST_UNIX) == FTP_OK,
+          "second LIST");
+    size_t n2 = drain(data[1], again, sizeof(again));
+    CHECK((n1 > 0U) && (n1 == n2) && (memcmp(first, again, n1) == 0),
+          "hit differs from miss");
+
+    ftp_list_cache_stats_t st;
+    ftp_list_cache_get_stats(&st);
+    CHECK(st.misses - st0.misses == 1U, "one miss");
+    CHECK(st.hits - st0.hits == 1U, "one hit");
+    CHECK(st.entries == 1U, "one entry");
+
+    /* Other formats reuse the stat array */
+    CHECK(ftp_list_send_directory(&session, root, FTP_LIST_MLSD) == FTP_OK,
+          "MLSD");
+    drain(data[1], again, sizeof(again));
+    CHECK(strstr(again, "type=file;size=4;") != NULL, "MLSD from cache");
+    ftp_list_cache_get_stats(&st);
+    CHECK(st.hits - st0.hits == 2U, "MLSD served from the LIST entry");
+
+    /* Our own change: invalidated without waiting for mtime */
+    touch(root, "c.txt");
+    age_dir(root, 50);
+    char changed[FTP_PATH_MAX];
+    snprintf(changed, sizeof(changed), "%s/c.txt", root);
+    ftp_list_cache_invalidate(changed);
+    CHECK(ftp_list_send_directory(&session, root, FTP_LIST_NAMES) == FTP_OK,
+          "NLST after invalidate");
+    drain(data[1], again, sizeof(again));
+    CHECK(strstr(again, "c.txt\r\n") != NULL, "new file listed");
+
+    /* External change: caught by the directory mtime */
+    touch(root, "d.txt");
+    age_dir(root, 20);
+    CHECK(ftp_list_send_directory(&session, root, FTP_LIST_NAMES) == FTP_OK,
+          "NLST after external change");
+    drain(data[1], again, sizeof(again));
+    CHECK(strstr(again, "d.txt\r\n") != NULL, "external file listed");
+
+    /* A directory modified this very second is not stored */
+    ftp_list_cache_clear();
+    touch(root, "e.txt");
+    CHECK(ftp_list_send_directory(&session, root, FTP_LIST_NAMES) == FTP_OK,
+          "NLST of fresh directory");
+    drain(data[1], again, sizeof(again));
+    ftp_list_cache_get_stats(&st);
+    CHECK(st.entries == 0U, "fresh directory not cached");
+
+    /* More than one stat batch: every size lands on its own name */
+    char big[FTP_PATH_MAX];
+    snprintf(big, sizeof(big), "%s/big", root);
+    (void)mkdir(big, 0755);
+    for (unsigned i = 0U; i < BIG_FILES; i++) {
+        char path[FTP_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/f%03u", big, i);
+        int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            (void)ftruncate(fd, (off_t)i + 1);
+            close(fd);
+        }
+    }
+    CHECK(ftp_list_send_directory(&session, big, FTP_LIST_MLSD) == FTP_OK,
+          "MLSD of large directory");
+    drain(data[1], listing, sizeof(listing));
+    unsigned seen = 0U;
+    for (char *line = strtok(listing, "\r\n"); line != NULL;
+         line = strtok(NULL, "\r\n")) {
+        unsigned idx = 0U;
+        unsigned long long size = 0ULL;
+        const char *name = strstr(line, "; f");
+        const char *sz = strstr(line, "size=");
+        if ((name != NULL) && (sz != NULL) &&
+            (sscanf(name + 3, "%3u", &idx) == 1) &&
+            (sscanf(sz + 5, "%llu", &size) == 1) &&
+            (size == (unsigned long long)idx + 1ULL)) {
+            seen++;
+        }
+    }
+    CHECK(seen == BIG_FILES, "large directory sizes match names");
+
+    /* Snapshots: the paged HTTP listing reads the same entries */
+    age_dir(big, 100);
+    ftp_list_cache_get_stats(&st0);
+    ftp_list_snapshot_t snap;
+    CHECK(ftp_list_snapshot(big, &snap) == FTP_OK, "first snapshot");
+    CHECK(snap.count == BIG_FILES, "snapshot count");
+    unsigned matched = 0U;
+    for (size_t i = 0U; i < snap.count; i++) {
+        unsigned idx = 0U;
+        if ((sscanf(ftp_list_snapshot_name(&snap, i), "f%3u", &idx) == 1) &&
+            (ftp_list_snapshot_stat(&snap, i)->size == (uint64_t)idx + 1U)) {
+            matched++;
+        }
+    }
+    CHECK(matched == BIG_FILES, "snapshot sizes match names");
+    ftp_list_snapshot_t again_snap;
+    CHECK(ftp_list_snapshot(big, &again_snap) == FTP_OK, "second snapshot");
+    ftp_list_cache_get_stats(&st);
+    CHECK((st.hits - st0.hits == 1U) && (again_snap.count == snap.count),
+          "second snapshot is a cache hit");
+    ftp_list_snapshot_release(&again_snap);
+    /* Still pinned by the first snapshot across a clear */
+    ftp_list_cache_clear();
+    CHECK(ftp_list_snapshot_name(&snap, 0U)[0] == 'f',
+          "pinned snapshot survives clear");
+    ftp_list_snapshot_release(&snap);
+    CHECK(snap.entry == NULL, "release clears the handle");
+
+    ftp_list_cache_clear();
+    ftp_session_cleanup(&session);
+    close(ctrl[1]);
+    close(data[1]);
+
+    const char *names[] = {"a.txt", "b.txt", "c.txt", "d.txt", "e.txt"};
+    for (size_t i = 0U; i < sizeof(names) / sizeof(names[0]); i++) {
+        char path[FTP_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%s", root, names[i]);
+        unlink(path);
+    }
+    for (unsigned i = 0U; i < BIG_FILES; i++) {
+        char path[FTP_PATH_MAX];
+        snprintf(path, sizeof(path), "%s/f%03u", big, i);
+        unlink(path);
+    }
+    rmdir(big);
+    rmdir(root);
+
+    if (failures != 0) {
+        printf("list_cache: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("list_cache: OK\n");
+    return 0;
+#endif
+}
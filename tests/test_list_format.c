@@ -0,0 +1,114 @@
+#include "ftp_list.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static int failures = 0;
+
+/* The snprintf/strftime formatting ftp_list_format() replaced */
+static void ref_unix(const vfs_stat_t *st, const char *name, char *out,
+                     size_t size)
+{
+    char perms[11];
+    perms[0] = ((st->mode & S_IFMT) == S_IFDIR) ? 'd' : '-';
+    perms[1] = ((st->mode & S_IRUSR) != 0U) ? 'r' : '-';
+    perms[2] = ((st->mode & S_IWUSR) != 0U) ? 'w' : '-';
+    perms[3] = ((st->mode & S_IXUSR) != 0U) ? 'x' : '-';
+    perms[4] = ((st->mode & S_IRGRP) != 0U) ? 'r' : '-';
+    perms[5] = ((st->mode & S_IWGRP) != 0U) ? 'w' : '-';
+    perms[6] = ((st->mode & S_IXGRP) != 0U) ? 'x' : '-';
+    perms[7] = ((st->mode & S_IROTH) != 0U) ? 'r' : '-';
+    perms[8] = ((st->mode & S_IWOTH) != 0U) ? 'w' : '-';
+    perms[9] = ((st->mode & S_IXOTH) != 0U) ? 'x' : '-';
+    perms[10] = '\0';
+
+    struct tm tm_time;
+    time_t mtime = (time_t)st->mtime;
+    gmtime_r(&mtime, &tm_time);
+    char time_str[32];
+    strftime(time_str, sizeof(time_str), "%b %d %H:%M", &tm_time);
+    snprintf(out, size, "%s 1 ftp ftp %10lld %s %s\r\n", perms,
+             (long long)st->size, time_str, name);
+}
+
+static void ref_mlsx(const vfs_stat_t *st, const char *name, int lead,
+                     char *out, size_t size)
+{
+    struct tm tm_time;
+    time_t mtime = (time_t)st->mtime;
+    gmtime_r(&mtime, &tm_time);
+    char timebuf[20];
+    strftime(timebuf, sizeof(timebuf), "%Y%m%d%H%M%S", &tm_time);
+    int dir = ((st->mode & S_IFMT) == S_IFDIR);
+    snprintf(out, size, "%stype=%s;size=%llu;modify=%s;unix.mode=%04o; %s\r\n",
+             lead ? " " : "", dir ? "dir" : "file",
+             dir ? 0ULL : (unsigned long long)st->size, timebuf,
+             (unsigned)(st->mode & 07777U), name);
+}
+
+static void check(ftp_list_format_t fmt, const vfs_stat_t *st,
+                  const char *name)
+{
+    char want[FTP_LIST_LINE_SIZE];
+    char got[FTP_LIST_LINE_SIZE];
+    if (fmt == FTP_LIST_UNIX) {
+        ref_unix(st, name, want, sizeof(want));
+    } else if (fmt == FTP_LIST_NAMES) {
+        snprintf(want, sizeof(want), "%s\r\n", name);
+    } else {
+        ref_mlsx(st, name, fmt == FTP_LIST_MLST, want, sizeof(want));
+    }
+    size_t n = ftp_list_format(fmt, st, name, got, sizeof(got));
+    if ((n != strlen(want)) || (strcmp(got, want) != 0)) {
+        printf("FAIL fmt=%d mtime=%lld\n  want: %s  got:  %s", (int)fmt,
+               (long long)st->mtime, want, got);
+        failures++;
+    }
+}
+
+int main(void)
+{
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < 200000; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        vfs_stat_t st;
+        st.mode = (uint32_t)(((x & 1U) != 0U) ? S_IFDIR : S_IFREG) |
+                  (uint32_t)((x >> 8) & 07777U);
+        /* 1000-01-01 .. 9999-12-31 */
+        int64_t lo = -30610224000LL;
+        int64_t span = 253402300799LL - lo;
+        st.mtime = lo + (int64_t)((x >> 16) % (uint64_t)span);
+        st.size = (i % 3 == 0) ? (x >> 20) : (x % 100000U);
+        check((ftp_list_format_t)(i % 4), &st, "entry name.bin");
+    }
+
+    vfs_stat_t st;
+    memset(&st, 0, sizeof(st));
+    st.mode = (uint32_t)S_IFREG | 0644U;
+    const int64_t edges[] = {0, -1, 86399, 86400, 951782400 /* 2000-02-29 */,
+                             4107542400LL /* 2100-03-01 */, -86401};
+    for (size_t i = 0U; i < sizeof(edges) / sizeof(edges[0]); i++) {
+        st.mtime = edges[i];
+        check(FTP_LIST_UNIX, &st, "a");
+        check(FTP_LIST_MLSD, &st, "a");
+    }
+
+    /* Too small a buffer is refused, never truncated */
+    char small[16];
+    if (ftp_list_format(FTP_LIST_UNIX, &st, "name", small, sizeof(small)) !=
+        0U) {
+        printf("FAIL short buffer accepted\n");
+        failures++;
+    }
+
+    if (failures != 0) {
+        printf("list_format: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("list_format: OK\n");
+    return 0;
+}
@@ -0,0 +1,143 @@
+#include "ftp_log.h"
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define THREADS 4
+#define PER_THREAD 200U
+#define BURST 5000U
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static ftp_session_t sessions[THREADS];
+
+static void *producer(void *arg)
+{
+    ftp_session_t *s = arg;
+    for (uint32_t i = 0U; i < PER_THREAD; i++) {
+        ftp_log_session_event(s, "RETR_OK", FTP_OK, (uint64_t)i);
+        if ((i % 50U) == 49U) {
+            usleep(30000);
+        }
+    }
+    return NULL;
+}
+
+static void *burst(void *arg)
+{
+    for (uint32_t i = 0U; i < BURST; i++) {
+        ftp_log_session_cmd(arg, "NOOP", FTP_OK);
+    }
+    return NULL;
+}
+
+int main(void)
+{
+    char path[] = "/tmp/zftpd_log_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return 1;
+    }
+    (void)unlink(path);
+    int saved = dup(STDERR_FILENO);
+    (void)dup2(fd, STDERR_FILENO);
+
+    for (int i = 0; i < THREADS; i++) {
+        sessions[i].session_id = (uint32_t)(i + 1);
+        sessions[i].ctrl_addr.sin_addr.s_addr = htonl(0x0A000001U + (uint32_t)i);
+    }
+
+    /* Paced producers: nothing is lost */
+    pthread_t th[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        pthread_create(&th[i], NULL, producer, &sessions[i]);
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(th[i], NULL);
+    }
+    ftp_log_session_cmd(NULL, "A_VERY_LONG_COMMAND_NAME", FTP_ERR_INVALID_PARAM);
+    ftp_log_flush();
+
+    ftp_log_stats_t st;
+    ftp_log_get_stats(&st);
+    CHECK(st.queued + st.direct == THREADS * PER_THREAD + 1U, "all queued");
+    CHECK(st.dropped == 0U, "no drops when paced");
+    CHECK(st.written == st.queued, "all written");
+
+    /* Burst: drops instead of blocking, and says so */
+    pthread_t b;
+    pthread_create(&b, NULL, burst, &sessions[0]);
+    pthread_join(b, NULL);
+    ftp_log_flush();
+    ftp_log_stats_t st2;
+    ftp_log_get_stats(&st2);
+    CHECK((st2.queued - st.queued) + (st2.direct - st.direct) +
+                  (st2.dropped - st.dropped) ==
+              BURST,
+          "burst accounted");
+    CHECK(st2.written == st2.queued, "burst written");
+    CHECK(st2.rings >= 1U, "rings counted");
+
+    (void)fflush(stderr);
+    (void)dup2(saved, STDERR_FILENO);
+
+    /* Read the captured log back */
+    FILE *f = fdopen(fd, "r");
+    CHECK(f != NULL, "reopen");
+    if (f != NULL) {
+        rewind(f);
+        char line[256];
+        uint64_t next[THREADS] = {0};
+        unsigned events = 0U;
+        unsigned noops = 0U;
+        int in_order = 1;
+        int long_ok = 0;
+        int drop_line = 0;
+        while (fgets(line, sizeof(line), f) != NULL) {
+            unsigned sid = 0U;
+            unsigned long long bytes = 0U;
+            if (sscanf(line, "[FTP][INFO] SID=%u IP=%*s EVT=RETR_OK RES=0 BYTES=%llu",
+                       &sid, &bytes) == 2) {
+                events++;
+                if ((sid >= 1U) && (sid <= THREADS)) {
+                    in_order &= (bytes == next[sid - 1U]) ? 1 : 0;
+                    next[sid - 1U] = bytes + 1U;
+                }
+            } else if (strstr(line, "CMD=NOOP RES=0") != NULL) {
+                noops++;
+            } else if (strncmp(line, "[FTP][WARN] SID=0 IP=unknown "
+                                     "CMD=A_VERY_LONG_COM RES=-", 54) == 0) {
+                long_ok = 1;
+            } else if (strstr(line, "[FTP][WARN] log: dropped") != NULL) {
+                drop_line = 1;
+            }
+        }
+        CHECK(events == THREADS * PER_THREAD, "event lines");
+        CHECK(in_order != 0, "per-session order kept");
+        CHECK(long_ok != 0, "name truncated, unknown IP");
+        CHECK(noops == (unsigned)((st2.queued - st.queued) +
+                                  (st2.direct - st.direct)),
+              "burst lines");
+        CHECK((drop_line != 0) == (st2.dropped > 0U), "drop reported");
+        fclose(f);
+    }
+
+    if (failures != 0) {
+        printf("log: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("log: OK (burst dropped %llu of %u)\n",
+           (unsigned long long)(st2.dropped - st.dropped), BURST);
+    return 0;
+}
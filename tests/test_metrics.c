@@ -0,0 +1,156 @@
+#include "ftp_metrics.h"
+#include "ftp_protocol.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define THREADS 12
+#define PER_THREAD 10000U
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+/* Value of the first line starting with @p prefix, -1 if absent */
+static long long sample(const char *text, const char *prefix)
+{
+    size_t n = strlen(prefix);
+    for (const char *p = text; (p != NULL) && (*p != '\0');) {
+        if (strncmp(p, prefix, n) == 0) {
+            return atoll(p + n);
+        }
+        p = strchr(p, '\n');
+        p = (p != NULL) ? p + 1 : NULL;
+    }
+    return -1;
+}
+
+static void *hammer(void *arg)
+{
+    (void)arg;
+    for (unsigned i = 0U; i < PER_THREAD; i++) {
+        ftp_metrics_add(FTP_METRIC_SENDFILE_EAGAIN, 1U);
+        ftp_metrics_observe(FTP_METRIC_PASV_ACCEPT, 5000U);
+    }
+    return NULL;
+}
+
+static void test_buckets(void)
+{
+    CHECK(ftp_metrics_bucket(0U) == 0U, "zero");
+    CHECK(ftp_metrics_bucket(1024U) == 0U, "first bound inclusive");
+    CHECK(ftp_metrics_bucket(1025U) == 1U, "just above");
+    CHECK(ftp_metrics_bucket(2048U) == 1U, "second bound inclusive");
+    CHECK(ftp_metrics_bucket(1ULL << 20) == 10U, "1 MiB");
+    CHECK(ftp_metrics_bucket(UINT64_MAX) == FTP_METRICS_BUCKETS, "+Inf");
+}
+
+int main(void)
+{
+    test_buckets();
+
+    /* Threads outnumber shards: nothing may be lost */
+    pthread_t th[THREADS];
+    for (int i = 0; i < THREADS; i++) {
+        CHECK(pthread_create(&th[i], NULL, hammer, NULL) == 0, "thread");
+    }
+    for (int i = 0; i < THREADS; i++) {
+        pthread_join(th[i], NULL);
+    }
+    CHECK(ftp_metrics_counter(FTP_METRIC_SENDFILE_EAGAIN) ==
+              (uint64_t)THREADS * PER_THREAD,
+          "sharded counter sums");
+
+    /* First byte is recorded once per arm */
+    _Atomic uint64_t armed = now_ns() - 3000000U;
+    ftp_metrics_first_byte(&armed);
+    ftp_metrics_first_byte(&armed);
+    CHECK(armed == 0U, "disarmed");
+    ftp_metrics_first_byte(NULL);
+
+    /* Short connections stay out of the throughput histogram */
+    ftp_metrics_transfer(0, 100U, 1000U);
+    ftp_metrics_transfer(1, 8U * 1024U * 1024U, 1000000000U);
+
+    const ftp_command_entry_t *table = ftp_get_command_table(NULL);
+    const ftp_command_entry_t *user = ftp_find_command("USER");
+    CHECK(user != NULL, "USER in table");
+    ftp_metrics_command((size_t)(user - table), 2000U);
+    ftp_metrics_command((size_t)(user - table), 40000000U);
+    ftp_metrics_command(FTP_METRICS_VERBS, 1U); /* ignored */
+
+    size_t need = ftp_metrics_render(NULL, NULL, 0U);
+    CHECK(need > 0U, "length without a buffer");
+    char *text = malloc(need + 1U);
+    if (text == NULL) {
+        return 1;
+    }
+    CHECK(ftp_metrics_render(NULL, text, need + 1U) == need, "fits");
+
+    CHECK(sample(text, "zftpd_sendfile_eagain_total ") ==
+              (long long)THREADS * PER_THREAD,
+          "counter rendered");
+    CHECK(sample(text, "zftpd_pasv_accept_seconds_count ") ==
+              (long long)THREADS * PER_THREAD,
+          "histogram count");
+    CHECK(sample(text, "zftpd_pasv_accept_seconds_bucket{le=\"4.096e-06\"} ") ==
+              0,
+          "below the values");
+    CHECK(sample(text, "zftpd_pasv_accept_seconds_bucket{le=\"8.192e-06\"} ") ==
+              (long long)THREADS * PER_THREAD,
+          "cumulative bucket");
+    CHECK(sample(text, "zftpd_transfer_first_byte_seconds_count ") == 1,
+          "first byte once");
+    CHECK(sample(text, "zftpd_command_duration_seconds_count{verb=\"USER\"} ") ==
+              2,
+          "verb series");
+    CHECK(sample(text, "zftpd_command_duration_seconds_bucket{verb=\"USER\","
+                       "le=\"+Inf\"} ") == 2,
+          "verb +Inf");
+    CHECK(strstr(text, "verb=\"PASS\"") == NULL, "unused verbs omitted");
+    CHECK(sample(text, "zftpd_transfer_throughput_bytes_per_second_count{"
+                       "direction=\"send\"} ") == 0,
+          "short transfer skipped");
+    CHECK(sample(text, "zftpd_transfer_throughput_bytes_per_second_bucket{"
+                       "direction=\"recv\",le=\"8388608\"} ") == 1,
+          "8 MiB/s in its bucket");
+    CHECK(strstr(text, "# TYPE zftpd_command_duration_seconds histogram\n") !=
+              NULL,
+          "TYPE line");
+    CHECK(sample(text, "zftpd_buffer_waits_total{class=\"stream\"} ") >= 0,
+          "buffer pool series");
+    CHECK(sample(text, "zftpd_alloc_failures_total ") >= 0, "alloc series");
+    CHECK(sample(text, "zftpd_alloc_largest_free_bytes{region=\"large\"} ") >=
+              0,
+          "alloc fragmentation series");
+    CHECK(sample(text, "zftpd_scratch_fallbacks_total ") >= 0, "scratch series");
+
+    /* Truncation reports the full length and stays terminated */
+    char small[64];
+    CHECK(ftp_metrics_render(NULL, small, sizeof(small)) >= need,
+          "truncated length");
+    CHECK(strlen(small) == sizeof(small) - 1U, "NUL-terminated");
+    free(text);
+
+    if (failures != 0) {
+        printf("metrics: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("metrics: OK\n");
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "pal_ffi.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static uint64_t addr(const void *p)
+{
+    return (uint64_t)(uintptr_t)p;
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/zftpd-ffi-XXXXXX";
+    if (mkdtemp(dir) == NULL) {
+        return 1;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "%s/data.bin", dir);
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return 1;
+    }
+
+    /* --- One batch: write, fsync, read back, stat, bad opcode -------- */
+    void *q = pal_ffi_queue_create(5U);
+    CHECK(q != NULL, "queue created");
+    char out[] = "batched";
+    char in[16];
+    memset(in, 0, sizeof(in));
+    pal_ffi_stat_t st;
+    memset(&st, 0, sizeof(st));
+    pal_ffi_op_t ops[5];
+    memset(ops, 0, sizeof(ops));
+    ops[0] = (pal_ffi_op_t){.opcode = PAL_FFI_OP_WRITE, .fd = fd,
+                            .addr = addr(out), .len = 7U, .user_data = 1U};
+    ops[1] = (pal_ffi_op_t){.opcode = PAL_FFI_OP_FSYNC, .fd = fd,
+                            .user_data = 2U};
+    ops[2] = (pal_ffi_op_t){.opcode = PAL_FFI_OP_READ, .fd = fd,
+                            .addr = addr(in), .len = sizeof(in),
+                            .offset = 2U, .user_data = 3U};
+    ops[3] = (pal_ffi_op_t){.opcode = PAL_FFI_OP_STAT, .addr = addr(&st),
+                            .len = sizeof(st), .path = addr(path),
+                            .user_data = 4U};
+    ops[4] = (pal_ffi_op_t){.opcode = 99U, .user_data = 5U};
+    CHECK(pal_ffi_queue_submit(q, ops, 5U) == 5, "whole batch ran");
+    CHECK(strcmp(in, "tched") == 0, "read into the caller buffer");
+    CHECK(st.size == 7U && S_ISREG(st.mode), "stat into the caller struct");
+
+    uint32_t n = 0U;
+    const pal_ffi_cqe_t *c = pal_ffi_queue_peek(q, &n);
+    CHECK(c != NULL && n == 5U, "completions borrowed in place");
+    if (c != NULL && n == 5U) {
+        CHECK(c[0].user_data == 1U && c[0].result == 7, "write result");
+        CHECK(c[1].result == 0, "fsync result");
+        CHECK(c[2].result == 5 && c[2].opcode == PAL_FFI_OP_READ,
+              "short read result");
+        CHECK(c[4].result == PAL_FFI_ERR_INVALID_PARAM, "unknown opcode");
+    }
+    pal_ffi_queue_advance(q, 2U);
+    pal_ffi_cqe_t got[8];
+    CHECK(pal_ffi_queue_reap(q, got, 8U) == 3U && got[0].user_data == 3U,
+          "reap copies the rest");
+    CHECK(pal_ffi_queue_peek(q, &n) == NULL && n == 0U, "queue drained");
+
+    /* --- Errors carry errno; a full queue stops the batch ------------ */
+    ops[3].path = addr("/nonexistent/zftpd");
+    for (uint32_t i = 0U; i < 5U; i++) {
+        ops[i] = ops[3];
+        ops[i].user_data = 10U + i;
+    }
+    CHECK(pal_ffi_queue_submit(q, ops, 5U) == 5, "second batch");
+    CHECK(pal_ffi_queue_submit(q, ops, 5U) == 3, "stops when full");
+    /* Depth 5 rounds up to 8: three slots to the end, five wrapped */
+    c = pal_ffi_queue_peek(q, &n);
+    CHECK(c != NULL && n == 3U, "contiguous run up to the end");
+    if (c != NULL && n == 3U) {
+        CHECK(c[0].result == PAL_FFI_ERR_IO && c[0].sys_errno != 0,
+              "io error with errno");
+    }
+    pal_ffi_queue_advance(q, n);
+    c = pal_ffi_queue_peek(q, &n);
+    CHECK(c != NULL && n == 5U && c[0].user_data == 13U, "wrapped run");
+    pal_ffi_queue_advance(q, 10U);
+    CHECK(pal_ffi_queue_submit(NULL, ops, 1U) == PAL_FFI_ERR_INVALID_PARAM,
+          "null queue");
+    pal_ffi_queue_destroy(q);
+
+    /* --- Listing in one block ---------------------------------------- */
+    char sub[64];
+    snprintf(sub, sizeof(sub), "%s/subdir", dir);
+    (void)mkdir(sub, 0755);
+    void *ls = pal_ffi_dir_open(dir);
+    CHECK(ls != NULL, "dir opened");
+    uint32_t count = 0U;
+    size_t bytes = 0U;
+    const pal_ffi_dirent_t *e = pal_ffi_dir_entries(ls, &count, &bytes);
+    CHECK(e != NULL && count == 2U, "two entries");
+    int seen = 0;
+    for (uint32_t i = 0U; (e != NULL) && (i < count); i++) {
+        const char *name = (const char *)e + e[i].name_off;
+        CHECK(e[i].name_off + e[i].name_len < bytes, "name inside block");
+        CHECK(strlen(name) == e[i].name_len, "name length");
+        if (strcmp(name, "data.bin") == 0) {
+            CHECK(e[i].size == 7U && S_ISREG(e[i].mode), "file entry");
+            seen++;
+        } else if (strcmp(name, "subdir") == 0) {
+            CHECK(S_ISDIR(e[i].mode), "dir entry");
+            seen++;
+        }
+    }
+    CHECK(seen == 2, "both names");
+    pal_ffi_dir_close(ls);
+    CHECK(pal_ffi_dir_open("/nonexistent/zftpd") == NULL, "missing dir");
+
+    /* --- FTP counters ------------------------------------------------- */
+    void *ftp = pal_ffi_ftp_server_create("127.0.0.1", 21210U, dir);
+    CHECK(ftp != NULL, "ftp server created");
+    pal_ffi_ftp_stats_t fs;
+    memset(&fs, 0xFF, sizeof(fs));
+    CHECK(pal_ffi_ftp_server_get_stats(ftp, &fs) == PAL_FFI_OK &&
+              fs.total_connections == 0U && fs.active_sessions == 0U &&
+              fs.reserved == 0U,
+          "ftp stats view");
+    CHECK(pal_ffi_ftp_server_get_stats(NULL, &fs) == PAL_FFI_ERR_INVALID_PARAM,
+          "null server");
+    pal_ffi_ftp_server_destroy(ftp);
+
+    close(fd);
+    (void)unlink(path);
+    (void)rmdir(sub);
+    (void)rmdir(dir);
+
+    if (failures != 0) {
+        printf("pal_ffi: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("pal_ffi: OK\n");
+    return 0;
+}
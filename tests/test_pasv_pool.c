@@ -0,0 +1,141 @@
+#include "ftp_pasv_pool.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define LOOPBACK 0x7F000001U
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static int dial(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(LOOPBACK);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int pending(int fd)
+{
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return (poll(&pfd, 1U, 100) > 0) && ((pfd.revents & POLLIN) != 0);
+}
+
+int main(void)
+{
+    ftp_pasv_pool_stats_t st;
+
+    CHECK(ftp_pasv_pool_create(0U, 0U, 0U) == NULL, "zero slots rejected");
+    CHECK(ftp_pasv_pool_create(1U, 2000U, 1999U) == NULL,
+          "inverted range rejected");
+
+    ftp_pasv_pool_t *pool = ftp_pasv_pool_create(2U, 0U, 0U);
+    CHECK(pool != NULL, "create");
+    if (pool == NULL) {
+        return 1;
+    }
+
+    /* Lease, return, lease again: the same listener comes back */
+    uint16_t port = 0U;
+    int fd = ftp_pasv_pool_lease(pool, LOOPBACK, &port);
+    CHECK((fd >= 0) && (port != 0U), "first lease opens a listener");
+    ftp_pasv_pool_return(pool, fd);
+
+    uint16_t port2 = 0U;
+    int fd2 = ftp_pasv_pool_lease(pool, LOOPBACK, &port2);
+    CHECK((fd2 == fd) && (port2 == port), "second lease reuses it");
+    ftp_pasv_pool_get_stats(pool, &st);
+    CHECK((st.created == 1U) && (st.reused == 1U) && (st.leased == 1U),
+          "created/reused/leased counters");
+
+    /* The leased listener accepts */
+    int c = dial(port2);
+    CHECK((c >= 0) && pending(fd2), "leased listener accepts");
+    int a = accept(fd2, NULL, NULL);
+    CHECK(a >= 0, "accept on lease");
+    if (a >= 0) {
+        close(a);
+    }
+    if (c >= 0) {
+        close(c);
+    }
+    ftp_pasv_pool_return(pool, fd2);
+
+    /* A connection queued while idle is dropped before the next lease */
+    c = dial(port);
+    CHECK(c >= 0, "dial idle listener");
+    fd = ftp_pasv_pool_lease(pool, LOOPBACK, &port2);
+    CHECK(fd >= 0, "lease after stale connect");
+    CHECK(!pending(fd), "stale connection drained");
+    if (c >= 0) {
+        close(c);
+    }
+
+    /* Both slots leased: the next lease spills outside the pool */
+    int fd3 = ftp_pasv_pool_lease(pool, LOOPBACK, NULL);
+    int spill = ftp_pasv_pool_lease(pool, LOOPBACK, NULL);
+    CHECK((fd3 >= 0) && (spill >= 0) && (spill != fd) && (spill != fd3),
+          "spill listener");
+    ftp_pasv_pool_get_stats(pool, &st);
+    CHECK((st.leased == 2U) && (st.idle == 0U) && (st.spilled == 1U),
+          "full pool counters");
+    ftp_pasv_pool_return(pool, spill);
+    CHECK(fcntl(spill, F_GETFD) < 0, "spilled listener closed on return");
+
+    ftp_pasv_pool_return(pool, fd);
+    ftp_pasv_pool_return(pool, fd3);
+    ftp_pasv_pool_get_stats(pool, &st);
+    CHECK((st.idle == 2U) && (st.leased == 0U), "all returned");
+    ftp_pasv_pool_destroy(pool);
+
+    /* Port range */
+    uint16_t lo = (uint16_t)(40000 + (getpid() % 20000));
+    pool = ftp_pasv_pool_create(2U, lo, (uint16_t)(lo + 3U));
+    CHECK(pool != NULL, "create with range");
+    if (pool != NULL) {
+        fd = ftp_pasv_pool_lease(pool, LOOPBACK, &port);
+        fd2 = ftp_pasv_pool_lease(pool, LOOPBACK, &port2);
+        CHECK((fd >= 0) && (port >= lo) && (port <= lo + 3U), "port in range");
+        CHECK((fd2 >= 0) && (port2 >= lo) && (port2 <= lo + 3U) &&
+                  (port2 != port),
+              "second port in range");
+        ftp_pasv_pool_return(pool, fd);
+        ftp_pasv_pool_return(pool, fd2);
+        ftp_pasv_pool_destroy(pool);
+    }
+
+    /* No pool: a fresh listener that return() closes */
+    fd = ftp_pasv_pool_lease(NULL, LOOPBACK, &port);
+    CHECK((fd >= 0) && (port != 0U), "unpooled lease");
+    ftp_pasv_pool_return(NULL, fd);
+    CHECK(fcntl(fd, F_GETFD) < 0, "unpooled listener closed");
+
+    if (failures != 0) {
+        printf("pasv_pool: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("pasv_pool: OK\n");
+    return 0;
+}
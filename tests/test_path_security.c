@@ -39,13 +39,16 @@ int main(void)
     (void)symlink("/", linkp);
 
     ftp_session_t s;
+    static ftp_session_paths_t paths;
     memset(&s, 0, sizeof(s));
+    s.root_path = paths.root_path;
+    s.cwd = paths.cwd;
     char root_real[FTP_PATH_MAX];
     if (realpath(root, root_real) == NULL) {
         return 2;
     }
-    (void)snprintf(s.root_path, sizeof(s.root_path), "%s", root_real);
-    (void)snprintf(s.cwd, sizeof(s.cwd), "%s", root_real);
+    (void)snprintf(s.root_path, sizeof(paths.root_path), "%s", root_real);
+    (void)snprintf(s.cwd, sizeof(paths.cwd), "%s", root_real);
 
     char out[FTP_PATH_MAX];
 
@@ -67,6 +70,47 @@ int main(void)
         return 6;
     }
 
+    /* Same checks through the cwd descriptor and resolution cache */
+    s.paths = &paths;
+    ftp_path_cache_init(&paths);
+
+    if ((ftp_path_resolve(&s, "sub", out, sizeof(out)) != FTP_OK) ||
+        (ftp_path_is_within_root(out, s.root_path) != 1)) {
+        return 7;
+    }
+    if (ftp_path_resolve(&s, "out", out, sizeof(out)) != FTP_ERR_PATH_INVALID) {
+        return 8;
+    }
+    if (ftp_path_resolve(&s, "../", out, sizeof(out)) != FTP_ERR_PATH_INVALID) {
+        return 9;
+    }
+
+    /* A cached name turned into an escaping symlink is caught after
+     * the namespace change is reported */
+    char alias[FTP_PATH_MAX];
+    (void)snprintf(alias, sizeof(alias), "%s/alias", root);
+    if ((ftp_path_resolve(&s, "alias", out, sizeof(out)) != FTP_OK) ||
+        (paths.cwd_fd < 0)) {
+        return 10;
+    }
+    (void)symlink("/", alias);
+    ftp_path_cache_invalidate();
+    if (ftp_path_resolve(&s, "alias", out, sizeof(out)) != FTP_ERR_PATH_INVALID) {
+        return 11;
+    }
+
+    if ((ftp_path_resolve(&s, "sub", out, sizeof(out)) != FTP_OK) ||
+        (ftp_path_set_cwd(&s, out) != FTP_OK) || (paths.cwd_fd >= 0)) {
+        return 12;
+    }
+    if ((ftp_path_resolve(&s, "../out", out, sizeof(out)) != FTP_ERR_PATH_INVALID) ||
+        (ftp_path_resolve(&s, "..", out, sizeof(out)) != FTP_OK) ||
+        (strcmp(out, s.root_path) != 0)) {
+        return 13;
+    }
+    ftp_path_cache_release(&paths);
+
+    unlink(alias);
     unlink(linkp);
     rmdir(sub);
     rmdir(root);
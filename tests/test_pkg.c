@@ -0,0 +1,248 @@
+#include "pkg_unpacker.h"
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define TABLE_OFF   0x2000U
+#define NUM_FILLER  300U
+#define FAR_OFF     (PKG_MAP_WINDOW + 0x10000U)
+#define NAMES_OFF   0x1A000U
+
+static const char names[] = "\0../evil\0..\0";
+
+static uint8_t img[0x20000];
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void put_entry(uint32_t i, uint32_t id, uint32_t flags1,
+                      uint32_t off, uint32_t size)
+{
+    uint8_t *e = img + TABLE_OFF + (i * PKG_ENTRY_RECORD_SIZE);
+    put_be32(e, id);
+    put_be32(e + 8, flags1);
+    put_be32(e + 16, off);
+    put_be32(e + 20, size);
+}
+
+/*
+ * Synthetic PKG: NUM_FILLER dummy entries plus param.sfo, icon0.png (and a
+ * duplicate id behind it), an encrypted pic0, pic1 past the mapped window
+ * and a name table naming two fillers.  The file is sparse up to FAR_OFF.
+ */
+static void build_pkg(const char *path)
+{
+    uint32_t n = 0U;
+
+    memset(img, 0, sizeof(img));
+    put_be32(img, PKG_MAGIC_CNT);
+    memcpy(img + 0x40, "UP0000-CUSA00001_00-0000000000000001", 36);
+    for (uint32_t i = 0U; i < NUM_FILLER; i++) {
+        put_entry(n++, 0x2000U + i, 0U, 0x10000U, 16U);
+    }
+    put_entry(n++, PKG_ENTRY_ID_PARAM_SFO, 0U, 0x10000U, 64U);
+    put_entry(n++, PKG_ENTRY_ID_ICON0_PNG, 0U, 0x11000U, 0x8000U);
+    put_entry(n++, PKG_ENTRY_ID_ICON0_PNG, 0U, 0x10000U, 8U);
+    put_entry(n++, PKG_ENTRY_ID_PIC0_PNG, PKG_ENTRY_FLAG_ENCRYPTED,
+              0x10000U, 8U);
+    put_entry(n++, PKG_ENTRY_ID_PIC1_PNG, 0U, FAR_OFF, 4096U);
+    put_entry(n++, PKG_ENTRY_ID_ENTRY_NAMES, 0U, NAMES_OFF, sizeof(names));
+    put_be32(img + TABLE_OFF + 4, 1U);                          /* filler 0 */
+    put_be32(img + TABLE_OFF + PKG_ENTRY_RECORD_SIZE + 4, 9U);  /* filler 1 */
+    memcpy(img + NAMES_OFF, names, sizeof(names));
+    put_be32(img + 0x10, n);
+    put_be32(img + 0x18, TABLE_OFF);
+
+    memcpy(img + 0x10000, "\0PSF param-sfo-bytes", 20);
+    for (uint32_t i = 0U; i < 0x8000U; i++) {
+        img[0x11000U + i] = (uint8_t)(i * 7U);
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0, "create pkg");
+    CHECK(write(fd, img, sizeof(img)) == (ssize_t)sizeof(img), "write pkg");
+    uint8_t far[4096];
+    memset(far, 0xA5, sizeof(far));
+    CHECK(pwrite(fd, far, sizeof(far), (off_t)FAR_OFF) == (ssize_t)sizeof(far),
+          "write far entry");
+    close(fd);
+}
+
+static atomic_uint_fast64_t progressed;
+
+static void on_progress(void *user, uint64_t bytes)
+{
+    (void)user;
+    atomic_fetch_add(&progressed, bytes);
+}
+
+static int file_matches(const char *path, const uint8_t *want, size_t len)
+{
+    static uint8_t got[0x10000];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t n = read(fd, got, sizeof(got));
+    close(fd);
+    return (n == (ssize_t)len) && (memcmp(got, want, len) == 0);
+}
+
+int main(void)
+{
+    char path[] = "/tmp/zftpd-pkg-XXXXXX";
+    int tmp = mkstemp(path);
+    CHECK(tmp >= 0, "mkstemp");
+    close(tmp);
+    build_pkg(path);
+
+    pkg_context_t ctx;
+    CHECK(pkg_init(&ctx, path) == PKG_OK, "init");
+    CHECK(ctx.num_entries == NUM_FILLER + 6U, "entry count");
+    CHECK(strcmp(ctx.header.content_id,
+                 "UP0000-CUSA00001_00-0000000000000001") == 0, "content id");
+    CHECK(ctx.map != NULL, "window mapped");
+
+    /* Hashed lookup: every filler id, the named ids, a miss */
+    int all = 1;
+    for (uint32_t i = 0U; i < NUM_FILLER; i++) {
+        const pkg_entry_t *e = pkg_find_entry_by_id(&ctx, 0x2000U + i);
+        all &= (e != NULL) && (e->id == 0x2000U + i);
+    }
+    CHECK(all, "filler lookups");
+    CHECK(pkg_find_entry_by_id(&ctx, 0x1234U) == NULL, "missing id");
+    const pkg_entry_t *icon = pkg_find_entry_by_id(&ctx, PKG_ENTRY_ID_ICON0_PNG);
+    CHECK((icon != NULL) && (icon->size == 0x8000U), "duplicate: first wins");
+
+    /* Zero-copy views inside the window */
+    const pkg_entry_t *sfo = pkg_find_entry_by_id(&ctx, PKG_ENTRY_ID_PARAM_SFO);
+    const uint8_t *data = NULL;
+    CHECK(pkg_entry_view(&ctx, sfo, &data) == 64, "sfo view");
+    CHECK((data == ctx.map + 0x10000U) &&
+          (memcmp(data, "\0PSF param-sfo-bytes", 20) == 0), "sfo in place");
+    CHECK(pkg_entry_view(&ctx, icon, &data) == 0x8000, "icon view");
+    CHECK((data != NULL) && (memcmp(data, img + 0x11000, 0x8000U) == 0),
+          "icon bytes");
+
+    const pkg_entry_t *enc = pkg_find_entry_by_id(&ctx, PKG_ENTRY_ID_PIC0_PNG);
+    CHECK(pkg_entry_view(&ctx, enc, &data) == PKG_ERR_ENCRYPTED, "enc view");
+    CHECK(data == NULL, "enc view cleared");
+
+    /* Past the window: no view, pread extraction still works */
+    const pkg_entry_t *far = pkg_find_entry_by_id(&ctx, PKG_ENTRY_ID_PIC1_PNG);
+    CHECK(pkg_entry_view(&ctx, far, &data) == PKG_ERR_UNMAPPED, "far unmapped");
+    uint8_t buf[0x8000];
+    CHECK(pkg_extract_to_buffer(&ctx, far, buf, sizeof(buf)) == 4096, "far");
+    CHECK((buf[0] == 0xA5U) && (buf[4095] == 0xA5U), "far bytes");
+    CHECK(pkg_extract_to_buffer(&ctx, icon, buf, 100U) == PKG_ERR_BUFFER_SMALL,
+          "small buffer");
+    CHECK(pkg_extract_to_buffer(&ctx, icon, buf, sizeof(buf)) == 0x8000,
+          "icon copy");
+    CHECK(memcmp(buf, img + 0x11000, 0x8000U) == 0, "icon copy bytes");
+
+    /* Streaming extraction */
+    char out[] = "/tmp/zftpd-pkg-out-XXXXXX";
+    int ofd = mkstemp(out);
+    CHECK(ofd >= 0, "mkstemp out");
+    CHECK(pkg_extract_file_fd(&ctx, icon, ofd) == PKG_OK, "extract fd");
+    CHECK(pkg_extract_file_fd(&ctx, far, ofd) == PKG_OK, "extract far fd");
+    CHECK(pread(ofd, buf, 0x8000U, 0) == 0x8000, "read back");
+    CHECK(memcmp(buf, img + 0x11000, 0x8000U) == 0, "fd bytes");
+    CHECK(lseek(ofd, 0, SEEK_END) == (off_t)(0x8000U + 4096U), "fd size");
+    close(ofd);
+    unlink(out);
+
+    /* Names: table, sanitised table, well-known id, hex fallback */
+    char name[PKG_ENTRY_NAME_MAX];
+    CHECK((pkg_entry_name(&ctx, &ctx.entries[0], name, sizeof(name)) == PKG_OK)
+          && (strcmp(name, ".._evil") == 0), "table name sanitised");
+    CHECK((pkg_entry_name(&ctx, &ctx.entries[1], name, sizeof(name)) == PKG_OK)
+          && (strcmp(name, "00002001.bin") == 0), "'..' replaced");
+    CHECK((pkg_entry_name(&ctx, &ctx.entries[2], name, sizeof(name)) == PKG_OK)
+          && (strcmp(name, "00002002.bin") == 0), "hex name");
+    CHECK((pkg_entry_name(&ctx, sfo, name, sizeof(name)) == PKG_OK) &&
+          (strcmp(name, "param.sfo") == 0), "known name");
+    CHECK(pkg_entry_name(&ctx, sfo, name, 4U) == PKG_ERR_BUFFER_SMALL,
+          "short name buffer");
+
+    /* Batch: mapped, far (kernel or pread copy) and encrypted items */
+    char dir[] = "/tmp/zftpd-pkg-dir-XXXXXX";
+    CHECK(mkdtemp(dir) != NULL, "mkdtemp");
+    char p_icon[64], p_sfo[64], p_far[64], p_enc[64];
+    snprintf(p_icon, sizeof(p_icon), "%s/icon0.png", dir);
+    snprintf(p_sfo, sizeof(p_sfo), "%s/param.sfo", dir);
+    snprintf(p_far, sizeof(p_far), "%s/pic1.png", dir);
+    snprintf(p_enc, sizeof(p_enc), "%s/pic0.png", dir);
+    pkg_batch_item_t items[4] = {
+        {far, p_far, 0}, {icon, p_icon, 0}, {enc, p_enc, 0}, {sfo, p_sfo, 0},
+    };
+    int rc = pkg_extract_batch(&ctx, items, 4U, 3U, on_progress, NULL, NULL);
+    CHECK(rc == PKG_ERR_ENCRYPTED, "batch reports the encrypted item");
+    CHECK((items[0].result == PKG_OK) && (items[1].result == PKG_OK) &&
+          (items[3].result == PKG_OK), "batch items");
+    CHECK(items[2].result == PKG_ERR_ENCRYPTED, "encrypted item");
+    CHECK(access(p_enc, F_OK) != 0, "no file for the encrypted item");
+    CHECK(file_matches(p_icon, img + 0x11000, 0x8000U), "batch icon");
+    CHECK(file_matches(p_sfo, img + 0x10000, 64U), "batch sfo");
+    memset(buf, 0xA5, 4096U);
+    CHECK(file_matches(p_far, buf, 4096U), "batch far");
+    CHECK(atomic_load(&progressed) == 0x8000U + 64U + 4096U, "progress");
+
+    volatile int stop = 1;
+    items[1].result = PKG_OK;
+    unlink(p_icon);
+    CHECK(pkg_extract_batch(&ctx, &items[1], 1U, 0U, NULL, NULL, &stop) ==
+          PKG_ERR_CANCELLED, "cancelled batch");
+    CHECK(items[1].result == PKG_ERR_CANCELLED, "cancelled item");
+    CHECK(access(p_icon, F_OK) != 0, "nothing written when cancelled");
+    CHECK(pkg_extract_batch(&ctx, NULL, 0U, 0U, NULL, NULL, NULL) == PKG_OK,
+          "empty batch");
+
+    unlink(p_sfo);
+    unlink(p_far);
+    rmdir(dir);
+
+    pkg_cleanup(&ctx);
+    CHECK((ctx.fd == -1) && (ctx.map == NULL) && (ctx.index == NULL),
+          "cleanup");
+    pkg_cleanup(&ctx);
+
+    /* Corrupt: entry past EOF */
+    put_entry(0U, 0x2000U, 0U, 0xFFFFFF00U, 0x1000U);
+    int fd = open(path, O_WRONLY);
+    CHECK(pwrite(fd, img + TABLE_OFF, 32U, TABLE_OFF) == 32, "corrupt");
+    close(fd);
+    CHECK(pkg_init(&ctx, path) == PKG_ERR_FORMAT, "entry past EOF");
+    pkg_cleanup(&ctx);
+
+    CHECK(pkg_init(&ctx, "/nonexistent/x.pkg") == PKG_ERR_IO, "missing file");
+    pkg_cleanup(&ctx);
+
+    unlink(path);
+
+    if (failures != 0) {
+        printf("pkg: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("pkg: OK\n");
+    return 0;
+}
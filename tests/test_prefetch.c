@@ -0,0 +1,207 @@
+#include "ftp_list.h"
+#include "ftp_metrics.h"
+#include "ftp_prefetch.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define FILES 8U
+#define FILE_BYTES (64U * 1024U)
+#define MB (1024U * 1024U)
+
+static char g_dir[64];
+static char g_other[96];
+
+static void write_file(const char *path, size_t len)
+{
+    static char buf[FILE_BYTES];
+    memset(buf, 'p', sizeof(buf));
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        failures++;
+        return;
+    }
+    if (len > sizeof(buf)) {
+        (void)ftruncate(fd, (off_t)len); /* sparse */
+    } else if (write(fd, buf, len) != (ssize_t)len) {
+        failures++;
+    }
+    close(fd);
+}
+
+/* Regular, non-empty entries of g_dir in listing order */
+static size_t listing_order(char names[][32], size_t max)
+{
+    ftp_list_snapshot_t snap;
+    size_t n = 0U;
+    if (ftp_list_snapshot(g_dir, &snap) != FTP_OK) {
+        return 0U;
+    }
+    for (size_t i = 0U; (i < snap.count) && (n < max); i++) {
+        const vfs_stat_t *st = ftp_list_snapshot_stat(&snap, i);
+        if (((st->mode & S_IFMT) == S_IFREG) && (st->size > 0U)) {
+            snprintf(names[n++], 32, "%s", ftp_list_snapshot_name(&snap, i));
+        }
+    }
+    ftp_list_snapshot_release(&snap);
+    return n;
+}
+
+static void retr(ftp_session_t *s, const char *name)
+{
+    char path[128];
+    snprintf(path, sizeof(path), "%s/%s", g_dir, name);
+    ftp_prefetch_retr(s, path);
+}
+
+static uint64_t counter(ftp_metric_counter_t c)
+{
+    return ftp_metrics_counter(c);
+}
+
+static void test_listing_order(void)
+{
+    static ftp_session_t s;
+    char order[FILES][32];
+    CHECK(listing_order(order, FILES) == FILES, "listing");
+
+    uint64_t files0 = counter(FTP_METRIC_PREFETCH_FILES);
+    uint64_t bytes0 = counter(FTP_METRIC_PREFETCH_BYTES);
+    uint64_t hits0 = counter(FTP_METRIC_PREFETCH_HITS);
+    uint64_t cancel0 = counter(FTP_METRIC_PREFETCH_CANCELLED);
+
+    ftp_prefetch_listing(&s, g_dir);
+    CHECK(s.prefetch != NULL, "tracker attached");
+
+    retr(&s, order[0]);
+    ftp_prefetch_quiesce();
+    CHECK(ftp_prefetch_budget_used() == 0U, "one RETR is no pattern");
+
+    retr(&s, order[1]);
+    CHECK(ftp_prefetch_budget_used() ==
+              (uint64_t)FTP_PREFETCH_FILES * FILE_BYTES,
+          "next files reserved");
+    ftp_prefetch_quiesce();
+    CHECK(counter(FTP_METRIC_PREFETCH_FILES) - files0 == FTP_PREFETCH_FILES,
+          "files warmed");
+    CHECK(counter(FTP_METRIC_PREFETCH_BYTES) - bytes0 ==
+              (uint64_t)FTP_PREFETCH_FILES * FILE_BYTES,
+          "bytes warmed");
+
+    /* The predicted file arrives: hit, one more queued behind */
+    retr(&s, order[2]);
+    ftp_prefetch_quiesce();
+    CHECK(counter(FTP_METRIC_PREFETCH_HITS) - hits0 == 1U, "hit");
+    CHECK(counter(FTP_METRIC_PREFETCH_FILES) - files0 ==
+              FTP_PREFETCH_FILES + 1U,
+          "window moved");
+    CHECK(ftp_prefetch_budget_used() ==
+              (uint64_t)FTP_PREFETCH_FILES * FILE_BYTES,
+          "budget follows the window");
+
+    /* A file from elsewhere breaks the pattern */
+    char other[160];
+    snprintf(other, sizeof(other), "%s/x", g_other);
+    ftp_prefetch_retr(&s, other);
+    CHECK(ftp_prefetch_budget_used() == 0U, "budget returned");
+    CHECK(counter(FTP_METRIC_PREFETCH_CANCELLED) - cancel0 ==
+              FTP_PREFETCH_FILES,
+          "predictions cancelled");
+
+    /* Skipping ahead is not the next file either */
+    retr(&s, order[0]);
+    retr(&s, order[1]);
+    retr(&s, order[3]);
+    CHECK(ftp_prefetch_budget_used() == 0U, "skip breaks the pattern");
+
+    ftp_prefetch_session_end(&s);
+    CHECK(s.prefetch == NULL, "tracker detached");
+    ftp_prefetch_quiesce();
+}
+
+static void test_name_order(void)
+{
+    static ftp_session_t s;
+    ftp_prefetch_listing(&s, g_dir);
+    retr(&s, "f0");
+    retr(&s, "f1");
+    CHECK(ftp_prefetch_budget_used() ==
+              (uint64_t)FTP_PREFETCH_FILES * FILE_BYTES,
+          "name order followed");
+
+    /* A new listing drops what the old one predicted */
+    ftp_prefetch_listing(&s, g_other);
+    CHECK(ftp_prefetch_budget_used() == 0U, "relisting cancels");
+    ftp_prefetch_session_end(&s);
+    ftp_prefetch_quiesce();
+}
+
+static void test_file_cap(void)
+{
+    static ftp_session_t s;
+    char path[160];
+    for (unsigned i = 0U; i < 3U; i++) {
+        snprintf(path, sizeof(path), "%s/z%u", g_other, i);
+        write_file(path, 20U * MB);
+    }
+    ftp_prefetch_listing(&s, g_other);
+    snprintf(path, sizeof(path), "%s/z0", g_other);
+    ftp_prefetch_retr(&s, path);
+    snprintf(path, sizeof(path), "%s/z1", g_other);
+    ftp_prefetch_retr(&s, path);
+    CHECK(ftp_prefetch_budget_used() == (uint64_t)FTP_PREFETCH_FILE_MB * MB,
+          "only the head is reserved");
+    ftp_prefetch_session_end(&s);
+    CHECK(ftp_prefetch_budget_used() == 0U, "session end returns it");
+    ftp_prefetch_quiesce();
+}
+
+int main(void)
+{
+#if !FTP_PREFETCH_ENABLE
+    printf("prefetch: skipped (FTP_PREFETCH_ENABLE=0)\n");
+    return 0;
+#else
+    snprintf(g_dir, sizeof(g_dir), "/tmp/zftpd-pf-%d", (int)getpid());
+    snprintf(g_other, sizeof(g_other), "%s/sub", g_dir);
+    (void)mkdir(g_dir, 0755);
+    (void)mkdir(g_other, 0755);
+
+    char path[128];
+    for (unsigned i = 0U; i < FILES; i++) {
+        snprintf(path, sizeof(path), "%s/f%u", g_dir, i);
+        write_file(path, FILE_BYTES);
+    }
+    snprintf(path, sizeof(path), "%s/empty", g_dir);
+    write_file(path, 0U);
+
+    test_listing_order();
+    test_name_order();
+    test_file_cap();
+    ftp_prefetch_shutdown();
+
+    char cmd[160];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", g_dir);
+    (void)system(cmd);
+
+    if (failures != 0) {
+        printf("prefetch: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("prefetch: OK\n");
+    return 0;
+#endif
+}
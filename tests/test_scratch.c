@@ -1,31 +1,105 @@
 #include "pal_scratch.h"
 #include <stdint.h>
- 
-int main(void)
+#include <string.h>
+
+static int test_slots(void)
 {
-    uint8_t *p1 = NULL;
+    uint8_t *slot[PAL_SCRATCH_SLOTS];
     uint8_t *p2 = NULL;
- 
-    if (pal_scratch_acquire(&p1, 16U) != 0) {
-        return 1;
-    }
-    if (p1 == NULL) {
-        return 2;
+
+    for (unsigned i = 0U; i < PAL_SCRATCH_SLOTS; i++) {
+        if (pal_scratch_acquire(&slot[i], 16U) != 0) {
+            return 1;
+        }
+        if ((slot[i] == NULL) || ((i > 0U) && (slot[i] == slot[i - 1U]))) {
+            return 2;
+        }
     }
- 
+
     if (pal_scratch_acquire(&p2, 16U) == 0) {
         return 3;
     }
- 
-    pal_scratch_release(p1);
- 
-    if (pal_scratch_acquire(&p2, 16U) != 0) {
+
+    /* Every slot busy: get() falls back to the heap and counts it */
+    pal_scratch_stats_t st;
+    pal_scratch_get_stats(&st);
+    uint8_t *heap = pal_scratch_get(4096U);
+    pal_scratch_stats_t st2;
+    pal_scratch_get_stats(&st2);
+    if ((heap == NULL) || (st2.fallbacks != st.fallbacks + 1U) ||
+        (st2.slots_in_use != PAL_SCRATCH_SLOTS)) {
         return 4;
     }
-    if (p2 == NULL) {
+    memset(heap, 0xA5, 4096U);
+    pal_scratch_put(heap);
+
+    pal_scratch_release(slot[0]);
+
+    if (pal_scratch_acquire(&p2, 16U) != 0) {
         return 5;
     }
+    if (p2 != slot[0]) {
+        return 6;
+    }
     pal_scratch_release(p2);
- 
+    for (unsigned i = 1U; i < PAL_SCRATCH_SLOTS; i++) {
+        pal_scratch_release(slot[i]);
+    }
+
+    uint8_t *big = pal_scratch_get(pal_scratch_capacity());
+    if (big != slot[0]) {
+        return 7;
+    }
+    pal_scratch_put(big);
+    return 0;
+}
+
+static int test_arena(void)
+{
+    pal_scratch_mark_t outer = pal_scratch_mark();
+    uint8_t *a = pal_scratch_alloc(100U);
+    if ((a == NULL) || (((uintptr_t)a & 15U) != 0U)) {
+        return 10;
+    }
+    memset(a, 1, 100U);
+
+    pal_scratch_mark_t inner = pal_scratch_mark();
+    uint8_t *b = pal_scratch_alloc(64U);
+    if ((b == NULL) || (b < a + 100U)) {
+        return 11;
+    }
+
+    /* Larger than the arena: spills to the heap until the reset */
+    pal_scratch_stats_t st;
+    pal_scratch_get_stats(&st);
+    uint8_t *spill = pal_scratch_alloc(PAL_SCRATCH_ARENA_SIZE + 1U);
+    if (spill == NULL) {
+        return 12;
+    }
+    memset(spill, 2, PAL_SCRATCH_ARENA_SIZE + 1U);
+    pal_scratch_stats_t st2;
+    pal_scratch_get_stats(&st2);
+    if ((st2.fallbacks != st.fallbacks + 1U) || (st2.arenas != 1U)) {
+        return 13;
+    }
+
+    pal_scratch_reset(inner);
+    if ((pal_scratch_alloc(64U) != b) || (a[99] != 1U)) {
+        return 14;
+    }
+    pal_scratch_reset(outer);
+    if (pal_scratch_alloc(16U) != a) {
+        return 15;
+    }
+    pal_scratch_reset(outer);
     return 0;
 }
+
+int main(void)
+{
+    int rc = test_slots();
+    if (rc != 0) {
+        return rc;
+    }
+    return test_arena();
+}
@@ -0,0 +1,296 @@
+#include "ftp_metrics.h"
+#include "ftp_segment.h"
+#include "pal_fileio.h"
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define SEG_BYTES 4096U
+
+static char g_dir[64];
+static ftp_session_t g_s1;
+static ftp_session_t g_s2;
+static ftp_session_t g_s3;
+
+static off_t file_size(const char *path)
+{
+    struct stat st;
+    return (stat(path, &st) == 0) ? st.st_size : -1;
+}
+
+/* Segment k is SEG_BYTES of 'a' + k at offset k * SEG_BYTES */
+static void put_segment(int fd, unsigned k)
+{
+    char buf[SEG_BYTES];
+    memset(buf, 'a' + (int)k, sizeof(buf));
+    if (pwrite(fd, buf, sizeof(buf), (off_t)k * SEG_BYTES) !=
+        (ssize_t)sizeof(buf)) {
+        failures++;
+    }
+}
+
+static int segment_intact(const char *path, unsigned k)
+{
+    char buf[SEG_BYTES];
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t n = pread(fd, buf, sizeof(buf), (off_t)k * SEG_BYTES);
+    close(fd);
+    if (n != (ssize_t)sizeof(buf)) {
+        return 0;
+    }
+    for (size_t i = 0U; i < sizeof(buf); i++) {
+        if (buf[i] != (char)('a' + (int)k)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* What cmd_STOR does as the first stream of a fresh atomic upload */
+static int open_first(ftp_segment_t *seg, const char *tmp)
+{
+    int fd = pal_file_open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ftp_segment_stor_opened(seg, fd, tmp, 1, 1);
+    return fd;
+}
+
+static void test_upload(void)
+{
+    char path[128];
+    char tmp[160];
+    snprintf(path, sizeof(path), "%s/up.bin", g_dir);
+    snprintf(tmp, sizeof(tmp), "%s/.zftpd.tmp.up.bin", g_dir);
+    uint64_t files0 = ftp_metrics_counter(FTP_METRIC_SEGMENT_FILES);
+    uint64_t joins0 = ftp_metrics_counter(FTP_METRIC_SEGMENT_JOINS);
+
+    static ftp_segment_t a;
+    static ftp_segment_t b;
+    static ftp_segment_t c;
+    CHECK(ftp_segment_stor_begin(&g_s1, path, &a) == FTP_SEGMENT_FIRST,
+          "first stream opens");
+    int fd = open_first(&a, tmp);
+    CHECK(fd >= 0, "open");
+    CHECK(ftp_segment_reserve(&a, 8U * SEG_BYTES) != FTP_ERR_FILE_WRITE,
+          "reserve");
+
+    CHECK(ftp_segment_stor_begin(&g_s2, path, &b) == FTP_SEGMENT_JOINED,
+          "second joins");
+    CHECK((b.fd == fd) && (b.own_fd == 0), "same fd");
+    CHECK(strcmp(b.write_path, tmp) == 0, "same temp name");
+    CHECK(b.atomic == 1, "atomic inherited");
+    CHECK(ftp_segment_stor_begin(&g_s3, path, &c) == FTP_SEGMENT_JOINED,
+          "third joins");
+    CHECK(ftp_metrics_counter(FTP_METRIC_SEGMENT_FILES) == files0 + 1U,
+          "one segmented file");
+    CHECK(ftp_metrics_counter(FTP_METRIC_SEGMENT_JOINS) == joins0 + 2U,
+          "two joins");
+    CHECK(ftp_segment_direct_begin(&a) == 0, "no O_DIRECT while shared");
+
+    /* Progress: the session counters, summed per file */
+    put_segment(fd, 0U);
+    put_segment(b.fd, 1U);
+    put_segment(c.fd, 2U);
+    atomic_fetch_add(&g_s1.stats.bytes_received, SEG_BYTES);
+    atomic_fetch_add(&g_s2.stats.bytes_received, SEG_BYTES);
+    atomic_fetch_add(&g_s3.stats.bytes_received, SEG_BYTES);
+    ftp_segment_info_t info[4];
+    CHECK(ftp_segment_snapshot(info, 4U) == 1U, "one file in transfer");
+    CHECK(strcmp(info[0].path, path) == 0, "its path");
+    CHECK((info[0].upload == 1) && (info[0].streams == 3U), "three streams");
+    CHECK(info[0].bytes == 3U * SEG_BYTES, "bytes of all streams");
+    CHECK(info[0].size == 8U * SEG_BYTES, "reserved size");
+
+    /* The first stream ends first: nothing is committed yet */
+    ftp_segment_end_t res;
+    ftp_segment_stor_end(&b, 1, 2 * (off_t)SEG_BYTES, &res);
+    CHECK((res.fd == -1) && (res.rename == 0), "not last");
+    ftp_segment_stor_end(&a, 1, (off_t)SEG_BYTES, &res);
+    CHECK(res.fd == -1, "first is not last either");
+    CHECK(file_size(path) < 0, "final name not there yet");
+    CHECK(ftp_segment_snapshot(info, 4U) == 1U, "still in transfer");
+    CHECK((info[0].streams == 1U) && (info[0].peak == 3U), "one left");
+    CHECK(info[0].bytes == 3U * SEG_BYTES, "left streams still counted");
+
+    ftp_segment_stor_end(&c, 1, 3 * (off_t)SEG_BYTES, &res);
+    CHECK(res.fd == fd, "last gets the fd");
+    CHECK((res.segmented == 1) && (res.failed == 0), "segmented, ok");
+    CHECK((res.rename == 1) && (res.discard == 0), "commit by rename");
+    CHECK(file_size(tmp) == 3 * (off_t)SEG_BYTES, "reserved tail trimmed");
+    pal_file_close(res.fd);
+    CHECK(rename(tmp, path) == 0, "rename");
+    CHECK(segment_intact(path, 0U) && segment_intact(path, 1U) &&
+              segment_intact(path, 2U),
+          "every segment in place");
+    CHECK(ftp_segment_snapshot(info, 4U) == 0U, "table empty");
+}
+
+static void test_failures(void)
+{
+    char path[128];
+    char tmp[160];
+    static ftp_segment_t a;
+    static ftp_segment_t b;
+    ftp_segment_end_t res;
+    snprintf(path, sizeof(path), "%s/fail.bin", g_dir);
+    snprintf(tmp, sizeof(tmp), "%s/.zftpd.tmp.fail.bin", g_dir);
+
+    /* One stream failing alone: a fresh upload is discarded */
+    CHECK(ftp_segment_stor_begin(&g_s1, path, &a) == FTP_SEGMENT_FIRST,
+          "single: first");
+    (void)open_first(&a, tmp);
+    ftp_segment_stor_end(&a, 0, 100, &res);
+    CHECK((res.fd >= 0) && (res.discard == 1) && (res.rename == 0),
+          "single failure discarded");
+    pal_file_close(res.fd);
+
+    /* With another stream, the file is kept for a REST retry */
+    CHECK(ftp_segment_stor_begin(&g_s1, path, &a) == FTP_SEGMENT_FIRST,
+          "multi: first");
+    int fd = open_first(&a, tmp);
+    CHECK(ftp_segment_stor_begin(&g_s2, path, &b) == FTP_SEGMENT_JOINED,
+          "multi: join");
+    put_segment(fd, 0U);
+    put_segment(fd, 1U);
+    ftp_segment_stor_end(&b, 0, (off_t)SEG_BYTES + 10, &res);
+    CHECK(res.fd == -1, "failed joiner is not last");
+    ftp_segment_stor_end(&a, 1, (off_t)SEG_BYTES, &res);
+    CHECK((res.failed == 1) && (res.segmented == 1), "group failed");
+    CHECK((res.discard == 0) && (res.rename == 1), "kept and renamed");
+    CHECK(file_size(tmp) == (off_t)SEG_BYTES + 10, "ends at the furthest");
+    pal_file_close(res.fd);
+    (void)unlink(tmp);
+
+    /* A failed open hands the file to the next STOR */
+    CHECK(ftp_segment_stor_begin(&g_s1, path, &a) == FTP_SEGMENT_FIRST,
+          "open fails: first");
+    ftp_segment_stor_opened(&a, -1, tmp, 1, 1);
+    CHECK(ftp_segment_stor_begin(&g_s2, path, &b) == FTP_SEGMENT_FIRST,
+          "next STOR opens itself");
+    ftp_segment_stor_opened(&b, -1, tmp, 1, 1);
+}
+
+static void test_direct(void)
+{
+    char path[128];
+    static ftp_segment_t a;
+    static ftp_segment_t b;
+    ftp_segment_end_t res;
+    snprintf(path, sizeof(path), "%s/direct.bin", g_dir);
+
+    CHECK(ftp_segment_stor_begin(&g_s1, path, &a) == FTP_SEGMENT_FIRST,
+          "direct: first");
+    int fd = pal_file_open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ftp_segment_stor_opened(&a, fd, path, 0, 1);
+    CHECK(ftp_segment_direct_begin(&a) == 1, "alone: O_DIRECT allowed");
+
+    /* The shared open file is O_DIRECT: the joiner gets its own */
+    CHECK(ftp_segment_stor_begin(&g_s2, path, &b) == FTP_SEGMENT_JOINED,
+          "direct: join");
+    CHECK((b.own_fd == 1) && (b.fd >= 0) && (b.fd != fd), "private fd");
+    CHECK(ftp_segment_direct_begin(&b) == 0, "joiner never O_DIRECT");
+    ftp_segment_direct_end(&a);
+
+    ftp_segment_stor_end(&b, 1, (off_t)SEG_BYTES, &res);
+    CHECK(res.fd == -1, "private fd closed by its stream");
+    ftp_segment_stor_end(&a, 1, (off_t)SEG_BYTES, &res);
+    CHECK((res.fd == fd) && (res.rename == 0), "non-atomic: no rename");
+    pal_file_close(res.fd);
+}
+
+static ftp_segment_role_t g_waiter_role;
+
+static void *waiter(void *arg)
+{
+    static ftp_segment_t w;
+    ftp_segment_end_t res;
+    g_waiter_role = ftp_segment_stor_begin(&g_s2, (const char *)arg, &w);
+    ftp_segment_stor_end(&w, 1, -1, &res);
+    return NULL;
+}
+
+static void test_opening_wait(void)
+{
+    char path[128];
+    static ftp_segment_t a;
+    ftp_segment_end_t res;
+    snprintf(path, sizeof(path), "%s/slow.bin", g_dir);
+
+    CHECK(ftp_segment_stor_begin(&g_s1, path, &a) == FTP_SEGMENT_FIRST,
+          "slow: first");
+    g_waiter_role = FTP_SEGMENT_ALONE;
+    pthread_t tid;
+    pthread_create(&tid, NULL, waiter, path);
+    usleep(100000);
+    CHECK(g_waiter_role == FTP_SEGMENT_ALONE, "waits for the open");
+
+    int fd = pal_file_open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ftp_segment_stor_opened(&a, fd, path, 0, 1);
+    pthread_join(tid, NULL);
+    CHECK(g_waiter_role == FTP_SEGMENT_JOINED, "then joins");
+    ftp_segment_stor_end(&a, 1, 0, &res);
+    CHECK(res.fd == fd, "first is last");
+    pal_file_close(res.fd);
+}
+
+static void test_download(void)
+{
+    static ftp_segment_t a;
+    static ftp_segment_t b;
+    ftp_segment_info_t info[2];
+    uint64_t files0 = ftp_metrics_counter(FTP_METRIC_SEGMENT_FILES);
+
+    ftp_segment_retr_begin(&g_s1, "/x/big.iso", 1000000U, &a);
+    ftp_segment_retr_begin(&g_s2, "/x/big.iso", 1000000U, &b);
+    CHECK(ftp_metrics_counter(FTP_METRIC_SEGMENT_FILES) == files0 + 1U,
+          "pget counted");
+    atomic_fetch_add(&g_s1.stats.bytes_sent, 300U);
+    atomic_fetch_add(&g_s2.stats.bytes_sent, 200U);
+    atomic_fetch_add(&g_s2.stats.bytes_received, 999U); /* not a download */
+    CHECK(ftp_segment_snapshot(info, 2U) == 1U, "one download");
+    CHECK((info[0].upload == 0) && (info[0].streams == 2U), "two streams");
+    CHECK((info[0].bytes == 500U) && (info[0].size == 1000000U),
+          "download progress");
+    ftp_segment_retr_end(&a);
+    ftp_segment_retr_end(&b);
+    CHECK(ftp_segment_snapshot(info, 2U) == 0U, "download done");
+}
+
+int main(void)
+{
+    snprintf(g_dir, sizeof(g_dir), "/tmp/zftpd-seg-%d", (int)getpid());
+    (void)mkdir(g_dir, 0755);
+
+    test_upload();
+    test_failures();
+    test_direct();
+    test_opening_wait();
+    test_download();
+
+    char cmd[96];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", g_dir);
+    (void)system(cmd);
+
+    if (failures != 0) {
+        printf("segment: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("segment: OK\n");
+    return 0;
+}
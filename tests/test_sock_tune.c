@@ -0,0 +1,162 @@
+#include "ftp_config.h"
+#include "pal_network.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define KB 1024U
+#define MB (1024U * 1024U)
+
+/* Twice the bandwidth-delay product */
+static uint32_t bdp2(uint64_t rate_bps, uint32_t rtt_us)
+{
+    return (uint32_t)(2U * ((rate_bps * rtt_us) / 1000000U));
+}
+
+/* Connected loopback pair; returns the client side, *peer the server side */
+static int loopback_pair(int *peer)
+{
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a;
+    socklen_t len = (socklen_t)sizeof(a);
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((lfd < 0) || (bind(lfd, (struct sockaddr *)&a, len) != 0) ||
+        (listen(lfd, 1) != 0) ||
+        (getsockname(lfd, (struct sockaddr *)&a, &len) != 0)) {
+        return -1;
+    }
+    int c = socket(AF_INET, SOCK_STREAM, 0);
+    if ((c < 0) || (connect(c, (struct sockaddr *)&a, len) != 0)) {
+        close(lfd);
+        return -1;
+    }
+    *peer = accept(lfd, NULL, NULL);
+    close(lfd);
+    return c;
+}
+
+int main(void)
+{
+    /* --- Pure policy ---------------------------------------------------- */
+    pal_sock_limits_t lim = {0U, 64U * MB, 0};
+    pal_tcp_info_t info;
+    memset(&info, 0, sizeof(info));
+
+    /* LAN: 0.2 ms at 100 MB/s is a 20 KB BDP, far under a 256 KB buffer */
+    info.rtt_us = 200U;
+    info.inflight_bytes = 64U * KB;
+    CHECK(pal_sock_tune_target(&info, 100U * MB, 0U, 256U * KB, &lim) == 0U,
+          "LAN holds");
+
+    /* WAN, buffer-bound: in flight = buffer, so the target doubles */
+    info.rtt_us = 80000U;
+    info.inflight_bytes = 256U * KB;
+    CHECK(pal_sock_tune_target(&info, 3U * MB, 0U, 256U * KB, &lim) ==
+              512U * KB,
+          "buffer-bound WAN doubles");
+
+    /* A large rate x RTT product wins over in flight */
+    CHECK(pal_sock_tune_target(&info, 10U * MB, 0U, 256U * KB, &lim) ==
+              bdp2(10U * MB, 80000U),
+          "rate x rtt drives the target");
+
+    CHECK(pal_sock_tune_target(&info, 3U * MB, 2U, 256U * KB, &lim) == 0U,
+          "retransmits hold");
+
+    info.rtt_us = 0U;
+    CHECK(pal_sock_tune_target(&info, 3U * MB, 0U, 256U * KB, &lim) == 0U,
+          "no rtt, no target");
+    info.rtt_us = 80000U;
+
+    /* Under 25% more is not worth it */
+    CHECK(pal_sock_tune_target(&info, 3U * MB, 0U, 450U * KB, &lim) == 0U,
+          "small gain ignored");
+
+    /* Caps: the kernel maximum, then FTP_SOCK_TUNE_MAX_BUF */
+    pal_sock_limits_t small = {0U, 300U * KB, 0};
+    CHECK(pal_sock_tune_target(&info, 100U * MB, 0U, 128U * KB, &small) ==
+              300U * KB,
+          "capped by the kernel maximum");
+    CHECK(pal_sock_tune_target(&info, 1000U * MB, 0U, 128U * KB, &lim) ==
+              (uint32_t)FTP_SOCK_TUNE_MAX_BUF,
+          "capped by FTP_SOCK_TUNE_MAX_BUF");
+    CHECK(pal_sock_tune_target(&info, 1000U * MB, 0U,
+                               (uint32_t)FTP_SOCK_TUNE_MAX_BUF, &lim) == 0U,
+          "already at the cap");
+
+    /* Kernel autotuning keeps the buffer until its ceiling is too low */
+    pal_sock_limits_t autot = {4U * MB, 64U * MB, 1};
+    CHECK(pal_sock_tune_target(&info, 3U * MB, 0U, 256U * KB, &autot) == 0U,
+          "defers to kernel autotuning");
+    CHECK(pal_sock_tune_target(&info, 40U * MB, 0U, 256U * KB, &autot) ==
+              ((uint32_t)FTP_SOCK_TUNE_MAX_BUF < bdp2(40U * MB, 80000U)
+                   ? (uint32_t)FTP_SOCK_TUNE_MAX_BUF
+                   : bdp2(40U * MB, 80000U)),
+          "takes over past the autotuning ceiling");
+    autot.auto_max = 0U;
+    CHECK(pal_sock_tune_target(&info, 40U * MB, 0U, 256U * KB, &autot) == 0U,
+          "unknown ceiling: leave it to the kernel");
+
+    CHECK(pal_sock_tune_target(NULL, 1U, 0U, 0U, &lim) == 0U, "NULL info");
+
+    /* --- Sampling a live socket ----------------------------------------- */
+    int peer = -1;
+    int c = loopback_pair(&peer);
+    CHECK((c >= 0) && (peer >= 0), "loopback pair");
+    CHECK(pal_socket_tcp_info(-1, &info) == -1, "bad fd");
+    CHECK(pal_socket_tcp_info(c, NULL) == -1, "NULL out");
+#if defined(__linux__) || defined(__FreeBSD__) || defined(__APPLE__)
+    if (c >= 0) {
+        static char payload[64U * KB];
+        (void)send(c, payload, sizeof(payload), 0);
+        CHECK(pal_socket_tcp_info(c, &info) == 0, "tcp_info");
+        CHECK(info.mss > 0U, "mss reported");
+        CHECK(info.sndbuf > 0U && info.rcvbuf > 0U, "buffer sizes");
+
+        pal_sock_tune_t t;
+        pal_sock_tune_begin(&t, c, 0, 0U, 1000U);
+        CHECK(t.fd == c && t.buf == info.sndbuf, "begin samples");
+        CHECK(pal_sock_tune_tick(&t, sizeof(payload), 2000U) == 0,
+              "no sample before the interval");
+#if FTP_SOCK_TUNE
+        uint64_t due = t.next_ns;
+        CHECK(pal_sock_tune_tick(&t, sizeof(payload), due) == 1,
+              "sample when due");
+        CHECK(t.rate_bps > 0U && t.next_ns > due, "rate and next sample");
+#endif
+    }
+#endif
+    if (c >= 0) {
+        close(c);
+    }
+    if (peer >= 0) {
+        close(peer);
+    }
+
+    pal_sock_tune_t dead;
+    pal_sock_tune_begin(&dead, -1, 1, 0U, 0U);
+    CHECK(dead.fd == -1 && pal_sock_tune_tick(&dead, 1U, ~0ULL) == 0,
+          "closed controller stays idle");
+
+    if (failures != 0) {
+        printf("sock_tune: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("sock_tune: OK\n");
+    return 0;
+}
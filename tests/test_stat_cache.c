@@ -0,0 +1,162 @@
+#include "ftp_list.h"
+#include "ftp_stat_cache.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static char g_dir[64];
+
+static void write_file(const char *path, size_t len)
+{
+    static char buf[4096];
+    memset(buf, 's', sizeof(buf));
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if ((fd < 0) || (write(fd, buf, len) != (ssize_t)len)) {
+        failures++;
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+static ftp_stat_cache_stats_t stats(void)
+{
+    ftp_stat_cache_stats_t st;
+    ftp_stat_cache_get_stats(&st);
+    return st;
+}
+
+static void test_hit(void)
+{
+    char path[128];
+    vfs_stat_t st;
+    snprintf(path, sizeof(path), "%s/a", g_dir);
+    write_file(path, 100U);
+
+    ftp_stat_cache_stats_t s0 = stats();
+    CHECK(ftp_stat_cache_stat(path, &st) == FTP_OK, "first stat");
+    CHECK(st.size == 100U, "size");
+    CHECK(stats().misses == s0.misses + 1U, "first is a miss");
+
+    /* The file grows behind the cache's back: the entry still answers */
+    write_file(path, 200U);
+    CHECK(ftp_stat_cache_stat(path, &st) == FTP_OK, "second stat");
+    CHECK(st.size == 100U, "answered from the cache");
+    CHECK(stats().hits == s0.hits + 1U, "second is a hit");
+
+    /* Failures are not cached */
+    char missing[128];
+    snprintf(missing, sizeof(missing), "%s/none", g_dir);
+    CHECK(ftp_stat_cache_stat(missing, &st) != FTP_OK, "missing");
+    CHECK(ftp_stat_cache_stat(missing, &st) != FTP_OK, "missing again");
+    CHECK(stats().misses == s0.misses + 3U, "missing never hits");
+
+    ftp_list_cache_invalidate(path);
+    CHECK(ftp_stat_cache_stat(path, &st) == FTP_OK, "after change");
+    CHECK(st.size == 200U, "list cache invalidation reaches the stat cache");
+}
+
+static void test_invalidate(void)
+{
+    vfs_stat_t st;
+    vfs_stat_t got;
+    char sub[96];
+    char child[128];
+    char sibling[128];
+    memset(&st, 0, sizeof(st));
+    st.mode = S_IFREG | 0644U;
+    st.size = 7U;
+    snprintf(sub, sizeof(sub), "%s/sub", g_dir);
+    snprintf(child, sizeof(child), "%s/sub/c", g_dir);
+    snprintf(sibling, sizeof(sibling), "%s/subling", g_dir);
+
+    ftp_stat_cache_clear();
+    uint32_t gen = ftp_stat_cache_generation();
+    ftp_stat_cache_store(g_dir, &st, gen);
+    ftp_stat_cache_store(sub, &st, gen);
+    ftp_stat_cache_store(child, &st, gen);
+    ftp_stat_cache_store(sibling, &st, gen);
+    CHECK(stats().entries == 4U, "four stored");
+
+    ftp_stat_cache_stats_t s0 = stats();
+    ftp_stat_cache_invalidate(sub);
+    ftp_stat_cache_stats_t s1 = stats();
+    CHECK(s1.entries == 1U, "path, child and parent dropped");
+    CHECK(s1.invalidations == s0.invalidations + 3U, "invalidations counted");
+
+    /* The sibling shares a prefix but is not below sub */
+    CHECK(ftp_stat_cache_stat(sibling, &got) == FTP_OK, "sibling kept");
+    CHECK(got.size == 7U, "sibling from the cache");
+    CHECK(stats().hits == s1.hits + 1U, "sibling hit");
+
+    /* A stat taken before the change is not stored after it */
+    gen = ftp_stat_cache_generation();
+    ftp_stat_cache_invalidate(child);
+    ftp_stat_cache_store(child, &st, gen);
+    CHECK(stats().entries == 1U, "stale store ignored");
+    ftp_stat_cache_store(child, &st, ftp_stat_cache_generation());
+    CHECK(stats().entries == 2U, "fresh store kept");
+
+    ftp_stat_cache_clear();
+    CHECK(stats().entries == 0U, "cleared");
+}
+
+static void test_ttl(void)
+{
+    char path[128];
+    vfs_stat_t st;
+    snprintf(path, sizeof(path), "%s/t", g_dir);
+    write_file(path, 10U);
+
+    CHECK(ftp_stat_cache_stat(path, &st) == FTP_OK, "ttl: stat");
+    write_file(path, 20U);
+
+    struct timespec ts;
+    ts.tv_sec = (time_t)(FTP_STAT_CACHE_TTL_MS / 1000U);
+    ts.tv_nsec = (long)(FTP_STAT_CACHE_TTL_MS % 1000U) * 1000000L +
+                 100000000L;
+    (void)nanosleep(&ts, NULL);
+
+    CHECK(ftp_stat_cache_stat(path, &st) == FTP_OK, "ttl: restat");
+    CHECK(st.size == 20U, "expired entry refreshed");
+}
+
+int main(void)
+{
+#if FTP_STAT_CACHE_ENTRIES == 0
+    printf("stat_cache: skipped (FTP_STAT_CACHE_ENTRIES=0)\n");
+    return 0;
+#else
+    snprintf(g_dir, sizeof(g_dir), "/tmp/zftpd-sc-%d", (int)getpid());
+    (void)mkdir(g_dir, 0755);
+
+    test_hit();
+    test_invalidate();
+    test_ttl();
+
+    char cmd[96];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", g_dir);
+    (void)system(cmd);
+
+    if (failures != 0) {
+        printf("stat_cache: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("stat_cache: OK\n");
+    return 0;
+#endif
+}
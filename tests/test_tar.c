@@ -0,0 +1,257 @@
+#include "ftp_tar.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static unsigned char hdr[4096];
+static unsigned char arc[16384];
+static size_t arc_len;
+
+/* Collects what the reader reports */
+typedef struct {
+    int members;
+    int ends;
+    char names[8][400];
+    uint64_t sizes[8];
+    unsigned long sums[8];
+    int skip_dirs;
+} sink_state_t;
+
+static int on_begin(void *ctx, const ftp_tar_entry_t *e)
+{
+    sink_state_t *s = ctx;
+    if (s->members < 8) {
+        snprintf(s->names[s->members], sizeof(s->names[0]), "%s", e->name);
+        s->sizes[s->members] = e->size;
+    }
+    s->members++;
+    return ((s->skip_dirs != 0) && (e->type == '5')) ? 1 : 0;
+}
+
+static int on_data(void *ctx, const void *buf, size_t len)
+{
+    sink_state_t *s = ctx;
+    for (size_t i = 0U; i < len; i++) {
+        s->sums[s->members - 1] += ((const unsigned char *)buf)[i];
+    }
+    return 0;
+}
+
+static int on_end(void *ctx)
+{
+    ((sink_state_t *)ctx)->ends++;
+    return 0;
+}
+
+static void put(const void *p, size_t n)
+{
+    memcpy(arc + arc_len, p, n);
+    arc_len += n;
+}
+
+static void put_member(const ftp_tar_member_t *m, unsigned char fill)
+{
+    arc_len += ftp_tar_header(arc + arc_len, sizeof(arc) - arc_len, m);
+    memset(arc + arc_len, fill, (size_t)m->size);
+    arc_len += (size_t)m->size;
+    memset(arc + arc_len, 0, ftp_tar_padding(m->size));
+    arc_len += ftp_tar_padding(m->size);
+}
+
+/* Rewrite a header's checksum after patching it */
+static void fix_checksum(unsigned char *b)
+{
+    unsigned sum = 0U;
+    memset(b + 148, ' ', 8U);
+    for (size_t i = 0U; i < FTP_TAR_BLOCK; i++) {
+        sum += b[i];
+    }
+    snprintf((char *)b + 148, 8U, "%06o", sum);
+}
+
+static ftp_error_t feed(ftp_tar_reader_t *r, sink_state_t *st, size_t step)
+{
+    ftp_tar_sink_t sink = {on_begin, on_data, on_end, st};
+    ftp_tar_reader_init(r, &sink);
+    for (size_t off = 0U; off < arc_len; off += step) {
+        size_t n = ((arc_len - off) < step) ? (arc_len - off) : step;
+        ftp_error_t err = ftp_tar_reader_feed(r, arc + off, n);
+        if (err != FTP_OK) {
+            return err;
+        }
+    }
+    return ftp_tar_reader_finish(r);
+}
+
+/* Header checksum as a reader computes it */
+static int checksum_ok(const unsigned char *b)
+{
+    unsigned long sum = 0UL;
+    for (size_t i = 0U; i < FTP_TAR_BLOCK; i++) {
+        sum += ((i >= 148U) && (i < 156U)) ? (unsigned long)' ' : b[i];
+    }
+    return strtoul((const char *)b + 148, NULL, 8) == sum;
+}
+
+int main(void)
+{
+    ftp_tar_member_t m = {"saves/slot1.dat", 1234U, 0644U, 1700000000,
+                          FTP_TAR_FILE};
+
+    /* Short name: one block, octal fields, valid checksum */
+    size_t n = ftp_tar_header(hdr, sizeof(hdr), &m);
+    CHECK(n == FTP_TAR_BLOCK, "one block");
+    CHECK(strcmp((const char *)hdr, "saves/slot1.dat") == 0, "name field");
+    CHECK(strtoull((const char *)hdr + 124, NULL, 8) == 1234U, "octal size");
+    CHECK(strtoull((const char *)hdr + 136, NULL, 8) == 1700000000U, "mtime");
+    CHECK(strtoul((const char *)hdr + 100, NULL, 8) == 0644U, "mode");
+    CHECK(hdr[156] == '0', "regular file type");
+    CHECK(memcmp(hdr + 257, "ustar\0" "00", 8U) == 0, "ustar magic");
+    CHECK(checksum_ok(hdr), "checksum");
+    CHECK(ftp_tar_header(hdr, FTP_TAR_BLOCK - 1U, &m) == 0U, "short buffer");
+
+    /* Directory: trailing slash added, size forced to zero */
+    ftp_tar_member_t d = {"saves", 99U, 0755U, 0, FTP_TAR_DIR};
+    CHECK(ftp_tar_header(hdr, sizeof(hdr), &d) == FTP_TAR_BLOCK, "dir");
+    CHECK(strcmp((const char *)hdr, "saves/") == 0, "dir slash");
+    CHECK(strtoull((const char *)hdr + 124, NULL, 8) == 0U, "dir size");
+    CHECK(hdr[156] == '5', "dir type");
+
+    /* > 8 GiB: base-256 size */
+    m.size = 9ULL << 30;
+    CHECK(ftp_tar_header(hdr, sizeof(hdr), &m) == FTP_TAR_BLOCK, "big file");
+    CHECK(hdr[124] == 0x80, "base-256 marker");
+    unsigned long long big = 0ULL;
+    for (size_t i = 125U; i < 136U; i++) {
+        big = (big << 8) | hdr[i];
+    }
+    CHECK(big == (9ULL << 30), "base-256 value");
+    CHECK(checksum_ok(hdr), "big checksum");
+
+    /* 150-byte path: prefix/name split, still one block */
+    char path[400];
+    memset(path, 'a', 120U);
+    path[120] = '/';
+    memset(path + 121, 'b', 29U);
+    path[150] = '\0';
+    m.name = path;
+    m.size = 1U;
+    CHECK(ftp_tar_header_size(path, FTP_TAR_FILE) == FTP_TAR_BLOCK,
+          "split size");
+    CHECK(ftp_tar_header(hdr, sizeof(hdr), &m) == FTP_TAR_BLOCK, "split");
+    CHECK((strlen((const char *)hdr) == 29U) && (hdr[0] == 'b'), "split name");
+    CHECK((memcmp(hdr + 345, path, 120U) == 0) && (hdr[465] == '\0'),
+          "split prefix");
+    CHECK(checksum_ok(hdr), "split checksum");
+
+    /* 300-byte component: GNU long-name record */
+    memset(path, 'c', 300U);
+    path[300] = '\0';
+    size_t want = FTP_TAR_BLOCK + 512U + FTP_TAR_BLOCK;
+    CHECK(ftp_tar_header_size(path, FTP_TAR_FILE) == want, "long size");
+    n = ftp_tar_header(hdr, sizeof(hdr), &m);
+    CHECK(n == want, "long header");
+    CHECK(strcmp((const char *)hdr, "././@LongLink") == 0, "long link name");
+    CHECK(hdr[156] == 'L', "long link type");
+    CHECK(strtoull((const char *)hdr + 124, NULL, 8) == 301U, "long length");
+    CHECK(checksum_ok(hdr), "long link checksum");
+    CHECK((memcmp(hdr + 512, path, 300U) == 0) && (hdr[812] == '\0'),
+          "long name data");
+    CHECK(hdr[1024 + 156] == '0', "real header follows");
+    CHECK(checksum_ok(hdr + 1024), "real checksum");
+
+    /* Invalid members */
+    m.name = "";
+    CHECK(ftp_tar_header(hdr, sizeof(hdr), &m) == 0U, "empty name");
+    CHECK(ftp_tar_header(hdr, sizeof(hdr), NULL) == 0U, "null member");
+
+    CHECK(ftp_tar_padding(0U) == 0U, "pad 0");
+    CHECK(ftp_tar_padding(1U) == 511U, "pad 1");
+    CHECK(ftp_tar_padding(512U) == 0U, "pad 512");
+    CHECK(ftp_tar_padding(513U) == 511U, "pad 513");
+
+    /* Reader: round trip through the writer, fed in awkward chunk sizes */
+    static ftp_tar_reader_t rd;
+    static sink_state_t st;
+    ftp_tar_member_t w1 = {"saves", 0U, 0755U, 0, FTP_TAR_DIR};
+    ftp_tar_member_t w2 = {"saves/a.dat", 700U, 0644U, 5, FTP_TAR_FILE};
+    ftp_tar_member_t w3 = {path, 10U, 0600U, 6, FTP_TAR_FILE};
+    arc_len = 0U;
+    put_member(&w1, 0U);
+    put_member(&w2, 1U);
+    put_member(&w3, 2U);
+    memset(arc + arc_len, 0, 4096U); /* trailer + record padding */
+    arc_len += 4096U;
+
+    static const size_t steps[] = {1U, 7U, 512U, 100000U};
+    for (size_t i = 0U; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        memset(&st, 0, sizeof(st));
+        CHECK(feed(&rd, &st, steps[i]) == FTP_OK, "reader round trip");
+        CHECK((st.members == 3) && (st.ends == 3), "three members");
+        CHECK(strcmp(st.names[0], "saves/") == 0, "dir name");
+        CHECK((strcmp(st.names[1], "saves/a.dat") == 0) &&
+                  (st.sizes[1] == 700U) && (st.sums[1] == 700U),
+              "file body");
+        CHECK((strcmp(st.names[2], path) == 0) && (st.sums[2] == 20U),
+              "long name read back");
+    }
+
+    /* Skipped bodies get no data/end callbacks */
+    memset(&st, 0, sizeof(st));
+    st.skip_dirs = 1;
+    CHECK(feed(&rd, &st, 4096U) == FTP_OK, "skip");
+    CHECK((st.members == 3) && (st.ends == 2), "skipped member not ended");
+
+    /* Truncated inside a body */
+    size_t full = arc_len;
+    arc_len = FTP_TAR_BLOCK * 2U + 100U;
+    memset(&st, 0, sizeof(st));
+    CHECK(feed(&rd, &st, 512U) == FTP_ERR_PROTOCOL, "truncated body");
+    arc_len = full;
+
+    /* Corrupt checksum */
+    arc[FTP_TAR_BLOCK + 3U] ^= 0x20U;
+    memset(&st, 0, sizeof(st));
+    CHECK(feed(&rd, &st, 512U) == FTP_ERR_PROTOCOL, "bad checksum");
+
+    /* pax 'x' record overrides the name and the size */
+    static const char pax[] = "24 path=pax/renamed.bin\n10 size=3\n";
+    ftp_tar_member_t px = {"PaxHeader", sizeof(pax) - 1U, 0644U, 0,
+                           FTP_TAR_FILE};
+    arc_len = 0U;
+    arc_len += ftp_tar_header(arc, sizeof(arc), &px);
+    arc[156] = 'x';
+    fix_checksum(arc);
+    put(pax, sizeof(pax) - 1U);
+    memset(arc + arc_len, 0, ftp_tar_padding(sizeof(pax) - 1U));
+    arc_len += ftp_tar_padding(sizeof(pax) - 1U);
+    ftp_tar_member_t body = {"short", 99U, 0644U, 0, FTP_TAR_FILE};
+    arc_len += ftp_tar_header(arc + arc_len, sizeof(arc) - arc_len, &body);
+    put("xyz", 3U);
+    memset(arc + arc_len, 0, FTP_TAR_BLOCK - 3U + FTP_TAR_TRAILER);
+    arc_len += FTP_TAR_BLOCK - 3U + FTP_TAR_TRAILER;
+    memset(&st, 0, sizeof(st));
+    CHECK(feed(&rd, &st, 13U) == FTP_OK, "pax archive");
+    CHECK((st.members == 1) && (strcmp(st.names[0], "pax/renamed.bin") == 0),
+          "pax path");
+    CHECK((st.sizes[0] == 3U) &&
+              (st.sums[0] == (unsigned long)('x' + 'y' + 'z')),
+          "pax size");
+
+    if (failures != 0) {
+        printf("tar: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("tar: OK\n");
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "pal_thread.h"
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#if defined(__linux__)
+#include <errno.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static int has_cpu(const pal_thread_place_t *p, unsigned c)
+{
+    return ((p->cpus[c / 64U] >> (c % 64U)) & 1U) != 0U;
+}
+
+static void test_parse(void)
+{
+    pal_thread_place_t p;
+    char out[256];
+
+    CHECK(pal_thread_config("data=0-3,6/-5 disk=4/5;background=/10") == 0,
+          "valid spec");
+    pal_thread_get_place(PAL_THREAD_DATA, &p);
+    CHECK(has_cpu(&p, 0U) && has_cpu(&p, 3U) && has_cpu(&p, 6U), "data cpus");
+    CHECK(!has_cpu(&p, 4U) && !has_cpu(&p, 5U), "data gaps");
+    CHECK((p.has_nice == 1) && (p.nice == -5), "data nice");
+    pal_thread_get_place(PAL_THREAD_BACKGROUND, &p);
+    CHECK((p.cpus[0] == 0U) && (p.nice == 10), "background: nice only");
+    pal_thread_get_place(PAL_THREAD_CONTROL, &p);
+    CHECK((p.cpus[0] == 0U) && (p.has_nice == 0), "control untouched");
+
+    CHECK(pal_thread_describe(out, sizeof(out)) > 0U, "describe");
+    CHECK(strcmp(out, "data=0-3,6/-5 disk=4/5 background=/10") == 0,
+          "describe round trip");
+    CHECK(pal_thread_config(out) == 0, "describe output parses");
+
+    /* Malformed: rejected, table unchanged */
+    CHECK(pal_thread_config("cpu=1") < 0, "unknown role");
+    CHECK(pal_thread_config("data=256") < 0, "cpu out of range");
+    CHECK(pal_thread_config("data=1/20") < 0, "nice above 19");
+    CHECK(pal_thread_config("data=1/-21") < 0, "nice below -20");
+    CHECK(pal_thread_config("data=1,") < 0, "trailing comma");
+    CHECK(pal_thread_config("data=3-1") < 0, "reversed range");
+    CHECK(pal_thread_config("data=") < 0, "empty entry");
+    CHECK(pal_thread_config("data") < 0, "no '='");
+    pal_thread_get_place(PAL_THREAD_DISK, &p);
+    CHECK(has_cpu(&p, 4U) && (p.nice == 5), "table kept after a bad spec");
+
+    CHECK(pal_thread_config("") == 0, "empty clears");
+    CHECK(pal_thread_describe(out, sizeof(out)) == 0U, "nothing placed");
+    CHECK(pal_thread_role_name(PAL_THREAD_HTTP) != NULL, "role name");
+    CHECK(pal_thread_role_name(PAL_THREAD_ROLES) == NULL, "bad role name");
+}
+
+typedef struct {
+    int cpu;
+    int nice;
+    int ran;
+} probe_t;
+
+static void *probe_thread(void *arg)
+{
+    probe_t *pr = arg;
+    pr->ran = 1;
+#if defined(__linux__)
+    pr->cpu = sched_getcpu();
+    errno = 0;
+    pr->nice = getpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid));
+#endif
+    return NULL;
+}
+
+static void test_create(void)
+{
+    pal_thread_stats_t before;
+    pal_thread_stats_t after;
+    pal_thread_get_stats(&before);
+
+    /* Unplaced role: a plain thread */
+    probe_t pr = {-1, 0, 0};
+    pthread_t tid;
+    CHECK(pal_thread_create(&tid, NULL, PAL_THREAD_HTTP, probe_thread, &pr) ==
+              0,
+          "create unplaced");
+    pthread_join(tid, NULL);
+    CHECK(pr.ran == 1, "unplaced ran");
+
+#if defined(__linux__)
+    /* Pin to the first CPU this process may use, lower the priority */
+    cpu_set_t mine;
+    unsigned first = 0U;
+    CPU_ZERO(&mine);
+    if (sched_getaffinity(0, sizeof(mine), &mine) == 0) {
+        while ((first < 255U) && !CPU_ISSET(first, &mine)) {
+            first++;
+        }
+    }
+    char spec[64];
+    (void)snprintf(spec, sizeof(spec), "data=%u/5", first);
+    CHECK(pal_thread_config(spec) == 0, "pin spec");
+
+    probe_t pd = {-1, 0, 0};
+    CHECK(pal_thread_create(&tid, NULL, PAL_THREAD_DATA, probe_thread, &pd) ==
+              0,
+          "create placed");
+    pthread_join(tid, NULL);
+    CHECK(pd.ran == 1, "placed ran");
+    CHECK(pd.cpu == (int)first, "runs on the pinned cpu");
+    CHECK(pd.nice == 5, "nice applied");
+    (void)pal_thread_config("");
+#endif
+
+    pal_thread_get_stats(&after);
+    CHECK(after.started[PAL_THREAD_HTTP] ==
+              before.started[PAL_THREAD_HTTP] + 1U,
+          "http started counted");
+#if defined(__linux__)
+    CHECK(after.started[PAL_THREAD_DATA] ==
+              before.started[PAL_THREAD_DATA] + 1U,
+          "data started counted");
+    CHECK(after.placed == before.placed + 1U, "placement counted");
+    CHECK(after.refused == before.refused, "nothing refused");
+#endif
+
+    CHECK(pal_thread_create(&tid, NULL, PAL_THREAD_ROLES, probe_thread, &pr) !=
+              0,
+          "bad role refused");
+}
+
+int main(void)
+{
+    test_parse();
+    test_create();
+
+    if (failures != 0) {
+        printf("thread: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("thread: OK\n");
+    return 0;
+}
@@ -0,0 +1,123 @@
+#include "ftp_trace.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+static ftp_trace_t out[FTP_TRACE_HISTORY];
+
+static void test_timeline(void)
+{
+    ftp_trace_t t;
+    memset(&t, 0, sizeof(t));
+    CHECK(!ftp_trace_active(&t), "idle");
+    ftp_trace_span(&t, FTP_TRACE_SENDFILE, 100U); /* ignored while idle */
+
+    uint64_t start = ftp_trace_now_ns();
+    usleep(2000);
+    ftp_trace_begin(&t, "RETR", "/data/file.bin", 7U, start);
+    CHECK(ftp_trace_active(&t), "active");
+    CHECK((t.events == 1U) && (t.ev[0].kind == FTP_TRACE_OPEN), "open event");
+    CHECK(t.ev[0].dur_us >= 1500U, "open latency from the command");
+
+    ftp_trace_mark(&t, FTP_TRACE_CONNECT, ftp_trace_now_ns(), 0U, 0U);
+    ftp_trace_mark(&t, FTP_TRACE_FIRST_BYTE, 0U, 0U, 0U);
+    for (int i = 0; i < 100; i++) {
+        ftp_trace_span(&t, FTP_TRACE_SENDFILE, 1000U);
+    }
+    CHECK(t.events == 4U, "sendfile calls merged into one burst");
+    CHECK((t.ev[3].bytes == 100000U) && (t.ev[3].count == 100U),
+          "burst bytes and calls");
+    ftp_trace_span(&t, FTP_TRACE_STALL, 0U);
+    ftp_trace_span(&t, FTP_TRACE_COOLDOWN, 4096U);
+    ftp_trace_span(&t, FTP_TRACE_SENDFILE, 5000U);
+    CHECK(t.events == 7U, "a stall splits bursts");
+    CHECK(t.ev[6].at_us >= t.ev[5].at_us + t.ev[5].dur_us,
+          "spans follow each other");
+
+    ftp_trace_end(&t, 1, 109096U);
+    CHECK(!ftp_trace_active(&t), "idle after end");
+
+    size_t n = ftp_trace_recent(7U, out, FTP_TRACE_HISTORY);
+    CHECK(n == 1U, "published");
+    CHECK((out[0].ok == 1U) && (strcmp(out[0].cmd, "RETR") == 0) &&
+              (strcmp(out[0].path, "/data/file.bin") == 0),
+          "header");
+    CHECK((out[0].events == 8U) && (out[0].ev[7].kind == FTP_TRACE_CLOSE) &&
+              (out[0].ev[7].bytes == 109096U),
+          "close event");
+    CHECK(ftp_trace_recent(8U, out, FTP_TRACE_HISTORY) == 0U,
+          "other session sees nothing");
+
+    char line[128];
+    ftp_trace_format_event(&out[0].ev[3], line, sizeof(line));
+    CHECK((strstr(line, " sendfile ") != NULL) &&
+              (strstr(line, " 100000B x100") != NULL),
+          "event text");
+}
+
+static void test_bounds(void)
+{
+    ftp_trace_t t;
+    memset(&t, 0, sizeof(t));
+
+    /* Long path keeps its tail */
+    char path[300];
+    memset(path, 'a', sizeof(path));
+    memcpy(path + sizeof(path) - 10U, "/tail.bin", 10U);
+    ftp_trace_begin(&t, "STOR", path, 9U, 0U);
+    CHECK(strlen(t.path) == FTP_TRACE_PATH_MAX - 1U, "path truncated");
+    CHECK(strcmp(t.path + strlen(t.path) - 9U, "/tail.bin") == 0,
+          "tail kept");
+
+    /* Alternating kinds never merge: the ring fills, close still fits */
+    for (unsigned i = 0U; i < FTP_TRACE_EVENTS * 2U; i++) {
+        ftp_trace_span(&t, (i % 2U) ? FTP_TRACE_STALL : FTP_TRACE_SENDFILE,
+                       1U);
+    }
+    CHECK(t.events == FTP_TRACE_EVENTS - 1U, "last slot reserved");
+    CHECK(t.dropped > 0U, "overflow counted");
+
+    /* A new begin publishes the abandoned timeline as failed */
+    ftp_trace_begin(&t, "STOR", "/next", 9U, 0U);
+    ftp_trace_end(&t, 1, 0U);
+    size_t n = ftp_trace_recent(9U, out, FTP_TRACE_HISTORY);
+    CHECK(n == 2U, "both published");
+    CHECK((n == 2U) && (strcmp(out[0].path, "/next") == 0) &&
+              (out[1].ok == 0U) &&
+              (out[1].ev[FTP_TRACE_EVENTS - 1U].kind == FTP_TRACE_CLOSE),
+          "newest first, abandoned one failed and closed");
+
+    /* History wraps */
+    for (unsigned i = 0U; i < FTP_TRACE_HISTORY + 5U; i++) {
+        ftp_trace_begin(&t, "RETR", "/w", 10U, 0U);
+        ftp_trace_end(&t, 1, (uint64_t)i);
+    }
+    n = ftp_trace_recent(FTP_TRACE_ALL_SESSIONS, out, FTP_TRACE_HISTORY);
+    CHECK(n == FTP_TRACE_HISTORY, "ring bounded");
+    CHECK(out[0].ev[out[0].events - 1U].bytes ==
+              (uint64_t)FTP_TRACE_HISTORY + 4U,
+          "newest kept");
+}
+
+int main(void)
+{
+    test_timeline();
+    test_bounds();
+
+    if (failures != 0) {
+        printf("trace: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("trace: OK\n");
+    return 0;
+}
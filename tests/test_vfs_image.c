@@ -0,0 +1,289 @@
+#include "ftp_list.h"
+#include "pal_filesystem.h"
+#include "exfat_unpacker.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+/* 512-byte sectors and clusters; FAT in sector 1, heap from sector 2 */
+#define SECTOR      512U
+#define CLUSTERS    64U
+#define HEAP_SECTOR 2U
+#define ROOT_DIR    2U
+#define SUB_DIR     3U
+
+/* readme.txt: NoFatChain clusters 10-11 */
+#define README_FIRST 10U
+#define README_SIZE  700U
+
+/* frag.bin: chain 20, 21, 30, 31, 22 — three extents, last one partial */
+static const uint32_t frag[5] = {20U, 21U, 30U, 31U, 22U};
+#define FRAG_SIZE (4U * SECTOR + 352U)
+
+/* sub/inner.dat: NoFatChain cluster 40 */
+#define INNER_FIRST 40U
+#define INNER_SIZE  100U
+
+static uint8_t img[(HEAP_SECTOR + CLUSTERS) * SECTOR];
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    put_le16(p, (uint16_t)v);
+    put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put_le64(uint8_t *p, uint64_t v)
+{
+    put_le32(p, (uint32_t)v);
+    put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static uint8_t *cluster(uint32_t c)
+{
+    return img + (size_t)(HEAP_SECTOR + c - 2U) * SECTOR;
+}
+
+/* File, stream extension and one name entry (names up to 15 chars) */
+static uint8_t *add_entry(uint8_t *p, const char *name, int is_dir,
+                          uint32_t first, uint64_t size, int contiguous)
+{
+    p[0] = EXFAT_ENTRY_TYPE_FILE_DIR;
+    p[1] = 2U;
+    put_le16(p + 4, is_dir ? EXFAT_ATTR_DIRECTORY : EXFAT_ATTR_ARCHIVE);
+    put_le32(p + 12, (45U << 25) | (6U << 21) | (15U << 16)); /* 2025-06-15 */
+
+    p[32] = EXFAT_ENTRY_TYPE_STREAM_EXT;
+    p[33] = EXFAT_FLAG_ALLOC_POSSIBLE |
+            (contiguous ? EXFAT_FLAG_NO_FAT_CHAIN : 0U);
+    p[35] = (uint8_t)strlen(name);
+    put_le64(p + 40, size);
+    put_le32(p + 52, first);
+    put_le64(p + 56, size);
+
+    p[64] = EXFAT_ENTRY_TYPE_FILENAME;
+    for (size_t i = 0U; name[i] != '\0'; i++) {
+        put_le16(p + 66 + i * 2U, (uint16_t)(unsigned char)name[i]);
+    }
+    return p + 96;
+}
+
+/* Byte k of a file whose data starts at pattern seed s */
+static uint8_t pat(uint32_t s, uint64_t k)
+{
+    return (uint8_t)(s * 7U + k * 13U + (k >> 9));
+}
+
+static void fill(uint32_t c, uint32_t seed, uint64_t file_off)
+{
+    for (uint32_t k = 0U; k < SECTOR; k++) {
+        cluster(c)[k] = pat(seed, file_off + k);
+    }
+}
+
+static void build_image(const char *path)
+{
+    memcpy(img + 3, EXFAT_FS_NAME, EXFAT_FS_NAME_LEN);
+    put_le32(img + 0x50, 1U);          /* FatOffset         */
+    put_le32(img + 0x54, 1U);          /* FatLength         */
+    put_le32(img + 0x58, HEAP_SECTOR); /* ClusterHeapOffset */
+    put_le32(img + 0x5C, CLUSTERS);    /* ClusterCount      */
+    put_le32(img + 0x60, ROOT_DIR);
+    img[0x6C] = 9U;
+    img[0x6D] = 0U;
+    img[0x6E] = 1U;
+    img[0x1FE] = 0x55U;
+    img[0x1FF] = 0xAAU;
+
+    uint8_t *fat = img + SECTOR;
+    put_le32(fat + ROOT_DIR * 4U, EXFAT_FAT_END_OF_CHAIN);
+    put_le32(fat + SUB_DIR * 4U, EXFAT_FAT_END_OF_CHAIN);
+    for (uint32_t i = 0U; i < 5U; i++) {
+        put_le32(fat + frag[i] * 4U,
+                 (i < 4U) ? frag[i + 1U] : EXFAT_FAT_END_OF_CHAIN);
+        fill(frag[i], 2U, (uint64_t)i * SECTOR);
+    }
+    fill(README_FIRST, 1U, 0U);
+    fill(README_FIRST + 1U, 1U, SECTOR);
+    fill(INNER_FIRST, 3U, 0U);
+
+    uint8_t *p = cluster(ROOT_DIR);
+    p = add_entry(p, "readme.txt", 0, README_FIRST, README_SIZE, 1);
+    p = add_entry(p, "frag.bin", 0, frag[0], FRAG_SIZE, 0);
+    (void)add_entry(p, "sub", 1, SUB_DIR, SECTOR, 0);
+    (void)add_entry(cluster(SUB_DIR), "inner.dat", 0, INNER_FIRST,
+                    INNER_SIZE, 1);
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    CHECK(fd >= 0, "create image");
+    CHECK(write(fd, img, sizeof(img)) == (ssize_t)sizeof(img), "write image");
+    close(fd);
+}
+
+typedef struct {
+    char names[8][32];
+    vfs_stat_t st[8];
+    int n;
+} dir_list_t;
+
+static int collect(void *user, const char *name, const vfs_stat_t *st)
+{
+    dir_list_t *l = (dir_list_t *)user;
+    if (l->n < 8) {
+        snprintf(l->names[l->n], sizeof(l->names[0]), "%s", name);
+        l->st[l->n] = *st;
+        l->n++;
+    }
+    return 0;
+}
+
+static int matches(const uint8_t *p, uint32_t seed, uint64_t off, size_t len)
+{
+    for (size_t k = 0U; k < len; k++) {
+        if (p[k] != pat(seed, off + k)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/zftpd-vfsimg-XXXXXX";
+    CHECK(mkdtemp(dir) != NULL, "mkdtemp");
+    char image[128];
+    char at[128];
+    char path[192];
+    snprintf(image, sizeof(image), "%s/games.exfat", dir);
+    snprintf(at, sizeof(at), "%s/games", dir);
+    build_image(image);
+
+    /* Mount rules */
+    CHECK(vfs_mount_image(image, dir) == FTP_ERR_DIR_EXISTS,
+          "existing directory refused");
+    CHECK(vfs_mount_image(image, "/") != FTP_OK, "root refused");
+    CHECK(vfs_mount_image(dir, at) == FTP_ERR_FILE_OPEN, "not an image");
+    CHECK(vfs_is_image_path(at) == 0, "nothing mounted yet");
+    CHECK(vfs_mount_image(image, at) == FTP_OK, "mount");
+    snprintf(path, sizeof(path), "%s/sub", at);
+    CHECK(vfs_mount_image(image, path) == FTP_ERR_DIR_EXISTS,
+          "nested mount refused");
+    CHECK(vfs_is_image_path(at) == 1, "mount point");
+    CHECK(vfs_is_image_path(path) == 1, "below mount point");
+    snprintf(path, sizeof(path), "%s/gamesx", dir);
+    CHECK(vfs_is_image_path(path) == 0, "prefix is not a component");
+
+    /* Stat from the index; real paths are untouched */
+    vfs_stat_t st;
+    CHECK((vfs_stat(at, &st) == FTP_OK) &&
+          ((st.mode & S_IFMT) == S_IFDIR), "stat mount point");
+    snprintf(path, sizeof(path), "%s/sub/inner.dat", at);
+    CHECK((vfs_stat(path, &st) == FTP_OK) &&
+          ((st.mode & S_IFMT) == S_IFREG) && (st.size == INNER_SIZE) &&
+          (st.mtime > 0), "stat nested file");
+    snprintf(path, sizeof(path), "%s/missing", at);
+    CHECK(vfs_stat(path, &st) == FTP_ERR_NOT_FOUND, "missing entry");
+    CHECK((vfs_stat(image, &st) == FTP_OK) && (st.size == sizeof(img)),
+          "real file");
+
+    /* Listings in directory order */
+    dir_list_t l;
+    memset(&l, 0, sizeof(l));
+    CHECK(vfs_image_readdir(at, collect, &l) == FTP_OK, "readdir root");
+    CHECK((l.n == 3) && (strcmp(l.names[0], "readme.txt") == 0) &&
+          (strcmp(l.names[1], "frag.bin") == 0) &&
+          (strcmp(l.names[2], "sub") == 0), "root names");
+    CHECK((l.st[1].size == FRAG_SIZE) &&
+          ((l.st[2].mode & S_IFMT) == S_IFDIR), "root stats");
+    snprintf(path, sizeof(path), "%s/sub", at);
+    memset(&l, 0, sizeof(l));
+    CHECK((vfs_image_readdir(path, collect, &l) == FTP_OK) && (l.n == 1) &&
+          (strcmp(l.names[0], "inner.dat") == 0), "readdir sub");
+
+    ftp_list_snapshot_t snap;
+    CHECK(ftp_list_snapshot(at, &snap) == FTP_OK, "snapshot");
+    CHECK((snap.count == 3U) &&
+          (strcmp(ftp_list_snapshot_name(&snap, 2U), "sub") == 0),
+          "snapshot entries");
+    ftp_list_snapshot_release(&snap);
+
+    /* Directories do not open */
+    vfs_node_t node;
+    CHECK(vfs_open(&node, path) != FTP_OK, "open directory");
+
+    /* Fragmented file: sequential reads cross all three extents */
+    static uint8_t buf[FRAG_SIZE + 64U];
+    snprintf(path, sizeof(path), "%s/frag.bin", at);
+    CHECK(vfs_open(&node, path) == FTP_OK, "open frag.bin");
+    CHECK(vfs_get_size(&node) == FRAG_SIZE, "size");
+    CHECK((vfs_get_caps(&node) & VFS_CAP_SENDFILE) == 0U, "no sendfile");
+    size_t got = 0U;
+    for (;;) {
+        ssize_t n = vfs_read(&node, buf + got, 300U);
+        if (n <= 0) {
+            CHECK(n == 0, "clean EOF");
+            break;
+        }
+        got += (size_t)n;
+    }
+    CHECK(got == FRAG_SIZE, "read all");
+    CHECK(matches(buf, 2U, 0U, FRAG_SIZE), "sequential bytes");
+
+    /* REST / Range: forward, backward and across an extent boundary */
+    memset(buf, 0, sizeof(buf));
+    CHECK(vfs_pread(&node, buf, 1300U, 900U) == 1300, "pread across");
+    CHECK(matches(buf, 2U, 900U, 1300U), "pread across bytes");
+    CHECK(vfs_pread(&node, buf, 10U, 5U) == 10, "pread backwards");
+    CHECK(matches(buf, 2U, 5U, 10U), "pread backwards bytes");
+    CHECK(vfs_pread(&node, buf, 100U, FRAG_SIZE - 40U) == 40, "short tail");
+    CHECK(vfs_pread(&node, buf, 100U, FRAG_SIZE) == 0, "at EOF");
+    vfs_set_offset(&node, 2048U);
+    CHECK((vfs_read(&node, buf, 64U) == 64) && matches(buf, 2U, 2048U, 64U),
+          "read after set_offset");
+
+    /* Unmount with the file open: the node keeps the image alive */
+    CHECK(vfs_unmount_image(at) == FTP_OK, "unmount");
+    CHECK(vfs_unmount_image(at) == FTP_ERR_NOT_FOUND, "unmount twice");
+    CHECK(vfs_is_image_path(at) == 0, "gone from the table");
+    CHECK((vfs_pread(&node, buf, 64U, 0U) == 64) && matches(buf, 2U, 0U, 64U),
+          "read after unmount");
+    vfs_close(&node);
+    CHECK(vfs_stat(at, &st) != FTP_OK, "mount point gone");
+
+    /* Contiguous file through a fresh mount */
+    CHECK(vfs_mount_image(image, at) == FTP_OK, "remount");
+    snprintf(path, sizeof(path), "%s/readme.txt", at);
+    CHECK(vfs_open(&node, path) == FTP_OK, "open readme.txt");
+    CHECK((vfs_read(&node, buf, sizeof(buf)) == (ssize_t)README_SIZE) &&
+          matches(buf, 1U, 0U, README_SIZE), "contiguous bytes");
+    vfs_close(&node);
+    CHECK(vfs_unmount_image(at) == FTP_OK, "unmount again");
+
+    unlink(image);
+    rmdir(dir);
+
+    if (failures != 0) {
+        printf("vfs_image: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("vfs_image: OK\n");
+    return 0;
+}
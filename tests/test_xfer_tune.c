@@ -0,0 +1,106 @@
+#include "ftp_config.h"
+#include "ftp_xfer_tune.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MB (1024U * 1024U)
+
+/* Push one full window of sendfile output in chunk-sized pieces */
+static void feed_window(ftp_xfer_tune_t *t, uint32_t eagain_per_call)
+{
+    uint64_t moved = 0U;
+    while (moved < (uint64_t)FTP_RETR_TUNE_WINDOW_BYTES) {
+        for (uint32_t i = 0U; i < eagain_per_call; i++) {
+            ftp_xfer_tune_on_eagain(t);
+        }
+        ftp_xfer_tune_on_sent(t, t->chunk);
+        moved += t->chunk;
+    }
+}
+
+int main(void)
+{
+    ftp_xfer_tune_t t;
+
+    ftp_xfer_tune_reset_table();
+
+    /* Defaults for an unseen filesystem */
+    ftp_xfer_tune_begin(&t, "exfat");
+    if ((t.chunk != FTP_RETR_SENDFILE_CHUNK) ||
+        (t.cooldown != FTP_RETR_TUNE_COOLDOWN) || (t.seeded != 0)) {
+        return 1;
+    }
+    if ((uint64_t)t.eagain_retries * t.eagain_sleep_us !=
+        (uint64_t)FTP_SENDFILE_EAGAIN_RETRIES * FTP_SENDFILE_EAGAIN_SLEEP_US) {
+        return 2;
+    }
+
+    /* Zero-return storm: chunk must shrink */
+    uint32_t before = t.chunk;
+    feed_window(&t, 1U);
+    if (t.chunk >= before) {
+        fprintf(stderr, "chunk %u not reduced\n", t.chunk);
+        return 3;
+    }
+
+    /* Back-pressure always clears on the first retry: sleep shrinks */
+    uint32_t sleep_before = t.eagain_sleep_us;
+    for (int i = 0; i < 8; i++) {
+        ftp_xfer_tune_on_recovered(&t, 1U);
+    }
+    feed_window(&t, 0U);
+    if (t.eagain_sleep_us >= sleep_before) {
+        return 4;
+    }
+
+    /* Stalls right after each cooldown: cooldown grows */
+    uint32_t cool_before = t.cooldown;
+    ftp_xfer_tune_on_stall(&t);
+    ftp_xfer_tune_on_sent(&t, MB);
+    ftp_xfer_tune_on_stall(&t);
+    if (t.cooldown <= cool_before) {
+        return 5;
+    }
+    if (t.cooldown > FTP_RETR_TUNE_COOLDOWN_MAX) {
+        return 6;
+    }
+
+    /* Completed transfer is remembered for the same filesystem only */
+    uint32_t learned_cool = t.cooldown;
+    uint32_t learned_sleep = t.eagain_sleep_us;
+    ftp_xfer_tune_end(&t, 1);
+
+    ftp_xfer_tune_begin(&t, "exfat");
+    if ((t.seeded != 1) || (t.cooldown != learned_cool) ||
+        (t.eagain_sleep_us != learned_sleep)) {
+        return 7;
+    }
+    ftp_xfer_tune_end(&t, 0);
+
+    ftp_xfer_tune_begin(&t, "pfs");
+    if ((t.seeded != 0) || (t.chunk != FTP_RETR_SENDFILE_CHUNK)) {
+        return 8;
+    }
+
+    /* Knobs stay inside their bounds under sustained pressure */
+    for (int w = 0; w < 16; w++) {
+        feed_window(&t, 4U);
+        for (int i = 0; i < 4; i++) {
+            ftp_xfer_tune_on_recovered(&t, 64U);
+        }
+    }
+    if ((t.chunk < FTP_RETR_TUNE_CHUNK_MIN) ||
+        (t.eagain_sleep_us > FTP_RETR_TUNE_SLEEP_MAX_US) ||
+        (t.eagain_retries == 0U)) {
+        return 9;
+    }
+
+    char fs[FTP_XFER_TUNE_FSNAME_MAX];
+    ftp_xfer_tune_fstype(-1, fs, sizeof(fs));
+    if (strcmp(fs, "unknown") != 0) {
+        return 10;
+    }
+
+    printf("test_xfer_tune: OK\n");
+    return 0;
+}
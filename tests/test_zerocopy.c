@@ -0,0 +1,237 @@
+#include "ftp_buffer_pool.h"
+#include "ftp_session.h"
+#include "pal_network.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static int failures = 0;
+
+#define CHECK(cond, msg)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("FAIL %s (line %d)\n", msg, __LINE__);                      \
+            failures++;                                                        \
+        }                                                                      \
+    } while (0)
+
+#define CHUNK 65536U
+
+/* Connected loopback pair; returns the client side, *peer the server side */
+static int loopback_pair(int *peer)
+{
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in a;
+    socklen_t len = (socklen_t)sizeof(a);
+    memset(&a, 0, sizeof(a));
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((lfd < 0) || (bind(lfd, (struct sockaddr *)&a, len) != 0) ||
+        (listen(lfd, 1) != 0) ||
+        (getsockname(lfd, (struct sockaddr *)&a, &len) != 0)) {
+        return -1;
+    }
+    int c = socket(AF_INET, SOCK_STREAM, 0);
+    if ((c < 0) || (connect(c, (struct sockaddr *)&a, len) != 0)) {
+        close(lfd);
+        return -1;
+    }
+    *peer = accept(lfd, NULL, NULL);
+    close(lfd);
+    return c;
+}
+
+/* Read exactly len bytes and compare them with the fill byte */
+static int recv_fill(int fd, size_t len, unsigned char fill)
+{
+    static unsigned char in[CHUNK];
+    size_t got = 0U;
+    int same = 1;
+    while (got < len) {
+        size_t want = len - got;
+        ssize_t n = recv(fd, in, (want < sizeof(in)) ? want : sizeof(in), 0);
+        if (n <= 0) {
+            return 0;
+        }
+        for (ssize_t i = 0; i < n; i++) {
+            if (in[i] != fill) {
+                same = 0;
+            }
+        }
+        got += (size_t)n;
+    }
+    return same;
+}
+
+static uint32_t small_in_use(void)
+{
+    ftp_buffer_class_stats_t st[FTP_BUFFER_CLASSES];
+    ftp_buffer_get_stats(st);
+    return st[FTP_BUFFER_SMALL].in_use;
+}
+
+static void test_off(void)
+{
+    pal_zc_t zc;
+    pal_zc_begin(&zc, -1);
+    CHECK(zc.fd == -1, "no socket: off");
+    CHECK(pal_zc_usable(&zc) == 0, "off is not usable");
+    int parked = 1;
+    char b[16] = {0};
+    CHECK(pal_zc_send(&zc, b, sizeof(b), b, &parked) < 0, "send refused");
+    CHECK(parked == 0, "nothing parked");
+    void *out[FTP_ZEROCOPY_INFLIGHT];
+    CHECK(pal_zc_reap(&zc, 0U, out, FTP_ZEROCOPY_INFLIGHT) == 0U, "no reap");
+    CHECK(pal_zc_end(&zc, 0U, out) == 0U, "no end");
+}
+
+static void test_tracker(void)
+{
+    int peer = -1;
+    int fd = loopback_pair(&peer);
+    if ((fd < 0) || (peer < 0)) {
+        printf("zerocopy: no loopback\n");
+        failures++;
+        return;
+    }
+
+    pal_zc_t zc;
+    pal_zc_begin(&zc, fd);
+    if (zc.fd < 0) {
+        printf("zerocopy: SO_ZEROCOPY unsupported, tracker skipped\n");
+        close(fd);
+        close(peer);
+        return;
+    }
+    CHECK(pal_zc_usable(&zc) == 1, "usable");
+
+    static unsigned char a[CHUNK];
+    static unsigned char b[CHUNK];
+    memset(a, 'a', sizeof(a));
+    memset(b, 'b', sizeof(b));
+    int parked = 0;
+    CHECK(pal_zc_send(&zc, a, sizeof(a), a, &parked) == (ssize_t)sizeof(a),
+          "send a");
+    CHECK((parked == 1) && (zc.parked == 1U), "a parked");
+    CHECK(pal_zc_send(&zc, b, sizeof(b), b, &parked) == (ssize_t)sizeof(b),
+          "send b");
+    CHECK(zc.parked == 2U, "b parked");
+    CHECK(zc.bytes == 2U * CHUNK, "bytes counted");
+
+    CHECK(recv_fill(peer, sizeof(a), 'a'), "a intact");
+    CHECK(recv_fill(peer, sizeof(b), 'b'), "b intact");
+
+    void *out[FTP_ZEROCOPY_INFLIGHT];
+    uint32_t n = 0U;
+    while (n < 2U) {
+        uint32_t got = pal_zc_reap(&zc, 2000U, out + n,
+                                   FTP_ZEROCOPY_INFLIGHT - n);
+        if (got == 0U) {
+            break;
+        }
+        n += got;
+    }
+    CHECK(n == 2U, "both owners back");
+    CHECK((out[0] == a) && (out[1] == b), "oldest first");
+    CHECK(zc.parked == 0U, "nothing left");
+    CHECK(zc.done_seq == zc.next_seq, "every send completed");
+
+    /* Loopback delivers by copying: no more zerocopy on this socket */
+    CHECK(zc.copied > 0U, "loopback completions are copies");
+    CHECK(pal_zc_usable(&zc) == 0, "off after a copied completion");
+
+    CHECK(pal_zc_end(&zc, 0U, out) == 0U, "end: nothing parked");
+    CHECK((zc.fd == -1) && (zc.aborted == 0U), "ended cleanly");
+    close(fd);
+    close(peer);
+}
+
+static void test_session(void)
+{
+    int ctrl[2];
+    int peer = -1;
+    int fd = loopback_pair(&peer);
+    if ((fd < 0) || (peer < 0) ||
+        (socketpair(AF_UNIX, SOCK_STREAM, 0, ctrl) != 0)) {
+        failures++;
+        return;
+    }
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    (void)inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+    static ftp_session_t session;
+    if (ftp_session_init(&session, ctrl[0], &addr, 1U, "/tmp") != FTP_OK) {
+        failures++;
+        return;
+    }
+    session.data_fd = fd;
+    pal_zc_begin(&session.zc, fd);
+    int zc_on = (session.zc.fd >= 0);
+    uint32_t base = small_in_use();
+
+    size_t cap = 0U;
+    void *buf = ftp_buffer_acquire_size(CHUNK, &cap);
+    CHECK((buf != NULL) && (cap >= CHUNK), "pool buffer");
+    if (buf == NULL) {
+        return;
+    }
+
+    /* Below FTP_ZEROCOPY_MIN: a plain send, the buffer stays */
+    void *before = buf;
+    memset(buf, 's', 100U);
+    CHECK(ftp_session_send_buffer(&session, &buf, cap, 100U) == 100,
+          "small send");
+    CHECK(buf == before, "small send keeps the buffer");
+    CHECK(recv_fill(peer, 100U, 's'), "small intact");
+
+    /* Large: handed to the kernel, replaced by a fresh buffer */
+    memset(buf, 'L', CHUNK);
+    CHECK(ftp_session_send_buffer(&session, &buf, cap, CHUNK) ==
+              (ssize_t)CHUNK,
+          "large send");
+    if (zc_on) {
+        CHECK((buf != before) && (buf != NULL), "buffer swapped");
+        CHECK(session.zc.parked == 1U, "old buffer parked");
+        CHECK(small_in_use() == base + 2U, "both buffers held");
+    }
+    /* Scribbling over the new buffer cannot reach the wire */
+    memset(buf, 'X', CHUNK);
+    CHECK(recv_fill(peer, CHUNK, 'L'), "large intact");
+    CHECK(ftp_session_send_buffer(&session, &buf, cap, CHUNK) ==
+              (ssize_t)CHUNK,
+          "second large send");
+    CHECK(recv_fill(peer, CHUNK, 'X'), "second intact");
+
+    ftp_session_close_data_connection(&session);
+    CHECK(session.zc.fd == -1, "tracker off after close");
+    CHECK(session.zc.parked == 0U, "nothing parked after close");
+    ftp_buffer_release(buf);
+    CHECK(small_in_use() == base, "every buffer back in the pool");
+
+    close(peer);
+    close(ctrl[1]);
+}
+
+int main(void)
+{
+#if !FTP_ZEROCOPY
+    printf("zerocopy: skipped (FTP_ZEROCOPY=0)\n");
+    return 0;
+#else
+    test_off();
+    test_tracker();
+    test_session();
+
+    if (failures != 0) {
+        printf("zerocopy: %d failure(s)\n", failures);
+        return 1;
+    }
+    printf("zerocopy: OK\n");
+    return 0;
+#endif
+}
@@ -0,0 +1,222 @@
+#include "ftp_config.h"
+#include <stdio.h>
+
+#if FTP_ENABLE_MODEZ
+
+#include "ftp_zstream.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Growable in-memory "wire" */
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    size_t rd;
+    size_t max_read;    /* source hands out at most this many bytes */
+} wire_t;
+
+static ssize_t wire_sink(void *ctx, const void *buf, size_t len)
+{
+    wire_t *w = (wire_t *)ctx;
+    if (w->len + len > w->cap) {
+        size_t cap = (w->cap == 0U) ? 65536U : w->cap;
+        while (cap < w->len + len) {
+            cap *= 2U;
+        }
+        uint8_t *p = realloc(w->data, cap);
+        if (p == NULL) {
+            return -1;
+        }
+        w->data = p;
+        w->cap = cap;
+    }
+    memcpy(w->data + w->len, buf, len);
+    w->len += len;
+    return (ssize_t)len;
+}
+
+static ssize_t wire_source(void *ctx, void *buf, size_t len)
+{
+    wire_t *w = (wire_t *)ctx;
+    size_t n = w->len - w->rd;
+    if (n > len) {
+        n = len;
+    }
+    if ((w->max_read != 0U) && (n > w->max_read)) {
+        n = w->max_read;
+    }
+    memcpy(buf, w->data + w->rd, n);
+    w->rd += n;
+    return (ssize_t)n;
+}
+
+/* Deflate @p len bytes in odd-sized writes, inflate them back, compare */
+static int roundtrip(const uint8_t *src, size_t len, wire_t *w, int *level)
+{
+    ftp_zstream_t *d = ftp_zstream_create(FTP_ZSTREAM_DEFLATE, FTP_MODEZ_LEVEL);
+    if (d == NULL) {
+        return -1;
+    }
+    size_t off = 0U;
+    while (off < len) {
+        size_t n = len - off;
+        if (n > 7777U) {
+            n = 7777U;
+        }
+        if (ftp_zstream_write(d, src + off, n, wire_sink, w) != (ssize_t)n) {
+            ftp_zstream_destroy(d);
+            return -2;
+        }
+        off += n;
+    }
+    if (ftp_zstream_finish(d, wire_sink, w) != 0) {
+        ftp_zstream_destroy(d);
+        return -3;
+    }
+    ftp_zstream_stats(d, NULL, NULL, level);
+    ftp_zstream_destroy(d);
+
+    ftp_zstream_t *inf = ftp_zstream_create(FTP_ZSTREAM_INFLATE, 0);
+    if (inf == NULL) {
+        return -4;
+    }
+    uint8_t *out = malloc(len + 1U);
+    size_t got = 0U;
+    for (;;) {
+        uint8_t tmp[3000];
+        ssize_t n = ftp_zstream_read(inf, tmp, sizeof(tmp), wire_source, w);
+        if (n < 0) {
+            free(out);
+            ftp_zstream_destroy(inf);
+            return -5;
+        }
+        if (n == 0) {
+            break;
+        }
+        if (got + (size_t)n > len) {
+            free(out);
+            ftp_zstream_destroy(inf);
+            return -6;
+        }
+        memcpy(out + got, tmp, (size_t)n);
+        got += (size_t)n;
+    }
+    ftp_zstream_destroy(inf);
+    int rc = ((got == len) && (memcmp(out, src, len) == 0)) ? 0 : -7;
+    free(out);
+    return rc;
+}
+
+int main(void)
+{
+    /* Controller: incompressible window -> stored, then re-probe */
+    ftp_zadapt_t a;
+    ftp_zadapt_init(&a, 6);
+    a.win_in = 1000U;
+    a.win_out = 990U;
+    if (ftp_zadapt_window(&a) != 0) {
+        return 1;
+    }
+    for (uint32_t i = 1U; i < FTP_MODEZ_PROBE_WINDOWS; i++) {
+        if (ftp_zadapt_window(&a) != 0) {
+            return 2;
+        }
+    }
+    if (ftp_zadapt_window(&a) != 1) {
+        return 3;
+    }
+
+    /* CPU-bound: level drops; link-bound: level rises, both clamped */
+    ftp_zadapt_init(&a, FTP_MODEZ_LEVEL_MIN);
+    a.win_in = 1000U;
+    a.win_out = 100U;
+    a.win_deflate_ns = 1000U;
+    a.win_sink_ns = 1U;
+    if (ftp_zadapt_window(&a) != FTP_MODEZ_LEVEL_MIN) {
+        return 4;
+    }
+    ftp_zadapt_init(&a, 5);
+    a.win_in = 1000U;
+    a.win_out = 100U;
+    a.win_deflate_ns = 1000U;
+    a.win_sink_ns = 10U;
+    if (ftp_zadapt_window(&a) != 4) {
+        return 5;
+    }
+    a.win_in = 1000U;
+    a.win_out = 100U;
+    a.win_deflate_ns = 10U;
+    a.win_sink_ns = 1000U;
+    if (ftp_zadapt_window(&a) != 5) {
+        return 6;
+    }
+
+    /* Text round trip compresses */
+    size_t len = 4U * (size_t)FTP_MODEZ_WINDOW_BYTES;
+    uint8_t *text = malloc(len);
+    if (text == NULL) {
+        return 7;
+    }
+    for (size_t i = 0U; i < len; i++) {
+        text[i] = (uint8_t)"-rw-r--r-- 1 ftp ftp 4096 save.dat\r\n"[i % 36U];
+    }
+    wire_t w = {0};
+    w.max_read = 1000U;
+    int level = -1;
+    int rc = roundtrip(text, len, &w, &level);
+    if (rc != 0) {
+        fprintf(stderr, "text roundtrip %d\n", rc);
+        return 8;
+    }
+    if (w.len * 10U > len) {
+        fprintf(stderr, "text ratio %zu/%zu\n", w.len, len);
+        return 9;
+    }
+
+    /* Random data switches the stream to stored blocks and still decodes */
+    uint32_t x = 0x12345678U;
+    for (size_t i = 0U; i < len; i++) {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        text[i] = (uint8_t)x;
+    }
+    free(w.data);
+    memset(&w, 0, sizeof(w));
+    rc = roundtrip(text, len, &w, &level);
+    if (rc != 0) {
+        fprintf(stderr, "random roundtrip %d\n", rc);
+        return 10;
+    }
+    if (level != 0) {
+        fprintf(stderr, "random level %d\n", level);
+        return 11;
+    }
+
+    /* Corrupt input is reported, not looped on */
+    memset(w.data, 0xFF, 64U);
+    w.rd = 0U;
+    ftp_zstream_t *inf = ftp_zstream_create(FTP_ZSTREAM_INFLATE, 0);
+    uint8_t tmp[256];
+    if (ftp_zstream_read(inf, tmp, sizeof(tmp), wire_source, &w) >= 0) {
+        return 12;
+    }
+    ftp_zstream_destroy(inf);
+
+    free(w.data);
+    free(text);
+    printf("zstream: OK\n");
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("zstream: skipped (FTP_ENABLE_MODEZ=0)\n");
+    return 0;
+}
+
+#endif
@@ -2,20 +2,35 @@
 """
 Generate embedded HTTP resources from web/ directory.
 
+Every UI file is embedded as identity bytes plus precompressed variants:
+gzip always, brotli when the `brotli` Python module is installed.  A
+variant is kept only if it saves at least MIN_SAVING_PCT of the identity
+size, so images stay identity-only.  Each asset also gets a strong ETag
+from the SHA-256 of its identity bytes; files with identical content
+(e.g. the logo at / and at assets/) share one set of arrays.
+
 Usage:
   python3 tools/generate_resources.py > src/http_resources.c
 """
 
+import gzip
+import hashlib
 import os
-import sys
 
-def file_to_c_array(filepath, varname):
-    with open(filepath, "rb") as f:
-        data = f.read()
+try:
+    import brotli
+except ImportError:
+    brotli = None
+
+# Legacy copies and editor backups are not part of the UI
+SKIP_SUFFIXES = ('.bak', '.legacy', '~')
+MIN_SAVING_PCT = 10
+ETAG_HEX_DIGITS = 16
 
-    print(f"/* {os.path.basename(filepath)} - {len(data)} bytes */")
-    print(f"static const unsigned char {varname}[] = {{")
 
+def c_array(varname, data, comment):
+    print(f"/* {comment} */")
+    print(f"static const unsigned char {varname}[] = {{")
     for i in range(0, len(data), 12):
         chunk = data[i : i + 12]
         items = ", ".join(f"0x{b:02x}" for b in chunk)
@@ -23,43 +38,82 @@ def file_to_c_array(filepath, varname):
             print(f"    {items},")
         else:
             print(f"    {items}")
-
     print("};")
     print()
 
-    return len(data)
+
+def worth_it(encoded, identity):
+    return len(encoded) * 100 <= len(identity) * (100 - MIN_SAVING_PCT)
+
+
+def collect(web_dir):
+    paths = []
+    for root, dirs, files in os.walk(web_dir):
+        dirs.sort()
+        for name in sorted(files):
+            if name.startswith('.') or name.endswith(SKIP_SUFFIXES):
+                continue
+            full = os.path.join(root, name)
+            rel = os.path.relpath(full, web_dir).replace(os.sep, '/')
+            paths.append((rel, full))
+    return paths
+
 
 def main():
     web_dir = os.path.join(os.path.dirname(__file__), '..', 'web')
-    
-    print("/* Auto-generated HTTP resources */")
-    print("#include <stddef.h>")
+
+    print("/* Auto-generated HTTP resources (tools/generate_resources.py) */")
+    print('#include "http_resources.h"')
     print("#include <string.h>")
     print()
-    print("const char *http_get_resource(const char *path, size_t *size);")
+
+    blobs = {}   # sha256 -> (varname, hash, has_gz, has_br)
+    entries = []
+
+    for rel, full in collect(web_dir):
+        with open(full, "rb") as f:
+            data = f.read()
+        digest = hashlib.sha256(data).hexdigest()
+
+        if digest not in blobs:
+            varname = "res_" + "".join(c if c.isalnum() else "_" for c in rel)
+            c_array(varname, data, f"{rel} - {len(data)} bytes")
+
+            gz = gzip.compress(data, compresslevel=9, mtime=0)
+            has_gz = worth_it(gz, data)
+            if has_gz:
+                c_array(varname + "_gz", gz, f"{rel} gzip - {len(gz)} bytes")
+
+            has_br = False
+            if brotli is not None:
+                br = brotli.compress(data, quality=11)
+                has_br = worth_it(br, data)
+                if has_br:
+                    c_array(varname + "_br", br, f"{rel} br - {len(br)} bytes")
+
+            blobs[digest] = (varname, digest[:ETAG_HEX_DIGITS], has_gz, has_br)
+
+        entries.append((rel, blobs[digest]))
+
+    print("static const http_resource_t k_resources[] = {")
+    for rel, (varname, tag, has_gz, has_br) in entries:
+        gz = f"{varname}_gz, sizeof({varname}_gz)" if has_gz else "NULL, 0U"
+        br = f"{varname}_br, sizeof({varname}_br)" if has_br else "NULL, 0U"
+        print(f"    {{\"{rel}\", \"{tag}\", {varname}, sizeof({varname}),")
+        print(f"     {gz}, {br}}},")
+    print("};")
     print()
-    
-    resources = []
-    
-    for filename in ['index.html', 'style.css', 'app.js', 'zftpd-logo.png']:
-        filepath = os.path.join(web_dir, filename)
-        if not os.path.exists(filepath):
-            continue
-        
-        varname = filename.replace('.', '_').replace('-', '_')
-        size = file_to_c_array(filepath, varname)
-        resources.append((filename, varname, size))
-    
-    print("const char *http_get_resource(const char *path, size_t *size) {")
-    
-    for filename, varname, fsize in resources:
-        print(f"    if (strcmp(path, \"{filename}\") == 0) {{")
-        print(f"        *size = sizeof({varname});")
-        print(f"        return (const char *){varname};")
-        print(f"    }}")
-    
-    print("    return NULL;")
+
+    print("int http_resource_get(const char *path, const http_resource_t **out) {")
+    print("    for (size_t i = 0; i < sizeof(k_resources) / sizeof(k_resources[0]); i++) {")
+    print("        if (strcmp(path, k_resources[i].path) == 0) {")
+    print("            *out = &k_resources[i];")
+    print("            return 0;")
+    print("        }")
+    print("    }")
+    print("    return -1;")
     print("}")
 
+
 if __name__ == '__main__':
     main()
@@ -0,0 +1,840 @@
+/*
+MIT License
+
+Copyright (c) 2026 Seregon
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+/**
+ * @file zftpd_load.c
+ * @brief Multi-session FTP / zhttpd load generator
+ *
+ * One thread per session, each holding a logged-in control connection
+ * and picking operations from a weighted mix until the run ends:
+ *
+ *   retr   PASV + RETR of a random file from the MLSD of -d
+ *   stor   PASV + STOR of -s bytes into -d, then DELE (not timed)
+ *   list   PASV + LIST of -d
+ *   churn  connect, USER/PASS, QUIT on a fresh control connection
+ *   http   GET /api/list?path=<-d> on the zhttpd port (-W)
+ *
+ *   zftpd-load -H 192.168.1.50 -p 2121 -c 200 -t 30 \
+ *              -m retr=60,list=20,stor=10,churn=10 -d /data/small
+ *
+ * Latencies go into per-thread log-linear histograms (16 sub-buckets
+ * per power of two, ~6% resolution) merged when the run ends, and are
+ * reported per operation as p50/p99/p999 with ops/s and MB/s.  -j
+ * prints the same as one JSON object per line.  A failed operation
+ * counts as an error and the session reconnects before going on.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 /* SIGPIPE is ignored instead */
+#endif
+
+#define LOAD_MAX_SESSIONS 4096U
+#define LOAD_MAX_FILES 4096U
+#define LOAD_NAME_MAX 256U
+#define LOAD_LINE_MAX 1024U
+#define LOAD_IO_SIZE (256U * 1024U)
+#define LOAD_SINK_SIZE (64U * 1024U) /* on the worker stack */
+#define LOAD_TIMEOUT_SEC 15
+#define LOAD_THREAD_STACK (256U * 1024U)
+
+/* Log-linear histogram in microseconds: values < 16 exact, then 16
+ * sub-buckets per power of two */
+#define HIST_SUB_BITS 4U
+#define HIST_SUB (1U << HIST_SUB_BITS)
+#define HIST_BUCKETS (64U * HIST_SUB)
+
+typedef enum {
+  OP_RETR = 0,
+  OP_STOR,
+  OP_LIST,
+  OP_CHURN,
+  OP_HTTP,
+  OP_COUNT,
+} load_op_t;
+
+static const char *const k_op_names[OP_COUNT] = {"retr", "stor", "list",
+                                                 "churn", "http"};
+
+typedef struct {
+  uint64_t ops;
+  uint64_t errors;
+  uint64_t bytes;
+  uint64_t hist[HIST_BUCKETS];
+} op_stats_t;
+
+typedef struct {
+  const char *host;
+  uint16_t port;
+  uint16_t http_port;
+  const char *user;
+  const char *pass;
+  const char *dir;
+  unsigned sessions;
+  unsigned seconds;
+  uint64_t stor_size;
+  unsigned weight[OP_COUNT];
+  unsigned weight_total;
+  int json;
+} load_config_t;
+
+/* Buffered control connection */
+typedef struct {
+  int fd;
+  size_t len;
+  size_t off;
+  char buf[LOAD_LINE_MAX * 4U];
+} ctrl_t;
+
+typedef struct {
+  unsigned id;
+  uint32_t seed;
+  uint64_t stor_seq;
+  ctrl_t ctrl;
+  op_stats_t stats[OP_COUNT];
+} worker_t;
+
+static load_config_t g_cfg;
+static struct sockaddr_storage g_ftp_addr;
+static socklen_t g_ftp_addr_len;
+static struct sockaddr_storage g_http_addr;
+static socklen_t g_http_addr_len;
+static atomic_int g_stop;
+static char (*g_files)[LOAD_NAME_MAX];
+static unsigned g_file_count;
+static uint8_t g_payload[LOAD_IO_SIZE];
+
+/*===========================================================================*
+ * TIME / HISTOGRAM
+ *===========================================================================*/
+
+static uint64_t now_us(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000ULL) + ((uint64_t)ts.tv_nsec / 1000U);
+}
+
+static unsigned hist_index(uint64_t us) {
+  if (us < HIST_SUB) {
+    return (unsigned)us;
+  }
+  unsigned msb = 63U - (unsigned)__builtin_clzll(us);
+  unsigned sub = (unsigned)(us >> (msb - HIST_SUB_BITS)) & (HIST_SUB - 1U);
+  unsigned idx = ((msb - HIST_SUB_BITS + 1U) * HIST_SUB) + sub;
+  return (idx < HIST_BUCKETS) ? idx : HIST_BUCKETS - 1U;
+}
+
+/* Midpoint of a bucket */
+static uint64_t hist_value(unsigned idx) {
+  if (idx < HIST_SUB) {
+    return idx;
+  }
+  unsigned shift = (idx / HIST_SUB) - 1U;
+  uint64_t low = (uint64_t)(HIST_SUB + (idx % HIST_SUB)) << shift;
+  return low + (((uint64_t)1U << shift) / 2U);
+}
+
+static uint64_t hist_percentile(const op_stats_t *s, double pct) {
+  if (s->ops == 0U) {
+    return 0U;
+  }
+  uint64_t rank = (uint64_t)(((double)s->ops * pct) + 0.999999);
+  uint64_t seen = 0U;
+  for (unsigned i = 0U; i < HIST_BUCKETS; i++) {
+    seen += s->hist[i];
+    if ((seen >= rank) && (s->hist[i] != 0U)) {
+      return hist_value(i);
+    }
+  }
+  return hist_value(HIST_BUCKETS - 1U);
+}
+
+static void record(worker_t *w, load_op_t op, uint64_t t0, uint64_t bytes,
+                   int ok) {
+  op_stats_t *s = &w->stats[op];
+  if (!ok) {
+    s->errors++;
+    return;
+  }
+  s->ops++;
+  s->bytes += bytes;
+  s->hist[hist_index(now_us() - t0)]++;
+}
+
+static uint32_t xs32(uint32_t *s) {
+  uint32_t x = *s;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *s = x;
+  return x;
+}
+
+/*===========================================================================*
+ * SOCKETS / CONTROL CHANNEL
+ *===========================================================================*/
+
+static int dial(const struct sockaddr *addr, socklen_t len) {
+  int fd = socket(addr->sa_family, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  struct timeval tv = {LOAD_TIMEOUT_SEC, 0};
+  (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  (void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  int one = 1;
+  (void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  if (connect(fd, addr, len) != 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+static int send_all(int fd, const void *data, size_t len) {
+  const uint8_t *p = (const uint8_t *)data;
+  while (len > 0U) {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    p += (size_t)n;
+    len -= (size_t)n;
+  }
+  return 0;
+}
+
+/* One CRLF-terminated line (CR/LF stripped) */
+static int ctrl_line(ctrl_t *c, char *out, size_t size) {
+  size_t n = 0U;
+  for (;;) {
+    if (c->off == c->len) {
+      ssize_t r = recv(c->fd, c->buf, sizeof(c->buf), 0);
+      if (r <= 0) {
+        if ((r < 0) && (errno == EINTR)) {
+          continue;
+        }
+        return -1;
+      }
+      c->len = (size_t)r;
+      c->off = 0U;
+    }
+    char ch = c->buf[c->off++];
+    if (ch == '\n') {
+      if ((n > 0U) && (out[n - 1U] == '\r')) {
+        n--;
+      }
+      out[n] = '\0';
+      return 0;
+    }
+    if (n + 1U < size) {
+      out[n++] = ch;
+    }
+  }
+}
+
+/*
+ * Read a complete (possibly multiline) reply.
+ *
+ * @return reply code, or -1 on a closed / timed out connection.  The
+ *         final line is left in @p last when non-NULL.
+ */
+static int ctrl_reply(ctrl_t *c, char *last, size_t size) {
+  char line[LOAD_LINE_MAX];
+  if (ctrl_line(c, line, sizeof(line)) != 0) {
+    return -1;
+  }
+  if ((strlen(line) < 3U) || (line[0] < '1') || (line[0] > '5')) {
+    return -1;
+  }
+  int code = atoi(line);
+  if (line[3] == '-') {
+    char end[5];
+    (void)snprintf(end, sizeof(end), "%03d ", code);
+    do {
+      if (ctrl_line(c, line, sizeof(line)) != 0) {
+        return -1;
+      }
+    } while (strncmp(line, end, 4U) != 0);
+  }
+  if (last != NULL) {
+    (void)snprintf(last, size, "%s", line);
+  }
+  return code;
+}
+
+static int ctrl_cmd(ctrl_t *c, const char *cmd, const char *arg, char *last,
+                    size_t size) {
+  char line[LOAD_LINE_MAX];
+  int n = (arg != NULL) ? snprintf(line, sizeof(line), "%s %s\r\n", cmd, arg)
+                        : snprintf(line, sizeof(line), "%s\r\n", cmd);
+  if ((n < 0) || ((size_t)n >= sizeof(line)) ||
+      (send_all(c->fd, line, (size_t)n) != 0)) {
+    return -1;
+  }
+  return ctrl_reply(c, last, size);
+}
+
+static void ctrl_close(ctrl_t *c) {
+  if (c->fd >= 0) {
+    close(c->fd);
+  }
+  c->fd = -1;
+  c->len = 0U;
+  c->off = 0U;
+}
+
+/* Connect, log in and switch to binary */
+static int ctrl_open(ctrl_t *c) {
+  c->len = 0U;
+  c->off = 0U;
+  c->fd = dial((const struct sockaddr *)&g_ftp_addr, g_ftp_addr_len);
+  if (c->fd < 0) {
+    return -1;
+  }
+  int code = ctrl_reply(c, NULL, 0U);
+  if (code != 220) {
+    ctrl_close(c);
+    return -1;
+  }
+  code = ctrl_cmd(c, "USER", g_cfg.user, NULL, 0U);
+  if (code == 331) {
+    code = ctrl_cmd(c, "PASS", g_cfg.pass, NULL, 0U);
+  }
+  if ((code != 230) || (ctrl_cmd(c, "TYPE", "I", NULL, 0U) != 200)) {
+    ctrl_close(c);
+    return -1;
+  }
+  return 0;
+}
+
+/* PASV + connect; the data socket, or -1 */
+static int ctrl_pasv(ctrl_t *c) {
+  char last[LOAD_LINE_MAX];
+  if (ctrl_cmd(c, "PASV", NULL, last, sizeof(last)) != 227) {
+    return -1;
+  }
+  const char *p = strchr(last, '(');
+  unsigned p1, p2;
+  if ((p == NULL) ||
+      (sscanf(p + 1, "%*u,%*u,%*u,%*u,%u,%u", &p1, &p2) != 2) ||
+      (p1 > 255U) || (p2 > 255U)) {
+    return -1;
+  }
+  /* Same host as the control connection, like most clients behind NAT */
+  struct sockaddr_storage addr = g_ftp_addr;
+  uint16_t port = htons((uint16_t)((p1 << 8) | p2));
+  if (addr.ss_family == AF_INET) {
+    ((struct sockaddr_in *)&addr)->sin_port = port;
+  } else {
+    ((struct sockaddr_in6 *)&addr)->sin6_port = port;
+  }
+  return dial((const struct sockaddr *)&addr, g_ftp_addr_len);
+}
+
+/*===========================================================================*
+ * OPERATIONS
+ *===========================================================================*/
+
+static int drain(int fd, uint64_t *bytes) {
+  uint8_t sink[LOAD_SINK_SIZE];
+  for (;;) {
+    ssize_t n = recv(fd, sink, sizeof(sink), 0);
+    if (n > 0) {
+      *bytes += (uint64_t)n;
+    } else if (n == 0) {
+      return 0;
+    } else if (errno != EINTR) {
+      return -1;
+    }
+  }
+}
+
+/* RETR or LIST: PASV, command, drain, expect 226 */
+static int op_download(worker_t *w, const char *cmd, const char *arg,
+                       uint64_t *bytes) {
+  int data = ctrl_pasv(&w->ctrl);
+  if (data < 0) {
+    return -1;
+  }
+  int code = ctrl_cmd(&w->ctrl, cmd, arg, NULL, 0U);
+  if ((code != 150) && (code != 125)) {
+    close(data);
+    return -1;
+  }
+  int rc = drain(data, bytes);
+  close(data);
+  return ((rc == 0) && (ctrl_reply(&w->ctrl, NULL, 0U) == 226)) ? 0 : -1;
+}
+
+static int op_stor(worker_t *w, uint64_t *bytes) {
+  char name[LOAD_NAME_MAX];
+  (void)snprintf(name, sizeof(name), "%s%s.zload-%ld-%u-%llu", g_cfg.dir,
+                 (g_cfg.dir[strlen(g_cfg.dir) - 1U] == '/') ? "" : "/",
+                 (long)getpid(), w->id, (unsigned long long)w->stor_seq++);
+  int data = ctrl_pasv(&w->ctrl);
+  if (data < 0) {
+    return -1;
+  }
+  int code = ctrl_cmd(&w->ctrl, "STOR", name, NULL, 0U);
+  if ((code != 150) && (code != 125)) {
+    close(data);
+    return -1;
+  }
+  uint64_t left = g_cfg.stor_size;
+  int rc = 0;
+  while ((left > 0U) && (rc == 0)) {
+    size_t n = (left < sizeof(g_payload)) ? (size_t)left : sizeof(g_payload);
+    rc = send_all(data, g_payload, n);
+    left -= n;
+  }
+  close(data);
+  if ((rc != 0) || (ctrl_reply(&w->ctrl, NULL, 0U) != 226)) {
+    return -1;
+  }
+  *bytes = g_cfg.stor_size;
+  return (ctrl_cmd(&w->ctrl, "DELE", name, NULL, 0U) == 250) ? 0 : -1;
+}
+
+static int op_churn(uint64_t *t0) {
+  ctrl_t c;
+  *t0 = now_us();
+  if (ctrl_open(&c) != 0) {
+    return -1;
+  }
+  int code = ctrl_cmd(&c, "QUIT", NULL, NULL, 0U);
+  ctrl_close(&c);
+  return (code == 221) ? 0 : -1;
+}
+
+static int op_http(uint64_t *bytes) {
+  char req[LOAD_LINE_MAX];
+  int n = snprintf(req, sizeof(req),
+                   "GET /api/list?path=%s HTTP/1.1\r\nHost: %s\r\n"
+                   "Connection: close\r\n\r\n",
+                   g_cfg.dir, g_cfg.host);
+  if ((n < 0) || ((size_t)n >= sizeof(req))) {
+    return -1;
+  }
+  int fd = dial((const struct sockaddr *)&g_http_addr, g_http_addr_len);
+  if (fd < 0) {
+    return -1;
+  }
+  char head[16];
+  ssize_t got = -1;
+  if (send_all(fd, req, (size_t)n) == 0) {
+    got = recv(fd, head, sizeof(head) - 1U, 0);
+  }
+  if (got < 12) {
+    close(fd);
+    return -1;
+  }
+  head[got] = '\0';
+  *bytes = (uint64_t)got;
+  int rc = drain(fd, bytes);
+  close(fd);
+  return ((rc == 0) && (strncmp(head + 9, "200", 3U) == 0)) ? 0 : -1;
+}
+
+static load_op_t pick_op(worker_t *w) {
+  unsigned r = xs32(&w->seed) % g_cfg.weight_total;
+  for (unsigned i = 0U; i < OP_COUNT; i++) {
+    if (r < g_cfg.weight[i]) {
+      return (load_op_t)i;
+    }
+    r -= g_cfg.weight[i];
+  }
+  return OP_CHURN;
+}
+
+static void *worker_main(void *arg) {
+  worker_t *w = (worker_t *)arg;
+  w->ctrl.fd = -1;
+
+  while (atomic_load(&g_stop) == 0) {
+    load_op_t op = pick_op(w);
+    int needs_ctrl = (op == OP_RETR) || (op == OP_STOR) || (op == OP_LIST);
+    if (needs_ctrl && (w->ctrl.fd < 0) && (ctrl_open(&w->ctrl) != 0)) {
+      w->stats[op].errors++;
+      usleep(10000U);
+      continue;
+    }
+
+    uint64_t t0 = now_us();
+    uint64_t bytes = 0U;
+    int rc = -1;
+    switch (op) {
+    case OP_RETR:
+      if (g_file_count > 0U) {
+        rc = op_download(w, "RETR", g_files[xs32(&w->seed) % g_file_count],
+                         &bytes);
+      }
+      break;
+    case OP_STOR:
+      rc = op_stor(w, &bytes);
+      break;
+    case OP_LIST:
+      rc = op_download(w, "LIST", g_cfg.dir, &bytes);
+      break;
+    case OP_CHURN:
+      rc = op_churn(&t0);
+      break;
+    default:
+      rc = op_http(&bytes);
+      break;
+    }
+    if ((rc != 0) && (atomic_load(&g_stop) != 0)) {
+      break; /* interrupted by the end of the run, not a failure */
+    }
+    record(w, op, t0, bytes, rc == 0);
+    if ((rc != 0) && needs_ctrl) {
+      ctrl_close(&w->ctrl);
+    }
+  }
+  if (w->ctrl.fd >= 0) {
+    (void)ctrl_cmd(&w->ctrl, "QUIT", NULL, NULL, 0U);
+    ctrl_close(&w->ctrl);
+  }
+  return NULL;
+}
+
+/*===========================================================================*
+ * SETUP
+ *===========================================================================*/
+
+static int resolve(const char *host, uint16_t port,
+                   struct sockaddr_storage *out, socklen_t *len) {
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+  char svc[8];
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  (void)snprintf(svc, sizeof(svc), "%u", (unsigned)port);
+  if ((getaddrinfo(host, svc, &hints, &res) != 0) || (res == NULL)) {
+    return -1;
+  }
+  memcpy(out, res->ai_addr, res->ai_addrlen);
+  *len = res->ai_addrlen;
+  freeaddrinfo(res);
+  return 0;
+}
+
+/* RETR candidates: regular files from an MLSD of the target directory */
+static int load_file_list(void) {
+  ctrl_t c;
+  if (ctrl_open(&c) != 0) {
+    return -1;
+  }
+  g_files = calloc(LOAD_MAX_FILES, LOAD_NAME_MAX);
+  int data = (g_files != NULL) ? ctrl_pasv(&c) : -1;
+  if (data < 0) {
+    ctrl_close(&c);
+    return -1;
+  }
+  int code = ctrl_cmd(&c, "MLSD", g_cfg.dir, NULL, 0U);
+  if ((code != 150) && (code != 125)) {
+    close(data);
+    ctrl_close(&c);
+    return -1;
+  }
+  ctrl_t d = {data, 0U, 0U, {0}};
+  char line[LOAD_LINE_MAX];
+  const char *sep = (g_cfg.dir[strlen(g_cfg.dir) - 1U] == '/') ? "" : "/";
+  while ((ctrl_line(&d, line, sizeof(line)) == 0) &&
+         (g_file_count < LOAD_MAX_FILES)) {
+    const char *name = strstr(line, "; ");
+    if ((name == NULL) || (strstr(line, "type=file;") == NULL)) {
+      continue;
+    }
+    (void)snprintf(g_files[g_file_count], LOAD_NAME_MAX, "%s%s%s", g_cfg.dir,
+                   sep, name + 2);
+    g_file_count++;
+  }
+  close(data);
+  (void)ctrl_reply(&c, NULL, 0U);
+  (void)ctrl_cmd(&c, "QUIT", NULL, NULL, 0U);
+  ctrl_close(&c);
+  return 0;
+}
+
+/* "retr=60,list=20,churn=20" */
+static int parse_mix(const char *spec) {
+  char copy[256];
+  (void)snprintf(copy, sizeof(copy), "%s", spec);
+  memset(g_cfg.weight, 0, sizeof(g_cfg.weight));
+  g_cfg.weight_total = 0U;
+  char *save = NULL;
+  for (char *tok = strtok_r(copy, ",", &save); tok != NULL;
+       tok = strtok_r(NULL, ",", &save)) {
+    char *eq = strchr(tok, '=');
+    unsigned long weight = 1UL;
+    if (eq != NULL) {
+      *eq = '\0';
+      weight = strtoul(eq + 1, NULL, 10);
+    }
+    unsigned i = 0U;
+    while ((i < OP_COUNT) && (strcmp(tok, k_op_names[i]) != 0)) {
+      i++;
+    }
+    if ((i == OP_COUNT) || (weight > 1000000UL)) {
+      fprintf(stderr, "zftpd-load: bad mix entry '%s'\n", tok);
+      return -1;
+    }
+    g_cfg.weight[i] = (unsigned)weight;
+    g_cfg.weight_total += (unsigned)weight;
+  }
+  return (g_cfg.weight_total > 0U) ? 0 : -1;
+}
+
+static void usage(void) {
+  printf("Usage: zftpd-load [options]\n"
+         "  -H host    server (default 127.0.0.1)\n"
+         "  -p port    FTP port (default 2121)\n"
+         "  -u user    login (default anonymous)\n"
+         "  -w pass    password (default load@)\n"
+         "  -c n       concurrent sessions (default 16, max %u)\n"
+         "  -t secs    run time (default 10)\n"
+         "  -m mix     weighted ops: retr,stor,list,churn,http "
+         "(default retr=1)\n"
+         "  -d dir     remote directory for retr/stor/list/http (default: login dir)\n"
+         "  -s bytes   STOR size (default 1048576, k/m/g suffixes)\n"
+         "  -W port    zhttpd port for the http op\n"
+         "  -j         JSON lines instead of a table\n",
+         LOAD_MAX_SESSIONS);
+}
+
+static uint64_t parse_size(const char *s) {
+  char *end = NULL;
+  uint64_t v = strtoull(s, &end, 10);
+  switch ((end != NULL) ? *end : '\0') {
+  case 'g':
+  case 'G':
+    v <<= 10;
+    /* fall through */
+  case 'm':
+  case 'M':
+    v <<= 10;
+    /* fall through */
+  case 'k':
+  case 'K':
+    v <<= 10;
+    break;
+  default:
+    break;
+  }
+  return v;
+}
+
+static void report(const op_stats_t *total, double secs) {
+  if (!g_cfg.json) {
+    printf("%-6s %10s %8s %10s %9s %9s %9s %9s\n", "op", "ops", "errors",
+           "ops/s", "MB/s", "p50_us", "p99_us", "p999_us");
+  }
+  for (unsigned i = 0U; i < OP_COUNT; i++) {
+    const op_stats_t *s = &total[i];
+    if ((g_cfg.weight[i] == 0U) && (s->ops == 0U) && (s->errors == 0U)) {
+      continue;
+    }
+    double ops_s = (double)s->ops / secs;
+    double mb_s = ((double)s->bytes / (1024.0 * 1024.0)) / secs;
+    unsigned long long p50 = hist_percentile(s, 0.50);
+    unsigned long long p99 = hist_percentile(s, 0.99);
+    unsigned long long p999 = hist_percentile(s, 0.999);
+    if (g_cfg.json) {
+      printf("{\"op\":\"%s\",\"sessions\":%u,\"secs\":%.3f,\"ops\":%llu,"
+             "\"errors\":%llu,\"bytes\":%llu,\"ops_s\":%.1f,\"mb_s\":%.1f,"
+             "\"p50_us\":%llu,\"p99_us\":%llu,\"p999_us\":%llu}\n",
+             k_op_names[i], g_cfg.sessions, secs,
+             (unsigned long long)s->ops, (unsigned long long)s->errors,
+             (unsigned long long)s->bytes, ops_s, mb_s, p50, p99, p999);
+    } else {
+      printf("%-6s %10llu %8llu %10.1f %9.1f %9llu %9llu %9llu\n",
+             k_op_names[i], (unsigned long long)s->ops,
+             (unsigned long long)s->errors, ops_s, mb_s, p50, p99, p999);
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  memset(&g_cfg, 0, sizeof(g_cfg));
+  g_cfg.host = "127.0.0.1";
+  g_cfg.port = 2121U;
+  g_cfg.user = "anonymous";
+  g_cfg.pass = "load@";
+  g_cfg.dir = ".";
+  g_cfg.sessions = 16U;
+  g_cfg.seconds = 10U;
+  g_cfg.stor_size = 1024U * 1024U;
+  (void)parse_mix("retr=1");
+
+  int opt;
+  while ((opt = getopt(argc, argv, "H:p:u:w:c:t:m:d:s:W:jh")) != -1) {
+    switch (opt) {
+    case 'H':
+      g_cfg.host = optarg;
+      break;
+    case 'p':
+      g_cfg.port = (uint16_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'u':
+      g_cfg.user = optarg;
+      break;
+    case 'w':
+      g_cfg.pass = optarg;
+      break;
+    case 'c':
+      g_cfg.sessions = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 't':
+      g_cfg.seconds = (unsigned)strtoul(optarg, NULL, 10);
+      break;
+    case 'm':
+      if (parse_mix(optarg) != 0) {
+        return 2;
+      }
+      break;
+    case 'd':
+      g_cfg.dir = optarg;
+      break;
+    case 's':
+      g_cfg.stor_size = parse_size(optarg);
+      break;
+    case 'W':
+      g_cfg.http_port = (uint16_t)strtoul(optarg, NULL, 10);
+      break;
+    case 'j':
+      g_cfg.json = 1;
+      break;
+    default:
+      usage();
+      return (opt == 'h') ? 0 : 2;
+    }
+  }
+  if ((g_cfg.sessions == 0U) || (g_cfg.sessions > LOAD_MAX_SESSIONS) ||
+      (g_cfg.seconds == 0U) || (g_cfg.dir[0] == '\0')) {
+    usage();
+    return 2;
+  }
+  if ((g_cfg.weight[OP_HTTP] != 0U) && (g_cfg.http_port == 0U)) {
+    fprintf(stderr, "zftpd-load: the http op needs -W <port>\n");
+    return 2;
+  }
+
+  (void)signal(SIGPIPE, SIG_IGN);
+  if (resolve(g_cfg.host, g_cfg.port, &g_ftp_addr, &g_ftp_addr_len) != 0) {
+    fprintf(stderr, "zftpd-load: cannot resolve %s\n", g_cfg.host);
+    return 1;
+  }
+  if ((g_cfg.http_port != 0U) &&
+      (resolve(g_cfg.host, g_cfg.http_port, &g_http_addr, &g_http_addr_len) !=
+       0)) {
+    fprintf(stderr, "zftpd-load: cannot resolve %s\n", g_cfg.host);
+    return 1;
+  }
+  for (size_t i = 0U; i < sizeof(g_payload); i++) {
+    g_payload[i] = (uint8_t)((i * 131U) ^ (i >> 8));
+  }
+  if (g_cfg.weight[OP_RETR] != 0U) {
+    if ((load_file_list() != 0) || (g_file_count == 0U)) {
+      fprintf(stderr, "zftpd-load: no files to RETR in %s\n", g_cfg.dir);
+      return 1;
+    }
+  }
+
+  worker_t *workers = calloc(g_cfg.sessions, sizeof(worker_t));
+  pthread_t *tids = calloc(g_cfg.sessions, sizeof(pthread_t));
+  if ((workers == NULL) || (tids == NULL)) {
+    free(workers);
+    free(tids);
+    return 1;
+  }
+  pthread_attr_t attr;
+  (void)pthread_attr_init(&attr);
+  (void)pthread_attr_setstacksize(&attr, LOAD_THREAD_STACK);
+
+  uint64_t t0 = now_us();
+  unsigned started = 0U;
+  for (; started < g_cfg.sessions; started++) {
+    workers[started].id = started;
+    workers[started].seed = 0x9E3779B9U ^ ((started + 1U) * 2654435761U);
+    if (pthread_create(&tids[started], &attr, worker_main,
+                       &workers[started]) != 0) {
+      fprintf(stderr, "zftpd-load: started %u of %u sessions\n", started,
+              g_cfg.sessions);
+      break;
+    }
+  }
+  (void)pthread_attr_destroy(&attr);
+
+  struct timespec run = {(time_t)g_cfg.seconds, 0};
+  while (nanosleep(&run, &run) != 0) {
+  }
+  atomic_store(&g_stop, 1);
+  for (unsigned i = 0U; i < started; i++) {
+    (void)pthread_join(tids[i], NULL);
+  }
+  double secs = (double)(now_us() - t0) / 1e6;
+
+  static op_stats_t total[OP_COUNT];
+  for (unsigned i = 0U; i < started; i++) {
+    for (unsigned op = 0U; op < OP_COUNT; op++) {
+      const op_stats_t *s = &workers[i].stats[op];
+      total[op].ops += s->ops;
+      total[op].errors += s->errors;
+      total[op].bytes += s->bytes;
+      for (unsigned b = 0U; b < HIST_BUCKETS; b++) {
+        total[op].hist[b] += s->hist[b];
+      }
+    }
+  }
+  report(total, secs);
+
+  free(workers);
+  free(tids);
+  free(g_files);
+  return 0;
+}
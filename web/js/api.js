@@ -47,6 +47,19 @@ var ZFTPD = ZFTPD || {};
     return get('/api/list?path=' + Z.E(path));
   };
 
+  /* ── Paged listing: opts = { limit, cursor, sort, order, q } ──
+   * Resolves to { total, next, entries }; pass next back as cursor. */
+  api.listPage = function (path, opts) {
+    var url = '/api/list?path=' + Z.E(path);
+    opts = opts || {};
+    ['limit', 'cursor', 'sort', 'order', 'q'].forEach(function (k) {
+      if (opts[k] !== undefined && opts[k] !== null && opts[k] !== '') {
+        url += '&' + k + '=' + Z.E(String(opts[k]));
+      }
+    });
+    return get(url);
+  };
+
   /* ── Directory size (lazy) ── */
   api.dirsize = function (path) {
     return get('/api/dirsize?path=' + Z.E(path));
@@ -101,7 +114,9 @@ var ZFTPD = ZFTPD || {};
 
   api.del = function (path, recursive) {
     var url = '/api/delete?path=' + Z.E(path);
-    if (recursive) url += '&recursive=1';
+    // Recursive deletes run as a background job; the tree is renamed
+    // aside first so it disappears from the listing right away.
+    if (recursive) url += '&recursive=1&trash=1';
     return post(url);
   };
 
@@ -165,8 +180,11 @@ var ZFTPD = ZFTPD || {};
     return get('/api/game/meta?path=' + Z.E(path));
   };
 
-  api.gameIconUrl = function (path) {
-    return '/api/game/icon?path=' + Z.E(path);
+  /* size: edge of a cached thumbnail (64/128/256); omit for the original */
+  api.gameIconUrl = function (path, size) {
+    var u = '/api/game/icon?path=' + Z.E(path);
+    if (size) u += '&size=' + size;
+    return u;
   };
 
   /* ── Games management ── */
@@ -174,9 +192,10 @@ var ZFTPD = ZFTPD || {};
     return get('/api/admin/games/installed');
   };
 
-  api.gameInstalledIconUrl = function (id, path) {
+  api.gameInstalledIconUrl = function (id, path, size) {
     var u = '/api/admin/games/icon?id=' + Z.E(id || '');
     if (path) u += '&path=' + Z.E(path);
+    if (size) u += '&size=' + size;
     return u;
   };
 
@@ -244,6 +263,34 @@ var ZFTPD = ZFTPD || {};
     return post('/api/download/cancel', { id: id });
   };
 
+  /* ── Event stream (/api/events, Server-Sent Events) ──
+   * One shared EventSource carries every topic: copy, extract, downloads,
+   * ftp.  The server pushes a topic only when its JSON changes.
+   * Returns an unsubscribe function, or null when the browser has no
+   * EventSource (callers then fall back to polling). */
+  var _es = null;
+  var _esSubs = {};
+
+  api.events = function (topic, cb) {
+    if (typeof EventSource === 'undefined') return null;
+    if (!_es) _es = new EventSource('/api/events');
+    if (!_esSubs[topic]) {
+      _esSubs[topic] = [];
+      _es.addEventListener(topic, function (e) {
+        var d;
+        try { d = JSON.parse(e.data); } catch (x) { return; }
+        var subs = _esSubs[topic].slice();
+        for (var i = 0; i < subs.length; i++) subs[i](d);
+      });
+    }
+    _esSubs[topic].push(cb);
+    return function () {
+      var list = _esSubs[topic];
+      var idx = list.indexOf(cb);
+      if (idx >= 0) list.splice(idx, 1);
+    };
+  };
+
   Z.api = api;
 
 })(ZFTPD);
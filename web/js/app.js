@@ -300,61 +300,68 @@ var ZFTPD = ZFTPD || {};
   /* ═══════════════════════════════════════════════════════════════════════
    * DOWNLOAD PROGRESS PILL (topbar)
    *
-   * Polls /api/download/status every 2s when downloads are active.
+   * Follows the "downloads" topic of /api/events while downloads are
+   * active, falling back to polling /api/download/status every 2s.
    * Updates the pill count + aggregate progress bar.
    * ═══════════════════════════════════════════════════════════════════════ */
 
   var _dlPollTimer = null;
+  var _dlUnsub = null;
 
   function _startDlPolling() {
-    if (_dlPollTimer) return;
+    if (_dlPollTimer || _dlUnsub) return;
+    _dlUnsub = Z.api.events('downloads', _onDownloads);
+    if (_dlUnsub) return;
     _dlPollTimer = setInterval(_pollDownloads, 2000);
     _pollDownloads();
   }
 
   function _stopDlPolling() {
     if (_dlPollTimer) { clearInterval(_dlPollTimer); _dlPollTimer = null; }
+    if (_dlUnsub) { _dlUnsub(); _dlUnsub = null; }
   }
 
   function _pollDownloads() {
-    Z.api.downloadStatus().then(function (data) {
-      var items = (data && Array.isArray(data.downloads)) ? data.downloads : [];
-      var active = items.filter(function (d) { return !d.done && !d.error; });
-      var pill = $('tb-dl-pill');
-      var countEl = $('tb-dl-count');
-      var barFill = $('tb-dl-bar-fill');
-
-      if (active.length > 0) {
-        if (pill) pill.classList.remove('hidden');
-        if (countEl) countEl.textContent = active.length;
-
-        /* Calculate aggregate progress */
-        var totalDown = 0, totalSize = 0;
-        for (var i = 0; i < active.length; i++) {
-          totalDown += (active[i].downloaded || 0);
-          totalSize += (active[i].total_size || 0);
-        }
-        var pct = totalSize > 0 ? Math.floor(totalDown / totalSize * 100) : 0;
-        if (barFill) barFill.style.width = pct + '%';
-      } else {
-        if (pill) pill.classList.add('hidden');
-        _stopDlPolling();
+    Z.api.downloadStatus().then(_onDownloads).catch(function () { });
+  }
+
+  function _onDownloads(data) {
+    var items = (data && Array.isArray(data.downloads)) ? data.downloads : [];
+    var active = items.filter(function (d) { return !d.done && !d.error; });
+    var pill = $('tb-dl-pill');
+    var countEl = $('tb-dl-count');
+    var barFill = $('tb-dl-bar-fill');
+
+    if (active.length > 0) {
+      if (pill) pill.classList.remove('hidden');
+      if (countEl) countEl.textContent = active.length;
+
+      /* Calculate aggregate progress */
+      var totalDown = 0, totalSize = 0;
+      for (var i = 0; i < active.length; i++) {
+        totalDown += (active[i].downloaded || 0);
+        totalSize += (active[i].total_size || 0);
       }
+      var pct = totalSize > 0 ? Math.floor(totalDown / totalSize * 100) : 0;
+      if (barFill) barFill.style.width = pct + '%';
+    } else {
+      if (pill) pill.classList.add('hidden');
+      _stopDlPolling();
+    }
 
-      /* Notify on completed/errored downloads */
-      for (var j = 0; j < items.length; j++) {
-        var d = items[j];
-        var nKey = 'dl_notified_' + (d.id || j);
-        if (d.done && !d.error && !Z.state[nKey]) {
-          Z.state[nKey] = true;
-          Z.notify('Download complete', d.filename || d.url, 'ok');
-        }
-        if (d.error && !Z.state[nKey]) {
-          Z.state[nKey] = true;
-          Z.notify('Download failed', (d.filename || d.url) + ': ' + d.error_msg, 'er');
-        }
+    /* Notify on completed/errored downloads */
+    for (var j = 0; j < items.length; j++) {
+      var d = items[j];
+      var nKey = 'dl_notified_' + (d.id || j);
+      if (d.done && !d.error && !Z.state[nKey]) {
+        Z.state[nKey] = true;
+        Z.notify('Download complete', d.filename || d.url, 'ok');
       }
-    }).catch(function () { });
+      if (d.error && !Z.state[nKey]) {
+        Z.state[nKey] = true;
+        Z.notify('Download failed', (d.filename || d.url) + ': ' + d.error_msg, 'er');
+      }
+    }
   }
 
   /* Hook: call this from download-mgr.js when a download starts */
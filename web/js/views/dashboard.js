@@ -154,10 +154,10 @@ var ZFTPD = ZFTPD || {};
       }
 
       var iconUrl = null;
-      if (ug.meta && (ug.meta.has_icon || ug.meta.icon_base64)) {
-        iconUrl = ug.meta.icon_base64 ? ('data:image/png;base64,' + ug.meta.icon_base64) : Z.api.gameIconUrl(ug.locations[0].path);
+      if (ug.meta && ug.meta.has_icon) {
+        iconUrl = Z.api.gameIconUrl(ug.locations[0].path, 256);
         ug.coverUrl = iconUrl;
-        setHeroBanner(ug, iconUrl);
+        setHeroBanner(ug, Z.api.gameIconUrl(ug.locations[0].path));
       }
 
       var coverHtml = iconUrl ? '<img class="dash-game-cover" src="' + iconUrl + '">' : '<div class="dash-game-cover placeholder">' + ICO.gamepad + '</div>';
@@ -18,6 +18,8 @@ var ZFTPD = ZFTPD || {};
   var _view = 'grid'; /* grid | list | details */
   var _sortKey = 'name';
   var _sortAsc = true;
+  var PAGE_SIZE = 1000;
+  var _listGen = 0; /* drops replies of a superseded nav/sort/search */
 
   /* ── Navigate to directory ── */
   var _viewInitialized = false;
@@ -38,17 +40,51 @@ var ZFTPD = ZFTPD || {};
     var fl = $('file-list');
     if (fl) fl.innerHTML = '<div class="s-card"><div class="loader"></div><div>Loading\u2026</div></div>';
 
-    Z.api.list(Z.state.path).then(function (d) {
-      Z.state.entries = (d && Array.isArray(d.entries)) ? d.entries : [];
-      sortEntries();
+    Z.state.entries = [];
+    Z.state.listNext = null;
+    loadPage(false, '');
+  };
+
+  /* ── Fetch one page of the listing ──
+   * The server sorts and filters, so huge folders arrive in pieces; once
+   * every entry is loaded, sorting and search stay client-side. */
+  function loadPage(append, query) {
+    var gen = ++_listGen;
+    var fl = $('file-list');
+    Z.api.listPage(Z.state.path, {
+      limit: PAGE_SIZE,
+      cursor: append ? Z.state.listNext : null,
+      sort: _sortKey === 'ext' ? 'name' : _sortKey,
+      order: _sortAsc ? 'asc' : 'desc',
+      q: query
+    }).then(function (d) {
+      if (gen !== _listGen) return;
+      var page = (d && Array.isArray(d.entries)) ? d.entries : [];
+      Z.state.entries = append ? Z.state.entries.concat(page) : page;
+      Z.state.listNext = (d && d.next) ? d.next : null;
+      Z.state.listTotal = (d && d.total) ? d.total : Z.state.entries.length;
+      Z.state.listQuery = query;
+      if (_sortKey === 'ext') sortEntries();
       render($('search') ? $('search').value : '');
       updateStatus(true);
       updateCount();
     }).catch(function () {
+      if (gen !== _listGen) return;
       if (fl) fl.innerHTML = '<div class="s-card s-err"><div class="s-ico">' + ICO.alert + '</div><div>Failed to load directory</div></div>';
       updateStatus(false);
     });
-  };
+  }
+
+  /* Partial listing: re-query so the order/filter covers every entry */
+  function refilter() {
+    var q = $('search') ? $('search').value.trim() : '';
+    if (Z.state.listNext || Z.state.listQuery) {
+      loadPage(false, q);
+    } else {
+      sortEntries();
+      render(q);
+    }
+  }
 
   /* ── Render file list ── */
   function render(query) {
@@ -87,6 +123,17 @@ var ZFTPD = ZFTPD || {};
         fl.appendChild(card);
       }
     }
+
+    if (Z.state.listNext) {
+      var more = D.createElement('button');
+      more.className = 'btn';
+      more.textContent = 'Load more (' + Z.state.entries.length + ' / ' + Z.state.listTotal + ')';
+      more.onclick = function () {
+        more.disabled = true;
+        loadPage(true, Z.state.listQuery || '');
+      };
+      fl.appendChild(more);
+    }
   }
 
   /* ── Create a card element ── */
@@ -160,8 +207,7 @@ var ZFTPD = ZFTPD || {};
           var key = th.getAttribute('data-sort');
           if (_sortKey === key) _sortAsc = !_sortAsc;
           else { _sortKey = key; _sortAsc = true; }
-          sortEntries();
-          render($('search') ? $('search').value : '');
+          refilter();
         };
       })(ths[h]);
     }
@@ -441,26 +487,36 @@ var ZFTPD = ZFTPD || {};
       });
 
       var startTime = Date.now();
+      function onProgress(d) {
+        if (d && d.total_bytes > 0) {
+          Z.updateTransferLock({
+            pct: Math.min(100, Math.floor(d.bytes_extracted * 100 / d.total_bytes))
+          });
+        }
+      }
+      /* Progress is pushed over /api/events; poll only without EventSource */
+      var unsubProgress = Z.api.events('extract', onProgress);
       var progressInterval = setInterval(function() {
          var elapsed = Math.floor((Date.now() - startTime) / 1000);
          Z.updateTransferLock({ elapsed: elapsed + 's' });
-         /* If your API supports extract progress, poll it here */
-         Z.api.extractProgress().then(function(d) {
-           if (d && typeof d.progress === 'number') {
-             Z.updateTransferLock({ pct: d.progress });
-           }
-         }).catch(function(){});
+         if (!unsubProgress) {
+           Z.api.extractProgress().then(onProgress).catch(function(){});
+         }
       }, 1000);
+      function stopProgress() {
+        clearInterval(progressInterval);
+        if (unsubProgress) unsubProgress();
+      }
 
       Z.api.extract(archivePath, dst).then(function () {
-        clearInterval(progressInterval);
+        stopProgress();
         if (!cancelled) {
           Z.hideTransferLock();
           Z.notify('Extracted', 'Successfully extracted to ' + dst, 'ok');
           explorer.nav(Z.state.path);
         }
       }).catch(function (e) {
-        clearInterval(progressInterval);
+        stopProgress();
         Z.hideTransferLock();
         Z.notify('Extract failed', e.message, 'er');
       });
@@ -552,7 +608,10 @@ var ZFTPD = ZFTPD || {};
 
   function updateCount() {
     var el = $('fl-count');
-    if (el) el.innerHTML = '<b>' + (Z.state.entries ? Z.state.entries.length : 0) + '</b> items';
+    var n = Z.state.entries ? Z.state.entries.length : 0;
+    if (el) el.innerHTML = Z.state.listNext
+      ? '<b>' + n + '</b> of ' + Z.state.listTotal + ' items'
+      : '<b>' + n + '</b> items';
   }
 
   /* ── Init (called when view becomes active) ── */
@@ -568,7 +627,7 @@ var ZFTPD = ZFTPD || {};
     var br = $('btn-ref');
     if (br) br.onclick = function () { explorer.nav(Z.state.path); };
     var sr = $('search');
-    if (sr) sr.oninput = Z.debounce(function () { render(sr.value); }, 150);
+    if (sr) sr.oninput = Z.debounce(refilter, 150);
     var fi = $('file-input');
     if (fi) fi.onchange = function (e) { explorer.upload(e.target.files); e.target.value = ''; };
 
@@ -113,7 +113,7 @@ var ZFTPD = ZFTPD || {};
       var id = g.id || '';
       var name = g.name || id || 'Unknown';
       var path = g.path || '';
-      var icon = Z.api.gameInstalledIconUrl(id, path) + '&_t=' + Date.now();
+      var icon = Z.api.gameInstalledIconUrl(id, path, 256);
 
       var row = D.createElement('article');
       row.className = 'games-card';
@@ -271,8 +271,8 @@ var ZFTPD = ZFTPD || {};
       var path = g.path || '';
       var canInstall = /\.(pkg|fpkg|ffpkg)$/i.test(path);
 
-      var cover = (g.meta && g.meta.icon_base64)
-        ? ('data:image/png;base64,' + g.meta.icon_base64)
+      var cover = (g.meta && g.meta.has_icon)
+        ? Z.api.gameIconUrl(path, 256)
         : '/assets/zftpd-logo.png';
 
       var row = D.createElement('article');